@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+namespace porla::Benchmarks
+{
+    // Calls to the global operator new so far, which the benchmarks replace to count them.
+    std::uint64_t Allocations();
+}
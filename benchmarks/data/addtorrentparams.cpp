@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <sqlite3.h>
+
+#include "../../src/data/migrate.hpp"
+#include "../../src/data/models/addtorrentparams.hpp"
+#include "../../src/data/statement.hpp"
+#include "../../src/torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Data::Models::AddTorrentParams;
+
+// A torrent of a few files with random piece hashes, sized like a typical release.
+static lt::add_torrent_params MakeParams(std::mt19937& rng, int index)
+{
+    lt::file_storage fs;
+    const auto dir = "Synthetic.Torrent." + std::to_string(index) + ".1080p";
+
+    fs.add_file(dir + "/video.mkv", std::int64_t(4) * 1024 * 1024 * 1024);
+    fs.add_file(dir + "/sample.mkv", 50 * 1024 * 1024);
+    fs.add_file(dir + "/info.nfo", 4096);
+
+    lt::create_torrent ct(fs, 4 * 1024 * 1024, lt::create_torrent::v1_only);
+
+    for (lt::piece_index_t i(0); i < lt::piece_index_t(ct.num_pieces()); i++)
+    {
+        lt::sha1_hash hash;
+        for (auto& b : hash) { b = static_cast<std::uint8_t>(rng()); }
+        ct.set_hash(i, hash);
+    }
+
+    std::vector<char> buf;
+    lt::bencode(std::back_inserter(buf), ct.generate());
+
+    lt::add_torrent_params params;
+    params.ti         = std::make_shared<lt::torrent_info>(buf, lt::from_span);
+    params.name       = dir;
+    params.save_path  = "/data/torrents";
+    params.added_time = 1600000000 + index;
+
+    return params;
+}
+
+static sqlite3* MakeDatabase(int count, bool compress)
+{
+    sqlite3* db;
+    sqlite3_open(":memory:", &db);
+    porla::Data::Migrate(db);
+
+    std::mt19937 rng(1337);
+    porla::TorrentClientData client_data;
+
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+    for (int i = 0; i < count; i++)
+    {
+        auto params = MakeParams(rng, i);
+
+        AddTorrentParams::Insert(db, params.ti->info_hashes(), AddTorrentParams{
+            .client_data    = &client_data,
+            .name           = params.name,
+            .params         = params,
+            .queue_position = i,
+            .save_path      = params.save_path
+        }, compress);
+    }
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    return db;
+}
+
+static std::int64_t DatabaseSize(sqlite3* db)
+{
+    std::int64_t size = 0;
+
+    porla::Data::Statement::Prepare(db, "SELECT page_count * page_size FROM pragma_page_count(), pragma_page_size();")
+        .Step([&size](const auto& row)
+        {
+            size = row.GetInt64(0);
+            return SQLITE_OK;
+        });
+
+    return size;
+}
+
+// Reads and decodes every row like loading the session does, and reports the database
+// size for the same torrents.
+static void BM_AddTorrentParams_Load(benchmark::State& state)
+{
+    sqlite3* db = MakeDatabase(static_cast<int>(state.range(0)), state.range(1) != 0);
+
+    for (auto _ : state)
+    {
+        AddTorrentParams::ForEachRow(
+            db,
+            [](AddTorrentParams::Row&& row)
+            {
+                lt::add_torrent_params params;
+                benchmark::DoNotOptimize(AddTorrentParams::Decode(row, params));
+                delete params.userdata.get<porla::TorrentClientData>();
+            });
+    }
+
+    state.counters["db_bytes"] = static_cast<double>(DatabaseSize(db));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(state.range(1) != 0 ? "compressed" : "uncompressed");
+
+    porla::Data::Statement::ClearCache(db);
+    sqlite3_close(db);
+}
+
+BENCHMARK(BM_AddTorrentParams_Load)->ArgsProduct({
+    {1000},
+    {0, 1}
+})->Unit(benchmark::kMillisecond);
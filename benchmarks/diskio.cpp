@@ -0,0 +1,232 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include <libtorrent/alert_types.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/config.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/disk_buffer_holder.hpp>
+#include <libtorrent/io_context.hpp>
+#include <libtorrent/performance_counters.hpp>
+#include <libtorrent/session.hpp>
+#include <libtorrent/storage_defs.hpp>
+#include <libtorrent/torrent_info.hpp>
+
+#include "../src/diskio.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+// Where the payload is written. Point it at the storage being measured, since the
+// temporary directory is often a tmpfs.
+static fs::path Directory()
+{
+    if (const auto dir = std::getenv("PORLA_BENCH_DISK_DIR")) return dir;
+    return fs::temp_directory_path() / "porla-bench-disk";
+}
+
+// In MiB. Make it larger than the page cache to measure the storage rather than memory.
+static std::int64_t PayloadSize()
+{
+    if (const auto size = std::getenv("PORLA_BENCH_DISK_SIZE")) return std::stoll(size) * 1024 * 1024;
+    return 512ll * 1024 * 1024;
+}
+
+// A file of random data and a torrent of it, created once and kept between runs.
+static std::shared_ptr<const lt::torrent_info> Payload()
+{
+    static const auto ti = []()
+    {
+        const auto dir  = Directory();
+        const auto file = dir / "payload.bin";
+
+        fs::create_directories(dir);
+
+        if (!fs::exists(file) || static_cast<std::int64_t>(fs::file_size(file)) != PayloadSize())
+        {
+            std::ofstream out(file, std::ios::binary | std::ios::trunc);
+            std::mt19937_64 rng(1337);
+            std::vector<std::uint64_t> block(1024 * 1024 / sizeof(std::uint64_t));
+
+            for (std::int64_t written = 0; written < PayloadSize(); written += 1024 * 1024)
+            {
+                for (auto& value : block) value = rng();
+                out.write(reinterpret_cast<const char*>(block.data()), 1024 * 1024);
+            }
+        }
+
+        lt::file_storage files;
+        lt::add_files(files, file.string());
+
+        lt::create_torrent ct(files, 4 * 1024 * 1024);
+        lt::set_piece_hashes(ct, dir.string());
+
+        std::vector<char> buf;
+        lt::bencode(std::back_inserter(buf), ct.generate());
+
+        return std::make_shared<const lt::torrent_info>(buf, lt::from_span);
+    }();
+
+    return ti;
+}
+
+static bool WaitForChecked(lt::session& session)
+{
+    for (;;)
+    {
+        if (session.wait_for_alert(lt::seconds(60)) == nullptr)
+        {
+            return false;
+        }
+
+        std::vector<lt::alert*> alerts;
+        session.pop_alerts(&alerts);
+
+        for (const auto alert : alerts)
+        {
+            if (lt::alert_cast<lt::torrent_checked_alert>(alert)) return true;
+        }
+    }
+}
+
+// Rechecks the payload, which reads and hashes all of it through the backend like seeding
+// and rechecking do. Writes need peers and are not measured.
+static void BM_DiskIoRecheck(benchmark::State& state, const std::string& backend)
+{
+    const auto ti = Payload();
+
+    lt::settings_pack settings;
+    settings.set_str(lt::settings_pack::listen_interfaces, "127.0.0.1:0");
+    settings.set_bool(lt::settings_pack::enable_dht, false);
+    settings.set_bool(lt::settings_pack::enable_lsd, false);
+    settings.set_bool(lt::settings_pack::enable_natpmp, false);
+    settings.set_bool(lt::settings_pack::enable_upnp, false);
+    settings.set_int(lt::settings_pack::alert_mask, static_cast<int>(static_cast<std::uint32_t>(lt::alert_category::status)));
+
+    lt::session_params params(std::move(settings));
+    params.disk_io_constructor = *porla::DiskIo::Constructor(backend);
+
+    lt::session session(std::move(params));
+
+    lt::add_torrent_params p;
+    p.ti        = std::make_shared<lt::torrent_info>(*ti);
+    p.save_path = Directory().string();
+    p.flags    &= ~(lt::torrent_flags::auto_managed | lt::torrent_flags::paused);
+
+    const auto th = session.add_torrent(std::move(p));
+
+    if (!WaitForChecked(session))
+    {
+        state.SkipWithError("Timed out waiting for the initial check");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        th.force_recheck();
+
+        if (!WaitForChecked(session))
+        {
+            state.SkipWithError("Timed out waiting for the recheck");
+            return;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * ti->total_size());
+}
+
+// Reads the payload block by block straight from the backend, with as many reads in
+// flight as a busy seed would have. Unlike rechecks, these go through async_read, which
+// is what the io_uring backend serves.
+static void BM_DiskIoRead(benchmark::State& state, const std::string& backend)
+{
+    const auto ti = Payload();
+    const int  inflight = static_cast<int>(state.range(0));
+
+    lt::io_context ios;
+    lt::settings_pack settings;
+    lt::counters counters;
+
+    auto disk = (*porla::DiskIo::Constructor(backend))(ios, settings, counters);
+
+    const auto& files = ti->files();
+
+    auto storage = disk->new_torrent(
+        lt::storage_params(files, nullptr, Directory().string(), lt::storage_mode_sparse, {}, ti->info_hashes().get_best()),
+        {});
+
+    const int blocks_per_piece = ti->piece_length() / lt::default_block_size;
+    const int blocks = static_cast<int>((ti->total_size() + lt::default_block_size - 1) / lt::default_block_size);
+
+    for (auto _ : state)
+    {
+        int next   = 0;
+        int failed = 0;
+
+        std::function<void()> issue;
+
+        issue = [&]()
+        {
+            if (next >= blocks) return;
+
+            const int block = next++;
+
+            lt::peer_request r;
+            r.piece  = lt::piece_index_t(block / blocks_per_piece);
+            r.start  = (block % blocks_per_piece) * lt::default_block_size;
+            r.length = std::min(lt::default_block_size, files.piece_size(r.piece) - r.start);
+
+            disk->async_read(storage, r, [&](lt::disk_buffer_holder, const lt::storage_error& error)
+            {
+                if (error) failed++;
+                issue();
+                disk->submit_jobs();
+            });
+        };
+
+        for (int i = 0; i < inflight; i++) issue();
+
+        disk->submit_jobs();
+
+        ios.restart();
+        ios.run();
+
+        if (failed > 0)
+        {
+            state.SkipWithError("Failed to read blocks");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * ti->total_size());
+
+    storage.reset();
+    disk->abort(true);
+}
+
+BENCHMARK_CAPTURE(BM_DiskIoRecheck, default, std::string("default"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
+#if TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE
+BENCHMARK_CAPTURE(BM_DiskIoRecheck, mmap, std::string("mmap"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
+#endif
+BENCHMARK_CAPTURE(BM_DiskIoRecheck, posix, std::string("posix"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
+#ifdef PORLA_WITH_IO_URING
+BENCHMARK_CAPTURE(BM_DiskIoRecheck, io_uring, std::string("io_uring"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3);
+#endif
+
+BENCHMARK_CAPTURE(BM_DiskIoRead, default, std::string("default"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3)->Arg(64);
+#if TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE
+BENCHMARK_CAPTURE(BM_DiskIoRead, mmap, std::string("mmap"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3)->Arg(64);
+#endif
+BENCHMARK_CAPTURE(BM_DiskIoRead, posix, std::string("posix"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3)->Arg(64);
+#ifdef PORLA_WITH_IO_URING
+BENCHMARK_CAPTURE(BM_DiskIoRead, io_uring, std::string("io_uring"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3)->Arg(64)->Arg(512);
+BENCHMARK_CAPTURE(BM_DiskIoRead, io_uring_direct, std::string("io_uring_direct"))->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(3)->Arg(64)->Arg(512);
+#endif
@@ -0,0 +1,60 @@
+#include "fleet.hpp"
+
+#include <random>
+
+namespace lt = libtorrent;
+
+std::vector<lt::torrent_status> porla::Benchmarks::MakeFleet(int count)
+{
+    static const lt::torrent_status::state_t states[] =
+    {
+        lt::torrent_status::checking_files,
+        lt::torrent_status::downloading,
+        lt::torrent_status::finished,
+        lt::torrent_status::seeding
+    };
+
+    std::mt19937 rng(1337);
+    std::uniform_int_distribution<int> rate(0, 10 * 1024 * 1024);
+    std::uniform_real_distribution<float> progress(0.f, 1.f);
+
+    std::vector<lt::torrent_status> fleet;
+    fleet.reserve(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        lt::sha1_hash hash;
+
+        for (auto& b : hash) { b = static_cast<std::uint8_t>(rng()); }
+
+        lt::torrent_status ts;
+        ts.info_hashes       = lt::info_hash_t(hash);
+        ts.name              = "Synthetic.Torrent." + std::to_string(i) + ".1080p";
+        ts.save_path         = "/data/torrents/" + std::to_string(i % 16);
+        ts.added_time        = 1600000000 + i;
+        ts.download_rate     = i % 3 == 0 ? rate(rng) : 0;
+        ts.upload_rate       = i % 2 == 0 ? rate(rng) : 0;
+        ts.state             = states[i % std::size(states)];
+        ts.progress          = ts.state == lt::torrent_status::downloading ? progress(rng) : 1.f;
+        ts.queue_position    = lt::queue_position_t{ts.state == lt::torrent_status::downloading ? i : -1};
+        ts.flags             = i % 5 == 0 ? lt::torrent_flags::paused : lt::torrent_flags_t{};
+        ts.all_time_download = rate(rng);
+        ts.all_time_upload   = rate(rng) * (i % 4);
+        ts.total             = ts.all_time_download;
+        ts.total_done        = static_cast<std::int64_t>(ts.total * ts.progress);
+        ts.total_wanted      = ts.total;
+
+        fleet.push_back(std::move(ts));
+    }
+
+    return fleet;
+}
+
+void porla::Benchmarks::Seed(InMemorySession& session, const std::vector<lt::torrent_status>& fleet)
+{
+    for (const auto& ts : fleet)
+    {
+        session.m_statuses.insert_or_assign(ts.info_hashes, ts);
+        session.m_torrentAdded(ts);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+#include <libtorrent/torrent_status.hpp>
+
+#include "../tests/inmemorysession.hpp"
+
+namespace porla::Benchmarks
+{
+    // Deterministic synthetic torrents with a spread of states, rates and save paths. The
+    // handles are invalid, so the torrents have no client data (category, tags).
+    std::vector<libtorrent::torrent_status> MakeFleet(int count);
+
+    // Seeds the session status cache and fires the added signal for every torrent, so any
+    // index or column snapshot subscribed to the session sees them.
+    void Seed(InMemorySession& session, const std::vector<libtorrent::torrent_status>& fleet);
+}
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include "fleet.hpp"
+#include "nullhttpcontext.hpp"
+#include "../src/httpeventstream.hpp"
+
+using boost::asio::ip::tcp;
+
+// An event stream subscriber backed by a loopback connection, so broadcasts go through
+// real socket writes.
+class LoopbackContext : public porla::Benchmarks::NullHttpContext
+{
+public:
+    LoopbackContext(boost::asio::io_context& io, tcp::socket socket)
+        : NullHttpContext(io)
+        , m_stream(std::move(socket))
+    {
+    }
+
+    boost::beast::tcp_stream& Stream() override { return m_stream; }
+
+private:
+    boost::beast::tcp_stream m_stream;
+};
+
+// Runs pending writes and reads everything the clients received until both sides are idle.
+static void Flush(boost::asio::io_context& io, std::vector<tcp::socket>& clients)
+{
+    char buf[64 * 1024];
+
+    do
+    {
+        for (auto& client : clients)
+        {
+            boost::system::error_code ec;
+            while (client.read_some(boost::asio::buffer(buf), ec) > 0) {}
+        }
+    }
+    while (io.poll() > 0);
+}
+
+static void BM_HttpEventStream_StateUpdate(benchmark::State& state)
+{
+    const auto torrents    = static_cast<int>(state.range(0));
+    const auto subscribers = static_cast<int>(state.range(1));
+
+    boost::asio::io_context io;
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+
+    InMemorySession session;
+    porla::HttpEventStream stream(io, session);
+
+    std::vector<tcp::socket> clients;
+
+    for (int i = 0; i < subscribers; i++)
+    {
+        auto& client = clients.emplace_back(io);
+        client.connect(acceptor.local_endpoint());
+        client.non_blocking(true);
+
+        stream(std::make_shared<LoopbackContext>(io, acceptor.accept()));
+    }
+
+    const auto fleet = porla::Benchmarks::MakeFleet(torrents);
+
+    Flush(io, clients);
+
+    for (auto _ : state)
+    {
+        session.m_stateUpdate(fleet);
+        Flush(io, clients);
+    }
+
+    state.SetItemsProcessed(state.iterations() * torrents * subscribers);
+}
+
+BENCHMARK(BM_HttpEventStream_StateUpdate)->ArgsProduct({
+    {1000, 10000, 100000},
+    {1, 8, 64}
+})->Unit(benchmark::kMillisecond);
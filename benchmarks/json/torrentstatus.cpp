@@ -0,0 +1,19 @@
+#include <benchmark/benchmark.h>
+
+#include "../fleet.hpp"
+#include "../../src/json/lttorrentstatus.hpp"
+
+static void BM_Json_TorrentStatus(benchmark::State& state)
+{
+    const auto fleet = porla::Benchmarks::MakeFleet(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        nlohmann::json j = fleet;
+        benchmark::DoNotOptimize(j.dump());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_Json_TorrentStatus)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
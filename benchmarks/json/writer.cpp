@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "../fleet.hpp"
+#include "../../src/json/ltpeerinfo.hpp"
+#include "../../src/json/torrentslist.hpp"
+#include "../../src/json/writer.hpp"
+
+using porla::Methods::TorrentsListRes;
+
+// Serializes the items one at a time into a single buffer, as a streamed response does,
+// either through a nlohmann::json per item or written directly.
+template<bool Direct, typename TItem, typename TWrite>
+static void Serialize(benchmark::State& state, const std::vector<TItem>& items, const TWrite& write)
+{
+    std::string out;
+
+    nlohmann::detail::serializer<nlohmann::json> serializer(
+        nlohmann::detail::output_adapter<char>(out), ' ');
+
+    for (auto _ : state)
+    {
+        out.clear();
+
+        for (const auto& item : items)
+        {
+            out.push_back(',');
+
+            if constexpr (Direct) { write(out, item); }
+            else                  { serializer.dump(nlohmann::json(item), false, false, 0); }
+        }
+
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * items.size());
+}
+
+template<bool Direct>
+static void BM_Json_TorrentsListItems(benchmark::State& state)
+{
+    std::vector<TorrentsListRes::Item> items;
+
+    for (const auto& ts : porla::Benchmarks::MakeFleet(static_cast<int>(state.range(0))))
+    {
+        items.push_back({
+            .added_time     = ts.added_time,
+            .download_rate  = ts.download_payload_rate,
+            .error          = ts.errc,
+            .info_hash      = ts.info_hashes,
+            .name           = std::pmr::string(ts.name),
+            .progress       = ts.progress,
+            .queue_position = static_cast<int>(ts.queue_position),
+            .ratio          = 1.5,
+            .save_path      = std::pmr::string(ts.save_path),
+            .size           = ts.total_wanted,
+            .state          = static_cast<int>(ts.state),
+            .upload_rate    = ts.upload_payload_rate
+        });
+    }
+
+    Serialize<Direct>(state, items, [](std::string& out, const auto& item) { porla::Json::Write(out, item); });
+}
+
+template<bool Direct>
+static void BM_Json_PeersListItems(benchmark::State& state)
+{
+    std::vector<lt::peer_info> peers(state.range(0));
+
+    for (std::size_t i = 0; i < peers.size(); i++)
+    {
+        peers[i].client = "qBittorrent/4.6." + std::to_string(i % 10);
+        peers[i].ip = lt::tcp::endpoint(boost::asio::ip::make_address_v4(static_cast<std::uint32_t>(0x0a000000 + i)), 6881);
+        peers[i].progress = static_cast<float>(i % 100) / 100.0f;
+        peers[i].total_download = static_cast<std::int64_t>(i) * 16384;
+    }
+
+    Serialize<Direct>(state, peers, [](std::string& out, const lt::peer_info& pi)
+    {
+        bool first = true;
+        out.push_back('{');
+
+        for (const auto& [_, field] : porla::PeerInfoFields())
+        {
+            if (!first) out.push_back(',');
+            first = false;
+
+            out.append(field.key);
+            field.write(out, pi);
+        }
+
+        porla::Json::EndObject(out, first);
+    });
+}
+
+BENCHMARK_TEMPLATE(BM_Json_TorrentsListItems, false)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Json_TorrentsListItems, true)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Json_PeersListItems, false)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Json_PeersListItems, true)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "allocations.hpp"
+#include "nullhttpcontext.hpp"
+#include "../src/jsonrpchandler.hpp"
+#include "../src/methods/method.hpp"
+
+using porla::Methods::Method;
+using porla::Methods::WriteCb;
+
+namespace
+{
+    struct PingReq
+    {
+        std::string info_hash;
+    };
+
+    struct PingRes
+    {
+        std::string info_hash;
+        bool        paused;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(PingReq, info_hash)
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(PingRes, info_hash, paused)
+
+    // About as little as a method can do, like pausing a torrent or reading a property, so
+    // what is left is the cost of dispatching it.
+    class Ping : public Method<PingReq, PingRes>
+    {
+    protected:
+        void Invoke(const PingReq& req, WriteCb<PingRes> cb) override
+        {
+            cb(PingRes{ .info_hash = req.info_hash, .paused = true });
+        }
+    };
+}
+
+// One small call at a time through the whole handler, from the parsed request to the
+// encoded response, with as many other methods registered as the daemon has.
+static void BM_JsonRpcHandler_Dispatch(benchmark::State& state)
+{
+    std::map<std::string, porla::JsonRpcHandler::Handler> methods;
+
+    for (int i = 0; i < state.range(0); i++)
+    {
+        methods.insert({ "bench.method" + std::to_string(i), Ping() });
+    }
+
+    methods.insert({ "torrents.pause", Ping() });
+
+    porla::JsonRpcHandler rpc(std::move(methods));
+
+    boost::asio::io_context io;
+    auto ctx = std::make_shared<porla::Benchmarks::NullHttpContext>(io);
+
+    const nlohmann::json request = {
+        {"jsonrpc", "2.0"},
+        {"id", 1},
+        {"method", "torrents.pause"},
+        {"params", {{"info_hash", "6161616161616161616161616161616161616161"}}}
+    };
+
+    const auto allocations = porla::Benchmarks::Allocations();
+
+    for (auto _ : state)
+    {
+        rpc(request, ctx);
+    }
+
+    state.counters["allocs"] = benchmark::Counter(
+        static_cast<double>(porla::Benchmarks::Allocations() - allocations),
+        benchmark::Counter::kAvgIterations);
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(static_cast<std::int64_t>(ctx->Written()));
+}
+
+BENCHMARK(BM_JsonRpcHandler_Dispatch)->Arg(0)->Arg(64);
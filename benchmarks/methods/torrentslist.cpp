@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+
+#include "../allocations.hpp"
+#include "../fleet.hpp"
+#include "../nullhttpcontext.hpp"
+#include "../../src/methods/torrentslist.hpp"
+#include "../../src/torrentcolumns.hpp"
+#include "../../src/torrentindex.hpp"
+#include "../../src/torrentrevisions.hpp"
+
+using porla::Methods::TorrentsList;
+using porla::Methods::TorrentsListReq;
+using porla::Methods::TorrentsListRes;
+using porla::Methods::WriteCb;
+
+static const char* OrderBy[] =
+{
+    "queue_position",
+    "name",
+    "download_rate",
+    "progress",
+    "ratio"
+};
+
+static const char* Filters[] =
+{
+    "",
+    "is:downloading",
+    "progress < 0.5 and download_rate > 1mbps",
+    "name contains \"1080p\""
+};
+
+// Every field but the ones read from client data, which the synthetic torrents do not have.
+static const std::vector<std::string> AllFields =
+{
+    "all_time_download", "all_time_upload", "download_rate", "error", "eta", "flags", "info_hash",
+    "list_peers", "list_seeds", "moving_storage", "name", "num_peers", "num_seeds", "progress",
+    "queue_position", "ratio", "save_path", "size", "state", "total", "total_done", "upload_rate"
+};
+
+// Sessions are expensive to seed, so keep one per fleet size for the whole run.
+struct Fleet
+{
+    explicit Fleet(int count)
+        : index(session)
+        , revisions(session)
+        , columns(session)
+    {
+        porla::Benchmarks::Seed(session, porla::Benchmarks::MakeFleet(count));
+    }
+
+    InMemorySession session;
+    porla::TorrentIndex index;
+    porla::TorrentRevisions revisions;
+    porla::TorrentColumns columns;
+};
+
+static Fleet& GetFleet(int count)
+{
+    static std::map<int, std::unique_ptr<Fleet>> fleets;
+
+    auto& fleet = fleets[count];
+    if (!fleet) { fleet = std::make_unique<Fleet>(count); }
+
+    return *fleet;
+}
+
+static void Run(benchmark::State& state, const TorrentsListReq& req, bool use_columns)
+{
+    auto& fleet = GetFleet(static_cast<int>(state.range(0)));
+
+    boost::asio::io_context io;
+    auto ctx = std::make_shared<porla::Benchmarks::NullHttpContext>(io);
+
+    TorrentsList method(nullptr, fleet.session, fleet.index, fleet.revisions, use_columns ? &fleet.columns : nullptr);
+
+    const auto allocations = porla::Benchmarks::Allocations();
+
+    for (auto _ : state)
+    {
+        method.Invoke(req, WriteCb<TorrentsListRes>(1, ctx));
+    }
+
+    state.counters["allocs"] = benchmark::Counter(
+        static_cast<double>(porla::Benchmarks::Allocations() - allocations),
+        benchmark::Counter::kAvgIterations);
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(static_cast<std::int64_t>(ctx->Written()));
+}
+
+static void BM_TorrentsList_Sort(benchmark::State& state)
+{
+    const TorrentsListReq req{
+        .fields       = AllFields,
+        .order_by     = OrderBy[state.range(1)],
+        .order_by_dir = "desc"
+    };
+
+    Run(state, req, state.range(2) != 0);
+    state.SetLabel(*req.order_by);
+}
+
+static void BM_TorrentsList_Filter(benchmark::State& state)
+{
+    const TorrentsListReq req{
+        .fields  = AllFields,
+        .filters = std::map<std::string, nlohmann::json>{{"query", Filters[state.range(1)]}}
+    };
+
+    Run(state, req, state.range(2) != 0);
+    state.SetLabel(Filters[state.range(1)]);
+}
+
+static void BM_TorrentsList_Fields(benchmark::State& state)
+{
+    const TorrentsListReq req{
+        .fields   = std::vector<std::string>{"name", "progress", "state"},
+        .order_by = "progress"
+    };
+
+    Run(state, req, state.range(2) != 0);
+}
+
+BENCHMARK(BM_TorrentsList_Sort)->ArgsProduct({
+    {1000, 10000, 100000},
+    benchmark::CreateDenseRange(0, std::size(OrderBy) - 1, 1),
+    {0, 1}
+})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_TorrentsList_Filter)->ArgsProduct({
+    {1000, 10000, 100000},
+    benchmark::CreateDenseRange(0, std::size(Filters) - 1, 1),
+    {0, 1}
+})->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_TorrentsList_Fields)->ArgsProduct({
+    {1000, 10000, 100000},
+    {0},
+    {0, 1}
+})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/httpcontext.hpp"
+
+namespace porla::Benchmarks
+{
+    // Serializes JSON responses the same way HttpSession would and throws the result away.
+    class NullHttpContext : public porla::HttpContext
+    {
+    public:
+        explicit NullHttpContext(boost::asio::io_context& io)
+            : m_stream(io)
+        {
+        }
+
+        void Next() override {}
+
+        boost::beast::http::request<boost::beast::http::string_body>& Request() override { return m_req; }
+        Uri& RequestUri() override { return m_uri; }
+        boost::beast::tcp_stream& Stream() override { return m_stream; }
+
+        void Write(std::string body) override { m_written += body.size(); }
+        void Write(boost::beast::http::response<boost::beast::http::file_body> res) override {}
+        void Write(boost::beast::http::response<boost::beast::http::string_body> res) override { m_written += res.body().size(); }
+        void WriteJson(const nlohmann::json& j) override { m_written += j.dump().size(); }
+
+        void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) override
+        {
+            std::string chunk;
+            bool more = true;
+
+            while (more)
+            {
+                chunk.clear();
+                more = next(chunk);
+                m_written += chunk.size();
+            }
+        }
+
+        [[nodiscard]] std::size_t Written() const { return m_written; }
+
+    private:
+        boost::beast::http::request<boost::beast::http::string_body> m_req;
+        Uri m_uri;
+        boost::beast::tcp_stream m_stream;
+        std::size_t m_written = 0;
+    };
+}
@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+
+#include "../fleet.hpp"
+#include "../../src/query/pql.hpp"
+
+using porla::Query::PQL;
+
+static const char* Queries[] =
+{
+    "is:seeding",
+    "progress >= 0.5 and download_rate > 1mbps",
+    "name contains \"1080p\" or not is:paused and ratio < 1.5",
+    "save_path = \"/data/torrents/1\" or save_path = \"/data/torrents/2\" or save_path = \"/data/torrents/3\"",
+    "is:seeding and age > 1h and upload_rate > 100kbps and size < 1gb or is:downloading"
+};
+
+static void BM_PQL_Parse(benchmark::State& state)
+{
+    const auto query = Queries[state.range(0)];
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(PQL::Parse(query));
+    }
+
+    state.SetLabel(query);
+}
+
+static void BM_PQL_ParseAntlr(benchmark::State& state)
+{
+    const auto query = Queries[state.range(0)];
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(PQL::ParseAntlr(query));
+    }
+
+    state.SetLabel(query);
+}
+
+static void BM_PQL_Includes(benchmark::State& state)
+{
+    const auto query  = Queries[state.range(0)];
+    const auto fleet  = porla::Benchmarks::MakeFleet(static_cast<int>(state.range(1)));
+    const auto filter = PQL::Parse(query);
+
+    for (auto _ : state)
+    {
+        std::int64_t matches = 0;
+
+        for (const auto& ts : fleet)
+        {
+            matches += filter->Includes(ts);
+        }
+
+        benchmark::DoNotOptimize(matches);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+    state.SetLabel(query);
+}
+
+BENCHMARK(BM_PQL_Parse)->DenseRange(0, std::size(Queries) - 1);
+BENCHMARK(BM_PQL_ParseAntlr)->DenseRange(0, std::size(Queries) - 1);
+BENCHMARK(BM_PQL_Includes)->ArgsProduct({
+    benchmark::CreateDenseRange(0, std::size(Queries) - 1, 1),
+    {1000, 10000, 100000}
+});
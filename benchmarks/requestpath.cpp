@@ -0,0 +1,408 @@
+// End to end timings of the request path, from a client socket through the HTTP server,
+// the router and the JSON-RPC handler to the methods and back, with SSE clients reading
+// the state updates at the same time. Runs the real server on an ephemeral port over an
+// in-memory session, so what is measured is porla and not libtorrent.
+//
+// The results are written as JSON to PORLA_BENCH_RESULTS, and checked against the ones in
+// PORLA_BENCH_BASELINE when it is set, failing the test for a scenario which got slower
+// than the baseline by more than PORLA_BENCH_TOLERANCE. Keep baselines per machine, since
+// the numbers only compare on the same hardware.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <nlohmann/json.hpp>
+
+#include "fleet.hpp"
+#include "../src/httpeventstream.hpp"
+#include "../src/httpmiddleware.hpp"
+#include "../src/httprouter.hpp"
+#include "../src/httpserver.hpp"
+#include "../src/jsonrpchandler.hpp"
+#include "../src/methods/torrentslist.hpp"
+#include "../src/methods/torrentspause.hpp"
+#include "../src/torrentcolumns.hpp"
+#include "../src/torrentindex.hpp"
+#include "../src/torrentrevisions.hpp"
+
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using tcp = boost::asio::ip::tcp;
+
+static int EnvInt(const char* name, int fallback)
+{
+    if (const auto value = std::getenv(name)) return std::atoi(value);
+    return fallback;
+}
+
+static double EnvDouble(const char* name, double fallback)
+{
+    if (const auto value = std::getenv(name)) return std::atof(value);
+    return fallback;
+}
+
+// Latencies of one kind of call, over every client making it.
+class Recorder
+{
+public:
+    void Record(double seconds, bool ok)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_latencies.push_back(seconds);
+        if (!ok) m_errors++;
+    }
+
+    [[nodiscard]] json Summary(double elapsed)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        const auto percentile = [this](double p)
+        {
+            if (m_latencies.empty()) return 0.0;
+
+            const auto nth = m_latencies.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(m_latencies.size() - 1));
+            std::nth_element(m_latencies.begin(), nth, m_latencies.end());
+            return *nth * 1000;
+        };
+
+        return {
+            {"requests", m_latencies.size()},
+            {"errors", m_errors},
+            {"throughput", static_cast<double>(m_latencies.size()) / elapsed},
+            {"p50_ms", percentile(0.5)},
+            {"p99_ms", percentile(0.99)}
+        };
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<double> m_latencies;
+    std::uint64_t m_errors = 0;
+};
+
+// A keep-alive connection making one JSON-RPC call at a time.
+class RpcClient
+{
+public:
+    explicit RpcClient(const tcp::endpoint& endpoint)
+        : m_stream(m_io)
+    {
+        m_stream.connect(endpoint);
+    }
+
+    void Call(const std::string& method, const json& params, Recorder& recorder)
+    {
+        http::request<http::string_body> req{ http::verb::post, "/api/v1/jsonrpc", 11 };
+        req.set(http::field::host, "127.0.0.1");
+        req.set(http::field::content_type, "application/json");
+        req.body() = json{{"jsonrpc", "2.0"}, {"id", m_id++}, {"method", method}, {"params", params}}.dump();
+        req.prepare_payload();
+
+        const auto started = std::chrono::steady_clock::now();
+
+        http::response<http::string_body> res;
+
+        http::write(m_stream, req);
+        http::read(m_stream, m_buffer, res);
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        const bool ok = res.result() == http::status::ok && !json::parse(res.body()).contains("error");
+
+        recorder.Record(elapsed, ok);
+    }
+
+private:
+    boost::asio::io_context m_io;
+    beast::tcp_stream m_stream;
+    beast::flat_buffer m_buffer;
+    int m_id = 0;
+};
+
+struct EventTotals
+{
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<std::uint64_t> events{0};
+};
+
+// Reads an event stream until told to stop, counting the events in it.
+static void ReadEvents(const tcp::endpoint& endpoint, const std::atomic<bool>& stop, EventTotals& totals)
+{
+    boost::asio::io_context io;
+    tcp::socket socket(io);
+
+    socket.connect(endpoint);
+
+    http::request<http::empty_body> req{ http::verb::get, "/api/v1/events", 11 };
+    req.set(http::field::host, "127.0.0.1");
+    req.set(http::field::accept, "text/event-stream");
+    http::write(socket, req);
+
+    static const std::string Marker = "\nevent: ";
+
+    std::string carry;
+    std::array<char, 16 * 1024> buffer{};
+    std::function<void()> read;
+
+    read = [&]()
+    {
+        socket.async_read_some(
+            boost::asio::buffer(buffer),
+            [&](const boost::system::error_code& ec, std::size_t size)
+            {
+                if (ec) { return; }
+
+                totals.bytes += size;
+
+                // Kept from the last read, so a marker split over two reads is still seen.
+                carry.append(buffer.data(), size);
+
+                for (auto pos = carry.find(Marker); pos != std::string::npos; pos = carry.find(Marker, pos + Marker.size()))
+                {
+                    totals.events++;
+                }
+
+                carry.erase(0, carry.size() > Marker.size() ? carry.size() - Marker.size() + 1 : 0);
+
+                read();
+            });
+    };
+
+    read();
+
+    // Woken up now and then to see if the run is over. Stops on its own if the server
+    // closes the stream.
+    while (!stop && !io.stopped())
+    {
+        io.run_for(std::chrono::milliseconds(200));
+    }
+}
+
+class RequestPathPerf : public ::testing::Test
+{
+protected:
+    RequestPathPerf()
+        : index(session)
+        , revisions(session)
+        , columns(session)
+        , fleet(porla::Benchmarks::MakeFleet(EnvInt("PORLA_BENCH_TORRENTS", 50000)))
+    {
+        porla::Benchmarks::Seed(session, fleet);
+    }
+
+    // Changes the rates of a slice of the torrents every interval, like the state updates
+    // of a busy session, so the event stream has something to send.
+    void ScheduleStateUpdate(boost::asio::steady_timer& timer, std::size_t& offset)
+    {
+        timer.expires_after(std::chrono::milliseconds(250));
+        timer.async_wait(
+            [this, &timer, &offset](const boost::system::error_code& ec)
+            {
+                if (ec) { return; }
+
+                std::vector<lt::torrent_status> updated;
+                updated.reserve(1000);
+
+                for (std::size_t i = 0; i < 1000 && !fleet.empty(); i++)
+                {
+                    auto& ts = fleet[(offset + i) % fleet.size()];
+                    ts.download_rate = ts.download_rate > 0 ? 0 : static_cast<int>(offset % 4096) * 1024;
+                    session.m_statuses.insert_or_assign(ts.info_hashes, ts);
+                    updated.push_back(ts);
+                }
+
+                offset += updated.size();
+                session.m_stateUpdate(updated);
+
+                ScheduleStateUpdate(timer, offset);
+            });
+    }
+
+    InMemorySession session;
+    porla::TorrentIndex index;
+    porla::TorrentRevisions revisions;
+    porla::TorrentColumns columns;
+    std::vector<lt::torrent_status> fleet;
+};
+
+TEST_F(RequestPathPerf, MixedTraffic)
+{
+    const auto duration     = std::chrono::seconds(std::max(1, EnvInt("PORLA_BENCH_SECONDS", 10)));
+    const int  list_clients = std::max(1, EnvInt("PORLA_BENCH_LIST_CLIENTS", 4));
+    const int  sse_clients  = std::max(0, EnvInt("PORLA_BENCH_SSE_CLIENTS", 16));
+
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+
+    porla::JsonRpcHandler rpc({
+        {"torrents.list", porla::Methods::TorrentsList(nullptr, session, index, revisions, &columns)},
+        {"torrents.pause", porla::Methods::TorrentsPause(session)}
+    });
+
+    porla::HttpEventStream events(io, session);
+
+    porla::HttpServer server(io, porla::HttpServerOptions{ .host = "127.0.0.1", .port = 0 });
+
+    const auto on_main = [&io](porla::HttpMiddleware middleware)
+    {
+        return porla::HttpDispatch(io.get_executor(), std::move(middleware));
+    };
+
+    porla::HttpRouter router;
+    router.Post("/api/v1/jsonrpc", on_main([&rpc](auto const& ctx) { rpc(ctx); }));
+    router.Get("/api/v1/events", on_main([&events](auto const& ctx) { events(ctx); }));
+
+    server.Use(router);
+    server.Use(porla::HttpNotFound());
+
+    const auto endpoint = tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), server.Endpoint().port());
+
+    boost::asio::steady_timer updates(io);
+    std::size_t offset = 0;
+    ScheduleStateUpdate(updates, offset);
+
+    std::thread io_thread([&io]() { io.run(); });
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> clients;
+
+    Recorder lists;
+    Recorder pauses;
+    EventTotals totals;
+
+    for (int i = 0; i < sse_clients; i++)
+    {
+        clients.emplace_back([&]() { ReadEvents(endpoint, stop, totals); });
+    }
+
+    // Pages through the torrents the way the web UI does, with a few orders and filters.
+    static const char* OrderBy[] = { "queue_position", "name", "download_rate", "progress", "ratio" };
+
+    for (int i = 0; i < list_clients; i++)
+    {
+        clients.emplace_back(
+            [&, i]()
+            {
+                RpcClient client(endpoint);
+
+                for (int n = i; !stop; n++)
+                {
+                    json params = {
+                        {"page", n % 20},
+                        {"page_size", 100},
+                        {"order_by", OrderBy[n % std::size(OrderBy)]},
+                        {"order_by_dir", n % 2 == 0 ? "asc" : "desc"}
+                    };
+
+                    if (n % 3 == 0) params["filters"] = {{"query", "is:downloading and progress < 0.5"}};
+
+                    client.Call("torrents.list", params, lists);
+                }
+            });
+    }
+
+    clients.emplace_back(
+        [&]()
+        {
+            RpcClient client(endpoint);
+
+            while (!stop)
+            {
+                client.Call("torrents.pause", {{"query", "is:downloading and progress < 0.05"}}, pauses);
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        });
+
+    const auto started = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+
+    for (auto& client : clients) client.join();
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    boost::asio::post(io, [&updates]() { updates.cancel(); });
+    work.reset();
+    io.stop();
+    io_thread.join();
+
+    const json results = {
+        {"torrents", fleet.size()},
+        {"seconds", elapsed},
+        {"scenarios", {
+            {"torrents.list", lists.Summary(elapsed)},
+            {"torrents.pause", pauses.Summary(elapsed)},
+            {"events", {
+                {"clients", sse_clients},
+                {"events", totals.events.load()},
+                {"bytes", totals.bytes.load()},
+                {"throughput", static_cast<double>(totals.events.load()) / elapsed}
+            }}
+        }}
+    };
+
+    std::cout << results.dump(2) << "\n";
+
+    for (const auto& [name, scenario] : results["scenarios"].items())
+    {
+        if (scenario.contains("p99_ms")) RecordProperty(name + ".p99_ms", std::to_string(scenario["p99_ms"].get<double>()));
+        RecordProperty(name + ".throughput", std::to_string(scenario["throughput"].get<double>()));
+    }
+
+    if (const auto path = std::getenv("PORLA_BENCH_RESULTS"))
+    {
+        std::ofstream(path) << results.dump(2) << "\n";
+    }
+
+    EXPECT_EQ(results["scenarios"]["torrents.list"]["errors"], 0);
+    EXPECT_EQ(results["scenarios"]["torrents.pause"]["errors"], 0);
+
+    const auto baseline_path = std::getenv("PORLA_BENCH_BASELINE");
+
+    if (baseline_path == nullptr)
+    {
+        return;
+    }
+
+    std::ifstream baseline_file(baseline_path);
+    ASSERT_TRUE(baseline_file.is_open()) << "Failed to open baseline " << baseline_path;
+
+    const auto baseline  = json::parse(baseline_file);
+    const auto tolerance = EnvDouble("PORLA_BENCH_TOLERANCE", 0.25);
+
+    // Only scenarios in both are compared, so a baseline from before a scenario was added
+    // still works.
+    for (const auto& [name, expected] : baseline["scenarios"].items())
+    {
+        if (!results["scenarios"].contains(name)) continue;
+
+        const auto& actual = results["scenarios"][name];
+
+        if (expected.contains("p99_ms") && actual.contains("p99_ms"))
+        {
+            EXPECT_LE(actual["p99_ms"].get<double>(), expected["p99_ms"].get<double>() * (1 + tolerance))
+                << name << " p99 latency regressed";
+        }
+
+        EXPECT_GE(actual["throughput"].get<double>(), expected["throughput"].get<double>() * (1 - tolerance))
+            << name << " throughput regressed";
+    }
+}
@@ -0,0 +1,356 @@
+// Times what porla does at startup and shutdown, against a synthetic database of as many
+// torrents as asked for. Unlike the Google Benchmark suite, every phase runs once, since
+// most of them can only run once per database.
+//
+//   porla_startup_bench [--torrents <n>] [--dir <path>] [--dirty <fraction>] [--reuse]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <sqlite3.h>
+
+#include "../src/data/migrate.hpp"
+#include "../src/data/models/addtorrentparams.hpp"
+#include "../src/data/pragmas.hpp"
+#include "../src/data/statement.hpp"
+#include "../src/session.hpp"
+#include "../src/torrentclientdata.hpp"
+#include "../src/utils/phases.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::Data::Models::AddTorrentParams;
+
+struct Args
+{
+    int      torrents = 10000;
+    fs::path dir      = fs::temp_directory_path() / "porla-startup-bench";
+    // The share of torrents changed after loading, which are the ones shutdown saves.
+    double   dirty    = 1.0;
+    bool     reuse    = false;
+};
+
+struct Result
+{
+    std::string name;
+    double      seconds;
+    long        peak_rss_kb;
+    std::string detail;
+};
+
+static long PeakRss()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static double Seconds(std::chrono::steady_clock::duration elapsed)
+{
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+static bool ParseArgs(int argc, char* argv[], Args& args)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--torrents" && has_value)     { args.torrents = std::atoi(argv[++i]); }
+        else if (arg == "--dir" && has_value)     { args.dir = argv[++i]; }
+        else if (arg == "--dirty" && has_value)   { args.dirty = std::atof(argv[++i]); }
+        else if (arg == "--reuse")                { args.reuse = true; }
+        else { return false; }
+    }
+
+    return args.torrents > 0 && args.dirty >= 0 && args.dirty <= 1;
+}
+
+// A torrent shaped like the ones a long running instance has: a spread of sizes and piece
+// counts, most of it downloaded, a few trackers and known peers, transfer totals, and a
+// category and tags from small sets.
+static AddTorrentParams MakeTorrent(std::mt19937& rng, int index, const fs::path& save_path, porla::TorrentClientData* client_data)
+{
+    static const char* Categories[] = { "movies", "tv", "music", "linux", "books" };
+    static const char* Tags[] = { "hd", "private", "archive", "seed-forever", "new", "remux" };
+
+    const int files = 1 + static_cast<int>(rng() % 12);
+    // 100 MiB to about 50 GiB, so piece counts range from hundreds to thousands.
+    const std::int64_t total = (std::int64_t(100) << 20) << (rng() % 9);
+    const int piece_size = total > (std::int64_t(8) << 30) ? 16 << 20 : total > (std::int64_t(1) << 30) ? 4 << 20 : 1 << 20;
+
+    lt::file_storage storage;
+    const auto dir = "Synthetic.Torrent." + std::to_string(index);
+
+    for (int f = 0; f < files; f++)
+    {
+        storage.add_file(dir + "/file" + std::to_string(f) + ".bin", f == 0 ? total - (files - 1) * (1 << 20) : 1 << 20);
+    }
+
+    lt::create_torrent ct(storage, piece_size, lt::create_torrent::v1_only);
+    ct.add_tracker("https://tracker.example.org/announce/" + std::to_string(index), 0);
+
+    for (lt::piece_index_t i(0); i < lt::piece_index_t(ct.num_pieces()); i++)
+    {
+        lt::sha1_hash hash;
+        for (auto& b : hash) { b = static_cast<std::uint8_t>(rng()); }
+        ct.set_hash(i, hash);
+    }
+
+    std::vector<char> buf;
+    lt::bencode(std::back_inserter(buf), ct.generate());
+
+    lt::add_torrent_params params;
+    params.ti             = std::make_shared<lt::torrent_info>(buf, lt::from_span);
+    params.name           = dir;
+    params.save_path      = save_path.string();
+    params.added_time     = 1600000000 + index;
+    params.flags          = lt::torrent_flags::paused;
+    params.trackers       = { "https://tracker.example.org/announce/" + std::to_string(index), "udp://tracker.example.net:6969/announce" };
+    params.tracker_tiers  = { 0, 1 };
+    params.total_uploaded   = static_cast<std::int64_t>(rng() % 4) * total;
+    params.total_downloaded = total;
+    params.active_time      = static_cast<int>(rng() % 10000000);
+    params.seeding_time     = params.active_time / 2;
+
+    // Three in four are complete and the rest part of the way there.
+    const int pieces = ct.num_pieces();
+    const int have = rng() % 4 != 0 ? pieces : static_cast<int>(rng() % pieces);
+
+    params.have_pieces.resize(pieces, false);
+    for (int p = 0; p < have; p++) { params.have_pieces.set_bit(lt::piece_index_t(p)); }
+
+    if (have == pieces)
+    {
+        params.completed_time = params.added_time + 3600;
+    }
+
+    params.file_priorities.assign(files, lt::default_priority);
+
+    for (int p = 0; p < 20; p++)
+    {
+        params.peers.emplace_back(
+            lt::make_address_v4(static_cast<std::uint32_t>(rng())),
+            static_cast<std::uint16_t>(1024 + rng() % 60000));
+    }
+
+    client_data->category = porla::Symbol::Intern(Categories[rng() % std::size(Categories)]);
+
+    std::vector<std::string> tags;
+    for (std::size_t t = rng() % 4; t > 0; t--) { tags.emplace_back(Tags[rng() % std::size(Tags)]); }
+    client_data->tags = porla::SymbolSet(tags);
+
+    return AddTorrentParams{
+        .client_data    = client_data,
+        .name           = params.name,
+        .params         = std::move(params),
+        .queue_position = index,
+        .save_path      = save_path.string()
+    };
+}
+
+static sqlite3* Open(const fs::path& file)
+{
+    sqlite3* db;
+
+    if (sqlite3_open(file.c_str(), &db) != SQLITE_OK)
+    {
+        fprintf(stderr, "Failed to open %s: %s\n", file.c_str(), sqlite3_errmsg(db));
+        std::exit(1);
+    }
+
+    // The same as porla uses unless configured otherwise.
+    porla::Data::ApplyPragmas(db, porla::Data::Pragmas{
+        .busy_timeout = 5000,
+        .journal_mode = "wal"
+    });
+
+    return db;
+}
+
+static void Close(sqlite3* db)
+{
+    porla::Data::Statement::ClearCache(db);
+    sqlite3_close(db);
+}
+
+static void Generate(const fs::path& file, const fs::path& save_path, int count)
+{
+    sqlite3* db = Open(file);
+    porla::Data::Migrate(db);
+
+    std::mt19937 rng(1337);
+    porla::TorrentClientData client_data;
+
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+    for (int i = 0; i < count; i++)
+    {
+        const auto torrent = MakeTorrent(rng, i, save_path, &client_data);
+        AddTorrentParams::Insert(db, torrent.params.ti->info_hashes(), torrent, true);
+
+        if ((i + 1) % 1000 == 0)
+        {
+            fprintf(stderr, "\rGenerating torrents... %d/%d", i + 1, count);
+        }
+    }
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    fprintf(stderr, "\rGenerated %d torrents%20s\n", count, "");
+
+    Close(db);
+}
+
+static lt::settings_pack QuietSettings()
+{
+    // Keeps the session off the network, so only the work of loading and saving is timed.
+    auto settings = lt::default_settings();
+    settings.set_str(lt::settings_pack::listen_interfaces, "127.0.0.1:0");
+    settings.set_bool(lt::settings_pack::enable_dht, false);
+    settings.set_bool(lt::settings_pack::enable_lsd, false);
+    settings.set_bool(lt::settings_pack::enable_natpmp, false);
+    settings.set_bool(lt::settings_pack::enable_upnp, false);
+
+    return settings;
+}
+
+int main(int argc, char* argv[])
+{
+    Args args;
+
+    if (!ParseArgs(argc, argv, args))
+    {
+        fprintf(stderr, "Usage: %s [--torrents <n>] [--dir <path>] [--dirty <fraction>] [--reuse]\n", argv[0]);
+        return 1;
+    }
+
+    boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::warning);
+
+    const auto db_file   = args.dir / "porla.sqlite";
+    const auto save_path = args.dir / "downloads";
+
+    std::vector<Result> results;
+
+    const auto measure = [&results](const std::string& name, const std::function<std::string()>& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        auto detail = fn();
+        results.push_back({ name, Seconds(std::chrono::steady_clock::now() - start), PeakRss(), std::move(detail) });
+    };
+
+    if (!args.reuse || !fs::exists(db_file))
+    {
+        fs::remove_all(args.dir);
+        fs::create_directories(save_path);
+
+        measure("generate", [&]()
+        {
+            Generate(db_file, save_path, args.torrents);
+            return std::to_string(fs::file_size(db_file) >> 20) + " MiB";
+        });
+    }
+
+    sqlite3* db = nullptr;
+
+    measure("migrations", [&]()
+    {
+        db = Open(db_file);
+        return porla::Data::Migrate(db) ? std::string() : std::string("failed");
+    });
+
+    const int count = AddTorrentParams::Count(db);
+
+    measure("decode", [&]()
+    {
+        std::int64_t pieces = 0;
+
+        AddTorrentParams::ForEach(
+            db,
+            [&pieces](lt::add_torrent_params& params)
+            {
+                if (params.ti) { pieces += params.ti->num_pieces(); }
+                delete params.userdata.get<porla::TorrentClientData>();
+            });
+
+        return std::to_string(count) + " rows, " + std::to_string(pieces) + " pieces";
+    });
+
+    boost::asio::io_context io;
+    std::unique_ptr<porla::Session> session;
+
+    measure("load", [&]()
+    {
+        session = std::make_unique<porla::Session>(io, porla::SessionOptions{
+            .db                  = db,
+            .settings            = QuietSettings(),
+            .session_params_file = args.dir / "session.dat"
+        });
+
+        auto loaded = session->OnTorrentsLoaded([&io](const auto&) { io.stop(); });
+
+        session->Load();
+        io.run();
+        io.restart();
+
+        const auto progress = session->Loading();
+
+        return std::to_string(progress.loaded) + " loaded, " + std::to_string(progress.failed) + " failed";
+    });
+
+    const double load_seconds = results.back().seconds;
+    results.back().detail += ", " + std::to_string(static_cast<int>(count / load_seconds)) + " torrents/s";
+
+    // Fresh from their resume data, the torrents have nothing to save. Changing a setting
+    // of theirs marks them the way transfers and edits would.
+    int dirty = 0;
+
+    for (const auto& [hash, handle] : session->Torrents())
+    {
+        if (dirty >= static_cast<int>(args.dirty * count)) { break; }
+
+        handle.set_max_connections(100 + dirty % 100);
+        dirty++;
+    }
+
+    // Lets libtorrent apply the changes before shutdown asks which torrents need saving.
+    io.run_for(std::chrono::milliseconds(500));
+
+    measure("shutdown", [&]()
+    {
+        session.reset();
+        return std::to_string(dirty) + " marked for saving";
+    });
+
+    Close(db);
+
+    printf("%-12s %12s %14s  %s\n", "phase", "seconds", "peak rss (MiB)", "");
+
+    for (const auto& result : results)
+    {
+        printf("%-12s %12.3f %14ld  %s\n", result.name.c_str(), result.seconds, result.peak_rss_kb / 1024, result.detail.c_str());
+    }
+
+    for (const auto& phase : porla::Utils::Phases::Shutdown().Get())
+    {
+        printf("  %-10s %12.3f\n", phase.name.c_str(), phase.seconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include <libtorrent/torrent_handle.hpp>
+
+#include "fleet.hpp"
+#include "../src/torrentregistry.hpp"
+
+namespace lt = libtorrent;
+
+typedef std::map<lt::info_hash_t, lt::torrent_handle> TorrentMap;
+typedef porla::TorrentRegistry<lt::torrent_handle>     TorrentRegistry;
+
+static std::vector<lt::info_hash_t> MakeHashes(int count)
+{
+    std::vector<lt::info_hash_t> hashes;
+
+    for (const auto& ts : porla::Benchmarks::MakeFleet(count))
+    {
+        hashes.push_back(ts.info_hashes);
+    }
+
+    return hashes;
+}
+
+template<typename TContainer>
+static TContainer MakeContainer(const std::vector<lt::info_hash_t>& hashes)
+{
+    TContainer container;
+
+    for (const auto& hash : hashes)
+    {
+        container.insert({ hash, lt::torrent_handle{} });
+    }
+
+    return container;
+}
+
+// Looks the torrents up in random order, like RPC calls for arbitrary torrents would.
+template<typename TContainer>
+static void BM_Lookup(benchmark::State& state)
+{
+    auto hashes = MakeHashes(static_cast<int>(state.range(0)));
+    const auto container = MakeContainer<TContainer>(hashes);
+
+    std::shuffle(hashes.begin(), hashes.end(), std::mt19937(1337));
+
+    for (auto _ : state)
+    {
+        for (const auto& hash : hashes)
+        {
+            benchmark::DoNotOptimize(container.find(hash));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<typename TContainer>
+static void BM_Iterate(benchmark::State& state)
+{
+    const auto container = MakeContainer<TContainer>(MakeHashes(static_cast<int>(state.range(0))));
+
+    for (auto _ : state)
+    {
+        std::size_t valid = 0;
+
+        for (const auto& [hash, handle] : container)
+        {
+            valid += handle.is_valid() ? 1 : 0;
+        }
+
+        benchmark::DoNotOptimize(valid);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template<typename TContainer>
+static void BM_Insert(benchmark::State& state)
+{
+    const auto hashes = MakeHashes(static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(MakeContainer<TContainer>(hashes));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_Lookup, TorrentMap)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_Lookup, TorrentRegistry)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_Iterate, TorrentMap)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_Iterate, TorrentRegistry)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_Insert, TorrentMap)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Insert, TorrentRegistry)->Arg(100000)->Unit(benchmark::kMillisecond);
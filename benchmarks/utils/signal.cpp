@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <boost/signals2.hpp>
+
+#include "../fleet.hpp"
+#include "../../src/utils/signal.hpp"
+
+namespace lt = libtorrent;
+
+typedef boost::signals2::signal<void(const lt::torrent_status&)> BoostSignal;
+typedef porla::Utils::Signal<void(const lt::torrent_status&)>    PorlaSignal;
+
+// Emits one event per torrent to a few subscribers, as the per-torrent alerts are.
+template<typename TSignal>
+static void BM_Emit(benchmark::State& state)
+{
+    const auto torrents = porla::Benchmarks::MakeFleet(1000);
+
+    TSignal signal;
+    std::int64_t seen = 0;
+
+    for (int i = 0; i < state.range(0); i++)
+    {
+        signal.connect([&seen](const lt::torrent_status& ts) { seen += ts.num_peers; });
+    }
+
+    for (auto _ : state)
+    {
+        for (const auto& ts : torrents)
+        {
+            signal(ts);
+        }
+    }
+
+    benchmark::DoNotOptimize(seen);
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(torrents.size()));
+}
+
+template<typename TSignal>
+static void BM_ConnectDisconnect(benchmark::State& state)
+{
+    TSignal signal;
+
+    for (auto _ : state)
+    {
+        auto connection = signal.connect([](const lt::torrent_status&) {});
+        connection.disconnect();
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Emit, BoostSignal)->Arg(1)->Arg(5);
+BENCHMARK_TEMPLATE(BM_Emit, PorlaSignal)->Arg(1)->Arg(5);
+BENCHMARK_TEMPLATE(BM_ConnectDisconnect, BoostSignal);
+BENCHMARK_TEMPLATE(BM_ConnectDisconnect, PorlaSignal);
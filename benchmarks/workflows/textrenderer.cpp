@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+
+#include "../fleet.hpp"
+#include "../../src/workflows/textrenderer.hpp"
+#include "../../src/workflows/torrentcontextprovider.hpp"
+
+using porla::Workflows::ContextProvider;
+using porla::Workflows::TextRenderer;
+using porla::Workflows::TorrentContextProvider;
+
+static const char* Templates[] =
+{
+    "Plain text without any lookups",
+    "${{ torrent.name }}",
+    "Torrent ${{ torrent.name }} finished in ${{ torrent.save_path }} (${{ torrent.progress }})"
+};
+
+static void BM_TextRenderer_Render(benchmark::State& state)
+{
+    const auto fleet = porla::Benchmarks::MakeFleet(1);
+
+    TextRenderer renderer({
+        {"torrent", std::make_shared<TorrentContextProvider>(fleet.front())}
+    });
+
+    const std::string text = Templates[state.range(0)];
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(renderer.Render(text));
+    }
+
+    state.SetLabel(text);
+}
+
+BENCHMARK(BM_TextRenderer_Render)->DenseRange(0, std::size(Templates) - 1);
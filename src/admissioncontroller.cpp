@@ -0,0 +1,300 @@
+#include "admissioncontroller.hpp"
+
+#include <optional>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+#include <boost/log/trivial.hpp>
+
+using porla::AdmissionController;
+using porla::AdmissionControllerOptions;
+using porla::AdmissionPriority;
+
+class AdmissionController::Slot
+{
+public:
+    Slot(std::weak_ptr<AdmissionController*> controller, std::string client, AdmissionPriority priority)
+        : m_controller(std::move(controller))
+        , m_client(std::move(client))
+        , m_priority(priority)
+    {
+    }
+
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+
+    ~Slot()
+    {
+        // Posted requests still holding a slot are dropped with the io context, which may
+        // be after the controller is gone.
+        if (const auto controller = m_controller.lock())
+        {
+            (*controller)->Release(m_client, m_priority);
+        }
+    }
+
+private:
+    std::weak_ptr<AdmissionController*> m_controller;
+    std::string m_client;
+    AdmissionPriority m_priority;
+};
+
+AdmissionController::AdmissionController(boost::asio::io_context& io, AdmissionControllerOptions options)
+    : m_io(io)
+    , m_options(std::move(options))
+    , m_timer(io)
+    , m_self(std::make_shared<AdmissionController*>(this))
+    , m_queued(0)
+    , m_running(0)
+    , m_running_bulk(0)
+    , m_draining(false)
+    , m_stats{}
+{
+}
+
+AdmissionController::~AdmissionController()
+{
+    m_timer.cancel();
+}
+
+void AdmissionController::Submit(
+    const std::string& client,
+    AdmissionPriority priority,
+    std::function<void(std::shared_ptr<Slot>)> run,
+    std::function<void(Rejection)> shed)
+{
+    // Anything queued that could run has already been let in, so a request that fits the
+    // limits does not skip ahead of anyone.
+    if (CanRun(client, priority))
+    {
+        return run(Acquire(client, priority));
+    }
+
+    Waiter waiter{
+        .client   = client,
+        .priority = priority,
+        .deadline = std::chrono::steady_clock::now() + Budget(priority),
+        .run      = std::move(run),
+        .shed     = std::move(shed)
+    };
+
+    if (m_queued >= m_options.max_queued)
+    {
+        // Make room by dropping the newest of the least urgent requests, if it is less
+        // urgent than this one.
+        auto victim = m_queues.rbegin();
+
+        while (victim != m_queues.rend() && victim->second.empty()) { victim++; }
+
+        if (victim == m_queues.rend() || victim->first <= priority)
+        {
+            return Shed(std::move(waiter), Rejection::QueueFull);
+        }
+
+        auto dropped = std::move(victim->second.back());
+        victim->second.pop_back();
+        m_queued--;
+
+        Shed(std::move(dropped), Rejection::QueueFull);
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Queueing RPC request from " << client << " at priority " << static_cast<int>(priority);
+
+    m_queues[priority].push_back(std::move(waiter));
+    m_queued++;
+
+    Schedule();
+}
+
+AdmissionController::Stats AdmissionController::GetStats() const
+{
+    auto stats = m_stats;
+    stats.queued  = m_queued;
+    stats.running = m_running;
+
+    return stats;
+}
+
+bool AdmissionController::CanRun(const std::string& client, AdmissionPriority priority) const
+{
+    if (priority == AdmissionPriority::Health)
+    {
+        return true;
+    }
+
+    if (m_running >= m_options.max_concurrent)
+    {
+        return false;
+    }
+
+    if (priority == AdmissionPriority::Bulk && m_running_bulk >= m_options.max_bulk)
+    {
+        return false;
+    }
+
+    const auto running = m_clients.find(client);
+    return running == m_clients.end() || running->second < m_options.max_per_client;
+}
+
+std::chrono::milliseconds AdmissionController::Budget(AdmissionPriority priority) const
+{
+    switch (priority)
+    {
+    case AdmissionPriority::Health:  return std::chrono::milliseconds(0);
+    case AdmissionPriority::Control: return m_options.control_budget;
+    case AdmissionPriority::Read:    return m_options.read_budget;
+    case AdmissionPriority::Bulk:    return m_options.bulk_budget;
+    }
+
+    return std::chrono::milliseconds(0);
+}
+
+std::shared_ptr<AdmissionController::Slot> AdmissionController::Acquire(const std::string& client, AdmissionPriority priority)
+{
+    m_stats.admitted++;
+
+    // Health requests take no slot, but still get one so callers need not care.
+    if (priority != AdmissionPriority::Health)
+    {
+        m_running++;
+        m_clients[client]++;
+
+        if (priority == AdmissionPriority::Bulk) { m_running_bulk++; }
+    }
+
+    return std::make_shared<Slot>(m_self, client, priority);
+}
+
+void AdmissionController::Release(const std::string& client, AdmissionPriority priority)
+{
+    if (priority == AdmissionPriority::Health)
+    {
+        return;
+    }
+
+    m_running--;
+
+    if (priority == AdmissionPriority::Bulk) { m_running_bulk--; }
+
+    if (auto running = m_clients.find(client); running != m_clients.end() && --running->second == 0)
+    {
+        m_clients.erase(running);
+    }
+
+    Drain();
+}
+
+void AdmissionController::Drain()
+{
+    // Shedding or posting never releases a slot right away, but guard against it anyway.
+    if (m_draining)
+    {
+        return;
+    }
+
+    m_draining = true;
+
+    Expire();
+
+    // Most urgent first, and in arrival order within a class, skipping the requests whose
+    // client is at its limit.
+    for (auto& [priority, queue] : m_queues)
+    {
+        for (auto it = queue.begin(); it != queue.end() && m_running < m_options.max_concurrent;)
+        {
+            if (!CanRun(it->client, priority))
+            {
+                it++;
+                continue;
+            }
+
+            auto slot = Acquire(it->client, priority);
+
+            // Posted, so the request does not run inside the response of another.
+            boost::asio::post(m_io, [run = std::move(it->run), slot = std::move(slot)]() { run(slot); });
+
+            it = queue.erase(it);
+            m_queued--;
+        }
+    }
+
+    m_draining = false;
+}
+
+void AdmissionController::Expire()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto& [priority, queue] : m_queues)
+    {
+        if (Budget(priority).count() <= 0)
+        {
+            continue;
+        }
+
+        // Every request in a class has the same budget, so the oldest expire first.
+        while (!queue.empty() && queue.front().deadline <= now)
+        {
+            auto waiter = std::move(queue.front());
+            queue.pop_front();
+            m_queued--;
+
+            Shed(std::move(waiter), Rejection::Timeout);
+        }
+    }
+}
+
+void AdmissionController::Schedule()
+{
+    std::optional<std::chrono::steady_clock::time_point> next;
+
+    for (const auto& [priority, queue] : m_queues)
+    {
+        if (queue.empty() || Budget(priority).count() <= 0)
+        {
+            continue;
+        }
+
+        if (!next.has_value() || queue.front().deadline < *next)
+        {
+            next = queue.front().deadline;
+        }
+    }
+
+    // Already set to fire in time.
+    if (!next.has_value() || (m_timer_at != std::chrono::steady_clock::time_point{} && m_timer_at <= *next))
+    {
+        return;
+    }
+
+    m_timer_at = *next;
+    m_timer.expires_at(*next);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+
+            m_timer_at = {};
+
+            Expire();
+            Schedule();
+        });
+}
+
+void AdmissionController::Shed(Waiter waiter, Rejection rejection)
+{
+    switch (rejection)
+    {
+    case Rejection::QueueFull: m_stats.shed_full++;    break;
+    case Rejection::Timeout:   m_stats.shed_timeout++; break;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Shedding RPC request from " << waiter.client
+        << (rejection == Rejection::Timeout ? " after its queue budget" : " with a full queue");
+
+    // Posted like the requests that run, so it never writes while the caller is queueing.
+    boost::asio::post(m_io, [shed = std::move(waiter.shed), rejection]() { shed(rejection); });
+}
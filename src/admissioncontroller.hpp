@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace porla
+{
+    // From most to least urgent. Health requests are never queued or shed, and bulk reads
+    // only get part of the slots so control requests always find one.
+    enum class AdmissionPriority
+    {
+        Health,
+        Control,
+        Read,
+        Bulk
+    };
+
+    struct AdmissionControllerOptions
+    {
+        // Requests running at once over every class but health, and per client.
+        std::size_t max_concurrent = 16;
+        std::size_t max_per_client = 4;
+        std::size_t max_bulk       = 8;
+        // Requests waiting for a slot, over every class.
+        std::size_t max_queued     = 256;
+        // How long a request may wait for a slot before it is shed. Zero waits for as long
+        // as it takes.
+        std::chrono::milliseconds control_budget{4000};
+        std::chrono::milliseconds read_budget{2000};
+        std::chrono::milliseconds bulk_budget{1000};
+    };
+
+    // Decides when RPC requests run, so a burst of expensive reads cannot hold up the
+    // cheap requests behind it. Requests over the limits wait in priority order, and are
+    // shed once their class's queue budget runs out or the queue is full. Everything runs
+    // on the io thread, including the slots being released.
+    class AdmissionController
+    {
+    public:
+        enum class Rejection
+        {
+            QueueFull,
+            Timeout
+        };
+
+        struct Stats
+        {
+            std::uint64_t admitted;
+            std::uint64_t queued;
+            std::uint64_t running;
+            std::uint64_t shed_full;
+            std::uint64_t shed_timeout;
+        };
+
+        // Held for as long as the request runs. Destroying it lets the next one in.
+        class Slot;
+
+        explicit AdmissionController(boost::asio::io_context& io, AdmissionControllerOptions options);
+        ~AdmissionController();
+
+        AdmissionController(const AdmissionController&) = delete;
+        AdmissionController& operator=(const AdmissionController&) = delete;
+
+        // Calls run with a slot, right away if the limits allow it and posted to the io
+        // context once a slot opens up otherwise. Calls shed instead if the request is
+        // dropped from the queue.
+        void Submit(
+            const std::string& client,
+            AdmissionPriority priority,
+            std::function<void(std::shared_ptr<Slot>)> run,
+            std::function<void(Rejection)> shed);
+
+        [[nodiscard]] Stats GetStats() const;
+
+    private:
+        struct Waiter
+        {
+            std::string                                client;
+            AdmissionPriority                          priority;
+            std::chrono::steady_clock::time_point      deadline;
+            std::function<void(std::shared_ptr<Slot>)> run;
+            std::function<void(Rejection)>             shed;
+        };
+
+        [[nodiscard]] bool CanRun(const std::string& client, AdmissionPriority priority) const;
+        [[nodiscard]] std::chrono::milliseconds Budget(AdmissionPriority priority) const;
+
+        std::shared_ptr<Slot> Acquire(const std::string& client, AdmissionPriority priority);
+        void Release(const std::string& client, AdmissionPriority priority);
+
+        void Drain();
+        void Expire();
+        void Schedule();
+        void Shed(Waiter waiter, Rejection rejection);
+
+        boost::asio::io_context& m_io;
+        AdmissionControllerOptions m_options;
+        boost::asio::steady_timer m_timer;
+        std::chrono::steady_clock::time_point m_timer_at;
+        // What slots release through, so the ones left over at shutdown do nothing.
+        std::shared_ptr<AdmissionController*> m_self;
+
+        // One queue per class but health, in arrival order.
+        std::map<AdmissionPriority, std::deque<Waiter>> m_queues;
+        std::map<std::string, std::size_t> m_clients;
+        std::size_t m_queued;
+        std::size_t m_running;
+        std::size_t m_running_bulk;
+        bool m_draining;
+
+        Stats m_stats;
+    };
+}
@@ -0,0 +1,267 @@
+#include "announcescheduler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "session.hpp"
+#include "utils/string.hpp"
+
+namespace lt = libtorrent;
+
+using porla::AnnounceScheduler;
+
+AnnounceScheduler::AnnounceScheduler(boost::asio::io_context& io, porla::ISession& session, porla::AnnounceSchedulerOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(options)
+    , m_next(0)
+{
+    m_announceConnection = m_session.OnTrackerAnnounce(
+        [this](const ISession::TrackerAnnounce& announce)
+        {
+            if (announce.kind == ISession::TrackerAnnounce::Sent)
+            {
+                OnSent(announce.handle.info_hashes(), porla::Utils::String::UrlHost(announce.url));
+            }
+        });
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash) { Forget(hash); });
+}
+
+AnnounceScheduler::~AnnounceScheduler()
+{
+    m_timer.cancel();
+    m_announceConnection.disconnect();
+    m_removedConnection.disconnect();
+}
+
+bool AnnounceScheduler::Reannounce(const lt::info_hash_t& hash, int priority, bool ignore_min_interval)
+{
+    if (!m_session.TorrentStatuses().contains(hash))
+    {
+        return false;
+    }
+
+    if (m_options.boost)
+    {
+        priority += m_options.boost(hash);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    if (auto queued = m_queued.find(hash); queued != m_queued.end())
+    {
+        auto& queue = m_hosts.at(queued->second.host).queue;
+        auto  node  = queue.extract(queued->second.key);
+
+        node.mapped().ignore_min_interval |= ignore_min_interval;
+
+        if (priority > -node.key().first)
+        {
+            node.key().first = -priority;
+            queued->second.key = node.key();
+        }
+
+        queue.insert(std::move(node));
+        m_stats.coalesced++;
+
+        return true;
+    }
+
+    const auto name = HostOf(hash);
+
+    // Nothing to pace for torrents without trackers, which only announce to the DHT.
+    if (name.empty())
+    {
+        Dispatch(name, Request{ .hash = hash, .ignore_min_interval = ignore_min_interval });
+        return true;
+    }
+
+    auto& host = Refill(name, now);
+    const OrderKey key{ -priority, m_next++ };
+
+    if (host.queue.size() >= std::max<std::size_t>(1, m_options.max_queued))
+    {
+        const auto lowest = std::prev(host.queue.end());
+
+        if (key > lowest->first)
+        {
+            m_stats.dropped++;
+            return false;
+        }
+
+        m_queued.erase(lowest->second.hash);
+        host.queue.erase(lowest);
+        m_stats.dropped++;
+    }
+
+    host.queue.insert({ key, Request{ .hash = hash, .ignore_min_interval = ignore_min_interval } });
+    m_queued.insert({ hash, Queued{ .host = name, .key = key } });
+
+    Pump(now);
+
+    return true;
+}
+
+void AnnounceScheduler::Pump(std::chrono::steady_clock::time_point now)
+{
+    std::optional<std::chrono::steady_clock::time_point> wake;
+
+    for (auto it = m_hosts.begin(); it != m_hosts.end();)
+    {
+        auto& host = Refill(it->first, now);
+
+        while (host.tokens >= 1 && !host.queue.empty())
+        {
+            const auto request = host.queue.begin()->second;
+
+            host.queue.erase(host.queue.begin());
+            host.tokens -= 1;
+
+            m_queued.erase(request.hash);
+            Dispatch(it->first, request);
+        }
+
+        if (!host.queue.empty())
+        {
+            const auto until = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((1 - host.tokens) / std::max(m_options.rate, 0.001)));
+
+            wake = wake.has_value() ? std::min(*wake, until) : until;
+        }
+        else if (host.tokens >= m_options.burst)
+        {
+            it = m_hosts.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+
+    if (!wake.has_value())
+    {
+        return;
+    }
+
+    m_timer.expires_at(*wake);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            Pump(std::chrono::steady_clock::now());
+        });
+}
+
+AnnounceScheduler::Stats AnnounceScheduler::GetStats() const
+{
+    auto stats = m_stats;
+    stats.queued = m_queued.size();
+    return stats;
+}
+
+std::string AnnounceScheduler::HostOf(const lt::info_hash_t& hash) const
+{
+    const auto& statuses = m_session.TorrentStatuses();
+
+    if (const auto status = statuses.find(hash); status != statuses.end() && !status->second.current_tracker.empty())
+    {
+        return porla::Utils::String::UrlHost(status->second.current_tracker);
+    }
+
+    if (const auto last = m_last.find(hash); last != m_last.end())
+    {
+        return last->second;
+    }
+
+    // Not announced since it was added, so it is asked of libtorrent.
+    const auto& torrents = m_session.Torrents();
+
+    if (const auto th = torrents.find(hash); th != torrents.end())
+    {
+        const auto trackers = th->second.trackers();
+
+        if (!trackers.empty())
+        {
+            return porla::Utils::String::UrlHost(trackers.front().url);
+        }
+    }
+
+    return {};
+}
+
+AnnounceScheduler::Host& AnnounceScheduler::Refill(const std::string& name, std::chrono::steady_clock::time_point now)
+{
+    const auto [it, inserted] = m_hosts.try_emplace(
+        name,
+        Host{ .tokens = static_cast<double>(m_options.burst), .refilled = now });
+
+    auto& host = it->second;
+
+    if (!inserted && now > host.refilled)
+    {
+        const double elapsed = std::chrono::duration<double>(now - host.refilled).count();
+
+        host.tokens   = std::min(static_cast<double>(m_options.burst), host.tokens + elapsed * m_options.rate);
+        host.refilled = now;
+    }
+
+    return host;
+}
+
+void AnnounceScheduler::Dispatch(const std::string& host, const Request& request)
+{
+    m_session.Reannounce(request.hash, request.ignore_min_interval);
+    m_stats.forced++;
+
+    if (!host.empty())
+    {
+        m_sent.insert_or_assign(request.hash, host);
+    }
+}
+
+void AnnounceScheduler::Forget(const lt::info_hash_t& hash)
+{
+    if (const auto queued = m_queued.find(hash); queued != m_queued.end())
+    {
+        m_hosts.at(queued->second.host).queue.erase(queued->second.key);
+        m_queued.erase(queued);
+    }
+
+    m_sent.erase(hash);
+    m_last.erase(hash);
+}
+
+void AnnounceScheduler::OnSent(const lt::info_hash_t& hash, const std::string& name)
+{
+    m_last.insert_or_assign(hash, name);
+
+    // Our own, which was charged when it was sent.
+    if (const auto sent = m_sent.find(hash); sent != m_sent.end() && sent->second == name)
+    {
+        m_sent.erase(sent);
+        return;
+    }
+
+    auto& host = Refill(name, std::chrono::steady_clock::now());
+
+    // Periodic announces are not ours to hold back, so a host may go into debt, which
+    // forced ones wait out.
+    host.tokens = std::max(-static_cast<double>(m_options.burst), host.tokens - 1);
+    m_stats.periodic++;
+
+    if (const auto queued = m_queued.find(hash); queued != m_queued.end() && queued->second.host == name)
+    {
+        host.queue.erase(queued->second.key);
+        m_queued.erase(queued);
+        m_stats.coalesced++;
+    }
+}
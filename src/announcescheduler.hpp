@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <libtorrent/info_hash.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct AnnounceSchedulerOptions
+    {
+        // Announces per second to one tracker host, periodic and forced ones together.
+        double rate = 1;
+        // Announces a host takes at once after being quiet for a while.
+        int burst = 10;
+        // Forced reannounces waiting per host. The lowest priority ones make way for
+        // higher ones beyond this.
+        std::size_t max_queued = 1000;
+        // Added to the priority of every reannounce, such as the boost of new releases.
+        std::function<int(const libtorrent::info_hash_t&)> boost;
+    };
+
+    // Forced reannounces paced per tracker host with a token bucket, so thousands of
+    // torrents on one tracker are not announced to it at once. The periodic announces
+    // libtorrent sends on its own are seen through the tracker alerts and take from the same
+    // budget, leaving the forced ones what is left over. Those wait in priority order, higher
+    // first and in the order they were asked for otherwise, and asking again for a torrent
+    // which is waiting only raises its priority. A torrent which announces to the host while
+    // waiting is dropped from the queue, since that is what it waited for. Runs on the io
+    // thread.
+    class AnnounceScheduler
+    {
+    public:
+        struct Stats
+        {
+            std::uint64_t forced    = 0;
+            std::uint64_t periodic  = 0;
+            // Reannounces asked for again while waiting, or answered by a periodic announce.
+            std::uint64_t coalesced = 0;
+            std::uint64_t dropped   = 0;
+            std::size_t   queued    = 0;
+        };
+
+        explicit AnnounceScheduler(boost::asio::io_context& io, ISession& session, AnnounceSchedulerOptions options = {});
+        AnnounceScheduler(const AnnounceScheduler&) = delete;
+
+        ~AnnounceScheduler();
+
+        // Returns false if the torrent is not in the session, or if the queue of its host is
+        // full of reannounces with a higher priority.
+        bool Reannounce(const libtorrent::info_hash_t& hash, int priority = 0, bool ignore_min_interval = false);
+
+        // Sends the waiting reannounces the budgets allow as of now, and sets the timer for the
+        // next. Called by the timer and when a reannounce is asked for.
+        void Pump(std::chrono::steady_clock::time_point now);
+
+        [[nodiscard]] Stats GetStats() const;
+
+    private:
+        // Ordered by priority, highest first, and then by id, which grows as reannounces
+        // are asked for.
+        typedef std::pair<int, std::uint64_t> OrderKey;
+
+        struct Request
+        {
+            libtorrent::info_hash_t hash;
+            bool                    ignore_min_interval;
+        };
+
+        struct Host
+        {
+            double                                tokens;
+            std::chrono::steady_clock::time_point refilled;
+            std::map<OrderKey, Request>           queue;
+        };
+
+        struct Queued
+        {
+            std::string host;
+            OrderKey    key;
+        };
+
+        // The host the torrent announces to, or empty when it has no trackers.
+        std::string HostOf(const libtorrent::info_hash_t& hash) const;
+        Host& Refill(const std::string& name, std::chrono::steady_clock::time_point now);
+
+        void Dispatch(const std::string& host, const Request& request);
+        void Forget(const libtorrent::info_hash_t& hash);
+        void OnSent(const libtorrent::info_hash_t& hash, const std::string& host);
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        AnnounceSchedulerOptions m_options;
+        std::uint64_t m_next;
+
+        // Hosts with a queue or with a budget still refilling. Full and idle ones are dropped.
+        std::map<std::string, Host> m_hosts;
+        std::map<libtorrent::info_hash_t, Queued> m_queued;
+        // Sent by us and charged already, until libtorrent posts the announce.
+        std::map<libtorrent::info_hash_t, std::string> m_sent;
+        // The host of the last announce of each torrent.
+        std::map<libtorrent::info_hash_t, std::string> m_last;
+
+        Stats m_stats;
+
+        porla::Utils::Connection m_announceConnection;
+        porla::Utils::Connection m_removedConnection;
+    };
+}
@@ -1,23 +1,27 @@
 #include "authinithandler.hpp"
 
-#include <thread>
-
 #include <boost/log/trivial.hpp>
-#include <sodium.h>
 
 #include "data/models/users.hpp"
+#include "passwordhasher.hpp"
+#include "responsecache.hpp"
+#include "systemhandler.hpp"
 
 using porla::AuthInitHandler;
+using porla::PasswordHasher;
 
-AuthInitHandler::AuthInitHandler(boost::asio::io_context& io, sqlite3* db)
-    : m_io(io)
-    , m_db(db)
+AuthInitHandler::AuthInitHandler(sqlite3* db, PasswordHasher& hasher, ResponseCache& cache)
+    : m_db(db)
+    , m_hasher(hasher)
+    , m_cache(cache)
 {
 }
 
 void AuthInitHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
 {
-    if (porla::Data::Models::Users::Any(m_db))
+    const auto system = m_cache.Get(SystemHandler::Key, [db = m_db]() { return SystemHandler::Document(db); });
+
+    if (system->value("status", "") != "setup")
     {
         return ctx->Write("Invalid request");
     }
@@ -32,55 +36,49 @@ void AuthInitHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
     auto const username = req["username"].get<std::string>();
     auto const password = req["password"].get<std::string>();
 
-    std::thread t(
-        [ctx = ctx, db = m_db, &io = m_io, username, password]()
+    m_hasher.Hash(
+        password,
+        [ctx = ctx, db = m_db, &cache = m_cache, username](PasswordHasher::Result result, const std::string& password_hashed)
         {
-            std::string password_hashed;
-            password_hashed.resize(crypto_pwhash_STRBYTES);
-
-            int result = crypto_pwhash_str(
-                password_hashed.data(),
-                password.c_str(),
-                password.size(),
-                crypto_pwhash_OPSLIMIT_SENSITIVE,
-                crypto_pwhash_MEMLIMIT_SENSITIVE);
-
-            boost::asio::dispatch(
-                io,
-                [ctx, db, password_hashed, result, username]()
-                {
-                    if (result != 0)
-                    {
-                        BOOST_LOG_TRIVIAL(error) << "Out of memory when hashing password";
-
-                        return ctx->WriteJson({
-                            {"error", "oom"}
-                        });
-                    }
-
-                    if (porla::Data::Models::Users::Any(db))
-                    {
-                        BOOST_LOG_TRIVIAL(warning) << "A user was created while we where creating ours";
-
-                        return ctx->WriteJson({
-                            {"error", "already_initialized"}
-                        });
-                    }
-
-                    porla::Data::Models::Users::Insert(
-                        db,
-                        porla::Data::Models::Users::User{
-                            .username        = username,
-                            .password_hashed = password_hashed,
-                        });
-
-                    BOOST_LOG_TRIVIAL(info) << "User " << username << " created";
-
-                    ctx->WriteJson({
-                        {"ok", true}
-                    });
+            if (result == PasswordHasher::Result::Busy || result == PasswordHasher::Result::Timeout)
+            {
+                return ctx->WriteJson({
+                    {"error", "busy"}
                 });
-        });
+            }
+
+            if (result != PasswordHasher::Result::Ok)
+            {
+                BOOST_LOG_TRIVIAL(error) << "Out of memory when hashing password";
+
+                return ctx->WriteJson({
+                    {"error", "oom"}
+                });
+            }
+
+            // Asked of the database, since the cached status may be from before the hash.
+            if (porla::Data::Models::Users::Any(db))
+            {
+                BOOST_LOG_TRIVIAL(warning) << "A user was created while we where creating ours";
 
-    t.detach();
+                return ctx->WriteJson({
+                    {"error", "already_initialized"}
+                });
+            }
+
+            porla::Data::Models::Users::Insert(
+                db,
+                porla::Data::Models::Users::User{
+                    .username        = username,
+                    .password_hashed = password_hashed,
+                });
+
+            cache.Invalidate(SystemHandler::Key);
+
+            BOOST_LOG_TRIVIAL(info) << "User " << username << " created";
+
+            ctx->WriteJson({
+                {"ok", true}
+            });
+        });
 }
@@ -1,21 +1,26 @@
 #pragma once
 
-#include <boost/asio.hpp>
 #include <sqlite3.h>
 
 #include "httpcontext.hpp"
 
 namespace porla
 {
+    class PasswordHasher;
+    class ResponseCache;
+
+    // Asks the cached system status whether there are users yet, and invalidates it once
+    // the first one is created.
     class AuthInitHandler
     {
     public:
-        explicit AuthInitHandler(boost::asio::io_context& io, sqlite3* db);
+        explicit AuthInitHandler(sqlite3* db, PasswordHasher& hasher, ResponseCache& cache);
 
         void operator()(const std::shared_ptr<HttpContext>&);
 
     private:
-        boost::asio::io_context& m_io;
         sqlite3* m_db;
+        PasswordHasher& m_hasher;
+        ResponseCache& m_cache;
     };
 }
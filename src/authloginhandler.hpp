@@ -1,8 +1,5 @@
 #pragma once
 
-#include <thread>
-#include <vector>
-
 #include <boost/asio.hpp>
 #include <sqlite3.h>
 
@@ -10,16 +7,19 @@
 
 namespace porla
 {
+    class PasswordHasher;
+
     struct AuthLoginHandlerOptions
     {
         sqlite3* db;
+        PasswordHasher& hasher;
         std::string secret_key;
     };
 
     class AuthLoginHandler
     {
     public:
-        explicit AuthLoginHandler(boost::asio::io_context& io, const AuthLoginHandlerOptions& opts);
+        explicit AuthLoginHandler(const AuthLoginHandlerOptions& opts);
 
         AuthLoginHandler(const AuthLoginHandler&) = delete;
         AuthLoginHandler(AuthLoginHandler&&) = delete;
@@ -29,9 +29,8 @@ namespace porla
         void operator()(const std::shared_ptr<HttpContext>&);
 
     private:
-        boost::asio::io_context& m_io;
         sqlite3* m_db;
+        PasswordHasher& m_hasher;
         std::string m_secret_key;
-        std::vector<std::thread> m_threads;
     };
 }
@@ -0,0 +1,504 @@
+#include "changefeed.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "json/ltinfohash.hpp"
+#include "json/symbol.hpp"
+#include "session.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using porla::ChangeFeed;
+
+// Proxies close streams which are quiet for too long.
+static constexpr std::chrono::seconds HeartbeatInterval(15);
+
+static std::int64_t NowMillis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Files are named by their first offset, padded so they sort in order.
+static std::string FileName(std::uint64_t offset)
+{
+    std::ostringstream name;
+    name << "changes-" << std::setw(20) << std::setfill('0') << offset << ".ndjson";
+    return name.str();
+}
+
+static std::vector<fs::path> ListFiles(const fs::path& dir)
+{
+    std::vector<fs::path> files;
+    std::error_code ec;
+
+    for (const auto& entry : fs::directory_iterator(dir, ec))
+    {
+        const auto name = entry.path().filename().string();
+        if (name.starts_with("changes-") && name.ends_with(".ndjson")) files.push_back(entry.path());
+    }
+
+    std::sort(files.begin(), files.end());
+
+    return files;
+}
+
+// Writes the records to the response of a changes request, after its headers. Records are
+// queued on the strand of the connection, which may be on an HTTP thread.
+class ChangeFeed::Client : public std::enable_shared_from_this<ChangeFeed::Client>
+{
+public:
+    explicit Client(std::shared_ptr<porla::HttpContext> ctx, std::size_t max_queued_bytes)
+        : m_ctx(std::move(ctx))
+        , m_maxQueuedBytes(max_queued_bytes)
+    {
+    }
+
+    bool IsDead() const { return m_dead; }
+
+    void Queue(std::shared_ptr<const std::string> line)
+    {
+        if (m_dead) { return; }
+
+        boost::asio::dispatch(
+            m_ctx->Stream().get_executor(),
+            [_this = shared_from_this(), line = std::move(line)]() mutable
+            {
+                _this->Enqueue(std::move(line));
+            });
+    }
+
+private:
+    void Enqueue(std::shared_ptr<const std::string> line)
+    {
+        if (m_dead) { return; }
+
+        m_queuedBytes += line->size();
+        m_queue.push_back(std::move(line));
+
+        if (m_queuedBytes > m_maxQueuedBytes)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Disconnecting slow change feed client with " << m_queuedBytes << " bytes queued";
+
+            m_dead = true;
+
+            boost::system::error_code ec;
+            m_ctx->Stream().socket().close(ec);
+            return;
+        }
+
+        MaybeWrite();
+    }
+
+    void MaybeWrite()
+    {
+        if (m_writing || m_queue.empty())
+        {
+            return;
+        }
+
+        m_writing = true;
+
+        std::vector<std::shared_ptr<const std::string>> lines(m_queue.begin(), m_queue.end());
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.reserve(lines.size());
+
+        for (const auto& line : lines)
+        {
+            buffers.emplace_back(boost::asio::buffer(*line));
+            m_queuedBytes -= line->size();
+        }
+
+        m_queue.clear();
+
+        boost::asio::async_write(
+            m_ctx->Stream(),
+            buffers,
+            [_this = shared_from_this(), lines = std::move(lines)](boost::system::error_code ec, std::size_t)
+            {
+                _this->m_writing = false;
+
+                if (ec)
+                {
+                    _this->m_dead = true;
+                    return;
+                }
+
+                _this->MaybeWrite();
+            });
+    }
+
+    std::shared_ptr<porla::HttpContext> m_ctx;
+    std::size_t m_maxQueuedBytes;
+    std::size_t m_queuedBytes = 0;
+    std::deque<std::shared_ptr<const std::string>> m_queue;
+    std::atomic<bool> m_dead{false};
+    bool m_writing = false;
+};
+
+ChangeFeed::ChangeFeed(boost::asio::io_context& io, porla::ISession& session, ChangeFeedOptions options)
+    : m_session(session)
+    , m_options(std::move(options))
+    , m_snapshotTimer(io)
+    , m_heartbeatTimer(io)
+    // Offsets start from the startup time in microseconds when there are no files to
+    // continue from, so they keep increasing across restarts anyway.
+    , m_next(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count())
+{
+    if (m_options.dir.has_value())
+    {
+        Recover();
+        Open();
+    }
+
+    const auto torrent = [](const char* type, const lt::info_hash_t& hash)
+    {
+        return json{{"type", type}, {"info_hash", hash}};
+    };
+
+    m_connections.push_back(m_session.OnTorrentAdded(
+        [this, torrent](const lt::torrent_status& ts)
+        {
+            auto record = torrent("added", ts.info_hashes);
+            record["name"]      = ts.name;
+            record["save_path"] = ts.save_path;
+            record["size"]      = ts.total_wanted;
+
+            if (const auto* client_data = m_session.ClientData(ts))
+            {
+                if (client_data->category.has_value()) record["category"] = *client_data->category;
+                if (client_data->tags.has_value())     record["tags"]     = *client_data->tags;
+            }
+
+            Append(std::move(record));
+        }));
+
+    m_connections.push_back(m_session.OnTorrentFinished(
+        [this, torrent](const lt::torrent_status& ts)
+        {
+            auto record = torrent("finished", ts.info_hashes);
+            record["total_done"] = ts.total_done;
+            Append(std::move(record));
+        }));
+
+    m_connections.push_back(m_session.OnStorageMoved(
+        [this, torrent](const lt::torrent_handle& th)
+        {
+            auto record = torrent("moved", th.info_hashes());
+
+            const auto& statuses = m_session.TorrentStatuses();
+            if (const auto status = statuses.find(th.info_hashes()); status != statuses.end())
+            {
+                record["save_path"] = status->second.save_path;
+            }
+
+            Append(std::move(record));
+        }));
+
+    m_connections.push_back(m_session.OnTorrentPaused(
+        [this, torrent](const lt::torrent_handle& th) { Append(torrent("paused", th.info_hashes())); }));
+
+    m_connections.push_back(m_session.OnTorrentRemoved(
+        [this, torrent](const lt::info_hash_t& hash)
+        {
+            m_snapshots.erase(hash);
+            Append(torrent("removed", hash));
+        }));
+
+    m_connections.push_back(m_session.OnTorrentResumed(
+        [this, torrent](const lt::torrent_status& ts) { Append(torrent("resumed", ts.info_hashes)); }));
+
+    if (m_options.snapshot_interval.count() > 0)
+    {
+        Schedule();
+    }
+
+    Heartbeat();
+}
+
+ChangeFeed::~ChangeFeed()
+{
+    m_snapshotTimer.cancel();
+    m_heartbeatTimer.cancel();
+
+    for (auto& connection : m_connections)
+    {
+        connection.disconnect();
+    }
+}
+
+void ChangeFeed::operator()(std::shared_ptr<HttpContext> ctx)
+{
+    static const auto headers = std::make_shared<const std::string>(
+        "HTTP/1.1 200 OK\r\n"
+        "Connection: close\r\n"
+        "Content-Type: application/x-ndjson\r\n"
+        "Cache-Control: no-cache, no-transform\r\n\r\n");
+
+    std::erase_if(m_clients, [](const auto& client) { return client->IsDead(); });
+
+    if (m_clients.size() >= m_options.max_subscribers)
+    {
+        namespace http = boost::beast::http;
+
+        http::response<http::string_body> res{http::status::service_unavailable, ctx->Request().version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::content_type, "text/plain");
+        res.set(http::field::retry_after, "30");
+        res.keep_alive(false);
+        res.body() = "Too many change feed clients";
+        res.prepare_payload();
+
+        return ctx->Write(std::move(res));
+    }
+
+    std::optional<std::uint64_t> from;
+    const auto& query = ctx->RequestUri().query;
+
+    if (const auto param = query.find("from"); param != query.end())
+    {
+        try { from = std::stoull(param->second); } catch (const std::exception&) {}
+    }
+
+    auto client = std::make_shared<Client>(std::move(ctx), m_options.max_queued_bytes);
+    client->Queue(headers);
+
+    // A client which missed records is told where the feed picks up again, and should
+    // reconcile its state with torrents.list before applying more changes.
+    if (from.has_value() && !Replay(*from, [&client](const std::string& line) { client->Queue(std::make_shared<const std::string>(line)); }))
+    {
+        const auto oldest = m_records.empty() ? m_next : m_records.front().offset;
+        client->Queue(std::make_shared<const std::string>(json{{"type", "reset"}, {"offset", oldest}}.dump() + "\n"));
+
+        Replay(oldest, [&client](const std::string& line) { client->Queue(std::make_shared<const std::string>(line)); });
+    }
+
+    m_clients.push_back(std::move(client));
+}
+
+void ChangeFeed::Append(json record)
+{
+    record["offset"] = m_next;
+    record["time"]   = NowMillis();
+
+    auto line = std::make_shared<const std::string>(record.dump() + "\n");
+
+    if (m_file.is_open())
+    {
+        if (m_fileSize > 0 && m_fileSize + line->size() > m_options.file_size)
+        {
+            m_file.close();
+            Open();
+        }
+
+        m_file << *line;
+        m_file.flush();
+        m_fileSize += line->size();
+    }
+
+    m_records.push_back(Record{ .offset = m_next, .line = line });
+
+    while (m_records.size() > m_options.retain)
+    {
+        m_records.pop_front();
+    }
+
+    m_next++;
+
+    std::erase_if(m_clients, [](const auto& client) { return client->IsDead(); });
+
+    for (const auto& client : m_clients)
+    {
+        client->Queue(line);
+    }
+}
+
+bool ChangeFeed::Replay(std::uint64_t from, const std::function<void(const std::string&)>& callback) const
+{
+    if (from > m_next || (!m_records.empty() && from < m_records.front().offset) || (m_records.empty() && from < m_next))
+    {
+        return false;
+    }
+
+    const auto first = std::lower_bound(
+        m_records.begin(),
+        m_records.end(),
+        from,
+        [](const Record& record, std::uint64_t offset) { return record.offset < offset; });
+
+    for (auto record = first; record != m_records.end(); ++record)
+    {
+        callback(*record->line);
+    }
+
+    return true;
+}
+
+porla::MemoryUsage ChangeFeed::Memory() const
+{
+    MemoryUsage usage{
+        .bytes   = m_snapshots.size() * (sizeof(Snapshot) + sizeof(lt::info_hash_t) + 32),
+        .objects = m_records.size() + m_snapshots.size() + m_clients.size()
+    };
+
+    for (const auto& record : m_records)
+    {
+        usage.bytes += sizeof(Record) + record.line->size();
+    }
+
+    return usage;
+}
+
+void ChangeFeed::Heartbeat()
+{
+    m_heartbeatTimer.expires_after(HeartbeatInterval);
+    m_heartbeatTimer.async_wait(
+        [this](boost::system::error_code ec)
+        {
+            if (ec) return;
+
+            // Not a record, so it has no offset and is not written to the files.
+            static const auto heartbeat = std::make_shared<const std::string>("{\"type\":\"heartbeat\"}\n");
+
+            std::erase_if(m_clients, [](const auto& client) { return client->IsDead(); });
+
+            for (const auto& client : m_clients)
+            {
+                client->Queue(heartbeat);
+            }
+
+            Heartbeat();
+        });
+}
+
+void ChangeFeed::Open()
+{
+    std::error_code ec;
+    fs::create_directories(*m_options.dir, ec);
+
+    const auto path = *m_options.dir / FileName(m_next);
+
+    m_file.open(path, std::ios::app);
+
+    if (!m_file.is_open())
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to open change feed file " << path;
+        return;
+    }
+
+    m_fileSize = fs::file_size(path, ec);
+    if (ec) m_fileSize = 0;
+
+    auto files = ListFiles(*m_options.dir);
+
+    while (files.size() > static_cast<std::size_t>(std::max(1, m_options.max_files)))
+    {
+        fs::remove(files.front(), ec);
+        files.erase(files.begin());
+    }
+}
+
+// Continues after the last record of the newest file, which is read from its end.
+void ChangeFeed::Recover()
+{
+    const auto files = ListFiles(*m_options.dir);
+
+    if (files.empty())
+    {
+        return;
+    }
+
+    std::ifstream file(files.back(), std::ios::binary | std::ios::ate);
+    const std::streamoff size = file.tellg();
+    const std::streamoff tail = std::min<std::streamoff>(size, 64 * 1024);
+
+    std::string buffer(static_cast<std::size_t>(tail), '\0');
+    file.seekg(size - tail);
+    file.read(buffer.data(), tail);
+
+    std::istringstream lines(buffer);
+    std::string line;
+    std::optional<std::uint64_t> last;
+
+    while (std::getline(lines, line))
+    {
+        const auto record = json::parse(line, nullptr, false);
+
+        if (!record.is_discarded() && record.contains("offset"))
+        {
+            last = record["offset"].get<std::uint64_t>();
+        }
+    }
+
+    if (last.has_value())
+    {
+        m_next = std::max(m_next, *last + 1);
+    }
+}
+
+void ChangeFeed::Schedule()
+{
+    m_snapshotTimer.expires_after(m_options.snapshot_interval);
+    m_snapshotTimer.async_wait(
+        [this](boost::system::error_code ec)
+        {
+            if (ec) return;
+
+            TakeSnapshot();
+            Schedule();
+        });
+}
+
+// One record for every torrent whose rates, progress or state changed since the last
+// snapshot, so idle torrents cost nothing.
+void ChangeFeed::TakeSnapshot()
+{
+    json torrents = json::array();
+
+    for (const auto& [hash, ts] : m_session.TorrentStatuses())
+    {
+        const Snapshot current{
+            .download_rate = ts.download_payload_rate,
+            .progress      = ts.progress,
+            .state         = static_cast<int>(ts.state),
+            .upload_rate   = ts.upload_payload_rate
+        };
+
+        auto [it, inserted] = m_snapshots.try_emplace(hash, current);
+
+        if (!inserted
+            && it->second.download_rate == current.download_rate
+            && it->second.progress == current.progress
+            && it->second.state == current.state
+            && it->second.upload_rate == current.upload_rate)
+        {
+            continue;
+        }
+
+        it->second = current;
+
+        torrents.push_back({
+            {"info_hash", hash},
+            {"download_rate", current.download_rate},
+            {"progress", current.progress},
+            {"state", current.state},
+            {"upload_rate", current.upload_rate},
+            {"total_done", ts.total_done},
+            {"all_time_upload", ts.all_time_upload}
+        });
+    }
+
+    if (!torrents.empty())
+    {
+        Append(json{{"type", "snapshot"}, {"torrents", std::move(torrents)}});
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+
+#include "httpcontext.hpp"
+#include "memoryusage.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct ChangeFeedOptions
+    {
+        // Where the records are also written as NDJSON files, rotated by size. Unset keeps
+        // them in memory only.
+        std::optional<std::filesystem::path> dir;
+        std::uint64_t             file_size         = 64 * 1024 * 1024;
+        // The oldest files are deleted beyond this many.
+        int                       max_files         = 10;
+        // Stream clients with more than this queued are disconnected, and resume from
+        // their last offset when they reconnect.
+        std::size_t               max_queued_bytes  = 16 * 1024 * 1024;
+        std::size_t               max_subscribers   = 16;
+        // Records kept in memory for clients resuming from an offset.
+        std::size_t               retain            = 10000;
+        // How often the rates and progress of the torrents which changed are recorded.
+        // Zero records none.
+        std::chrono::milliseconds snapshot_interval = std::chrono::milliseconds(60000);
+    };
+
+    // An append-only feed of torrent changes for external consumers. Every record has an
+    // offset, which keeps increasing across restarts, and recent records are kept so a
+    // consumer can resume from the last offset it saw. Records are streamed as NDJSON over
+    // HTTP, and optionally written to rotating files. Used from the io thread.
+    class ChangeFeed
+    {
+    public:
+        explicit ChangeFeed(boost::asio::io_context& io, ISession& session, ChangeFeedOptions options = {});
+        ChangeFeed(const ChangeFeed&) = delete;
+
+        ~ChangeFeed();
+
+        // Streams the records after the from offset of the query, or only new records
+        // without one.
+        void operator()(std::shared_ptr<HttpContext> ctx);
+
+        // Records a change without a torrent, such as a move. The offset and time are set
+        // on the record.
+        void Append(nlohmann::json record);
+
+        // Calls the callback with the encoded records from the offset on. Returns false if
+        // some of them are no longer kept.
+        bool Replay(std::uint64_t from, const std::function<void(const std::string&)>& callback) const;
+
+        // The offset of the next record.
+        [[nodiscard]] std::uint64_t Next() const { return m_next; }
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+    private:
+        class Client;
+
+        struct Record
+        {
+            std::uint64_t                      offset;
+            std::shared_ptr<const std::string> line;
+        };
+
+        // The values last recorded in a snapshot.
+        struct Snapshot
+        {
+            int   download_rate;
+            float progress;
+            int   state;
+            int   upload_rate;
+        };
+
+        void Heartbeat();
+        void Open();
+        void Recover();
+        void Schedule();
+        void TakeSnapshot();
+
+        ISession& m_session;
+        ChangeFeedOptions m_options;
+        boost::asio::steady_timer m_snapshotTimer;
+        boost::asio::steady_timer m_heartbeatTimer;
+
+        std::uint64_t m_next;
+        std::deque<Record> m_records;
+        std::map<libtorrent::info_hash_t, Snapshot> m_snapshots;
+        std::vector<std::shared_ptr<Client>> m_clients;
+
+        std::ofstream m_file;
+        std::uint64_t m_fileSize = 0;
+
+        std::vector<porla::Utils::Connection> m_connections;
+    };
+}
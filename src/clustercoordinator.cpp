@@ -0,0 +1,480 @@
+#include "clustercoordinator.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include <boost/log/trivial.hpp>
+
+#include "httpclient.hpp"
+#include "json/ltinfohash.hpp"
+
+using porla::ClusterCoordinator;
+
+// Requests are left running past the timeout of their node, so a slow reply still
+// refreshes the cache, but not forever.
+static constexpr std::chrono::seconds RequestTimeout(30);
+
+struct ClusterCoordinator::Call
+{
+    explicit Call(boost::asio::io_context& io)
+        : timer(io)
+    {
+    }
+
+    boost::asio::steady_timer timer;
+    ReplyCallback done;
+    bool replied = false;
+};
+
+std::vector<nlohmann::json> ClusterCoordinator::MergeSorted(
+    const std::vector<Reply>& pages,
+    const std::string& list,
+    const std::string& key,
+    bool descending,
+    std::size_t offset,
+    std::size_t count)
+{
+    std::vector<nlohmann::json> items;
+
+    for (const auto& page : pages)
+    {
+        if (page.error.has_value() || !page.result.contains(list) || !page.result[list].is_array())
+        {
+            continue;
+        }
+
+        for (const auto& item : page.result[list])
+        {
+            auto& added = items.emplace_back(item);
+            added["node"] = page.node;
+        }
+    }
+
+    // The nodes may break ties differently, so the merged items are sorted again rather
+    // than trusting every page to be in the same order.
+    std::stable_sort(
+        items.begin(),
+        items.end(),
+        [&](const nlohmann::json& lhs, const nlohmann::json& rhs)
+        {
+            const auto& l = lhs.contains(key) ? lhs[key] : nullptr;
+            const auto& r = rhs.contains(key) ? rhs[key] : nullptr;
+
+            if (l != r) return descending ? r < l : l < r;
+
+            return lhs.value("info_hash", nlohmann::json()) < rhs.value("info_hash", nlohmann::json());
+        });
+
+    if (offset >= items.size())
+    {
+        return {};
+    }
+
+    const auto end = items.size() - offset > count
+        ? items.begin() + static_cast<std::ptrdiff_t>(offset + count)
+        : items.end();
+
+    return {
+        std::make_move_iterator(items.begin() + static_cast<std::ptrdiff_t>(offset)),
+        std::make_move_iterator(end)
+    };
+}
+
+ClusterCoordinator::ClusterCoordinator(boost::asio::io_context& io, HttpClient& http, ClusterCoordinatorOptions options)
+    : m_io(io)
+    , m_http(http)
+    , m_options(std::move(options))
+    , m_timer(io)
+    , m_synced(m_options.nodes.size())
+{
+    for (const auto& node : m_options.nodes)
+    {
+        m_states.insert({ node.name, NodeState{} });
+    }
+
+    if (m_options.poll_interval.count() > 0)
+    {
+        Poll();
+    }
+}
+
+ClusterCoordinator::~ClusterCoordinator()
+{
+    m_timer.cancel();
+}
+
+void ClusterCoordinator::Gather(const std::string& method, const nlohmann::json& params, bool cache, GatherCallback done)
+{
+    if (m_options.nodes.empty())
+    {
+        return done({});
+    }
+
+    struct Pending
+    {
+        std::vector<Reply> replies;
+        std::size_t        left;
+        GatherCallback     done;
+    };
+
+    auto pending = std::make_shared<Pending>(Pending{
+        .replies = std::vector<Reply>(m_options.nodes.size()),
+        .left    = m_options.nodes.size(),
+        .done    = std::move(done)
+    });
+
+    for (std::size_t i = 0; i < m_options.nodes.size(); i++)
+    {
+        Send(
+            i,
+            method,
+            params,
+            cache,
+            [pending, i](Reply reply)
+            {
+                pending->replies[i] = std::move(reply);
+                if (--pending->left == 0) pending->done(std::move(pending->replies));
+            });
+    }
+}
+
+std::optional<std::string> ClusterCoordinator::Owner(const lt::info_hash_t& hash) const
+{
+    if (const auto owner = m_owners.find(hash); owner != m_owners.end())
+    {
+        return m_options.nodes[owner->second].name;
+    }
+
+    return std::nullopt;
+}
+
+void ClusterCoordinator::Route(const lt::info_hash_t& hash, const std::string& method, const nlohmann::json& params, ReplyCallback done)
+{
+    if (const auto owner = m_owners.find(hash); owner != m_owners.end())
+    {
+        return Send(owner->second, method, params, false, std::move(done));
+    }
+
+    if (m_options.nodes.empty())
+    {
+        return done(Reply{ .error = "No cluster nodes" });
+    }
+
+    Gather(
+        method,
+        params,
+        false,
+        [done = std::move(done)](std::vector<Reply> replies)
+        {
+            const auto ok = std::find_if(
+                replies.begin(),
+                replies.end(),
+                [](const Reply& reply) { return !reply.error.has_value(); });
+
+            done(std::move(ok != replies.end() ? *ok : replies.front()));
+        });
+}
+
+void ClusterCoordinator::Split(
+    const std::vector<lt::info_hash_t>& hashes,
+    const std::string& key,
+    const std::string& method,
+    const nlohmann::json& params,
+    GatherCallback done)
+{
+    std::vector<std::vector<lt::info_hash_t>> split(m_options.nodes.size());
+    std::vector<lt::info_hash_t> unknown;
+
+    for (const auto& hash : hashes)
+    {
+        if (const auto owner = m_owners.find(hash); owner != m_owners.end())
+        {
+            split[owner->second].push_back(hash);
+        }
+        else
+        {
+            unknown.push_back(hash);
+        }
+    }
+
+    std::vector<std::size_t> targets;
+
+    for (std::size_t i = 0; i < split.size(); i++)
+    {
+        split[i].insert(split[i].end(), unknown.begin(), unknown.end());
+        if (!split[i].empty()) targets.push_back(i);
+    }
+
+    if (targets.empty())
+    {
+        return done({});
+    }
+
+    struct Pending
+    {
+        std::vector<Reply> replies;
+        std::size_t        left;
+        GatherCallback     done;
+    };
+
+    auto pending = std::make_shared<Pending>(Pending{
+        .replies = std::vector<Reply>(targets.size()),
+        .left    = targets.size(),
+        .done    = std::move(done)
+    });
+
+    for (std::size_t i = 0; i < targets.size(); i++)
+    {
+        auto node_params = params;
+        node_params[key] = split[targets[i]];
+
+        Send(
+            targets[i],
+            method,
+            node_params,
+            false,
+            [pending, i](Reply reply)
+            {
+                pending->replies[i] = std::move(reply);
+                if (--pending->left == 0) pending->done(std::move(pending->replies));
+            });
+    }
+}
+
+void ClusterCoordinator::Learn(std::size_t node, const nlohmann::json& result)
+{
+    if (result.contains("torrents") && result["torrents"].is_array())
+    {
+        for (const auto& item : result["torrents"])
+        {
+            if (item.contains("info_hash"))
+            {
+                m_owners.insert_or_assign(item["info_hash"].get<lt::info_hash_t>(), node);
+            }
+        }
+    }
+
+    if (result.contains("removed") && result["removed"].is_array())
+    {
+        for (const auto& item : result["removed"])
+        {
+            const auto hash = item.get<lt::info_hash_t>();
+
+            if (const auto owner = m_owners.find(hash); owner != m_owners.end() && owner->second == node)
+            {
+                m_owners.erase(owner);
+            }
+        }
+    }
+}
+
+// Nodes are asked for what changed since their last revision, and for everything when
+// they cannot tell, such as after a restart.
+void ClusterCoordinator::Poll()
+{
+    if (m_options.nodes.empty())
+    {
+        return;
+    }
+
+    auto left = std::make_shared<std::size_t>(m_options.nodes.size());
+
+    for (std::size_t i = 0; i < m_options.nodes.size(); i++)
+    {
+        nlohmann::json params = {{"fields", {"info_hash"}}};
+        const bool full = !m_synced[i].has_value();
+
+        if (full) { params["page_size"] = std::numeric_limits<int>::max(); }
+        else      { params["since_revision"] = *m_synced[i]; }
+
+        Send(
+            i,
+            "torrents.list",
+            params,
+            false,
+            [this, i, full, left](Reply reply)
+            {
+                if (reply.error.has_value())
+                {
+                    m_synced[i].reset();
+                }
+                else
+                {
+                    if (full)
+                    {
+                        std::erase_if(m_owners, [i](const auto& owner) { return owner.second == i; });
+                        Learn(i, reply.result);
+                    }
+
+                    const auto revision = reply.result.value("revision", std::uint64_t{0});
+                    m_synced[i] = revision;
+
+                    Update(i, [&](NodeState& state)
+                    {
+                        state.revision = revision;
+                        state.torrents = reply.result.value("torrents_total_unfiltered", std::size_t{0});
+                    });
+                }
+
+                if (--*left == 0) Schedule();
+            });
+    }
+}
+
+void ClusterCoordinator::Schedule()
+{
+    m_timer.expires_after(m_options.poll_interval);
+    m_timer.async_wait(
+        [this](boost::system::error_code ec)
+        {
+            if (ec) return;
+            Poll();
+        });
+}
+
+void ClusterCoordinator::Send(std::size_t node, const std::string& method, const nlohmann::json& params, bool cache, ReplyCallback done)
+{
+    const auto& target = m_options.nodes[node];
+    const std::string key = target.name + "\n" + method + "\n" + params.dump();
+
+    auto call = std::make_shared<Call>(m_io);
+    call->done = std::move(done);
+
+    const auto from_cache = [this, key](Reply& reply)
+    {
+        const auto cached = m_cache.find(key);
+
+        if (cached == m_cache.end() || std::chrono::steady_clock::now() - cached->second.stored > m_options.cache_ttl)
+        {
+            return;
+        }
+
+        reply.result = cached->second.result;
+        reply.error.reset();
+        reply.cached = true;
+    };
+
+    call->timer.expires_after(target.timeout);
+    call->timer.async_wait(
+        [call, cache, from_cache, name = target.name](boost::system::error_code ec)
+        {
+            if (ec || call->replied) return;
+
+            call->replied = true;
+
+            Reply reply{ .node = name, .error = "Timed out" };
+            if (cache) from_cache(reply);
+
+            call->done(std::move(reply));
+        });
+
+    HttpClient::Request req{
+        .url     = target.url + "/api/v1/jsonrpc",
+        .method  = "POST",
+        .body    = nlohmann::json({
+            {"jsonrpc", "2.0"},
+            {"id", m_nextId++},
+            {"method", method},
+            {"params", params}
+        }).dump(),
+        .timeout = RequestTimeout
+    };
+
+    if (!target.token.empty())
+    {
+        req.headers.insert({ "Authorization", "Bearer " + target.token });
+    }
+
+    m_http.SendAsync(
+        req,
+        [this, node, call, cache, from_cache, key, method](const HttpClient::Response& res)
+        {
+            Reply reply{ .node = m_options.nodes[node].name };
+            // Errors from the method itself still mean the node is up.
+            bool reachable = false;
+
+            if (res.ec)
+            {
+                reply.error = res.ec.message();
+            }
+            else if (res.status != 200)
+            {
+                reply.error = "HTTP status " + std::to_string(res.status);
+            }
+            else if (const auto body = nlohmann::json::parse(res.body, nullptr, false); body.is_discarded())
+            {
+                reply.error = "Invalid JSON-RPC response";
+            }
+            else if (body.contains("error"))
+            {
+                reachable   = true;
+                reply.error = body["error"].value("message", "Unknown error");
+            }
+            else
+            {
+                reachable    = true;
+                reply.result = body.value("result", nlohmann::json());
+            }
+
+            if (!reply.error.has_value())
+            {
+                if (method == "torrents.list") Learn(node, reply.result);
+
+                if (cache)
+                {
+                    const auto now = std::chrono::steady_clock::now();
+
+                    std::erase_if(m_cache, [&](const auto& item) { return now - item.second.stored > m_options.cache_ttl; });
+                    m_cache.insert_or_assign(key, Cached{ .result = reply.result, .stored = now });
+                }
+            }
+
+            Update(node, [&](NodeState& state)
+            {
+                state.online = reachable;
+                state.error  = reachable ? std::nullopt : reply.error;
+
+                if (reachable)
+                {
+                    state.last_seen = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+                }
+            });
+
+            if (call->replied)
+            {
+                return;
+            }
+
+            call->replied = true;
+            call->timer.cancel();
+
+            // Unreachable nodes are answered for from the cache as well.
+            if (!reachable && cache) from_cache(reply);
+
+            call->done(std::move(reply));
+        });
+}
+
+void ClusterCoordinator::Update(std::size_t node, const std::function<void(NodeState&)>& update)
+{
+    const auto& name = m_options.nodes[node].name;
+    auto& state = m_states[name];
+    const auto previous = state;
+
+    update(state);
+
+    if (state.online != previous.online)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Cluster node " << name << " is " << (state.online ? "online" : "offline")
+                                << (state.error.has_value() ? " (" + *state.error + ")" : "");
+    }
+
+    if (state.online != previous.online
+        || state.revision != previous.revision
+        || state.torrents != previous.torrents)
+    {
+        m_nodeChanged(name, state);
+    }
+}
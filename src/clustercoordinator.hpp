@@ -0,0 +1,132 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+
+#include "clusternode.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class HttpClient;
+
+    struct ClusterCoordinatorOptions
+    {
+        std::vector<ClusterNode>  nodes;
+        // How often every node is asked for its torrents, which keeps the owners of the
+        // torrents and the cached results fresh. Zero only learns from calls.
+        std::chrono::milliseconds poll_interval = std::chrono::milliseconds(10000);
+        // Cached results older than this are not used for slow nodes.
+        std::chrono::seconds      cache_ttl     = std::chrono::seconds(300);
+    };
+
+    // Federates the JSON-RPC API of several porla nodes. Calls are sent to every node at
+    // once, and each node has until its timeout to reply before its last result for the
+    // same call is used instead. Calls for a torrent go to the node which has it, which is
+    // learned from the torrents the nodes list. Used from the io thread.
+    class ClusterCoordinator
+    {
+    public:
+        struct Reply
+        {
+            std::string                 node;
+            nlohmann::json              result;
+            std::optional<std::string>  error;
+            // Set for results reused after the node did not reply in time.
+            bool                        cached = false;
+        };
+
+        struct NodeState
+        {
+            bool                                  online = false;
+            std::uint64_t                         revision = 0;
+            std::size_t                           torrents = 0;
+            std::optional<std::string>            error;
+            // Unix time of the last reply, zero if there was none.
+            std::int64_t                          last_seen = 0;
+        };
+
+        typedef std::function<void(std::vector<Reply>)> GatherCallback;
+        typedef std::function<void(Reply)> ReplyCallback;
+        typedef porla::Utils::Signal<void(const std::string&, const NodeState&)> NodeSignal;
+
+        // Merges pages sorted by key from every node into one, skipping offset items and
+        // keeping at most count. Items are tagged with the node they came from.
+        static std::vector<nlohmann::json> MergeSorted(
+            const std::vector<Reply>& pages,
+            const std::string& list,
+            const std::string& key,
+            bool descending,
+            std::size_t offset,
+            std::size_t count);
+
+        explicit ClusterCoordinator(boost::asio::io_context& io, HttpClient& http, ClusterCoordinatorOptions options);
+        ClusterCoordinator(const ClusterCoordinator&) = delete;
+
+        ~ClusterCoordinator();
+
+        // Signals when a node goes on or offline, or its torrents change.
+        porla::Utils::Connection OnNodeChanged(const NodeSignal::slot_type& subscriber)
+        {
+            return m_nodeChanged.connect(subscriber);
+        }
+
+        // Calls the method on every node. Read-only calls should be cached so slow nodes
+        // still contribute their last result.
+        void Gather(const std::string& method, const nlohmann::json& params, bool cache, GatherCallback done);
+
+        // Calls the method on the node which has the torrent, or on every node while the
+        // owner is unknown, keeping the first reply without an error.
+        void Route(const lt::info_hash_t& hash, const std::string& method, const nlohmann::json& params, ReplyCallback done);
+
+        // Calls the method once per node with the torrents it has set on key, and on every
+        // node with the torrents of unknown owners.
+        void Split(
+            const std::vector<lt::info_hash_t>& hashes,
+            const std::string& key,
+            const std::string& method,
+            const nlohmann::json& params,
+            GatherCallback done);
+
+        [[nodiscard]] const std::map<std::string, NodeState>& Nodes() const { return m_states; }
+        [[nodiscard]] std::optional<std::string> Owner(const lt::info_hash_t& hash) const;
+
+    private:
+        struct Call;
+
+        struct Cached
+        {
+            nlohmann::json                        result;
+            std::chrono::steady_clock::time_point stored;
+        };
+
+        void Learn(std::size_t node, const nlohmann::json& result);
+        void Poll();
+        void Schedule();
+        void Send(std::size_t node, const std::string& method, const nlohmann::json& params, bool cache, ReplyCallback done);
+        void Update(std::size_t node, const std::function<void(NodeState&)>& update);
+
+        boost::asio::io_context& m_io;
+        HttpClient& m_http;
+        ClusterCoordinatorOptions m_options;
+        boost::asio::steady_timer m_timer;
+
+        std::uint64_t m_nextId = 0;
+        std::map<std::string, Cached> m_cache;
+        std::map<lt::info_hash_t, std::size_t> m_owners;
+        std::map<std::string, NodeState> m_states;
+        // The revision each node was last listed at, if the listing was complete.
+        std::vector<std::optional<std::uint64_t>> m_synced;
+
+        NodeSignal m_nodeChanged;
+    };
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace porla
+{
+    // A porla instance federated by the cluster coordinator.
+    struct ClusterNode
+    {
+        std::string               name;
+        // Where the node serves its API, with its base path but without /api/v1.
+        std::string               url;
+        // Sent as the bearer token, for nodes with HTTP auth enabled.
+        std::string               token;
+        // Replies slower than this are answered from the last result of the node.
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(2000);
+    };
+}
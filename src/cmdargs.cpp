@@ -13,19 +13,39 @@ static po::options_description Options()
         ("db",                    po::value<std::string>(), "Path to where the database will be stored.")
         ("help",                                            "Show usage")
         ("http-base-path",        po::value<std::string>(), "The base path for HTTP routes")
+        ("http-debug-enabled",    po::value<bool>(),        "Set to true to enable the profiling endpoints")
         ("http-host",             po::value<std::string>(), "The host to listen on for HTTP traffic.")
         ("http-metrics-enabled",  po::value<bool>(),        "Set to true if the metrics endpoint should be enabled")
         ("http-port",             po::value<uint16_t>(),    "The port to listen on for HTTP traffic.")
+        ("http-tcp-enabled",      po::value<bool>(),        "Set to false to only serve HTTP on the Unix socket")
+        ("http-threads",          po::value<int>(),         "Number of threads for the HTTP server. 0 shares the main thread.")
+        ("http-unix-socket",      po::value<std::string>(), "Path to a Unix socket to also serve HTTP on.")
         ("http-webui-enabled",    po::value<bool>(),        "Set to true if the web UI should be enabled")
+        ("log-format",            po::value<std::string>(), "The log format, text or json.")
         ("log-level",             po::value<std::string>(), "The minimum log level to print.")
+        ("log-repeat-window",     po::value<int>(),         "Seconds within which a repeated log message is only counted. 0 writes every one.")
+        ("metrics-max-labels",    po::value<int>(),         "The maximum number of label values per aggregated metric.")
+        ("rpc-coalesce-ttl",      po::value<int>(),         "The time in milliseconds to reuse the result of a coalesced RPC request.")
+        ("rpc-max-concurrent",    po::value<int>(),         "The maximum number of RPC requests running at once. 0 disables admission control.")
+        ("rpc-max-per-client",    po::value<int>(),         "The maximum number of RPC requests running at once per client.")
+        ("rpc-max-queued",        po::value<int>(),         "The maximum number of RPC requests waiting to run.")
+        ("rpc-queue-budget",      po::value<int>(),         "The time in milliseconds an RPC read may wait to run before it is shed.")
+        ("rpc-worker-queue-size", po::value<int>(),         "The maximum number of RPC requests waiting for a worker.")
+        ("rpc-worker-threads",    po::value<int>(),         "Number of worker threads for heavy RPC methods. 0 runs them on the main thread.")
         ("secret-key",            po::value<std::string>(), "The secret key to use when protecting various pieces of data.")
         ("session-settings-base", po::value<std::string>(), "The libtorrent base settings to use")
+        ("simulation-torrents",   po::value<int>(),         "Run against this many simulated torrents instead of libtorrent.")
         ("state-dir",             po::value<std::string>(), "The path to a directory where Porla state will be saved.")
         ("supervised-interval",   po::value<int>(),         "The interval to use when checking the supervisor pid.")
         ("supervised-pid",        po::value<pid_t>(),       "A pid to a parent process. If this pid dies, we shut down.")
+        ("timer-dht-state",       po::value<int>(),         "The interval to write the DHT state to disk, besides at shutdown.")
         ("timer-dht-stats",       po::value<int>(),         "The interval to use for the DHT stats updates.")
+        ("timer-dht-stats-idle",  po::value<int>(),         "The interval to use for the DHT stats updates when nothing needs them.")
+        ("timer-resume-data",     po::value<int>(),         "The interval to save resume data for torrents with unsaved changes.")
         ("timer-session-stats",   po::value<int>(),         "The interval to use for the session stats updates.")
+        ("timer-session-stats-idle", po::value<int>(),      "The interval to use for the session stats updates when nothing needs them.")
         ("timer-torrent-updates", po::value<int>(),         "The interval to use for the torrent updates.")
+        ("timer-torrent-updates-idle", po::value<int>(),    "The interval to use for the torrent updates when nothing needs them.")
         ("workflow-dir",          po::value<std::string>(), "The directory where workflow files are stored.")
         ;
 
@@ -1,5 +1,6 @@
 #include "config.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 
@@ -14,7 +15,10 @@
 
 #include "data/migrate.hpp"
 #include "data/models/sessionsettings.hpp"
+#include "data/statement.hpp"
+#include "utils/phases.hpp"
 #include "utils/secretkey.hpp"
+#include "utils/string.hpp"
 
 namespace fs = std::filesystem;
 namespace lt = libtorrent;
@@ -23,8 +27,10 @@ namespace po = boost::program_options;
 using porla::Config;
 
 static void ApplySettings(const toml::table& tbl, lt::settings_pack& settings);
+static void ApplyStaticSettings(lt::settings_pack& settings);
+static void OpenReadOnly(Config& cfg, const std::string& db_file);
 
-std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map& cmd)
+std::unique_ptr<Config> Config::Parse(const boost::program_options::variables_map& cmd, bool strict)
 {
     const static std::vector<fs::path> config_file_search_paths =
     {
@@ -50,6 +56,8 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
     };
 
     auto cfg = std::unique_ptr<Config>(new Config());
+    cfg->db_pragmas.busy_timeout   = 5000;
+    cfg->db_pragmas.journal_mode   = "wal";
     cfg->http_auth_enabled         = true;
     cfg->session_settings          = lt::default_settings();
 
@@ -72,25 +80,90 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
         break;
     }
 
+    if (auto val = std::getenv("PORLA_ALERT_QUEUE_MAX")) cfg->alert_queue_max = std::stoi(val);
+    if (auto val = std::getenv("PORLA_ALERT_THREAD"))
+    {
+        if (strcmp("true", val) == 0)  cfg->alert_thread = true;
+        if (strcmp("false", val) == 0) cfg->alert_thread = false;
+    }
+    if (auto val = std::getenv("PORLA_AUTH_HASH_MEMLIMIT"))      cfg->auth_hash_memlimit      = std::stoi(val);
+    if (auto val = std::getenv("PORLA_AUTH_HASH_MEMORY_BUDGET")) cfg->auth_hash_memory_budget = std::stoi(val);
+    if (auto val = std::getenv("PORLA_AUTH_HASH_OPSLIMIT"))      cfg->auth_hash_opslimit      = std::stoi(val);
+    if (auto val = std::getenv("PORLA_AUTH_HASH_QUEUE_SIZE"))    cfg->auth_hash_queue_size    = std::stoi(val);
+    if (auto val = std::getenv("PORLA_AUTH_HASH_TIMEOUT"))       cfg->auth_hash_timeout       = std::stoi(val);
+    if (auto val = std::getenv("PORLA_COLUMNAR_SNAPSHOT"))
+    {
+        if (strcmp("true", val) == 0)  cfg->columnar_snapshot = true;
+        if (strcmp("false", val) == 0) cfg->columnar_snapshot = false;
+    }
     if (auto val = std::getenv("PORLA_CONFIG_FILE"))           cfg->config_file     = val;
     if (auto val = std::getenv("PORLA_DB"))                    cfg->db_file         = val;
+    if (auto val = std::getenv("PORLA_DISK_IO"))               cfg->disk_io         = val;
+    if (auto val = std::getenv("PORLA_DISK_SPACE_CRITICAL"))   cfg->disk_space_critical = std::stoi(val);
+    if (auto val = std::getenv("PORLA_DISK_SPACE_INTERVAL"))   cfg->disk_space_interval = std::stoi(val);
+    if (auto val = std::getenv("PORLA_DISK_SPACE_LOW"))        cfg->disk_space_low      = std::stoi(val);
+    if (auto val = std::getenv("PORLA_DISK_SPACE_PAUSE"))
+    {
+        if (strcmp("true", val) == 0)  cfg->disk_space_pause = true;
+        if (strcmp("false", val) == 0) cfg->disk_space_pause = false;
+    }
     if (auto val = std::getenv("PORLA_HTTP_AUTH_DISABLED_YES_REALLY"))
     {
         if (strcmp("true", val) == 0) cfg->http_auth_enabled = false;
     }
     if (auto val = std::getenv("PORLA_HTTP_BASE_PATH"))        cfg->http_base_path  = val;
+    if (auto val = std::getenv("PORLA_HTTP_COMPRESSION_LEVEL"))    cfg->http_compression_level    = std::stoi(val);
+    if (auto val = std::getenv("PORLA_HTTP_COMPRESSION_MIN_SIZE")) cfg->http_compression_min_size = std::stoi(val);
+    if (auto val = std::getenv("PORLA_HTTP_DEBUG_ENABLED"))
+    {
+        if (strcmp("true", val) == 0)  cfg->http_debug_enabled = true;
+        if (strcmp("false", val) == 0) cfg->http_debug_enabled = false;
+    }
     if (auto val = std::getenv("PORLA_HTTP_HOST"))             cfg->http_host       = val;
+    if (auto val = std::getenv("PORLA_HTTP_IDLE_TIMEOUT"))     cfg->http_idle_timeout = std::stoi(val);
+    if (auto val = std::getenv("PORLA_HTTP_MAX_CONNECTIONS"))  cfg->http_max_connections = std::stoi(val);
+    if (auto val = std::getenv("PORLA_HTTP_MAX_EVENT_SUBSCRIBERS")) cfg->http_max_event_subscribers = std::stoi(val);
     if (auto val = std::getenv("PORLA_HTTP_METRICS_ENABLED"))
     {
         if (strcmp("true", val) == 0)  cfg->http_metrics_enabled = true;
         if (strcmp("false", val) == 0) cfg->http_metrics_enabled = false;
     }
     if (auto val = std::getenv("PORLA_HTTP_PORT"))             cfg->http_port       = std::stoi(val);
+    if (auto val = std::getenv("PORLA_HTTP_TCP_ENABLED"))
+    {
+        if (strcmp("true", val) == 0)  cfg->http_tcp_enabled = true;
+        if (strcmp("false", val) == 0) cfg->http_tcp_enabled = false;
+    }
+    if (auto val = std::getenv("PORLA_HTTP_THREADS"))          cfg->http_threads    = std::stoi(val);
+    if (auto val = std::getenv("PORLA_HTTP_UNIX_SOCKET"))      cfg->http_unix_socket = val;
     if (auto val = std::getenv("PORLA_HTTP_WEBUI_ENABLED"))
     {
         if (strcmp("true", val) == 0)  cfg->http_webui_enabled = true;
         if (strcmp("false", val) == 0) cfg->http_webui_enabled = false;
     }
+    if (auto val = std::getenv("PORLA_MAGNETS_CONCURRENCY"))    cfg->magnets_concurrency        = std::stoi(val);
+    if (auto val = std::getenv("PORLA_MAGNETS_RETRY_DELAY"))    cfg->magnets_retry_delay        = std::stoi(val);
+    if (auto val = std::getenv("PORLA_MAGNETS_TIMEOUT"))        cfg->magnets_timeout            = std::stoi(val);
+    if (auto val = std::getenv("PORLA_METADATA_CACHE_SIZE"))    cfg->metadata_cache_size        = std::stoi(val);
+    if (auto val = std::getenv("PORLA_METADATA_INDEXES"))       cfg->metadata_indexes           = porla::Utils::String::Split(val, ",");
+    if (auto val = std::getenv("PORLA_METRICS_MAX_LABELS"))     cfg->metrics_max_labels         = std::stoi(val);
+    if (auto val = std::getenv("PORLA_MOVE_CONCURRENCY"))       cfg->move_concurrency           = std::stoi(val);
+    if (auto val = std::getenv("PORLA_PARKING_AFTER"))          cfg->parking_after              = std::stoi(val);
+    if (auto val = std::getenv("PORLA_PERSISTENCE_BATCH_SIZE"))     cfg->persistence_batch_size     = std::stoi(val);
+    if (auto val = std::getenv("PORLA_PERSISTENCE_COMPRESS"))
+    {
+        if (strcmp("true", val) == 0)  cfg->persistence_compress = true;
+        if (strcmp("false", val) == 0) cfg->persistence_compress = false;
+    }
+    if (auto val = std::getenv("PORLA_PERSISTENCE_FLUSH_INTERVAL")) cfg->persistence_flush_interval = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RECHECK_CONCURRENCY"))    cfg->recheck_concurrency        = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_COALESCE_TTL"))       cfg->rpc_coalesce_ttl           = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_MAX_CONCURRENT"))     cfg->rpc_max_concurrent         = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_MAX_PER_CLIENT"))     cfg->rpc_max_per_client         = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_MAX_QUEUED"))         cfg->rpc_max_queued             = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_QUEUE_BUDGET"))       cfg->rpc_queue_budget           = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_WORKER_QUEUE_SIZE"))  cfg->rpc_worker_queue_size      = std::stoi(val);
+    if (auto val = std::getenv("PORLA_RPC_WORKER_THREADS"))     cfg->rpc_worker_threads         = std::stoi(val);
     if (auto val = std::getenv("PORLA_SECRET_KEY"))            cfg->secret_key      = val;
     if (auto val = std::getenv("PORLA_SESSION_SETTINGS_BASE"))
     {
@@ -98,10 +171,36 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
         if (strcmp("high_performance_seed", val) == 0) cfg->session_settings = lt::high_performance_seed();
         if (strcmp("min_memory_usage", val) == 0)      cfg->session_settings = lt::min_memory_usage();
     }
+    if (auto val = std::getenv("PORLA_SHARDS"))                 cfg->shards                 = std::stoi(val);
+    if (auto val = std::getenv("PORLA_SIMULATION_FINISH_RATE")) cfg->simulation_finish_rate = std::stoi(val);
+    if (auto val = std::getenv("PORLA_SIMULATION_TORRENTS"))    cfg->simulation_torrents    = std::stoi(val);
+    if (auto val = std::getenv("PORLA_SIMULATION_UPDATE_RATE")) cfg->simulation_update_rate = std::stoi(val);
+    if (auto val = std::getenv("PORLA_SORT_INDEXES"))
+    {
+        if (strcmp("true", val) == 0)  cfg->sort_indexes = true;
+        if (strcmp("false", val) == 0) cfg->sort_indexes = false;
+    }
     if (auto val = std::getenv("PORLA_STATE_DIR"))             cfg->state_dir             = val;
-    if (auto val = std::getenv("PORLA_TIMER_DHT_STATS"))       cfg->timer_dht_stats       = std::stoi(val);
-    if (auto val = std::getenv("PORLA_TIMER_SESSION_STATS"))   cfg->timer_session_stats   = std::stoi(val);
-    if (auto val = std::getenv("PORLA_TIMER_TORRENT_UPDATES")) cfg->timer_torrent_updates = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_DHT_STATE"))            cfg->timer_dht_state            = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_DHT_STATS"))            cfg->timer_dht_stats            = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_DHT_STATS_IDLE"))       cfg->timer_dht_stats_idle       = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_RESUME_DATA"))          cfg->timer_resume_data          = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_SESSION_STATS"))        cfg->timer_session_stats        = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_SESSION_STATS_IDLE"))   cfg->timer_session_stats_idle   = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_TORRENT_UPDATES"))      cfg->timer_torrent_updates      = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TIMER_TORRENT_UPDATES_IDLE")) cfg->timer_torrent_updates_idle = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TORRENT_HISTORY_ENABLED"))
+    {
+        if (strcmp("true", val) == 0)  cfg->torrent_history_enabled = true;
+        if (strcmp("false", val) == 0) cfg->torrent_history_enabled = false;
+    }
+    if (auto val = std::getenv("PORLA_TORRENT_HISTORY_FLUSH_INTERVAL")) cfg->torrent_history_flush_interval = std::stoi(val);
+    if (auto val = std::getenv("PORLA_TRACING_ENDPOINT"))    cfg->tracing_endpoint    = val;
+    if (auto val = std::getenv("PORLA_TRACING_SAMPLE_RATE")) cfg->tracing_sample_rate = std::stod(val);
+    if (auto val = std::getenv("PORLA_WATCH_INTERVAL"))      cfg->watch_interval      = std::stoi(val);
+    if (auto val = std::getenv("PORLA_WORKFLOW_MAX_PARALLEL_STEPS")) cfg->workflow_max_parallel_steps = std::stoi(val);
+    if (auto val = std::getenv("PORLA_WORKFLOW_MAX_QUEUED"))  cfg->workflow_max_queued  = std::stoi(val);
+    if (auto val = std::getenv("PORLA_WORKFLOW_MAX_RUNNING")) cfg->workflow_max_running = std::stoi(val);
 
     if (cmd.count("config-file"))
     {
@@ -126,24 +225,278 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
         {
             const toml::table config_file_tbl = toml::parse(config_file_data);
 
+            if (auto val = config_file_tbl["alert_queue_max"].value<int>())
+                cfg->alert_queue_max = *val;
+
+            if (auto val = config_file_tbl["alert_thread"].value<bool>())
+                cfg->alert_thread = *val;
+
+            if (auto val = config_file_tbl["auth"]["hash_memlimit"].value<int>())
+                cfg->auth_hash_memlimit = *val;
+
+            if (auto val = config_file_tbl["auth"]["hash_memory_budget"].value<int>())
+                cfg->auth_hash_memory_budget = *val;
+
+            if (auto val = config_file_tbl["auth"]["hash_opslimit"].value<int>())
+                cfg->auth_hash_opslimit = *val;
+
+            if (auto val = config_file_tbl["auth"]["hash_queue_size"].value<int>())
+                cfg->auth_hash_queue_size = *val;
+
+            if (auto val = config_file_tbl["auth"]["hash_timeout"].value<int>())
+                cfg->auth_hash_timeout = *val;
+
+            if (auto val = config_file_tbl["changes"]["dir"].value<std::string>())
+                cfg->changes_dir = *val;
+
+            if (auto val = config_file_tbl["changes"]["enabled"].value<bool>())
+                cfg->changes_enabled = *val;
+
+            if (auto val = config_file_tbl["changes"]["file_size"].value<int>())
+                cfg->changes_file_size = *val;
+
+            if (auto val = config_file_tbl["changes"]["max_files"].value<int>())
+                cfg->changes_max_files = *val;
+
+            if (auto val = config_file_tbl["changes"]["retain"].value<int>())
+                cfg->changes_retain = *val;
+
+            if (auto val = config_file_tbl["changes"]["snapshot_interval"].value<int>())
+                cfg->changes_snapshot_interval = *val;
+
+            if (auto val = config_file_tbl["cluster"]["cache_ttl"].value<int>())
+                cfg->cluster_cache_ttl = *val;
+
+            if (auto const* nodes_arr = config_file_tbl["cluster"]["nodes"].as_array())
+            {
+                for (auto const& item : *nodes_arr)
+                {
+                    auto const* node_tbl = item.as_table();
+
+                    if (node_tbl == nullptr)
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Cluster node is not a TOML table";
+                        continue;
+                    }
+
+                    ClusterNode node = {};
+
+                    node.url   = (*node_tbl)["url"].value_or(std::string());
+                    node.name  = (*node_tbl)["name"].value_or(node.url);
+                    node.token = (*node_tbl)["token"].value_or(std::string());
+
+                    if (auto val = (*node_tbl)["timeout"].value<int>())
+                        node.timeout = std::chrono::milliseconds(std::max(1, *val));
+
+                    if (node.url.empty())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Cluster node without url";
+                        continue;
+                    }
+
+                    while (node.url.ends_with("/")) node.url.pop_back();
+
+                    cfg->cluster_nodes.push_back(std::move(node));
+                }
+            }
+
+            if (auto val = config_file_tbl["cluster"]["poll_interval"].value<int>())
+                cfg->cluster_poll_interval = *val;
+
+            if (auto val = config_file_tbl["cpu"]["http"].value<std::string>())
+                cfg->cpu_http = *val;
+
+            if (auto val = config_file_tbl["cpu"]["io"].value<std::string>())
+                cfg->cpu_io = *val;
+
+            if (auto val = config_file_tbl["cpu"]["libtorrent"].value<std::string>())
+                cfg->cpu_libtorrent = *val;
+
+            if (auto val = config_file_tbl["cpu"]["numa_local"].value<bool>())
+                cfg->cpu_numa_local = *val;
+
+            if (auto val = config_file_tbl["cpu"]["workers"].value<std::string>())
+                cfg->cpu_workers = *val;
+
+            if (auto val = config_file_tbl["columnar_snapshot"].value<bool>())
+                cfg->columnar_snapshot = *val;
+
             if (auto val = config_file_tbl["db"].value<std::string>())
                 cfg->db_file = *val;
 
+            if (auto val = config_file_tbl["disk_io"].value<std::string>())
+                cfg->disk_io = *val;
+
+            if (auto val = config_file_tbl["disk_space"]["critical"].value<int>())
+                cfg->disk_space_critical = *val;
+
+            if (auto val = config_file_tbl["disk_space"]["interval"].value<int>())
+                cfg->disk_space_interval = *val;
+
+            if (auto val = config_file_tbl["disk_space"]["low"].value<int>())
+                cfg->disk_space_low = *val;
+
+            if (auto val = config_file_tbl["disk_space"]["pause"].value<bool>())
+                cfg->disk_space_pause = *val;
+
             if (auto val = config_file_tbl["http"]["base_path"].value<std::string>())
                 cfg->http_base_path = *val;
 
             if (auto val = config_file_tbl["http"]["host"].value<std::string>())
                 cfg->http_host = *val;
 
+            if (auto val = config_file_tbl["http"]["compression_level"].value<int>())
+                cfg->http_compression_level = *val;
+
+            if (auto val = config_file_tbl["http"]["compression_min_size"].value<int>())
+                cfg->http_compression_min_size = *val;
+
+            if (auto val = config_file_tbl["http"]["idle_timeout"].value<int>())
+                cfg->http_idle_timeout = *val;
+
+            if (auto val = config_file_tbl["http"]["debug_enabled"].value<bool>())
+                cfg->http_debug_enabled = *val;
+
+            if (auto val = config_file_tbl["http"]["max_connections"].value<int>())
+                cfg->http_max_connections = *val;
+
+            if (auto val = config_file_tbl["http"]["max_event_subscribers"].value<int>())
+                cfg->http_max_event_subscribers = *val;
+
             if (auto val = config_file_tbl["http"]["metrics_enabled"].value<bool>())
                 cfg->http_metrics_enabled = *val;
 
             if (auto val = config_file_tbl["http"]["port"].value<uint16_t>())
                 cfg->http_port = *val;
 
+            if (auto val = config_file_tbl["http"]["tcp_enabled"].value<bool>())
+                cfg->http_tcp_enabled = *val;
+
+            if (auto val = config_file_tbl["http"]["threads"].value<int>())
+                cfg->http_threads = *val;
+
+            if (auto val = config_file_tbl["http"]["unix_socket"].value<std::string>())
+                cfg->http_unix_socket = *val;
+
             if (auto val = config_file_tbl["http"]["webui_enabled"].value<bool>())
                 cfg->http_webui_enabled = *val;
 
+            if (auto val = config_file_tbl["magnets"]["concurrency"].value<int>())
+                cfg->magnets_concurrency = *val;
+
+            if (auto val = config_file_tbl["magnets"]["retry_delay"].value<int>())
+                cfg->magnets_retry_delay = *val;
+
+            if (auto val = config_file_tbl["magnets"]["timeout"].value<int>())
+                cfg->magnets_timeout = *val;
+
+            if (auto val = config_file_tbl["metadata"]["cache_size"].value<int>())
+                cfg->metadata_cache_size = *val;
+
+            if (auto const indexes_val = config_file_tbl["metadata"]["indexes"].as_array())
+            {
+                cfg->metadata_indexes.clear();
+
+                for (auto const& index_item : *indexes_val)
+                {
+                    if (auto const index_value = index_item.value<std::string>())
+                    {
+                        cfg->metadata_indexes.push_back(*index_value);
+                    }
+                }
+            }
+
+            if (auto val = config_file_tbl["metrics"]["max_labels"].value<int>())
+                cfg->metrics_max_labels = *val;
+
+            if (auto val = config_file_tbl["move"]["concurrency"].value<int>())
+                cfg->move_concurrency = *val;
+
+            if (auto const* quotas_arr = config_file_tbl["quotas"].as_array())
+            {
+                for (auto const& item : *quotas_arr)
+                {
+                    auto const* quota_tbl = item.as_table();
+
+                    if (quota_tbl == nullptr)
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Quota is not a TOML table";
+                        continue;
+                    }
+
+                    SavePathQuota quota = {};
+
+                    quota.action   = (*quota_tbl)["action"].value_or(std::string("reject"));
+                    quota.max_size = (*quota_tbl)["max_size"].value_or(std::int64_t(0)) * 1024 * 1024;
+                    quota.name     = (*quota_tbl)["name"].value_or(std::string());
+
+                    if (auto val = (*quota_tbl)["category"].value<std::string>())
+                        quota.category = *val;
+
+                    if (auto val = (*quota_tbl)["save_path"].value<std::string>())
+                        quota.save_path = *val;
+
+                    if (!quota.category.has_value() && !quota.save_path.has_value())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Quota '" << quota.name << "' needs a category or a save_path";
+                        continue;
+                    }
+
+                    if (quota.action != "reject" && quota.action != "pause")
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Quota '" << quota.name << "' has unknown action '" << quota.action << "'";
+                        continue;
+                    }
+
+                    cfg->quotas.push_back(std::move(quota));
+                }
+            }
+
+            if (auto val = config_file_tbl["recheck"]["concurrency"].value<int>())
+                cfg->recheck_concurrency = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["curve"].value<std::string>())
+                cfg->release_boost_curve = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["enabled"].value<bool>())
+                cfg->release_boost_enabled = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["finished"].value<bool>())
+                cfg->release_boost_finished = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["max_priority"].value<int>())
+                cfg->release_boost_max_priority = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["tiers"].value<int>())
+                cfg->release_boost_tiers = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["unchoke_tiers"].value<int>())
+                cfg->release_boost_unchoke_tiers = *val;
+
+            if (auto val = config_file_tbl["release_boost"]["window"].value<int>())
+                cfg->release_boost_window = *val;
+
+            if (auto val = config_file_tbl["rpc"]["coalesce_ttl"].value<int>())
+                cfg->rpc_coalesce_ttl = *val;
+
+            if (auto val = config_file_tbl["rpc"]["max_concurrent"].value<int>())
+                cfg->rpc_max_concurrent = *val;
+
+            if (auto val = config_file_tbl["rpc"]["max_per_client"].value<int>())
+                cfg->rpc_max_per_client = *val;
+
+            if (auto val = config_file_tbl["rpc"]["max_queued"].value<int>())
+                cfg->rpc_max_queued = *val;
+
+            if (auto val = config_file_tbl["rpc"]["queue_budget"].value<int>())
+                cfg->rpc_queue_budget = *val;
+
+            if (auto val = config_file_tbl["rpc"]["worker_queue_size"].value<int>())
+                cfg->rpc_worker_queue_size = *val;
+
+            if (auto val = config_file_tbl["rpc"]["worker_threads"].value<int>())
+                cfg->rpc_worker_threads = *val;
+
             // Load presets
             if (auto const* presets_tbl = config_file_tbl["presets"].as_table())
             {
@@ -198,6 +551,149 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
                 }
             }
 
+            if (auto val = config_file_tbl["parking"]["after"].value<int>())
+                cfg->parking_after = *val;
+
+            if (auto val = config_file_tbl["peer_aggregates"]["enabled"].value<bool>())
+                cfg->peer_aggregates_enabled = *val;
+
+            if (auto val = config_file_tbl["peer_aggregates"]["interval"].value<int>())
+                cfg->peer_aggregates_interval = *val;
+
+            if (auto val = config_file_tbl["peer_aggregates"]["top"].value<int>())
+                cfg->peer_aggregates_top = *val;
+
+            if (auto val = config_file_tbl["peer_aggregates"]["torrents_per_tick"].value<int>())
+                cfg->peer_aggregates_torrents_per_tick = *val;
+
+            // Load peer classes, after the presets since they can name presets for their category
+            if (auto const* classes_tbl = config_file_tbl["peer_classes"].as_table())
+            {
+                for (auto const [key,value] : *classes_tbl)
+                {
+                    if (!value.is_table())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Peer class '" << key << "' is not a TOML table";
+                        continue;
+                    }
+
+                    const toml::table value_tbl = *value.as_table();
+
+                    PeerClass pc = {};
+                    pc.name = key.data();
+
+                    if (auto const categories_val = value_tbl["categories"].as_array())
+                    {
+                        for (auto const& category_item : *categories_val)
+                        {
+                            if (auto const category_value = category_item.value<std::string>())
+                            {
+                                pc.categories.push_back(*category_value);
+                            }
+                        }
+                    }
+
+                    if (auto val = value_tbl["download_limit"].value<int>())
+                        pc.download_limit = *val;
+
+                    if (auto val = value_tbl["download_priority"].value<int>())
+                        pc.download_priority = *val;
+
+                    if (auto val = value_tbl["ignore_unchoke_slots"].value<bool>())
+                        pc.ignore_unchoke_slots = *val;
+
+                    if (auto const presets_val = value_tbl["presets"].as_array())
+                    {
+                        for (auto const& preset_item : *presets_val)
+                        {
+                            auto const preset_name = preset_item.value<std::string>();
+                            if (!preset_name) continue;
+
+                            auto const preset = cfg->presets.find(*preset_name);
+
+                            if (preset == cfg->presets.end() || !preset->second.category.has_value())
+                            {
+                                BOOST_LOG_TRIVIAL(warning) << "Peer class '" << key << "' names preset '" << *preset_name << "' which does not exist or has no category";
+                                continue;
+                            }
+
+                            pc.categories.push_back(*preset->second.category);
+                        }
+                    }
+
+                    if (auto val = value_tbl["upload_limit"].value<int>())
+                        pc.upload_limit = *val;
+
+                    if (auto val = value_tbl["upload_priority"].value<int>())
+                        pc.upload_priority = *val;
+
+                    cfg->peer_classes.insert({ key.data(), std::move(pc) });
+                }
+            }
+
+            if (auto val = config_file_tbl["seed_scheduler"]["demand_weight"].value<double>())
+                cfg->seed_scheduler_demand_weight = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["enabled"].value<bool>())
+                cfg->seed_scheduler_enabled = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["interval"].value<int>())
+                cfg->seed_scheduler_interval = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["max_changes"].value<int>())
+                cfg->seed_scheduler_max_changes = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["seeding_time_weight"].value<double>())
+                cfg->seed_scheduler_seeding_time_weight = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["slots"].value<int>())
+                cfg->seed_scheduler_slots = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["upload_weight"].value<double>())
+                cfg->seed_scheduler_upload_weight = *val;
+
+            if (auto val = config_file_tbl["seed_scheduler"]["upload_window"].value<int>())
+                cfg->seed_scheduler_upload_window = *val;
+
+            if (auto const* goals_arr = config_file_tbl["seeding_goals"].as_array())
+            {
+                for (auto const& item : *goals_arr)
+                {
+                    auto const* goal_tbl = item.as_table();
+
+                    if (goal_tbl == nullptr)
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Seeding goal is not a TOML table";
+                        continue;
+                    }
+
+                    SeedingGoal goal = {};
+
+                    goal.action = (*goal_tbl)["action"].value_or(std::string());
+                    goal.name   = (*goal_tbl)["name"].value_or(std::string());
+                    goal.query  = (*goal_tbl)["query"].value_or(std::string());
+
+                    if (auto val = (*goal_tbl)["path"].value<std::string>())
+                        goal.path = *val;
+
+                    if (auto const presets_val = (*goal_tbl)["presets"].as_array())
+                    {
+                        for (auto const& preset_item : *presets_val)
+                        {
+                            if (auto const preset_value = preset_item.value<std::string>())
+                            {
+                                goal.presets.push_back(*preset_value);
+                            }
+                        }
+                    }
+
+                    cfg->seeding_goals.push_back(std::move(goal));
+                }
+            }
+
+            if (auto val = config_file_tbl["seeding_goals_interval"].value<int>())
+                cfg->seeding_goals_interval = *val;
+
             if (auto val = config_file_tbl["secret_key"].value<std::string>())
                 cfg->secret_key = *val;
 
@@ -228,6 +724,15 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
                 cfg->session_extensions = extensions;
             }
 
+            if (auto val = config_file_tbl["persistence"]["batch_size"].value<int>())
+                cfg->persistence_batch_size = *val;
+
+            if (auto val = config_file_tbl["persistence"]["compress"].value<bool>())
+                cfg->persistence_compress = *val;
+
+            if (auto val = config_file_tbl["persistence"]["flush_interval"].value<int>())
+                cfg->persistence_flush_interval = *val;
+
             if (auto val = config_file_tbl["session_settings"]["base"].value<std::string>())
             {
                 if (*val == "default")               cfg->session_settings = lt::default_settings();
@@ -238,39 +743,360 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
             if (auto session_settings_tbl = config_file_tbl["session_settings"].as_table())
                 ApplySettings(*session_settings_tbl, cfg->session_settings);
 
+            if (auto const* profiles_tbl = config_file_tbl["session_profiles"].as_table())
+            {
+                for (auto const& [key, value] : *profiles_tbl)
+                {
+                    auto const* profile_tbl = value.as_table();
+
+                    if (profile_tbl == nullptr)
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Session profile '" << key << "' is not a table";
+                        continue;
+                    }
+
+                    // Only the settings in the table, which are applied over the others.
+                    lt::settings_pack profile;
+                    ApplySettings(*profile_tbl, profile);
+
+                    cfg->session_profiles.insert({ key.data(), std::move(profile) });
+                }
+            }
+
+            if (auto const* bounds_tbl = config_file_tbl["settings_tuner"]["bounds"].as_table())
+            {
+                std::map<std::string, std::pair<int, int>> bounds;
+
+                for (auto const& [key, value] : *bounds_tbl)
+                {
+                    auto const* range = value.as_array();
+
+                    if (range != nullptr && range->size() == 2 && range->get(0)->value<int>() && range->get(1)->value<int>())
+                    {
+                        bounds.insert({ key.data(), { *range->get(0)->value<int>(), *range->get(1)->value<int>() } });
+                    }
+                    else
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Tuner bounds for '" << key << "' are not a [min, max] pair";
+                    }
+                }
+
+                cfg->settings_tuner_bounds = std::move(bounds);
+            }
+
+            if (auto val = config_file_tbl["settings_tuner"]["enabled"].value<bool>())
+                cfg->settings_tuner_enabled = *val;
+
+            if (auto val = config_file_tbl["settings_tuner"]["interval"].value<int>())
+                cfg->settings_tuner_interval = *val;
+
+            if (auto val = config_file_tbl["settings_tuner"]["max_cpu"].value<double>())
+                cfg->settings_tuner_max_cpu = *val;
+
+            if (auto val = config_file_tbl["settings_tuner"]["step"].value<double>())
+                cfg->settings_tuner_step = *val;
+
+            if (auto val = config_file_tbl["settings_tuner"]["sustain"].value<int>())
+                cfg->settings_tuner_sustain = *val;
+
+            if (auto val = config_file_tbl["shards"]["count"].value<int>())
+                cfg->shards = *val;
+
+            if (auto const interfaces_val = config_file_tbl["shards"]["listen_interfaces"].as_array())
+            {
+                for (auto const& interface_item : *interfaces_val)
+                {
+                    if (auto const interface_value = interface_item.value<std::string>())
+                    {
+                        cfg->shards_listen_interfaces.push_back(*interface_value);
+                    }
+                }
+            }
+
+            if (auto const* presets_tbl = config_file_tbl["shards"]["presets"].as_table())
+            {
+                for (auto const [key, value] : *presets_tbl)
+                {
+                    if (auto shard = value.value<int>())
+                    {
+                        cfg->shards_presets.insert({ key.data(), *shard });
+                    }
+                }
+            }
+
+            if (auto val = config_file_tbl["simulation"]["finish_rate"].value<int>())
+                cfg->simulation_finish_rate = *val;
+
+            if (auto val = config_file_tbl["simulation"]["torrents"].value<int>())
+                cfg->simulation_torrents = *val;
+
+            if (auto val = config_file_tbl["simulation"]["update_rate"].value<int>())
+                cfg->simulation_update_rate = *val;
+
+            if (auto val = config_file_tbl["sqlite"]["busy_timeout"].value<int>())
+                cfg->db_pragmas.busy_timeout = *val;
+
+            if (auto val = config_file_tbl["sqlite"]["cache_size"].value<int>())
+                cfg->db_pragmas.cache_size = *val;
+
+            if (auto val = config_file_tbl["sqlite"]["journal_mode"].value<std::string>())
+                cfg->db_pragmas.journal_mode = *val;
+
+            if (auto val = config_file_tbl["sqlite"]["mmap_size"].value<int64_t>())
+                cfg->db_pragmas.mmap_size = *val;
+
+            if (auto val = config_file_tbl["sqlite"]["readers"].value<int>())
+                cfg->db_readers = *val;
+
+            if (auto val = config_file_tbl["sqlite"]["synchronous"].value<std::string>())
+                cfg->db_pragmas.synchronous = *val;
+
+            if (auto val = config_file_tbl["sort_indexes"].value<bool>())
+                cfg->sort_indexes = *val;
+
             if (auto val = config_file_tbl["state_dir"].value<std::string>())
                 cfg->state_dir = *val;
 
+            if (auto const metrics_val = config_file_tbl["stats_history"]["metrics"].as_array())
+            {
+                std::vector<std::string> metrics;
+
+                for (auto const& metric_item : *metrics_val)
+                {
+                    if (auto const metric_value = metric_item.value<std::string>())
+                    {
+                        metrics.push_back(*metric_value);
+                    }
+                }
+
+                cfg->stats_history_metrics = std::move(metrics);
+            }
+
+            if (auto val = config_file_tbl["state_snapshot"]["file"].value<std::string>())
+                cfg->state_snapshot_file = *val;
+
+            if (auto val = config_file_tbl["state_snapshot"]["interval"].value<int>())
+                cfg->state_snapshot_interval = *val;
+
+            if (auto val = config_file_tbl["status_snapshot"]["path"].value<std::string>())
+                cfg->status_snapshot_path = *val;
+
+            if (auto val = config_file_tbl["timer"]["dht_state"].value<int>())
+                cfg->timer_dht_state = *val;
+
             if (auto val = config_file_tbl["timer"]["dht_stats"].value<int>())
                 cfg->timer_dht_stats = *val;
 
+            if (auto val = config_file_tbl["timer"]["dht_stats_idle"].value<int>())
+                cfg->timer_dht_stats_idle = *val;
+
+            if (auto val = config_file_tbl["timer"]["resume_data"].value<int>())
+                cfg->timer_resume_data = *val;
+
             if (auto val = config_file_tbl["timer"]["session_stats"].value<int>())
                 cfg->timer_session_stats = *val;
 
+            if (auto val = config_file_tbl["timer"]["session_stats_idle"].value<int>())
+                cfg->timer_session_stats_idle = *val;
+
             if (auto val = config_file_tbl["timer"]["torrent_updates"].value<int>())
                 cfg->timer_torrent_updates = *val;
 
+            if (auto val = config_file_tbl["timer"]["torrent_updates_idle"].value<int>())
+                cfg->timer_torrent_updates_idle = *val;
+
+            if (auto val = config_file_tbl["torrent_costs"]["capacity"].value<int>())
+                cfg->torrent_costs_capacity = *val;
+
+            if (auto val = config_file_tbl["torrent_costs"]["enabled"].value<bool>())
+                cfg->torrent_costs_enabled = *val;
+
+            if (auto val = config_file_tbl["torrent_costs"]["slots"].value<int>())
+                cfg->torrent_costs_slots = *val;
+
+            if (auto val = config_file_tbl["torrent_costs"]["window"].value<int>())
+                cfg->torrent_costs_window = *val;
+
+            if (auto val = config_file_tbl["torrent_counters"]["enabled"].value<bool>())
+                cfg->torrent_counters_enabled = *val;
+
+            if (auto val = config_file_tbl["torrent_counters"]["interval"].value<int>())
+                cfg->torrent_counters_interval = *val;
+
+            if (auto val = config_file_tbl["torrent_files"]["cache_size"].value<int>())
+                cfg->torrent_files_cache_size = *val;
+
+            if (auto val = config_file_tbl["torrent_files"]["max_size"].value<int>())
+                cfg->torrent_files_max_size = *val;
+
+            if (auto val = config_file_tbl["torrent_history"]["enabled"].value<bool>())
+                cfg->torrent_history_enabled = *val;
+
+            if (auto val = config_file_tbl["torrent_history"]["flush_interval"].value<int>())
+                cfg->torrent_history_flush_interval = *val;
+
+            if (auto val = config_file_tbl["torrent_rates"]["half_life"].value<int>())
+                cfg->torrent_rates_half_life = *val;
+
+            if (auto val = config_file_tbl["tracing"]["endpoint"].value<std::string>())
+                cfg->tracing_endpoint = *val;
+
+            if (auto val = config_file_tbl["tracing"]["sample_rate"].value<double>())
+                cfg->tracing_sample_rate = *val;
+
+            if (auto val = config_file_tbl["tracker_announces"]["burst"].value<int>())
+                cfg->tracker_announces_burst = *val;
+
+            if (auto val = config_file_tbl["tracker_announces"]["enabled"].value<bool>())
+                cfg->tracker_announces_enabled = *val;
+
+            if (auto val = config_file_tbl["tracker_announces"]["max_queued"].value<int>())
+                cfg->tracker_announces_max_queued = *val;
+
+            if (auto val = config_file_tbl["tracker_announces"]["rate"].value<double>())
+                cfg->tracker_announces_rate = *val;
+
+            if (auto val = config_file_tbl["tracker_registry"]["enabled"].value<bool>())
+                cfg->tracker_registry_enabled = *val;
+
+            if (auto const* views_tbl = config_file_tbl["views"].as_table())
+            {
+                for (auto const [key,value] : *views_tbl)
+                {
+                    if (auto const query = value.value<std::string>())
+                    {
+                        cfg->views.insert({ key.data(), *query });
+                    }
+                    else
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "View '" << key << "' is not a string";
+                    }
+                }
+            }
+
+            if (auto const* feeds_tbl = config_file_tbl["feeds"].as_table())
+            {
+                for (auto const [key,value] : *feeds_tbl)
+                {
+                    if (!value.is_table())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Feed '" << key << "' is not a TOML table";
+                        continue;
+                    }
+
+                    const toml::table value_tbl = *value.as_table();
+                    const auto url = value_tbl["url"].value<std::string>();
+
+                    if (!url.has_value())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Feed '" << key << "' has no url";
+                        continue;
+                    }
+
+                    Feed feed = {};
+                    feed.url = *url;
+
+                    if (auto val = value_tbl["filter"].value<std::string>())
+                        feed.filter = *val;
+
+                    if (auto val = value_tbl["interval"].value<int>())
+                        feed.interval = *val;
+
+                    if (auto val = value_tbl["preset"].value<std::string>())
+                        feed.preset = *val;
+
+                    cfg->feeds.insert({ key.data(), std::move(feed) });
+                }
+            }
+
+            if (auto const* dirs_tbl = config_file_tbl["watch"]["directories"].as_table())
+            {
+                for (auto const [key,value] : *dirs_tbl)
+                {
+                    if (!value.is_table())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Watch directory '" << key << "' is not a TOML table";
+                        continue;
+                    }
+
+                    const toml::table value_tbl = *value.as_table();
+                    const auto path = value_tbl["path"].value<std::string>();
+
+                    if (!path.has_value())
+                    {
+                        BOOST_LOG_TRIVIAL(warning) << "Watch directory '" << key << "' has no path";
+                        continue;
+                    }
+
+                    WatchDirectory dir = {};
+                    dir.path = *path;
+
+                    if (auto val = value_tbl["move_to"].value<std::string>())
+                        dir.move_to = *val;
+
+                    if (auto val = value_tbl["preset"].value<std::string>())
+                        dir.preset = *val;
+
+                    cfg->watch_directories.insert({ key.data(), std::move(dir) });
+                }
+            }
+
+            if (auto val = config_file_tbl["watch"]["interval"].value<int>())
+                cfg->watch_interval = *val;
+
             if (auto val = config_file_tbl["workflow_dir"].value<std::string>())
                 cfg->workflow_dir = *val;
+
+            if (auto val = config_file_tbl["workflows"]["max_parallel_steps"].value<int>())
+                cfg->workflow_max_parallel_steps = *val;
+
+            if (auto val = config_file_tbl["workflows"]["max_queued"].value<int>())
+                cfg->workflow_max_queued = *val;
+
+            if (auto val = config_file_tbl["workflows"]["max_running"].value<int>())
+                cfg->workflow_max_running = *val;
         }
         catch (const toml::parse_error& err)
         {
             BOOST_LOG_TRIVIAL(error) << "Failed to parse config file '" << cfg->config_file.value() << "': " << err;
+
+            if (strict)
+            {
+                throw std::runtime_error("Failed to parse config file");
+            }
         }
     }
 
     if (cmd.count("db"))                    cfg->db_file               = cmd["db"].as<std::string>();
     if (cmd.count("http-base-path"))        cfg->http_base_path        = cmd["http-base-path"].as<std::string>();
+    if (cmd.count("http-debug-enabled"))
+    {
+        cfg->http_debug_enabled = cmd["http-debug-enabled"].as<bool>();
+    }
     if (cmd.count("http-host"))             cfg->http_host             = cmd["http-host"].as<std::string>();
     if (cmd.count("http-metrics-enabled"))
     {
         cfg->http_metrics_enabled = cmd["http-metrics-enabled"].as<bool>();
     }
     if (cmd.count("http-port"))             cfg->http_port             = cmd["http-port"].as<uint16_t>();
+    if (cmd.count("http-tcp-enabled"))
+    {
+        cfg->http_tcp_enabled = cmd["http-tcp-enabled"].as<bool>();
+    }
+    if (cmd.count("http-threads"))          cfg->http_threads          = cmd["http-threads"].as<int>();
+    if (cmd.count("http-unix-socket"))      cfg->http_unix_socket      = cmd["http-unix-socket"].as<std::string>();
     if (cmd.count("http-webui-enabled"))
     {
         cfg->http_webui_enabled = cmd["http-webui-enabled"].as<bool>();
     }
+    if (cmd.count("metrics-max-labels"))    cfg->metrics_max_labels    = cmd["metrics-max-labels"].as<int>();
+    if (cmd.count("rpc-coalesce-ttl"))      cfg->rpc_coalesce_ttl      = cmd["rpc-coalesce-ttl"].as<int>();
+    if (cmd.count("rpc-max-concurrent"))    cfg->rpc_max_concurrent    = cmd["rpc-max-concurrent"].as<int>();
+    if (cmd.count("rpc-max-per-client"))    cfg->rpc_max_per_client    = cmd["rpc-max-per-client"].as<int>();
+    if (cmd.count("rpc-max-queued"))        cfg->rpc_max_queued        = cmd["rpc-max-queued"].as<int>();
+    if (cmd.count("rpc-queue-budget"))      cfg->rpc_queue_budget      = cmd["rpc-queue-budget"].as<int>();
+    if (cmd.count("rpc-worker-queue-size")) cfg->rpc_worker_queue_size = cmd["rpc-worker-queue-size"].as<int>();
+    if (cmd.count("rpc-worker-threads"))    cfg->rpc_worker_threads    = cmd["rpc-worker-threads"].as<int>();
     if (cmd.count("secret-key"))            cfg->secret_key            = cmd["secret-key"].as<std::string>();
     if (cmd.count("session-settings-base"))
     {
@@ -280,10 +1106,16 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
         if (val == "high_performance_seed") cfg->session_settings = lt::high_performance_seed();
         if (val == "min_memory_usage")      cfg->session_settings = lt::min_memory_usage();
     }
+    if (cmd.count("simulation-torrents"))   cfg->simulation_torrents   = cmd["simulation-torrents"].as<int>();
     if (cmd.count("state-dir"))             cfg->state_dir             = cmd["state-dir"].as<std::string>();
-    if (cmd.count("timer-dht-stats"))       cfg->timer_dht_stats       = cmd["timer-dht-stats"].as<int>();
-    if (cmd.count("timer-session-stats"))   cfg->timer_session_stats   = cmd["timer-session-stats"].as<pid_t>();
-    if (cmd.count("timer-torrent-updates")) cfg->timer_torrent_updates = cmd["timer-torrent-updates"].as<pid_t>();
+    if (cmd.count("timer-dht-state"))            cfg->timer_dht_state            = cmd["timer-dht-state"].as<int>();
+    if (cmd.count("timer-dht-stats"))            cfg->timer_dht_stats            = cmd["timer-dht-stats"].as<int>();
+    if (cmd.count("timer-dht-stats-idle"))       cfg->timer_dht_stats_idle       = cmd["timer-dht-stats-idle"].as<int>();
+    if (cmd.count("timer-resume-data"))          cfg->timer_resume_data          = cmd["timer-resume-data"].as<int>();
+    if (cmd.count("timer-session-stats"))        cfg->timer_session_stats        = cmd["timer-session-stats"].as<pid_t>();
+    if (cmd.count("timer-session-stats-idle"))   cfg->timer_session_stats_idle   = cmd["timer-session-stats-idle"].as<int>();
+    if (cmd.count("timer-torrent-updates"))      cfg->timer_torrent_updates      = cmd["timer-torrent-updates"].as<pid_t>();
+    if (cmd.count("timer-torrent-updates-idle")) cfg->timer_torrent_updates_idle = cmd["timer-torrent-updates-idle"].as<int>();
     if (cmd.count("workflow-dir"))          cfg->workflow_dir          = cmd["workflow-dir"].as<std::string>();
 
     // If no db_file is set, default to a file in state_dir.
@@ -292,36 +1124,60 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
         cfg->db_file = cfg->state_dir.value_or(fs::current_path()) / "porla.sqlite";
     }
 
-    if (sqlite3_open(cfg->db_file.value_or("porla.sqlite").c_str(), &cfg->db) != SQLITE_OK)
+    if (cfg->workflow_dir.has_value())
     {
-        BOOST_LOG_TRIVIAL(fatal) << "Failed to open SQLite connection: " << sqlite3_errmsg(cfg->db);
-        throw std::runtime_error("Failed to open SQLite connection");
+        for (const auto& file : fs::directory_iterator(cfg->workflow_dir.value()))
+        {
+            if (!file.is_regular_file()) continue;
+            cfg->workflow_files.emplace_back(file.path());
+        }
     }
 
-    if (sqlite3_exec(cfg->db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr) != SQLITE_OK)
-    {
-        BOOST_LOG_TRIVIAL(fatal) << "Failed to enable WAL journal mode: " << sqlite3_errmsg(cfg->db);
-        throw std::runtime_error("Failed to enable WAL journal mode");
-    }
+    return cfg;
+}
+
+std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map& cmd, bool read_only)
+{
+    auto cfg = Parse(cmd, false);
 
-    if (!porla::Data::Migrate(cfg->db))
+    const std::string db_file = cfg->db_file.value_or("porla.sqlite");
+
+    if (read_only)
     {
-        BOOST_LOG_TRIVIAL(error) << "Failed to run migrations";
-        throw std::runtime_error("Failed to apply migrations");
+        OpenReadOnly(*cfg, db_file);
     }
+    else
+    {
+        // Taken before opening, so a second daemon never gets to migrate the database.
+        cfg->db_lock = std::make_unique<porla::Data::InstanceLock>(db_file);
 
-    porla::Data::Models::SessionSettings::Apply(cfg->db, cfg->session_settings);
+        if (sqlite3_open(db_file.c_str(), &cfg->db) != SQLITE_OK)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "Failed to open SQLite connection: " << sqlite3_errmsg(cfg->db);
+            throw std::runtime_error("Failed to open SQLite connection");
+        }
 
-    // Apply static libtorrent settings here. These are always set after all other settings from
-    // the config are applied, and cannot be overwritten by it.
-    lt::alert_category_t alerts =
-        lt::alert::status_notification
-        | lt::alert::storage_notification
-        | lt::alert::tracker_notification;
+        if (!porla::Data::ApplyPragmas(cfg->db, cfg->db_pragmas))
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "Failed to apply SQLite settings";
+            throw std::runtime_error("Failed to apply SQLite settings");
+        }
 
-    cfg->session_settings.set_int(lt::settings_pack::alert_mask, alerts);
-    cfg->session_settings.set_str(lt::settings_pack::peer_fingerprint, lt::generate_fingerprint("PO", 0, 1));
-    cfg->session_settings.set_str(lt::settings_pack::user_agent, "porla/1.0");
+        if (!porla::Utils::Phases::Startup().Measure("config.migrations", [&cfg]() { return porla::Data::Migrate(cfg->db); }))
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to run migrations";
+            throw std::runtime_error("Failed to apply migrations");
+        }
+    }
+
+    if (cfg->db != nullptr)
+    {
+        porla::Utils::Phases::Startup().Measure(
+            "config.session_settings",
+            [&cfg]() { porla::Data::Models::SessionSettings::Apply(cfg->db, cfg->session_settings); });
+    }
+
+    ApplyStaticSettings(cfg->session_settings);
 
     // If we get here without having a secret key, we must generate one. Also log a warning because
     // if the secret key changes, JWT's will not work if restarting.
@@ -334,27 +1190,40 @@ std::unique_ptr<Config> Config::Load(const boost::program_options::variables_map
         cfg->secret_key = porla::Utils::SecretKey::New();
     }
 
-    if (cfg->workflow_dir.has_value())
-    {
-        for (const auto& file : fs::directory_iterator(cfg->workflow_dir.value()))
-        {
-            if (!file.is_regular_file()) continue;
-            cfg->workflow_files.emplace_back(file.path());
-        }
-    }
-
     return std::move(cfg);
 }
 
+std::unique_ptr<Config> Config::Reload(const boost::program_options::variables_map& cmd, sqlite3* db)
+{
+    auto cfg = Parse(cmd, true);
+
+    porla::Data::Models::SessionSettings::Apply(db, cfg->session_settings);
+    ApplyStaticSettings(cfg->session_settings);
+
+    return cfg;
+}
+
 Config::~Config()
 {
-    BOOST_LOG_TRIVIAL(debug) << "Vacuuming database";
+    // Reloaded configs do not have a database of their own.
+    if (db == nullptr)
+    {
+        return;
+    }
 
-    if (sqlite3_exec(db, "VACUUM;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    // Read-only connections belong to tools, which leave the vacuuming to the daemon.
+    if (sqlite3_db_readonly(db, "main") != 1)
     {
-        BOOST_LOG_TRIVIAL(error) << "Failed to vacuum database: " << sqlite3_errmsg(db);
+        BOOST_LOG_TRIVIAL(debug) << "Vacuuming database";
+
+        if (sqlite3_exec(db, "VACUUM;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to vacuum database: " << sqlite3_errmsg(db);
+        }
     }
 
+    porla::Data::Statement::ClearCache(db);
+
     if (sqlite3_close(db) != SQLITE_OK)
     {
         BOOST_LOG_TRIVIAL(error) << "Failed to close SQLite connection: " << sqlite3_errmsg(db);
@@ -409,3 +1278,38 @@ static void ApplySettings(const toml::table& tbl, lt::settings_pack& settings)
         }
     }
 }
+
+// Static libtorrent settings, always set after all other settings from the config are
+// applied, and cannot be overwritten by it. The alert mask is up to the session, which
+// knows what it handles.
+static void ApplyStaticSettings(lt::settings_pack& settings)
+{
+    settings.set_str(lt::settings_pack::peer_fingerprint, lt::generate_fingerprint("PO", 0, 1));
+    settings.set_str(lt::settings_pack::user_agent, "porla/1.0");
+}
+
+// Leaves cfg without a database if it cannot be read, which only the tools that need one
+// complain about. A database not migrated yet is not read either, since the tables may
+// not be what the tools expect, and migrating is up to the daemon.
+static void OpenReadOnly(Config& cfg, const std::string& db_file)
+{
+    if (sqlite3_open_v2(db_file.c_str(), &cfg.db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(debug) << "Failed to open " << db_file << " for reading: " << sqlite3_errmsg(cfg.db);
+        sqlite3_close(cfg.db);
+        cfg.db = nullptr;
+        return;
+    }
+
+    // The journal mode and synchronous setting belong to the daemon.
+    auto pragmas = cfg.db_pragmas;
+    pragmas.journal_mode.reset();
+    pragmas.synchronous.reset();
+
+    if (!porla::Data::ApplyPragmas(cfg.db, pragmas) || !porla::Data::IsMigrated(cfg.db))
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Database " << db_file << " is not set up, start porla once to migrate it";
+        sqlite3_close(cfg.db);
+        cfg.db = nullptr;
+    }
+}
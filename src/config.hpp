@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -13,6 +14,13 @@
 #include <sqlite3.h>
 #include <toml++/toml.h>
 
+#include "clusternode.hpp"
+#include "data/instancelock.hpp"
+#include "data/pragmas.hpp"
+#include "peerclass.hpp"
+#include "savepathquota.hpp"
+#include "seedinggoal.hpp"
+
 typedef std::function<std::shared_ptr<libtorrent::torrent_plugin>(libtorrent:: torrent_handle const&, libtorrent::client_data_t)> lt_plugin;
 
 namespace fs = std::filesystem;
@@ -22,6 +30,16 @@ namespace porla
     class Config
     {
     public:
+        struct Feed
+        {
+            std::string                url;
+            // Seconds between polls.
+            int                        interval = 900;
+            // PQL the items are matched with, tested against their title as the name.
+            std::optional<std::string> filter;
+            std::optional<std::string> preset;
+        };
+
         struct Preset
         {
             std::optional<std::string>                category;
@@ -34,28 +52,175 @@ namespace porla
             std::optional<int>                        upload_limit;
         };
 
+        struct WatchDirectory
+        {
+            // Added torrent files are moved here, or deleted when it is not set.
+            std::optional<fs::path>    move_to;
+            fs::path                   path;
+            std::optional<std::string> preset;
+        };
+
+        std::optional<int>                    alert_queue_max;
+        std::optional<bool>                   alert_thread;
+        std::optional<int>                    auth_hash_memlimit;
+        std::optional<int>                    auth_hash_memory_budget;
+        std::optional<int>                    auth_hash_opslimit;
+        std::optional<int>                    auth_hash_queue_size;
+        std::optional<int>                    auth_hash_timeout;
+        std::optional<std::string>            changes_dir;
+        std::optional<bool>                   changes_enabled;
+        std::optional<int>                    changes_file_size;
+        std::optional<int>                    changes_max_files;
+        std::optional<int>                    changes_retain;
+        std::optional<int>                    changes_snapshot_interval;
+        std::optional<int>                    cluster_cache_ttl;
+        std::optional<std::string>            cpu_http;
+        std::optional<std::string>            cpu_io;
+        std::optional<std::string>            cpu_libtorrent;
+        std::optional<bool>                   cpu_numa_local;
+        std::optional<std::string>            cpu_workers;
+        std::vector<ClusterNode>              cluster_nodes;
+        std::optional<int>                    cluster_poll_interval;
+        std::optional<bool>                   columnar_snapshot;
         std::optional<std::string>            config_file;
-        sqlite3*                              db;
+        sqlite3*                              db = nullptr;
         std::optional<std::string>            db_file;
+        // Only taken by the daemon, and let go of after the database is closed.
+        std::unique_ptr<Data::InstanceLock>   db_lock;
+        porla::Data::Pragmas                  db_pragmas;
+        std::optional<int>                    db_readers;
+        std::optional<std::string>            disk_io;
+        std::optional<int>                    disk_space_critical;
+        std::optional<int>                    disk_space_interval;
+        std::optional<int>                    disk_space_low;
+        std::optional<bool>                   disk_space_pause;
+        std::map<std::string, Feed>           feeds;
         std::optional<bool>                   http_auth_enabled;
         std::optional<std::string>            http_base_path;
+        std::optional<int>                    http_compression_level;
+        std::optional<int>                    http_compression_min_size;
+        std::optional<bool>                   http_debug_enabled;
         std::optional<std::string>            http_host;
+        std::optional<int>                    http_idle_timeout;
+        std::optional<int>                    http_max_connections;
+        std::optional<int>                    http_max_event_subscribers;
         std::optional<bool>                   http_metrics_enabled;
         std::optional<uint16_t>               http_port;
+        std::optional<bool>                   http_tcp_enabled;
+        std::optional<int>                    http_threads;
+        std::optional<std::string>            http_unix_socket;
         std::optional<bool>                   http_webui_enabled;
 
+        std::optional<int>                    magnets_concurrency;
+        std::optional<int>                    magnets_retry_delay;
+        std::optional<int>                    magnets_timeout;
+        std::optional<int>                    metadata_cache_size;
+        std::vector<std::string>              metadata_indexes;
+
+        std::optional<int>                    metrics_max_labels;
+        std::optional<int>                    move_concurrency;
+        std::optional<int>                    parking_after;
+
+        std::optional<bool>                   peer_aggregates_enabled;
+        std::optional<int>                    peer_aggregates_interval;
+        std::optional<int>                    peer_aggregates_top;
+        std::optional<int>                    peer_aggregates_torrents_per_tick;
+        std::map<std::string, PeerClass>      peer_classes;
+        std::optional<int>                    persistence_batch_size;
+        std::optional<bool>                   persistence_compress;
+        std::optional<int>                    persistence_flush_interval;
+        std::vector<SavePathQuota>            quotas;
+        std::optional<int>                    recheck_concurrency;
+        std::optional<std::string>            release_boost_curve;
+        std::optional<bool>                   release_boost_enabled;
+        std::optional<bool>                   release_boost_finished;
+        std::optional<int>                    release_boost_max_priority;
+        std::optional<int>                    release_boost_tiers;
+        std::optional<int>                    release_boost_unchoke_tiers;
+        std::optional<int>                    release_boost_window;
         std::map<std::string, Preset>         presets;
+        std::optional<int>                    rpc_coalesce_ttl;
+        std::optional<int>                    rpc_max_concurrent;
+        std::optional<int>                    rpc_max_per_client;
+        std::optional<int>                    rpc_max_queued;
+        std::optional<int>                    rpc_queue_budget;
+        std::optional<int>                    rpc_worker_queue_size;
+        std::optional<int>                    rpc_worker_threads;
         std::string                           secret_key;
+        std::optional<double>                 seed_scheduler_demand_weight;
+        std::optional<bool>                   seed_scheduler_enabled;
+        std::optional<int>                    seed_scheduler_interval;
+        std::optional<int>                    seed_scheduler_max_changes;
+        std::optional<double>                 seed_scheduler_seeding_time_weight;
+        std::optional<int>                    seed_scheduler_slots;
+        std::optional<double>                 seed_scheduler_upload_weight;
+        std::optional<int>                    seed_scheduler_upload_window;
+        std::vector<SeedingGoal>              seeding_goals;
+        std::optional<int>                    seeding_goals_interval;
         std::optional<std::vector<lt_plugin>> session_extensions;
+        std::map<std::string, libtorrent::settings_pack> session_profiles;
         libtorrent::settings_pack             session_settings;
+        std::optional<std::map<std::string, std::pair<int, int>>> settings_tuner_bounds;
+        std::optional<bool>                   settings_tuner_enabled;
+        std::optional<int>                    settings_tuner_interval;
+        std::optional<double>                 settings_tuner_max_cpu;
+        std::optional<double>                 settings_tuner_step;
+        std::optional<int>                    settings_tuner_sustain;
+        std::optional<int>                    shards;
+        std::vector<std::string>              shards_listen_interfaces;
+        std::map<std::string, int>            shards_presets;
+        std::optional<int>                    simulation_finish_rate;
+        std::optional<int>                    simulation_torrents;
+        std::optional<int>                    simulation_update_rate;
+        std::optional<bool>                   sort_indexes;
         std::optional<fs::path>               state_dir;
+        std::optional<fs::path>               state_snapshot_file;
+        std::optional<int>                    state_snapshot_interval;
+        std::optional<std::vector<std::string>> stats_history_metrics;
+        std::optional<fs::path>               status_snapshot_path;
+        std::optional<int>                    timer_dht_state;
         std::optional<int>                    timer_dht_stats;
+        std::optional<int>                    timer_dht_stats_idle;
+        std::optional<int>                    timer_resume_data;
         std::optional<int>                    timer_session_stats;
+        std::optional<int>                    timer_session_stats_idle;
         std::optional<int>                    timer_torrent_updates;
+        std::optional<int>                    timer_torrent_updates_idle;
+        std::optional<int>                    torrent_costs_capacity;
+        std::optional<bool>                   torrent_costs_enabled;
+        std::optional<int>                    torrent_costs_slots;
+        std::optional<int>                    torrent_costs_window;
+        std::optional<bool>                   torrent_counters_enabled;
+        std::optional<int>                    torrent_counters_interval;
+        std::optional<int>                    torrent_files_cache_size;
+        std::optional<int>                    torrent_files_max_size;
+        std::optional<bool>                   torrent_history_enabled;
+        std::optional<int>                    torrent_history_flush_interval;
+        std::optional<int>                    torrent_rates_half_life;
+        std::optional<std::string>            tracing_endpoint;
+        std::optional<double>                 tracing_sample_rate;
+        std::optional<int>                    tracker_announces_burst;
+        std::optional<bool>                   tracker_announces_enabled;
+        std::optional<int>                    tracker_announces_max_queued;
+        std::optional<double>                 tracker_announces_rate;
+        std::optional<bool>                   tracker_registry_enabled;
+        std::map<std::string, std::string>    views;
+        std::map<std::string, WatchDirectory> watch_directories;
+        std::optional<int>                    watch_interval;
         std::optional<fs::path>               workflow_dir;
+        std::optional<int>                    workflow_max_parallel_steps;
+        std::optional<int>                    workflow_max_queued;
+        std::optional<int>                    workflow_max_running;
         std::vector<fs::path>                 workflow_files;
 
-        static std::unique_ptr<Config> Load(const boost::program_options::variables_map& cmd);
+        // Opens the database and migrates it. A read-only config, for tools running next
+        // to the daemon, opens it without writing anything and without the instance lock,
+        // and has no database if it is missing or not migrated yet.
+        static std::unique_ptr<Config> Load(const boost::program_options::variables_map& cmd, bool read_only = false);
+        // Reads the config file and command line again for a running instance, without
+        // opening a database. Stored session settings in db are applied like on startup.
+        // Throws if the config file does not parse, instead of going with the defaults.
+        static std::unique_ptr<Config> Reload(const boost::program_options::variables_map& cmd, sqlite3* db);
 
         ~Config();
 
@@ -66,5 +231,7 @@ namespace porla
 
     private:
         explicit Config() = default;
+
+        static std::unique_ptr<Config> Parse(const boost::program_options::variables_map& cmd, bool strict);
     };
 }
@@ -0,0 +1,122 @@
+#include "configreloader.hpp"
+
+#include <cstring>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/settings_pack.hpp>
+
+#include "config.hpp"
+#include "methods/presetslist.hpp"
+#include "responsecache.hpp"
+#include "session.hpp"
+#include "workflows/executor.hpp"
+#include "workflows/workflow.hpp"
+
+using porla::ConfigReloader;
+
+ConfigReloader::ConfigReloader(ConfigReloaderOptions options)
+    : m_options(options)
+{
+}
+
+ConfigReloader::Result ConfigReloader::Reload()
+{
+    BOOST_LOG_TRIVIAL(info) << "Reloading configuration";
+
+    auto next = Config::Reload(m_options.cmd, m_options.config.db);
+
+    std::vector<std::shared_ptr<Workflows::Workflow>> workflows;
+
+    for (const auto& workflow_file : next->workflow_files)
+    {
+        workflows.push_back(Workflows::Workflow::LoadFromFile(workflow_file));
+    }
+
+    Result result{
+        .presets   = static_cast<int>(next->presets.size()),
+        .workflows = static_cast<int>(workflows.size())
+    };
+
+    // Only settings changed in the config since it was last read are applied, and only
+    // when the session does not already have them. Settings changed at runtime, such as
+    // by session.settings.update, are kept otherwise.
+    auto const  running  = m_options.session.Settings();
+    auto const& previous = m_options.config.session_settings;
+    auto const& wanted   = next->session_settings;
+
+    lt::settings_pack delta;
+
+    const auto diff = [&](int first, int last, auto get, auto set)
+    {
+        for (int i = first; i < last; i++)
+        {
+            const char* name = lt::name_for_setting(i);
+            if (strcmp(name, "") == 0 || !wanted.has_val(i)) continue;
+
+            auto const value = get(wanted, i);
+            if (value == get(previous, i) || value == get(running, i)) continue;
+
+            set(delta, i, value);
+            result.settings.emplace_back(name);
+        }
+    };
+
+    diff(
+        lt::settings_pack::bool_type_base,
+        lt::settings_pack::max_bool_setting_internal,
+        [](const lt::settings_pack& p, int i) { return p.get_bool(i); },
+        [](lt::settings_pack& p, int i, bool v) { p.set_bool(i, v); });
+
+    diff(
+        lt::settings_pack::int_type_base,
+        lt::settings_pack::max_int_setting_internal,
+        [](const lt::settings_pack& p, int i) { return p.get_int(i); },
+        [](lt::settings_pack& p, int i, int v) { p.set_int(i, v); });
+
+    diff(
+        lt::settings_pack::string_type_base,
+        lt::settings_pack::max_string_setting_internal,
+        [](const lt::settings_pack& p, int i) { return p.get_str(i); },
+        [](lt::settings_pack& p, int i, const std::string& v) { p.set_str(i, v); });
+
+    if (!result.settings.empty())
+    {
+        m_options.session.ApplySettings(delta);
+    }
+
+    m_options.session.SetTimers(ISession::Timers{
+        .dht_stats            = next->timer_dht_stats.value_or(5000),
+        .dht_stats_idle       = next->timer_dht_stats_idle.value_or(60000),
+        .resume_data          = next->timer_resume_data.value_or(300000),
+        .session_stats        = next->timer_session_stats.value_or(5000),
+        .session_stats_idle   = next->timer_session_stats_idle.value_or(30000),
+        .torrent_updates      = next->timer_torrent_updates.value_or(1000),
+        .torrent_updates_idle = next->timer_torrent_updates_idle.value_or(5000)
+    });
+
+    m_options.executor.SetWorkflows(std::move(workflows));
+
+    auto& config = m_options.config;
+
+    config.presets                    = std::move(next->presets);
+
+    if (m_options.cache != nullptr)
+    {
+        m_options.cache->Invalidate(Methods::PresetsList::Key);
+    }
+
+    config.session_settings           = std::move(next->session_settings);
+    config.timer_dht_stats            = next->timer_dht_stats;
+    config.timer_dht_stats_idle       = next->timer_dht_stats_idle;
+    config.timer_resume_data          = next->timer_resume_data;
+    config.timer_session_stats        = next->timer_session_stats;
+    config.timer_session_stats_idle   = next->timer_session_stats_idle;
+    config.timer_torrent_updates      = next->timer_torrent_updates;
+    config.timer_torrent_updates_idle = next->timer_torrent_updates_idle;
+    config.workflow_files             = std::move(next->workflow_files);
+
+    BOOST_LOG_TRIVIAL(info) << "Reloaded configuration with " << result.presets << " preset(s), "
+                            << result.workflows << " workflow(s) and " << result.settings.size() << " changed setting(s)";
+
+    return result;
+}
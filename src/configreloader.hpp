@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+namespace porla
+{
+    class Config;
+    class ISession;
+    class ResponseCache;
+}
+
+namespace porla::Workflows
+{
+    class Executor;
+}
+
+namespace porla
+{
+    struct ConfigReloaderOptions
+    {
+        const boost::program_options::variables_map& cmd;
+        Config&                                      config;
+        ISession&                                    session;
+        Workflows::Executor&                         executor;
+        // Cached responses built from the presets are invalidated with them, if set.
+        ResponseCache*                               cache = nullptr;
+    };
+
+    // Reads the config again and applies what can change while running: the session
+    // settings changed in it, presets, workflows and the session timers. Everything is read
+    // before anything is applied, so a broken config or workflow file leaves it all as it
+    // was. Reloads run on the io thread, where presets and workflows are used, so requests
+    // see either the old or the new ones. The rest of the config needs a restart.
+    class ConfigReloader
+    {
+    public:
+        struct Result
+        {
+            int                      presets;
+            // Names of the session settings applied.
+            std::vector<std::string> settings;
+            int                      workflows;
+        };
+
+        explicit ConfigReloader(ConfigReloaderOptions options);
+
+        ConfigReloader(const ConfigReloader&) = delete;
+
+        // Throws if the config or a workflow cannot be read.
+        Result Reload();
+
+    private:
+        ConfigReloaderOptions m_options;
+    };
+}
@@ -0,0 +1,218 @@
+#include "contentindex.hpp"
+
+#include <algorithm>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::ContentIndex;
+
+ContentIndex::ContentIndex(porla::ISession& session)
+    : m_session(session)
+{
+    const auto index = [this](const lt::torrent_status& ts)
+    {
+        if (m_entries.contains(ts.info_hashes))
+        {
+            return;
+        }
+
+        if (const auto ti = ts.torrent_file.lock())
+        {
+            Update(ts.info_hashes, ti->files());
+        }
+    };
+
+    for (auto const& [_, ts] : m_session.TorrentStatuses())
+    {
+        index(ts);
+    }
+
+    // Magnets get their metadata after being added, which the next state update shows.
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [index](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                if (ts.has_metadata) index(ts);
+            }
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded(index);
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [index](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents) index(ts);
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+}
+
+ContentIndex::~ContentIndex()
+{
+    m_stateUpdateConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+std::vector<ContentIndex::Match> ContentIndex::Find(const lt::file_storage& files) const
+{
+    std::map<lt::info_hash_t, Match> matches;
+
+    const auto match = [&matches](const lt::info_hash_t& hash) -> Match&
+    {
+        return matches.try_emplace(hash, Match{ .info_hash = hash, .files = 0, .bytes = 0, .same_size = false }).first->second;
+    };
+
+    std::int64_t total_size = 0;
+
+    for (const auto file : files.file_range())
+    {
+        if (files.pad_file_at(file))
+        {
+            continue;
+        }
+
+        const auto size = files.file_size(file);
+        total_size += size;
+
+        const auto found = m_files.find(Key(files.file_name(file), size));
+        if (found == m_files.end()) { continue; }
+
+        for (const auto& hash : found->second)
+        {
+            auto& m = match(hash);
+            m.files++;
+            m.bytes += size;
+        }
+    }
+
+    if (const auto found = m_sizes.find(total_size); found != m_sizes.end())
+    {
+        for (const auto& hash : found->second)
+        {
+            match(hash).same_size = true;
+        }
+    }
+
+    std::vector<Match> result;
+    result.reserve(matches.size());
+
+    for (auto& [_, m] : matches)
+    {
+        result.push_back(m);
+    }
+
+    std::sort(
+        result.begin(),
+        result.end(),
+        [](const Match& lhs, const Match& rhs)
+        {
+            if (lhs.bytes != rhs.bytes) return lhs.bytes > rhs.bytes;
+            if (lhs.same_size != rhs.same_size) return lhs.same_size;
+            return lhs.info_hash < rhs.info_hash;
+        });
+
+    return result;
+}
+
+porla::MemoryUsage ContentIndex::Memory() const
+{
+    MemoryUsage usage{ .objects = m_entries.size() };
+
+    for (const auto& [_, entry] : m_entries)
+    {
+        usage.bytes += sizeof(lt::info_hash_t) + sizeof(Entry) + entry.files.capacity() * sizeof(std::uint64_t);
+    }
+
+    for (const auto& [_, hashes] : m_files)
+    {
+        usage.bytes += sizeof(std::uint64_t) + sizeof(hashes) + hashes.capacity() * sizeof(lt::info_hash_t);
+    }
+
+    for (const auto& [_, hashes] : m_sizes)
+    {
+        usage.bytes += sizeof(std::int64_t) + sizeof(hashes) + hashes.capacity() * sizeof(lt::info_hash_t);
+    }
+
+    return usage;
+}
+
+void ContentIndex::Update(const lt::info_hash_t& hash, const lt::file_storage& files)
+{
+    Remove(hash);
+
+    Entry entry{ .total_size = 0 };
+    entry.files.reserve(files.num_files());
+
+    for (const auto file : files.file_range())
+    {
+        if (files.pad_file_at(file))
+        {
+            continue;
+        }
+
+        const auto size = files.file_size(file);
+        const auto key  = Key(files.file_name(file), size);
+
+        entry.files.push_back(key);
+        entry.total_size += size;
+
+        // The same file twice in one torrent counts once.
+        auto& hashes = m_files[key];
+        if (hashes.empty() || hashes.back() != hash) hashes.push_back(hash);
+    }
+
+    m_sizes[entry.total_size].push_back(hash);
+    m_entries.insert({ hash, std::move(entry) });
+}
+
+void ContentIndex::Remove(const lt::info_hash_t& hash)
+{
+    const auto entry = m_entries.find(hash);
+    if (entry == m_entries.end()) { return; }
+
+    for (const auto key : entry->second.files)
+    {
+        Erase(m_files, key, hash);
+    }
+
+    Erase(m_sizes, entry->second.total_size, hash);
+
+    m_entries.erase(entry);
+}
+
+// FNV-1a over the name and then the size. Collisions only add a candidate, which the
+// caller looks at before acting on it anyway.
+std::uint64_t ContentIndex::Key(std::string_view name, std::int64_t size)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+
+    const auto mix = [&hash](unsigned char byte)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+
+    for (const char c : name) mix(static_cast<unsigned char>(c));
+    for (int i = 0; i < 8; i++) mix(static_cast<unsigned char>(static_cast<std::uint64_t>(size) >> (i * 8)));
+
+    return hash;
+}
+
+template<typename TIndex, typename TKey>
+void ContentIndex::Erase(TIndex& index, const TKey& key, const lt::info_hash_t& hash)
+{
+    const auto it = index.find(key);
+    if (it == index.end()) { return; }
+
+    std::erase(it->second, hash);
+
+    if (it->second.empty())
+    {
+        index.erase(it);
+    }
+}
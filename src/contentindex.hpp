@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <libtorrent/file_storage.hpp>
+#include <libtorrent/info_hash.hpp>
+
+#include "memoryusage.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Indexes the files of every torrent with metadata by name and size, and the torrents by
+    // total size, so a torrent about to be added can be matched against content that is
+    // already there. Names are without their directories, since another torrent of the same
+    // content often puts them in a different one. Pad files are left out.
+    class ContentIndex
+    {
+    public:
+        struct Match
+        {
+            libtorrent::info_hash_t info_hash;
+            int                     files;
+            std::int64_t            bytes;
+            bool                    same_size;
+        };
+
+        explicit ContentIndex(ISession& session);
+        ContentIndex(const ContentIndex&) = delete;
+
+        ~ContentIndex();
+
+        // Torrents with files of the same name and size as any in the storage, or of the
+        // same total size, the most bytes in common first.
+        [[nodiscard]] std::vector<Match> Find(const libtorrent::file_storage& files) const;
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+        // Indexes a torrent, once it has metadata.
+        void Update(const libtorrent::info_hash_t& hash, const libtorrent::file_storage& files);
+        void Remove(const libtorrent::info_hash_t& hash);
+
+    private:
+        struct Entry
+        {
+            // Keys of the files, which may repeat.
+            std::vector<std::uint64_t> files;
+            std::int64_t               total_size;
+        };
+
+        static std::uint64_t Key(std::string_view name, std::int64_t size);
+
+        template<typename TIndex, typename TKey>
+        static void Erase(TIndex& index, const TKey& key, const libtorrent::info_hash_t& hash);
+
+        ISession& m_session;
+
+        std::map<libtorrent::info_hash_t, Entry> m_entries;
+        // Few torrents share a file, so these are short and searched linearly.
+        std::unordered_map<std::uint64_t, std::vector<libtorrent::info_hash_t>> m_files;
+        std::unordered_map<std::int64_t, std::vector<libtorrent::info_hash_t>> m_sizes;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
@@ -0,0 +1,187 @@
+#include "backup.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+#include <boost/log/trivial.hpp>
+#include <sqlite3.h>
+
+#include "pragmas.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Data::Backup;
+using porla::Data::BackupStatus;
+
+// Small steps keep each read short, and the pause between them leaves room for the
+// writers on a busy database.
+static constexpr int PagesPerStep = 256;
+static constexpr std::chrono::milliseconds StepDelay(5);
+
+Backup::Backup(std::string source)
+    : m_source(std::move(source))
+    , m_stopping(false)
+{
+}
+
+Backup::~Backup()
+{
+    m_stopping = true;
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+std::optional<std::string> Backup::Run(const std::string& source, const std::string& destination, const StepCallback& step)
+{
+    if (source.empty() || source == ":memory:")
+    {
+        return "The database is not stored in a file";
+    }
+
+    sqlite3* src = nullptr;
+
+    if (sqlite3_open_v2(source.c_str(), &src, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        std::string error = sqlite3_errmsg(src);
+        sqlite3_close(src);
+        return error;
+    }
+
+    sqlite3_busy_timeout(src, 5000);
+
+    // A read transaction held for the whole backup pins a WAL snapshot. Writers carry on,
+    // and the backup is not restarted by their commits. In other journal modes it would
+    // lock them out instead, so there the backup restarts when the database changes.
+    const bool snapshot = porla::Data::InWalMode(src)
+        && sqlite3_exec(src, "BEGIN; SELECT COUNT(*) FROM sqlite_master;", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    const auto partial = destination + ".tmp";
+    std::error_code ec;
+    fs::remove(partial, ec);
+
+    sqlite3* dst = nullptr;
+    std::optional<std::string> error;
+
+    if (sqlite3_open_v2(partial.c_str(), &dst, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK)
+    {
+        error = sqlite3_errmsg(dst);
+    }
+    else if (sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main"); backup == nullptr)
+    {
+        error = sqlite3_errmsg(dst);
+    }
+    else
+    {
+        while (true)
+        {
+            const int rc = sqlite3_backup_step(backup, PagesPerStep);
+
+            if (rc == SQLITE_DONE)
+            {
+                if (step) step(0, sqlite3_backup_pagecount(backup));
+                break;
+            }
+
+            if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED)
+            {
+                error = sqlite3_errstr(rc);
+                break;
+            }
+
+            if (step && !step(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup)))
+            {
+                error = "Backup cancelled";
+                break;
+            }
+
+            std::this_thread::sleep_for(StepDelay);
+        }
+
+        if (sqlite3_backup_finish(backup) != SQLITE_OK && !error.has_value())
+        {
+            error = sqlite3_errmsg(dst);
+        }
+    }
+
+    sqlite3_close(dst);
+
+    if (snapshot)
+    {
+        sqlite3_exec(src, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    sqlite3_close(src);
+
+    if (!error.has_value())
+    {
+        fs::rename(partial, destination, ec);
+        if (ec) error = ec.message();
+    }
+
+    if (error.has_value())
+    {
+        fs::remove(partial, ec);
+    }
+
+    return error;
+}
+
+bool Backup::Start(const std::string& destination)
+{
+    std::unique_lock lock(m_mtx);
+
+    if (m_status.state == BackupStatus::State::Running)
+    {
+        return false;
+    }
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    m_status             = BackupStatus();
+    m_status.state       = BackupStatus::State::Running;
+    m_status.destination = destination;
+
+    m_thread = std::thread(
+        [this, destination]()
+        {
+            BOOST_LOG_TRIVIAL(info) << "Backing up database to " << destination;
+
+            const auto error = Run(
+                m_source,
+                destination,
+                [this](int remaining, int total)
+                {
+                    std::unique_lock lock(m_mtx);
+                    m_status.pages_remaining = remaining;
+                    m_status.pages_total     = total;
+                    return !m_stopping.load();
+                });
+
+            if (error.has_value())
+            {
+                BOOST_LOG_TRIVIAL(error) << "Failed to back up database: " << *error;
+            }
+            else
+            {
+                BOOST_LOG_TRIVIAL(info) << "Database backed up to " << destination;
+            }
+
+            std::unique_lock lock(m_mtx);
+            m_status.state = error.has_value() ? BackupStatus::State::Failed : BackupStatus::State::Done;
+            m_status.error = error.value_or("");
+        });
+
+    return true;
+}
+
+BackupStatus Backup::Status()
+{
+    std::unique_lock lock(m_mtx);
+    return m_status;
+}
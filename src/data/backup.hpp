@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace porla::Data
+{
+    struct BackupStatus
+    {
+        enum class State
+        {
+            Idle,
+            Running,
+            Done,
+            Failed
+        };
+
+        State       state           = State::Idle;
+        std::string destination;
+        std::string error;
+        int         pages_remaining = 0;
+        int         pages_total     = 0;
+    };
+
+    // Copies a live database with the SQLite online backup API, a few pages at a time
+    // from a connection of its own. In WAL mode the copy reads from one snapshot, so it
+    // is consistent and never stalls the connections writing to the database. The copy
+    // is written next to the destination and renamed into place once complete.
+    class Backup
+    {
+    public:
+        explicit Backup(std::string source);
+        Backup(const Backup&) = delete;
+
+        ~Backup();
+
+        // Called after every step with the pages left and the total. Returning false
+        // cancels the backup.
+        typedef std::function<bool(int remaining, int total)> StepCallback;
+
+        // Runs a backup on the calling thread. Returns the error if it failed.
+        static std::optional<std::string> Run(
+            const std::string& source,
+            const std::string& destination,
+            const StepCallback& step = {});
+
+        // Starts a backup on a background thread. Returns false if one is already running.
+        bool Start(const std::string& destination);
+        BackupStatus Status();
+
+    private:
+        std::string m_source;
+        std::mutex m_mtx;
+        std::thread m_thread;
+        std::atomic_bool m_stopping;
+        BackupStatus m_status;
+    };
+}
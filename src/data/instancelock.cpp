@@ -0,0 +1,69 @@
+#include "instancelock.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <boost/log/trivial.hpp>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+using porla::Data::InstanceLock;
+
+InstanceLock::InstanceLock(const std::filesystem::path& db_file)
+    : m_fd(-1)
+{
+    if (db_file.empty() || db_file == ":memory:")
+    {
+        return;
+    }
+
+    const auto file = LockFile(db_file);
+
+    m_fd = open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (m_fd < 0)
+    {
+        throw std::runtime_error("Failed to open " + file.string() + ": " + strerror(errno));
+    }
+
+    if (flock(m_fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        const int err = errno;
+
+        close(m_fd);
+        m_fd = -1;
+
+        if (err == EWOULDBLOCK)
+        {
+            throw std::runtime_error("Another instance is using " + db_file.string());
+        }
+
+        throw std::runtime_error("Failed to lock " + file.string() + ": " + strerror(err));
+    }
+
+    // The pid is only there for whoever looks at the file, the lock is what counts.
+    const std::string pid = std::to_string(getpid()) + "\n";
+
+    if (ftruncate(m_fd, 0) != 0 || pwrite(m_fd, pid.data(), pid.size(), 0) != static_cast<ssize_t>(pid.size()))
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to write pid to " << file;
+    }
+}
+
+InstanceLock::~InstanceLock()
+{
+    if (m_fd >= 0)
+    {
+        // The file is left in place, since removing it would race with the next instance
+        // opening it.
+        close(m_fd);
+    }
+}
+
+std::filesystem::path InstanceLock::LockFile(const std::filesystem::path& db_file)
+{
+    return db_file.string() + ".lock";
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+
+namespace porla::Data
+{
+    // Held by the daemon for as long as it has the database open, so a second daemon
+    // on the same database fails to start instead of both of them writing to it. The
+    // lock is an flock on a file next to the database, which the kernel lets go of when
+    // the process exits, however it exits. Tools reading the database do not take it.
+    class InstanceLock
+    {
+    public:
+        // Throws if another process holds the lock. In-memory databases are never
+        // shared, and take no lock.
+        explicit InstanceLock(const std::filesystem::path& db_file);
+        InstanceLock(const InstanceLock&) = delete;
+
+        ~InstanceLock();
+
+        static std::filesystem::path LockFile(const std::filesystem::path& db_file);
+
+    private:
+        int m_fd;
+    };
+}
@@ -12,6 +12,16 @@
 #include "migrations/0004_removesessionparams.hpp"
 #include "migrations/0005_metadata.hpp"
 #include "migrations/0006_clientdata.hpp"
+#include "migrations/0007_torrenthistory.hpp"
+#include "migrations/0008_resumedataencoding.hpp"
+#include "migrations/0009_torrentinfo.hpp"
+#include "migrations/0010_binaryinfohash.hpp"
+#include "migrations/0011_clientdataencoding.hpp"
+#include "migrations/0012_torrentmetadata.hpp"
+#include "migrations/0013_parked.hpp"
+#include "migrations/0014_feeditems.hpp"
+#include "migrations/0015_workflowruns.hpp"
+#include "migrations/0016_rowrevision.hpp"
 #include "statement.hpp"
 
 int GetUserVersion(sqlite3* db)
@@ -34,9 +44,9 @@ void SetUserVersion(sqlite3* db, int version)
     sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
 }
 
-bool porla::Data::Migrate(sqlite3* db)
+static const std::vector<std::function<int(sqlite3*)>>& AllMigrations()
 {
-    static std::vector<std::function<int(sqlite3*)>> Migrations =
+    static const std::vector<std::function<int(sqlite3*)>> Migrations =
     {
         &porla::Data::Migrations::InitialSetup::Migrate,
         &porla::Data::Migrations::AddSessionSettings::Migrate,
@@ -44,8 +54,30 @@ bool porla::Data::Migrate(sqlite3* db)
         &porla::Data::Migrations::RemoveSessionParams::Migrate,
         &porla::Data::Migrations::TorrentsMetadata::Migrate,
         &porla::Data::Migrations::ClientData::Migrate,
+        &porla::Data::Migrations::TorrentHistory::Migrate,
+        &porla::Data::Migrations::ResumeDataEncoding::Migrate,
+        &porla::Data::Migrations::TorrentInfo::Migrate,
+        &porla::Data::Migrations::BinaryInfoHash::Migrate,
+        &porla::Data::Migrations::ClientDataEncoding::Migrate,
+        &porla::Data::Migrations::TorrentMetadata::Migrate,
+        &porla::Data::Migrations::Parked::Migrate,
+        &porla::Data::Migrations::FeedItems::Migrate,
+        &porla::Data::Migrations::WorkflowRuns::Migrate,
+        &porla::Data::Migrations::RowRevision::Migrate,
     };
 
+    return Migrations;
+}
+
+bool porla::Data::IsMigrated(sqlite3* db)
+{
+    return GetUserVersion(db) >= static_cast<int>(AllMigrations().size());
+}
+
+bool porla::Data::Migrate(sqlite3* db)
+{
+    const auto& Migrations = AllMigrations();
+
     int user_version = GetUserVersion(db);
 
     if (user_version < Migrations.size())
@@ -62,7 +94,11 @@ bool porla::Data::Migrate(sqlite3* db)
         }
     }
 
-    SetUserVersion(db, static_cast<int>(Migrations.size()));
+    // Only written when something was migrated, so an up to date database is left alone.
+    if (user_version < Migrations.size())
+    {
+        SetUserVersion(db, static_cast<int>(Migrations.size()));
+    }
 
     return true;
 }
@@ -5,4 +5,7 @@
 namespace porla::Data
 {
     bool Migrate(sqlite3* db);
+    // Whether every migration has been applied, without writing anything, for readers
+    // which must not migrate the database themselves.
+    bool IsMigrated(sqlite3* db);
 }
@@ -0,0 +1,37 @@
+#include "0007_torrenthistory.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::TorrentHistory;
+
+int TorrentHistory::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Creating 'torrenthistory' table";
+
+    int res = sqlite3_exec(
+        db,
+        "CREATE TABLE torrenthistory ("
+            "info_hash TEXT NOT NULL,"
+            "period INTEGER NOT NULL,"
+            "bucket INTEGER NOT NULL,"
+            "downloaded INTEGER NOT NULL DEFAULT 0,"
+            "uploaded INTEGER NOT NULL DEFAULT 0,"
+            "PRIMARY KEY (info_hash, period, bucket)"
+        ") WITHOUT ROWID;",
+        nullptr,
+        nullptr,
+        nullptr);
+
+    if (res != SQLITE_OK)
+    {
+        return res;
+    }
+
+    // Pruning deletes by age across all torrents.
+    return sqlite3_exec(
+        db,
+        "CREATE INDEX torrenthistory_period_bucket ON torrenthistory (period, bucket);",
+        nullptr,
+        nullptr,
+        nullptr);
+}
@@ -0,0 +1,18 @@
+#include "0008_resumedataencoding.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::ResumeDataEncoding;
+
+int ResumeDataEncoding::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Adding resume_data_encoding column to addtorrentparams table";
+
+    // Existing rows are uncompressed, and are compressed the next time they are saved.
+    return sqlite3_exec(
+        db,
+        "ALTER TABLE addtorrentparams ADD COLUMN resume_data_encoding INTEGER NOT NULL DEFAULT 0;",
+        nullptr,
+        nullptr,
+        nullptr);
+}
@@ -0,0 +1,24 @@
+#include "0009_torrentinfo.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::TorrentInfo;
+
+int TorrentInfo::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Creating 'torrentinfo' table";
+
+    // Keyed on the v2 info hash if there is one and the v1 hash otherwise, the same as
+    // COALESCE(info_hash_v2, info_hash_v1) in addtorrentparams. Existing resume data keeps
+    // its info dict until the torrent is saved again, and loads either way.
+    return sqlite3_exec(
+        db,
+        "CREATE TABLE torrentinfo ("
+            "info_hash TEXT NOT NULL PRIMARY KEY,"
+            "info_buf BLOB NOT NULL,"
+            "info_encoding INTEGER NOT NULL DEFAULT 0"
+        ") WITHOUT ROWID;",
+        nullptr,
+        nullptr,
+        nullptr);
+}
@@ -0,0 +1,118 @@
+#include "0010_binaryinfohash.hpp"
+
+#include <string>
+#include <string_view>
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::BinaryInfoHash;
+
+static bool Unhex(std::string_view hex, std::string& out)
+{
+    const auto nibble = [](char c) -> int
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    if (hex.size() % 2 != 0) return false;
+
+    for (std::size_t i = 0; i < hex.size(); i += 2)
+    {
+        const int hi = nibble(hex[i]);
+        const int lo = nibble(hex[i + 1]);
+
+        if (hi < 0 || lo < 0) return false;
+
+        out.push_back(static_cast<char>(hi << 4 | lo));
+    }
+
+    return true;
+}
+
+// porla_info_hash(v1, v2) builds the key from the hex columns, like
+// AddTorrentParams does from an info_hash_t.
+static void InfoHashFunction(sqlite3_context* ctx, int, sqlite3_value** args)
+{
+    std::string key;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (sqlite3_value_type(args[i]) == SQLITE_NULL)
+        {
+            continue;
+        }
+
+        const auto hex = std::string_view(
+            reinterpret_cast<const char*>(sqlite3_value_text(args[i])),
+            static_cast<std::size_t>(sqlite3_value_bytes(args[i])));
+
+        if (!Unhex(hex, key))
+        {
+            sqlite3_result_error(ctx, "invalid info hash", -1);
+            return;
+        }
+    }
+
+    sqlite3_result_blob(ctx, key.data(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+}
+
+int BinaryInfoHash::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Keying 'addtorrentparams' and 'torrentinfo' on binary info hashes";
+
+    int res = sqlite3_create_function(db, "porla_info_hash", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, &InfoHashFunction, nullptr, nullptr);
+
+    if (res != SQLITE_OK)
+    {
+        return res;
+    }
+
+    // Tables with large blobs keep their rowid, so the rows are not stored in the index.
+    res = sqlite3_exec(
+        db,
+        "BEGIN;"
+        "CREATE TABLE addtorrentparams_new ("
+            "id INTEGER PRIMARY KEY,"
+            "info_hash BLOB NOT NULL UNIQUE,"
+            "client_data TEXT NULL,"
+            "name TEXT,"
+            "queue_position INTEGER NOT NULL,"
+            "resume_data_buf BLOB NOT NULL,"
+            "resume_data_encoding INTEGER NOT NULL DEFAULT 0,"
+            "save_path TEXT NOT NULL"
+        ");"
+        "INSERT INTO addtorrentparams_new (info_hash, client_data, name, queue_position, resume_data_buf, resume_data_encoding, save_path) "
+            "SELECT porla_info_hash(info_hash_v1, info_hash_v2), client_data, name, queue_position, resume_data_buf, resume_data_encoding, save_path "
+            "FROM addtorrentparams;"
+        "CREATE TABLE torrentinfo_new ("
+            "id INTEGER PRIMARY KEY,"
+            "info_hash BLOB NOT NULL UNIQUE,"
+            "info_buf BLOB NOT NULL,"
+            "info_encoding INTEGER NOT NULL DEFAULT 0"
+        ");"
+        "INSERT INTO torrentinfo_new (info_hash, info_buf, info_encoding) "
+            "SELECT porla_info_hash(atp.info_hash_v1, atp.info_hash_v2), ti.info_buf, ti.info_encoding "
+            "FROM torrentinfo ti "
+            "JOIN addtorrentparams atp ON ti.info_hash = COALESCE(atp.info_hash_v2, atp.info_hash_v1);"
+        "DROP TABLE addtorrentparams;"
+        "DROP TABLE torrentinfo;"
+        "ALTER TABLE addtorrentparams_new RENAME TO addtorrentparams;"
+        "ALTER TABLE torrentinfo_new RENAME TO torrentinfo;"
+        "CREATE INDEX addtorrentparams_queue_position ON addtorrentparams (queue_position);"
+        "COMMIT;",
+        nullptr,
+        nullptr,
+        nullptr);
+
+    if (res != SQLITE_OK)
+    {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+
+    sqlite3_create_function(db, "porla_info_hash", 2, SQLITE_UTF8, nullptr, nullptr, nullptr, nullptr);
+
+    return res;
+}
@@ -0,0 +1,18 @@
+#include "0011_clientdataencoding.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::ClientDataEncoding;
+
+int ClientDataEncoding::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Adding client_data_encoding column to addtorrentparams table";
+
+    // Existing client data is JSON text, and is rewritten as CBOR when it next changes.
+    return sqlite3_exec(
+        db,
+        "ALTER TABLE addtorrentparams ADD COLUMN client_data_encoding INTEGER NOT NULL DEFAULT 0;",
+        nullptr,
+        nullptr,
+        nullptr);
+}
@@ -0,0 +1,125 @@
+#include "0012_torrentmetadata.hpp"
+
+#include <string>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <nlohmann/json.hpp>
+
+#include "../statement.hpp"
+
+using json = nlohmann::json;
+using porla::Data::Migrations::TorrentMetadata;
+using porla::Data::Statement;
+
+struct ClientDataRow
+{
+    std::vector<char> info_hash;
+    json              client_data;
+    int               encoding;
+};
+
+int TorrentMetadata::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Moving torrent metadata to the 'torrentmetadata' table";
+
+    // One row per torrent and key, with the value as CBOR.
+    int res = sqlite3_exec(
+        db,
+        "BEGIN;"
+        "CREATE TABLE torrentmetadata ("
+            "info_hash BLOB NOT NULL,"
+            "key TEXT NOT NULL,"
+            "value BLOB NOT NULL,"
+            "PRIMARY KEY (info_hash, key)"
+        ") WITHOUT ROWID;",
+        nullptr,
+        nullptr,
+        nullptr);
+
+    if (res != SQLITE_OK)
+    {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return res;
+    }
+
+    try
+    {
+        std::vector<ClientDataRow> rows;
+
+        Statement::Prepare(db, "SELECT info_hash, client_data, client_data_encoding FROM addtorrentparams WHERE client_data IS NOT NULL;")
+            .Step(
+                [&rows](const Statement::IRow& row)
+                {
+                    const int encoding = row.GetInt32(2);
+                    const auto blob = row.GetBlob(1);
+
+                    // Client data is JSON text (0) or CBOR (1).
+                    auto client_data = encoding == 1
+                        ? json::from_cbor(blob.begin(), blob.end())
+                        : json::parse(blob.begin(), blob.end());
+
+                    if (client_data.is_object() && client_data.contains("metadata"))
+                    {
+                        rows.push_back(ClientDataRow{
+                            .info_hash   = row.GetBuffer(0),
+                            .client_data = std::move(client_data),
+                            .encoding    = encoding
+                        });
+                    }
+
+                    return SQLITE_OK;
+                });
+
+        for (auto& row : rows)
+        {
+            const auto& metadata = row.client_data["metadata"];
+
+            if (metadata.is_object())
+            {
+                for (const auto& [key, value] : metadata.items())
+                {
+                    std::vector<char> cbor;
+                    json::to_cbor(value, cbor);
+
+                    Statement::Prepare(db, "INSERT OR REPLACE INTO torrentmetadata (info_hash, key, value) VALUES ($1, $2, $3);")
+                        .Bind(1, row.info_hash)
+                        .Bind(2, std::string_view(key))
+                        .Bind(3, cbor)
+                        .Execute();
+                }
+            }
+
+            row.client_data.erase("metadata");
+
+            // Written back in the encoding it was read in, which the column says.
+            auto stmt = Statement::Prepare(db, "UPDATE addtorrentparams SET client_data = $1 WHERE info_hash = $2;");
+
+            std::vector<char> cbor;
+            std::string text;
+
+            if (row.encoding == 1)
+            {
+                json::to_cbor(row.client_data, cbor);
+                stmt.Bind(1, cbor);
+            }
+            else
+            {
+                text = row.client_data.dump();
+                stmt.Bind(1, std::string_view(text));
+            }
+
+            stmt.Bind(2, row.info_hash).Execute();
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Moved metadata for " << rows.size() << " torrent(s)";
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to move torrent metadata: " << ex.what();
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return SQLITE_ERROR;
+    }
+
+    return sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+}
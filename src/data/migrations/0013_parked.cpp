@@ -0,0 +1,18 @@
+#include "0013_parked.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::Parked;
+
+int Parked::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Adding parked column to addtorrentparams table";
+
+    // Parked torrents are kept out of the libtorrent session when loaded.
+    return sqlite3_exec(
+        db,
+        "ALTER TABLE addtorrentparams ADD COLUMN parked INTEGER NOT NULL DEFAULT 0;",
+        nullptr,
+        nullptr,
+        nullptr);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <sqlite3.h>
+
+namespace porla::Data::Migrations
+{
+    struct Parked
+    {
+        static int Migrate(sqlite3* db);
+    };
+}
@@ -0,0 +1,35 @@
+#include "0014_feeditems.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::FeedItems;
+
+int FeedItems::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Creating 'feeditems' table";
+
+    int res = sqlite3_exec(
+        db,
+        "CREATE TABLE feeditems ("
+            "feed TEXT NOT NULL,"
+            "item_id TEXT NOT NULL,"
+            "seen_at INTEGER NOT NULL,"
+            "PRIMARY KEY (feed, item_id)"
+        ") WITHOUT ROWID;",
+        nullptr,
+        nullptr,
+        nullptr);
+
+    if (res != SQLITE_OK)
+    {
+        return res;
+    }
+
+    // Pruning deletes by age within a feed.
+    return sqlite3_exec(
+        db,
+        "CREATE INDEX feeditems_feed_seen_at ON feeditems (feed, seen_at);",
+        nullptr,
+        nullptr,
+        nullptr);
+}
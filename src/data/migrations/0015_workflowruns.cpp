@@ -0,0 +1,26 @@
+#include "0015_workflowruns.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::WorkflowRuns;
+
+int WorkflowRuns::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Creating 'workflowruns' table";
+
+    // Runs which are queued or in progress, resumed from the stage after the last one
+    // done when porla starts.
+    return sqlite3_exec(
+        db,
+        "CREATE TABLE workflowruns ("
+            "id INTEGER PRIMARY KEY,"
+            "workflow TEXT NOT NULL,"
+            "contexts TEXT NOT NULL,"
+            "stage INTEGER NOT NULL DEFAULT 0,"
+            "outputs TEXT NOT NULL DEFAULT '[]',"
+            "queued_at INTEGER NOT NULL"
+        ");",
+        nullptr,
+        nullptr,
+        nullptr);
+}
@@ -0,0 +1,20 @@
+#include "0016_rowrevision.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::Data::Migrations::RowRevision;
+
+int RowRevision::Migrate(sqlite3* db)
+{
+    BOOST_LOG_TRIVIAL(info) << "Adding revision column to addtorrentparams table";
+
+    // Tells rows in a state snapshot apart from the ones changed since it was written. The
+    // index covers the whole revision scan, so it never reads the resume data itself.
+    return sqlite3_exec(
+        db,
+        "ALTER TABLE addtorrentparams ADD COLUMN revision INTEGER NOT NULL DEFAULT 0;"
+        "CREATE INDEX addtorrentparams_revision ON addtorrentparams (queue_position, info_hash, revision);",
+        nullptr,
+        nullptr,
+        nullptr);
+}
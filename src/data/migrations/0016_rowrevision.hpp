@@ -0,0 +1,11 @@
+#pragma once
+
+#include <sqlite3.h>
+
+namespace porla::Data::Migrations
+{
+    struct RowRevision
+    {
+        static int Migrate(sqlite3* db);
+    };
+}
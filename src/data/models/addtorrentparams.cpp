@@ -1,24 +1,60 @@
 #include "addtorrentparams.hpp"
 
+#include <atomic>
+#include <chrono>
+
 #include <boost/log/trivial.hpp>
 #include <libtorrent/read_resume_data.hpp>
+#include <libtorrent/torrent_info.hpp>
 #include <libtorrent/write_resume_data.hpp>
 #include <nlohmann/json.hpp>
 
+#include "../resumedatacodec.hpp"
 #include "../statement.hpp"
 #include "../../json/torrentclientdata.hpp"
 #include "../../torrentclientdata.hpp"
 
 using json = nlohmann::json;
+using porla::Data::ResumeDataCodec;
+using porla::Data::ResumeDataEncoding;
 using porla::Data::Statement;
 using porla::Data::Models::AddTorrentParams;
 
-template<typename T>
-static std::string ToString(const T &hash)
+std::vector<char> AddTorrentParams::Key(const lt::info_hash_t& hash)
+{
+    std::vector<char> key;
+
+    if (hash.has_v1()) key.insert(key.end(), hash.v1.data(), hash.v1.data() + hash.v1.size());
+    if (hash.has_v2()) key.insert(key.end(), hash.v2.data(), hash.v2.data() + hash.v2.size());
+
+    return key;
+}
+
+lt::info_hash_t AddTorrentParams::FromKey(std::span<const char> key)
+{
+    lt::info_hash_t hash;
+
+    if (key.size() == 20 || key.size() == 52)
+    {
+        hash.v1.assign(key.data());
+    }
+
+    if (key.size() == 32 || key.size() == 52)
+    {
+        hash.v2.assign(key.data() + key.size() - 32);
+    }
+
+    return hash;
+}
+
+// Revisions start from the time in microseconds, so they keep increasing across restarts
+// and a row written after a state snapshot never has the revision the snapshot holds.
+static std::int64_t NextRevision()
 {
-    std::stringstream ss;
-    ss << hash;
-    return ss.str();
+    static std::atomic<std::int64_t> revision(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    return ++revision;
 }
 
 int AddTorrentParams::Count(sqlite3 *db)
@@ -41,93 +77,452 @@ int AddTorrentParams::Count(sqlite3 *db)
     return count;
 }
 
-void AddTorrentParams::ForEach(sqlite3 *db, const std::function<void(lt::add_torrent_params&)>& cb)
+static ResumeDataEncoding Compress(bool compress, std::vector<char>& buf)
 {
-    auto stmt = Statement::Prepare(db, "SELECT client_data,name,resume_data_buf,save_path FROM addtorrentparams\n"
-                                       "ORDER BY queue_position ASC");
-    stmt.Step(
-        [&cb](const Statement::IRow& row)
+    if (!compress)
+    {
+        return ResumeDataEncoding::None;
+    }
+
+    buf = ResumeDataCodec::Compress(buf);
+
+    return ResumeDataEncoding::DeflateV1;
+}
+
+static ResumeDataEncoding Encode(const AddTorrentParams& params, bool compress, std::vector<char>& buf)
+{
+    // Copying the params is much cheaper than encoding and storing the info dict with
+    // every save.
+    lt::add_torrent_params state = params.params;
+    state.ti.reset();
+
+    buf = lt::write_resume_data_buf(state);
+
+    return Compress(compress, buf);
+}
+
+// Returns the number of bytes written, which is zero unless the info dict was not stored yet.
+static std::size_t StoreInfo(sqlite3* db, const lt::info_hash_t& hash, const AddTorrentParams& params, bool compress)
+{
+    if (!params.params.ti || !params.params.ti->is_valid())
+    {
+        return 0;
+    }
+
+    const auto key = Key(hash);
+    bool stored = false;
+
+    Statement::PrepareCached(db, "SELECT 1 FROM torrentinfo WHERE info_hash = $1;")
+        .Bind(1, key)
+        .Step([&stored](const Statement::IRow&)
         {
+            stored = true;
+            return SQLITE_OK;
+        });
+
+    if (stored)
+    {
+        return 0;
+    }
 
-            libtorrent::error_code ec;
-            auto atp = lt::read_resume_data(row.GetBuffer(2), ec);
+    const auto section = params.params.ti->info_section();
 
-            if (ec)
+    std::vector<char> buf(section.begin(), section.end());
+    const auto encoding = Compress(compress, buf);
+
+    Statement::PrepareCached(db, "INSERT INTO torrentinfo (info_hash, info_buf, info_encoding) VALUES ($1, $2, $3);")
+        .Bind(1, std::span<const char>(key))
+        .Bind(2, std::span<const char>(buf))
+        .Bind(3, static_cast<int>(encoding))
+        .Execute();
+
+    return buf.size();
+}
+
+// How the client_data column is stored.
+enum class ClientDataEncoding
+{
+    Json = 0,
+    Cbor = 1
+};
+
+static std::vector<char> EncodeClientData(const porla::TorrentClientData& client_data)
+{
+    std::vector<char> buf;
+    json::to_cbor(json(client_data), buf);
+    return buf;
+}
+
+static void ReadClientData(std::string_view data, int encoding, porla::TorrentClientData& client_data)
+{
+    if (data.empty())
+    {
+        return;
+    }
+
+    const auto parsed = static_cast<ClientDataEncoding>(encoding) == ClientDataEncoding::Cbor
+        ? json::from_cbor(data.begin(), data.end())
+        : json::parse(data);
+
+    parsed.get_to(client_data);
+}
+
+static constexpr std::string_view SelectRows =
+    "SELECT atp.client_data,atp.client_data_encoding,ti.info_buf,ti.info_encoding,atp.name,atp.resume_data_buf,atp.resume_data_encoding,atp.save_path,atp.parked,atp.info_hash,atp.revision\n"
+    "FROM addtorrentparams atp\n"
+    "LEFT JOIN torrentinfo ti ON ti.info_hash = atp.info_hash\n"
+    "ORDER BY atp.queue_position ASC";
+
+static constexpr std::string_view SelectRow =
+    "SELECT atp.client_data,atp.client_data_encoding,ti.info_buf,ti.info_encoding,atp.name,atp.resume_data_buf,atp.resume_data_encoding,atp.save_path,atp.parked,atp.info_hash,atp.revision\n"
+    "FROM addtorrentparams atp\n"
+    "LEFT JOIN torrentinfo ti ON ti.info_hash = atp.info_hash\n"
+    "WHERE atp.info_hash = $1";
+
+// The same columns as SelectRows, followed by the row id.
+static constexpr std::string_view SelectRowsAfter =
+    "SELECT atp.client_data,atp.client_data_encoding,ti.info_buf,ti.info_encoding,atp.name,atp.resume_data_buf,atp.resume_data_encoding,atp.save_path,atp.parked,atp.info_hash,atp.revision,atp.id\n"
+    "FROM addtorrentparams atp\n"
+    "LEFT JOIN torrentinfo ti ON ti.info_hash = atp.info_hash\n"
+    "WHERE atp.id > $1\n"
+    "ORDER BY atp.id ASC\n"
+    "LIMIT $2";
+
+static AddTorrentParams::RowView ReadRow(const Statement::IRow& row)
+{
+    // Read as a blob since it is either JSON text or CBOR.
+    const auto client_data = row.GetBlob(0);
+
+    return AddTorrentParams::RowView{
+        .client_data          = std::string_view(client_data.data(), client_data.size()),
+        .client_data_encoding = row.GetInt32(1),
+        .info_buf             = row.GetBlob(2),
+        .info_encoding        = row.GetInt32(3),
+        .info_hash            = AddTorrentParams::FromKey(row.GetBlob(9)),
+        .name                 = row.GetStringView(4),
+        .resume_data_buf      = row.GetBlob(5),
+        .resume_data_encoding = row.GetInt32(6),
+        .save_path            = row.GetStringView(7),
+        .parked               = row.GetInt32(8) != 0,
+        .revision             = row.GetInt64(10)
+    };
+}
+
+bool AddTorrentParams::Decode(const Row& row, lt::add_torrent_params& params)
+{
+    return Decode(
+        RowView{
+            .client_data          = row.client_data,
+            .client_data_encoding = row.client_data_encoding,
+            .info_buf             = row.info_buf,
+            .info_encoding        = row.info_encoding,
+            .info_hash            = row.info_hash,
+            .name                 = row.name,
+            .resume_data_buf      = row.resume_data_buf,
+            .resume_data_encoding = row.resume_data_encoding,
+            .save_path            = row.save_path,
+            .parked               = row.parked,
+            .revision             = row.revision
+        },
+        params);
+}
+
+bool AddTorrentParams::Decode(const RowView& row, lt::add_torrent_params& params)
+{
+    // Uncompressed data is parsed where it is.
+    std::span<const char> resume = row.resume_data_buf;
+    std::vector<char> inflated;
+
+    if (static_cast<ResumeDataEncoding>(row.resume_data_encoding) != ResumeDataEncoding::None)
+    {
+        if (!ResumeDataCodec::Decompress(static_cast<ResumeDataEncoding>(row.resume_data_encoding), resume, inflated))
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to decompress resume data with encoding " << row.resume_data_encoding;
+            return false;
+        }
+
+        resume = inflated;
+    }
+
+    libtorrent::error_code ec;
+    params = lt::read_resume_data(lt::span<char const>(resume.data(), static_cast<std::ptrdiff_t>(resume.size())), ec);
+
+    if (ec)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read resume data from buffer: " << ec;
+        return false;
+    }
+
+    if (!row.info_buf.empty())
+    {
+        std::span<const char> info = row.info_buf;
+
+        if (static_cast<ResumeDataEncoding>(row.info_encoding) != ResumeDataEncoding::None)
+        {
+            if (!ResumeDataCodec::Decompress(static_cast<ResumeDataEncoding>(row.info_encoding), info, inflated))
             {
-                BOOST_LOG_TRIVIAL(error) << "Failed to read resume data from buffer: " << ec;
-                return SQLITE_OK;
+                BOOST_LOG_TRIVIAL(error) << "Failed to decompress info dict with encoding " << row.info_encoding;
+                return false;
             }
 
-            atp.userdata = lt::client_data_t(new TorrentClientData());
-            atp.name = row.GetStdString(1);
-            atp.save_path = row.GetStdString(3);
+            info = inflated;
+        }
+
+        // torrent_info parses whole torrent files, so the dict is wrapped in one.
+        const std::string_view prefix = "d4:info";
+
+        std::vector<char> torrent;
+        torrent.reserve(prefix.size() + info.size() + 1);
+        torrent.insert(torrent.end(), prefix.begin(), prefix.end());
+        torrent.insert(torrent.end(), info.begin(), info.end());
+        torrent.push_back('e');
+
+        params.ti = std::make_shared<lt::torrent_info>(torrent, ec, lt::from_span);
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to read info dict: " << ec;
+            return false;
+        }
+    }
+
+    params.userdata = lt::client_data_t(new TorrentClientData());
+    params.name = row.name;
+    params.save_path = row.save_path;
+
+    auto client_data = params.userdata.get<TorrentClientData>();
+
+    ReadClientData(row.client_data, row.client_data_encoding, *client_data);
+
+    client_data->revision = 0;
+
+    return true;
+}
+
+void AddTorrentParams::DecodeClientData(const Row& row, porla::TorrentClientData& client_data)
+{
+    ReadClientData(row.client_data, row.client_data_encoding, client_data);
+}
 
-            const auto client_data_str = row.GetStdString(0);
+void AddTorrentParams::ForEach(sqlite3 *db, const std::function<void(lt::add_torrent_params&)>& cb)
+{
+    // Decoded straight from the row, since nothing outlives the step.
+    Statement::Prepare(db, SelectRows).Step(
+        [&cb](const Statement::IRow& row)
+        {
+            lt::add_torrent_params atp;
 
-            if (!client_data_str.empty())
+            if (Decode(ReadRow(row), atp))
             {
-                json::parse(client_data_str).get_to(
-                    *atp.userdata.get<TorrentClientData>());
+                cb(atp);
             }
 
-            cb(atp);
+            return SQLITE_OK;
+        });
+}
+
+std::int64_t AddTorrentParams::ForEachAfter(
+    sqlite3* db,
+    std::int64_t after,
+    int limit,
+    const std::function<void(lt::add_torrent_params&)>& cb)
+{
+    std::int64_t last = after;
+
+    Statement::Prepare(db, SelectRowsAfter)
+        .Bind(1, after)
+        .Bind(2, limit)
+        .Step(
+            [&cb, &last](const Statement::IRow& row)
+            {
+                lt::add_torrent_params atp;
+
+                last = row.GetInt64(11);
+
+                if (Decode(ReadRow(row), atp))
+                {
+                    cb(atp);
+                }
+
+                return SQLITE_OK;
+            });
+
+    return last;
+}
+
+static AddTorrentParams::Row CopyRow(const AddTorrentParams::RowView& view)
+{
+    return AddTorrentParams::Row{
+        .client_data          = std::string(view.client_data),
+        .client_data_encoding = view.client_data_encoding,
+        .info_buf             = std::vector<char>(view.info_buf.begin(), view.info_buf.end()),
+        .info_encoding        = view.info_encoding,
+        .info_hash            = view.info_hash,
+        .name                 = std::string(view.name),
+        .resume_data_buf      = std::vector<char>(view.resume_data_buf.begin(), view.resume_data_buf.end()),
+        .resume_data_encoding = view.resume_data_encoding,
+        .save_path            = std::string(view.save_path),
+        .parked               = view.parked,
+        .revision             = view.revision
+    };
+}
 
+void AddTorrentParams::ForEachRevision(sqlite3* db, const std::function<void(std::span<const char>, std::int64_t)>& cb)
+{
+    Statement::Prepare(db, "SELECT info_hash, revision FROM addtorrentparams INDEXED BY addtorrentparams_revision ORDER BY queue_position ASC").Step(
+        [&cb](const Statement::IRow& row)
+        {
+            cb(row.GetBlob(0), row.GetInt64(1));
             return SQLITE_OK;
         });
 }
 
-void AddTorrentParams::Insert(sqlite3 *db, const libtorrent::info_hash_t& hash, const AddTorrentParams& params)
+void AddTorrentParams::ForEachRow(sqlite3* db, const std::function<void(Row&&)>& cb)
 {
-    std::vector<char> buf = lt::write_resume_data_buf(params.params);
+    // Copied once, into rows which are decoded on other threads.
+    ForEachRowView(db, [&cb](const RowView& view) { cb(CopyRow(view)); });
+}
 
-    const std::string client_data_json = json(*params.client_data).dump();
+void AddTorrentParams::ForEachRowView(sqlite3* db, const std::function<void(const RowView&)>& cb)
+{
+    Statement::Prepare(db, SelectRows).Step(
+        [&cb](const Statement::IRow& row)
+        {
+            cb(ReadRow(row));
+            return SQLITE_OK;
+        });
+}
+
+std::optional<AddTorrentParams::Row> AddTorrentParams::GetRow(sqlite3* db, std::span<const char> key)
+{
+    std::optional<Row> result;
+
+    Statement::PrepareCached(db, SelectRow)
+        .Bind(1, key)
+        .Step(
+            [&result](const Statement::IRow& row)
+            {
+                result = CopyRow(ReadRow(row));
+                return SQLITE_OK;
+            });
+
+    return result;
+}
+
+bool AddTorrentParams::Get(sqlite3* db, const libtorrent::info_hash_t& hash, lt::add_torrent_params& params)
+{
+    bool found = false;
 
-    auto stmt = Statement::Prepare(db, "INSERT INTO addtorrentparams\n"
-                                       "    (info_hash_v1, info_hash_v2, client_data, name, queue_position, resume_data_buf, save_path)\n"
-                                       "VALUES ($1, $2, $3, $4, $5, $6, $7);");
+    Statement::PrepareCached(db, SelectRow)
+        .Bind(1, Key(hash))
+        .Step(
+            [&found, &params](const Statement::IRow& row)
+            {
+                found = Decode(ReadRow(row), params);
+                return SQLITE_OK;
+            });
+
+    return found;
+}
+
+void AddTorrentParams::Insert(sqlite3 *db, const libtorrent::info_hash_t& hash, const AddTorrentParams& params, bool compress)
+{
+    std::vector<char> buf;
+    const auto encoding = Encode(params, compress, buf);
+
+    const auto client_data = EncodeClientData(*params.client_data);
+
+    auto stmt = Statement::PrepareCached(db, "INSERT INTO addtorrentparams\n"
+                                       "    (info_hash, client_data, client_data_encoding, name, queue_position, resume_data_buf, resume_data_encoding, save_path, parked, revision)\n"
+                                       "VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10);");
     stmt
-        .Bind(1, hash.has_v1() ? std::optional(ToString(hash.v1)) : std::nullopt)
-        .Bind(2, hash.has_v2() ? std::optional(ToString(hash.v2)) : std::nullopt)
-        .Bind(3, std::string_view(client_data_json))
+        .Bind(1, Key(hash))
+        .Bind(2, std::span<const char>(client_data))
+        .Bind(3, static_cast<int>(ClientDataEncoding::Cbor))
         .Bind(4, std::string_view(params.name))
         .Bind(5, params.queue_position)
-        .Bind(6, buf)
-        .Bind(7, std::string_view(params.save_path))
+        .Bind(6, std::span<const char>(buf))
+        .Bind(7, static_cast<int>(encoding))
+        .Bind(8, std::string_view(params.save_path))
+        .Bind(9, params.parked ? 1 : 0)
+        .Bind(10, NextRevision())
         .Execute();
+
+    StoreInfo(db, hash, params, compress);
 }
 
 void AddTorrentParams::Remove(sqlite3 *db, const libtorrent::info_hash_t& hash)
 {
-    auto stmt = Statement::Prepare(
-        db,
-        "DELETE FROM addtorrentparams\n"
-        "WHERE (info_hash_v1 = $1 AND info_hash_v2 IS NULL)\n"
-        "   OR (info_hash_v1 IS NULL AND info_hash_v2 = $2)\n"
-        "   OR (info_hash_v1 = $1 AND info_hash_v2 = $2);");
+    const auto key = Key(hash);
 
-    stmt
-        .Bind(1, hash.has_v1() ? std::optional(ToString(hash.v1)) : std::nullopt)
-        .Bind(2, hash.has_v2() ? std::optional(ToString(hash.v2)) : std::nullopt)
+    Statement::PrepareCached(db, "DELETE FROM addtorrentparams WHERE info_hash = $1;")
+        .Bind(1, key)
+        .Execute();
+
+    Statement::PrepareCached(db, "DELETE FROM torrentinfo WHERE info_hash = $1;")
+        .Bind(1, key)
         .Execute();
 }
 
-void AddTorrentParams::Update(sqlite3 *db, const libtorrent::info_hash_t& hash, const AddTorrentParams& params)
+void AddTorrentParams::UpdateClientData(sqlite3* db, const libtorrent::info_hash_t& hash, const TorrentClientData& client_data)
 {
-    std::vector<char> buf = lt::write_resume_data_buf(params.params);
+    const auto buf = EncodeClientData(client_data);
 
-    const std::string client_data_json = json(*params.client_data).dump();
-
-    auto stmt = Statement::Prepare(db, "UPDATE addtorrentparams SET client_data = $1, name = $2, resume_data_buf = $3, queue_position = $4, save_path = $5\n"
-                                       "WHERE (info_hash_v1 = $6 AND info_hash_v2 IS NULL)\n"
-                                       "   OR (info_hash_v1 IS NULL AND info_hash_v2 = $7)\n"
-                                       "   OR (info_hash_v1 = $6 AND info_hash_v2 = $7);");
-    stmt
-        .Bind(1, std::string_view(client_data_json))
-        .Bind(2, std::string_view(params.name))
-        .Bind(3, buf)
-        .Bind(4, params.queue_position)
-        .Bind(5, std::string_view(params.save_path))
-        .Bind(6, hash.has_v1() ? std::optional(ToString(hash.v1)) : std::nullopt)
-        .Bind(7, hash.has_v2() ? std::optional(ToString(hash.v2)) : std::nullopt)
+    Statement::PrepareCached(db, "UPDATE addtorrentparams SET client_data = $1, client_data_encoding = $2, revision = $4 WHERE info_hash = $3;")
+        .Bind(1, std::span<const char>(buf))
+        .Bind(2, static_cast<int>(ClientDataEncoding::Cbor))
+        .Bind(3, Key(hash))
+        .Bind(4, NextRevision())
         .Execute();
 }
+
+std::size_t AddTorrentParams::Update(
+    sqlite3 *db,
+    const libtorrent::info_hash_t& hash,
+    const AddTorrentParams& params,
+    bool compress,
+    bool write_client_data)
+{
+    std::vector<char> buf;
+    const auto encoding = Encode(params, compress, buf);
+
+    std::vector<char> client_data;
+
+    if (write_client_data)
+    {
+        client_data = EncodeClientData(*params.client_data);
+
+        Statement::PrepareCached(db, "UPDATE addtorrentparams SET client_data = $1, client_data_encoding = $2, name = $3, resume_data_buf = $4, queue_position = $5, save_path = $6, resume_data_encoding = $7, parked = $9, revision = $10\n"
+                                     "WHERE info_hash = $8;")
+            .Bind(1, std::span<const char>(client_data))
+            .Bind(2, static_cast<int>(ClientDataEncoding::Cbor))
+            .Bind(3, std::string_view(params.name))
+            .Bind(4, std::span<const char>(buf))
+            .Bind(5, params.queue_position)
+            .Bind(6, std::string_view(params.save_path))
+            .Bind(7, static_cast<int>(encoding))
+            .Bind(8, Key(hash))
+            .Bind(9, params.parked ? 1 : 0)
+            .Bind(10, NextRevision())
+            .Execute();
+    }
+    else
+    {
+        Statement::PrepareCached(db, "UPDATE addtorrentparams SET name = $1, resume_data_buf = $2, queue_position = $3, save_path = $4, resume_data_encoding = $5, parked = $7, revision = $8\n"
+                                     "WHERE info_hash = $6;")
+            .Bind(1, std::string_view(params.name))
+            .Bind(2, std::span<const char>(buf))
+            .Bind(3, params.queue_position)
+            .Bind(4, std::string_view(params.save_path))
+            .Bind(5, static_cast<int>(encoding))
+            .Bind(6, Key(hash))
+            .Bind(7, params.parked ? 1 : 0)
+            .Bind(8, NextRevision())
+            .Execute();
+    }
+
+    // Only when the row exists, since Insert stores the info dict otherwise.
+    const std::size_t info_size = sqlite3_changes(db) > 0 ? StoreInfo(db, hash, params, compress) : 0;
+
+    return buf.size() + client_data.size() + info_size;
+}
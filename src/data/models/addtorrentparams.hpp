@@ -1,5 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <libtorrent/add_torrent_params.hpp>
 #include <sqlite3.h>
 
@@ -17,11 +25,89 @@ namespace porla::Data::Models
         libtorrent::add_torrent_params params;
         int                            queue_position;
         std::string                    save_path;
+        // Kept out of the libtorrent session until it is needed again.
+        bool                           parked = false;
+
+        // A raw, undecoded row from the addtorrentparams table, with the info dict stored
+        // for it in the torrentinfo table. Reading rows and decoding them are split so the
+        // (expensive) decoding can happen on other threads.
+        struct Row
+        {
+            std::string       client_data;
+            int               client_data_encoding;
+            // Empty for torrents without metadata, and for rows written before the info
+            // dict was split out, which carry it in the resume data.
+            std::vector<char> info_buf;
+            int               info_encoding;
+            libtorrent::info_hash_t info_hash;
+            std::string       name;
+            std::vector<char> resume_data_buf;
+            int               resume_data_encoding;
+            std::string       save_path;
+            bool              parked;
+            // Changes with every write of the row, and never goes back to an earlier value.
+            std::int64_t      revision;
+        };
+
+        // A row over SQLite's memory, valid for one step.
+        struct RowView
+        {
+            std::string_view      client_data;
+            int                   client_data_encoding;
+            std::span<const char> info_buf;
+            int                   info_encoding;
+            libtorrent::info_hash_t info_hash;
+            std::string_view      name;
+            std::span<const char> resume_data_buf;
+            int                   resume_data_encoding;
+            std::string_view      save_path;
+            bool                  parked;
+            std::int64_t          revision;
+        };
+
+        // The primary key for a torrent: the v1 hash, the v2 hash, or both of them in that
+        // order for hybrid torrents. The lengths keep the three apart.
+        static std::vector<char> Key(const libtorrent::info_hash_t& hash);
+        // The info hash for a key, empty if its length is not one of the three.
+        static libtorrent::info_hash_t FromKey(std::span<const char> key);
 
         static int Count(sqlite3* db);
+        static bool Decode(const Row& row, libtorrent::add_torrent_params& params);
+        static bool Decode(const RowView& row, libtorrent::add_torrent_params& params);
+        // Only the client data of the row, which is much cheaper than all of it.
+        static void DecodeClientData(const Row& row, TorrentClientData& client_data);
         static void ForEach(sqlite3* db, const std::function<void(libtorrent::add_torrent_params&)>& cb);
-        static void Insert(sqlite3* db, const libtorrent::info_hash_t& hash, const AddTorrentParams& params);
+        // Decodes up to limit rows with an id after the given one, in id order, and returns
+        // the id of the last row read. Walks the table in pages without holding a
+        // statement open between them.
+        static std::int64_t ForEachAfter(
+            sqlite3* db,
+            std::int64_t after,
+            int limit,
+            const std::function<void(libtorrent::add_torrent_params&)>& cb);
+        // The key and revision of every row, in the order the rows are loaded. Read from an
+        // index, without touching the rows themselves.
+        static void ForEachRevision(sqlite3* db, const std::function<void(std::span<const char>, std::int64_t)>& cb);
+        static void ForEachRow(sqlite3* db, const std::function<void(Row&&)>& cb);
+        static void ForEachRowView(sqlite3* db, const std::function<void(const RowView&)>& cb);
+        // Decodes the stored torrent with the hash, returning false if there is none.
+        static bool Get(sqlite3* db, const libtorrent::info_hash_t& hash, libtorrent::add_torrent_params& params);
+        static std::optional<Row> GetRow(sqlite3* db, std::span<const char> key);
+        // The resume data is written without the info dict, which is written to the
+        // torrentinfo table the first time the torrent has one, since it never changes.
+        // Compressing is optional since it costs some CPU per write, while reading handles
+        // both.
+        static void Insert(sqlite3* db, const libtorrent::info_hash_t& hash, const AddTorrentParams& params, bool compress = false);
         static void Remove(sqlite3* db, const libtorrent::info_hash_t& hash);
-        static void Update(sqlite3* db, const libtorrent::info_hash_t& hash, const AddTorrentParams& params);
+        // Returns the number of bytes written for the row. The client data column is left
+        // as it is unless write_client_data is set.
+        static std::size_t Update(
+            sqlite3* db,
+            const libtorrent::info_hash_t& hash,
+            const AddTorrentParams& params,
+            bool compress = false,
+            bool write_client_data = true);
+        // Only the client data column, for edits which leave the resume data as it is.
+        static void UpdateClientData(sqlite3* db, const libtorrent::info_hash_t& hash, const TorrentClientData& client_data);
     };
 }
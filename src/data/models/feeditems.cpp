@@ -0,0 +1,40 @@
+#include "feeditems.hpp"
+
+#include "../statement.hpp"
+
+using porla::Data::Models::FeedItems;
+using porla::Data::Statement;
+
+bool FeedItems::Contains(sqlite3* db, const std::string& feed, const std::string& item_id)
+{
+    bool found = false;
+
+    Statement::PrepareCached(db, "SELECT 1 FROM feeditems WHERE feed = $1 AND item_id = $2;")
+        .Bind(1, std::string_view(feed))
+        .Bind(2, std::string_view(item_id))
+        .Step(
+            [&found](const Statement::IRow&)
+            {
+                found = true;
+                return SQLITE_OK;
+            });
+
+    return found;
+}
+
+void FeedItems::Prune(sqlite3* db, const std::string& feed, std::int64_t before)
+{
+    Statement::PrepareCached(db, "DELETE FROM feeditems WHERE feed = $1 AND seen_at < $2;")
+        .Bind(1, std::string_view(feed))
+        .Bind(2, before)
+        .Execute();
+}
+
+void FeedItems::Set(sqlite3* db, const std::string& feed, const std::string& item_id, std::int64_t seen_at)
+{
+    Statement::PrepareCached(db, "INSERT OR REPLACE INTO feeditems (feed, item_id, seen_at) VALUES ($1, $2, $3);")
+        .Bind(1, std::string_view(feed))
+        .Bind(2, std::string_view(item_id))
+        .Bind(3, seen_at)
+        .Execute();
+}
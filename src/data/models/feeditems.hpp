@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <sqlite3.h>
+
+namespace porla::Data::Models
+{
+    // The items of each subscribed feed that have been seen, so they are only added once.
+    // Items are keyed on their guid or id, and seen_at is the last time a poll found them.
+    class FeedItems
+    {
+    public:
+        static bool Contains(sqlite3* db, const std::string& feed, const std::string& item_id);
+        // Forgets the items not seen since before, which have dropped out of the feed.
+        static void Prune(sqlite3* db, const std::string& feed, std::int64_t before);
+        static void Set(sqlite3* db, const std::string& feed, const std::string& item_id, std::int64_t seen_at);
+    };
+}
@@ -1,5 +1,6 @@
 #include "sessionsettings.hpp"
 
+#include <stdexcept>
 #include <unordered_set>
 
 #include <boost/log/trivial.hpp>
@@ -35,49 +36,9 @@ void SessionSettings::Apply(sqlite3* db, libtorrent::settings_pack& settings)
                     return SQLITE_OK;
                 }
 
-                if (BlockedKeys.contains(key))
+                if (const auto error = Set(settings, key, val_parsed))
                 {
-                    BOOST_LOG_TRIVIAL(warning) << "Will not apply key " << key << " to settings";
-                    return SQLITE_OK;
-                }
-
-                int type = lt::setting_by_name(key);
-
-                if (type == -1)
-                {
-                    BOOST_LOG_TRIVIAL(error) << "Key " << key << " is invalid";
-                    return SQLITE_OK;
-                }
-
-                if ((type & lt::settings_pack::type_mask) == lt::settings_pack::bool_type_base)
-                {
-                    if (!val_parsed.is_boolean())
-                    {
-                        BOOST_LOG_TRIVIAL(error) << "Value for key " << key << " is not a boolean";
-                        return SQLITE_OK;
-                    }
-
-                    settings.set_bool(type, val_parsed.get<bool>());
-                }
-                else if ((type & lt::settings_pack::type_mask) == lt::settings_pack::int_type_base)
-                {
-                    if (!val_parsed.is_number_integer())
-                    {
-                        BOOST_LOG_TRIVIAL(error) << "Value for key " << key << " is not an integer";
-                        return SQLITE_OK;
-                    }
-
-                    settings.set_int(type, val_parsed.get<int>());
-                }
-                else if ((type & lt::settings_pack::type_mask) == lt::settings_pack::string_type_base)
-                {
-                    if (!val_parsed.is_string())
-                    {
-                        BOOST_LOG_TRIVIAL(error) << "Value for key " << key << " is not a string";
-                        return SQLITE_OK;
-                    }
-
-                    settings.set_str(type, val_parsed.get<std::string>());
+                    BOOST_LOG_TRIVIAL(error) << "Will not apply key " << key << " to settings: " << *error;
                 }
 
                 return SQLITE_OK;
@@ -98,3 +59,67 @@ void SessionSettings::Update(sqlite3 *db, const std::string &name, const nlohman
         .Bind(2, std::string_view(value.dump()))
         .Execute();
 }
+
+void SessionSettings::Update(sqlite3* db, const std::map<std::string, nlohmann::json>& values)
+{
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        throw std::runtime_error(std::string("Failed to begin transaction: ") + sqlite3_errmsg(db));
+    }
+
+    try
+    {
+        for (const auto& [name, value] : values)
+        {
+            Update(db, name, value);
+        }
+    }
+    catch (...)
+    {
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        throw;
+    }
+
+    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        const std::string error = sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+        throw std::runtime_error("Failed to commit transaction: " + error);
+    }
+}
+
+std::optional<std::string> SessionSettings::Set(libtorrent::settings_pack& settings, const std::string& key, const nlohmann::json& value)
+{
+    if (BlockedKeys.contains(key))
+    {
+        return "blocked";
+    }
+
+    const int type = lt::setting_by_name(key);
+
+    if (type == -1)
+    {
+        return "unknown setting";
+    }
+
+    switch (type & lt::settings_pack::type_mask)
+    {
+    case lt::settings_pack::bool_type_base:
+        if (!value.is_boolean()) return "not a boolean";
+        settings.set_bool(type, value.get<bool>());
+        break;
+
+    case lt::settings_pack::int_type_base:
+        if (!value.is_number_integer()) return "not an integer";
+        settings.set_int(type, value.get<int>());
+        break;
+
+    case lt::settings_pack::string_type_base:
+        if (!value.is_string()) return "not a string";
+        settings.set_str(type, value.get<std::string>());
+        break;
+    }
+
+    return std::nullopt;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <map>
+#include <optional>
 #include <string>
 #include <unordered_set>
 
@@ -13,6 +15,12 @@ namespace porla::Data::Models
     {
         static void Apply(sqlite3* db, libtorrent::settings_pack& settings);
         static void Update(sqlite3* db, const std::string& name, const nlohmann::json& value);
+        // Stores all of the settings in one transaction, or none of them.
+        static void Update(sqlite3* db, const std::map<std::string, nlohmann::json>& values);
+
+        // Sets the setting from its JSON value. Returns why it could not, for unknown and
+        // blocked keys and for values of the wrong type.
+        static std::optional<std::string> Set(libtorrent::settings_pack& settings, const std::string& key, const nlohmann::json& value);
 
         static const std::unordered_set<std::string> BlockedKeys;
     };
@@ -0,0 +1,73 @@
+#include "torrenthistory.hpp"
+
+#include "../statement.hpp"
+
+using porla::Data::Models::TorrentHistory;
+using porla::Data::Statement;
+
+void TorrentHistory::Add(sqlite3* db, const std::string& info_hash, int period, const Bucket& bucket)
+{
+    auto stmt = Statement::PrepareCached(
+        db,
+        "INSERT INTO torrenthistory (info_hash, period, bucket, downloaded, uploaded) VALUES ($1, $2, $3, $4, $5)\n"
+        "ON CONFLICT (info_hash, period, bucket) DO UPDATE SET\n"
+        "    downloaded = downloaded + excluded.downloaded,\n"
+        "    uploaded = uploaded + excluded.uploaded;");
+
+    stmt
+        .Bind(1, std::string_view(info_hash))
+        .Bind(2, period)
+        .Bind(3, bucket.start)
+        .Bind(4, bucket.downloaded)
+        .Bind(5, bucket.uploaded)
+        .Execute();
+}
+
+std::vector<TorrentHistory::Bucket> TorrentHistory::Get(sqlite3* db, const std::string& info_hash, int period, std::int64_t from, std::int64_t to)
+{
+    std::vector<Bucket> buckets;
+
+    auto stmt = Statement::PrepareCached(
+        db,
+        "SELECT bucket, downloaded, uploaded FROM torrenthistory\n"
+        "WHERE info_hash = $1 AND period = $2 AND bucket >= $3 AND bucket <= $4\n"
+        "ORDER BY bucket ASC;");
+
+    stmt
+        .Bind(1, std::string_view(info_hash))
+        .Bind(2, period)
+        .Bind(3, from)
+        .Bind(4, to)
+        .Step(
+            [&buckets](const Statement::IRow& row)
+            {
+                buckets.push_back(Bucket{
+                    .start      = row.GetInt64(0),
+                    .downloaded = row.GetInt64(1),
+                    .uploaded   = row.GetInt64(2)
+                });
+
+                return SQLITE_OK;
+            });
+
+    return buckets;
+}
+
+void TorrentHistory::Prune(sqlite3* db, int period, std::int64_t before)
+{
+    auto stmt = Statement::PrepareCached(db, "DELETE FROM torrenthistory WHERE period = $1 AND bucket < $2;");
+
+    stmt
+        .Bind(1, period)
+        .Bind(2, before)
+        .Execute();
+}
+
+void TorrentHistory::Remove(sqlite3* db, const std::string& info_hash)
+{
+    auto stmt = Statement::PrepareCached(db, "DELETE FROM torrenthistory WHERE info_hash = $1;");
+
+    stmt
+        .Bind(1, std::string_view(info_hash))
+        .Execute();
+}
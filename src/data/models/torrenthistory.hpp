@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+namespace porla::Data::Models
+{
+    // Bytes transferred per torrent, summed into buckets of a fixed period (in seconds).
+    // Torrents are keyed on the hex string of their best info hash.
+    class TorrentHistory
+    {
+    public:
+        struct Bucket
+        {
+            std::int64_t start;
+            std::int64_t downloaded;
+            std::int64_t uploaded;
+        };
+
+        // Adds to the bucket, creating it if needed.
+        static void Add(sqlite3* db, const std::string& info_hash, int period, const Bucket& bucket);
+        static std::vector<Bucket> Get(sqlite3* db, const std::string& info_hash, int period, std::int64_t from, std::int64_t to);
+        static void Prune(sqlite3* db, int period, std::int64_t before);
+        static void Remove(sqlite3* db, const std::string& info_hash);
+    };
+}
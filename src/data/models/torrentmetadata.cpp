@@ -0,0 +1,92 @@
+#include "torrentmetadata.hpp"
+
+#include "addtorrentparams.hpp"
+#include "../statement.hpp"
+
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using porla::Data::Models::AddTorrentParams;
+using porla::Data::Models::TorrentMetadata;
+using porla::Data::Statement;
+
+static json Value(const Statement::IRow& row, int index)
+{
+    const auto blob = row.GetBlob(index);
+    return json::from_cbor(blob.begin(), blob.end());
+}
+
+std::map<std::string, json> TorrentMetadata::Get(sqlite3* db, const lt::info_hash_t& hash)
+{
+    std::map<std::string, json> metadata;
+
+    Statement::PrepareCached(db, "SELECT key, value FROM torrentmetadata WHERE info_hash = $1;")
+        .Bind(1, AddTorrentParams::Key(hash))
+        .Step(
+            [&metadata](const Statement::IRow& row)
+            {
+                metadata.emplace(row.GetStdString(0), Value(row, 1));
+                return SQLITE_OK;
+            });
+
+    return metadata;
+}
+
+std::optional<json> TorrentMetadata::Get(sqlite3* db, const lt::info_hash_t& hash, const std::string& key)
+{
+    std::optional<json> value;
+
+    Statement::PrepareCached(db, "SELECT value FROM torrentmetadata WHERE info_hash = $1 AND key = $2;")
+        .Bind(1, AddTorrentParams::Key(hash))
+        .Bind(2, std::string_view(key))
+        .Step(
+            [&value](const Statement::IRow& row)
+            {
+                value = Value(row, 0);
+                return SQLITE_OK;
+            });
+
+    return value;
+}
+
+void TorrentMetadata::ForEach(
+    sqlite3* db,
+    const std::string& key,
+    const std::function<void(const lt::info_hash_t&, json&&)>& cb)
+{
+    Statement::Prepare(db, "SELECT info_hash, value FROM torrentmetadata WHERE key = $1;")
+        .Bind(1, std::string_view(key))
+        .Step(
+            [&cb](const Statement::IRow& row)
+            {
+                cb(AddTorrentParams::FromKey(row.GetBlob(0)), Value(row, 1));
+                return SQLITE_OK;
+            });
+}
+
+void TorrentMetadata::Remove(sqlite3* db, const lt::info_hash_t& hash)
+{
+    Statement::PrepareCached(db, "DELETE FROM torrentmetadata WHERE info_hash = $1;")
+        .Bind(1, AddTorrentParams::Key(hash))
+        .Execute();
+}
+
+void TorrentMetadata::Remove(sqlite3* db, const lt::info_hash_t& hash, const std::string& key)
+{
+    Statement::PrepareCached(db, "DELETE FROM torrentmetadata WHERE info_hash = $1 AND key = $2;")
+        .Bind(1, AddTorrentParams::Key(hash))
+        .Bind(2, std::string_view(key))
+        .Execute();
+}
+
+void TorrentMetadata::Set(sqlite3* db, const lt::info_hash_t& hash, const std::string& key, const json& value)
+{
+    std::vector<char> cbor;
+    json::to_cbor(value, cbor);
+
+    Statement::PrepareCached(db, "INSERT OR REPLACE INTO torrentmetadata (info_hash, key, value) VALUES ($1, $2, $3);")
+        .Bind(1, AddTorrentParams::Key(hash))
+        .Bind(2, std::string_view(key))
+        .Bind(3, std::span<const char>(cbor))
+        .Execute();
+}
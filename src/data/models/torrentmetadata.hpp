@@ -0,0 +1,31 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+#include <sqlite3.h>
+
+namespace porla::Data::Models
+{
+    // Metadata set by clients, one row per torrent and key with the value as CBOR. Torrents
+    // are keyed the same as in addtorrentparams.
+    class TorrentMetadata
+    {
+    public:
+        static std::map<std::string, nlohmann::json> Get(sqlite3* db, const libtorrent::info_hash_t& hash);
+        static std::optional<nlohmann::json> Get(sqlite3* db, const libtorrent::info_hash_t& hash, const std::string& key);
+        // Calls cb with the value of the key for every torrent which has it.
+        static void ForEach(
+            sqlite3* db,
+            const std::string& key,
+            const std::function<void(const libtorrent::info_hash_t&, nlohmann::json&&)>& cb);
+        static void Remove(sqlite3* db, const libtorrent::info_hash_t& hash);
+        static void Remove(sqlite3* db, const libtorrent::info_hash_t& hash, const std::string& key);
+        static void Set(sqlite3* db, const libtorrent::info_hash_t& hash, const std::string& key, const nlohmann::json& value);
+    };
+}
@@ -0,0 +1,47 @@
+#include "workflowruns.hpp"
+
+#include "../statement.hpp"
+
+using porla::Data::Models::WorkflowRuns;
+using porla::Data::Statement;
+
+void WorkflowRuns::ForEach(sqlite3* db, const std::function<void(Run&&)>& cb)
+{
+    Statement::Prepare(db, "SELECT id, workflow, contexts, stage, outputs, queued_at FROM workflowruns ORDER BY id ASC;")
+        .Step(
+            [&cb](const Statement::IRow& row)
+            {
+                cb(Run{
+                    .id        = row.GetInt64(0),
+                    .workflow  = row.GetStdString(1),
+                    .contexts  = row.GetStdString(2),
+                    .stage     = row.GetInt32(3),
+                    .outputs   = row.GetStdString(4),
+                    .queued_at = row.GetInt64(5)
+                });
+
+                return SQLITE_OK;
+            });
+}
+
+void WorkflowRuns::Remove(sqlite3* db, std::int64_t id)
+{
+    Statement::PrepareCached(db, "DELETE FROM workflowruns WHERE id = $1;")
+        .Bind(1, id)
+        .Execute();
+}
+
+void WorkflowRuns::Upsert(sqlite3* db, const Run& run)
+{
+    Statement::PrepareCached(
+        db,
+        "INSERT INTO workflowruns (id, workflow, contexts, stage, outputs, queued_at) VALUES ($1, $2, $3, $4, $5, $6)\n"
+        "ON CONFLICT (id) DO UPDATE SET stage = excluded.stage, outputs = excluded.outputs;")
+        .Bind(1, run.id)
+        .Bind(2, std::string_view(run.workflow))
+        .Bind(3, std::string_view(run.contexts))
+        .Bind(4, run.stage)
+        .Bind(5, std::string_view(run.outputs))
+        .Bind(6, run.queued_at)
+        .Execute();
+}
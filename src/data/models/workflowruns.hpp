@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <sqlite3.h>
+
+namespace porla::Data::Models
+{
+    // Checkpoints of workflow runs which are not done. Contexts and outputs are JSON, the
+    // contexts naming the torrents of the run by info hash.
+    class WorkflowRuns
+    {
+    public:
+        struct Run
+        {
+            std::int64_t id;
+            std::string  workflow;
+            std::string  contexts;
+            int          stage;
+            std::string  outputs;
+            std::int64_t queued_at;
+        };
+
+        // In the order the runs were queued.
+        static void ForEach(sqlite3* db, const std::function<void(Run&&)>& cb);
+        static void Remove(sqlite3* db, std::int64_t id);
+        static void Upsert(sqlite3* db, const Run& run);
+    };
+}
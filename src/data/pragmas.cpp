@@ -0,0 +1,83 @@
+#include "pragmas.hpp"
+
+#include <string_view>
+#include <unordered_set>
+
+#include <boost/log/trivial.hpp>
+
+static bool Exec(sqlite3* db, const std::string& sql)
+{
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to execute '" << sql << "': " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    return true;
+}
+
+bool porla::Data::ApplyPragmas(sqlite3* db, const Pragmas& pragmas)
+{
+    static const std::unordered_set<std::string> JournalModes = {"delete", "memory", "off", "persist", "truncate", "wal"};
+    static const std::unordered_set<std::string> SynchronousModes = {"extra", "full", "normal", "off"};
+
+    if (pragmas.busy_timeout.has_value() && sqlite3_busy_timeout(db, *pragmas.busy_timeout) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to set busy timeout: " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (pragmas.journal_mode.has_value())
+    {
+        if (!JournalModes.contains(*pragmas.journal_mode))
+        {
+            BOOST_LOG_TRIVIAL(error) << "Invalid journal mode: " << *pragmas.journal_mode;
+            return false;
+        }
+
+        if (!Exec(db, "PRAGMA journal_mode=" + *pragmas.journal_mode + ";")) return false;
+    }
+
+    if (pragmas.synchronous.has_value())
+    {
+        if (!SynchronousModes.contains(*pragmas.synchronous))
+        {
+            BOOST_LOG_TRIVIAL(error) << "Invalid synchronous mode: " << *pragmas.synchronous;
+            return false;
+        }
+
+        if (!Exec(db, "PRAGMA synchronous=" + *pragmas.synchronous + ";")) return false;
+    }
+
+    if (pragmas.cache_size.has_value()
+        && !Exec(db, "PRAGMA cache_size=" + std::to_string(*pragmas.cache_size) + ";"))
+    {
+        return false;
+    }
+
+    if (pragmas.mmap_size.has_value()
+        && !Exec(db, "PRAGMA mmap_size=" + std::to_string(*pragmas.mmap_size) + ";"))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool porla::Data::InWalMode(sqlite3* db)
+{
+    bool wal = false;
+
+    sqlite3_exec(
+        db,
+        "PRAGMA journal_mode;",
+        [](void* user, int, char** values, char**)
+        {
+            *static_cast<bool*>(user) = values[0] != nullptr && std::string_view(values[0]) == "wal";
+            return SQLITE_OK;
+        },
+        &wal,
+        nullptr);
+
+    return wal;
+}
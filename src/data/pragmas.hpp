@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <sqlite3.h>
+
+namespace porla::Data
+{
+    // Connection tuning applied to every SQLite connection porla opens. Unset values keep
+    // the SQLite defaults.
+    struct Pragmas
+    {
+        std::optional<int>         busy_timeout;
+        std::optional<int>         cache_size;
+        std::optional<std::string> journal_mode;
+        std::optional<int64_t>     mmap_size;
+        std::optional<std::string> synchronous;
+    };
+
+    bool ApplyPragmas(sqlite3* db, const Pragmas& pragmas);
+    bool InWalMode(sqlite3* db);
+}
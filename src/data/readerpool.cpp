@@ -0,0 +1,115 @@
+#include "readerpool.hpp"
+
+#include <cstring>
+
+#include <boost/log/trivial.hpp>
+
+#include "statement.hpp"
+
+using porla::Data::ReaderPool;
+
+ReaderPool::Lease::Lease(ReaderPool* pool, sqlite3* db)
+    : m_pool(pool)
+    , m_db(db)
+{
+}
+
+ReaderPool::Lease::Lease(Lease&& other) noexcept
+    : m_pool(other.m_pool)
+    , m_db(other.m_db)
+{
+    other.m_db = nullptr;
+}
+
+ReaderPool::Lease::~Lease()
+{
+    if (m_db != nullptr)
+    {
+        m_pool->Release(m_db);
+    }
+}
+
+ReaderPool::ReaderPool(sqlite3* writer, const Pragmas& pragmas, int size)
+    : m_stats{}
+{
+    const char* filename = sqlite3_db_filename(writer, "main");
+
+    if (filename == nullptr || strlen(filename) == 0)
+    {
+        return;
+    }
+
+    // The journal mode and synchronous setting belong to the writer.
+    Pragmas reader_pragmas = pragmas;
+    reader_pragmas.journal_mode.reset();
+    reader_pragmas.synchronous.reset();
+
+    for (int i = 0; i < size; i++)
+    {
+        sqlite3* db = nullptr;
+
+        // Each connection is used by one thread at a time, so SQLite need not lock it.
+        if (sqlite3_open_v2(filename, &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to open SQLite reader connection: " << sqlite3_errmsg(db);
+            sqlite3_close(db);
+            break;
+        }
+
+        if (!ApplyPragmas(db, reader_pragmas))
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to apply SQLite settings to reader connection";
+        }
+
+        m_connections.push_back(db);
+    }
+
+    m_free = m_connections;
+}
+
+ReaderPool::~ReaderPool()
+{
+    for (auto db : m_connections)
+    {
+        Statement::ClearCache(db);
+
+        if (sqlite3_close(db) != SQLITE_OK)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to close SQLite reader connection: " << sqlite3_errmsg(db);
+        }
+    }
+}
+
+ReaderPool::Lease ReaderPool::Acquire()
+{
+    std::unique_lock lock(m_mtx);
+
+    m_stats.acquired++;
+
+    if (m_free.empty())
+    {
+        m_stats.waited++;
+        m_cv.wait(lock, [this] { return !m_free.empty(); });
+    }
+
+    sqlite3* db = m_free.back();
+    m_free.pop_back();
+
+    return { this, db };
+}
+
+ReaderPool::Stats ReaderPool::GetStats()
+{
+    std::unique_lock lock(m_mtx);
+    return m_stats;
+}
+
+void ReaderPool::Release(sqlite3* db)
+{
+    {
+        std::unique_lock lock(m_mtx);
+        m_free.push_back(db);
+    }
+
+    m_cv.notify_one();
+}
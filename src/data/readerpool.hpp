@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "pragmas.hpp"
+
+namespace porla::Data
+{
+    // A few read-only connections to the database for queries off the io thread. In WAL
+    // mode each read sees a snapshot of its own, so it neither waits for nor holds up the
+    // writers. Databases without a file, such as in-memory ones, get no readers.
+    class ReaderPool
+    {
+    public:
+        struct Stats
+        {
+            std::uint64_t acquired;
+            std::uint64_t waited;
+        };
+
+        // A connection borrowed from the pool, returned when the lease is destroyed. Only
+        // used from one thread at a time.
+        class Lease
+        {
+        public:
+            Lease(Lease&& other) noexcept;
+            Lease(const Lease&) = delete;
+            ~Lease();
+
+            sqlite3* Get() const { return m_db; }
+
+        private:
+            friend class ReaderPool;
+
+            Lease(ReaderPool* pool, sqlite3* db);
+
+            ReaderPool* m_pool;
+            sqlite3*    m_db;
+        };
+
+        // Opens size connections to the same file as writer, with its pragmas except the
+        // ones only a writer can set.
+        explicit ReaderPool(sqlite3* writer, const Pragmas& pragmas, int size = 2);
+        ReaderPool(const ReaderPool&) = delete;
+
+        ~ReaderPool();
+
+        // Blocks until a connection is free. Must not be called when Size is zero.
+        Lease Acquire();
+
+        [[nodiscard]] std::size_t Size() const { return m_connections.size(); }
+        [[nodiscard]] Stats GetStats();
+
+    private:
+        void Release(sqlite3* db);
+
+        std::vector<sqlite3*> m_connections;
+
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::vector<sqlite3*> m_free;
+        Stats m_stats;
+    };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+namespace porla::Data
+{
+    // How a resume data blob is stored in the addtorrentparams table.
+    enum class ResumeDataEncoding
+    {
+        // Bencoded, as written by libtorrent.
+        None = 0,
+        // zlib deflate, primed with a dictionary of the keys and values every resume file
+        // shares, which small resume files otherwise have too little data to learn.
+        DeflateV1 = 1
+    };
+
+    class ResumeDataCodec
+    {
+    public:
+        // Throws std::runtime_error if zlib fails.
+        static std::vector<char> Compress(const std::vector<char>& data);
+
+        // Returns false if the data is corrupt or uses an unknown encoding.
+        static bool Decompress(ResumeDataEncoding encoding, std::span<const char> data, std::vector<char>& out);
+    };
+}
@@ -1,7 +1,12 @@
 #include "statement.hpp"
 
+#include <map>
+#include <mutex>
+
 #include <boost/log/trivial.hpp>
 
+#include "../tracing.hpp"
+
 using porla::Data::Statement;
 
 class InternalRow : public Statement::IRow
@@ -17,40 +22,78 @@ public:
         return sqlite3_column_int(m_stmt, pos);
     }
 
-    [[nodiscard]] std::vector<char> GetBuffer(int pos) const override
+    [[nodiscard]] std::int64_t GetInt64(int pos) const override
+    {
+        return sqlite3_column_int64(m_stmt, pos);
+    }
+
+    // The pointer has to be taken before the size, which would otherwise be the size of
+    // a converted value.
+    [[nodiscard]] std::span<const char> GetBlob(int pos) const override
     {
-        int len = sqlite3_column_bytes(m_stmt, pos);
         const char* buf = static_cast<const char*>(sqlite3_column_blob(m_stmt, pos));
-        return {buf, buf + len};
+        return { buf, static_cast<std::size_t>(sqlite3_column_bytes(m_stmt, pos)) };
     }
 
-    [[nodiscard]] std::string GetStdString(int pos) const override
+    [[nodiscard]] std::string_view GetStringView(int pos) const override
     {
-        auto data = sqlite3_column_text(m_stmt, pos);
-        return
-        {
-            reinterpret_cast<const char*>(data),
-            static_cast<unsigned long>(sqlite3_column_bytes(m_stmt, pos))
-        };
+        const char* data = reinterpret_cast<const char*>(sqlite3_column_text(m_stmt, pos));
+        return { data, static_cast<std::size_t>(sqlite3_column_bytes(m_stmt, pos)) };
     }
 
 private:
     sqlite3_stmt* m_stmt;
 };
 
-Statement::Statement(sqlite3_stmt *stmt)
+// Idle (not currently in use) prepared statements, per connection and SQL text. A
+// statement is taken out of the cache while in use so the same SQL can be prepared
+// concurrently from several threads.
+static std::mutex StatementCacheMutex;
+static std::map<sqlite3*, std::map<std::string, std::vector<sqlite3_stmt*>, std::less<>>> StatementCache;
+
+Statement::Statement(sqlite3_stmt *stmt, std::optional<std::string> cache_key)
     : m_stmt(stmt)
+    , m_cache_key(std::move(cache_key))
 {
 }
 
 Statement::~Statement()
 {
+    if (m_cache_key.has_value())
+    {
+        sqlite3_reset(m_stmt);
+        sqlite3_clear_bindings(m_stmt);
+
+        std::unique_lock lock(StatementCacheMutex);
+        StatementCache[sqlite3_db_handle(m_stmt)][*m_cache_key].push_back(m_stmt);
+
+        return;
+    }
+
     if (sqlite3_finalize(m_stmt) != SQLITE_OK)
     {
         BOOST_LOG_TRIVIAL(error) << "Failed to finalize SQLite statement";
     }
 }
 
+void Statement::ClearCache(sqlite3* db)
+{
+    std::unique_lock lock(StatementCacheMutex);
+
+    auto connection = StatementCache.find(db);
+    if (connection == StatementCache.end()) { return; }
+
+    for (auto const& [_, stmts] : connection->second)
+    {
+        for (auto stmt : stmts)
+        {
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    StatementCache.erase(connection);
+}
+
 Statement Statement::Prepare(sqlite3 *db, const std::string_view &sql)
 {
     sqlite3_stmt* stmt;
@@ -64,6 +107,34 @@ Statement Statement::Prepare(sqlite3 *db, const std::string_view &sql)
     return Statement(stmt);
 }
 
+Statement Statement::PrepareCached(sqlite3* db, const std::string_view& sql)
+{
+    {
+        std::unique_lock lock(StatementCacheMutex);
+
+        if (auto connection = StatementCache.find(db); connection != StatementCache.end())
+        {
+            if (auto stmts = connection->second.find(sql);
+                stmts != connection->second.end() && !stmts->second.empty())
+            {
+                sqlite3_stmt* stmt = stmts->second.back();
+                stmts->second.pop_back();
+                return Statement(stmt, std::string(sql));
+            }
+        }
+    }
+
+    sqlite3_stmt* stmt;
+
+    if (sqlite3_prepare_v3(db, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to prepare SQLite statement: " << sqlite3_errmsg(db);
+        throw std::runtime_error("Failed to prepare SQLite statement: " + std::string(sqlite3_errmsg(db)));
+    }
+
+    return Statement(stmt, std::string(sql));
+}
+
 Statement& Statement::Bind(int pos, int value)
 {
     if (sqlite3_bind_int(m_stmt, pos, value) != SQLITE_OK)
@@ -75,6 +146,17 @@ Statement& Statement::Bind(int pos, int value)
     return *this;
 }
 
+Statement& Statement::Bind(int pos, std::int64_t value)
+{
+    if (sqlite3_bind_int64(m_stmt, pos, value) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to bind SQLite value";
+        throw std::runtime_error("Failed to bind SQLite value");
+    }
+
+    return *this;
+}
+
 Statement& Statement::Bind(int pos, const std::string_view &value)
 {
     if (sqlite3_bind_text(m_stmt, pos, value.data(), static_cast<int>(value.size()), nullptr) != SQLITE_OK)
@@ -112,8 +194,28 @@ Statement& Statement::Bind(int pos, const std::vector<char>& buffer)
     return *this;
 }
 
+Statement& Statement::Bind(int pos, std::span<const char> buffer)
+{
+    if (sqlite3_bind_blob(m_stmt, pos, buffer.data(), static_cast<int>(buffer.size()), SQLITE_STATIC) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to bind SQLite value";
+        throw std::runtime_error("Failed to bind SQLite value");
+    }
+
+    return *this;
+}
+
+// Statements run while a traced request is current get their own span.
+static void Annotate(const std::shared_ptr<porla::TraceSpan>& span, sqlite3_stmt* stmt)
+{
+    if (span) { span->SetAttribute("db.statement", sqlite3_sql(stmt)); }
+}
+
 void Statement::Execute()
 {
+    porla::ScopedSpan span("sqlite");
+    Annotate(span.Get(), m_stmt);
+
     int res = sqlite3_step(m_stmt);
 
     if (res == SQLITE_DONE)
@@ -128,6 +230,9 @@ void Statement::Execute()
 
 void Statement::Step(const std::function<int(const Statement::IRow&)>& cb)
 {
+    porla::ScopedSpan span("sqlite");
+    Annotate(span.Get(), m_stmt);
+
     do
     {
         switch (int res = sqlite3_step(m_stmt))
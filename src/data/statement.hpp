@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <sqlite3.h>
@@ -15,9 +18,24 @@ namespace porla::Data
         class IRow
         {
         public:
-            virtual std::vector<char> GetBuffer(int index) const = 0;
+            // Views over SQLite's memory for the column, valid until the step callback
+            // returns.
+            virtual std::span<const char> GetBlob(int index) const = 0;
             virtual int GetInt32(int index) const = 0;
-            virtual std::string GetStdString(int index) const = 0;
+            virtual std::int64_t GetInt64(int index) const = 0;
+            virtual std::string_view GetStringView(int index) const = 0;
+
+            // Copies, for values kept after the step.
+            std::vector<char> GetBuffer(int index) const
+            {
+                const auto blob = GetBlob(index);
+                return { blob.begin(), blob.end() };
+            }
+
+            std::string GetStdString(int index) const
+            {
+                return std::string(GetStringView(index));
+            }
         };
 
         ~Statement();
@@ -25,17 +43,30 @@ namespace porla::Data
 
         static Statement Prepare(sqlite3* db, const std::string_view& sql);
 
+        // Like Prepare, but the compiled statement is kept in a per-connection cache and
+        // reset (instead of finalized) when this Statement goes out of scope. Use for
+        // statements that run often.
+        static Statement PrepareCached(sqlite3* db, const std::string_view& sql);
+
+        // Finalizes every cached statement for the connection. Must be called before the
+        // connection is closed.
+        static void ClearCache(sqlite3* db);
+
         Statement& Bind(int pos, int value);
+        Statement& Bind(int pos, std::int64_t value);
         Statement& Bind(int pos, const std::string_view& value);
         Statement& Bind(int pos, const std::optional<std::string_view>& value);
         Statement& Bind(int pos, const std::vector<char>& buffer);
+        // Binds the blob without copying it, so it has to outlive the Execute or Step.
+        Statement& Bind(int pos, std::span<const char> buffer);
 
         void Execute();
         void Step(const std::function<int(const IRow&)>& cb);
 
     private:
-        explicit Statement(sqlite3_stmt* stmt);
+        explicit Statement(sqlite3_stmt* stmt, std::optional<std::string> cache_key = std::nullopt);
 
         sqlite3_stmt* m_stmt;
+        std::optional<std::string> m_cache_key;
     };
 }
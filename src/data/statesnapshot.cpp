@@ -0,0 +1,455 @@
+#include "statesnapshot.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "statement.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Data::Models::AddTorrentParams;
+using porla::Data::StateSnapshot;
+
+// Records are gathered into a buffer of about this size before each write.
+static constexpr std::size_t WriteChunk = 1024 * 1024;
+
+static std::int64_t NowMillis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::uint32_t Crc(std::uint32_t crc, const char* data, std::size_t size)
+{
+    // crc32 takes at most an uInt at a time.
+    while (size > 0)
+    {
+        const auto n = static_cast<uInt>(std::min<std::size_t>(size, 1u << 30));
+        crc  = static_cast<std::uint32_t>(crc32(crc, reinterpret_cast<const Bytef*>(data), n));
+        data += n;
+        size -= n;
+    }
+
+    return crc;
+}
+
+static std::size_t Padded(std::size_t size)
+{
+    return (size + 7) & ~std::size_t(7);
+}
+
+static bool WriteAll(int fd, const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t n = write(fd, data, size);
+
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+
+    return true;
+}
+
+std::optional<StateSnapshot::LoadStats> StateSnapshot::ForEachRow(
+    sqlite3* db,
+    const fs::path& file,
+    const std::function<void(AddTorrentParams::Row&&)>& cb)
+{
+    const int fd = open(file.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    struct stat st{};
+
+    if (fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header))
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to map state snapshot " << file << ": " << std::strerror(errno);
+        return std::nullopt;
+    }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const auto* base = static_cast<const char*>(map);
+
+    Header header{};
+    std::memcpy(&header, base, sizeof(Header));
+
+    // Everything is checked before the first row is handed out, so a broken file never
+    // loads some torrents twice or from two different revisions.
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+        || header.version != Version
+        || header.body_size != size - sizeof(Header)
+        || Crc(0, base + sizeof(Header), header.body_size) != header.crc)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Ignoring state snapshot " << file << " which is incomplete or damaged";
+        munmap(map, size);
+        return std::nullopt;
+    }
+
+    // The key of every record to where its record starts.
+    std::unordered_map<std::string_view, std::size_t> records;
+    records.reserve(header.count);
+
+    std::size_t offset = sizeof(Header);
+    bool valid = true;
+
+    for (std::uint64_t i = 0; i < header.count && valid; i++)
+    {
+        Record record{};
+
+        if (offset + sizeof(Record) > size)
+        {
+            valid = false;
+            break;
+        }
+
+        std::memcpy(&record, base + offset, sizeof(Record));
+
+        const std::uint64_t payload = std::uint64_t(record.key_size) + record.name_size + record.save_path_size
+            + record.client_data_size + record.info_size + record.resume_data_size;
+
+        valid = record.size % 8 == 0
+            && record.size >= sizeof(Record) + payload
+            && offset + record.size <= size;
+
+        if (valid)
+        {
+            records.insert({ std::string_view(base + offset + sizeof(Record), record.key_size), offset });
+            offset += record.size;
+        }
+    }
+
+    if (!valid || offset != size)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Ignoring state snapshot " << file << " with invalid records";
+        munmap(map, size);
+        return std::nullopt;
+    }
+
+    LoadStats stats;
+
+    try
+    {
+        // The database decides which torrents there are and their order, from an index
+        // which is much smaller than the rows. Rows changed or added since the snapshot
+        // are read from the database, and removed ones are in neither.
+        AddTorrentParams::ForEachRevision(
+            db,
+            [&](std::span<const char> key, std::int64_t revision)
+            {
+                const auto found = records.find(std::string_view(key.data(), key.size()));
+
+                Record record{};
+                if (found != records.end()) std::memcpy(&record, base + found->second, sizeof(Record));
+
+                if (found == records.end() || record.revision != revision)
+                {
+                    if (auto row = AddTorrentParams::GetRow(db, key))
+                    {
+                        stats.database++;
+                        cb(std::move(*row));
+                    }
+
+                    return;
+                }
+
+                const char* data = base + found->second + sizeof(Record) + record.key_size;
+
+                const auto take = [&data](std::uint32_t length)
+                {
+                    const char* start = data;
+                    data += length;
+                    return std::string_view(start, length);
+                };
+
+                const auto name        = take(record.name_size);
+                const auto save_path   = take(record.save_path_size);
+                const auto client_data = take(record.client_data_size);
+                const auto info        = take(record.info_size);
+                const auto resume      = take(record.resume_data_size);
+
+                stats.snapshot++;
+
+                cb(AddTorrentParams::Row{
+                    .client_data          = std::string(client_data),
+                    .client_data_encoding = record.client_data_encoding,
+                    .info_buf             = std::vector<char>(info.begin(), info.end()),
+                    .info_encoding        = record.info_encoding,
+                    .info_hash            = AddTorrentParams::FromKey(key),
+                    .name                 = std::string(name),
+                    .resume_data_buf      = std::vector<char>(resume.begin(), resume.end()),
+                    .resume_data_encoding = record.resume_data_encoding,
+                    .save_path            = std::string(save_path),
+                    .parked               = record.parked != 0,
+                    .revision             = record.revision
+                });
+            });
+    }
+    catch (...)
+    {
+        munmap(map, size);
+        throw;
+    }
+
+    munmap(map, size);
+
+    return stats;
+}
+
+std::optional<std::string> StateSnapshot::Write(sqlite3* db, const fs::path& file)
+{
+    const auto partial = fs::path(file.string() + ".tmp");
+
+    const int fd = open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        return std::string("Failed to open ") + partial.string() + ": " + std::strerror(errno);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version    = Version;
+    header.created_at = NowMillis();
+
+    std::vector<char> buffer;
+    buffer.reserve(WriteChunk * 2);
+
+    std::optional<std::string> error;
+
+    const auto flush = [&]()
+    {
+        header.crc        = Crc(header.crc, buffer.data(), buffer.size());
+        header.body_size += buffer.size();
+
+        if (!WriteAll(fd, buffer.data(), buffer.size()) && !error.has_value())
+        {
+            error = std::string("Failed to write state snapshot: ") + std::strerror(errno);
+        }
+
+        buffer.clear();
+    };
+
+    // Room for the header, which is written once the count and checksum are known.
+    if (lseek(fd, sizeof(Header), SEEK_SET) < 0)
+    {
+        error = std::string("Failed to write state snapshot: ") + std::strerror(errno);
+    }
+
+    try
+    {
+        // One statement, so in WAL mode every row is from the same commit.
+        AddTorrentParams::ForEachRowView(
+            db,
+            [&](const AddTorrentParams::RowView& row)
+            {
+                if (error.has_value()) return;
+
+                const auto key = AddTorrentParams::Key(row.info_hash);
+
+                Record record{
+                    .key_size             = static_cast<std::uint8_t>(key.size()),
+                    .parked               = static_cast<std::uint8_t>(row.parked ? 1 : 0),
+                    .revision             = row.revision,
+                    .client_data_encoding = row.client_data_encoding,
+                    .info_encoding        = row.info_encoding,
+                    .resume_data_encoding = row.resume_data_encoding,
+                    .name_size            = static_cast<std::uint32_t>(row.name.size()),
+                    .save_path_size       = static_cast<std::uint32_t>(row.save_path.size()),
+                    .client_data_size     = static_cast<std::uint32_t>(row.client_data.size()),
+                    .info_size            = static_cast<std::uint32_t>(row.info_buf.size()),
+                    .resume_data_size     = static_cast<std::uint32_t>(row.resume_data_buf.size())
+                };
+
+                const std::size_t payload = key.size() + row.name.size() + row.save_path.size()
+                    + row.client_data.size() + row.info_buf.size() + row.resume_data_buf.size();
+
+                record.size = static_cast<std::uint32_t>(Padded(sizeof(Record) + payload));
+
+                const auto start = buffer.size();
+                buffer.resize(start + record.size, 0);
+
+                char* out = buffer.data() + start;
+                std::memcpy(out, &record, sizeof(Record));
+                out += sizeof(Record);
+
+                for (const std::string_view part : {
+                    std::string_view(key.data(), key.size()),
+                    row.name,
+                    row.save_path,
+                    row.client_data,
+                    std::string_view(row.info_buf.data(), row.info_buf.size()),
+                    std::string_view(row.resume_data_buf.data(), row.resume_data_buf.size()) })
+                {
+                    if (!part.empty()) std::memcpy(out, part.data(), part.size());
+                    out += part.size();
+                }
+
+                header.count++;
+
+                if (buffer.size() >= WriteChunk) flush();
+            });
+    }
+    catch (const std::exception& ex)
+    {
+        error = ex.what();
+    }
+
+    if (!error.has_value()) flush();
+
+    if (!error.has_value()
+        && (pwrite(fd, &header, sizeof(Header), 0) != static_cast<ssize_t>(sizeof(Header)) || fsync(fd) < 0))
+    {
+        error = std::string("Failed to write state snapshot: ") + std::strerror(errno);
+    }
+
+    close(fd);
+
+    std::error_code ec;
+
+    if (!error.has_value())
+    {
+        fs::rename(partial, file, ec);
+        if (ec) error = ec.message();
+    }
+
+    if (error.has_value())
+    {
+        fs::remove(partial, ec);
+        return error;
+    }
+
+    // Makes the rename itself durable.
+    if (const int dir = open(file.has_parent_path() ? file.parent_path().c_str() : ".", O_RDONLY); dir >= 0)
+    {
+        fsync(dir);
+        close(dir);
+    }
+
+    return std::nullopt;
+}
+
+StateSnapshot::StateSnapshot(StateSnapshotOptions options)
+    : m_options(std::move(options))
+    , m_db(nullptr)
+    , m_stopping(false)
+{
+    if (m_options.source.empty() || m_options.source == ":memory:")
+    {
+        BOOST_LOG_TRIVIAL(warning) << "State snapshots need a database stored in a file";
+        return;
+    }
+
+    if (sqlite3_open_v2(m_options.source.c_str(), &m_db, SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to open database for state snapshots: " << sqlite3_errmsg(m_db);
+        sqlite3_close(m_db);
+        m_db = nullptr;
+        return;
+    }
+
+    sqlite3_busy_timeout(m_db, 5000);
+
+    m_thread = std::thread([this]() { Run(); });
+}
+
+StateSnapshot::~StateSnapshot()
+{
+    {
+        std::unique_lock lock(m_mtx);
+        m_stopping = true;
+    }
+
+    m_cv.notify_all();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    if (m_db != nullptr)
+    {
+        Statement::ClearCache(m_db);
+        sqlite3_close(m_db);
+    }
+}
+
+void StateSnapshot::Run()
+{
+    const auto interval = std::max(std::chrono::seconds(1), m_options.interval);
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_mtx);
+            if (m_cv.wait_for(lock, interval, [this] { return m_stopping; })) break;
+        }
+
+        int version = 0;
+
+        try
+        {
+            Statement::Prepare(m_db, "PRAGMA data_version;").Step(
+                [&version](const Statement::IRow& row)
+                {
+                    version = row.GetInt32(0);
+                    return SQLITE_OK;
+                });
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to read database version for state snapshot: " << ex.what();
+            continue;
+        }
+
+        if (m_version == version)
+        {
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        if (const auto error = Write(m_db, m_options.file); error.has_value())
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to write state snapshot " << m_options.file << ": " << *error;
+            continue;
+        }
+
+        m_version = version;
+
+        BOOST_LOG_TRIVIAL(debug) << "Wrote state snapshot " << m_options.file << " in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms";
+    }
+}
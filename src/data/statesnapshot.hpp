@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <sqlite3.h>
+
+#include "models/addtorrentparams.hpp"
+
+namespace porla::Data
+{
+    struct StateSnapshotOptions
+    {
+        // The database file, read from a connection of its own.
+        std::string           source;
+        std::filesystem::path file;
+        std::chrono::seconds  interval = std::chrono::seconds(300);
+    };
+
+    // Keeps a copy of the stored torrents in one flat file, written in the background, so
+    // a restart reads them from a memory mapped file instead of walking the database. Every
+    // row carries its revision, and loading takes from the snapshot only the rows whose
+    // revision still matches the database, reading the others from the database. The
+    // header, with a checksum of everything after it, is written last and the file renamed
+    // into place, so a crash leaves either the previous snapshot or a complete new one.
+    class StateSnapshot
+    {
+    public:
+        static constexpr char          Magic[8] = {'P', 'O', 'R', 'L', 'A', 'A', 'T', 'P'};
+        static constexpr std::uint32_t Version  = 1;
+
+        struct Header
+        {
+            char          magic[8];
+            std::uint32_t version;
+            // zlib crc32 of every byte after the header.
+            std::uint32_t crc;
+            std::uint64_t count;
+            std::uint64_t body_size;
+            // Unix time in milliseconds.
+            std::int64_t  created_at;
+            std::uint64_t reserved[3];
+        };
+
+        // Followed by the key and the name, save path, client data, info dict and resume
+        // data, and padded to a multiple of eight bytes, which size includes.
+        struct Record
+        {
+            std::uint32_t size;
+            std::uint8_t  key_size;
+            std::uint8_t  parked;
+            std::uint8_t  reserved[2];
+            std::int64_t  revision;
+            std::int32_t  client_data_encoding;
+            std::int32_t  info_encoding;
+            std::int32_t  resume_data_encoding;
+            std::uint32_t name_size;
+            std::uint32_t save_path_size;
+            std::uint32_t client_data_size;
+            std::uint32_t info_size;
+            std::uint32_t resume_data_size;
+        };
+
+        static_assert(sizeof(Header) == 64);
+        static_assert(sizeof(Record) == 48);
+
+        struct LoadStats
+        {
+            std::size_t snapshot = 0;
+            std::size_t database = 0;
+        };
+
+        // Calls cb for every stored torrent, in the order AddTorrentParams::ForEachRow
+        // would. Returns an empty value without calling cb if the file is missing or fails
+        // to validate, which leaves loading to the database alone.
+        static std::optional<LoadStats> ForEachRow(
+            sqlite3* db,
+            const std::filesystem::path& file,
+            const std::function<void(Models::AddTorrentParams::Row&&)>& cb);
+
+        // Writes a snapshot of the database on the calling thread. Returns the error if it
+        // failed, in which case the previous snapshot is left as it was.
+        static std::optional<std::string> Write(sqlite3* db, const std::filesystem::path& file);
+
+        explicit StateSnapshot(StateSnapshotOptions options);
+        StateSnapshot(const StateSnapshot&) = delete;
+
+        ~StateSnapshot();
+
+    private:
+        void Run();
+
+        StateSnapshotOptions m_options;
+        sqlite3* m_db;
+        // Changes whenever another connection commits, so an unchanged database is not
+        // written again.
+        std::optional<int> m_version;
+
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        bool m_stopping;
+        std::thread m_thread;
+    };
+}
@@ -0,0 +1,286 @@
+#include "writebehindqueue.hpp"
+
+#include <cstring>
+
+#include <boost/log/trivial.hpp>
+
+#include "statement.hpp"
+
+using porla::Data::Models::AddTorrentParams;
+using porla::Data::Statement;
+using porla::Data::WriteBehindQueue;
+using porla::Data::WriteBehindQueueOptions;
+using porla::Data::WriteBehindQueueStats;
+
+WriteBehindQueue::WriteBehindQueue(const WriteBehindQueueOptions& options)
+    : m_options(options)
+    , m_db(options.db)
+    , m_owns_db(false)
+    , m_drain(false)
+    , m_flushing(false)
+    , m_writing(0)
+    , m_stopping(false)
+{
+    // Use a separate connection to the same database when possible so our transactions
+    // never interleave with statements executed on the io thread.
+    const char* filename = sqlite3_db_filename(options.db, "main");
+
+    if (filename != nullptr && strlen(filename) > 0)
+    {
+        sqlite3* db = nullptr;
+
+        if (sqlite3_open_v2(filename, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, nullptr) == SQLITE_OK)
+        {
+            if (!ApplyPragmas(db, options.pragmas))
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Failed to apply SQLite settings to write queue connection";
+            }
+
+            m_db = db;
+            m_owns_db = true;
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to open SQLite connection for write queue: " << sqlite3_errmsg(db);
+            sqlite3_close(db);
+        }
+    }
+
+    m_thread = std::thread([this] { Run(); });
+}
+
+WriteBehindQueue::~WriteBehindQueue()
+{
+    {
+        std::unique_lock lock(m_mtx);
+        m_stopping = true;
+    }
+
+    m_cv.notify_one();
+    m_thread.join();
+
+    if (m_owns_db)
+    {
+        Statement::ClearCache(m_db);
+
+        if (sqlite3_close(m_db) != SQLITE_OK)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to close SQLite connection: " << sqlite3_errmsg(m_db);
+        }
+    }
+}
+
+void WriteBehindQueue::Drain()
+{
+    std::unique_lock lock(m_mtx);
+
+    m_drain = true;
+    m_cv.notify_one();
+    m_drained.wait(lock, [this] { return m_pending.empty() && !m_flushing; });
+}
+
+void WriteBehindQueue::Flush()
+{
+    std::unique_lock lock(m_mtx);
+
+    m_drain = true;
+    m_cv.notify_one();
+}
+
+std::size_t WriteBehindQueue::Pending()
+{
+    std::unique_lock lock(m_mtx);
+    return m_pending.size() + m_writing;
+}
+
+void WriteBehindQueue::Remove(const libtorrent::info_hash_t& hash)
+{
+    Enqueue(hash, Operation{});
+}
+
+WriteBehindQueueStats WriteBehindQueue::Stats()
+{
+    std::unique_lock lock(m_stats_mtx);
+    return m_stats;
+}
+
+void WriteBehindQueue::UpdateClientData(const std::vector<std::pair<libtorrent::info_hash_t, TorrentClientData>>& torrents)
+{
+    {
+        std::unique_lock lock(m_mtx);
+
+        for (const auto& [hash, client_data] : torrents)
+        {
+            const auto pending = m_pending.find(hash);
+
+            if (pending == m_pending.end())
+            {
+                m_pending.insert({ hash, Operation{ .client_data = client_data, .client_data_only = true } });
+            }
+            // A pending removal wins, since the torrent is gone.
+            else if (pending->second.params.has_value() || pending->second.client_data_only)
+            {
+                pending->second.client_data = client_data;
+            }
+        }
+
+        // Written the way a drain is, in one transaction whatever the batch size, but
+        // without waiting for it.
+        m_drain = true;
+    }
+
+    m_cv.notify_one();
+}
+
+void WriteBehindQueue::Upsert(const libtorrent::info_hash_t& hash, const AddTorrentParams& params)
+{
+    // Copy the client data now since the torrent (which owns it) may be gone by the time
+    // the write happens.
+    Enqueue(hash, Operation{
+        .params      = params,
+        .client_data = params.client_data != nullptr ? *params.client_data : TorrentClientData{}
+    });
+}
+
+void WriteBehindQueue::Enqueue(const libtorrent::info_hash_t& hash, Operation op)
+{
+    bool notify;
+
+    {
+        std::unique_lock lock(m_mtx);
+        m_pending.insert_or_assign(hash, std::move(op));
+        notify = static_cast<int>(m_pending.size()) >= m_options.batch_size;
+    }
+
+    if (notify)
+    {
+        m_cv.notify_one();
+    }
+}
+
+void WriteBehindQueue::Run()
+{
+    std::unique_lock lock(m_mtx);
+
+    while (true)
+    {
+        m_cv.wait_for(
+            lock,
+            m_options.flush_interval,
+            [this]
+            {
+                return m_stopping
+                    || m_drain
+                    || static_cast<int>(m_pending.size()) >= m_options.batch_size;
+            });
+
+        if (m_pending.empty())
+        {
+            m_drain = false;
+            m_drained.notify_all();
+
+            if (m_stopping)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        std::map<libtorrent::info_hash_t, Operation> batch;
+
+        // When draining, everything pending is written in a single transaction.
+        if (m_drain || m_stopping)
+        {
+            batch.swap(m_pending);
+        }
+
+        while (!m_pending.empty() && static_cast<int>(batch.size()) < m_options.batch_size)
+        {
+            batch.insert(m_pending.extract(m_pending.begin()));
+        }
+
+        m_flushing = true;
+        m_writing  = batch.size();
+        lock.unlock();
+
+        Write(batch);
+
+        lock.lock();
+        m_flushing = false;
+        m_writing  = 0;
+
+        if (m_pending.empty())
+        {
+            m_drain = false;
+            m_drained.notify_all();
+        }
+    }
+}
+
+void WriteBehindQueue::Write(std::map<libtorrent::info_hash_t, Operation>& batch)
+{
+    if (sqlite3_exec(m_db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to begin transaction: " << sqlite3_errmsg(m_db);
+    }
+
+    for (auto& [hash, op] : batch)
+    {
+        try
+        {
+            if (op.client_data_only)
+            {
+                AddTorrentParams::UpdateClientData(m_db, hash, op.client_data);
+                m_clientDataRevisions.insert_or_assign(hash, op.client_data.revision);
+                continue;
+            }
+
+            if (!op.params.has_value())
+            {
+                AddTorrentParams::Remove(m_db, hash);
+                m_clientDataRevisions.erase(hash);
+                continue;
+            }
+
+            op.params->client_data = &op.client_data;
+
+            const auto written  = m_clientDataRevisions.find(hash);
+            const auto revision = written != m_clientDataRevisions.end() ? written->second : 0;
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto size  = AddTorrentParams::Update(m_db, hash, *op.params, m_options.compress, op.client_data.revision != revision);
+
+            if (sqlite3_changes(m_db) == 0)
+            {
+                AddTorrentParams::Insert(m_db, hash, *op.params, m_options.compress);
+            }
+
+            if (op.client_data.revision == 0)
+            {
+                m_clientDataRevisions.erase(hash);
+            }
+            else
+            {
+                m_clientDataRevisions.insert_or_assign(hash, op.client_data.revision);
+            }
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::unique_lock lock(m_stats_mtx);
+            m_stats.duration.Observe(elapsed.count());
+            m_stats.size.Observe(static_cast<double>(size));
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to persist torrent " << hash.get_best() << ": " << ex.what();
+        }
+    }
+
+    if (sqlite3_exec(m_db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to commit transaction: " << sqlite3_errmsg(m_db);
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Persisted " << batch.size() << " torrent(s)";
+}
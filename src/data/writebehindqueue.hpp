@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <sqlite3.h>
+
+#include "models/addtorrentparams.hpp"
+#include "pragmas.hpp"
+#include "../utils/histogram.hpp"
+#include "../torrentclientdata.hpp"
+
+namespace porla::Data
+{
+    struct WriteBehindQueueOptions
+    {
+        sqlite3*                  db;
+        std::chrono::milliseconds flush_interval;
+        int                       batch_size;
+        // Deflates the resume data of every row written.
+        bool                      compress = false;
+        Pragmas                   pragmas;
+    };
+
+    struct WriteBehindQueueStats
+    {
+        // Per torrent write, including encoding the resume data.
+        Utils::Histogram duration{{0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1}};
+        Utils::Histogram size{{1024, 4096, 16384, 65536, 262144, 1048576, 4194304}};
+    };
+
+    // Persists AddTorrentParams changes off the io thread. Pending writes are coalesced per
+    // info hash (only the latest state is written) and flushed in batched transactions on a
+    // dedicated thread.
+    class WriteBehindQueue
+    {
+    public:
+        explicit WriteBehindQueue(const WriteBehindQueueOptions& options);
+        ~WriteBehindQueue();
+
+        WriteBehindQueue(const WriteBehindQueue&) = delete;
+        WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+        // Blocks until every write queued so far is committed. Pending writes are flushed in
+        // one transaction regardless of the batch size.
+        void Drain();
+        // Starts flushing everything pending in one transaction, like Drain, without
+        // waiting for it.
+        void Flush();
+        // Writes queued or being written, and not yet committed.
+        std::size_t Pending();
+        void Remove(const libtorrent::info_hash_t& hash);
+        WriteBehindQueueStats Stats();
+        // Writes only the client data of the torrents, all of them in one transaction which
+        // starts right away. A pending write of a whole row takes the new client data along.
+        void UpdateClientData(const std::vector<std::pair<libtorrent::info_hash_t, TorrentClientData>>& torrents);
+        void Upsert(const libtorrent::info_hash_t& hash, const Models::AddTorrentParams& params);
+
+    private:
+        struct Operation
+        {
+            // An empty value means the row should be removed, unless only the client data
+            // is written.
+            std::optional<Models::AddTorrentParams> params;
+            TorrentClientData                       client_data;
+            bool                                    client_data_only = false;
+        };
+
+        void Enqueue(const libtorrent::info_hash_t& hash, Operation op);
+        void Run();
+        void Write(std::map<libtorrent::info_hash_t, Operation>& batch);
+
+        WriteBehindQueueOptions m_options;
+        sqlite3* m_db;
+        bool m_owns_db;
+
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::condition_variable m_drained;
+        std::map<libtorrent::info_hash_t, Operation> m_pending;
+        // The client data revision last written per torrent, where it is not the loaded
+        // revision. Only used on the writer thread.
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_clientDataRevisions;
+        bool m_drain;
+        bool m_flushing;
+        std::size_t m_writing;
+        bool m_stopping;
+
+        std::mutex m_stats_mtx;
+        WriteBehindQueueStats m_stats;
+
+        std::thread m_thread;
+    };
+}
@@ -0,0 +1,42 @@
+#include "diskio.hpp"
+
+#include <libtorrent/mmap_disk_io.hpp>
+#include <libtorrent/posix_disk_io.hpp>
+
+#ifdef PORLA_WITH_IO_URING
+#include "iouringdiskio.hpp"
+#endif
+
+namespace lt = libtorrent;
+
+using porla::DiskIo;
+
+std::optional<lt::disk_io_constructor_type> DiskIo::Constructor(const std::string& name)
+{
+    if (name == "default") return lt::default_disk_io_constructor;
+#if TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE
+    if (name == "mmap")    return lt::mmap_disk_io_constructor;
+#endif
+    if (name == "posix")   return lt::posix_disk_io_constructor;
+#ifdef PORLA_WITH_IO_URING
+    if (name == "io_uring")        return IoUringDiskIo::Constructor({});
+    if (name == "io_uring_direct") return IoUringDiskIo::Constructor({ .direct = true });
+#endif
+
+    return std::nullopt;
+}
+
+std::vector<std::string> DiskIo::Names()
+{
+    return {
+        "default",
+#if TORRENT_HAVE_MMAP || TORRENT_HAVE_MAP_VIEW_OF_FILE
+        "mmap",
+#endif
+        "posix",
+#ifdef PORLA_WITH_IO_URING
+        "io_uring",
+        "io_uring_direct"
+#endif
+    };
+}
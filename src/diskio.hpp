@@ -0,0 +1,24 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/disk_interface.hpp>
+
+namespace porla
+{
+    // The disk I/O backends libtorrent can be constructed with, by the name used in the
+    // config. "mmap" maps the files into memory and leaves caching to the kernel, which
+    // suits fast local disks. "posix" reads and writes with pread/pwrite, which holds up
+    // better on network file systems and where mapped files are slow or unsupported.
+    // "default" is libtorrent's choice, which is mmap where it is available. When built
+    // with liburing, "io_uring" serves block reads through io_uring on top of the default
+    // backend, and "io_uring_direct" does so with O_DIRECT where the blocks line up.
+    class DiskIo
+    {
+    public:
+        static std::optional<libtorrent::disk_io_constructor_type> Constructor(const std::string& name);
+        static std::vector<std::string> Names();
+    };
+}
@@ -0,0 +1,270 @@
+#include "diskspacemonitor.hpp"
+
+#include <filesystem>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "session.hpp"
+#include "utils/mounttable.hpp"
+#include "workerpool.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::DiskSpaceMonitor;
+
+static std::vector<DiskSpaceMonitor::Volume> Measure(const std::set<std::string>& paths)
+{
+    std::map<std::uint64_t, DiskSpaceMonitor::Volume> volumes;
+
+    for (const auto& path : paths)
+    {
+        const auto id = porla::Utils::MountTable::DeviceId(path);
+
+        if (!id.has_value())
+        {
+            continue;
+        }
+
+        const auto device = *id;
+
+        auto [volume, inserted] = volumes.try_emplace(device, DiskSpaceMonitor::Volume{ .device = device });
+        volume->second.paths.push_back(path);
+
+        if (!inserted)
+        {
+            continue;
+        }
+
+        // Measured where the device was found, since the path itself may not exist yet.
+        fs::path existing(path);
+        std::error_code ec;
+
+        while (!fs::exists(existing, ec) && existing.has_relative_path())
+        {
+            existing = existing.parent_path();
+        }
+
+        const auto space = fs::space(existing, ec);
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to get space for " << path << ": " << ec.message();
+            volumes.erase(volume);
+            continue;
+        }
+
+        volume->second.available = space.available;
+        volume->second.capacity  = space.capacity;
+        volume->second.free      = space.free;
+    }
+
+    std::vector<DiskSpaceMonitor::Volume> result;
+    result.reserve(volumes.size());
+
+    for (auto& [device, volume] : volumes) result.push_back(std::move(volume));
+
+    return result;
+}
+
+const char* DiskSpaceMonitor::Name(Level level)
+{
+    switch (level)
+    {
+    case Level::Ok:       return "ok";
+    case Level::Low:      return "low";
+    case Level::Critical: return "critical";
+    }
+
+    return "unknown";
+}
+
+DiskSpaceMonitor::DiskSpaceMonitor(boost::asio::io_context& io, porla::ISession& session, porla::DiskSpaceMonitorOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(std::move(options))
+{
+    // Not sampled right away, so subscribers connected after construction see the first
+    // levels too.
+    Schedule(std::chrono::milliseconds(0));
+}
+
+DiskSpaceMonitor::~DiskSpaceMonitor()
+{
+    m_timer.cancel();
+}
+
+void DiskSpaceMonitor::Apply(std::vector<Volume> samples)
+{
+    const auto cleared = [](std::uint64_t available, std::uint64_t threshold)
+    {
+        return available >= threshold + threshold / 10;
+    };
+
+    std::map<std::uint64_t, Volume> volumes;
+
+    for (auto& sample : samples)
+    {
+        const auto last = m_volumes.find(sample.device);
+        const Level current = last != m_volumes.end() ? last->second.level : Level::Ok;
+
+        Level level = Level::Ok;
+
+        if (sample.available < m_options.critical_bytes)
+        {
+            level = Level::Critical;
+        }
+        else if (sample.available < m_options.low_bytes)
+        {
+            level = Level::Low;
+        }
+
+        // Going back up a level needs some room above the threshold.
+        if (current == Level::Critical && level != Level::Critical && !cleared(sample.available, m_options.critical_bytes))
+        {
+            level = Level::Critical;
+        }
+        else if (current != Level::Ok && level == Level::Ok && !cleared(sample.available, m_options.low_bytes))
+        {
+            level = Level::Low;
+        }
+
+        sample.level    = level;
+        sample.previous = current;
+
+        if (level != current)
+        {
+            BOOST_LOG_TRIVIAL(level == Level::Ok ? boost::log::trivial::info : boost::log::trivial::warning)
+                << "Disk space on " << sample.paths.front() << " is " << Name(level)
+                << ", " << sample.available / (1024 * 1024) << " MiB available";
+
+            m_levelChanged(sample);
+        }
+
+        if (m_options.pause)
+        {
+            // Also picks up torrents started on the volume since the last sample.
+            if (level == Level::Critical) Pause(sample);
+            if (level == Level::Ok && current != Level::Ok) Resume(sample);
+        }
+
+        volumes.insert({ sample.device, std::move(sample) });
+    }
+
+    m_volumes = std::move(volumes);
+
+    Schedule(m_options.interval);
+}
+
+void DiskSpaceMonitor::Pause(const Volume& volume)
+{
+    const std::set<std::string> paths(volume.paths.begin(), volume.paths.end());
+    const auto& torrents = m_session.Torrents();
+
+    int paused = 0;
+
+    for (const auto& [hash, ts] : m_session.TorrentStatuses())
+    {
+        const bool downloading = !ts.is_finished && !(ts.flags & lt::torrent_flags::paused);
+
+        if (!downloading || !paths.contains(ts.save_path) || m_paused.contains(hash))
+        {
+            continue;
+        }
+
+        const auto handle = torrents.find(hash);
+
+        if (handle == torrents.end())
+        {
+            continue;
+        }
+
+        // Auto managed torrents would be started again by the queue.
+        const bool auto_managed = static_cast<bool>(ts.flags & lt::torrent_flags::auto_managed);
+
+        handle->second.unset_flags(lt::torrent_flags::auto_managed);
+        handle->second.pause();
+
+        m_paused.insert({ hash, { volume.device, auto_managed } });
+        paused++;
+    }
+
+    if (paused > 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Paused " << paused << " downloading torrent(s) on " << volume.paths.front();
+    }
+}
+
+void DiskSpaceMonitor::Resume(const Volume& volume)
+{
+    const auto& torrents = m_session.Torrents();
+
+    int resumed = 0;
+
+    for (auto item = m_paused.begin(); item != m_paused.end();)
+    {
+        const auto& [device, auto_managed] = item->second;
+
+        if (device != volume.device)
+        {
+            ++item;
+            continue;
+        }
+
+        if (const auto handle = torrents.find(item->first); handle != torrents.end())
+        {
+            if (auto_managed) handle->second.set_flags(lt::torrent_flags::auto_managed);
+            handle->second.resume();
+            resumed++;
+        }
+
+        item = m_paused.erase(item);
+    }
+
+    if (resumed > 0)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Resumed " << resumed << " torrent(s) on " << volume.paths.front();
+    }
+}
+
+void DiskSpaceMonitor::Sample()
+{
+    std::set<std::string> paths(m_options.paths.begin(), m_options.paths.end());
+
+    for (const auto& [hash, ts] : m_session.TorrentStatuses())
+    {
+        paths.insert(ts.save_path);
+    }
+
+    paths.erase("");
+
+    if (m_options.pool == nullptr)
+    {
+        return Apply(Measure(paths));
+    }
+
+    const bool posted = m_options.pool->Post(
+        [this, paths = std::move(paths)]()
+        {
+            m_options.pool->Complete([this, volumes = Measure(paths)]() mutable { Apply(std::move(volumes)); });
+        });
+
+    if (!posted)
+    {
+        // Tried again on the next interval.
+        Schedule(m_options.interval);
+    }
+}
+
+void DiskSpaceMonitor::Schedule(std::chrono::milliseconds delay)
+{
+    m_timer.expires_after(delay);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+            Sample();
+        });
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+    class WorkerPool;
+
+    struct DiskSpaceMonitorOptions
+    {
+        std::chrono::milliseconds interval       = std::chrono::milliseconds(30000);
+        // Volumes with less space available than these are low and critical.
+        std::uint64_t             low_bytes      = 10ull * 1024 * 1024 * 1024;
+        std::uint64_t             critical_bytes = 1ull * 1024 * 1024 * 1024;
+        // Pauses the downloading torrents on a critical volume, and resumes them once it is
+        // no longer low. Seeding torrents are left alone.
+        bool                      pause          = false;
+        // Watched along with the save paths of the torrents, such as preset save paths.
+        std::vector<std::string>  paths;
+        // Where the volumes are sampled, since a slow file system can block. Null samples
+        // them on the io thread.
+        WorkerPool*               pool           = nullptr;
+    };
+
+    // Samples the free space on the volumes that hold the save paths, grouping paths by
+    // the device they are on, and signals when a volume crosses a threshold. A volume has
+    // to clear a threshold by a tenth of it to go back up a level, so it does not flap.
+    class DiskSpaceMonitor
+    {
+    public:
+        enum class Level
+        {
+            Ok,
+            Low,
+            Critical
+        };
+
+        struct Volume
+        {
+            std::uint64_t            device;
+            std::vector<std::string> paths;
+            std::uint64_t            available;
+            std::uint64_t            capacity;
+            std::uint64_t            free;
+            Level                    level;
+            Level                    previous;
+        };
+
+        typedef porla::Utils::Signal<void(const Volume&)> VolumeSignal;
+
+        static const char* Name(Level level);
+
+        explicit DiskSpaceMonitor(boost::asio::io_context& io, ISession& session, DiskSpaceMonitorOptions options);
+        DiskSpaceMonitor(const DiskSpaceMonitor&) = delete;
+
+        ~DiskSpaceMonitor();
+
+        porla::Utils::Connection OnLevelChanged(const VolumeSignal::slot_type& subscriber)
+        {
+            return m_levelChanged.connect(subscriber);
+        }
+
+    private:
+        void Apply(std::vector<Volume> samples);
+        void Pause(const Volume& volume);
+        void Resume(const Volume& volume);
+        void Sample();
+        void Schedule(std::chrono::milliseconds delay);
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        DiskSpaceMonitorOptions m_options;
+
+        std::map<std::uint64_t, Volume> m_volumes;
+        // Torrents paused for a volume, and whether they were auto managed.
+        std::map<libtorrent::info_hash_t, std::pair<std::uint64_t, bool>> m_paused;
+
+        VolumeSignal m_levelChanged;
+    };
+}
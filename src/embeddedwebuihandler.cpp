@@ -1,11 +1,18 @@
 #include "embeddedwebuihandler.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
+#include <iomanip>
 #include <regex>
+#include <sstream>
 
 #include <boost/log/trivial.hpp>
 #include <utility>
-#include <zip.h>
+#include <zlib.h>
+
+#include "responsecache.hpp"
+#include "utils/gzip.hpp"
 
 namespace fs = std::filesystem;
 using porla::EmbeddedWebUIHandler;
@@ -32,47 +39,156 @@ void str_replace_all(std::string& str, const std::string& from, const std::strin
     }
 }
 
+static const std::map<std::string, std::string> MimeTypes =
+{
+    {".css", "text/css"},
+    {".html", "text/html"},
+    {".js", "text/javascript"},
+    {".svg", "image/svg+xml"}
+};
+
+// A strong etag from the CRC-32 and size, which the zip already has for every entry.
+static std::string ETag(std::uint32_t crc, std::size_t size)
+{
+    std::stringstream ss;
+    ss << "\"" << std::hex << std::setfill('0') << std::setw(8) << crc << "-" << size << "\"";
+    return ss.str();
+}
+
+static std::uint32_t Crc32(const std::string& data)
+{
+    return static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size())));
+}
+
+// Bundlers name assets after a hash of their content, like index-4f2a9c1d.js, so a
+// changed file gets a new name and the old one can be cached forever.
+static bool IsHashedName(const fs::path& file)
+{
+    static const std::regex Hashed(R"([-.]([A-Za-z0-9_]{8,})\.[A-Za-z0-9]+$)");
+
+    std::smatch match;
+    const auto name = file.filename().string();
+
+    return std::regex_search(name, match, Hashed)
+        && std::any_of(match[1].first, match[1].second, [](char ch) { return std::isdigit(ch); });
+}
+
 EmbeddedWebUIHandler::EmbeddedWebUIHandler(std::string base_path)
     : m_base_path(std::move(base_path))
+    , m_state(std::make_shared<State>())
 {
     if (webui_zip_size() == 0)
     {
         BOOST_LOG_TRIVIAL(warning) << "No embedded web UI found";
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Loading embedded web UI (" << webui_zip_size()/1024 << " kB)";
+
+    std::vector<Utils::Zip::Entry> entries;
+
+    try
+    {
+        entries = Utils::Zip::Entries({ reinterpret_cast<const char*>(webui_zip_data()), webui_zip_size() });
     }
-    else
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read embedded web UI: " << ex.what();
+        return;
+    }
+
+    for (auto& entry : entries)
     {
-        BOOST_LOG_TRIVIAL(debug) << "Loading embedded web UI (" << webui_zip_size()/1024 << " kB)";
+        if (entry.size == 0)
+        {
+            continue;
+        }
+
+        if (entry.method != Utils::Zip::Stored && entry.method != Utils::Zip::Deflated)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Skipping " << entry.name << ", which uses an unsupported compression method";
+            continue;
+        }
+
+        const fs::path name = entry.name;
+
+        std::string etag      = ETag(entry.crc32, entry.size);
+        std::string mime_type = "text/plain";
+
+        if (name.has_extension() && MimeTypes.contains(name.extension()))
+        {
+            mime_type = MimeTypes.at(name.extension());
+        }
+
+        Asset asset{
+            .entry     = std::move(entry),
+            .etag      = std::move(etag),
+            .immutable = name != "index.html" && IsHashedName(name),
+            .mime_type = std::move(mime_type)
+        };
+
+        m_state->files.emplace(name.string(), std::move(asset));
+    }
+}
 
-        zip_error_t err;
-        zip_source_t *source = zip_source_buffer_create(webui_zip_data(), webui_zip_size(), 0, &err);
+porla::MemoryUsage EmbeddedWebUIHandler::Memory() const
+{
+    std::unique_lock lock(m_state->mtx);
 
-        zip_t *webui = zip_open_from_source(source, ZIP_RDONLY, &err);
-        zip_int64_t num_entries = zip_get_num_entries(webui, ZIP_FL_UNCHANGED);
+    MemoryUsage usage{ .objects = m_state->files.size() };
 
-        for (int i = 0; i < num_entries; i++)
+    for (const auto& [name, asset] : m_state->files)
+    {
+        usage.bytes += sizeof(Asset) + name.size() + asset.etag.size()
+            + (asset.body ? asset.body->size() : 0)
+            + (asset.gzip ? asset.gzip->size() : 0);
+    }
+
+    return usage;
+}
+
+void EmbeddedWebUIHandler::Prepare(Asset& asset, bool want_gzip) const
+{
+    if (asset.entry.name == "index.html")
+    {
+        if (asset.body.has_value())
         {
-            zip_stat_t st;
-            zip_stat_init(&st);
-            zip_stat_index(webui, i, 0, &st);
+            return;
+        }
+
+        std::string data = Utils::Zip::Inflate(asset.entry);
 
-            if (st.size == 0)
-            {
-                continue;
-            }
+        // The base path never changes, so index.html is patched once.
+        str_replace_all(data, "%BASE_PATH%", m_base_path);
 
-            zip_file* file = zip_fopen_index(webui, i, ZIP_FL_UNCHANGED);
+        // Try to patch in our base path
+        std::regex href_expression(R"(href=\"(\.\/)(.*)\")");
+        std::regex src_expression(R"(src=\"(\.\/)(.*)\")");
 
-            std::vector<char> buffer;
-            buffer.resize(st.size);
+        data = std::regex_replace(data, href_expression, "href=\"" + m_base_path + "/$2\"");
+        data = std::regex_replace(data, src_expression, "src=\"" + m_base_path + "/$2\"");
 
-            zip_fread(file, &buffer[0], st.size);
-            zip_fclose(file);
+        asset.etag = ETag(Crc32(data), data.size());
 
-            m_files.emplace(st.name, buffer);
+        try
+        {
+            auto gzip = porla::Utils::Gzip::Compress(data);
+            if (gzip.size() < data.size()) { asset.gzip = std::move(gzip); }
         }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to compress index.html: " << ex.what();
+        }
+
+        asset.body = std::move(data);
+        return;
+    }
 
-        zip_close(webui);
-        zip_source_close(source);
+    // Stored entries are served straight from the archive, and deflated ones too when the
+    // client takes gzip.
+    if (asset.entry.method == Utils::Zip::Deflated && !want_gzip && !asset.body.has_value())
+    {
+        asset.body = Utils::Zip::Inflate(asset.entry);
     }
 }
 
@@ -80,51 +196,73 @@ void EmbeddedWebUIHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
 {
     // If files are empty (we have no embedded web UI) - return next middleware
     // and ignore this request.
-    if (m_files.empty())
+    if (m_state->files.empty())
     {
         return ctx->Next();
     }
 
     namespace http = boost::beast::http;
 
-    const static std::map<std::string, std::string> MimeTypes =
-    {
-        {".css", "text/css"},
-        {".html", "text/html"},
-        {".js", "text/javascript"},
-        {".svg", "image/svg+xml"}
-    };
-
-    auto const respond_with_file = [&ctx, this](const fs::path& file)
+    auto const respond_with_file = [&ctx, this](const std::string& file)
     {
         namespace http = boost::beast::http;
 
-        std::string mime_type = "text/plain";
+        const auto& req = ctx->Request();
 
-        if (file.has_extension() && MimeTypes.contains(file.extension()))
+        std::unique_lock lock(m_state->mtx);
+        auto& asset = m_state->files.at(file);
+
+        const auto accept_encoding = req.find(http::field::accept_encoding);
+        const bool accepts_gzip = accept_encoding != req.end()
+            && Utils::Gzip::IsAccepted({accept_encoding->value().data(), accept_encoding->value().size()});
+
+        try
+        {
+            Prepare(asset, accepts_gzip);
+        }
+        catch (const std::exception& ex)
         {
-            mime_type = MimeTypes.at(file.extension());
+            BOOST_LOG_TRIVIAL(error) << "Failed to read " << file << " from the embedded web UI: " << ex.what();
+
+            http::response<http::string_body> res{http::status::internal_server_error, req.version()};
+            res.set(http::field::server, "porla/1.0");
+            res.keep_alive(req.keep_alive());
+            res.prepare_payload();
+            return res;
         }
 
-        std::string data = std::string(m_files.at(file).data(), m_files.at(file).size());
+        const bool patched = asset.entry.name == "index.html";
+        const bool gzip    = accepts_gzip && (patched ? asset.gzip.has_value() : asset.entry.method == Utils::Zip::Deflated);
+
+        // Each encoding is its own representation, so it gets its own strong etag.
+        const auto etag = gzip ? asset.etag.substr(0, asset.etag.size() - 1) + "-gzip\"" : asset.etag;
 
-        if (file == "index.html")
+        http::response<http::string_body> res{http::status::ok, req.version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::cache_control, asset.immutable ? "public, max-age=31536000, immutable" : "no-cache");
+        res.set(http::field::etag, etag);
+        res.set(http::field::vary, "Accept-Encoding");
+        res.keep_alive(req.keep_alive());
+
+        if (const auto inm = req.find(http::field::if_none_match);
+            inm != req.end() && porla::ResponseCache::IsNoneMatch({inm->value().data(), inm->value().size()}, etag))
         {
-            str_replace_all(data, "%BASE_PATH%", m_base_path);
+            res.result(http::status::not_modified);
+            return res;
+        }
 
-            // Try to patch in our base path
-            std::regex href_expression(R"(href=\"(\.\/)(.*)\")");
-            std::regex src_expression(R"(src=\"(\.\/)(.*)\")");
+        res.set(http::field::content_type, asset.mime_type);
 
-            data = std::regex_replace(data, href_expression, "href=\"" + m_base_path + "/$2\"");
-            data = std::regex_replace(data, src_expression, "src=\"" + m_base_path + "/$2\"");
+        if (gzip)
+        {
+            res.set(http::field::content_encoding, "gzip");
+            res.body() = patched ? *asset.gzip : Utils::Zip::Gzip(asset.entry);
+        }
+        else
+        {
+            res.body() = asset.body.has_value() ? *asset.body : std::string(asset.entry.data);
         }
 
-        http::response<http::string_body> res{http::status::ok, ctx->Request().version()};
-        res.set(http::field::server, "porla/1.0");
-        res.set(http::field::content_type, mime_type);
-        res.keep_alive(ctx->Request().keep_alive());
-        res.body() = data;
         res.prepare_payload();
         return res;
     };
@@ -146,7 +284,7 @@ void EmbeddedWebUIHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
 
     if (rooted_path.length() > 0 && rooted_path[0] == '/') rooted_path = rooted_path.substr(1);
     if (rooted_path.empty())                               rooted_path = "index.html";
-    if (!m_files.contains(rooted_path))                    rooted_path = "index.html";
+    if (!m_state->files.contains(rooted_path))             rooted_path = "index.html";
 
     ctx->Write(respond_with_file(rooted_path));
 }
@@ -1,13 +1,20 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
-#include <vector>
 
 #include "httpcontext.hpp"
+#include "memoryusage.hpp"
+#include "utils/zip.hpp"
 
 namespace porla
 {
+    // Serves the web UI from the zip embedded in the binary. Only the archive's directory is
+    // read up front. Deflated files go out as they are stored, wrapped as gzip, and are only
+    // inflated, once, for clients which do not take gzip.
     class EmbeddedWebUIHandler
     {
     public:
@@ -15,8 +22,32 @@ namespace porla
 
         void operator()(const std::shared_ptr<HttpContext>&);
 
+        // The assets inflated or compressed so far. The archive itself is part of the binary.
+        [[nodiscard]] MemoryUsage Memory() const;
+
     private:
+        struct Asset
+        {
+            Utils::Zip::Entry entry;
+            std::string       etag;
+            bool              immutable;
+            std::string       mime_type;
+            // Filled on first use. The body is the inflated entry, or the patched one for
+            // index.html, which is the only asset compressed here.
+            std::optional<std::string> body = std::nullopt;
+            std::optional<std::string> gzip = std::nullopt;
+        };
+
+        // Shared by the copies of the handler, which may run on several HTTP threads.
+        struct State
+        {
+            std::mutex                   mtx;
+            std::map<std::string, Asset> files;
+        };
+
+        void Prepare(Asset& asset, bool want_gzip) const;
+
         std::string m_base_path;
-        std::map<std::string, std::vector<char>> m_files;
+        std::shared_ptr<State> m_state;
     };
 }
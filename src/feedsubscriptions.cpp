@@ -0,0 +1,315 @@
+#include "feedsubscriptions.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/add_torrent_params.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "data/models/feeditems.hpp"
+#include "methods/torrentsadd.hpp"
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Data::Models::FeedItems;
+using porla::FeedSubscriptions;
+
+// Polls are started this far apart at startup, so many feeds do not all go at once.
+static constexpr std::chrono::milliseconds Stagger(250);
+static constexpr std::chrono::seconds Timeout(30);
+
+static std::int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+FeedSubscriptions::FeedSubscriptions(
+    boost::asio::io_context& io,
+    porla::ISession& session,
+    porla::HttpClient& http,
+    const porla::Methods::TorrentsAdd& add,
+    porla::FeedSubscriptionsOptions options)
+    : m_io(io)
+    , m_session(session)
+    , m_http(http)
+    , m_add(add)
+    , m_options(std::move(options))
+{
+    for (const auto& [name, feed] : m_options.feeds)
+    {
+        std::unique_ptr<Query::PQL::Filter> filter;
+
+        if (feed.filter.has_value())
+        {
+            try
+            {
+                filter = Query::PQL::Parse(*feed.filter);
+            }
+            catch (const Query::QueryError& ex)
+            {
+                BOOST_LOG_TRIVIAL(error) << "Not subscribing to feed '" << name << "', its filter is invalid: " << ex.what();
+                continue;
+            }
+        }
+
+        m_subscriptions.push_back(std::unique_ptr<Subscription>(new Subscription{
+            .name   = name,
+            .feed   = feed,
+            .filter = std::move(filter),
+            .timer  = boost::asio::steady_timer(m_io)
+        }));
+    }
+
+    for (std::size_t i = 0; i < m_subscriptions.size(); i++)
+    {
+        // Feeds are not polled more than once a minute.
+        m_subscriptions[i]->feed.interval = std::max(60, m_subscriptions[i]->feed.interval);
+
+        Schedule(*m_subscriptions[i], Stagger * static_cast<int>(i));
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Subscribed to " << m_subscriptions.size() << " feed(s)";
+}
+
+FeedSubscriptions::~FeedSubscriptions()
+{
+    for (auto& sub : m_subscriptions)
+    {
+        sub->timer.cancel();
+    }
+}
+
+void FeedSubscriptions::Add(Subscription& sub, std::shared_ptr<Batch> batch)
+{
+    // Without the validators the next poll gets the whole feed, and retries the items
+    // whose torrent files failed to fetch.
+    if (batch->failed)
+    {
+        sub.etag.clear();
+        sub.last_modified.clear();
+    }
+
+    std::vector<lt::add_torrent_params> params;
+    std::vector<Pending> added;
+
+    for (auto& pending : batch->pending)
+    {
+        lt::add_torrent_params p;
+
+        if (const auto error = m_add.Build(pending.req, p))
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to add item " << pending.item_id << " of feed '" << sub.name << "': " << error->message;
+            Seen(sub, pending.item_id);
+            continue;
+        }
+
+        params.push_back(std::move(p));
+        added.push_back(std::move(pending));
+    }
+
+    if (params.empty())
+    {
+        return Schedule(sub, sub.feed.interval * std::chrono::seconds(1));
+    }
+
+    m_session.AddTorrents(
+        std::move(params),
+        [this, &sub, added = std::move(added)](std::vector<ISession::AddTorrentResult> results)
+        {
+            int count = 0;
+
+            for (std::size_t i = 0; i < results.size(); i++)
+            {
+                if (results[i].error.empty())
+                {
+                    m_add.Added(results[i].info_hash, added[i].req.metadata);
+                    count++;
+                }
+                else
+                {
+                    BOOST_LOG_TRIVIAL(warning) << "Failed to add item " << added[i].item_id << " of feed '" << sub.name << "': " << results[i].error;
+                }
+
+                Seen(sub, added[i].item_id);
+            }
+
+            BOOST_LOG_TRIVIAL(info) << "Added " << count << " torrent(s) from feed '" << sub.name << "'";
+
+            Schedule(sub, sub.feed.interval * std::chrono::seconds(1));
+        });
+}
+
+void FeedSubscriptions::Fetch(Subscription& sub, std::shared_ptr<Batch> batch, Pending pending)
+{
+    batch->fetching++;
+
+    m_http.SendAsync(
+        HttpClient::Request{
+            .url     = pending.link,
+            .method  = "GET",
+            .timeout = Timeout
+        },
+        [this, &sub, batch, pending = std::move(pending)](const HttpClient::Response& res) mutable
+        {
+            if (res.ec || res.status != 200)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Failed to fetch the torrent of item " << pending.item_id << " of feed '" << sub.name << "': "
+                    << (res.ec ? res.ec.message() : "status " + std::to_string(res.status));
+
+                batch->failed = true;
+            }
+            else
+            {
+                pending.req.ti = res.body;
+
+                Methods::TorrentsAdd::ParseTorrentInfo(pending.req);
+
+                batch->pending.push_back(std::move(pending));
+            }
+
+            if (--batch->fetching == 0)
+            {
+                Add(sub, batch);
+            }
+        });
+}
+
+void FeedSubscriptions::Poll(Subscription& sub)
+{
+    // Nothing could be added, and the items would be marked as seen all the same.
+    if (m_session.Draining().draining)
+    {
+        return Schedule(sub, sub.feed.interval * std::chrono::seconds(1));
+    }
+
+    HttpClient::Request req{
+        .url     = sub.feed.url,
+        .method  = "GET",
+        .timeout = Timeout
+    };
+
+    if (!sub.etag.empty())          req.headers.insert({ "If-None-Match", sub.etag });
+    if (!sub.last_modified.empty()) req.headers.insert({ "If-Modified-Since", sub.last_modified });
+
+    m_http.SendAsync(req, [this, &sub](const HttpClient::Response& res) { Receive(sub, res); });
+}
+
+void FeedSubscriptions::Receive(Subscription& sub, const HttpClient::Response& res)
+{
+    const auto interval = sub.feed.interval * std::chrono::seconds(1);
+
+    if (res.ec || (res.status != 200 && res.status != 304))
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to poll feed '" << sub.name << "': "
+            << (res.ec ? res.ec.message() : "status " + std::to_string(res.status));
+
+        return Schedule(sub, interval);
+    }
+
+    if (res.status == 304)
+    {
+        BOOST_LOG_TRIVIAL(trace) << "Feed '" << sub.name << "' is not modified";
+        return Schedule(sub, interval);
+    }
+
+    std::vector<Utils::Feed::Item> items;
+
+    try
+    {
+        items = Utils::Feed::Parse(res.body);
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to read feed '" << sub.name << "': " << ex.what();
+        return Schedule(sub, interval);
+    }
+
+    const auto etag          = res.headers.find("etag");
+    const auto last_modified = res.headers.find("last-modified");
+
+    sub.etag          = etag != res.headers.end() ? etag->second : std::string();
+    sub.last_modified = last_modified != res.headers.end() ? last_modified->second : std::string();
+
+    auto batch = std::make_shared<Batch>();
+    std::vector<Pending> fetch;
+
+    // One transaction for the items of the feed, rather than one per item.
+    sqlite3_exec(m_options.db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+
+    for (const auto& item : items)
+    {
+        if (item.id.empty())
+        {
+            continue;
+        }
+
+        // Seen before, and only kept from being pruned.
+        if (FeedItems::Contains(m_options.db, sub.name, item.id))
+        {
+            Seen(sub, item.id);
+            continue;
+        }
+
+        if (sub.filter != nullptr)
+        {
+            lt::torrent_status ts;
+            ts.name = item.title;
+
+            if (!sub.filter->Includes(ts))
+            {
+                Seen(sub, item.id);
+                continue;
+            }
+        }
+
+        Pending pending{ .item_id = item.id, .link = item.link };
+        pending.req.metadata = std::map<std::string, nlohmann::json>{{ "feed", sub.name }};
+        pending.req.preset   = sub.feed.preset;
+
+        if (item.link.starts_with("magnet:"))
+        {
+            pending.req.magnet_uri = item.link;
+            batch->pending.push_back(std::move(pending));
+        }
+        else if (item.link.starts_with("http://") || item.link.starts_with("https://"))
+        {
+            fetch.push_back(std::move(pending));
+        }
+        else
+        {
+            Seen(sub, item.id);
+        }
+    }
+
+    FeedItems::Prune(m_options.db, sub.name, Now() - m_options.retention.count());
+
+    sqlite3_exec(m_options.db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    if (fetch.empty())
+    {
+        return Add(sub, batch);
+    }
+
+    for (auto& pending : fetch)
+    {
+        Fetch(sub, batch, std::move(pending));
+    }
+}
+
+void FeedSubscriptions::Schedule(Subscription& sub, std::chrono::milliseconds delay)
+{
+    sub.timer.expires_after(delay);
+    sub.timer.async_wait(
+        [this, &sub](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+            Poll(sub);
+        });
+}
+
+void FeedSubscriptions::Seen(const Subscription& sub, const std::string& item_id)
+{
+    FeedItems::Set(m_options.db, sub.name, item_id, Now());
+}
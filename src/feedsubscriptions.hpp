@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <sqlite3.h>
+
+#include "config.hpp"
+#include "httpclient.hpp"
+#include "methods/torrentsaddreq.hpp"
+#include "query/pql.hpp"
+#include "utils/feed.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    namespace Methods
+    {
+        class TorrentsAdd;
+    }
+
+    struct FeedSubscriptionsOptions
+    {
+        std::map<std::string, Config::Feed> feeds;
+        // Where the seen items are kept.
+        sqlite3*                            db        = nullptr;
+        // Seen items which have not been in their feed for this long are forgotten.
+        std::chrono::seconds                retention = std::chrono::hours(24 * 30);
+    };
+
+    // Polls RSS and Atom feeds, each on its own interval, and adds the torrents of new
+    // items matching the filter of the feed, with its preset. Polls are conditional on the
+    // ETag and Last-Modified of the last response, so an unchanged feed costs a 304. Items
+    // are remembered in the database, so each one is only added once. The torrent files
+    // new items link to are fetched together, and everything a poll found is added as one
+    // batch.
+    class FeedSubscriptions
+    {
+    public:
+        explicit FeedSubscriptions(
+            boost::asio::io_context& io,
+            ISession& session,
+            HttpClient& http,
+            const Methods::TorrentsAdd& add,
+            FeedSubscriptionsOptions options);
+
+        FeedSubscriptions(const FeedSubscriptions&) = delete;
+
+        ~FeedSubscriptions();
+
+    private:
+        struct Subscription
+        {
+            std::string                         name;
+            Config::Feed                        feed;
+            std::unique_ptr<Query::PQL::Filter> filter;
+            std::string                         etag;
+            std::string                         last_modified;
+            boost::asio::steady_timer           timer;
+        };
+
+        struct Pending
+        {
+            std::string             item_id;
+            std::string             link;
+            Methods::TorrentsAddReq req;
+        };
+
+        // The items of one poll, while their torrent files are fetched.
+        struct Batch
+        {
+            std::vector<Pending> pending;
+            std::size_t          fetching = 0;
+            // Whether any torrent file failed to fetch, and is to be tried again.
+            bool                 failed   = false;
+        };
+
+        void Add(Subscription& sub, std::shared_ptr<Batch> batch);
+        void Fetch(Subscription& sub, std::shared_ptr<Batch> batch, Pending pending);
+        void Poll(Subscription& sub);
+        void Receive(Subscription& sub, const HttpClient::Response& res);
+        void Schedule(Subscription& sub, std::chrono::milliseconds delay);
+        void Seen(const Subscription& sub, const std::string& item_id);
+
+        boost::asio::io_context& m_io;
+        ISession& m_session;
+        HttpClient& m_http;
+        const Methods::TorrentsAdd& m_add;
+        FeedSubscriptionsOptions m_options;
+
+        std::vector<std::unique_ptr<Subscription>> m_subscriptions;
+    };
+}
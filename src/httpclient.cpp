@@ -1,5 +1,11 @@
 #include "httpclient.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <map>
+#include <optional>
+
 #include <boost/asio/ssl/context.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/ssl.hpp>
@@ -9,44 +15,160 @@
 
 using porla::HttpClient;
 
-struct HttpClient::RequestState : public std::enable_shared_from_this<HttpClient::RequestState>
+// Loading the default verify paths reads the system certificate store, so it is done once.
+static boost::asio::ssl::context& SslContext()
 {
-    explicit RequestState(boost::asio::io_context& io)
-        : m_resolver(io)
-        , m_stream(io)
-        , m_ssl_ctx(boost::asio::ssl::context::tls_client)
-        , m_ssl_stream(io, m_ssl_ctx)
+    static boost::asio::ssl::context ctx = []()
     {
-        m_ssl_ctx.set_verify_mode(
+        boost::asio::ssl::context c(boost::asio::ssl::context::tls_client);
+        c.set_verify_mode(
             boost::asio::ssl::verify_peer
             | boost::asio::ssl::context::verify_fail_if_no_peer_cert);
-        m_ssl_ctx.set_default_verify_paths();
+        c.set_default_verify_paths();
+        return c;
+    }();
+
+    return ctx;
+}
+
+static std::string HostKey(const porla::Uri& uri)
+{
+    return uri.scheme + "://" + uri.host + ":" + std::to_string(uri.port);
+}
+
+struct HttpClient::Connection
+{
+    explicit Connection(boost::asio::io_context& io, bool tls)
+        : tls(tls)
+    {
+        if (tls) { ssl_stream.emplace(io, SslContext()); }
+        else     { stream.emplace(io); }
+    }
+
+    boost::beast::tcp_stream& Lowest()
+    {
+        return tls ? boost::beast::get_lowest_layer(*ssl_stream) : *stream;
+    }
+
+    bool tls;
+    std::optional<boost::beast::tcp_stream> stream;
+    std::optional<boost::beast::ssl_stream<boost::beast::tcp_stream>> ssl_stream;
+    boost::beast::flat_buffer buffer;
+    std::chrono::steady_clock::time_point idle_since;
+};
+
+struct HttpClient::Pool : public std::enable_shared_from_this<HttpClient::Pool>
+{
+    struct Host
+    {
+        ~Host()
+        {
+            if (session != nullptr) { SSL_SESSION_free(session); }
+        }
+
+        std::vector<std::shared_ptr<Connection>> idle;
+        std::deque<std::shared_ptr<RequestState>> waiting;
+        int open = 0;
+        SSL_SESSION* session = nullptr;
+    };
+
+    typedef boost::asio::ip::tcp::resolver::results_type Endpoints;
+    typedef std::function<void(boost::system::error_code, const Endpoints&)> ResolveHandler;
+
+    // Failed lookups are cached too, so a host that does not resolve is not looked up
+    // again for every request. Lookups in flight for a host are shared.
+    struct Lookup
+    {
+        boost::system::error_code ec;
+        Endpoints endpoints;
+        std::chrono::steady_clock::time_point expires;
+        std::vector<ResolveHandler> waiting;
+        bool resolving = false;
+    };
+
+    Pool(boost::asio::io_context& io, HttpClientOptions options)
+        : io(io)
+        , options(options)
+        , resolver(io)
+    {
     }
 
-    void Send()
+    void Acquire(const std::shared_ptr<RequestState>& state);
+    void Release(const std::string& key, std::shared_ptr<Connection> conn, bool reusable);
+    void Resolve(const std::string& host, const std::string& port, ResolveHandler handler);
+
+    // Drops a cached lookup, for when its endpoints cannot be connected to.
+    void Forget(const std::string& host, const std::string& port)
     {
-        m_resolver.async_resolve(
+        const auto lookup = lookups.find(host + ":" + port);
+        if (lookup != lookups.end() && !lookup->second.resolving) { lookups.erase(lookup); }
+    }
+
+    boost::asio::io_context& io;
+    HttpClientOptions options;
+    std::map<std::string, Host> hosts;
+    boost::asio::ip::tcp::resolver resolver;
+    std::map<std::string, Lookup> lookups;
+};
+
+struct HttpClient::RequestState : public std::enable_shared_from_this<HttpClient::RequestState>
+{
+    explicit RequestState(std::shared_ptr<Pool> pool)
+        : m_pool(std::move(pool))
+    {
+    }
+
+    // Runs the request on a connection from the pool. Reused connections may have been closed
+    // by the server while idle, so a request failing on one is retried once on a new one.
+    void Start(std::shared_ptr<Connection> conn, bool reused)
+    {
+        m_conn = std::move(conn);
+        m_reused = reused;
+
+        if (m_reused)
+        {
+            return SendRequest();
+        }
+
+        m_pool->Resolve(
             m_uri.host,
             std::to_string(m_uri.port),
-            boost::beast::bind_front_handler(
-                [_this = shared_from_this()](auto && PH1, auto && PH2) { _this->OnAsyncResolve(PH1, PH2); }));
+            [_this = shared_from_this()](auto && PH1, auto && PH2) { _this->OnAsyncResolve(PH1, PH2); });
+    }
+
+    void Fail(const std::string& what, boost::system::error_code ec)
+    {
+        auto conn = std::move(m_conn);
+        const bool retry = m_reused;
+
+        m_pool->Release(m_key, std::move(conn), false);
+
+        if (retry)
+        {
+            BOOST_LOG_TRIVIAL(debug) << "HttpClient " << what << " on reused connection, retrying: " << ec.message();
+
+            m_reused = false;
+            m_res = {};
+            return m_pool->Acquire(shared_from_this());
+        }
+
+        BOOST_LOG_TRIVIAL(error) << "HttpClient " << what << " error: " << ec.message();
+
+        m_callback(Response{ .ec = ec });
     }
 
     void OnAsyncResolve(boost::system::error_code ec, const boost::asio::ip::tcp::resolver::results_type &results)
     {
         if (ec)
         {
-            BOOST_LOG_TRIVIAL(error) << "HttpClient resolve error: " << ec.message();
-            return;
+            return Fail("resolve", ec);
         }
 
         BOOST_LOG_TRIVIAL(debug) << "HttpClient resolved hosts";
 
-        auto& stream = m_uri.scheme == "https"
-            ? boost::beast::get_lowest_layer(m_ssl_stream)
-            : m_stream;
+        Expire();
 
-        stream.async_connect(
+        m_conn->Lowest().async_connect(
             results,
             boost::beast::bind_front_handler(
                 [_this = shared_from_this()](auto && PH1, auto && PH2) { _this->OnAsyncConnect(PH1, PH2); }));
@@ -58,24 +180,31 @@ struct HttpClient::RequestState : public std::enable_shared_from_this<HttpClient
     {
         if (ec)
         {
-            BOOST_LOG_TRIVIAL(error) << "HttpClient connect error: " << ec.message();
-            return;
+            m_pool->Forget(m_uri.host, std::to_string(m_uri.port));
+            return Fail("connect", ec);
         }
 
         BOOST_LOG_TRIVIAL(debug) << "HttpClient connected to " << type.address().to_string();
 
-        if (m_uri.scheme == "https")
+        if (m_conn->tls)
         {
-            if (!SSL_set_tlsext_host_name(m_ssl_stream.native_handle(), m_uri.host.c_str()))
+            auto* ssl = m_conn->ssl_stream->native_handle();
+
+            if (!SSL_set_tlsext_host_name(ssl, m_uri.host.c_str()))
             {
                 ec = {static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
-                BOOST_LOG_TRIVIAL(error) << "Failed to set tlsext hostname: " << ec.message();
-                return;
+                return Fail("set tlsext hostname", ec);
+            }
+
+            // Resume the last session with this host, skipping the full handshake.
+            if (auto* session = m_pool->hosts[m_key].session)
+            {
+                SSL_set_session(ssl, session);
             }
 
             BOOST_LOG_TRIVIAL(debug) << "HttpClient starting SSL handshake";
 
-            m_ssl_stream.async_handshake(
+            m_conn->ssl_stream->async_handshake(
                 boost::asio::ssl::stream_base::client,
                 boost::beast::bind_front_handler(
                     [_this = shared_from_this()](auto && PH1) { _this->OnAsyncHandshake(PH1); }));
@@ -90,24 +219,41 @@ struct HttpClient::RequestState : public std::enable_shared_from_this<HttpClient
     {
         if (ec)
         {
-            BOOST_LOG_TRIVIAL(error) << "Webhook SSL handshake error: " << ec.message();
-            return;
+            return Fail("SSL handshake", ec);
         }
 
-        BOOST_LOG_TRIVIAL(debug) << "HttpClient SSL handshake complete";
+        BOOST_LOG_TRIVIAL(debug)
+            << "HttpClient SSL handshake complete"
+            << (SSL_session_reused(m_conn->ssl_stream->native_handle()) ? " (resumed)" : "");
 
         SendRequest();
     }
 
+    // The deadline covers the whole exchange, so it is only set once per connection
+    // attempt and not again for every operation.
+    void Expire()
+    {
+        if (m_timeout.count() > 0) { m_conn->Lowest().expires_after(m_timeout); }
+        else                       { m_conn->Lowest().expires_never(); }
+    }
+
     void SendRequest()
     {
+        if (m_reused) { Expire(); }
+
         auto req = std::make_shared<boost::beast::http::request<boost::beast::http::string_body>>();
         req->method(m_payload.empty() ? boost::beast::http::verb::get : boost::beast::http::verb::post);
         req->target(m_uri.path);
         req->version(11);
+        req->keep_alive(true);
 
         req->set(boost::beast::http::field::content_type, "application/json");
 
+        for (const auto& [name, value] : m_headers)
+        {
+            req->set(name, value);
+        }
+
         // Set these headers after user-specified headers. These cannot be overridden.
 
         req->set(boost::beast::http::field::host, m_uri.host + ":" + std::to_string(m_uri.port));
@@ -118,107 +264,221 @@ struct HttpClient::RequestState : public std::enable_shared_from_this<HttpClient
         BOOST_LOG_TRIVIAL(debug) << "HttpClient writing request";
         BOOST_LOG_TRIVIAL(debug) << *req;
 
-        if (m_uri.scheme == "https")
-        {
-            boost::beast::http::async_write(
-                m_ssl_stream,
-                *req,
-                boost::beast::bind_front_handler(
-                    [_this = shared_from_this(), req](auto &&PH1, auto &&PH2) { _this->OnAsyncWrite(PH1, PH2); }));
-        }
-        else
-        {
-            boost::beast::http::async_write(
-                m_stream,
-                *req,
-                boost::beast::bind_front_handler(
-                    [_this = shared_from_this(), req](auto &&PH1, auto &&PH2) { _this->OnAsyncWrite(PH1, PH2); }));
-        }
+        const auto on_write = [_this = shared_from_this(), req](auto &&PH1, auto &&PH2) { _this->OnAsyncWrite(PH1, PH2); };
+
+        if (m_conn->tls) { boost::beast::http::async_write(*m_conn->ssl_stream, *req, on_write); }
+        else             { boost::beast::http::async_write(*m_conn->stream, *req, on_write); }
     }
 
     void OnAsyncWrite(boost::system::error_code ec, std::size_t size)
     {
         if (ec)
         {
-            BOOST_LOG_TRIVIAL(error) << "HttpClient write error: " << ec.message();
-            return;
+            return Fail("write", ec);
         }
 
         BOOST_LOG_TRIVIAL(debug) << "HttpClient request written (" << size << " bytes)";
 
-        if (m_uri.scheme == "https")
-        {
-            boost::beast::http::async_read(
-                m_ssl_stream,
-                m_buffer,
-                m_res,
-                boost::beast::bind_front_handler(
-                    [_this = shared_from_this()](auto &&PH1, auto &&PH2)
-                    {
-                        _this->OnAsyncRead(
-                            std::forward<decltype(PH1)>(PH1),
-                            std::forward<decltype(PH2)>(PH2));
-                    }));
-        }
-        else
-        {
-            boost::beast::http::async_read(
-                m_stream,
-                m_buffer,
-                m_res,
-                boost::beast::bind_front_handler(
-                    [_this = shared_from_this()](auto && PH1, auto && PH2)
-                    {
-                        _this->OnAsyncRead(
-                            std::forward<decltype(PH1)>(PH1),
-                            std::forward<decltype(PH2)>(PH2));
-                    }));
-        }
+        const auto on_read = [_this = shared_from_this()](auto &&PH1, auto &&PH2) { _this->OnAsyncRead(PH1, PH2); };
+
+        if (m_conn->tls) { boost::beast::http::async_read(*m_conn->ssl_stream, m_conn->buffer, m_res, on_read); }
+        else             { boost::beast::http::async_read(*m_conn->stream, m_conn->buffer, m_res, on_read); }
     }
 
     void OnAsyncRead(boost::system::error_code ec, std::size_t size)
     {
         if (ec)
         {
-            BOOST_LOG_TRIVIAL(info) << "Webhook read error: " << ec.message();
-            return;
+            return Fail("read", ec);
         }
 
         BOOST_LOG_TRIVIAL(debug) << "HttpClient read " << size << " bytes";
         BOOST_LOG_TRIVIAL(debug) << m_res;
 
-        m_callback();
+        // Session tickets may arrive after the handshake, so the session is kept once a
+        // response has been read.
+        if (m_conn->tls)
+        {
+            if (auto* session = SSL_get1_session(m_conn->ssl_stream->native_handle()))
+            {
+                auto& host = m_pool->hosts[m_key];
+                if (host.session != nullptr) { SSL_SESSION_free(host.session); }
+                host.session = session;
+            }
+        }
+
+        m_pool->Release(m_key, std::move(m_conn), m_res.keep_alive());
+
+        std::map<std::string, std::string> headers;
+
+        for (const auto& field : m_res)
+        {
+            std::string name(field.name_string());
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+            headers.insert_or_assign(std::move(name), std::string(field.value()));
+        }
+
+        m_callback(Response{
+            .status  = static_cast<int>(m_res.result_int()),
+            .body    = std::move(m_res.body()),
+            .headers = std::move(headers)
+        });
     }
 
-    boost::asio::ip::tcp::resolver m_resolver;
-    boost::beast::flat_buffer m_buffer;
     boost::beast::http::response<boost::beast::http::string_body> m_res;
-    boost::beast::tcp_stream m_stream;
-    boost::asio::ssl::context m_ssl_ctx;
-    boost::beast::ssl_stream<boost::beast::tcp_stream> m_ssl_stream;
+    std::shared_ptr<Pool> m_pool;
+    std::shared_ptr<Connection> m_conn;
+    bool m_reused = false;
+    std::string m_key;
     porla::Uri m_uri;
     std::string m_payload;
-    std::function<void()> m_callback;
+    std::map<std::string, std::string> m_headers;
+    std::chrono::milliseconds m_timeout{0};
+    std::function<void(const Response&)> m_callback;
 };
 
-HttpClient::HttpClient(boost::asio::io_context& io)
-    : m_io(io)
+void HttpClient::Pool::Acquire(const std::shared_ptr<RequestState>& state)
+{
+    auto& host = hosts[state->m_key];
+    const auto now = std::chrono::steady_clock::now();
+
+    while (!host.idle.empty())
+    {
+        auto conn = std::move(host.idle.back());
+        host.idle.pop_back();
+
+        if (now - conn->idle_since < options.idle_timeout)
+        {
+            return state->Start(std::move(conn), true);
+        }
+
+        boost::beast::error_code ec;
+        conn->Lowest().socket().close(ec);
+        host.open--;
+    }
+
+    if (host.open >= options.max_connections_per_host)
+    {
+        host.waiting.push_back(state);
+        return;
+    }
+
+    host.open++;
+    state->Start(std::make_shared<Connection>(io, state->m_uri.scheme == "https"), false);
+}
+
+void HttpClient::Pool::Release(const std::string& key, std::shared_ptr<Connection> conn, bool reusable)
+{
+    auto& host = hosts[key];
+
+    if (conn == nullptr)
+    {
+        return;
+    }
+
+    if (!reusable)
+    {
+        boost::beast::error_code ec;
+        conn->Lowest().socket().close(ec);
+        host.open--;
+
+        if (!host.waiting.empty())
+        {
+            auto next = std::move(host.waiting.front());
+            host.waiting.pop_front();
+            Acquire(next);
+        }
+
+        return;
+    }
+
+    if (!host.waiting.empty())
+    {
+        auto next = std::move(host.waiting.front());
+        host.waiting.pop_front();
+        return next->Start(std::move(conn), true);
+    }
+
+    conn->idle_since = std::chrono::steady_clock::now();
+    host.idle.push_back(std::move(conn));
+}
+
+void HttpClient::Pool::Resolve(const std::string& host, const std::string& port, ResolveHandler handler)
+{
+    auto& lookup = lookups[host + ":" + port];
+
+    if (lookup.resolving)
+    {
+        lookup.waiting.push_back(std::move(handler));
+        return;
+    }
+
+    if (std::chrono::steady_clock::now() < lookup.expires)
+    {
+        return handler(lookup.ec, lookup.endpoints);
+    }
+
+    lookup.resolving = true;
+    lookup.waiting.push_back(std::move(handler));
+
+    resolver.async_resolve(
+        host,
+        port,
+        [_this = shared_from_this(), key = host + ":" + port](boost::system::error_code ec, const Endpoints& endpoints)
+        {
+            auto& lookup = _this->lookups[key];
+
+            // asio does not expose record TTLs, so the configured ones are used.
+            lookup.ec        = ec;
+            lookup.endpoints = endpoints;
+            lookup.expires   = std::chrono::steady_clock::now() + (ec ? _this->options.dns_negative_ttl : _this->options.dns_ttl);
+            lookup.resolving = false;
+
+            const auto waiting = std::move(lookup.waiting);
+            lookup.waiting.clear();
+
+            for (const auto& handler : waiting)
+            {
+                handler(ec, endpoints);
+            }
+        });
+}
+
+HttpClient::HttpClient(boost::asio::io_context& io, HttpClientOptions options)
+    : m_pool(std::make_shared<Pool>(io, options))
 {
 }
 
+HttpClient::~HttpClient() = default;
+
 void HttpClient::SendAsync(const Request& req, const std::function<void()>& callback)
 {
-    auto state = std::make_shared<RequestState>(m_io);
+    SendAsync(
+        req,
+        [callback](const Response& res)
+        {
+            if (!res.ec) callback();
+        });
+}
+
+void HttpClient::SendAsync(const Request& req, const std::function<void(const Response&)>& callback)
+{
+    auto state = std::make_shared<RequestState>(m_pool);
     state->m_callback = callback;
+    state->m_headers  = req.headers;
     state->m_payload  = req.body;
+    state->m_timeout  = req.timeout;
 
     if (!Uri::Parse(req.url, state->m_uri))
     {
         BOOST_LOG_TRIVIAL(error) << "Failed to parse uri: " << req.url;
-        return;
+        return callback(Response{ .ec = boost::asio::error::invalid_argument });
     }
 
+    state->m_key = HostKey(state->m_uri);
+
     BOOST_LOG_TRIVIAL(debug) << "Sending HTTP request to " << req.url;
 
-    state->Send();
+    m_pool->Acquire(state);
 }
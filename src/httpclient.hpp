@@ -1,11 +1,27 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <map>
+#include <memory>
+#include <string>
 
 #include <boost/asio.hpp>
 
 namespace porla
 {
+    struct HttpClientOptions
+    {
+        std::chrono::seconds dns_negative_ttl = std::chrono::seconds(5);
+        std::chrono::seconds dns_ttl = std::chrono::seconds(60);
+        std::chrono::seconds idle_timeout = std::chrono::seconds(30);
+        int max_connections_per_host = 4;
+    };
+
+    // Sends requests over keep-alive connections pooled per host. HTTPS connections share
+    // one TLS context and resume the last session of their host. Requests beyond the
+    // connection cap wait for a free connection. Host lookups are cached. Used from the
+    // io thread.
     class HttpClient
     {
     public:
@@ -14,14 +30,34 @@ namespace porla
             std::string url;
             std::string method;
             std::string body;
+            std::map<std::string, std::string> headers;
+            // Closes the connection if the response has not been read by then. Zero waits
+            // as long as the server keeps the connection open.
+            std::chrono::milliseconds timeout{0};
+        };
+
+        struct Response
+        {
+            boost::system::error_code ec;
+            int status = 0;
+            std::string body;
+            // By lowercase name. Repeated headers keep the last value.
+            std::map<std::string, std::string> headers;
         };
 
-        explicit HttpClient(boost::asio::io_context& io);
+        explicit HttpClient(boost::asio::io_context& io, HttpClientOptions options = {});
+        ~HttpClient();
+
+        // The callback is only invoked for requests which got a response.
         void SendAsync(const Request& req, const std::function<void()>& callback);
+        // The callback is invoked for failed requests too, with the error set.
+        void SendAsync(const Request& req, const std::function<void(const Response&)>& callback);
 
     private:
+        struct Connection;
+        struct Pool;
         struct RequestState;
 
-        boost::asio::io_context& m_io;
+        std::shared_ptr<Pool> m_pool;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,79 @@
+#include "httpcontext.hpp"
+
+#include "utils/encoding.hpp"
+
+using porla::HttpContext;
+using porla::Utils::Encoding;
+
+boost::beast::http::response<boost::beast::http::string_body> HttpContext::JsonResponse(
+    const boost::beast::http::request<boost::beast::http::string_body>& req,
+    const nlohmann::json& j)
+{
+    namespace http = boost::beast::http;
+
+    // Clients asking for MessagePack or CBOR get the same document in that encoding,
+    // which is both smaller and cheaper to produce for large responses.
+    const auto accept   = req.find(http::field::accept);
+    const auto encoding = accept != req.end()
+        ? Encoding::FromMediaType({accept->value().data(), accept->value().size()})
+        : Encoding::Type::Json;
+
+    http::response<http::string_body> res{http::status::ok, req.version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, Encoding::MediaType(encoding));
+    res.keep_alive(req.keep_alive());
+    res.body() = Encoding::Dump(j, encoding);
+    res.prepare_payload();
+
+    return res;
+}
+
+void HttpContext::WriteFile(
+    boost::beast::http::response<boost::beast::http::empty_body> res,
+    boost::beast::file file,
+    std::uint64_t offset,
+    std::uint64_t length,
+    FileAvailability available)
+{
+    namespace http = boost::beast::http;
+
+    if (available)
+    {
+        http::response<http::string_body> error{http::status::service_unavailable, res.version()};
+        error.set(http::field::server, "porla/1.0");
+        error.set(http::field::content_type, "text/plain");
+        error.keep_alive(res.keep_alive());
+        error.body() = "The file is not downloaded yet";
+        error.prepare_payload();
+        return Write(std::move(error));
+    }
+
+    http::response<http::string_body> full{std::move(res)};
+    full.body().resize(length);
+
+    boost::beast::error_code ec;
+    file.seek(offset, ec);
+
+    std::size_t read = 0;
+
+    while (!ec && read < length)
+    {
+        const auto n = file.read(full.body().data() + read, length - read, ec);
+        if (n == 0) { break; }
+        read += n;
+    }
+
+    if (ec || read < length)
+    {
+        http::response<http::string_body> error{http::status::internal_server_error, full.version()};
+        error.set(http::field::server, "porla/1.0");
+        error.set(http::field::content_type, "text/plain");
+        error.keep_alive(full.keep_alive());
+        error.body() = "The file could not be read";
+        error.prepare_payload();
+        return Write(std::move(error));
+    }
+
+    full.prepare_payload();
+    Write(std::move(full));
+}
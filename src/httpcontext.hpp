@@ -1,27 +1,70 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
 #include <boost/beast.hpp>
 #include <nlohmann/json.hpp>
 
 namespace porla
 {
+    class TraceSpan;
+
     class HttpContext
     {
     public:
         struct Uri
         {
-            std::string path;
+            std::string                        path;
+            std::map<std::string, std::string> query;
         };
 
+        // The response WriteJson writes, in the encoding the Accept header asks for.
+        static boost::beast::http::response<boost::beast::http::string_body> JsonResponse(
+            const boost::beast::http::request<boost::beast::http::string_body>& req,
+            const nlohmann::json& j);
+
         virtual void Next() = 0;
 
         virtual boost::beast::http::request<boost::beast::http::string_body>& Request() = 0;
         virtual Uri& RequestUri() = 0;
         virtual boost::beast::tcp_stream& Stream() = 0;
 
+        // The span of the current operation when the request is traced, for adding children.
+        virtual std::shared_ptr<TraceSpan> Trace() { return nullptr; }
+
+        // True for requests over the Unix socket, where the socket's file permissions
+        // decide who may connect.
+        virtual bool Local() { return false; }
+
         virtual void Write(std::string body) = 0;
         virtual void Write(boost::beast::http::response<boost::beast::http::file_body> res) = 0;
         virtual void Write(boost::beast::http::response<boost::beast::http::string_body> res) = 0;
         virtual void WriteJson(const nlohmann::json& j) = 0;
+
+        // Calls done, from any thread, with how many bytes of the file from offset can be
+        // read once at least one can. Zero means no more will be.
+        typedef std::function<void(std::uint64_t offset, std::function<void(std::uint64_t available)> done)> FileAvailability;
+
+        // Writes length bytes of file from offset as the body of res, which has every header
+        // but the content length set. With available set, the file is only read as far as
+        // it says, for files which are still being written. HTTP sessions send it straight
+        // from the page cache with sendfile where they can. Other contexts read the range
+        // into memory, and answer 503 to files which are still being written.
+        virtual void WriteFile(
+            boost::beast::http::response<boost::beast::http::empty_body> res,
+            boost::beast::file file,
+            std::uint64_t offset,
+            std::uint64_t length,
+            FileAvailability available = nullptr);
+
+        // Writes a chunked response with the body produced by next, which appends the next
+        // part to the chunk and returns false after the last one. It is called on the
+        // connection's executor once the previous chunk is written, so at most one chunk is
+        // held in memory.
+        virtual void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) = 0;
     };
 }
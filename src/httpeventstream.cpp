@@ -1,66 +1,494 @@
 #include "httpeventstream.hpp"
 
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <set>
+#include <string_view>
+#include <type_traits>
 
 #include <boost/log/trivial.hpp>
+#include <libtorrent/hex.hpp>
 #include <nlohmann/json.hpp>
 
 #include "json/all.hpp"
+#include "json/writer.hpp"
+#include "query/pql.hpp"
 #include "session.hpp"
+#include "utils/string.hpp"
 
 namespace lt = libtorrent;
 
 using json = nlohmann::json;
 using porla::HttpEventStream;
+using porla::Query::PQL;
+
+// Events are serialized once per broadcast and shared, immutable, by every client queue.
+typedef std::shared_ptr<const std::string> EventBuffer;
+
+static EventBuffer Format(const std::string& name, const std::string& data, std::uint64_t id = 0)
+{
+    std::string evt;
+    evt.reserve(name.size() + data.size() + 48);
+    if (id > 0) evt.append("id: ").append(std::to_string(id)).append("\n");
+    evt.append("event: ").append(name).append("\n");
+    evt.append("data: ").append(data).append("\n\n");
+
+    return std::make_shared<const std::string>(std::move(evt));
+}
+
+// What a client asked to receive, from the query string of the events request. Everything
+// is included when nothing is set.
+struct Subscription
+{
+    std::set<std::string> events;
+    std::shared_ptr<PQL::Filter> filter;
+    // The session metrics sent with session_metrics_updated. Names ending in '*' match
+    // every metric they start with. The key is the same for the same metrics, so clients
+    // asking for them share one payload.
+    std::set<std::string> metrics;
+    std::string metrics_key;
+    std::set<lt::sha1_hash> v1;
+    std::set<lt::sha256_hash> v2;
+    // The torrent whose peers are sent, as a peers event with all of them and then a
+    // peers_diff for each sample that changed anything.
+    std::optional<lt::info_hash_t> peers;
+
+    [[nodiscard]] bool Filtered() const
+    {
+        return filter != nullptr || !v1.empty() || !v2.empty();
+    }
+
+    // Events sent only to clients which name them, so existing clients are not sent the
+    // same torrents twice.
+    static bool OptIn(const std::string& name)
+    {
+        return name == "torrents_lifecycle";
+    }
+
+    [[nodiscard]] bool Wants(const std::string& name) const
+    {
+        return events.empty() ? !OptIn(name) : events.contains(name);
+    }
+
+    // Torrents that are gone have no status, so they only have their hash checked.
+    [[nodiscard]] bool Includes(const lt::info_hash_t& hash, const lt::torrent_status* status) const
+    {
+        if ((!v1.empty() || !v2.empty())
+            && !(hash.has_v1() && v1.contains(hash.v1))
+            && !(hash.has_v2() && v2.contains(hash.v2)))
+        {
+            return false;
+        }
+
+        return filter == nullptr || status == nullptr || filter->Includes(*status);
+    }
+};
+
+static Subscription ParseSubscription(const std::map<std::string, std::string>& params)
+{
+    const auto param = [&params](const std::string& key) -> std::string
+    {
+        const auto it = params.find(key);
+        return it != params.end() ? it->second : "";
+    };
+
+    Subscription subscription;
+
+    for (const auto& name : porla::Utils::String::Split(param("events"), ","))
+    {
+        if (!name.empty()) subscription.events.insert(name);
+    }
+
+    for (const auto& hex : porla::Utils::String::Split(param("info_hashes"), ","))
+    {
+        if (hex.size() == 40)
+        {
+            lt::sha1_hash hash;
+            if (lt::aux::from_hex(hex, hash.data())) subscription.v1.insert(hash);
+        }
+        else if (hex.size() == 64)
+        {
+            lt::sha256_hash hash;
+            if (lt::aux::from_hex(hex, hash.data())) subscription.v2.insert(hash);
+        }
+    }
+
+    if (const auto hex = param("peers"); hex.size() == 40)
+    {
+        lt::sha1_hash hash;
+        if (lt::aux::from_hex(hex, hash.data())) subscription.peers = lt::info_hash_t(hash);
+    }
+    else if (hex.size() == 64)
+    {
+        lt::sha256_hash hash;
+        if (lt::aux::from_hex(hex, hash.data())) subscription.peers = lt::info_hash_t(hash);
+    }
+
+    if (const auto q = param("query"); !q.empty())
+    {
+        subscription.filter = PQL::ParseCached(q);
+    }
+
+    for (const auto& name : porla::Utils::String::Split(param("metrics"), ","))
+    {
+        if (!name.empty()) subscription.metrics.insert(name);
+    }
+
+    for (const auto& name : subscription.metrics)
+    {
+        if (!subscription.metrics_key.empty()) subscription.metrics_key.push_back(',');
+        subscription.metrics_key.append(name);
+    }
+
+    return subscription;
+}
+
+// Counters are sent as their value, how much they grew over the interval and the rate per
+// second, and gauges as their value.
+static std::string MetricsPayload(const porla::SessionMetrics& stats, const std::set<std::string>& names)
+{
+    std::string out;
+    out.append("{\"interval\":");
+    porla::Json::Write(out, stats.Interval());
+    out.append(",\"metrics\":{");
+
+    bool first = true;
+
+    const auto write = [&](std::size_t index)
+    {
+        if (!first) out.push_back(',');
+        first = false;
+
+        porla::Json::WriteString(out, stats.Name(index));
+        out.push_back(':');
+
+        if (!stats.IsCounter(index))
+        {
+            porla::Json::Write(out, stats.Value(index));
+            return;
+        }
+
+        out.push_back('[');
+        porla::Json::Write(out, stats.Value(index));
+        out.push_back(',');
+        porla::Json::Write(out, stats.Delta(index));
+        out.push_back(',');
+        porla::Json::Write(out, stats.Rate(index));
+        out.push_back(']');
+    };
+
+    std::set<std::size_t> indices;
+
+    for (const auto& name : names)
+    {
+        if (!name.ends_with('*'))
+        {
+            if (const auto index = stats.Find(name)) indices.insert(*index);
+            continue;
+        }
+
+        const std::string_view prefix(name.data(), name.size() - 1);
+
+        for (std::size_t i = 0; i < stats.Size(); i++)
+        {
+            if (stats.Name(i).starts_with(prefix)) indices.insert(i);
+        }
+    }
+
+    for (const auto index : indices) write(index);
+
+    out.append("}}");
+
+    return out;
+}
+
+static EventBuffer PeersEvent(const lt::info_hash_t& hash, const std::vector<lt::peer_info>& peers)
+{
+    return Format("peers", json({{"info_hash", hash}, {"peers", peers}}).dump());
+}
+
+// Peers are told apart by their endpoint. Those which stayed connected are sent with their
+// ip and the fields that changed, and those which left with only their ip. Null if
+// nothing changed.
+static EventBuffer PeersDiff(
+    const lt::info_hash_t& hash,
+    const std::vector<lt::peer_info>& before,
+    const std::vector<lt::peer_info>& after)
+{
+    const auto& fields = porla::PeerInfoFields();
+    const auto& ip = fields.at("ip");
+
+    std::map<lt::tcp::endpoint, const lt::peer_info*> previous;
+
+    for (const auto& peer : before)
+    {
+        previous.emplace(peer.ip, &peer);
+    }
+
+    json joined  = json::array();
+    json changed = json::array();
+    json left    = json::array();
+
+    for (const auto& peer : after)
+    {
+        const auto prev = previous.find(peer.ip);
+
+        if (prev == previous.end())
+        {
+            joined.push_back(json(peer));
+            continue;
+        }
+
+        json j = {{"ip", ip.to_json(peer)}};
+
+        for (const auto& [name, field] : fields)
+        {
+            auto current = field.to_json(peer);
+            if (current != field.to_json(*prev->second)) j[name] = std::move(current);
+        }
+
+        if (j.size() > 1)
+        {
+            changed.push_back(std::move(j));
+        }
+
+        previous.erase(prev);
+    }
+
+    for (const auto& [endpoint, peer] : previous)
+    {
+        left.push_back(ip.to_json(*peer));
+    }
+
+    if (joined.empty() && changed.empty() && left.empty())
+    {
+        return nullptr;
+    }
+
+    return Format("peers_diff", json({
+        {"info_hash", hash},
+        {"joined",    joined},
+        {"left",      left},
+        {"changed",   changed}
+    }).dump());
+}
+
+// Clients opt in to field diffs with diff=true. Diffs are never coalesced, since each one
+// only holds what changed since the previous.
+static bool WantsDiff(const std::map<std::string, std::string>& params)
+{
+    const auto it = params.find("diff");
+    return it != params.end() && (it->second == "true" || it->second == "1");
+}
+
+// Writes events to the response of an events request, after its headers.
+class ResponseSink : public HttpEventStream::Sink
+{
+public:
+    explicit ResponseSink(std::shared_ptr<porla::HttpContext> ctx)
+        : m_ctx(std::move(ctx))
+    {
+    }
+
+    boost::asio::any_io_executor Executor() override
+    {
+        return m_ctx->Stream().get_executor();
+    }
+
+    // Everything queued while the previous write was in flight goes out in one
+    // scatter-gather write, straight from the shared buffers.
+    void Write(
+        std::vector<std::shared_ptr<const std::string>> events,
+        std::function<void(boost::system::error_code, std::size_t)> done) override
+    {
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.reserve(events.size());
+
+        for (const auto& evt : events)
+        {
+            buffers.emplace_back(boost::asio::buffer(*evt));
+        }
+
+        boost::asio::async_write(
+            m_ctx->Stream(),
+            buffers,
+            [events = std::move(events), done = std::move(done)](boost::system::error_code ec, std::size_t bytes)
+            {
+                done(ec, bytes);
+            });
+    }
+
+    void Close() override
+    {
+        boost::system::error_code ec;
+        m_ctx->Stream().socket().close(ec);
+    }
+
+private:
+    std::shared_ptr<porla::HttpContext> m_ctx;
+};
 
 class HttpEventStream::ContextState : public std::enable_shared_from_this<HttpEventStream::ContextState>
 {
 public:
-    explicit ContextState(std::shared_ptr<porla::HttpContext> context)
-        : m_ctx(std::move(context))
+    explicit ContextState(
+        std::shared_ptr<Sink> sink,
+        const HttpEventStreamOptions& options,
+        std::shared_ptr<Counters> counters,
+        Subscription subscription,
+        bool diff)
+        : m_sink(std::move(sink))
+        , m_options(options)
+        , m_counters(std::move(counters))
+        , m_subscription(std::move(subscription))
+        , m_diff(diff)
     {
     }
 
-    bool IsDead() const { return m_ctx == nullptr || m_dead; }
+    ~ContextState()
+    {
+        SetQueued(0);
+    }
+
+    bool IsDead() const { return m_sink == nullptr || m_dead; }
+
+    // Ends the subscription without closing the connection.
+    void Stop() { m_dead = true; }
 
-    void QueueWrite(std::string data)
+    [[nodiscard]] const Subscription& Subscribed() const { return m_subscription; }
+
+    // Set for clients that asked for field diffs in state_update events.
+    bool WantsDiff() const { return m_diff; }
+
+    // The torrent the client watches the peers of, with the hash it has in the session.
+    // Synced once the client was sent the sample that the next diff builds on.
+    [[nodiscard]] const std::optional<lt::info_hash_t>& Peers() const { return m_peers; }
+    [[nodiscard]] bool PeersSynced() const { return m_peersSynced; }
+    void WatchPeers(const lt::info_hash_t& hash) { m_peers = hash; }
+    void SetPeersSynced() { m_peersSynced = true; }
+
+    // The sink may run on an HTTP thread, so writes are queued on its strand. Events with
+    // a coalesce key replace any queued event with the same key that is not yet written.
+    // Keys are static names, so queueing one copies no string for each client.
+    void QueueWrite(EventBuffer data, std::string_view coalesce_key = {})
     {
         if (m_dead) { return; }
-        m_sendData.push(std::move(data));
-        MaybeWrite();
+
+        boost::asio::dispatch(
+            m_sink->Executor(),
+            [_this = shared_from_this(), data = std::move(data), key = coalesce_key]() mutable
+            {
+                _this->Enqueue(Event{ .data = std::move(data), .coalesce_key = key });
+            });
     }
 
 private:
+    struct Event
+    {
+        EventBuffer      data;
+        std::string_view coalesce_key;
+    };
+
+    // Upper bound on the events gathered into a single write.
+    static constexpr std::size_t MaxGather = 16;
+
+    void Enqueue(Event evt)
+    {
+        if (m_dead) { return; }
+
+        if (!evt.coalesce_key.empty())
+        {
+            // Events in flight are already being written, so leave those alone.
+            const auto superseded = std::find_if(
+                m_sendData.begin() + static_cast<std::ptrdiff_t>(m_inFlight),
+                m_sendData.end(),
+                [&evt](const Event& queued) { return queued.coalesce_key == evt.coalesce_key; });
+
+            if (superseded != m_sendData.end())
+            {
+                SetQueued(m_queuedBytes - superseded->data->size());
+                m_sendData.erase(superseded);
+                m_counters->coalesced++;
+            }
+        }
+
+        SetQueued(m_queuedBytes + evt.data->size());
+        m_sendData.push_back(std::move(evt));
+
+        if (m_sendData.size() > m_options.max_queued_events || m_queuedBytes > m_options.max_queued_bytes)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Disconnecting slow event stream client with "
+                                       << m_sendData.size() << " event(s) (" << m_queuedBytes << " bytes) queued";
+
+            return Disconnect();
+        }
+
+        MaybeWrite();
+    }
+
+    // Kept in the counters as well, summed over every client, for the memory accounting.
+    void SetQueued(std::size_t bytes)
+    {
+        m_counters->queued_bytes += bytes;
+        m_counters->queued_bytes -= m_queuedBytes;
+        m_queuedBytes = bytes;
+    }
+
+    void Disconnect()
+    {
+        m_dead = true;
+        m_counters->disconnected++;
+        m_counters->dropped += m_sendData.size() - m_inFlight;
+
+        // Closing cancels the write in flight, which releases the rest of the queue.
+        m_sendData.erase(m_sendData.begin() + static_cast<std::ptrdiff_t>(m_inFlight), m_sendData.end());
+        SetQueued(0);
+
+        m_sink->Close();
+    }
+
     void MaybeWrite()
     {
-        if (m_dead || m_isWriting || m_sendData.empty())
+        if (m_dead || m_inFlight > 0 || m_sendData.empty())
         {
             return;
         }
 
-        const std::string& data = m_sendData.front();
+        std::vector<EventBuffer> events;
+        m_inFlight = std::min(m_sendData.size(), MaxGather);
+        events.reserve(m_inFlight);
 
-        boost::asio::async_write(
-            m_ctx->Stream(),
-            boost::asio::buffer(data),
-            [_this = shared_from_this()](boost::system::error_code ec, int b)
+        for (std::size_t i = 0; i < m_inFlight; i++)
+        {
+            events.emplace_back(m_sendData[i].data);
+        }
+
+        m_sink->Write(
+            std::move(events),
+            [_this = shared_from_this()](boost::system::error_code ec, std::size_t b)
             {
                 _this->OnWrite(ec, b);
             });
-
-        m_isWriting = true;
     }
 
-    void OnWrite(boost::system::error_code ec, int bytes)
+    void OnWrite(boost::system::error_code ec, std::size_t bytes)
     {
-        m_isWriting = false;
-        m_sendData.pop();
+        for (std::size_t i = 0; i < m_inFlight && !m_sendData.empty(); i++)
+        {
+            SetQueued(m_queuedBytes - std::min(m_queuedBytes, m_sendData.front().data->size()));
+            m_sendData.pop_front();
+        }
+
+        m_inFlight = 0;
 
         if (ec)
         {
             m_dead = true;
 
             if (ec == boost::asio::error::broken_pipe
+                || ec == boost::asio::error::operation_aborted
                 || ec == boost::asio::error::timed_out)
             {
                 // Client disconnected
@@ -72,66 +500,501 @@ private:
             return;
         }
 
-        m_sent += bytes;
+        m_sent += static_cast<int64_t>(bytes);
 
         MaybeWrite();
     }
 
-    bool m_dead {false};
-    bool m_isWriting {false};
+    std::atomic<bool> m_dead {false};
+    std::size_t m_inFlight {0};
+    std::size_t m_queuedBytes {0};
     int64_t m_sent{0};
-    std::queue<std::string> m_sendData;
-    std::shared_ptr<porla::HttpContext> m_ctx;
+    std::deque<Event> m_sendData;
+    std::shared_ptr<Sink> m_sink;
+    HttpEventStreamOptions m_options;
+    std::shared_ptr<Counters> m_counters;
+    Subscription m_subscription;
+    bool m_diff;
+    std::optional<lt::info_hash_t> m_peers;
+    bool m_peersSynced {false};
 };
 
-HttpEventStream::HttpEventStream(porla::ISession &session)
+HttpEventStream::HttpEventStream(boost::asio::io_context& io, porla::ISession &session, HttpEventStreamOptions options)
     : m_session(session)
+    , m_options(options)
+    , m_heartbeat(io)
+    , m_counters(std::make_shared<Counters>())
+    , m_firstId(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count())
+    , m_lastId(m_firstId)
+    , m_evictedId(m_firstId)
+    , m_peersTimer(io)
+    , m_peersSampling(false)
+    , m_self(std::make_shared<HttpEventStream*>(this))
 {
-    m_sessionStatsConnection = m_session.OnSessionStats([this](auto s) { OnSessionStats(s); });
+    m_sessionStatsConnection = m_session.OnSessionStats([this](const auto& s) { OnSessionStats(s); });
     m_stateUpdateConnection = m_session.OnStateUpdate([this](auto s) { OnStateUpdate(s); });
+    m_torrentLifecycleConnection = m_session.OnTorrentLifecycle([this](const auto& l) { OnTorrentLifecycle(l); });
     m_torrentPausedConnection = m_session.OnTorrentPaused([this](auto s) { OnTorrentPaused(s); });
     m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto s) { OnTorrentRemoved(s); });
     m_torrentResumedConnection = m_session.OnTorrentResumed([this](auto s) { OnTorrentResumed(s); });
+
+    if (m_options.heartbeat_interval > 0)
+    {
+        Heartbeat();
+    }
 }
 
 HttpEventStream::~HttpEventStream()
 {
+    boost::system::error_code ec;
+    m_heartbeat.cancel(ec);
+    m_peersTimer.cancel(ec);
+
     m_sessionStatsConnection.disconnect();
     m_stateUpdateConnection.disconnect();
+    m_torrentLifecycleConnection.disconnect();
     m_torrentPausedConnection.disconnect();
     m_torrentRemovedConnection.disconnect();
     m_torrentResumedConnection.disconnect();
 }
 
+porla::MemoryUsage HttpEventStream::Memory() const
+{
+    MemoryUsage usage{
+        .bytes   = m_counters->queued_bytes.load() + m_snapshots.size() * (sizeof(Snapshot) + sizeof(lt::info_hash_t) + 32),
+        .objects = m_ctxs.size() + m_snapshots.size() + m_replay.size()
+    };
+
+    for (const auto& evt : m_replay)
+    {
+        usage.bytes += sizeof(Replayable) + evt.name.size() + (evt.buffer ? evt.buffer->size() : 0);
+    }
+
+    for (const auto& [hash, watch] : m_peerWatches)
+    {
+        usage.bytes += sizeof(PeerWatch) + sizeof(lt::info_hash_t) + 32
+            + (watch.peers ? watch.peers->size() * sizeof(lt::peer_info) : 0);
+        usage.objects++;
+    }
+
+    return usage;
+}
+
 void HttpEventStream::operator()(std::shared_ptr<HttpContext> context)
 {
-    std::string headers = "HTTP/1.1 200 OK\n"
-                          "Connection: keep-alive\n"
-                          "Content-Type: text/event-stream\n"
-                          "Cache-Control: no-cache, no-transform\n\n";
+    static const auto headers = std::make_shared<const std::string>(
+        "HTTP/1.1 200 OK\n"
+        "Connection: keep-alive\n"
+        "Content-Type: text/event-stream\n"
+        "Cache-Control: no-cache, no-transform\n\n");
+
+    Prune();
+
+    if (m_options.max_subscribers > 0 && m_ctxs.size() >= m_options.max_subscribers)
+    {
+        namespace http = boost::beast::http;
+
+        BOOST_LOG_TRIVIAL(warning) << "Rejecting event stream client, " << m_ctxs.size() << " already connected";
+
+        m_counters->rejected++;
+
+        http::response<http::string_body> res{http::status::service_unavailable, context->Request().version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::content_type, "text/plain");
+        res.set(http::field::retry_after, "30");
+        res.keep_alive(false);
+        res.body() = "Too many event stream clients";
+        res.prepare_payload();
+
+        return context->Write(std::move(res));
+    }
 
-    std::stringstream evt;
-    evt << "event: hello\n";
-    evt << "data: {}\n\n";
+    const auto& query = context->RequestUri().query;
+
+    Subscription subscription;
+
+    try
+    {
+        subscription = ParseSubscription(query);
+    }
+    catch (const porla::Query::QueryError& err)
+    {
+        namespace http = boost::beast::http;
+
+        http::response<http::string_body> res{http::status::bad_request, context->Request().version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::content_type, "text/plain");
+        res.keep_alive(context->Request().keep_alive());
+        res.body() = std::string("Invalid query: ") + err.what();
+        res.prepare_payload();
+
+        return context->Write(std::move(res));
+    }
+
+    // Browsers send the id of the last event they saw when reconnecting. The query parameter
+    // is for clients that cannot set headers.
+    std::string last_event_id = query.contains("last_event_id") ? query.at("last_event_id") : "";
+
+    if (const auto header = context->Request().find("Last-Event-ID"); header != context->Request().end())
+    {
+        last_event_id = std::string(header->value());
+    }
+
+    const bool wants_diff = WantsDiff(query);
+
+    auto state = std::make_shared<ContextState>(
+        std::make_shared<ResponseSink>(std::move(context)),
+        m_options,
+        m_counters,
+        std::move(subscription),
+        wants_diff);
 
-    auto state = std::make_shared<ContextState>(std::move(context));
     state->QueueWrite(headers);
-    state->QueueWrite(evt.str());
+
+    Add(state, last_event_id);
+}
+
+std::shared_ptr<void> HttpEventStream::Subscribe(std::shared_ptr<Sink> sink, const std::map<std::string, std::string>& params)
+{
+    Prune();
+
+    if (m_options.max_subscribers > 0 && m_ctxs.size() >= m_options.max_subscribers)
+    {
+        m_counters->rejected++;
+        return nullptr;
+    }
+
+    auto state = std::make_shared<ContextState>(
+        std::move(sink),
+        m_options,
+        m_counters,
+        ParseSubscription(params),
+        WantsDiff(params));
+
+    Add(state, params.contains("last_event_id") ? params.at("last_event_id") : "");
+
+    return std::shared_ptr<void>(nullptr, [state](void*) { state->Stop(); });
+}
+
+void HttpEventStream::Add(const std::shared_ptr<ContextState>& state, const std::string& last_event_id)
+{
+    static const auto hello = std::make_shared<const std::string>(
+        "event: hello\n"
+        "data: {}\n\n");
+
+    const bool wants_diff = state->WantsDiff();
+
+    state->QueueWrite(hello);
+
+    // If everything since the last event is still in the replay buffer the client catches
+    // up from it, otherwise it is told to reset and fetch everything again.
+    if (!last_event_id.empty())
+    {
+        std::uint64_t last = 0;
+
+        try { last = std::stoull(last_event_id); } catch (const std::exception&) {}
+
+        if (last < m_evictedId || last > m_lastId)
+        {
+            static const auto reset = std::make_shared<const std::string>(
+                "event: reset\n"
+                "data: {}\n\n");
+
+            state->QueueWrite(reset);
+        }
+        else
+        {
+            const auto& sub = state->Subscribed();
+
+            for (const auto& evt : m_replay)
+            {
+                if (evt.id <= last
+                    || evt.diff != wants_diff
+                    || !sub.Wants(evt.name)
+                    || (evt.hash.has_value() && !sub.Includes(*evt.hash, nullptr))
+                    || (evt.batch && sub.Filtered()))
+                {
+                    continue;
+                }
+
+                state->QueueWrite(evt.buffer);
+            }
+        }
+    }
 
     m_ctxs.push_back(state);
+    m_counters->subscribers = m_ctxs.size();
+
+    if (m_torrentUpdatesDemand == nullptr)
+    {
+        m_sessionStatsDemand   = m_session.Demand(ISession::Stats::Session);
+        m_torrentUpdatesDemand = m_session.Demand(ISession::Stats::Torrents);
+    }
+
+    if (const auto& peers = state->Subscribed().peers)
+    {
+        // Either hash of a hybrid torrent finds it.
+        lt::info_hash_t hash = *peers;
+
+        for (const auto& [info_hash, status] : m_session.TorrentStatuses())
+        {
+            if ((peers->has_v1() && info_hash.v1 == peers->v1) || (peers->has_v2() && info_hash.v2 == peers->v2))
+            {
+                hash = info_hash;
+                break;
+            }
+        }
+
+        state->WatchPeers(hash);
+
+        const auto& watch = m_peerWatches[hash];
+
+        if (watch.peers != nullptr)
+        {
+            state->QueueWrite(PeersEvent(hash, *watch.peers));
+            state->SetPeersSynced();
+        }
+
+        if (!m_peersSampling)
+        {
+            m_peersSampling = true;
+            SamplePeers();
+        }
+        else
+        {
+            RequestPeers(hash);
+        }
+    }
 }
 
-void HttpEventStream::Broadcast(const std::string& name, const std::string& data)
+void HttpEventStream::Broadcast(
+    const std::string& name,
+    const std::string& data,
+    const lt::info_hash_t* hash,
+    const lt::torrent_status* status)
 {
-    if (m_ctxs.empty())
+    Prune();
+
+    // Only the latest of these matter to a client that is behind, so they are neither
+    // kept for replay nor left queued behind a newer one. The key is a literal since it
+    // stays in the client queues.
+    const std::string_view coalesce_key =
+          name == "state_update"            ? "state_update"
+        : name == "session_metrics_updated" ? "session_metrics_updated"
+        : std::string_view();
+
+    const bool coalesce = !coalesce_key.empty();
+    const auto id = ++m_lastId;
+
+    EventBuffer buffer;
+
+    if (!coalesce)
+    {
+        buffer = Format(name, data, id);
+
+        Record(Replayable{
+            .id     = id,
+            .name   = name,
+            .hash   = hash != nullptr ? std::optional(*hash) : std::nullopt,
+            .buffer = buffer,
+            .diff   = false
+        });
+    }
+
+    for (auto& ctx : m_ctxs)
+    {
+        const auto& sub = ctx->Subscribed();
+
+        if (!sub.Wants(name) || (hash != nullptr && !sub.Includes(*hash, status)))
+        {
+            continue;
+        }
+
+        // Format lazily, so events no one subscribes to are never serialized.
+        if (buffer == nullptr)
+        {
+            buffer = Format(name, data, id);
+        }
+
+        ctx->QueueWrite(buffer, coalesce_key);
+    }
+}
+
+void HttpEventStream::Publish(const std::string& name, const std::string& data)
+{
+    Broadcast(name, data);
+}
+
+void HttpEventStream::Heartbeat()
+{
+    boost::system::error_code ec;
+
+    m_heartbeat.expires_from_now(boost::posix_time::milliseconds(m_options.heartbeat_interval), ec);
+    if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to set timer expiry: " << ec.message(); }
+
+    m_heartbeat.async_wait(
+        [this](boost::system::error_code ec)
+        {
+            if (ec) { return; }
+
+            static const auto heartbeat = std::make_shared<const std::string>(": heartbeat\n\n");
+
+            Prune();
+
+            for (auto& ctx : m_ctxs)
+            {
+                ctx->QueueWrite(heartbeat, "heartbeat");
+            }
+
+            Heartbeat();
+        });
+}
+
+void HttpEventStream::RequestPeers(const lt::info_hash_t& hash)
+{
+    const auto watch = m_peerWatches.find(hash);
+
+    if (watch == m_peerWatches.end() || watch->second.sampling)
+    {
+        return;
+    }
+
+    watch->second.sampling = true;
+
+    m_session.PeerInfo(
+        hash,
+        [self = std::weak_ptr<HttpEventStream*>(m_self), hash](porla::ISession::PeerInfoList peers)
+        {
+            if (const auto alive = self.lock())
+            {
+                (*alive)->OnPeers(hash, std::move(peers));
+            }
+        });
+}
+
+void HttpEventStream::SamplePeers()
+{
+    Prune();
+
+    std::set<lt::info_hash_t> watched;
+
+    for (const auto& ctx : m_ctxs)
+    {
+        if (ctx->Peers().has_value()) watched.insert(*ctx->Peers());
+    }
+
+    std::erase_if(m_peerWatches, [&watched](const auto& watch) { return !watched.contains(watch.first); });
+
+    if (m_peerWatches.empty())
+    {
+        m_peersSampling = false;
+        return;
+    }
+
+    // Collected first, since the session may call back before PeerInfo returns.
+    std::vector<lt::info_hash_t> hashes;
+    hashes.reserve(m_peerWatches.size());
+
+    for (const auto& [hash, watch] : m_peerWatches)
+    {
+        hashes.push_back(hash);
+    }
+
+    for (const auto& hash : hashes)
+    {
+        RequestPeers(hash);
+    }
+
+    boost::system::error_code ec;
+
+    m_peersTimer.expires_from_now(boost::posix_time::milliseconds(m_options.peers_interval), ec);
+    if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to set timer expiry: " << ec.message(); }
+
+    m_peersTimer.async_wait(
+        [this](boost::system::error_code ec)
+        {
+            if (ec) { return; }
+            SamplePeers();
+        });
+}
+
+void HttpEventStream::Record(Replayable evt)
+{
+    if (m_options.replay_events == 0)
     {
+        m_evictedId = evt.id;
         return;
     }
 
-    std::stringstream evt;
-    evt << "event: "<< name << "\n";
-    evt << "data: " << data << "\n\n";
+    m_replay.push_back(std::move(evt));
+
+    while (m_replay.size() > m_options.replay_events)
+    {
+        m_evictedId = m_replay.front().id;
+        m_replay.pop_front();
+    }
+}
+
+void HttpEventStream::OnPeers(const lt::info_hash_t& hash, std::shared_ptr<const std::vector<lt::peer_info>> peers)
+{
+    const auto watch = m_peerWatches.find(hash);
+
+    if (watch == m_peerWatches.end())
+    {
+        return;
+    }
+
+    watch->second.sampling = false;
+
+    // A torrent which is gone has no peers left.
+    if (peers == nullptr)
+    {
+        peers = std::make_shared<const std::vector<lt::peer_info>>();
+    }
 
+    Prune();
+
+    const auto& previous = watch->second.peers;
+
+    // Serialized once for every client watching the torrent, and lazily, since most
+    // samples have either no one to sync or nothing to diff.
+    EventBuffer snapshot;
+    EventBuffer diff;
+    bool diffed = false;
+
+    for (auto& ctx : m_ctxs)
+    {
+        if (ctx->Peers() != hash)
+        {
+            continue;
+        }
+
+        if (!ctx->PeersSynced() || previous == nullptr)
+        {
+            if (snapshot == nullptr) snapshot = PeersEvent(hash, *peers);
+
+            ctx->QueueWrite(snapshot);
+            ctx->SetPeersSynced();
+
+            continue;
+        }
+
+        if (!diffed)
+        {
+            diff   = PeersDiff(hash, *previous, *peers);
+            diffed = true;
+        }
+
+        // Never coalesced, since each one builds on the one before.
+        if (diff != nullptr) ctx->QueueWrite(diff);
+    }
+
+    watch->second.peers = std::move(peers);
+}
+
+void HttpEventStream::Prune()
+{
     m_ctxs.erase(
         std::remove_if(
             m_ctxs.begin(),
@@ -139,44 +1002,276 @@ void HttpEventStream::Broadcast(const std::string& name, const std::string& data
             [](auto ptr) { return ptr->IsDead(); }),
         m_ctxs.end());
 
-    for (auto& ctx : m_ctxs)
+    m_counters->subscribers = m_ctxs.size();
+
+    if (m_ctxs.empty())
     {
-        ctx->QueueWrite(evt.str());
+        m_sessionStatsDemand.reset();
+        m_torrentUpdatesDemand.reset();
     }
 }
 
-void HttpEventStream::OnSessionStats(const std::map<std::string, int64_t>& stats)
+void HttpEventStream::OnSessionStats(const porla::SessionMetrics& stats)
 {
-    Broadcast("session_metrics_updated", "{}");
+    static const std::string Name = "session_metrics_updated";
+
+    Prune();
+
+    const auto id = ++m_lastId;
+
+    // By the metrics asked for, with the empty key for clients which only want to know
+    // that there are new ones.
+    std::map<std::string, EventBuffer> payloads;
+
+    for (auto& ctx : m_ctxs)
+    {
+        const auto& sub = ctx->Subscribed();
+
+        if (!sub.Wants(Name))
+        {
+            continue;
+        }
+
+        auto& buffer = payloads[sub.metrics_key];
+
+        if (buffer == nullptr)
+        {
+            buffer = Format(Name, sub.metrics.empty() ? "{}" : MetricsPayload(stats, sub.metrics), id);
+        }
+
+        ctx->QueueWrite(buffer, Name);
+    }
 }
 
 void HttpEventStream::OnStateUpdate(const std::vector<lt::torrent_status>& torrents)
 {
-    json state = json::array();
+    Prune();
+
+    const auto id = ++m_lastId;
+
+    const auto subscribed = [](auto const& ctx) { return ctx->Subscribed().Wants("state_update"); };
+
+    const bool any_diff = std::any_of(
+        m_ctxs.begin(),
+        m_ctxs.end(),
+        [&](auto const& ctx) { return subscribed(ctx) && ctx->WantsDiff(); });
 
-    for (const auto& status : torrents)
+    // Every field is sent the first time a torrent is seen, and then only the fields that
+    // changed since the last broadcast. Entries stay null for torrents with no changes.
+    std::vector<json> diffs;
+
+    if (any_diff)
     {
-        json j = {
-            {"info_hash", status.info_hashes}
-        };
+        diffs.resize(torrents.size());
+
+        for (std::size_t i = 0; i < torrents.size(); i++)
+        {
+            const auto& status = torrents[i];
+
+            auto [it, inserted] = m_snapshots.try_emplace(status.info_hashes);
+            auto& snapshot = it->second;
+
+            json j = {{"info_hash", status.info_hashes}};
+
+            const auto field = [&](const char* name, auto& last, auto current)
+            {
+                if (inserted || last != current)
+                {
+                    j[name] = current;
+                    last = current;
+                }
+            };
+
+            field("download_rate", snapshot.download_rate, status.download_rate);
+            field("num_peers",     snapshot.num_peers,     status.num_peers);
+            field("num_seeds",     snapshot.num_seeds,     status.num_seeds);
+            field("progress",      snapshot.progress,      status.progress);
+            field("state",         snapshot.state,         static_cast<int>(status.state));
+            field("upload_rate",   snapshot.upload_rate,   status.upload_rate);
 
-        state.push_back(j);
+            if (j.size() > 1)
+            {
+                diffs[i] = std::move(j);
+            }
+        }
     }
 
-    Broadcast("state_update", state.dump());
+    // Builds the event for the torrents passing the predicate, or null if there are none
+    // and the event is filtered.
+    const auto build = [&](bool diff, const Subscription* sub) -> EventBuffer
+    {
+        json state = json::array();
+
+        for (std::size_t i = 0; i < torrents.size(); i++)
+        {
+            if (diff && diffs[i].is_null()) continue;
+            if (sub != nullptr && !sub->Includes(torrents[i].info_hashes, &torrents[i])) continue;
+
+            state.push_back(diff ? diffs[i] : json{{"info_hash", torrents[i].info_hashes}});
+        }
+
+        if (sub != nullptr && state.empty())
+        {
+            return nullptr;
+        }
+
+        return Format("state_update", state.dump(), id);
+    };
+
+    // Unfiltered clients share one buffer per format. Filtered clients get their own.
+    EventBuffer plain;
+    EventBuffer diff;
+
+    // Diffs are kept for replay since a client that misses one would have stale fields.
+    // Filtered clients have them replayed unfiltered.
+    if (any_diff)
+    {
+        diff = build(true, nullptr);
+
+        Record(Replayable{
+            .id     = id,
+            .name   = "state_update",
+            .buffer = diff,
+            .diff   = true
+        });
+    }
+
+    for (auto& ctx : m_ctxs)
+    {
+        if (!subscribed(ctx))
+        {
+            continue;
+        }
+
+        const auto& sub = ctx->Subscribed();
+
+        EventBuffer buffer;
+
+        if (sub.Filtered())
+        {
+            buffer = build(ctx->WantsDiff(), &sub);
+        }
+        else if (ctx->WantsDiff())
+        {
+            buffer = diff;
+        }
+        else
+        {
+            buffer = plain != nullptr ? plain : (plain = build(false, nullptr));
+        }
+
+        if (buffer == nullptr)
+        {
+            continue;
+        }
+
+        if (ctx->WantsDiff()) ctx->QueueWrite(buffer);
+        else                  ctx->QueueWrite(buffer, "state_update");
+    }
+}
+
+void HttpEventStream::OnTorrentLifecycle(const porla::TorrentLifecycle& lifecycle)
+{
+    static const std::string Name = "torrents_lifecycle";
+
+    Prune();
+
+    const auto id = ++m_lastId;
+    const auto& statuses = m_session.TorrentStatuses();
+
+    // The hashes of each kind the subscription includes, or all of them without one.
+    const auto payload = [&](const Subscription* sub)
+    {
+        const auto hashes = [&](const auto& items)
+        {
+            json list = json::array();
+
+            for (const auto& item : items)
+            {
+                const lt::info_hash_t* hash;
+                const lt::torrent_status* status;
+
+                if constexpr (std::is_same_v<std::decay_t<decltype(item)>, lt::torrent_status>)
+                {
+                    hash   = &item.info_hashes;
+                    status = &item;
+                }
+                else
+                {
+                    const auto found = statuses.find(item);
+                    hash   = &item;
+                    status = found != statuses.end() ? &found->second : nullptr;
+                }
+
+                if (sub == nullptr || sub->Includes(*hash, status))
+                {
+                    list.push_back(*hash);
+                }
+            }
+
+            return list;
+        };
+
+        json data = {
+            {"finished", hashes(lifecycle.finished)},
+            {"paused",   hashes(lifecycle.paused)},
+            {"removed",  hashes(lifecycle.removed)},
+            {"resumed",  hashes(lifecycle.resumed)}
+        };
+
+        const bool empty = data["finished"].empty() && data["paused"].empty()
+            && data["removed"].empty() && data["resumed"].empty();
+
+        return empty ? EventBuffer() : Format(Name, data.dump(), id);
+    };
+
+    const auto all = payload(nullptr);
+
+    Record(Replayable{
+        .id     = id,
+        .name   = Name,
+        .hash   = std::nullopt,
+        .buffer = all,
+        .diff   = false,
+        .batch  = true
+    });
+
+    for (auto& ctx : m_ctxs)
+    {
+        const auto& sub = ctx->Subscribed();
+
+        if (!sub.Wants(Name))
+        {
+            continue;
+        }
+
+        if (const auto buffer = sub.Filtered() ? payload(&sub) : all; buffer != nullptr)
+        {
+            ctx->QueueWrite(buffer);
+        }
+    }
 }
 
 void HttpEventStream::OnTorrentPaused(const libtorrent::torrent_handle& th)
 {
-    Broadcast("torrent_paused", json({"info_hash", th.info_hashes()}).dump());
+    const auto hash   = th.info_hashes();
+    const auto status = m_session.TorrentStatuses().find(hash);
+
+    Broadcast(
+        "torrent_paused",
+        json({"info_hash", hash}).dump(),
+        &hash,
+        status != m_session.TorrentStatuses().end() ? &status->second : nullptr);
 }
 
 void HttpEventStream::OnTorrentRemoved(const libtorrent::info_hash_t &hash)
 {
-    Broadcast("torrent_removed", json({"info_hash", hash}).dump());
+    m_snapshots.erase(hash);
+    m_peerWatches.erase(hash);
+    Broadcast("torrent_removed", json({"info_hash", hash}).dump(), &hash);
 }
 
 void HttpEventStream::OnTorrentResumed(const libtorrent::torrent_status &status)
 {
-    Broadcast("torrent_resumed", json({"info_hash", status.info_hashes}).dump());
+    Broadcast("torrent_resumed", json({"info_hash", status.info_hashes}).dump(), &status.info_hashes, &status);
 }
@@ -1,44 +1,187 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
-#include <boost/signals2.hpp>
+#include <boost/asio.hpp>
+#include <libtorrent/peer_info.hpp>
 #include <libtorrent/torrent_status.hpp>
 
 #include "httpcontext.hpp"
+#include "memoryusage.hpp"
+#include "utils/signal.hpp"
 
 namespace porla
 {
     class ISession;
+    class SessionMetrics;
+    struct TorrentLifecycle;
+
+    struct HttpEventStreamOptions
+    {
+        // Clients with more than this queued are disconnected. Superseded state_update and
+        // session_metrics_updated events are coalesced before counting.
+        std::size_t max_queued_bytes  = 16 * 1024 * 1024;
+        std::size_t max_queued_events = 1024;
+
+        // Milliseconds between the comments sent to keep proxies from closing idle streams.
+        int heartbeat_interval = 15000;
+
+        // Clients connecting beyond this many are turned away. 0 means no limit.
+        std::size_t max_subscribers = 256;
+
+        // Number of recent torrent events kept for clients reconnecting with Last-Event-ID.
+        std::size_t replay_events = 1024;
+
+        // Milliseconds between peer samples of torrents whose peers are subscribed to.
+        int peers_interval = 1000;
+    };
 
     class HttpEventStream
     {
     public:
-        explicit HttpEventStream(ISession& session);
+        struct Counters
+        {
+            std::atomic<std::uint64_t> coalesced{0};
+            std::atomic<std::uint64_t> disconnected{0};
+            std::atomic<std::uint64_t> dropped{0};
+            std::atomic<std::uint64_t> queued_bytes{0};
+            std::atomic<std::uint64_t> rejected{0};
+            std::atomic<std::uint64_t> subscribers{0};
+        };
+
+        // Where a subscriber's events are written. SSE clients have them written to their
+        // response, other transports such as WebSockets bring their own. Events are passed
+        // in their SSE form, and the next write starts once done is called.
+        class Sink
+        {
+        public:
+            virtual ~Sink() = default;
+
+            virtual boost::asio::any_io_executor Executor() = 0;
+            virtual void Write(
+                std::vector<std::shared_ptr<const std::string>> events,
+                std::function<void(boost::system::error_code, std::size_t)> done) = 0;
+            virtual void Close() = 0;
+        };
+
+        explicit HttpEventStream(boost::asio::io_context& io, ISession& session, HttpEventStreamOptions options = {});
         HttpEventStream(const HttpEventStream&) = delete;
 
         ~HttpEventStream();
 
         void operator()(std::shared_ptr<HttpContext>);
 
+        // Subscribes a sink with the same parameters as the query string of an events
+        // request. Events stop when the returned handle is released. Returns null when the
+        // subscriber limit is reached, and throws Query::QueryError for an invalid query.
+        std::shared_ptr<void> Subscribe(std::shared_ptr<Sink> sink, const std::map<std::string, std::string>& params);
+
+        // Sends an event which is not about a torrent, such as a disk space warning, to the
+        // clients subscribed to it. Called on the io thread.
+        void Publish(const std::string& name, const std::string& data);
+
+        [[nodiscard]] const Counters& Stats() const { return *m_counters; }
+
+        // Client queues, the replay buffer, the state_update snapshots and the last peer
+        // samples of watched torrents. Events shared
+        // by several queues are counted once for each. Called on the io thread.
+        [[nodiscard]] MemoryUsage Memory() const;
+
     private:
         class ContextState;
 
-        void Broadcast(const std::string& name, const std::string& data);
-        void OnSessionStats(const std::map<std::string, int64_t>& stats);
+        // The last broadcast value of the fields sent in state_update diffs.
+        struct Snapshot
+        {
+            int   download_rate;
+            int   num_peers;
+            int   num_seeds;
+            float progress;
+            int   state;
+            int   upload_rate;
+        };
+
+        // Torrent events pass the torrent so each client's subscription can be checked. The
+        // status is null when the torrent is already gone.
+        // An event kept for replay. Only events that a later event does not supersede are
+        // kept, so periodic updates are left out, except for diffs which build on each other.
+        struct Replayable
+        {
+            std::uint64_t                          id;
+            std::string                            name;
+            std::optional<libtorrent::info_hash_t> hash;
+            std::shared_ptr<const std::string>     buffer;
+            bool                                   diff;
+            // Events naming many torrents are not replayed to clients filtering torrents,
+            // since the buffer has all of them.
+            bool                                   batch = false;
+        };
+
+        // A torrent whose peers someone subscribed to. Diffs are taken against the last
+        // sample, which is also what clients subscribing later start from.
+        struct PeerWatch
+        {
+            std::shared_ptr<const std::vector<libtorrent::peer_info>> peers;
+            bool                                                      sampling = false;
+        };
+
+        void Add(const std::shared_ptr<ContextState>& state, const std::string& last_event_id);
+        void Broadcast(
+            const std::string& name,
+            const std::string& data,
+            const libtorrent::info_hash_t* hash = nullptr,
+            const libtorrent::torrent_status* status = nullptr);
+        void Heartbeat();
+        void OnPeers(const libtorrent::info_hash_t& hash, std::shared_ptr<const std::vector<libtorrent::peer_info>> peers);
+        void Prune();
+        void Record(Replayable evt);
+        void RequestPeers(const libtorrent::info_hash_t& hash);
+        void SamplePeers();
+        void OnSessionStats(const SessionMetrics& stats);
         void OnStateUpdate(const std::vector<libtorrent::torrent_status>& torrents);
+        void OnTorrentLifecycle(const TorrentLifecycle& lifecycle);
         void OnTorrentPaused(const libtorrent::torrent_handle& th);
         void OnTorrentRemoved(const libtorrent::info_hash_t& hash);
         void OnTorrentResumed(const libtorrent::torrent_status& status);
 
         ISession& m_session;
+        HttpEventStreamOptions m_options;
+        boost::asio::deadline_timer m_heartbeat;
+        std::shared_ptr<Counters> m_counters;
         std::vector<std::shared_ptr<ContextState>> m_ctxs;
+        std::map<libtorrent::info_hash_t, Snapshot> m_snapshots;
+
+        // Peers are only sampled while the timer runs, which is while anyone watches them.
+        boost::asio::deadline_timer m_peersTimer;
+        bool m_peersSampling;
+        std::map<libtorrent::info_hash_t, PeerWatch> m_peerWatches;
+        // Held by the peer callbacks, which may be called after we are gone.
+        std::shared_ptr<HttpEventStream*> m_self;
+
+        // Ids start from the startup time in microseconds so they keep increasing across
+        // restarts, and ids from an earlier run are known to be unreplayable.
+        std::uint64_t m_firstId;
+        std::uint64_t m_lastId;
+        std::uint64_t m_evictedId;
+        std::deque<Replayable> m_replay;
+
+        // Held while there are clients, so updates are posted at their active rate.
+        std::shared_ptr<void> m_sessionStatsDemand;
+        std::shared_ptr<void> m_torrentUpdatesDemand;
 
-        boost::signals2::connection m_sessionStatsConnection;
-        boost::signals2::connection m_stateUpdateConnection;
-        boost::signals2::connection m_torrentPausedConnection;
-        boost::signals2::connection m_torrentRemovedConnection;
-        boost::signals2::connection m_torrentResumedConnection;
+        porla::Utils::Connection m_sessionStatsConnection;
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_torrentLifecycleConnection;
+        porla::Utils::Connection m_torrentPausedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+        porla::Utils::Connection m_torrentResumedConnection;
     };
 }
@@ -2,13 +2,21 @@
 
 #include <utility>
 
-#include <jwt-cpp/jwt.h>
+#include <boost/beast/websocket.hpp>
+#include <sodium.h>
+
+#include "tracing.hpp"
 
 using porla::HttpJwtAuth;
+using porla::ScopedSpan;
 
-HttpJwtAuth::HttpJwtAuth(std::string secret_key, porla::HttpMiddleware middleware)
+HttpJwtAuth::HttpJwtAuth(std::string secret_key, porla::HttpMiddleware middleware, std::size_t cache_size)
     : m_secret_key(std::move(secret_key))
     , m_http_middleware(std::move(middleware))
+    , m_verifier(jwt::verify()
+        .allow_algorithm(jwt::algorithm::hs256(m_secret_key))
+        .with_issuer("porla"))
+    , m_cache(std::make_shared<Cache>(cache_size))
 {
 }
 
@@ -18,6 +26,11 @@ void HttpJwtAuth::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
 
     namespace http = boost::beast::http;
 
+    if (ctx->Local())
+    {
+        return m_http_middleware(ctx);
+    }
+
     auto const not_authorized = [&ctx]()
     {
         http::response<http::string_body> res{http::status::unauthorized, ctx->Request().version()};
@@ -56,22 +69,68 @@ void HttpJwtAuth::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
         bearer_token = header_finder(http::field::authorization);
     }
 
+    // Browsers cannot set headers on WebSocket handshakes, so those may pass the token in
+    // the query string instead.
+    if (!bearer_token.has_value() && boost::beast::websocket::is_upgrade(ctx->Request()))
+    {
+        const auto& query = ctx->RequestUri().query;
+
+        if (const auto token = query.find("token"); token != query.end() && !token->second.empty())
+        {
+            bearer_token = token->second;
+        }
+    }
+
     if (!bearer_token.has_value())
     {
         return ctx->Write(not_authorized());
     }
 
+    if (Verify(ctx, bearer_token.value()))
+    {
+        return m_http_middleware(ctx);
+    }
+
+    return ctx->Write(not_authorized());
+}
+
+bool HttpJwtAuth::Verify(const std::shared_ptr<porla::HttpContext>& ctx, const std::string& token)
+{
+    std::string digest(crypto_hash_sha256_BYTES, '\0');
+
+    crypto_hash_sha256(
+        reinterpret_cast<unsigned char*>(digest.data()),
+        reinterpret_cast<const unsigned char*>(token.data()),
+        token.size());
+
+    const auto now = std::chrono::system_clock::now();
+
+    {
+        std::unique_lock lock(m_cache->mtx);
+
+        if (const auto expires = m_cache->tokens.Get(digest); expires.has_value() && now < *expires)
+        {
+            return true;
+        }
+    }
+
     try
     {
-        auto decoded_token = jwt::decode(bearer_token.value());
+        ScopedSpan span(ctx->Trace(), "http.jwt_verify");
 
-        auto verifier = jwt::verify()
-            .allow_algorithm(jwt::algorithm::hs256(m_secret_key))
-            .with_issuer("porla");
+        auto decoded_token = jwt::decode(token);
 
-        verifier.verify(decoded_token);
+        m_verifier.verify(decoded_token);
 
-        return m_http_middleware(ctx);
+        // Tokens without an expiry are verified every time, since the cache would keep
+        // them forever.
+        if (decoded_token.has_expires_at())
+        {
+            std::unique_lock lock(m_cache->mtx);
+            m_cache->tokens.Put(digest, decoded_token.get_expires_at());
+        }
+
+        return true;
     }
     catch (const jwt::signature_verification_exception& ex)
     {
@@ -86,5 +145,5 @@ void HttpJwtAuth::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
         BOOST_LOG_TRIVIAL(warning) << "Failed to decode token: " << ex.what();
     }
 
-    return ctx->Write(not_authorized());
+    return false;
 }
@@ -1,21 +1,41 @@
 #pragma once
 
+#include <chrono>
+#include <mutex>
 #include <optional>
 
+#include <jwt-cpp/jwt.h>
+
 #include "httpcontext.hpp"
 #include "httpmiddleware.hpp"
+#include "utils/lrucache.hpp"
 
 namespace porla
 {
     class HttpJwtAuth
     {
     public:
-        explicit HttpJwtAuth(std::string secret_key, HttpMiddleware middleware);
+        explicit HttpJwtAuth(std::string secret_key, HttpMiddleware middleware, std::size_t cache_size = 256);
 
         void operator()(const std::shared_ptr<porla::HttpContext>& ctx);
 
     private:
+        bool Verify(const std::shared_ptr<porla::HttpContext>& ctx, const std::string& token);
+
         std::string m_secret_key;
         HttpMiddleware m_http_middleware;
+        decltype(jwt::verify()) m_verifier;
+
+        // Tokens verified recently, by their SHA-256, and when they expire. Requests run
+        // on the HTTP threads, so the cache is locked. Shared, since middlewares are copied.
+        struct Cache
+        {
+            explicit Cache(std::size_t size) : tokens(size) {}
+
+            std::mutex mtx;
+            Utils::LruCache<std::string, std::chrono::system_clock::time_point> tokens;
+        };
+
+        std::shared_ptr<Cache> m_cache;
     };
 }
@@ -3,6 +3,7 @@
 #include <functional>
 #include <memory>
 
+#include <boost/asio/dispatch.hpp>
 #include <boost/log/trivial.hpp>
 
 #include "httpcontext.hpp"
@@ -11,6 +12,17 @@ namespace porla
 {
     typedef std::function<void(std::shared_ptr<HttpContext> ctx)> HttpMiddleware;
 
+    // Runs the middleware on the given executor. Handlers that touch the session are
+    // dispatched onto its io_context when the HTTP layer runs on threads of its own.
+    template<typename TExecutor>
+    HttpMiddleware HttpDispatch(TExecutor executor, HttpMiddleware middleware)
+    {
+        return [executor, middleware = std::move(middleware)](const std::shared_ptr<HttpContext>& ctx)
+        {
+            boost::asio::dispatch(executor, [middleware, ctx]() { middleware(ctx); });
+        };
+    }
+
     class HttpMethod
     {
     public:
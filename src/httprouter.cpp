@@ -0,0 +1,76 @@
+#include "httprouter.hpp"
+
+using porla::HttpRouter;
+
+// Prefixes are kept without a trailing slash, so /ui and /ui/ are the same prefix.
+static std::string Trim(std::string path)
+{
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+    return path;
+}
+
+HttpRouter::HttpRouter()
+    : m_routes(std::make_shared<Routes>())
+{
+}
+
+HttpRouter& HttpRouter::Get(const std::string& path, HttpMiddleware middleware)
+{
+    return Route(boost::beast::http::verb::get, path, std::move(middleware));
+}
+
+HttpRouter& HttpRouter::Post(const std::string& path, HttpMiddleware middleware)
+{
+    return Route(boost::beast::http::verb::post, path, std::move(middleware));
+}
+
+HttpRouter& HttpRouter::Prefix(const std::string& prefix, HttpMiddleware middleware)
+{
+    m_routes->prefix.insert_or_assign(Trim(prefix.empty() ? "/" : prefix), std::move(middleware));
+    return *this;
+}
+
+HttpRouter& HttpRouter::Route(boost::beast::http::verb verb, const std::string& path, HttpMiddleware middleware)
+{
+    m_routes->exact[path].emplace_back(verb, std::move(middleware));
+    return *this;
+}
+
+void HttpRouter::operator()(const std::shared_ptr<HttpContext>& ctx) const
+{
+    const auto& path = ctx->RequestUri().path;
+
+    if (const auto route = m_routes->exact.find(path); route != m_routes->exact.end())
+    {
+        for (const auto& [verb, middleware] : route->second)
+        {
+            if (verb == ctx->Request().method())
+            {
+                return middleware(ctx);
+            }
+        }
+    }
+
+    if (!m_routes->prefix.empty())
+    {
+        std::string parent = Trim(path.empty() ? "/" : path);
+
+        while (true)
+        {
+            if (const auto route = m_routes->prefix.find(parent); route != m_routes->prefix.end())
+            {
+                return route->second(ctx);
+            }
+
+            if (parent == "/")
+            {
+                break;
+            }
+
+            const auto slash = parent.find_last_of('/');
+            parent = slash == 0 || slash == std::string::npos ? "/" : parent.substr(0, slash);
+        }
+    }
+
+    ctx->Next();
+}
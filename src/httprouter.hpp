@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/beast/http/verb.hpp>
+
+#include "httpcontext.hpp"
+#include "httpmiddleware.hpp"
+
+namespace porla
+{
+    // Matches a request to its route with one hash lookup on the path, instead of trying
+    // each route in turn. Prefix routes, for static files, are found by looking up the
+    // path and then each of its parents, so the longest prefix wins. Requests without a
+    // route go on to the next middleware.
+    class HttpRouter
+    {
+    public:
+        HttpRouter();
+
+        HttpRouter& Get(const std::string& path, HttpMiddleware middleware);
+        HttpRouter& Post(const std::string& path, HttpMiddleware middleware);
+        HttpRouter& Prefix(const std::string& prefix, HttpMiddleware middleware);
+        HttpRouter& Route(boost::beast::http::verb verb, const std::string& path, HttpMiddleware middleware);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx) const;
+
+    private:
+        struct Routes
+        {
+            std::unordered_map<std::string, std::vector<std::pair<boost::beast::http::verb, HttpMiddleware>>> exact;
+            std::unordered_map<std::string, HttpMiddleware> prefix;
+        };
+
+        // Shared, since the server copies its middlewares.
+        std::shared_ptr<Routes> m_routes;
+    };
+}
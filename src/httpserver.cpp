@@ -1,5 +1,11 @@
 #include "httpserver.hpp"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+
 #include <boost/beast.hpp>
 #include <boost/log/trivial.hpp>
 
@@ -13,9 +19,110 @@ using porla::HttpSession;
 class HttpServer::State : public std::enable_shared_from_this<HttpServer::State>
 {
 public:
-    State(boost::asio::io_context& io, std::string const& host, uint16_t port)
+    State(boost::asio::io_context& io, const porla::HttpServerOptions& options)
         : m_io(io),
-        m_acceptor(boost::asio::make_strand(m_io))
+        m_acceptor(boost::asio::make_strand(m_io)),
+        m_unix_acceptor(boost::asio::make_strand(m_io)),
+        m_unix_socket(options.unix_socket),
+        m_tracer(options.tracer),
+        m_compression(options.compression),
+        m_idle_timeout(options.idle_timeout),
+        m_max_connections(options.max_connections),
+        m_accepted(0),
+        m_rejected(0)
+    {
+        if (options.tcp)
+        {
+            ListenTcp(options.host, options.port);
+        }
+
+        if (!m_unix_socket.empty())
+        {
+            ListenUnix(options.unix_socket_mode);
+        }
+    }
+
+    ~State()
+    {
+        if (m_unix_acceptor.is_open())
+        {
+            ::unlink(m_unix_socket.c_str());
+        }
+    }
+
+    auto Endpoint() { return m_acceptor.local_endpoint(); }
+
+    void Start()
+    {
+        if (m_acceptor.is_open())
+        {
+            boost::asio::dispatch(
+                m_acceptor.get_executor(),
+                boost::beast::bind_front_handler(
+                    &State::BeginAccept,
+                    shared_from_this()));
+        }
+
+        if (m_unix_acceptor.is_open())
+        {
+            boost::asio::dispatch(
+                m_unix_acceptor.get_executor(),
+                boost::beast::bind_front_handler(
+                    &State::BeginAcceptUnix,
+                    shared_from_this()));
+        }
+    }
+
+    void Stop()
+    {
+        boost::system::error_code ec;
+        m_acceptor.cancel(ec);
+        m_unix_acceptor.cancel(ec);
+
+        std::unique_lock lock(m_sessions_mtx);
+
+        m_middlewares.reset();
+
+        for (auto&& s : m_sessions)
+        {
+            if (auto sl = s.lock())
+            {
+                sl->Stop();
+            }
+        }
+
+        m_sessions.clear();
+    }
+
+    HttpServer::Stats GetStats()
+    {
+        std::unique_lock lock(m_sessions_mtx);
+
+        return HttpServer::Stats{
+            .connections = static_cast<std::size_t>(std::count_if(
+                m_sessions.begin(),
+                m_sessions.end(),
+                [](const auto& s) { return !s.expired(); })),
+            .accepted = m_accepted,
+            .rejected = m_rejected
+        };
+    }
+
+    void Use(const porla::HttpMiddleware& middleware)
+    {
+        std::unique_lock lock(m_sessions_mtx);
+
+        // Sessions share the list, so it is copied instead of changed in place.
+        auto middlewares = m_middlewares
+            ? std::make_shared<std::vector<porla::HttpMiddleware>>(*m_middlewares)
+            : std::make_shared<std::vector<porla::HttpMiddleware>>();
+
+        middlewares->emplace_back(middleware);
+        m_middlewares = std::move(middlewares);
+    }
+
+private:
+    void ListenTcp(const std::string& host, uint16_t port)
     {
         boost::system::error_code ec;
         auto addr = boost::asio::ip::make_address(host, ec);
@@ -43,39 +150,113 @@ public:
         BOOST_LOG_TRIVIAL(info) << "Running HTTP server on " << m_acceptor.local_endpoint();
     }
 
-    auto Endpoint() { return m_acceptor.local_endpoint(); }
+    void ListenUnix(int mode)
+    {
+        boost::system::error_code ec;
 
-    void Start()
+        // A socket left behind by an earlier run would fail the bind.
+        ::unlink(m_unix_socket.c_str());
+
+        const boost::asio::local::stream_protocol::endpoint endpoint(m_unix_socket);
+
+        m_unix_acceptor.open(endpoint.protocol(), ec);
+        if (!ec) { m_unix_acceptor.bind(endpoint, ec); }
+        if (!ec && ::chmod(m_unix_socket.c_str(), static_cast<mode_t>(mode)) != 0)
+        {
+            ec = boost::system::error_code(errno, boost::system::system_category());
+        }
+        if (!ec) { m_unix_acceptor.listen(boost::asio::socket_base::max_listen_connections, ec); }
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to listen on Unix socket " << m_unix_socket << ": " << ec.message();
+            m_unix_acceptor.close(ec);
+            return;
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Running HTTP server on " << m_unix_socket;
+    }
+
+    void BeginAcceptUnix()
     {
-        boost::asio::dispatch(
-            m_acceptor.get_executor(),
+        m_unix_acceptor.async_accept(
+            boost::asio::make_strand(m_io),
             boost::beast::bind_front_handler(
-                &State::BeginAccept,
+                &State::EndAcceptUnix,
                 shared_from_this()));
     }
 
-    void Stop()
+    void EndAcceptUnix(boost::system::error_code ec, boost::asio::local::stream_protocol::socket socket)
     {
-        m_acceptor.cancel();
-        m_middlewares.clear();
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
 
-        for (auto&& s : m_sessions)
+        if (ec)
         {
-            if (auto sl = s.lock())
-            {
-                sl->Stop();
-            }
+            BOOST_LOG_TRIVIAL(error) << "Error when accepting Unix socket client: " << ec.message();
+            return BeginAcceptUnix();
         }
 
-        m_sessions.clear();
+        BOOST_LOG_TRIVIAL(debug) << "Incoming HTTP connection on " << m_unix_socket;
+
+        // Sessions only read, write and close their socket, which works the same for any
+        // stream socket, so the descriptor is served by a TCP socket. Nothing asks it for
+        // its endpoints.
+        auto executor = socket.get_executor();
+
+        boost::asio::ip::tcp::socket stream(executor);
+        stream.assign(boost::asio::ip::tcp::v4(), socket.release(), ec);
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to assign Unix socket client: " << ec.message();
+            return BeginAcceptUnix();
+        }
+
+        StartSession(std::move(stream), true);
+
+        BeginAcceptUnix();
     }
 
-    void Use(const porla::HttpMiddleware& middleware)
+    void StartSession(boost::asio::ip::tcp::socket&& socket, bool local)
     {
-        m_middlewares.emplace_back(middleware);
+        // Both acceptors end up here, each on its own strand.
+        std::unique_lock lock(m_sessions_mtx);
+
+        std::erase_if(m_sessions, [](const auto& s) { return s.expired(); });
+
+        if (m_max_connections > 0 && m_sessions.size() >= m_max_connections)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Rejecting HTTP connection, limit of " << m_max_connections << " reached";
+
+            boost::system::error_code ec;
+            socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+            socket.close(ec);
+
+            m_rejected++;
+            return;
+        }
+
+        auto session = std::make_shared<HttpSession>(
+            std::move(socket),
+            porla::HttpSessionOptions{
+                .compression  = m_compression,
+                .idle_timeout = m_idle_timeout,
+                .local        = local,
+                .middlewares  = m_middlewares,
+                .tracer       = m_tracer
+            });
+
+        m_sessions.push_back(session);
+        m_accepted++;
+
+        lock.unlock();
+
+        session->Run();
     }
 
-private:
     void BeginAccept()
     {
         m_acceptor.async_accept(
@@ -95,13 +276,7 @@ private:
         {
             BOOST_LOG_TRIVIAL(debug) << "Incoming HTTP connection from " << socket.remote_endpoint();
 
-            auto session = std::make_shared<HttpSession>(
-                std::move(socket),
-                m_middlewares);
-
-            m_sessions.push_back(session);
-
-            session->Run();
+            StartSession(std::move(socket), false);
         }
 
         BeginAccept();
@@ -109,15 +284,24 @@ private:
 
     boost::asio::io_context& m_io;
     boost::asio::ip::tcp::acceptor m_acceptor;
+    boost::asio::local::stream_protocol::acceptor m_unix_acceptor;
+    std::string m_unix_socket;
+    porla::Tracer* m_tracer;
+    porla::HttpCompressionOptions m_compression;
+    std::chrono::seconds m_idle_timeout;
+    std::size_t m_max_connections;
 
+    std::mutex m_sessions_mtx;
     std::vector<std::weak_ptr<HttpSession>> m_sessions;
-    std::vector<porla::HttpMiddleware> m_middlewares;
+    std::uint64_t m_accepted;
+    std::uint64_t m_rejected;
+    std::shared_ptr<const std::vector<porla::HttpMiddleware>> m_middlewares;
 };
 
 HttpServer::HttpServer(boost::asio::io_context& io, porla::HttpServerOptions const& options)
     : m_io(io)
 {
-    m_state = std::make_shared<State>(io, options.host, options.port);
+    m_state = std::make_shared<State>(io, options);
     m_state->Start();
 }
 
@@ -131,6 +315,11 @@ boost::asio::ip::tcp::endpoint HttpServer::Endpoint()
     return m_state->Endpoint();
 }
 
+HttpServer::Stats HttpServer::GetStats() const
+{
+    return m_state->GetStats();
+}
+
 void HttpServer::Use(const porla::HttpMiddleware& middleware)
 {
     m_state->Use(middleware);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -8,22 +10,44 @@
 #include <nlohmann/json.hpp>
 
 #include "httpmiddleware.hpp"
+#include "httpsession.hpp"
 
 namespace porla
 {
+    class Tracer;
+
     struct HttpServerOptions
     {
         std::string host;
         uint16_t port;
+        HttpCompressionOptions compression;
+        // Keep-alive connections are closed after this long without a request.
+        std::chrono::seconds idle_timeout = std::chrono::seconds(30);
+        // Connections past this are closed as soon as they are accepted. 0 means no limit.
+        std::size_t max_connections = 1024;
+        bool tcp = true;
+        Tracer* tracer = nullptr; // traces requests if set
+        // Also serves on a Unix socket at this path if set. Anyone allowed to connect to it
+        // is trusted, so requests over it skip token auth.
+        std::string unix_socket;
+        int unix_socket_mode = 0660;
     };
 
     class HttpServer
     {
     public:
+        struct Stats
+        {
+            std::size_t   connections;
+            std::uint64_t accepted;
+            std::uint64_t rejected;
+        };
+
         HttpServer(boost::asio::io_context& io, HttpServerOptions const& options);
         ~HttpServer();
 
         boost::asio::ip::tcp::endpoint Endpoint();
+        [[nodiscard]] Stats GetStats() const;
         void Use(const HttpMiddleware& middleware);
 
     private:
@@ -1,15 +1,24 @@
 #include "httpsession.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <filesystem>
 #include <memory>
+#include <type_traits>
 #include <utility>
 
 #include <boost/log/trivial.hpp>
 #include <nlohmann/json.hpp>
 #include <uriparser/Uri.h>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 #include "httpcontext.hpp"
 #include "httpmiddleware.hpp"
+#include "tracing.hpp"
+#include "utils/gzip.hpp"
 
 namespace fs = std::filesystem;
 
@@ -17,20 +26,40 @@ using json = nlohmann::json;
 using BasicHttpRequest = boost::beast::http::request<boost::beast::http::string_body>;
 
 using porla::HttpSession;
+using porla::TraceSpan;
+
+// Binary files and the like are left as they are, since gzip does not make them smaller.
+static bool IsCompressible(std::string_view content_type)
+{
+    return content_type.starts_with("text/")
+        || content_type.starts_with("application/json")
+        || content_type.starts_with("application/cbor")
+        || content_type.starts_with("application/msgpack")
+        || content_type.starts_with("application/x-msgpack")
+        || content_type.starts_with("image/svg+xml");
+}
 
-class HttpSession::MiddlewareContext : public porla::HttpContext
+// One context per request, passed along the whole middleware chain. The request and its
+// URI are kept here once and Next only moves on to the next middleware.
+class HttpSession::MiddlewareContext
+    : public porla::HttpContext
+    , public std::enable_shared_from_this<HttpSession::MiddlewareContext>
 {
 public:
     explicit MiddlewareContext(
         std::shared_ptr<HttpSession> session,
         BasicHttpRequest req,
-        std::vector<porla::HttpMiddleware> mws,
-        std::vector<porla::HttpMiddleware>::const_iterator current)
+        std::shared_ptr<const std::vector<porla::HttpMiddleware>> mws,
+        std::shared_ptr<TraceSpan> span)
         : m_session(std::move(session))
         , m_req(std::move(req))
         , m_mws(std::move(mws))
-        , m_curr(current)
+        , m_curr(0)
+        , m_span(std::move(span))
+        , m_entered(std::chrono::system_clock::now())
     {
+        porla::ScopedSpan parse(m_span, "http.parse_uri");
+
         UriUriA uri = {};
 
         UriParserStateA state;
@@ -61,19 +90,55 @@ public:
             m_uri = Uri{
                 .path = accum.str()
             };
+
+            UriQueryListA* query = nullptr;
+            int query_count = 0;
+
+            if (uri.query.first != nullptr
+                && uriDissectQueryMallocA(&query, &query_count, uri.query.first, uri.query.afterLast) == URI_SUCCESS)
+            {
+                for (auto item = query; item != nullptr; item = item->next)
+                {
+                    m_uri.query.insert({ item->key, item->value != nullptr ? item->value : "" });
+                }
+
+                uriFreeQueryListA(query);
+            }
+
+            uriFreeUriMembersA(&uri);
         }
     }
 
+    // Runs the current middleware.
+    void Run()
+    {
+        (*m_mws)[m_curr](shared_from_this());
+    }
+
     void Next() override
     {
-        auto next = m_curr + 1;
-        auto ctx = std::make_shared<MiddlewareContext>(
-            m_session,
-            m_req,
-            m_mws,
-            next);
-
-        (*next)(ctx);
+        EndMiddlewareSpan();
+
+        if (m_curr + 1 >= m_mws->size())
+        {
+            BOOST_LOG_TRIVIAL(error) << "No middleware after the last one for " << m_req.target();
+            return;
+        }
+
+        m_curr++;
+        m_entered = std::chrono::system_clock::now();
+
+        Run();
+    }
+
+    std::shared_ptr<TraceSpan> Trace() override
+    {
+        return m_span;
+    }
+
+    bool Local() override
+    {
+        return m_session->m_options.local;
     }
 
     boost::beast::http::request<boost::beast::http::string_body>& Request() override
@@ -102,50 +167,461 @@ public:
         res.body() = body;
         res.prepare_payload();
 
-        m_session->m_queue(std::move(res));
+        Queue(std::move(res));
     }
 
     void Write(boost::beast::http::response<boost::beast::http::file_body> res) override
     {
-        m_session->m_queue(std::move(res));
+        Queue(std::move(res));
     }
 
     void Write(boost::beast::http::response<boost::beast::http::string_body> res) override
     {
-        m_session->m_queue(std::move(res));
+        Queue(std::move(res));
     }
 
     void WriteJson(const nlohmann::json& j) override
+    {
+        Queue(JsonResponse(m_req, j));
+    }
+
+    void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) override
     {
         namespace http = boost::beast::http;
 
-        http::response<http::string_body> res{http::status::ok, m_req.version()};
+        // HTTP/1.0 has no chunked encoding, so the body is produced in full up front.
+        if (m_req.version() < 11)
+        {
+            http::response<http::string_body> res{http::status::ok, m_req.version()};
+            res.set(http::field::server, "porla/1.0");
+            res.set(http::field::content_type, content_type);
+            res.keep_alive(m_req.keep_alive());
+
+            while (next(res.body())) {}
+
+            res.prepare_payload();
+
+            return Queue(std::move(res));
+        }
+
+        http::response<http::empty_body> res{http::status::ok, m_req.version()};
         res.set(http::field::server, "porla/1.0");
-        res.set(http::field::content_type, "application/json");
+        res.set(http::field::content_type, content_type);
         res.keep_alive(m_req.keep_alive());
-        res.body() = j.dump();
-        res.prepare_payload();
+        res.chunked(true);
+
+        if (AcceptsGzip() && IsCompressible(content_type))
+        {
+            res.set(http::field::content_encoding, "gzip");
+            res.set(http::field::vary, "Accept-Encoding");
+
+            auto stream = std::make_shared<porla::Utils::Gzip::Stream>(m_session->m_options.compression.level);
+
+            next = [stream, next = std::move(next), part = std::string()](std::string& chunk) mutable
+            {
+                part.clear();
+                const bool more = next(part);
+                stream->Write(part, chunk, !more);
+                return more;
+            };
+        }
 
-        m_session->m_queue(std::move(res));
+        EndMiddlewareSpan();
+
+        boost::asio::dispatch(
+            m_session->m_stream.get_executor(),
+            [session = m_session, res = std::move(res), next = std::move(next), span = m_span]() mutable
+            {
+                session->m_queue.Chunked(std::move(res), std::move(next), std::move(span));
+            });
+    }
+
+    void WriteFile(
+        boost::beast::http::response<boost::beast::http::empty_body> res,
+        boost::beast::file file,
+        std::uint64_t offset,
+        std::uint64_t length,
+        FileAvailability available) override
+    {
+        res.content_length(length);
+
+        EndMiddlewareSpan();
+
+        boost::asio::dispatch(
+            m_session->m_stream.get_executor(),
+            [session = m_session, res = std::move(res), file = std::move(file), offset, length, available = std::move(available), span = m_span]() mutable
+            {
+                session->m_queue.File(std::move(res), std::move(file), offset, length, std::move(available), std::move(span));
+            });
     }
 
 private:
+    [[nodiscard]] bool AcceptsGzip() const
+    {
+        const auto accept_encoding = m_req.find(boost::beast::http::field::accept_encoding);
+
+        return m_session->m_options.compression.level > 0
+            && accept_encoding != m_req.end()
+            && porla::Utils::Gzip::IsAccepted({accept_encoding->value().data(), accept_encoding->value().size()});
+    }
+
+    // Covers the time from entering this middleware until it handed the request on or
+    // queued a response.
+    void EndMiddlewareSpan()
+    {
+        if (!m_span) { return; }
+
+        if (auto span = TraceSpan::Child(m_span, "http.middleware", m_entered))
+        {
+            span->SetAttribute("http.middleware.index", std::to_string(m_curr));
+            span->End();
+        }
+    }
+
+    // Responses may be written from another thread than the one running the session, so
+    // they are queued on the session strand.
+    template<typename TBody>
+    void Queue(boost::beast::http::response<TBody>&& res)
+    {
+        EndMiddlewareSpan();
+
+        boost::asio::dispatch(
+            m_session->m_stream.get_executor(),
+            [session = m_session, res = std::move(res), span = m_span, gzip = AcceptsGzip()]() mutable
+            {
+                if constexpr (std::is_same_v<TBody, boost::beast::http::string_body>)
+                {
+                    if (gzip) { session->Compress(res); }
+                }
+
+                session->m_queue(std::move(res), std::move(span));
+            });
+    }
+
     std::shared_ptr<HttpSession> m_session;
     BasicHttpRequest m_req;
-    std::vector<porla::HttpMiddleware> m_mws;
-    std::vector<porla::HttpMiddleware>::const_iterator m_curr;
+    std::shared_ptr<const std::vector<porla::HttpMiddleware>> m_mws;
+    std::size_t m_curr;
     Uri m_uri;
+    std::shared_ptr<TraceSpan> m_span;
+    std::chrono::system_clock::time_point m_entered;
 };
 
-HttpSession::HttpSession(
-    boost::asio::ip::tcp::socket&& socket,
-    std::vector<porla::HttpMiddleware> middlewares)
+void HttpSession::Queue::Push(std::unique_ptr<Work> work, std::shared_ptr<TraceSpan> span)
+{
+    work->span   = std::move(span);
+    work->queued = std::chrono::system_clock::now();
+
+    m_items.push_back(std::move(work));
+
+    // If there was no previous work, start this one
+    if (m_items.size() == 1)
+        (*m_items.front())();
+}
+
+void HttpSession::Queue::File(
+    boost::beast::http::response<boost::beast::http::empty_body>&& header,
+    boost::beast::file file,
+    std::uint64_t offset,
+    std::uint64_t length,
+    HttpContext::FileAvailability available,
+    std::shared_ptr<TraceSpan> span)
+{
+    // Bytes per sendfile call or buffered read. Only the fallback holds them in memory.
+    static constexpr std::size_t ChunkSize = 256 * 1024;
+    // Calls made in one go before yielding, so a fast client does not hold up the other
+    // sessions of its thread.
+    static constexpr int ChunksPerTurn = 8;
+    // How soon a file which is still being written is read again when what it said was
+    // available is not on disk yet.
+    static constexpr std::chrono::milliseconds RetryDelay(100);
+
+    struct FileImpl : Work
+    {
+        HttpSession& m_self;
+        boost::beast::http::response<boost::beast::http::empty_body> m_header;
+        boost::beast::http::response_serializer<boost::beast::http::empty_body> m_serializer;
+        boost::beast::file m_file;
+        std::uint64_t m_offset;
+        std::uint64_t m_remaining;
+        HttpContext::FileAvailability m_availability;
+        // How much more can be read, when the file is still being written.
+        std::uint64_t m_available = 0;
+        std::vector<char> m_buffer;
+        // Closes the connection when a client stops reading while sendfile waits for it.
+        boost::asio::steady_timer m_timer;
+        std::chrono::milliseconds m_retried{0};
+        bool m_sendfile = true;
+
+        FileImpl(
+            HttpSession& self,
+            boost::beast::http::response<boost::beast::http::empty_body>&& header,
+            boost::beast::file file,
+            std::uint64_t offset,
+            std::uint64_t length,
+            HttpContext::FileAvailability available)
+            : m_self(self)
+            , m_header(std::move(header))
+            , m_serializer(m_header)
+            , m_file(std::move(file))
+            , m_offset(offset)
+            , m_remaining(length)
+            , m_availability(std::move(available))
+            , m_timer(self.m_stream.get_executor())
+        {
+        }
+
+        unsigned Status() const override
+        {
+            return m_header.result_int();
+        }
+
+        void operator()() override
+        {
+            m_self.m_stream.expires_after(m_self.m_options.idle_timeout);
+
+            boost::beast::http::async_write_header(
+                m_self.m_stream,
+                m_serializer,
+                [this, self = m_self.shared_from_this()](boost::beast::error_code ec, std::size_t bytes)
+                {
+                    if (ec) { return self->EndWrite(true, ec, bytes); }
+                    Send();
+                });
+        }
+
+        // What may be sent before asking for more.
+        [[nodiscard]] std::uint64_t Allowed() const
+        {
+            return m_availability ? std::min(m_remaining, m_available) : m_remaining;
+        }
+
+        void Sent(std::uint64_t bytes)
+        {
+            m_offset    += bytes;
+            m_remaining -= bytes;
+            m_retried    = std::chrono::milliseconds(0);
+
+            if (m_availability) { m_available -= bytes; }
+        }
+
+        void Send()
+        {
+            if (m_remaining == 0)
+            {
+                return m_self.EndWrite(m_header.need_eof(), {}, 0);
+            }
+
+            if (Allowed() == 0)
+            {
+                return m_availability(
+                    m_offset,
+                    [this, self = m_self.shared_from_this()](std::uint64_t available)
+                    {
+                        boost::asio::dispatch(
+                            self->m_stream.get_executor(),
+                            [this, self, available]()
+                            {
+                                // The headers are out, so all that is left is to cut the body short.
+                                if (available == 0) { return self->EndWrite(true, boost::asio::error::eof, 0); }
+
+                                m_available = available;
+                                Send();
+                            });
+                    });
+            }
+
+#ifdef __linux__
+            if (m_sendfile)
+            {
+                return SendFile();
+            }
+#endif
+
+            ReadWrite();
+        }
+
+        // The file is shorter than it should be. Files which are still being written may
+        // not have the pieces said to be available on disk yet, so they are read again
+        // for a while.
+        void Short()
+        {
+            if (!m_availability || m_retried >= m_self.m_options.idle_timeout)
+            {
+                return m_self.EndWrite(true, boost::asio::error::eof, 0);
+            }
+
+            m_retried += RetryDelay;
+
+            m_timer.expires_after(RetryDelay);
+            m_timer.async_wait(
+                [this, self = m_self.shared_from_this()](boost::beast::error_code ec)
+                {
+                    if (ec) { return self->EndWrite(true, ec, 0); }
+                    Send();
+                });
+        }
+
+#ifdef __linux__
+        void SendFile()
+        {
+            auto& socket = m_self.m_stream.socket();
+
+            boost::beast::error_code ec;
+            socket.native_non_blocking(true, ec);
+
+            for (int i = 0; i < ChunksPerTurn && Allowed() > 0; i++)
+            {
+                auto offset = static_cast<off_t>(m_offset);
+                const auto sent = ::sendfile(
+                    socket.native_handle(),
+                    m_file.native_handle(),
+                    &offset,
+                    static_cast<std::size_t>(std::min<std::uint64_t>(Allowed(), ChunkSize)));
+
+                if (sent > 0)
+                {
+                    Sent(static_cast<std::uint64_t>(sent));
+                    continue;
+                }
+
+                if (sent == 0)
+                {
+                    return Short();
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    return Wait();
+                }
+
+                // Files on file systems which cannot be sent from are read instead.
+                if (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)
+                {
+                    m_sendfile = false;
+                    return ReadWrite();
+                }
+
+                return m_self.EndWrite(true, boost::beast::error_code(errno, boost::system::system_category()), 0);
+            }
+
+            if (Allowed() == 0)
+            {
+                return Send();
+            }
+
+            boost::asio::post(
+                m_self.m_stream.get_executor(),
+                [this, self = m_self.shared_from_this()]() { SendFile(); });
+        }
+
+        void Wait()
+        {
+            auto self = m_self.shared_from_this();
+
+            m_timer.expires_after(m_self.m_options.idle_timeout);
+            m_timer.async_wait(
+                [this, self](boost::beast::error_code ec)
+                {
+                    if (!ec) { m_self.m_stream.socket().cancel(); }
+                });
+
+            m_self.m_stream.socket().async_wait(
+                boost::asio::ip::tcp::socket::wait_write,
+                [this, self](boost::beast::error_code ec)
+                {
+                    m_timer.cancel();
+                    if (ec) { return self->EndWrite(true, ec, 0); }
+                    SendFile();
+                });
+        }
+#endif
+
+        void ReadWrite()
+        {
+            m_buffer.resize(ChunkSize);
+
+            boost::beast::error_code ec;
+            m_file.seek(m_offset, ec);
+
+            const auto read = ec
+                ? 0
+                : m_file.read(m_buffer.data(), static_cast<std::size_t>(std::min<std::uint64_t>(Allowed(), m_buffer.size())), ec);
+
+            if (ec)
+            {
+                return m_self.EndWrite(true, ec, 0);
+            }
+
+            if (read == 0)
+            {
+                return Short();
+            }
+
+            m_self.m_stream.expires_after(m_self.m_options.idle_timeout);
+
+            boost::asio::async_write(
+                m_self.m_stream,
+                boost::asio::buffer(m_buffer.data(), read),
+                [this, self = m_self.shared_from_this()](boost::beast::error_code ec, std::size_t bytes)
+                {
+                    if (ec) { return self->EndWrite(true, ec, bytes); }
+
+                    Sent(bytes);
+                    Send();
+                });
+        }
+    };
+
+    Push(
+        std::make_unique<FileImpl>(m_self, std::move(header), std::move(file), offset, length, std::move(available)),
+        std::move(span));
+}
+
+void HttpSession::Queue::EndSpan(Work& work)
+{
+    if (!work.span) { return; }
+
+    if (auto write = TraceSpan::Child(work.span, "http.write", work.queued))
+    {
+        write->End();
+    }
+
+    work.span->SetAttribute("http.status_code", std::to_string(work.Status()));
+    work.span->End();
+}
+
+HttpSession::HttpSession(boost::asio::ip::tcp::socket&& socket, HttpSessionOptions options)
     : m_stream(std::move(socket))
+    , m_options(std::move(options))
     , m_queue(*this)
-    , m_middlewares(std::move(middlewares))
 {
 }
 
+void HttpSession::Compress(boost::beast::http::response<boost::beast::http::string_body>& res) const
+{
+    namespace http = boost::beast::http;
+
+    if (res.body().size() < m_options.compression.min_size
+        || res.find(http::field::content_encoding) != res.end()
+        || !IsCompressible(res[http::field::content_type]))
+    {
+        return;
+    }
+
+    try
+    {
+        res.body() = porla::Utils::Gzip::Compress(res.body(), m_options.compression.level);
+        res.set(http::field::content_encoding, "gzip");
+        res.set(http::field::vary, "Accept-Encoding");
+        res.prepare_payload();
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to compress response: " << ex.what();
+    }
+}
+
 void HttpSession::Run()
 {
     // We need to be executing within a strand to perform async operations
@@ -169,7 +645,7 @@ void HttpSession::BeginRead()
     m_parser.emplace();
     m_parser->body_limit(10000000);
 
-    m_stream.expires_after(std::chrono::seconds(30));
+    m_stream.expires_after(m_options.idle_timeout);
 
     // Read a request using the parser-oriented interface
     boost::beast::http::async_read(
@@ -203,16 +679,30 @@ void HttpSession::EndRead(boost::beast::error_code ec, std::size_t bytes_transfe
     // Check for matching handler
     auto req = m_parser->release();
 
-    if (!m_middlewares.empty())
+    if (m_options.middlewares && !m_options.middlewares->empty())
     {
-        auto first = m_middlewares.begin();
-        auto ctx = std::make_shared<MiddlewareContext>(
+        std::shared_ptr<TraceSpan> span;
+
+        if (m_options.tracer != nullptr)
+        {
+            const auto traceparent = req.find("traceparent");
+
+            span = m_options.tracer->Start(
+                "HTTP " + std::string(req.method_string()),
+                traceparent != req.end() ? std::string_view(traceparent->value()) : std::string_view());
+
+            if (span)
+            {
+                span->SetAttribute("http.method", std::string(req.method_string()));
+                span->SetAttribute("http.target", std::string(req.target()));
+            }
+        }
+
+        std::make_shared<MiddlewareContext>(
             shared_from_this(),
             std::move(req),
-            m_middlewares,
-            first);
-
-        (*first)(ctx);
+            m_options.middlewares,
+            std::move(span))->Run();
 
         return;
     }
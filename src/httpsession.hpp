@@ -1,6 +1,10 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <boost/asio.hpp>
@@ -10,6 +14,27 @@
 
 namespace porla
 {
+    class TraceSpan;
+    class Tracer;
+
+    // Responses are gzipped on the session strand when the client accepts it. Streamed
+    // responses are compressed as they are written, whatever their size.
+    struct HttpCompressionOptions
+    {
+        int level = 6;                // 1-9, 0 turns compression off
+        std::size_t min_size = 1024;  // bytes
+    };
+
+    struct HttpSessionOptions
+    {
+        HttpCompressionOptions compression;
+        // How long a connection may wait for the next request, or take to send one.
+        std::chrono::seconds idle_timeout = std::chrono::seconds(30);
+        bool local = false;
+        std::shared_ptr<const std::vector<porla::HttpMiddleware>> middlewares;
+        Tracer* tracer = nullptr;
+    };
+
     class HttpSession : public std::enable_shared_from_this<HttpSession>
     {
         class MiddlewareContext;
@@ -27,8 +52,16 @@ namespace porla
             {
                 virtual ~Work() = default;
                 virtual void operator()() = 0;
+                virtual unsigned Status() const = 0;
+
+                // The request span, ended once the response is written.
+                std::shared_ptr<TraceSpan> span;
+                std::chrono::system_clock::time_point queued;
             };
 
+            void Push(std::unique_ptr<Work> work, std::shared_ptr<TraceSpan> span);
+            void EndSpan(Work& work);
+
             HttpSession& m_self;
             std::vector<std::unique_ptr<Work>> m_items;
 
@@ -52,6 +85,7 @@ namespace porla
             {
                 BOOST_ASSERT(!m_items.empty());
                 auto const wasFull = IsFull();
+                EndSpan(*m_items.front());
                 m_items.erase(m_items.begin());
                 if(! m_items.empty())
                     (*m_items.front())();
@@ -59,7 +93,7 @@ namespace porla
             }
 
             template<bool isRequest, class Body, class Fields>
-            void operator()(boost::beast::http::message<isRequest, Body, Fields>&& msg)
+            void operator()(boost::beast::http::message<isRequest, Body, Fields>&& msg, std::shared_ptr<TraceSpan> span = nullptr)
             {
                 // This holds a work item
                 struct WorkImpl : Work
@@ -75,8 +109,18 @@ namespace porla
                     {
                     }
 
-                    void operator()()
+                    unsigned Status() const override
                     {
+                        if constexpr (isRequest) { return 0; }
+                        else { return m_msg.result_int(); }
+                    }
+
+                    void operator()() override
+                    {
+                        // The expiry set for reading the request may already have passed
+                        // for responses which took a while.
+                        m_self.m_stream.expires_after(m_self.m_options.idle_timeout);
+
                         boost::beast::http::async_write(
                             m_self.m_stream,
                             m_msg,
@@ -88,18 +132,129 @@ namespace porla
                 };
 
                 // Allocate and store the work
-                m_items.push_back(std::make_unique<WorkImpl>(m_self, std::move(msg)));
+                Push(std::make_unique<WorkImpl>(m_self, std::move(msg)), std::move(span));
+            }
 
-                // If there was no previous work, start this one
-                if(m_items.size() == 1)
-                    (*m_items.front())();
+            // Queues a chunked response. The next chunk is only produced once the previous
+            // one is written.
+            void Chunked(
+                boost::beast::http::response<boost::beast::http::empty_body>&& header,
+                std::function<bool(std::string&)> next,
+                std::shared_ptr<TraceSpan> span = nullptr)
+            {
+                struct ChunkedImpl : Work
+                {
+                    HttpSession& m_self;
+                    boost::beast::http::response<boost::beast::http::empty_body> m_header;
+                    boost::beast::http::response_serializer<boost::beast::http::empty_body> m_serializer;
+                    std::function<bool(std::string&)> m_next;
+                    std::string m_chunk;
+
+                    ChunkedImpl(
+                        HttpSession& self,
+                        boost::beast::http::response<boost::beast::http::empty_body>&& header,
+                        std::function<bool(std::string&)> next)
+                        : m_self(self)
+                        , m_header(std::move(header))
+                        , m_serializer(m_header)
+                        , m_next(std::move(next))
+                    {
+                    }
+
+                    unsigned Status() const override
+                    {
+                        return m_header.result_int();
+                    }
+
+                    void operator()() override
+                    {
+                        m_self.m_stream.expires_after(m_self.m_options.idle_timeout);
+
+                        boost::beast::http::async_write_header(
+                            m_self.m_stream,
+                            m_serializer,
+                            [this, self = m_self.shared_from_this()](boost::beast::error_code ec, std::size_t bytes)
+                            {
+                                if (ec) { return self->EndWrite(true, ec, bytes); }
+                                WriteChunk();
+                            });
+                    }
+
+                    void WriteChunk()
+                    {
+                        bool more;
+
+                        // An empty chunk would read as the end of the body.
+                        do
+                        {
+                            m_chunk.clear();
+                            more = m_next(m_chunk);
+                        }
+                        while (more && m_chunk.empty());
+
+                        // Long bodies only time out when a chunk is not taken in time.
+                        m_self.m_stream.expires_after(m_self.m_options.idle_timeout);
+
+                        if (!more)
+                        {
+                            return WriteLast();
+                        }
+
+                        boost::asio::async_write(
+                            m_self.m_stream,
+                            boost::beast::http::make_chunk(boost::asio::buffer(m_chunk)),
+                            [this, self = m_self.shared_from_this()](boost::beast::error_code ec, std::size_t bytes)
+                            {
+                                if (ec) { return self->EndWrite(true, ec, bytes); }
+                                WriteChunk();
+                            });
+                    }
+
+                    void WriteLast()
+                    {
+                        if (m_chunk.empty())
+                        {
+                            return WriteTrailer();
+                        }
+
+                        boost::asio::async_write(
+                            m_self.m_stream,
+                            boost::beast::http::make_chunk(boost::asio::buffer(m_chunk)),
+                            [this, self = m_self.shared_from_this()](boost::beast::error_code ec, std::size_t bytes)
+                            {
+                                if (ec) { return self->EndWrite(true, ec, bytes); }
+                                WriteTrailer();
+                            });
+                    }
+
+                    void WriteTrailer()
+                    {
+                        boost::asio::async_write(
+                            m_self.m_stream,
+                            boost::beast::http::make_chunk_last(),
+                            boost::beast::bind_front_handler(
+                                &HttpSession::EndWrite,
+                                m_self.shared_from_this(),
+                                m_header.need_eof()));
+                    }
+                };
+
+                Push(std::make_unique<ChunkedImpl>(m_self, std::move(header), std::move(next)), std::move(span));
             }
+
+            // Queues a response with length bytes of file from offset as its body, each part
+            // sent once available says it can be read when it is set.
+            void File(
+                boost::beast::http::response<boost::beast::http::empty_body>&& header,
+                boost::beast::file file,
+                std::uint64_t offset,
+                std::uint64_t length,
+                HttpContext::FileAvailability available,
+                std::shared_ptr<TraceSpan> span = nullptr);
         };
 
     public:
-        HttpSession(
-            boost::asio::ip::tcp::socket&& socket,
-            std::vector<porla::HttpMiddleware> middlewares);
+        HttpSession(boost::asio::ip::tcp::socket&& socket, HttpSessionOptions options);
 
         void Run();
         void Stop();
@@ -110,9 +265,11 @@ namespace porla
         void EndWrite(bool close, boost::beast::error_code ec, std::size_t bytes_transferred);
         void BeginClose();
 
+        void Compress(boost::beast::http::response<boost::beast::http::string_body>& res) const;
+
         boost::beast::tcp_stream m_stream;
         boost::beast::flat_buffer m_buffer;
-        std::vector<porla::HttpMiddleware> m_middlewares;
+        HttpSessionOptions m_options;
 
         Queue m_queue;
 
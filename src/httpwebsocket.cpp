@@ -0,0 +1,582 @@
+#include "httpwebsocket.hpp"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/beast.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/log/trivial.hpp>
+#include <nlohmann/json.hpp>
+
+#include "httpeventstream.hpp"
+#include "jsonrpchandler.hpp"
+#include "query/pql.hpp"
+
+namespace http = boost::beast::http;
+namespace websocket = boost::beast::websocket;
+
+using json = nlohmann::json;
+using porla::HttpWebSocket;
+using porla::HttpWebSocketOptions;
+
+static std::string Error(const json& id, int code, const std::string& message, const json& data = {})
+{
+    return json{
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"error", {
+            {"code", code},
+            {"message", message},
+            {"data", data}
+        }}
+    }.dump();
+}
+
+// Subscription parameters are sent as JSON, and turned into the query string form the
+// event stream takes. Arrays are joined with commas.
+static std::map<std::string, std::string> ToParams(const json& params)
+{
+    std::map<std::string, std::string> result;
+
+    if (!params.is_object())
+    {
+        return result;
+    }
+
+    for (const auto& [key, value] : params.items())
+    {
+        if (value.is_string())
+        {
+            result.insert({ key, value.get<std::string>() });
+        }
+        else if (value.is_array())
+        {
+            std::string joined;
+
+            for (const auto& item : value)
+            {
+                if (!joined.empty()) joined.push_back(',');
+                joined.append(item.is_string() ? item.get<std::string>() : item.dump());
+            }
+
+            result.insert({ key, joined });
+        }
+        else
+        {
+            result.insert({ key, value.dump() });
+        }
+    }
+
+    return result;
+}
+
+// Turns an event in its SSE form into a JSON-RPC notification. Comments, like the
+// heartbeat, have no event and are left out, since the WebSocket pings on its own.
+static std::optional<std::string> ToMessage(std::string_view evt)
+{
+    std::string_view id;
+    std::string_view name;
+    std::string_view data;
+
+    while (!evt.empty())
+    {
+        const auto end  = evt.find('\n');
+        const auto line = evt.substr(0, end);
+
+        evt.remove_prefix(end == std::string_view::npos ? evt.size() : end + 1);
+
+        if (line.starts_with("id: "))         id   = line.substr(4);
+        else if (line.starts_with("event: ")) name = line.substr(7);
+        else if (line.starts_with("data: "))  data = line.substr(6);
+    }
+
+    if (name.empty())
+    {
+        return std::nullopt;
+    }
+
+    std::string message;
+    message.reserve(name.size() + id.size() + data.size() + 64);
+    message.append(R"({"jsonrpc":"2.0","method":"event","params":{"name":")").append(name).append("\"");
+    if (!id.empty()) message.append(",\"id\":").append(id);
+    message.append(",\"data\":").append(data.empty() ? "{}" : data).append("}}");
+
+    return message;
+}
+
+class HttpWebSocket::Connection : public std::enable_shared_from_this<HttpWebSocket::Connection>
+{
+public:
+    typedef std::function<void(boost::system::error_code, std::size_t)> Done;
+
+    Connection(std::shared_ptr<porla::HttpContext> ctx, std::shared_ptr<const HttpWebSocketOptions> options)
+        : m_ctx(std::move(ctx))
+        , m_options(std::move(options))
+        , m_ws(m_ctx->Stream())
+    {
+    }
+
+    boost::asio::any_io_executor Executor() { return m_ws.get_executor(); }
+    boost::beast::tcp_stream& Stream() { return m_ctx->Stream(); }
+    bool Local() { return m_ctx->Local(); }
+
+    void Accept()
+    {
+        // The WebSocket keeps its own timeouts and pings idle clients.
+        m_ctx->Stream().expires_never();
+
+        websocket::permessage_deflate pmd;
+        pmd.server_enable = true;
+        pmd.client_enable = true;
+
+        m_ws.set_option(pmd);
+        m_ws.set_option(websocket::stream_base::timeout::suggested(boost::beast::role_type::server));
+        m_ws.set_option(websocket::stream_base::decorator(
+            [](websocket::response_type& res)
+            {
+                res.set(http::field::server, "porla/1.0");
+            }));
+
+        m_ws.read_message_max(m_options->max_message_size);
+        m_ws.text(true);
+
+        m_ws.async_accept(
+            m_ctx->Request(),
+            [self = shared_from_this()](boost::beast::error_code ec)
+            {
+                if (ec)
+                {
+                    BOOST_LOG_TRIVIAL(warning) << "Failed to accept WebSocket: " << ec.message();
+                    return;
+                }
+
+                self->BeginRead();
+            });
+    }
+
+    void Close()
+    {
+        boost::asio::dispatch(
+            Executor(),
+            [self = shared_from_this()]()
+            {
+                boost::system::error_code ec;
+                self->m_ctx->Stream().socket().close(ec);
+            });
+    }
+
+    // Called once for every request handed to the RPC handler, after its response is written.
+    void Complete()
+    {
+        boost::asio::dispatch(
+            Executor(),
+            [self = shared_from_this()]()
+            {
+                self->m_pending--;
+
+                if (!self->m_reading && !self->m_closed && self->m_pending < self->m_options->max_pending)
+                {
+                    self->BeginRead();
+                }
+            });
+    }
+
+    void Send(std::string message, Done done = nullptr)
+    {
+        Queue(Outgoing{ .data = std::move(message), .done = std::move(done) });
+    }
+
+    // Sends the message in frames as next produces it, so it is never held in full.
+    void SendChunked(std::function<bool(std::string&)> next, Done done = nullptr)
+    {
+        Queue(Outgoing{ .next = std::move(next), .done = std::move(done) });
+    }
+
+private:
+    struct Outgoing
+    {
+        std::string data;
+        std::function<bool(std::string&)> next;
+        Done done;
+    };
+
+    void BeginRead()
+    {
+        m_reading = true;
+
+        m_ws.async_read(
+            m_buffer,
+            boost::beast::bind_front_handler(
+                &Connection::EndRead,
+                shared_from_this()));
+    }
+
+    void EndRead(boost::beast::error_code ec, std::size_t bytes)
+    {
+        m_reading = false;
+
+        if (ec)
+        {
+            if (ec != websocket::error::closed && ec != boost::asio::error::operation_aborted)
+            {
+                BOOST_LOG_TRIVIAL(debug) << "WebSocket closed: " << ec.message();
+            }
+
+            m_closed = true;
+            m_subscription.reset();
+
+            return;
+        }
+
+        auto req = json::parse(
+            static_cast<const char*>(m_buffer.data().data()),
+            static_cast<const char*>(m_buffer.data().data()) + bytes,
+            nullptr,
+            false);
+
+        m_buffer.consume(m_buffer.size());
+
+        if (req.is_discarded())
+        {
+            Send(Error(nullptr, -32700, "Parse error"));
+        }
+        else
+        {
+            Handle(std::move(req));
+        }
+
+        if (m_pending < m_options->max_pending)
+        {
+            BeginRead();
+        }
+    }
+
+    void Handle(json req)
+    {
+        if (req.is_object() && req.contains("method") && req["method"].is_string())
+        {
+            const auto& method = req["method"].get_ref<const std::string&>();
+
+            if (method == "events.subscribe")
+            {
+                return Subscribe(req.value("id", json()), req.value("params", json::object()));
+            }
+
+            if (method == "events.unsubscribe")
+            {
+                m_subscription.reset();
+                return Send(json{{"jsonrpc", "2.0"}, {"id", req.value("id", json())}, {"result", json::object()}}.dump());
+            }
+        }
+
+        m_pending++;
+
+        boost::asio::post(
+            m_options->io,
+            [rpc = &m_options->rpc, req = std::move(req), ctx = std::make_shared<MessageContext>(shared_from_this())]() mutable
+            {
+                try
+                {
+                    (*rpc)(std::move(req), ctx);
+                }
+                catch (const std::exception& ex)
+                {
+                    ctx->Write(Error(nullptr, -32600, "Invalid Request", ex.what()));
+                }
+            });
+    }
+
+    void Subscribe(json id, json params)
+    {
+        if (m_options->events == nullptr)
+        {
+            return Send(Error(id, -32601, "Method not found"));
+        }
+
+        // The event stream lives on the io_context, and so does subscribing to it. A new
+        // subscription replaces the previous one.
+        boost::asio::post(
+            m_options->io,
+            [self = shared_from_this(), events = m_options->events, id = std::move(id), params = ToParams(params)]()
+            {
+                std::shared_ptr<void> subscription;
+                std::string response;
+
+                try
+                {
+                    subscription = events->Subscribe(std::make_shared<EventSink>(self), params);
+
+                    response = subscription != nullptr
+                        ? json{{"jsonrpc", "2.0"}, {"id", id}, {"result", json::object()}}.dump()
+                        : Error(id, -32000, "Too many event subscribers");
+                }
+                catch (const porla::Query::QueryError& err)
+                {
+                    response = Error(id, -32602, "Invalid params", std::string("Invalid query: ") + err.what());
+                }
+
+                boost::asio::dispatch(
+                    self->Executor(),
+                    [self, subscription = std::move(subscription), response = std::move(response)]() mutable
+                    {
+                        if (subscription != nullptr)
+                        {
+                            self->m_subscription = std::move(subscription);
+                        }
+
+                        self->Send(std::move(response));
+                    });
+            });
+    }
+
+    void Queue(Outgoing out)
+    {
+        boost::asio::dispatch(
+            Executor(),
+            [self = shared_from_this(), out = std::move(out)]() mutable
+            {
+                self->m_outgoing.push_back(std::move(out));
+                self->Write();
+            });
+    }
+
+    // One message is written at a time, as required by the WebSocket stream.
+    void Write()
+    {
+        if (m_writing || m_outgoing.empty())
+        {
+            return;
+        }
+
+        m_writing = true;
+
+        if (m_outgoing.front().next)
+        {
+            return WriteChunk();
+        }
+
+        m_ws.async_write(
+            boost::asio::buffer(m_outgoing.front().data),
+            boost::beast::bind_front_handler(
+                &Connection::EndWrite,
+                shared_from_this()));
+    }
+
+    void WriteChunk()
+    {
+        auto& out = m_outgoing.front();
+        bool more;
+
+        do
+        {
+            out.data.clear();
+            more = out.next(out.data);
+        }
+        while (more && out.data.empty());
+
+        m_ws.async_write_some(
+            !more,
+            boost::asio::buffer(out.data),
+            [self = shared_from_this(), more](boost::beast::error_code ec, std::size_t bytes)
+            {
+                if (!ec && more) { return self->WriteChunk(); }
+                self->EndWrite(ec, bytes);
+            });
+    }
+
+    void EndWrite(boost::beast::error_code ec, std::size_t bytes)
+    {
+        auto done = std::move(m_outgoing.front().done);
+
+        m_outgoing.pop_front();
+        m_writing = false;
+
+        if (done) { done(ec, bytes); }
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(debug) << "Failed to write WebSocket message: " << ec.message();
+
+            // Nothing more can be written, so whoever waits on the rest is told now.
+            while (!m_outgoing.empty())
+            {
+                auto rest = std::move(m_outgoing.front().done);
+                m_outgoing.pop_front();
+
+                if (rest) { rest(ec, 0); }
+            }
+
+            return;
+        }
+
+        Write();
+    }
+
+    // Writes the responses of a single request as messages on the connection.
+    class MessageContext : public porla::HttpContext
+    {
+    public:
+        explicit MessageContext(std::shared_ptr<Connection> conn)
+            : m_conn(std::move(conn))
+            , m_req(http::verb::post, "/api/v1/jsonrpc", 11)
+            , m_uri{ .path = "/api/v1/jsonrpc" }
+            , m_responded(false)
+        {
+            m_req.set(http::field::accept, "application/json");
+        }
+
+        ~MessageContext()
+        {
+            if (!m_responded) { m_conn->Complete(); }
+        }
+
+        void Next() override
+        {
+            BOOST_LOG_TRIVIAL(error) << "No middleware after a WebSocket request";
+        }
+
+        boost::beast::http::request<boost::beast::http::string_body>& Request() override { return m_req; }
+        Uri& RequestUri() override { return m_uri; }
+        boost::beast::tcp_stream& Stream() override { return m_conn->Stream(); }
+        bool Local() override { return m_conn->Local(); }
+
+        void Write(std::string body) override { Respond(std::move(body)); }
+
+        void Write(boost::beast::http::response<boost::beast::http::file_body> res) override
+        {
+            BOOST_LOG_TRIVIAL(warning) << "File responses are not sent over WebSockets";
+            Respond(Error(nullptr, -32603, "Internal error"));
+        }
+
+        void Write(boost::beast::http::response<boost::beast::http::string_body> res) override
+        {
+            Respond(std::move(res.body()));
+        }
+
+        void WriteJson(const nlohmann::json& j) override { Respond(j.dump()); }
+
+        void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) override
+        {
+            if (m_responded) { return; }
+            m_responded = true;
+
+            m_conn->SendChunked(std::move(next), [conn = m_conn](auto, auto) { conn->Complete(); });
+        }
+
+    private:
+        void Respond(std::string message)
+        {
+            if (m_responded) { return; }
+            m_responded = true;
+
+            m_conn->Send(std::move(message), [conn = m_conn](auto, auto) { conn->Complete(); });
+        }
+
+        std::shared_ptr<Connection> m_conn;
+        http::request<http::string_body> m_req;
+        Uri m_uri;
+        bool m_responded;
+    };
+
+    // Hands subscribed events to the connection as notifications. It does not keep the
+    // connection alive, so a closed connection fails the writes and ends the subscription.
+    class EventSink : public porla::HttpEventStream::Sink
+    {
+    public:
+        explicit EventSink(const std::shared_ptr<Connection>& conn)
+            : m_conn(conn)
+            , m_executor(conn->Executor())
+        {
+        }
+
+        boost::asio::any_io_executor Executor() override { return m_executor; }
+
+        void Write(std::vector<std::shared_ptr<const std::string>> events, Done done) override
+        {
+            const auto conn = m_conn.lock();
+
+            if (conn == nullptr)
+            {
+                return boost::asio::post(m_executor, [done = std::move(done)]() { done(boost::asio::error::operation_aborted, 0); });
+            }
+
+            std::vector<std::string> messages;
+            messages.reserve(events.size());
+
+            for (const auto& evt : events)
+            {
+                if (auto message = ToMessage(*evt)) messages.push_back(std::move(*message));
+            }
+
+            if (messages.empty())
+            {
+                return boost::asio::post(m_executor, [done = std::move(done)]() { done({}, 0); });
+            }
+
+            std::size_t bytes = 0;
+            for (const auto& message : messages) bytes += message.size();
+
+            for (std::size_t i = 0; i + 1 < messages.size(); i++)
+            {
+                conn->Send(std::move(messages[i]));
+            }
+
+            conn->Send(
+                std::move(messages.back()),
+                [bytes, done = std::move(done)](boost::system::error_code ec, std::size_t) { done(ec, bytes); });
+        }
+
+        void Close() override
+        {
+            if (const auto conn = m_conn.lock()) { conn->Close(); }
+        }
+
+    private:
+        std::weak_ptr<Connection> m_conn;
+        boost::asio::any_io_executor m_executor;
+    };
+
+    std::shared_ptr<porla::HttpContext> m_ctx;
+    std::shared_ptr<const HttpWebSocketOptions> m_options;
+    websocket::stream<boost::beast::tcp_stream&> m_ws;
+    boost::beast::flat_buffer m_buffer;
+    std::deque<Outgoing> m_outgoing;
+    std::size_t m_pending = 0;
+    bool m_closed = false;
+    bool m_reading = false;
+    bool m_writing = false;
+    std::shared_ptr<void> m_subscription;
+};
+
+HttpWebSocket::HttpWebSocket(HttpWebSocketOptions options)
+    : m_options(std::make_shared<const HttpWebSocketOptions>(std::move(options)))
+{
+}
+
+void HttpWebSocket::operator()(const std::shared_ptr<porla::HttpContext>& ctx)
+{
+    if (!websocket::is_upgrade(ctx->Request()))
+    {
+        http::response<http::string_body> res{http::status::upgrade_required, ctx->Request().version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::content_type, "text/plain");
+        res.set(http::field::upgrade, "websocket");
+        res.keep_alive(ctx->Request().keep_alive());
+        res.body() = "Expected a WebSocket upgrade";
+        res.prepare_payload();
+
+        return ctx->Write(std::move(res));
+    }
+
+    auto conn = std::make_shared<Connection>(ctx, m_options);
+
+    boost::asio::dispatch(
+        conn->Executor(),
+        [conn]() { conn->Accept(); });
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/asio.hpp>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    class HttpEventStream;
+    class JsonRpcHandler;
+
+    struct HttpWebSocketOptions
+    {
+        // Where the RPC methods and event subscriptions run.
+        boost::asio::io_context& io;
+        JsonRpcHandler&          rpc;
+        HttpEventStream*         events = nullptr;
+        std::size_t              max_message_size = 10000000;
+        // Requests a connection may have waiting for a response before it is read from
+        // again.
+        std::size_t              max_pending = 64;
+    };
+
+    // Serves JSON-RPC and events over a single WebSocket connection, authenticated once by
+    // the handshake. Each text message is a JSON-RPC request or batch, answered in a message
+    // of its own. events.subscribe takes the parameters of an events request and
+    // events.unsubscribe ends it. Events are sent as "event" notifications. Messages are
+    // compressed with permessage-deflate when the client offers it.
+    class HttpWebSocket
+    {
+    public:
+        explicit HttpWebSocket(HttpWebSocketOptions options);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        class Connection;
+
+        // Shared, since the server copies its middlewares.
+        std::shared_ptr<const HttpWebSocketOptions> m_options;
+    };
+}
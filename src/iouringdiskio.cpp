@@ -0,0 +1,748 @@
+#include "iouringdiskio.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/asio/post.hpp>
+#include <boost/log/trivial.hpp>
+#include <fcntl.h>
+#include <liburing.h>
+#include <libtorrent/error_code.hpp>
+#include <libtorrent/operations.hpp>
+#include <libtorrent/performance_counters.hpp>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace lt = libtorrent;
+
+using porla::IoUringDiskIo;
+
+// The largest block peers ask for. Anything larger is read by the default backend.
+static constexpr int BufferSize = 16 * 1024;
+// O_DIRECT wants offsets, lengths and memory aligned to the logical block size, which is
+// at most this on the disks worth using it with.
+static constexpr int DirectAlignment = 4096;
+// Marks the no-op which stops the completion thread.
+static constexpr std::uint64_t StopToken = 0;
+
+lt::disk_io_constructor_type IoUringDiskIo::Constructor(porla::IoUringDiskIoOptions options)
+{
+    return [options](lt::io_context& ios, const lt::settings_interface& settings, lt::counters& counters)
+    {
+        return std::make_unique<IoUringDiskIo>(ios, settings, counters, options);
+    };
+}
+
+IoUringDiskIo::IoUringDiskIo(
+    lt::io_context& ios,
+    const lt::settings_interface& settings,
+    lt::counters& counters,
+    porla::IoUringDiskIoOptions options)
+    : m_ios(ios)
+    , m_counters(counters)
+    , m_options(options)
+    , m_inner(lt::default_disk_io_constructor(ios, settings, counters))
+    , m_ring(std::make_unique<io_uring>())
+    , m_fixed(false)
+    , m_aborted(false)
+    , m_memory(nullptr)
+    , m_openFiles(0)
+    , m_tick(0)
+{
+    m_options.buffers = std::clamp(m_options.buffers, 1, 32768);
+
+    if (const int res = io_uring_queue_init(static_cast<unsigned>(std::min(m_options.buffers, 4096)), m_ring.get(), 0); res < 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to set up io_uring (" << std::strerror(-res) << "), reading through the default disk backend";
+        m_ring.reset();
+        return;
+    }
+
+    m_memory = static_cast<char*>(std::aligned_alloc(DirectAlignment, static_cast<std::size_t>(m_options.buffers) * BufferSize));
+
+    std::vector<iovec> iovecs(static_cast<std::size_t>(m_options.buffers));
+
+    for (int i = 0; i < m_options.buffers; i++)
+    {
+        iovecs[i] = iovec{ .iov_base = m_memory + static_cast<std::size_t>(i) * BufferSize, .iov_len = BufferSize };
+        m_freeBuffers.push_back(m_options.buffers - i - 1);
+    }
+
+    // Registering pins the memory, which RLIMIT_MEMLOCK may not allow. Plain reads into
+    // the same buffers still work.
+    if (const int res = io_uring_register_buffers(m_ring.get(), iovecs.data(), static_cast<unsigned>(iovecs.size())); res < 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to register io_uring buffers (" << std::strerror(-res) << "), reading without them";
+    }
+    else
+    {
+        m_fixed = true;
+    }
+
+    m_reaper = std::thread([this]() { Reap(); });
+
+    BOOST_LOG_TRIVIAL(info) << "Reading blocks with io_uring into " << m_options.buffers << " buffer(s)"
+                            << (m_options.direct ? ", with direct I/O where aligned" : "");
+}
+
+IoUringDiskIo::~IoUringDiskIo()
+{
+    abort(true);
+
+    for (auto& [index, storage] : m_storages)
+    {
+        storage.inflight = 0;
+        Close(storage);
+    }
+
+    if (m_ring)
+    {
+        io_uring_queue_exit(m_ring.get());
+    }
+
+    std::free(m_memory);
+}
+
+lt::storage_holder IoUringDiskIo::new_torrent(const lt::storage_params& p, const std::shared_ptr<void>& torrent)
+{
+    auto inner = m_inner->new_torrent(p, torrent);
+    const lt::storage_index_t index = inner;
+
+    m_storages.insert_or_assign(index, Storage{
+        .inner      = std::move(inner),
+        .files      = p.mapped_files != nullptr ? *p.mapped_files : p.files,
+        .save_path  = p.path,
+        .priorities = p.priorities
+    });
+
+    return { index, *this };
+}
+
+void IoUringDiskIo::remove_torrent(lt::storage_index_t index)
+{
+    auto storage = m_storages.find(index);
+
+    if (storage == m_storages.end())
+    {
+        return;
+    }
+
+    storage->second.inner.reset();
+
+    // Reads still in flight keep their descriptors until they are done.
+    if (storage->second.inflight > 0)
+    {
+        storage->second.removed = true;
+        Close(storage->second);
+        return;
+    }
+
+    Close(storage->second);
+    m_storages.erase(storage);
+}
+
+void IoUringDiskIo::async_read(
+    lt::storage_index_t index,
+    const lt::peer_request& r,
+    std::function<void(lt::disk_buffer_holder, const lt::storage_error&)> handler,
+    lt::disk_job_flags_t flags)
+{
+    const auto storage = m_storages.find(index);
+
+    const bool own = m_ring != nullptr
+        && !m_aborted
+        && storage != m_storages.end()
+        && !storage->second.removed
+        && storage->second.fences == 0
+        && r.length > 0
+        && r.length <= BufferSize
+        && !storage->second.writing.contains(r.piece);
+
+    if (!own)
+    {
+        return m_inner->async_read(index, r, std::move(handler), flags);
+    }
+
+    auto read = std::make_unique<Read>();
+    read->storage = index;
+    read->length  = r.length;
+    read->handler = std::move(handler);
+
+    int buffer_offset = 0;
+
+    for (const auto& slice : storage->second.files.map_block(r.piece, r.start, r.length))
+    {
+        const auto& prio = storage->second.priorities;
+
+        // Files not wanted may have their data in the part file, which only the default
+        // backend knows how to read.
+        if (slice.file_index < prio.end_index() && prio[slice.file_index] == lt::dont_download)
+        {
+            return m_inner->async_read(index, r, std::move(read->handler), flags);
+        }
+
+        if (read->slices.empty()) read->first_file = slice.file_index;
+
+        // Pad files are not on disk, and read as zeros.
+        if (storage->second.files.pad_file_at(slice.file_index))
+        {
+            read->slices.push_back(Slice{ .read = read.get(), .fd = -1, .offset = 0, .buffer_offset = buffer_offset, .size = static_cast<int>(slice.size) });
+            buffer_offset += static_cast<int>(slice.size);
+            continue;
+        }
+
+        const bool direct = m_options.direct
+            && slice.offset % DirectAlignment == 0
+            && slice.size % DirectAlignment == 0
+            && buffer_offset % DirectAlignment == 0;
+
+        const int fd = Open(storage->second, slice.file_index, direct);
+
+        // Missing files and the like are left to the default backend, which reports them
+        // the way libtorrent expects.
+        if (fd < 0)
+        {
+            return m_inner->async_read(index, r, std::move(read->handler), flags);
+        }
+
+        read->slices.push_back(Slice{
+            .read          = read.get(),
+            .fd            = fd,
+            .offset        = slice.offset,
+            .buffer_offset = buffer_offset,
+            .size          = static_cast<int>(slice.size)
+        });
+
+        buffer_offset += static_cast<int>(slice.size);
+    }
+
+    storage->second.inflight++;
+    storage->second.last_used = ++m_tick;
+
+    m_pending.push_back(std::move(read));
+}
+
+bool IoUringDiskIo::async_write(
+    lt::storage_index_t index,
+    const lt::peer_request& r,
+    const char* buf,
+    std::shared_ptr<lt::disk_observer> o,
+    std::function<void(const lt::storage_error&)> handler,
+    lt::disk_job_flags_t flags)
+{
+    // Until the default backend has written the block, reads of the piece go to it too.
+    if (auto storage = m_storages.find(index); storage != m_storages.end())
+    {
+        storage->second.writing[r.piece]++;
+    }
+
+    return m_inner->async_write(
+        index,
+        r,
+        buf,
+        std::move(o),
+        [this, index, piece = r.piece, handler = std::move(handler)](const lt::storage_error& error)
+        {
+            if (auto storage = m_storages.find(index); storage != m_storages.end())
+            {
+                if (auto writing = storage->second.writing.find(piece); writing != storage->second.writing.end() && --writing->second <= 0)
+                {
+                    storage->second.writing.erase(writing);
+                }
+            }
+
+            handler(error);
+        },
+        flags);
+}
+
+void IoUringDiskIo::async_hash(
+    lt::storage_index_t storage,
+    lt::piece_index_t piece,
+    lt::span<lt::sha256_hash> v2,
+    lt::disk_job_flags_t flags,
+    std::function<void(lt::piece_index_t, const lt::sha1_hash&, const lt::storage_error&)> handler)
+{
+    m_inner->async_hash(storage, piece, v2, flags, std::move(handler));
+}
+
+void IoUringDiskIo::async_hash2(
+    lt::storage_index_t storage,
+    lt::piece_index_t piece,
+    int offset,
+    lt::disk_job_flags_t flags,
+    std::function<void(lt::piece_index_t, const lt::sha256_hash&, const lt::storage_error&)> handler)
+{
+    m_inner->async_hash2(storage, piece, offset, flags, std::move(handler));
+}
+
+template<typename THandler>
+auto IoUringDiskIo::Fenced(lt::storage_index_t index, THandler handler)
+{
+    if (auto storage = m_storages.find(index); storage != m_storages.end())
+    {
+        storage->second.fences++;
+        Close(storage->second);
+    }
+
+    return [this, index, handler = std::move(handler)](auto&&... args)
+    {
+        if (auto storage = m_storages.find(index); storage != m_storages.end())
+        {
+            storage->second.fences--;
+        }
+
+        handler(std::forward<decltype(args)>(args)...);
+    };
+}
+
+void IoUringDiskIo::async_move_storage(
+    lt::storage_index_t index,
+    std::string p,
+    lt::move_flags_t flags,
+    std::function<void(lt::status_t, const std::string&, const lt::storage_error&)> handler)
+{
+    m_inner->async_move_storage(
+        index,
+        std::move(p),
+        flags,
+        Fenced(index, [this, index, handler = std::move(handler)](lt::status_t status, const std::string& path, const lt::storage_error& error)
+        {
+            if (auto storage = m_storages.find(index); storage != m_storages.end() && !error)
+            {
+                storage->second.save_path = path;
+            }
+
+            handler(status, path, error);
+        }));
+}
+
+void IoUringDiskIo::async_release_files(lt::storage_index_t index, std::function<void()> handler)
+{
+    if (auto storage = m_storages.find(index); storage != m_storages.end())
+    {
+        Close(storage->second);
+    }
+
+    m_inner->async_release_files(index, std::move(handler));
+}
+
+void IoUringDiskIo::async_check_files(
+    lt::storage_index_t index,
+    const lt::add_torrent_params* resume_data,
+    lt::aux::vector<std::string, lt::file_index_t> links,
+    std::function<void(lt::status_t, const lt::storage_error&)> handler)
+{
+    m_inner->async_check_files(index, resume_data, std::move(links), Fenced(index, std::move(handler)));
+}
+
+void IoUringDiskIo::async_stop_torrent(lt::storage_index_t index, std::function<void()> handler)
+{
+    if (auto storage = m_storages.find(index); storage != m_storages.end())
+    {
+        Close(storage->second);
+    }
+
+    m_inner->async_stop_torrent(index, std::move(handler));
+}
+
+void IoUringDiskIo::async_rename_file(
+    lt::storage_index_t index,
+    lt::file_index_t file,
+    std::string name,
+    std::function<void(const std::string&, lt::file_index_t, const lt::storage_error&)> handler)
+{
+    m_inner->async_rename_file(
+        index,
+        file,
+        std::move(name),
+        Fenced(index, [this, index, handler = std::move(handler)](const std::string& new_name, lt::file_index_t file, const lt::storage_error& error)
+        {
+            if (auto storage = m_storages.find(index); storage != m_storages.end() && !error)
+            {
+                storage->second.files.rename_file(file, new_name);
+            }
+
+            handler(new_name, file, error);
+        }));
+}
+
+void IoUringDiskIo::async_delete_files(
+    lt::storage_index_t index,
+    lt::remove_flags_t options,
+    std::function<void(const lt::storage_error&)> handler)
+{
+    m_inner->async_delete_files(index, options, Fenced(index, std::move(handler)));
+}
+
+void IoUringDiskIo::async_set_file_priority(
+    lt::storage_index_t index,
+    lt::aux::vector<lt::download_priority_t, lt::file_index_t> prio,
+    std::function<void(const lt::storage_error&, lt::aux::vector<lt::download_priority_t, lt::file_index_t>)> handler)
+{
+    m_inner->async_set_file_priority(
+        index,
+        std::move(prio),
+        [this, index, handler = std::move(handler)](const lt::storage_error& error, lt::aux::vector<lt::download_priority_t, lt::file_index_t> prio)
+        {
+            if (auto storage = m_storages.find(index); storage != m_storages.end())
+            {
+                storage->second.priorities = prio;
+            }
+
+            handler(error, std::move(prio));
+        });
+}
+
+void IoUringDiskIo::async_clear_piece(
+    lt::storage_index_t storage,
+    lt::piece_index_t index,
+    std::function<void(lt::piece_index_t)> handler)
+{
+    m_inner->async_clear_piece(storage, index, std::move(handler));
+}
+
+void IoUringDiskIo::update_stats_counters(lt::counters& c) const
+{
+    m_inner->update_stats_counters(c);
+}
+
+std::vector<lt::open_file_state> IoUringDiskIo::get_status(lt::storage_index_t storage) const
+{
+    return m_inner->get_status(storage);
+}
+
+void IoUringDiskIo::abort(bool wait)
+{
+    if (m_aborted)
+    {
+        return;
+    }
+
+    m_aborted = true;
+    m_inner->abort(wait);
+
+    // Reads not submitted yet are failed, and the ones in flight are left to finish.
+    std::vector<Read*> aborted;
+
+    for (auto& read : m_pending)
+    {
+        read->error.ec        = boost::asio::error::operation_aborted;
+        read->error.operation = lt::operation_t::file_read;
+        aborted.push_back(read.release());
+    }
+
+    m_pending.clear();
+
+    if (!aborted.empty())
+    {
+        boost::asio::post(m_ios, [this, aborted = std::move(aborted)]() mutable { Complete(std::move(aborted)); });
+    }
+
+    if (!m_ring)
+    {
+        return;
+    }
+
+    // Drained, so the completion thread stops after everything before it has completed.
+    if (io_uring_sqe* sqe = io_uring_get_sqe(m_ring.get()))
+    {
+        io_uring_prep_nop(sqe);
+        io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+        io_uring_sqe_set_data64(sqe, StopToken);
+        io_uring_submit(m_ring.get());
+    }
+
+    if (wait && m_reaper.joinable())
+    {
+        m_reaper.join();
+    }
+    else if (m_reaper.joinable())
+    {
+        m_reaper.detach();
+    }
+}
+
+void IoUringDiskIo::submit_jobs()
+{
+    m_inner->submit_jobs();
+    Submit();
+}
+
+void IoUringDiskIo::settings_updated()
+{
+    m_inner->settings_updated();
+}
+
+void IoUringDiskIo::free_disk_buffer(char* buf)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_buffersMutex);
+        m_freeBuffers.push_back(static_cast<int>((buf - m_memory) / BufferSize));
+    }
+
+    // Reads waiting for a buffer can go now.
+    boost::asio::post(m_ios, [this]() { if (!m_aborted) Submit(); });
+}
+
+void IoUringDiskIo::Close(Storage& storage)
+{
+    if (storage.inflight > 0)
+    {
+        storage.close_idle = true;
+        return;
+    }
+
+    for (auto& [index, file] : storage.open)
+    {
+        if (file.fd >= 0)        { ::close(file.fd); m_openFiles--; }
+        if (file.direct_fd >= 0) { ::close(file.direct_fd); m_openFiles--; }
+    }
+
+    storage.open.clear();
+    storage.close_idle = false;
+}
+
+void IoUringDiskIo::Complete(std::vector<Read*> reads)
+{
+    for (auto raw : reads)
+    {
+        std::unique_ptr<Read> read(raw);
+
+        if (auto storage = m_storages.find(read->storage); storage != m_storages.end())
+        {
+            storage->second.inflight--;
+
+            if (storage->second.inflight == 0 && storage->second.close_idle)
+            {
+                Close(storage->second);
+            }
+
+            if (storage->second.inflight == 0 && storage->second.removed)
+            {
+                m_storages.erase(storage);
+            }
+        }
+
+        m_counters.inc_stats_counter(lt::counters::num_read_ops);
+
+        if (read->error)
+        {
+            if (read->buffer >= 0) free_disk_buffer(m_memory + static_cast<std::size_t>(read->buffer) * BufferSize);
+            read->handler(lt::disk_buffer_holder{}, read->error);
+            continue;
+        }
+
+        m_counters.inc_stats_counter(lt::counters::num_blocks_read);
+
+        read->handler(
+            lt::disk_buffer_holder(*this, m_memory + static_cast<std::size_t>(read->buffer) * BufferSize, read->length),
+            read->error);
+    }
+}
+
+void IoUringDiskIo::Evict()
+{
+    // Closes the files of the torrents read from least recently, skipping the ones with
+    // reads in flight, until there is room for one more.
+    while (m_openFiles >= m_options.max_open_files)
+    {
+        Storage* oldest = nullptr;
+
+        for (auto& [index, storage] : m_storages)
+        {
+            if (storage.inflight == 0 && !storage.open.empty() && (oldest == nullptr || storage.last_used < oldest->last_used))
+            {
+                oldest = &storage;
+            }
+        }
+
+        if (oldest == nullptr)
+        {
+            return;
+        }
+
+        Close(*oldest);
+    }
+}
+
+int IoUringDiskIo::Open(Storage& storage, lt::file_index_t index, bool direct)
+{
+    auto& file = storage.open[index];
+
+    if (direct && !file.no_direct)
+    {
+        if (file.direct_fd < 0)
+        {
+            Evict();
+
+            file.direct_fd = ::open(storage.files.file_path(index, storage.save_path).c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+
+            if (file.direct_fd >= 0) m_openFiles++;
+            else if (errno == EINVAL) file.no_direct = true;
+        }
+
+        if (file.direct_fd >= 0)
+        {
+            return file.direct_fd;
+        }
+    }
+
+    if (file.fd < 0)
+    {
+        Evict();
+
+        file.fd = ::open(storage.files.file_path(index, storage.save_path).c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (file.fd >= 0) m_openFiles++;
+    }
+
+    return file.fd;
+}
+
+void IoUringDiskIo::Reap()
+{
+    std::vector<io_uring_cqe*> cqes(256);
+
+    for (;;)
+    {
+        io_uring_cqe* first = nullptr;
+
+        if (const int res = io_uring_wait_cqe(m_ring.get(), &first); res < 0)
+        {
+            if (res == -EINTR) continue;
+
+            BOOST_LOG_TRIVIAL(error) << "Failed to wait for io_uring completions: " << std::strerror(-res);
+            return;
+        }
+
+        const unsigned count = io_uring_peek_batch_cqe(m_ring.get(), cqes.data(), static_cast<unsigned>(cqes.size()));
+
+        std::vector<Read*> done;
+        bool stop = false;
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            const auto data = io_uring_cqe_get_data64(cqes[i]);
+            const int  res  = cqes[i]->res;
+
+            if (data == StopToken)
+            {
+                stop = true;
+                continue;
+            }
+
+            auto slice = reinterpret_cast<Slice*>(data);
+            auto read  = slice->read;
+
+            if (res != slice->size && !read->error)
+            {
+                read->error.ec        = res < 0 ? lt::error_code(-res, lt::system_category()) : lt::error_code(boost::asio::error::eof);
+                read->error.operation = lt::operation_t::file_read;
+                read->error.file(read->first_file);
+            }
+
+            if (--read->remaining == 0)
+            {
+                done.push_back(read);
+            }
+        }
+
+        io_uring_cq_advance(m_ring.get(), count);
+
+        // One post for all of them, since there may be many.
+        if (!done.empty())
+        {
+            boost::asio::post(m_ios, [this, done = std::move(done)]() mutable { Complete(std::move(done)); });
+        }
+
+        if (stop)
+        {
+            return;
+        }
+    }
+}
+
+void IoUringDiskIo::Submit()
+{
+    int submitted = 0;
+
+    while (!m_pending.empty())
+    {
+        int buffer;
+
+        {
+            std::unique_lock<std::mutex> lock(m_buffersMutex);
+
+            if (m_freeBuffers.empty())
+            {
+                break;
+            }
+
+            buffer = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        }
+
+        auto read = std::move(m_pending.front());
+        m_pending.pop_front();
+
+        read->buffer = buffer;
+
+        char* memory = m_memory + static_cast<std::size_t>(buffer) * BufferSize;
+        std::vector<Slice*> queued;
+
+        for (auto& slice : read->slices)
+        {
+            if (slice.fd < 0)
+            {
+                std::memset(memory + slice.buffer_offset, 0, static_cast<std::size_t>(slice.size));
+                continue;
+            }
+
+            queued.push_back(&slice);
+        }
+
+        // Only pad files, so there is nothing to read.
+        if (queued.empty())
+        {
+            boost::asio::post(m_ios, [this, raw = read.release()]() { Complete({ raw }); });
+            continue;
+        }
+
+        read->remaining = static_cast<int>(queued.size());
+
+        for (auto slice : queued)
+        {
+            io_uring_sqe* sqe = io_uring_get_sqe(m_ring.get());
+
+            // The ring is full, so what is queued so far goes first.
+            if (sqe == nullptr)
+            {
+                io_uring_submit(m_ring.get());
+                sqe = io_uring_get_sqe(m_ring.get());
+            }
+
+            if (m_fixed)
+            {
+                io_uring_prep_read_fixed(sqe, slice->fd, memory + slice->buffer_offset, static_cast<unsigned>(slice->size), static_cast<std::uint64_t>(slice->offset), buffer);
+            }
+            else
+            {
+                io_uring_prep_read(sqe, slice->fd, memory + slice->buffer_offset, static_cast<unsigned>(slice->size), static_cast<std::uint64_t>(slice->offset));
+            }
+
+            io_uring_sqe_set_data64(sqe, reinterpret_cast<std::uint64_t>(slice));
+        }
+
+        // Owned by the completions until they hand it back.
+        read.release();
+        submitted++;
+    }
+
+    if (submitted > 0)
+    {
+        io_uring_submit(m_ring.get());
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <libtorrent/disk_buffer_holder.hpp>
+#include <libtorrent/disk_interface.hpp>
+#include <libtorrent/file_storage.hpp>
+#include <libtorrent/io_context.hpp>
+
+struct io_uring;
+
+namespace porla
+{
+    struct IoUringDiskIoOptions
+    {
+        // Block sized buffers registered with the ring, which is also the most reads in flight.
+        int  buffers        = 1024;
+        // Reads blocks with O_DIRECT when the offset, length and buffer are all aligned,
+        // skipping the page cache. Helps when seeding far more data than fits in memory.
+        bool direct         = false;
+        // Descriptors kept open across torrents. Files of idle torrents are closed first.
+        int  max_open_files = 1024;
+    };
+
+    // Serves block reads, which is what seeding does most, through io_uring and leaves
+    // everything else to libtorrent's default backend. Reads are queued as they are asked
+    // for and submitted together when libtorrent submits its jobs, into buffers registered
+    // with the ring, and a thread of their own reaps the completions. Reads which could
+    // see data the default backend has not written yet, or touch files being moved,
+    // renamed or checked, go to the default backend instead. Without io_uring support in
+    // the kernel, everything does.
+    class IoUringDiskIo final : public libtorrent::disk_interface, public libtorrent::buffer_allocator_interface
+    {
+    public:
+        static libtorrent::disk_io_constructor_type Constructor(IoUringDiskIoOptions options);
+
+        explicit IoUringDiskIo(
+            libtorrent::io_context& ios,
+            const libtorrent::settings_interface& settings,
+            libtorrent::counters& counters,
+            IoUringDiskIoOptions options);
+
+        IoUringDiskIo(const IoUringDiskIo&) = delete;
+
+        ~IoUringDiskIo() override;
+
+        libtorrent::storage_holder new_torrent(const libtorrent::storage_params& p, const std::shared_ptr<void>& torrent) override;
+        void remove_torrent(libtorrent::storage_index_t storage) override;
+
+        void async_read(
+            libtorrent::storage_index_t storage,
+            const libtorrent::peer_request& r,
+            std::function<void(libtorrent::disk_buffer_holder, const libtorrent::storage_error&)> handler,
+            libtorrent::disk_job_flags_t flags) override;
+
+        bool async_write(
+            libtorrent::storage_index_t storage,
+            const libtorrent::peer_request& r,
+            const char* buf,
+            std::shared_ptr<libtorrent::disk_observer> o,
+            std::function<void(const libtorrent::storage_error&)> handler,
+            libtorrent::disk_job_flags_t flags) override;
+
+        void async_hash(
+            libtorrent::storage_index_t storage,
+            libtorrent::piece_index_t piece,
+            libtorrent::span<libtorrent::sha256_hash> v2,
+            libtorrent::disk_job_flags_t flags,
+            std::function<void(libtorrent::piece_index_t, const libtorrent::sha1_hash&, const libtorrent::storage_error&)> handler) override;
+
+        void async_hash2(
+            libtorrent::storage_index_t storage,
+            libtorrent::piece_index_t piece,
+            int offset,
+            libtorrent::disk_job_flags_t flags,
+            std::function<void(libtorrent::piece_index_t, const libtorrent::sha256_hash&, const libtorrent::storage_error&)> handler) override;
+
+        void async_move_storage(
+            libtorrent::storage_index_t storage,
+            std::string p,
+            libtorrent::move_flags_t flags,
+            std::function<void(libtorrent::status_t, const std::string&, const libtorrent::storage_error&)> handler) override;
+
+        void async_release_files(libtorrent::storage_index_t storage, std::function<void()> handler) override;
+
+        void async_check_files(
+            libtorrent::storage_index_t storage,
+            const libtorrent::add_torrent_params* resume_data,
+            libtorrent::aux::vector<std::string, libtorrent::file_index_t> links,
+            std::function<void(libtorrent::status_t, const libtorrent::storage_error&)> handler) override;
+
+        void async_stop_torrent(libtorrent::storage_index_t storage, std::function<void()> handler) override;
+
+        void async_rename_file(
+            libtorrent::storage_index_t storage,
+            libtorrent::file_index_t index,
+            std::string name,
+            std::function<void(const std::string&, libtorrent::file_index_t, const libtorrent::storage_error&)> handler) override;
+
+        void async_delete_files(
+            libtorrent::storage_index_t storage,
+            libtorrent::remove_flags_t options,
+            std::function<void(const libtorrent::storage_error&)> handler) override;
+
+        void async_set_file_priority(
+            libtorrent::storage_index_t storage,
+            libtorrent::aux::vector<libtorrent::download_priority_t, libtorrent::file_index_t> prio,
+            std::function<void(const libtorrent::storage_error&, libtorrent::aux::vector<libtorrent::download_priority_t, libtorrent::file_index_t>)> handler) override;
+
+        void async_clear_piece(
+            libtorrent::storage_index_t storage,
+            libtorrent::piece_index_t index,
+            std::function<void(libtorrent::piece_index_t)> handler) override;
+
+        void update_stats_counters(libtorrent::counters& c) const override;
+        std::vector<libtorrent::open_file_state> get_status(libtorrent::storage_index_t storage) const override;
+
+        void abort(bool wait) override;
+        void submit_jobs() override;
+        void settings_updated() override;
+
+        void free_disk_buffer(char* buf) override;
+
+    private:
+        struct File
+        {
+            int  fd        = -1;
+            int  direct_fd = -1;
+            // Set once O_DIRECT failed to open for the file, such as on tmpfs.
+            bool no_direct = false;
+        };
+
+        struct Storage
+        {
+            libtorrent::storage_holder inner;
+            libtorrent::file_storage   files;
+            std::string                save_path;
+            libtorrent::aux::vector<libtorrent::download_priority_t, libtorrent::file_index_t> priorities;
+
+            std::map<libtorrent::file_index_t, File> open;
+            std::map<libtorrent::piece_index_t, int> writing;
+            // Moves, renames, checks and deletes in progress, which send reads to the
+            // default backend.
+            int           fences     = 0;
+            int           inflight   = 0;
+            bool          close_idle = false;
+            bool          removed    = false;
+            std::uint64_t last_used  = 0;
+        };
+
+        struct Read;
+
+        struct Slice
+        {
+            Read*         read;
+            int           fd;
+            std::int64_t  offset;
+            int           buffer_offset;
+            int           size;
+        };
+
+        struct Read
+        {
+            libtorrent::storage_index_t storage;
+            libtorrent::file_index_t    first_file;
+            int                         length;
+            int                         buffer = -1;
+            std::vector<Slice>          slices;
+            // Only touched by the completion thread until the read is handed back.
+            int                         remaining = 0;
+            libtorrent::storage_error   error;
+            std::function<void(libtorrent::disk_buffer_holder, const libtorrent::storage_error&)> handler;
+        };
+
+        void Close(Storage& storage);
+        void Complete(std::vector<Read*> reads);
+        void Evict();
+        int Open(Storage& storage, libtorrent::file_index_t index, bool direct);
+        void Reap();
+        void Submit();
+        template<typename THandler>
+        auto Fenced(libtorrent::storage_index_t storage, THandler handler);
+
+        libtorrent::io_context& m_ios;
+        libtorrent::counters& m_counters;
+        IoUringDiskIoOptions m_options;
+        std::unique_ptr<libtorrent::disk_interface> m_inner;
+
+        std::unique_ptr<io_uring> m_ring;
+        bool m_fixed;
+        std::thread m_reaper;
+        bool m_aborted;
+
+        char* m_memory;
+        std::mutex m_buffersMutex;
+        std::vector<int> m_freeBuffers;
+
+        std::map<libtorrent::storage_index_t, Storage> m_storages;
+        std::deque<std::unique_ptr<Read>> m_pending;
+        int m_openFiles;
+        std::uint64_t m_tick;
+    };
+}
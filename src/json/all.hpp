@@ -1,27 +1,58 @@
 #pragma once
 
+#include "clustercall.hpp"
+#include "clusternodeslist.hpp"
+#include "clustertorrentslist.hpp"
+#include "configreload.hpp"
+#include "dbbackup.hpp"
 #include "fsspace.hpp"
 #include "ltannounceentry.hpp"
 #include "lterrorcode.hpp"
 #include "ltinfohash.hpp"
 #include "ltpeerinfo.hpp"
+#include "peerclasseslist.hpp"
+#include "peerclassesremove.hpp"
+#include "peerclassesset.hpp"
 #include "presetslist.hpp"
+#include "sessionalertsdebug.hpp"
+#include "sessiondhtstats.hpp"
+#include "sessiondrain.hpp"
 #include "sessionpause.hpp"
+#include "sessionpeerssummary.hpp"
+#include "sessionprofilesactivate.hpp"
+#include "sessionprofileslist.hpp"
 #include "sessionresume.hpp"
 #include "sessionsettingsget.hpp"
 #include "sessionsettingsupdate.hpp"
+#include "sessionstatshistory.hpp"
+#include "sysmemory.hpp"
+#include "sysstatus.hpp"
+#include "torrentsaddbatch.hpp"
 #include "torrentsaddreq.hpp"
 #include "torrentsaddres.hpp"
+#include "torrentscategoryset.hpp"
 #include "torrentsfileslist.hpp"
+#include "torrentshistory.hpp"
 #include "torrentslist.hpp"
+#include "torrentsmatch.hpp"
+#include "torrentsmetadatafind.hpp"
+#include "torrentsmetadataget.hpp"
 #include "torrentsmetadatalist.hpp"
+#include "torrentsmetadataset.hpp"
 #include "torrentsmove.hpp"
+#include "torrentsmovelist.hpp"
 #include "torrentspause.hpp"
 #include "torrentspeersadd.hpp"
 #include "torrentspeerslist.hpp"
+#include "torrentspieces.hpp"
 #include "torrentspropertiesget.hpp"
 #include "torrentsrecheck.hpp"
+#include "torrentsrechecklist.hpp"
 #include "torrentsremove.hpp"
 #include "torrentsresume.hpp"
 #include "torrentspropertiesset.hpp"
+#include "torrentsstats.hpp"
+#include "torrentstagsupdate.hpp"
+#include "torrentstop.hpp"
 #include "torrentstrackerslist.hpp"
+#include "trackerslist.hpp"
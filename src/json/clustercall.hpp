@@ -0,0 +1,29 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/clustercall_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterCoordinator::Reply,
+        node,
+        result,
+        error,
+        cached)
+}
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterCallReq,
+        method,
+        params,
+        cached)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterCallRes,
+        replies)
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/clusternodeslist_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterCoordinator::NodeState,
+        online,
+        revision,
+        torrents,
+        error,
+        last_seen)
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, ClusterNodesListReq& req)
+    {
+    }
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterNodesListRes,
+        nodes)
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/clustertorrentslist_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterTorrentsListReq,
+        fields,
+        filters,
+        include_metadata,
+        page,
+        page_size,
+        order_by,
+        order_by_dir)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterTorrentsListRes::Node,
+        cached,
+        error,
+        torrents_total)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ClusterTorrentsListRes,
+        nodes,
+        order_by,
+        order_by_dir,
+        page,
+        page_size,
+        torrents,
+        torrents_total)
+}
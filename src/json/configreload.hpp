@@ -0,0 +1,19 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/configreload_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, ConfigReloadReq& req)
+    {
+    }
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        ConfigReloadRes,
+        presets,
+        settings,
+        workflows)
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/dbbackup_reqres.hpp"
+#include "../methods/dbbackupstatus_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        DbBackupReq,
+        path)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        DbBackupRes,
+        destination,
+        error,
+        pages_remaining,
+        pages_total,
+        state)
+
+    static void from_json(const nlohmann::json& j, DbBackupStatusReq& req)
+    {
+    }
+}
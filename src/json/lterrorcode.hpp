@@ -3,6 +3,8 @@
 #include <libtorrent/error_code.hpp>
 #include <nlohmann/json.hpp>
 
+#include "writer.hpp"
+
 using json = nlohmann::json;
 
 namespace boost::system
@@ -21,4 +23,19 @@ namespace boost::system
             };
         }
     }
+
+    static void write_json(std::string& out, const boost::system::error_code& ec)
+    {
+        if (!ec)
+        {
+            out.append("null");
+            return;
+        }
+
+        out.append("{\"message\":");
+        porla::Json::WriteString(out, ec.message());
+        out.append(",\"value\":");
+        porla::Json::Write(out, ec.value());
+        out.push_back('}');
+    }
 }
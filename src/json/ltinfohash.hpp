@@ -6,6 +6,8 @@
 #include <libtorrent/info_hash.hpp>
 #include <nlohmann/json.hpp>
 
+#include "writer.hpp"
+
 using json = nlohmann::json;
 
 template<typename T>
@@ -31,9 +33,17 @@ namespace libtorrent
         }
         else if (j.is_array() && j.size() == 2)
         {
-            lt::sha1_hash h;
-            lt::aux::from_hex({j[0].get<std::string>().c_str(),40}, h.data());
-            ih = lt::info_hash_t(h);
+            ih = lt::info_hash_t();
+
+            if (j[0].is_string())
+            {
+                lt::aux::from_hex({j[0].get<std::string>().c_str(),40}, ih.v1.data());
+            }
+
+            if (j[1].is_string())
+            {
+                lt::aux::from_hex({j[1].get<std::string>().c_str(),64}, ih.v2.data());
+            }
         }
     }
 
@@ -43,4 +53,19 @@ namespace libtorrent
         j.push_back(ih.has_v1() ? json(ToString(ih.v1)) : nullptr);
         j.push_back(ih.has_v2() ? json(ToString(ih.v2)) : nullptr);
     }
+
+    static void write_json(std::string& out, const libtorrent::info_hash_t& ih)
+    {
+        out.push_back('[');
+
+        if (ih.has_v1()) porla::Json::WriteHex(out, { ih.v1.data(), ih.v1.size() });
+        else             out.append("null");
+
+        out.push_back(',');
+
+        if (ih.has_v2()) porla::Json::WriteHex(out, { ih.v2.data(), ih.v2.size() });
+        else             out.append("null");
+
+        out.push_back(']');
+    }
 }
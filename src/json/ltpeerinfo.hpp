@@ -1,38 +1,81 @@
 #pragma once
 
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
 #include <libtorrent/peer_info.hpp>
 #include <nlohmann/json.hpp>
 
+#include "writer.hpp"
+
 using json = nlohmann::json;
 
+namespace porla
+{
+    struct PeerInfoField
+    {
+        std::string name;
+        // The quoted name and a colon, to write as an object key.
+        std::string key;
+        std::function<json(const libtorrent::peer_info&)> to_json;
+        std::function<void(std::string&, const libtorrent::peer_info&)> write;
+    };
+
+    // Serializes each field of a peer_info on its own, so a peer list can be projected to
+    // the fields asked for without building the rest. Each field is either converted to a
+    // json or written straight to a buffer.
+    static const std::map<std::string, PeerInfoField>& PeerInfoFields()
+    {
+        static const std::map<std::string, PeerInfoField> fields = []()
+        {
+            std::map<std::string, PeerInfoField> result;
+
+            const auto add = [&result](const std::string& name, auto get)
+            {
+                result.insert({ name, PeerInfoField{
+                    .name    = name,
+                    .key     = "\"" + name + "\":",
+                    .to_json = [get](const libtorrent::peer_info& pi) { return json(get(pi)); },
+                    .write   = [get](std::string& out, const libtorrent::peer_info& pi) { Json::Write(out, get(pi)); }
+                }});
+            };
+
+            add("busy_requests",         [](auto const& pi) { return pi.busy_requests; });
+            add("client",                [](auto const& pi) { return pi.client; });
+            add("connection_type",       [](auto const& pi) { return static_cast<uint8_t>(pi.connection_type); });
+            add("down_speed",            [](auto const& pi) { return pi.down_speed; });
+            add("download_queue_length", [](auto const& pi) { return pi.download_queue_length; });
+            add("download_queue_time",   [](auto const& pi) { return lt::total_seconds(pi.download_queue_time); });
+            add("flags",                 [](auto const& pi) { return static_cast<uint32_t>(pi.flags); });
+            add("ip",                    [](auto const& pi) { return std::pair{ pi.ip.address().to_string(), pi.ip.port() }; });
+            add("last_active",           [](auto const& pi) { return lt::total_seconds(pi.last_active); });
+            add("last_request",          [](auto const& pi) { return lt::total_seconds(pi.last_request); });
+            add("local_endpoint",        [](auto const& pi) { return std::pair{ pi.local_endpoint.address().to_string(), pi.local_endpoint.port() }; });
+            add("progress",              [](auto const& pi) { return pi.progress; });
+            add("rtt",                   [](auto const& pi) { return pi.rtt; });
+            add("source",                [](auto const& pi) { return static_cast<uint8_t>(pi.source); });
+            add("total_download",        [](auto const& pi) { return pi.total_download; });
+            add("total_upload",          [](auto const& pi) { return pi.total_upload; });
+            add("up_speed",              [](auto const& pi) { return pi.up_speed; });
+
+            return result;
+        }();
+
+        return fields;
+    }
+}
+
 namespace libtorrent
 {
     static void to_json(json& j, const libtorrent::peer_info& pi)
     {
-        j = {
-            {"busy_requests", pi.busy_requests},
-            {"client", pi.client},
-            {"connection_type", static_cast<uint8_t>(pi.connection_type)},
-            {"down_speed", pi.down_speed},
-            {"download_queue_length", pi.download_queue_length},
-            {"download_queue_time", lt::total_seconds(pi.download_queue_time)},
-            {"flags", static_cast<uint32_t>(pi.flags)},
-            {"ip", {
-                pi.ip.address().to_string(),
-                pi.ip.port()
-            }},
-            {"last_active", lt::total_seconds(pi.last_active)},
-            {"last_request", lt::total_seconds(pi.last_request)},
-            {"local_endpoint", {
-                pi.local_endpoint.address().to_string(),
-                pi.local_endpoint.port()
-            }},
-            {"progress", pi.progress},
-            {"rtt", pi.rtt},
-            {"source", static_cast<uint8_t>(pi.source)},
-            {"total_download", pi.total_download},
-            {"total_upload", pi.total_upload},
-            {"up_speed", pi.up_speed},
-        };
+        j = json::object();
+
+        for (auto const& [name, field] : porla::PeerInfoFields())
+        {
+            j[name] = field.to_json(pi);
+        }
     }
 }
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/peerclasseslist_reqres.hpp"
+
+namespace porla
+{
+    static void to_json(nlohmann::json& j, const PeerClass& pc)
+    {
+        j = {
+            {"categories", pc.categories},
+            {"download_limit", pc.download_limit},
+            {"download_priority", pc.download_priority},
+            {"ignore_unchoke_slots", pc.ignore_unchoke_slots},
+            {"name", pc.name},
+            {"upload_limit", pc.upload_limit},
+            {"upload_priority", pc.upload_priority}
+        };
+    }
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, PeerClassesListReq& req)
+    {
+    }
+
+    static void to_json(nlohmann::json& j, const PeerClassesListRes& res)
+    {
+        j = {{"peer_classes", res.peer_classes}};
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/peerclassesremove_reqres.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, PeerClassesRemoveReq& req)
+    {
+        j.at("name").get_to(req.name);
+    }
+
+    static void to_json(nlohmann::json& j, const PeerClassesRemoveRes& res)
+    {
+        j = true;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/peerclassesset_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        PeerClassesSetReq,
+        categories,
+        download_limit,
+        download_priority,
+        name,
+        upload_limit,
+        upload_priority)
+
+    static void to_json(nlohmann::json& j, const PeerClassesSetRes& res)
+    {
+        j = true;
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "utils.hpp"
+#include "../methods/sessionalertsdebug_reqres.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, SessionAlertsDebugReq& req)
+    {
+        porla::optional_from_json(j, "categories", req.categories);
+    }
+
+    static void to_json(nlohmann::json& j, const SessionAlertsDebugRes& res)
+    {
+        j = {{"categories", res.categories}};
+    }
+}
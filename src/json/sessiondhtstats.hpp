@@ -0,0 +1,45 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "utils.hpp"
+#include "../methods/sessiondhtstats_reqres.hpp"
+
+namespace porla
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        DhtStats::Bucket,
+        last_active,
+        nodes,
+        replacements)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        DhtStats::Lookup,
+        branch_factor,
+        nodes_left,
+        outstanding_requests,
+        responses,
+        timeouts,
+        type)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        DhtStats::Node,
+        buckets,
+        endpoint,
+        lookups)
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, SessionDhtStatsReq& req)
+    {
+    }
+
+    static void to_json(nlohmann::json& j, const SessionDhtStatsRes& res)
+    {
+        j = {
+            {"nodes", res.stats.nodes},
+            {"state_saved", res.stats.state_saved}
+        };
+    }
+}
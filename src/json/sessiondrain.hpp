@@ -0,0 +1,19 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sessiondrain_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SessionDrainReq,
+        pause)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SessionDrainRes,
+        drained,
+        saving,
+        writes)
+}
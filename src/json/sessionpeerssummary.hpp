@@ -0,0 +1,45 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sessionpeerssummary_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        PeerAggregates::Values,
+        peers,
+        download_rate,
+        upload_rate)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        PeerAggregates::Peer,
+        client,
+        download_rate,
+        ip,
+        torrents,
+        upload_rate)
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, SessionPeersSummaryReq& req)
+    {
+    }
+
+    static void to_json(nlohmann::json& j, const SessionPeersSummaryRes& res)
+    {
+        const auto& s = res.snapshot;
+
+        j = {
+            {"clients", s.clients},
+            {"connected", s.connected},
+            {"disconnected", s.disconnected},
+            {"networks", s.networks},
+            {"top", s.top},
+            {"torrents_sampled", s.torrents_sampled},
+            {"total", s.total}
+        };
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sessionprofilesactivate_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SessionProfilesActivateReq,
+        name)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SessionProfilesActivateRes,
+        applied)
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sessionprofileslist_reqres.hpp"
+#include "../utils/settingspack.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, SessionProfilesListReq& req)
+    {
+    }
+
+    static void to_json(nlohmann::json& j, const SessionProfilesListRes& res)
+    {
+        j = {
+            {"active", res.active.has_value() ? nlohmann::json(*res.active) : nlohmann::json()},
+            {"profiles", nlohmann::json::object()}
+        };
+
+        for (auto const& [name, profile] : res.profiles)
+        {
+            auto& settings = j["profiles"][name] = nlohmann::json::object();
+
+            for (const int key : porla::Utils::SettingsPack::Keys(profile))
+            {
+                switch (key & lt::settings_pack::type_mask)
+                {
+                case lt::settings_pack::bool_type_base:   settings[lt::name_for_setting(key)] = profile.get_bool(key); break;
+                case lt::settings_pack::int_type_base:    settings[lt::name_for_setting(key)] = profile.get_int(key); break;
+                case lt::settings_pack::string_type_base: settings[lt::name_for_setting(key)] = profile.get_str(key); break;
+                }
+            }
+        }
+    }
+}
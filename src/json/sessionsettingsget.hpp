@@ -11,7 +11,18 @@ namespace porla::Methods
         SessionSettingsListReq,
         keys)
 
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SessionSettingsListRes::Tuned,
+        changed_at,
+        changes,
+        max,
+        min,
+        reason,
+        released,
+        value)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
         SessionSettingsListRes,
-        settings)
+        settings,
+        tuned)
 }
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sessionstatshistory_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SessionStatsHistoryReq,
+        from,
+        metrics,
+        resolution,
+        to)
+
+    static void to_json(nlohmann::json& j, const SessionStatsHistoryRes& res)
+    {
+        auto metrics = nlohmann::json::object();
+
+        for (const auto& [name, values] : res.metrics)
+        {
+            auto& arr = metrics[name] = nlohmann::json::array();
+
+            for (const auto& value : values)
+            {
+                if (value.has_value()) arr.push_back(*value);
+                else                   arr.push_back(nullptr);
+            }
+        }
+
+        j = {
+            {"metrics", std::move(metrics)},
+            {"resolution", res.resolution},
+            {"start", res.start}
+        };
+    }
+}
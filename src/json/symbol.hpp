@@ -0,0 +1,51 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "writer.hpp"
+#include "../symbol.hpp"
+
+namespace porla
+{
+    static void from_json(const nlohmann::json& j, Symbol& symbol)
+    {
+        symbol = Symbol::Intern(j.get<std::string>());
+    }
+
+    static void to_json(nlohmann::json& j, const Symbol& symbol)
+    {
+        j = symbol.str();
+    }
+
+    static void from_json(const nlohmann::json& j, SymbolSet& symbols)
+    {
+        symbols = SymbolSet(j.get<std::vector<std::string>>());
+    }
+
+    static void to_json(nlohmann::json& j, const SymbolSet& symbols)
+    {
+        j = nlohmann::json::array();
+        for (const auto& symbol : symbols) j.push_back(symbol.str());
+    }
+
+    static void write_json(std::string& out, const Symbol& symbol)
+    {
+        Json::WriteString(out, symbol.str());
+    }
+
+    static void write_json(std::string& out, const SymbolSet& symbols)
+    {
+        bool first = true;
+
+        out.push_back('[');
+
+        for (const auto& symbol : symbols)
+        {
+            if (!first) out.push_back(',');
+            first = false;
+            Json::WriteString(out, symbol.str());
+        }
+
+        out.push_back(']');
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sysmemory_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        MemoryUsage,
+        bytes,
+        objects)
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, SysMemoryReq& req)
+    {
+    }
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SysMemoryRes,
+        heap_allocated,
+        heap_free,
+        resident,
+        subsystems)
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/sysstatus_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, SysStatusReq& req)
+    {
+    }
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        SysStatusRes,
+        draining,
+        drained,
+        ready,
+        torrents_failed,
+        torrents_loaded,
+        torrents_total)
+}
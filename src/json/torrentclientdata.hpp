@@ -2,6 +2,7 @@
 
 #include "../torrentclientdata.hpp"
 
+#include "symbol.hpp"
 #include "utils.hpp"
 
 namespace porla
@@ -9,6 +10,6 @@ namespace porla
 NLOHMANN_JSONIFY_ALL_THINGS(
     TorrentClientData,
     category,
-    metadata,
+    preset,
     tags);
 }
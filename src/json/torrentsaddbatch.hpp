@@ -0,0 +1,26 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "ltinfohash.hpp"
+#include "../methods/torrentsaddbatch_reqres.hpp"
+
+namespace porla::Methods
+{
+    static void to_json(nlohmann::json& j, const TorrentsAddBatchRes::Result& result)
+    {
+        if (result.info_hash.has_value())
+        {
+            j = {{"info_hash", *result.info_hash}};
+        }
+        else if (result.error.has_value())
+        {
+            j = {{"error", {{"code", result.error->code}, {"message", result.error->message}}}};
+        }
+    }
+
+    static void to_json(nlohmann::json& j, const TorrentsAddBatchRes& res)
+    {
+        j = {{"results", res.results}};
+    }
+}
@@ -12,6 +12,7 @@ namespace porla::Methods
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsAddReq,
         download_limit,
+        duplicate,
         http_seeds,
         magnet_uri,
         max_connections,
@@ -13,5 +13,7 @@ namespace porla::Methods
         j = {
             {"info_hash", res.info_hash}
         };
+
+        if (res.duplicate) j["duplicate"] = true;
     }
 }
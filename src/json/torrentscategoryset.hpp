@@ -0,0 +1,23 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentscategoryset_reqres.hpp"
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsCategorySetReq,
+        info_hash,
+        info_hashes,
+        query,
+        category)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsCategorySetRes,
+        matched,
+        changed,
+        failed)
+}
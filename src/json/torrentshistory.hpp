@@ -0,0 +1,34 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+#include "../methods/torrentshistory_reqres.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, TorrentsHistoryReq& req)
+    {
+        j.at("info_hash").get_to(req.info_hash);
+        porla::optional_from_json(j, "from", req.from);
+        porla::optional_from_json(j, "period", req.period);
+        porla::optional_from_json(j, "to", req.to);
+    }
+
+    // Buckets are written as [start, downloaded, uploaded] to keep long ranges small.
+    static void to_json(nlohmann::json& j, const TorrentsHistoryRes& res)
+    {
+        auto buckets = nlohmann::json::array();
+
+        for (const auto& bucket : res.buckets)
+        {
+            buckets.push_back({ bucket.start, bucket.downloaded, bucket.uploaded });
+        }
+
+        j = {
+            {"buckets", std::move(buckets)},
+            {"period", res.period}
+        };
+    }
+}
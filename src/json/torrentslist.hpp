@@ -4,6 +4,7 @@
 
 #include "lterrorcode.hpp"
 #include "ltinfohash.hpp"
+#include "symbol.hpp"
 #include "utils.hpp"
 #include "../methods/torrentslist_reqres.hpp"
 
@@ -11,21 +12,28 @@ namespace porla::Methods
 {
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsListReq,
+        cursor,
+        fields,
         filters,
         include_metadata,
         order_by,
         order_by_dir,
         page,
-        page_size);
+        page_size,
+        search,
+        since_revision);
 
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsListRes::Item,
+        added_time,
         all_time_download,
         all_time_upload,
         category,
         download_rate,
+        download_rate_avg,
         error,
         eta,
+        eta_avg,
         flags,
         info_hash,
         list_peers,
@@ -35,23 +43,29 @@ namespace porla::Methods
         name,
         num_peers,
         num_seeds,
+        parked,
         progress,
         queue_position,
         ratio,
+        relevance,
         save_path,
         size,
         state,
         tags,
         total,
         total_done,
-        upload_rate);
+        upload_rate,
+        upload_rate_avg);
 
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsListRes,
+        next_cursor,
         order_by,
         order_by_dir,
         page,
         page_size,
+        removed,
+        revision,
         torrents,
         torrents_total,
         torrents_total_unfiltered);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+#include "../methods/torrentsmatch_reqres.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMatchReq,
+        limit,
+        ti)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMatchRes::Match,
+        bytes,
+        complete,
+        files,
+        info_hash,
+        name,
+        same_size,
+        save_path)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMatchRes,
+        matches)
+}
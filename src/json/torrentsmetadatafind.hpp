@@ -0,0 +1,20 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentsmetadatafind_reqres.hpp"
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMetadataFindReq,
+        key,
+        value);
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMetadataFindRes,
+        info_hashes);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentsmetadataget_reqres.hpp"
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMetadataGetReq,
+        info_hash,
+        keys);
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMetadataGetRes,
+        metadata);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentsmetadataset_reqres.hpp"
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsMetadataSetReq,
+        info_hash,
+        metadata);
+
+    static void to_json(nlohmann::json& j, const TorrentsMetadataSetRes& res)
+    {
+        j = {};
+    }
+}
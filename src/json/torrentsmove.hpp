@@ -12,7 +12,10 @@ namespace porla::Methods
         TorrentsMoveReq,
         flags,
         info_hash,
-        path)
+        info_hashes,
+        path,
+        priority,
+        query)
 
     static void to_json(json& j, const TorrentsMoveRes& res)
     {
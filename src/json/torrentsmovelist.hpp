@@ -0,0 +1,36 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentsmovelist_reqres.hpp"
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla
+{
+    static void to_json(nlohmann::json& j, const MoveQueue::Move& move)
+    {
+        j = {
+            {"info_hash", move.info_hash},
+            {"path", move.path},
+            {"position", move.position.has_value() ? nlohmann::json(*move.position) : nlohmann::json()},
+            {"priority", move.priority},
+            {"queued_at", move.queued_at},
+            {"started_at", move.started_at.has_value() ? nlohmann::json(*move.started_at) : nlohmann::json()},
+            {"state", MoveQueue::Name(move.state)}
+        };
+    }
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, TorrentsMoveListReq& req)
+    {
+    }
+
+    static void to_json(nlohmann::json& j, const TorrentsMoveListRes& res)
+    {
+        j = {{"moves", res.moves}};
+    }
+}
@@ -3,19 +3,26 @@
 #include <nlohmann/json.hpp>
 
 #include "ltinfohash.hpp"
+#include "utils.hpp"
 #include "../methods/torrentspeerslist_reqres.hpp"
 
 namespace porla::Methods
 {
-    static void from_json(const json& j, porla::Methods::TorrentsPeersListReq& req)
-    {
-        j.at("info_hash").get_to(req.info_hash);
-    }
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsPeersListReq,
+        fields,
+        info_hash,
+        order_by,
+        order_by_dir,
+        page,
+        page_size);
 
-    static void to_json(json& j, const porla::Methods::TorrentsPeersListRes& res)
-    {
-        j = json{
-            {"peers", res.peers}
-        };
-    }
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsPeersListRes,
+        order_by,
+        order_by_dir,
+        page,
+        page_size,
+        peers,
+        peers_total);
 }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+#include "../methods/torrentspieces_reqres.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsPiecesReq,
+        bins,
+        info_hash,
+        max_runs);
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsPiecesRes,
+        availability,
+        bin_size,
+        downloading,
+        downloading_bins,
+        have,
+        have_bins,
+        num_pieces,
+        piece_length);
+}
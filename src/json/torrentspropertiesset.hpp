@@ -14,6 +14,8 @@ namespace porla::Methods
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsPropertiesSetReq,
         info_hash,
+        info_hashes,
+        query,
         download_limit,
         max_connections,
         max_uploads,
@@ -10,7 +10,10 @@ namespace porla::Methods
 {
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsRecheckReq,
-        info_hash)
+        info_hash,
+        info_hashes,
+        priority,
+        query)
 
     static void to_json(json& j, const TorrentsRecheckRes& res)
     {
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentsrechecklist_reqres.hpp"
+
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla
+{
+    static void to_json(nlohmann::json& j, const RecheckQueue::Recheck& recheck)
+    {
+        j = {
+            {"info_hash", recheck.info_hash},
+            {"position", recheck.position.has_value() ? nlohmann::json(*recheck.position) : nlohmann::json()},
+            {"priority", recheck.priority},
+            {"progress", recheck.progress.has_value() ? nlohmann::json(*recheck.progress) : nlohmann::json()},
+            {"queued_at", recheck.queued_at},
+            {"started_at", recheck.started_at.has_value() ? nlohmann::json(*recheck.started_at) : nlohmann::json()},
+            {"state", RecheckQueue::Name(recheck.state)}
+        };
+    }
+}
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, TorrentsRecheckListReq& req)
+    {
+    }
+
+    static void to_json(nlohmann::json& j, const TorrentsRecheckListRes& res)
+    {
+        j = {{"rechecks", res.rechecks}};
+    }
+}
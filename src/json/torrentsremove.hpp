@@ -2,6 +2,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "ltinfohash.hpp"
+#include "utils.hpp"
 #include "../methods/torrentsremovereq.hpp"
 #include "../methods/torrentsremoveres.hpp"
 
@@ -12,6 +14,7 @@ namespace porla::Methods
     NLOHMANN_JSONIFY_ALL_THINGS(
         TorrentsRemoveReq,
         info_hashes,
+        query,
         remove_data)
 
     static void to_json(json& j, const porla::Methods::TorrentsRemoveRes& res)
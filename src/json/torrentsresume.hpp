@@ -4,13 +4,16 @@
 #include <nlohmann/json.hpp>
 
 #include "ltinfohash.hpp"
+#include "utils.hpp"
 #include "../methods/torrentsresume_reqres.hpp"
 
 namespace porla::Methods
 {
     static void from_json(const nlohmann::json& j, TorrentsResumeReq& req)
     {
-        j.at("info_hash").get_to(req.info_hash);
+        porla::optional_from_json(j, "info_hash", req.info_hash);
+        porla::optional_from_json(j, "info_hashes", req.info_hashes);
+        porla::optional_from_json(j, "query", req.query);
     }
 
     static void to_json(nlohmann::json& j, const TorrentsResumeRes& res)
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "utils.hpp"
+#include "../methods/torrentsstats_reqres.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsStatsReq,
+        group_by,
+        percentiles,
+        query)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsStatsRes::Metric,
+        max,
+        min,
+        percentiles,
+        sum)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsStatsRes::Group,
+        count,
+        metrics)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsStatsRes,
+        groups,
+        total)
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentstagsupdate_reqres.hpp"
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsTagsUpdateReq,
+        info_hash,
+        info_hashes,
+        query,
+        add,
+        remove)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsTagsUpdateRes,
+        matched,
+        changed,
+        failed)
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/torrentstop_reqres.hpp"
+#include "ltinfohash.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsTopReq,
+        resource,
+        limit)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsTopRes::Item,
+        info_hash,
+        name,
+        value,
+        error)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TorrentsTopRes,
+        resource,
+        window,
+        torrents)
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include "../methods/trackerslist_reqres.hpp"
+#include "utils.hpp"
+
+namespace porla::Methods
+{
+    static void from_json(const nlohmann::json& j, TrackersListReq& req)
+    {
+    }
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TrackersListRes::Item,
+        announces,
+        errors,
+        failures,
+        host,
+        last_error,
+        last_failure,
+        last_reply,
+        latency_p50,
+        latency_p95,
+        replies,
+        success_rate)
+
+    NLOHMANN_JSONIFY_ALL_THINGS(
+        TrackersListRes,
+        trackers)
+}
@@ -2,6 +2,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "writer.hpp"
+
 namespace porla
 {
     template<class J, class T>
@@ -49,12 +51,22 @@ namespace porla
 
 #define EXTEND_JSON_TO(v1) extended_to_json(#v1, nlohmann_json_j, nlohmann_json_t.v1);
 #define EXTEND_JSON_FROM(v1) extended_from_json(#v1, nlohmann_json_j, nlohmann_json_t.v1);
+#define EXTEND_JSON_WRITE(v1) porla::Json::WriteMember(porla_json_out, porla_json_first, "\"" #v1 "\":", nlohmann_json_t.v1);
 
+// Besides to_json and from_json, declares a write_json which appends the same object
+// straight to a buffer, with the keys quoted at compile time, for responses too large to
+// build as a document first.
 #define NLOHMANN_JSONIFY_ALL_THINGS(Type, ...)                                          \
   inline void to_json(nlohmann::json &nlohmann_json_j, const Type &nlohmann_json_t) {   \
       NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(EXTEND_JSON_TO, __VA_ARGS__))            \
   }                                                                                     \
   inline void from_json(const nlohmann::json &nlohmann_json_j, Type &nlohmann_json_t) { \
       NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(EXTEND_JSON_FROM, __VA_ARGS__))          \
+  }                                                                                     \
+  inline void write_json(std::string &porla_json_out, const Type &nlohmann_json_t) {    \
+      bool porla_json_first = true;                                                     \
+      porla_json_out.push_back('{');                                                    \
+      NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(EXTEND_JSON_WRITE, __VA_ARGS__))         \
+      porla::Json::EndObject(porla_json_out, porla_json_first);                         \
   }
 }
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace porla::Json
+{
+    namespace Detail
+    {
+        template<typename>
+        constexpr bool IsOptional = false;
+        template<typename T>
+        constexpr bool IsOptional<std::optional<T>> = true;
+
+        template<typename>
+        constexpr bool IsVector = false;
+        template<typename T, typename A>
+        constexpr bool IsVector<std::vector<T, A>> = true;
+
+        template<typename>
+        constexpr bool IsPair = false;
+        template<typename T, typename U>
+        constexpr bool IsPair<std::pair<T, U>> = true;
+    }
+
+    // Types with a write_json found by argument dependent lookup, as the ones declared
+    // with NLOHMANN_JSONIFY_ALL_THINGS.
+    template<typename T>
+    concept HasWriter = requires(std::string& out, const T& value) { write_json(out, value); };
+
+    inline void WriteString(std::string& out, std::string_view str)
+    {
+        static constexpr char Hex[] = "0123456789abcdef";
+
+        out.push_back('"');
+
+        // Runs with nothing to escape are appended whole.
+        std::size_t run = 0;
+
+        for (std::size_t i = 0; i < str.size(); i++)
+        {
+            const auto c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            out.append(str.data() + run, i - run);
+            run = i + 1;
+
+            switch (c)
+            {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                out.append("\\u00");
+                out.push_back(Hex[c >> 4]);
+                out.push_back(Hex[c & 0xf]);
+                break;
+            }
+        }
+
+        out.append(str.data() + run, str.size() - run);
+        out.push_back('"');
+    }
+
+    // Writes bytes as a quoted lowercase hex string, as hashes are.
+    inline void WriteHex(std::string& out, std::string_view bytes)
+    {
+        static constexpr char Hex[] = "0123456789abcdef";
+
+        out.push_back('"');
+
+        for (const auto c : bytes)
+        {
+            const auto b = static_cast<unsigned char>(c);
+            out.push_back(Hex[b >> 4]);
+            out.push_back(Hex[b & 0xf]);
+        }
+
+        out.push_back('"');
+    }
+
+    inline void WriteFloat(std::string& out, double value)
+    {
+        if (!std::isfinite(value))
+        {
+            out.append("null");
+            return;
+        }
+
+        // The same digits nlohmann writes, including the ".0" on integral values.
+        char buffer[64];
+        char* end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, end);
+
+        if (std::none_of(buffer, end, [](char c) { return c == '.' || c == 'e'; }))
+        {
+            out.append(".0");
+        }
+    }
+
+    // Appends a value as JSON without building a nlohmann::json for it. Types this does
+    // not know are converted through nlohmann::json, so the output is the same as dumping
+    // the value, except that object members come in the order they are listed, which the
+    // field lists keep alphabetical as nlohmann sorts them.
+    template<typename T>
+    void Write(std::string& out, const T& value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            out.append(value ? "true" : "false");
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            char buffer[24];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            WriteFloat(out, static_cast<double>(value));
+        }
+        // Before strings, which a json implicitly converts to.
+        else if constexpr (std::is_same_v<T, nlohmann::json>)
+        {
+            nlohmann::detail::serializer<nlohmann::json> serializer(
+                nlohmann::detail::output_adapter<char>(out), ' ');
+            serializer.dump(value, false, false, 0);
+        }
+        else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+        {
+            WriteString(out, value);
+        }
+        else if constexpr (Detail::IsOptional<T>)
+        {
+            if (value) Write(out, *value);
+            else       out.append("null");
+        }
+        else if constexpr (Detail::IsVector<T>)
+        {
+            out.push_back('[');
+
+            for (std::size_t i = 0; i < value.size(); i++)
+            {
+                if (i > 0) out.push_back(',');
+                Write(out, value[i]);
+            }
+
+            out.push_back(']');
+        }
+        else if constexpr (Detail::IsPair<T>)
+        {
+            out.push_back('[');
+            Write(out, value.first);
+            out.push_back(',');
+            Write(out, value.second);
+            out.push_back(']');
+        }
+        else if constexpr (HasWriter<T>)
+        {
+            write_json(out, value);
+        }
+        else
+        {
+            Write(out, nlohmann::json(value));
+        }
+    }
+
+    // Appends one object member. Key is the quoted name and colon, escaped ahead of time.
+    // Empty optionals are left out, as optional_to_json does.
+    template<typename T>
+    void WriteMember(std::string& out, bool& first, std::string_view key, const T& value)
+    {
+        if constexpr (Detail::IsOptional<T>)
+        {
+            if (!value) return;
+        }
+
+        if (!first) out.push_back(',');
+        first = false;
+
+        out.append(key);
+        Write(out, value);
+    }
+
+    // Closes an object opened with '{'. One with no members written is null instead, as
+    // to_json leaves it.
+    inline void EndObject(std::string& out, bool first)
+    {
+        if (first) out.replace(out.size() - 1, 1, "null");
+        else       out.push_back('}');
+    }
+}
@@ -1,25 +1,295 @@
 #include "jsonrpchandler.hpp"
 
+#include <chrono>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include <boost/log/trivial.hpp>
 
+#include "tracing.hpp"
+#include "utils/encoding.hpp"
+
 using json = nlohmann::json;
+using porla::AdmissionController;
+using porla::AdmissionPriority;
 using porla::JsonRpcHandler;
+using porla::ScopedSpan;
+using porla::TraceScope;
+using porla::TraceSpan;
+using porla::Utils::Encoding;
+
+JsonRpcHandler::JsonRpcHandler(std::map<std::string, Handler> methods, JsonRpcHandlerOptions options)
+    : m_options(std::move(options))
+    , m_results(128)
+{
+    // Coalescing and priorities are resolved here, so a request does one lookup for all of it.
+    for (auto& [name, handler] : methods)
+    {
+        auto& entry = m_methods.try_emplace(name).first->second;
+        entry.handler  = std::move(handler);
+        entry.coalesce = m_options.coalesce.contains(name);
+
+        if (const auto priority = m_options.priorities.find(name); priority != m_options.priorities.end())
+        {
+            entry.priority = priority->second;
+        }
+    }
+}
+
+std::map<std::string, porla::JsonRpcMethodStats> JsonRpcHandler::Stats() const
+{
+    std::map<std::string, JsonRpcMethodStats> stats;
+
+    for (const auto& [name, entry] : m_methods)
+    {
+        std::unique_lock lock(entry.meter.mtx);
+        stats.insert({ name, entry.meter.stats });
+    }
 
-JsonRpcHandler::JsonRpcHandler(
-    std::map<std::string, std::function<void(const nlohmann::json&, const nlohmann::json&, std::shared_ptr<porla::HttpContext>)>> methods)
-    : m_methods(std::move(methods))
+    return stats;
+}
+
+// Admission limits apply per remote address, and to the Unix socket as a whole.
+static std::string ClientOf(porla::HttpContext& ctx)
 {
+    if (ctx.Local())
+    {
+        return "local";
+    }
+
+    boost::system::error_code ec;
+    const auto endpoint = ctx.Stream().socket().remote_endpoint(ec);
+
+    return ec ? "unknown" : endpoint.address().to_string();
 }
 
+// Batch requests are dispatched one at a time, each with a context that collects its
+// response instead of writing it, and the collected responses are written as one array.
+struct JsonRpcHandler::Batch
+{
+    std::shared_ptr<porla::HttpContext> ctx;
+    std::vector<json> requests;
+    std::vector<json> responses;
+    std::size_t completed = 0;
+    std::size_t dispatched = 0;
+    bool running = false;
+    bool written = false;
+};
+
+// The requests waiting on a coalesced invocation, with the id each should be answered with.
+struct JsonRpcHandler::Flight
+{
+    std::vector<std::pair<json, std::shared_ptr<porla::HttpContext>>> waiters;
+};
+
+// Hands the response to a callback instead of writing it, for batches and coalesced
+// requests. Everything else is forwarded to the request's own context.
+class JsonRpcHandler::CollectContext : public porla::HttpContext
+{
+public:
+    CollectContext(std::shared_ptr<porla::HttpContext> ctx, std::function<void(json)> done)
+        : m_ctx(std::move(ctx))
+        , m_done(std::move(done))
+    {
+    }
+
+    void Next() override { m_ctx->Next(); }
+
+    boost::beast::http::request<boost::beast::http::string_body>& Request() override { return m_ctx->Request(); }
+    Uri& RequestUri() override { return m_ctx->RequestUri(); }
+    boost::beast::tcp_stream& Stream() override { return m_ctx->Stream(); }
+    std::shared_ptr<porla::TraceSpan> Trace() override { return m_ctx->Trace(); }
+    bool Local() override { return m_ctx->Local(); }
+
+    void Write(std::string body) override { Complete(body); }
+    void Write(boost::beast::http::response<boost::beast::http::file_body> res) override { Complete(nullptr); }
+    void Write(boost::beast::http::response<boost::beast::http::string_body> res) override { Complete(res.body()); }
+    void WriteJson(const nlohmann::json& j) override { Complete(j); }
+
+    // Streamed results are collected in full, since they are written as part of another
+    // document or more than once.
+    void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) override
+    {
+        std::string body;
+        while (next(body)) {}
+
+        Complete(json::parse(body, nullptr, false));
+    }
+
+private:
+    void Complete(json response)
+    {
+        if (!m_done) { return; }
+
+        auto done = std::move(m_done);
+        m_done = nullptr;
+
+        done(std::move(response));
+    }
+
+    std::shared_ptr<porla::HttpContext> m_ctx;
+    std::function<void(json)> m_done;
+};
+
+// Records the latency and size of the response written by a single request. Writes are
+// forwarded as is, apart from JSON which is encoded here so its size is known. Requests in
+// a batch are part of a larger body, so only their latency is recorded. The method's span,
+// if the request is traced, ends at the same time.
+class JsonRpcHandler::MeteredContext : public porla::HttpContext
+{
+public:
+    MeteredContext(std::shared_ptr<porla::HttpContext> ctx, Meter& meter, bool batched, std::shared_ptr<porla::TraceSpan> span)
+        : m_ctx(std::move(ctx))
+        , m_meter(meter)
+        , m_batched(batched)
+        , m_start(std::chrono::steady_clock::now())
+        , m_span(std::move(span))
+    {
+    }
+
+    void Next() override { m_ctx->Next(); }
+
+    boost::beast::http::request<boost::beast::http::string_body>& Request() override { return m_ctx->Request(); }
+    Uri& RequestUri() override { return m_ctx->RequestUri(); }
+    boost::beast::tcp_stream& Stream() override { return m_ctx->Stream(); }
+    std::shared_ptr<porla::TraceSpan> Trace() override { return m_span; }
+    bool Local() override { return m_ctx->Local(); }
+
+    // Keeps the admission slot until the response is written.
+    void Hold(std::shared_ptr<AdmissionController::Slot> slot) { m_slot = std::move(slot); }
+
+    void Write(std::string body) override
+    {
+        Record(body.size(), false);
+        m_ctx->Write(std::move(body));
+    }
+
+    void Write(boost::beast::http::response<boost::beast::http::file_body> res) override
+    {
+        Record(res.body().size(), false);
+        m_ctx->Write(std::move(res));
+    }
+
+    void Write(boost::beast::http::response<boost::beast::http::string_body> res) override
+    {
+        Record(res.body().size(), false);
+        m_ctx->Write(std::move(res));
+    }
+
+    void WriteFile(
+        boost::beast::http::response<boost::beast::http::empty_body> res,
+        boost::beast::file file,
+        std::uint64_t offset,
+        std::uint64_t length,
+        FileAvailability available) override
+    {
+        Record(static_cast<std::size_t>(length), false);
+        m_ctx->WriteFile(std::move(res), std::move(file), offset, length, std::move(available));
+    }
+
+    void WriteJson(const nlohmann::json& j) override
+    {
+        const bool error = j.is_object() && j.contains("error");
+
+        if (m_batched)
+        {
+            Record(std::nullopt, error);
+            return m_ctx->WriteJson(j);
+        }
+
+        auto res = JsonResponse(m_ctx->Request(), j);
+
+        Record(res.body().size(), error);
+        m_ctx->Write(std::move(res));
+    }
+
+    // The latency is taken when the stream starts, and the size once the last chunk is out.
+    // Chunks are produced on the connection's executor, so the admission slot is let go
+    // here, on the io thread.
+    void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) override
+    {
+        const auto latency = Elapsed();
+        m_slot.reset();
+        auto written = std::make_shared<std::size_t>(0);
+
+        m_ctx->WriteChunked(
+            content_type,
+            [meter = &m_meter, batched = m_batched, latency, written, span = m_span, next = std::move(next)](std::string& chunk)
+            {
+                const auto before = chunk.size();
+                const bool more = next(chunk);
+
+                *written += chunk.size() - before;
+
+                if (!more)
+                {
+                    if (span) { span->End(); }
+
+                    std::unique_lock lock(meter->mtx);
+                    Observe(meter->stats, latency, batched ? std::nullopt : std::optional(*written), false);
+                }
+
+                return more;
+            });
+    }
+
+private:
+    static void Observe(JsonRpcMethodStats& stats, double latency, std::optional<std::size_t> size, bool error)
+    {
+        stats.requests++;
+        if (error) { stats.errors++; }
+        stats.latency.Observe(latency);
+        if (size.has_value()) { stats.size.Observe(static_cast<double>(*size)); }
+    }
+
+    [[nodiscard]] double Elapsed() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    void Record(std::optional<std::size_t> size, bool error)
+    {
+        if (m_span)
+        {
+            if (error) { m_span->SetAttribute("rpc.error", "true"); }
+            m_span->End();
+        }
+
+        m_slot.reset();
+
+        std::unique_lock lock(m_meter.mtx);
+        Observe(m_meter.stats, Elapsed(), size, error);
+    }
+
+    std::shared_ptr<porla::HttpContext> m_ctx;
+    Meter& m_meter;
+    bool m_batched;
+    std::chrono::steady_clock::time_point m_start;
+    std::shared_ptr<porla::TraceSpan> m_span;
+    std::shared_ptr<AdmissionController::Slot> m_slot;
+};
+
 void JsonRpcHandler::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
 {
     json req = {};
 
     try
     {
-        req = json::parse(ctx->Request().body());
+        ScopedSpan span(ctx->Trace(), "rpc.parse");
+
+        // Requests may be sent as MessagePack or CBOR too, the response encoding is picked
+        // separately from the Accept header.
+        const auto content_type = ctx->Request().find(boost::beast::http::field::content_type);
+
+        req = Encoding::Parse(
+            ctx->Request().body(),
+            content_type != ctx->Request().end()
+                ? Encoding::FromMediaType({content_type->value().data(), content_type->value().size()})
+                : Encoding::Type::Json);
+
+        // Bodies can be up to the 10MB limit, so let go of it now that it is parsed.
+        std::string().swap(ctx->Request().body());
     }
     catch (const std::exception& ex)
     {
@@ -34,6 +304,48 @@ void JsonRpcHandler::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
         });
     }
 
+    (*this)(std::move(req), ctx);
+}
+
+void JsonRpcHandler::operator()(json req, const std::shared_ptr<porla::HttpContext>& ctx)
+{
+    if (req.is_array())
+    {
+        if (req.empty())
+        {
+            return ctx->WriteJson({
+                {"error", {
+                    {"code", -32600},
+                    {"message", "Invalid Request"},
+                    {"data", "Batch is empty"}
+                }}
+            });
+        }
+
+        auto batch = std::make_shared<Batch>();
+        batch->ctx = ctx;
+        batch->requests = std::move(req.get_ref<json::array_t&>());
+        batch->responses.resize(batch->requests.size());
+
+        return RunBatch(batch);
+    }
+
+    Dispatch(std::move(req), ctx);
+}
+
+void JsonRpcHandler::Dispatch(json req, const std::shared_ptr<porla::HttpContext>& ctx, bool batched)
+{
+    if (!req.is_object())
+    {
+        return ctx->WriteJson({
+            {"error", {
+                {"code", -32600},
+                {"message", "Invalid Request"},
+                {"data", "Request is not an object"}
+            }}
+        });
+    }
+
     if (!req.contains("id")
         && !req["id"].is_string()
         && !req["id"].is_number()
@@ -48,11 +360,12 @@ void JsonRpcHandler::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
         });
     }
 
-    std::string method = req.at("method").get<std::string>();
+    const auto& method_name = req.at("method").get_ref<const std::string&>();
+    const auto method = m_methods.find(method_name);
 
-    if (m_methods.find(method) == m_methods.end())
+    if (method == m_methods.end())
     {
-        BOOST_LOG_TRIVIAL(warning) << "Failed to find JSONRPC method '" << method << "'";
+        BOOST_LOG_TRIVIAL(warning) << "Failed to find JSONRPC method '" << method_name << "'";
 
         return ctx->WriteJson({
             {"error", {
@@ -62,14 +375,138 @@ void JsonRpcHandler::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
         });
     }
 
+    // The name is the key of the entry from here on, so the request can be taken apart.
+    Call call{
+        .method = &method->first,
+        .entry  = &method->second,
+        .id     = std::move(req["id"]),
+        .params = req.contains("params") ? std::move(req["params"]) : json()
+    };
+
+    auto span = TraceSpan::Child(ctx->Trace(), *call.method);
+
+    if (span)
+    {
+        span->SetAttribute("rpc.system", "jsonrpc");
+        span->SetAttribute("rpc.method", *call.method);
+    }
+
+    const auto metered = std::make_shared<MeteredContext>(ctx, call.entry->meter, batched, std::move(span));
+
+    if (m_options.admission == nullptr)
+    {
+        return Run(std::move(call), metered);
+    }
+
+    const auto priority = call.entry->priority;
+
+    // The admission callback is a std::function, which has to be copyable, so the call
+    // is kept behind a pointer for it.
+    m_options.admission->Submit(
+        ClientOf(*ctx),
+        priority,
+        [this, call = std::make_shared<Call>(std::move(call)), metered](std::shared_ptr<AdmissionController::Slot> slot)
+        {
+            metered->Hold(std::move(slot));
+            Run(std::move(*call), metered);
+        },
+        [metered](AdmissionController::Rejection rejection)
+        {
+            // Nothing ran, so the request is always safe to send again.
+            metered->WriteJson({
+                {"error", {
+                    {"code", -32000},
+                    {"message", rejection == AdmissionController::Rejection::Timeout
+                        ? "Server busy - timed out waiting to run"
+                        : "Server busy - too many queued requests"},
+                    {"data", {
+                        {"retryable", true},
+                        {"retry_after", 1}
+                    }}
+                }}
+            });
+        });
+}
+
+void JsonRpcHandler::Run(Call call, const std::shared_ptr<porla::HttpContext>& ctx)
+{
+    if (call.entry->coalesce)
+    {
+        return Coalesce(std::move(call), ctx);
+    }
+
+    Invoke(std::move(call), ctx);
+}
+
+void JsonRpcHandler::Coalesce(Call call, const std::shared_ptr<porla::HttpContext>& ctx)
+{
+    // Object keys are kept sorted, so the same params always dump to the same key.
+    const std::string key = *call.method + "\n" + (call.params.is_null() ? "" : call.params.dump());
+    const auto generation = m_options.generation ? m_options.generation() : 0;
+    const auto now = std::chrono::steady_clock::now();
+
+    if (const auto result = m_results.Get(key))
+    {
+        if ((*result)->generation == generation && (*result)->expires > now)
+        {
+            json response = (*result)->response;
+            response["id"] = std::move(call.id);
+
+            return ctx->WriteJson(response);
+        }
+    }
+
+    if (const auto flight = m_flights.find(key); flight != m_flights.end())
+    {
+        BOOST_LOG_TRIVIAL(debug) << "Coalescing JSONRPC method '" << *call.method << "' with a pending request";
+        flight->second->waiters.emplace_back(std::move(call.id), ctx);
+        return;
+    }
+
+    auto flight = std::make_shared<Flight>();
+    flight->waiters.emplace_back(call.id, ctx);
+
+    m_flights.insert({ key, flight });
+
+    Invoke(
+        std::move(call),
+        std::make_shared<CollectContext>(
+            ctx,
+            [this, key, generation, flight](json response)
+            {
+                m_flights.erase(key);
+
+                // Errors are not reused, the next request tries again.
+                if (response.contains("result") && m_options.coalesce_ttl.count() > 0)
+                {
+                    m_results.Put(key, std::make_shared<const Result>(Result{
+                        .response   = response,
+                        .generation = generation,
+                        .expires    = std::chrono::steady_clock::now() + m_options.coalesce_ttl
+                    }));
+                }
+
+                for (auto& [id, waiter] : flight->waiters)
+                {
+                    response["id"] = id;
+                    waiter->WriteJson(response);
+                }
+            }));
+}
+
+void JsonRpcHandler::Invoke(Call call, const std::shared_ptr<porla::HttpContext>& ctx)
+{
     try
     {
-        BOOST_LOG_TRIVIAL(debug) << "Executing JSONRPC method '" << method << "'";
-        m_methods.at(method)(req.at("id"), req.at("params"), ctx);
+        BOOST_LOG_TRIVIAL(debug) << "Executing JSONRPC method '" << *call.method << "'";
+
+        // Database calls made while the method runs are added to its span.
+        TraceScope scope(ctx->Trace());
+        call.entry->handler(std::move(call.id), std::move(call.params), ctx);
     }
     catch (const std::exception& ex)
     {
-        BOOST_LOG_TRIVIAL(error) << "Error when executing JSONRPC method '" << method << "': " << ex.what();
+        BOOST_LOG_TRIVIAL(error) << "Error when executing JSONRPC method '" << *call.method << "': " << ex.what();
 
         ctx->WriteJson({
             {"error", {
@@ -80,3 +517,61 @@ void JsonRpcHandler::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
         });
     }
 }
+
+void JsonRpcHandler::RunBatch(const std::shared_ptr<Batch>& batch)
+{
+    // Synchronous responses complete while dispatching, which would otherwise recurse
+    // once per request. The outermost call keeps the loop going instead.
+    if (batch->running)
+    {
+        return;
+    }
+
+    batch->running = true;
+
+    // Requests run in order, and each one only after the previous has responded.
+    while (batch->dispatched < batch->requests.size() && batch->completed == batch->dispatched)
+    {
+        const auto index = batch->dispatched++;
+
+        try
+        {
+            Dispatch(
+                std::move(batch->requests[index]),
+                std::make_shared<CollectContext>(
+                    batch->ctx,
+                    [this, batch, index](json response)
+                    {
+                        batch->responses[index] = std::move(response);
+                        batch->completed++;
+
+                        RunBatch(batch);
+                    }),
+                true);
+        }
+        catch (const std::exception& ex)
+        {
+            // A malformed request fails on its own without failing the rest of the batch.
+            if (batch->completed == index)
+            {
+                batch->responses[index] = {
+                    {"error", {
+                        {"code", -32600},
+                        {"message", "Invalid Request"},
+                        {"data", ex.what()}
+                    }}
+                };
+
+                batch->completed++;
+            }
+        }
+    }
+
+    batch->running = false;
+
+    if (batch->completed == batch->requests.size() && !batch->written)
+    {
+        batch->written = true;
+        batch->ctx->WriteJson(std::move(batch->responses));
+    }
+}
@@ -1,19 +1,55 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
 
 #include <nlohmann/json.hpp>
 
+#include "admissioncontroller.hpp"
 #include "httpcontext.hpp"
+#include "utils/histogram.hpp"
+#include "utils/lrucache.hpp"
 
 namespace porla
 {
+    struct JsonRpcHandlerOptions
+    {
+        // Read-only methods where concurrent requests with the same params share a single
+        // invocation, and its result is reused for a short while.
+        std::set<std::string>          coalesce;
+        std::chrono::milliseconds      coalesce_ttl{0};
+        // Results are only reused while this returns the value it had when they were made.
+        std::function<std::uint64_t()> generation;
+        // Requests wait for a slot from it when set, at the priority of their method, and
+        // methods not listed are reads.
+        AdmissionController*                     admission = nullptr;
+        std::map<std::string, AdmissionPriority> priorities;
+    };
+
+    struct JsonRpcMethodStats
+    {
+        std::uint64_t    errors = 0;
+        std::uint64_t    requests = 0;
+        // Seconds until the response is handed to the HTTP layer.
+        Utils::Histogram latency{{0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10}};
+        // Bytes in the encoded response body.
+        Utils::Histogram size{{256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304, 16777216}};
+    };
+
     class JsonRpcHandler
     {
     public:
-        explicit JsonRpcHandler(
-            std::map<std::string, std::function<void(const nlohmann::json&, const nlohmann::json&, std::shared_ptr<porla::HttpContext>)>> methods);
+        // Called with the id and params of the request, both moved out of it.
+        typedef std::function<void(nlohmann::json&&, nlohmann::json&&, std::shared_ptr<porla::HttpContext>)> Handler;
+
+        explicit JsonRpcHandler(std::map<std::string, Handler> methods, JsonRpcHandlerOptions options = {});
 
         JsonRpcHandler(const JsonRpcHandler&) = delete;
         JsonRpcHandler& operator=(const JsonRpcHandler&) = delete;
@@ -21,7 +57,62 @@ namespace porla
 
         void operator()(const std::shared_ptr<porla::HttpContext>& ctx);
 
+        // Handles a request or batch that is already parsed, for transports that read the
+        // messages themselves.
+        void operator()(nlohmann::json req, const std::shared_ptr<porla::HttpContext>& ctx);
+
+        // A copy of the counters for every method, safe to call from any thread.
+        [[nodiscard]] std::map<std::string, JsonRpcMethodStats> Stats() const;
+
     private:
-        std::map<std::string, std::function<void(const nlohmann::json&, const nlohmann::json&, std::shared_ptr<porla::HttpContext>)>> m_methods;
+        class CollectContext;
+        class MeteredContext;
+        struct Batch;
+        struct Flight;
+
+        // Responses may be written from the HTTP threads, so the counters are locked.
+        struct Meter
+        {
+            mutable std::mutex mtx;
+            JsonRpcMethodStats stats;
+        };
+
+        // Everything the handler knows about a method, looked up once per request.
+        struct Entry
+        {
+            Handler           handler;
+            Meter             meter;
+            bool              coalesce = false;
+            AdmissionPriority priority = AdmissionPriority::Read;
+        };
+
+        // A request taken apart once, and moved from one step of dispatching to the next.
+        struct Call
+        {
+            const std::string* method;
+            Entry*             entry;
+            nlohmann::json     id;
+            nlohmann::json     params;
+        };
+
+        struct Result
+        {
+            nlohmann::json                        response;
+            std::uint64_t                         generation;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        // Dispatches a single request object, writing errors to the context.
+        void Dispatch(nlohmann::json req, const std::shared_ptr<porla::HttpContext>& ctx, bool batched = false);
+        void Run(Call call, const std::shared_ptr<porla::HttpContext>& ctx);
+        void Coalesce(Call call, const std::shared_ptr<porla::HttpContext>& ctx);
+        void Invoke(Call call, const std::shared_ptr<porla::HttpContext>& ctx);
+        void RunBatch(const std::shared_ptr<Batch>& batch);
+
+        // Nodes never move, so entries are safe to point to for as long as the handler is.
+        std::unordered_map<std::string, Entry> m_methods;
+        JsonRpcHandlerOptions m_options;
+        std::map<std::string, std::shared_ptr<Flight>> m_flights;
+        Utils::LruCache<std::string, std::shared_ptr<const Result>> m_results;
     };
 }
@@ -1,24 +1,228 @@
 #include "logger.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/log/attributes/current_thread_id.hpp>
 #include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/log/utility/setup/common_attributes.hpp>
+#include <boost/smart_ptr/make_shared_object.hpp>
+#include <nlohmann/json.hpp>
+
+namespace logging = boost::log;
+namespace sinks = boost::log::sinks;
 
 using porla::Logger;
 
+namespace
+{
+    // Records which did not fit in the queue, reported with the next one written.
+    std::atomic<std::uint64_t> dropped{0};
+
+    struct CountDropped
+    {
+        template<typename LockT>
+        static bool on_overflow(const logging::record_view&, LockT&)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        static void on_queue_space_available() {}
+        static void interrupt() {}
+    };
+
+    class Backend : public sinks::basic_sink_backend<sinks::combine_requirements<sinks::synchronized_feeding, sinks::flushing>::type>
+    {
+    public:
+        explicit Backend(bool json, std::chrono::seconds repeat_window)
+            : m_json(json)
+            , m_window(repeat_window)
+        {
+        }
+
+        void consume(const logging::record_view& rec)
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            auto const message  = rec[logging::expressions::smessage];
+            auto const severity = rec[logging::trivial::severity];
+            auto const time     = logging::extract<boost::posix_time::ptime>("TimeStamp", rec);
+            auto const thread   = logging::extract<logging::attributes::current_thread_id::value_type>("ThreadID", rec);
+
+            const std::string text = message ? message.get() : std::string();
+            const auto level = severity ? severity.get() : logging::trivial::info;
+
+            if (const auto lost = dropped.exchange(0, std::memory_order_relaxed); lost > 0)
+            {
+                Write(Now(), "", logging::trivial::warning, "Dropped " + std::to_string(lost) + " log message(s), the log queue was full");
+            }
+
+            if (m_window.count() > 0)
+            {
+                if (now - m_swept >= std::chrono::seconds(1))
+                {
+                    Sweep(now, false);
+                    m_swept = now;
+                }
+
+                if (const auto it = m_repeats.find(text); it != m_repeats.end())
+                {
+                    if (now - it->second.since < m_window)
+                    {
+                        it->second.count++;
+                        return;
+                    }
+
+                    Summarize(it->first, it->second);
+                    it->second = Repeat{ .since = now, .level = level };
+                }
+                else if (m_repeats.size() < MaxRepeats)
+                {
+                    m_repeats.insert({text, Repeat{ .since = now, .level = level }});
+                }
+            }
+
+            std::string thread_id;
+
+            if (thread)
+            {
+                std::ostringstream ss;
+                ss << thread.get();
+                thread_id = ss.str();
+            }
+
+            Write(time ? time.get() : Now(), thread_id, level, text);
+        }
+
+        void flush()
+        {
+            Sweep(std::chrono::steady_clock::now(), true);
+            std::clog.flush();
+        }
+
+    private:
+        // Messages tracked for repeats at once. Others are written every time.
+        static constexpr std::size_t MaxRepeats = 1024;
+
+        struct Repeat
+        {
+            std::chrono::steady_clock::time_point since;
+            logging::trivial::severity_level      level;
+            std::uint64_t                         count = 0;
+        };
+
+        static boost::posix_time::ptime Now()
+        {
+            return boost::posix_time::microsec_clock::local_time();
+        }
+
+        // Forgets messages whose window is over, writing the ones repeated in it.
+        void Sweep(std::chrono::steady_clock::time_point now, bool all)
+        {
+            for (auto it = m_repeats.begin(); it != m_repeats.end();)
+            {
+                if (!all && now - it->second.since < m_window)
+                {
+                    ++it;
+                    continue;
+                }
+
+                Summarize(it->first, it->second);
+                it = m_repeats.erase(it);
+            }
+        }
+
+        void Summarize(const std::string& text, const Repeat& repeat)
+        {
+            if (repeat.count == 0)
+            {
+                return;
+            }
+
+            Write(Now(), "", repeat.level, text + " (repeated " + std::to_string(repeat.count) + " more time(s))");
+        }
+
+        void Write(const boost::posix_time::ptime& time, const std::string& thread, logging::trivial::severity_level level, const std::string& text)
+        {
+            if (m_json)
+            {
+                std::clog << nlohmann::json({
+                    {"level", logging::trivial::to_string(level)},
+                    {"message", text},
+                    {"thread", thread},
+                    {"time", boost::posix_time::to_iso_extended_string(time)}
+                }).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+
+                return;
+            }
+
+            std::clog << "[" << boost::posix_time::to_iso_extended_string(time) << "] "
+                      << "[" << thread << "] "
+                      << "[" << logging::trivial::to_string(level) << "] "
+                      << text << '\n';
+        }
+
+        bool m_json;
+        std::chrono::seconds m_window;
+        std::map<std::string, Repeat> m_repeats;
+        std::chrono::steady_clock::time_point m_swept;
+    };
+
+    // Records waiting for the logging thread. Enough for a burst of one line per torrent.
+    constexpr std::size_t QueueSize = 16384;
+
+    typedef sinks::asynchronous_sink<Backend, sinks::bounded_fifo_queue<QueueSize, CountDropped>> Sink;
+
+    boost::shared_ptr<Sink> sink;
+}
+
 void Logger::Setup(const boost::program_options::variables_map& cmd) noexcept
 {
     std::string configured_level;
+    std::string configured_format = "text";
+    int repeat_window = 5;
 
     if (auto env_level = std::getenv("PORLA_LOG_LEVEL"))
     {
         configured_level = env_level;
     }
 
+    if (auto env_format = std::getenv("PORLA_LOG_FORMAT"))
+    {
+        configured_format = env_format;
+    }
+
+    if (auto env_window = std::getenv("PORLA_LOG_REPEAT_WINDOW"))
+    {
+        repeat_window = static_cast<int>(std::strtol(env_window, nullptr, 10));
+    }
+
     if (cmd.count("log-level"))
     {
         configured_level = cmd["log-level"].as<std::string>();
     }
 
+    if (cmd.count("log-format"))
+    {
+        configured_format = cmd["log-format"].as<std::string>();
+    }
+
+    if (cmd.count("log-repeat-window"))
+    {
+        repeat_window = cmd["log-repeat-window"].as<int>();
+    }
+
     boost::log::trivial::severity_level log_level = boost::log::trivial::info;
 
     if (configured_level == "trace")   { log_level = boost::log::trivial::severity_level::trace; }
@@ -28,5 +232,29 @@ void Logger::Setup(const boost::program_options::variables_map& cmd) noexcept
     if (configured_level == "error")   { log_level = boost::log::trivial::severity_level::error; }
     if (configured_level == "fatal")   { log_level = boost::log::trivial::severity_level::fatal; }
 
+    logging::add_common_attributes();
+
+    sink = boost::make_shared<Sink>(boost::make_shared<Backend>(
+        configured_format == "json",
+        std::chrono::seconds(std::max(0, repeat_window))));
+
+    // Adding a sink replaces the default one, which writes inline.
+    boost::log::core::get()->add_sink(sink);
     boost::log::core::get()->set_filter(boost::log::trivial::severity >= log_level);
+
+    std::atexit(&Logger::Shutdown);
+}
+
+void Logger::Shutdown() noexcept
+{
+    if (!sink)
+    {
+        return;
+    }
+
+    boost::log::core::get()->remove_sink(sink);
+
+    sink->stop();
+    sink->flush();
+    sink.reset();
 }
@@ -7,6 +7,13 @@ namespace porla
     class Logger
     {
     public:
+        // Logs through a bounded queue to a thread of its own, so the threads logging
+        // never wait on stderr. Records which do not fit in the queue are counted and
+        // dropped, and the same message logged again within the repeat window is counted
+        // instead, and written once with the count.
         static void Setup(const boost::program_options::variables_map& cmd) noexcept;
+
+        // Writes out what is still queued. Called at exit by Setup.
+        static void Shutdown() noexcept;
     };
-}
\ No newline at end of file
+}
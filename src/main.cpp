@@ -1,49 +1,148 @@
+#include <algorithm>
+#include <thread>
+
 #include <boost/asio.hpp>
 #include <boost/log/expressions.hpp>
 #include <boost/log/trivial.hpp>
 
+#include "admissioncontroller.hpp"
+#include "announcescheduler.hpp"
 #include "authinithandler.hpp"
 #include "authloginhandler.hpp"
+#include "changefeed.hpp"
+#include "clustercoordinator.hpp"
 #include "cmdargs.hpp"
 #include "config.hpp"
+#include "configreloader.hpp"
+#include "contentindex.hpp"
+#include "data/backup.hpp"
+#include "data/readerpool.hpp"
+#include "data/statesnapshot.hpp"
+#include "diskio.hpp"
+#include "diskspacemonitor.hpp"
 #include "embeddedwebuihandler.hpp"
+#include "feedsubscriptions.hpp"
+#include "httpclient.hpp"
 #include "httpeventstream.hpp"
 #include "httpjwtauth.hpp"
+#include "httprouter.hpp"
 #include "httpserver.hpp"
+#include "httpwebsocket.hpp"
 #include "jsonrpchandler.hpp"
 #include "logger.hpp"
+#include "memoryaccounting.hpp"
+#include "metadataqueue.hpp"
+#include "metadatastore.hpp"
 #include "metricshandler.hpp"
+#include "movequeue.hpp"
+#include "passwordhasher.hpp"
+#include "peeraggregates.hpp"
+#include "piecestreams.hpp"
+#include "profilehandler.hpp"
+#include "profiler.hpp"
+#include "readyhandler.hpp"
+#include "recheckqueue.hpp"
+#include "releaseboost.hpp"
+#include "responsecache.hpp"
+#include "savepathquotas.hpp"
+#include "seedinggoals.hpp"
+#include "seedscheduler.hpp"
+#include "settingstuner.hpp"
 #include "session.hpp"
+#include "sessionprofiles.hpp"
+#include "shardedsession.hpp"
+#include "simulatedsession.hpp"
+#include "statshistory.hpp"
+#include "statussnapshot.hpp"
 #include "systemhandler.hpp"
+#include "torrentaggregates.hpp"
+#include "torrentcosts.hpp"
+#include "torrentcounters.hpp"
+#include "torrentcolumns.hpp"
+#include "torrentsarchivehandler.hpp"
+#include "torrentsdownloadhandler.hpp"
+#include "torrentsexporthandler.hpp"
+#include "torrentsimporthandler.hpp"
+#include "torrentssnapshot.hpp"
+#include "torrenthistory.hpp"
+#include "torrentindex.hpp"
+#include "torrentinfocache.hpp"
+#include "torrentorders.hpp"
+#include "torrentrates.hpp"
+#include "torrentrevisions.hpp"
+#include "torrentstats.hpp"
+#include "torrentsuploadhandler.hpp"
+#include "torrentviews.hpp"
+#include "threadplacement.hpp"
+#include "tracing.hpp"
+#include "trackerregistry.hpp"
+#include "watchdirectories.hpp"
 #include "tools/authtoken.hpp"
+#include "tools/dbbackup.hpp"
+#include "tools/dbquery.hpp"
 #include "tools/generatesecretkey.hpp"
 #include "tools/versionjson.hpp"
+#include "utils/phases.hpp"
 #include "utils/secretkey.hpp"
+#include "workerpool.hpp"
 
+#include "methods/clustercall.hpp"
+#include "methods/clusternodeslist.hpp"
+#include "methods/clustertorrentslist.hpp"
+#include "methods/configreload.hpp"
+#include "methods/dbbackup.hpp"
+#include "methods/dbbackupstatus.hpp"
 #include "methods/fsspace.hpp"
+#include "methods/peerclasseslist.hpp"
+#include "methods/peerclassesremove.hpp"
+#include "methods/peerclassesset.hpp"
 #include "methods/presetslist.hpp"
+#include "methods/sessionalertsdebug.hpp"
+#include "methods/sessiondhtstats.hpp"
+#include "methods/sessiondrain.hpp"
 #include "methods/sessionpause.hpp"
+#include "methods/sessionpeerssummary.hpp"
+#include "methods/sessionprofilesactivate.hpp"
+#include "methods/sessionprofileslist.hpp"
 #include "methods/sessionresume.hpp"
 #include "methods/sessionsettingslist.hpp"
 #include "methods/sessionsettingsupdate.hpp"
+#include "methods/sessionstatshistory.hpp"
+#include "methods/sysmemory.hpp"
+#include "methods/sysstatus.hpp"
 #include "methods/sysversions.hpp"
 #include "methods/torrentsadd.hpp"
+#include "methods/torrentsaddbatch.hpp"
+#include "methods/torrentscategoryset.hpp"
 #include "methods/torrentsfileslist.hpp"
+#include "methods/torrentshistory.hpp"
 #include "methods/torrentslist.hpp"
+#include "methods/torrentsmatch.hpp"
+#include "methods/torrentsmetadatafind.hpp"
+#include "methods/torrentsmetadataget.hpp"
 #include "methods/torrentsmetadatalist.hpp"
+#include "methods/torrentsmetadataset.hpp"
 #include "methods/torrentsmove.hpp"
+#include "methods/torrentsmovelist.hpp"
 #include "methods/torrentspause.hpp"
 #include "methods/torrentspeersadd.hpp"
 #include "methods/torrentspeerslist.hpp"
+#include "methods/torrentspieces.hpp"
 #include "methods/torrentsrecheck.hpp"
+#include "methods/torrentsrechecklist.hpp"
 #include "methods/torrentsremove.hpp"
 #include "methods/torrentsresume.hpp"
 #include "methods/torrentspropertiesget.hpp"
 #include "methods/torrentspropertiesset.hpp"
+#include "methods/torrentsstats.hpp"
+#include "methods/torrentstagsupdate.hpp"
+#include "methods/torrentstop.hpp"
 #include "methods/torrentstrackerslist.hpp"
+#include "methods/trackerslist.hpp"
 
 #include "workflows/actionfactory.hpp"
 #include "workflows/executor.hpp"
+#include "workflows/timerwheel.hpp"
 #include "workflows/workflow.hpp"
 #include "workflows/actions/http.hpp"
 #include "workflows/actions/log.hpp"
@@ -61,6 +160,10 @@ int main(int argc, char* argv[])
     static std::map<std::string, std::function<int(int, char**, std::unique_ptr<porla::Config>)>> subcommands =
     {
         {"auth:token", &porla::Tools::AuthToken},
+        {"db:backup", &porla::Tools::DbBackup},
+        {"db:settings", &porla::Tools::DbSettings},
+        {"db:stats", &porla::Tools::DbStats},
+        {"db:torrents", &porla::Tools::DbTorrents},
         {"key:generate", &porla::Tools::GenerateSecretKey},
         {"version:json", &porla::Tools::VersionJson}
     };
@@ -74,11 +177,17 @@ int main(int argc, char* argv[])
 
     porla::Logger::Setup(cmd);
 
+    auto& startup = porla::Utils::Phases::Startup();
+    startup.Begin();
+
     std::unique_ptr<porla::Config> cfg;
 
+    // Subcommands run next to the daemon, and only read the database.
+    const bool subcommand = argc >= 2 && subcommands.contains(argv[1]);
+
     try
     {
-        cfg = porla::Config::Load(cmd);
+        cfg = startup.Measure("config", [&cmd, subcommand]() { return porla::Config::Load(cmd, subcommand); });
     }
     catch (const std::exception& ex)
     {
@@ -87,11 +196,31 @@ int main(int argc, char* argv[])
     }
 
     // Check if we should run one of the subcommands we have.
-    if (argc >= 2 && subcommands.contains(argv[1]))
+    if (subcommand)
     {
         return subcommands.at(argv[1])(argc, argv, std::move(cfg));
     }
 
+    std::unique_ptr<porla::ThreadPlacement> placement;
+
+    try
+    {
+        placement = std::make_unique<porla::ThreadPlacement>(porla::ThreadPlacementOptions{
+            .http       = cfg->cpu_http,
+            .io         = cfg->cpu_io,
+            .libtorrent = cfg->cpu_libtorrent,
+            .workers    = cfg->cpu_workers,
+            .numa_local = cfg->cpu_numa_local.value_or(false)
+        });
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(fatal) << "Failed to configure thread placement: " << ex.what();
+        return -1;
+    }
+
+    placement->Report();
+
     boost::asio::io_context io;
     boost::asio::signal_set signals(io, SIGINT, SIGTERM);
 
@@ -103,19 +232,110 @@ int main(int argc, char* argv[])
         });
 
     {
-        porla::Session session(io, porla::SessionOptions{
-            .db                         = cfg->db,
-            .extensions                 = cfg->session_extensions,
-            .settings                   = cfg->session_settings,
-            .session_params_file        = cfg->state_dir.value_or(fs::current_path()) / "session.dat",
-            .timer_dht_stats            = cfg->timer_dht_stats.value_or(5000),
-            .timer_session_stats        = cfg->timer_session_stats.value_or(5000),
-            .timer_torrent_updates      = cfg->timer_torrent_updates.value_or(1000)
-        });
+        // Made before the session, which adds its plugin as the torrents are added, and
+        // outlives it.
+        std::unique_ptr<porla::TorrentCounters> torrentCounters;
+
+        // Torrent costs are kept from the counters, so they enable them too.
+        if (cfg->torrent_counters_enabled.value_or(false) || cfg->torrent_costs_enabled.value_or(false))
+        {
+            torrentCounters = std::make_unique<porla::TorrentCounters>(io, porla::TorrentCountersOptions{
+                .interval = std::chrono::milliseconds(std::max(100, cfg->torrent_counters_interval.value_or(1000)))
+            });
+        }
+
+        std::unique_ptr<porla::ISession> session_ptr;
+
+        // The threads libtorrent starts inherit the CPUs and memory policy of the thread
+        // that starts them, which is this one until the session is made.
+        placement->Place(porla::ThreadPlacement::Role::Libtorrent);
 
         try
         {
-            session.Load();
+            if (cfg->simulation_torrents.has_value())
+            {
+                const int torrents = cfg->simulation_torrents.value();
+
+                auto simulated = std::make_unique<porla::SimulatedSession>(io, porla::SimulatedSessionOptions{
+                    .finish_rate           = cfg->simulation_finish_rate.value_or(1),
+                    .timer_session_stats   = cfg->timer_session_stats.value_or(5000),
+                    .timer_torrent_updates = cfg->timer_torrent_updates.value_or(1000),
+                    .torrents              = torrents,
+                    .update_rate           = cfg->simulation_update_rate.value_or(torrents / 10)
+                });
+
+                simulated->Load();
+                session_ptr = std::move(simulated);
+            }
+            else
+            {
+                const auto session_start = std::chrono::steady_clock::now();
+                const auto disk_io_name  = cfg->disk_io.value_or("default");
+                const auto disk_io       = porla::DiskIo::Constructor(disk_io_name);
+
+                if (!disk_io.has_value())
+                {
+                    BOOST_LOG_TRIVIAL(fatal) << "Unknown disk I/O backend " << disk_io_name;
+                    return -1;
+                }
+
+                BOOST_LOG_TRIVIAL(info) << "Using the " << disk_io_name << " disk I/O backend";
+
+                std::vector<porla::PeerClass> peer_classes;
+
+                for (const auto& [name, peer_class] : cfg->peer_classes)
+                {
+                    peer_classes.push_back(peer_class);
+                }
+
+                porla::SessionOptions session_options{
+                    .alert_queue_max            = cfg->alert_queue_max.value_or(100000),
+                    .alert_thread               = cfg->alert_thread.value_or(false),
+                    .db                         = cfg->db,
+                    .db_pragmas                 = cfg->db_pragmas,
+                    .disk_io                    = *disk_io,
+                    .extensions                 = cfg->session_extensions,
+                    .park_after                 = std::chrono::seconds(cfg->parking_after.value_or(0)),
+                    .peer_classes               = std::move(peer_classes),
+                    .plugins                    = torrentCounters ? std::vector<lt_plugin>{ torrentCounters->Plugin() } : std::vector<lt_plugin>{},
+                    .persistence_batch_size     = cfg->persistence_batch_size.value_or(500),
+                    .persistence_compress       = cfg->persistence_compress.value_or(true),
+                    .persistence_flush_interval = cfg->persistence_flush_interval.value_or(1000),
+                    .settings                   = cfg->session_settings,
+                    .session_params_file        = cfg->state_dir.value_or(fs::current_path()) / "session.dat",
+                    .state_snapshot_file        = cfg->state_snapshot_file.value_or(fs::path()),
+                    .timer_dht_state            = cfg->timer_dht_state.value_or(600000),
+                    .timer_dht_stats            = cfg->timer_dht_stats.value_or(5000),
+                    .timer_dht_stats_idle       = cfg->timer_dht_stats_idle.value_or(60000),
+                    .timer_resume_data          = cfg->timer_resume_data.value_or(300000),
+                    .timer_session_stats        = cfg->timer_session_stats.value_or(5000),
+                    .timer_session_stats_idle   = cfg->timer_session_stats_idle.value_or(30000),
+                    .timer_torrent_updates      = cfg->timer_torrent_updates.value_or(1000),
+                    .timer_torrent_updates_idle = cfg->timer_torrent_updates_idle.value_or(5000)
+                };
+
+                if (cfg->shards.value_or(1) > 1)
+                {
+                    auto sharded = std::make_unique<porla::ShardedSession>(io, porla::ShardedSessionOptions{
+                        .session           = std::move(session_options),
+                        .shards            = *cfg->shards,
+                        .listen_interfaces = cfg->shards_listen_interfaces,
+                        .presets           = cfg->shards_presets
+                    });
+
+                    sharded->Load();
+                    session_ptr = std::move(sharded);
+                }
+                else
+                {
+                    auto real = std::make_unique<porla::Session>(io, session_options);
+
+                    real->Load();
+                    session_ptr = std::move(real);
+                }
+
+                startup.Record("session", std::chrono::steady_clock::now() - session_start);
+            }
         }
         catch (const std::exception &ex)
         {
@@ -123,69 +343,675 @@ int main(int argc, char* argv[])
             return -1;
         }
 
+        placement->Place(porla::ThreadPlacement::Role::Io);
+
+        porla::ISession& session = *session_ptr;
+
+        porla::TorrentIndex index(session);
+        porla::ContentIndex content(session);
+        porla::TorrentStats torrentStats(session);
+        porla::TorrentRevisions revisions(session);
+        porla::StatsHistory stats_history(session, cfg->stats_history_metrics.value_or(porla::StatsHistory::DefaultMetrics));
+
+        porla::MemoryAccounting memory(session);
+        memory.Add("content", [&content]() { return content.Memory(); });
+        memory.Add("index", [&index]() { return index.Memory(); });
+        memory.Add("stats_history", [&stats_history]() { return stats_history.Memory(); });
+        memory.Add("torrent_stats", [&torrentStats]() { return torrentStats.Memory(); });
+        memory.Add("workflows.runs", []() { return porla::MemoryUsage{ .objects = porla::Workflows::Workflow::RunsInProgress() }; });
+
+        if (torrentCounters)
+        {
+            memory.Add("torrent_counters", [&torrentCounters]() { return torrentCounters->Memory(); });
+        }
+
+        std::unique_ptr<porla::TorrentCosts> torrentCosts;
+
+        if (cfg->torrent_costs_enabled.value_or(false))
+        {
+            torrentCosts = std::make_unique<porla::TorrentCosts>(session, *torrentCounters, porla::TorrentCostsOptions{
+                .window   = std::chrono::seconds(std::max(10, cfg->torrent_costs_window.value_or(300))),
+                .slots    = std::clamp(cfg->torrent_costs_slots.value_or(5), 1, 60),
+                .capacity = static_cast<std::size_t>(std::clamp(cfg->torrent_costs_capacity.value_or(100), 10, 10000))
+            });
+
+            memory.Add("torrent_costs", [&torrentCosts]() { return torrentCosts->Memory(); });
+        }
+
+        porla::MetadataStore metadata(session, porla::MetadataStoreOptions{
+            .db         = cfg->db,
+            .cache_size = static_cast<std::size_t>(std::max(0, cfg->metadata_cache_size.value_or(1024))),
+            .indexes    = cfg->metadata_indexes
+        });
+
+        porla::MoveQueue moves(session, porla::MoveQueueOptions{
+            .per_device = std::max(1, cfg->move_concurrency.value_or(1))
+        });
+
+        porla::RecheckQueue rechecks(session, porla::RecheckQueueOptions{
+            .per_device = std::max(1, cfg->recheck_concurrency.value_or(1))
+        });
+
+        std::unique_ptr<porla::MetadataQueue> magnets;
+
+        if (cfg->magnets_concurrency.value_or(0) > 0)
+        {
+            magnets = std::make_unique<porla::MetadataQueue>(io, session, porla::MetadataQueueOptions{
+                .concurrency = *cfg->magnets_concurrency,
+                .timeout     = std::chrono::seconds(std::max(1, cfg->magnets_timeout.value_or(300))),
+                .retry_delay = std::chrono::seconds(std::max(1, cfg->magnets_retry_delay.value_or(60)))
+            });
+        }
+
+        std::unique_ptr<porla::SeedingGoals> seedingGoals;
+
+        if (!cfg->seeding_goals.empty())
+        {
+            seedingGoals = std::make_unique<porla::SeedingGoals>(io, session, moves, porla::SeedingGoalsOptions{
+                .goals    = cfg->seeding_goals,
+                .interval = std::chrono::milliseconds(std::max(1000, cfg->seeding_goals_interval.value_or(60000)))
+            });
+        }
+
+        std::unique_ptr<porla::PeerAggregates> peerAggregates;
+
+        if (cfg->peer_aggregates_enabled.value_or(false))
+        {
+            peerAggregates = std::make_unique<porla::PeerAggregates>(io, session, porla::PeerAggregatesOptions{
+                .interval          = std::chrono::milliseconds(std::max(100, cfg->peer_aggregates_interval.value_or(1000))),
+                .torrents_per_tick = std::max(1, cfg->peer_aggregates_torrents_per_tick.value_or(16)),
+                .top               = static_cast<std::size_t>(std::max(0, cfg->peer_aggregates_top.value_or(25))),
+                .max_labels        = static_cast<std::size_t>(std::max(1, cfg->metrics_max_labels.value_or(100)))
+            });
+        }
+
+        // Asks libtorrent for every announce and answer, so it can be turned off.
+        std::unique_ptr<porla::TrackerRegistry> trackerRegistry;
+
+        if (cfg->tracker_registry_enabled.value_or(true))
+        {
+            trackerRegistry = std::make_unique<porla::TrackerRegistry>(session, porla::TrackerRegistryOptions{
+                .max_hosts = static_cast<std::size_t>(std::max(1, cfg->metrics_max_labels.value_or(100)))
+            });
+        }
+
+        std::unique_ptr<porla::ReleaseBoost> releaseBoost;
+
+        if (cfg->release_boost_enabled.value_or(false))
+        {
+            releaseBoost = std::make_unique<porla::ReleaseBoost>(io, session, porla::ReleaseBoostOptions{
+                .window        = std::chrono::seconds(std::max(1, cfg->release_boost_window.value_or(1800))),
+                .curve         = cfg->release_boost_curve.value_or("exponential") == "linear"
+                    ? porla::ReleaseBoostOptions::Curve::Linear
+                    : porla::ReleaseBoostOptions::Curve::Exponential,
+                .tiers         = std::clamp(cfg->release_boost_tiers.value_or(4), 1, 16),
+                .max_priority  = std::clamp(cfg->release_boost_max_priority.value_or(255), 1, 255),
+                .unchoke_tiers = std::max(0, cfg->release_boost_unchoke_tiers.value_or(1)),
+                .finished      = cfg->release_boost_finished.value_or(true)
+            });
+        }
+
+        // Paces forced reannounces per tracker host, which needs the tracker alerts on too.
+        std::unique_ptr<porla::AnnounceScheduler> announces;
+
+        if (cfg->tracker_announces_enabled.value_or(true))
+        {
+            announces = std::make_unique<porla::AnnounceScheduler>(io, session, porla::AnnounceSchedulerOptions{
+                .rate       = std::max(0.01, cfg->tracker_announces_rate.value_or(1.0)),
+                .burst      = std::max(1, cfg->tracker_announces_burst.value_or(10)),
+                .max_queued = static_cast<std::size_t>(std::max(1, cfg->tracker_announces_max_queued.value_or(1000))),
+                .boost      = [&releaseBoost](const libtorrent::info_hash_t& hash) { return releaseBoost ? releaseBoost->Priority(hash) : 0; }
+            });
+        }
+
+        std::unique_ptr<porla::SeedScheduler> seedScheduler;
+
+        if (cfg->seed_scheduler_enabled.value_or(false))
+        {
+            seedScheduler = std::make_unique<porla::SeedScheduler>(io, session, porla::SeedSchedulerOptions{
+                .interval            = std::chrono::milliseconds(std::max(1000, cfg->seed_scheduler_interval.value_or(300000))),
+                .slots               = std::max(0, cfg->seed_scheduler_slots.value_or(0)),
+                .max_changes         = std::max(1, cfg->seed_scheduler_max_changes.value_or(100)),
+                .upload_weight       = cfg->seed_scheduler_upload_weight.value_or(1.0),
+                .demand_weight       = cfg->seed_scheduler_demand_weight.value_or(10.0),
+                .seeding_time_weight = cfg->seed_scheduler_seeding_time_weight.value_or(-0.1),
+                .upload_window       = std::chrono::seconds(std::max(1, cfg->seed_scheduler_upload_window.value_or(3600)))
+            });
+        }
+
+        std::unique_ptr<porla::SettingsTuner> settingsTuner;
+
+        if (cfg->settings_tuner_enabled.value_or(false))
+        {
+            std::map<std::string, porla::SettingsTunerBounds> bounds = porla::SettingsTuner::DefaultBounds;
+
+            if (cfg->settings_tuner_bounds)
+            {
+                bounds.clear();
+
+                for (auto const& [name, range] : *cfg->settings_tuner_bounds)
+                {
+                    bounds.insert({name, porla::SettingsTunerBounds{ .min = range.first, .max = range.second }});
+                }
+            }
+
+            settingsTuner = std::make_unique<porla::SettingsTuner>(session, porla::SettingsTunerOptions{
+                .interval = std::chrono::milliseconds(std::max(1000, cfg->settings_tuner_interval.value_or(60000))),
+                .bounds   = std::move(bounds),
+                .step     = std::clamp(cfg->settings_tuner_step.value_or(0.25), 0.01, 1.0),
+                .sustain  = std::max(1, cfg->settings_tuner_sustain.value_or(3)),
+                .max_cpu  = cfg->settings_tuner_max_cpu.value_or(0.8)
+            });
+        }
+
+        porla::SessionProfiles sessionProfiles(porla::SessionProfilesOptions{
+            .session  = session,
+            .profiles = cfg->session_profiles
+        });
+
+        std::unique_ptr<porla::TorrentColumns> columns;
+
+        if (cfg->columnar_snapshot.value_or(false))
+        {
+            columns = std::make_unique<porla::TorrentColumns>(session);
+        }
+
+        porla::TorrentRates rates(session, porla::TorrentRatesOptions{
+            .half_life = std::chrono::seconds(std::max(1, cfg->torrent_rates_half_life.value_or(10)))
+        });
+
+        memory.Add("rates", [&rates]() { return rates.Memory(); });
+
+        std::unique_ptr<porla::TorrentOrders> orders;
+
+        if (cfg->sort_indexes.value_or(false))
+        {
+            orders = std::make_unique<porla::TorrentOrders>(session);
+            memory.Add("orders", [&orders]() { return orders->Memory(); });
+        }
+
+        // Read-side queries use these instead of the connection the io thread writes with.
+        porla::Data::ReaderPool readers(cfg->db, cfg->db_pragmas, std::max(0, cfg->db_readers.value_or(2)));
+
+        std::unique_ptr<porla::TorrentHistory> history;
+
+        if (cfg->torrent_history_enabled.value_or(false))
+        {
+            history = std::make_unique<porla::TorrentHistory>(io, session, porla::TorrentHistoryOptions{
+                .db             = cfg->db,
+                .readers        = &readers,
+                .flush_interval = std::chrono::seconds(std::max(1, cfg->torrent_history_flush_interval.value_or(60)))
+            });
+        }
+
+        std::unique_ptr<porla::TorrentViews> views;
+
+        try
+        {
+            views = std::make_unique<porla::TorrentViews>(session, cfg->views);
+        }
+        catch (const porla::Query::QueryError& qe)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "Failed to parse view query: " << qe.what();
+            return -1;
+        }
+
         std::vector<std::shared_ptr<porla::Workflows::Workflow>> workflows;
 
         BOOST_LOG_TRIVIAL(info) << "Loading " << cfg->workflow_files.size() << " workflow file(s)";
 
-        for (const auto& workflow_file : cfg->workflow_files)
+        startup.Measure(
+            "workflows",
+            [&]()
+            {
+                for (const auto& workflow_file : cfg->workflow_files)
+                {
+                    BOOST_LOG_TRIVIAL(debug) << "Loading workflow from file " << workflow_file;
+                    workflows.push_back(porla::Workflows::Workflow::LoadFromFile(workflow_file));
+                }
+            });
+
+        // Timeouts of every workflow action share one timer, and requests one connection pool.
+        porla::Workflows::TimerWheel timers(io);
+        porla::HttpClient http_client(io);
+
+        // Coordinator mode, federating the API of other porla nodes.
+        std::unique_ptr<porla::ClusterCoordinator> cluster;
+
+        if (!cfg->cluster_nodes.empty())
         {
-            BOOST_LOG_TRIVIAL(debug) << "Loading workflow from file " << workflow_file;
-            workflows.push_back(porla::Workflows::Workflow::LoadFromFile(workflow_file));
+            BOOST_LOG_TRIVIAL(info) << "Coordinating " << cfg->cluster_nodes.size() << " cluster node(s)";
+
+            cluster = std::make_unique<porla::ClusterCoordinator>(io, http_client, porla::ClusterCoordinatorOptions{
+                .nodes         = cfg->cluster_nodes,
+                .poll_interval = std::chrono::milliseconds(std::max(0, cfg->cluster_poll_interval.value_or(10000))),
+                .cache_ttl     = std::chrono::seconds(std::max(0, cfg->cluster_cache_ttl.value_or(300)))
+            });
         }
 
         porla::Workflows::Executor workflow_executor{porla::Workflows::ExecutorOptions{
+            .io             = io,
             .session        = session,
             .workflows      = workflows,
             .action_factory = std::make_shared<porla::Workflows::ActionFactory>(
                 std::map<std::string, std::function<std::shared_ptr<porla::Workflows::Action>()>>{
-                    // The world is not ready for this {"http",                [&io]()      { return std::make_shared<porla::Workflows::Actions::Http>(io); }},
+                    // The world is not ready for this {"http",                [&http_client]()    { return std::make_shared<porla::Workflows::Actions::Http>(http_client); }},
                     {"log",                 []()         { return std::make_shared<porla::Workflows::Actions::Log>(); }},
-                    {"push/discord",        [&io]()      { return std::make_shared<porla::Workflows::Actions::Push::Discord>(io); }},
-                    {"push/ntfy-sh",        [&io]()      { return std::make_shared<porla::Workflows::Actions::Push::Ntfy>(io); }},
-                    {"sleep",               [&io]()      { return std::make_shared<porla::Workflows::Actions::Sleep>(io); }},
+                    {"push/discord",        [&http_client]() { return std::make_shared<porla::Workflows::Actions::Push::Discord>(http_client); }},
+                    {"push/ntfy-sh",        [&http_client]() { return std::make_shared<porla::Workflows::Actions::Push::Ntfy>(http_client); }},
+                    {"sleep",               [&timers]()  { return std::make_shared<porla::Workflows::Actions::Sleep>(timers); }},
                     {"torrents/flags",      [&session]() { return std::make_shared<porla::Workflows::Actions::Torrents::Flags>(session); }},
-                    {"torrents/move",       [&session]() { return std::make_shared<porla::Workflows::Actions::Torrents::Move>(session); }},
+                    {"torrents/move",       [&moves]()   { return std::make_shared<porla::Workflows::Actions::Torrents::Move>(moves); }},
                     {"torrents/pause",      [&session]() { return std::make_shared<porla::Workflows::Actions::Torrents::Pause>(session); }},
-                    {"torrents/reannounce", [&session]() { return std::make_shared<porla::Workflows::Actions::Torrents::Reannounce>(session); }},
+                    {"torrents/reannounce", [&session, &timers, &announces]() { return std::make_shared<porla::Workflows::Actions::Torrents::Reannounce>(session, timers, announces.get()); }},
                     {"torrents/remove",     [&session]() { return std::make_shared<porla::Workflows::Actions::Torrents::Remove>(session); }}
-                })
+                }),
+            .max_running    = std::max(1, cfg->workflow_max_running.value_or(16)),
+            .max_queued     = static_cast<std::size_t>(std::max(0, cfg->workflow_max_queued.value_or(10000))),
+            .max_parallel_steps = std::max(0, cfg->workflow_max_parallel_steps.value_or(16)),
+            .db             = cfg->db,
+            .batch_events   = true
         }};
 
+        porla::ResponseCache responses;
+        memory.Add("responses", [&responses]() { return responses.Memory(); });
+
+        porla::ConfigReloader reloader(porla::ConfigReloaderOptions{
+            .cmd      = cmd,
+            .config   = *cfg,
+            .session  = session,
+            .executor = workflow_executor,
+            .cache    = &responses
+        });
+
+        boost::asio::signal_set hangup(io, SIGHUP);
+        std::function<void()> wait_hangup;
+
+        wait_hangup = [&]()
+        {
+            hangup.async_wait(
+                [&](boost::system::error_code const& ec, int signal)
+                {
+                    if (ec) return;
+
+                    BOOST_LOG_TRIVIAL(info) << "Hangup received - reloading configuration";
+
+                    try
+                    {
+                        reloader.Reload();
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        BOOST_LOG_TRIVIAL(error) << "Failed to reload configuration: " << ex.what();
+                    }
+
+                    wait_hangup();
+                });
+        };
+
+        wait_hangup();
+
+        // Heavy methods decode and run on these threads, keeping the io thread free for
+        // alerts and the event stream.
+        porla::WorkerPool workers(io, porla::WorkerPoolOptions{
+            .threads    = std::max(0, cfg->rpc_worker_threads.value_or(2)),
+            .queue_size = std::max(1, cfg->rpc_worker_queue_size.value_or(64)),
+            .on_start   = [&placement]() { placement->Place(porla::ThreadPlacement::Role::Workers); }
+        });
+
+        porla::WorkerPool* rpc_pool = cfg->rpc_worker_threads.value_or(2) > 0 ? &workers : nullptr;
+
+        // Lets methods running on the workers look torrents up without the io thread.
+        std::unique_ptr<porla::TorrentsSnapshot> torrentsSnapshot;
+
+        if (rpc_pool != nullptr)
+        {
+            torrentsSnapshot = std::make_unique<porla::TorrentsSnapshot>(io, session);
+            memory.Add("torrents_snapshot", [&torrentsSnapshot]() { return torrentsSnapshot->Memory(); });
+        }
+
+        porla::TorrentInfoCache torrentFiles(porla::TorrentInfoCacheOptions{
+            .capacity = static_cast<std::size_t>(std::max(0, cfg->torrent_files_cache_size.value_or(64))),
+            .max_size = static_cast<std::size_t>(std::max(1, cfg->torrent_files_max_size.value_or(32 * 1024 * 1024)))
+        });
+
+        std::unique_ptr<porla::SavePathQuotas> quotas;
+
+        if (!cfg->quotas.empty())
+        {
+            quotas = std::make_unique<porla::SavePathQuotas>(session, porla::SavePathQuotasOptions{
+                .quotas = cfg->quotas
+            });
+        }
+
+        porla::Methods::TorrentsAdd torrentsAdd(session, metadata, cfg->presets, rpc_pool, torrentsSnapshot.get(), &torrentFiles, quotas.get());
+
+        const char* db_filename = sqlite3_db_filename(cfg->db, "main");
+        porla::Data::Backup backup(db_filename != nullptr ? db_filename : "");
+
+        std::unique_ptr<porla::Data::StateSnapshot> stateSnapshot;
+
+        if (cfg->state_snapshot_file.has_value())
+        {
+            stateSnapshot = std::make_unique<porla::Data::StateSnapshot>(porla::Data::StateSnapshotOptions{
+                .source   = db_filename != nullptr ? db_filename : "",
+                .file     = *cfg->state_snapshot_file,
+                .interval = std::chrono::seconds(std::max(1, cfg->state_snapshot_interval.value_or(300)))
+            });
+        }
+
+        // Keeps cheap status and control requests moving while expensive reads pile up.
+        // Off with rpc_max_concurrent set to 0.
+        const int rpc_max_concurrent = std::max(0, cfg->rpc_max_concurrent.value_or(16));
+        const auto rpc_queue_budget  = std::chrono::milliseconds(std::max(0, cfg->rpc_queue_budget.value_or(2000)));
+
+        std::unique_ptr<porla::AdmissionController> admission;
+
+        if (rpc_max_concurrent > 0)
+        {
+            admission = std::make_unique<porla::AdmissionController>(io, porla::AdmissionControllerOptions{
+                .max_concurrent = static_cast<std::size_t>(rpc_max_concurrent),
+                .max_per_client = static_cast<std::size_t>(std::max(1, cfg->rpc_max_per_client.value_or(4))),
+                .max_bulk       = static_cast<std::size_t>(std::max(1, rpc_max_concurrent / 2)),
+                .max_queued     = static_cast<std::size_t>(std::max(0, cfg->rpc_max_queued.value_or(256))),
+                .control_budget = rpc_queue_budget * 2,
+                .read_budget    = rpc_queue_budget,
+                .bulk_budget    = rpc_queue_budget / 2
+            });
+        }
+
         porla::JsonRpcHandler rpc({
-            {"fs.space", porla::Methods::FsSpace()},
-            {"presets.list", porla::Methods::PresetsList(cfg->presets)},
+            {"cluster.call", porla::Methods::ClusterCall(cluster.get())},
+            {"cluster.nodes.list", porla::Methods::ClusterNodesList(cluster.get())},
+            {"cluster.torrents.list", porla::Methods::ClusterTorrentsList(cluster.get())},
+            {"config.reload", porla::Methods::ConfigReload(reloader)},
+            {"db.backup", porla::Methods::DbBackup(backup)},
+            {"db.backup.status", porla::Methods::DbBackupStatus(backup)},
+            {"fs.space", porla::Methods::FsSpace(rpc_pool)},
+            {"peerclasses.list", porla::Methods::PeerClassesList(session)},
+            {"peerclasses.remove", porla::Methods::PeerClassesRemove(session)},
+            {"peerclasses.set", porla::Methods::PeerClassesSet(session)},
+            {"presets.list", porla::Methods::PresetsList(cfg->presets, responses)},
+            {"session.alerts.debug", porla::Methods::SessionAlertsDebug(session)},
+            {"session.dht.stats", porla::Methods::SessionDhtStats(session)},
+            {"session.drain", porla::Methods::SessionDrain(session)},
             {"session.pause", porla::Methods::SessionPause(session)},
+            {"session.peers.summary", porla::Methods::SessionPeersSummary(peerAggregates.get())},
+            {"session.profiles.activate", porla::Methods::SessionProfilesActivate(sessionProfiles)},
+            {"session.profiles.list", porla::Methods::SessionProfilesList(sessionProfiles)},
             {"session.resume", porla::Methods::SessionResume(session)},
-            {"session.settings.list", porla::Methods::SessionSettingsList(session)},
+            {"session.settings.list", porla::Methods::SessionSettingsList(session, settingsTuner.get())},
             {"session.settings.update", porla::Methods::SessionSettingsUpdate(session, cfg->db)},
-            {"sys.versions", porla::Methods::SysVersions()},
-            {"torrents.add", porla::Methods::TorrentsAdd(cfg->db, session, cfg->presets)},
-            {"torrents.files.list", porla::Methods::TorrentsFilesList(session)},
-            {"torrents.list", porla::Methods::TorrentsList(cfg->db, session)},
-            {"torrents.metadata.list", porla::Methods::TorrentsMetadataList(cfg->db, session)},
-            {"torrents.move", porla::Methods::TorrentsMove(session)},
+            {"session.stats.history", porla::Methods::SessionStatsHistory(stats_history)},
+            {"sys.memory", porla::Methods::SysMemory(memory)},
+            {"sys.status", porla::Methods::SysStatus(session)},
+            {"sys.versions", porla::Methods::SysVersions(responses)},
+            {"torrents.add", torrentsAdd},
+            {"torrents.add.batch", porla::Methods::TorrentsAddBatch(session, torrentsAdd, rpc_pool)},
+            {"torrents.category.set", porla::Methods::TorrentsCategorySet(session)},
+            {"torrents.files.list", porla::Methods::TorrentsFilesList(io, session)},
+            {"torrents.history", porla::Methods::TorrentsHistory(history.get(), rpc_pool)},
+            {"torrents.list", porla::Methods::TorrentsList(cfg->db, session, index, revisions, columns.get(), views.get(), &metadata, orders.get(), &rates, peerAggregates.get())},
+            {"torrents.match", porla::Methods::TorrentsMatch(session, content)},
+            {"torrents.metadata.find", porla::Methods::TorrentsMetadataFind(metadata)},
+            {"torrents.metadata.get", porla::Methods::TorrentsMetadataGet(session, metadata)},
+            {"torrents.metadata.list", porla::Methods::TorrentsMetadataList(session, metadata)},
+            {"torrents.metadata.set", porla::Methods::TorrentsMetadataSet(session, metadata)},
+            {"torrents.move", porla::Methods::TorrentsMove(session, moves)},
+            {"torrents.move.list", porla::Methods::TorrentsMoveList(moves)},
             {"torrents.pause", porla::Methods::TorrentsPause(session)},
             {"torrents.peers.add", porla::Methods::TorrentsPeersAdd(session)},
             {"torrents.peers.list", porla::Methods::TorrentsPeersList(session)},
+            {"torrents.pieces", porla::Methods::TorrentsPieces(session, rpc_pool, torrentsSnapshot.get())},
             {"torrents.properties.get", porla::Methods::TorrentsPropertiesGet(session)},
             {"torrents.properties.set", porla::Methods::TorrentsPropertiesSet(session)},
-            {"torrents.recheck", porla::Methods::TorrentsRecheck(session)},
+            {"torrents.recheck", porla::Methods::TorrentsRecheck(session, rechecks)},
+            {"torrents.recheck.list", porla::Methods::TorrentsRecheckList(rechecks)},
             {"torrents.remove", porla::Methods::TorrentsRemove(session)},
             {"torrents.resume", porla::Methods::TorrentsResume(session)},
-            {"torrents.trackers.list", porla::Methods::TorrentsTrackersList(session)}
+            {"torrents.stats", porla::Methods::TorrentsStats(torrentStats)},
+            {"torrents.tags.update", porla::Methods::TorrentsTagsUpdate(session)},
+            {"torrents.top", porla::Methods::TorrentsTop(session, torrentCosts.get())},
+            {"torrents.trackers.list", porla::Methods::TorrentsTrackersList(session)},
+            {"trackers.list", porla::Methods::TrackersList(trackerRegistry.get())}
+        }, porla::JsonRpcHandlerOptions{
+            .coalesce     = {"torrents.files.list", "torrents.list", "torrents.peers.list", "torrents.trackers.list"},
+            .coalesce_ttl = std::chrono::milliseconds(std::max(0, cfg->rpc_coalesce_ttl.value_or(500))),
+            .generation   = [&revisions]() { return revisions.Current(); },
+            .admission    = admission.get(),
+            .priorities   = {
+                {"sys.status",              porla::AdmissionPriority::Health},
+                {"sys.versions",            porla::AdmissionPriority::Health},
+                {"config.reload",           porla::AdmissionPriority::Control},
+                {"session.drain",           porla::AdmissionPriority::Control},
+                {"session.pause",           porla::AdmissionPriority::Control},
+                {"session.resume",          porla::AdmissionPriority::Control},
+                {"session.profiles.activate", porla::AdmissionPriority::Control},
+                {"torrents.add",            porla::AdmissionPriority::Control},
+                {"torrents.move",           porla::AdmissionPriority::Control},
+                {"torrents.pause",          porla::AdmissionPriority::Control},
+                {"torrents.properties.set", porla::AdmissionPriority::Control},
+                {"torrents.recheck",        porla::AdmissionPriority::Control},
+                {"torrents.remove",         porla::AdmissionPriority::Control},
+                {"torrents.resume",         porla::AdmissionPriority::Control},
+                {"torrents.category.set",   porla::AdmissionPriority::Control},
+                {"torrents.tags.update",    porla::AdmissionPriority::Control},
+                {"cluster.torrents.list",   porla::AdmissionPriority::Bulk},
+                {"db.backup",               porla::AdmissionPriority::Bulk},
+                {"session.stats.history",   porla::AdmissionPriority::Bulk},
+                {"torrents.add.batch",      porla::AdmissionPriority::Bulk},
+                {"torrents.history",        porla::AdmissionPriority::Bulk},
+                {"torrents.list",           porla::AdmissionPriority::Bulk},
+                {"torrents.metadata.list",  porla::AdmissionPriority::Bulk},
+                {"torrents.pieces",         porla::AdmissionPriority::Bulk}
+            }
         });
 
-        porla::HttpServer http(io, porla::HttpServerOptions{
-            .host = cfg->http_host.value_or("127.0.0.1"),
-            .port = cfg->http_port.value_or(1337)
+        std::unique_ptr<porla::FeedSubscriptions> feeds;
+
+        if (!cfg->feeds.empty())
+        {
+            feeds = std::make_unique<porla::FeedSubscriptions>(io, session, http_client, torrentsAdd, porla::FeedSubscriptionsOptions{
+                .feeds = cfg->feeds,
+                .db    = cfg->db
+            });
+        }
+
+        std::unique_ptr<porla::WatchDirectories> watchDirectories;
+
+        if (!cfg->watch_directories.empty())
+        {
+            watchDirectories = std::make_unique<porla::WatchDirectories>(io, session, torrentsAdd, porla::WatchDirectoriesOptions{
+                .directories = cfg->watch_directories,
+                .interval    = std::chrono::milliseconds(std::max(100, cfg->watch_interval.value_or(5000))),
+                .pool        = rpc_pool
+            });
+        }
+
+        // With http_threads set, the HTTP server runs on an io_context of its own and only
+        // the handlers that touch the session are dispatched back onto the main one.
+        const int http_threads = std::max(0, cfg->http_threads.value_or(0));
+        boost::asio::io_context http_io;
+
+        const auto on_main = [&io](porla::HttpMiddleware middleware)
+        {
+            return porla::HttpDispatch(io.get_executor(), std::move(middleware));
+        };
+
+        std::unique_ptr<porla::Tracer> tracer;
+
+        if (cfg->tracing_endpoint.has_value())
+        {
+            tracer = std::make_unique<porla::Tracer>(io, porla::TracerOptions{
+                .endpoint    = *cfg->tracing_endpoint,
+                .sample_rate = std::clamp(cfg->tracing_sample_rate.value_or(0.01), 0.0, 1.0)
+            });
+        }
+
+        porla::HttpServer http(http_threads > 0 ? http_io : io, porla::HttpServerOptions{
+            .host        = cfg->http_host.value_or("127.0.0.1"),
+            .port        = cfg->http_port.value_or(1337),
+            .compression = porla::HttpCompressionOptions{
+                .level    = std::clamp(cfg->http_compression_level.value_or(6), 0, 9),
+                .min_size = static_cast<std::size_t>(std::max(0, cfg->http_compression_min_size.value_or(1024)))
+            },
+            .idle_timeout    = std::chrono::seconds(std::max(1, cfg->http_idle_timeout.value_or(30))),
+            .max_connections = static_cast<std::size_t>(std::max(0, cfg->http_max_connections.value_or(1024))),
+            .tcp         = cfg->http_tcp_enabled.value_or(true),
+            .tracer      = tracer.get(),
+            .unix_socket = cfg->http_unix_socket.value_or("")
+        });
+
+        porla::HttpEventStream eventStream(io, session, porla::HttpEventStreamOptions{
+            .max_subscribers = static_cast<std::size_t>(std::max(0, cfg->http_max_event_subscribers.value_or(256)))
         });
 
-        porla::HttpEventStream eventStream(session);
-        porla::MetricsHandler metrics(session);
+        memory.Add("events", [&eventStream]() { return eventStream.Memory(); });
+
+        std::unique_ptr<porla::ChangeFeed> changes;
+
+        if (cfg->changes_enabled.value_or(false))
+        {
+            changes = std::make_unique<porla::ChangeFeed>(io, session, porla::ChangeFeedOptions{
+                .dir               = cfg->changes_dir.has_value() ? std::optional<fs::path>(*cfg->changes_dir) : std::nullopt,
+                .file_size         = static_cast<std::uint64_t>(std::max(1, cfg->changes_file_size.value_or(64))) * 1024 * 1024,
+                .max_files         = std::max(1, cfg->changes_max_files.value_or(10)),
+                .retain            = static_cast<std::size_t>(std::max(0, cfg->changes_retain.value_or(10000))),
+                .snapshot_interval = std::chrono::milliseconds(std::max(0, cfg->changes_snapshot_interval.value_or(60000)))
+            });
+
+            memory.Add("changes", [&changes]() { return changes->Memory(); });
+        }
+
+        std::unique_ptr<porla::StatusSnapshot> statusSnapshot;
+
+        if (cfg->status_snapshot_path.has_value())
+        {
+            statusSnapshot = std::make_unique<porla::StatusSnapshot>(session, porla::StatusSnapshotOptions{
+                .path = *cfg->status_snapshot_path
+            });
+        }
+
+        porla::Utils::ScopedConnection clusterEvents;
 
-        porla::AuthInitHandler authInitHandler(io, cfg->db);
-        porla::AuthLoginHandler authLoginHandler(io, porla::AuthLoginHandlerOptions{
+        if (cluster)
+        {
+            clusterEvents = cluster->OnNodeChanged(
+                [&eventStream](const std::string& name, const porla::ClusterCoordinator::NodeState& state)
+                {
+                    eventStream.Publish("cluster_node", nlohmann::json({
+                        {"node", name},
+                        {"online", state.online},
+                        {"revision", state.revision},
+                        {"torrents", state.torrents}
+                    }).dump());
+                });
+        }
+
+        // Scoped, since the queues outlive the event stream.
+        porla::Utils::ScopedConnection moveEvents = moves.OnChanged(
+            [&eventStream](const porla::MoveQueue::Move& move)
+            {
+                eventStream.Publish("storage_move", nlohmann::json(move).dump());
+            });
+
+        porla::Utils::ScopedConnection recheckEvents = rechecks.OnChanged(
+            [&eventStream](const porla::RecheckQueue::Recheck& recheck)
+            {
+                eventStream.Publish("torrent_recheck", nlohmann::json(recheck).dump());
+            });
+
+        porla::Utils::ScopedConnection magnetEvents;
+
+        if (magnets)
+        {
+            magnetEvents = magnets->OnChanged(
+                [&eventStream](const porla::MetadataQueue::Fetch& fetch)
+                {
+                    eventStream.Publish("torrent_metadata", nlohmann::json({
+                        {"attempts", fetch.attempts},
+                        {"info_hash", fetch.info_hash},
+                        {"queued_at", fetch.queued_at},
+                        {"retry_at", fetch.retry_at.has_value() ? nlohmann::json(*fetch.retry_at) : nlohmann::json()},
+                        {"started_at", fetch.started_at.has_value() ? nlohmann::json(*fetch.started_at) : nlohmann::json()},
+                        {"state", porla::MetadataQueue::Name(fetch.state)}
+                    }).dump());
+                });
+        }
+
+        std::unique_ptr<porla::DiskSpaceMonitor> diskSpace;
+
+        if (cfg->disk_space_interval.value_or(30000) > 0)
+        {
+            std::vector<std::string> preset_paths;
+
+            for (const auto& [name, preset] : cfg->presets)
+            {
+                if (preset.save_path.has_value()) preset_paths.push_back(*preset.save_path);
+            }
+
+            diskSpace = std::make_unique<porla::DiskSpaceMonitor>(io, session, porla::DiskSpaceMonitorOptions{
+                .interval       = std::chrono::milliseconds(std::max(1000, cfg->disk_space_interval.value_or(30000))),
+                .low_bytes      = static_cast<std::uint64_t>(std::max(0, cfg->disk_space_low.value_or(10240))) * 1024 * 1024,
+                .critical_bytes = static_cast<std::uint64_t>(std::max(0, cfg->disk_space_critical.value_or(1024))) * 1024 * 1024,
+                .pause          = cfg->disk_space_pause.value_or(false),
+                .paths          = std::move(preset_paths),
+                .pool           = rpc_pool
+            });
+
+            diskSpace->OnLevelChanged(
+                [&eventStream](const porla::DiskSpaceMonitor::Volume& volume)
+                {
+                    eventStream.Publish("disk_space", nlohmann::json({
+                        {"available", volume.available},
+                        {"capacity", volume.capacity},
+                        {"free", volume.free},
+                        {"level", porla::DiskSpaceMonitor::Name(volume.level)},
+                        {"paths", volume.paths},
+                        {"previous", porla::DiskSpaceMonitor::Name(volume.previous)}
+                    }).dump());
+                });
+        }
+        // Only kept when they are exported, since they are updated for every torrent change.
+        std::unique_ptr<porla::TorrentAggregates> aggregates;
+
+        if (cfg->http_metrics_enabled.value_or(true))
+        {
+            aggregates = std::make_unique<porla::TorrentAggregates>(
+                session,
+                std::max(1, cfg->metrics_max_labels.value_or(100)));
+        }
+
+        porla::MetricsHandler metrics(porla::MetricsHandlerOptions{
+            .session    = session,
+            .admission  = admission.get(),
+            .aggregates = aggregates.get(),
+            .counters   = torrentCounters.get(),
+            .events     = &eventStream,
+            .http       = &http,
+            .memory     = &memory,
+            .peers      = peerAggregates.get(),
+            .quotas     = quotas.get(),
+            .rpc        = &rpc,
+            .torrent_files = &torrentFiles,
+            .trackers   = trackerRegistry.get(),
+            .workers    = &workers,
+            .workflows  = &workflow_executor,
+            .timers     = &timers
+        });
+
+        porla::PasswordHasher hasher(io, porla::PasswordHasherOptions{
+            .memory_budget = static_cast<std::size_t>(std::max(1, cfg->auth_hash_memory_budget.value_or(2048))) * 1024 * 1024,
+            .memlimit      = static_cast<std::size_t>(std::max(1, cfg->auth_hash_memlimit.value_or(1024))) * 1024 * 1024,
+            .opslimit      = static_cast<unsigned long long>(std::max(1, cfg->auth_hash_opslimit.value_or(4))),
+            .queue_size    = cfg->auth_hash_queue_size.value_or(16),
+            .timeout       = std::chrono::milliseconds(cfg->auth_hash_timeout.value_or(30000))
+        });
+
+        porla::AuthInitHandler authInitHandler(cfg->db, hasher, responses);
+        porla::AuthLoginHandler authLoginHandler(porla::AuthLoginHandlerOptions{
             .db         = cfg->db,
+            .hasher     = hasher,
             .secret_key = cfg->secret_key
         });
 
@@ -194,38 +1020,171 @@ int main(int argc, char* argv[])
         if (http_base_path[0] != '/')      http_base_path = "/" + http_base_path;
         if (http_base_path.ends_with("/")) http_base_path = http_base_path.substr(0, http_base_path.size() - 1);
 
-        http.Use(porla::HttpPost(http_base_path + "/api/v1/auth/init",  [&authInitHandler](auto const& ctx) { authInitHandler(ctx); }));
-        http.Use(porla::HttpPost(http_base_path + "/api/v1/auth/login", [&authLoginHandler](auto const& ctx) { authLoginHandler(ctx); }));
-        http.Use(porla::HttpGet(http_base_path +  "/api/v1/system",     porla::SystemHandler(cfg->db)));
+        porla::PieceStreams pieceStreams(io, session);
+        porla::HttpRouter router;
 
-        http.Use(
-            porla::HttpPost(http_base_path + "/api/v1/jsonrpc",
-                cfg->http_auth_enabled.value_or(true)
-                    ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, [&rpc](auto const& ctx) { rpc(ctx); }))
-                    : static_cast<porla::HttpMiddleware>([&rpc](auto const& ctx) { rpc(ctx); })));
+        router.Post(http_base_path + "/api/v1/auth/init",  on_main([&authInitHandler](auto const& ctx) { authInitHandler(ctx); }));
+        router.Post(http_base_path + "/api/v1/auth/login", on_main([&authLoginHandler](auto const& ctx) { authLoginHandler(ctx); }));
+        router.Get(http_base_path +  "/api/v1/system",     on_main(porla::SystemHandler(cfg->db, responses)));
+        router.Get(http_base_path +  "/api/v1/ready",      on_main(porla::ReadyHandler(session)));
+
+        router.Post(
+            http_base_path + "/api/v1/jsonrpc",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main([&rpc](auto const& ctx) { rpc(ctx); })))
+                : on_main([&rpc](auto const& ctx) { rpc(ctx); }));
 
-        http.Use(
-            porla::HttpGet(http_base_path + "/api/v1/events",
+        router.Get(
+            http_base_path + "/api/v1/events",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main([&eventStream](auto const& ctx) { eventStream(ctx); })))
+                : on_main([&eventStream](auto const& ctx) { eventStream(ctx); }));
+
+        if (changes)
+        {
+            router.Get(
+                http_base_path + "/api/v1/changes",
                 cfg->http_auth_enabled.value_or(true)
-                    ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, [&eventStream](auto const& ctx) { eventStream(ctx); }))
-                    : static_cast<porla::HttpMiddleware>([&eventStream](auto const& ctx) { eventStream(ctx); })));
+                    ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main([&changes](auto const& ctx) { (*changes)(ctx); })))
+                    : on_main([&changes](auto const& ctx) { (*changes)(ctx); }));
+        }
+
+        router.Post(
+            http_base_path + "/api/v1/torrents/upload",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main(porla::TorrentsUploadHandler(torrentsAdd))))
+                : on_main(porla::TorrentsUploadHandler(torrentsAdd)));
+
+        router.Get(
+            http_base_path + "/api/v1/torrents/archive",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main(porla::TorrentsArchiveHandler(session))))
+                : on_main(porla::TorrentsArchiveHandler(session)));
+
+        router.Get(
+            http_base_path + "/api/v1/torrents/download",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main(porla::TorrentsDownloadHandler(session, &pieceStreams))))
+                : on_main(porla::TorrentsDownloadHandler(session, &pieceStreams)));
+
+        router.Get(
+            http_base_path + "/api/v1/torrents/export",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main(porla::TorrentsExportHandler(cfg->db))))
+                : on_main(porla::TorrentsExportHandler(cfg->db)));
+
+        router.Post(
+            http_base_path + "/api/v1/torrents/import",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, on_main(porla::TorrentsImportHandler(session, metadata, rpc_pool))))
+                : on_main(porla::TorrentsImportHandler(session, metadata, rpc_pool)));
+
+        porla::HttpWebSocket webSocket(porla::HttpWebSocketOptions{
+            .io     = io,
+            .rpc    = rpc,
+            .events = &eventStream
+        });
+
+        router.Get(
+            http_base_path + "/api/v1/ws",
+            cfg->http_auth_enabled.value_or(true)
+                ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, webSocket))
+                : webSocket);
 
         if (cfg->http_metrics_enabled.value_or(true))
         {
             BOOST_LOG_TRIVIAL(info) << "Enabling HTTP metrics endpoint";
-            http.Use(porla::HttpGet(http_base_path + "/metrics", [&metrics](auto const &ctx) { metrics(ctx); }));
+            router.Get(http_base_path + "/metrics", on_main([&metrics](auto const &ctx) { metrics(ctx); }));
+        }
+
+        porla::Profiler profiler(io);
+
+        if (cfg->http_debug_enabled.value_or(false))
+        {
+            BOOST_LOG_TRIVIAL(info) << "Enabling HTTP debug endpoints";
+
+            const std::vector<std::pair<std::string, porla::ProfileHandler::Kind>> debug =
+            {
+                {"/api/v1/debug/pprof/profile", porla::ProfileHandler::Kind::Cpu},
+                {"/api/v1/debug/pprof/heap",    porla::ProfileHandler::Kind::Heap},
+                {"/api/v1/debug/timings",       porla::ProfileHandler::Kind::Timings}
+            };
+
+            for (const auto& [path, kind] : debug)
+            {
+                const auto handler = on_main(porla::ProfileHandler(kind, io, profiler, session));
+
+                router.Get(
+                    http_base_path + path,
+                    cfg->http_auth_enabled.value_or(true)
+                        ? static_cast<porla::HttpMiddleware>(porla::HttpJwtAuth(cfg->secret_key, handler))
+                        : handler);
+            }
         }
 
         if (cfg->http_webui_enabled.value_or(true))
         {
             BOOST_LOG_TRIVIAL(info) << "Enabling HTTP web UI";
-            http.Use(porla::EmbeddedWebUIHandler(http_base_path));
+            auto webui = startup.Measure("webui", [&]() { return porla::EmbeddedWebUIHandler(http_base_path); });
+
+            // The copies share the cached assets, so the one kept here sees them all.
+            memory.Add("webui", [webui]() { return webui.Memory(); });
+            router.Prefix(http_base_path, webui);
         }
 
+        http.Use(router);
         http.Use(porla::HttpNotFound());
 
+        // Started last, since the middlewares must not change once requests are handled.
+        auto http_work = boost::asio::make_work_guard(http_io);
+        std::vector<std::thread> http_pool;
+
+        if (http_threads > 0)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Running HTTP server on " << http_threads << " thread(s)";
+        }
+
+        for (int i = 0; i < http_threads; i++)
+        {
+            http_pool.emplace_back(
+                [&http_io, &placement]()
+                {
+                    placement->Place(porla::ThreadPlacement::Role::Http);
+                    http_io.run();
+                });
+        }
+
+        // Torrents are still loading, and are logged on their own when done.
+        BOOST_LOG_TRIVIAL(info) << "Started in " << startup.Elapsed().count() << "ms (" << startup.Summary() << ")";
+
         io.run();
+
+        porla::Utils::Phases::Shutdown().Begin();
+
+        // The methods posting to the workers go away with this scope.
+        porla::Utils::Phases::Shutdown().Measure(
+            "workers",
+            [&]()
+            {
+                workers.Stop();
+                hasher.Stop();
+            });
+
+        porla::Utils::Phases::Shutdown().Measure(
+            "http",
+            [&]()
+            {
+                http_io.stop();
+
+                for (auto& thread : http_pool)
+                {
+                    thread.join();
+                }
+            });
     }
 
+    const auto& shutdown = porla::Utils::Phases::Shutdown();
+    BOOST_LOG_TRIVIAL(info) << "Shut down in " << shutdown.Elapsed().count() << "ms (" << shutdown.Summary() << ")";
+
     return 0;
 }
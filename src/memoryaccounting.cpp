@@ -0,0 +1,115 @@
+#include "memoryaccounting.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include <unistd.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define PORLA_HAVE_MALLINFO2
+#endif
+
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+
+using porla::MemoryAccounting;
+
+// The libtorrent disk cache is counted in blocks of this size.
+static constexpr std::uint64_t DiskBlockSize = 16 * 1024;
+
+// What a map node and the strings of a status add to it, roughly.
+static constexpr std::uint64_t StatusOverhead = 48;
+
+static MemoryAccounting::Process ReadProcess()
+{
+    MemoryAccounting::Process process;
+
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    std::uint64_t size = 0;
+    std::uint64_t resident = 0;
+
+    if (statm >> size >> resident)
+    {
+        process.resident = resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+
+#if defined(PORLA_HAVE_MALLINFO2)
+    const auto info = mallinfo2();
+
+    process.heap_allocated = info.uordblks + info.hblkhd;
+    process.heap_free      = info.fordblks;
+#endif
+
+    return process;
+}
+
+MemoryAccounting::MemoryAccounting(ISession& session)
+    : m_session(session)
+    , m_diskBlocks(0)
+{
+    m_sessionStatsConnection = m_session.OnSessionStats(
+        [this](const auto& stats)
+        {
+            if (auto const blocks = stats.Get("disk.disk_blocks_in_use"))
+            {
+                m_diskBlocks = *blocks;
+            }
+        });
+}
+
+MemoryAccounting::~MemoryAccounting()
+{
+    m_sessionStatsConnection.disconnect();
+}
+
+void MemoryAccounting::Add(const std::string& name, std::function<MemoryUsage()> source)
+{
+    if (source)
+    {
+        m_sources.insert_or_assign(name, std::move(source));
+    }
+    else
+    {
+        m_sources.erase(name);
+    }
+}
+
+MemoryAccounting::Snapshot MemoryAccounting::Sample() const
+{
+    Snapshot snapshot{ .process = ReadProcess() };
+
+    MemoryUsage statuses;
+
+    for (const auto& [hash, status] : m_session.TorrentStatuses())
+    {
+        statuses.bytes += sizeof(lt::torrent_status) + StatusOverhead
+            + status.name.size()
+            + status.save_path.size()
+            + status.current_tracker.size();
+        statuses.objects++;
+    }
+
+    const auto client_data = Utils::LiveCount<TorrentClientData>::Count();
+
+    snapshot.subsystems["libtorrent.disk"] = MemoryUsage{
+        .bytes   = static_cast<std::uint64_t>(std::max<std::int64_t>(0, m_diskBlocks)) * DiskBlockSize,
+        .objects = static_cast<std::uint64_t>(std::max<std::int64_t>(0, m_diskBlocks))
+    };
+
+    snapshot.subsystems["session.client_data"] = MemoryUsage{
+        .bytes   = client_data * sizeof(TorrentClientData),
+        .objects = client_data
+    };
+
+    snapshot.subsystems["session.statuses"] = statuses;
+
+    for (const auto& [name, source] : m_sources)
+    {
+        snapshot.subsystems[name] = source();
+    }
+
+    return snapshot;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "memoryusage.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Approximate memory per subsystem, from the sizes of the containers which own it. The
+    // torrent statuses, the client data of each torrent and the libtorrent disk cache are
+    // counted here. Other subsystems are added as sources, each read when sampled.
+    class MemoryAccounting
+    {
+    public:
+        // From the kernel and the allocator, where they tell.
+        struct Process
+        {
+            std::optional<std::uint64_t> heap_allocated;
+            std::optional<std::uint64_t> heap_free;
+            std::optional<std::uint64_t> resident;
+        };
+
+        struct Snapshot
+        {
+            Process                             process;
+            std::map<std::string, MemoryUsage> subsystems;
+        };
+
+        explicit MemoryAccounting(ISession& session);
+        MemoryAccounting(const MemoryAccounting&) = delete;
+
+        ~MemoryAccounting();
+
+        // Sources are read on the io thread, and must outlive the accounting or be added
+        // again with an empty function.
+        void Add(const std::string& name, std::function<MemoryUsage()> source);
+
+        // Called on the io thread.
+        [[nodiscard]] Snapshot Sample() const;
+
+    private:
+        ISession& m_session;
+        std::map<std::string, std::function<MemoryUsage()>> m_sources;
+        std::int64_t m_diskBlocks;
+
+        porla::Utils::Connection m_sessionStatsConnection;
+    };
+}
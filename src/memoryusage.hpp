@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace porla
+{
+    // Memory held by a subsystem, estimated from the sizes of what it keeps rather than
+    // measured, so allocator overhead is left out.
+    struct MemoryUsage
+    {
+        std::uint64_t bytes   = 0;
+        std::uint64_t objects = 0;
+    };
+}
@@ -0,0 +1,300 @@
+#include "metadataqueue.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_handle.hpp>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::MetadataQueue;
+
+static std::int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* MetadataQueue::Name(State state)
+{
+    switch (state)
+    {
+    case State::Queued:   return "queued";
+    case State::Fetching: return "fetching";
+    case State::Waiting:  return "waiting";
+    case State::Received: return "received";
+    case State::Removed:  return "removed";
+    }
+
+    return "unknown";
+}
+
+MetadataQueue::MetadataQueue(boost::asio::io_context& io, porla::ISession& session, porla::MetadataQueueOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(options)
+    , m_next(0)
+{
+    m_addedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts)
+        {
+            Adopt(ts);
+            Pump();
+        });
+
+    m_loadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents) Adopt(ts);
+            Pump();
+        });
+
+    m_metadataConnection = m_session.OnTorrentMetadataReceived(
+        [this](const lt::torrent_handle& th) { Finish(th.info_hashes(), State::Received); });
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash) { Finish(hash, State::Removed); });
+
+    Schedule();
+}
+
+MetadataQueue::~MetadataQueue()
+{
+    m_addedConnection.disconnect();
+    m_loadedConnection.disconnect();
+    m_metadataConnection.disconnect();
+    m_removedConnection.disconnect();
+
+    m_timer.cancel();
+}
+
+std::vector<MetadataQueue::Fetch> MetadataQueue::List() const
+{
+    std::vector<Fetch> fetches;
+    fetches.reserve(m_jobs.size());
+
+    for (const auto id : m_fetching) fetches.push_back(m_jobs.at(id).fetch);
+    for (const auto id : m_queued)   fetches.push_back(m_jobs.at(id).fetch);
+
+    for (const auto& [deadline, id] : m_deadlines)
+    {
+        if (const auto& job = m_jobs.at(id); job.fetch.state == State::Waiting)
+        {
+            fetches.push_back(job.fetch);
+        }
+    }
+
+    return fetches;
+}
+
+void MetadataQueue::Adopt(const lt::torrent_status& ts)
+{
+    if (ts.has_metadata || m_ids.contains(ts.info_hashes))
+    {
+        return;
+    }
+
+    const bool auto_managed = static_cast<bool>(ts.flags & lt::torrent_flags::auto_managed);
+
+    // Paused by the user, who gets to decide when it starts.
+    if ((ts.flags & lt::torrent_flags::paused) && !auto_managed)
+    {
+        return;
+    }
+
+    const auto& torrents = m_session.Torrents();
+    const auto handle = torrents.find(ts.info_hashes);
+
+    if (handle == torrents.end())
+    {
+        return;
+    }
+
+    // Auto managed torrents would be started again by the libtorrent queue.
+    handle->second.unset_flags(lt::torrent_flags::auto_managed);
+    handle->second.pause();
+
+    const auto id = m_next++;
+
+    m_jobs.insert({ id, Job{
+        .fetch = Fetch{
+            .info_hash = ts.info_hashes,
+            .state     = State::Queued,
+            .attempts  = 0,
+            .queued_at = Now()
+        },
+        .auto_managed = auto_managed
+    }});
+
+    m_ids.insert({ ts.info_hashes, id });
+
+    Enqueue(id);
+}
+
+void MetadataQueue::Enqueue(std::uint64_t id)
+{
+    auto& job = m_jobs.at(id);
+
+    job.fetch.state      = State::Queued;
+    job.fetch.started_at = std::nullopt;
+    job.fetch.retry_at   = std::nullopt;
+
+    m_queued.insert(id);
+
+    m_changed(job.fetch);
+}
+
+void MetadataQueue::Finish(const lt::info_hash_t& hash, State state)
+{
+    const auto it = m_ids.find(hash);
+
+    // Added with metadata, or left alone when it was added.
+    if (it == m_ids.end())
+    {
+        return;
+    }
+
+    const auto id = it->second;
+    auto job = std::move(m_jobs.at(id));
+
+    m_queued.erase(id);
+    m_fetching.erase(id);
+    m_deadlines.erase({ job.deadline, id });
+    m_jobs.erase(id);
+    m_ids.erase(it);
+
+    if (state == State::Received)
+    {
+        const auto& torrents = m_session.Torrents();
+
+        // Metadata can also arrive for a queued torrent the user resumed.
+        if (const auto handle = torrents.find(hash); handle != torrents.end())
+        {
+            if (job.auto_managed) handle->second.set_flags(lt::torrent_flags::auto_managed);
+            else                  handle->second.resume();
+        }
+    }
+
+    job.fetch.state    = state;
+    job.fetch.retry_at = std::nullopt;
+
+    m_changed(job.fetch);
+
+    Pump();
+}
+
+void MetadataQueue::Pump()
+{
+    const auto& torrents = m_session.Torrents();
+    const auto limit = static_cast<std::size_t>(std::max(1, m_options.concurrency));
+
+    std::vector<lt::info_hash_t> gone;
+    std::vector<Fetch> started;
+
+    for (auto it = m_queued.begin(); it != m_queued.end() && m_fetching.size() < limit;)
+    {
+        const auto id = *it;
+        auto& job = m_jobs.at(id);
+
+        it = m_queued.erase(it);
+
+        const auto handle = torrents.find(job.fetch.info_hash);
+
+        if (handle == torrents.end())
+        {
+            gone.push_back(job.fetch.info_hash);
+            continue;
+        }
+
+        handle->second.resume();
+
+        job.fetch.state      = State::Fetching;
+        job.fetch.started_at = Now();
+        job.deadline         = Clock::now() + m_options.timeout;
+
+        m_fetching.insert(id);
+        m_deadlines.insert({ job.deadline, id });
+
+        started.push_back(job.fetch);
+    }
+
+    // Signalled after the loop, since subscribers may add more torrents.
+    for (const auto& hash : gone)
+    {
+        Finish(hash, State::Removed);
+    }
+
+    for (const auto& fetch : started)
+    {
+        m_changed(fetch);
+    }
+}
+
+void MetadataQueue::Schedule()
+{
+    m_timer.expires_after(std::chrono::seconds(1));
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) return;
+
+            Tick();
+            Schedule();
+        });
+}
+
+void MetadataQueue::Tick()
+{
+    const auto now = Clock::now();
+    const auto& torrents = m_session.Torrents();
+
+    std::vector<Fetch> changed;
+
+    while (!m_deadlines.empty() && m_deadlines.begin()->first <= now)
+    {
+        const auto id = m_deadlines.begin()->second;
+        auto& job = m_jobs.at(id);
+
+        m_deadlines.erase(m_deadlines.begin());
+
+        if (job.fetch.state == State::Waiting)
+        {
+            Enqueue(id);
+            continue;
+        }
+
+        m_fetching.erase(id);
+
+        if (const auto handle = torrents.find(job.fetch.info_hash); handle != torrents.end())
+        {
+            handle->second.pause();
+        }
+
+        job.fetch.attempts++;
+
+        // Doubled for every attempt, without overflowing on the shift.
+        const auto shift = std::min(job.fetch.attempts - 1, 20);
+        const auto delay = std::max(
+            std::chrono::seconds(1),
+            std::min(m_options.retry_delay * (1 << shift), m_options.retry_max));
+
+        job.fetch.state    = State::Waiting;
+        job.fetch.retry_at = Now() + delay.count();
+        job.deadline       = now + delay;
+
+        m_deadlines.insert({ job.deadline, id });
+
+        BOOST_LOG_TRIVIAL(debug) << "Metadata fetch timed out, retrying in " << delay.count() << "s";
+
+        changed.push_back(job.fetch);
+    }
+
+    for (const auto& fetch : changed)
+    {
+        m_changed(fetch);
+    }
+
+    Pump();
+}
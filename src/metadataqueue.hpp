@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct MetadataQueueOptions
+    {
+        // Torrents fetching metadata at the same time.
+        int                       concurrency = 50;
+        // How long a fetch may take before the torrent is paused and retried.
+        std::chrono::seconds      timeout     = std::chrono::seconds(300);
+        // Retries wait this long, doubled for every failed fetch up to the max.
+        std::chrono::seconds      retry_delay = std::chrono::seconds(60);
+        std::chrono::seconds      retry_max   = std::chrono::seconds(3600);
+    };
+
+    // Holds back torrents added without metadata, as from magnet links, so only so many
+    // look for it at once. Queued torrents are paused and taken off the libtorrent queue,
+    // and started in the order they were added. A fetch which times out is paused and
+    // queued again after a backoff. Once the metadata arrives, the torrent gets its auto
+    // managed flag back and is left to the normal queueing. Torrents added paused and not
+    // auto managed are left alone.
+    class MetadataQueue
+    {
+    public:
+        enum class State
+        {
+            Queued,
+            Fetching,
+            Waiting,
+            Received,
+            Removed
+        };
+
+        struct Fetch
+        {
+            libtorrent::info_hash_t     info_hash;
+            State                       state;
+            // Fetches which timed out so far.
+            int                         attempts;
+            std::int64_t                queued_at;
+            std::optional<std::int64_t> started_at;
+            // When the torrent is queued again, while it is waiting.
+            std::optional<std::int64_t> retry_at;
+        };
+
+        typedef porla::Utils::Signal<void(const Fetch&)> FetchSignal;
+
+        static const char* Name(State state);
+
+        explicit MetadataQueue(boost::asio::io_context& io, ISession& session, MetadataQueueOptions options = {});
+        MetadataQueue(const MetadataQueue&) = delete;
+
+        ~MetadataQueue();
+
+        // The fetching torrents followed by the queued and then the waiting ones.
+        [[nodiscard]] std::vector<Fetch> List() const;
+
+        porla::Utils::Connection OnChanged(const FetchSignal::slot_type& subscriber)
+        {
+            return m_changed.connect(subscriber);
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Job
+        {
+            Fetch             fetch;
+            bool              auto_managed;
+            Clock::time_point deadline;
+        };
+
+        void Adopt(const libtorrent::torrent_status& ts);
+        void Enqueue(std::uint64_t id);
+        void Finish(const libtorrent::info_hash_t& hash, State state);
+        void Pump();
+        void Schedule();
+        void Tick();
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        MetadataQueueOptions m_options;
+        std::uint64_t m_next;
+
+        std::map<std::uint64_t, Job> m_jobs;
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_ids;
+        // Queued jobs by id, which grows as they are queued, so the oldest go first.
+        std::set<std::uint64_t> m_queued;
+        std::set<std::uint64_t> m_fetching;
+        // Waiting and fetching jobs by their deadline.
+        std::set<std::pair<Clock::time_point, std::uint64_t>> m_deadlines;
+
+        porla::Utils::Connection m_addedConnection;
+        porla::Utils::Connection m_loadedConnection;
+        porla::Utils::Connection m_metadataConnection;
+        porla::Utils::Connection m_removedConnection;
+
+        FetchSignal m_changed;
+    };
+}
@@ -0,0 +1,166 @@
+#include "metadatastore.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#include "data/models/torrentmetadata.hpp"
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using porla::Data::Models::TorrentMetadata;
+using porla::MetadataStore;
+
+MetadataStore::MetadataStore(porla::ISession& session, porla::MetadataStoreOptions options)
+    : m_session(session)
+    , m_options(std::move(options))
+    , m_cache(m_options.cache_size)
+{
+    for (const auto& key : m_options.indexes)
+    {
+        auto& index = m_indexes[key];
+
+        TorrentMetadata::ForEach(
+            m_options.db,
+            key,
+            [&index](const lt::info_hash_t& hash, json&& value)
+            {
+                index[value.dump()].insert(hash);
+            });
+
+        BOOST_LOG_TRIVIAL(info) << "Indexed metadata key '" << key << "' with " << index.size() << " distinct value(s)";
+    }
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](const lt::info_hash_t& hash) { Remove(hash); });
+}
+
+MetadataStore::~MetadataStore()
+{
+    m_torrentRemovedConnection.disconnect();
+}
+
+MetadataStore::Map MetadataStore::Get(const lt::info_hash_t& hash)
+{
+    std::unique_lock lock(m_mtx);
+    return Load(hash);
+}
+
+MetadataStore::Map MetadataStore::Get(const lt::info_hash_t& hash, const std::vector<std::string>& keys)
+{
+    std::unique_lock lock(m_mtx);
+
+    const auto metadata = Load(hash);
+    Map result;
+
+    for (const auto& key : keys)
+    {
+        if (const auto value = metadata.find(key); value != metadata.end())
+        {
+            result.insert(*value);
+        }
+    }
+
+    return result;
+}
+
+void MetadataStore::Set(const lt::info_hash_t& hash, const Map& values)
+{
+    std::unique_lock lock(m_mtx);
+
+    auto metadata = Load(hash);
+
+    for (const auto& [key, value] : values)
+    {
+        if (const auto current = metadata.find(key); current != metadata.end())
+        {
+            Unindex(hash, key, current->second);
+        }
+
+        if (value.is_null())
+        {
+            TorrentMetadata::Remove(m_options.db, hash, key);
+            metadata.erase(key);
+            continue;
+        }
+
+        TorrentMetadata::Set(m_options.db, hash, key, value);
+        metadata.insert_or_assign(key, value);
+
+        if (const auto index = m_indexes.find(key); index != m_indexes.end())
+        {
+            index->second[value.dump()].insert(hash);
+        }
+    }
+
+    m_cache.Put(hash, std::move(metadata));
+}
+
+std::vector<lt::info_hash_t> MetadataStore::Find(const std::string& key, const json& value)
+{
+    std::unique_lock lock(m_mtx);
+
+    const auto dumped = value.dump();
+    std::vector<lt::info_hash_t> hashes;
+
+    if (const auto index = m_indexes.find(key); index != m_indexes.end())
+    {
+        if (const auto item = index->second.find(dumped); item != index->second.end())
+        {
+            hashes.assign(item->second.begin(), item->second.end());
+        }
+
+        return hashes;
+    }
+
+    TorrentMetadata::ForEach(
+        m_options.db,
+        key,
+        [&dumped, &hashes](const lt::info_hash_t& hash, json&& v)
+        {
+            if (v.dump() == dumped) hashes.push_back(hash);
+        });
+
+    return hashes;
+}
+
+MetadataStore::Map MetadataStore::Load(const lt::info_hash_t& hash)
+{
+    if (auto cached = m_cache.Get(hash))
+    {
+        return std::move(*cached);
+    }
+
+    auto metadata = TorrentMetadata::Get(m_options.db, hash);
+    m_cache.Put(hash, metadata);
+
+    return metadata;
+}
+
+void MetadataStore::Remove(const lt::info_hash_t& hash)
+{
+    std::unique_lock lock(m_mtx);
+
+    for (const auto& [key, value] : Load(hash))
+    {
+        Unindex(hash, key, value);
+    }
+
+    TorrentMetadata::Remove(m_options.db, hash);
+    m_cache.Erase(hash);
+}
+
+void MetadataStore::Unindex(const lt::info_hash_t& hash, const std::string& key, const json& value)
+{
+    const auto index = m_indexes.find(key);
+
+    if (index == m_indexes.end())
+    {
+        return;
+    }
+
+    if (const auto item = index->second.find(value.dump()); item != index->second.end())
+    {
+        item->second.erase(hash);
+        if (item->second.empty()) index->second.erase(item);
+    }
+}
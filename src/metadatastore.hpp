@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+#include <sqlite3.h>
+
+#include "utils/lrucache.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct MetadataStoreOptions
+    {
+        sqlite3*                 db;
+        // Torrents whose metadata is kept in memory after being read.
+        std::size_t              cache_size = 1024;
+        // Keys whose values are indexed, so Find does not scan the table for them.
+        std::vector<std::string> indexes;
+    };
+
+    // Client metadata for torrents, stored apart from the client data and read when it is
+    // asked for, so it is not held in memory for every torrent. Metadata is removed with
+    // its torrent. Safe to use from any thread.
+    class MetadataStore
+    {
+    public:
+        typedef std::map<std::string, nlohmann::json> Map;
+
+        explicit MetadataStore(ISession& session, MetadataStoreOptions options);
+        MetadataStore(const MetadataStore&) = delete;
+
+        ~MetadataStore();
+
+        Map Get(const libtorrent::info_hash_t& hash);
+        // Only the given keys, with the ones the torrent does not have left out.
+        Map Get(const libtorrent::info_hash_t& hash, const std::vector<std::string>& keys);
+        // Sets the given keys, removing the ones set to null.
+        void Set(const libtorrent::info_hash_t& hash, const Map& values);
+
+        // The torrents with the value for a key.
+        std::vector<libtorrent::info_hash_t> Find(const std::string& key, const nlohmann::json& value);
+
+    private:
+        struct Hash
+        {
+            std::size_t operator()(const libtorrent::info_hash_t& hash) const
+            {
+                const auto best = hash.get_best();
+                return std::hash<std::string_view>{}(std::string_view(best.data(), best.size()));
+            }
+        };
+
+        typedef std::map<std::string, std::set<libtorrent::info_hash_t>> Index;
+
+        Map Load(const libtorrent::info_hash_t& hash);
+        void Remove(const libtorrent::info_hash_t& hash);
+        void Unindex(const libtorrent::info_hash_t& hash, const std::string& key, const nlohmann::json& value);
+
+        ISession& m_session;
+        MetadataStoreOptions m_options;
+
+        std::mutex m_mtx;
+        Utils::LruCache<libtorrent::info_hash_t, Map, Hash> m_cache;
+        // Torrents by the dumped value, for each indexed key.
+        std::map<std::string, Index> m_indexes;
+
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
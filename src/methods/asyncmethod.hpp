@@ -0,0 +1,101 @@
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include "method.hpp"
+#include "../session.hpp"
+
+namespace porla::Methods
+{
+    namespace Async
+    {
+        // Awaits a session call which takes a callback. The result is posted to the
+        // coroutine's executor, since the session may call back before returning.
+        template<typename TResult, typename TInitiate>
+        boost::asio::awaitable<TResult> Await(TInitiate initiate)
+        {
+            return boost::asio::async_initiate<const boost::asio::use_awaitable_t<>&, void(TResult)>(
+                [initiate = std::move(initiate)](auto handler) mutable
+                {
+                    // The session keeps callbacks in std::function, which must be copyable.
+                    auto shared = std::make_shared<decltype(handler)>(std::move(handler));
+
+                    initiate([shared](TResult result)
+                    {
+                        const auto executor = boost::asio::get_associated_executor(*shared);
+
+                        boost::asio::post(
+                            executor,
+                            [shared, result = std::move(result)]() mutable { (*shared)(std::move(result)); });
+                    });
+                },
+                boost::asio::use_awaitable);
+        }
+
+        inline boost::asio::awaitable<ISession::PeerInfoList> PeerInfo(ISession& session, const libtorrent::info_hash_t& hash)
+        {
+            return Await<ISession::PeerInfoList>([&session, hash](auto done) { session.PeerInfo(hash, std::move(done)); });
+        }
+
+        inline boost::asio::awaitable<ISession::FileProgressList> FileProgress(ISession& session, const libtorrent::info_hash_t& hash)
+        {
+            return Await<ISession::FileProgressList>([&session, hash](auto done) { session.FileProgress(hash, std::move(done)); });
+        }
+
+        inline boost::asio::awaitable<std::vector<ISession::AddTorrentResult>> AddTorrents(ISession& session, std::vector<libtorrent::add_torrent_params> params)
+        {
+            return Await<std::vector<ISession::AddTorrentResult>>(
+                [&session, params = std::move(params)](auto done) mutable { session.AddTorrents(std::move(params), std::move(done)); });
+        }
+    }
+
+    // A method written as a coroutine, for methods which wait on the session more than
+    // once. Each call runs on the io context and can co_await the session calls above
+    // without blocking it. An exception escaping the coroutine is written as an internal
+    // error.
+    template<typename TReq, typename TRes>
+    class AsyncMethod : public Method<TReq, TRes>
+    {
+    protected:
+        explicit AsyncMethod(boost::asio::io_context& io)
+            : m_io(io)
+        {
+        }
+
+        // The request is taken by value, since it has to outlive the first suspension.
+        virtual boost::asio::awaitable<void> InvokeAsync(TReq req, WriteCb<TRes> cb) = 0;
+
+    private:
+        void Invoke(const TReq& req, WriteCb<TRes> cb) final
+        {
+            boost::asio::co_spawn(
+                m_io,
+                InvokeAsync(req, cb),
+                [cb](const std::exception_ptr& ex) mutable
+                {
+                    if (!ex) return;
+
+                    try
+                    {
+                        std::rethrow_exception(ex);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        cb.Error(-32603, "Internal error", e.what());
+                    }
+                });
+        }
+
+        boost::asio::io_context& m_io;
+    };
+}
@@ -0,0 +1,59 @@
+#include "clustercall.hpp"
+
+using porla::ClusterCoordinator;
+using porla::Methods::ClusterCall;
+using porla::Methods::ClusterCallReq;
+using porla::Methods::ClusterCallRes;
+
+ClusterCall::ClusterCall(ClusterCoordinator* cluster)
+    : m_cluster(cluster)
+{
+}
+
+void ClusterCall::Invoke(const ClusterCallReq& req, WriteCb<ClusterCallRes> cb)
+{
+    if (m_cluster == nullptr)
+    {
+        return cb.Error(-1, "Cluster mode is not enabled");
+    }
+
+    if (req.method.starts_with("cluster."))
+    {
+        return cb.Error(-1, "Cluster methods cannot be called on the nodes");
+    }
+
+    const json params = req.params.value_or(json::object());
+
+    const auto done = [cb](std::vector<ClusterCoordinator::Reply> replies) mutable
+    {
+        cb.Ok(ClusterCallRes{ .replies = std::move(replies) });
+    };
+
+    try
+    {
+        if (params.contains("info_hash"))
+        {
+            return m_cluster->Route(
+                params["info_hash"].get<lt::info_hash_t>(),
+                req.method,
+                params,
+                [done](ClusterCoordinator::Reply reply) mutable { done({ std::move(reply) }); });
+        }
+
+        if (params.contains("info_hashes"))
+        {
+            return m_cluster->Split(
+                params["info_hashes"].get<std::vector<lt::info_hash_t>>(),
+                "info_hashes",
+                req.method,
+                params,
+                done);
+        }
+    }
+    catch (const json::exception&)
+    {
+        return cb.Error(-1, "Invalid info hash");
+    }
+
+    m_cluster->Gather(req.method, params, req.cached.value_or(false), done);
+}
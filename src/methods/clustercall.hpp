@@ -0,0 +1,22 @@
+#pragma once
+
+#include "method.hpp"
+#include "clustercall_reqres.hpp"
+
+namespace porla::Methods
+{
+    // Calls a method on the cluster nodes. Params with an info_hash go to the node which
+    // has the torrent, and info_hashes are split between the nodes which have them. Other
+    // calls go to every node.
+    class ClusterCall : public Method<ClusterCallReq, ClusterCallRes>
+    {
+    public:
+        explicit ClusterCall(ClusterCoordinator* cluster);
+
+    protected:
+        void Invoke(const ClusterCallReq& req, WriteCb<ClusterCallRes> cb) override;
+
+    private:
+        ClusterCoordinator* m_cluster;
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "../clustercoordinator.hpp"
+
+namespace porla::Methods
+{
+    struct ClusterCallReq
+    {
+        std::string method;
+        std::optional<nlohmann::json> params;
+        // Lets nodes which are slow or down answer with their last result. Only for
+        // read-only methods.
+        std::optional<bool> cached;
+    };
+
+    struct ClusterCallRes
+    {
+        std::vector<ClusterCoordinator::Reply> replies;
+    };
+}
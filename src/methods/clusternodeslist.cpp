@@ -0,0 +1,22 @@
+#include "clusternodeslist.hpp"
+
+using porla::Methods::ClusterNodesList;
+using porla::Methods::ClusterNodesListReq;
+using porla::Methods::ClusterNodesListRes;
+
+ClusterNodesList::ClusterNodesList(const porla::ClusterCoordinator* cluster)
+    : m_cluster(cluster)
+{
+}
+
+void ClusterNodesList::Invoke(const ClusterNodesListReq& req, WriteCb<ClusterNodesListRes> cb)
+{
+    if (m_cluster == nullptr)
+    {
+        return cb.Error(-1, "Cluster mode is not enabled");
+    }
+
+    cb.Ok(ClusterNodesListRes{
+        .nodes = m_cluster->Nodes()
+    });
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "method.hpp"
+#include "clusternodeslist_reqres.hpp"
+
+namespace porla::Methods
+{
+    class ClusterNodesList : public Method<ClusterNodesListReq, ClusterNodesListRes>
+    {
+    public:
+        explicit ClusterNodesList(const ClusterCoordinator* cluster);
+
+    protected:
+        void Invoke(const ClusterNodesListReq& req, WriteCb<ClusterNodesListRes> cb) override;
+
+    private:
+        const ClusterCoordinator* m_cluster;
+    };
+}
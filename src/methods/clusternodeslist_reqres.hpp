@@ -0,0 +1,16 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "../clustercoordinator.hpp"
+
+namespace porla::Methods
+{
+    struct ClusterNodesListReq {};
+
+    struct ClusterNodesListRes
+    {
+        std::map<std::string, ClusterCoordinator::NodeState> nodes;
+    };
+}
@@ -0,0 +1,86 @@
+#include "clustertorrentslist.hpp"
+
+#include <algorithm>
+
+using porla::ClusterCoordinator;
+using porla::Methods::ClusterTorrentsList;
+using porla::Methods::ClusterTorrentsListReq;
+using porla::Methods::ClusterTorrentsListRes;
+
+ClusterTorrentsList::ClusterTorrentsList(ClusterCoordinator* cluster)
+    : m_cluster(cluster)
+{
+}
+
+void ClusterTorrentsList::Invoke(const ClusterTorrentsListReq& req, WriteCb<ClusterTorrentsListRes> cb)
+{
+    if (m_cluster == nullptr)
+    {
+        return cb.Error(-1, "Cluster mode is not enabled");
+    }
+
+    const int page      = std::max(0, req.page.value_or(0));
+    const int page_size = std::max(1, req.page_size.value_or(50));
+    const auto order_by     = req.order_by.value_or("queue_position");
+    const auto order_by_dir = req.order_by_dir.value_or("asc");
+
+    json params = {
+        {"order_by", order_by},
+        {"order_by_dir", order_by_dir},
+        {"page", 0},
+        {"page_size", (page + 1) * page_size}
+    };
+
+    // The items are merged on these, so they are listed even when not asked for.
+    if (req.fields.has_value())
+    {
+        auto fields = *req.fields;
+
+        for (const auto& field : { std::string("info_hash"), order_by })
+        {
+            if (std::find(fields.begin(), fields.end(), field) == fields.end()) fields.push_back(field);
+        }
+
+        params["fields"] = fields;
+    }
+
+    if (req.filters.has_value())          params["filters"] = *req.filters;
+    if (req.include_metadata.has_value()) params["include_metadata"] = *req.include_metadata;
+
+    m_cluster->Gather(
+        "torrents.list",
+        params,
+        true,
+        [cb, page, page_size, order_by, order_by_dir](std::vector<ClusterCoordinator::Reply> replies) mutable
+        {
+            ClusterTorrentsListRes res{
+                .order_by     = order_by,
+                .order_by_dir = order_by_dir,
+                .page         = page,
+                .page_size    = page_size,
+                .torrents     = ClusterCoordinator::MergeSorted(
+                    replies,
+                    "torrents",
+                    order_by,
+                    order_by_dir == "desc",
+                    static_cast<std::size_t>(page) * page_size,
+                    page_size),
+                .torrents_total = 0
+            };
+
+            for (const auto& reply : replies)
+            {
+                const int total = reply.error.has_value() ? 0 : reply.result.value("torrents_total", 0);
+
+                res.nodes.insert({ reply.node, ClusterTorrentsListRes::Node{
+                    .cached         = reply.cached,
+                    .error          = reply.error,
+                    .torrents_total = total
+                }});
+
+                res.torrents_total += total;
+            }
+
+            cb.Ok(res);
+        });
+}
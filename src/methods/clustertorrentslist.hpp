@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../clustercoordinator.hpp"
+#include "method.hpp"
+#include "clustertorrentslist_reqres.hpp"
+
+namespace porla::Methods
+{
+    // Lists the torrents of every cluster node as one list. Every node is asked for all
+    // the torrents up to the end of the page, so deep pages cost more than on one node.
+    class ClusterTorrentsList : public Method<ClusterTorrentsListReq, ClusterTorrentsListRes>
+    {
+    public:
+        explicit ClusterTorrentsList(ClusterCoordinator* cluster);
+
+    protected:
+        void Invoke(const ClusterTorrentsListReq& req, WriteCb<ClusterTorrentsListRes> cb) override;
+
+    private:
+        ClusterCoordinator* m_cluster;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace porla::Methods
+{
+    struct ClusterTorrentsListReq
+    {
+        std::optional<std::vector<std::string>> fields;
+        std::optional<std::map<std::string, nlohmann::json>> filters;
+        std::optional<std::vector<std::string>> include_metadata;
+        std::optional<int> page;
+        std::optional<int> page_size;
+        std::optional<std::string> order_by;
+        std::optional<std::string> order_by_dir;
+    };
+
+    struct ClusterTorrentsListRes
+    {
+        struct Node
+        {
+            bool                       cached;
+            std::optional<std::string> error;
+            int                        torrents_total;
+        };
+
+        std::map<std::string, Node> nodes;
+        std::string                 order_by;
+        std::string                 order_by_dir;
+        int                         page;
+        int                         page_size;
+        // Items of torrents.list, with the node they are on set on node.
+        std::vector<nlohmann::json> torrents;
+        int                         torrents_total;
+    };
+}
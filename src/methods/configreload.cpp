@@ -0,0 +1,33 @@
+#include "configreload.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#include "../configreloader.hpp"
+
+using porla::Methods::ConfigReload;
+using porla::Methods::ConfigReloadReq;
+using porla::Methods::ConfigReloadRes;
+
+ConfigReload::ConfigReload(porla::ConfigReloader& reloader)
+    : m_reloader(reloader)
+{
+}
+
+void ConfigReload::Invoke(const ConfigReloadReq& req, WriteCb<ConfigReloadRes> cb)
+{
+    try
+    {
+        auto result = m_reloader.Reload();
+
+        return cb.Ok(ConfigReloadRes{
+            .presets   = result.presets,
+            .settings  = std::move(result.settings),
+            .workflows = result.workflows
+        });
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to reload configuration: " << ex.what();
+        return cb.Error(-1, std::string("Failed to reload configuration: ") + ex.what());
+    }
+}
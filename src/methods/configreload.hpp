@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "configreload_reqres.hpp"
+
+namespace porla
+{
+    class ConfigReloader;
+}
+
+namespace porla::Methods
+{
+    class ConfigReload : public Method<ConfigReloadReq, ConfigReloadRes>
+    {
+    public:
+        explicit ConfigReload(ConfigReloader& reloader);
+
+    protected:
+        void Invoke(const ConfigReloadReq& req, WriteCb<ConfigReloadRes> cb) override;
+
+    private:
+        ConfigReloader& m_reloader;
+    };
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace porla::Methods
+{
+    struct ConfigReloadReq {};
+
+    struct ConfigReloadRes
+    {
+        int                      presets;
+        std::vector<std::string> settings;
+        int                      workflows;
+    };
+}
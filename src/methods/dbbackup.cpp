@@ -0,0 +1,54 @@
+#include "dbbackup.hpp"
+
+#include "../data/backup.hpp"
+
+using porla::Data::BackupStatus;
+using porla::Methods::DbBackup;
+using porla::Methods::DbBackupReq;
+using porla::Methods::DbBackupRes;
+
+static std::string StateName(BackupStatus::State state)
+{
+    switch (state)
+    {
+    case BackupStatus::State::Idle:    return "idle";
+    case BackupStatus::State::Running: return "running";
+    case BackupStatus::State::Done:    return "done";
+    case BackupStatus::State::Failed:  return "failed";
+    }
+
+    return "unknown";
+}
+
+DbBackup::DbBackup(porla::Data::Backup& backup)
+    : m_backup(backup)
+{
+}
+
+DbBackupRes DbBackup::ToRes(const BackupStatus& status)
+{
+    return DbBackupRes{
+        .destination     = status.destination,
+        .error           = status.error,
+        .pages_remaining = status.pages_remaining,
+        .pages_total     = status.pages_total,
+        .state           = StateName(status.state)
+    };
+}
+
+// The backup runs on a thread of its own, so this only starts it. Progress is
+// available from db.backup.status.
+void DbBackup::Invoke(const DbBackupReq& req, WriteCb<DbBackupRes> cb)
+{
+    if (req.path.empty())
+    {
+        return cb.Error(-1, "A path is required");
+    }
+
+    if (!m_backup.Start(req.path))
+    {
+        return cb.Error(-1, "A backup is already running");
+    }
+
+    cb.Ok(ToRes(m_backup.Status()));
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "method.hpp"
+#include "dbbackup_reqres.hpp"
+
+namespace porla::Data
+{
+    class Backup;
+    struct BackupStatus;
+}
+
+namespace porla::Methods
+{
+    class DbBackup : public Method<DbBackupReq, DbBackupRes>
+    {
+    public:
+        explicit DbBackup(Data::Backup& backup);
+
+        static DbBackupRes ToRes(const Data::BackupStatus& status);
+
+    protected:
+        void Invoke(const DbBackupReq& req, WriteCb<DbBackupRes> cb) override;
+
+    private:
+        Data::Backup& m_backup;
+    };
+}
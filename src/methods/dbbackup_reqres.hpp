@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+namespace porla::Methods
+{
+    struct DbBackupReq
+    {
+        std::string path;
+    };
+
+    // The state of the latest backup, which is the one just started for db.backup.
+    struct DbBackupRes
+    {
+        std::string destination;
+        std::string error;
+        int         pages_remaining;
+        int         pages_total;
+        std::string state;
+    };
+}
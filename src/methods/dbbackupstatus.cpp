@@ -0,0 +1,18 @@
+#include "dbbackupstatus.hpp"
+
+#include "dbbackup.hpp"
+#include "../data/backup.hpp"
+
+using porla::Methods::DbBackupStatus;
+using porla::Methods::DbBackupStatusReq;
+using porla::Methods::DbBackupStatusRes;
+
+DbBackupStatus::DbBackupStatus(porla::Data::Backup& backup)
+    : m_backup(backup)
+{
+}
+
+void DbBackupStatus::Invoke(const DbBackupStatusReq& req, WriteCb<DbBackupStatusRes> cb)
+{
+    cb.Ok(DbBackup::ToRes(m_backup.Status()));
+}
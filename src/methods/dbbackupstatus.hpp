@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "dbbackupstatus_reqres.hpp"
+
+namespace porla::Data
+{
+    class Backup;
+}
+
+namespace porla::Methods
+{
+    class DbBackupStatus : public Method<DbBackupStatusReq, DbBackupStatusRes>
+    {
+    public:
+        explicit DbBackupStatus(Data::Backup& backup);
+
+    protected:
+        void Invoke(const DbBackupStatusReq& req, WriteCb<DbBackupStatusRes> cb) override;
+
+    private:
+        Data::Backup& m_backup;
+    };
+}
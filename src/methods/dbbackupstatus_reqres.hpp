@@ -0,0 +1,10 @@
+#pragma once
+
+#include "dbbackup_reqres.hpp"
+
+namespace porla::Methods
+{
+    struct DbBackupStatusReq {};
+
+    typedef DbBackupRes DbBackupStatusRes;
+}
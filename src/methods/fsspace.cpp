@@ -1,11 +1,21 @@
 #include "fsspace.hpp"
 
+#include <chrono>
 #include <filesystem>
+#include <map>
+#include <mutex>
 #include <optional>
-#include <regex>
 
 #include <boost/log/trivial.hpp>
 #include <sys/quota.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+#include "../utils/mounttable.hpp"
 
 namespace fs = std::filesystem;
 
@@ -14,13 +24,32 @@ using porla::Methods::FsSpaceReq;
 using porla::Methods::FsSpaceRes;
 using porla::Methods::FsSpaceQuota;
 
-FsSpace::FsSpace() = default;
+// Quotas change as files are written, but the UI polls a handful of paths every few
+// seconds, so a result is reused for a little while.
+static constexpr std::chrono::seconds QuotaTtl(5);
 
-std::optional<std::string> GetBlockDeviceFromPath(const std::string& path)
+struct FsSpace::QuotaCache
 {
-#ifdef __linux__
-    static const auto mountpoint_re = std::regex(R"(^([\d]+)\s([\d]+)\s([\d]+:[\d]+)\s([a-zA-Z\d\/:\[\]]+)\s([a-zA-Z\d\/\.-]+)\s([a-zA-Z\d\,]+)\s([a-zA-Z\d\/:\s]+)\s-\s([a-zA-Z0-9\.]+)\s([a-zA-Z\d\/_-]+)\s([a-zA-Z\d\/:\s=,_]+)$)");
+    struct Entry
+    {
+        std::chrono::steady_clock::time_point expires;
+        std::optional<FsSpaceQuota>           quota;
+    };
+
+    std::mutex                   mtx;
+    std::map<std::string, Entry> entries;
+};
+
+// Nothing here touches the session, so the whole method can run on the pool.
+FsSpace::FsSpace(porla::WorkerPool* pool)
+    : Method(pool, true)
+    , m_quotas(std::make_shared<QuotaCache>())
+{
+}
 
+static std::optional<std::string> GetBlockDeviceFromPath(const std::string& path)
+{
+#ifdef __linux__
     struct stat fs{};
     if (stat(path.c_str(), &fs) < 0)
     {
@@ -28,66 +57,72 @@ std::optional<std::string> GetBlockDeviceFromPath(const std::string& path)
         return std::nullopt;
     }
 
-    std::stringstream minmaj_stream;
-    minmaj_stream << static_cast<int>(fs.st_dev >> 8);
-    minmaj_stream << ":";
-    minmaj_stream << static_cast<int>(fs.st_dev & 0xff);
-    std::string minmaj = minmaj_stream.str();
-
-    std::ifstream mountinfo("/proc/self/mountinfo");
-    std::string line;
-
-    while (std::getline(mountinfo, line))
+    if (const auto mount = porla::Utils::MountTable::Instance().Find({ major(fs.st_dev), minor(fs.st_dev) }))
     {
-        std::smatch matches;
-
-        if (std::regex_search(line, matches, mountpoint_re))
-        {
-            if (matches[3] == minmaj)
-            {
-                return matches[9];
-            }
-        }
-        else
-        {
-            BOOST_LOG_TRIVIAL(debug) << "Mount point line did not match: " << line;
-        }
+        return mount->source;
     }
 #endif
 
     return std::nullopt;
 }
 
-std::optional<FsSpaceQuota> GetQuota(const std::string& path)
+static std::optional<FsSpaceQuota> GetQuota(const std::string& block_device)
 {
 #ifdef __linux__
-    if (auto block_device = GetBlockDeviceFromPath(path))
+    const int cmd = QCMD(Q_GETQUOTA, USRQUOTA);
+    dqblk blk = {};
+
+    if (quotactl(cmd, block_device.c_str(), static_cast<int>(getuid()), reinterpret_cast<char*>(&blk)) < 0)
+    {
+        BOOST_LOG_TRIVIAL(debug) << "quotactl error for " << block_device << ": " << errno;
+        return std::nullopt;
+    }
+
+    return FsSpaceQuota{
+        .blocks_limit_hard = blk.dqb_bhardlimit,
+        .blocks_limit_soft = blk.dqb_bsoftlimit,
+        .blocks_time       = blk.dqb_btime,
+        .current_inodes    = blk.dqb_curinodes,
+        .current_space     = blk.dqb_curspace,
+        .inodes_limit_hard = blk.dqb_ihardlimit,
+        .inodes_limit_soft = blk.dqb_isoftlimit,
+        .inodes_time       = blk.dqb_itime
+    };
+#else
+    return std::nullopt;
+#endif
+}
+
+std::optional<FsSpaceQuota> FsSpace::Quota(const std::string& path) const
+{
+    const auto block_device = GetBlockDeviceFromPath(path);
+
+    if (!block_device.has_value())
     {
-        BOOST_LOG_TRIVIAL(info) << "Found block device: " << *block_device;
+        return std::nullopt;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
 
-        const int cmd = QCMD(Q_GETQUOTA, USRQUOTA);
-        dqblk blk = {};
+    {
+        std::unique_lock lock(m_quotas->mtx);
 
-        if (quotactl(cmd, block_device->c_str(), static_cast<int>(getuid()), reinterpret_cast<char*>(&blk)) < 0)
+        if (const auto entry = m_quotas->entries.find(*block_device);
+            entry != m_quotas->entries.end() && entry->second.expires > now)
         {
-            BOOST_LOG_TRIVIAL(error) << "quotactl error: " << errno;
-            return std::nullopt;
+            return entry->second.quota;
         }
-
-        return FsSpaceQuota{
-            .blocks_limit_hard = blk.dqb_bhardlimit,
-            .blocks_limit_soft = blk.dqb_bsoftlimit,
-            .blocks_time       = blk.dqb_btime,
-            .current_inodes    = blk.dqb_curinodes,
-            .current_space     = blk.dqb_curspace,
-            .inodes_limit_hard = blk.dqb_ihardlimit,
-            .inodes_limit_soft = blk.dqb_isoftlimit,
-            .inodes_time       = blk.dqb_itime
-        };
     }
-#endif
 
-    return std::nullopt;
+    // Not held while calling quotactl, which may block on a slow device.
+    auto quota = GetQuota(*block_device);
+
+    std::unique_lock lock(m_quotas->mtx);
+
+    std::erase_if(m_quotas->entries, [&now](const auto& item) { return item.second.expires <= now; });
+    m_quotas->entries.insert_or_assign(*block_device, QuotaCache::Entry{ .expires = now + QuotaTtl, .quota = quota });
+
+    return quota;
 }
 
 void FsSpace::Invoke(const FsSpaceReq& req, WriteCb<FsSpaceRes> cb)
@@ -104,6 +139,6 @@ void FsSpace::Invoke(const FsSpaceReq& req, WriteCb<FsSpaceRes> cb)
         .available = space_info.available,
         .capacity  = space_info.capacity,
         .free      = space_info.free,
-        .quota     = GetQuota(req.path)
+        .quota     = Quota(req.path)
     });
 }
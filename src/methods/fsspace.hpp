@@ -1,17 +1,31 @@
 #pragma once
 
+#include <memory>
+#include <optional>
+#include <string>
+
 #include "../config.hpp"
 #include "method.hpp"
 #include "fsspace_reqres.hpp"
 
 namespace porla::Methods
 {
+    // Space and quota for the file system a path is on. The device is looked up in the
+    // cached mount table, and quotas are cached per device for a few seconds.
     class FsSpace : public Method<FsSpaceReq, FsSpaceRes>
     {
     public:
-        explicit FsSpace();
+        explicit FsSpace(WorkerPool* pool = nullptr);
 
     protected:
         void Invoke(const FsSpaceReq& req, WriteCb<FsSpaceRes> cb) override;
+
+    private:
+        struct QuotaCache;
+
+        std::optional<FsSpaceQuota> Quota(const std::string& path) const;
+
+        // Shared by the copies of the method, which run on any of the pool threads.
+        std::shared_ptr<QuotaCache> m_quotas;
     };
 }
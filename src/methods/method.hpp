@@ -1,12 +1,19 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
 #include "../json/all.hpp"
+#include "../json/writer.hpp"
 #include "../httpcontext.hpp"
+#include "../tracing.hpp"
+#include "../utils/encoding.hpp"
+#include "../workerpool.hpp"
 
 using json = nlohmann::json;
 
@@ -24,8 +31,7 @@ namespace porla::Methods
 
         void operator()(const TRes& res)
         {
-            json d = res;
-            Ok(d);
+            Ok(json(res));
         }
 
         void operator()(const json& j)
@@ -46,13 +52,82 @@ namespace porla::Methods
             });
         }
 
-        void Ok(const json& result)
+        // The result is moved into the envelope, so a result built for the call is never
+        // copied on its way to the response body.
+        void Ok(json result)
         {
-            m_ctx->WriteJson({
-                {"jsonrpc", "2.0"},
-                {"id", m_id},
-                {"result", result}
+            json envelope = json::object();
+            envelope["jsonrpc"] = "2.0";
+            envelope["id"]      = m_id;
+            envelope["result"]  = std::move(result);
+
+            m_ctx->WriteJson(envelope);
+        }
+
+        // Same as Ok with the items set on result[key], but the items are serialized one at
+        // a time into a chunked response instead of building the whole document first.
+        // Binary encodings are not streamed. Anything the items point into, such as the
+        // arena their strings are allocated from, is kept until the last chunk is written.
+        template<typename TItem>
+        void OkStreamed(json result, const std::string& key, std::vector<TItem> items, std::shared_ptr<void> keep = nullptr)
+        {
+            // Items are serialized until a chunk is at least this large.
+            static constexpr std::size_t ChunkSize = 64 * 1024;
+
+            using porla::Utils::Encoding;
+
+            const auto accept = m_ctx->Request().find(boost::beast::http::field::accept);
+
+            if (accept != m_ctx->Request().end()
+                && Encoding::FromMediaType({accept->value().data(), accept->value().size()}) != Encoding::Type::Json)
+            {
+                result[key] = items;
+                return Ok(std::move(result));
+            }
+
+            // The envelope is written with the items left out and result left open, so the
+            // items can be added as its last member.
+            std::string head = json{{"jsonrpc", "2.0"}, {"id", m_id}, {"result", result}}.dump();
+            head.resize(head.size() - 2);
+            if (head.back() != '{') head.push_back(',');
+            head.append(json(key).dump()).append(":[");
+
+            struct State
+            {
+                std::string           head;
+                std::vector<TItem>    items;
+                std::shared_ptr<void> keep;
+                std::size_t           pos = 0;
+            };
+
+            auto state = std::make_shared<State>(State{
+                .head  = std::move(head),
+                .items = std::move(items),
+                .keep  = std::move(keep)
             });
+
+            m_ctx->WriteChunked(
+                "application/json",
+                [state](std::string& chunk)
+                {
+                    chunk.swap(state->head);
+
+                    // Items are written straight into the chunk, without a document of
+                    // their own each.
+                    while (state->pos < state->items.size() && chunk.size() < ChunkSize)
+                    {
+                        if (state->pos > 0) chunk.push_back(',');
+                        porla::Json::Write(chunk, state->items[state->pos++]);
+                    }
+
+                    if (state->pos < state->items.size())
+                    {
+                        return true;
+                    }
+
+                    chunk.append("]}}");
+                    return false;
+                });
         }
 
     private:
@@ -64,12 +139,85 @@ namespace porla::Methods
     class Method
     {
     public:
-        void operator()(const nlohmann::json& id, const nlohmann::json& body, std::shared_ptr<porla::HttpContext> ctx)
+        void operator()(nlohmann::json&& id, nlohmann::json&& body, std::shared_ptr<porla::HttpContext> ctx)
         {
-            Invoke(body.get<TReq>(), WriteCb<TRes>(id, std::move(ctx)));
+            Run(
+                std::move(id),
+                [this, body = std::move(body)]() mutable { return Decode(std::move(body)); },
+                std::move(ctx));
         }
 
     protected:
+        Method() = default;
+
+        // Decodes the request on the worker pool, and invokes it there too if the method does
+        // not touch the session. Otherwise Invoke still runs on the io thread.
+        explicit Method(WorkerPool* pool, bool invoke_on_pool = false)
+            : m_pool(pool)
+            , m_invoke_on_pool(invoke_on_pool)
+        {
+        }
+
+        // Builds the request with decode, on the worker pool if there is one, and invokes
+        // the method with it. For requests that do not come from JSON-RPC params.
+        // The id is moved along with the request, and into the callback at the end.
+        void Run(nlohmann::json id, std::function<TReq()> decode, std::shared_ptr<porla::HttpContext> ctx)
+        {
+            if (m_pool == nullptr)
+            {
+                Invoke(decode(), WriteCb<TRes>(std::move(id), std::move(ctx)));
+                return;
+            }
+
+            // The task gets a copy of the id, which is kept here for the busy error.
+            const bool posted = m_pool->Post(
+                [this, id, decode = std::move(decode), ctx]() mutable
+                {
+                    TraceScope scope(ctx->Trace());
+                    std::shared_ptr<TReq> req;
+
+                    try
+                    {
+                        req = std::make_shared<TReq>(decode());
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        return m_pool->Context(ctx)->WriteJson({
+                            {"error", {
+                                {"code", -32603},
+                                {"message", "Internal error"},
+                                {"data", ex.what()}
+                            }}
+                        });
+                    }
+
+                    if (m_invoke_on_pool)
+                    {
+                        return Invoke(*req, WriteCb<TRes>(std::move(id), m_pool->Context(ctx)));
+                    }
+
+                    m_pool->Complete(
+                        [this, id = std::move(id), req, ctx]() mutable
+                        {
+                            TraceScope scope(ctx->Trace());
+                            Invoke(*req, WriteCb<TRes>(std::move(id), ctx));
+                        });
+                });
+
+            if (!posted)
+            {
+                WriteCb<TRes>(id, std::move(ctx)).Error(-32000, "Server busy - too many queued requests");
+            }
+        }
+
+        // Converts the params to the request. Methods with large members override this to
+        // move them out of the params instead of copying.
+        virtual TReq Decode(nlohmann::json&& body) { return body.get<TReq>(); }
+
         virtual void Invoke(const TReq& req, WriteCb<TRes>) = 0;
+
+    private:
+        WorkerPool* m_pool = nullptr;
+        bool m_invoke_on_pool = false;
     };
 }
@@ -0,0 +1,19 @@
+#include "peerclasseslist.hpp"
+
+#include "../session.hpp"
+
+using porla::Methods::PeerClassesList;
+using porla::Methods::PeerClassesListReq;
+using porla::Methods::PeerClassesListRes;
+
+PeerClassesList::PeerClassesList(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void PeerClassesList::Invoke(const PeerClassesListReq& req, WriteCb<PeerClassesListRes> cb)
+{
+    cb.Ok(PeerClassesListRes{
+        .peer_classes = m_session.PeerClasses()
+    });
+}
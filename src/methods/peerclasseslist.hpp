@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "peerclasseslist_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class PeerClassesList : public Method<PeerClassesListReq, PeerClassesListRes>
+    {
+    public:
+        explicit PeerClassesList(ISession& session);
+
+    protected:
+        void Invoke(const PeerClassesListReq& req, WriteCb<PeerClassesListRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+#include "../peerclass.hpp"
+
+namespace porla::Methods
+{
+    struct PeerClassesListReq {};
+
+    struct PeerClassesListRes
+    {
+        std::vector<PeerClass> peer_classes;
+    };
+}
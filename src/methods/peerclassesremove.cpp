@@ -0,0 +1,22 @@
+#include "peerclassesremove.hpp"
+
+#include "../session.hpp"
+
+using porla::Methods::PeerClassesRemove;
+using porla::Methods::PeerClassesRemoveReq;
+using porla::Methods::PeerClassesRemoveRes;
+
+PeerClassesRemove::PeerClassesRemove(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void PeerClassesRemove::Invoke(const PeerClassesRemoveReq& req, WriteCb<PeerClassesRemoveRes> cb)
+{
+    if (!m_session.RemovePeerClass(req.name))
+    {
+        return cb.Error(-1, "Unknown peer class: " + req.name);
+    }
+
+    cb.Ok(PeerClassesRemoveRes{});
+}
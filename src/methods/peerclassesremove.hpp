@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "peerclassesremove_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class PeerClassesRemove : public Method<PeerClassesRemoveReq, PeerClassesRemoveRes>
+    {
+    public:
+        explicit PeerClassesRemove(ISession& session);
+
+    protected:
+        void Invoke(const PeerClassesRemoveReq& req, WriteCb<PeerClassesRemoveRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
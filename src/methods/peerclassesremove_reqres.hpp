@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+namespace porla::Methods
+{
+    struct PeerClassesRemoveReq
+    {
+        std::string name;
+    };
+
+    struct PeerClassesRemoveRes {};
+}
@@ -0,0 +1,46 @@
+#include "peerclassesset.hpp"
+
+#include <algorithm>
+
+#include "../session.hpp"
+
+using porla::Methods::PeerClassesSet;
+using porla::Methods::PeerClassesSetReq;
+using porla::Methods::PeerClassesSetRes;
+
+PeerClassesSet::PeerClassesSet(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void PeerClassesSet::Invoke(const PeerClassesSetReq& req, WriteCb<PeerClassesSetRes> cb)
+{
+    if (req.name.empty())
+    {
+        return cb.Error(-1, "A name is required");
+    }
+
+    if ((req.download_priority.has_value() && (*req.download_priority < 1 || *req.download_priority > 255))
+        || (req.upload_priority.has_value() && (*req.upload_priority < 1 || *req.upload_priority > 255)))
+    {
+        return cb.Error(-1, "Priorities must be between 1 and 255");
+    }
+
+    const auto existing = m_session.PeerClasses();
+    const auto current  = std::find_if(
+        existing.begin(),
+        existing.end(),
+        [&req](const PeerClass& pc) { return pc.name == req.name; });
+
+    PeerClass peer_class = current != existing.end() ? *current : PeerClass{ .name = req.name };
+
+    if (req.categories.has_value())        peer_class.categories        = *req.categories;
+    if (req.download_limit.has_value())    peer_class.download_limit    = std::max(0, *req.download_limit);
+    if (req.download_priority.has_value()) peer_class.download_priority = *req.download_priority;
+    if (req.upload_limit.has_value())      peer_class.upload_limit      = std::max(0, *req.upload_limit);
+    if (req.upload_priority.has_value())   peer_class.upload_priority   = *req.upload_priority;
+
+    m_session.SetPeerClass(peer_class);
+
+    cb.Ok(PeerClassesSetRes{});
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "peerclassesset_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class PeerClassesSet : public Method<PeerClassesSetReq, PeerClassesSetRes>
+    {
+    public:
+        explicit PeerClassesSet(ISession& session);
+
+    protected:
+        void Invoke(const PeerClassesSetReq& req, WriteCb<PeerClassesSetRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
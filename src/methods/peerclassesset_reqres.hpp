@@ -0,0 +1,22 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace porla::Methods
+{
+    // Creates the peer class, or updates it when it exists. Fields left out keep their
+    // current values, or the defaults for a new class.
+    struct PeerClassesSetReq
+    {
+        std::optional<std::vector<std::string>> categories;
+        std::optional<int>                      download_limit;
+        std::optional<int>                      download_priority;
+        std::string                             name;
+        std::optional<int>                      upload_limit;
+        std::optional<int>                      upload_priority;
+    };
+
+    struct PeerClassesSetRes {};
+}
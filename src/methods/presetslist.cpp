@@ -1,17 +1,27 @@
 #include "presetslist.hpp"
 
+#include "../responsecache.hpp"
+
 using porla::Methods::PresetsList;
 using porla::Methods::PresetsListReq;
 using porla::Methods::PresetsListRes;
 
-PresetsList::PresetsList(const std::map<std::string, Config::Preset>& presets)
+PresetsList::PresetsList(const std::map<std::string, Config::Preset>& presets, ResponseCache& cache)
     : m_presets(presets)
+    , m_cache(cache)
 {
 }
 
 void PresetsList::Invoke(const PresetsListReq& req, WriteCb<PresetsListRes> cb)
 {
-    cb.Ok(PresetsListRes{
-        .presets = m_presets
-    });
+    const auto presets = m_cache.Get(
+        Key,
+        [this]()
+        {
+            return json(PresetsListRes{
+                .presets = m_presets
+            });
+        });
+
+    cb(*presets);
 }
@@ -4,17 +4,27 @@
 #include "method.hpp"
 #include "presetslist_reqres.hpp"
 
+namespace porla
+{
+    class ResponseCache;
+}
+
 namespace porla::Methods
 {
+    // The presets are serialized once and kept in the response cache under Key, which
+    // reloading the config invalidates.
     class PresetsList : public Method<PresetsListReq, PresetsListRes>
     {
     public:
-        explicit PresetsList(const std::map<std::string, Config::Preset>& presets);
+        static constexpr const char* Key = "presets.list";
+
+        explicit PresetsList(const std::map<std::string, Config::Preset>& presets, ResponseCache& cache);
 
     protected:
         void Invoke(const PresetsListReq& req, WriteCb<PresetsListRes> cb) override;
 
     private:
         const std::map<std::string, Config::Preset>& m_presets;
+        ResponseCache& m_cache;
     };
 }
@@ -0,0 +1,78 @@
+#include "sessionalertsdebug.hpp"
+
+#include <map>
+
+#include <libtorrent/alert.hpp>
+
+#include "../session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Methods::SessionAlertsDebug;
+using porla::Methods::SessionAlertsDebugReq;
+using porla::Methods::SessionAlertsDebugRes;
+
+static const std::map<std::string, lt::alert_category_t> Categories =
+{
+    {"block_progress",    lt::alert_category::block_progress},
+    {"connect",           lt::alert_category::connect},
+    {"dht",               lt::alert_category::dht},
+    {"dht_log",           lt::alert_category::dht_log},
+    {"dht_operation",     lt::alert_category::dht_operation},
+    {"error",             lt::alert_category::error},
+    {"file_progress",     lt::alert_category::file_progress},
+    {"incoming_request",  lt::alert_category::incoming_request},
+    {"ip_block",          lt::alert_category::ip_block},
+    {"peer",              lt::alert_category::peer},
+    {"peer_log",          lt::alert_category::peer_log},
+    {"performance",       lt::alert_category::performance_warning},
+    {"picker_log",        lt::alert_category::picker_log},
+    {"piece_progress",    lt::alert_category::piece_progress},
+    {"port_mapping",      lt::alert_category::port_mapping},
+    {"port_mapping_log",  lt::alert_category::port_mapping_log},
+    {"session_log",       lt::alert_category::session_log},
+    {"stats",             lt::alert_category::stats},
+    {"status",            lt::alert_category::status},
+    {"storage",           lt::alert_category::storage},
+    {"torrent_log",       lt::alert_category::torrent_log},
+    {"tracker",           lt::alert_category::tracker},
+    {"upload",            lt::alert_category::upload}
+};
+
+SessionAlertsDebug::SessionAlertsDebug(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void SessionAlertsDebug::Invoke(const SessionAlertsDebugReq& req, WriteCb<SessionAlertsDebugRes> cb)
+{
+    if (req.categories.has_value())
+    {
+        lt::alert_category_t categories{};
+
+        for (const auto& name : *req.categories)
+        {
+            const auto category = Categories.find(name);
+
+            if (category == Categories.end())
+            {
+                return cb.Error(-1, "Unknown alert category: " + name);
+            }
+
+            categories |= category->second;
+        }
+
+        m_session.SetDebugAlerts(categories);
+    }
+
+    const auto current = m_session.DebugAlerts();
+
+    SessionAlertsDebugRes res;
+
+    for (const auto& [name, category] : Categories)
+    {
+        if (current & category) res.categories.push_back(name);
+    }
+
+    cb.Ok(res);
+}
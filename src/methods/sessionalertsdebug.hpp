@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessionalertsdebug_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    // Logs the alerts of the given categories, such as "peer" or "dht", until they are
+    // cleared again. Responds with the categories being logged.
+    class SessionAlertsDebug : public Method<SessionAlertsDebugReq, SessionAlertsDebugRes>
+    {
+    public:
+        explicit SessionAlertsDebug(ISession& session);
+
+    protected:
+        void Invoke(const SessionAlertsDebugReq& req, WriteCb<SessionAlertsDebugRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
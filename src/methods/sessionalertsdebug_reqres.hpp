@@ -0,0 +1,19 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace porla::Methods
+{
+    struct SessionAlertsDebugReq
+    {
+        // Replaces the logged categories when set. An empty list stops logging.
+        std::optional<std::vector<std::string>> categories;
+    };
+
+    struct SessionAlertsDebugRes
+    {
+        std::vector<std::string> categories;
+    };
+}
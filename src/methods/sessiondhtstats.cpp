@@ -0,0 +1,24 @@
+#include "sessiondhtstats.hpp"
+
+#include "../session.hpp"
+
+using porla::Methods::SessionDhtStats;
+
+SessionDhtStats::SessionDhtStats(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void SessionDhtStats::Invoke(const SessionDhtStatsReq& req, WriteCb<SessionDhtStatsRes> cb)
+{
+    auto stats = m_session.Dht();
+
+    if (!stats.has_value())
+    {
+        return cb.Error(-1, "The session does not report DHT stats");
+    }
+
+    cb(SessionDhtStatsRes{
+        .stats = std::move(*stats)
+    });
+}
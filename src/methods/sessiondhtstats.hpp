@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessiondhtstats_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    // The routing table and lookups of each DHT node, and when the DHT state was last
+    // written to disk.
+    class SessionDhtStats : public Method<SessionDhtStatsReq, SessionDhtStatsRes>
+    {
+    public:
+        explicit SessionDhtStats(ISession& session);
+
+    protected:
+        void Invoke(const SessionDhtStatsReq& req, WriteCb<SessionDhtStatsRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
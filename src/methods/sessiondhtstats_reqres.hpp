@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../session.hpp"
+
+namespace porla::Methods
+{
+    struct SessionDhtStatsReq {};
+
+    struct SessionDhtStatsRes
+    {
+        DhtStats stats;
+    };
+}
@@ -0,0 +1,25 @@
+#include "sessiondrain.hpp"
+
+#include "../session.hpp"
+
+using porla::Methods::SessionDrain;
+using porla::Methods::SessionDrainReq;
+using porla::Methods::SessionDrainRes;
+
+SessionDrain::SessionDrain(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void SessionDrain::Invoke(const SessionDrainReq& req, WriteCb<SessionDrainRes> cb)
+{
+    m_session.Drain(req.pause.value_or(false));
+
+    const auto progress = m_session.Draining();
+
+    cb.Ok(SessionDrainRes{
+        .drained = progress.drained,
+        .saving  = progress.saving,
+        .writes  = progress.writes
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessiondrain_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class SessionDrain : public Method<SessionDrainReq, SessionDrainRes>
+    {
+    public:
+        explicit SessionDrain(ISession& session);
+
+    protected:
+        void Invoke(const SessionDrainReq& req, WriteCb<SessionDrainRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+namespace porla::Methods
+{
+    struct SessionDrainReq
+    {
+        // Pauses the session too, so nothing needs saving again before it shuts down.
+        std::optional<bool> pause;
+    };
+
+    // Where draining is at. Called again, it saves what changed since, and drained is
+    // set once there is nothing left to save or write.
+    struct SessionDrainRes
+    {
+        bool        drained;
+        int         saving;
+        std::size_t writes;
+    };
+}
@@ -0,0 +1,22 @@
+#include "sessionpeerssummary.hpp"
+
+#include "../peeraggregates.hpp"
+
+using porla::Methods::SessionPeersSummary;
+
+SessionPeersSummary::SessionPeersSummary(const porla::PeerAggregates* aggregates)
+    : m_aggregates(aggregates)
+{
+}
+
+void SessionPeersSummary::Invoke(const SessionPeersSummaryReq& req, WriteCb<SessionPeersSummaryRes> cb)
+{
+    if (m_aggregates == nullptr)
+    {
+        return cb.Error(-1, "Peer aggregates are not enabled");
+    }
+
+    cb.Ok(SessionPeersSummaryRes{
+        .snapshot = m_aggregates->Get()
+    });
+}
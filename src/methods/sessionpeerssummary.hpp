@@ -0,0 +1,25 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessionpeerssummary_reqres.hpp"
+
+namespace porla
+{
+    class PeerAggregates;
+}
+
+namespace porla::Methods
+{
+    class SessionPeersSummary : public Method<SessionPeersSummaryReq, SessionPeersSummaryRes>
+    {
+    public:
+        // The aggregates are null when they are not enabled.
+        explicit SessionPeersSummary(const PeerAggregates* aggregates);
+
+    protected:
+        void Invoke(const SessionPeersSummaryReq& req, WriteCb<SessionPeersSummaryRes> cb) override;
+
+    private:
+        const PeerAggregates* m_aggregates;
+    };
+}
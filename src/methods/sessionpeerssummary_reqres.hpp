@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../peeraggregates.hpp"
+
+namespace porla::Methods
+{
+    struct SessionPeersSummaryReq {};
+
+    struct SessionPeersSummaryRes
+    {
+        PeerAggregates::Snapshot snapshot;
+    };
+}
@@ -0,0 +1,26 @@
+#include "sessionprofilesactivate.hpp"
+
+#include <stdexcept>
+
+#include "../sessionprofiles.hpp"
+
+using porla::Methods::SessionProfilesActivate;
+using porla::Methods::SessionProfilesActivateReq;
+using porla::Methods::SessionProfilesActivateRes;
+
+SessionProfilesActivate::SessionProfilesActivate(porla::SessionProfiles& profiles)
+    : m_profiles(profiles)
+{
+}
+
+void SessionProfilesActivate::Invoke(const SessionProfilesActivateReq& req, WriteCb<SessionProfilesActivateRes> cb)
+{
+    try
+    {
+        cb.Ok(SessionProfilesActivateRes{ .applied = m_profiles.Activate(req.name) });
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        cb.Error(-1, ex.what());
+    }
+}
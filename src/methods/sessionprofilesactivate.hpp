@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessionprofilesactivate_reqres.hpp"
+
+namespace porla
+{
+    class SessionProfiles;
+}
+
+namespace porla::Methods
+{
+    class SessionProfilesActivate : public Method<SessionProfilesActivateReq, SessionProfilesActivateRes>
+    {
+    public:
+        explicit SessionProfilesActivate(SessionProfiles& profiles);
+
+    protected:
+        void Invoke(const SessionProfilesActivateReq& req, WriteCb<SessionProfilesActivateRes> cb) override;
+
+    private:
+        SessionProfiles& m_profiles;
+    };
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+namespace porla::Methods
+{
+    struct SessionProfilesActivateReq
+    {
+        // Unset goes back to no profile.
+        std::optional<std::string> name;
+    };
+
+    struct SessionProfilesActivateRes
+    {
+        // The settings which differed from the session, and were applied.
+        int applied;
+    };
+}
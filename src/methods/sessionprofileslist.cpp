@@ -0,0 +1,20 @@
+#include "sessionprofileslist.hpp"
+
+#include "../sessionprofiles.hpp"
+
+using porla::Methods::SessionProfilesList;
+using porla::Methods::SessionProfilesListReq;
+using porla::Methods::SessionProfilesListRes;
+
+SessionProfilesList::SessionProfilesList(const porla::SessionProfiles& profiles)
+    : m_profiles(profiles)
+{
+}
+
+void SessionProfilesList::Invoke(const SessionProfilesListReq& req, WriteCb<SessionProfilesListRes> cb)
+{
+    cb.Ok(SessionProfilesListRes{
+        .active   = m_profiles.Active(),
+        .profiles = m_profiles.Profiles()
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessionprofileslist_reqres.hpp"
+
+namespace porla
+{
+    class SessionProfiles;
+}
+
+namespace porla::Methods
+{
+    class SessionProfilesList : public Method<SessionProfilesListReq, SessionProfilesListRes>
+    {
+    public:
+        explicit SessionProfilesList(const SessionProfiles& profiles);
+
+    protected:
+        void Invoke(const SessionProfilesListReq& req, WriteCb<SessionProfilesListRes> cb) override;
+
+    private:
+        const SessionProfiles& m_profiles;
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+
+#include <libtorrent/settings_pack.hpp>
+
+namespace porla::Methods
+{
+    struct SessionProfilesListReq {};
+
+    struct SessionProfilesListRes
+    {
+        std::optional<std::string> active;
+        std::map<std::string, libtorrent::settings_pack> profiles;
+    };
+}
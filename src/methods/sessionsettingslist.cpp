@@ -1,13 +1,15 @@
 #include "sessionsettingslist.hpp"
 
 #include "../session.hpp"
+#include "../settingstuner.hpp"
 
 using porla::Methods::SessionSettingsList;
 using porla::Methods::SessionSettingsListReq;
 using porla::Methods::SessionSettingsListRes;
 
-SessionSettingsList::SessionSettingsList(porla::ISession& session)
+SessionSettingsList::SessionSettingsList(porla::ISession& session, const porla::SettingsTuner* tuner)
     : m_session(session)
+    , m_tuner(tuner)
 {
 }
 
@@ -44,5 +46,25 @@ void SessionSettingsList::Invoke(const SessionSettingsListReq &req, WriteCb<Sess
         res.settings.insert({name,settings.get_str(i)});
     }
 
+    if (m_tuner != nullptr)
+    {
+        res.tuned = std::map<std::string, SessionSettingsListRes::Tuned>();
+
+        for (auto const& [name, choice] : m_tuner->Choices())
+        {
+            if (req.keys.has_value() && req.keys.value().find(name) == req.keys.value().end()) continue;
+
+            res.tuned->insert({name, SessionSettingsListRes::Tuned{
+                .changed_at = choice.changed_at,
+                .changes    = choice.changes,
+                .max        = choice.max,
+                .min        = choice.min,
+                .reason     = choice.reason,
+                .released   = choice.released,
+                .value      = choice.value
+            }});
+        }
+    }
+
     cb.Ok(res);
 }
@@ -6,6 +6,7 @@
 namespace porla
 {
     class ISession;
+    class SettingsTuner;
 }
 
 namespace porla::Methods
@@ -13,12 +14,13 @@ namespace porla::Methods
     class SessionSettingsList : public Method<SessionSettingsListReq, SessionSettingsListRes>
     {
     public:
-        explicit SessionSettingsList(ISession& session);
+        explicit SessionSettingsList(ISession& session, const SettingsTuner* tuner = nullptr);
 
     protected:
         void Invoke(const SessionSettingsListReq& req, WriteCb<SessionSettingsListRes> cb) override;
 
     private:
         ISession& m_session;
+        const SettingsTuner* m_tuner;
     };
 }
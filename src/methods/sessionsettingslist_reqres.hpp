@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <string>
 #include <unordered_set>
@@ -15,6 +17,19 @@ namespace porla::Methods
 
     struct SessionSettingsListRes
     {
+        // The value the settings tuner last chose for a setting, and why.
+        struct Tuned
+        {
+            std::int64_t  changed_at;
+            std::uint64_t changes;
+            int           max;
+            int           min;
+            std::string   reason;
+            bool          released;
+            int           value;
+        };
+
         std::map<std::string, nlohmann::json> settings;
+        std::optional<std::map<std::string, Tuned>> tuned;
     };
 }
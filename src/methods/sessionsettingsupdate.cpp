@@ -4,11 +4,13 @@
 
 #include "../data/models/sessionsettings.hpp"
 #include "../session.hpp"
+#include "../utils/settingspack.hpp"
 
 using porla::Data::Models::SessionSettings;
 using porla::Methods::SessionSettingsUpdate;
 using porla::Methods::SessionSettingsUpdateReq;
 using porla::Methods::SessionSettingsUpdateRes;
+using porla::Utils::SettingsPack;
 
 SessionSettingsUpdate::SessionSettingsUpdate(porla::ISession& session, sqlite3* db)
     : m_session(session)
@@ -18,60 +20,54 @@ SessionSettingsUpdate::SessionSettingsUpdate(porla::ISession& session, sqlite3*
 
 void SessionSettingsUpdate::Invoke(const SessionSettingsUpdateReq& req, WriteCb<SessionSettingsUpdateRes> cb)
 {
-    auto current_settings = m_session.Settings();
+    // The update is taken as a whole, so nothing is stored or applied unless every
+    // setting in it is valid.
+    lt::settings_pack requested;
+    json errors = json::array();
 
     for (auto const& [key,value] : req.settings)
     {
-        // Get the libtorrent type of this setting
-        const int type = lt::setting_by_name(key);
-
-        if (type == -1)
+        if (const auto error = SessionSettings::Set(requested, key, value))
         {
-            BOOST_LOG_TRIVIAL(warning) << "Invalid setting: " << key;
-            continue;
+            errors.push_back({{"key", key}, {"error", *error}});
         }
+    }
 
-        if (SessionSettings::BlockedKeys.contains(key))
-        {
-            continue;
-        }
+    if (!errors.empty())
+    {
+        return cb.Error(-1, "Invalid settings", {{"errors", errors}});
+    }
 
-        if ((type & lt::settings_pack::type_mask) == lt::settings_pack::bool_type_base)
-        {
-            if (!value.is_boolean())
-            {
-                BOOST_LOG_TRIVIAL(warning) << "Value for setting " << key << " is not a boolean";
-                continue;
-            }
+    // Every setting is stored, even the ones the session already has, so they survive a
+    // change of the config. Only the ones which differ are applied.
+    try
+    {
+        SessionSettings::Update(m_db, req.settings);
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to store session settings: " << ex.what();
+        return cb.Error(-2, "Failed to store settings");
+    }
 
-            current_settings.set_bool(type, value.get<bool>());
-            SessionSettings::Update(m_db, key, value);
-        }
-        else if((type & lt::settings_pack::type_mask) == lt::settings_pack::int_type_base)
-        {
-            if (!value.is_number_integer())
-            {
-                BOOST_LOG_TRIVIAL(warning) << "Value for setting " << key << " is not an integer";
-                continue;
-            }
+    auto const current = m_session.Settings();
 
-            current_settings.set_int(type, value.get<int>());
-            SessionSettings::Update(m_db, key, value);
-        }
-        else if((type & lt::settings_pack::type_mask) == lt::settings_pack::string_type_base)
-        {
-            if (!value.is_string())
-            {
-                BOOST_LOG_TRIVIAL(warning) << "Value for setting " << key << " is not a string";
-                continue;
-            }
+    lt::settings_pack changed;
+    int count = 0;
 
-            current_settings.set_str(type, value.get<std::string>());
-            SessionSettings::Update(m_db, key, value);
-        }
+    for (const int key : SettingsPack::Keys(requested))
+    {
+        if (SettingsPack::Equal(requested, current, key)) continue;
+
+        SettingsPack::Copy(changed, requested, key);
+        count++;
     }
 
-    m_session.ApplySettings(current_settings);
+    if (count > 0)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Applying " << count << " changed session setting(s)";
+        m_session.ApplySettings(changed);
+    }
 
     cb.Ok(SessionSettingsUpdateRes{});
 }
@@ -0,0 +1,39 @@
+#include "sessionstatshistory.hpp"
+
+#include <ctime>
+
+#include "../statshistory.hpp"
+
+using porla::Methods::SessionStatsHistory;
+using porla::Methods::SessionStatsHistoryReq;
+using porla::Methods::SessionStatsHistoryRes;
+
+SessionStatsHistory::SessionStatsHistory(const porla::StatsHistory& history)
+    : m_history(history)
+{
+}
+
+void SessionStatsHistory::Invoke(const SessionStatsHistoryReq& req, WriteCb<SessionStatsHistoryRes> cb)
+{
+    // Defaults to the last ten minutes of every metric kept.
+    const std::int64_t to   = req.to.value_or(std::time(nullptr));
+    const std::int64_t from = req.from.value_or(to - 600);
+
+    if (from > to)
+    {
+        return cb.Error(-1, "'from' must not be after 'to'");
+    }
+
+    auto range = m_history.Query(req.metrics.value_or(m_history.Metrics()), from, to, req.resolution);
+
+    if (!range.has_value())
+    {
+        return cb.Error(-2, "Unsupported resolution");
+    }
+
+    cb.Ok(SessionStatsHistoryRes{
+        .metrics    = std::move(range->values),
+        .resolution = range->resolution,
+        .start      = range->start
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "sessionstatshistory_reqres.hpp"
+
+namespace porla
+{
+    class StatsHistory;
+}
+
+namespace porla::Methods
+{
+    class SessionStatsHistory : public Method<SessionStatsHistoryReq, SessionStatsHistoryRes>
+    {
+    public:
+        explicit SessionStatsHistory(const StatsHistory& history);
+
+    protected:
+        void Invoke(const SessionStatsHistoryReq& req, WriteCb<SessionStatsHistoryRes> cb) override;
+
+    private:
+        const StatsHistory& m_history;
+    };
+}
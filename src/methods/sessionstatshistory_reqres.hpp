@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace porla::Methods
+{
+    struct SessionStatsHistoryReq
+    {
+        std::optional<std::int64_t>             from;
+        std::optional<std::vector<std::string>> metrics;
+        std::optional<int>                      resolution;
+        std::optional<std::int64_t>             to;
+    };
+
+    // Values are for consecutive slots of the given resolution, starting at start. Slots
+    // without samples are null.
+    struct SessionStatsHistoryRes
+    {
+        std::map<std::string, std::vector<std::optional<double>>> metrics;
+        int                                                       resolution;
+        std::int64_t                                              start;
+    };
+}
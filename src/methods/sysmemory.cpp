@@ -0,0 +1,24 @@
+#include "sysmemory.hpp"
+
+#include "../memoryaccounting.hpp"
+
+using porla::Methods::SysMemory;
+using porla::Methods::SysMemoryReq;
+using porla::Methods::SysMemoryRes;
+
+SysMemory::SysMemory(const porla::MemoryAccounting& memory)
+    : m_memory(memory)
+{
+}
+
+void SysMemory::Invoke(const SysMemoryReq& req, WriteCb<SysMemoryRes> cb)
+{
+    auto snapshot = m_memory.Sample();
+
+    cb.Ok(SysMemoryRes{
+        .heap_allocated = snapshot.process.heap_allocated,
+        .heap_free      = snapshot.process.heap_free,
+        .resident       = snapshot.process.resident,
+        .subsystems     = std::move(snapshot.subsystems)
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "sysmemory_reqres.hpp"
+
+namespace porla
+{
+    class MemoryAccounting;
+}
+
+namespace porla::Methods
+{
+    class SysMemory : public Method<SysMemoryReq, SysMemoryRes>
+    {
+    public:
+        explicit SysMemory(const MemoryAccounting& memory);
+
+    protected:
+        void Invoke(const SysMemoryReq& req, WriteCb<SysMemoryRes> cb) override;
+
+    private:
+        const MemoryAccounting& m_memory;
+    };
+}
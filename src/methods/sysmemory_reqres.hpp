@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "../memoryusage.hpp"
+
+namespace porla::Methods
+{
+    struct SysMemoryReq {};
+
+    // Subsystems are estimated, so their sum is below the resident size. The process
+    // figures are left out where the platform does not have them.
+    struct SysMemoryRes
+    {
+        std::optional<std::uint64_t>       heap_allocated;
+        std::optional<std::uint64_t>       heap_free;
+        std::optional<std::uint64_t>       resident;
+        std::map<std::string, MemoryUsage> subsystems;
+    };
+}
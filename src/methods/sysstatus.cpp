@@ -0,0 +1,32 @@
+#include "sysstatus.hpp"
+
+#include "../session.hpp"
+
+using porla::Methods::SysStatus;
+using porla::Methods::SysStatusReq;
+using porla::Methods::SysStatusRes;
+
+SysStatus::SysStatus(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+SysStatusRes SysStatus::ToRes(const porla::ISession& session)
+{
+    const auto loading  = session.Loading();
+    const auto draining = session.Draining();
+
+    return SysStatusRes{
+        .draining        = draining.draining,
+        .drained         = draining.drained,
+        .ready           = loading.done && !draining.draining,
+        .torrents_failed = loading.failed,
+        .torrents_loaded = loading.loaded,
+        .torrents_total  = loading.total
+    };
+}
+
+void SysStatus::Invoke(const SysStatusReq& req, WriteCb<SysStatusRes> cb)
+{
+    cb.Ok(ToRes(m_session));
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "sysstatus_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class SysStatus : public Method<SysStatusReq, SysStatusRes>
+    {
+    public:
+        explicit SysStatus(ISession& session);
+
+        static SysStatusRes ToRes(const ISession& session);
+
+    protected:
+        void Invoke(const SysStatusReq& req, WriteCb<SysStatusRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
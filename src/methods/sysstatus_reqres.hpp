@@ -0,0 +1,19 @@
+#pragma once
+
+namespace porla::Methods
+{
+    struct SysStatusReq {};
+
+    // Whether the stored torrents are loaded. Until they are, methods only see the ones
+    // loaded so far. A draining node is not ready, and drained once it has nothing left
+    // to save before it exits.
+    struct SysStatusRes
+    {
+        bool draining;
+        bool drained;
+        bool ready;
+        int  torrents_failed;
+        int  torrents_loaded;
+        int  torrents_total;
+    };
+}
@@ -7,10 +7,21 @@
 #include <toml++/toml.h>
 
 #include "../buildinfo.hpp"
+#include "../responsecache.hpp"
 
 using porla::Methods::SysVersions;
 
+SysVersions::SysVersions(ResponseCache& cache)
+    : m_cache(cache)
+{
+}
+
 void SysVersions::Invoke(const json &req, WriteCb<std::map<std::string, std::string>> cb)
+{
+    cb(*m_cache.Get("sys.versions", &SysVersions::Build));
+}
+
+json SysVersions::Build()
 {
     std::stringstream boost_version;
     boost_version << BOOST_VERSION / 100000 << "."
@@ -27,7 +38,7 @@ void SysVersions::Invoke(const json &req, WriteCb<std::map<std::string, std::str
         << TOML_LIB_MINOR << "."
         << TOML_LIB_PATCH;
 
-    cb.Ok({
+    return {
         {"porla", {
             {"branch", porla::BuildInfo::Branch()},
             {"commitish", porla::BuildInfo::Commitish()},
@@ -55,5 +66,5 @@ void SysVersions::Invoke(const json &req, WriteCb<std::map<std::string, std::str
         {"tomlplusplus", {
             {"version", toml_version.str()}
         }}
-    });
+    };
 }
@@ -5,11 +5,25 @@
 
 #include "method.hpp"
 
+namespace porla
+{
+    class ResponseCache;
+}
+
 namespace porla::Methods
 {
+    // Built once, since none of it changes while running.
     class SysVersions : public Method<json, std::map<std::string, std::string>>
     {
+    public:
+        explicit SysVersions(ResponseCache& cache);
+
     protected:
         void Invoke(const json& req, WriteCb<std::map<std::string, std::string>> cb) override;
+
+    private:
+        static json Build();
+
+        ResponseCache& m_cache;
     };
 }
@@ -1,11 +1,19 @@
 #include "torrentsadd.hpp"
 
+#include <stdexcept>
+
 #include <boost/log/trivial.hpp>
 #include <libtorrent/add_torrent_params.hpp>
+#include <libtorrent/announce_entry.hpp>
+#include <libtorrent/hasher.hpp>
 #include <libtorrent/magnet_uri.hpp>
 
+#include "../metadatastore.hpp"
+#include "../savepathquotas.hpp"
 #include "../session.hpp"
 #include "../torrentclientdata.hpp"
+#include "../torrentinfocache.hpp"
+#include "../torrentssnapshot.hpp"
 #include "../utils/base64.hpp"
 
 namespace lt = libtorrent;
@@ -13,7 +21,7 @@ namespace lt = libtorrent;
 using porla::Methods::TorrentsAdd;
 using porla::Methods::TorrentsAddReq;
 
-static void ApplyPreset(lt::add_torrent_params& p, const porla::Config::Preset& preset)
+static void ApplyPreset(lt::add_torrent_params& p, const std::string& name, const porla::Config::Preset& preset)
 {
     if (preset.download_limit.has_value())  p.download_limit  = preset.download_limit.value();
     if (preset.max_connections.has_value()) p.max_connections = preset.max_connections.value();
@@ -23,29 +31,219 @@ static void ApplyPreset(lt::add_torrent_params& p, const porla::Config::Preset&
     if (preset.upload_limit.has_value())    p.upload_limit    = preset.upload_limit.value();
 
     // Set our custom client data
+    p.userdata.get<porla::TorrentClientData>()->preset = porla::Symbol::Intern(name);
+
     if (preset.category.has_value())
-        p.userdata.get<porla::TorrentClientData>()->category = preset.category.value();
+        p.userdata.get<porla::TorrentClientData>()->category = porla::Symbol::Intern(preset.category.value());
 
     if (!preset.tags.empty())
-        p.userdata.get<porla::TorrentClientData>()->tags = preset.tags;
+        p.userdata.get<porla::TorrentClientData>()->tags = porla::SymbolSet(preset.tags);
+}
+
+lt::info_hash_t TorrentsAdd::PeekInfoHash(const TorrentsAddReq& req)
+{
+    lt::info_hash_t hash;
+
+    if (req.ti.has_value())
+    {
+        lt::error_code ec;
+        const lt::bdecode_node node = lt::bdecode(req.ti.value(), ec);
+
+        if (ec || node.type() != lt::bdecode_node::dict_t)
+        {
+            return hash;
+        }
+
+        const auto info = node.dict_find_dict("info");
+
+        if (!info)
+        {
+            return hash;
+        }
+
+        // The same hashes libtorrent takes of the info dict, SHA-256 for v2 and SHA-1
+        // for v1 and hybrid torrents.
+        const auto section = info.data_section();
+
+        if (info.dict_find_int_value("meta version", 1) >= 2)
+        {
+            hash.v2 = lt::hasher256(section).final();
+        }
+
+        if (!hash.has_v2() || info.dict_find_string("pieces"))
+        {
+            hash.v1 = lt::hasher(section).final();
+        }
+    }
+    else if (req.magnet_uri.has_value())
+    {
+        lt::error_code ec;
+        const auto params = lt::parse_magnet_uri(req.magnet_uri.value(), ec);
+
+        if (!ec)
+        {
+            hash = params.info_hashes;
+        }
+    }
+
+    return hash;
+}
+
+// The errors of parsing a torrent file, by their code.
+static std::string ParseErrorMessage(int code)
+{
+    switch (code)
+    {
+    case -1: return "Failed to bdecode 'ti' parameter";
+    case -9: return "Torrent file too large";
+    default: return "Failed to parse torrent_info from bdecoded data";
+    }
 }
 
-TorrentsAdd::TorrentsAdd(sqlite3* db, ISession& session, const std::map<std::string, Config::Preset>& presets)
-    : m_db(db)
+std::optional<TorrentsAdd::BuildError> TorrentsAdd::LoadTorrentInfo(
+    const TorrentsAddReq& req,
+    porla::TorrentInfoCache* torrents,
+    std::shared_ptr<lt::torrent_info>& ti)
+{
+    const auto result = torrents != nullptr
+        ? torrents->Parse(req.info_hash, req.ti.value())
+        : TorrentInfoCache::Load(req.ti.value(), {});
+
+    int code = -2;
+
+    switch (result.error)
+    {
+    case TorrentInfoCache::Error::None:
+        ti = result.ti;
+        return std::nullopt;
+    case TorrentInfoCache::Error::TooLarge:
+        BOOST_LOG_TRIVIAL(warning) << "Rejected torrent file: " << result.message;
+        code = -9;
+        break;
+    case TorrentInfoCache::Error::Decode:
+        BOOST_LOG_TRIVIAL(error) << "Failed to decode torrent file: " << result.message;
+        code = -1;
+        break;
+    case TorrentInfoCache::Error::Info:
+        BOOST_LOG_TRIVIAL(error) << "Failed to parse torrent file to info: " << result.message;
+        break;
+    }
+
+    return BuildError{ code, ParseErrorMessage(code) };
+}
+
+void TorrentsAdd::ParseTorrentInfo(TorrentsAddReq& req, porla::TorrentInfoCache* torrents)
+{
+    if (!req.ti.has_value())
+    {
+        return;
+    }
+
+    if (const auto error = LoadTorrentInfo(req, torrents, req.torrent_info))
+    {
+        req.torrent_info_error = error->code;
+    }
+}
+
+TorrentsAdd::TorrentsAdd(
+    ISession& session,
+    MetadataStore& metadata,
+    const std::map<std::string, Config::Preset>& presets,
+    WorkerPool* pool,
+    const TorrentsSnapshot* snapshot,
+    TorrentInfoCache* torrents,
+    SavePathQuotas* quotas)
+    : Method(pool)
     , m_session(session)
+    , m_metadata(metadata)
     , m_presets(presets)
+    , m_snapshot(snapshot)
+    , m_torrents(torrents)
+    , m_quotas(quotas)
 {
 }
 
-void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
+// Torrents the snapshot has are not parsed while decoding. Invoke checks the session
+// again, and parses the file there in the rare case the torrent was removed in between.
+static bool Known(const porla::TorrentsSnapshot* snapshot, const lt::info_hash_t& hash)
+{
+    return hash != lt::info_hash_t() && snapshot->Current()->torrents.contains(hash);
+}
+
+TorrentsAddReq TorrentsAdd::Decode(nlohmann::json&& body)
+{
+    auto req = ParseParams(std::move(body));
+
+    if (m_snapshot != nullptr && !Known(m_snapshot, req.info_hash))
+    {
+        ParseTorrentInfo(req, m_torrents);
+    }
+
+    return req;
+}
+
+TorrentsAddReq TorrentsAdd::Parse(nlohmann::json&& body, porla::TorrentInfoCache* torrents)
+{
+    auto req = ParseParams(std::move(body));
+    ParseTorrentInfo(req, torrents);
+    return req;
+}
+
+TorrentsAddReq TorrentsAdd::ParseParams(nlohmann::json&& body)
+{
+    // The torrent file is by far the largest member, so it is moved out of the params and
+    // decoded in its own buffer instead of being copied and decoded into a new one.
+    std::optional<std::string> ti;
+
+    if (auto it = body.find("ti"); it != body.end() && it->is_string())
+    {
+        ti = std::move(it->get_ref<std::string&>());
+        body.erase(it);
+
+        if (!porla::Utils::Base64::DecodeInPlace(*ti))
+        {
+            throw std::invalid_argument("Invalid base64 in 'ti' parameter");
+        }
+    }
+
+    auto req = body.get<TorrentsAddReq>();
+    req.ti        = std::move(ti);
+    req.info_hash = PeekInfoHash(req);
+
+    return req;
+}
+
+void TorrentsAdd::Upload(std::string ti, nlohmann::json params, std::shared_ptr<porla::HttpContext> ctx)
+{
+    Run(
+        nullptr,
+        [ti = std::move(ti), params = std::move(params), snapshot = m_snapshot, torrents = m_torrents]() mutable
+        {
+            // The file is already raw, so a base64 one in the params is not used.
+            params.erase("ti");
+
+            auto req = params.get<TorrentsAddReq>();
+            req.ti        = std::move(ti);
+            req.info_hash = PeekInfoHash(req);
+
+            if (snapshot != nullptr && !Known(snapshot, req.info_hash))
+            {
+                ParseTorrentInfo(req, torrents);
+            }
+
+            return req;
+        },
+        std::move(ctx));
+}
+
+std::optional<TorrentsAdd::BuildError> TorrentsAdd::Build(const TorrentsAddReq& req, lt::add_torrent_params& p) const
 {
-    lt::add_torrent_params p;
     p.userdata = lt::client_data_t(new TorrentClientData());
 
     // Apply the 'default' preset if it exists
     if (m_presets.find("default") != m_presets.end())
     {
-        ApplyPreset(p, m_presets.at("default"));
+        ApplyPreset(p, "default", m_presets.at("default"));
     }
 
     if (req.preset.has_value())
@@ -61,27 +259,26 @@ void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
         else if (preset_name != "default")
         {
             BOOST_LOG_TRIVIAL(debug) << "Applying preset " << preset_name;
-            ApplyPreset(p, preset->second);
+            ApplyPreset(p, preset_name, preset->second);
         }
     }
 
-    if (req.ti.has_value()) {
-        auto buffer = porla::Utils::Base64::Decode(req.ti.value());
-
-        lt::error_code ec;
-        lt::bdecode_node node = lt::bdecode(buffer, ec);
-
-        if (ec) {
-            BOOST_LOG_TRIVIAL(error) << "Failed to decode torrent file: " << ec.message();
-            return cb.Error(-1, "Failed to bdecode 'ti' parameter");
-        }
-
-        p.ti = std::make_shared<lt::torrent_info>(node, ec);
-
-        if (ec)
+    if (req.torrent_info)
+    {
+        p.ti = req.torrent_info;
+    }
+    else if (req.torrent_info_error.has_value())
+    {
+        // Logged when it was parsed.
+        return BuildError{ *req.torrent_info_error, ParseErrorMessage(*req.torrent_info_error) };
+    }
+    else if (req.ti.has_value())
+    {
+        // Not parsed while decoding, which is only the case without a worker pool or for
+        // a torrent which was removed after the request was decoded.
+        if (const auto error = LoadTorrentInfo(req, m_torrents, p.ti))
         {
-            BOOST_LOG_TRIVIAL(error) << "Failed to parse torrent file to info: " << ec.message();
-            return cb.Error(-2, "Failed to parse torrent_info from bdecoded data");
+            return error;
         }
     }
     else if (req.magnet_uri.has_value())
@@ -92,7 +289,7 @@ void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
         if (ec)
         {
             BOOST_LOG_TRIVIAL(error) << "Failed to parse magnet uri: " << ec.message();
-            return cb.Error(-3, "Could not parse 'magnet_uri' param");
+            return BuildError{ -3, "Could not parse 'magnet_uri' param" };
         }
     }
 
@@ -107,9 +304,8 @@ void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
     if (req.url_seeds.has_value())       p.url_seeds       = req.url_seeds.value();
 
     // userdata values
-    if (req.category.has_value())        p.userdata.get<TorrentClientData>()->category = req.category.value();
-    if (req.metadata.has_value())        p.userdata.get<TorrentClientData>()->metadata = req.metadata.value();
-    if (req.tags.has_value())            p.userdata.get<TorrentClientData>()->tags     = req.tags.value();
+    if (req.category.has_value())        p.userdata.get<TorrentClientData>()->category = Symbol::Intern(req.category.value());
+    if (req.tags.has_value())            p.userdata.get<TorrentClientData>()->tags     = SymbolSet(req.tags.value());
 
 
     // Before passing our params to the session. Validate that we have at least
@@ -119,12 +315,103 @@ void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
 
     if (p.save_path.empty())
     {
-        return cb.Error(-4, "'save_path' missing");
+        return BuildError{ -4, "'save_path' missing" };
     }
 
     if (!p.ti && p.info_hashes == lt::info_hash_t())
     {
-        return cb.Error(-4, "Either 'ti' or 'magnet_uri' must be set");
+        return BuildError{ -4, "Either 'ti' or 'magnet_uri' must be set" };
+    }
+
+    if (m_quotas != nullptr)
+    {
+        const auto& category = p.userdata.get<TorrentClientData>()->category;
+
+        // Magnet links have no size yet, and are paused later if they do not fit.
+        const auto rejection = m_quotas->Admit(
+            p.ti ? p.ti->info_hashes() : p.info_hashes,
+            category.has_value() ? std::optional<std::string>(category->str()) : std::nullopt,
+            p.save_path,
+            p.ti ? p.ti->total_size() : 0);
+
+        if (rejection.has_value())
+        {
+            return BuildError{
+                -10,
+                "Torrent does not fit in quota '" + rejection->quota + "', "
+                    + std::to_string(rejection->reserved) + " of " + std::to_string(rejection->max_size) + " bytes reserved"
+            };
+        }
+    }
+
+    return std::nullopt;
+}
+
+void TorrentsAdd::Added(const lt::info_hash_t& hash, const std::optional<std::map<std::string, nlohmann::json>>& metadata) const
+{
+    if (metadata.has_value() && !metadata->empty())
+    {
+        m_metadata.Set(hash, metadata.value());
+    }
+}
+
+void TorrentsAdd::Duplicate(const TorrentsAddReq& req, WriteCb<TorrentsAddRes>& cb) const
+{
+    const auto& torrents = m_session.Torrents();
+    const auto torrent = torrents.find(req.info_hash);
+
+    // Parked torrents have no handle to merge into.
+    if (req.duplicate.value_or("reject") != "merge" || torrent == torrents.end())
+    {
+        return cb.Error(-6, "Torrent already added", {{"info_hash", req.info_hash}});
+    }
+
+    std::vector<std::string> trackers = req.trackers.value_or(std::vector<std::string>());
+
+    if (req.magnet_uri.has_value())
+    {
+        lt::error_code ec;
+        const auto params = lt::parse_magnet_uri(req.magnet_uri.value(), ec);
+        if (!ec) trackers.insert(trackers.end(), params.trackers.begin(), params.trackers.end());
+    }
+
+    // libtorrent skips the ones the torrent already has.
+    for (const auto& url : trackers)
+    {
+        torrent->second.add_tracker(lt::announce_entry(url));
+    }
+
+    Added(req.info_hash, req.metadata);
+
+    cb.Ok(TorrentsAddRes{
+        .info_hash = req.info_hash,
+        .duplicate = true
+    });
+}
+
+void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
+{
+    if (req.duplicate.has_value() && req.duplicate != "reject" && req.duplicate != "merge")
+    {
+        return cb.Error(-7, "Invalid duplicate - expected 'reject' or 'merge'");
+    }
+
+    if (req.info_hash != lt::info_hash_t()
+        && (m_session.Torrents().contains(req.info_hash) || m_session.Parked(req.info_hash).has_value()))
+    {
+        return Duplicate(req, cb);
+    }
+
+    if (m_session.Draining().draining)
+    {
+        return cb.Error(-8, "Session is draining");
+    }
+
+    lt::add_torrent_params p;
+
+    if (const auto error = Build(req, p))
+    {
+        return cb.Error(error->code, error->message);
     }
 
     lt::info_hash_t hash;
@@ -144,6 +431,8 @@ void TorrentsAdd::Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb)
         return cb.Error(-4, "Failed to add torrent");
     }
 
+    Added(hash, req.metadata);
+
     cb.Ok(TorrentsAddRes{
         .info_hash = hash
     });
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <sqlite3.h>
+#include <optional>
+#include <string>
+
+#include <libtorrent/add_torrent_params.hpp>
 
 #include "../config.hpp"
 #include "method.hpp"
@@ -10,21 +13,87 @@
 namespace porla
 {
     class ISession;
+    class MetadataStore;
+    class SavePathQuotas;
+    class TorrentInfoCache;
+    class TorrentsSnapshot;
 }
 
 namespace porla::Methods
 {
+    // Duplicates are found from the info hash alone, before the torrent file is parsed.
+    // With a snapshot the file is parsed while decoding on the pool, unless the snapshot
+    // has the torrent. Without one it is left for Invoke, after checking the session.
+    // Files go through the torrent info cache when there is one, which limits their size
+    // and keeps them for adding again. Torrents of a known size which would not fit in
+    // their quotas are rejected when building the params.
     class TorrentsAdd : public Method<TorrentsAddReq, TorrentsAddRes>
     {
     public:
-        explicit TorrentsAdd(sqlite3* db, ISession& session, const std::map<std::string, Config::Preset>& presets);
+        struct BuildError
+        {
+            int         code;
+            std::string message;
+        };
+
+        explicit TorrentsAdd(
+            ISession& session,
+            MetadataStore& metadata,
+            const std::map<std::string, Config::Preset>& presets,
+            WorkerPool* pool = nullptr,
+            const TorrentsSnapshot* snapshot = nullptr,
+            TorrentInfoCache* torrents = nullptr,
+            SavePathQuotas* quotas = nullptr);
+
+        // Adds a torrent file sent as is, with the rest of the params given separately. The
+        // response is the same as for torrents.add, with a null id.
+        void Upload(std::string ti, nlohmann::json params, std::shared_ptr<porla::HttpContext> ctx);
+
+        // Converts torrents.add params to a request, base64 decoding and parsing the
+        // torrent file. Throws for invalid params.
+        static TorrentsAddReq Parse(nlohmann::json&& params, TorrentInfoCache* torrents = nullptr);
+
+        // The info hash of the torrent in the request, from the SHA-1 and SHA-256 of the
+        // info dict in ti or from the magnet link, without parsing the rest of the torrent.
+        // Empty when neither gives one.
+        static libtorrent::info_hash_t PeekInfoHash(const TorrentsAddReq& req);
+
+        [[nodiscard]] TorrentInfoCache* Torrents() const { return m_torrents; }
+
+        // Parses the raw torrent file in the request, if any, which may be done off the io
+        // thread. Leaves torrent_info empty when it does not parse, with the error set.
+        static void ParseTorrentInfo(TorrentsAddReq& req, TorrentInfoCache* torrents = nullptr);
+
+        // Fills the add params from a request, with its presets applied. Returns the error to
+        // respond with when the request is not valid.
+        std::optional<BuildError> Build(const TorrentsAddReq& req, libtorrent::add_torrent_params& p) const;
+
+        // Stores the metadata from a request for the torrent it added, since metadata is
+        // kept apart from the add params.
+        void Added(const libtorrent::info_hash_t& hash, const std::optional<std::map<std::string, nlohmann::json>>& metadata) const;
 
     protected:
+        TorrentsAddReq Decode(nlohmann::json&& body) override;
         void Invoke(const TorrentsAddReq& req, WriteCb<TorrentsAddRes> cb) override;
 
     private:
-        sqlite3* m_db;
+        // Base64 decodes the torrent file and peeks at its info hash, without parsing it.
+        static TorrentsAddReq ParseParams(nlohmann::json&& params);
+
+        static std::optional<BuildError> LoadTorrentInfo(
+            const TorrentsAddReq& req,
+            TorrentInfoCache* torrents,
+            std::shared_ptr<libtorrent::torrent_info>& ti);
+
+        // Answers a request for a torrent which is already added, rejecting it or merging
+        // its trackers into the torrent.
+        void Duplicate(const TorrentsAddReq& req, WriteCb<TorrentsAddRes>& cb) const;
+
         ISession& m_session;
+        MetadataStore& m_metadata;
         const std::map<std::string, Config::Preset>& m_presets;
+        const TorrentsSnapshot* m_snapshot;
+        TorrentInfoCache* m_torrents;
+        SavePathQuotas* m_quotas;
     };
 }
@@ -0,0 +1,110 @@
+#include "torrentsaddbatch.hpp"
+
+#include <stdexcept>
+
+#include <libtorrent/add_torrent_params.hpp>
+
+#include "torrentsadd.hpp"
+#include "../session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Methods::TorrentsAddBatch;
+using porla::Methods::TorrentsAddBatchReq;
+using porla::Methods::TorrentsAddBatchRes;
+
+TorrentsAddBatch::TorrentsAddBatch(porla::ISession& session, const TorrentsAdd& add, WorkerPool* pool)
+    : Method(pool)
+    , m_session(session)
+    , m_add(add)
+{
+}
+
+TorrentsAddBatchReq TorrentsAddBatch::Decode(nlohmann::json&& body)
+{
+    auto& torrents = body.at("torrents");
+
+    if (!torrents.is_array())
+    {
+        throw std::invalid_argument("'torrents' must be an array");
+    }
+
+    TorrentsAddBatchReq req;
+    req.torrents.reserve(torrents.size());
+
+    // One bad torrent only fails itself, not the whole batch.
+    for (auto& item : torrents)
+    {
+        TorrentsAddBatchReq::Item parsed;
+
+        try
+        {
+            parsed.torrent = TorrentsAdd::Parse(std::move(item), m_add.Torrents());
+        }
+        catch (const std::exception& ex)
+        {
+            parsed.error = ex.what();
+        }
+
+        req.torrents.push_back(std::move(parsed));
+    }
+
+    return req;
+}
+
+void TorrentsAddBatch::Invoke(const TorrentsAddBatchReq& req, WriteCb<TorrentsAddBatchRes> cb)
+{
+    TorrentsAddBatchRes res;
+    res.results.resize(req.torrents.size());
+
+    std::vector<lt::add_torrent_params> params;
+    // The result index of each params passed to the session.
+    std::vector<std::size_t> indices;
+    // Stored once the torrents are added, since it is not part of the params.
+    std::vector<std::optional<std::map<std::string, nlohmann::json>>> metadata;
+
+    for (std::size_t i = 0; i < req.torrents.size(); i++)
+    {
+        const auto& item = req.torrents[i];
+
+        if (!item.torrent.has_value())
+        {
+            res.results[i].error = TorrentsAddBatchRes::Error{ -32602, item.error };
+            continue;
+        }
+
+        lt::add_torrent_params p;
+
+        if (const auto error = m_add.Build(*item.torrent, p))
+        {
+            res.results[i].error = TorrentsAddBatchRes::Error{ error->code, error->message };
+            continue;
+        }
+
+        params.push_back(std::move(p));
+        indices.push_back(i);
+        metadata.push_back(item.torrent->metadata);
+    }
+
+    m_session.AddTorrents(
+        std::move(params),
+        [&add = m_add, cb, res = std::move(res), indices = std::move(indices), metadata = std::move(metadata)](std::vector<ISession::AddTorrentResult> added) mutable
+        {
+            for (std::size_t i = 0; i < added.size(); i++)
+            {
+                auto& result = res.results[indices[i]];
+
+                if (added[i].error.empty())
+                {
+                    result.info_hash = added[i].info_hash;
+                    add.Added(added[i].info_hash, metadata[i]);
+                }
+                else
+                {
+                    result.error = TorrentsAddBatchRes::Error{ -5, added[i].error };
+                }
+            }
+
+            cb(res);
+        });
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsaddbatch_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class TorrentsAdd;
+
+    // Adds many torrents in one request, each with the params of torrents.add. The torrents
+    // are added without waiting on each other and the response has a result per torrent, in
+    // the same order.
+    class TorrentsAddBatch : public Method<TorrentsAddBatchReq, TorrentsAddBatchRes>
+    {
+    public:
+        explicit TorrentsAddBatch(ISession& session, const TorrentsAdd& add, WorkerPool* pool = nullptr);
+
+    protected:
+        TorrentsAddBatchReq Decode(nlohmann::json&& body) override;
+        void Invoke(const TorrentsAddBatchReq& req, WriteCb<TorrentsAddBatchRes> cb) override;
+
+    private:
+        ISession& m_session;
+        const TorrentsAdd& m_add;
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "torrentsaddreq.hpp"
+
+namespace porla::Methods
+{
+    struct TorrentsAddBatchReq
+    {
+        // A torrent whose params could not be parsed has the reason instead.
+        struct Item
+        {
+            std::optional<TorrentsAddReq> torrent;
+            std::string                   error;
+        };
+
+        std::vector<Item> torrents;
+    };
+
+    struct TorrentsAddBatchRes
+    {
+        struct Error
+        {
+            int         code;
+            std::string message;
+        };
+
+        // Either the info hash of the added torrent or why it was not added.
+        struct Result
+        {
+            std::optional<libtorrent::info_hash_t> info_hash;
+            std::optional<Error>                   error;
+        };
+
+        std::vector<Result> results;
+    };
+}
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <memory>
 #include <optional>
 #include <string>
 
+#include <libtorrent/fwd.hpp>
+#include <libtorrent/info_hash.hpp>
+
 namespace porla::Methods
 {
     struct TorrentsAddReq
     {
         std::optional<std::string>                           category;
         std::optional<int>                                   download_limit;
+        // What to do when the torrent is already added, "reject" (the default) or "merge",
+        // which adds the trackers of the request to it.
+        std::optional<std::string>                           duplicate;
         std::optional<std::vector<std::string>>              http_seeds;
+        // Hashed from the info dict in ti, or read from the magnet link, while decoding and
+        // before anything else is parsed. Empty when neither gives one.
+        libtorrent::info_hash_t                              info_hash;
         std::optional<std::string>                           magnet_uri;
         std::optional<int>                                   max_connections;
         std::optional<int>                                   max_uploads;
@@ -18,7 +28,14 @@ namespace porla::Methods
         std::optional<std::string>                           preset;
         std::optional<std::string>                           save_path;
         std::optional<std::unordered_set<std::string>>       tags;
+        // Base64 in the params, and already decoded to the raw torrent file here.
         std::optional<std::string>                           ti;
+        // Parsed from ti while decoding, which may run off the io thread. Left empty if
+        // ti does not parse, and Invoke reports why.
+        std::shared_ptr<libtorrent::torrent_info>            torrent_info;
+        // The error code Invoke responds with when ti was parsed while decoding and did not
+        // parse, so it is not parsed again on the io thread.
+        std::optional<int>                                   torrent_info_error;
         std::optional<std::vector<std::string>>              trackers;
         std::optional<int>                                   upload_limit;
         std::optional<std::vector<std::string>>              url_seeds;
@@ -7,5 +7,7 @@ namespace porla::Methods
     struct TorrentsAddRes
     {
         libtorrent::info_hash_t info_hash;
+        // Set when the torrent was already added, and the request merged into it.
+        bool                    duplicate = false;
     };
 }
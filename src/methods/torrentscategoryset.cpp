@@ -0,0 +1,60 @@
+#include "torrentscategoryset.hpp"
+
+#include "../session.hpp"
+#include "../torrentclientdata.hpp"
+#include "torrentselector.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Methods::TorrentsCategorySet;
+using porla::Methods::TorrentsCategorySetReq;
+using porla::Methods::TorrentsCategorySetRes;
+using porla::Methods::TorrentSelection;
+using porla::Methods::TorrentSelector;
+
+TorrentsCategorySet::TorrentsCategorySet(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void TorrentsCategorySet::Invoke(const TorrentsCategorySetReq& req, WriteCb<TorrentsCategorySetRes> cb)
+{
+    if (!req.info_hash.has_value() && !TorrentSelector::IsBulk(req))
+    {
+        return cb.Error(-2, "One of 'info_hash', 'info_hashes' or 'query' must be set");
+    }
+
+    TorrentSelection selection;
+
+    try
+    {
+        selection = TorrentSelector::Select(m_session, req);
+    }
+    catch (const Query::QueryError& qe)
+    {
+        return cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
+    }
+
+    const std::optional<Symbol> category = req.category.has_value() && !req.category->empty()
+        ? std::make_optional(Symbol::Intern(*req.category))
+        : std::nullopt;
+
+    const auto changed = m_session.EditClientData(
+        selection.hashes,
+        [&category](TorrentClientData& client_data)
+        {
+            if (client_data.category == category)
+            {
+                return false;
+            }
+
+            client_data.category = category;
+            return true;
+        });
+
+    cb(TorrentsCategorySetRes{
+        .matched = static_cast<int>(selection.hashes.size()),
+        .changed = static_cast<int>(changed.size()),
+        .failed  = selection.missing
+    });
+}
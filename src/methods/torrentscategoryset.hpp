@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentscategoryset_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    // Sets or clears the category of every selected torrent, the same way as
+    // torrents.tags.update.
+    class TorrentsCategorySet : public Method<TorrentsCategorySetReq, TorrentsCategorySetRes>
+    {
+    public:
+        explicit TorrentsCategorySet(ISession& session);
+
+    protected:
+        void Invoke(const TorrentsCategorySetReq& req, WriteCb<TorrentsCategorySetRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsCategorySetReq
+    {
+        std::optional<libtorrent::info_hash_t> info_hash;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        std::optional<std::string> query;
+        // Unset or empty clears the category.
+        std::optional<std::string> category;
+    };
+
+    struct TorrentsCategorySetRes
+    {
+        int matched;
+        int changed;
+        std::vector<libtorrent::info_hash_t> failed;
+    };
+}
@@ -0,0 +1,109 @@
+#include "torrentselector.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#include "../json/ltinfohash.hpp"
+#include "../session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Methods::TorrentSelection;
+using porla::Methods::TorrentSelector;
+
+TorrentSelection TorrentSelector::Select(
+    porla::ISession& session,
+    const std::optional<lt::info_hash_t>& info_hash,
+    const std::optional<std::vector<lt::info_hash_t>>& info_hashes,
+    const std::optional<std::string>& query)
+{
+    std::shared_ptr<Query::PQL::Filter> filter;
+
+    if (query.has_value() && !query->empty())
+    {
+        filter = Query::PQL::ParseCached(*query);
+    }
+
+    const auto& statuses = session.TorrentStatuses();
+
+    TorrentSelection selection;
+
+    const auto consider = [&](const lt::info_hash_t& hash)
+    {
+        const auto status = statuses.find(hash);
+
+        if (status == statuses.end())
+        {
+            selection.missing.push_back(hash);
+        }
+        else if (filter == nullptr || filter->Includes(status->second))
+        {
+            selection.hashes.push_back(hash);
+        }
+    };
+
+    if (info_hash.has_value())
+    {
+        consider(*info_hash);
+    }
+
+    if (info_hashes.has_value())
+    {
+        for (const auto& hash : *info_hashes) { consider(hash); }
+    }
+
+    // Without explicit hashes the query runs over the whole session.
+    if (!info_hash.has_value() && !info_hashes.has_value() && filter != nullptr)
+    {
+        for (const auto& [hash, status] : statuses)
+        {
+            if (filter->Includes(status)) { selection.hashes.push_back(hash); }
+        }
+    }
+
+    return selection;
+}
+
+nlohmann::json TorrentSelector::Apply(
+    porla::ISession& session,
+    const TorrentSelection& selection,
+    const Action& action)
+{
+    nlohmann::json failed = nlohmann::json::array();
+
+    for (const auto& hash : selection.missing)
+    {
+        failed.push_back({{"info_hash", hash}, {"error", "Torrent not found"}});
+    }
+
+    int applied = 0;
+
+    // The action may remove torrents, so nothing is held from the map between calls.
+    for (const auto& hash : selection.hashes)
+    {
+        const auto& torrents = session.Torrents();
+        const auto  handle   = torrents.find(hash);
+
+        if (handle == torrents.end())
+        {
+            failed.push_back({{"info_hash", hash}, {"error", session.Parked(hash) ? "Torrent is parked" : "Torrent not found"}});
+            continue;
+        }
+
+        try
+        {
+            action(hash, handle->second);
+            applied++;
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Bulk operation failed for torrent " << hash.get_best() << ": " << ex.what();
+            failed.push_back({{"info_hash", hash}, {"error", ex.what()}});
+        }
+    }
+
+    return {
+        {"matched", selection.hashes.size()},
+        {"applied", applied},
+        {"failed",  failed}
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_handle.hpp>
+#include <nlohmann/json.hpp>
+
+#include "method.hpp"
+#include "../query/pql.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    struct TorrentSelection
+    {
+        std::vector<libtorrent::info_hash_t> hashes;
+        std::vector<libtorrent::info_hash_t> missing;
+    };
+
+    // Resolves the torrents a method acts on from its 'info_hash', 'info_hashes' and 'query'
+    // params. The query is compiled once and narrows down the hashes if both are given.
+    class TorrentSelector
+    {
+    public:
+        typedef std::function<void(const libtorrent::info_hash_t&, const libtorrent::torrent_handle&)> Action;
+
+        // Selecting by list or query gets a bulk response with counts and failures. A single
+        // info_hash keeps the plain response and errors of the method.
+        template<typename TReq>
+        static bool IsBulk(const TReq& req)
+        {
+            return req.info_hashes.has_value() || req.query.has_value();
+        }
+
+        // Throws a QueryError if the query does not parse.
+        template<typename TReq>
+        static TorrentSelection Select(ISession& session, const TReq& req)
+        {
+            return Select(session, req.info_hash, req.info_hashes, req.query);
+        }
+
+        static TorrentSelection Select(
+            ISession& session,
+            const std::optional<libtorrent::info_hash_t>& info_hash,
+            const std::optional<std::vector<libtorrent::info_hash_t>>& info_hashes,
+            const std::optional<std::string>& query);
+
+        // Runs the action for every selected torrent, collecting the torrents it throws for.
+        // Returns {"matched", "applied", "failed": [{"info_hash", "error"}]}.
+        static nlohmann::json Apply(
+            ISession& session,
+            const TorrentSelection& selection,
+            const Action& action);
+
+        // Answers the call if it is a bulk request, or if it selects nothing at all. Returns
+        // false when the method should handle its single 'info_hash' as before.
+        template<typename TReq, typename TRes>
+        static bool HandleBulk(ISession& session, const TReq& req, WriteCb<TRes>& cb, const Action& action)
+        {
+            if (!IsBulk(req))
+            {
+                if (!req.info_hash.has_value())
+                {
+                    cb.Error(-2, "One of 'info_hash', 'info_hashes' or 'query' must be set");
+                    return true;
+                }
+
+                return false;
+            }
+
+            try
+            {
+                cb.Ok(Apply(session, Select(session, req), action));
+            }
+            catch (const Query::QueryError& qe)
+            {
+                cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
+            }
+
+            return true;
+        }
+    };
+}
@@ -1,36 +1,264 @@
 #include "torrentsfileslist.hpp"
 
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "../session.hpp"
 
 using porla::Methods::TorrentsFilesList;
 using porla::Methods::TorrentsFilesListReq;
 using porla::Methods::TorrentsFilesListRes;
 
-TorrentsFilesList::TorrentsFilesList(porla::ISession &session)
-    : m_session(session)
+// A file of the torrent, or a directory of them when browsing by path. Names are kept for
+// sorting, and only directories have a path and size of their own. The rest of a file is
+// read from the file storage.
+struct Entry
+{
+    bool                          directory = false;
+    lt::file_index_t              index{0};
+    std::string                   name;
+    std::string                   path;
+    std::int64_t                  size = 0;
+    std::vector<lt::file_index_t> files;
+};
+
+// What the fields are read from. Progress and priorities are only fetched when asked for.
+struct Listing
 {
+    std::shared_ptr<const lt::torrent_info>    torrent_file;
+    porla::ISession::FileProgressList          progress;
+    std::vector<lt::download_priority_t>       priorities;
+};
+
+typedef std::function<json(const Listing&, const Entry&)> Field;
+
+static const std::map<std::string, Field>& FileFields()
+{
+    static const std::map<std::string, Field> fields =
+    {
+        {"absolute_path",    [](auto const& l, auto const& e) { return l.torrent_file->files().file_absolute_path(e.index); }},
+        {"first_block_node", [](auto const& l, auto const& e) { return l.torrent_file->files().file_first_block_node(e.index); }},
+        {"first_piece_node", [](auto const& l, auto const& e) { return l.torrent_file->files().file_first_piece_node(e.index); }},
+        {"flags",            [](auto const& l, auto const& e) { return static_cast<uint8_t>(l.torrent_file->files().file_flags(e.index)); }},
+        {"index",            [](auto const& l, auto const& e) { return static_cast<int>(e.index); }},
+        {"name",             [](auto const& l, auto const& e) { return std::string(l.torrent_file->files().file_name(e.index)); }},
+        {"num_blocks",       [](auto const& l, auto const& e) { return l.torrent_file->files().file_num_blocks(e.index); }},
+        {"num_pieces",       [](auto const& l, auto const& e) { return l.torrent_file->files().file_num_pieces(e.index); }},
+        {"offset",           [](auto const& l, auto const& e) { return l.torrent_file->files().file_offset(e.index); }},
+        {"path",             [](auto const& l, auto const& e) { return l.torrent_file->files().file_path(e.index); }},
+        {"priority",         [](auto const& l, auto const& e) { return static_cast<uint8_t>(l.priorities.at(static_cast<int>(e.index))); }},
+        {"progress",         [](auto const& l, auto const& e) { return l.progress->at(static_cast<int>(e.index)); }},
+        {"size",             [](auto const& l, auto const& e) { return l.torrent_file->files().file_size(e.index); }},
+        {"type",             [](auto const& l, auto const& e) { return "file"; }},
+    };
+
+    return fields;
 }
 
-void TorrentsFilesList::Invoke(const TorrentsFilesListReq& req, WriteCb<TorrentsFilesListRes> cb)
+static const std::map<std::string, Field>& DirectoryFields()
 {
-    auto const& torrents = m_session.Torrents();
-    auto const handle = torrents.find(req.info_hash);
+    static const std::map<std::string, Field> fields =
+    {
+        {"name",      [](auto const& l, auto const& e) { return e.name; }},
+        {"num_files", [](auto const& l, auto const& e) { return e.files.size(); }},
+        {"path",      [](auto const& l, auto const& e) { return e.path; }},
+        {
+            "progress",
+            [](auto const& l, auto const& e)
+            {
+                std::int64_t progress = 0;
+                for (const auto index : e.files) progress += l.progress->at(static_cast<int>(index));
+                return progress;
+            }
+        },
+        {"size",      [](auto const& l, auto const& e) { return e.size; }},
+        {"type",      [](auto const& l, auto const& e) { return "directory"; }},
+    };
 
-    if (handle == torrents.end())
+    return fields;
+}
+
+// The files and directories right under the path, directories first and each sorted by
+// name. Files are matched on their path, so nothing else is read until they are listed.
+static std::vector<Entry> Entries(const lt::file_storage& storage, const std::string& path)
+{
+    std::string prefix = path;
+    if (!prefix.empty() && prefix.back() != '/') prefix.push_back('/');
+    if (prefix == "/") prefix.clear();
+
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, std::size_t> directories;
+
+    for (const auto index : storage.file_range())
     {
-        return cb.Error(-1, "Torrent not found");
+        const std::string file_path = storage.file_path(index);
+
+        if (!file_path.starts_with(prefix))
+        {
+            continue;
+        }
+
+        const std::string_view rest = std::string_view(file_path).substr(prefix.size());
+        const auto separator = rest.find('/');
+
+        if (separator == std::string_view::npos)
+        {
+            entries.push_back(Entry{ .index = index, .name = std::string(rest) });
+            continue;
+        }
+
+        const std::string name(rest.substr(0, separator));
+        auto [directory, inserted] = directories.try_emplace(name, entries.size());
+
+        if (inserted)
+        {
+            entries.push_back(Entry{ .directory = true, .name = name, .path = prefix + name });
+        }
+
+        auto& entry = entries[directory->second];
+        entry.size += storage.file_size(index);
+        entry.files.push_back(index);
     }
 
-    auto const status = handle->second.status();
+    std::sort(
+        entries.begin(),
+        entries.end(),
+        [](const Entry& lhs, const Entry& rhs)
+        {
+            if (lhs.directory != rhs.directory) return lhs.directory;
+            return lhs.name < rhs.name;
+        });
 
-    TorrentsFilesListRes res;
+    return entries;
+}
 
-    if (auto tf = status.torrent_file.lock())
+TorrentsFilesList::TorrentsFilesList(boost::asio::io_context& io, porla::ISession &session)
+    : AsyncMethod(io)
+    , m_session(session)
+{
+}
+
+boost::asio::awaitable<void> TorrentsFilesList::InvokeAsync(TorrentsFilesListReq req, WriteCb<TorrentsFilesListRes> cb)
+{
+    // Listed when no fields are asked for, which are the ones not needing a round trip to
+    // the network thread.
+    static const std::vector<std::string> default_fields =
     {
-        return cb.Ok(TorrentsFilesListRes{
-            .file_storage = tf->files()
-        });
+        "absolute_path", "first_block_node", "first_piece_node", "flags", "index", "name",
+        "num_blocks", "num_pieces", "offset", "path", "size", "type"
+    };
+
+    const auto& requested = req.fields.has_value() ? req.fields.value() : default_fields;
+    const std::unordered_set<std::string> fields(requested.begin(), requested.end());
+
+    for (const auto& field : fields)
+    {
+        if (!FileFields().contains(field) && !DirectoryFields().contains(field))
+        {
+            co_return cb.Error(-3, "Invalid field in 'fields': " + field);
+        }
+    }
+
+    if (req.page_size.has_value() && req.page_size.value() <= 0)
+    {
+        co_return cb.Error(-1, "Invalid 'page_size'");
+    }
+
+    auto const& statuses = m_session.TorrentStatuses();
+    auto const status = statuses.find(req.info_hash);
+
+    if (status == statuses.end())
+    {
+        co_return cb.Error(-1, "Torrent not found");
+    }
+
+    Listing listing;
+    listing.torrent_file = status->second.torrent_file.lock();
+
+    if (!listing.torrent_file)
+    {
+        co_return cb.Error(-2, "Failed to lock torrent file");
+    }
+
+    if (fields.contains("priority"))
+    {
+        // There is no way to ask for priorities without blocking, but they are only read
+        // for views showing them.
+        auto const& torrents = m_session.Torrents();
+
+        if (auto const& torrent = torrents.find(req.info_hash); torrent != torrents.end())
+        {
+            listing.priorities = torrent->second.get_file_priorities();
+        }
+
+        listing.priorities.resize(listing.torrent_file->num_files(), lt::default_priority);
+    }
+
+    if (fields.contains("progress"))
+    {
+        listing.progress = co_await Async::FileProgress(m_session, req.info_hash);
+
+        if (listing.progress == nullptr)
+        {
+            co_return cb.Error(-1, "Torrent not found");
+        }
+    }
+
+    auto const& storage = listing.torrent_file->files();
+
+    // Without a path the files are listed as they are in the torrent, and only the page
+    // is looked at.
+    const auto entries = req.path.has_value()
+        ? Entries(storage, req.path.value())
+        : std::vector<Entry>();
+
+    const std::size_t total = req.path.has_value()
+        ? entries.size()
+        : static_cast<std::size_t>(storage.num_files());
+
+    const int page = std::max(0, req.page.value_or(0));
+
+    std::size_t beg = 0;
+    std::size_t end = total;
+
+    if (req.page_size.has_value())
+    {
+        beg = std::min(total, static_cast<std::size_t>(page) * req.page_size.value());
+        end = std::min(total, beg + req.page_size.value());
     }
 
-    return cb.Error(-2, "Failed to lock torrent file");
+    std::vector<json> items;
+    items.reserve(end - beg);
+
+    for (std::size_t i = beg; i < end; i++)
+    {
+        const Entry file{ .index = lt::file_index_t(static_cast<int>(i)) };
+        auto const& entry = req.path.has_value() ? entries[i] : file;
+
+        auto const& entry_fields = entry.directory ? DirectoryFields() : FileFields();
+
+        json item = json::object();
+
+        for (const auto& name : fields)
+        {
+            if (auto const& field = entry_fields.find(name); field != entry_fields.end())
+            {
+                item[name] = field->second(listing, entry);
+            }
+        }
+
+        items.push_back(std::move(item));
+    }
+
+    json result = TorrentsFilesListRes{
+        .files_total = static_cast<int>(total),
+        .page        = page,
+        .page_size   = req.page_size,
+        .path        = req.path
+    };
+
+    result.erase("files");
+
+    cb.OkStreamed(std::move(result), "files", std::move(items));
 }
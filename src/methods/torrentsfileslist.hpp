@@ -1,6 +1,6 @@
 #pragma once
 
-#include "method.hpp"
+#include "asyncmethod.hpp"
 #include "torrentsfileslist_reqres.hpp"
 
 namespace porla
@@ -10,13 +10,13 @@ namespace porla
 
 namespace porla::Methods
 {
-    class TorrentsFilesList : public Method<TorrentsFilesListReq, TorrentsFilesListRes>
+    class TorrentsFilesList : public AsyncMethod<TorrentsFilesListReq, TorrentsFilesListRes>
     {
     public:
-        explicit TorrentsFilesList(ISession& session);
+        explicit TorrentsFilesList(boost::asio::io_context& io, ISession& session);
 
     protected:
-        void Invoke(const TorrentsFilesListReq& req, WriteCb<TorrentsFilesListRes> cb);
+        boost::asio::awaitable<void> InvokeAsync(TorrentsFilesListReq req, WriteCb<TorrentsFilesListRes> cb) override;
 
     private:
         ISession& m_session;
@@ -1,19 +1,33 @@
 #pragma once
 
+#include <optional>
+#include <string>
 #include <vector>
 
-#include <libtorrent/file_storage.hpp>
 #include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
 
 namespace porla::Methods
 {
     struct TorrentsFilesListReq
     {
+        std::optional<std::vector<std::string>> fields;
         libtorrent::info_hash_t info_hash;
+        std::optional<int> page;
+        std::optional<int> page_size;
+        // Lists the files and directories right under the path, with "" being the top of
+        // the torrent, instead of every file.
+        std::optional<std::string> path;
     };
 
     struct TorrentsFilesListRes
     {
-        libtorrent::file_storage file_storage;
+        // Each file or directory with the fields from TorrentsFilesListReq::fields, or the
+        // ones which are cheap to get.
+        std::vector<nlohmann::json> files;
+        int                         files_total;
+        int                         page;
+        std::optional<int>          page_size;
+        std::optional<std::string>  path;
     };
 }
@@ -0,0 +1,71 @@
+#include "torrentshistory.hpp"
+
+#include <ctime>
+
+#include "../torrenthistory.hpp"
+
+using porla::Methods::TorrentsHistory;
+using porla::Methods::TorrentsHistoryReq;
+using porla::Methods::TorrentsHistoryRes;
+
+TorrentsHistory::TorrentsHistory(const porla::TorrentHistory* history, porla::WorkerPool* pool)
+    : Method(pool)
+    , m_history(history)
+    , m_pool(pool)
+{
+}
+
+void TorrentsHistory::Invoke(const TorrentsHistoryReq& req, WriteCb<TorrentsHistoryRes> cb)
+{
+    if (m_history == nullptr)
+    {
+        return cb.Error(-1, "Torrent history is not enabled");
+    }
+
+    const auto period_name = req.period.value_or("hourly");
+
+    if (period_name != "hourly" && period_name != "daily")
+    {
+        return cb.Error(-2, "Invalid period - expected 'hourly' or 'daily'");
+    }
+
+    const auto period = period_name == "daily"
+        ? TorrentHistory::Period::Daily
+        : TorrentHistory::Period::Hourly;
+
+    // Defaults to the last day of hourly buckets, or the last month of daily ones.
+    const std::int64_t to   = req.to.value_or(std::time(nullptr));
+    const std::int64_t from = req.from.value_or(to - (period == TorrentHistory::Period::Daily ? 30 * 86400 : 86400));
+
+    if (m_pool == nullptr || !m_history->HasReaders())
+    {
+        return cb.Ok(TorrentsHistoryRes{
+            .buckets = m_history->Get(req.info_hash, period, from, to),
+            .period  = static_cast<int>(period)
+        });
+    }
+
+    const auto posted = m_pool->Post(
+        [history = m_history, pool = m_pool, hash = req.info_hash, period, from, to, flushes = m_history->Flushes(), cb]() mutable
+        {
+            auto stored = history->Stored(hash, period, from, to);
+
+            pool->Complete(
+                [history, hash, period, from, to, flushes, cb, stored = std::move(stored)]() mutable
+                {
+                    // A flush in between moved pending buckets into the database after
+                    // they were read, so they are read again.
+                    cb.Ok(TorrentsHistoryRes{
+                        .buckets = history->Flushes() == flushes
+                            ? history->Merge(hash, period, from, to, stored)
+                            : history->Get(hash, period, from, to),
+                        .period  = static_cast<int>(period)
+                    });
+                });
+        });
+
+    if (!posted)
+    {
+        cb.Error(-32000, "Server busy - too many queued requests");
+    }
+}
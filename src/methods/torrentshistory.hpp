@@ -0,0 +1,27 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentshistory_reqres.hpp"
+
+namespace porla
+{
+    class TorrentHistory;
+}
+
+namespace porla::Methods
+{
+    class TorrentsHistory : public Method<TorrentsHistoryReq, TorrentsHistoryRes>
+    {
+    public:
+        // The history is null when it is not enabled. With a pool, and readers for the
+        // history, the stored buckets are read on the pool.
+        explicit TorrentsHistory(const TorrentHistory* history, WorkerPool* pool = nullptr);
+
+    protected:
+        void Invoke(const TorrentsHistoryReq& req, WriteCb<TorrentsHistoryRes> cb) override;
+
+    private:
+        const TorrentHistory* m_history;
+        WorkerPool* m_pool;
+    };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "../data/models/torrenthistory.hpp"
+
+namespace porla::Methods
+{
+    struct TorrentsHistoryReq
+    {
+        std::optional<std::int64_t> from;
+        libtorrent::info_hash_t     info_hash;
+        std::optional<std::string>  period; // "hourly" (default) or "daily"
+        std::optional<std::int64_t> to;
+    };
+
+    struct TorrentsHistoryRes
+    {
+        std::vector<Data::Models::TorrentHistory::Bucket> buckets;
+        int                                               period;
+    };
+}
@@ -1,33 +1,150 @@
 #include "torrentslist.hpp"
 
+#include <bit>
+#include <numeric>
+
+#include "../metadatastore.hpp"
+#include "../peeraggregates.hpp"
 #include "../query/pql.hpp"
 #include "../session.hpp"
 #include "../torrentclientdata.hpp"
+#include "../torrentcolumns.hpp"
+#include "../torrentorders.hpp"
+#include "../torrentrates.hpp"
+#include "../torrentrevisions.hpp"
+#include "../torrentviews.hpp"
+#include "../utils/arena.hpp"
 #include "../utils/eta.hpp"
 #include "../utils/ratio.hpp"
 
 using porla::Methods::TorrentsList;
 
-TorrentsList::TorrentsList(sqlite3* db, porla::ISession& session)
+TorrentsList::TorrentsList(
+    sqlite3* db,
+    porla::ISession& session,
+    porla::TorrentIndex& index,
+    porla::TorrentRevisions& revisions,
+    porla::TorrentColumns* columns,
+    porla::TorrentViews* views,
+    porla::MetadataStore* metadata,
+    porla::TorrentOrders* orders,
+    porla::TorrentRates* rates,
+    porla::PeerAggregates* peers)
     : m_db(db)
     , m_session(session)
+    , m_index(index)
+    , m_revisions(revisions)
+    , m_columns(columns)
+    , m_views(views)
+    , m_metadata(metadata)
+    , m_orders(orders)
+    , m_rates(rates)
+    , m_peers(peers)
+{
+}
+
+// Orders rows the same way as the item sorters below, for the fields kept in columns.
+// Returns an empty function for every other field.
+static std::function<bool(std::uint32_t, std::uint32_t)> ColumnSorter(const porla::Query::Columns& columns, const std::string& field, bool asc)
+{
+    const auto by = [&columns, asc](auto const& column) -> std::function<bool(std::uint32_t, std::uint32_t)>
+    {
+        return [&columns, &column, asc](std::uint32_t lhs, std::uint32_t rhs)
+        {
+            if (column[lhs] != column[rhs]) return asc ? column[lhs] < column[rhs] : column[lhs] > column[rhs];
+            return columns.hashes[lhs] < columns.hashes[rhs];
+        };
+    };
+
+    if (field == "download_rate") return by(columns.download_rate);
+    if (field == "progress")      return by(columns.progress);
+    if (field == "ratio")         return by(columns.ratio);
+    if (field == "size")          return by(columns.size);
+    if (field == "upload_rate")   return by(columns.upload_rate);
+
+    if (field == "queue_position")
+    {
+        return [&columns, asc](std::uint32_t lhs, std::uint32_t rhs)
+        {
+            const auto lq = columns.queue_position[lhs];
+            const auto rq = columns.queue_position[rhs];
+
+            // Torrents without a queue position go last and are ordered by hash only.
+            if (lq >= 0 && rq >= 0 && lq != rq) return asc ? lq < rq : lq > rq;
+            if ((lq < 0) != (rq < 0)) return rq < 0;
+            return columns.hashes[lhs] < columns.hashes[rhs];
+        };
+    }
+
+    return {};
+}
+
+// The value TorrentOrders::Number gives the torrent a cursor item was made from.
+static std::int64_t CursorNumber(porla::TorrentOrders::Field field, const porla::Methods::TorrentsListRes::Item& item)
 {
+    switch (field)
+    {
+    case porla::TorrentOrders::AddedTime:     return item.added_time.value_or(0);
+    case porla::TorrentOrders::Progress:      return std::bit_cast<std::int32_t>(std::max(0.0f, item.progress.value_or(0)));
+    case porla::TorrentOrders::QueuePosition: return item.queue_position.value_or(-1);
+    case porla::TorrentOrders::Size:          return item.size.value_or(-1);
+    default:                                  return 0;
+    }
+}
+
+const porla::TorrentIndex::HashSet* TorrentsList::IndexCandidates(const TorrentsListReq& req)
+{
+    if (!req.filters.has_value())
+    {
+        return nullptr;
+    }
+
+    // Pick the smallest set since every candidate is checked against all filters anyway.
+    const TorrentIndex::HashSet* candidates = nullptr;
+
+    for (const auto& [filter_field, args] : req.filters.value())
+    {
+        if (!args.is_string())
+        {
+            continue;
+        }
+
+        const TorrentIndex::HashSet* set = nullptr;
+
+        if (filter_field == "category")       set = &m_index.Category(args.get<std::string>());
+        else if (filter_field == "save_path") set = &m_index.SavePath(args.get<std::string>());
+        else if (filter_field == "tags")      set = &m_index.Tag(args.get<std::string>());
+        else if (filter_field == "view")      set = m_views->Find(args.get<std::string>());
+
+        if (set != nullptr && (candidates == nullptr || set->size() < candidates->size()))
+        {
+            candidates = set;
+        }
+    }
+
+    return candidates;
 }
 
 void TorrentsList::Invoke(const TorrentsListReq& req, WriteCb<TorrentsListRes> cb)
 {
     static std::map<std::pair<std::string, bool>, std::function<bool(const TorrentsListRes::Item&, const TorrentsListRes::Item&)>> sorters =
     {
+        {{"added_time", false},     [](auto const& lhs, auto const& rhs) { return lhs.added_time > rhs.added_time; }},
+        {{"added_time", true},      [](auto const& lhs, auto const& rhs) { return lhs.added_time < rhs.added_time; }},
         {{"download_rate", false},  [](auto const& lhs, auto const& rhs) { return lhs.download_rate > rhs.download_rate; }},
         {{"download_rate", true},   [](auto const& lhs, auto const& rhs) { return lhs.download_rate < rhs.download_rate; }},
+        {{"download_rate_avg", false}, [](auto const& lhs, auto const& rhs) { return lhs.download_rate_avg > rhs.download_rate_avg; }},
+        {{"download_rate_avg", true},  [](auto const& lhs, auto const& rhs) { return lhs.download_rate_avg < rhs.download_rate_avg; }},
         {{"eta", false},            [](auto const& lhs, auto const& rhs) { return lhs.eta > rhs.eta; }},
         {{"eta", true},             [](auto const& lhs, auto const& rhs) { return lhs.eta < rhs.eta; }},
+        {{"eta_avg", false},        [](auto const& lhs, auto const& rhs) { return lhs.eta_avg > rhs.eta_avg; }},
+        {{"eta_avg", true},         [](auto const& lhs, auto const& rhs) { return lhs.eta_avg < rhs.eta_avg; }},
         {{"list_peers", false},     [](auto const& lhs, auto const& rhs) { return lhs.list_peers > rhs.list_peers; }},
         {{"list_peers", true},      [](auto const& lhs, auto const& rhs) { return lhs.list_peers < rhs.list_peers; }},
         {{"list_seeds", false},     [](auto const& lhs, auto const& rhs) { return lhs.list_seeds > rhs.list_seeds; }},
         {{"list_seeds", true},      [](auto const& lhs, auto const& rhs) { return lhs.list_seeds < rhs.list_seeds; }},
-        {{"name", false},           [](auto const& lhs, auto const& rhs) { return strcmp(lhs.name.c_str(), rhs.name.c_str()) > 0; }},
-        {{"name", true},            [](auto const& lhs, auto const& rhs) { return strcmp(lhs.name.c_str(), rhs.name.c_str()) < 0; }},
+        {{"name", false},           [](auto const& lhs, auto const& rhs) { return lhs.name > rhs.name; }},
+        {{"name", true},            [](auto const& lhs, auto const& rhs) { return lhs.name < rhs.name; }},
         {{"num_peers", false},      [](auto const& lhs, auto const& rhs) { return lhs.num_peers > rhs.num_peers; }},
         {{"num_peers", true},       [](auto const& lhs, auto const& rhs) { return lhs.num_peers < rhs.num_peers; }},
         {{"num_seeds", false},      [](auto const& lhs, auto const& rhs) { return lhs.num_seeds > rhs.num_seeds; }},
@@ -38,24 +155,26 @@ void TorrentsList::Invoke(const TorrentsListReq& req, WriteCb<TorrentsListRes> c
             {"queue_position", false},
             [](auto const& lhs, auto const& rhs)
             {
-                if (lhs.queue_position < 0) return false;
-                if (rhs.queue_position < 0) return true;
-                return lhs.queue_position >= rhs.queue_position;
+                if (lhs.queue_position.value_or(-1) < 0) return false;
+                if (rhs.queue_position.value_or(-1) < 0) return true;
+                return lhs.queue_position > rhs.queue_position;
             }
         },
         {
             {"queue_position", true},
             [](auto const& lhs, auto const& rhs)
             {
-                if (lhs.queue_position < 0) return false;
-                if (rhs.queue_position < 0) return true;
+                if (lhs.queue_position.value_or(-1) < 0) return false;
+                if (rhs.queue_position.value_or(-1) < 0) return true;
                 return lhs.queue_position < rhs.queue_position;
             }
         },
         {{"ratio", false},          [](auto const& lhs, auto const& rhs) { return lhs.ratio > rhs.ratio; }},
         {{"ratio", true},           [](auto const& lhs, auto const& rhs) { return lhs.ratio < rhs.ratio; }},
-        {{"save_path", false},      [](auto const& lhs, auto const& rhs) { return strcmp(lhs.save_path.c_str(), rhs.save_path.c_str()) > 0; }},
-        {{"save_path", true},       [](auto const& lhs, auto const& rhs) { return strcmp(lhs.save_path.c_str(), rhs.save_path.c_str()) < 0; }},
+        {{"relevance", false},      [](auto const& lhs, auto const& rhs) { return lhs.relevance > rhs.relevance; }},
+        {{"relevance", true},       [](auto const& lhs, auto const& rhs) { return lhs.relevance < rhs.relevance; }},
+        {{"save_path", false},      [](auto const& lhs, auto const& rhs) { return lhs.save_path > rhs.save_path; }},
+        {{"save_path", true},       [](auto const& lhs, auto const& rhs) { return lhs.save_path < rhs.save_path; }},
         {{"size", false},           [](auto const& lhs, auto const& rhs) { return lhs.size > rhs.size; }},
         {{"size", true},            [](auto const& lhs, auto const& rhs) { return lhs.size < rhs.size; }},
         {{"total", false},          [](auto const& lhs, auto const& rhs) { return lhs.total > rhs.total; }},
@@ -64,10 +183,16 @@ void TorrentsList::Invoke(const TorrentsListReq& req, WriteCb<TorrentsListRes> c
         {{"total_done", true},      [](auto const& lhs, auto const& rhs) { return lhs.total_done < rhs.total_done; }},
         {{"upload_rate", false},    [](auto const& lhs, auto const& rhs) { return lhs.upload_rate > rhs.upload_rate; }},
         {{"upload_rate", true},     [](auto const& lhs, auto const& rhs) { return lhs.upload_rate < rhs.upload_rate; }},
+        {{"upload_rate_avg", false}, [](auto const& lhs, auto const& rhs) { return lhs.upload_rate_avg > rhs.upload_rate_avg; }},
+        {{"upload_rate_avg", true},  [](auto const& lhs, auto const& rhs) { return lhs.upload_rate_avg < rhs.upload_rate_avg; }},
     };
 
-    std::string field = req.order_by.value_or("queue_position");
-    bool order_asc = req.order_by_dir.value_or("asc") == "asc";
+    const bool searching = req.search.has_value() && !req.search->empty();
+
+    // Search results come best first unless asked otherwise.
+    std::string field = req.order_by.value_or(searching ? "relevance" : "queue_position");
+    const std::string order_dir = req.order_by_dir.value_or(searching && !req.order_by.has_value() ? "desc" : "asc");
+    bool order_asc = order_dir == "asc";
 
     auto const& sorter = sorters.find({field,order_asc});
 
@@ -76,64 +201,143 @@ void TorrentsList::Invoke(const TorrentsListReq& req, WriteCb<TorrentsListRes> c
         return cb.Error(-1, "Invalid field in 'order_by'");
     }
 
-    std::vector<TorrentsListRes::Item> torrents;
-    torrents.reserve(m_session.Torrents().size());
+    // Parsed before collecting, since a maintained order starts walking from it.
+    std::optional<TorrentsListRes::Item> after;
 
-    for (auto const& [_, handle] : m_session.Torrents())
+    if (req.cursor.has_value())
     {
-        const auto client_data = handle.userdata().get<TorrentClientData>();
+        try
+        {
+            if (req.cursor->value("order_by", "") != field
+                || req.cursor->value("order_by_dir", "") != order_dir)
+            {
+                return cb.Error(-4, "Invalid cursor - ordering does not match");
+            }
 
-        std::map<std::string, json> metadata = {};
-        std::int64_t size                    = -1;
+            req.cursor->at("after").get_to(after.emplace());
+        }
+        catch (const json::exception&)
+        {
+            return cb.Error(-4, "Invalid cursor");
+        }
+    }
 
-        if (req.include_metadata.has_value())
+    static const std::unordered_set<std::string> known_fields =
+    {
+        "added_time", "all_time_download", "all_time_upload", "category", "download_rate", "download_rate_avg",
+        "error", "eta", "eta_avg", "flags", "info_hash", "list_peers", "list_seeds", "metadata", "moving_storage",
+        "name", "num_peers", "num_seeds", "parked", "progress", "queue_position", "ratio", "relevance", "save_path",
+        "size", "state", "tags", "total", "total_done", "upload_rate", "upload_rate_avg"
+    };
+
+    // Only compute the requested fields. The field we sort on is always needed.
+    std::optional<std::unordered_set<std::string>> fields;
+
+    if (req.fields.has_value())
+    {
+        fields = std::unordered_set<std::string>(req.fields->begin(), req.fields->end());
+        fields->insert(field);
+
+        for (const auto& f : *fields)
         {
-            const auto metadata_keys   = req.include_metadata.value();
-            const auto metadata_client = client_data->metadata.value_or(std::map<std::string, nlohmann::json>());
+            if (!known_fields.contains(f))
+            {
+                return cb.Error(-3, "Invalid field in 'fields': " + f);
+            }
+        }
+    }
+
+    const auto include = [&fields](const char* name)
+    {
+        return !fields.has_value() || fields->contains(name);
+    };
+
+    // Compile the query filter once for the whole request instead of once per torrent.
+    std::shared_ptr<Query::PQL::Filter> query_filter;
 
-            // Include metadata for all the keys specified. If ["*"], include everything.
+    if (req.filters.has_value() && req.filters->contains("query"))
+    {
+        const auto& query = req.filters->at("query");
 
-            if (metadata_keys.size() == 1 && metadata_keys.at(0) == "*")
+        if (query.is_string() && !query.get<std::string>().empty())
+        {
+            try
             {
-                metadata = metadata_client;
+                query_filter = Query::PQL::ParseCached(query.get<std::string>());
             }
-            else
+            catch (const Query::QueryError& qe)
             {
-                for (const auto& key : metadata_keys)
-                {
-                    if (!metadata_client.contains(key)) continue;
-                    metadata[key] = metadata_client.at(key);
-                }
+                return cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
             }
         }
+    }
+
+    // Views are kept up to date as torrents change, so filtering on one is a set lookup.
+    const TorrentViews::HashSet* view = nullptr;
+
+    if (req.filters.has_value() && req.filters->contains("view"))
+    {
+        const auto& name = req.filters->at("view");
+
+        if (!name.is_string() || m_views == nullptr || (view = m_views->Find(name.get<std::string>())) == nullptr)
+        {
+            return cb.Error(-6, "Invalid view");
+        }
+    }
+
+    // Relevance of every torrent matching the search, which the other filters then narrow
+    // down further.
+    std::map<lt::info_hash_t, double> relevance;
+    TorrentIndex::HashSet search_hashes;
+
+    if (searching)
+    {
+        for (const auto& [hash, score] : m_index.Search(*req.search))
+        {
+            relevance.insert({ hash, score });
+            search_hashes.insert(hash);
+        }
+    }
+
+    // Every matching torrent becomes an item, though only a page is written, so the item
+    // vector and the strings in it come from one arena which goes with the response.
+    auto arena = std::make_shared<Utils::Arena>();
 
-        auto const& ts = handle.status();
+    std::pmr::vector<TorrentsListRes::Item> torrents(arena->Resource());
 
-        if (auto ti = ts.torrent_file.lock())
-            size = ti->total_size();
+    // Set when iterating candidates planned from the query, which only need the residual
+    // part of it checked.
+    bool query_planned = false;
 
+    const auto passes = [&](const lt::torrent_status& ts, const TorrentClientData* client_data)
+    {
         // Filter torrents here.
-        bool filter_includes_torrent = true;
+        bool filter_includes_torrent = !searching || relevance.contains(ts.info_hashes);
 
         if (const auto& filters = req.filters)
         {
             for (const auto& [filter_field, args] : filters.value())
             {
+                if (!filter_includes_torrent)
+                {
+                    break;
+                }
+
                 if (filter_field == "category" && args.is_string())
                 {
-                    filter_includes_torrent = client_data->category == args;
+                    filter_includes_torrent = client_data != nullptr
+                        && client_data->category.has_value()
+                        && *client_data->category == args.get_ref<const std::string&>();
                 }
-                else if (filter_field == "query" && args.is_string() && !args.get<std::string>().empty())
+                else if (filter_field == "query" && query_filter)
                 {
-                    try
-                    {
-                        const auto filter = Query::PQL::Parse(args.get<std::string>());
-                        filter_includes_torrent = filter->Includes(ts);
-                    }
-                    catch (const Query::QueryError& qe)
-                    {
-                        return cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
-                    }
+                    filter_includes_torrent = query_planned
+                        ? query_filter->IncludesCandidate(ts, m_rates, m_peers)
+                        : query_filter->Includes(ts, m_rates, m_peers);
+                }
+                else if (filter_field == "view")
+                {
+                    filter_includes_torrent = view->contains(ts.info_hashes);
                 }
                 else if (filter_field == "save_path" && args.is_string())
                 {
@@ -141,73 +345,422 @@ void TorrentsList::Invoke(const TorrentsListReq& req, WriteCb<TorrentsListRes> c
                 }
                 else if (filter_field == "tags" && args.is_string())
                 {
-                    const auto& tag_value = args.get<std::string>();
-                    const auto  tags      = client_data->tags.value_or(std::unordered_set<std::string>());
-
-                    filter_includes_torrent = tags.find(tag_value) != tags.end();
+                    filter_includes_torrent = client_data != nullptr
+                        && client_data->tags.has_value()
+                        && client_data->tags->contains(args.get_ref<const std::string&>());
                 }
             }
         }
 
-        if (!filter_includes_torrent)
+        return filter_includes_torrent;
+    };
+
+    // Items are first made with only the field they are sorted on, since most of them are
+    // never on the page. Those on it are made again in full once the page is known.
+    const auto make_item = [&](const lt::torrent_status& ts, const TorrentClientData* client_data, bool full)
+    {
+        const auto wanted = [&](const char* name)
         {
-            continue;
+            return full ? include(name) : field == name;
+        };
+
+        TorrentsListRes::Item item{ .info_hash = ts.info_hashes };
+
+        if (wanted("added_time"))        item.added_time        = ts.added_time;
+        if (wanted("all_time_download")) item.all_time_download = ts.all_time_download;
+        if (wanted("all_time_upload"))   item.all_time_upload   = ts.all_time_upload;
+        if (wanted("category"))          item.category          = client_data ? client_data->category : std::nullopt;
+        if (wanted("download_rate"))     item.download_rate     = ts.download_rate;
+        if (wanted("download_rate_avg")) item.download_rate_avg = static_cast<int>(m_rates ? m_rates->Download(ts) : ts.download_payload_rate);
+        if (wanted("error"))             item.error             = ts.errc;
+        if (wanted("eta"))               item.eta               = porla::Utils::ETA(ts).count();
+        if (wanted("eta_avg"))           item.eta_avg           = (m_rates ? m_rates->ETA(ts) : porla::Utils::ETA(ts)).count();
+        if (wanted("flags"))             item.flags             = static_cast<std::uint64_t>(ts.flags);
+        if (wanted("list_peers"))        item.list_peers        = ts.list_peers;
+        if (wanted("list_seeds"))        item.list_seeds        = ts.list_seeds;
+        if (wanted("moving_storage"))    item.moving_storage    = ts.moving_storage;
+        if (wanted("name"))              item.name.emplace(ts.name, arena->Resource());
+        if (wanted("num_peers"))         item.num_peers         = ts.num_peers;
+        if (wanted("num_seeds"))         item.num_seeds         = ts.num_seeds;
+        if (wanted("parked"))            item.parked            = m_session.Parked(ts.info_hashes).has_value();
+        if (wanted("progress"))          item.progress          = ts.progress;
+        if (wanted("queue_position"))    item.queue_position    = static_cast<int>(ts.queue_position);
+        if (wanted("ratio"))             item.ratio             = porla::Utils::Ratio(ts);
+        if (wanted("relevance") && searching)
+        {
+            const auto score = relevance.find(ts.info_hashes);
+            item.relevance = score != relevance.end() ? std::optional(score->second) : std::nullopt;
+        }
+        if (wanted("save_path"))         item.save_path.emplace(ts.save_path, arena->Resource());
+        if (wanted("state"))             item.state             = ts.state;
+        if (wanted("tags"))              item.tags              = client_data ? client_data->tags.value_or(SymbolSet()) : SymbolSet();
+        if (wanted("total"))             item.total             = ts.total;
+        if (wanted("total_done"))        item.total_done        = ts.total_done;
+        if (wanted("upload_rate"))       item.upload_rate       = ts.upload_rate;
+        if (wanted("upload_rate_avg"))   item.upload_rate_avg   = static_cast<int>(m_rates ? m_rates->Upload(ts) : ts.upload_payload_rate);
+
+        if (wanted("metadata"))
+        {
+            std::map<std::string, json> metadata = {};
+
+            if (req.include_metadata.has_value() && m_metadata != nullptr)
+            {
+                const auto& metadata_keys = req.include_metadata.value();
+
+                // Include metadata for all the keys specified. If ["*"], include everything.
+
+                metadata = metadata_keys.size() == 1 && metadata_keys.at(0) == "*"
+                    ? m_metadata->Get(ts.info_hashes)
+                    : m_metadata->Get(ts.info_hashes, metadata_keys);
+            }
+
+            item.metadata = metadata;
+        }
+
+        if (wanted("size"))
+        {
+            // Parked torrents no longer have the info dict, only its size.
+            auto ti = ts.torrent_file.lock();
+            item.size = ti ? ti->total_size() : m_session.Parked(ts.info_hashes) && ts.has_metadata ? ts.total_wanted : -1;
+        }
+
+        return item;
+    };
+
+    // Adds the torrent to the result if it passes the filters.
+    const auto collect = [&](const lt::torrent_status& ts)
+    {
+        const auto client_data = m_session.ClientData(ts);
+
+        if (!passes(ts, client_data))
+        {
+            return false;
+        }
+
+        torrents.push_back(make_item(ts, client_data, false));
+
+        return true;
+    };
+
+    std::optional<std::vector<lt::info_hash_t>> removed;
+
+    // Rows of the column snapshot, when the torrents were selected from it.
+    bool from_columns = false;
+    std::vector<std::uint32_t> rows;
+    Query::Bitmap selection;
+
+    // Set when only the page was collected, to the number of torrents it was taken from.
+    std::optional<std::size_t> rows_total;
+    std::optional<bool> rows_more;
+
+    // Without filters, a sorted page of every torrent is a slice of a maintained order.
+    const auto order = m_orders != nullptr && !req.since_revision.has_value() && !searching && (!req.filters.has_value() || req.filters->empty())
+        ? TorrentOrders::Find(field)
+        : std::nullopt;
+
+    if (order.has_value())
+    {
+        const auto& statuses = m_session.TorrentStatuses();
+        const std::size_t page_size = req.page_size.value_or(50);
+        const std::size_t skip = after.has_value() ? 0 : req.page.value_or(0) * page_size;
+
+        if (skip > m_orders->Size())
+        {
+            return cb.Error(-2, "Invalid page - too large.");
         }
 
-        torrents.emplace_back(TorrentsListRes::Item{
-            .all_time_download = ts.all_time_download,
-            .all_time_upload   = ts.all_time_upload,
-            .category          = client_data->category,
-            .download_rate     = ts.download_rate,
-            .error             = ts.errc,
-            .eta               = porla::Utils::ETA(ts).count(),
-            .flags             = static_cast<std::uint64_t>(ts.flags),
-            .info_hash         = ts.info_hashes,
-            .list_peers        = ts.list_peers,
-            .list_seeds        = ts.list_seeds,
-            .metadata          = metadata,
-            .moving_storage    = ts.moving_storage,
-            .name              = ts.name,
-            .num_peers         = ts.num_peers,
-            .num_seeds         = ts.num_seeds,
-            .progress          = ts.progress,
-            .queue_position    = static_cast<int>(ts.queue_position),
-            .ratio             = porla::Utils::Ratio(ts),
-            .save_path         = ts.save_path,
-            .size              = size,
-            .state             = ts.state,
-            .tags              = client_data->tags.value_or(std::unordered_set<std::string>()),
-            .total             = ts.total,
-            .total_done        = ts.total_done,
-            .upload_rate       = ts.upload_rate,
+        std::optional<TorrentOrders::After> from;
+
+        if (after.has_value())
+        {
+            from = TorrentOrders::After{
+                .name      = after->name.has_value() ? std::string(*after->name) : std::string(),
+                .number    = CursorNumber(*order, *after),
+                .info_hash = after->info_hash
+            };
+        }
+
+        torrents.reserve(page_size);
+        rows_more = false;
+
+        m_orders->Walk(*order, order_asc, from, skip, [&](const lt::info_hash_t& hash)
+        {
+            if (torrents.size() == page_size)
+            {
+                rows_more = true;
+                return false;
+            }
+
+            if (auto status = statuses.find(hash); status != statuses.end())
+            {
+                torrents.push_back(make_item(status->second, m_session.ClientData(status->second), false));
+            }
+
+            return true;
         });
+
+        rows_total = m_orders->Size();
     }
+    else if (req.since_revision.has_value())
+    {
+        // Only return what changed since the client's revision. Torrents which changed but
+        // no longer match the filters are reported as removed.
+        removed = std::vector<lt::info_hash_t>();
 
-    std::sort(
-        torrents.begin(),
-        torrents.end(),
-        [&sorter](auto const& lhs, auto const& rhs)
+        if (!m_revisions.RemovedSince(*req.since_revision, [&](auto const& hash) { removed->push_back(hash); }))
         {
-            return sorter->second(lhs, rhs);
-        });
+            return cb.Error(-5, "Revision is too old - a full refresh is required");
+        }
 
-    int page_beg = req.page.value_or(0) * req.page_size.value_or(50);
-    int page_end = std::min(
-        page_beg + req.page_size.value_or(50),
-        static_cast<int>(torrents.size()));
+        m_revisions.ChangedSince(
+            *req.since_revision,
+            [&](auto const& hash)
+            {
+                const auto& statuses = m_session.TorrentStatuses();
+
+                if (auto status = statuses.find(hash); status != statuses.end() && !collect(status->second))
+                {
+                    removed->push_back(hash);
+                }
+            });
+    }
+    else
+    {
+        const auto& statuses = m_session.TorrentStatuses();
+        const auto candidates = IndexCandidates(req);
+        const auto query_candidates = query_filter
+            ? query_filter->Candidates(m_index)
+            : std::nullopt;
+
+        const auto collect_from = [&](const TorrentIndex::HashSet& hashes)
+        {
+            torrents.reserve(hashes.size());
+
+            for (auto const& hash : hashes)
+            {
+                if (auto status = statuses.find(hash); status != statuses.end())
+                {
+                    collect(status->second);
+                }
+            }
+        };
+
+        // The search, equality filters or the query narrowed it down to a few torrents. These
+        // still go through every filter, so iterate whichever set is smallest.
+        if (searching)
+        {
+            collect_from(search_hashes);
+        }
+        else if (query_candidates.has_value() && (candidates == nullptr || query_candidates->size() <= candidates->size()))
+        {
+            query_planned = true;
+            collect_from(*query_candidates);
+        }
+        else if (candidates != nullptr)
+        {
+            collect_from(*candidates);
+        }
+        else if (query_filter && m_columns != nullptr && query_filter->Select(m_columns->Snapshot(), selection))
+        {
+            // Equality filters always go through the index above, so the selection from
+            // the columns is the complete result.
+            const auto& columns = m_columns->Snapshot();
+            from_columns = true;
+
+            for (std::uint32_t row = 0; row < columns.Size(); row++)
+            {
+                if ((selection[row / 64] >> (row % 64)) & 1) { rows.push_back(row); }
+            }
+        }
+        else if (!query_filter && m_columns != nullptr)
+        {
+            from_columns = true;
+            rows.resize(m_columns->Snapshot().Size());
+            std::iota(rows.begin(), rows.end(), 0);
+        }
+        else
+        {
+            torrents.reserve(statuses.size());
+
+            for (auto const& [_, ts] : statuses)
+            {
+                collect(ts);
+            }
+        }
+    }
+
+    // Rows selected through the columns become items here. If the sort field has a column
+    // as well, the rows are ordered first and only the page is ever built.
+    if (from_columns)
+    {
+        const auto& columns  = m_columns->Snapshot();
+        const auto& statuses = m_session.TorrentStatuses();
+        const auto row_sorter = ColumnSorter(columns, field, order_asc);
+
+        std::size_t beg = 0;
+        std::size_t end = rows.size();
+
+        if (row_sorter && !req.cursor.has_value())
+        {
+            const std::size_t page_size = req.page_size.value_or(50);
+
+            beg = req.page.value_or(0) * page_size;
+
+            if (beg > rows.size())
+            {
+                return cb.Error(-2, "Invalid page - too large.");
+            }
+
+            end = std::min(beg + page_size, rows.size());
+
+            if (beg > 0 && beg < rows.size())
+            {
+                std::nth_element(rows.begin(), rows.begin() + beg, rows.end(), row_sorter);
+            }
+
+            std::partial_sort(rows.begin() + beg, rows.begin() + end, rows.end(), row_sorter);
+
+            rows_total = rows.size();
+        }
+
+        torrents.reserve(end - beg);
+
+        for (std::size_t i = beg; i < end; i++)
+        {
+            if (auto status = statuses.find(columns.hashes[rows[i]]); status != statuses.end())
+            {
+                torrents.push_back(make_item(status->second, m_session.ClientData(status->second), false));
+            }
+        }
+    }
+
+    // Break ties on info hash so the order is total, which keyset paging depends on.
+    // Names are ordered by collation key when the orders keep them, so a filtered page
+    // orders the same as an unfiltered one. The cursor item may be for a removed torrent,
+    // so its key is computed from its name.
+    const bool collate = m_orders != nullptr && field == "name";
+    const std::string after_key = collate && after.has_value() && after->name.has_value()
+        ? TorrentOrders::Collate(*after->name)
+        : std::string();
+
+    const auto name_key = [&](const TorrentsListRes::Item& item) -> std::string_view
+    {
+        if (after.has_value() && &item == &*after) return after_key;
+        const auto key = m_orders->NameKey(item.info_hash);
+        return key != nullptr ? std::string_view(*key) : std::string_view();
+    };
 
-    if (page_beg > torrents.size())
+    const auto compare = [&](auto const& lhs, auto const& rhs)
+    {
+        if (collate)
+        {
+            const auto lk = name_key(lhs);
+            const auto rk = name_key(rhs);
+            if (lk != rk) return order_asc ? lk < rk : lk > rk;
+            return lhs.info_hash < rhs.info_hash;
+        }
+
+        if (sorter->second(lhs, rhs)) return true;
+        if (sorter->second(rhs, lhs)) return false;
+        return lhs.info_hash < rhs.info_hash;
+    };
+
+    // A delta is small and returned in full.
+    const int page_size = req.since_revision.has_value()
+        ? static_cast<int>(torrents.size())
+        : req.page_size.value_or(50);
+
+    int page_beg = req.page.value_or(0) * page_size;
+
+    if (req.since_revision.has_value() || rows_total.has_value())
+    {
+        // Either returned in full, or the page was selected already.
+        page_beg = 0;
+    }
+    else if (after.has_value())
+    {
+        // Move everything up to and including the cursor to the front and start the
+        // page right after it.
+        const auto first = std::partition(
+            torrents.begin(),
+            torrents.end(),
+            [&](auto const& item) { return !compare(*after, item); });
+
+        page_beg = static_cast<int>(std::distance(torrents.begin(), first));
+    }
+    else if (page_beg > torrents.size())
     {
         return cb.Error(-2, "Invalid page - too large.");
     }
 
-    cb.Ok(TorrentsListRes{
-        .order_by                  = req.order_by.value_or("queue_position"),
-        .order_by_dir              = req.order_by_dir.value_or("asc"),
+    const int page_end = std::min(
+        page_beg + page_size,
+        static_cast<int>(torrents.size()));
+
+    // Only order what the page needs - select the page start, then sort the page itself.
+    if (!rows_total.has_value())
+    {
+        if (!req.cursor.has_value() && page_beg > 0 && page_beg < torrents.size())
+        {
+            std::nth_element(torrents.begin(), torrents.begin() + page_beg, torrents.end(), compare);
+        }
+
+        std::partial_sort(torrents.begin() + page_beg, torrents.begin() + page_end, torrents.end(), compare);
+    }
+
+    for (int i = page_beg; i < page_end; i++)
+    {
+        const auto& statuses = m_session.TorrentStatuses();
+
+        if (auto status = statuses.find(torrents[i].info_hash); status != statuses.end())
+        {
+            torrents[i] = make_item(status->second, m_session.ClientData(status->second), true);
+        }
+    }
+
+    const std::size_t total = rows_total.value_or(torrents.size());
+    const bool has_more = rows_more.has_value()
+        ? *rows_more
+        : rows_total.has_value()
+            ? (req.page.value_or(0) * page_size) + page_end < total
+            : page_end < torrents.size();
+
+    std::optional<json> next_cursor;
+
+    if (page_end > page_beg && has_more)
+    {
+        const json last = torrents.at(page_end - 1);
+
+        next_cursor = {
+            {"order_by", field},
+            {"order_by_dir", order_dir},
+            {"after", {
+                {"info_hash", last["info_hash"]},
+                {field, last[field]}
+            }}
+        };
+    }
+
+    // The page is streamed separately, so large pages never exist as one JSON document.
+    json result = TorrentsListRes{
+        .next_cursor               = next_cursor,
+        .order_by                  = field,
+        .order_by_dir              = order_dir,
         .page                      = req.page.value_or(0),
-        .page_size                 = req.page_size.value_or(50),
-        .torrents                  = std::vector(torrents.begin() + page_beg, torrents.begin() + page_end),
-        .torrents_total            = static_cast<int>(torrents.size()),
+        .page_size                 = page_size,
+        .removed                   = removed,
+        .revision                  = m_revisions.Current(),
+        .torrents_total            = static_cast<int>(total),
         .torrents_total_unfiltered = static_cast<int>(m_session.Torrents().size())
-    });
+    };
+
+    result.erase("torrents");
+
+    cb.OkStreamed(
+        std::move(result),
+        "torrents",
+        std::vector(
+            std::make_move_iterator(torrents.begin() + page_beg),
+            std::make_move_iterator(torrents.begin() + page_end)),
+        std::move(arena));
 }
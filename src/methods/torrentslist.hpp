@@ -4,10 +4,18 @@
 
 #include "method.hpp"
 #include "torrentslist_reqres.hpp"
+#include "../torrentindex.hpp"
 
 namespace porla
 {
     class ISession;
+    class MetadataStore;
+    class PeerAggregates;
+    class TorrentColumns;
+    class TorrentOrders;
+    class TorrentRates;
+    class TorrentRevisions;
+    class TorrentViews;
 }
 
 namespace porla::Methods
@@ -15,12 +23,37 @@ namespace porla::Methods
     class TorrentsList : public Method<TorrentsListReq, TorrentsListRes>
     {
     public:
-        explicit TorrentsList(sqlite3* db, porla::ISession& session);
+        // The column snapshot is optional and used for full scans when available. Without
+        // views, the 'view' filter matches nothing, and without a metadata store no
+        // metadata is included. With the orders, unfiltered sorted pages are read off them.
+        // Without the rates, the smoothed fields are the instantaneous payload rates, and
+        // without the peer samples, queries over peers match nothing.
+        explicit TorrentsList(
+            sqlite3* db,
+            porla::ISession& session,
+            porla::TorrentIndex& index,
+            porla::TorrentRevisions& revisions,
+            porla::TorrentColumns* columns = nullptr,
+            porla::TorrentViews* views = nullptr,
+            porla::MetadataStore* metadata = nullptr,
+            porla::TorrentOrders* orders = nullptr,
+            porla::TorrentRates* rates = nullptr,
+            porla::PeerAggregates* peers = nullptr);
 
         void Invoke(const TorrentsListReq& req, WriteCb<TorrentsListRes> cb) override;
 
     private:
+        const TorrentIndex::HashSet* IndexCandidates(const TorrentsListReq& req);
+
         sqlite3* m_db;
         porla::ISession& m_session;
+        porla::TorrentIndex& m_index;
+        porla::TorrentRevisions& m_revisions;
+        porla::TorrentColumns* m_columns;
+        porla::TorrentViews* m_views;
+        porla::MetadataStore* m_metadata;
+        porla::TorrentOrders* m_orders;
+        porla::TorrentRates* m_rates;
+        porla::PeerAggregates* m_peers;
     };
 }
@@ -1,60 +1,85 @@
 #pragma once
 
 #include <map>
+#include <memory_resource>
 #include <optional>
 #include <vector>
 
 #include <libtorrent/info_hash.hpp>
 
+#include "../symbol.hpp"
+
 namespace porla::Methods
 {
     struct TorrentsListReq
     {
+        std::optional<json> cursor;
+        std::optional<std::vector<std::string>> fields;
         std::optional<std::map<std::string, nlohmann::json>> filters;
         std::optional<std::vector<std::string>> include_metadata;
         std::optional<int> page;
         std::optional<int> page_size;
         std::optional<std::string> order_by;
         std::optional<std::string> order_by_dir;
+        // Ranks the torrents whose name or save path contains every word, and orders by
+        // relevance unless order_by is set.
+        std::optional<std::string> search;
+        std::optional<std::uint64_t> since_revision;
     };
 
     struct TorrentsListRes
     {
+        // Every field but info_hash is optional, so only the fields requested with
+        // TorrentsListReq::fields are computed and serialized. The strings are allocated
+        // from the arena of the request.
         struct Item
         {
-            std::int64_t                    all_time_download;
-            std::int64_t                    all_time_upload;
-            std::optional<std::string>      category;
-            int                             download_rate;
-            libtorrent::error_code          error;
-            std::int64_t                    eta;
-            std::uint64_t                   flags;
-            lt::info_hash_t                 info_hash;
-            int                             list_peers;
-            int                             list_seeds;
-            std::optional<json>             metadata;
-            bool                            moving_storage;
-            std::string                     name;
-            int                             num_peers;
-            int                             num_seeds;
-            float                           progress;
-            int                             queue_position;
-            double                          ratio;
-            std::string                     save_path;
-            std::int64_t                    size;
-            int                             state;
-            std::unordered_set<std::string> tags;
-            std::int64_t                    total;
-            std::int64_t                    total_done;
-            int                             upload_rate;
+            std::optional<std::int64_t>                    added_time;
+            std::optional<std::int64_t>                    all_time_download;
+            std::optional<std::int64_t>                    all_time_upload;
+            std::optional<Symbol>                          category;
+            std::optional<int>                             download_rate;
+            // Smoothed payload rate, in bytes per second.
+            std::optional<int>                             download_rate_avg;
+            std::optional<libtorrent::error_code>          error;
+            std::optional<std::int64_t>                    eta;
+            // From the smoothed download rate.
+            std::optional<std::int64_t>                    eta_avg;
+            std::optional<std::uint64_t>                   flags;
+            lt::info_hash_t                                info_hash;
+            std::optional<int>                             list_peers;
+            std::optional<int>                             list_seeds;
+            std::optional<json>                            metadata;
+            std::optional<bool>                            moving_storage;
+            std::optional<std::pmr::string>                name;
+            std::optional<int>                             num_peers;
+            std::optional<int>                             num_seeds;
+            // Out of libtorrent until resumed, listed from its last status.
+            std::optional<bool>                            parked;
+            std::optional<float>                           progress;
+            std::optional<int>                             queue_position;
+            std::optional<double>                          ratio;
+            // Set when searching.
+            std::optional<double>                          relevance;
+            std::optional<std::pmr::string>                save_path;
+            std::optional<std::int64_t>                    size;
+            std::optional<int>                             state;
+            std::optional<SymbolSet>                       tags;
+            std::optional<std::int64_t>                    total;
+            std::optional<std::int64_t>                    total_done;
+            std::optional<int>                             upload_rate;
+            std::optional<int>                             upload_rate_avg;
         };
 
-        std::string       order_by;
-        std::string       order_by_dir;
-        int               page;
-        int               page_size;
-        std::vector<Item> torrents;
-        int               torrents_total;
-        int               torrents_total_unfiltered;
+        std::optional<json>                         next_cursor;
+        std::string                                 order_by;
+        std::string                                 order_by_dir;
+        int                                         page;
+        int                                         page_size;
+        std::optional<std::vector<lt::info_hash_t>> removed;
+        std::uint64_t                               revision;
+        std::vector<Item>                           torrents;
+        int                                         torrents_total;
+        int                                         torrents_total_unfiltered;
     };
 }
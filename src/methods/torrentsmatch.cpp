@@ -0,0 +1,79 @@
+#include "torrentsmatch.hpp"
+
+#include <libtorrent/torrent_info.hpp>
+
+#include "../contentindex.hpp"
+#include "../session.hpp"
+#include "../utils/base64.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Methods::TorrentsMatch;
+using porla::Methods::TorrentsMatchReq;
+using porla::Methods::TorrentsMatchRes;
+
+TorrentsMatch::TorrentsMatch(porla::ISession& session, const porla::ContentIndex& index)
+    : m_session(session)
+    , m_index(index)
+{
+}
+
+void TorrentsMatch::Invoke(const TorrentsMatchReq& req, WriteCb<TorrentsMatchRes> cb)
+{
+    std::string buffer = req.ti;
+
+    if (!porla::Utils::Base64::DecodeInPlace(buffer))
+    {
+        return cb.Error(-1, "Invalid base64 in 'ti' parameter");
+    }
+
+    lt::error_code ec;
+    const lt::bdecode_node node = lt::bdecode(buffer, ec);
+
+    if (ec)
+    {
+        return cb.Error(-2, "Invalid torrent file", {{"message", ec.message()}});
+    }
+
+    const lt::torrent_info ti(node, ec);
+
+    if (ec)
+    {
+        return cb.Error(-2, "Invalid torrent file", {{"message", ec.message()}});
+    }
+
+    int files = 0;
+
+    for (const auto file : ti.files().file_range())
+    {
+        if (!ti.files().pad_file_at(file)) files++;
+    }
+
+    const auto& statuses = m_session.TorrentStatuses();
+    const auto limit = static_cast<std::size_t>(std::max(0, req.limit.value_or(50)));
+
+    TorrentsMatchRes res;
+
+    for (const auto& match : m_index.Find(ti.files()))
+    {
+        if (res.matches.size() >= limit)
+        {
+            break;
+        }
+
+        const auto status = statuses.find(match.info_hash);
+        if (status == statuses.end()) { continue; }
+
+        res.matches.push_back({
+            .bytes     = match.bytes,
+            .complete  = match.files >= files,
+            .files     = match.files,
+            .info_hash = match.info_hash,
+            .name      = status->second.name,
+            .same_size = match.same_size,
+            .save_path = status->second.save_path
+        });
+    }
+
+    cb.Ok(res);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsmatch_reqres.hpp"
+
+namespace porla
+{
+    class ContentIndex;
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    class TorrentsMatch : public Method<TorrentsMatchReq, TorrentsMatchRes>
+    {
+    public:
+        explicit TorrentsMatch(ISession& session, const ContentIndex& index);
+
+    protected:
+        void Invoke(const TorrentsMatchReq& req, WriteCb<TorrentsMatchRes> cb) override;
+
+    private:
+        ISession& m_session;
+        const ContentIndex& m_index;
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsMatchReq
+    {
+        std::optional<int> limit;
+        // The torrent file, base64 encoded.
+        std::string        ti;
+    };
+
+    struct TorrentsMatchRes
+    {
+        struct Match
+        {
+            std::int64_t            bytes;
+            // Every file of the torrent file was found in this torrent.
+            bool                    complete;
+            int                     files;
+            libtorrent::info_hash_t info_hash;
+            std::string             name;
+            bool                    same_size;
+            std::string             save_path;
+        };
+
+        std::vector<Match> matches;
+    };
+}
@@ -0,0 +1,19 @@
+#include "torrentsmetadatafind.hpp"
+
+#include "../metadatastore.hpp"
+
+using porla::Methods::TorrentsMetadataFind;
+using porla::Methods::TorrentsMetadataFindReq;
+using porla::Methods::TorrentsMetadataFindRes;
+
+TorrentsMetadataFind::TorrentsMetadataFind(MetadataStore& metadata)
+    : m_metadata(metadata)
+{
+}
+
+void TorrentsMetadataFind::Invoke(const TorrentsMetadataFindReq& req, WriteCb<TorrentsMetadataFindRes> cb)
+{
+    cb.Ok(TorrentsMetadataFindRes{
+        .info_hashes = m_metadata.Find(req.key, req.value)
+    });
+}
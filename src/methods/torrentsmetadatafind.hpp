@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsmetadatafind_reqres.hpp"
+
+namespace porla
+{
+    class MetadataStore;
+}
+
+namespace porla::Methods
+{
+    // The torrents with a value for a metadata key. Answered from memory for the keys in
+    // the configured indexes, and by scanning the stored metadata for the others.
+    class TorrentsMetadataFind : public Method<TorrentsMetadataFindReq, TorrentsMetadataFindRes>
+    {
+    public:
+        explicit TorrentsMetadataFind(MetadataStore& metadata);
+
+    protected:
+        void Invoke(const TorrentsMetadataFindReq& req, WriteCb<TorrentsMetadataFindRes> cb) override;
+
+    private:
+        MetadataStore& m_metadata;
+    };
+}
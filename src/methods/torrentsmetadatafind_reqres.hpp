@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsMetadataFindReq
+    {
+        std::string    key;
+        nlohmann::json value;
+    };
+
+    struct TorrentsMetadataFindRes
+    {
+        std::vector<libtorrent::info_hash_t> info_hashes;
+    };
+}
@@ -0,0 +1,26 @@
+#include "torrentsmetadataget.hpp"
+
+#include "../metadatastore.hpp"
+#include "../session.hpp"
+
+using porla::Methods::TorrentsMetadataGet;
+using porla::Methods::TorrentsMetadataGetReq;
+using porla::Methods::TorrentsMetadataGetRes;
+
+TorrentsMetadataGet::TorrentsMetadataGet(ISession& session, MetadataStore& metadata)
+    : m_session(session)
+    , m_metadata(metadata)
+{
+}
+
+void TorrentsMetadataGet::Invoke(const TorrentsMetadataGetReq& req, WriteCb<TorrentsMetadataGetRes> cb)
+{
+    if (!m_session.Torrents().contains(req.info_hash))
+    {
+        return cb.Error(-1, "Torrent not found");
+    }
+
+    return cb.Ok(TorrentsMetadataGetRes{
+        .metadata = m_metadata.Get(req.info_hash, req.keys)
+    });
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsmetadataget_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+    class MetadataStore;
+}
+
+namespace porla::Methods
+{
+    // The values of some metadata keys for a torrent, leaving out the keys it does not have.
+    class TorrentsMetadataGet : public Method<TorrentsMetadataGetReq, TorrentsMetadataGetRes>
+    {
+    public:
+        explicit TorrentsMetadataGet(ISession& session, MetadataStore& metadata);
+
+    protected:
+        void Invoke(const TorrentsMetadataGetReq& req, WriteCb<TorrentsMetadataGetRes> cb) override;
+
+    private:
+        ISession& m_session;
+        MetadataStore& m_metadata;
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsMetadataGetReq
+    {
+        libtorrent::info_hash_t  info_hash;
+        std::vector<std::string> keys;
+    };
+
+    struct TorrentsMetadataGetRes
+    {
+        std::map<std::string, nlohmann::json> metadata;
+    };
+}
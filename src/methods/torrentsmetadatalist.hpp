@@ -1,13 +1,12 @@
 #pragma once
 
-#include <sqlite3.h>
-
 #include "method.hpp"
 #include "torrentsmetadatalist_reqres.hpp"
 
 namespace porla
 {
     class ISession;
+    class MetadataStore;
 }
 
 namespace porla::Methods
@@ -15,13 +14,13 @@ namespace porla::Methods
     class TorrentsMetadataList : public Method<TorrentsMetadataListReq, TorrentsMetadataListRes>
     {
     public:
-        explicit TorrentsMetadataList(sqlite3* db, ISession& session);
+        explicit TorrentsMetadataList(ISession& session, MetadataStore& metadata);
 
     protected:
         void Invoke(const TorrentsMetadataListReq& req, WriteCb<TorrentsMetadataListRes> cb) override;
 
     private:
-        sqlite3* m_db;
         ISession& m_session;
+        MetadataStore& m_metadata;
     };
 }
@@ -0,0 +1,26 @@
+#include "torrentsmetadataset.hpp"
+
+#include "../metadatastore.hpp"
+#include "../session.hpp"
+
+using porla::Methods::TorrentsMetadataSet;
+using porla::Methods::TorrentsMetadataSetReq;
+using porla::Methods::TorrentsMetadataSetRes;
+
+TorrentsMetadataSet::TorrentsMetadataSet(ISession& session, MetadataStore& metadata)
+    : m_session(session)
+    , m_metadata(metadata)
+{
+}
+
+void TorrentsMetadataSet::Invoke(const TorrentsMetadataSetReq& req, WriteCb<TorrentsMetadataSetRes> cb)
+{
+    if (!m_session.Torrents().contains(req.info_hash))
+    {
+        return cb.Error(-1, "Torrent not found");
+    }
+
+    m_metadata.Set(req.info_hash, req.metadata);
+
+    cb.Ok(TorrentsMetadataSetRes{});
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsmetadataset_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+    class MetadataStore;
+}
+
+namespace porla::Methods
+{
+    // Sets some metadata keys for a torrent, leaving its other keys as they are.
+    class TorrentsMetadataSet : public Method<TorrentsMetadataSetReq, TorrentsMetadataSetRes>
+    {
+    public:
+        explicit TorrentsMetadataSet(ISession& session, MetadataStore& metadata);
+
+    protected:
+        void Invoke(const TorrentsMetadataSetReq& req, WriteCb<TorrentsMetadataSetRes> cb) override;
+
+    private:
+        ISession& m_session;
+        MetadataStore& m_metadata;
+    };
+}
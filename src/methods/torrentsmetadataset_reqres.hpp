@@ -0,0 +1,19 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <libtorrent/info_hash.hpp>
+#include <nlohmann/json.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsMetadataSetReq
+    {
+        libtorrent::info_hash_t               info_hash;
+        // Keys set to null are removed.
+        std::map<std::string, nlohmann::json> metadata;
+    };
+
+    struct TorrentsMetadataSetRes {};
+}
@@ -1,26 +1,22 @@
 #include "torrentsmove.hpp"
 
+#include "../movequeue.hpp"
 #include "../session.hpp"
+#include "torrentselector.hpp"
 
 using porla::Methods::TorrentsMove;
 using porla::Methods::TorrentsMoveReq;
 using porla::Methods::TorrentsMoveRes;
+using porla::Methods::TorrentSelector;
 
-TorrentsMove::TorrentsMove(porla::ISession &session)
+TorrentsMove::TorrentsMove(porla::ISession &session, porla::MoveQueue& queue)
     : m_session(session)
+    , m_queue(queue)
 {
 }
 
 void TorrentsMove::Invoke(const TorrentsMoveReq &req, WriteCb<TorrentsMoveRes> cb)
 {
-    auto const& torrents = m_session.Torrents();
-    auto const& handle = torrents.find(req.info_hash);
-
-    if (handle == torrents.end())
-    {
-        return cb.Error(-1, "Torrent not found");
-    }
-
     lt::move_flags_t flags = lt::move_flags_t::dont_replace;
 
     if (req.flags.has_value())
@@ -30,7 +26,22 @@ void TorrentsMove::Invoke(const TorrentsMoveReq &req, WriteCb<TorrentsMoveRes> c
         if (req.flags.value() == "fail_if_exist")        flags = lt::move_flags_t::fail_if_exist;
     }
 
-    handle->second.move_storage(req.path, flags);
+    const auto move = [&](auto const& hash, auto const&) { m_queue.Enqueue(hash, req.path, flags, req.priority.value_or(0)); };
+
+    if (TorrentSelector::HandleBulk(m_session, req, cb, move))
+    {
+        return;
+    }
+
+    auto const& torrents = m_session.Torrents();
+    auto const& handle = torrents.find(*req.info_hash);
+
+    if (handle == torrents.end())
+    {
+        return cb.Error(-1, "Torrent not found");
+    }
+
+    move(handle->first, handle->second);
 
     return cb.Ok(TorrentsMoveRes{});
 }
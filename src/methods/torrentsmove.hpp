@@ -6,19 +6,23 @@
 namespace porla
 {
     class ISession;
+    class MoveQueue;
 }
 
 namespace porla::Methods
 {
+    // Queues the moves, which start once the devices involved have room. Responds when
+    // they are queued, and torrents.move.list tells how far along they are.
     class TorrentsMove : public Method<TorrentsMoveReq, TorrentsMoveRes>
     {
     public:
-        explicit TorrentsMove(ISession& session);
+        explicit TorrentsMove(ISession& session, MoveQueue& queue);
 
     protected:
         void Invoke(const TorrentsMoveReq& req, WriteCb<TorrentsMoveRes> cb) override;
 
     private:
         ISession& m_session;
+        MoveQueue& m_queue;
     };
 }
@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <libtorrent/info_hash.hpp>
 
@@ -10,7 +11,11 @@ namespace porla::Methods
     struct TorrentsMoveReq
     {
         std::optional<std::string> flags;
-        libtorrent::info_hash_t info_hash;
+        std::optional<libtorrent::info_hash_t> info_hash;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        // Higher moves start first. Defaults to 0.
+        std::optional<int> priority;
+        std::optional<std::string> query;
         std::string path;
     };
 
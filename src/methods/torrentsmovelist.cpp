@@ -0,0 +1,17 @@
+#include "torrentsmovelist.hpp"
+
+using porla::Methods::TorrentsMoveList;
+using porla::Methods::TorrentsMoveListReq;
+using porla::Methods::TorrentsMoveListRes;
+
+TorrentsMoveList::TorrentsMoveList(porla::MoveQueue& queue)
+    : m_queue(queue)
+{
+}
+
+void TorrentsMoveList::Invoke(const TorrentsMoveListReq& req, WriteCb<TorrentsMoveListRes> cb)
+{
+    cb.Ok(TorrentsMoveListRes{
+        .moves = m_queue.List()
+    });
+}
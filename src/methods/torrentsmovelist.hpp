@@ -0,0 +1,21 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsmovelist_reqres.hpp"
+
+namespace porla::Methods
+{
+    // The moves running and waiting in the move queue, with where each queued move is in
+    // line.
+    class TorrentsMoveList : public Method<TorrentsMoveListReq, TorrentsMoveListRes>
+    {
+    public:
+        explicit TorrentsMoveList(MoveQueue& queue);
+
+    protected:
+        void Invoke(const TorrentsMoveListReq& req, WriteCb<TorrentsMoveListRes> cb) override;
+
+    private:
+        MoveQueue& m_queue;
+    };
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "../movequeue.hpp"
+
+namespace porla::Methods
+{
+    struct TorrentsMoveListReq
+    {
+    };
+
+    struct TorrentsMoveListRes
+    {
+        std::vector<MoveQueue::Move> moves;
+    };
+}
@@ -1,10 +1,12 @@
 #include "torrentspause.hpp"
 
 #include "../session.hpp"
+#include "torrentselector.hpp"
 
 using porla::Methods::TorrentsPause;
 using porla::Methods::TorrentsPauseReq;
 using porla::Methods::TorrentsPauseRes;
+using porla::Methods::TorrentSelector;
 
 TorrentsPause::TorrentsPause(porla::ISession &session)
     : m_session(session)
@@ -13,8 +15,13 @@ TorrentsPause::TorrentsPause(porla::ISession &session)
 
 void TorrentsPause::Invoke(const TorrentsPauseReq& req, WriteCb<TorrentsPauseRes> cb)
 {
+    if (TorrentSelector::HandleBulk(m_session, req, cb, [](auto const&, auto const& th) { th.pause(); }))
+    {
+        return;
+    }
+
     auto const& torrents = m_session.Torrents();
-    auto handle = torrents.find(req.info_hash);
+    auto handle = torrents.find(*req.info_hash);
 
     if (handle == torrents.end())
     {
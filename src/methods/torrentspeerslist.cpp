@@ -1,9 +1,53 @@
 #include "torrentspeerslist.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <set>
+
 #include "../session.hpp"
 
 using porla::Methods::TorrentsPeersList;
 
+namespace
+{
+    typedef std::vector<const porla::PeerInfoField*> Fields;
+
+    // A peer with the fields asked for, written straight from the peer_info the session
+    // shares when the response is streamed.
+    struct PeerItem
+    {
+        const lt::peer_info* peer;
+        const Fields*        fields;
+    };
+
+    void write_json(std::string& out, const PeerItem& item)
+    {
+        out.push_back('{');
+
+        for (std::size_t i = 0; i < item.fields->size(); i++)
+        {
+            if (i > 0) out.push_back(',');
+
+            const auto& field = *(*item.fields)[i];
+            out.append(field.key);
+            field.write(out, *item.peer);
+        }
+
+        out.push_back('}');
+    }
+
+    // For the encodings which are not streamed.
+    void to_json(json& j, const PeerItem& item)
+    {
+        j = json::object();
+
+        for (const auto* field : *item.fields)
+        {
+            j[field->name] = field->to_json(*item.peer);
+        }
+    }
+}
+
 TorrentsPeersList::TorrentsPeersList(porla::ISession& session)
     : m_session(session)
 {
@@ -11,18 +55,125 @@ TorrentsPeersList::TorrentsPeersList(porla::ISession& session)
 
 void TorrentsPeersList::Invoke(const TorrentsPeersListReq& req, WriteCb<TorrentsPeersListRes> cb)
 {
-    auto const& torrents = m_session.Torrents();
-    auto const& status = torrents.find(req.info_hash);
+    typedef std::function<bool(const lt::peer_info&, const lt::peer_info&)> Sorter;
 
-    if (status == torrents.end())
+    static const std::map<std::string, Sorter> sorters =
     {
-        return cb.Error(-1, "Torrent not found");
+        {"client",         [](auto const& lhs, auto const& rhs) { return lhs.client < rhs.client; }},
+        {"down_speed",     [](auto const& lhs, auto const& rhs) { return lhs.down_speed < rhs.down_speed; }},
+        {"ip",             [](auto const& lhs, auto const& rhs) { return lhs.ip < rhs.ip; }},
+        {"last_active",    [](auto const& lhs, auto const& rhs) { return lhs.last_active < rhs.last_active; }},
+        {"progress",       [](auto const& lhs, auto const& rhs) { return lhs.progress < rhs.progress; }},
+        {"rtt",            [](auto const& lhs, auto const& rhs) { return lhs.rtt < rhs.rtt; }},
+        {"total_download", [](auto const& lhs, auto const& rhs) { return lhs.total_download < rhs.total_download; }},
+        {"total_upload",   [](auto const& lhs, auto const& rhs) { return lhs.total_upload < rhs.total_upload; }},
+        {"up_speed",       [](auto const& lhs, auto const& rhs) { return lhs.up_speed < rhs.up_speed; }},
+    };
+
+    const std::string order_by = req.order_by.value_or("ip");
+    const std::string order_by_dir = req.order_by_dir.value_or("asc");
+
+    auto const& sorter = sorters.find(order_by);
+
+    if (sorter == sorters.end())
+    {
+        return cb.Error(-1, "Invalid field in 'order_by'");
     }
 
-    std::vector<lt::peer_info> peers;
-    status->second.get_peer_info(peers);
+    auto const& all_fields = porla::PeerInfoFields();
+
+    auto fields = std::make_shared<Fields>();
+
+    if (req.fields.has_value())
+    {
+        // Ordered by name, as the members of any other object are.
+        for (const auto& name : std::set<std::string>(req.fields->begin(), req.fields->end()))
+        {
+            auto const& field = all_fields.find(name);
+
+            if (field == all_fields.end())
+            {
+                return cb.Error(-3, "Invalid field in 'fields': " + name);
+            }
+
+            fields->push_back(&field->second);
+        }
+    }
+    else
+    {
+        for (const auto& [_, field] : all_fields) fields->push_back(&field);
+    }
+
+    if (req.page_size.has_value() && req.page_size.value() <= 0)
+    {
+        return cb.Error(-1, "Invalid 'page_size'");
+    }
+
+    m_session.PeerInfo(
+        req.info_hash,
+        [req, cb, order_by, order_by_dir, fields = std::move(fields), &sort = sorter->second](ISession::PeerInfoList peers) mutable
+        {
+            if (peers == nullptr)
+            {
+                return cb.Error(-1, "Torrent not found");
+            }
+
+            // The peers are shared with other requests, so only pointers to them are sorted.
+            std::vector<const lt::peer_info*> ordered;
+            ordered.reserve(peers->size());
+
+            for (const auto& peer : *peers)
+            {
+                ordered.push_back(&peer);
+            }
+
+            const bool asc = order_by_dir == "asc";
+
+            std::stable_sort(
+                ordered.begin(),
+                ordered.end(),
+                [&sort, asc](const lt::peer_info* lhs, const lt::peer_info* rhs)
+                {
+                    if (sort(*lhs, *rhs)) return asc;
+                    if (sort(*rhs, *lhs)) return !asc;
+                    return lhs->ip < rhs->ip;
+                });
+
+            const int page = std::max(0, req.page.value_or(0));
+
+            std::size_t beg = 0;
+            std::size_t end = ordered.size();
+
+            if (req.page_size.has_value())
+            {
+                beg = std::min(ordered.size(), static_cast<std::size_t>(page) * req.page_size.value());
+                end = std::min(ordered.size(), beg + req.page_size.value());
+            }
+
+            std::vector<PeerItem> items;
+            items.reserve(end - beg);
+
+            for (std::size_t i = beg; i < end; i++)
+            {
+                items.push_back({ ordered[i], fields.get() });
+            }
+
+            TorrentsPeersListRes res{
+                .order_by     = order_by,
+                .order_by_dir = order_by_dir,
+                .page         = page,
+                .page_size    = req.page_size,
+                .peers_total  = static_cast<int>(ordered.size())
+            };
+
+            json result = res;
+            result.erase("peers");
 
-    cb.Ok(TorrentsPeersListRes{
-        .peers = peers
-    });
+            // The items point into the peers and the field list until they are written.
+            cb.OkStreamed(
+                std::move(result),
+                "peers",
+                std::move(items),
+                std::make_shared<std::pair<ISession::PeerInfoList, std::shared_ptr<Fields>>>(std::move(peers), fields));
+        });
 }
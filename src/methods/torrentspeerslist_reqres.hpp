@@ -1,19 +1,32 @@
 #pragma once
 
+#include <optional>
+#include <string>
 #include <vector>
 
 #include <libtorrent/info_hash.hpp>
-#include <libtorrent/peer_info.hpp>
+#include <nlohmann/json.hpp>
 
 namespace porla::Methods
 {
     struct TorrentsPeersListReq
     {
+        std::optional<std::vector<std::string>> fields;
         libtorrent::info_hash_t info_hash;
+        std::optional<std::string> order_by;
+        std::optional<std::string> order_by_dir;
+        std::optional<int> page;
+        std::optional<int> page_size;
     };
 
     struct TorrentsPeersListRes
     {
-        std::vector<libtorrent::peer_info> peers;
+        std::string                 order_by;
+        std::string                 order_by_dir;
+        int                         page;
+        std::optional<int>          page_size;
+        // Each peer with the fields from TorrentsPeersListReq::fields, or all of them.
+        std::vector<nlohmann::json> peers;
+        int                         peers_total;
     };
 }
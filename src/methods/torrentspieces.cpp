@@ -0,0 +1,170 @@
+#include "torrentspieces.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+
+#include "../session.hpp"
+#include "../torrentssnapshot.hpp"
+
+using porla::Methods::TorrentsPieces;
+using porla::Methods::TorrentsPiecesReq;
+using porla::Methods::TorrentsPiecesRes;
+
+// Bounds what a request can make us build. A million runs is a few megabytes of JSON.
+static constexpr int MaxBins = 4096;
+static constexpr int MaxRuns = 1 << 20;
+
+template<typename TTest>
+static std::optional<std::vector<int>> Runs(int num_pieces, int max_runs, TTest test)
+{
+    std::vector<int> runs;
+
+    bool value  = false;
+    int  length = 0;
+
+    for (int i = 0; i < num_pieces; i++)
+    {
+        if (test(i) != value)
+        {
+            if (static_cast<int>(runs.size()) >= max_runs)
+            {
+                return std::nullopt;
+            }
+
+            runs.push_back(length);
+            value  = !value;
+            length = 0;
+        }
+
+        length++;
+    }
+
+    runs.push_back(length);
+
+    return runs;
+}
+
+static std::optional<TorrentsPiecesRes> Pieces(const lt::torrent_handle& th, int bins, int max_runs)
+{
+    const auto ti = th.torrent_file();
+
+    if (!ti)
+    {
+        return std::nullopt;
+    }
+
+    const auto status = th.status(lt::torrent_handle::query_pieces);
+    const int num_pieces = ti->num_pieces();
+
+    std::vector<bool> downloading(num_pieces, false);
+
+    for (const auto& piece : th.get_download_queue())
+    {
+        if (const int index = static_cast<int>(piece.piece_index); index >= 0 && index < num_pieces)
+        {
+            downloading[index] = true;
+        }
+    }
+
+    std::vector<int> availability;
+    th.piece_availability(availability);
+
+    const auto have = [&status](int i)
+    {
+        return !status.pieces.empty() && status.pieces.get_bit(lt::piece_index_t(i));
+    };
+
+    const int bin_size = std::max(1, (num_pieces + bins - 1) / bins);
+    const int num_bins = (num_pieces + bin_size - 1) / bin_size;
+
+    TorrentsPiecesRes res{
+        .bin_size         = bin_size,
+        .downloading      = Runs(num_pieces, max_runs, [&downloading](int i) { return downloading[i]; }),
+        .downloading_bins = std::vector<int>(num_bins, 0),
+        .have             = Runs(num_pieces, max_runs, have),
+        .have_bins        = std::vector<int>(num_bins, 0),
+        .num_pieces       = num_pieces,
+        .piece_length     = ti->piece_length()
+    };
+
+    const bool has_availability = static_cast<int>(availability.size()) == num_pieces;
+    if (has_availability) res.availability.resize(num_bins, 0);
+
+    for (int i = 0; i < num_pieces; i++)
+    {
+        const int bin = i / bin_size;
+
+        if (have(i))          res.have_bins[bin]++;
+        if (downloading[i])   res.downloading_bins[bin]++;
+        if (has_availability) res.availability[bin] += static_cast<float>(availability[i]);
+    }
+
+    for (int bin = 0; bin < static_cast<int>(res.availability.size()); bin++)
+    {
+        res.availability[bin] /= static_cast<float>(std::min(bin_size, num_pieces - bin * bin_size));
+    }
+
+    return res;
+}
+
+TorrentsPieces::TorrentsPieces(porla::ISession& session, porla::WorkerPool* pool, porla::TorrentsSnapshot* snapshot)
+    : Method(pool, pool != nullptr && snapshot != nullptr)
+    , m_session(session)
+    , m_pool(pool)
+    , m_snapshot(pool != nullptr ? snapshot : nullptr)
+{
+}
+
+void TorrentsPieces::Invoke(const TorrentsPiecesReq& req, WriteCb<TorrentsPiecesRes> cb)
+{
+    // Invoked on the pool with a snapshot, where Torrents() must not be touched.
+    const auto snapshot = m_snapshot != nullptr ? m_snapshot->Current() : nullptr;
+
+    auto const& torrents = snapshot != nullptr ? snapshot->torrents : m_session.Torrents();
+    auto const& torrent = torrents.find(req.info_hash);
+
+    if (torrent == torrents.end())
+    {
+        return cb.Error(-1, "Torrent not found");
+    }
+
+    const int bins     = std::clamp(req.bins.value_or(256), 1, MaxBins);
+    const int max_runs = std::clamp(req.max_runs.value_or(65536), 0, MaxRuns);
+
+    auto work = [handle = torrent->second, bins, max_runs, cb, pool = m_pool]() mutable
+    {
+        std::optional<TorrentsPiecesRes> res;
+        std::string error = "Torrent has no metadata";
+
+        try
+        {
+            res = Pieces(handle, bins, max_runs);
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to read pieces: " << ex.what();
+            error = "Torrent not found";
+        }
+
+        auto respond = [cb, res = std::move(res), error]() mutable
+        {
+            if (!res.has_value()) return cb.Error(-2, error);
+            cb(res.value());
+        };
+
+        // The response is always written from the io thread.
+        if (pool != nullptr) return pool->Complete(std::move(respond));
+        respond();
+    };
+
+    if (m_pool == nullptr || snapshot != nullptr)
+    {
+        return work();
+    }
+
+    if (!m_pool->Post(std::move(work)))
+    {
+        cb.Error(-32000, "Server busy - too many queued requests");
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentspieces_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+    class TorrentsSnapshot;
+}
+
+namespace porla::Methods
+{
+    // Have, downloading and availability of the pieces of a torrent, compressed to runs and
+    // bins. Asking libtorrent for them blocks, so it is done on the worker pool when there
+    // is one. With a snapshot of the torrents as well, the whole call runs on the pool.
+    class TorrentsPieces : public Method<TorrentsPiecesReq, TorrentsPiecesRes>
+    {
+    public:
+        explicit TorrentsPieces(ISession& session, WorkerPool* pool = nullptr, TorrentsSnapshot* snapshot = nullptr);
+
+    protected:
+        void Invoke(const TorrentsPiecesReq& req, WriteCb<TorrentsPiecesRes> cb) override;
+
+    private:
+        ISession& m_session;
+        WorkerPool* m_pool;
+        TorrentsSnapshot* m_snapshot;
+    };
+}
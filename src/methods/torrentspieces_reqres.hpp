@@ -0,0 +1,34 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsPiecesReq
+    {
+        std::optional<int> bins;
+        libtorrent::info_hash_t info_hash;
+        std::optional<int> max_runs;
+    };
+
+    // Piece states as runs and as bins of bin_size pieces each, the last one being smaller
+    // when the pieces do not divide evenly. Runs are the lengths of alternating stretches of
+    // pieces out of and in the state, starting with pieces out of it, so [0, n] is every
+    // piece. They are left out when there are more of them than asked for.
+    struct TorrentsPiecesRes
+    {
+        // The mean number of peers having the pieces of each bin. Empty for seeds, which
+        // libtorrent does not count availability for.
+        std::vector<float>              availability;
+        int                             bin_size;
+        std::optional<std::vector<int>> downloading;
+        std::vector<int>                downloading_bins;
+        std::optional<std::vector<int>> have;
+        std::vector<int>                have_bins;
+        int                             num_pieces;
+        int                             piece_length;
+    };
+}
@@ -1,10 +1,12 @@
 #include "torrentspropertiesset.hpp"
 
 #include "../session.hpp"
+#include "torrentselector.hpp"
 
 using porla::Methods::TorrentsPropertiesSet;
 using porla::Methods::TorrentsPropertiesSetReq;
 using porla::Methods::TorrentsPropertiesSetRes;
+using porla::Methods::TorrentSelector;
 
 TorrentsPropertiesSet::TorrentsPropertiesSet(porla::ISession& session)
     : m_session(session)
@@ -13,33 +15,41 @@ TorrentsPropertiesSet::TorrentsPropertiesSet(porla::ISession& session)
 
 void TorrentsPropertiesSet::Invoke(const TorrentsPropertiesSetReq& req, WriteCb<TorrentsPropertiesSetRes> cb)
 {
-    auto& torrents = m_session.Torrents();
-    auto torrent = torrents.find(req.info_hash);
-
-    if (torrent == torrents.end())
+    const auto apply = [&req](auto const&, const lt::torrent_handle& handle)
     {
-        return cb.Error(-1, "Torrent not found");
-    }
+        if (auto val = req.download_limit)
+            handle.set_download_limit(*val);
+
+        if (auto val = req.set_flags)
+            handle.set_flags(*val);
+
+        if (auto val = req.max_connections)
+            handle.set_max_connections(*val);
 
-    auto& handle = torrent->second;
+        if (auto val = req.max_uploads)
+            handle.set_max_uploads(*val);
 
-    if (auto val = req.download_limit)
-        handle.set_download_limit(*val);
+        if (auto val = req.upload_limit)
+            handle.set_upload_limit(*val);
 
-    if (auto val = req.set_flags)
-        handle.set_flags(*val);
+        if (auto val = req.unset_flags)
+            handle.unset_flags(*val);
+    };
 
-    if (auto val = req.max_connections)
-        handle.set_max_connections(*val);
+    if (TorrentSelector::HandleBulk(m_session, req, cb, apply))
+    {
+        return;
+    }
 
-    if (auto val = req.max_uploads)
-        handle.set_max_uploads(*val);
+    auto& torrents = m_session.Torrents();
+    auto torrent = torrents.find(*req.info_hash);
 
-    if (auto val = req.upload_limit)
-        handle.set_upload_limit(*val);
+    if (torrent == torrents.end())
+    {
+        return cb.Error(-1, "Torrent not found");
+    }
 
-    if (auto val = req.unset_flags)
-        handle.unset_flags(*val);
+    apply(torrent->first, torrent->second);
 
     cb.Ok({});
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <optional>
+#include <string>
+#include <vector>
 
 #include <libtorrent/info_hash.hpp>
 
@@ -8,7 +10,9 @@ namespace porla::Methods
 {
     struct TorrentsPropertiesSetReq
     {
-        libtorrent::info_hash_t info_hash;
+        std::optional<libtorrent::info_hash_t> info_hash;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        std::optional<std::string> query;
         std::optional<int> download_limit;
         std::optional<libtorrent::torrent_flags_t> set_flags;
         std::optional<libtorrent::torrent_flags_t> unset_flags;
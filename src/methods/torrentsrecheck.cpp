@@ -3,28 +3,39 @@
 #include <libtorrent/torrent_handle.hpp>
 #include <libtorrent/torrent_status.hpp>
 
+#include "../recheckqueue.hpp"
 #include "../session.hpp"
+#include "torrentselector.hpp"
 
 using porla::Methods::TorrentsRecheck;
 using porla::Methods::TorrentsRecheckReq;
 using porla::Methods::TorrentsRecheckRes;
+using porla::Methods::TorrentSelector;
 
-TorrentsRecheck::TorrentsRecheck(porla::ISession &session)
+TorrentsRecheck::TorrentsRecheck(porla::ISession &session, porla::RecheckQueue& queue)
     : m_session(session)
+    , m_queue(queue)
 {
 }
 
 void TorrentsRecheck::Invoke(const TorrentsRecheckReq &req, WriteCb<TorrentsRecheckRes> cb)
 {
+    const auto recheck = [&](auto const& hash, auto const&) { m_queue.Enqueue(hash, req.priority.value_or(0)); };
+
+    if (TorrentSelector::HandleBulk(m_session, req, cb, recheck))
+    {
+        return;
+    }
+
     auto const& torrents = m_session.Torrents();
-    auto const& handle = torrents.find(req.info_hash);
+    auto const& handle = torrents.find(*req.info_hash);
 
     if (handle == torrents.end())
     {
         return cb.Error(-1, "Torrent not found");
     }
 
-    m_session.Recheck(req.info_hash);
+    recheck(handle->first, handle->second);
 
     return cb.Ok(TorrentsRecheckRes{});
 }
@@ -6,19 +6,22 @@
 namespace porla
 {
     class ISession;
+    class RecheckQueue;
 }
 
 namespace porla::Methods
 {
+    // Queues the checks, which start once the device the torrent is on has room.
     class TorrentsRecheck : public Method<TorrentsRecheckReq, TorrentsRecheckRes>
     {
     public:
-        explicit TorrentsRecheck(ISession& session);
+        explicit TorrentsRecheck(ISession& session, RecheckQueue& queue);
 
     protected:
         void Invoke(const TorrentsRecheckReq& req, WriteCb<TorrentsRecheckRes> cb) override;
 
     private:
         ISession& m_session;
+        RecheckQueue& m_queue;
     };
 }
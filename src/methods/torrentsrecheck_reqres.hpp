@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <libtorrent/info_hash.hpp>
 
@@ -9,7 +10,11 @@ namespace porla::Methods
 {
     struct TorrentsRecheckReq
     {
-        libtorrent::info_hash_t info_hash;
+        std::optional<libtorrent::info_hash_t> info_hash;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        // Higher checks start first. Defaults to 0.
+        std::optional<int> priority;
+        std::optional<std::string> query;
     };
 
     struct TorrentsRecheckRes
@@ -0,0 +1,17 @@
+#include "torrentsrechecklist.hpp"
+
+using porla::Methods::TorrentsRecheckList;
+using porla::Methods::TorrentsRecheckListReq;
+using porla::Methods::TorrentsRecheckListRes;
+
+TorrentsRecheckList::TorrentsRecheckList(porla::RecheckQueue& queue)
+    : m_queue(queue)
+{
+}
+
+void TorrentsRecheckList::Invoke(const TorrentsRecheckListReq& req, WriteCb<TorrentsRecheckListRes> cb)
+{
+    cb.Ok(TorrentsRecheckListRes{
+        .rechecks = m_queue.List()
+    });
+}
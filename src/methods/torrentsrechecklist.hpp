@@ -0,0 +1,21 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsrechecklist_reqres.hpp"
+
+namespace porla::Methods
+{
+    // The checks running and waiting in the recheck queue, with how far along the running
+    // ones are and where the queued ones are in line.
+    class TorrentsRecheckList : public Method<TorrentsRecheckListReq, TorrentsRecheckListRes>
+    {
+    public:
+        explicit TorrentsRecheckList(RecheckQueue& queue);
+
+    protected:
+        void Invoke(const TorrentsRecheckListReq& req, WriteCb<TorrentsRecheckListRes> cb) override;
+
+    private:
+        RecheckQueue& m_queue;
+    };
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "../recheckqueue.hpp"
+
+namespace porla::Methods
+{
+    struct TorrentsRecheckListReq
+    {
+    };
+
+    struct TorrentsRecheckListRes
+    {
+        std::vector<RecheckQueue::Recheck> rechecks;
+    };
+}
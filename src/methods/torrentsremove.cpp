@@ -1,10 +1,12 @@
 #include "torrentsremove.hpp"
 
 #include "../session.hpp"
+#include "torrentselector.hpp"
 
 using porla::Methods::TorrentsRemove;
 using porla::Methods::TorrentsRemoveReq;
 using porla::Methods::TorrentsRemoveRes;
+using porla::Methods::TorrentSelector;
 
 TorrentsRemove::TorrentsRemove(porla::ISession &session)
     : m_session(session)
@@ -13,10 +15,22 @@ TorrentsRemove::TorrentsRemove(porla::ISession &session)
 
 void TorrentsRemove::Invoke(const TorrentsRemoveReq &req, WriteCb<TorrentsRemoveRes> cb)
 {
-    for (auto const& hash : req.info_hashes)
+    if (!req.info_hashes.has_value() && !req.query.has_value())
     {
-        m_session.Remove(hash, req.remove_data);
+        return cb.Error(-2, "One of 'info_hashes' or 'query' must be set");
     }
 
-    cb(TorrentsRemoveRes{});
+    try
+    {
+        const auto selection = TorrentSelector::Select(m_session, std::nullopt, req.info_hashes, req.query);
+
+        cb.Ok(TorrentSelector::Apply(
+            m_session,
+            selection,
+            [&](auto const& hash, auto const&) { m_session.Remove(hash, req.remove_data); }));
+    }
+    catch (const porla::Query::QueryError& qe)
+    {
+        cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
+    }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+#include <string>
 #include <vector>
 
 #include <libtorrent/info_hash.hpp>
@@ -8,7 +10,8 @@ namespace porla::Methods
 {
     struct TorrentsRemoveReq
     {
-        std::vector<libtorrent::info_hash_t> info_hashes;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        std::optional<std::string> query;
         bool remove_data;
     };
 }
@@ -1,10 +1,12 @@
 #include "torrentsresume.hpp"
 
 #include "../session.hpp"
+#include "torrentselector.hpp"
 
 using porla::Methods::TorrentsResume;
 using porla::Methods::TorrentsResumeReq;
 using porla::Methods::TorrentsResumeRes;
+using porla::Methods::TorrentSelector;
 
 TorrentsResume::TorrentsResume(porla::ISession& session)
     : m_session(session)
@@ -13,11 +15,37 @@ TorrentsResume::TorrentsResume(porla::ISession& session)
 
 void TorrentsResume::Invoke(const TorrentsResumeReq& req, WriteCb<TorrentsResumeRes> cb)
 {
+    // Parked torrents are added back first, already resumed, and counted with the rest.
+    if (TorrentSelector::IsBulk(req))
+    {
+        try
+        {
+            for (const auto& hash : TorrentSelector::Select(m_session, req).hashes)
+            {
+                if (m_session.Parked(hash)) m_session.Unpark(hash, true);
+            }
+        }
+        catch (const porla::Query::QueryError&)
+        {
+            // Answered by HandleBulk below.
+        }
+    }
+
+    if (TorrentSelector::HandleBulk(m_session, req, cb, [](auto const&, auto const& th) { th.resume(); }))
+    {
+        return;
+    }
+
     auto const& torrents = m_session.Torrents();
-    auto status = torrents.find(req.info_hash);
+    auto status = torrents.find(*req.info_hash);
 
     if (status == torrents.end())
     {
+        if (m_session.Unpark(*req.info_hash, true))
+        {
+            return cb.Ok(TorrentsResumeRes{});
+        }
+
         return cb.Error(-1, "Torrent not found");
     }
 
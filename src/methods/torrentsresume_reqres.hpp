@@ -1,12 +1,18 @@
 #pragma once
 
+#include <optional>
+#include <string>
+#include <vector>
+
 #include <libtorrent/info_hash.hpp>
 
 namespace porla::Methods
 {
     struct TorrentsResumeReq
     {
-        libtorrent::info_hash_t info_hash;
+        std::optional<libtorrent::info_hash_t> info_hash;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        std::optional<std::string> query;
     };
 
     struct TorrentsResumeRes {};
@@ -0,0 +1,119 @@
+#include "torrentsstats.hpp"
+
+#include <cstdio>
+
+#include "../query/pql.hpp"
+#include "../torrentstats.hpp"
+
+using porla::Methods::TorrentsStats;
+using porla::Methods::TorrentsStatsReq;
+using porla::Methods::TorrentsStatsRes;
+using porla::TorrentStats;
+
+TorrentsStats::TorrentsStats(const porla::TorrentStats& stats)
+    : m_stats(stats)
+{
+}
+
+static TorrentsStatsRes::Group ToGroup(const TorrentStats::Group& group, const std::vector<double>& percentiles)
+{
+    TorrentsStatsRes::Group result{ .count = group.count };
+
+    for (int m = 0; m < TorrentStats::MetricCount; m++)
+    {
+        const auto  metric = static_cast<TorrentStats::Metric>(m);
+        const auto& values = group.metrics[m];
+        const double scale = metric == TorrentStats::Ratio ? 1 / TorrentStats::RatioScale : 1;
+
+        TorrentsStatsRes::Metric entry{
+            .max = static_cast<double>(values.Max()) * scale,
+            .min = static_cast<double>(values.Min()) * scale,
+            .sum = static_cast<double>(values.Sum()) * scale
+        };
+
+        for (const auto q : percentiles)
+        {
+            char key[32];
+            std::snprintf(key, sizeof(key), "%g", q);
+            entry.percentiles.insert({ key, values.Quantile(q) * scale });
+        }
+
+        result.metrics.insert({ TorrentStats::Name(metric), std::move(entry) });
+    }
+
+    return result;
+}
+
+void TorrentsStats::Invoke(const TorrentsStatsReq& req, WriteCb<TorrentsStatsRes> cb)
+{
+    std::vector<TorrentStats::Dimension> dimensions;
+
+    if (req.group_by.has_value())
+    {
+        for (const auto& name : *req.group_by)
+        {
+            bool found = false;
+
+            for (int d = 0; d < TorrentStats::DimensionCount; d++)
+            {
+                if (name == TorrentStats::Name(static_cast<TorrentStats::Dimension>(d)))
+                {
+                    dimensions.push_back(static_cast<TorrentStats::Dimension>(d));
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                return cb.Error(-1, "Invalid field in 'group_by': " + name);
+            }
+        }
+    }
+    else
+    {
+        for (int d = 0; d < TorrentStats::DimensionCount; d++)
+        {
+            dimensions.push_back(static_cast<TorrentStats::Dimension>(d));
+        }
+    }
+
+    const auto percentiles = req.percentiles.value_or(std::vector<double>{ 0.5, 0.9, 0.99 });
+
+    for (const auto q : percentiles)
+    {
+        if (q < 0 || q > 1)
+        {
+            return cb.Error(-2, "Percentiles must be between 0 and 1");
+        }
+    }
+
+    std::optional<TorrentStats::Groups> scanned;
+
+    if (req.query.has_value() && !req.query->empty())
+    {
+        try
+        {
+            scanned = m_stats.Scan(*Query::PQL::ParseCached(*req.query));
+        }
+        catch (const Query::QueryError& qe)
+        {
+            return cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
+        }
+    }
+
+    const auto& groups = scanned.has_value() ? *scanned : m_stats.Current();
+
+    TorrentsStatsRes res{ .total = ToGroup(groups.total, percentiles) };
+
+    for (const auto dimension : dimensions)
+    {
+        auto& result = res.groups[TorrentStats::Name(dimension)];
+
+        for (const auto& [label, group] : groups.dimensions[dimension])
+        {
+            result.insert({ label, ToGroup(group, percentiles) });
+        }
+    }
+
+    cb.Ok(res);
+}
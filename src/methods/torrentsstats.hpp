@@ -0,0 +1,24 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentsstats_reqres.hpp"
+
+namespace porla
+{
+    class TorrentStats;
+}
+
+namespace porla::Methods
+{
+    class TorrentsStats : public Method<TorrentsStatsReq, TorrentsStatsRes>
+    {
+    public:
+        explicit TorrentsStats(const TorrentStats& stats);
+
+    protected:
+        void Invoke(const TorrentsStatsReq& req, WriteCb<TorrentsStatsRes> cb) override;
+
+    private:
+        const TorrentStats& m_stats;
+    };
+}
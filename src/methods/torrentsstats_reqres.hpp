@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace porla::Methods
+{
+    struct TorrentsStatsReq
+    {
+        // Any of category, save_path, state and tag. Defaults to all of them.
+        std::optional<std::vector<std::string>> group_by;
+        // Fractions between 0 and 1. Defaults to 0.5, 0.9 and 0.99.
+        std::optional<std::vector<double>>      percentiles;
+        // Only counts the torrents matching this PQL query, which needs every torrent checked.
+        std::optional<std::string>              query;
+    };
+
+    struct TorrentsStatsRes
+    {
+        struct Metric
+        {
+            double                        max;
+            double                        min;
+            std::map<std::string, double> percentiles;
+            double                        sum;
+        };
+
+        struct Group
+        {
+            std::int64_t                  count;
+            std::map<std::string, Metric> metrics;
+        };
+
+        std::map<std::string, std::map<std::string, Group>> groups;
+        Group                                               total;
+    };
+}
@@ -0,0 +1,82 @@
+#include "torrentstagsupdate.hpp"
+
+#include <algorithm>
+
+#include "../session.hpp"
+#include "../torrentclientdata.hpp"
+#include "torrentselector.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Methods::TorrentsTagsUpdate;
+using porla::Methods::TorrentsTagsUpdateReq;
+using porla::Methods::TorrentsTagsUpdateRes;
+using porla::Methods::TorrentSelection;
+using porla::Methods::TorrentSelector;
+
+TorrentsTagsUpdate::TorrentsTagsUpdate(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void TorrentsTagsUpdate::Invoke(const TorrentsTagsUpdateReq& req, WriteCb<TorrentsTagsUpdateRes> cb)
+{
+    if (!req.info_hash.has_value() && !TorrentSelector::IsBulk(req))
+    {
+        return cb.Error(-2, "One of 'info_hash', 'info_hashes' or 'query' must be set");
+    }
+
+    TorrentSelection selection;
+
+    try
+    {
+        selection = TorrentSelector::Select(m_session, req);
+    }
+    catch (const Query::QueryError& qe)
+    {
+        return cb.Error(-1000, qe.what(), {{"pos", qe.pos()}});
+    }
+
+    // Interned once for the whole call. Tags to remove are only looked up, since a tag no
+    // torrent has cannot be removed from any of them.
+    std::vector<Symbol> add;
+    std::vector<Symbol> remove;
+
+    for (const auto& tag : req.add.value_or(std::vector<std::string>()))
+    {
+        if (!tag.empty()) { add.push_back(Symbol::Intern(tag)); }
+    }
+
+    for (const auto& tag : req.remove.value_or(std::vector<std::string>()))
+    {
+        if (const auto symbol = Symbol::Find(tag); symbol.has_value()) { remove.push_back(*symbol); }
+    }
+
+    const auto changed = m_session.EditClientData(
+        selection.hashes,
+        [&add, &remove](TorrentClientData& client_data)
+        {
+            SymbolSet tags;
+
+            for (const auto& tag : client_data.tags.value_or(SymbolSet()))
+            {
+                if (std::find(remove.begin(), remove.end(), tag) == remove.end()) { tags.insert(tag); }
+            }
+
+            for (const auto& tag : add) { tags.insert(tag); }
+
+            if (tags == client_data.tags.value_or(SymbolSet()))
+            {
+                return false;
+            }
+
+            client_data.tags = tags.empty() ? std::nullopt : std::make_optional(tags);
+            return true;
+        });
+
+    cb(TorrentsTagsUpdateRes{
+        .matched = static_cast<int>(selection.hashes.size()),
+        .changed = static_cast<int>(changed.size()),
+        .failed  = selection.missing
+    });
+}
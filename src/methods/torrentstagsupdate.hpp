@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentstagsupdate_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+}
+
+namespace porla::Methods
+{
+    // Adds and removes tags on every selected torrent, and writes only the client data of
+    // the ones that changed, in one transaction.
+    class TorrentsTagsUpdate : public Method<TorrentsTagsUpdateReq, TorrentsTagsUpdateRes>
+    {
+    public:
+        explicit TorrentsTagsUpdate(ISession& session);
+
+    protected:
+        void Invoke(const TorrentsTagsUpdateReq& req, WriteCb<TorrentsTagsUpdateRes> cb) override;
+
+    private:
+        ISession& m_session;
+    };
+}
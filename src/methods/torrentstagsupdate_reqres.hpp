@@ -0,0 +1,29 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsTagsUpdateReq
+    {
+        std::optional<libtorrent::info_hash_t> info_hash;
+        std::optional<std::vector<libtorrent::info_hash_t>> info_hashes;
+        std::optional<std::string> query;
+        // Removed before the ones to add are added, so a tag in both is kept.
+        std::optional<std::vector<std::string>> add;
+        std::optional<std::vector<std::string>> remove;
+    };
+
+    struct TorrentsTagsUpdateRes
+    {
+        int matched;
+        // The torrents whose tags are different now, which is less than matched when some
+        // already had the tags added and none of the ones removed.
+        int changed;
+        std::vector<libtorrent::info_hash_t> failed;
+    };
+}
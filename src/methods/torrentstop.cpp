@@ -0,0 +1,53 @@
+#include "torrentstop.hpp"
+
+#include <algorithm>
+
+#include "../session.hpp"
+#include "../torrentcosts.hpp"
+
+using porla::Methods::TorrentsTop;
+using porla::Methods::TorrentsTopReq;
+using porla::Methods::TorrentsTopRes;
+
+TorrentsTop::TorrentsTop(porla::ISession& session, const porla::TorrentCosts* costs)
+    : m_session(session)
+    , m_costs(costs)
+{
+}
+
+void TorrentsTop::Invoke(const TorrentsTopReq& req, WriteCb<TorrentsTopRes> cb)
+{
+    if (m_costs == nullptr)
+    {
+        return cb.Error(-1, "Torrent costs are not enabled");
+    }
+
+    const auto resource = TorrentCosts::FromName(req.resource);
+
+    if (!resource.has_value())
+    {
+        return cb.Error(-2, "Unknown resource '" + req.resource + "'");
+    }
+
+    const auto limit = static_cast<std::size_t>(std::clamp(req.limit.value_or(10), 1, static_cast<int>(m_costs->Capacity())));
+    const auto& statuses = m_session.TorrentStatuses();
+
+    TorrentsTopRes res{
+        .resource = req.resource,
+        .window   = m_costs->Window().count()
+    };
+
+    for (const auto& cost : m_costs->Top(*resource, limit))
+    {
+        const auto status = statuses.find(cost.info_hash);
+
+        res.torrents.push_back({
+            .info_hash = cost.info_hash,
+            .name      = status == statuses.end() ? std::string() : status->second.name,
+            .value     = cost.value,
+            .error     = cost.error
+        });
+    }
+
+    cb.Ok(res);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "method.hpp"
+#include "torrentstop_reqres.hpp"
+
+namespace porla
+{
+    class ISession;
+    class TorrentCosts;
+}
+
+namespace porla::Methods
+{
+    // Ranks the torrents by what they cost the node of a resource, over the recent window.
+    class TorrentsTop : public Method<TorrentsTopReq, TorrentsTopRes>
+    {
+    public:
+        explicit TorrentsTop(ISession& session, const TorrentCosts* costs);
+
+    protected:
+        void Invoke(const TorrentsTopReq& req, WriteCb<TorrentsTopRes> cb) override;
+
+    private:
+        ISession& m_session;
+        const TorrentCosts* m_costs;
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+namespace porla::Methods
+{
+    struct TorrentsTopReq
+    {
+        // One of peers, disk_read, checking, uploaded or downloaded.
+        std::string resource;
+        // Defaults to 10.
+        std::optional<int> limit;
+    };
+
+    struct TorrentsTopRes
+    {
+        struct Item
+        {
+            libtorrent::info_hash_t info_hash;
+            // Empty for torrents which have been removed since.
+            std::string             name;
+            std::uint64_t           value;
+            std::uint64_t           error;
+        };
+
+        std::string resource;
+        // Seconds the ranking covers.
+        std::int64_t window;
+        std::vector<Item> torrents;
+    };
+}
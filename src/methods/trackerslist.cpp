@@ -0,0 +1,41 @@
+#include "trackerslist.hpp"
+
+#include "../trackerregistry.hpp"
+
+using porla::Methods::TrackersList;
+
+TrackersList::TrackersList(const porla::TrackerRegistry* registry)
+    : m_registry(registry)
+{
+}
+
+void TrackersList::Invoke(const TrackersListReq& req, WriteCb<TrackersListRes> cb)
+{
+    if (m_registry == nullptr)
+    {
+        return cb.Error(-1, "Tracker registry is not enabled");
+    }
+
+    TrackersListRes res;
+
+    for (const auto& [host, stats] : m_registry->Hosts())
+    {
+        const auto answered = stats.replies + stats.failures;
+
+        res.trackers.push_back(TrackersListRes::Item{
+            .announces    = stats.announces,
+            .errors       = stats.errors,
+            .failures     = stats.failures,
+            .host         = host,
+            .last_error   = stats.last_error,
+            .last_failure = stats.last_failure,
+            .last_reply   = stats.last_reply,
+            .latency_p50  = stats.latency.Quantile(0.5),
+            .latency_p95  = stats.latency.Quantile(0.95),
+            .replies      = stats.replies,
+            .success_rate = answered > 0 ? static_cast<double>(stats.replies) / static_cast<double>(answered) : 1.0
+        });
+    }
+
+    cb.Ok(res);
+}
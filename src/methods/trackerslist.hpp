@@ -0,0 +1,26 @@
+#pragma once
+
+#include "method.hpp"
+#include "trackerslist_reqres.hpp"
+
+namespace porla
+{
+    class TrackerRegistry;
+}
+
+namespace porla::Methods
+{
+    // Announce outcomes per tracker host across all torrents.
+    class TrackersList : public Method<TrackersListReq, TrackersListRes>
+    {
+    public:
+        // The registry is null when it is not enabled.
+        explicit TrackersList(const TrackerRegistry* registry);
+
+    protected:
+        void Invoke(const TrackersListReq& req, WriteCb<TrackersListRes> cb) override;
+
+    private:
+        const TrackerRegistry* m_registry;
+    };
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace porla::Methods
+{
+    struct TrackersListReq {};
+
+    struct TrackersListRes
+    {
+        struct Item
+        {
+            std::uint64_t                        announces;
+            std::map<std::string, std::uint64_t> errors;
+            std::uint64_t                        failures;
+            std::string                          host;
+            std::string                          last_error;
+            std::int64_t                         last_failure;
+            std::int64_t                         last_reply;
+            // In seconds, estimated from the latency histogram.
+            double                               latency_p50;
+            double                               latency_p95;
+            std::uint64_t                        replies;
+            // Replies out of the answered announces, or 1 before any was answered.
+            double                               success_rate;
+        };
+
+        std::vector<Item> trackers;
+    };
+}
@@ -1,13 +1,126 @@
 #include "metricshandler.hpp"
 
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+
+#include <boost/log/trivial.hpp>
+
+#include "admissioncontroller.hpp"
+#include "httpeventstream.hpp"
+#include "httpserver.hpp"
+#include "jsonrpchandler.hpp"
+#include "memoryaccounting.hpp"
+#include "peeraggregates.hpp"
+#include "savepathquotas.hpp"
 #include "session.hpp"
+#include "torrentaggregates.hpp"
+#include "torrentcounters.hpp"
+#include "torrentinfocache.hpp"
+#include "trackerregistry.hpp"
+#include "utils/gzip.hpp"
+#include "utils/phases.hpp"
+#include "workerpool.hpp"
+#include "workflows/executor.hpp"
+#include "workflows/timerwheel.hpp"
+
+namespace http = boost::beast::http;
 
 using porla::MetricsHandler;
 
-MetricsHandler::MetricsHandler(porla::ISession &session)
-    : m_session(session)
+static constexpr std::string_view Counter = "counter";
+static constexpr std::string_view Gauge = "gauge";
+static constexpr std::string_view Histogram = "histogram";
+
+// OpenMetrics requires counter samples to end in _total, and names the family without it.
+// The Prometheus text format names the family after the sample, so existing names are kept.
+static std::string SampleName(MetricsHandler::Format format, const std::string& name, std::string_view type)
+{
+    if (format == MetricsHandler::Format::OpenMetrics && type == Counter && !name.ends_with("_total"))
+    {
+        return name + "_total";
+    }
+
+    return name;
+}
+
+static void WriteFamily(std::ostream& out, MetricsHandler::Format format, const std::string& name, std::string_view type, const std::string& help)
+{
+    std::string family = SampleName(format, name, type);
+
+    if (format == MetricsHandler::Format::OpenMetrics && type == Counter)
+    {
+        family = family.substr(0, family.size() - 6);
+    }
+
+    out << "# HELP " << family << " " << help << "\n";
+    out << "# TYPE " << family << " " << type << "\n";
+}
+
+template<typename TValue>
+static void WriteMetric(std::ostream& out, MetricsHandler::Format format, const std::string& name, std::string_view type, const std::string& help, TValue value)
+{
+    WriteFamily(out, format, name, type, help);
+    out << SampleName(format, name, type) << " " << value << "\n";
+}
+
+// Save paths and categories are user input, so quotes, backslashes and newlines are escaped.
+static std::string EscapeLabel(const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for (const char c : value)
+    {
+        switch (c)
+        {
+        case '\\': escaped += "\\\\"; break;
+        case '"':  escaped += "\\\""; break;
+        case '\n': escaped += "\\n"; break;
+        default:   escaped += c; break;
+        }
+    }
+
+    return escaped;
+}
+
+template<typename TItem>
+static std::int64_t Sum(const std::vector<TItem>& items, int TItem::* field)
+{
+    std::int64_t sum = 0;
+    for (const auto& item : items) { sum += item.*field; }
+    return sum;
+}
+
+// Labels are given rendered, as in 'method="x"', and may be empty.
+static void WriteHistogram(std::ostream& out, const std::string& name, const std::string& labels, const porla::Utils::Histogram& histogram)
 {
-    m_sessionStatsConnection = m_session.OnSessionStats([this](auto s) { OnSessionStats(s); });
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    const std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+
+    std::uint64_t cumulative = 0;
+
+    for (std::size_t i = 0; i < histogram.Counts().size(); i++)
+    {
+        cumulative += histogram.Counts()[i];
+
+        out << name << "_bucket{" << prefix << "le=\"";
+
+        if (i < histogram.Bounds().size()) out << histogram.Bounds()[i];
+        else                               out << "+Inf";
+
+        out << "\"} " << cumulative << "\n";
+    }
+
+    out << name << "_sum" << suffix << " " << histogram.Sum() << "\n";
+    out << name << "_count" << suffix << " " << histogram.Count() << "\n";
+}
+
+MetricsHandler::MetricsHandler(const porla::MetricsHandlerOptions& options)
+    : m_options(options)
+{
+    m_sessionStatsConnection = m_options.session.OnSessionStats([this](const auto& s) { OnSessionStats(s); });
 }
 
 MetricsHandler::~MetricsHandler()
@@ -17,20 +130,526 @@ MetricsHandler::~MetricsHandler()
 
 void MetricsHandler::operator()(const std::shared_ptr<porla::HttpContext> &ctx)
 {
+    const auto& req = ctx->Request();
+
+    const auto accept = req.find(http::field::accept);
+    const auto format = accept != req.end() && accept->value().find("application/openmetrics-text") != std::string::npos
+        ? Format::OpenMetrics
+        : Format::Prometheus;
+
+    // The libtorrent counters only change with each session stats alert, so they are
+    // rendered then and reused here. Everything else is cheap enough to render per scrape.
     std::stringstream out;
+    out << m_rendered[static_cast<int>(format)];
+
+    Render(out, format);
 
-    for (auto const& [key,val] : m_stats)
+    if (format == Format::OpenMetrics)
     {
-        std::string key_replaced = key;
-        std::replace(key_replaced.begin(), key_replaced.end(), '.', '_');
+        out << "# EOF\n";
+    }
+
+    http::response<http::string_body> res{http::status::ok, req.version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::vary, "Accept, Accept-Encoding");
+    res.set(
+        http::field::content_type,
+        format == Format::OpenMetrics
+            ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+            : "text/plain; version=0.0.4; charset=utf-8");
+    res.keep_alive(req.keep_alive());
+    res.body() = out.str();
 
-        out << "libtorrent_" << key_replaced << " " << val << "\n";
+    const auto accept_encoding = req.find(http::field::accept_encoding);
+
+    if (accept_encoding != req.end()
+        && Utils::Gzip::IsAccepted({accept_encoding->value().data(), accept_encoding->value().size()}))
+    {
+        try
+        {
+            res.body() = Utils::Gzip::Compress(res.body());
+            res.set(http::field::content_encoding, "gzip");
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to compress metrics: " << ex.what();
+        }
     }
 
-    ctx->Write(out.str());
+    res.prepare_payload();
+
+    ctx->Write(std::move(res));
 }
 
-void MetricsHandler::OnSessionStats(const std::map<std::string, int64_t>& stats)
+void MetricsHandler::Render(std::ostream& out, Format format) const
 {
-    m_stats = stats;
+    if (m_options.aggregates != nullptr)
+    {
+        RenderAggregates(out, format);
+    }
+
+    if (m_options.counters != nullptr)
+    {
+        RenderCounters(out, format);
+    }
+
+    if (m_options.memory != nullptr)
+    {
+        RenderMemory(out, format);
+    }
+
+    if (m_options.peers != nullptr)
+    {
+        RenderPeers(out, format);
+    }
+
+    if (m_options.trackers != nullptr)
+    {
+        RenderTrackers(out, format);
+    }
+
+    if (const auto instrumentation = m_options.session.Instrumentation())
+    {
+        RenderInstrumentation(out, format, *instrumentation);
+    }
+
+    if (const auto dht = m_options.session.Dht())
+    {
+        RenderDht(out, format, *dht);
+    }
+
+    const auto loading = m_options.session.Loading();
+
+    WriteMetric(out, format, "porla_session_ready", Gauge, "Whether the stored torrents are loaded.", loading.done ? 1 : 0);
+    WriteMetric(out, format, "porla_session_torrents_loaded", Gauge, "Stored torrents loaded at startup.", loading.loaded);
+    WriteMetric(out, format, "porla_session_torrents_stored", Gauge, "Stored torrents to load at startup.", loading.total);
+
+    WriteFamily(out, format, "porla_startup_phase_seconds", Gauge, "Time taken by each phase of startup.");
+    for (const auto& phase : porla::Utils::Phases::Startup().Get()) out << "porla_startup_phase_seconds{phase=\"" << phase.name << "\"} " << phase.seconds << "\n";
+
+    if (m_options.events != nullptr)
+    {
+        const auto& stats = m_options.events->Stats();
+
+        WriteMetric(out, format, "porla_events_coalesced", Counter, "Events replaced by a newer one in a client queue.", stats.coalesced.load());
+        WriteMetric(out, format, "porla_events_disconnected", Counter, "Event stream clients disconnected for falling behind.", stats.disconnected.load());
+        WriteMetric(out, format, "porla_events_dropped", Counter, "Events dropped from a full client queue.", stats.dropped.load());
+        WriteMetric(out, format, "porla_events_rejected", Counter, "Event stream clients turned away at the subscriber limit.", stats.rejected.load());
+        WriteMetric(out, format, "porla_events_subscribers", Gauge, "Connected event stream clients.", stats.subscribers.load());
+    }
+
+    if (m_options.http != nullptr)
+    {
+        const auto stats = m_options.http->GetStats();
+
+        WriteMetric(out, format, "porla_http_connections", Gauge, "Open HTTP connections.", stats.connections);
+        WriteMetric(out, format, "porla_http_connections_accepted", Counter, "HTTP connections accepted.", stats.accepted);
+        WriteMetric(out, format, "porla_http_connections_rejected", Counter, "HTTP connections closed at the connection limit.", stats.rejected);
+    }
+
+    if (m_options.admission != nullptr)
+    {
+        const auto stats = m_options.admission->GetStats();
+
+        WriteMetric(out, format, "porla_rpc_admission_admitted", Counter, "RPC requests let in by admission control.", stats.admitted);
+        WriteMetric(out, format, "porla_rpc_admission_queued", Gauge, "RPC requests waiting for an admission slot.", stats.queued);
+        WriteMetric(out, format, "porla_rpc_admission_running", Gauge, "RPC requests holding an admission slot.", stats.running);
+        WriteMetric(out, format, "porla_rpc_admission_shed_full", Counter, "RPC requests shed by a full admission queue.", stats.shed_full);
+        WriteMetric(out, format, "porla_rpc_admission_shed_timeout", Counter, "RPC requests shed after waiting past their queue budget.", stats.shed_timeout);
+    }
+
+    if (m_options.workers != nullptr)
+    {
+        const auto stats = m_options.workers->GetStats();
+
+        WriteMetric(out, format, "porla_rpc_workers_completed", Counter, "RPC requests run on a worker.", stats.completed);
+        WriteMetric(out, format, "porla_rpc_workers_queued", Gauge, "RPC requests waiting for a worker.", stats.queued);
+        WriteMetric(out, format, "porla_rpc_workers_rejected", Counter, "RPC requests rejected by a full worker queue.", stats.rejected);
+        WriteMetric(out, format, "porla_rpc_workers_wait_us_max", Gauge, "Longest time in microseconds an RPC request waited for a worker.", stats.wait_us_max);
+        WriteMetric(out, format, "porla_rpc_workers_wait_us_total", Counter, "Total time in microseconds RPC requests waited for a worker.", stats.wait_us_total);
+    }
+
+    if (m_options.workflows != nullptr && !m_options.workflows->Stats().empty())
+    {
+        const auto& stats = m_options.workflows->Stats();
+
+        out << std::setprecision(12);
+
+        WriteFamily(out, format, "porla_workflow_evaluations_total", Counter, "Times a workflow's conditions were evaluated.");
+        for (const auto& s : stats) out << "porla_workflow_evaluations_total{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.evaluations << "\n";
+
+        WriteFamily(out, format, "porla_workflow_matches_total", Counter, "Times a workflow's conditions matched and it was run.");
+        for (const auto& s : stats) out << "porla_workflow_matches_total{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.matches << "\n";
+
+        WriteFamily(out, format, "porla_workflow_evaluation_seconds_total", Counter, "Time spent evaluating a workflow's conditions.");
+        for (const auto& s : stats) out << "porla_workflow_evaluation_seconds_total{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.seconds << "\n";
+
+        WriteFamily(out, format, "porla_workflow_runs_total", Counter, "Workflow runs started.");
+        for (const auto& s : stats) out << "porla_workflow_runs_total{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.runs << "\n";
+
+        WriteFamily(out, format, "porla_workflow_runs_running", Gauge, "Workflow runs in progress.");
+        for (const auto& s : stats) out << "porla_workflow_runs_running{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.running << "\n";
+
+        WriteFamily(out, format, "porla_workflow_runs_queued", Gauge, "Workflow runs waiting for a slot.");
+        for (const auto& s : stats) out << "porla_workflow_runs_queued{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.queued << "\n";
+
+        WriteFamily(out, format, "porla_workflow_runs_rejected_total", Counter, "Workflow runs dropped because the queue was full.");
+        for (const auto& s : stats) out << "porla_workflow_runs_rejected_total{workflow=\"" << EscapeLabel(s.name) << "\"} " << s.rejected << "\n";
+
+        WriteMetric(out, format, "porla_workflow_queue_wait_seconds_total", Counter, "Total time workflow runs waited for a slot.", m_options.workflows->Queue().wait_seconds);
+    }
+
+    if (m_options.timers != nullptr)
+    {
+        const auto stats = m_options.timers->GetStats();
+
+        WriteMetric(out, format, "porla_workflow_timers_pending", Gauge, "Workflow action timeouts waiting to expire.", stats.pending);
+        WriteMetric(out, format, "porla_workflow_timers_expired", Counter, "Workflow action timeouts expired.", stats.expired);
+        WriteMetric(out, format, "porla_workflow_timers_cancelled", Counter, "Workflow action timeouts cancelled before expiring.", stats.cancelled);
+    }
+
+    if (m_options.quotas != nullptr)
+    {
+        const auto quotas = m_options.quotas->Quotas();
+
+        WriteFamily(out, format, "porla_quota_max_bytes", Gauge, "Size allowed for the torrents of each quota.");
+        for (const auto& q : quotas) out << "porla_quota_max_bytes{quota=\"" << EscapeLabel(q.name) << "\"} " << q.max_size << "\n";
+
+        WriteFamily(out, format, "porla_quota_reserved_bytes", Gauge, "Wanted size of the torrents in each quota.");
+        for (const auto& q : quotas) out << "porla_quota_reserved_bytes{quota=\"" << EscapeLabel(q.name) << "\"} " << q.reserved << "\n";
+
+        WriteFamily(out, format, "porla_quota_completed_bytes", Gauge, "Completed size of the torrents in each quota.");
+        for (const auto& q : quotas) out << "porla_quota_completed_bytes{quota=\"" << EscapeLabel(q.name) << "\"} " << q.completed << "\n";
+
+        WriteFamily(out, format, "porla_quota_torrents", Gauge, "Torrents counted against each quota.");
+        for (const auto& q : quotas) out << "porla_quota_torrents{quota=\"" << EscapeLabel(q.name) << "\"} " << q.torrents << "\n";
+
+        WriteFamily(out, format, "porla_quota_over_torrents", Gauge, "Downloads which do not fit in each quota.");
+        for (const auto& q : quotas) out << "porla_quota_over_torrents{quota=\"" << EscapeLabel(q.name) << "\"} " << q.over << "\n";
+    }
+
+    if (m_options.rpc != nullptr)
+    {
+        const auto stats = m_options.rpc->Stats();
+
+        // Enough digits for the bucket bounds to be printed exactly.
+        out << std::setprecision(12);
+
+        WriteFamily(out, format, "porla_rpc_requests_total", Counter, "RPC requests by method.");
+        for (const auto& [method, s] : stats) out << "porla_rpc_requests_total{method=\"" << method << "\"} " << s.requests << "\n";
+
+        WriteFamily(out, format, "porla_rpc_errors_total", Counter, "RPC requests answered with an error, by method.");
+        for (const auto& [method, s] : stats) out << "porla_rpc_errors_total{method=\"" << method << "\"} " << s.errors << "\n";
+
+        WriteFamily(out, format, "porla_rpc_request_duration_seconds", Histogram, "Time until an RPC response is written, by method.");
+        for (const auto& [method, s] : stats) WriteHistogram(out, "porla_rpc_request_duration_seconds", "method=\"" + method + "\"", s.latency);
+
+        WriteFamily(out, format, "porla_rpc_response_size_bytes", Histogram, "Size of the encoded RPC response, by method.");
+        for (const auto& [method, s] : stats) WriteHistogram(out, "porla_rpc_response_size_bytes", "method=\"" + method + "\"", s.size);
+    }
+
+    if (m_options.torrent_files != nullptr)
+    {
+        const auto stats = m_options.torrent_files->GetStats();
+
+        WriteMetric(out, format, "porla_torrent_parse_cache_hits_total", Counter, "Torrent files added again and taken from the parse cache.", stats.hits);
+        WriteMetric(out, format, "porla_torrent_parse_rejected_total", Counter, "Torrent files rejected for their size before they were decoded.", stats.rejected);
+
+        out << std::setprecision(12);
+
+        WriteFamily(out, format, "porla_torrent_parse_seconds", Histogram, "Time taken to decode and parse a torrent file which was not cached.");
+        WriteHistogram(out, "porla_torrent_parse_seconds", "", stats.parse_seconds);
+    }
+}
+
+void MetricsHandler::RenderMemory(std::ostream& out, Format format) const
+{
+    const auto snapshot = m_options.memory->Sample();
+
+    WriteFamily(out, format, "porla_memory_bytes", Gauge, "Approximate memory held by each subsystem.");
+    for (const auto& [name, usage] : snapshot.subsystems) out << "porla_memory_bytes{subsystem=\"" << name << "\"} " << usage.bytes << "\n";
+
+    WriteFamily(out, format, "porla_memory_objects", Gauge, "Objects kept by each subsystem.");
+    for (const auto& [name, usage] : snapshot.subsystems) out << "porla_memory_objects{subsystem=\"" << name << "\"} " << usage.objects << "\n";
+
+    if (snapshot.process.resident)
+    {
+        WriteMetric(out, format, "porla_process_resident_bytes", Gauge, "Resident memory of the process.", *snapshot.process.resident);
+    }
+
+    if (snapshot.process.heap_allocated && snapshot.process.heap_free)
+    {
+        WriteFamily(out, format, "porla_process_heap_bytes", Gauge, "Heap memory in use and held free by the allocator.");
+        out << "porla_process_heap_bytes{state=\"allocated\"} " << *snapshot.process.heap_allocated << "\n";
+        out << "porla_process_heap_bytes{state=\"free\"} " << *snapshot.process.heap_free << "\n";
+    }
+}
+
+void MetricsHandler::RenderInstrumentation(std::ostream& out, Format format, const SessionInstrumentation& instrumentation) const
+{
+    out << std::setprecision(12);
+
+    WriteFamily(out, format, "porla_session_alert_batch_size", Histogram, "Alerts read per pop_alerts call.");
+    WriteHistogram(out, "porla_session_alert_batch_size", "", instrumentation.alert_batch_size);
+
+    WriteFamily(out, format, "porla_session_alert_loop_lag_seconds", Histogram, "Time from libtorrent notifying of alerts, or the alert thread popping them, until they are handled on the io thread.");
+    WriteHistogram(out, "porla_session_alert_loop_lag_seconds", "", instrumentation.loop_lag);
+
+    WriteMetric(out, format, "porla_session_alert_queue_depth", Gauge, "Alert batches decoded on the alert thread and waiting for the io thread.", instrumentation.alert_queue_depth);
+    WriteMetric(out, format, "porla_session_alert_queue_size", Gauge, "Size of the libtorrent alert queue, which grows when alerts are dropped.", instrumentation.alert_queue_size);
+    WriteMetric(out, format, "porla_session_alert_resyncs_total", Counter, "Times torrents or resume data were reconciled with the session after alerts were dropped.", instrumentation.alert_resyncs);
+
+    WriteFamily(out, format, "porla_session_load_add_seconds", Histogram, "Time from passing a stored torrent to libtorrent at startup until it was added.");
+    WriteHistogram(out, "porla_session_load_add_seconds", "", instrumentation.load_add);
+
+    WriteFamily(out, format, "porla_session_load_decode_seconds", Histogram, "Time taken to decode the resume data of a stored torrent at startup.");
+    WriteHistogram(out, "porla_session_load_decode_seconds", "", instrumentation.load_decode);
+
+    WriteFamily(out, format, "porla_session_alerts_total", Counter, "Alerts processed, by type.");
+    for (const auto& [type, t] : instrumentation.alerts) out << "porla_session_alerts_total{type=\"" << type << "\"} " << t.count << "\n";
+
+    WriteFamily(out, format, "porla_session_alert_seconds_total", Counter, "Time spent processing alerts, by type.");
+    for (const auto& [type, t] : instrumentation.alerts) out << "porla_session_alert_seconds_total{type=\"" << type << "\"} " << t.seconds << "\n";
+
+    WriteFamily(out, format, "porla_session_alerts_dropped_total", Counter, "Times alerts were dropped from a full alert queue, by type.");
+    for (const auto& [type, count] : instrumentation.alerts_dropped) out << "porla_session_alerts_dropped_total{type=\"" << type << "\"} " << count << "\n";
+
+    WriteFamily(out, format, "porla_session_signals_total", Counter, "Session signals emitted, by signal.");
+    for (const auto& [signal, t] : instrumentation.signals) out << "porla_session_signals_total{signal=\"" << signal << "\"} " << t.count << "\n";
+
+    WriteFamily(out, format, "porla_session_signal_seconds_total", Counter, "Time spent in signal subscribers, by signal.");
+    for (const auto& [signal, t] : instrumentation.signals) out << "porla_session_signal_seconds_total{signal=\"" << signal << "\"} " << t.seconds << "\n";
+
+    WriteFamily(out, format, "porla_persistence_write_duration_seconds", Histogram, "Time to encode and write a torrent to the database.");
+    WriteHistogram(out, "porla_persistence_write_duration_seconds", "", instrumentation.persist_duration);
+
+    WriteFamily(out, format, "porla_persistence_write_size_bytes", Histogram, "Encoded resume and client data written per torrent.");
+    WriteHistogram(out, "porla_persistence_write_size_bytes", "", instrumentation.persist_size);
+}
+
+void MetricsHandler::RenderCounters(std::ostream& out, Format format) const
+{
+    const auto& totals = m_options.counters->Totals();
+
+    WriteMetric(out, format, "porla_torrents_downloaded_bytes", Counter, "Payload received in blocks, as of the last batch of torrent counters.", totals.downloaded);
+    WriteMetric(out, format, "porla_torrents_uploaded_bytes", Counter, "Payload sent, as of the last batch of torrent counters.", totals.uploaded);
+    WriteMetric(out, format, "porla_torrents_peer_connects", Counter, "Peer connections made, as of the last batch of torrent counters.", totals.connects);
+    WriteMetric(out, format, "porla_torrents_peer_disconnects", Counter, "Peer connections closed, as of the last batch of torrent counters.", totals.disconnects);
+    WriteMetric(out, format, "porla_torrents_hash_failures", Counter, "Pieces which failed the hash check, as of the last batch of torrent counters.", totals.hash_failures);
+    WriteMetric(out, format, "porla_torrents_disk_read_bytes", Counter, "Block bytes requested by peers, as of the last batch of torrent counters.", totals.disk_read);
+    WriteMetric(out, format, "porla_torrents_checking_milliseconds", Counter, "Time spent checking files and resume data, as of the last batch of torrent counters.", totals.checking_ms);
+}
+
+void MetricsHandler::RenderDht(std::ostream& out, Format format, const DhtStats& dht) const
+{
+    WriteMetric(out, format, "porla_dht_state_saved_timestamp_seconds", Gauge, "When the DHT state was last written to disk, or 0.", dht.state_saved);
+
+    struct DhtGauge
+    {
+        const char* name;
+        const char* help;
+        std::int64_t (*value)(const DhtStats::Node&);
+    };
+
+    static const std::array<DhtGauge, 5> gauges = {{
+        {"porla_dht_nodes",           "Nodes in the routing table, by DHT endpoint.",
+            [](const DhtStats::Node& node) { return Sum(node.buckets, &DhtStats::Bucket::nodes); }},
+        {"porla_dht_replacements",    "Replacement nodes in the routing table, by DHT endpoint.",
+            [](const DhtStats::Node& node) { return Sum(node.buckets, &DhtStats::Bucket::replacements); }},
+        {"porla_dht_buckets",         "Buckets in the routing table, by DHT endpoint.",
+            [](const DhtStats::Node& node) { return static_cast<std::int64_t>(node.buckets.size()); }},
+        {"porla_dht_lookups",         "Lookups in flight, by DHT endpoint.",
+            [](const DhtStats::Node& node) { return static_cast<std::int64_t>(node.lookups.size()); }},
+        {"porla_dht_lookup_timeouts", "Timed out requests of the lookups in flight, by DHT endpoint.",
+            [](const DhtStats::Node& node) { return Sum(node.lookups, &DhtStats::Lookup::timeouts); }}
+    }};
+
+    for (const auto& gauge : gauges)
+    {
+        WriteFamily(out, format, gauge.name, Gauge, gauge.help);
+
+        for (const auto& node : dht.nodes)
+        {
+            out << SampleName(format, gauge.name, Gauge) << "{endpoint=\"" << EscapeLabel(node.endpoint) << "\"} " << gauge.value(node) << "\n";
+        }
+    }
+}
+
+void MetricsHandler::RenderPeers(std::ostream& out, Format format) const
+{
+    using porla::PeerAggregates;
+
+    const auto& snapshot = m_options.peers->Get();
+
+    WriteMetric(out, format, "porla_peers", Gauge, "Peers as of the last sample of each torrent.", snapshot.total.peers);
+    WriteMetric(out, format, "porla_peers_connected", Counter, "Peers seen connecting between samples of a torrent.", snapshot.connected);
+    WriteMetric(out, format, "porla_peers_disconnected", Counter, "Peers seen disconnecting between samples of a torrent.", snapshot.disconnected);
+
+    struct PeerGauge
+    {
+        const char* name;
+        const char* help;
+        std::int64_t PeerAggregates::Values::* value;
+    };
+
+    static const std::array<PeerGauge, 3> gauges = {{
+        {"peers",               "Peers",                            &PeerAggregates::Values::peers},
+        {"peers_download_rate", "Download payload rate in bytes/s", &PeerAggregates::Values::download_rate},
+        {"peers_upload_rate",   "Upload payload rate in bytes/s",   &PeerAggregates::Values::upload_rate}
+    }};
+
+    const std::array<std::pair<std::string, const std::map<std::string, PeerAggregates::Values>*>, 2> groups = {{
+        {"client",  &snapshot.clients},
+        {"network", &snapshot.networks}
+    }};
+
+    for (const auto& [label, group] : groups)
+    {
+        for (const auto& gauge : gauges)
+        {
+            const auto name = std::string("porla_") + gauge.name + "_by_" + label;
+
+            WriteFamily(out, format, name, Gauge, std::string(gauge.help) + " by " + label + ".");
+
+            for (const auto& [value, values] : *group)
+            {
+                out << name << "{" << label << "=\"" << EscapeLabel(value) << "\"} " << values.*gauge.value << "\n";
+            }
+        }
+    }
+}
+
+void MetricsHandler::RenderTrackers(std::ostream& out, Format format) const
+{
+    const auto& hosts = m_options.trackers->Hosts();
+
+    struct TrackerCounter
+    {
+        const char* name;
+        const char* help;
+        std::uint64_t TrackerRegistry::Stats::* value;
+    };
+
+    static const std::array<TrackerCounter, 3> counters = {{
+        {"porla_tracker_announces", "Announces sent to the tracker.",       &TrackerRegistry::Stats::announces},
+        {"porla_tracker_failures",  "Announces the tracker failed.",        &TrackerRegistry::Stats::failures},
+        {"porla_tracker_replies",   "Announces the tracker replied to.",    &TrackerRegistry::Stats::replies}
+    }};
+
+    for (const auto& counter : counters)
+    {
+        WriteFamily(out, format, counter.name, Counter, counter.help);
+
+        for (const auto& [host, stats] : hosts)
+        {
+            out << SampleName(format, counter.name, Counter) << "{tracker=\"" << EscapeLabel(host) << "\"} " << stats.*counter.value << "\n";
+        }
+    }
+
+    const std::string errors = "porla_tracker_errors";
+
+    WriteFamily(out, format, errors, Counter, "Failed announces by tracker and reason.");
+
+    for (const auto& [host, stats] : hosts)
+    {
+        for (const auto& [reason, count] : stats.errors)
+        {
+            out << SampleName(format, errors, Counter) << "{tracker=\"" << EscapeLabel(host) << "\",reason=\"" << EscapeLabel(reason) << "\"} " << count << "\n";
+        }
+    }
+
+    WriteFamily(out, format, "porla_tracker_latency_seconds", Histogram, "Time from sending an announce to its reply or failure.");
+
+    for (const auto& [host, stats] : hosts)
+    {
+        WriteHistogram(out, "porla_tracker_latency_seconds", "tracker=\"" + EscapeLabel(host) + "\"", stats.latency);
+    }
+}
+
+void MetricsHandler::RenderAggregates(std::ostream& out, Format format) const
+{
+    using porla::TorrentAggregates;
+
+    struct AggregateGauge
+    {
+        const char* name;
+        const char* help;
+        std::int64_t TorrentAggregates::Values::* value;
+    };
+
+    static const std::array<AggregateGauge, 4> gauges = {{
+        {"torrents",               "Torrents",                         &TorrentAggregates::Values::count},
+        {"torrents_download_rate", "Download payload rate in bytes/s", &TorrentAggregates::Values::download_rate},
+        {"torrents_upload_rate",   "Upload payload rate in bytes/s",   &TorrentAggregates::Values::upload_rate},
+        {"torrents_size_bytes",    "Total wanted size in bytes",       &TorrentAggregates::Values::size}
+    }};
+
+    // Ratios can go down as well as up, which OpenMetrics calls a gauge histogram.
+    const bool om = format == Format::OpenMetrics;
+
+    for (int d = 0; d < TorrentAggregates::DimensionCount; d++)
+    {
+        const auto  dimension = static_cast<TorrentAggregates::Dimension>(d);
+        const auto& group     = m_options.aggregates->Group(dimension);
+        const std::string label = TorrentAggregates::Name(dimension);
+
+        for (const auto& gauge : gauges)
+        {
+            const auto name = std::string("porla_") + gauge.name + "_by_" + label;
+
+            WriteFamily(out, format, name, Gauge, std::string(gauge.help) + " by " + label + ".");
+
+            for (const auto& [value, values] : group)
+            {
+                out << name << "{" << label << "=\"" << EscapeLabel(value) << "\"} " << values.*gauge.value << "\n";
+            }
+        }
+
+        const auto ratio = "porla_torrents_ratio_by_" + label;
+
+        WriteFamily(out, format, ratio, om ? "gaugehistogram" : Histogram, "Share ratio distribution by " + label + ".");
+
+        for (const auto& [value, values] : group)
+        {
+            const auto escaped = EscapeLabel(value);
+            std::int64_t cumulative = 0;
+
+            for (std::size_t i = 0; i < values.ratio.size(); i++)
+            {
+                cumulative += values.ratio[i];
+
+                out << ratio << "_bucket{" << label << "=\"" << escaped << "\",le=\"";
+
+                if (i < TorrentAggregates::RatioBounds.size()) out << TorrentAggregates::RatioBounds[i];
+                else                                           out << "+Inf";
+
+                out << "\"} " << cumulative << "\n";
+            }
+
+            out << ratio << (om ? "_gsum{" : "_sum{") << label << "=\"" << escaped << "\"} " << values.ratio_sum << "\n";
+            out << ratio << (om ? "_gcount{" : "_count{") << label << "=\"" << escaped << "\"} " << values.count << "\n";
+        }
+    }
+}
+
+void MetricsHandler::OnSessionStats(const porla::SessionMetrics& stats)
+{
+    for (const auto format : { Format::OpenMetrics, Format::Prometheus })
+    {
+        std::stringstream out;
+
+        for (std::size_t i = 0; i < stats.Size(); i++)
+        {
+            const auto& key = stats.Name(i);
+
+            std::string name = "libtorrent_" + key;
+            std::replace(name.begin(), name.end(), '.', '_');
+
+            // Anything libtorrent does not know of, like the simulated session stats, is
+            // reported as a gauge.
+            WriteMetric(out, format, name, stats.IsCounter(i) ? Counter : Gauge, "libtorrent " + key, stats.Value(i));
+        }
+
+        m_rendered[static_cast<int>(format)] = out.str();
+    }
 }
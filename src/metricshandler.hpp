@@ -1,17 +1,67 @@
 #pragma once
 
-#include <boost/signals2.hpp>
+#include <array>
+#include <ostream>
+#include <string>
 
 #include "httpcontext.hpp"
+#include "utils/signal.hpp"
 
 namespace porla
 {
+    class AdmissionController;
+    class HttpEventStream;
+    class HttpServer;
+    class JsonRpcHandler;
     class ISession;
+    class MemoryAccounting;
+    class PeerAggregates;
+    class SavePathQuotas;
+    struct DhtStats;
+    struct SessionInstrumentation;
+    class SessionMetrics;
+    class TorrentAggregates;
+    class TorrentCounters;
+    class TorrentInfoCache;
+    class TrackerRegistry;
+    class WorkerPool;
+
+    namespace Workflows
+    {
+        class Executor;
+        class TimerWheel;
+    }
+
+    // Everything but the session is optional, and adds its metrics when set.
+    struct MetricsHandlerOptions
+    {
+        ISession&                session;
+        const AdmissionController* admission = nullptr;
+        const TorrentAggregates* aggregates = nullptr;
+        const TorrentCounters*   counters = nullptr;
+        const HttpEventStream*   events = nullptr;
+        const HttpServer*        http = nullptr;
+        const MemoryAccounting*  memory = nullptr;
+        const PeerAggregates*    peers = nullptr;
+        const SavePathQuotas*    quotas = nullptr;
+        const JsonRpcHandler*    rpc = nullptr;
+        const TorrentInfoCache*  torrent_files = nullptr;
+        const TrackerRegistry*   trackers = nullptr;
+        const WorkerPool*        workers = nullptr;
+        const Workflows::Executor* workflows = nullptr;
+        const Workflows::TimerWheel* timers = nullptr;
+    };
 
     class MetricsHandler
     {
     public:
-        explicit MetricsHandler(ISession& session);
+        enum class Format
+        {
+            OpenMetrics,
+            Prometheus
+        };
+
+        explicit MetricsHandler(const MetricsHandlerOptions& options);
         explicit MetricsHandler(const MetricsHandler&) = delete;
         explicit MetricsHandler(const MetricsHandler&&) = delete;
 
@@ -20,10 +70,18 @@ namespace porla
         void operator()(const std::shared_ptr<porla::HttpContext>& ctx);
 
     private:
-        void OnSessionStats(const std::map<std::string, int64_t>& stats);
+        void OnSessionStats(const SessionMetrics& stats);
+        void Render(std::ostream& out, Format format) const;
+        void RenderAggregates(std::ostream& out, Format format) const;
+        void RenderCounters(std::ostream& out, Format format) const;
+        void RenderDht(std::ostream& out, Format format, const DhtStats& dht) const;
+        void RenderMemory(std::ostream& out, Format format) const;
+        void RenderPeers(std::ostream& out, Format format) const;
+        void RenderTrackers(std::ostream& out, Format format) const;
+        void RenderInstrumentation(std::ostream& out, Format format, const SessionInstrumentation& instrumentation) const;
 
-        ISession& m_session;
-        boost::signals2::connection m_sessionStatsConnection;
-        std::map<std::string, int64_t> m_stats;
+        MetricsHandlerOptions m_options;
+        porla::Utils::Connection m_sessionStatsConnection;
+        std::array<std::string, 2> m_rendered;
     };
 }
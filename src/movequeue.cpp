@@ -0,0 +1,303 @@
+#include "movequeue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "session.hpp"
+#include "utils/mounttable.hpp"
+
+namespace lt = libtorrent;
+
+using porla::MoveQueue;
+
+static std::int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Paths which cannot be resolved share one device, so they are at least limited together.
+static std::uint64_t DeviceOf(const std::string& path)
+{
+    return porla::Utils::MountTable::DeviceId(path).value_or(0);
+}
+
+const char* MoveQueue::Name(State state)
+{
+    switch (state)
+    {
+    case State::Queued:  return "queued";
+    case State::Moving:  return "moving";
+    case State::Moved:   return "moved";
+    case State::Failed:  return "failed";
+    case State::Removed: return "removed";
+    }
+
+    return "unknown";
+}
+
+MoveQueue::MoveQueue(porla::ISession& session, porla::MoveQueueOptions options)
+    : m_session(session)
+    , m_options(options)
+    , m_next(0)
+{
+    m_movedConnection = m_session.OnStorageMoved(
+        [this](const lt::torrent_handle& th) { Finish(th.info_hashes(), State::Moved); });
+
+    m_movedFailedConnection = m_session.OnStorageMovedFailed(
+        [this](const lt::torrent_handle& th) { Finish(th.info_hashes(), State::Failed); });
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            Forget(hash);
+            Finish(hash, State::Removed);
+        });
+}
+
+MoveQueue::~MoveQueue()
+{
+    m_movedConnection.disconnect();
+    m_movedFailedConnection.disconnect();
+    m_removedConnection.disconnect();
+}
+
+bool MoveQueue::Enqueue(
+    const lt::info_hash_t& hash,
+    std::string path,
+    lt::move_flags_t flags,
+    int priority,
+    DoneCallback done)
+{
+    const auto& statuses = m_session.TorrentStatuses();
+    const auto status = statuses.find(hash);
+
+    if (status == statuses.end())
+    {
+        return false;
+    }
+
+    std::uint64_t id;
+
+    if (const auto queued = m_queued.find(hash); queued != m_queued.end())
+    {
+        id = queued->second;
+
+        auto& job = m_jobs.at(id);
+        m_order.erase({ -job.move.priority, id });
+
+        job.move.path     = std::move(path);
+        job.move.priority = priority;
+        job.flags         = flags;
+        job.target        = DeviceOf(job.move.path);
+
+        if (done) job.done.push_back(std::move(done));
+    }
+    else
+    {
+        id = m_next++;
+
+        // A torrent still moving is queued from where that move takes it.
+        const auto moving = m_moving.find(hash);
+        const auto source = moving != m_moving.end() ? m_jobs.at(moving->second).target : DeviceOf(status->second.save_path);
+
+        Job job{
+            .move = Move{
+                .info_hash = hash,
+                .path      = std::move(path),
+                .priority  = priority,
+                .state     = State::Queued,
+                .queued_at = Now()
+            },
+            .flags  = flags,
+            .source = source
+        };
+
+        job.target = DeviceOf(job.move.path);
+
+        if (done) job.done.push_back(std::move(done));
+
+        m_jobs.insert({ id, std::move(job) });
+        m_queued.insert({ hash, id });
+    }
+
+    m_order.insert({ -priority, id });
+
+    auto move = m_jobs.at(id).move;
+    move.position = Position(id);
+
+    m_changed(move);
+
+    Pump();
+
+    return true;
+}
+
+std::vector<MoveQueue::Move> MoveQueue::List() const
+{
+    std::vector<Move> moves;
+    moves.reserve(m_jobs.size());
+
+    for (const auto& [hash, id] : m_moving)
+    {
+        moves.push_back(m_jobs.at(id).move);
+    }
+
+    int position = 0;
+
+    for (const auto& [priority, id] : m_order)
+    {
+        auto& move = moves.emplace_back(m_jobs.at(id).move);
+        move.position = position++;
+    }
+
+    return moves;
+}
+
+bool MoveQueue::Available(std::uint64_t device) const
+{
+    const auto busy = m_busy.find(device);
+    return busy == m_busy.end() || busy->second < std::max(1, m_options.per_device);
+}
+
+void MoveQueue::Finish(const lt::info_hash_t& hash, State state)
+{
+    const auto moving = m_moving.find(hash);
+
+    // Moves not started by the queue are none of its business.
+    if (moving == m_moving.end())
+    {
+        return;
+    }
+
+    const auto id = moving->second;
+    auto job = std::move(m_jobs.at(id));
+
+    m_jobs.erase(id);
+    m_moving.erase(moving);
+
+    for (const auto device : std::set{ job.source, job.target })
+    {
+        if (auto busy = m_busy.find(device); busy != m_busy.end() && --busy->second <= 0)
+        {
+            m_busy.erase(busy);
+        }
+    }
+
+    // A move queued behind this one starts from wherever the torrent is now.
+    if (const auto queued = m_queued.find(hash); queued != m_queued.end())
+    {
+        m_jobs.at(queued->second).source = state == State::Moved ? job.target : job.source;
+    }
+
+    job.move.state = state;
+
+    if (state == State::Failed)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Queued move of " << hash.get_best() << " to " << job.move.path << " failed";
+    }
+
+    m_changed(job.move);
+
+    for (const auto& done : job.done)
+    {
+        done(state == State::Moved);
+    }
+
+    Pump();
+}
+
+void MoveQueue::Forget(const lt::info_hash_t& hash)
+{
+    const auto queued = m_queued.find(hash);
+
+    if (queued == m_queued.end())
+    {
+        return;
+    }
+
+    auto job = std::move(m_jobs.at(queued->second));
+
+    m_order.erase({ -job.move.priority, queued->second });
+    m_jobs.erase(queued->second);
+    m_queued.erase(queued);
+
+    job.move.state = State::Removed;
+
+    m_changed(job.move);
+
+    for (const auto& done : job.done)
+    {
+        done(false);
+    }
+}
+
+int MoveQueue::Position(std::uint64_t id) const
+{
+    const auto& job = m_jobs.at(id);
+    return static_cast<int>(std::distance(m_order.begin(), m_order.find({ -job.move.priority, id })));
+}
+
+void MoveQueue::Pump()
+{
+    const auto& torrents = m_session.Torrents();
+
+    std::vector<Move> started;
+    std::vector<std::uint64_t> gone;
+
+    for (auto it = m_order.begin(); it != m_order.end();)
+    {
+        const auto id = it->second;
+        auto& job = m_jobs.at(id);
+
+        // libtorrent runs the moves of a torrent in order anyway, but a second one would
+        // count against the devices twice.
+        if (m_moving.contains(job.move.info_hash) || !Available(job.source) || !Available(job.target))
+        {
+            ++it;
+            continue;
+        }
+
+        const auto handle = torrents.find(job.move.info_hash);
+
+        if (handle == torrents.end())
+        {
+            gone.push_back(id);
+            ++it;
+            continue;
+        }
+
+        handle->second.move_storage(job.move.path, job.flags);
+
+        for (const auto device : std::set{ job.source, job.target })
+        {
+            m_busy[device]++;
+        }
+
+        job.move.state      = State::Moving;
+        job.move.started_at = Now();
+
+        m_queued.erase(job.move.info_hash);
+        m_moving.insert({ job.move.info_hash, id });
+
+        started.push_back(job.move);
+
+        it = m_order.erase(it);
+    }
+
+    // Signalled after the loop, since subscribers may queue more moves.
+    for (const auto id : gone)
+    {
+        if (const auto job = m_jobs.find(id); job != m_jobs.end()) Forget(job->second.move.info_hash);
+    }
+
+    for (const auto& move : started)
+    {
+        m_changed(move);
+    }
+}
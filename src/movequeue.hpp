@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/storage_defs.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct MoveQueueOptions
+    {
+        // Moves which may read from or write to one device at the same time.
+        int per_device = 1;
+    };
+
+    // Runs storage moves in priority order, higher first and in the order they were queued
+    // otherwise, with a limit on how many moves touch a device at once. A move waits while
+    // its source or destination device is busy, but does not hold back moves on other
+    // devices. A torrent has at most one waiting move, so queueing it again replaces where
+    // it is going.
+    class MoveQueue
+    {
+    public:
+        enum class State
+        {
+            Queued,
+            Moving,
+            Moved,
+            Failed,
+            Removed
+        };
+
+        struct Move
+        {
+            libtorrent::info_hash_t info_hash;
+            std::string             path;
+            int                     priority;
+            State                   state;
+            // Among the queued moves, counted from zero. Not set once the move has started.
+            std::optional<int>      position;
+            std::int64_t            queued_at;
+            std::optional<std::int64_t> started_at;
+        };
+
+        // Called with whether the torrent ended up at the path it was queued for.
+        typedef std::function<void(bool moved)> DoneCallback;
+        typedef porla::Utils::Signal<void(const Move&)> MoveSignal;
+
+        static const char* Name(State state);
+
+        explicit MoveQueue(ISession& session, MoveQueueOptions options = {});
+        MoveQueue(const MoveQueue&) = delete;
+
+        ~MoveQueue();
+
+        // Returns false if the torrent is not in the session.
+        bool Enqueue(
+            const libtorrent::info_hash_t& hash,
+            std::string path,
+            libtorrent::move_flags_t flags,
+            int priority = 0,
+            DoneCallback done = nullptr);
+
+        // The running moves followed by the queued ones, in the order they will start.
+        [[nodiscard]] std::vector<Move> List() const;
+
+        porla::Utils::Connection OnChanged(const MoveSignal::slot_type& subscriber)
+        {
+            return m_changed.connect(subscriber);
+        }
+
+    private:
+        struct Job
+        {
+            Move                      move;
+            libtorrent::move_flags_t  flags;
+            std::uint64_t             source;
+            std::uint64_t             target;
+            std::vector<DoneCallback> done;
+        };
+
+        // Ordered by priority, highest first, and then by id, which grows as moves are queued.
+        typedef std::pair<int, std::uint64_t> OrderKey;
+
+        [[nodiscard]] bool Available(std::uint64_t device) const;
+        void Finish(const libtorrent::info_hash_t& hash, State state);
+        void Forget(const libtorrent::info_hash_t& hash);
+        [[nodiscard]] int Position(std::uint64_t id) const;
+        void Pump();
+
+        ISession& m_session;
+        MoveQueueOptions m_options;
+        std::uint64_t m_next;
+
+        std::map<std::uint64_t, Job> m_jobs;
+        std::set<OrderKey> m_order;
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_queued;
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_moving;
+        // Running moves by the devices they touch.
+        std::map<std::uint64_t, int> m_busy;
+
+        porla::Utils::Connection m_movedConnection;
+        porla::Utils::Connection m_movedFailedConnection;
+        porla::Utils::Connection m_removedConnection;
+
+        MoveSignal m_changed;
+    };
+}
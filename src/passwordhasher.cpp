@@ -0,0 +1,111 @@
+#include "passwordhasher.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+#include <sodium.h>
+
+using porla::PasswordHasher;
+
+static int Threads(const porla::PasswordHasherOptions& options)
+{
+    return static_cast<int>(std::max<std::size_t>(1, options.memory_budget / std::max<std::size_t>(1, options.memlimit)));
+}
+
+PasswordHasher::PasswordHasher(boost::asio::io_context& io, const PasswordHasherOptions& options)
+    : m_options(options)
+    , m_threads(::Threads(options))
+    , m_pool(io, WorkerPoolOptions{ .threads = m_threads, .queue_size = std::max(1, options.queue_size) })
+{
+    BOOST_LOG_TRIVIAL(debug) << "Hashing passwords on " << m_threads << " thread(s)";
+}
+
+void PasswordHasher::Hash(std::string password, std::function<void(Result, std::string)> callback)
+{
+    Run(
+        [callback](Result result) { callback(result, {}); },
+        [this, callback, password = std::move(password)]()
+        {
+            std::string hashed;
+            hashed.resize(crypto_pwhash_STRBYTES);
+
+            const int result = crypto_pwhash_str(
+                hashed.data(),
+                password.c_str(),
+                password.size(),
+                m_options.opslimit,
+                m_options.memlimit);
+
+            hashed.resize(hashed.find('\0') == std::string::npos ? hashed.size() : hashed.find('\0'));
+
+            m_pool.Complete(
+                [callback, hashed = std::move(hashed), result]()
+                {
+                    callback(result == 0 ? Result::Ok : Result::Failed, hashed);
+                });
+        });
+}
+
+void PasswordHasher::Verify(std::optional<std::string> hash, std::string password, std::function<void(Result)> callback)
+{
+    Run(
+        callback,
+        [this, callback, hash = std::move(hash), password = std::move(password)]()
+        {
+            int result = -1;
+
+            if (hash)
+            {
+                result = crypto_pwhash_str_verify(hash->c_str(), password.c_str(), password.size());
+            }
+            else
+            {
+                (void) crypto_pwhash_str_verify(Dummy().c_str(), password.c_str(), password.size());
+            }
+
+            m_pool.Complete([callback, result]() { callback(result == 0 ? Result::Ok : Result::Failed); });
+        });
+}
+
+template<typename TFn>
+void PasswordHasher::Run(std::function<void(Result)> fail, TFn&& work)
+{
+    const auto deadline = std::chrono::steady_clock::now() + m_options.timeout;
+
+    const bool posted = m_pool.Post(
+        [this, fail, deadline, work = std::forward<TFn>(work)]() mutable
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Password hash timed out in queue";
+                return m_pool.Complete([fail]() { fail(Result::Timeout); });
+            }
+
+            work();
+        });
+
+    if (!posted)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Password hash queue is full";
+        fail(Result::Busy);
+    }
+}
+
+// Hashed with the same limits as new passwords, so verifying it costs what verifying a
+// real password does. Made on first use, on a worker thread.
+const std::string& PasswordHasher::Dummy()
+{
+    std::call_once(
+        m_dummy_once,
+        [this]()
+        {
+            m_dummy.resize(crypto_pwhash_STRBYTES);
+
+            if (crypto_pwhash_str(m_dummy.data(), "hunter2", 7, m_options.opslimit, m_options.memlimit) != 0)
+            {
+                BOOST_LOG_TRIVIAL(error) << "Failed to hash dummy password";
+            }
+        });
+
+    return m_dummy;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include "workerpool.hpp"
+
+namespace porla
+{
+    struct PasswordHasherOptions
+    {
+        // Memory used by all hashes running at once. The number of threads is this
+        // divided by the memory limit of a hash.
+        std::size_t               memory_budget = 2048ULL * 1024 * 1024;
+        // Limits for new hashes. Verifying uses the limits the hash was made with.
+        std::size_t               memlimit      = 1024ULL * 1024 * 1024;
+        unsigned long long        opslimit      = 4;
+        int                       queue_size    = 16;
+        // Hashes waiting longer than this fail without running.
+        std::chrono::milliseconds timeout       = std::chrono::seconds(30);
+    };
+
+    // Runs argon2id on a few threads, so logins queue behind each other instead of each
+    // taking a thread and a gigabyte of memory. Callbacks run on the io thread.
+    class PasswordHasher
+    {
+    public:
+        enum class Result
+        {
+            Ok,
+            Failed,
+            Busy,
+            Timeout
+        };
+
+        explicit PasswordHasher(boost::asio::io_context& io, const PasswordHasherOptions& options);
+
+        PasswordHasher(const PasswordHasher&) = delete;
+        PasswordHasher& operator=(const PasswordHasher&) = delete;
+
+        void Hash(std::string password, std::function<void(Result, std::string)> callback);
+
+        // Without a hash, a dummy hash is verified instead and the result is Failed, so
+        // unknown usernames take as long as known ones.
+        void Verify(std::optional<std::string> hash, std::string password, std::function<void(Result)> callback);
+
+        [[nodiscard]] WorkerPool::Stats GetStats() const { return m_pool.GetStats(); }
+        [[nodiscard]] int Threads() const { return m_threads; }
+
+        void Stop() { m_pool.Stop(); }
+
+    private:
+        template<typename TFn>
+        void Run(std::function<void(Result)> fail, TFn&& work);
+
+        const std::string& Dummy();
+
+        PasswordHasherOptions m_options;
+        int m_threads;
+        WorkerPool m_pool;
+
+        std::once_flag m_dummy_once;
+        std::string m_dummy;
+    };
+}
@@ -0,0 +1,285 @@
+#include "peeraggregates.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include <boost/log/trivial.hpp>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::PeerAggregates;
+
+PeerAggregates::PeerAggregates(boost::asio::io_context& io, porla::ISession& session, porla::PeerAggregatesOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(options)
+    , m_connected(0)
+    , m_disconnected(0)
+    , m_dirty(true)
+    , m_self(std::make_shared<PeerAggregates*>(this))
+{
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            if (auto sample = m_samples.find(hash); sample != m_samples.end())
+            {
+                m_disconnected += sample->second.size();
+                m_samples.erase(sample);
+                m_dirty = true;
+            }
+        });
+
+    Schedule();
+}
+
+PeerAggregates::~PeerAggregates()
+{
+    m_timer.cancel();
+    m_removedConnection.disconnect();
+}
+
+std::string PeerAggregates::Client(const std::string& client)
+{
+    // Versions follow the name after a space or slash, as in "qBittorrent 4.6.2" or
+    // "libtorrent/2.0.9".
+    for (std::size_t i = 1; i + 1 < client.size(); i++)
+    {
+        if ((client[i] == ' ' || client[i] == '/') && std::isdigit(static_cast<unsigned char>(client[i + 1])))
+        {
+            return client.substr(0, i);
+        }
+    }
+
+    return client.empty() ? "unknown" : client;
+}
+
+std::string PeerAggregates::Network(const lt::address& address)
+{
+    if (address.is_v4())
+    {
+        auto bytes = address.to_v4().to_bytes();
+        bytes[2] = bytes[3] = 0;
+
+        return lt::address_v4(bytes).to_string() + "/16";
+    }
+
+    auto bytes = address.to_v6().to_bytes();
+    std::fill(bytes.begin() + 4, bytes.end(), 0);
+
+    return lt::address_v6(bytes).to_string() + "/32";
+}
+
+const std::vector<PeerAggregates::Sample>* PeerAggregates::Sampled(const lt::info_hash_t& hash) const
+{
+    const auto samples = m_samples.find(hash);
+    return samples != m_samples.end() ? &samples->second : nullptr;
+}
+
+const PeerAggregates::Snapshot& PeerAggregates::Get() const
+{
+    if (!m_dirty)
+    {
+        return m_snapshot;
+    }
+
+    Snapshot snapshot{
+        .torrents_sampled = static_cast<int>(std::count_if(
+            m_samples.begin(),
+            m_samples.end(),
+            [](const auto& entry) { return !entry.second.empty(); })),
+        .connected        = m_connected,
+        .disconnected     = m_disconnected
+    };
+
+    std::map<lt::address, Peer> peers;
+
+    for (const auto& [hash, samples] : m_samples)
+    {
+        for (const auto& sample : samples)
+        {
+            const auto add = [&sample](Values& values)
+            {
+                values.peers++;
+                values.download_rate += sample.download_rate;
+                values.upload_rate   += sample.upload_rate;
+            };
+
+            add(snapshot.total);
+            add(snapshot.clients[Client(sample.client)]);
+            add(snapshot.networks[Network(sample.endpoint.address())]);
+
+            auto& peer = peers[sample.endpoint.address()];
+            peer.client         = sample.client;
+            peer.download_rate += sample.download_rate;
+            peer.upload_rate   += sample.upload_rate;
+            peer.torrents++;
+        }
+    }
+
+    // Only the largest groups are kept, by peers, and the rest summed as 'other'.
+    for (auto* group : { &snapshot.clients, &snapshot.networks })
+    {
+        if (group->size() <= m_options.max_labels)
+        {
+            continue;
+        }
+
+        std::vector<std::pair<std::string, Values>> sorted(group->begin(), group->end());
+
+        std::sort(
+            sorted.begin(),
+            sorted.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.second.peers > rhs.second.peers; });
+
+        group->clear();
+
+        for (std::size_t i = 0; i < sorted.size(); i++)
+        {
+            auto& values = (*group)[i < m_options.max_labels ? sorted[i].first : "other"];
+            values.peers         += sorted[i].second.peers;
+            values.download_rate += sorted[i].second.download_rate;
+            values.upload_rate   += sorted[i].second.upload_rate;
+        }
+    }
+
+    for (auto& [address, peer] : peers)
+    {
+        peer.ip = address.to_string();
+        snapshot.top.push_back(std::move(peer));
+    }
+
+    const auto by_upload = [](const Peer& lhs, const Peer& rhs)
+    {
+        if (lhs.upload_rate != rhs.upload_rate) return lhs.upload_rate > rhs.upload_rate;
+        return lhs.download_rate > rhs.download_rate;
+    };
+
+    const auto top = std::min(m_options.top, snapshot.top.size());
+    std::partial_sort(snapshot.top.begin(), snapshot.top.begin() + top, snapshot.top.end(), by_upload);
+    snapshot.top.resize(top);
+
+    m_snapshot = std::move(snapshot);
+    m_dirty = false;
+
+    return m_snapshot;
+}
+
+void PeerAggregates::Schedule()
+{
+    m_timer.expires_after(m_options.interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            Tick();
+            Schedule();
+        });
+}
+
+void PeerAggregates::Tick()
+{
+    const auto& statuses = m_session.TorrentStatuses();
+
+    // Torrents which lost their peers since they were sampled are cleared without asking.
+    for (auto& [hash, samples] : m_samples)
+    {
+        const auto status = statuses.find(hash);
+
+        if (!samples.empty() && (status == statuses.end() || status->second.num_peers == 0))
+        {
+            m_disconnected += samples.size();
+            samples.clear();
+            m_dirty = true;
+        }
+    }
+
+    // Picks up after the last torrent sampled, wrapping around.
+    auto status = statuses.upper_bound(m_cursor);
+    int sampled = 0;
+
+    for (std::size_t seen = 0; seen < statuses.size() && sampled < m_options.torrents_per_tick; seen++, ++status)
+    {
+        if (status == statuses.end())
+        {
+            status = statuses.begin();
+        }
+
+        m_cursor = status->first;
+
+        if (status->second.num_peers == 0)
+        {
+            continue;
+        }
+
+        sampled++;
+
+        m_session.PeerInfo(
+            status->first,
+            [self = std::weak_ptr<PeerAggregates*>(m_self), hash = status->first](porla::ISession::PeerInfoList peers)
+            {
+                const auto alive = self.lock();
+
+                if (!alive || peers == nullptr)
+                {
+                    return;
+                }
+
+                auto* aggregates = *alive;
+
+                std::vector<Sample> samples;
+                samples.reserve(peers->size());
+
+                for (const auto& peer : *peers)
+                {
+                    samples.push_back(Sample{
+                        .endpoint      = peer.ip,
+                        .client        = peer.client,
+                        .download_rate = peer.payload_down_speed,
+                        .upload_rate   = peer.payload_up_speed
+                    });
+                }
+
+                std::sort(
+                    samples.begin(),
+                    samples.end(),
+                    [](const Sample& lhs, const Sample& rhs) { return lhs.endpoint < rhs.endpoint; });
+
+                auto [entry, first] = aggregates->m_samples.try_emplace(hash);
+                auto& previous = entry->second;
+
+                // Endpoints in one sample and not the other connected or disconnected in
+                // between. Peers coming and going within one sweep are not seen, and the
+                // peers of a torrent sampled for the first time were already connected.
+                auto prev = previous.begin();
+                auto next = samples.begin();
+
+                while (!first && (prev != previous.end() || next != samples.end()))
+                {
+                    if (next == samples.end() || (prev != previous.end() && prev->endpoint < next->endpoint))
+                    {
+                        aggregates->m_disconnected++;
+                        ++prev;
+                    }
+                    else if (prev == previous.end() || next->endpoint < prev->endpoint)
+                    {
+                        aggregates->m_connected++;
+                        ++next;
+                    }
+                    else
+                    {
+                        ++prev;
+                        ++next;
+                    }
+                }
+
+                previous = std::move(samples);
+                aggregates->m_dirty = true;
+            });
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/socket.hpp>
+
+#include "query/pql.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct PeerAggregatesOptions
+    {
+        std::chrono::milliseconds interval          = std::chrono::milliseconds(1000);
+        // Torrents with peers sampled per interval, so a sweep over all of them is spread
+        // out and costs about the same at any session size.
+        int                       torrents_per_tick = 16;
+        // Peers and label values kept in a snapshot. The rest of the labels are counted as
+        // 'other'.
+        std::size_t               top               = 25;
+        std::size_t               max_labels        = 100;
+    };
+
+    // Peers of the whole session, summed by address, client and network. Each torrent with
+    // peers is sampled in turn through ISession::PeerInfo, so the figures are as old as the
+    // last sweep over the torrents. Comparing samples of a torrent counts the peers which
+    // connected and disconnected in between. The samples are what PQL peer aggregates test.
+    class PeerAggregates : public Query::PQL::Peers
+    {
+    public:
+        typedef Query::PQL::Peer Sample;
+
+        struct Values
+        {
+            std::int64_t peers         = 0;
+            std::int64_t download_rate = 0;
+            std::int64_t upload_rate   = 0;
+        };
+
+        struct Peer
+        {
+            std::string  ip;
+            std::string  client;
+            std::int64_t download_rate = 0;
+            std::int64_t upload_rate   = 0;
+            int          torrents      = 0;
+        };
+
+        struct Snapshot
+        {
+            // Clients without their version, and networks as /16 for IPv4 and /32 for IPv6.
+            std::map<std::string, Values> clients;
+            std::map<std::string, Values> networks;
+            // By upload rate, highest first.
+            std::vector<Peer>             top;
+            Values                        total;
+            int                           torrents_sampled = 0;
+            // Since startup.
+            std::uint64_t                 connected        = 0;
+            std::uint64_t                 disconnected     = 0;
+        };
+
+        explicit PeerAggregates(boost::asio::io_context& io, ISession& session, PeerAggregatesOptions options);
+        PeerAggregates(const PeerAggregates&) = delete;
+
+        ~PeerAggregates() override;
+
+        [[nodiscard]] const Snapshot& Get() const;
+        [[nodiscard]] const std::vector<Sample>* Sampled(const libtorrent::info_hash_t& hash) const override;
+
+        [[nodiscard]] static std::string Client(const std::string& client);
+        [[nodiscard]] static std::string Network(const libtorrent::address& address);
+
+    private:
+        void Schedule();
+        void Tick();
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        PeerAggregatesOptions m_options;
+
+        // Sorted by endpoint, so samples are compared by walking both.
+        std::map<libtorrent::info_hash_t, std::vector<Sample>> m_samples;
+        libtorrent::info_hash_t m_cursor;
+        std::uint64_t m_connected;
+        std::uint64_t m_disconnected;
+
+        mutable bool m_dirty;
+        mutable Snapshot m_snapshot;
+
+        // Held by the peer callbacks, which may be called after we are gone.
+        std::shared_ptr<PeerAggregates*> m_self;
+
+        porla::Utils::Connection m_removedConnection;
+    };
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace porla
+{
+    // A libtorrent peer class which the torrents of some categories belong to, so they
+    // share one rate limit instead of being limited one by one.
+    struct PeerClass
+    {
+        std::string              name;
+        std::vector<std::string> categories;
+        // In bytes per second. Zero is unlimited.
+        int                      download_limit    = 0;
+        int                      upload_limit      = 0;
+        // The share of bandwidth this class gets when classes compete for it, from 1 to 255.
+        int                      download_priority = 1;
+        int                      upload_priority   = 1;
+        // Peers in the class are unchoked whatever the unchoke slots limit.
+        bool                     ignore_unchoke_slots = false;
+    };
+}
@@ -0,0 +1,294 @@
+#include "piecestreams.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_info.hpp>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::PieceStreams;
+
+// Seconds of reading ahead of a stream that are downloaded first.
+static constexpr double ReadAhead = 30;
+static constexpr std::int64_t MinWindow = 8 * 1024 * 1024;
+static constexpr std::int64_t MaxWindow = 256 * 1024 * 1024;
+// Deadlines are this far apart until the rate of a stream is known.
+static constexpr int DeadlineSpacing = 500;
+// Readers waiting this long for a piece are let go, which ends their response.
+static constexpr std::chrono::seconds WaitTimeout(120);
+static constexpr std::chrono::seconds PruneInterval(5);
+
+PieceStreams::PieceStreams(boost::asio::io_context& io, porla::ISession& session)
+    : m_io(io)
+    , m_session(session)
+    , m_timer(io)
+{
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](const lt::info_hash_t& hash) { Removed(hash); });
+}
+
+PieceStreams::~PieceStreams()
+{
+    m_timer.cancel();
+    m_pieceFinishedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+porla::HttpContext::FileAvailability PieceStreams::Open(const lt::torrent_status& ts, lt::file_index_t index)
+{
+    const auto ti = ts.torrent_file.lock();
+
+    if (!ti)
+    {
+        return nullptr;
+    }
+
+    auto [torrent, inserted] = m_torrents.try_emplace(ts.info_hashes);
+
+    if (inserted)
+    {
+        // Blocks on the network thread, but only once for each torrent that is streamed.
+        // After that the pieces are kept up with from the piece alerts.
+        torrent->second.handle       = ts.handle;
+        torrent->second.piece_length = ti->piece_length();
+        torrent->second.have         = ts.handle.status(lt::torrent_handle::query_pieces).pieces;
+        torrent->second.deadlines.resize(ti->num_pieces(), false);
+        torrent->second.have.resize(ti->num_pieces(), false);
+
+        if (!m_pieceFinishedConnection.connected())
+        {
+            m_pieceFinishedConnection = m_session.OnPieceFinished(
+                [this](const lt::torrent_handle& th, lt::piece_index_t piece) { Finished(th, piece); });
+
+            Schedule();
+        }
+    }
+
+    const auto& files = ti->files();
+
+    auto stream = std::make_shared<Stream>(Stream{
+        .hash  = ts.info_hashes,
+        .start = files.file_offset(index),
+        .size  = files.file_size(index)
+    });
+
+    torrent->second.streams.push_back(stream);
+
+    return [this, stream](std::uint64_t offset, std::function<void(std::uint64_t)> done)
+    {
+        boost::asio::post(
+            m_io,
+            [this, stream, offset, done = std::move(done)]() mutable
+            {
+                Wait(stream, static_cast<std::int64_t>(offset), std::move(done));
+            });
+    };
+}
+
+std::uint64_t PieceStreams::Available(const Torrent& torrent, const Stream& stream, std::int64_t offset) const
+{
+    const auto end  = stream.start + stream.size;
+    const lt::piece_index_t last(static_cast<int>((end - 1) / torrent.piece_length));
+
+    lt::piece_index_t piece(static_cast<int>((stream.start + offset) / torrent.piece_length));
+
+    while (piece <= last && torrent.have[piece]) ++piece;
+
+    const auto available = std::min(end, static_cast<std::int64_t>(static_cast<int>(piece)) * torrent.piece_length);
+
+    return static_cast<std::uint64_t>(std::max<std::int64_t>(0, available - stream.start - offset));
+}
+
+void PieceStreams::Finished(const lt::torrent_handle& th, lt::piece_index_t piece)
+{
+    const auto torrent = m_torrents.find(th.info_hashes());
+
+    if (torrent == m_torrents.end())
+    {
+        return;
+    }
+
+    torrent->second.have.set_bit(piece);
+
+    auto& waiters = torrent->second.waiters;
+    std::vector<Waiter> ready;
+
+    for (auto it = waiters.begin(); it != waiters.end();)
+    {
+        if (it->piece == piece)
+        {
+            ready.push_back(std::move(*it));
+            it = waiters.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for (auto& waiter : ready)
+    {
+        waiter.done(Available(torrent->second, *waiter.stream, waiter.offset));
+    }
+}
+
+void PieceStreams::Prioritize(Torrent& torrent, Stream& stream, std::int64_t offset)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    if (stream.first < 0)
+    {
+        stream.first  = offset;
+        stream.opened = now;
+    }
+
+    const std::chrono::duration<double> elapsed = now - stream.opened;
+
+    // Bytes per second, once the stream has been read for long enough to tell.
+    const double rate = elapsed.count() >= 1 ? static_cast<double>(offset - stream.first) / elapsed.count() : 0;
+
+    const auto window   = std::clamp(static_cast<std::int64_t>(rate * ReadAhead), MinWindow, MaxWindow);
+    const auto position = stream.start + offset;
+    const auto end      = std::min(position + window, stream.start + stream.size);
+
+    const lt::piece_index_t first(static_cast<int>(position / torrent.piece_length));
+    const lt::piece_index_t last(static_cast<int>((end - 1) / torrent.piece_length));
+
+    int count = 0;
+
+    for (auto piece = first; piece <= last; ++piece)
+    {
+        if (torrent.have[piece] || torrent.deadlines[piece])
+        {
+            continue;
+        }
+
+        // When the stream gets to the piece, at the rate it is read.
+        const auto at = static_cast<std::int64_t>(static_cast<int>(piece)) * torrent.piece_length - position;
+        const int deadline = rate > 0
+            ? static_cast<int>(std::max<std::int64_t>(0, at) * 1000 / static_cast<std::int64_t>(rate))
+            : count * DeadlineSpacing;
+
+        torrent.handle.set_piece_deadline(piece, deadline);
+        torrent.deadlines.set_bit(piece);
+        count++;
+    }
+}
+
+void PieceStreams::Prune()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto torrent = m_torrents.begin(); torrent != m_torrents.end();)
+    {
+        auto& streams = torrent->second.streams;
+        auto& waiters = torrent->second.waiters;
+
+        streams.erase(
+            std::remove_if(streams.begin(), streams.end(), [](const auto& stream) { return stream.expired(); }),
+            streams.end());
+
+        std::vector<Waiter> expired;
+
+        for (auto it = waiters.begin(); it != waiters.end();)
+        {
+            if (now - it->since >= WaitTimeout)
+            {
+                expired.push_back(std::move(*it));
+                it = waiters.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        for (auto& waiter : expired)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Gave up waiting for piece " << static_cast<int>(waiter.piece) << " of a streamed file";
+            waiter.done(0);
+        }
+
+        // Waiters hold their stream, so none are left once the streams are gone.
+        if (streams.empty())
+        {
+            torrent->second.handle.clear_piece_deadlines();
+            torrent = m_torrents.erase(torrent);
+        }
+        else
+        {
+            ++torrent;
+        }
+    }
+
+    if (m_torrents.empty())
+    {
+        m_pieceFinishedConnection.disconnect();
+    }
+}
+
+void PieceStreams::Removed(const lt::info_hash_t& hash)
+{
+    const auto torrent = m_torrents.find(hash);
+
+    if (torrent == m_torrents.end())
+    {
+        return;
+    }
+
+    auto waiters = std::move(torrent->second.waiters);
+    m_torrents.erase(torrent);
+
+    for (auto& waiter : waiters)
+    {
+        waiter.done(0);
+    }
+}
+
+void PieceStreams::Schedule()
+{
+    m_timer.expires_after(PruneInterval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+
+            Prune();
+
+            if (!m_torrents.empty())
+            {
+                Schedule();
+            }
+        });
+}
+
+void PieceStreams::Wait(const std::shared_ptr<Stream>& stream, std::int64_t offset, std::function<void(std::uint64_t)> done)
+{
+    const auto torrent = m_torrents.find(stream->hash);
+
+    if (torrent == m_torrents.end() || offset >= stream->size)
+    {
+        return done(0);
+    }
+
+    Prioritize(torrent->second, *stream, offset);
+
+    const lt::piece_index_t piece(static_cast<int>((stream->start + offset) / torrent->second.piece_length));
+
+    if (!torrent->second.have[piece])
+    {
+        torrent->second.waiters.push_back(Waiter{
+            .piece  = piece,
+            .stream = stream,
+            .offset = offset,
+            .done   = std::move(done),
+            .since  = std::chrono::steady_clock::now()
+        });
+
+        return;
+    }
+
+    done(Available(torrent->second, *stream, offset));
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/bitfield.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "httpcontext.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Lets files of torrents which are still downloading be read as their pieces arrive.
+    // The pieces ahead of where each stream is read are given deadlines, over a window
+    // sized by how fast the stream is read, and readers of a missing piece wait for it to
+    // finish.
+    class PieceStreams
+    {
+    public:
+        explicit PieceStreams(boost::asio::io_context& io, ISession& session);
+
+        PieceStreams(const PieceStreams&) = delete;
+
+        ~PieceStreams();
+
+        // What of the file can be read, for HttpContext::WriteFile. Offsets are in the
+        // file. Returns nullptr when the torrent has no metadata yet.
+        HttpContext::FileAvailability Open(const libtorrent::torrent_status& ts, libtorrent::file_index_t index);
+
+    private:
+        struct Stream
+        {
+            libtorrent::info_hash_t               hash;
+            // Where the file starts in the torrent, and its size.
+            std::int64_t                          start;
+            std::int64_t                          size;
+            // Where it was first read, and when, for the rate it is read at.
+            std::int64_t                          first = -1;
+            std::chrono::steady_clock::time_point opened;
+        };
+
+        struct Waiter
+        {
+            libtorrent::piece_index_t             piece;
+            std::shared_ptr<Stream>               stream;
+            std::int64_t                          offset;
+            std::function<void(std::uint64_t)>    done;
+            std::chrono::steady_clock::time_point since;
+        };
+
+        struct Torrent
+        {
+            libtorrent::torrent_handle                         handle;
+            int                                                piece_length;
+            libtorrent::typed_bitfield<libtorrent::piece_index_t> have;
+            // Pieces given a deadline, which are not given one again.
+            libtorrent::typed_bitfield<libtorrent::piece_index_t> deadlines;
+            std::vector<std::weak_ptr<Stream>>                 streams;
+            std::vector<Waiter>                                waiters;
+        };
+
+        std::uint64_t Available(const Torrent& torrent, const Stream& stream, std::int64_t offset) const;
+        void Finished(const libtorrent::torrent_handle& th, libtorrent::piece_index_t piece);
+        void Prioritize(Torrent& torrent, Stream& stream, std::int64_t offset);
+        void Prune();
+        void Removed(const libtorrent::info_hash_t& hash);
+        void Schedule();
+        void Wait(const std::shared_ptr<Stream>& stream, std::int64_t offset, std::function<void(std::uint64_t)> done);
+
+        boost::asio::io_context& m_io;
+        ISession& m_session;
+        boost::asio::steady_timer m_timer;
+
+        std::map<libtorrent::info_hash_t, Torrent> m_torrents;
+
+        // Only connected while there are streams, so piece alerts are not asked for otherwise.
+        porla::Utils::Connection m_pieceFinishedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
@@ -0,0 +1,184 @@
+#include "profilehandler.hpp"
+
+#include <charconv>
+
+#include <nlohmann/json.hpp>
+
+#include "profiler.hpp"
+#include "session.hpp"
+
+namespace http = boost::beast::http;
+
+using porla::ProfileHandler;
+
+static constexpr int MaxSeconds = 300;
+
+static void WriteError(const std::shared_ptr<porla::HttpContext>& ctx, http::status status, const std::string& body)
+{
+    http::response<http::string_body> res{status, ctx->Request().version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "text/plain");
+    res.keep_alive(ctx->Request().keep_alive());
+    res.body() = body;
+    res.prepare_payload();
+
+    ctx->Write(std::move(res));
+}
+
+static void WriteProfile(const std::shared_ptr<porla::HttpContext>& ctx, const std::string& filename, std::string profile)
+{
+    http::response<http::string_body> res{http::status::ok, ctx->Request().version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "application/octet-stream");
+    res.set(http::field::content_disposition, "attachment; filename=\"" + filename + "\"");
+    res.keep_alive(ctx->Request().keep_alive());
+    res.body() = std::move(profile);
+    res.prepare_payload();
+
+    ctx->Write(std::move(res));
+}
+
+// Returns fallback if the parameter is missing, and -1 if it is not a number.
+static int IntParam(const std::shared_ptr<porla::HttpContext>& ctx, const std::string& name, int fallback)
+{
+    const auto& query = ctx->RequestUri().query;
+    const auto param = query.find(name);
+
+    if (param == query.end())
+    {
+        return fallback;
+    }
+
+    int value = -1;
+    const auto& str = param->second;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+
+    return ec == std::errc() && end == str.data() + str.size() ? value : -1;
+}
+
+static nlohmann::json Timings(const std::map<std::string, porla::SessionInstrumentation::Timing>& timings, const std::map<std::string, porla::SessionInstrumentation::Timing>* since)
+{
+    auto result = nlohmann::json::object();
+
+    for (const auto& [name, timing] : timings)
+    {
+        auto count   = timing.count;
+        auto seconds = timing.seconds;
+
+        if (since != nullptr)
+        {
+            if (const auto before = since->find(name); before != since->end())
+            {
+                count   -= before->second.count;
+                seconds -= before->second.seconds;
+            }
+        }
+
+        if (count == 0)
+        {
+            continue;
+        }
+
+        result[name] = {
+            {"count", count},
+            {"seconds", seconds},
+            {"average", seconds / static_cast<double>(count)}
+        };
+    }
+
+    return result;
+}
+
+static void WriteTimings(const std::shared_ptr<porla::HttpContext>& ctx, const porla::SessionInstrumentation& now, const porla::SessionInstrumentation* since)
+{
+    const auto& lag = now.loop_lag;
+
+    ctx->WriteJson({
+        {"alerts", Timings(now.alerts, since != nullptr ? &since->alerts : nullptr)},
+        {"signals", Timings(now.signals, since != nullptr ? &since->signals : nullptr)},
+        // The lag is only kept as a histogram since startup.
+        {"loop_lag", {
+            {"count", lag.Count()},
+            {"p50", lag.Quantile(0.5)},
+            {"p99", lag.Quantile(0.99)}
+        }}
+    });
+}
+
+ProfileHandler::ProfileHandler(Kind kind, boost::asio::io_context& io, porla::Profiler& profiler, porla::ISession& session)
+    : m_kind(kind)
+    , m_io(io)
+    , m_profiler(profiler)
+    , m_session(session)
+{
+}
+
+void ProfileHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    if (m_kind == Kind::Heap)
+    {
+        std::string profile;
+        std::string error;
+
+        if (!Profiler::Heap(profile, error))
+        {
+            return WriteError(ctx, http::status::not_implemented, error);
+        }
+
+        return WriteProfile(ctx, "heap.prof", std::move(profile));
+    }
+
+    const int seconds = IntParam(ctx, "seconds", m_kind == Kind::Cpu ? 30 : 0);
+
+    if (seconds < 0 || seconds > MaxSeconds || (m_kind == Kind::Cpu && seconds == 0))
+    {
+        return WriteError(ctx, http::status::bad_request, "'seconds' is from 1 to " + std::to_string(MaxSeconds));
+    }
+
+    if (m_kind == Kind::Cpu)
+    {
+        const int hz = IntParam(ctx, "hz", 100);
+
+        if (hz < 1 || hz > 1000)
+        {
+            return WriteError(ctx, http::status::bad_request, "'hz' is from 1 to 1000");
+        }
+
+        const bool started = m_profiler.Cpu(
+            std::chrono::seconds(seconds),
+            hz,
+            [ctx](std::string profile) { WriteProfile(ctx, "cpu.pb.gz", std::move(profile)); });
+
+        if (!started)
+        {
+            return WriteError(ctx, http::status::conflict, "A CPU profile is already being taken");
+        }
+
+        return;
+    }
+
+    const auto before = m_session.Instrumentation();
+
+    if (!before)
+    {
+        return WriteError(ctx, http::status::not_found, "The session has no timings");
+    }
+
+    if (seconds == 0)
+    {
+        return WriteTimings(ctx, *before, nullptr);
+    }
+
+    auto timer = std::make_shared<boost::asio::steady_timer>(m_io, std::chrono::seconds(seconds));
+
+    timer->async_wait(
+        [ctx, timer, before, &session = m_session](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+
+            if (const auto now = session.Instrumentation())
+            {
+                WriteTimings(ctx, *now, &*before);
+            }
+        });
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+
+#include <boost/asio.hpp>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    class ISession;
+    class Profiler;
+
+    // The debug endpoints for profiling a running node. Cpu takes a profile of seconds long
+    // at hz samples per second, Heap dumps the allocator's heap profile, and Timings lists
+    // the time spent handling each alert and signal on the io thread, since startup or
+    // over the next seconds.
+    class ProfileHandler
+    {
+    public:
+        enum class Kind
+        {
+            Cpu,
+            Heap,
+            Timings
+        };
+
+        explicit ProfileHandler(Kind kind, boost::asio::io_context& io, Profiler& profiler, ISession& session);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        Kind m_kind;
+        boost::asio::io_context& m_io;
+        Profiler& m_profiler;
+        ISession& m_session;
+    };
+}
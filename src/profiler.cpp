@@ -0,0 +1,382 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "utils/gzip.hpp"
+#include "utils/pprof.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Profiler;
+
+namespace
+{
+    // Samples past these are counted as dropped. Deeper stacks are cut at their callers.
+    constexpr std::size_t MaxSamples = 16384;
+    constexpr int MaxDepth = 64;
+    // The signal handler, and the trampoline the kernel returns from it through.
+    constexpr int SkipFrames = 2;
+
+    struct Sample
+    {
+        pid_t tid;
+        int   depth;
+        void* frames[MaxDepth];
+    };
+
+    // What the signal handler writes to, with no locks or allocations. A sample slot is
+    // claimed with next, and inflight lets the buffer be read once every handler is done.
+    std::atomic<bool>        g_running{false};
+    std::atomic<Sample*>     g_samples{nullptr};
+    std::atomic<std::size_t> g_next{0};
+    std::atomic<int>         g_inflight{0};
+    std::unique_ptr<Sample[]> g_buffer;
+    bool                     g_installed = false;
+
+    void OnProfileSignal(int)
+    {
+        const int saved = errno;
+
+        g_inflight.fetch_add(1);
+
+        if (auto samples = g_samples.load(); samples != nullptr)
+        {
+            if (const auto index = g_next.fetch_add(1); index < MaxSamples)
+            {
+                samples[index].tid   = static_cast<pid_t>(syscall(SYS_gettid));
+                samples[index].depth = backtrace(samples[index].frames, MaxDepth);
+            }
+        }
+
+        g_inflight.fetch_sub(1);
+
+        errno = saved;
+    }
+
+    std::string Hex(const unsigned char* data, std::size_t size)
+    {
+        static constexpr char Digits[] = "0123456789abcdef";
+
+        std::string out;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            out.push_back(Digits[data[i] >> 4]);
+            out.push_back(Digits[data[i] & 0x0f]);
+        }
+
+        return out;
+    }
+
+    std::string BuildId(const dl_phdr_info* info)
+    {
+        for (int i = 0; i < info->dlpi_phnum; i++)
+        {
+            const auto& phdr = info->dlpi_phdr[i];
+            if (phdr.p_type != PT_NOTE) continue;
+
+            auto note = reinterpret_cast<const unsigned char*>(info->dlpi_addr + phdr.p_vaddr);
+            const auto end = note + phdr.p_memsz;
+
+            while (note + sizeof(ElfW(Nhdr)) <= end)
+            {
+                const auto header = reinterpret_cast<const ElfW(Nhdr)*>(note);
+                const auto name = note + sizeof(ElfW(Nhdr));
+                const auto desc = name + ((header->n_namesz + 3) & ~3u);
+
+                if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 && std::memcmp(name, "GNU", 4) == 0)
+                {
+                    return Hex(desc, header->n_descsz);
+                }
+
+                note = desc + ((header->n_descsz + 3) & ~3u);
+            }
+        }
+
+        return "";
+    }
+
+    // The executable segments of every loaded object, for pprof to symbolize with.
+    void AddMappings(porla::Utils::Pprof& profile)
+    {
+        std::error_code ec;
+        const auto exe = fs::read_symlink("/proc/self/exe", ec).string();
+
+        std::pair<porla::Utils::Pprof*, const std::string*> args{&profile, &exe};
+
+        dl_iterate_phdr(
+            [](dl_phdr_info* info, std::size_t, void* data)
+            {
+                auto args = static_cast<std::pair<porla::Utils::Pprof*, const std::string*>*>(data);
+                const std::string file = info->dlpi_name != nullptr && info->dlpi_name[0] != '\0' ? info->dlpi_name : *args->second;
+                const auto page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+
+                std::string build_id;
+
+                for (int i = 0; i < info->dlpi_phnum; i++)
+                {
+                    const auto& phdr = info->dlpi_phdr[i];
+                    if (phdr.p_type != PT_LOAD || (phdr.p_flags & PF_X) == 0) continue;
+
+                    if (build_id.empty()) build_id = BuildId(info);
+
+                    const auto start = info->dlpi_addr + phdr.p_vaddr;
+
+                    args->first->AddMapping(
+                        start & ~(page - 1),
+                        start + phdr.p_memsz,
+                        phdr.p_offset & ~(page - 1),
+                        file,
+                        build_id);
+                }
+
+                return 0;
+            },
+            &args);
+    }
+
+    std::string Symbol(std::uint64_t address)
+    {
+        Dl_info info{};
+
+        if (dladdr(reinterpret_cast<void*>(address), &info) == 0 || info.dli_sname == nullptr)
+        {
+            return "";
+        }
+
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+
+        std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+        std::free(demangled);
+
+        return name;
+    }
+
+    std::string ThreadName(pid_t tid)
+    {
+        std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+
+        std::string name;
+        std::getline(comm, name);
+
+        // Threads which have ended since their samples are only known by id.
+        return name;
+    }
+}
+
+Profiler::Profiler(boost::asio::io_context& io)
+    : m_timer(io)
+{
+}
+
+Profiler::~Profiler()
+{
+    if (m_done)
+    {
+        m_done = nullptr;
+        Stop();
+    }
+}
+
+bool Profiler::Cpu(std::chrono::seconds duration, int hz, std::function<void(std::string)> done)
+{
+    if (g_running.exchange(true))
+    {
+        return false;
+    }
+
+    if (!g_installed)
+    {
+        // backtrace loads the unwinder the first time it is called, which is not safe to do
+        // in a signal handler.
+        void* frames[1];
+        backtrace(frames, 1);
+
+        struct sigaction action{};
+        action.sa_handler = OnProfileSignal;
+        action.sa_flags   = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, nullptr);
+
+        // Kept once installed, since a SIGPROF still pending when the timer is stopped would
+        // otherwise end the process.
+        g_installed = true;
+    }
+
+    m_done    = std::move(done);
+    m_hz      = std::clamp(hz, 1, 1000);
+    m_started = std::chrono::system_clock::now();
+
+    g_buffer = std::make_unique<Sample[]>(MaxSamples);
+    g_next   = 0;
+    g_samples.store(g_buffer.get());
+
+    itimerval timer{};
+    timer.it_interval.tv_usec = 1000000 / m_hz;
+    timer.it_value            = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    BOOST_LOG_TRIVIAL(info) << "Taking a CPU profile for " << duration.count() << "s at " << m_hz << " Hz";
+
+    m_timer.expires_after(duration);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+            Stop();
+        });
+
+    return true;
+}
+
+void Profiler::Stop()
+{
+    itimerval off{};
+    setitimer(ITIMER_PROF, &off, nullptr);
+
+    m_timer.cancel();
+
+    g_samples.store(nullptr);
+    while (g_inflight.load() > 0) std::this_thread::yield();
+
+    const auto taken = std::min(g_next.load(), MaxSamples);
+    const auto buffer = std::move(g_buffer);
+
+    g_running = false;
+
+    if (!m_done)
+    {
+        return;
+    }
+
+    const auto done = std::move(m_done);
+    m_done = nullptr;
+
+    if (g_next.load() > MaxSamples)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Dropped " << g_next.load() - MaxSamples << " CPU profile samples";
+    }
+
+    const std::int64_t period = 1000000000 / m_hz;
+
+    porla::Utils::Pprof profile({{"samples", "count"}, {"cpu", "nanoseconds"}}, {"cpu", "nanoseconds"}, period);
+    AddMappings(profile);
+
+    // Samples of the same stack on the same thread are counted together.
+    std::map<std::pair<pid_t, std::vector<std::uint64_t>>, std::int64_t> stacks;
+    std::set<std::uint64_t> addresses;
+
+    for (std::size_t i = 0; i < taken; i++)
+    {
+        const auto& sample = buffer[i];
+
+        std::vector<std::uint64_t> stack;
+
+        for (int frame = SkipFrames; frame < sample.depth; frame++)
+        {
+            // Callers are at their return address, which is the next instruction.
+            auto address = reinterpret_cast<std::uint64_t>(sample.frames[frame]);
+            if (frame > SkipFrames) address--;
+
+            stack.push_back(address);
+            addresses.insert(address);
+        }
+
+        stacks[{sample.tid, std::move(stack)}]++;
+    }
+
+    for (const auto address : addresses)
+    {
+        if (auto name = Symbol(address); !name.empty())
+        {
+            profile.AddFunction(address, name);
+        }
+    }
+
+    std::map<pid_t, std::string> threads;
+
+    for (const auto& [key, count] : stacks)
+    {
+        const auto& [tid, stack] = key;
+
+        auto thread = threads.find(tid);
+        if (thread == threads.end()) thread = threads.emplace(tid, ThreadName(tid)).first;
+
+        std::vector<porla::Utils::Pprof::Label> labels{{.key = "tid", .num = tid}};
+        if (!thread->second.empty()) labels.push_back({.key = "thread", .str = thread->second});
+
+        profile.AddSample(stack, {count, count * period}, labels);
+    }
+
+    const auto now = std::chrono::system_clock::now();
+
+    done(porla::Utils::Gzip::Compress(profile.Encode(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(m_started.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_started).count())));
+}
+
+bool Profiler::Heap(std::string& profile, std::string& error)
+{
+    typedef int (*Mallctl)(const char*, void*, std::size_t*, void*, std::size_t);
+
+    // Found at run time, so porla built against glibc's malloc can be started with jemalloc
+    // preloaded.
+    const auto mallctl = reinterpret_cast<Mallctl>(dlsym(RTLD_DEFAULT, "mallctl"));
+
+    if (mallctl == nullptr)
+    {
+        error = "Heap profiles need jemalloc, for example with LD_PRELOAD=libjemalloc.so";
+        return false;
+    }
+
+    bool enabled = false;
+    std::size_t size = sizeof(enabled);
+
+    if (mallctl("opt.prof", &enabled, &size, nullptr, 0) != 0 || !enabled)
+    {
+        error = "jemalloc profiling is not enabled, start porla with MALLOC_CONF=prof:true";
+        return false;
+    }
+
+    const auto path = fs::temp_directory_path() / ("porla-heap-" + std::to_string(getpid()) + ".prof");
+    const char* filename = path.c_str();
+
+    if (mallctl("prof.dump", nullptr, nullptr, &filename, sizeof(filename)) != 0)
+    {
+        error = "jemalloc failed to write the heap profile";
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    profile = ss.str();
+
+    std::error_code ec;
+    fs::remove(path, ec);
+
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <boost/asio.hpp>
+
+namespace porla
+{
+    // Takes profiles of the running process, without attaching a profiler to it. CPU
+    // profiles sample the stacks of every thread on SIGPROF, as it uses CPU time, and heap
+    // profiles come from jemalloc when porla runs with it and its profiling is enabled.
+    // Both are in formats `go tool pprof` reads.
+    class Profiler
+    {
+    public:
+        explicit Profiler(boost::asio::io_context& io);
+
+        Profiler(const Profiler&) = delete;
+
+        ~Profiler();
+
+        // Samples at hz for duration, and calls done with the gzipped pprof profile on the
+        // io_context. Returns false, without calling done, if a profile is already being
+        // taken.
+        bool Cpu(std::chrono::seconds duration, int hz, std::function<void(std::string)> done);
+
+        // Returns false with the reason in error if the allocator cannot profile.
+        static bool Heap(std::string& profile, std::string& error);
+
+    private:
+        void Stop();
+
+        boost::asio::steady_timer m_timer;
+        std::function<void(std::string)> m_done;
+        std::chrono::system_clock::time_point m_started;
+        int m_hz = 0;
+    };
+}
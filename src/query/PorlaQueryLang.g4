@@ -11,6 +11,7 @@ OPER_GT       : '>';
 OPER_GTE      : '>=';
 OPER_LT       : '<';
 OPER_LTE      : '<=';
+OPER_MATCHES  : 'matches';
 
 WHITESPACE    : [ \t\r\n]+ -> skip;
 INT           : '-'? [0-9]+ ;
@@ -59,6 +60,7 @@ operator
     | OPER_GTE
     | OPER_LT
     | OPER_LTE
+    | OPER_MATCHES
     ;
 
 reference: ID;
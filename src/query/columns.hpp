@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "../symbol.hpp"
+
+namespace porla::Query
+{
+    // A structure-of-arrays copy of the numeric torrent status fields. Row i of every
+    // column belongs to hashes[i].
+    struct Columns
+    {
+        std::vector<libtorrent::info_hash_t> hashes;
+        std::vector<std::int64_t>            added_time;
+        std::vector<std::int64_t>            download_rate;
+        std::vector<std::uint64_t>           flags;
+        std::vector<std::uint8_t>            moving_storage;
+        std::vector<float>                   progress;
+        std::vector<int>                     queue_position;
+        std::vector<double>                  ratio;
+        std::vector<std::int64_t>            size; // -1 without metadata
+        std::vector<std::uint8_t>            state;
+        std::vector<std::int64_t>            upload_rate;
+
+        // One bit per tag, tag_words words per row, so tag predicates are mask tests. Bits
+        // are handed out as tags are first seen and are not reused, which is fine for the
+        // small set of tags torrents share.
+        std::vector<std::uint64_t>                tags;
+        std::size_t                               tag_words = 0;
+        std::unordered_map<Symbol, std::uint32_t> tag_bits;
+
+        [[nodiscard]] std::size_t Size() const { return hashes.size(); }
+
+        [[nodiscard]] const std::uint64_t* TagRow(std::size_t row) const { return tags.data() + row * tag_words; }
+    };
+
+    // One bit per row, 64 rows per word.
+    typedef std::vector<std::uint64_t> Bitmap;
+}
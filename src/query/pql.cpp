@@ -2,22 +2,37 @@
 
 #include <antlr4-runtime.h>
 
-#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
 #include <utility>
 #include <variant>
+#include <vector>
+
+#include <libtorrent/hex.hpp>
+#include <libtorrent/torrent_info.hpp>
 
 #include "_aux/PorlaQueryLangBaseVisitor.h"
 #include "_aux/PorlaQueryLangLexer.h"
 #include "_aux/PorlaQueryLangParser.h"
 
+#include "regex.hpp"
+
 #include "../torrentclientdata.hpp"
+#include "../utils/lrucache.hpp"
 #include "../utils/ratio.hpp"
 
 using porla::Query::PQL;
 using porla::Query::QueryError;
 
-typedef std::function<bool(const libtorrent::torrent_status&)> TorrentStatusFilter;
-typedef std::variant<std::int64_t, float, std::string>         ValueVariant;
+typedef std::variant<std::int64_t, float, std::string> ValueVariant;
 
 class ExceptionErrorListener : public antlr4::BaseErrorListener
 {
@@ -48,12 +63,105 @@ enum class Oper
     EQ,
     GT,
     GTE,
+    IN,
     LT,
-    LTE
+    LTE,
+    MATCHES
+};
+
+// Everything a predicate can test. Resolved from the reference name at compile time so
+// evaluation is a single switch.
+enum class Field
+{
+    AddedTime,
+    Category,
+    DownloadRate,
+    DownloadRateAvg,
+    EtaAvg,
+    FileName,
+    FilePath,
+    FileSize,
+    Files,
+    FlagDownloading,
+    FlagFinished,
+    FlagMetadataPending,
+    FlagMoving,
+    FlagPaused,
+    FlagSeeding,
+    InfoHash,
+    Name,
+    PeerClient,
+    PeerDownloadRate,
+    PeerIp,
+    PeerUploadRate,
+    Peers,
+    Progress,
+    Ratio,
+    SavePath,
+    SeedingTime,
+    Size,
+    Tags,
+    UploadRate,
+    UploadRateAvg
+};
+
+struct Aggregate;
+
+struct Predicate
+{
+    Field        field;
+    Oper         oper;
+    std::int64_t int_value;
+    double       float_value;
+    std::string  string_value;
+
+    // The literals of an IN predicate, hashed so membership is a single lookup.
+    std::unordered_set<std::string> string_set;
+
+    // For tags, that the torrent has every tag of string_set rather than any of them,
+    // from an and-chain of tag tests.
+    bool all = false;
+
+    // The pattern of a matches predicate, compiled once with the query.
+    std::shared_ptr<const porla::Query::Regex> regex;
+
+    // For files and peers, what is counted and compared with int_value.
+    std::shared_ptr<const Aggregate> aggregate;
+};
+
+// The files or peers of a torrent passing every test in where, all of them or those of
+// the busiest subnet. any() is the count compared with >= 1, and stops at the first.
+struct Aggregate
+{
+    enum class Kind
+    {
+        Any,
+        Count,
+        MaxPerSubnet
+    };
+
+    Kind                   kind;
+    std::vector<Predicate> where;
+};
+
+// A flat program over a single boolean register. And/or compile to conditional jumps, so
+// evaluation short-circuits without any recursion or indirect calls.
+struct Instruction
+{
+    enum class Code : std::uint8_t
+    {
+        Test,
+        Not,
+        JumpIfFalse,
+        JumpIfTrue
+    };
+
+    Code          code;
+    std::uint32_t arg;
 };
 
 template<typename TLeft, typename TRight>
-bool Compare(TLeft const& lhs, TRight const& rhs, Oper oper)
+static bool Compare(TLeft const& lhs, TRight const& rhs, Oper oper)
 {
     switch (oper)
     {
@@ -63,371 +171,2096 @@ bool Compare(TLeft const& lhs, TRight const& rhs, Oper oper)
         case Oper::GT: return lhs > rhs;
         case Oper::GTE: return lhs >= rhs;
         case Oper::CONTAINS:
+        case Oper::IN:
+        case Oper::MATCHES:
             break;
     }
 
-    throw QueryError("Invalid operator", -1);
+    return false;
 }
 
-class Visitor : public PorlaQueryLangBaseVisitor
+static bool CompareString(const std::string& lhs, const Predicate& p)
 {
-public:
-    antlrcpp::Any visitAndExpression(PorlaQueryLangParser::AndExpressionContext* context) override
+    switch (p.oper)
+    {
+    case Oper::CONTAINS: return lhs.find(p.string_value) != std::string::npos;
+    case Oper::IN:       return p.string_set.contains(lhs);
+    case Oper::MATCHES:  return p.regex->Search(lhs);
+    default:             return Compare(lhs, p.string_value, p.oper);
+    }
+}
+
+// Compares a hash to lower case hex digit by digit, since formatting the hash for every
+// torrent would allocate.
+template<typename THash>
+static bool HexEquals(const THash& hash, const std::string& hex)
+{
+    static constexpr char Digits[] = "0123456789abcdef";
+
+    if (hex.size() != hash.size() * 2)
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < hash.size(); i++)
     {
-        std::vector<TorrentStatusFilter> filters;
+        const auto b = static_cast<std::uint8_t>(hash[i]);
 
-        for (const auto expression : context->expression())
+        if (hex[i * 2] != Digits[b >> 4] || hex[i * 2 + 1] != Digits[b & 0xf])
         {
-            filters.emplace_back(std::any_cast<TorrentStatusFilter>(this->visit(expression)));
+            return false;
         }
+    }
 
-        return TorrentStatusFilter(
-            [filters](const libtorrent::torrent_status& ts)
-            {
-                return std::all_of(
-                    filters.begin(),
-                    filters.end(),
-                    [&ts](const auto& f) { return f(ts); });
-            });
+    return true;
+}
+
+// Like CompareString for the text of files and peers, which is not always a string.
+static bool CompareText(std::string_view lhs, const Predicate& p)
+{
+    switch (p.oper)
+    {
+    case Oper::CONTAINS: return lhs.find(p.string_value) != std::string_view::npos;
+    case Oper::MATCHES:  return p.regex->Search(lhs);
+    default:             return Compare(lhs, std::string_view(p.string_value), p.oper);
     }
+}
 
-    antlrcpp::Any visitFilter(PorlaQueryLangParser::FilterContext* context) override
+// A /24 for IPv4 and a /64 for IPv6.
+static std::pair<bool, std::uint64_t> Subnet(const lt::address& address)
+{
+    if (address.is_v4())
     {
-        return this->visit(context->expression());
+        return { false, address.to_v4().to_uint() >> 8 };
     }
 
-    antlrcpp::Any visitFlag(PorlaQueryLangParser::FlagContext* context) override
+    const auto bytes = address.to_v6().to_bytes();
+    std::uint64_t prefix = 0;
+
+    for (std::size_t i = 0; i < 8; i++) { prefix = (prefix << 8) | bytes[i]; }
+
+    return { true, prefix };
+}
+
+// Walks the file storage of the metadata, which libtorrent keeps in memory. Torrents
+// without metadata have no files to count.
+static bool EvaluateFiles(const Predicate& p, const lt::torrent_status& ts)
+{
+    const auto torrent_file = ts.torrent_file.lock();
+
+    if (torrent_file == nullptr)
+    {
+        return false;
+    }
+
+    const auto& aggregate = *p.aggregate;
+    const auto& files = torrent_file->files();
+
+    std::int64_t count = 0;
+
+    for (const auto index : files.file_range())
     {
-        static const std::map<std::string, TorrentStatusFilter> flags_map =
+        // Padding aligns files to pieces, and is not one of the files of the torrent.
+        if (files.pad_file_at(index))
         {
-            {"downloading", [](const auto& ts) { return ts.state == lt::torrent_status::downloading; }},
-            {"finished", [](const auto& ts) { return ts.state == lt::torrent_status::finished; }},
-            {"moving", [](const auto& ts) { return ts.moving_storage; }},
-            {"paused", [](const auto& ts) { return (ts.flags & lt::torrent_flags::paused) == lt::torrent_flags::paused; }},
-            {"seeding", [](const auto& ts) { return ts.state == lt::torrent_status::seeding; }}
-        };
+            continue;
+        }
 
-        const auto reference = std::any_cast<std::string>(this->visit(context->reference()));
-        const auto flag_ref  = flags_map.find(reference);
+        const bool passes = std::all_of(
+            aggregate.where.begin(),
+            aggregate.where.end(),
+            [&](const Predicate& w)
+            {
+                switch (w.field)
+                {
+                case Field::FileName: return CompareText(files.file_name(index), w);
+                case Field::FilePath: return CompareText(files.file_path(index), w);
+                case Field::FileSize: return Compare(files.file_size(index), w.int_value, w.oper);
+                default:              return false;
+                }
+            });
 
-        if (flag_ref != flags_map.end())
+        if (!passes)
         {
-            return flag_ref->second;
+            continue;
         }
 
-        throw QueryError("Invalid flag '" + reference + "'", context->getStart()->getCharPositionInLine());
+        if (aggregate.kind == Aggregate::Kind::Any)
+        {
+            return true;
+        }
+
+        count++;
     }
 
-    antlrcpp::Any visitFlagExpression(PorlaQueryLangParser::FlagExpressionContext* context) override
+    return aggregate.kind != Aggregate::Kind::Any && Compare(count, p.int_value, p.oper);
+}
+
+static bool EvaluatePeers(const Predicate& p, const lt::torrent_status& ts, const PQL::Peers* sampled)
+{
+    const auto peers = sampled != nullptr ? sampled->Sampled(ts.info_hashes) : nullptr;
+
+    if (peers == nullptr)
     {
-        return this->visit(context->flag());
+        return false;
     }
 
-    antlrcpp::Any visitNotFlagExpression(PorlaQueryLangParser::NotFlagExpressionContext* context) override
+    const auto& aggregate = *p.aggregate;
+
+    std::int64_t count = 0;
+    std::vector<std::pair<bool, std::uint64_t>> subnets;
+
+    for (const auto& peer : *peers)
     {
-        const auto flag = std::any_cast<TorrentStatusFilter>(this->visit(context->flag()));
-        return TorrentStatusFilter(
-            [flag](const lt::torrent_status& ts)
+        const bool passes = std::all_of(
+            aggregate.where.begin(),
+            aggregate.where.end(),
+            [&](const Predicate& w)
             {
-                return !flag(ts);
+                switch (w.field)
+                {
+                case Field::PeerClient:       return CompareText(peer.client, w);
+                case Field::PeerDownloadRate: return Compare(static_cast<std::int64_t>(peer.download_rate), w.int_value, w.oper);
+                case Field::PeerIp:           return CompareText(peer.endpoint.address().to_string(), w);
+                case Field::PeerUploadRate:   return Compare(static_cast<std::int64_t>(peer.upload_rate), w.int_value, w.oper);
+                default:                      return false;
+                }
             });
+
+        if (!passes)
+        {
+            continue;
+        }
+
+        if (aggregate.kind == Aggregate::Kind::Any)
+        {
+            return true;
+        }
+
+        if (aggregate.kind == Aggregate::Kind::MaxPerSubnet)
+        {
+            subnets.push_back(Subnet(peer.endpoint.address()));
+        }
+
+        count++;
     }
 
-    antlrcpp::Any visitOperator(PorlaQueryLangParser::OperatorContext* context) override
+    if (aggregate.kind == Aggregate::Kind::MaxPerSubnet)
     {
-        if (context->OPER_CONTAINS()) return Oper::CONTAINS;
-        if (context->OPER_EQ()) return Oper::EQ;
-        if (context->OPER_GT()) return Oper::GT;
-        if (context->OPER_GTE()) return Oper::GTE;
-        if (context->OPER_LT()) return Oper::LT;
-        if (context->OPER_LTE()) return Oper::LTE;
-        throw QueryError("Invalid operator: " + context->getText());
+        // The longest run of one subnet.
+        std::sort(subnets.begin(), subnets.end());
+
+        count = 0;
+
+        for (std::size_t i = 0, run = 0; i < subnets.size(); i++)
+        {
+            run = i > 0 && subnets[i] == subnets[i - 1] ? run + 1 : 1;
+            count = std::max(count, static_cast<std::int64_t>(run));
+        }
     }
 
-    antlrcpp::Any visitOperatorPredicate(PorlaQueryLangParser::OperatorPredicateContext* context) override
+    return aggregate.kind != Aggregate::Kind::Any && Compare(count, p.int_value, p.oper);
+}
+
+// Sets one bit per row where pred holds for the row index. The inner loop has no
+// branches, so it vectorizes.
+template<typename TPred>
+static void SelectRows(std::size_t rows, porla::Query::Bitmap& selection, TPred pred)
+{
+    selection.assign((rows + 63) / 64, 0);
+
+    for (std::size_t word = 0; word < selection.size(); word++)
     {
-        typedef std::function<bool(Oper oper, const ValueVariant&, const lt::torrent_status&)> OperFunc;
+        const std::size_t base  = word * 64;
+        const std::size_t count = std::min<std::size_t>(64, rows - base);
 
-        struct OperRef
-        {
-            OperFunc func;
-        };
+        std::uint64_t bits = 0;
 
-        static const std::map<std::string, OperRef> oper_map =
+        for (std::size_t bit = 0; bit < count; bit++)
         {
-            {"age", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto age = std::get_if<std::int64_t>(&val))
-                    {
-                        const time_t torrent_age = time(nullptr) - ts.added_time;
-                        return Compare(torrent_age, *age, oper);
-                    }
+            bits |= static_cast<std::uint64_t>(pred(base + bit)) << bit;
+        }
 
-                    throw QueryError("Invalid value type - expected integer");
-                }
-            }},
-            {"category", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto category = std::get_if<std::string>(&val))
-                    {
-                        const auto client_data = ts.handle.userdata().get<porla::TorrentClientData>();
+        selection[word] = bits;
+    }
+}
 
-                        if (client_data == nullptr || !client_data->category.has_value())
-                        {
-                            return false;
-                        }
+template<typename T, typename TPred>
+static void SelectWhere(const std::vector<T>& column, porla::Query::Bitmap& selection, TPred pred)
+{
+    SelectRows(column.size(), selection, [&column, &pred](std::size_t row) { return pred(column[row]); });
+}
 
-                        return Compare(client_data->category.value(), *category, oper);
-                    }
+// Tests the tag bits of every row against a mask of the tags in the predicate - any of
+// them, or all of them for an and-chain. Tags without a bit are on no torrent.
+static void SelectTags(const porla::Query::Columns& columns, const Predicate& p, porla::Query::Bitmap& selection)
+{
+    const auto words = columns.tag_words;
+    std::vector<std::uint64_t> mask(words, 0);
 
-                    throw QueryError("Invalid value type - expected string");
-                }
-            }},
-            {"download_rate", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto dl = std::get_if<std::int64_t>(&val))
-                    {
-                        return Compare(ts.download_rate, *dl, oper);
-                    }
+    const auto set = [&mask](std::uint32_t bit) { mask[bit / 64] |= std::uint64_t{1} << (bit % 64); };
 
-                    throw QueryError("Invalid value type - expected number");
-                }
-            }},
-            {"name", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto name = std::get_if<std::string>(&val))
-                    {
-                        if (oper == Oper::CONTAINS)
-                        {
-                            return ts.name.find(*name) != std::string::npos;
-                        }
+    if (p.oper == Oper::MATCHES)
+    {
+        for (const auto& [tag, bit] : columns.tag_bits)
+        {
+            if (p.regex->Search(tag.str())) { set(bit); }
+        }
+    }
+    else
+    {
+        const auto add = [&](const std::string& value)
+        {
+            const auto symbol = porla::Symbol::Find(value);
+            const auto bit    = symbol.has_value() ? columns.tag_bits.find(*symbol) : columns.tag_bits.end();
 
-                        return Compare(ts.name, *name, oper);
-                    }
+            if (bit == columns.tag_bits.end()) { return false; }
 
-                    throw QueryError("Invalid value type - expected string");
-                }
-            }},
-            {"progress", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto progress = std::get_if<float>(&val))
-                    {
-                        return Compare(ts.progress, *progress, oper);
-                    }
+            set(bit->second);
+            return true;
+        };
 
-                    throw QueryError("Invalid value type - expected string");
-                }
-            }},
-            {"ratio", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    const auto ratio = porla::Utils::Ratio(ts);
+        bool known = true;
 
-                    if (const auto ratio_int = std::get_if<std::int64_t>(&val))
-                    {
-                        return Compare(ratio, *ratio_int, oper);
-                    }
+        if (p.oper == Oper::IN) { for (const auto& value : p.string_set) { known = add(value) && known; } }
+        else                    { known = add(p.string_value); }
 
-                    if (const auto ratio_float = std::get_if<float>(&val))
-                    {
-                        return Compare(ratio, *ratio_float, oper);
-                    }
+        if (p.all && !known)
+        {
+            selection.assign((columns.Size() + 63) / 64, 0);
+            return;
+        }
+    }
 
-                    throw QueryError("Invalid value type - expected int or float");
-                }
-            }},
-            {"save_path", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto save_path = std::get_if<std::string>(&val))
-                    {
-                        if (oper == Oper::CONTAINS)
-                        {
-                            return ts.save_path.find(*save_path) != std::string::npos;
-                        }
+    // Few enough tags for one word, which is the usual case.
+    if (words == 1)
+    {
+        const auto m = mask[0];
 
-                        return Compare(ts.save_path, *save_path, oper);
-                    }
+        return p.all
+            ? SelectWhere(columns.tags, selection, [m](std::uint64_t v) { return (v & m) == m; })
+            : SelectWhere(columns.tags, selection, [m](std::uint64_t v) { return (v & m) != 0; });
+    }
 
-                    throw QueryError("Invalid value type - expected string");
-                }
-            }},
-            {"size", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto size = std::get_if<std::int64_t>(&val))
-                    {
-                        if (const auto torrent_file = ts.torrent_file.lock())
-                        {
-                            return Compare(torrent_file->total_size(), *size, oper);
-                        }
+    SelectRows(
+        columns.Size(),
+        selection,
+        [&columns, &mask, words, all = p.all](std::size_t row)
+        {
+            const auto bits = columns.TagRow(row);
 
-                        return false;
-                    }
+            bool any = false;
+            bool every = true;
 
-                    throw QueryError("Invalid value type - expected string");
-                }
-            }},
-            {"tags", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (oper != Oper::CONTAINS)
-                    {
-                        throw QueryError("tags only support contains");
-                    }
+            for (std::size_t w = 0; w < words; w++)
+            {
+                any   |= (bits[w] & mask[w]) != 0;
+                every &= (bits[w] & mask[w]) == mask[w];
+            }
 
-                    if (const auto tag = std::get_if<std::string>(&val))
-                    {
-                        const auto client_data = ts.handle.userdata().get<porla::TorrentClientData>();
+            return all ? every : any;
+        });
+}
 
-                        return client_data != nullptr
-                            && client_data->tags.has_value()
-                            && client_data->tags->contains(*tag);
-                    }
+// Same as Compare, but with the operator resolved once for the whole column.
+template<typename T, typename TValue>
+static void SelectCompare(const std::vector<T>& column, TValue value, Oper oper, porla::Query::Bitmap& selection)
+{
+    switch (oper)
+    {
+    case Oper::LT:  return SelectWhere(column, selection, [value](T v) { return v < value; });
+    case Oper::LTE: return SelectWhere(column, selection, [value](T v) { return v <= value; });
+    case Oper::EQ:  return SelectWhere(column, selection, [value](T v) { return v == value; });
+    case Oper::GT:  return SelectWhere(column, selection, [value](T v) { return v > value; });
+    case Oper::GTE: return SelectWhere(column, selection, [value](T v) { return v >= value; });
+    case Oper::CONTAINS:
+    case Oper::IN:
+    case Oper::MATCHES:
+        break;
+    }
 
-                    throw QueryError("Invalid value type - expected string");
-                }
-            }},
-            {"upload_rate", OperRef{
-                .func = [](Oper oper, const ValueVariant& val, const lt::torrent_status& ts)
-                {
-                    if (const auto ul = std::get_if<std::int64_t>(&val))
-                    {
-                        return Compare(ts.upload_rate, *ul, oper);
-                    }
+    selection.assign((column.size() + 63) / 64, 0);
+}
 
-                    throw QueryError("Invalid value type - expected number");
-                }
-            }}
-        };
+// The expression tree. Children of and/or nodes are reordered before the program is
+// emitted, and the tree is kept afterwards to plan index lookups.
+struct Node
+{
+    enum class Kind
+    {
+        And,
+        Not,
+        Or,
+        Test
+    };
+
+    Kind                     kind;
+    std::uint32_t            predicate = 0;
+    std::vector<std::size_t> children;
+
+    // Estimated cost of evaluating the node, and the probability that it is true.
+    double                   cost        = 0;
+    double                   selectivity = 0;
+
+    // True if the index answers the node exactly, so candidates need no further check.
+    bool                     indexed     = false;
+};
 
-        const auto reference = std::any_cast<std::string>(this->visit(context->reference()));
-        const auto oper      = std::any_cast<Oper>(this->visit(context->operator_()));
-        const auto value     = std::any_cast<ValueVariant>(this->visit(context->value()));
+static std::size_t Emit(std::vector<Instruction>& code, Instruction::Code op, std::uint32_t arg = 0)
+{
+    code.push_back(Instruction{ .code = op, .arg = arg });
+    return code.size() - 1;
+}
+
+static void EmitNode(std::vector<Instruction>& code, const std::vector<Node>& nodes, std::size_t index)
+{
+    const auto& node = nodes[index];
+
+    switch (node.kind)
+    {
+    case Node::Kind::Test:
+        Emit(code, Instruction::Code::Test, node.predicate);
+        return;
+    case Node::Kind::Not:
+        EmitNode(code, nodes, node.children[0]);
+        Emit(code, Instruction::Code::Not);
+        return;
+    case Node::Kind::And:
+    case Node::Kind::Or:
+        break;
+    }
 
-        const auto oper_ref = oper_map.find(reference);
+    const auto jump_code = node.kind == Node::Kind::And
+        ? Instruction::Code::JumpIfFalse
+        : Instruction::Code::JumpIfTrue;
 
-        if (oper_ref == oper_map.end())
+    std::vector<std::size_t> jumps;
+
+    for (std::size_t i = 0; i < node.children.size(); i++)
+    {
+        EmitNode(code, nodes, node.children[i]);
+
+        if (i + 1 < node.children.size())
         {
-            throw QueryError("Invalid reference '" + reference + "'", context->getStart()->getCharPositionInLine());
+            jumps.push_back(Emit(code, jump_code));
         }
+    }
 
-        return TorrentStatusFilter(
-            [oper, value, func = oper_ref->second.func](const lt::torrent_status& ts)
-            {
-                return func(oper, value, ts);
-            });
+    for (const auto jump : jumps)
+    {
+        // Point the jump at the next instruction.
+        code[jump].arg = static_cast<std::uint32_t>(code.size());
+    }
+}
+
+class Program : public PQL::Filter
+{
+public:
+    bool Includes(const libtorrent::torrent_status& ts) override
+    {
+        return Run(m_code, ts, nullptr, nullptr);
     }
 
-    antlrcpp::Any visitOrExpression(PorlaQueryLangParser::OrExpressionContext* context) override
+    bool Includes(const libtorrent::torrent_status& ts, const PQL::Rates& rates) override
+    {
+        return Run(m_code, ts, &rates, nullptr);
+    }
+
+    bool Includes(const libtorrent::torrent_status& ts, const PQL::Rates* rates, const PQL::Peers* peers) override
+    {
+        return Run(m_code, ts, rates, peers);
+    }
+
+    bool IncludesCandidate(const libtorrent::torrent_status& ts) override
+    {
+        return Run(m_residual, ts, nullptr, nullptr);
+    }
+
+    bool IncludesCandidate(const libtorrent::torrent_status& ts, const PQL::Rates& rates) override
     {
-        std::vector<TorrentStatusFilter> filters;
+        return Run(m_residual, ts, &rates, nullptr);
+    }
+
+    bool IncludesCandidate(const libtorrent::torrent_status& ts, const PQL::Rates* rates, const PQL::Peers* peers) override
+    {
+        return Run(m_residual, ts, rates, peers);
+    }
+
+    [[nodiscard]] std::optional<PQL::HashSet> Candidates(const PQL::Index& index) const override
+    {
+        return Plan(index, m_root);
+    }
+
+    bool Select(const porla::Query::Columns& columns, porla::Query::Bitmap& selection) const override
+    {
+        const bool columnar = std::all_of(
+            m_predicates.begin(),
+            m_predicates.end(),
+            [](const Predicate& p) { return IsColumnar(p); });
 
-        for (const auto expression : context->expression())
+        if (!columnar)
         {
-            filters.emplace_back(std::any_cast<TorrentStatusFilter>(this->visit(expression)));
+            return false;
         }
 
-        return TorrentStatusFilter(
-            [filters](const libtorrent::torrent_status& ts)
-            {
-                return std::any_of(
-                    filters.begin(),
-                    filters.end(),
-                    [&ts](const auto& f) { return f(ts); });
-            });
+        SelectNode(columns, m_root, time(nullptr), selection);
+
+        return true;
     }
 
-    antlrcpp::Any visitPredicateExpression(PorlaQueryLangParser::PredicateExpressionContext* context) override
+    [[nodiscard]] bool UsesClock() const override
     {
-        return this->visit(context->predicate());
+        return m_uses_now;
     }
 
-    antlrcpp::Any visitReference(PorlaQueryLangParser::ReferenceContext* context) override
+    std::uint32_t AddPredicate(Predicate predicate)
     {
-        return context->getText();
+        if (predicate.field == Field::AddedTime || predicate.field == Field::SeedingTime) { m_uses_now = true; }
+
+        m_predicates.push_back(std::move(predicate));
+        return static_cast<std::uint32_t>(m_predicates.size() - 1);
     }
 
-    antlrcpp::Any visitValue(PorlaQueryLangParser::ValueContext* context) override
+    [[nodiscard]] const Predicate& GetPredicate(std::uint32_t index) const
     {
-        if (const auto float_value = context->FLOAT())
+        return m_predicates.at(index);
+    }
+
+    Predicate& GetPredicate(std::uint32_t index)
+    {
+        return m_predicates.at(index);
+    }
+
+    // Emits the program for an optimized tree, and the residual program used for
+    // candidates found through the index.
+    void Compile(std::vector<Node> nodes, std::size_t root)
+    {
+        m_nodes = std::move(nodes);
+        m_root  = root;
+
+        MarkIndexed(root);
+        EmitNode(m_code, m_nodes, root);
+
+        const auto& node = m_nodes[root];
+
+        if (node.indexed)
         {
-            return ValueVariant(std::stof(float_value->getText()));
+            // Every candidate matches, so the residual program is empty.
+            return;
         }
 
-        if (const auto int_value = context->INT())
+        if (node.kind == Node::Kind::And)
         {
-            std::int64_t val = std::stoll(int_value->getText());
-
-            if (auto duration = context->UNIT_DURATION())
-            {
-                if (duration->getText() == "m") val *= 60;
-                if (duration->getText() == "h") val *= 60 * 60;
-                if (duration->getText() == "d") val *= 60 * 60 * 24;
-                if (duration->getText() == "w") val *= 60 * 60 * 24 * 7;
-            }
+            // Only the operands the index did not answer are left to check.
+            Node residual{ .kind = Node::Kind::And };
 
-            if (auto size = context->UNIT_SIZE())
+            for (const auto child : node.children)
             {
-                if (size->getText() == "kb") val *= 1024;
-                if (size->getText() == "mb") val *= 1024 * 1024;
-                if (size->getText() == "gb") val *= 1024 * 1024 * 1024;
-                if (size->getText() == "tb") val *= 1024 * 1024 * 1024 * 1024l;
-                if (size->getText() == "pb") val *= 1024 * 1024 * 1024 * 1024l * 1024l;
+                if (!m_nodes[child].indexed) { residual.children.push_back(child); }
             }
 
-            if (auto speed = context->UNIT_SPEED())
-            {
-                if (speed->getText() == "kbps") val *= 1024;
-                if (speed->getText() == "mbps") val *= 1024 * 1024;
-                if (speed->getText() == "gbps") val *= 1024 * 1024 * 1024;
-            }
+            m_nodes.push_back(std::move(residual));
+            EmitNode(m_residual, m_nodes, m_nodes.size() - 1);
+            m_nodes.pop_back();
 
-            return ValueVariant(val);
+            return;
         }
 
-        if (const auto string_value = context->STRING())
+        m_residual = m_code;
+    }
+
+private:
+    bool Run(const std::vector<Instruction>& code, const libtorrent::torrent_status& ts, const PQL::Rates* rates, const PQL::Peers* peers) const
+    {
+        // Read the clock once per torrent, and only if an age predicate needs it.
+        const std::int64_t now = m_uses_now ? time(nullptr) : 0;
+
+        // An empty program accepts everything.
+        bool acc = true;
+        std::size_t pc = 0;
+
+        while (pc < code.size())
         {
-            std::string text = string_value->getText();
-            if (!text.empty() && text[0] == '\"') { text = text.substr(1); }
-            if (!text.empty() && text[text.size() - 1] == '\"') { text = text.substr(0, text.size() - 1); }
+            const auto& ins = code[pc];
+
+            switch (ins.code)
+            {
+            case Instruction::Code::Test:
+                acc = Evaluate(m_predicates[ins.arg], ts, now, rates, peers);
+                break;
+            case Instruction::Code::Not:
+                acc = !acc;
+                break;
+            case Instruction::Code::JumpIfFalse:
+                if (!acc) { pc = ins.arg; continue; }
+                break;
+            case Instruction::Code::JumpIfTrue:
+                if (acc) { pc = ins.arg; continue; }
+                break;
+            }
 
-            return ValueVariant(text);
+            pc++;
         }
 
-        throw QueryError("Invalid value type", context->getStart()->getCharPositionInLine());
+        return acc;
     }
-};
 
-struct PqlFilter : public PQL::Filter
-{
-    explicit PqlFilter(TorrentStatusFilter filter)
-        : m_filter(std::move(filter))
+    [[nodiscard]] static bool IsColumnar(const Predicate& p)
     {
+        switch (p.field)
+        {
+        case Field::Category:
+        case Field::DownloadRateAvg:
+        case Field::EtaAvg:
+        case Field::Files:
+        case Field::InfoHash:
+        case Field::Name:
+        case Field::Peers:
+        case Field::SavePath:
+        case Field::SeedingTime:
+        case Field::UploadRateAvg:
+            return false;
+        default:
+            return true;
+        }
     }
 
-    bool Includes(const libtorrent::torrent_status& ts) override
+    void SelectNode(const porla::Query::Columns& columns, std::size_t index, std::int64_t now, porla::Query::Bitmap& selection) const
     {
-        return m_filter(ts);
-    }
-
-private:
-    TorrentStatusFilter m_filter;
-};
+        const auto& node = m_nodes[index];
 
-std::unique_ptr<PQL::Filter> PQL::Parse(const std::string_view &input)
-{
-    ExceptionErrorListener errorListener;
+        switch (node.kind)
+        {
+        case Node::Kind::Test:
+            SelectPredicate(columns, m_predicates[node.predicate], now, selection);
+            return;
+        case Node::Kind::Not:
+        {
+            SelectNode(columns, node.children[0], now, selection);
 
-    antlr4::ANTLRInputStream inputStream(input);
-    PorlaQueryLangLexer lexer{&inputStream};
-    lexer.removeErrorListeners();
-    lexer.addErrorListener(&errorListener);
+            for (auto& word : selection) { word = ~word; }
+
+            // Clear the bits past the last row.
+            if (const auto tail = columns.Size() % 64; tail != 0)
+            {
+                selection.back() &= (std::uint64_t{1} << tail) - 1;
+            }
+
+            return;
+        }
+        case Node::Kind::And:
+        case Node::Kind::Or:
+            break;
+        }
+
+        const bool is_and = node.kind == Node::Kind::And;
+
+        porla::Query::Bitmap operand;
+        SelectNode(columns, node.children[0], now, selection);
+
+        for (std::size_t i = 1; i < node.children.size(); i++)
+        {
+            SelectNode(columns, node.children[i], now, operand);
+
+            for (std::size_t word = 0; word < selection.size(); word++)
+            {
+                selection[word] = is_and
+                    ? selection[word] & operand[word]
+                    : selection[word] | operand[word];
+            }
+        }
+    }
+
+    static void SelectPredicate(const porla::Query::Columns& columns, const Predicate& p, std::int64_t now, porla::Query::Bitmap& selection)
+    {
+        switch (p.field)
+        {
+        case Field::AddedTime:
+            return SelectCompare(columns.added_time, now - p.int_value, p.oper, selection);
+        case Field::DownloadRate:
+            return SelectCompare(columns.download_rate, p.int_value, p.oper, selection);
+        case Field::FlagDownloading:
+            return SelectWhere(columns.state, selection, [](std::uint8_t v) { return v == lt::torrent_status::downloading; });
+        case Field::FlagFinished:
+            return SelectWhere(columns.state, selection, [](std::uint8_t v) { return v == lt::torrent_status::finished; });
+        case Field::FlagMetadataPending:
+            return SelectWhere(columns.state, selection, [](std::uint8_t v) { return v == lt::torrent_status::downloading_metadata; });
+        case Field::FlagMoving:
+            return SelectWhere(columns.moving_storage, selection, [](std::uint8_t v) { return v != 0; });
+        case Field::FlagPaused:
+        {
+            const auto paused = static_cast<std::uint64_t>(lt::torrent_flags::paused);
+            return SelectWhere(columns.flags, selection, [paused](std::uint64_t v) { return (v & paused) == paused; });
+        }
+        case Field::FlagSeeding:
+            return SelectWhere(columns.state, selection, [](std::uint8_t v) { return v == lt::torrent_status::seeding; });
+        case Field::Progress:
+            return SelectCompare(columns.progress, static_cast<float>(p.float_value), p.oper, selection);
+        case Field::Ratio:
+            return SelectCompare(columns.ratio, p.float_value, p.oper, selection);
+        case Field::Size:
+        {
+            SelectCompare(columns.size, p.int_value, p.oper, selection);
+
+            // Torrents without metadata never match a size predicate.
+            porla::Query::Bitmap has_size;
+            SelectWhere(columns.size, has_size, [](std::int64_t v) { return v >= 0; });
+
+            for (std::size_t word = 0; word < selection.size(); word++) { selection[word] &= has_size[word]; }
+
+            return;
+        }
+        case Field::Tags:
+            return SelectTags(columns, p, selection);
+        case Field::UploadRate:
+            return SelectCompare(columns.upload_rate, p.int_value, p.oper, selection);
+        case Field::Category:
+        case Field::DownloadRateAvg:
+        case Field::EtaAvg:
+        case Field::FileName:
+        case Field::FilePath:
+        case Field::FileSize:
+        case Field::Files:
+        case Field::InfoHash:
+        case Field::Name:
+        case Field::PeerClient:
+        case Field::PeerDownloadRate:
+        case Field::PeerIp:
+        case Field::PeerUploadRate:
+        case Field::Peers:
+        case Field::SavePath:
+        case Field::SeedingTime:
+        case Field::UploadRateAvg:
+            break;
+        }
+
+        selection.assign((columns.Size() + 63) / 64, 0);
+    }
+
+    // Category and save path equality and tag membership map straight onto the index,
+    // and so do sets of them.
+    [[nodiscard]] static bool IsIndexable(const Predicate& p)
+    {
+        switch (p.field)
+        {
+        case Field::Category:
+        case Field::SavePath:
+            return p.oper == Oper::EQ || p.oper == Oper::IN;
+        case Field::Tags:
+            return p.oper != Oper::MATCHES;
+        default:
+            return false;
+        }
+    }
+
+    void MarkIndexed(std::size_t index)
+    {
+        auto& node = m_nodes[index];
+
+        for (const auto child : node.children)
+        {
+            MarkIndexed(child);
+        }
+
+        switch (node.kind)
+        {
+        case Node::Kind::Test:
+            node.indexed = IsIndexable(m_predicates[node.predicate]);
+            break;
+        case Node::Kind::Not:
+            node.indexed = false;
+            break;
+        case Node::Kind::And:
+        case Node::Kind::Or:
+            node.indexed = std::all_of(
+                node.children.begin(),
+                node.children.end(),
+                [this](std::size_t child) { return m_nodes[child].indexed; });
+            break;
+        }
+    }
+
+    // Returns a superset of the torrents matching the node. And intersects whatever its
+    // operands can look up, or needs every operand to be indexable.
+    [[nodiscard]] std::optional<PQL::HashSet> Plan(const PQL::Index& index, std::size_t node_index) const
+    {
+        const auto& node = m_nodes[node_index];
+
+        switch (node.kind)
+        {
+        case Node::Kind::Test:
+        {
+            const auto& p = m_predicates[node.predicate];
+
+            // Substring matches only narrow it down, so they stay in the residual program.
+            if (p.oper == Oper::CONTAINS && p.field == Field::Name)     { return index.NameContains(p.string_value); }
+            if (p.oper == Oper::CONTAINS && p.field == Field::SavePath) { return index.SavePathContains(p.string_value); }
+
+            if (!IsIndexable(p)) { return std::nullopt; }
+
+            const auto lookup = [&](const std::string& value) -> const PQL::HashSet&
+            {
+                switch (p.field)
+                {
+                case Field::Category: return index.Category(value);
+                case Field::SavePath: return index.SavePath(value);
+                default:              return index.Tag(value);
+                }
+            };
+
+            if (p.oper != Oper::IN)
+            {
+                return lookup(p.string_value);
+            }
+
+            if (p.all)
+            {
+                std::vector<const PQL::HashSet*> sets;
+                for (auto const& value : p.string_set) { sets.push_back(&lookup(value)); }
+
+                std::sort(sets.begin(), sets.end(), [](auto lhs, auto rhs) { return lhs->size() < rhs->size(); });
+
+                PQL::HashSet result = *sets[0];
+
+                for (std::size_t i = 1; i < sets.size() && !result.empty(); i++)
+                {
+                    std::erase_if(result, [&](auto const& hash) { return !sets[i]->contains(hash); });
+                }
+
+                return result;
+            }
+
+            PQL::HashSet result;
+
+            for (auto const& value : p.string_set)
+            {
+                const auto& set = lookup(value);
+                result.insert(set.begin(), set.end());
+            }
+
+            return result;
+        }
+        case Node::Kind::Not:
+            return std::nullopt;
+        case Node::Kind::And:
+        {
+            std::vector<PQL::HashSet> sets;
+
+            for (const auto child : node.children)
+            {
+                if (auto set = Plan(index, child)) { sets.push_back(std::move(*set)); }
+            }
+
+            if (sets.empty()) { return std::nullopt; }
+
+            // Start from the smallest set and drop anything missing from the others.
+            std::sort(sets.begin(), sets.end(), [](auto const& lhs, auto const& rhs) { return lhs.size() < rhs.size(); });
+
+            PQL::HashSet result = std::move(sets[0]);
+
+            for (std::size_t i = 1; i < sets.size() && !result.empty(); i++)
+            {
+                std::erase_if(result, [&](auto const& hash) { return !sets[i].contains(hash); });
+            }
+
+            return result;
+        }
+        case Node::Kind::Or:
+        {
+            PQL::HashSet result;
+
+            for (const auto child : node.children)
+            {
+                auto set = Plan(index, child);
+                if (!set) { return std::nullopt; }
+
+                result.merge(*set);
+            }
+
+            return result;
+        }
+        }
+
+        return std::nullopt;
+    }
+
+    static bool Evaluate(const Predicate& p, const libtorrent::torrent_status& ts, std::int64_t now, const PQL::Rates* rates, const PQL::Peers* peers)
+    {
+        switch (p.field)
+        {
+        case Field::AddedTime:
+            // 'age OP x' is folded into 'added_time OP' (now - x)' at compile time.
+            return Compare(static_cast<std::int64_t>(ts.added_time), now - p.int_value, p.oper);
+        case Field::Category:
+        {
+            // Parked torrents have no handle to ask, and match no category or tag.
+            const auto client_data = ts.handle.is_valid() ? ts.handle.userdata().get<porla::TorrentClientData>() : nullptr;
+
+            return client_data != nullptr
+                && client_data->category.has_value()
+                && CompareString(client_data->category->str(), p);
+        }
+        case Field::DownloadRate:
+            return Compare(static_cast<std::int64_t>(ts.download_rate), p.int_value, p.oper);
+        case Field::DownloadRateAvg:
+        {
+            const double rate = rates != nullptr ? rates->Download(ts) : ts.download_payload_rate;
+            return Compare(static_cast<std::int64_t>(rate), p.int_value, p.oper);
+        }
+        case Field::EtaAvg:
+        {
+            // Finished and stalled torrents have no ETA, and match no ETA predicate.
+            const double rate = rates != nullptr ? rates->Download(ts) : ts.download_payload_rate;
+            const auto remaining = ts.total_wanted - ts.total_wanted_done;
+
+            return remaining > 0
+                && rate >= 1
+                && Compare(static_cast<std::int64_t>(static_cast<double>(remaining) / rate), p.int_value, p.oper);
+        }
+        case Field::Files:
+            return EvaluateFiles(p, ts);
+        case Field::FlagDownloading:
+            return ts.state == lt::torrent_status::downloading;
+        case Field::FlagFinished:
+            return ts.state == lt::torrent_status::finished;
+        case Field::FlagMetadataPending:
+            // Torrents held back from fetching it too, which keep the state while paused.
+            return ts.state == lt::torrent_status::downloading_metadata;
+        case Field::FlagMoving:
+            return ts.moving_storage;
+        case Field::FlagPaused:
+            return (ts.flags & lt::torrent_flags::paused) == lt::torrent_flags::paused;
+        case Field::FlagSeeding:
+            return ts.state == lt::torrent_status::seeding;
+        case Field::InfoHash:
+            // Only = is allowed, against lower case hex.
+            return (ts.info_hashes.has_v1() && HexEquals(ts.info_hashes.v1, p.string_value))
+                || (ts.info_hashes.has_v2() && HexEquals(ts.info_hashes.v2, p.string_value));
+        case Field::Name:
+            return CompareString(ts.name, p);
+        case Field::Peers:
+            return EvaluatePeers(p, ts, peers);
+        case Field::Progress:
+            return Compare(ts.progress, static_cast<float>(p.float_value), p.oper);
+        case Field::Ratio:
+            return Compare(porla::Utils::Ratio(ts), p.float_value, p.oper);
+        case Field::SavePath:
+            return CompareString(ts.save_path, p);
+        case Field::SeedingTime:
+            return Compare(static_cast<std::int64_t>(ts.seeding_duration.count()), p.int_value, p.oper);
+        case Field::Size:
+        {
+            const auto torrent_file = ts.torrent_file.lock();
+            return torrent_file != nullptr && Compare(torrent_file->total_size(), p.int_value, p.oper);
+        }
+        case Field::Tags:
+        {
+            const auto client_data = ts.handle.is_valid() ? ts.handle.userdata().get<porla::TorrentClientData>() : nullptr;
+
+            if (client_data == nullptr || !client_data->tags.has_value())
+            {
+                return false;
+            }
+
+            switch (p.oper)
+            {
+            case Oper::IN:
+                if (p.all)
+                {
+                    return std::all_of(
+                        p.string_set.begin(),
+                        p.string_set.end(),
+                        [&client_data](const std::string& tag) { return client_data->tags->contains(tag); });
+                }
+
+                return std::any_of(
+                    client_data->tags->begin(),
+                    client_data->tags->end(),
+                    [&p](const porla::Symbol& tag) { return p.string_set.contains(tag.str()); });
+            case Oper::MATCHES:
+                return std::any_of(
+                    client_data->tags->begin(),
+                    client_data->tags->end(),
+                    [&p](const porla::Symbol& tag) { return p.regex->Search(tag.str()); });
+            default:
+                return client_data->tags->contains(p.string_value);
+            }
+        }
+        case Field::UploadRate:
+            return Compare(static_cast<std::int64_t>(ts.upload_rate), p.int_value, p.oper);
+        case Field::UploadRateAvg:
+        {
+            const double rate = rates != nullptr ? rates->Upload(ts) : ts.upload_payload_rate;
+            return Compare(static_cast<std::int64_t>(rate), p.int_value, p.oper);
+        }
+        case Field::FileName:
+        case Field::FilePath:
+        case Field::FileSize:
+        case Field::PeerClient:
+        case Field::PeerDownloadRate:
+        case Field::PeerIp:
+        case Field::PeerUploadRate:
+            // Only tested on the items of an aggregate.
+            break;
+        }
+
+        return false;
+    }
+
+    std::vector<Instruction> m_code;
+    std::vector<Instruction> m_residual;
+    std::vector<Predicate> m_predicates;
+    std::vector<Node> m_nodes;
+    std::size_t m_root = 0;
+    bool m_uses_now = false;
+};
+
+// Rough, static estimates. Anything touching userdata() is a round trip to the libtorrent
+// thread and by far the most expensive; string scans come next. Aggregates walk every
+// file or peer of a torrent, so cheaper tests in the same and-chain narrow it down first.
+static void EstimatePredicate(const Predicate& p, Node& node)
+{
+    switch (p.field)
+    {
+    case Field::FlagDownloading:
+    case Field::FlagFinished:
+    case Field::FlagMetadataPending:
+    case Field::FlagMoving:
+    case Field::FlagPaused:
+    case Field::FlagSeeding:
+        node.cost = 1;
+        node.selectivity = 0.3;
+        return;
+    case Field::AddedTime:
+    case Field::DownloadRate:
+    case Field::Progress:
+    case Field::SeedingTime:
+    case Field::UploadRate:
+        node.cost = 1;
+        break;
+    case Field::DownloadRateAvg:
+    case Field::EtaAvg:
+    case Field::Ratio:
+    case Field::UploadRateAvg:
+        node.cost = 2;
+        break;
+    case Field::Size:
+        node.cost = 3;
+        break;
+    case Field::InfoHash:
+    case Field::Name:
+    case Field::SavePath:
+        node.cost = p.oper == Oper::MATCHES ? 20 : p.oper == Oper::CONTAINS ? 10 : 4;
+        break;
+    case Field::Category:
+    case Field::Tags:
+        node.cost = 50;
+        break;
+    case Field::FileName:
+    case Field::FilePath:
+    case Field::FileSize:
+    case Field::Files:
+        node.cost = 100;
+        break;
+    case Field::PeerClient:
+    case Field::PeerDownloadRate:
+    case Field::PeerIp:
+    case Field::PeerUploadRate:
+    case Field::Peers:
+        node.cost = 200;
+        break;
+    }
+
+    switch (p.oper)
+    {
+    case Oper::EQ:       node.selectivity = 0.1; break;
+    case Oper::CONTAINS: node.selectivity = 0.2; break;
+    case Oper::MATCHES:  node.selectivity = 0.2; break;
+    case Oper::IN:
+        node.selectivity = p.all
+            ? std::pow(0.2, static_cast<double>(p.string_set.size()))
+            : std::min(0.9, 0.1 * static_cast<double>(p.string_set.size()));
+        break;
+    default:             node.selectivity = 0.5; break;
+    }
+}
+
+// Reorders the children of and/or nodes so cheap checks that are likely to decide the
+// result run first. Both operators are commutative and predicates have no side effects,
+// so only the evaluation order changes.
+static void Optimize(const Program& program, std::vector<Node>& nodes, std::size_t index)
+{
+    for (const auto child : nodes[index].children)
+    {
+        Optimize(program, nodes, child);
+    }
+
+    auto& node = nodes[index];
+
+    switch (node.kind)
+    {
+    case Node::Kind::Test:
+        EstimatePredicate(program.GetPredicate(node.predicate), node);
+        return;
+    case Node::Kind::Not:
+        node.cost = nodes[node.children[0]].cost;
+        node.selectivity = 1 - nodes[node.children[0]].selectivity;
+        return;
+    case Node::Kind::And:
+    case Node::Kind::Or:
+        break;
+    }
+
+    const bool is_and = node.kind == Node::Kind::And;
+
+    // The probability that a child decides the result - false for and, true for or.
+    const auto decides = [&](std::size_t i)
+    {
+        return is_and ? 1 - nodes[i].selectivity : nodes[i].selectivity;
+    };
+
+    // Classic ordering for short-circuit evaluation - ascending cost per decision.
+    std::stable_sort(
+        node.children.begin(),
+        node.children.end(),
+        [&](std::size_t lhs, std::size_t rhs)
+        {
+            return nodes[lhs].cost * decides(rhs) < nodes[rhs].cost * decides(lhs);
+        });
+
+    double cost = 0;
+    double reach = 1; // probability of evaluating the next child
+
+    for (const auto child : node.children)
+    {
+        cost  += reach * nodes[child].cost;
+        reach *= 1 - decides(child);
+    }
+
+    node.cost = cost;
+    node.selectivity = is_and ? reach : 1 - reach;
+}
+
+// Builds the expression tree over a Program's predicates. Field names, literal types and
+// units are all resolved here, so type errors surface when parsing instead of when
+// filtering. Shared by both parsers so they compile queries identically.
+class Builder
+{
+public:
+    explicit Builder(Program& program, std::vector<Node>& nodes)
+        : m_program(program)
+        , m_nodes(nodes)
+    {
+    }
+
+    // Builds an and/or node, flattening nested nodes of the same kind so all operands can
+    // be reordered together.
+    std::size_t Combine(Node::Kind kind, std::size_t lhs, std::size_t rhs)
+    {
+        std::vector<std::size_t> children;
+
+        for (const auto child : { lhs, rhs })
+        {
+            if (m_nodes[child].kind == kind)
+            {
+                const auto grandchildren = m_nodes[child].children;
+                children.insert(children.end(), grandchildren.begin(), grandchildren.end());
+            }
+            else
+            {
+                children.push_back(child);
+            }
+        }
+
+        if (kind == Node::Kind::Or)
+        {
+            FoldSets(children);
+        }
+        else
+        {
+            FoldTags(children);
+        }
+
+        if (children.size() == 1)
+        {
+            return children[0];
+        }
+
+        m_nodes.push_back(Node{ .kind = kind, .children = std::move(children) });
+        return m_nodes.size() - 1;
+    }
+
+    std::size_t Flag(const std::string& reference, std::size_t pos)
+    {
+        static const std::map<std::string, Field> flags_map =
+        {
+            {"downloading",       Field::FlagDownloading},
+            {"finished",          Field::FlagFinished},
+            {"metadata_pending",  Field::FlagMetadataPending},
+            {"moving",            Field::FlagMoving},
+            {"paused",            Field::FlagPaused},
+            {"seeding",           Field::FlagSeeding}
+        };
+
+        const auto flag_ref = flags_map.find(reference);
+
+        if (flag_ref == flags_map.end())
+        {
+            throw QueryError("Invalid flag '" + reference + "'", pos);
+        }
+
+        return Test(Predicate{ .field = flag_ref->second, .oper = Oper::EQ });
+    }
+
+    // reference in [values...] - the same as an or-chain of equality tests.
+    std::size_t In(const std::string& reference, const std::vector<ValueVariant>& values, std::size_t pos)
+    {
+        std::optional<Predicate> result;
+
+        for (const auto& value : values)
+        {
+            auto predicate = MakePredicate(reference, reference == "tags" ? Oper::CONTAINS : Oper::EQ, value, pos);
+
+            if (!IsFoldable(predicate))
+            {
+                throw QueryError("Invalid operator for '" + reference + "'", pos);
+            }
+
+            ToSet(predicate);
+
+            if (result.has_value()) { result->string_set.merge(predicate.string_set); }
+            else                    { result = std::move(predicate); }
+        }
+
+        if (!result.has_value())
+        {
+            throw QueryError("Empty set for '" + reference + "'", pos);
+        }
+
+        return Test(std::move(*result));
+    }
+
+    std::size_t Not(std::size_t child)
+    {
+        m_nodes.push_back(Node{ .kind = Node::Kind::Not, .children = { child } });
+        return m_nodes.size() - 1;
+    }
+
+    std::size_t Comparison(const std::string& reference, Oper oper, const ValueVariant& value, std::size_t pos)
+    {
+        return Test(MakePredicate(reference, oper, value, pos));
+    }
+
+    // A test of one file or peer, in an aggregate over them.
+    static Predicate ItemComparison(const std::string& list, const std::string& reference, Oper oper, const ValueVariant& value, std::size_t pos)
+    {
+        static const std::map<std::string, FieldRef> files_map =
+        {
+            {"name",          {Field::FileName,         ValueType::String,  true,  false, true }},
+            {"path",          {Field::FilePath,         ValueType::String,  true,  false, true }},
+            {"size",          {Field::FileSize,         ValueType::Integer, false, false, false}}
+        };
+
+        static const std::map<std::string, FieldRef> peers_map =
+        {
+            {"client",        {Field::PeerClient,       ValueType::String,  true,  false, true }},
+            {"download_rate", {Field::PeerDownloadRate, ValueType::Integer, false, false, false}},
+            {"ip",            {Field::PeerIp,           ValueType::String,  true,  false, true }},
+            {"upload_rate",   {Field::PeerUploadRate,   ValueType::Integer, false, false, false}}
+        };
+
+        if (list != "files" && list != "peers")
+        {
+            throw QueryError("Invalid list '" + list + "'", pos);
+        }
+
+        const auto& fields = list == "files" ? files_map : peers_map;
+        const auto field_ref = fields.find(reference);
+
+        if (field_ref == fields.end())
+        {
+            throw QueryError("Invalid reference '" + reference + "' for " + list, pos);
+        }
+
+        return MakePredicate(field_ref->second, reference, oper, value, pos);
+    }
+
+    // function(list, tests...) - any() of the items passing every test, or the count() of
+    // them, or of those in the busiest subnet with max_per_subnet(), compared with value.
+    std::size_t ListAggregate(
+        const std::string& function,
+        const std::string& list,
+        std::vector<Predicate> where,
+        Oper oper,
+        const ValueVariant& value,
+        std::size_t pos)
+    {
+        static const std::map<std::string, Aggregate::Kind> functions =
+        {
+            {"any",            Aggregate::Kind::Any},
+            {"count",          Aggregate::Kind::Count},
+            {"max_per_subnet", Aggregate::Kind::MaxPerSubnet}
+        };
+
+        const auto kind = functions.find(function);
+
+        if (kind == functions.end())
+        {
+            throw QueryError("Invalid function '" + function + "'", pos);
+        }
+
+        if (list != "files" && list != "peers")
+        {
+            throw QueryError("Invalid list '" + list + "'", pos);
+        }
+
+        if (kind->second == Aggregate::Kind::MaxPerSubnet && list != "peers")
+        {
+            throw QueryError("max_per_subnet only support peers", pos);
+        }
+
+        if (oper == Oper::CONTAINS || oper == Oper::IN || oper == Oper::MATCHES)
+        {
+            throw QueryError("Invalid operator for '" + function + "'", pos);
+        }
+
+        const auto count = std::get_if<std::int64_t>(&value);
+
+        if (count == nullptr)
+        {
+            throw QueryError("Invalid value type - expected integer", pos);
+        }
+
+        // Sizes and rates first, since the path of a file and the address of a peer are
+        // formatted for each test.
+        std::stable_sort(
+            where.begin(),
+            where.end(),
+            [](const Predicate& lhs, const Predicate& rhs) { return ItemCost(lhs) < ItemCost(rhs); });
+
+        return Test(Predicate{
+            .field     = list == "files" ? Field::Files : Field::Peers,
+            .oper      = oper,
+            .int_value = *count,
+            .aggregate = std::make_shared<const Aggregate>(Aggregate{ .kind = kind->second, .where = std::move(where) })
+        });
+    }
+
+    // Parses an integer literal and applies its unit, if any.
+    static ValueVariant IntValue(const std::string& text, const std::string& unit)
+    {
+        std::int64_t val = std::stoll(text);
+
+        if (unit == "m") val *= 60;
+        if (unit == "h") val *= 60 * 60;
+        if (unit == "d") val *= 60 * 60 * 24;
+        if (unit == "w") val *= 60 * 60 * 24 * 7;
+
+        if (unit == "kb") val *= 1024;
+        if (unit == "mb") val *= 1024 * 1024;
+        if (unit == "gb") val *= 1024 * 1024 * 1024;
+        if (unit == "tb") val *= 1024 * 1024 * 1024 * 1024l;
+        if (unit == "pb") val *= 1024 * 1024 * 1024 * 1024l * 1024l;
+
+        if (unit == "kbps") val *= 1024;
+        if (unit == "mbps") val *= 1024 * 1024;
+        if (unit == "gbps") val *= 1024 * 1024 * 1024;
+
+        return val;
+    }
+
+    static ValueVariant StringValue(std::string text)
+    {
+        if (!text.empty() && text[0] == '\"') { text = text.substr(1); }
+        if (!text.empty() && text[text.size() - 1] == '\"') { text = text.substr(0, text.size() - 1); }
+
+        return text;
+    }
+
+private:
+    enum class ValueType { Integer, Number, String };
+
+    struct FieldRef
+    {
+        Field     field;
+        ValueType type;
+        bool      contains;      // supports the contains operator
+        bool      contains_only; // supports nothing but the contains and matches operators
+        bool      matches;       // supports the matches operator
+    };
+
+    static int ItemCost(const Predicate& p)
+    {
+        switch (p.field)
+        {
+        case Field::FileName:
+        case Field::PeerClient:
+            return p.oper == Oper::MATCHES ? 2 : 1;
+        case Field::FilePath:
+        case Field::PeerIp:
+            return p.oper == Oper::MATCHES ? 4 : 3;
+        default:
+            return 0;
+        }
+    }
+
+    static Predicate MakePredicate(const std::string& reference, Oper oper, const ValueVariant& value, std::size_t pos)
+    {
+        static const std::map<std::string, FieldRef> field_map =
+        {
+            {"age",           {Field::AddedTime,    ValueType::Integer, false, false, false}},
+            {"category",      {Field::Category,     ValueType::String,  false, false, true }},
+            {"download_rate", {Field::DownloadRate, ValueType::Integer, false, false, false}},
+            {"download_rate_avg", {Field::DownloadRateAvg, ValueType::Integer, false, false, false}},
+            {"eta_avg",       {Field::EtaAvg,       ValueType::Integer, false, false, false}},
+            {"info_hash",     {Field::InfoHash,     ValueType::String,  false, false, false}},
+            {"name",          {Field::Name,         ValueType::String,  true,  false, true }},
+            {"progress",      {Field::Progress,     ValueType::Number,  false, false, false}},
+            {"ratio",         {Field::Ratio,        ValueType::Number,  false, false, false}},
+            {"save_path",     {Field::SavePath,     ValueType::String,  true,  false, true }},
+            {"seeding_time",  {Field::SeedingTime,  ValueType::Integer, false, false, false}},
+            {"size",          {Field::Size,         ValueType::Integer, false, false, false}},
+            {"tags",          {Field::Tags,         ValueType::String,  true,  true,  true }},
+            {"upload_rate",   {Field::UploadRate,   ValueType::Integer, false, false, false}},
+            {"upload_rate_avg", {Field::UploadRateAvg, ValueType::Integer, false, false, false}}
+        };
+
+        const auto field_ref = field_map.find(reference);
+        if (field_ref == field_map.end())
+        {
+            throw QueryError("Invalid reference '" + reference + "'", pos);
+        }
+
+        return MakePredicate(field_ref->second, reference, oper, value, pos);
+    }
+
+    static Predicate MakePredicate(const FieldRef& ref, const std::string& reference, Oper oper, const ValueVariant& value, std::size_t pos)
+    {
+        if (ref.contains_only && oper != Oper::CONTAINS && oper != Oper::MATCHES)
+        {
+            throw QueryError(reference + " only support contains and matches", pos);
+        }
+
+        if (!ref.contains && oper == Oper::CONTAINS)
+        {
+            throw QueryError("Invalid operator for '" + reference + "'", pos);
+        }
+
+        if (!ref.matches && oper == Oper::MATCHES)
+        {
+            throw QueryError("Invalid operator for '" + reference + "'", pos);
+        }
+
+        Predicate predicate{ .field = ref.field, .oper = oper };
+
+        switch (ref.type)
+        {
+        case ValueType::Integer:
+            if (const auto val = std::get_if<std::int64_t>(&value)) { predicate.int_value = *val; break; }
+            throw QueryError("Invalid value type - expected integer", pos);
+        case ValueType::Number:
+            if (const auto val = std::get_if<std::int64_t>(&value)) { predicate.float_value = static_cast<double>(*val); break; }
+            if (const auto val = std::get_if<float>(&value))        { predicate.float_value = *val; break; }
+            throw QueryError("Invalid value type - expected int or float", pos);
+        case ValueType::String:
+            if (const auto val = std::get_if<std::string>(&value))  { predicate.string_value = *val; break; }
+            throw QueryError("Invalid value type - expected string", pos);
+        }
+
+        if (oper == Oper::MATCHES)
+        {
+            try
+            {
+                predicate.regex = std::make_shared<porla::Query::Regex>(predicate.string_value);
+            }
+            catch (const std::invalid_argument& ex)
+            {
+                throw QueryError("Invalid pattern - " + std::string(ex.what()), pos);
+            }
+        }
+
+        if (predicate.field == Field::InfoHash)
+        {
+            auto& hash = predicate.string_value;
+
+            if (oper != Oper::EQ)
+            {
+                throw QueryError("info_hash only support =", pos);
+            }
+
+            const auto is_hex = [](unsigned char c) { return std::isxdigit(c) != 0; };
+
+            if ((hash.size() != 40 && hash.size() != 64) || !std::all_of(hash.begin(), hash.end(), is_hex))
+            {
+                throw QueryError("Invalid info hash '" + hash + "'", pos);
+            }
+
+            // Matched against lower case hex.
+            std::transform(hash.begin(), hash.end(), hash.begin(), [](unsigned char c) { return std::tolower(c); });
+        }
+
+        // age is the time since the torrent was added, so flip the comparison and test
+        // added_time against 'now - age' instead.
+        if (predicate.field == Field::AddedTime)
+        {
+            switch (oper)
+            {
+            case Oper::GT:  predicate.oper = Oper::LT;  break;
+            case Oper::GTE: predicate.oper = Oper::LTE; break;
+            case Oper::LT:  predicate.oper = Oper::GT;  break;
+            case Oper::LTE: predicate.oper = Oper::GTE; break;
+            default: break;
+            }
+        }
+
+        return predicate;
+    }
+
+    static bool IsFoldable(const Predicate& p)
+    {
+        switch (p.field)
+        {
+        case Field::Category:
+        case Field::InfoHash:
+        case Field::Name:
+        case Field::SavePath:
+            return p.oper == Oper::EQ || p.oper == Oper::IN;
+        case Field::Tags:
+            // A test for all of a set of tags is not one of a set of values.
+            return p.oper != Oper::MATCHES && !p.all;
+        default:
+            return false;
+        }
+    }
+
+    static void ToSet(Predicate& p)
+    {
+        if (p.oper == Oper::IN) { return; }
+
+        p.string_set.insert(std::move(p.string_value));
+        p.string_value.clear();
+        p.oper = Oper::IN;
+    }
+
+    // Folds equality tests on the same string field into a single set lookup, so a long
+    // or-chain of allowed values costs one hash lookup per torrent.
+    void FoldSets(std::vector<std::size_t>& children)
+    {
+        std::map<Field, std::size_t> sets;
+        std::vector<std::size_t> folded;
+
+        for (const auto child : children)
+        {
+            const auto& node = m_nodes[child];
+
+            if (node.kind != Node::Kind::Test || !IsFoldable(m_program.GetPredicate(node.predicate)))
+            {
+                folded.push_back(child);
+                continue;
+            }
+
+            auto& predicate = m_program.GetPredicate(node.predicate);
+            const auto set = sets.find(predicate.field);
+
+            if (set == sets.end())
+            {
+                sets.insert({ predicate.field, child });
+                folded.push_back(child);
+                continue;
+            }
+
+            auto& target = m_program.GetPredicate(m_nodes[set->second].predicate);
+
+            ToSet(target);
+            ToSet(predicate);
+
+            target.string_set.merge(predicate.string_set);
+        }
+
+        children = std::move(folded);
+    }
+
+    // Folds the single tag tests of an and-chain into one test for all of them, which is
+    // one look at the tags of a torrent instead of one per tag, and one mask test over
+    // the columns.
+    void FoldTags(std::vector<std::size_t>& children)
+    {
+        std::optional<std::size_t> target;
+        std::vector<std::size_t> folded;
+
+        for (const auto child : children)
+        {
+            const auto& node = m_nodes[child];
+
+            if (node.kind != Node::Kind::Test)
+            {
+                folded.push_back(child);
+                continue;
+            }
+
+            auto& predicate = m_program.GetPredicate(node.predicate);
+
+            const bool single = predicate.field == Field::Tags
+                && (predicate.oper == Oper::CONTAINS || (predicate.oper == Oper::IN && predicate.all));
+
+            if (!single)
+            {
+                folded.push_back(child);
+                continue;
+            }
+
+            if (!target.has_value())
+            {
+                target = child;
+                folded.push_back(child);
+                continue;
+            }
+
+            auto& into = m_program.GetPredicate(m_nodes[*target].predicate);
+
+            ToSet(into);
+            ToSet(predicate);
+
+            into.all = true;
+            into.string_set.merge(predicate.string_set);
+        }
+
+        children = std::move(folded);
+    }
+
+    std::size_t Test(Predicate predicate)
+    {
+        m_nodes.push_back(Node{ .kind = Node::Kind::Test, .predicate = m_program.AddPredicate(std::move(predicate)) });
+        return m_nodes.size() - 1;
+    }
+
+    Program& m_program;
+    std::vector<Node>& m_nodes;
+};
+
+// Walks the ANTLR parse tree. Kept as the reference implementation of the grammar.
+class Visitor : public PorlaQueryLangBaseVisitor
+{
+public:
+    explicit Visitor(Builder& builder)
+        : m_builder(builder)
+    {
+    }
+
+    antlrcpp::Any visitAndExpression(PorlaQueryLangParser::AndExpressionContext* context) override
+    {
+        return Combine(Node::Kind::And, context->expression());
+    }
+
+    antlrcpp::Any visitFilter(PorlaQueryLangParser::FilterContext* context) override
+    {
+        return this->visit(context->expression());
+    }
+
+    antlrcpp::Any visitFlag(PorlaQueryLangParser::FlagContext* context) override
+    {
+        const auto reference = std::any_cast<std::string>(this->visit(context->reference()));
+        return m_builder.Flag(reference, context->getStart()->getCharPositionInLine());
+    }
+
+    antlrcpp::Any visitFlagExpression(PorlaQueryLangParser::FlagExpressionContext* context) override
+    {
+        return this->visit(context->flag());
+    }
+
+    antlrcpp::Any visitNotFlagExpression(PorlaQueryLangParser::NotFlagExpressionContext* context) override
+    {
+        return m_builder.Not(std::any_cast<std::size_t>(this->visit(context->flag())));
+    }
+
+    antlrcpp::Any visitOperator(PorlaQueryLangParser::OperatorContext* context) override
+    {
+        if (context->OPER_CONTAINS()) return Oper::CONTAINS;
+        // By text, as the generated parser in _aux predates OPER_MATCHES.
+        if (context->getText() == "matches") return Oper::MATCHES;
+        if (context->OPER_EQ()) return Oper::EQ;
+        if (context->OPER_GT()) return Oper::GT;
+        if (context->OPER_GTE()) return Oper::GTE;
+        if (context->OPER_LT()) return Oper::LT;
+        if (context->OPER_LTE()) return Oper::LTE;
+        throw QueryError("Invalid operator: " + context->getText());
+    }
+
+    antlrcpp::Any visitOperatorPredicate(PorlaQueryLangParser::OperatorPredicateContext* context) override
+    {
+        const auto pos       = context->getStart()->getCharPositionInLine();
+        const auto reference = std::any_cast<std::string>(this->visit(context->reference()));
+        const auto oper      = std::any_cast<Oper>(this->visit(context->operator_()));
+        const auto value     = std::any_cast<ValueVariant>(this->visit(context->value()));
+
+        return m_builder.Comparison(reference, oper, value, pos);
+    }
+
+    antlrcpp::Any visitOrExpression(PorlaQueryLangParser::OrExpressionContext* context) override
+    {
+        return Combine(Node::Kind::Or, context->expression());
+    }
+
+    antlrcpp::Any visitPredicateExpression(PorlaQueryLangParser::PredicateExpressionContext* context) override
+    {
+        return this->visit(context->predicate());
+    }
+
+    antlrcpp::Any visitReference(PorlaQueryLangParser::ReferenceContext* context) override
+    {
+        return context->getText();
+    }
+
+    antlrcpp::Any visitValue(PorlaQueryLangParser::ValueContext* context) override
+    {
+        if (const auto float_value = context->FLOAT())
+        {
+            return ValueVariant(std::stof(float_value->getText()));
+        }
+
+        if (const auto int_value = context->INT())
+        {
+            std::string unit;
+
+            if (auto duration = context->UNIT_DURATION()) unit = duration->getText();
+            if (auto size = context->UNIT_SIZE())         unit = size->getText();
+            if (auto speed = context->UNIT_SPEED())       unit = speed->getText();
+
+            return Builder::IntValue(int_value->getText(), unit);
+        }
+
+        if (const auto string_value = context->STRING())
+        {
+            return Builder::StringValue(string_value->getText());
+        }
+
+        throw QueryError("Invalid value type", context->getStart()->getCharPositionInLine());
+    }
+
+private:
+    std::size_t Combine(Node::Kind kind, const std::vector<PorlaQueryLangParser::ExpressionContext*>& expressions)
+    {
+        const auto lhs = std::any_cast<std::size_t>(this->visit(expressions[0]));
+        const auto rhs = std::any_cast<std::size_t>(this->visit(expressions[1]));
+
+        return m_builder.Combine(kind, lhs, rhs);
+    }
+
+    Builder& m_builder;
+};
+
+// A recursive-descent parser for the same grammar, without the ANTLR runtime. Tokens are
+// views into the input, so nothing is allocated besides the program itself. It also
+// accepts 'reference in [value, ...]', parentheses and the aggregates over files and
+// peers, and rejects trailing input instead of ignoring it.
+class Parser
+{
+public:
+    explicit Parser(std::string_view input, Builder& builder)
+        : m_input(input)
+        , m_builder(builder)
+        , m_offset(0)
+    {
+        m_token = Lex();
+    }
+
+    std::size_t ParseFilter()
+    {
+        const auto root = ParseOr();
+
+        if (m_token.type != Token::Type::End)
+        {
+            Fail(m_token, "extraneous input " + Quote(m_token) + " expecting <EOF>");
+        }
+
+        return root;
+    }
+
+private:
+    struct Token
+    {
+        enum class Type
+        {
+            And,
+            Comma,
+            Contains,
+            End,
+            Eq,
+            Float,
+            Gt,
+            Gte,
+            Id,
+            In,
+            Int,
+            Is,
+            LBracket,
+            LParen,
+            Lt,
+            Lte,
+            Matches,
+            Not,
+            Or,
+            RBracket,
+            RParen,
+            String,
+            Unit
+        };
+
+        Type             type;
+        std::string_view text;
+        std::size_t      offset;
+    };
+
+    // Same as ANTLR's charPositionInLine.
+    [[nodiscard]] std::size_t Column(std::size_t offset) const
+    {
+        const auto newline = m_input.rfind('\n', offset == 0 ? 0 : offset - 1);
+        return newline == std::string_view::npos || newline >= offset ? offset : offset - newline - 1;
+    }
+
+    [[noreturn]] void Fail(const Token& token, const std::string& message) const
+    {
+        throw QueryError(message, Column(token.offset));
+    }
+
+    static std::string Quote(const Token& token)
+    {
+        return token.type == Token::Type::End
+            ? "'<EOF>'"
+            : "'" + std::string(token.text) + "'";
+    }
+
+    Token Lex()
+    {
+        while (m_offset < m_input.size() && std::strchr(" \t\r\n", m_input[m_offset]) != nullptr)
+        {
+            m_offset++;
+        }
+
+        const auto start = m_offset;
+
+        const auto token = [&](Token::Type type, std::size_t length)
+        {
+            m_offset = start + length;
+            return Token{ .type = type, .text = m_input.substr(start, length), .offset = start };
+        };
+
+        if (start >= m_input.size())
+        {
+            return token(Token::Type::End, 0);
+        }
+
+        const auto rest  = m_input.substr(start);
+        const auto digit = [&](std::size_t i) { return i < rest.size() && std::isdigit(static_cast<unsigned char>(rest[i])); };
+        const auto alpha = [&](std::size_t i) { return i < rest.size() && (std::isalpha(static_cast<unsigned char>(rest[i])) || rest[i] == '_'); };
+
+        switch (rest[0])
+        {
+        case '=': return token(Token::Type::Eq, 1);
+        case '>': return rest.starts_with(">=") ? token(Token::Type::Gte, 2) : token(Token::Type::Gt, 1);
+        case '<': return rest.starts_with("<=") ? token(Token::Type::Lte, 2) : token(Token::Type::Lt, 1);
+        case '[': return token(Token::Type::LBracket, 1);
+        case ']': return token(Token::Type::RBracket, 1);
+        case '(': return token(Token::Type::LParen, 1);
+        case ')': return token(Token::Type::RParen, 1);
+        case ',': return token(Token::Type::Comma, 1);
+        case '"':
+        {
+            const auto end = rest.find('"', 1);
+
+            if (end == std::string_view::npos)
+            {
+                throw QueryError("token recognition error at: '" + std::string(rest) + "'", Column(start));
+            }
+
+            return token(Token::Type::String, end + 1);
+        }
+        default:
+            break;
+        }
+
+        if (digit(0) || (rest[0] == '-' && digit(1)))
+        {
+            std::size_t i = rest[0] == '-' ? 1 : 0;
+            while (digit(i)) i++;
+
+            if (i < rest.size() && rest[i] == '.' && digit(i + 1))
+            {
+                i++;
+                while (digit(i)) i++;
+
+                return token(Token::Type::Float, i);
+            }
+
+            return token(Token::Type::Int, i);
+        }
+
+        if (alpha(0))
+        {
+            std::size_t i = 0;
+            while (alpha(i)) i++;
+
+            const auto word = rest.substr(0, i);
+
+            if (word == "is" && i < rest.size() && rest[i] == ':') return token(Token::Type::Is, 3);
+
+            if (word == "and")      return token(Token::Type::And, i);
+            if (word == "contains") return token(Token::Type::Contains, i);
+            if (word == "in")       return token(Token::Type::In, i);
+            if (word == "matches")  return token(Token::Type::Matches, i);
+            if (word == "not")      return token(Token::Type::Not, i);
+            if (word == "or")       return token(Token::Type::Or, i);
+
+            static constexpr std::string_view units[] =
+            {
+                "s", "m", "h", "d", "w",
+                "b", "kb", "mb", "gb", "tb", "pb",
+                "bps", "kbps", "mbps", "gbps"
+            };
+
+            if (std::find(std::begin(units), std::end(units), word) != std::end(units))
+            {
+                return token(Token::Type::Unit, i);
+            }
+
+            return token(Token::Type::Id, i);
+        }
+
+        throw QueryError("token recognition error at: '" + std::string(rest.substr(0, 1)) + "'", Column(start));
+    }
+
+    Token Advance()
+    {
+        auto current = m_token;
+        m_token = Lex();
+        return current;
+    }
+
+    Token Expect(Token::Type type, const char* expecting)
+    {
+        if (m_token.type != type)
+        {
+            Fail(m_token, "mismatched input " + Quote(m_token) + " expecting " + expecting);
+        }
+
+        return Advance();
+    }
+
+    // and binds tighter than or, matching the order of the alternatives in the grammar.
+    std::size_t ParseOr()
+    {
+        auto lhs = ParseAnd();
+
+        while (m_token.type == Token::Type::Or)
+        {
+            Advance();
+            lhs = m_builder.Combine(Node::Kind::Or, lhs, ParseAnd());
+        }
+
+        return lhs;
+    }
+
+    std::size_t ParseAnd()
+    {
+        auto lhs = ParsePrimary();
+
+        while (m_token.type == Token::Type::And)
+        {
+            Advance();
+            lhs = m_builder.Combine(Node::Kind::And, lhs, ParsePrimary());
+        }
+
+        return lhs;
+    }
+
+    std::size_t ParsePrimary()
+    {
+        switch (m_token.type)
+        {
+        case Token::Type::LParen:
+        {
+            Advance();
+            const auto inner = ParseOr();
+            Expect(Token::Type::RParen, "')'");
+
+            return inner;
+        }
+        case Token::Type::Is:
+            return ParseFlag();
+        case Token::Type::Not:
+            Advance();
+
+            if (m_token.type != Token::Type::Is)
+            {
+                Fail(m_token, "mismatched input " + Quote(m_token) + " expecting 'is:'");
+            }
+
+            return m_builder.Not(ParseFlag());
+        case Token::Type::Id:
+            return ParsePredicate();
+        default:
+            Fail(m_token, "no viable alternative at input " + Quote(m_token));
+        }
+    }
+
+    std::size_t ParseFlag()
+    {
+        const auto start = Advance();
+        const auto reference = Expect(Token::Type::Id, "ID");
+
+        return m_builder.Flag(std::string(reference.text), Column(start.offset));
+    }
+
+    [[nodiscard]] std::optional<Oper> Operator() const
+    {
+        switch (m_token.type)
+        {
+        case Token::Type::Contains: return Oper::CONTAINS;
+        case Token::Type::Eq:       return Oper::EQ;
+        case Token::Type::Gt:       return Oper::GT;
+        case Token::Type::Gte:      return Oper::GTE;
+        case Token::Type::Lt:       return Oper::LT;
+        case Token::Type::Lte:      return Oper::LTE;
+        case Token::Type::Matches:  return Oper::MATCHES;
+        default:                    return std::nullopt;
+        }
+    }
+
+    Oper ExpectOperator()
+    {
+        const auto oper = Operator();
+
+        if (!oper.has_value())
+        {
+            Fail(m_token, "mismatched input " + Quote(m_token) + " expecting operator");
+        }
+
+        Advance();
+        return *oper;
+    }
+
+    // function(list[, test and test ...]), followed by a comparison unless it is any().
+    std::size_t ParseAggregate(const Token& function)
+    {
+        const auto pos = Column(function.offset);
+
+        Expect(Token::Type::LParen, "'('");
+
+        const auto list = std::string(Expect(Token::Type::Id, "ID").text);
+        std::vector<Predicate> where;
+
+        if (m_token.type == Token::Type::Comma)
+        {
+            do
+            {
+                Advance();
+
+                const auto reference = Expect(Token::Type::Id, "ID");
+                const auto oper = ExpectOperator();
+
+                where.push_back(Builder::ItemComparison(list, std::string(reference.text), oper, ParseValue(), Column(reference.offset)));
+            }
+            while (m_token.type == Token::Type::And);
+        }
+
+        Expect(Token::Type::RParen, "')'");
+
+        if (function.text == "any")
+        {
+            return m_builder.ListAggregate("any", list, std::move(where), Oper::GTE, std::int64_t{1}, pos);
+        }
+
+        const auto oper = ExpectOperator();
+
+        return m_builder.ListAggregate(std::string(function.text), list, std::move(where), oper, ParseValue(), pos);
+    }
+
+    std::size_t ParsePredicate()
+    {
+        const auto reference = Advance();
+        const auto pos = Column(reference.offset);
+
+        if (m_token.type == Token::Type::LParen)
+        {
+            return ParseAggregate(reference);
+        }
+
+        if (m_token.type == Token::Type::In)
+        {
+            Advance();
+            Expect(Token::Type::LBracket, "'['");
+
+            std::vector<ValueVariant> values = { ParseValue() };
+
+            while (m_token.type == Token::Type::Comma)
+            {
+                Advance();
+                values.push_back(ParseValue());
+            }
+
+            Expect(Token::Type::RBracket, "']'");
+
+            return m_builder.In(std::string(reference.text), values, pos);
+        }
+
+        const auto oper = ExpectOperator();
+
+        return m_builder.Comparison(std::string(reference.text), oper, ParseValue(), pos);
+    }
+
+    ValueVariant ParseValue()
+    {
+        switch (m_token.type)
+        {
+        case Token::Type::Float:
+            return std::stof(std::string(Advance().text));
+        case Token::Type::Int:
+        {
+            const auto value = Advance();
+            const auto unit  = m_token.type == Token::Type::Unit ? Advance().text : std::string_view();
+
+            return Builder::IntValue(std::string(value.text), std::string(unit));
+        }
+        case Token::Type::String:
+            return Builder::StringValue(std::string(Advance().text));
+        default:
+            Fail(m_token, "no viable alternative at input " + Quote(m_token));
+        }
+    }
+
+    std::string_view m_input;
+    Builder& m_builder;
+    std::size_t m_offset;
+    Token m_token;
+};
+
+static std::unique_ptr<PQL::Filter> Compile(std::unique_ptr<Program> program, std::vector<Node> nodes, std::size_t root)
+{
+    Optimize(*program, nodes, root);
+    program->Compile(std::move(nodes), root);
+
+    return program;
+}
+
+std::unique_ptr<PQL::Filter> PQL::Parse(const std::string_view& input)
+{
+    auto program = std::make_unique<Program>();
+    std::vector<Node> nodes;
+
+    Builder builder(*program, nodes);
+    const auto root = Parser(input, builder).ParseFilter();
+
+    return Compile(std::move(program), std::move(nodes), root);
+}
+
+std::unique_ptr<PQL::Filter> PQL::ParseAntlr(const std::string_view& input)
+{
+    ExceptionErrorListener errorListener;
+
+    antlr4::ANTLRInputStream inputStream(input);
+    PorlaQueryLangLexer lexer{&inputStream};
+    lexer.removeErrorListeners();
+    lexer.addErrorListener(&errorListener);
 
     antlr4::CommonTokenStream tokens(&lexer);
 
@@ -435,7 +2268,37 @@ std::unique_ptr<PQL::Filter> PQL::Parse(const std::string_view &input)
     parser.removeErrorListeners();
     parser.addErrorListener(&errorListener);
 
-    Visitor visitor;
-    return std::make_unique<PqlFilter>(
-        std::any_cast<TorrentStatusFilter>(visitor.visitFilter(parser.filter())));
+    auto program = std::make_unique<Program>();
+    std::vector<Node> nodes;
+
+    Builder builder(*program, nodes);
+    Visitor visitor(builder);
+    const auto root = std::any_cast<std::size_t>(visitor.visitFilter(parser.filter()));
+
+    return Compile(std::move(program), std::move(nodes), root);
+}
+
+std::shared_ptr<PQL::Filter> PQL::ParseCached(const std::string_view& input)
+{
+    static std::mutex cache_mutex;
+    static porla::Utils::LruCache<std::string, std::shared_ptr<Filter>> cache(256);
+
+    const std::string key(input);
+
+    {
+        std::unique_lock<std::mutex> lock(cache_mutex);
+
+        if (auto filter = cache.Get(key))
+        {
+            return *filter;
+        }
+    }
+
+    // Parse outside the lock. Invalid queries throw and are never cached.
+    std::shared_ptr<Filter> filter = Parse(input);
+
+    std::unique_lock<std::mutex> lock(cache_mutex);
+    cache.Put(key, filter);
+
+    return filter;
 }
@@ -3,11 +3,17 @@
 #include <exception>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <vector>
 
+#include <libtorrent/socket.hpp>
 #include <libtorrent/torrent_status.hpp>
 #include <utility>
 
+#include "columns.hpp"
+
 namespace porla::Query
 {
     class QueryError : public std::runtime_error
@@ -30,12 +36,84 @@ namespace porla::Query
     class PQL
     {
     public:
+        typedef std::set<libtorrent::info_hash_t> HashSet;
+
+        // Exact lookups of the torrents with a given category, save path or tag, and
+        // supersets of the torrents whose name or save path contains a string. The latter
+        // return nullopt when the index cannot narrow it down.
+        struct Index
+        {
+            virtual ~Index() = default;
+            [[nodiscard]] virtual const HashSet& Category(const std::string& category) const = 0;
+            [[nodiscard]] virtual const HashSet& SavePath(const std::string& save_path) const = 0;
+            [[nodiscard]] virtual const HashSet& Tag(const std::string& tag) const = 0;
+            [[nodiscard]] virtual std::optional<HashSet> NameContains(const std::string& value) const { return std::nullopt; }
+            [[nodiscard]] virtual std::optional<HashSet> SavePathContains(const std::string& value) const { return std::nullopt; }
+        };
+
+        // Smoothed payload rates in bytes per second, for the *_avg fields. Without them,
+        // those fields are the instantaneous payload rates of the status.
+        struct Rates
+        {
+            virtual ~Rates() = default;
+            [[nodiscard]] virtual double Download(const libtorrent::torrent_status& ts) const = 0;
+            [[nodiscard]] virtual double Upload(const libtorrent::torrent_status& ts) const = 0;
+        };
+
+        struct Peer
+        {
+            libtorrent::tcp::endpoint endpoint;
+            std::string               client;
+            int                       download_rate;
+            int                       upload_rate;
+        };
+
+        // The last sampled peers of each torrent, for the peer aggregates. Without them, or
+        // for torrents not sampled yet, those aggregates match nothing.
+        struct Peers
+        {
+            virtual ~Peers() = default;
+            [[nodiscard]] virtual const std::vector<Peer>* Sampled(const libtorrent::info_hash_t& hash) const = 0;
+        };
+
         struct Filter
         {
             virtual ~Filter() = default;
             virtual bool Includes(const libtorrent::torrent_status& ts) = 0;
+            virtual bool Includes(const libtorrent::torrent_status& ts, const Rates& rates) { return Includes(ts); }
+            // With whichever of the rates and the peers there are.
+            virtual bool Includes(const libtorrent::torrent_status& ts, const Rates* rates, const Peers* peers)
+            {
+                return rates != nullptr ? Includes(ts, *rates) : Includes(ts);
+            }
+
+            // Uses the index to find every torrent that may match, or returns an empty
+            // optional if the query needs a full scan. Candidates are checked with
+            // IncludesCandidate, which skips the predicates the index already answered.
+            [[nodiscard]] virtual std::optional<HashSet> Candidates(const Index& index) const { return std::nullopt; }
+            virtual bool IncludesCandidate(const libtorrent::torrent_status& ts) { return Includes(ts); }
+            virtual bool IncludesCandidate(const libtorrent::torrent_status& ts, const Rates& rates) { return Includes(ts, rates); }
+            virtual bool IncludesCandidate(const libtorrent::torrent_status& ts, const Rates* rates, const Peers* peers)
+            {
+                return rates != nullptr ? IncludesCandidate(ts, *rates) : IncludesCandidate(ts);
+            }
+
+            // Evaluates the query over every row of the columns at once. Returns false if
+            // the query tests anything that is not kept in a column.
+            virtual bool Select(const Columns& columns, Bitmap& selection) const { return false; }
+
+            // True if the result can change without the torrent changing, as with age.
+            [[nodiscard]] virtual bool UsesClock() const { return false; }
         };
 
         static std::unique_ptr<Filter> Parse(const std::string_view& input);
+
+        // Parses with the ANTLR generated parser instead. Slower, and kept as the reference
+        // the hand-written parser is tested against.
+        static std::unique_ptr<Filter> ParseAntlr(const std::string_view& input);
+
+        // Same as Parse, but keeps a bounded cache of compiled filters keyed by the query
+        // text so repeated queries skip the lexer, parser and visitor entirely.
+        static std::shared_ptr<Filter> ParseCached(const std::string_view& input);
     };
 }
@@ -0,0 +1,571 @@
+#include "regex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string>
+
+using porla::Query::Regex;
+
+// Bounds the program, and so the time and memory per input byte, for patterns like
+// (a{1000}){1000}.
+static constexpr std::size_t MaxInstructions = 10000;
+static constexpr int         MaxRepeat       = 1000;
+
+// The parsed pattern. Repeats are expanded as they are emitted, so it is the program
+// which is held to the limit rather than the pattern.
+struct Regex::Node
+{
+    enum class Kind
+    {
+        Alternate,
+        Begin,
+        Class,
+        Concat,
+        End,
+        Repeat
+    };
+
+    Kind              kind;
+    std::uint32_t     cls = 0;
+    int               min = 0;
+    int               max = 0; // -1 for no limit
+    std::vector<Node> children;
+};
+
+class Regex::Compiler
+{
+public:
+    Compiler(Regex& regex, std::string_view pattern)
+        : m_regex(regex)
+        , m_pattern(pattern)
+        , m_pos(0)
+        , m_icase(false)
+    {
+        if (m_pattern.starts_with("(?i)"))
+        {
+            m_icase = true;
+            m_pos   = 4;
+        }
+    }
+
+    void Compile()
+    {
+        const auto root = ParseAlternate();
+
+        if (m_pos < m_pattern.size())
+        {
+            Fail("unmatched ')'");
+        }
+
+        Emit(root);
+        Push(Instruction::Code::Match);
+    }
+
+private:
+    [[noreturn]] void Fail(const std::string& message) const
+    {
+        throw std::invalid_argument(message + " at " + std::to_string(m_pos));
+    }
+
+    [[nodiscard]] bool Peek(char c) const
+    {
+        return m_pos < m_pattern.size() && m_pattern[m_pos] == c;
+    }
+
+    Node ParseAlternate()
+    {
+        std::vector<Node> alternatives = { ParseConcat() };
+
+        while (Peek('|'))
+        {
+            m_pos++;
+            alternatives.push_back(ParseConcat());
+        }
+
+        if (alternatives.size() == 1)
+        {
+            return std::move(alternatives[0]);
+        }
+
+        return Node{ .kind = Node::Kind::Alternate, .children = std::move(alternatives) };
+    }
+
+    Node ParseConcat()
+    {
+        Node node{ .kind = Node::Kind::Concat };
+
+        while (m_pos < m_pattern.size() && !Peek('|') && !Peek(')'))
+        {
+            node.children.push_back(ParseRepeat());
+        }
+
+        return node;
+    }
+
+    Node ParseRepeat()
+    {
+        auto atom = ParseAtom();
+
+        while (m_pos < m_pattern.size())
+        {
+            int min;
+            int max;
+
+            switch (m_pattern[m_pos])
+            {
+            case '*': min = 0; max = -1; m_pos++; break;
+            case '+': min = 1; max = -1; m_pos++; break;
+            case '?': min = 0; max = 1;  m_pos++; break;
+            case '{': ParseCount(min, max); break;
+            default:
+                return atom;
+            }
+
+            // Lazy and greedy repeats match the same inputs.
+            if (Peek('?')) { m_pos++; }
+
+            atom = Node{ .kind = Node::Kind::Repeat, .min = min, .max = max, .children = { std::move(atom) } };
+        }
+
+        return atom;
+    }
+
+    // {n}, {n,} or {n,m}.
+    void ParseCount(int& min, int& max)
+    {
+        m_pos++;
+
+        const auto number = [this]() -> int
+        {
+            const auto start = m_pos;
+            long value = 0;
+
+            while (m_pos < m_pattern.size() && std::isdigit(static_cast<unsigned char>(m_pattern[m_pos])))
+            {
+                value = std::min<long>(value * 10 + (m_pattern[m_pos++] - '0'), MaxRepeat + 1);
+            }
+
+            return m_pos == start ? -1 : static_cast<int>(value);
+        };
+
+        min = number();
+        max = min;
+
+        if (min < 0)
+        {
+            Fail("invalid repeat");
+        }
+
+        if (Peek(','))
+        {
+            m_pos++;
+            max = number();
+        }
+
+        if (!Peek('}'))
+        {
+            Fail("invalid repeat");
+        }
+
+        m_pos++;
+
+        if (min > MaxRepeat || max > MaxRepeat || (max >= 0 && max < min))
+        {
+            Fail("invalid repeat");
+        }
+    }
+
+    Node ParseAtom()
+    {
+        const char c = m_pattern[m_pos++];
+
+        switch (c)
+        {
+        case '(':
+        {
+            if (m_pattern.substr(m_pos).starts_with("?:")) { m_pos += 2; }
+
+            auto node = ParseAlternate();
+
+            if (!Peek(')'))
+            {
+                Fail("missing ')'");
+            }
+
+            m_pos++;
+            return node;
+        }
+        case '[':
+            return Class(ParseClass());
+        case '.':
+        {
+            std::bitset<256> any;
+            any.set();
+            any.reset('\n');
+
+            return Class(any);
+        }
+        case '^':
+            return Node{ .kind = Node::Kind::Begin };
+        case '$':
+            return Node{ .kind = Node::Kind::End };
+        case '\\':
+            return Class(ParseEscape());
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            m_pos--;
+            Fail("nothing to repeat");
+        default:
+            return Class(Literal(c));
+        }
+    }
+
+    std::bitset<256> ParseClass()
+    {
+        std::bitset<256> set;
+        bool negate = false;
+
+        if (Peek('^'))
+        {
+            negate = true;
+            m_pos++;
+        }
+
+        // A ']' first in the class is a literal.
+        for (bool first = true; ; first = false)
+        {
+            if (m_pos >= m_pattern.size())
+            {
+                Fail("missing ']'");
+            }
+
+            const auto lo = static_cast<unsigned char>(m_pattern[m_pos]);
+
+            if (lo == ']' && !first)
+            {
+                m_pos++;
+                break;
+            }
+
+            if (lo == '\\')
+            {
+                m_pos++;
+                set |= ParseEscape();
+                continue;
+            }
+
+            m_pos++;
+
+            if (Peek('-') && m_pos + 1 < m_pattern.size() && m_pattern[m_pos + 1] != ']')
+            {
+                const auto hi = static_cast<unsigned char>(m_pattern[m_pos + 1]);
+
+                if (hi < lo)
+                {
+                    Fail("invalid range");
+                }
+
+                for (unsigned int b = lo; b <= hi; b++) { set |= Literal(static_cast<char>(b)); }
+
+                m_pos += 2;
+                continue;
+            }
+
+            set |= Literal(static_cast<char>(lo));
+        }
+
+        return negate ? ~set : set;
+    }
+
+    std::bitset<256> ParseEscape()
+    {
+        if (m_pos >= m_pattern.size())
+        {
+            Fail("trailing '\\'");
+        }
+
+        const char c = m_pattern[m_pos++];
+
+        const auto of = [](int (*predicate)(int), bool negate)
+        {
+            std::bitset<256> set;
+
+            // Bytes of multi-byte characters are in none of the classes.
+            for (int b = 0; b < 128; b++)
+            {
+                set[b] = predicate(b) != 0;
+            }
+
+            return negate ? ~set : set;
+        };
+
+        switch (c)
+        {
+        case 'd': return of(std::isdigit, false);
+        case 'D': return of(std::isdigit, true);
+        case 's': return of(std::isspace, false);
+        case 'S': return of(std::isspace, true);
+        case 'w': return Word(false);
+        case 'W': return Word(true);
+        case 'n': return Literal('\n');
+        case 'r': return Literal('\r');
+        case 't': return Literal('\t');
+        default:
+            break;
+        }
+
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            m_pos--;
+            Fail(std::string("unsupported escape '\\") + c + "'");
+        }
+
+        return Literal(c);
+    }
+
+    static std::bitset<256> Word(bool negate)
+    {
+        std::bitset<256> set;
+
+        for (int b = 0; b < 128; b++)
+        {
+            set[b] = std::isalnum(b) != 0 || b == '_';
+        }
+
+        return negate ? ~set : set;
+    }
+
+    [[nodiscard]] std::bitset<256> Literal(char c) const
+    {
+        std::bitset<256> set;
+        const auto b = static_cast<unsigned char>(c);
+
+        set.set(b);
+
+        if (m_icase && b < 128)
+        {
+            set.set(std::tolower(b));
+            set.set(std::toupper(b));
+        }
+
+        return set;
+    }
+
+    Node Class(const std::bitset<256>& set)
+    {
+        m_regex.m_classes.push_back(set);
+        return Node{ .kind = Node::Kind::Class, .cls = static_cast<std::uint32_t>(m_regex.m_classes.size() - 1) };
+    }
+
+    std::size_t Push(Instruction::Code code, std::uint32_t x = 0)
+    {
+        auto& program = m_regex.m_code;
+
+        if (program.size() >= MaxInstructions)
+        {
+            throw std::invalid_argument("pattern is too large");
+        }
+
+        program.push_back(Instruction{ .code = code, .x = x });
+        return program.size() - 1;
+    }
+
+    [[nodiscard]] std::uint32_t Next() const
+    {
+        return static_cast<std::uint32_t>(m_regex.m_code.size());
+    }
+
+    void Emit(const Node& node)
+    {
+        auto& program = m_regex.m_code;
+
+        switch (node.kind)
+        {
+        case Node::Kind::Begin:
+            Push(Instruction::Code::Begin);
+            return;
+        case Node::Kind::Class:
+            Push(Instruction::Code::Byte, node.cls);
+            return;
+        case Node::Kind::Concat:
+            for (const auto& child : node.children) { Emit(child); }
+            return;
+        case Node::Kind::End:
+            Push(Instruction::Code::End);
+            return;
+        case Node::Kind::Alternate:
+        {
+            std::vector<std::size_t> jumps;
+
+            for (std::size_t i = 0; i < node.children.size(); i++)
+            {
+                if (i + 1 == node.children.size())
+                {
+                    Emit(node.children[i]);
+                    break;
+                }
+
+                const auto split = Push(Instruction::Code::Split, Next() + 1);
+                Emit(node.children[i]);
+                jumps.push_back(Push(Instruction::Code::Jump));
+                program[split].y = Next();
+            }
+
+            for (const auto jump : jumps) { program[jump].x = Next(); }
+            return;
+        }
+        case Node::Kind::Repeat:
+        {
+            const auto& child = node.children[0];
+
+            for (int i = 0; i < node.min; i++) { Emit(child); }
+
+            if (node.max < 0)
+            {
+                const auto loop = Push(Instruction::Code::Split, Next() + 1);
+                Emit(child);
+                Push(Instruction::Code::Jump, static_cast<std::uint32_t>(loop));
+                program[loop].y = Next();
+                return;
+            }
+
+            // Each optional copy may skip to the end.
+            std::vector<std::size_t> splits;
+
+            for (int i = node.min; i < node.max; i++)
+            {
+                splits.push_back(Push(Instruction::Code::Split, Next() + 1));
+                Emit(child);
+            }
+
+            for (const auto split : splits) { program[split].y = Next(); }
+            return;
+        }
+        }
+    }
+
+    Regex& m_regex;
+    std::string_view m_pattern;
+    std::size_t m_pos;
+    bool m_icase;
+};
+
+Regex::Regex(std::string_view pattern)
+{
+    Compiler(*this, pattern).Compile();
+}
+
+bool Regex::Search(std::string_view input) const
+{
+    // Sparse sets of the program counters at this byte and the next, which need no
+    // clearing between bytes.
+    struct Threads
+    {
+        std::uint32_t* dense;
+        std::uint32_t* sparse;
+        std::uint32_t  count = 0;
+
+        [[nodiscard]] bool Contains(std::uint32_t pc) const
+        {
+            return sparse[pc] < count && dense[sparse[pc]] == pc;
+        }
+
+        void Insert(std::uint32_t pc)
+        {
+            sparse[pc] = count;
+            dense[count++] = pc;
+        }
+    };
+
+    const auto size = m_code.size();
+
+    // Kept between searches, so matching every torrent of a list allocates nothing. The
+    // sparse sets work with whatever an earlier search left in them.
+    thread_local std::vector<std::uint32_t> buffer;
+    thread_local std::vector<std::uint32_t> stack;
+
+    buffer.resize(std::max(buffer.size(), size * 4));
+    stack.clear();
+
+    Threads current{ .dense = buffer.data(),            .sparse = buffer.data() + size };
+    Threads next{    .dense = buffer.data() + size * 2, .sparse = buffer.data() + size * 3 };
+
+    // Follows the jumps, splits and assertions from pc, adding every thread it reaches.
+    const auto add = [&](Threads& threads, std::uint32_t pc, std::size_t pos)
+    {
+        stack.push_back(pc);
+
+        while (!stack.empty())
+        {
+            pc = stack.back();
+            stack.pop_back();
+
+            if (threads.Contains(pc))
+            {
+                continue;
+            }
+
+            threads.Insert(pc);
+
+            const auto& ins = m_code[pc];
+
+            switch (ins.code)
+            {
+            case Instruction::Code::Begin:
+                if (pos == 0) { stack.push_back(pc + 1); }
+                break;
+            case Instruction::Code::Byte:
+                break;
+            case Instruction::Code::End:
+                if (pos == input.size()) { stack.push_back(pc + 1); }
+                break;
+            case Instruction::Code::Jump:
+                stack.push_back(ins.x);
+                break;
+            case Instruction::Code::Match:
+                stack.clear();
+                return true;
+            case Instruction::Code::Split:
+                stack.push_back(ins.y);
+                stack.push_back(ins.x);
+                break;
+            }
+        }
+
+        return false;
+    };
+
+    for (std::size_t pos = 0; ; pos++)
+    {
+        // A thread starts at every byte, so the pattern may match anywhere.
+        if (add(current, 0, pos))
+        {
+            return true;
+        }
+
+        if (pos == input.size())
+        {
+            return false;
+        }
+
+        const auto b = static_cast<unsigned char>(input[pos]);
+
+        next.count = 0;
+
+        for (std::uint32_t i = 0; i < current.count; i++)
+        {
+            const auto  pc  = current.dense[i];
+            const auto& ins = m_code[pc];
+
+            if (ins.code == Instruction::Code::Byte && m_classes[ins.x][b] && add(next, pc + 1, pos + 1))
+            {
+                return true;
+            }
+        }
+
+        std::swap(current, next);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace porla::Query
+{
+    // Regular expressions matched in time linear to the input, by running every path
+    // through the compiled NFA at once instead of backtracking. Supports literals, '.',
+    // classes, the \d \w \s escapes and their negations, groups, '|', '*', '+', '?',
+    // '{n,m}', '^' and '$'. Matching is on bytes, and case sensitive unless the pattern
+    // starts with (?i).
+    class Regex
+    {
+    public:
+        // Throws std::invalid_argument for invalid patterns, or ones which compile to too
+        // large a program.
+        explicit Regex(std::string_view pattern);
+
+        // True if the pattern matches anywhere in the input.
+        [[nodiscard]] bool Search(std::string_view input) const;
+
+    private:
+        struct Instruction
+        {
+            enum class Code : std::uint8_t
+            {
+                Begin,
+                Byte,
+                End,
+                Jump,
+                Match,
+                Split
+            };
+
+            Code          code;
+            std::uint32_t x = 0; // the class for bytes, otherwise a target
+            std::uint32_t y = 0; // the second target of a split
+        };
+
+        struct Node;
+        class Compiler;
+
+        std::vector<Instruction>      m_code;
+        std::vector<std::bitset<256>> m_classes;
+    };
+}
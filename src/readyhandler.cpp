@@ -0,0 +1,30 @@
+#include "readyhandler.hpp"
+
+#include "json/sysstatus.hpp"
+#include "methods/sysstatus.hpp"
+
+namespace http = boost::beast::http;
+
+using porla::ReadyHandler;
+
+ReadyHandler::ReadyHandler(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void ReadyHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    const auto status = Methods::SysStatus::ToRes(m_session);
+
+    http::response<http::string_body> res{
+        status.ready ? http::status::ok : http::status::service_unavailable,
+        ctx->Request().version()};
+
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "application/json");
+    res.keep_alive(ctx->Request().keep_alive());
+    res.body() = nlohmann::json(status).dump();
+    res.prepare_payload();
+
+    ctx->Write(std::move(res));
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Answers 200 once the stored torrents are loaded and 503 until then, or once the
+    // session drains, with the progress in the body either way. Meant for health checks,
+    // so it needs no token.
+    class ReadyHandler
+    {
+    public:
+        explicit ReadyHandler(ISession& session);
+        void operator()(const std::shared_ptr<HttpContext>&);
+
+    private:
+        ISession& m_session;
+    };
+}
@@ -0,0 +1,244 @@
+#include "recheckqueue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include <libtorrent/torrent_handle.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "session.hpp"
+#include "utils/mounttable.hpp"
+
+namespace lt = libtorrent;
+
+using porla::RecheckQueue;
+
+static std::int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* RecheckQueue::Name(State state)
+{
+    switch (state)
+    {
+    case State::Queued:   return "queued";
+    case State::Checking: return "checking";
+    case State::Checked:  return "checked";
+    case State::Removed:  return "removed";
+    }
+
+    return "unknown";
+}
+
+RecheckQueue::RecheckQueue(porla::ISession& session, porla::RecheckQueueOptions options)
+    : m_session(session)
+    , m_options(options)
+    , m_next(0)
+{
+    m_checkedConnection = m_session.OnTorrentChecked(
+        [this](const lt::torrent_handle& th) { Finish(th.info_hashes(), State::Checked); });
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            Forget(hash);
+            Finish(hash, State::Removed);
+        });
+}
+
+RecheckQueue::~RecheckQueue()
+{
+    m_checkedConnection.disconnect();
+    m_removedConnection.disconnect();
+}
+
+bool RecheckQueue::Enqueue(const lt::info_hash_t& hash, int priority)
+{
+    const auto& statuses = m_session.TorrentStatuses();
+    const auto status = statuses.find(hash);
+
+    if (status == statuses.end())
+    {
+        return false;
+    }
+
+    if (m_checking.contains(hash))
+    {
+        return true;
+    }
+
+    std::uint64_t id;
+
+    if (const auto queued = m_queued.find(hash); queued != m_queued.end())
+    {
+        id = queued->second;
+
+        auto& job = m_jobs.at(id);
+        m_order.erase({ -job.recheck.priority, id });
+        job.recheck.priority = priority;
+    }
+    else
+    {
+        id = m_next++;
+
+        m_jobs.insert({ id, Job{
+            .recheck = Recheck{
+                .info_hash = hash,
+                .priority  = priority,
+                .state     = State::Queued,
+                .queued_at = Now()
+            },
+            // Paths which cannot be resolved share one device, so they are limited together.
+            .device = Utils::MountTable::DeviceId(status->second.save_path).value_or(0)
+        }});
+
+        m_queued.insert({ hash, id });
+    }
+
+    const auto order = m_order.insert({ -priority, id }).first;
+
+    auto recheck = m_jobs.at(id).recheck;
+    recheck.position = static_cast<int>(std::distance(m_order.begin(), order));
+
+    m_changed(recheck);
+
+    Pump();
+
+    return true;
+}
+
+std::vector<RecheckQueue::Recheck> RecheckQueue::List() const
+{
+    const auto& statuses = m_session.TorrentStatuses();
+
+    std::vector<Recheck> rechecks;
+    rechecks.reserve(m_jobs.size());
+
+    for (const auto& [hash, id] : m_checking)
+    {
+        auto& recheck = rechecks.emplace_back(m_jobs.at(id).recheck);
+
+        // Until the next state update, the torrent may not show as checking yet.
+        if (const auto status = statuses.find(hash); status != statuses.end()
+            && status->second.state == lt::torrent_status::checking_files)
+        {
+            recheck.progress = status->second.progress;
+        }
+        else
+        {
+            recheck.progress = 0.f;
+        }
+    }
+
+    int position = 0;
+
+    for (const auto& [priority, id] : m_order)
+    {
+        auto& recheck = rechecks.emplace_back(m_jobs.at(id).recheck);
+        recheck.position = position++;
+    }
+
+    return rechecks;
+}
+
+void RecheckQueue::Finish(const lt::info_hash_t& hash, State state)
+{
+    const auto checking = m_checking.find(hash);
+
+    // Torrents checked when they were added, or rechecked some other way.
+    if (checking == m_checking.end())
+    {
+        return;
+    }
+
+    auto job = std::move(m_jobs.at(checking->second));
+
+    m_jobs.erase(checking->second);
+    m_checking.erase(checking);
+
+    if (auto busy = m_busy.find(job.device); busy != m_busy.end() && --busy->second <= 0)
+    {
+        m_busy.erase(busy);
+    }
+
+    job.recheck.state = state;
+
+    m_changed(job.recheck);
+
+    Pump();
+}
+
+void RecheckQueue::Forget(const lt::info_hash_t& hash)
+{
+    const auto queued = m_queued.find(hash);
+
+    if (queued == m_queued.end())
+    {
+        return;
+    }
+
+    auto job = std::move(m_jobs.at(queued->second));
+
+    m_order.erase({ -job.recheck.priority, queued->second });
+    m_jobs.erase(queued->second);
+    m_queued.erase(queued);
+
+    job.recheck.state = State::Removed;
+
+    m_changed(job.recheck);
+}
+
+void RecheckQueue::Pump()
+{
+    const auto& torrents = m_session.Torrents();
+    const int limit = std::max(1, m_options.per_device);
+
+    std::vector<Recheck> started;
+    std::vector<lt::info_hash_t> gone;
+
+    for (auto it = m_order.begin(); it != m_order.end();)
+    {
+        const auto id = it->second;
+        auto& job = m_jobs.at(id);
+
+        if (const auto busy = m_busy.find(job.device); busy != m_busy.end() && busy->second >= limit)
+        {
+            ++it;
+            continue;
+        }
+
+        if (!torrents.contains(job.recheck.info_hash))
+        {
+            gone.push_back(job.recheck.info_hash);
+            ++it;
+            continue;
+        }
+
+        m_session.Recheck(job.recheck.info_hash);
+        m_busy[job.device]++;
+
+        job.recheck.state      = State::Checking;
+        job.recheck.started_at = Now();
+
+        m_queued.erase(job.recheck.info_hash);
+        m_checking.insert({ job.recheck.info_hash, id });
+
+        started.push_back(job.recheck);
+
+        it = m_order.erase(it);
+    }
+
+    // Signalled after the loop, since subscribers may queue more checks.
+    for (const auto& hash : gone)
+    {
+        Forget(hash);
+    }
+
+    for (const auto& recheck : started)
+    {
+        m_changed(recheck);
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct RecheckQueueOptions
+    {
+        // Torrents hashing their files on one device at the same time.
+        int per_device = 1;
+    };
+
+    // Rechecks torrents in priority order, higher first and in the order they were queued
+    // otherwise, with a limit on how many torrents hash files on a device at once. The
+    // checks themselves go through ISession::Recheck, which resumes paused torrents for it
+    // and puts their flags back once they are checked.
+    class RecheckQueue
+    {
+    public:
+        enum class State
+        {
+            Queued,
+            Checking,
+            Checked,
+            Removed
+        };
+
+        struct Recheck
+        {
+            libtorrent::info_hash_t     info_hash;
+            int                         priority;
+            State                       state;
+            // Among the queued rechecks, counted from zero. Not set once the check has started.
+            std::optional<int>          position;
+            // How much of the torrent has been checked, while it is checking.
+            std::optional<float>        progress;
+            std::int64_t                queued_at;
+            std::optional<std::int64_t> started_at;
+        };
+
+        typedef porla::Utils::Signal<void(const Recheck&)> RecheckSignal;
+
+        static const char* Name(State state);
+
+        explicit RecheckQueue(ISession& session, RecheckQueueOptions options = {});
+        RecheckQueue(const RecheckQueue&) = delete;
+
+        ~RecheckQueue();
+
+        // Returns false if the torrent is not in the session. Queueing a torrent which is
+        // already queued changes its priority, and one which is checking is left alone.
+        bool Enqueue(const libtorrent::info_hash_t& hash, int priority = 0);
+
+        // The running checks followed by the queued ones, in the order they will start.
+        [[nodiscard]] std::vector<Recheck> List() const;
+
+        porla::Utils::Connection OnChanged(const RecheckSignal::slot_type& subscriber)
+        {
+            return m_changed.connect(subscriber);
+        }
+
+    private:
+        struct Job
+        {
+            Recheck       recheck;
+            std::uint64_t device;
+        };
+
+        // Ordered by priority, highest first, and then by id, which grows as checks are queued.
+        typedef std::pair<int, std::uint64_t> OrderKey;
+
+        void Finish(const libtorrent::info_hash_t& hash, State state);
+        void Forget(const libtorrent::info_hash_t& hash);
+        void Pump();
+
+        ISession& m_session;
+        RecheckQueueOptions m_options;
+        std::uint64_t m_next;
+
+        std::map<std::uint64_t, Job> m_jobs;
+        std::set<OrderKey> m_order;
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_queued;
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_checking;
+        // Running checks by the device their files are on.
+        std::map<std::uint64_t, int> m_busy;
+
+        porla::Utils::Connection m_checkedConnection;
+        porla::Utils::Connection m_removedConnection;
+
+        RecheckSignal m_changed;
+    };
+}
@@ -0,0 +1,186 @@
+#include "releaseboost.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+#include <boost/log/trivial.hpp>
+
+#include "peerclass.hpp"
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::ReleaseBoost;
+using porla::ReleaseBoostOptions;
+
+std::string ReleaseBoost::ClassName(int tier)
+{
+    return "porla.release." + std::to_string(tier);
+}
+
+double ReleaseBoost::Decay(std::int64_t since, std::int64_t now, const ReleaseBoostOptions& options)
+{
+    const double window = std::max<double>(1, static_cast<double>(options.window.count()));
+    const double age    = static_cast<double>(std::max<std::int64_t>(0, now - since));
+
+    if (age >= window)
+    {
+        return 0;
+    }
+
+    switch (options.curve)
+    {
+    case ReleaseBoostOptions::Curve::Exponential:
+        return std::exp2(-4 * age / window);
+    case ReleaseBoostOptions::Curve::Linear:
+        return 1 - age / window;
+    }
+
+    return 0;
+}
+
+ReleaseBoost::ReleaseBoost(boost::asio::io_context& io, porla::ISession& session, porla::ReleaseBoostOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(options)
+{
+    m_options.tiers = std::max(1, m_options.tiers);
+
+    for (int tier = 0; tier < m_options.tiers; tier++)
+    {
+        const int priority = static_cast<int>(std::lround(
+            1 + (std::clamp(m_options.max_priority, 1, 255) - 1) * static_cast<double>(m_options.tiers - tier) / m_options.tiers));
+
+        m_session.SetPeerClass(PeerClass{
+            .name                 = ClassName(tier),
+            .download_priority    = priority,
+            .upload_priority      = priority,
+            .ignore_unchoke_slots = tier < m_options.unchoke_tiers
+        });
+    }
+
+    m_addedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts) { Start(ts.info_hashes, ts.added_time); });
+
+    if (m_options.finished)
+    {
+        m_finishedConnection = m_session.OnTorrentFinished(
+            [this](const lt::torrent_status& ts)
+            {
+                Start(ts.info_hashes, ts.completed_time > 0 ? ts.completed_time : std::time(nullptr));
+            });
+    }
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash) { m_boosted.erase(hash); });
+
+    Schedule();
+}
+
+ReleaseBoost::~ReleaseBoost()
+{
+    m_timer.cancel();
+    m_addedConnection.disconnect();
+    m_finishedConnection.disconnect();
+    m_removedConnection.disconnect();
+
+    for (const auto& [hash, boosted] : m_boosted)
+    {
+        if (boosted.tier >= 0) m_session.JoinPeerClass(hash, ClassName(boosted.tier), false);
+    }
+
+    for (int tier = 0; tier < m_options.tiers; tier++)
+    {
+        m_session.RemovePeerClass(ClassName(tier));
+    }
+}
+
+double ReleaseBoost::Boost(const lt::info_hash_t& hash) const
+{
+    const auto boosted = m_boosted.find(hash);
+    return boosted != m_boosted.end() ? boosted->second.boost : 0;
+}
+
+int ReleaseBoost::Priority(const lt::info_hash_t& hash) const
+{
+    return static_cast<int>(std::lround(Boost(hash) * 100));
+}
+
+void ReleaseBoost::Tick(std::int64_t now)
+{
+    for (auto it = m_boosted.begin(); it != m_boosted.end();)
+    {
+        if (!Apply(it->first, it->second, now))
+        {
+            it = m_boosted.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+}
+
+bool ReleaseBoost::Apply(const lt::info_hash_t& hash, Boosted& boosted, std::int64_t now)
+{
+    boosted.boost = Decay(boosted.since, now, m_options);
+
+    const int tier = boosted.boost > 0 ? Tier(boosted.boost) : -1;
+
+    if (tier != boosted.tier)
+    {
+        if (boosted.tier >= 0) m_session.JoinPeerClass(hash, ClassName(boosted.tier), false);
+        if (tier >= 0)         m_session.JoinPeerClass(hash, ClassName(tier), true);
+
+        boosted.tier = tier;
+    }
+
+    return tier >= 0;
+}
+
+void ReleaseBoost::Schedule()
+{
+    m_timer.expires_after(m_options.interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            Tick(std::time(nullptr));
+            Schedule();
+        });
+}
+
+void ReleaseBoost::Start(const lt::info_hash_t& hash, std::int64_t since)
+{
+    const auto now = static_cast<std::int64_t>(std::time(nullptr));
+
+    if (Decay(since, now, m_options) <= 0)
+    {
+        return;
+    }
+
+    // A torrent finishing while boosted from being added starts over from the top.
+    auto [it, inserted] = m_boosted.insert({ hash, Boosted{ .since = since, .boost = 0, .tier = -1 } });
+
+    if (!inserted)
+    {
+        it->second.since = std::max(it->second.since, since);
+    }
+
+    if (!Apply(hash, it->second, now))
+    {
+        m_boosted.erase(it);
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Boosting torrent " << hash.get_best() << " in tier " << it->second.tier;
+}
+
+int ReleaseBoost::Tier(double boost) const
+{
+    return std::clamp(static_cast<int>(std::floor((1 - boost) * m_options.tiers)), 0, m_options.tiers - 1);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct ReleaseBoostOptions
+    {
+        enum class Curve
+        {
+            // Halves every quarter of the window.
+            Exponential,
+            Linear
+        };
+
+        // How long a torrent is boosted after it was added or finished.
+        std::chrono::seconds      window        = std::chrono::seconds(1800);
+        Curve                     curve         = Curve::Exponential;
+        // Peer classes the boost steps down through, the first with max_priority and the
+        // others closer to the priority of 1 every other torrent has.
+        int                       tiers         = 4;
+        int                       max_priority  = 255;
+        // The first tiers, whose peers are unchoked whatever the unchoke slots limit.
+        int                       unchoke_tiers = 1;
+        // Boosts torrents once they are finished too, for seeding in the first minutes.
+        bool                      finished      = true;
+        std::chrono::milliseconds interval      = std::chrono::milliseconds(10000);
+    };
+
+    // Gives torrents a head start right after they were added or finished, when the
+    // swarm is young. The boost starts at one and decays to zero over the window, and the
+    // torrent is moved down through peer classes of falling bandwidth priority as it does,
+    // checked on every interval. The boost counts from the added and completed times of the
+    // torrent, so torrents loaded on start are only boosted for what is left of their window.
+    class ReleaseBoost
+    {
+    public:
+        // The peer class of the tier, counted from zero.
+        static std::string ClassName(int tier);
+        // From one when started to zero once the window has passed.
+        static double Decay(std::int64_t since, std::int64_t now, const ReleaseBoostOptions& options);
+
+        explicit ReleaseBoost(boost::asio::io_context& io, ISession& session, ReleaseBoostOptions options = {});
+        ReleaseBoost(const ReleaseBoost&) = delete;
+
+        ~ReleaseBoost();
+
+        // The boost of the torrent as of the last check, zero if it has none.
+        [[nodiscard]] double Boost(const libtorrent::info_hash_t& hash) const;
+        // The boost from 0 to 100, which is added to the priority of its reannounces.
+        [[nodiscard]] int Priority(const libtorrent::info_hash_t& hash) const;
+        [[nodiscard]] std::size_t Size() const { return m_boosted.size(); }
+
+        // Moves the boosted torrents to the tier of their boost as of now, in unix time, and
+        // drops the ones it has run out for.
+        void Tick(std::int64_t now);
+
+    private:
+        struct Boosted
+        {
+            std::int64_t since;
+            double       boost;
+            // The tier the torrent is in, or -1 before it joined one.
+            int          tier;
+        };
+
+        bool Apply(const libtorrent::info_hash_t& hash, Boosted& boosted, std::int64_t now);
+        void Schedule();
+        void Start(const libtorrent::info_hash_t& hash, std::int64_t since);
+        [[nodiscard]] int Tier(double boost) const;
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        ReleaseBoostOptions m_options;
+
+        std::map<libtorrent::info_hash_t, Boosted> m_boosted;
+
+        porla::Utils::Connection m_addedConnection;
+        porla::Utils::Connection m_finishedConnection;
+        porla::Utils::Connection m_removedConnection;
+    };
+}
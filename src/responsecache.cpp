@@ -0,0 +1,141 @@
+#include "responsecache.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+#include <zlib.h>
+
+#include "utils/string.hpp"
+
+namespace http = boost::beast::http;
+
+using porla::ResponseCache;
+using porla::Utils::Encoding;
+
+// A strong etag from the CRC-32 and size of the body, like the embedded web UI assets.
+static std::string ETag(const std::string& data)
+{
+    const auto crc = crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size()));
+
+    std::stringstream ss;
+    ss << "\"" << std::hex << std::setfill('0') << std::setw(8) << crc << "-" << std::dec << data.size() << "\"";
+    return ss.str();
+}
+
+std::shared_ptr<const nlohmann::json> ResponseCache::Get(const std::string& key, const Builder& build)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return Find(key, build).document;
+}
+
+std::shared_ptr<const ResponseCache::Body> ResponseCache::Encoded(const std::string& key, Encoding::Type type, const Builder& build)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto& entry = Find(key, build);
+    auto& body  = entry.bodies[type];
+
+    if (body == nullptr)
+    {
+        auto data = Encoding::Dump(*entry.document, type);
+        auto etag = ETag(data);
+
+        body = std::make_shared<const Body>(Body{ .data = std::move(data), .etag = std::move(etag) });
+    }
+
+    return body;
+}
+
+void ResponseCache::Invalidate(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_entries.erase(key);
+}
+
+http::response<http::string_body> ResponseCache::Response(
+    const http::request<http::string_body>& req,
+    const std::string& key,
+    const Builder& build)
+{
+    const auto accept = req.find(http::field::accept);
+    const auto type   = accept != req.end()
+        ? Encoding::FromMediaType({accept->value().data(), accept->value().size()})
+        : Encoding::Type::Json;
+
+    const auto body = Encoded(key, type, build);
+
+    http::response<http::string_body> res{http::status::ok, req.version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::cache_control, "no-cache");
+    res.set(http::field::etag, body->etag);
+    res.set(http::field::vary, "Accept");
+    res.keep_alive(req.keep_alive());
+
+    if (const auto inm = req.find(http::field::if_none_match);
+        inm != req.end() && IsNoneMatch({inm->value().data(), inm->value().size()}, body->etag))
+    {
+        res.result(http::status::not_modified);
+        return res;
+    }
+
+    res.set(http::field::content_type, Encoding::MediaType(type));
+    res.body() = body->data;
+    res.prepare_payload();
+
+    return res;
+}
+
+porla::MemoryUsage ResponseCache::Memory() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    MemoryUsage usage;
+
+    for (const auto& [key, entry] : m_entries)
+    {
+        usage.bytes += key.size() + sizeof(Entry);
+        usage.objects++;
+
+        for (const auto& [type, body] : entry.bodies)
+        {
+            usage.bytes += sizeof(Body) + body->data.size() + body->etag.size();
+        }
+    }
+
+    return usage;
+}
+
+bool ResponseCache::IsNoneMatch(std::string_view if_none_match, const std::string& etag)
+{
+    for (auto part : porla::Utils::String::Split(std::string(if_none_match), ","))
+    {
+        while (!part.empty() && part.front() == ' ') part.erase(0, 1);
+        while (!part.empty() && part.back() == ' ')  part.pop_back();
+
+        if (part.starts_with("W/")) part = part.substr(2);
+        if (part == "*" || part == etag) return true;
+    }
+
+    return false;
+}
+
+ResponseCache::Entry& ResponseCache::Find(const std::string& key, const Builder& build)
+{
+    auto [entry, inserted] = m_entries.try_emplace(key);
+
+    if (inserted)
+    {
+        try
+        {
+            entry->second.document = std::make_shared<const nlohmann::json>(build());
+        }
+        catch (...)
+        {
+            // Not kept, so the next call builds it again.
+            m_entries.erase(entry);
+            throw;
+        }
+    }
+
+    return entry->second;
+}
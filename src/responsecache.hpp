@@ -0,0 +1,68 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <boost/beast/http.hpp>
+#include <nlohmann/json.hpp>
+
+#include "memoryusage.hpp"
+#include "utils/encoding.hpp"
+
+namespace porla
+{
+    // Documents of read-mostly endpoints, such as the system status the UI asks for on
+    // every page load, built once and kept until what they are built from is written and
+    // they are invalidated. Each encoding is serialized once too, with a strong etag of its
+    // own, so a client sending it back gets a 304 without the document being touched.
+    // Documents are built with the lock held, so an invalidation is never lost to a build
+    // in progress. Safe to use from any thread.
+    class ResponseCache
+    {
+    public:
+        struct Body
+        {
+            std::string data;
+            std::string etag;
+        };
+
+        typedef std::function<nlohmann::json()> Builder;
+
+        // The document under key, built with build the first time and after it was
+        // invalidated.
+        std::shared_ptr<const nlohmann::json> Get(const std::string& key, const Builder& build);
+
+        // The document serialized as type.
+        std::shared_ptr<const Body> Encoded(const std::string& key, Utils::Encoding::Type type, const Builder& build);
+
+        void Invalidate(const std::string& key);
+
+        // A response with the document in the encoding req accepts, or a 304 if it lists
+        // the etag in If-None-Match. Clients revalidate every time.
+        boost::beast::http::response<boost::beast::http::string_body> Response(
+            const boost::beast::http::request<boost::beast::http::string_body>& req,
+            const std::string& key,
+            const Builder& build);
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+        // True if the If-None-Match header value lists the etag, or is *.
+        static bool IsNoneMatch(std::string_view if_none_match, const std::string& etag);
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<const nlohmann::json> document;
+            std::map<Utils::Encoding::Type, std::shared_ptr<const Body>> bodies;
+        };
+
+        Entry& Find(const std::string& key, const Builder& build);
+
+        mutable std::mutex m_mutex;
+        std::map<std::string, Entry> m_entries;
+    };
+}
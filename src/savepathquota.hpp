@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace porla
+{
+    // A disk budget for the torrents of a category, the torrents under a save path, or the
+    // torrents of a category under a save path. Quotas nest, and a torrent counts against
+    // every quota it matches, so one under /data/tv counts against both /data and /data/tv.
+    struct SavePathQuota
+    {
+        std::string                name;
+        std::optional<std::string> category;
+        // Matches torrents saved in this directory or below it.
+        std::optional<std::string> save_path;
+        std::int64_t               max_size = 0;
+        // One of reject and pause. Reject refuses torrents.add for torrents which would not
+        // fit. Both pause the downloads which do not fit, such as magnet links which turn
+        // out too large once their metadata arrives.
+        std::string                action = "reject";
+    };
+}
@@ -0,0 +1,461 @@
+#include "savepathquotas.hpp"
+
+#include <filesystem>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_handle.hpp>
+
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::SavePathQuotas;
+
+static std::string Normalize(const std::string& path)
+{
+    auto normal = fs::path(path).lexically_normal().string();
+    while (normal.size() > 1 && normal.back() == '/') normal.pop_back();
+    return normal;
+}
+
+static bool Under(const std::string& path, const std::string& root)
+{
+    if (!path.starts_with(root))
+    {
+        return false;
+    }
+
+    return path.size() == root.size() || root.back() == '/' || path[root.size()] == '/';
+}
+
+SavePathQuotas::SavePathQuotas(porla::ISession& session, porla::SavePathQuotasOptions options)
+    : m_session(session)
+    , m_options(std::move(options))
+    , m_next(0)
+{
+    for (auto quota : m_options.quotas)
+    {
+        if (quota.save_path.has_value()) quota.save_path = Normalize(*quota.save_path);
+        m_quotas.push_back(Quota{ .quota = std::move(quota) });
+    }
+
+    for (const auto& [hash, ts] : m_session.TorrentStatuses())
+    {
+        Account(ts);
+    }
+
+    Enforce();
+
+    m_clientDataChangedConnection = m_session.OnClientDataChanged(
+        [this](const std::vector<lt::info_hash_t>& hashes)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+
+            for (const auto& hash : hashes)
+            {
+                if (const auto status = statuses.find(hash); status != statuses.end()) Account(status->second);
+            }
+
+            Enforce();
+        });
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+
+            for (const auto& ts : torrents)
+            {
+                // Updates can arrive for torrents that are already removed.
+                if (statuses.contains(ts.info_hashes)) Account(ts);
+            }
+
+            Enforce();
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved(
+        [this](const lt::torrent_handle& th)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+
+            if (const auto status = statuses.find(th.info_hashes()); status != statuses.end())
+            {
+                Account(status->second);
+                Enforce();
+            }
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts)
+        {
+            Account(ts);
+            Enforce();
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            DropPending(hash);
+            Forget(hash);
+            m_paused.erase(hash);
+            Enforce();
+        });
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents) Account(ts);
+            Enforce();
+        });
+}
+
+SavePathQuotas::~SavePathQuotas()
+{
+    m_clientDataChangedConnection.disconnect();
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+}
+
+std::optional<SavePathQuotas::Rejection> SavePathQuotas::Admit(
+    const lt::info_hash_t& hash,
+    const std::optional<std::string>& category,
+    const std::string& save_path,
+    std::int64_t size)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto item = m_pending.begin(); item != m_pending.end();)
+    {
+        if (item->second.expires > now)
+        {
+            ++item;
+            continue;
+        }
+
+        for (const auto index : item->second.quotas) m_quotas[index].pending -= item->second.size;
+        item = m_pending.erase(item);
+    }
+
+    if (size <= 0)
+    {
+        return std::nullopt;
+    }
+
+    const auto quotas = Match(category, save_path);
+
+    for (const auto index : quotas)
+    {
+        const auto& quota = m_quotas[index];
+
+        if (quota.quota.action == "reject" && quota.reserved + quota.pending + size > quota.quota.max_size)
+        {
+            return Rejection{
+                .quota    = quota.quota.name,
+                .max_size = quota.quota.max_size,
+                .reserved = quota.reserved + quota.pending
+            };
+        }
+    }
+
+    if (quotas.empty() || hash == lt::info_hash_t())
+    {
+        return std::nullopt;
+    }
+
+    DropPending(hash);
+
+    for (const auto index : quotas) m_quotas[index].pending += size;
+
+    m_pending.insert({ hash, Pending{
+        .quotas  = quotas,
+        .size    = size,
+        .expires = now + m_options.pending
+    }});
+
+    return std::nullopt;
+}
+
+bool SavePathQuotas::IsOver(const lt::info_hash_t& hash) const
+{
+    const auto torrent = m_torrents.find(hash);
+
+    if (torrent == m_torrents.end())
+    {
+        return false;
+    }
+
+    for (const auto index : torrent->second.quotas)
+    {
+        if (m_quotas[index].over.contains(hash)) return true;
+    }
+
+    return false;
+}
+
+std::vector<SavePathQuotas::Usage> SavePathQuotas::Quotas() const
+{
+    std::vector<Usage> result;
+    result.reserve(m_quotas.size());
+
+    for (const auto& quota : m_quotas)
+    {
+        result.push_back(Usage{
+            .name      = quota.quota.name,
+            .max_size  = quota.quota.max_size,
+            .reserved  = quota.reserved,
+            .completed = quota.completed,
+            .pending   = quota.pending,
+            .torrents  = quota.members.size(),
+            .over      = quota.over.size()
+        });
+    }
+
+    return result;
+}
+
+std::vector<std::size_t> SavePathQuotas::Match(const std::optional<std::string>& category, const std::string& save_path) const
+{
+    std::vector<std::size_t> result;
+
+    const auto path = Normalize(save_path);
+
+    for (std::size_t i = 0; i < m_quotas.size(); i++)
+    {
+        const auto& quota = m_quotas[i].quota;
+
+        if (quota.category.has_value() && quota.category != category) continue;
+        if (quota.save_path.has_value() && !Under(path, *quota.save_path)) continue;
+
+        result.push_back(i);
+    }
+
+    return result;
+}
+
+void SavePathQuotas::Account(const lt::torrent_status& ts)
+{
+    const auto client_data = m_session.ClientData(ts);
+
+    std::optional<std::string> category;
+
+    if (client_data != nullptr && client_data->category.has_value())
+    {
+        category = client_data->category->str();
+    }
+
+    DropPending(ts.info_hashes);
+
+    if (const auto torrent = m_torrents.find(ts.info_hashes); torrent != m_torrents.end())
+    {
+        auto& charge = torrent->second;
+
+        if (charge.save_path == ts.save_path && charge.category == category.value_or(""))
+        {
+            const bool resized = charge.wanted != ts.total_wanted || charge.finished != ts.is_finished;
+
+            Apply(charge, -1);
+            charge.wanted    = ts.total_wanted;
+            charge.completed = ts.total_wanted_done;
+            charge.finished  = ts.is_finished;
+            Apply(charge, 1);
+
+            if (resized)
+            {
+                for (const auto index : charge.quotas) m_quotas[index].dirty = true;
+            }
+
+            // Downloads which do not fit and were resumed by someone else.
+            if (!ts.is_finished && !(ts.flags & lt::torrent_flags::paused) && IsOver(ts.info_hashes))
+            {
+                m_changed.insert(ts.info_hashes);
+            }
+
+            return;
+        }
+
+        Forget(ts.info_hashes);
+    }
+
+    auto quotas = Match(category, ts.save_path);
+
+    if (quotas.empty())
+    {
+        return;
+    }
+
+    Charge charge{
+        .save_path = ts.save_path,
+        .category  = category.value_or(""),
+        .quotas    = std::move(quotas),
+        .order     = { ts.added_time, m_next++ },
+        .wanted    = ts.total_wanted,
+        .completed = ts.total_wanted_done,
+        .finished  = ts.is_finished
+    };
+
+    Apply(charge, 1);
+
+    for (const auto index : charge.quotas)
+    {
+        m_quotas[index].members.insert({ charge.order, ts.info_hashes });
+        m_quotas[index].dirty = true;
+    }
+
+    m_torrents.insert({ ts.info_hashes, std::move(charge) });
+}
+
+void SavePathQuotas::Apply(const Charge& charge, int sign)
+{
+    for (const auto index : charge.quotas)
+    {
+        auto& quota = m_quotas[index];
+
+        quota.reserved  += sign * charge.wanted;
+        quota.completed += sign * charge.completed;
+
+        if (charge.finished) quota.finished += sign * charge.wanted;
+    }
+}
+
+void SavePathQuotas::DropPending(const lt::info_hash_t& hash)
+{
+    const auto pending = m_pending.find(hash);
+
+    if (pending == m_pending.end())
+    {
+        return;
+    }
+
+    for (const auto index : pending->second.quotas) m_quotas[index].pending -= pending->second.size;
+
+    m_pending.erase(pending);
+}
+
+void SavePathQuotas::Enforce()
+{
+    for (auto& quota : m_quotas)
+    {
+        if (!quota.dirty)
+        {
+            continue;
+        }
+
+        quota.dirty = false;
+
+        std::set<lt::info_hash_t> over;
+
+        // Everything fits as long as the quota is not exceeded, which is the common case.
+        if (quota.reserved > quota.quota.max_size)
+        {
+            std::int64_t filled = quota.finished;
+
+            for (const auto& [order, hash] : quota.members)
+            {
+                const auto& charge = m_torrents.at(hash);
+
+                if (charge.finished) continue;
+
+                if (filled + charge.wanted <= quota.quota.max_size)
+                {
+                    filled += charge.wanted;
+                    continue;
+                }
+
+                over.insert(hash);
+            }
+        }
+
+        m_changed.insert(quota.over.begin(), quota.over.end());
+        m_changed.insert(over.begin(), over.end());
+
+        quota.over = std::move(over);
+    }
+
+    const auto& statuses = m_session.TorrentStatuses();
+    const auto& torrents = m_session.Torrents();
+
+    int paused = 0;
+    int resumed = 0;
+
+    for (const auto& hash : m_changed)
+    {
+        const auto handle = torrents.find(hash);
+        const auto status = statuses.find(hash);
+
+        if (handle == torrents.end() || status == statuses.end())
+        {
+            continue;
+        }
+
+        const auto& ts = status->second;
+
+        if (IsOver(hash))
+        {
+            const bool downloading = !ts.is_finished && !(ts.flags & lt::torrent_flags::paused);
+
+            if (!downloading || m_paused.contains(hash))
+            {
+                continue;
+            }
+
+            // Auto managed torrents would be started again by the queue.
+            const bool auto_managed = static_cast<bool>(ts.flags & lt::torrent_flags::auto_managed);
+
+            handle->second.unset_flags(lt::torrent_flags::auto_managed);
+            handle->second.pause();
+
+            m_paused.insert({ hash, auto_managed });
+            paused++;
+        }
+        else if (const auto item = m_paused.find(hash); item != m_paused.end())
+        {
+            if (item->second) handle->second.set_flags(lt::torrent_flags::auto_managed);
+            handle->second.resume();
+
+            m_paused.erase(item);
+            resumed++;
+        }
+    }
+
+    m_changed.clear();
+
+    if (paused > 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Paused " << paused << " download(s) which do not fit in their quota";
+    }
+
+    if (resumed > 0)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Resumed " << resumed << " download(s) which fit in their quota again";
+    }
+}
+
+void SavePathQuotas::Forget(const lt::info_hash_t& hash)
+{
+    const auto torrent = m_torrents.find(hash);
+
+    if (torrent == m_torrents.end())
+    {
+        return;
+    }
+
+    Apply(torrent->second, -1);
+
+    for (const auto index : torrent->second.quotas)
+    {
+        auto& quota = m_quotas[index];
+
+        quota.members.erase(torrent->second.order);
+        quota.over.erase(hash);
+        quota.dirty = true;
+    }
+
+    // Resumed by Enforce if it is paused for a quota it no longer counts against.
+    m_changed.insert(hash);
+    m_torrents.erase(torrent);
+}
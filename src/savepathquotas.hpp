@@ -0,0 +1,144 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "savepathquota.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct SavePathQuotasOptions
+    {
+        std::vector<SavePathQuota> quotas;
+        // How long a torrent admitted by torrents.add is counted before the session has
+        // added it. Torrents which fail to add are forgotten after this.
+        std::chrono::seconds       pending = std::chrono::seconds(60);
+    };
+
+    // Accounts the size of the torrents against the quotas they match, from the wanted and
+    // completed sizes in the state updates, without looking at the file system. What a
+    // torrent counts is kept so an update only moves the difference, and the quotas it
+    // matches are only found again when its save path or category changes.
+    //
+    // Finished torrents always fit, since their data is there already. The downloads then
+    // fit in the order they were added, and the ones which do not are paused until enough
+    // is removed for them. Torrents paused by anyone else are left alone. Runs on the io
+    // thread.
+    class SavePathQuotas
+    {
+    public:
+        struct Usage
+        {
+            std::string  name;
+            std::int64_t max_size;
+            // The wanted size of every torrent in the quota, and the part of it completed.
+            std::int64_t reserved;
+            std::int64_t completed;
+            std::int64_t pending;
+            std::size_t  torrents;
+            // Downloads which do not fit.
+            std::size_t  over;
+        };
+
+        struct Rejection
+        {
+            std::string  quota;
+            std::int64_t max_size;
+            std::int64_t reserved;
+        };
+
+        explicit SavePathQuotas(ISession& session, SavePathQuotasOptions options);
+        SavePathQuotas(const SavePathQuotas&) = delete;
+
+        ~SavePathQuotas();
+
+        // Whether a torrent of this size fits in the reject quotas it would count against,
+        // counting it as pending if it does. Torrents whose size is not known yet, from
+        // magnet links, are always admitted.
+        std::optional<Rejection> Admit(
+            const libtorrent::info_hash_t& hash,
+            const std::optional<std::string>& category,
+            const std::string& save_path,
+            std::int64_t size);
+
+        // Whether the torrent is a download which does not fit in one of its quotas.
+        [[nodiscard]] bool IsOver(const libtorrent::info_hash_t& hash) const;
+
+        [[nodiscard]] std::vector<Usage> Quotas() const;
+
+    private:
+        // Torrents are ordered by when they were added, and then by when they were seen.
+        typedef std::pair<std::int64_t, std::uint64_t> OrderKey;
+
+        struct Quota
+        {
+            SavePathQuota                               quota;
+            std::int64_t                                reserved = 0;
+            std::int64_t                                completed = 0;
+            // The wanted size of the finished torrents, which always fit.
+            std::int64_t                                finished = 0;
+            std::int64_t                                pending = 0;
+            std::map<OrderKey, libtorrent::info_hash_t> members;
+            std::set<libtorrent::info_hash_t>           over;
+            // Whether over has to be found again.
+            bool                                        dirty = false;
+        };
+
+        struct Charge
+        {
+            std::string              save_path;
+            std::string              category;
+            std::vector<std::size_t> quotas;
+            OrderKey                 order;
+            std::int64_t             wanted;
+            std::int64_t             completed;
+            bool                     finished;
+        };
+
+        struct Pending
+        {
+            std::vector<std::size_t>              quotas;
+            std::int64_t                          size;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        std::vector<std::size_t> Match(const std::optional<std::string>& category, const std::string& save_path) const;
+
+        void Account(const libtorrent::torrent_status& ts);
+        void Apply(const Charge& charge, int sign);
+        void DropPending(const libtorrent::info_hash_t& hash);
+        void Enforce();
+        void Forget(const libtorrent::info_hash_t& hash);
+
+        ISession& m_session;
+        SavePathQuotasOptions m_options;
+        std::uint64_t m_next;
+
+        std::vector<Quota> m_quotas;
+        std::map<libtorrent::info_hash_t, Charge> m_torrents;
+        std::map<libtorrent::info_hash_t, Pending> m_pending;
+        // Torrents paused for a quota, and whether they were auto managed.
+        std::map<libtorrent::info_hash_t, bool> m_paused;
+        // Torrents which may have to be paused or resumed by the next Enforce.
+        std::set<libtorrent::info_hash_t> m_changed;
+
+        porla::Utils::Connection m_clientDataChangedConnection;
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+    };
+}
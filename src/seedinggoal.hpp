@@ -0,0 +1,23 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace porla
+{
+    // What to do with torrents once they match a PQL query, such as pausing them at a
+    // ratio or removing them after some time seeding.
+    struct SeedingGoal
+    {
+        std::string                name;
+        std::string                query;
+        // One of move, pause, queue_bottom, queue_down, queue_top, queue_up, remove and
+        // remove_data.
+        std::string                action;
+        // Where move puts the torrent.
+        std::optional<std::string> path;
+        // Only torrents added with one of these presets. Empty is every torrent.
+        std::vector<std::string>   presets;
+    };
+}
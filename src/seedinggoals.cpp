@@ -0,0 +1,221 @@
+#include "seedinggoals.hpp"
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_handle.hpp>
+
+#include "movequeue.hpp"
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using porla::SeedingGoals;
+
+SeedingGoals::SeedingGoals(boost::asio::io_context& io, porla::ISession& session, porla::MoveQueue& moves, porla::SeedingGoalsOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_moves(moves)
+    , m_interval(options.interval)
+    , m_clock(false)
+{
+    static const std::map<std::string, Action> Actions =
+    {
+        {"move",         Action::Move},
+        {"pause",        Action::Pause},
+        {"queue_bottom", Action::QueueBottom},
+        {"queue_down",   Action::QueueDown},
+        {"queue_top",    Action::QueueTop},
+        {"queue_up",     Action::QueueUp},
+        {"remove",       Action::Remove},
+        {"remove_data",  Action::RemoveData}
+    };
+
+    for (auto& config : options.goals)
+    {
+        const auto action = Actions.find(config.action);
+
+        if (action == Actions.end())
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Seeding goal '" << config.name << "' has an unknown action '" << config.action << "'";
+            continue;
+        }
+
+        if (action->second == Action::Move && !config.path.has_value())
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Seeding goal '" << config.name << "' moves torrents but has no path";
+            continue;
+        }
+
+        std::unique_ptr<Query::PQL::Filter> filter;
+
+        try
+        {
+            filter = Query::PQL::Parse(config.query);
+        }
+        catch (const Query::QueryError& ex)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Seeding goal '" << config.name << "' has an invalid query: " << ex.what();
+            continue;
+        }
+
+        m_clock = m_clock || filter->UsesClock();
+
+        m_goals.push_back(Goal{
+            .action  = action->second,
+            .filter  = std::move(filter),
+            .presets = { config.presets.begin(), config.presets.end() }
+        });
+
+        m_goals.back().config = std::move(config);
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Checking torrents against " << m_goals.size() << " seeding goal(s)";
+
+    const auto evaluate = [this](const std::vector<lt::torrent_status>& torrents)
+    {
+        for (const auto& ts : torrents) Evaluate(ts, false);
+    };
+
+    m_loadedConnection      = m_session.OnTorrentsLoaded(evaluate);
+    m_stateUpdateConnection = m_session.OnStateUpdate(evaluate);
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            for (std::size_t i = 0; i < m_goals.size(); i++) m_matched.erase({ i, hash });
+        });
+
+    if (m_clock)
+    {
+        Schedule();
+    }
+}
+
+SeedingGoals::~SeedingGoals()
+{
+    m_timer.cancel();
+
+    m_loadedConnection.disconnect();
+    m_removedConnection.disconnect();
+    m_stateUpdateConnection.disconnect();
+}
+
+bool SeedingGoals::Apply(const Goal& goal, const lt::torrent_status& ts)
+{
+    const auto& torrents = m_session.Torrents();
+    const auto th = torrents.find(ts.info_hashes);
+
+    if (th == torrents.end())
+    {
+        return false;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Torrent " << ts.name << " reached seeding goal " << goal.config.name << ", applying " << goal.config.action;
+
+    switch (goal.action)
+    {
+    case Action::Move:
+        if (ts.save_path != *goal.config.path)
+        {
+            m_moves.Enqueue(ts.info_hashes, *goal.config.path, lt::move_flags_t::always_replace_files);
+        }
+        return true;
+    case Action::Pause:
+        // Not auto managed, or the queue would resume it.
+        th->second.unset_flags(lt::torrent_flags::auto_managed);
+        th->second.pause();
+        return true;
+    case Action::QueueBottom:
+        th->second.queue_position_bottom();
+        return true;
+    case Action::QueueDown:
+        th->second.queue_position_down();
+        return true;
+    case Action::QueueTop:
+        th->second.queue_position_top();
+        return true;
+    case Action::QueueUp:
+        th->second.queue_position_up();
+        return true;
+    case Action::Remove:
+        m_session.Remove(ts.info_hashes, false);
+        return false;
+    case Action::RemoveData:
+        m_session.Remove(ts.info_hashes, true);
+        return false;
+    }
+
+    return true;
+}
+
+void SeedingGoals::Evaluate(const lt::torrent_status& ts, bool clock_only)
+{
+    for (std::size_t i = 0; i < m_goals.size(); i++)
+    {
+        auto& goal = m_goals[i];
+
+        if (clock_only && !goal.filter->UsesClock())
+        {
+            continue;
+        }
+
+        const std::pair<std::size_t, lt::info_hash_t> key{ i, ts.info_hashes };
+
+        if (!goal.filter->Includes(ts))
+        {
+            m_matched.erase(key);
+            continue;
+        }
+
+        if (!m_matched.insert(key).second)
+        {
+            continue;
+        }
+
+        // Checked last, since client data is a round trip to the network thread.
+        if (!goal.presets.empty())
+        {
+            const auto client_data = m_session.ClientData(ts);
+
+            if (client_data == nullptr
+                || !client_data->preset.has_value()
+                || !goal.presets.contains(client_data->preset->str()))
+            {
+                continue;
+            }
+        }
+
+        if (!Apply(goal, ts))
+        {
+            return;
+        }
+    }
+}
+
+void SeedingGoals::Schedule()
+{
+    m_timer.expires_after(m_interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            // By hash, since removing torrents changes the statuses.
+            const auto& statuses = m_session.TorrentStatuses();
+
+            std::vector<lt::info_hash_t> hashes;
+            hashes.reserve(statuses.size());
+
+            for (const auto& [hash, ts] : statuses) hashes.push_back(hash);
+
+            for (const auto& hash : hashes)
+            {
+                if (const auto ts = statuses.find(hash); ts != statuses.end()) Evaluate(ts->second, true);
+            }
+
+            Schedule();
+        });
+}
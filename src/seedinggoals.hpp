@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "query/pql.hpp"
+#include "seedinggoal.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+    class MoveQueue;
+
+    struct SeedingGoalsOptions
+    {
+        std::vector<SeedingGoal>  goals;
+        // How often every torrent is checked against the goals whose queries depend on the
+        // clock, like age and seeding_time, which change without a state update.
+        std::chrono::milliseconds interval = std::chrono::milliseconds(60000);
+    };
+
+    // Applies the seeding goals to the torrents in each state update, which only holds the
+    // ones that changed, so the cost follows activity and not the number of torrents. A
+    // goal is applied once when a torrent starts matching it, and again only after the
+    // torrent has stopped matching, so resuming a paused torrent by hand sticks. Goals are
+    // checked in order, and none are checked after one removes the torrent.
+    class SeedingGoals
+    {
+    public:
+        explicit SeedingGoals(boost::asio::io_context& io, ISession& session, MoveQueue& moves, SeedingGoalsOptions options);
+        SeedingGoals(const SeedingGoals&) = delete;
+
+        ~SeedingGoals();
+
+    private:
+        enum class Action
+        {
+            Move,
+            Pause,
+            QueueBottom,
+            QueueDown,
+            QueueTop,
+            QueueUp,
+            Remove,
+            RemoveData
+        };
+
+        struct Goal
+        {
+            SeedingGoal                           config;
+            Action                                action;
+            std::unique_ptr<Query::PQL::Filter>   filter;
+            std::unordered_set<std::string>       presets;
+        };
+
+        bool Apply(const Goal& goal, const libtorrent::torrent_status& ts);
+        void Evaluate(const libtorrent::torrent_status& ts, bool clock_only);
+        void Schedule();
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        MoveQueue& m_moves;
+        std::chrono::milliseconds m_interval;
+
+        std::vector<Goal> m_goals;
+        bool m_clock;
+        // Goals by index which a torrent matched when it was last checked.
+        std::set<std::pair<std::size_t, libtorrent::info_hash_t>> m_matched;
+
+        porla::Utils::Connection m_loadedConnection;
+        porla::Utils::Connection m_removedConnection;
+        porla::Utils::Connection m_stateUpdateConnection;
+    };
+}
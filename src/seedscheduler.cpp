@@ -0,0 +1,216 @@
+#include "seedscheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/settings_pack.hpp>
+#include <libtorrent/torrent_handle.hpp>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::SeedScheduler;
+
+// Paused seeds scraped per interval.
+static constexpr std::size_t ScrapesPerTick = 50;
+
+static bool IsSeed(const lt::torrent_status& ts)
+{
+    return ts.state == lt::torrent_status::seeding || ts.state == lt::torrent_status::finished;
+}
+
+static bool IsPaused(const lt::torrent_status& ts)
+{
+    return (ts.flags & lt::torrent_flags::paused) == lt::torrent_flags::paused;
+}
+
+SeedScheduler::SeedScheduler(boost::asio::io_context& io, porla::ISession& session, porla::SeedSchedulerOptions options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(options)
+    , m_last(std::chrono::steady_clock::now())
+    , m_scrapeCursor(0)
+{
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash) { m_seeds.erase(hash); });
+
+    Schedule();
+}
+
+SeedScheduler::~SeedScheduler()
+{
+    m_timer.cancel();
+    m_removedConnection.disconnect();
+
+    // Handed back before the resume data is saved, so the seeds are taken over again on
+    // the next start instead of being left unmanaged.
+    const auto& torrents = m_session.Torrents();
+
+    for (const auto& [hash, seed] : m_seeds)
+    {
+        if (const auto th = torrents.find(hash); th != torrents.end())
+        {
+            th->second.set_flags(lt::torrent_flags::auto_managed);
+        }
+    }
+}
+
+double SeedScheduler::Score(const Seed& seed, const lt::torrent_status& ts) const
+{
+    // Connected peers for active seeds, and the last scrape for paused ones.
+    const int demand = std::max({ 0, ts.list_peers - ts.list_seeds, ts.num_incomplete });
+    const double days = static_cast<double>(ts.seeding_duration.count()) / 86400.0;
+
+    return m_options.upload_weight * seed.upload_rate / 1024.0
+        + m_options.demand_weight * demand
+        + m_options.seeding_time_weight * days;
+}
+
+void SeedScheduler::Schedule()
+{
+    m_timer.expires_after(m_options.interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            Tick();
+            Schedule();
+        });
+}
+
+void SeedScheduler::Tick()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - m_last).count();
+    const double alpha = 1.0 - std::exp(-elapsed / std::max(1.0, static_cast<double>(m_options.upload_window.count())));
+
+    m_last = now;
+
+    const auto& statuses = m_session.TorrentStatuses();
+    const auto& torrents = m_session.Torrents();
+
+    struct Ranked
+    {
+        lt::info_hash_t hash;
+        double          score;
+        bool            active;
+    };
+
+    std::vector<Ranked> ranked;
+
+    for (const auto& [hash, ts] : statuses)
+    {
+        auto seed = m_seeds.find(hash);
+
+        if (seed == m_seeds.end())
+        {
+            // Only seeds queued by libtorrent are taken over.
+            if (!IsSeed(ts) || !(ts.flags & lt::torrent_flags::auto_managed))
+            {
+                continue;
+            }
+
+            seed = m_seeds.insert({ hash, Seed{ .active = !IsPaused(ts), .upload_rate = static_cast<double>(ts.upload_payload_rate) } }).first;
+
+            if (const auto th = torrents.find(hash); th != torrents.end())
+            {
+                th->second.unset_flags(lt::torrent_flags::auto_managed);
+            }
+        }
+        else if (!IsSeed(ts) || seed->second.active == IsPaused(ts)
+            || (ts.flags & lt::torrent_flags::auto_managed))
+        {
+            // Changed by something else, like a user or a seeding goal.
+            m_seeds.erase(seed);
+            continue;
+        }
+
+        seed->second.upload_rate += alpha * (ts.upload_payload_rate - seed->second.upload_rate);
+
+        const double score = Score(seed->second, ts);
+
+        ranked.push_back(Ranked{
+            .hash   = hash,
+            .score  = seed->second.active ? score * 1.1 : score,
+            .active = seed->second.active
+        });
+    }
+
+    const int slots = m_options.slots > 0
+        ? m_options.slots
+        : m_session.Settings().get_int(lt::settings_pack::active_seeds);
+
+    const auto boundary = ranked.begin() + std::min(ranked.size(), static_cast<std::size_t>(std::max(0, slots)));
+
+    std::partial_sort(
+        ranked.begin(),
+        boundary,
+        ranked.end(),
+        [](const Ranked& lhs, const Ranked& rhs) { return lhs.score > rhs.score; });
+
+    // Both are capped, best first for resuming, so a large reshuffle takes a few intervals.
+    std::vector<lt::info_hash_t> resume;
+    std::vector<lt::info_hash_t> pause;
+
+    for (auto it = ranked.begin(); it != boundary; ++it)
+    {
+        if (!it->active) resume.push_back(it->hash);
+    }
+
+    for (auto it = ranked.rbegin(); it != std::make_reverse_iterator(boundary); ++it)
+    {
+        if (it->active) pause.push_back(it->hash);
+    }
+
+    const auto limit = static_cast<std::size_t>(std::max(0, m_options.max_changes));
+    const auto count = [limit](std::size_t size) { return std::min(size, limit); };
+
+    for (std::size_t i = 0; i < count(resume.size()); i++)
+    {
+        if (const auto th = torrents.find(resume[i]); th != torrents.end())
+        {
+            th->second.resume();
+            m_seeds.at(resume[i]).active = true;
+        }
+    }
+
+    for (std::size_t i = 0; i < count(pause.size()); i++)
+    {
+        if (const auto th = torrents.find(pause[i]); th != torrents.end())
+        {
+            th->second.pause();
+            m_seeds.at(pause[i]).active = false;
+        }
+    }
+
+    // Paused seeds do not announce, so their swarms are scraped in turns to keep their
+    // demand current.
+    std::vector<lt::info_hash_t> inactive;
+
+    for (const auto& [hash, seed] : m_seeds)
+    {
+        if (!seed.active) inactive.push_back(hash);
+    }
+
+    for (std::size_t i = 0; i < std::min(inactive.size(), ScrapesPerTick); i++)
+    {
+        const auto& hash = inactive[(m_scrapeCursor + i) % inactive.size()];
+
+        if (const auto th = torrents.find(hash); th != torrents.end())
+        {
+            th->second.scrape_tracker();
+        }
+    }
+
+    m_scrapeCursor = inactive.empty() ? 0 : (m_scrapeCursor + ScrapesPerTick) % inactive.size();
+
+    BOOST_LOG_TRIVIAL(debug) << "Seed scheduler ranked " << ranked.size() << " seed(s) for " << slots << " slot(s), "
+                             << "resumed " << count(resume.size()) << " and paused " << count(pause.size());
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct SeedSchedulerOptions
+    {
+        std::chrono::milliseconds interval            = std::chrono::milliseconds(300000);
+        // Seeds kept active. Zero follows the active_seeds setting.
+        int                       slots               = 0;
+        // Torrents resumed or paused per interval, so a large reshuffle is spread out.
+        int                       max_changes         = 100;
+        // Score per KiB/s of averaged upload, per peer in the swarm which does not have the
+        // whole torrent, and per day seeding.
+        double                    upload_weight       = 1.0;
+        double                    demand_weight       = 10.0;
+        double                    seeding_time_weight = -0.1;
+        // How far back the averaged upload rate reaches.
+        std::chrono::seconds      upload_window       = std::chrono::seconds(3600);
+    };
+
+    // Decides which seeds are active instead of libtorrent's queue, which ranks seeds with
+    // fixed heuristics. Seeds which are auto managed when the scheduler first sees them are
+    // taken out of auto management, and on every interval the ones with the highest score
+    // are resumed and the rest paused. Active seeds keep their slot unless a paused one
+    // scores a tenth higher, so they do not flap. Seeds paused or resumed by something
+    // else are left alone from then on, and the rest are auto managed again on shutdown.
+    // Paused seeds have no peers, so their demand comes from tracker scrapes, which are
+    // asked for a few at a time.
+    class SeedScheduler
+    {
+    public:
+        explicit SeedScheduler(boost::asio::io_context& io, ISession& session, SeedSchedulerOptions options);
+        SeedScheduler(const SeedScheduler&) = delete;
+
+        ~SeedScheduler();
+
+    private:
+        struct Seed
+        {
+            bool   active;
+            double upload_rate;
+        };
+
+        double Score(const Seed& seed, const libtorrent::torrent_status& ts) const;
+        void Schedule();
+        void Tick();
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        SeedSchedulerOptions m_options;
+
+        std::map<libtorrent::info_hash_t, Seed> m_seeds;
+        std::chrono::steady_clock::time_point m_last;
+        std::size_t m_scrapeCursor;
+
+        porla::Utils::Connection m_removedConnection;
+    };
+}
@@ -1,17 +1,35 @@
 #include "session.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
 #include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <utility>
 
+#include <boost/asio/thread_pool.hpp>
 #include <boost/log/trivial.hpp>
 #include <libtorrent/alert_types.hpp>
+#include <libtorrent/extensions.hpp>
 #include <libtorrent/extensions/ut_metadata.hpp>
 #include <libtorrent/extensions/ut_pex.hpp>
 #include <libtorrent/extensions/smart_ban.hpp>
+#include <libtorrent/aux_/session_impl.hpp>
 #include <libtorrent/session_stats.hpp>
+#include <libtorrent/torrent.hpp>
 
 #include "data/models/addtorrentparams.hpp"
+#include "data/statesnapshot.hpp"
+#include "data/writebehindqueue.hpp"
 #include "torrentclientdata.hpp"
+#include "utils/phases.hpp"
+#include "utils/settingspack.hpp"
 
 namespace fs = std::filesystem;
 namespace lt = libtorrent;
@@ -19,6 +37,173 @@ namespace lt = libtorrent;
 using porla::Data::Models::AddTorrentParams;
 using porla::Session;
 
+// Resume data requests per tick when saving many torrents at once. Each one posts an
+// alert, so all of them at once would overflow the queue.
+static constexpr std::size_t ResaveBatchSize = 250;
+// Number of stored torrents passed to async_add_torrent before waiting on their
+// add_torrent_alerts. Keeps us well below the alert queue size, since every added torrent
+// also posts a few state alerts of its own.
+static constexpr int LoadBatchSize = 250;
+// Maximum number of rows read ahead of the adding stage, to bound memory usage.
+static constexpr int LoadReadAhead = LoadBatchSize * 8;
+// How long fetched peers and file progress are handed out before asking libtorrent again.
+// They are polled by every open view of a torrent, and each fetch copies all of them.
+static constexpr auto FetchedTtl = std::chrono::seconds(1);
+// How often paused torrents are checked for parking, and how long a torrent being parked
+// waits on its resume data before it is tried again.
+static constexpr auto ParkInterval = std::chrono::seconds(60);
+
+// Told of peers connecting for torrents libtorrent does not have, which parked torrents
+// are. Called on the network thread, and the peer is always turned away.
+class UnknownTorrentPlugin : public lt::plugin
+{
+public:
+    explicit UnknownTorrentPlugin(std::function<void(const lt::info_hash_t&)> cb)
+        : m_cb(std::move(cb))
+    {
+    }
+
+    lt::feature_flags_t implemented_features() override
+    {
+        return unknown_torrent_feature;
+    }
+
+    bool on_unknown_torrent(const lt::info_hash_t& info_hash, const lt::peer_connection_handle&) override
+    {
+        m_cb(info_hash);
+        return false;
+    }
+
+private:
+    std::function<void(const lt::info_hash_t&)> m_cb;
+};
+
+// What a parked torrent keeps as its status, from the params stored for it. The info dict
+// is not kept, so sizes are taken from it here.
+static lt::torrent_status ParkedStatus(const lt::add_torrent_params& params)
+{
+    lt::torrent_status ts;
+    ts.info_hashes        = params.ti ? params.ti->info_hashes() : params.info_hashes;
+    ts.name               = params.ti ? params.ti->name() : params.name;
+    ts.save_path          = params.save_path;
+    ts.flags              = params.flags | lt::torrent_flags::paused;
+    ts.has_metadata       = params.ti != nullptr;
+    ts.all_time_download  = params.total_downloaded;
+    ts.all_time_upload    = params.total_uploaded;
+    ts.added_time         = params.added_time;
+    ts.completed_time     = params.completed_time;
+    ts.last_seen_complete = params.last_seen_complete;
+    ts.active_duration    = std::chrono::seconds(params.active_time);
+    ts.finished_duration  = std::chrono::seconds(params.finished_time);
+    ts.seeding_duration   = std::chrono::seconds(params.seeding_time);
+    ts.pieces             = params.have_pieces;
+    ts.num_pieces         = params.have_pieces.count();
+    ts.queue_position     = lt::queue_position_t{-1};
+
+    // Stored as wall clock time, while the status has them on the libtorrent clock.
+    const auto now = std::time(nullptr);
+    if (params.last_download > 0) ts.last_download = lt::clock_type::now() - std::chrono::seconds(now - params.last_download);
+    if (params.last_upload > 0)   ts.last_upload   = lt::clock_type::now() - std::chrono::seconds(now - params.last_upload);
+
+    if (params.ti)
+    {
+        const std::int64_t piece_length = params.ti->piece_length();
+
+        ts.total_wanted      = params.ti->total_size();
+        ts.total_wanted_done = std::min(ts.total_wanted, ts.num_pieces * piece_length);
+        ts.total_done        = ts.total_wanted_done;
+        ts.progress          = ts.total_wanted > 0 ? static_cast<float>(ts.total_wanted_done) / static_cast<float>(ts.total_wanted) : 1.0f;
+        ts.progress_ppm      = static_cast<int>(ts.progress * 1000000);
+        ts.is_finished       = ts.num_pieces == params.ti->num_pieces();
+        ts.is_seeding        = ts.is_finished;
+    }
+
+    ts.state = ts.is_seeding ? lt::torrent_status::seeding : lt::torrent_status::downloading;
+
+    return ts;
+}
+
+// Time since the torrent last sent or received payload, or since it was added if it never
+// has.
+static std::chrono::seconds IdleFor(const lt::torrent_status& ts)
+{
+    const auto last = std::max(ts.last_upload, ts.last_download);
+
+    if (last == lt::time_point{})
+    {
+        return std::chrono::seconds(std::time(nullptr) - ts.added_time);
+    }
+
+    return std::chrono::duration_cast<std::chrono::seconds>(lt::clock_type::now() - last);
+}
+
+// Adds torrents of the joining categories to the peer class and takes the ones of the
+// leaving categories out of it. There is no public API for the peer classes of a torrent,
+// so it goes through the torrent itself, on the network thread.
+static void MovePeerClass(
+    lt::session& session,
+    const porla::TorrentHandles& torrents,
+    lt::peer_class_t id,
+    const std::set<std::string>& joining,
+    const std::set<std::string>& leaving)
+{
+    std::vector<std::pair<std::shared_ptr<lt::torrent>, bool>> moves;
+
+    for (const auto& [hash, th] : torrents)
+    {
+        const auto client_data = th.userdata().get<porla::TorrentClientData>();
+
+        if (client_data == nullptr || !client_data->category.has_value())
+        {
+            continue;
+        }
+
+        const auto& category = client_data->category->str();
+        const bool join = joining.contains(category);
+
+        if (!join && !leaving.contains(category))
+        {
+            continue;
+        }
+
+        if (auto t = th.native_handle())
+        {
+            moves.emplace_back(std::move(t), join);
+        }
+    }
+
+    if (moves.empty())
+    {
+        return;
+    }
+
+    auto impl = session.native_handle();
+
+    boost::asio::post(
+        impl->get_context(),
+        [impl, id, moves = std::move(moves)]()
+        {
+            for (const auto& [t, join] : moves)
+            {
+                if (join) t->add_class(impl->peer_classes(), id);
+                else      t->remove_class(impl->peer_classes(), id);
+            }
+        });
+}
+
+static std::map<std::string, std::vector<lt::peer_class_t>> CategoryClasses(
+    const std::map<std::string, std::pair<porla::PeerClass, lt::peer_class_t>>& peer_classes)
+{
+    std::map<std::string, std::vector<lt::peer_class_t>> result;
+
+    for (const auto& [name, entry] : peer_classes)
+    {
+        for (const auto& category : entry.first.categories) result[category].push_back(entry.second);
+    }
+
+    return result;
+}
+
 template<typename T>
 static std::string ToString(const T &hash)
 {
@@ -27,43 +212,114 @@ static std::string ToString(const T &hash)
     return ss.str();
 }
 
+// Loading the stored torrents. Rows are read on a thread of their own and decoded on a
+// pool, while the io thread adds them in queue order and a window at a time.
+struct Session::LoadState
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    struct Decoded
+    {
+        // Empty when the row failed to decode.
+        std::optional<lt::add_torrent_params> params;
+        double                                seconds;
+        bool                                  parked = false;
+    };
+
+    // Decoded params keyed on their row sequence so they can be added in queue order even
+    // though decoding finishes out of order.
+    std::map<int, Decoded> decoded;
+    std::exception_ptr reader_error;
+    std::atomic<int64_t> decode_us = 0;
+    std::atomic<int> skipped = 0;
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> step_posted = false;
+    bool reader_done = false;
+    int count = 0;
+    int rows_read = 0;
+    int next_seq = 0;
+    std::chrono::milliseconds read_time{0};
+
+    // Only touched on the io thread. Torrents passed to libtorrent and waiting on their
+    // add_torrent_alert, by client data with when they were passed, and the ones added
+    // since the last step.
+    std::map<const TorrentClientData*, std::chrono::steady_clock::time_point> adding;
+    std::vector<lt::torrent_status> loaded;
+    int pending = 0;
+
+    std::chrono::steady_clock::time_point start;
+    unsigned int decoders = 1;
+    std::unique_ptr<boost::asio::thread_pool> pool;
+    std::thread reader;
+};
+
+// Runs the callback at the active interval while there is demand for it, and at the idle
+// interval otherwise.
 class Session::Timer
 {
 public:
-    explicit Timer(boost::asio::io_context& io, int interval, std::function<void()> cb)
+    explicit Timer(boost::asio::io_context& io, int active, int idle, std::function<void()> cb)
         : m_timer(io)
-        , m_interval(interval)
+        , m_active(active)
+        , m_idle(std::max(active, idle))
+        , m_demand(0)
         , m_callback(std::move(cb))
     {
-        boost::system::error_code ec;
+        Arm();
+    }
 
-        m_timer.expires_from_now(boost::posix_time::milliseconds(m_interval), ec);
-        if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to set timer expiry: " << ec.message(); }
+    Timer(const Timer&) = delete;
+    Timer(Timer&&) = delete;
+    Timer& operator=(const Timer&) = delete;
+    Timer& operator=(Timer&&) = delete;
 
-        m_timer.async_wait([this](auto &&PH1) { OnExpired(std::forward<decltype(PH1)>(PH1)); });
+    void Raise()
+    {
+        // Going from idle to active should not wait out the rest of the idle interval.
+        if (m_demand++ == 0 && m_idle != m_active)
+        {
+            boost::system::error_code ec;
+            m_timer.cancel(ec);
+            if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to cancel timer: " << ec.message(); }
+
+            Arm();
+        }
     }
 
-    Timer(Timer&& t) noexcept
-        : m_timer(std::move(t.m_timer))
-        , m_interval(std::exchange(t.m_interval, 0))
-        , m_callback(std::move(t.m_callback))
+    void Lower()
     {
-        boost::system::error_code ec;
+        m_demand = std::max(0, m_demand - 1);
+    }
+
+    void SetIntervals(int active, int idle)
+    {
+        if (active <= 0 || (active == m_active && std::max(active, idle) == m_idle))
+        {
+            return;
+        }
+
+        m_active = active;
+        m_idle   = std::max(active, idle);
 
+        boost::system::error_code ec;
         m_timer.cancel(ec);
         if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to cancel timer: " << ec.message(); }
 
-        m_timer.expires_from_now(boost::posix_time::milliseconds(m_interval), ec);
+        Arm();
+    }
+
+private:
+    void Arm()
+    {
+        boost::system::error_code ec;
+
+        m_timer.expires_from_now(boost::posix_time::milliseconds(m_demand > 0 ? m_active : m_idle), ec);
         if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to set timer expiry: " << ec.message(); }
 
         m_timer.async_wait([this](auto &&PH1) { OnExpired(std::forward<decltype(PH1)>(PH1)); });
     }
 
-    Timer(const Timer&) = delete;
-    Timer& operator=(const Timer&) = delete;
-    Timer& operator=(Timer&&) = delete; // noexcept {}
-
-private:
     void OnExpired(boost::system::error_code ec)
     {
         if (ec == boost::system::errc::operation_canceled)
@@ -78,17 +334,29 @@ private:
 
         m_callback();
 
-        m_timer.expires_from_now(boost::posix_time::milliseconds(m_interval), ec);
-        if (ec) { BOOST_LOG_TRIVIAL(error) << "Failed to set timer expiry: " << ec; }
-
-        m_timer.async_wait([this](auto &&PH1) { OnExpired(std::forward<decltype(PH1)>(PH1)); });
+        Arm();
     }
 
     boost::asio::deadline_timer m_timer;
-    int m_interval;
+    int m_active;
+    int m_idle;
+    int m_demand;
     std::function<void()> m_callback;
 };
 
+static std::shared_ptr<const porla::SessionMetrics::Layout> StatsLayout(const std::vector<lt::stats_metric>& stats)
+{
+    std::vector<std::pair<std::string, bool>> metrics;
+    metrics.reserve(stats.size());
+
+    for (const auto& metric : stats)
+    {
+        metrics.emplace_back(metric.name, metric.type == lt::metric_type_t::counter);
+    }
+
+    return std::make_shared<const porla::SessionMetrics::Layout>(metrics);
+}
+
 static lt::session_params ReadSessionParams(const fs::path& file)
 {
     if (fs::exists(file))
@@ -116,40 +384,163 @@ static lt::session_params ReadSessionParams(const fs::path& file)
     return {};
 }
 
-static void WriteSessionParams(const fs::path& file, const lt::session_params& params)
+// Written to a temporary file which is then renamed over the old one, so a crash while
+// writing leaves the last complete state.
+static bool WriteSessionParams(const fs::path& file, const lt::session_params& params)
 {
     std::vector<char> buf = lt::write_session_params_buf(
         params,
         lt::session::save_dht_state);
 
-    BOOST_LOG_TRIVIAL(info) << "Writing session params (" << buf.size() << " bytes)";
+    BOOST_LOG_TRIVIAL(debug) << "Writing session params (" << buf.size() << " bytes)";
 
-    std::ofstream session_params_file(file, std::ios::binary | std::ios::trunc);
+    fs::path temp = file;
+    temp += ".tmp";
 
-    if (!session_params_file.is_open())
     {
-        BOOST_LOG_TRIVIAL(error) << "Error while opening session_params.dat: " << strerror(errno);
-        return;
+        std::ofstream session_params_file(temp, std::ios::binary | std::ios::trunc);
+
+        if (!session_params_file.is_open())
+        {
+            BOOST_LOG_TRIVIAL(error) << "Error while opening session_params.dat: " << strerror(errno);
+            return false;
+        }
+
+        session_params_file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        session_params_file.close();
+
+        if (session_params_file.fail())
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to write session_params.dat file: " << strerror(errno);
+            return false;
+        }
     }
 
-    session_params_file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    std::error_code ec;
+    fs::rename(temp, file, ec);
 
-    if (session_params_file.fail())
+    if (ec)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to replace session_params.dat file: " << ec.message();
+        return false;
+    }
+
+    return true;
+}
+
+template<typename TSignal, typename... TArgs>
+void Session::Emit(const char* name, TSignal& signal, TArgs&&... args)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    signal(std::forward<TArgs>(args)...);
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto& timing = m_instrumentation.signals[name];
+    timing.count++;
+    timing.seconds += elapsed.count();
+}
+
+void Session::FlushLifecycle()
+{
+    if (m_lifecycle.Empty())
     {
-        BOOST_LOG_TRIVIAL(error) << "Failed to write session_params.dat file: " << strerror(errno);
+        return;
     }
+
+    // Swapped out first, since subscribers may remove torrents of their own.
+    TorrentLifecycle lifecycle;
+    std::swap(lifecycle, m_lifecycle);
+
+    Emit("torrent_lifecycle", m_torrentLifecycle, lifecycle);
 }
 
 Session::Session(boost::asio::io_context& io, porla::SessionOptions const& options)
     : m_io(io)
     , m_db(options.db)
     , m_session_params_file(options.session_params_file)
+    , m_state_snapshot_file(options.state_snapshot_file)
+    , m_dhtStateInterval(options.timer_dht_state)
+    , m_dhtStateTimer(io)
+    , m_dhtStateSaved(0)
     , m_stats(lt::session_stats_metrics())
+    , m_statsLayout(StatsLayout(m_stats))
+    , m_alertThreadEnabled(options.alert_thread)
+    , m_alertThreadStopping(false)
+    , m_alertDrainPosted(false)
+    , m_alertQueueDepth(0)
+    , m_alertHandlers{}
+    , m_debugAlerts(0)
+    , m_requestUpdates(false)
+    , m_torrents(options.shard ? *options.shard->torrents : m_ownTorrents)
+    , m_statuses(options.shard ? *options.shard->statuses : m_ownStatuses)
+    , m_alertQueueMax(options.alert_queue_max)
+    , m_resaveTimer(io)
+    , m_checkpointInterval(options.timer_resume_data)
+    , m_checkpointTimer(io)
+    , m_draining(false)
+    , m_parkAfter(options.park_after)
+    , m_parkTimer(io)
 {
-    lt::session_params params = ReadSessionParams(m_session_params_file);
+    if (options.shard)
+    {
+        m_writer = options.shard->writer;
+        m_loads  = options.shard->loads;
+        m_owns   = options.shard->owns;
+    }
+
+    if (!m_writer)
+    {
+        m_writer = std::make_shared<porla::Data::WriteBehindQueue>(porla::Data::WriteBehindQueueOptions{
+            .db             = options.db,
+            .flush_interval = std::chrono::milliseconds(options.persistence_flush_interval),
+            .batch_size     = options.persistence_batch_size,
+            .compress       = options.persistence_compress,
+            .pragmas        = options.db_pragmas
+        });
+    }
+
+    m_alertHandlers[lt::add_torrent_alert::alert_type]        = &Session::HandleAddTorrent;
+    m_alertHandlers[lt::alerts_dropped_alert::alert_type]     = &Session::HandleAlertsDropped;
+    m_alertHandlers[lt::dht_stats_alert::alert_type]          = &Session::HandleDhtStats;
+    m_alertHandlers[lt::file_progress_alert::alert_type]      = &Session::HandleFileProgress;
+    m_alertHandlers[lt::metadata_received_alert::alert_type]  = &Session::HandleMetadataReceived;
+    m_alertHandlers[lt::peer_info_alert::alert_type]          = &Session::HandlePeerInfo;
+    m_alertHandlers[lt::piece_finished_alert::alert_type]     = &Session::HandlePieceFinished;
+    m_alertHandlers[lt::save_resume_data_alert::alert_type]   = &Session::HandleSaveResumeData;
+    m_alertHandlers[lt::save_resume_data_failed_alert::alert_type] = &Session::HandleSaveResumeDataFailed;
+    m_alertHandlers[lt::session_stats_alert::alert_type]      = &Session::HandleSessionStats;
+    m_alertHandlers[lt::state_update_alert::alert_type]       = &Session::HandleStateUpdate;
+    m_alertHandlers[lt::storage_moved_alert::alert_type]      = &Session::HandleStorageMoved;
+    m_alertHandlers[lt::storage_moved_failed_alert::alert_type] = &Session::HandleStorageMovedFailed;
+    m_alertHandlers[lt::torrent_checked_alert::alert_type]    = &Session::HandleTorrentChecked;
+    m_alertHandlers[lt::torrent_finished_alert::alert_type]   = &Session::HandleTorrentFinished;
+    m_alertHandlers[lt::torrent_paused_alert::alert_type]     = &Session::HandleTorrentPaused;
+    m_alertHandlers[lt::torrent_removed_alert::alert_type]    = &Session::HandleTorrentRemoved;
+    m_alertHandlers[lt::torrent_resumed_alert::alert_type]    = &Session::HandleTorrentResumed;
+    m_alertHandlers[lt::tracker_announce_alert::alert_type]   = &Session::HandleTrackerAnnounce;
+    m_alertHandlers[lt::tracker_error_alert::alert_type]      = &Session::HandleTrackerError;
+    m_alertHandlers[lt::tracker_reply_alert::alert_type]      = &Session::HandleTrackerReply;
+
+    lt::session_params params = porla::Utils::Phases::Startup().Measure(
+        "session.params",
+        [this]() { return ReadSessionParams(m_session_params_file); });
     params.settings = options.settings;
 
+    if (options.disk_io)
+    {
+        params.disk_io_constructor = options.disk_io;
+    }
+
+    // The mask follows the handlers and subscribers, whatever the settings say.
+    m_alertMask = AlertMask();
+    params.settings.set_int(lt::settings_pack::alert_mask, static_cast<int>(static_cast<std::uint32_t>(m_alertMask)));
+
+    m_instrumentation.alert_queue_size = params.settings.get_int(lt::settings_pack::alert_queue_size);
+
     m_session = std::make_unique<lt::session>(std::move(params));
+    m_settings = m_session->get_settings();
 
     if (auto extensions = options.extensions)
     {
@@ -169,437 +560,2322 @@ Session::Session(boost::asio::io_context& io, porla::SessionOptions const& optio
         m_session->add_extension(&lt::create_smart_ban_plugin);
     }
 
-    m_session->set_alert_notify(
-        [this]()
+    m_session->add_extension(
+        [this](const lt::torrent_handle& th, lt::client_data_t userdata)
         {
-            boost::asio::post(m_io, [this] { ReadAlerts(); });
+            return JoinPeerClasses(th, userdata);
         });
 
+    for (const auto& plugin : options.plugins)
+    {
+        m_session->add_extension(plugin);
+    }
+
+    // Peers asking for an auto managed parked torrent bring it back, for the queue to
+    // start it. The others wait on being resumed.
+    if (m_parkAfter.count() > 0)
+    {
+        m_session->add_extension(std::make_shared<UnknownTorrentPlugin>(
+            [this](const lt::info_hash_t& info_hash)
+            {
+                boost::asio::post(
+                    m_io,
+                    [this, info_hash]()
+                    {
+                        const auto status = m_statuses.find(info_hash);
+
+                        if (status != m_statuses.end()
+                            && m_parked.contains(info_hash)
+                            && (status->second.flags & lt::torrent_flags::auto_managed))
+                        {
+                            Unpark(info_hash, false);
+                        }
+                    });
+            }));
+    }
+
+    for (const auto& peer_class : options.peer_classes)
+    {
+        SetPeerClass(peer_class);
+    }
+
+    if (!options.peer_classes.empty())
+    {
+        BOOST_LOG_TRIVIAL(info) << "Created " << options.peer_classes.size() << " peer class(es)";
+    }
+
+    if (!m_alertThreadEnabled)
+    {
+        m_session->set_alert_notify(
+            [this]()
+            {
+                boost::asio::post(m_io, [this, notified = std::chrono::steady_clock::now()] { ReadAlerts(notified); });
+            });
+    }
+
     if (options.timer_dht_stats > 0)
-        m_timers.emplace_back(m_io, options.timer_dht_stats, [&]() { m_session->post_dht_stats(); });
+        m_timers.try_emplace(
+            Stats::Dht,
+            m_io,
+            options.timer_dht_stats,
+            options.timer_dht_stats_idle,
+            [&]() { m_session->post_dht_stats(); });
 
     if (options.timer_session_stats > 0)
-        m_timers.emplace_back(m_io, options.timer_session_stats, [&]() { m_session->post_session_stats(); });
+        m_timers.try_emplace(
+            Stats::Session,
+            m_io,
+            options.timer_session_stats,
+            options.timer_session_stats_idle,
+            [&]() { m_session->post_session_stats(); });
 
     if (options.timer_torrent_updates > 0)
-        m_timers.emplace_back(m_io, options.timer_torrent_updates, [&]() { m_session->post_torrent_updates(); });
+        m_timers.try_emplace(
+            Stats::Torrents,
+            m_io,
+            options.timer_torrent_updates,
+            options.timer_torrent_updates_idle,
+            [&]() { m_session->post_torrent_updates(); });
 }
 
 Session::~Session()
 {
+    // Maximum number of outstanding save_resume_data requests. Keeps the alert queue from
+    // overflowing while still giving the disk threads enough work.
+    static constexpr int SaveWindow = 500;
+
     BOOST_LOG_TRIVIAL(info) << "Shutting down session";
 
+    if (m_load)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Stopped loading torrents, " << m_loadProgress.loaded << " (of " << m_loadProgress.total << ") loaded";
+
+        {
+            std::unique_lock lock(m_load->mtx);
+            m_load->cancelled = true;
+        }
+
+        m_load->cv.notify_all();
+        m_load->reader.join();
+        m_load->pool->join();
+        m_load.reset();
+    }
+
+    if (m_alertThread.joinable())
+    {
+        m_alertThreadStopping = true;
+        m_alertThread.join();
+    }
+
+    // Batches the io thread did not get to are dropped, like posted reads would be.
+    AlertBatch* batch;
+    while (m_alertQueue.pop(batch)) delete batch;
+
     m_session->set_alert_notify([]{});
     m_timers.clear();
+    m_resaveTimer.cancel();
+    m_checkpointTimer.cancel();
+    m_dhtStateTimer.cancel();
+    m_parkTimer.cancel();
 
     WriteSessionParams(
             m_session_params_file,
-            m_session->session_state());
+            m_session->session_state(lt::session::save_dht_state));
 
     m_session->pause();
 
-    int chunk_size = 1000;
-    int chunks = static_cast<int>(m_torrents.size() / chunk_size) + 1;
+    const auto save_start = std::chrono::steady_clock::now();
 
-    BOOST_LOG_TRIVIAL(info) << "Saving resume data in " << chunks << " chunk(s) - total torrents: " << m_torrents.size();
+    // One bulk status request instead of a round trip per torrent. Torrents which do not
+    // need saving already have current state stored.
+    const auto statuses = m_session->get_torrent_status(
+        [](const lt::torrent_status& ts)
+        {
+            return ts.has_metadata && ts.need_save_resume;
+        },
+        {});
 
-    auto current = m_torrents.begin();
+    std::map<lt::info_hash_t, int> queue_positions;
 
-    for (int i = 0; i < chunks; i++)
+    for (auto const& ts : statuses)
     {
-        int chunk_items = std::min(
-            chunk_size,
-            static_cast<int>(std::distance(current, m_torrents.end())));
+        queue_positions.insert({ ts.info_hashes, static_cast<int>(ts.queue_position) });
+    }
 
-        int outstanding = 0;
+    BOOST_LOG_TRIVIAL(info) << "Saving resume data for " << statuses.size() << " torrent(s) (out of " << m_torrents.size() << ")";
 
-        for (int j = 0; j < chunk_items; j++)
-        {
-            auto const& th = current->second;
-            auto const& ts = th.status();
+    auto next = statuses.begin();
+    int outstanding = 0;
+    int saved = 0;
 
-            if (!th.is_valid()
-                || !ts.has_metadata
-                || !ts.need_save_resume)
+    while (next != statuses.end() || outstanding > 0)
+    {
+        for (; next != statuses.end() && outstanding < SaveWindow; std::advance(next, 1))
+        {
+            if (!next->handle.is_valid())
             {
-                std::advance(current, 1);
                 continue;
             }
 
-            th.save_resume_data(
+            next->handle.save_resume_data(
                 lt::torrent_handle::flush_disk_cache
                 | lt::torrent_handle::save_info_dict
                 | lt::torrent_handle::only_if_modified);
 
             outstanding++;
-
-            std::advance(current, 1);
         }
 
-        BOOST_LOG_TRIVIAL(info) << "Chunk " << i + 1 << " - Saving state for " << outstanding << " torrent(s) (out of " << chunk_items << ")";
+        if (outstanding == 0)
+        {
+            continue;
+        }
 
-        while (outstanding > 0)
+        if (m_session->wait_for_alert(lt::seconds(10)) == nullptr)
         {
-            lt::alert const* tmp = m_session->wait_for_alert(lt::seconds(10));
-            if (tmp == nullptr) { continue; }
+            BOOST_LOG_TRIVIAL(warning) << "Still waiting for resume data from " << outstanding << " torrent(s)";
+            continue;
+        }
 
-            std::vector<lt::alert*> alerts;
-            m_session->pop_alerts(&alerts);
+        std::vector<lt::alert*> alerts;
+        m_session->pop_alerts(&alerts);
 
-            for (lt::alert* a : alerts)
+        for (lt::alert* a : alerts)
+        {
+            if (lt::alert_cast<lt::save_resume_data_failed_alert>(a))
             {
-                if (lt::alert_cast<lt::torrent_paused_alert>(a))
-                {
-                    continue;
-                }
-
-                if (auto fail = lt::alert_cast<lt::save_resume_data_failed_alert>(a))
-                {
-                    outstanding--;
-
-                    BOOST_LOG_TRIVIAL(error)
-                        << "Failed to save resume data for "
-                        << fail->torrent_name()
-                        << ": " << fail->message();
+                outstanding--;
+                continue;
+            }
 
-                    continue;
-                }
+            auto* rd = lt::alert_cast<lt::save_resume_data_alert>(a);
+            if (!rd) { continue; }
 
-                auto* rd = lt::alert_cast<lt::save_resume_data_alert>(a);
-                if (!rd) { continue; }
+            outstanding--;
+            saved++;
 
-                outstanding--;
+            const auto hashes = rd->handle.info_hashes();
+            const auto queue_position = queue_positions.find(hashes);
 
-                AddTorrentParams::Update(m_db, rd->handle.info_hashes(), AddTorrentParams{
-                    .client_data    = rd->handle.userdata().get<TorrentClientData>(),
-                    .name           = rd->params.name,
-                    .params         = rd->params,
-                    .queue_position = static_cast<int>(rd->handle.status().queue_position),
-                    .save_path      = rd->params.save_path
-                });
-            }
+            m_writer->Upsert(hashes, AddTorrentParams{
+                .client_data    = rd->handle.userdata().get<TorrentClientData>(),
+                .name           = rd->params.name,
+                .params         = rd->params,
+                .queue_position = queue_position != queue_positions.end() ? queue_position->second : -1,
+                .save_path      = rd->params.save_path
+            });
         }
     }
 
+    BOOST_LOG_TRIVIAL(info) << "Resume data saved for " << saved << " torrent(s), writing to database";
+
+    porla::Utils::Phases::Shutdown().Record("session.resume_data", std::chrono::steady_clock::now() - save_start);
+    porla::Utils::Phases::Shutdown().Measure("session.persistence", [this]() { m_writer->Drain(); });
+
     BOOST_LOG_TRIVIAL(info) << "All state saved";
 }
 
 void Session::Load()
 {
-    int count = AddTorrentParams::Count(m_db);
-    int current = 0;
+    LoadTorrents();
 
-    BOOST_LOG_TRIVIAL(info) << "Loading " << count << " torrent(s) from storage";
+    if (m_checkpointInterval.count() > 0)
+    {
+        m_checkpointTimer.expires_after(m_checkpointInterval);
+        m_checkpointTimer.async_wait([this](const boost::system::error_code& ec) { if (!ec) Checkpoint(); });
+    }
 
-    AddTorrentParams::ForEach(
-        m_db,
-        [&](lt::add_torrent_params& params)
-        {
-            current++;
+    if (m_dhtStateInterval.count() > 0)
+    {
+        m_dhtStateTimer.expires_after(m_dhtStateInterval);
+        m_dhtStateTimer.async_wait([this](const boost::system::error_code& ec) { if (!ec) SaveDhtState(); });
+    }
 
-            lt::torrent_handle th = m_session->add_torrent(params);
-            m_torrents.insert({ th.info_hashes(), th });
+    if (m_parkAfter.count() > 0)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Parking torrents paused and idle for " << m_parkAfter.count() << "s";
 
-            if (current % 1000 == 0 && current != count)
-            {
-                BOOST_LOG_TRIVIAL(info) << current << " torrents (of " << count << ") added";
-            }
-        });
+        m_parkTimer.expires_after(ParkInterval);
+        m_parkTimer.async_wait([this](const boost::system::error_code& ec) { if (!ec) ParkIdle(); });
+    }
 
-    if (count > 0)
+    if (m_alertThreadEnabled)
     {
-        BOOST_LOG_TRIVIAL(info) << "Added " << current << " (of " << count << ") torrent(s) to session";
+        BOOST_LOG_TRIVIAL(info) << "Reading alerts on a dedicated thread";
+        m_alertThread = std::thread([this]() { RunAlertThread(); });
     }
 }
 
-lt::info_hash_t Session::AddTorrent(lt::add_torrent_params const& p)
+void Session::LoadTorrents()
 {
-    lt::error_code ec;
-    lt::torrent_handle th = m_session->add_torrent(p, ec);
+    const int count = AddTorrentParams::Count(m_db);
 
-    if (ec)
+    BOOST_LOG_TRIVIAL(info) << "Loading " << count << " torrent(s) from storage";
+
+    m_loadProgress = LoadProgress{ .done = count == 0, .total = count };
+
+    if (count == 0)
     {
-        BOOST_LOG_TRIVIAL(error) << "Failed to add torrent: " << ec;
-        return {};
+        return;
     }
 
-    lt::torrent_status ts = th.status();
+    m_torrents.reserve(static_cast<std::size_t>(count));
 
-    AddTorrentParams::Insert(m_db, ts.info_hashes, AddTorrentParams{
-        .client_data    = p.userdata.get<TorrentClientData>(),
-        .name           = ts.name,
-        .params         = p,
-        .queue_position = static_cast<int>(ts.queue_position),
-        .save_path      = ts.save_path,
-    });
+    m_load = std::make_unique<LoadState>();
+    m_load->count    = count;
+    m_load->start    = std::chrono::steady_clock::now();
+    m_load->decoders = std::max(1u, std::thread::hardware_concurrency());
+    m_load->pool     = std::make_unique<boost::asio::thread_pool>(m_load->decoders);
 
-    th.save_resume_data(
-        lt::torrent_handle::flush_disk_cache
-        | lt::torrent_handle::save_info_dict
-        | lt::torrent_handle::only_if_modified);
+    m_load->reader = std::thread(
+        [this, &load = *m_load]()
+        {
+            const auto read_start = std::chrono::steady_clock::now();
 
-    m_torrents.insert({ ts.info_hashes, th });
-    m_torrentAdded(ts);
+            try
+            {
+                const auto read = [this, &load](AddTorrentParams::Row&& row)
+                    {
+                        // Stored for another shard.
+                        if (m_loads && !m_loads(row))
+                        {
+                            load.skipped++;
+                            return;
+                        }
+
+                        int seq;
+
+                        {
+                            std::unique_lock lock(load.mtx);
+                            load.cv.wait(lock, [&] { return load.cancelled || load.rows_read - load.next_seq < LoadReadAhead; });
+
+                            if (load.cancelled)
+                            {
+                                throw std::runtime_error("Loading was cancelled");
+                            }
+
+                            seq = load.rows_read++;
+                        }
+
+                        boost::asio::post(
+                            *load.pool,
+                            [this, &load, seq, row = std::move(row)]()
+                            {
+                                if (load.cancelled)
+                                {
+                                    return;
+                                }
+
+                                const auto decode_start = std::chrono::steady_clock::now();
+
+                                std::optional<lt::add_torrent_params> params = lt::add_torrent_params{};
+
+                                try
+                                {
+                                    if (!AddTorrentParams::Decode(row, *params))
+                                    {
+                                        params.reset();
+                                    }
+                                }
+                                catch (const std::exception& ex)
+                                {
+                                    BOOST_LOG_TRIVIAL(error) << "Failed to decode torrent " << row.name << ": " << ex.what();
+                                    params.reset();
+                                }
+
+                                const auto elapsed = std::chrono::steady_clock::now() - decode_start;
+
+                                load.decode_us += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+                                {
+                                    std::unique_lock lock(load.mtx);
+                                    load.decoded.insert({ seq, LoadState::Decoded{
+                                        .params  = std::move(params),
+                                        .seconds = std::chrono::duration<double>(elapsed).count(),
+                                        .parked  = row.parked
+                                    }});
+                                }
+
+                                PostLoadStep(load);
+                            });
+                    };
+
+                std::optional<Data::StateSnapshot::LoadStats> snapshot;
+
+                if (!m_state_snapshot_file.empty())
+                {
+                    snapshot = Data::StateSnapshot::ForEachRow(m_db, m_state_snapshot_file, read);
+                }
 
-    return ts.info_hashes;
-}
+                if (snapshot.has_value())
+                {
+                    BOOST_LOG_TRIVIAL(info) << "Read " << snapshot->snapshot << " torrent(s) from the state snapshot and "
+                        << snapshot->database << " from the database";
+                }
+                else
+                {
+                    AddTorrentParams::ForEachRow(m_db, read);
+                }
+            }
+            catch (...)
+            {
+                std::unique_lock lock(load.mtx);
+                if (!load.cancelled) load.reader_error = std::current_exception();
+            }
 
-void Session::ApplySettings(const libtorrent::settings_pack& settings)
-{
-    BOOST_LOG_TRIVIAL(debug) << "Applying session settings";
-    m_session->apply_settings(settings);
-}
+            {
+                std::unique_lock lock(load.mtx);
+                load.read_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - read_start);
+                load.reader_done = true;
+            }
 
-void Session::Pause()
-{
-    m_session->pause();
+            PostLoadStep(load);
+        });
 }
 
-void Session::Recheck(const lt::info_hash_t &hash)
+// Called by libtorrent on the network thread for every torrent added, loaded ones too, and
+// only used to put the torrent in the peer classes of its category.
+std::shared_ptr<lt::torrent_plugin> Session::JoinPeerClasses(const lt::torrent_handle& th, lt::client_data_t userdata)
 {
-    const auto& handle = m_torrents.at(hash);
+    const auto client_data = userdata.get<TorrentClientData>();
 
-    // If the torrent is paused, it must be resumed in order to be rechecked.
-    // It should also not be auto managed, so remove it from that as well.
-    // When the session posts a torrent_check alert, restore its flags.
+    if (client_data == nullptr || !client_data->category.has_value())
+    {
+        return nullptr;
+    }
+
+    std::unique_lock lock(m_peerClassesMutex);
+
+    const auto classes = m_categoryClasses.find(client_data->category->str());
+
+    if (classes == m_categoryClasses.end())
+    {
+        return nullptr;
+    }
+
+    const auto t = th.native_handle();
+    const auto impl = m_session->native_handle();
+
+    for (const auto id : classes->second)
+    {
+        t->add_class(impl->peer_classes(), id);
+    }
+
+    return nullptr;
+}
+
+void Session::LoadStep()
+{
+    // Steps posted before loading finished may still be queued.
+    if (!m_load)
+    {
+        return;
+    }
+
+    auto& load = *m_load;
+    load.step_posted = false;
+
+    // Counted from all of them, until the rows of other shards are skipped.
+    m_loadProgress.total = load.count - load.skipped;
+
+    if (!load.loaded.empty())
+    {
+        std::vector<lt::torrent_status> loaded;
+        loaded.swap(load.loaded);
+
+        Emit("torrents_loaded", m_torrentsLoaded, loaded);
+    }
+
+    std::vector<lt::add_torrent_params> batch;
+    std::vector<lt::add_torrent_params> parked;
+    bool read_all;
+
+    {
+        std::unique_lock lock(load.mtx);
+
+        while (load.pending + static_cast<int>(batch.size()) < LoadBatchSize)
+        {
+            auto node = load.decoded.extract(load.next_seq);
+
+            if (node.empty())
+            {
+                break;
+            }
+
+            load.next_seq++;
+
+            // Observed here since the histogram is not shared with the decoders.
+            m_instrumentation.load_decode.Observe(node.mapped().seconds);
+
+            if (node.mapped().params.has_value())
+            {
+                // Parked torrents stay out of libtorrent, unless parking was turned off.
+                auto& target = node.mapped().parked && m_parkAfter.count() > 0 ? parked : batch;
+                target.push_back(std::move(*node.mapped().params));
+            }
+            else
+            {
+                m_loadProgress.failed++;
+            }
+        }
+
+        read_all = load.reader_done && load.next_seq >= load.rows_read;
+    }
+
+    // Wake the reader if it is waiting on the read-ahead window.
+    load.cv.notify_all();
+
+    const auto now = std::chrono::steady_clock::now();
+
+    for (auto& params : batch)
+    {
+        load.adding.insert({ params.userdata.get<TorrentClientData>(), now });
+        load.pending++;
+
+        m_session->async_add_torrent(std::move(params));
+    }
+
+    for (const auto& params : parked)
+    {
+        auto ts = ParkedStatus(params);
+
+        m_parked.insert({ ts.info_hashes, params.userdata.get<TorrentClientData>() });
+        m_statuses.insert_or_assign(ts.info_hashes, ts);
+        load.loaded.push_back(std::move(ts));
+        m_loadProgress.loaded++;
+    }
+
+    if (read_all && load.pending == 0)
+    {
+        // Parked ones are done as soon as they are read, so there may be no later step.
+        if (!load.loaded.empty())
+        {
+            std::vector<lt::torrent_status> loaded;
+            loaded.swap(load.loaded);
+
+            Emit("torrents_loaded", m_torrentsLoaded, loaded);
+        }
+
+        FinishLoading();
+    }
+}
+
+// Called from the reader and decoders too, which is why the state is passed in rather than
+// read from m_load.
+void Session::PostLoadStep(LoadState& load)
+{
+    // Decoders finish faster than the io thread adds, so one queued step is enough.
+    if (!load.step_posted.exchange(true))
+    {
+        boost::asio::post(m_io, [this]() { LoadStep(); });
+    }
+}
+
+void Session::FinishLoading()
+{
+    const auto load = std::move(m_load);
+
+    load->reader.join();
+    load->pool->join();
+
+    m_loadProgress.done  = true;
+    m_loadProgress.total = load->count - load->skipped;
+
+    if (load->reader_error)
+    {
+        try
+        {
+            std::rethrow_exception(load->reader_error);
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(fatal) << "Failed to read torrents from storage: " << ex.what();
+        }
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Added " << m_loadProgress.loaded << " (of " << m_loadProgress.total << ") torrent(s) to session";
+
+    if (m_loadProgress.failed > 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << m_loadProgress.failed << " torrent(s) could not be loaded";
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - load->start;
+
+    porla::Utils::Phases::Startup().Record("torrents", elapsed);
+
+    const auto& decode = m_instrumentation.load_decode;
+    const auto& add    = m_instrumentation.load_add;
+
+    BOOST_LOG_TRIVIAL(info) << "Loaded torrents in "
+                            << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << "ms "
+                            << "(read: " << load->read_time.count() << "ms, "
+                            << "decode: " << load->decode_us / 1000 << "ms on " << load->decoders << " thread(s), "
+                            << "decode p50/p99: " << decode.Quantile(0.5) * 1000 << "/" << decode.Quantile(0.99) * 1000 << "ms, "
+                            << "add p50/p99: " << add.Quantile(0.5) * 1000 << "/" << add.Quantile(0.99) * 1000 << "ms)";
+}
+
+Session::DemandToken Session::Demand(Stats stats)
+{
+    const auto timer = m_timers.find(stats);
+
+    if (timer == m_timers.end())
+    {
+        return nullptr;
+    }
+
+    timer->second.Raise();
+
+    // The token is released on the io thread, since that is where the timer lives.
+    return DemandToken(
+        new int(0),
+        [this, stats](int* ptr)
+        {
+            delete ptr;
+            boost::asio::post(
+                m_io,
+                [this, stats]
+                {
+                    if (const auto t = m_timers.find(stats); t != m_timers.end()) t->second.Lower();
+                });
+        });
+}
+
+void Session::SetTimers(const Timers& timers)
+{
+    if (const auto t = m_timers.find(Stats::Dht); t != m_timers.end())
+        t->second.SetIntervals(timers.dht_stats, timers.dht_stats_idle);
+
+    if (const auto t = m_timers.find(Stats::Session); t != m_timers.end())
+        t->second.SetIntervals(timers.session_stats, timers.session_stats_idle);
+
+    if (const auto t = m_timers.find(Stats::Torrents); t != m_timers.end())
+        t->second.SetIntervals(timers.torrent_updates, timers.torrent_updates_idle);
+
+    // Used from the next checkpoint on.
+    if (m_checkpointInterval.count() > 0 && timers.resume_data > 0)
+    {
+        m_checkpointInterval = std::chrono::milliseconds(timers.resume_data);
+    }
+}
+
+lt::info_hash_t Session::AddTorrent(lt::add_torrent_params const& p)
+{
+    if (m_draining)
+    {
+        throw std::runtime_error("Session is draining");
+    }
+
+    lt::error_code ec;
+    lt::torrent_handle th = m_session->add_torrent(p, ec);
+
+    if (ec)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to add torrent: " << ec;
+        return {};
+    }
+
+    lt::torrent_status ts = th.status();
+
+    m_writer->Upsert(ts.info_hashes, AddTorrentParams{
+        .client_data    = p.userdata.get<TorrentClientData>(),
+        .name           = ts.name,
+        .params         = p,
+        .queue_position = static_cast<int>(ts.queue_position),
+        .save_path      = ts.save_path,
+    });
+
+    th.save_resume_data(
+        lt::torrent_handle::flush_disk_cache
+        | lt::torrent_handle::save_info_dict
+        | lt::torrent_handle::only_if_modified);
+
+    m_torrents.insert({ ts.info_hashes, th });
+    m_statuses.insert_or_assign(ts.info_hashes, ts);
+    Emit("torrent_added", m_torrentAdded, ts);
+
+    return ts.info_hashes;
+}
+
+void Session::AddTorrents(std::vector<lt::add_torrent_params> params, AddTorrentsCallback done)
+{
+    if (params.empty())
+    {
+        return done({});
+    }
+
+    if (m_draining)
+    {
+        return done(std::vector<AddTorrentResult>(params.size(), AddTorrentResult{ .error = "Session is draining" }));
+    }
+
+    auto pending = std::make_shared<PendingAdd>(PendingAdd{
+        .results   = std::vector<AddTorrentResult>(params.size()),
+        .remaining = params.size(),
+        .done      = std::move(done)
+    });
+
+    for (std::size_t i = 0; i < params.size(); i++)
+    {
+        auto& p = params[i];
+
+        if (p.userdata.get<TorrentClientData>() == nullptr)
+        {
+            p.userdata = lt::client_data_t(new TorrentClientData());
+        }
+
+        m_adding.insert({ p.userdata.get<TorrentClientData>(), Adding{
+            .batch       = pending,
+            .index       = i,
+            .info_hashes = p.ti ? p.ti->info_hashes() : p.info_hashes
+        }});
+        m_session->async_add_torrent(std::move(p));
+    }
+}
+
+void Session::Drain(bool pause)
+{
+    if (!m_draining)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Draining session, no more torrents will be added";
+        m_draining = true;
+    }
+
+    if (pause)
+    {
+        m_session->pause();
+    }
+
+    // Already being saved by a checkpoint or a resave if not empty, and the rest join it.
+    const bool ticking = !m_resave.empty();
+
+    for (const auto& [hashes, ts] : m_statuses)
+    {
+        if (ts.handle.is_valid() && ts.has_metadata && ts.need_save_resume && Owns(hashes) && m_drainSaving.insert(hashes).second)
+        {
+            // Flushing the disk cache too, since shutdown follows.
+            m_resave.emplace_back(
+                ts.handle,
+                lt::torrent_handle::flush_disk_cache | lt::torrent_handle::save_info_dict | lt::torrent_handle::only_if_modified);
+        }
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Saving resume data for " << m_drainSaving.size() << " torrent(s) before shutdown";
+
+    if (m_drainSaving.empty())
+    {
+        m_writer->Flush();
+    }
+    else if (!ticking)
+    {
+        ResaveTick();
+    }
+}
+
+porla::ISession::DrainProgress Session::Draining() const
+{
+    const auto writes = m_writer->Pending();
+
+    return DrainProgress{
+        .draining = m_draining,
+        .saving   = static_cast<int>(m_drainSaving.size()),
+        .writes   = writes,
+        .drained  = m_draining && m_drainSaving.empty() && writes == 0
+    };
+}
+
+void Session::Drained(const lt::info_hash_t& hash)
+{
+    // What is left of the drain is written right away, rather than in the next batch.
+    if (m_drainSaving.erase(hash) > 0 && m_drainSaving.empty())
+    {
+        BOOST_LOG_TRIVIAL(info) << "Resume data saved, writing to database";
+        m_writer->Flush();
+    }
+}
+
+void Session::ApplySettings(const libtorrent::settings_pack& settings)
+{
+    BOOST_LOG_TRIVIAL(debug) << "Applying session settings";
+
+    auto pack = settings;
+    pack.set_int(lt::settings_pack::alert_mask, static_cast<int>(static_cast<std::uint32_t>(m_alertMask)));
+
+    if (pack.has_val(lt::settings_pack::alert_queue_size))
+    {
+        m_instrumentation.alert_queue_size = pack.get_int(lt::settings_pack::alert_queue_size);
+    }
+
+    porla::Utils::SettingsPack::Merge(m_settings, pack);
+    m_session->apply_settings(std::move(pack));
+}
+
+std::vector<lt::info_hash_t> Session::EditClientData(
+    const std::vector<lt::info_hash_t>& hashes,
+    const std::function<bool(TorrentClientData&)>& edit)
+{
+    std::vector<lt::info_hash_t> changed;
+    std::vector<std::pair<lt::info_hash_t, TorrentClientData>> writes;
+
+    for (const auto& hash : hashes)
+    {
+        if (!Owns(hash))
+        {
+            continue;
+        }
+
+        TorrentClientData* client_data = nullptr;
+
+        if (const auto torrent = m_torrents.find(hash); torrent != m_torrents.end())
+        {
+            client_data = torrent->second.userdata().get<TorrentClientData>();
+        }
+        else if (const auto parked = m_parked.find(hash); parked != m_parked.end())
+        {
+            client_data = parked->second;
+        }
+
+        if (client_data == nullptr || !edit(*client_data))
+        {
+            continue;
+        }
+
+        client_data->revision++;
+
+        changed.push_back(hash);
+        writes.emplace_back(hash, *client_data);
+    }
+
+    if (changed.empty())
+    {
+        return changed;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Edited client data of " << changed.size() << " torrent(s)";
+
+    // Only the client data column is written, so there is no resume data to ask for.
+    m_writer->UpdateClientData(writes);
+
+    Emit("client_data_changed", m_clientDataChanged, changed);
+
+    return changed;
+}
+
+template<typename T>
+void Session::Fetch(
+    FetchedMap<T>& cache,
+    const lt::info_hash_t& hash,
+    std::function<void(std::shared_ptr<const T>)> done,
+    const std::function<void(const lt::torrent_handle&)>& post)
+{
+    auto torrent = m_torrents.find(hash);
+
+    if (torrent == m_torrents.end())
+    {
+        return done(nullptr);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    if (!cache.contains(hash))
+    {
+        // What nobody asked for in a while is dropped as other torrents are viewed.
+        std::erase_if(
+            cache,
+            [&now](const auto& entry)
+            {
+                return entry.second.waiting.empty() && now - entry.second.fetched > FetchedTtl;
+            });
+    }
+
+    auto& entry = cache[hash];
+
+    if (entry.value != nullptr && now - entry.fetched < FetchedTtl)
+    {
+        return done(entry.value);
+    }
+
+    entry.waiting.push_back(std::move(done));
+
+    // One fetch answers everybody waiting on it.
+    if (entry.waiting.size() == 1)
+    {
+        post(torrent->second);
+    }
+}
+
+template<typename T>
+void Session::Resolve(FetchedMap<T>& cache, const lt::info_hash_t& hash, T value)
+{
+    auto entry = cache.find(hash);
+
+    if (entry == cache.end())
+    {
+        return;
+    }
+
+    entry->second.fetched = std::chrono::steady_clock::now();
+    entry->second.value   = std::make_shared<const T>(std::move(value));
+
+    const auto result = entry->second.value;
+    auto waiting = std::move(entry->second.waiting);
+    entry->second.waiting.clear();
+
+    for (auto& done : waiting)
+    {
+        done(result);
+    }
+}
+
+void Session::FileProgress(const lt::info_hash_t& hash, FileProgressCallback done)
+{
+    Fetch(
+        m_fileProgress,
+        hash,
+        std::move(done),
+        [](const lt::torrent_handle& th) { th.post_file_progress(lt::torrent_handle::piece_granularity); });
+}
+
+void Session::Pause()
+{
+    m_session->pause();
+}
+
+bool Session::JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join)
+{
+    const auto torrent = m_torrents.find(hash);
+    const auto existing = m_peerClasses.find(name);
+
+    if (torrent == m_torrents.end() || existing == m_peerClasses.end())
+    {
+        return false;
+    }
+
+    auto t = torrent->second.native_handle();
+
+    if (t == nullptr)
+    {
+        return false;
+    }
+
+    auto impl = m_session->native_handle();
+
+    // Like MovePeerClass, through the torrent on the network thread.
+    boost::asio::post(
+        impl->get_context(),
+        [impl, id = existing->second.second, t = std::move(t), join]()
+        {
+            if (join) t->add_class(impl->peer_classes(), id);
+            else      t->remove_class(impl->peer_classes(), id);
+        });
+
+    return true;
+}
+
+std::vector<porla::PeerClass> Session::PeerClasses() const
+{
+    std::unique_lock lock(m_peerClassesMutex);
+
+    std::vector<PeerClass> result;
+    result.reserve(m_peerClasses.size());
+
+    for (const auto& [name, entry] : m_peerClasses)
+    {
+        result.push_back(entry.first);
+    }
+
+    return result;
+}
+
+void Session::PeerInfo(const lt::info_hash_t& hash, PeerInfoCallback done)
+{
+    Fetch(m_peerInfo, hash, std::move(done), [](const lt::torrent_handle& th) { th.post_peer_info(); });
+}
+
+void Session::Recheck(const lt::info_hash_t &hash)
+{
+    const auto& handle = m_torrents.at(hash);
+
+    // If the torrent is paused, it must be resumed in order to be rechecked.
+    // It should also not be auto managed, so remove it from that as well.
+    // When the session posts a torrent_check alert, restore its flags.
+
+    bool was_auto_managed = false;
+    bool was_paused = false;
+    int alert_type = lt::torrent_checked_alert::alert_type;
+
+    if ((handle.flags() & lt::torrent_flags::auto_managed) == lt::torrent_flags::auto_managed)
+    {
+        handle.unset_flags(lt::torrent_flags::auto_managed);
+        was_auto_managed = true;
+    }
+
+    if ((handle.flags() & lt::torrent_flags::paused) == lt::torrent_flags::paused)
+    {
+        handle.resume();
+        was_paused = true;
+    }
+
+    if (!m_oneshot_torrent_callbacks.contains({ alert_type, hash }))
+    {
+        m_oneshot_torrent_callbacks.insert({{ alert_type, hash }, {}});
+    }
+
+    m_oneshot_torrent_callbacks.at({ alert_type, hash }).emplace_back(
+        [&, hash, was_auto_managed, was_paused]()
+        {
+            if (!m_torrents.contains(hash))
+            {
+                return;
+            }
+
+            // TODO: Unsure about the order here. If there are reports that force-checking a torrent
+            //       leads to any issues with resume/pause, the order of these statements might matter.
+
+            if (was_auto_managed)
+            {
+                m_torrents.at(hash).set_flags(lt::torrent_flags::auto_managed);
+            }
+
+            if (was_paused)
+            {
+                m_torrents.at(hash).pause();
+            }
+        });
+
+    handle.force_recheck();
+}
+
+void Session::Remove(const lt::info_hash_t& hash, bool remove_data)
+{
+    if (const auto parked = m_parked.find(hash); parked != m_parked.end())
+    {
+        // Its files are removed by libtorrent, which needs it back for that.
+        if (remove_data)
+        {
+            if (const auto th = Unpark(hash, false))
+            {
+                m_session->remove_torrent(*th, lt::session::delete_files);
+            }
+
+            return;
+        }
+
+        const auto status = m_statuses.find(hash);
+
+        BOOST_LOG_TRIVIAL(info) << "Torrent " << (status != m_statuses.end() ? status->second.name : ToString(hash)) << " removed";
+
+        m_parked.erase(parked);
+        m_pausedSince.erase(hash);
+        m_writer->Remove(hash);
+        m_statuses.erase(hash);
+        Emit("torrent_removed", m_torrentRemoved, hash);
+
+        m_lifecycle.removed.push_back(hash);
+        FlushLifecycle();
+
+        return;
+    }
+
+    lt::torrent_handle th = m_torrents.at(hash);
+
+    m_session->remove_torrent(th, remove_data ? lt::session::delete_files : lt::remove_flags_t{});
+}
+
+bool Session::RemovePeerClass(const std::string& name)
+{
+    const auto existing = m_peerClasses.find(name);
+
+    if (existing == m_peerClasses.end())
+    {
+        return false;
+    }
+
+    const auto [peer_class, id] = existing->second;
+
+    {
+        std::unique_lock lock(m_peerClassesMutex);
+
+        m_peerClasses.erase(existing);
+        m_categoryClasses = CategoryClasses(m_peerClasses);
+    }
+
+    MovePeerClass(*m_session, m_torrents, id, {}, { peer_class.categories.begin(), peer_class.categories.end() });
+
+    // Posted after the torrents leave the class, so it is gone once they have.
+    m_session->delete_peer_class(id);
+
+    BOOST_LOG_TRIVIAL(info) << "Removed peer class " << name;
+
+    return true;
+}
+
+void Session::Resume()
+{
+    m_session->resume();
+}
+
+void Session::SetPeerClass(const PeerClass& peer_class)
+{
+    lt::peer_class_t id;
+    std::set<std::string> previous;
+
+    if (const auto existing = m_peerClasses.find(peer_class.name); existing != m_peerClasses.end())
+    {
+        id = existing->second.second;
+        previous.insert(existing->second.first.categories.begin(), existing->second.first.categories.end());
+    }
+    else
+    {
+        id = m_session->create_peer_class(peer_class.name.c_str());
+    }
+
+    auto info = m_session->get_peer_class(id);
+    info.label             = peer_class.name;
+    info.download_limit    = std::max(0, peer_class.download_limit);
+    info.upload_limit      = std::max(0, peer_class.upload_limit);
+    info.download_priority = std::clamp(peer_class.download_priority, 1, 255);
+    info.upload_priority   = std::clamp(peer_class.upload_priority, 1, 255);
+    info.ignore_unchoke_slots = peer_class.ignore_unchoke_slots;
+
+    m_session->set_peer_class(id, info);
+
+    {
+        std::unique_lock lock(m_peerClassesMutex);
+
+        m_peerClasses.insert_or_assign(peer_class.name, std::make_pair(peer_class, id));
+        m_categoryClasses = CategoryClasses(m_peerClasses);
+    }
+
+    std::set<std::string> joining;
+    std::set<std::string> leaving = previous;
+
+    for (const auto& category : peer_class.categories)
+    {
+        leaving.erase(category);
+        if (!previous.contains(category)) joining.insert(category);
+    }
+
+    // Torrents added from now on join in JoinPeerClasses, and the ones already in the
+    // session are moved here.
+    MovePeerClass(*m_session, m_torrents, id, joining, leaving);
+
+    BOOST_LOG_TRIVIAL(debug) << "Set peer class " << peer_class.name << " for " << peer_class.categories.size() << " category(ies)";
+}
+
+lt::settings_pack Session::Settings()
+{
+    return m_settings;
+}
+
+const porla::TorrentClientData* porla::ISession::ClientData(const lt::torrent_status& ts) const
+{
+    if (ts.handle.is_valid())
+    {
+        return ts.handle.userdata().get<TorrentClientData>();
+    }
+
+    return Parked(ts.info_hashes).value_or(nullptr);
+}
+
+std::optional<const porla::TorrentClientData*> Session::Parked(const lt::info_hash_t& hash) const
+{
+    if (const auto parked = m_parked.find(hash); parked != m_parked.end())
+    {
+        return parked->second;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<lt::torrent_handle> Session::Unpark(const lt::info_hash_t& hash, bool resume)
+{
+    const auto parked = m_parked.find(hash);
+
+    if (parked == m_parked.end())
+    {
+        return std::nullopt;
+    }
+
+    // The resume data it was parked with may still be queued for writing.
+    m_writer->Drain();
+
+    lt::add_torrent_params params;
+
+    if (!AddTorrentParams::Get(m_db, hash, params))
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read parked torrent " << ToString(hash);
+        return std::nullopt;
+    }
+
+    // The client data kept while parked is the one the rest of porla knows.
+    delete params.userdata.get<TorrentClientData>();
+    params.userdata = lt::client_data_t(parked->second);
+
+    if (resume)
+    {
+        params.flags &= ~lt::torrent_flags::paused;
+    }
+
+    lt::error_code ec;
+    lt::torrent_handle th = m_session->add_torrent(params, ec);
+
+    if (ec)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to unpark torrent " << params.name << ": " << ec;
+        return std::nullopt;
+    }
+
+    lt::torrent_status ts = th.status();
+
+    m_writer->Upsert(ts.info_hashes, AddTorrentParams{
+        .client_data    = parked->second,
+        .name           = ts.name,
+        .params         = params,
+        .queue_position = static_cast<int>(ts.queue_position),
+        .save_path      = ts.save_path,
+    });
+
+    m_parked.erase(parked);
+    m_torrents.insert({ ts.info_hashes, th });
+    m_statuses.insert_or_assign(ts.info_hashes, ts);
+
+    BOOST_LOG_TRIVIAL(info) << "Torrent " << ts.name << " unparked";
+
+    return th;
+}
+
+const porla::TorrentHandles& Session::Torrents()
+{
+    return m_torrents;
+}
+
+const std::map<lt::info_hash_t, lt::torrent_status>& Session::TorrentStatuses()
+{
+    return m_statuses;
+}
+
+std::optional<porla::DhtStats> Session::Dht() const
+{
+    DhtStats stats{ .state_saved = m_dhtStateSaved };
+
+    for (const auto& [_, node] : m_dhtNodes)
+    {
+        stats.nodes.push_back(node);
+    }
+
+    return stats;
+}
+
+porla::ISession::LoadProgress Session::Loading() const
+{
+    return m_loadProgress;
+}
+
+std::optional<porla::SessionInstrumentation> Session::Instrumentation() const
+{
+    SessionInstrumentation instrumentation = m_instrumentation;
+    instrumentation.alert_queue_depth = m_alertQueueDepth;
+
+    for (int type = 0; type < lt::num_alert_types; type++)
+    {
+        if (m_alertTimings[type].count > 0)
+        {
+            instrumentation.alerts.insert({ lt::alert_name(type), m_alertTimings[type] });
+        }
+    }
+
+    const auto persistence = m_writer->Stats();
+    instrumentation.persist_duration = persistence.duration;
+    instrumentation.persist_size     = persistence.size;
+
+    return instrumentation;
+}
+
+std::vector<Session::Alert> Session::DecodeAlerts(const std::vector<lt::alert*>& alerts) const
+{
+    std::vector<Alert> decoded;
+    decoded.reserve(alerts.size());
+
+    const lt::alert_category_t debug(m_debugAlerts.load());
+
+    for (auto const alert : alerts)
+    {
+        if (alert->category() & debug)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Alert " << alert->what() << ": " << alert->message();
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(trace) << "Session alert: " << alert->message();
+        }
+
+        // Nothing is kept of alerts without a handler.
+        if (m_alertHandlers[alert->type()] == nullptr)
+        {
+            continue;
+        }
+
+        Alert& a = decoded.emplace_back(Alert{ .type = alert->type() });
+
+        if (const auto ta = dynamic_cast<lt::torrent_alert*>(alert))
+        {
+            a.handle = ta->handle;
+            a.name   = ta->torrent_name();
+        }
+
+        // Large members are moved out, since nothing reads the alerts after us.
+        switch (alert->type())
+        {
+        case lt::add_torrent_alert::alert_type:
+        {
+            const auto ata = lt::alert_cast<lt::add_torrent_alert>(alert);
+            a.data = Alert::Added{ .params = std::move(ata->params), .error = ata->error };
+            break;
+        }
+        case lt::alerts_dropped_alert::alert_type:
+        {
+            const auto ada = lt::alert_cast<lt::alerts_dropped_alert>(alert);
+            a.data = Alert::Dropped{ .types = ada->dropped_alerts };
+            break;
+        }
+        case lt::dht_stats_alert::alert_type:
+        {
+            const auto dsa = lt::alert_cast<lt::dht_stats_alert>(alert);
+
+            DhtStats::Node node;
+
+            std::stringstream endpoint;
+            endpoint << dsa->local_endpoint;
+            node.endpoint = endpoint.str();
+
+            for (const auto& bucket : dsa->routing_table)
+            {
+                node.buckets.push_back({
+                    .nodes        = bucket.num_nodes,
+                    .replacements = bucket.num_replacements,
+                    .last_active  = bucket.last_active
+                });
+            }
+
+            for (const auto& lookup : dsa->active_requests)
+            {
+                node.lookups.push_back({
+                    .type                 = lookup.type != nullptr ? lookup.type : "",
+                    .outstanding_requests = lookup.outstanding_requests,
+                    .timeouts             = lookup.timeouts,
+                    .responses            = lookup.responses,
+                    .branch_factor        = lookup.branch_factor,
+                    .nodes_left           = lookup.nodes_left
+                });
+            }
+
+            a.data = Alert::Dht{ .node = std::move(node) };
+            break;
+        }
+        case lt::file_progress_alert::alert_type:
+        {
+            const auto fpa = lt::alert_cast<lt::file_progress_alert>(alert);
+            a.data = Alert::FileProgress{ .progress = std::move(static_cast<std::vector<std::int64_t>&>(fpa->files)) };
+            break;
+        }
+        case lt::peer_info_alert::alert_type:
+        {
+            const auto pia = lt::alert_cast<lt::peer_info_alert>(alert);
+            a.data = Alert::Peers{ .peers = std::move(pia->peer_info) };
+            break;
+        }
+        case lt::piece_finished_alert::alert_type:
+        {
+            const auto pfa = lt::alert_cast<lt::piece_finished_alert>(alert);
+            a.data = Alert::PieceFinished{ .piece = pfa->piece_index };
+            break;
+        }
+        case lt::save_resume_data_alert::alert_type:
+        {
+            const auto srda = lt::alert_cast<lt::save_resume_data_alert>(alert);
+            a.data = Alert::ResumeData{ .params = std::move(srda->params) };
+            break;
+        }
+        case lt::session_stats_alert::alert_type:
+        {
+            const auto ssa = lt::alert_cast<lt::session_stats_alert>(alert);
+            auto const& counters = ssa->counters();
+
+            Alert::Stats stats{ .when = ssa->timestamp() };
+            stats.values.reserve(m_stats.size());
+
+            for (auto const& metric : m_stats)
+            {
+                stats.values.push_back(counters[metric.value_index]);
+            }
+
+            a.data = std::move(stats);
+            break;
+        }
+        case lt::state_update_alert::alert_type:
+        {
+            const auto sua = lt::alert_cast<lt::state_update_alert>(alert);
+            a.data = Alert::StateUpdate{ .status = std::move(sua->status) };
+            break;
+        }
+        case lt::storage_moved_alert::alert_type:
+        {
+            const auto sma = lt::alert_cast<lt::storage_moved_alert>(alert);
+            a.data = Alert::StorageMoved{ .path = sma->storage_path() };
+            break;
+        }
+        case lt::storage_moved_failed_alert::alert_type:
+        {
+            const auto smfa = lt::alert_cast<lt::storage_moved_failed_alert>(alert);
+            a.data = Alert::StorageMoveFailed{ .error = smfa->error, .path = smfa->file_path() };
+            break;
+        }
+        case lt::torrent_removed_alert::alert_type:
+        {
+            const auto tra = lt::alert_cast<lt::torrent_removed_alert>(alert);
+            a.data = Alert::Removed{ .info_hashes = tra->info_hashes };
+            break;
+        }
+        case lt::tracker_announce_alert::alert_type:
+        {
+            const auto taa = lt::alert_cast<lt::tracker_announce_alert>(alert);
+            a.data = TrackerAnnounce{ .kind = TrackerAnnounce::Sent, .handle = taa->handle, .url = taa->tracker_url() };
+            break;
+        }
+        case lt::tracker_error_alert::alert_type:
+        {
+            const auto tea = lt::alert_cast<lt::tracker_error_alert>(alert);
+            a.data = TrackerError{
+                .handle  = tea->handle,
+                .error   = tea->error,
+                .message = tea->error_message(),
+                .name    = a.name,
+                .url     = tea->tracker_url()
+            };
+            break;
+        }
+        case lt::tracker_reply_alert::alert_type:
+        {
+            const auto tra = lt::alert_cast<lt::tracker_reply_alert>(alert);
+            a.data = TrackerAnnounce{
+                .kind      = TrackerAnnounce::Replied,
+                .handle    = tra->handle,
+                .url       = tra->tracker_url(),
+                .num_peers = tra->num_peers
+            };
+            break;
+        }
+        }
+    }
+
+    return decoded;
+}
+
+void Session::DrainAlerts()
+{
+    // Cleared first, so batches pushed while draining post another drain.
+    m_alertDrainPosted = false;
+
+    AlertBatch* item;
+
+    while (m_alertQueue.pop(item))
+    {
+        std::unique_ptr<AlertBatch> batch(item);
+        m_alertQueueDepth--;
+
+        const std::chrono::duration<double> lag = std::chrono::steady_clock::now() - batch->popped;
+
+        m_instrumentation.loop_lag.Observe(lag.count());
+        m_instrumentation.alert_batch_size.Observe(static_cast<double>(batch->alerts.size()));
+
+        HandleAlerts(batch->alerts);
+    }
+}
+
+void Session::ReadAlerts(std::chrono::steady_clock::time_point notified)
+{
+    const std::chrono::duration<double> lag = std::chrono::steady_clock::now() - notified;
+
+    std::vector<lt::alert*> alerts;
+    m_session->pop_alerts(&alerts);
+
+    m_instrumentation.loop_lag.Observe(lag.count());
+    m_instrumentation.alert_batch_size.Observe(static_cast<double>(alerts.size()));
+
+    ProcessAlerts(alerts);
+}
+
+void Session::RunAlertThread()
+{
+    while (!m_alertThreadStopping)
+    {
+        if (m_session->wait_for_alert(lt::milliseconds(100)) == nullptr)
+        {
+            continue;
+        }
+
+        std::vector<lt::alert*> alerts;
+        m_session->pop_alerts(&alerts);
+
+        auto batch = std::make_unique<AlertBatch>(AlertBatch{
+            .popped = std::chrono::steady_clock::now(),
+            .alerts = DecodeAlerts(alerts)
+        });
+
+        // With the io thread this far behind, further alerts wait in the libtorrent queue.
+        while (!m_alertQueue.push(batch.get()))
+        {
+            if (m_alertThreadStopping) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        batch.release();
+        m_alertQueueDepth++;
+
+        if (!m_alertDrainPosted.exchange(true))
+        {
+            boost::asio::post(m_io, [this] { DrainAlerts(); });
+        }
+    }
+}
+
+void Session::ProcessAlerts(const std::vector<lt::alert*>& alerts)
+{
+    auto decoded = DecodeAlerts(alerts);
+    HandleAlerts(decoded);
+}
+
+void Session::HandleAlerts(std::vector<Alert>& alerts)
+{
+    m_requestUpdates = false;
+
+    for (auto& alert : alerts)
+    {
+        const auto handler = m_alertHandlers[alert.type];
+
+        if (handler == nullptr)
+        {
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        (this->*handler)(alert);
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto& timing = m_alertTimings[alert.type];
+        timing.count++;
+        timing.seconds += elapsed.count();
+    }
+
+    // Asked for once per batch, by alerts which need a fresh status.
+    if (m_requestUpdates)
+    {
+        m_session->post_torrent_updates();
+    }
+
+    FlushLifecycle();
+}
+
+void Session::HandleAddTorrent(Alert& alert)
+{
+    auto& added = std::get<Alert::Added>(alert.data);
+    const auto client_data = added.params.userdata.get<TorrentClientData>();
+
+    if (HandleLoadedTorrent(alert))
+    {
+        return;
+    }
+
+    const auto adding = m_adding.find(client_data);
+
+    // Torrents added one at a time are handled where they are added.
+    if (adding == m_adding.end())
+    {
+        return;
+    }
+
+    if (added.error)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to add torrent " << added.params.name << ": " << added.error.message();
+        FinishAdding(adding, {}, added.error.message());
+    }
+    else
+    {
+        const lt::torrent_status ts = alert.handle.status();
+
+        // The write behind queue commits these in batched transactions. Resume data is
+        // saved later as usual rather than asked for per torrent.
+        m_writer->Upsert(ts.info_hashes, AddTorrentParams{
+            .client_data    = client_data,
+            .name           = ts.name,
+            .params         = added.params,
+            .queue_position = static_cast<int>(ts.queue_position),
+            .save_path      = ts.save_path,
+        });
+
+        m_torrents.insert({ ts.info_hashes, alert.handle });
+        m_statuses.insert_or_assign(ts.info_hashes, ts);
+        Emit("torrent_added", m_torrentAdded, ts);
+
+        FinishAdding(adding, ts.info_hashes, "");
+    }
+}
+
+void Session::HandleAlertsDropped(Alert& alert)
+{
+    const auto& dropped = std::get<Alert::Dropped>(alert.data);
+
+    for (int type = 0; type < lt::num_alert_types; type++)
+    {
+        if (dropped.types.test(type))
+        {
+            m_instrumentation.alerts_dropped[lt::alert_name(type)]++;
+        }
+    }
+
+    BOOST_LOG_TRIVIAL(warning) << "Alert queue overflowed, " << dropped.types.count() << " alert type(s) dropped";
+
+    GrowAlertQueue();
+
+    // Lost state updates are asked for again, while lost adds, removals and resume data
+    // leave state which has to be reconciled with the session.
+    if (dropped.types.test(lt::state_update_alert::alert_type))
+    {
+        m_requestUpdates = true;
+    }
+
+    if (dropped.types.test(lt::add_torrent_alert::alert_type)
+        || dropped.types.test(lt::torrent_removed_alert::alert_type))
+    {
+        SyncTorrents();
+    }
+
+    // Draining waits on the failures too.
+    if (dropped.types.test(lt::save_resume_data_alert::alert_type)
+        || (m_draining && dropped.types.test(lt::save_resume_data_failed_alert::alert_type)))
+    {
+        ResaveResumeData();
+    }
+
+    if (dropped.types.test(lt::file_progress_alert::alert_type))
+    {
+        for (const auto& [hash, entry] : m_fileProgress)
+        {
+            if (entry.waiting.empty()) continue;
+            if (auto torrent = m_torrents.find(hash); torrent != m_torrents.end()) torrent->second.post_file_progress(lt::torrent_handle::piece_granularity);
+        }
+    }
+
+    if (dropped.types.test(lt::peer_info_alert::alert_type))
+    {
+        for (const auto& [hash, entry] : m_peerInfo)
+        {
+            if (entry.waiting.empty()) continue;
+            if (auto torrent = m_torrents.find(hash); torrent != m_torrents.end()) torrent->second.post_peer_info();
+        }
+    }
+}
+
+// Returns false for torrents which are not being loaded from storage.
+bool Session::HandleLoadedTorrent(Alert& alert)
+{
+    if (!m_load)
+    {
+        return false;
+    }
+
+    auto& added = std::get<Alert::Added>(alert.data);
+    const auto loading = m_load->adding.find(added.params.userdata.get<TorrentClientData>());
+
+    if (loading == m_load->adding.end())
+    {
+        return false;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - loading->second;
+
+    m_instrumentation.load_add.Observe(elapsed.count());
+    m_load->adding.erase(loading);
+    m_load->pending--;
+
+    if (added.error)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to add torrent " << added.params.name << ": " << added.error.message();
+        m_loadProgress.failed++;
+    }
+    else
+    {
+        const lt::torrent_status ts = alert.handle.status();
+
+        m_torrents.insert({ ts.info_hashes, alert.handle });
+        m_statuses.insert_or_assign(ts.info_hashes, ts);
+        m_load->loaded.push_back(ts);
+        m_loadProgress.loaded++;
+
+        if (m_loadProgress.loaded % 1000 == 0 && m_loadProgress.loaded != m_loadProgress.total)
+        {
+            BOOST_LOG_TRIVIAL(info) << m_loadProgress.loaded << " torrents (of " << m_loadProgress.total << ") added";
+        }
+    }
+
+    PostLoadStep(*m_load);
+
+    return true;
+}
+
+void Session::HandleFileProgress(Alert& alert)
+{
+    Resolve(m_fileProgress, alert.handle.info_hashes(), std::move(std::get<Alert::FileProgress>(alert.data).progress));
+}
+
+void Session::HandleMetadataReceived(Alert& alert)
+{
+    BOOST_LOG_TRIVIAL(info) << "Metadata received for torrent " << alert.name;
+
+    alert.handle.save_resume_data(
+        lt::torrent_handle::flush_disk_cache
+        | lt::torrent_handle::save_info_dict
+        | lt::torrent_handle::only_if_modified);
+
+    Emit("torrent_metadata_received", m_torrentMetadataReceived, alert.handle);
+}
+
+void Session::HandlePeerInfo(Alert& alert)
+{
+    Resolve(m_peerInfo, alert.handle.info_hashes(), std::move(std::get<Alert::Peers>(alert.data).peers));
+}
+
+void Session::HandlePieceFinished(Alert& alert)
+{
+    Emit("piece_finished", m_pieceFinished, alert.handle, std::get<Alert::PieceFinished>(alert.data).piece);
+    // Drops the piece alerts once the last subscriber is gone.
+    UpdateAlertMask();
+}
+
+void Session::HandleSaveResumeData(Alert& alert)
+{
+    const auto& resume = std::get<Alert::ResumeData>(alert.data);
+    const auto hashes = alert.handle.info_hashes();
+    const auto status = m_statuses.find(hashes);
+    const auto client_data = alert.handle.userdata().get<TorrentClientData>();
+
+    // Parked once its resume data is stored, unless it was resumed while waiting on it.
+    const auto parking = m_parking.find(hashes);
+    const bool park = parking != m_parking.end()
+        && status != m_statuses.end()
+        && (status->second.flags & lt::torrent_flags::paused);
+
+    if (parking != m_parking.end())
+    {
+        m_parking.erase(parking);
+    }
+
+    // The params carry the current name and save path, and the queue position is
+    // as fresh as the last state update.
+    m_writer->Upsert(hashes, AddTorrentParams{
+        .client_data    = client_data,
+        .name           = resume.params.name,
+        .params         = resume.params,
+        .queue_position = status != m_statuses.end() ? static_cast<int>(status->second.queue_position) : -1,
+        .save_path      = resume.params.save_path,
+        .parked         = park
+    });
+
+    if (status != m_statuses.end())
+    {
+        status->second.need_save_resume = false;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Resume data saved for " << alert.name;
+
+    Drained(hashes);
+
+    if (park)
+    {
+        m_parked.insert({ hashes, client_data });
+        m_session->remove_torrent(alert.handle);
+    }
+}
+
+void Session::HandleSaveResumeDataFailed(Alert& alert)
+{
+    // Most often because nothing changed since it was last saved, and either way there is
+    // nothing more to wait on.
+    if (alert.handle.is_valid())
+    {
+        Drained(alert.handle.info_hashes());
+    }
+}
+
+void Session::HandleDhtStats(Alert& alert)
+{
+    auto& node = std::get<Alert::Dht>(alert.data).node;
+    m_dhtNodes[node.endpoint] = std::move(node);
+}
+
+void Session::HandleSessionStats(Alert& alert)
+{
+    auto& stats = std::get<Alert::Stats>(alert.data);
+
+    SessionMetrics metrics(m_statsLayout, std::move(stats.values));
+
+    if (m_lastStats.Size() > 0)
+    {
+        metrics.Since(m_lastStats, std::chrono::duration<double>(stats.when - m_lastStatsAt).count());
+    }
+
+    Emit("session_stats", m_sessionStats, metrics);
+
+    m_lastStats   = std::move(metrics);
+    m_lastStatsAt = stats.when;
+}
+
+void Session::HandleStateUpdate(Alert& alert)
+{
+    const auto& status = std::get<Alert::StateUpdate>(alert.data).status;
+
+    for (auto const& ts : status)
+    {
+        // Torrents can be removed after libtorrent posted the update but before we get
+        // here. Do not resurrect those in the cache.
+        if (!m_torrents.contains(ts.info_hashes))
+        {
+            continue;
+        }
+
+        m_statuses.insert_or_assign(ts.info_hashes, ts);
+    }
+
+    Emit("state_update", m_stateUpdate, status);
+
+    for (auto const& ts : status)
+    {
+        const auto awaiting = m_awaiting.find(ts.info_hashes);
+
+        if (awaiting == m_awaiting.end())
+        {
+            continue;
+        }
+
+        // An update posted before the alert may still show the old state, in which
+        // case the torrent waits for the next one.
+        if (awaiting->second.finished && ts.is_finished)
+        {
+            awaiting->second.finished = false;
+
+            if (ts.total_download > 0)
+            {
+                // Only emit this event if we have downloaded any data this session
+                BOOST_LOG_TRIVIAL(info) << "Torrent " << ts.name << " finished";
+                Emit("torrent_finished", m_torrentFinished, ts);
+                m_lifecycle.finished.push_back(ts);
+            }
+        }
+
+        if (awaiting->second.resumed && !(ts.flags & lt::torrent_flags::paused))
+        {
+            awaiting->second.resumed = false;
+            Emit("torrent_resumed", m_torrentResumed, ts);
+            m_lifecycle.resumed.push_back(ts);
+        }
+
+        if (!awaiting->second.finished && !awaiting->second.resumed)
+        {
+            m_awaiting.erase(awaiting);
+        }
+    }
+}
 
-    bool was_auto_managed = false;
-    bool was_paused = false;
-    int alert_type = lt::torrent_checked_alert::alert_type;
+void Session::HandleStorageMoved(Alert& alert)
+{
+    const auto& path = std::get<Alert::StorageMoved>(alert.data).path;
 
-    if ((handle.flags() & lt::torrent_flags::auto_managed) == lt::torrent_flags::auto_managed)
+    BOOST_LOG_TRIVIAL(info) << "Torrent " << alert.name << " moved to " << path;
+
+    if (auto status = m_statuses.find(alert.handle.info_hashes()); status != m_statuses.end())
     {
-        handle.unset_flags(lt::torrent_flags::auto_managed);
-        was_auto_managed = true;
+        status->second.save_path = path;
     }
 
-    if ((handle.flags() & lt::torrent_flags::paused) == lt::torrent_flags::paused)
+    if (alert.handle.need_save_resume_data())
     {
-        handle.resume();
-        was_paused = true;
+        alert.handle.save_resume_data(lt::torrent_handle::flush_disk_cache
+                                      | lt::torrent_handle::save_info_dict
+                                      | lt::torrent_handle::only_if_modified);
     }
 
-    if (!m_oneshot_torrent_callbacks.contains({ alert_type, hash }))
+    Emit("storage_moved", m_storageMoved, alert.handle);
+}
+
+void Session::HandleStorageMovedFailed(Alert& alert)
+{
+    const auto& failed = std::get<Alert::StorageMoveFailed>(alert.data);
+
+    BOOST_LOG_TRIVIAL(error) << "Failed to move torrent " << alert.name << ": " << failed.error.message()
+                             << (failed.path.empty() ? "" : " (" + failed.path + ")");
+
+    Emit("storage_moved_failed", m_storageMovedFailed, alert.handle);
+}
+
+void Session::HandleTorrentChecked(Alert& alert)
+{
+    BOOST_LOG_TRIVIAL(info) << "Torrent " << alert.name << " finished checking";
+
+    const auto key = std::make_pair(alert.type, alert.handle.info_hashes());
+
+    if (m_oneshot_torrent_callbacks.contains(key))
     {
-        m_oneshot_torrent_callbacks.insert({{ alert_type, hash }, {}});
+        for (auto && cb : m_oneshot_torrent_callbacks.at(key))
+        {
+            cb();
+        }
+
+        m_oneshot_torrent_callbacks.erase(key);
     }
 
-    m_oneshot_torrent_callbacks.at({ alert_type, hash }).emplace_back(
-        [&, hash, was_auto_managed, was_paused]()
+    Emit("torrent_checked", m_torrentChecked, alert.handle);
+}
+
+void Session::HandleTorrentFinished(Alert& alert)
+{
+    // The signal needs the finished status, which comes with the state update
+    // requested after the batch instead of blocking on it here.
+    if (m_torrents.contains(alert.handle.info_hashes()))
+    {
+        m_awaiting[alert.handle.info_hashes()].finished = true;
+        m_requestUpdates = true;
+    }
+
+    alert.handle.save_resume_data(lt::torrent_handle::flush_disk_cache
+                                  | lt::torrent_handle::save_info_dict
+                                  | lt::torrent_handle::only_if_modified);
+}
+
+void Session::HandleTorrentPaused(Alert& alert)
+{
+    if (auto status = m_statuses.find(alert.handle.info_hashes()); status != m_statuses.end())
+    {
+        status->second.flags |= lt::torrent_flags::paused;
+    }
+
+    Emit("torrent_paused", m_torrentPaused, alert.handle);
+    m_lifecycle.paused.push_back(alert.handle.info_hashes());
+}
+
+void Session::HandleTorrentRemoved(Alert& alert)
+{
+    const auto& hashes = std::get<Alert::Removed>(alert.data).info_hashes;
+    const bool parked  = m_parked.contains(hashes);
+
+    if (!parked)
+    {
+        m_writer->Remove(hashes);
+    }
+
+    m_awaiting.erase(hashes);
+    m_pausedSince.erase(hashes);
+    Drained(hashes);
+
+    const auto abandon = [&hashes](auto& cache)
+    {
+        if (auto entry = cache.find(hashes); entry != cache.end())
         {
-            if (!m_torrents.contains(hash))
-            {
-                return;
-            }
+            auto waiting = std::move(entry->second.waiting);
+            cache.erase(entry);
 
-            // TODO: Unsure about the order here. If there are reports that force-checking a torrent
-            //       leads to any issues with resume/pause, the order of these statements might matter.
+            for (auto& done : waiting) done(nullptr);
+        }
+    };
 
-            if (was_auto_managed)
-            {
-                m_torrents.at(hash).set_flags(lt::torrent_flags::auto_managed);
-            }
+    abandon(m_fileProgress);
+    abandon(m_peerInfo);
 
-            if (was_paused)
-            {
-                m_torrents.at(hash).pause();
-            }
+    m_torrents.erase(hashes);
+
+    // Still listed, from the status it had when it was parked.
+    if (parked)
+    {
+        if (auto status = m_statuses.find(hashes); status != m_statuses.end())
+        {
+            status->second.handle = {};
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Torrent " << alert.name << " parked";
+        return;
+    }
+
+    m_statuses.erase(hashes);
+    Emit("torrent_removed", m_torrentRemoved, hashes);
+    m_lifecycle.removed.push_back(hashes);
+
+    BOOST_LOG_TRIVIAL(info) << "Torrent " << alert.name << " removed";
+}
+
+void Session::HandleTorrentResumed(Alert& alert)
+{
+    BOOST_LOG_TRIVIAL(debug) << "Torrent " << alert.name << " resumed";
+
+    if (auto status = m_statuses.find(alert.handle.info_hashes()); status != m_statuses.end())
+    {
+        status->second.flags &= ~lt::torrent_flags::paused;
+
+        m_awaiting[alert.handle.info_hashes()].resumed = true;
+        m_requestUpdates = true;
+    }
+}
+
+void Session::HandleTrackerAnnounce(Alert& alert)
+{
+    Emit("tracker_announce", m_trackerAnnounce, std::get<TrackerAnnounce>(alert.data));
+    UpdateAlertMask();
+}
+
+void Session::HandleTrackerError(Alert& alert)
+{
+    const auto& error = std::get<TrackerError>(alert.data);
+
+    Emit("torrent_tracker_error", m_torrentTrackerError, error);
+
+    if (!m_trackerAnnounce.empty())
+    {
+        Emit("tracker_announce", m_trackerAnnounce, TrackerAnnounce{
+            .kind    = TrackerAnnounce::Failed,
+            .handle  = error.handle,
+            .url     = error.url,
+            .error   = error.error,
+            .message = error.message
         });
+    }
 
-    handle.force_recheck();
+    UpdateAlertMask();
 }
 
-void Session::Remove(const lt::info_hash_t& hash, bool remove_data)
+void Session::HandleTrackerReply(Alert& alert)
 {
-    lt::torrent_handle th = m_torrents.at(hash);
+    Emit("torrent_tracker_reply", m_torrentTrackerReply, alert.handle);
+    Emit("tracker_announce", m_trackerAnnounce, std::get<TrackerAnnounce>(alert.data));
+    UpdateAlertMask();
+}
 
-    m_session->remove_torrent(th, remove_data ? lt::session::delete_files : lt::remove_flags_t{});
+lt::alert_category_t Session::AlertMask() const
+{
+    // What the handlers need. State updates, session stats, resume data, peers and file
+    // progress are posted when asked for, whatever the mask.
+    lt::alert_category_t mask = lt::alert_category::status | lt::alert_category::storage;
+
+    // Tracker alerts are many and only used by workflows and the tracker registry.
+    if (!m_torrentTrackerError.empty() || !m_torrentTrackerReply.empty() || !m_trackerAnnounce.empty())
+    {
+        mask |= lt::alert_category::tracker;
+    }
+
+    if (!m_pieceFinished.empty())
+    {
+        mask |= lt::alert_category::piece_progress;
+    }
+
+    return mask | lt::alert_category_t(m_debugAlerts.load());
 }
 
-void Session::Resume()
+void Session::SetDebugAlerts(lt::alert_category_t categories)
 {
-    m_session->resume();
+    BOOST_LOG_TRIVIAL(info) << "Logging alert categories " << static_cast<std::uint32_t>(categories);
+
+    m_debugAlerts = static_cast<std::uint32_t>(categories);
+    UpdateAlertMask();
 }
 
-lt::settings_pack Session::Settings()
+void Session::UpdateAlertMask()
 {
-    return m_session->get_settings();
+    const auto mask = AlertMask();
+
+    if (mask == m_alertMask || m_session == nullptr)
+    {
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Setting alert mask to " << static_cast<std::uint32_t>(mask);
+
+    m_alertMask = mask;
+
+    lt::settings_pack settings;
+    settings.set_int(lt::settings_pack::alert_mask, static_cast<int>(static_cast<std::uint32_t>(mask)));
+    porla::Utils::SettingsPack::Merge(m_settings, settings);
+    m_session->apply_settings(std::move(settings));
 }
 
-const std::map<lt::info_hash_t, lt::torrent_handle>& Session::Torrents()
+void Session::FinishAdding(AddingMap::iterator adding, const lt::info_hash_t& hash, std::string error)
 {
-    return m_torrents;
+    auto pending = std::move(adding->second.batch);
+    auto& result = pending->results[adding->second.index];
+
+    m_adding.erase(adding);
+
+    if (error.empty())
+    {
+        result.info_hash = hash;
+    }
+    else
+    {
+        result.error = std::move(error);
+    }
+
+    if (--pending->remaining == 0)
+    {
+        pending->done(std::move(pending->results));
+    }
 }
 
-void Session::ReadAlerts()
+void Session::GrowAlertQueue()
 {
-    std::vector<lt::alert*> alerts;
-    m_session->pop_alerts(&alerts);
+    const int current = m_settings.get_int(lt::settings_pack::alert_queue_size);
 
-    for (auto const alert : alerts)
+    if (current >= m_alertQueueMax)
     {
-        BOOST_LOG_TRIVIAL(trace) << "Session alert: " << alert->message();
+        BOOST_LOG_TRIVIAL(warning) << "Alert queue is at its maximum size of " << current;
+        return;
+    }
 
-        switch (alert->type())
-        {
-        case lt::dht_stats_alert::alert_type:
-        {
-            auto dsa = lt::alert_cast<lt::dht_stats_alert>(alert);
-            // TODO: emit signal
-            break;
-        }
-        case lt::metadata_received_alert::alert_type:
-        {
-            auto mra = lt::alert_cast<lt::metadata_received_alert>(alert);
+    const int size = std::min(m_alertQueueMax, current * 2);
 
-            BOOST_LOG_TRIVIAL(info) << "Metadata received for torrent " << mra->handle.status().name;
+    lt::settings_pack settings;
+    settings.set_int(lt::settings_pack::alert_queue_size, size);
+    porla::Utils::SettingsPack::Merge(m_settings, settings);
+    m_session->apply_settings(std::move(settings));
 
-            mra->handle.save_resume_data(
-                lt::torrent_handle::flush_disk_cache
-                | lt::torrent_handle::save_info_dict
-                | lt::torrent_handle::only_if_modified);
+    m_instrumentation.alert_queue_size = size;
 
-            break;
-        }
-        case lt::save_resume_data_alert::alert_type:
-        {
-            auto srda = lt::alert_cast<lt::save_resume_data_alert>(alert);
-            auto const& status = srda->handle.status();
+    BOOST_LOG_TRIVIAL(warning) << "Raised alert queue size from " << current << " to " << size;
+}
 
-            AddTorrentParams::Update(m_db, status.info_hashes, AddTorrentParams{
-                .client_data    = srda->handle.userdata().get<TorrentClientData>(),
-                .name           = status.name,
-                .params         = srda->params,
-                .queue_position = static_cast<int>(status.queue_position),
-                .save_path      = status.save_path
-            });
+void Session::ResaveResumeData()
+{
+    m_instrumentation.alert_resyncs++;
 
-            BOOST_LOG_TRIVIAL(info) << "Resume data saved for " << status.name;
+    const bool scheduled = !m_resave.empty();
 
-            break;
-        }
-        case lt::session_stats_alert::alert_type:
-        {
-            auto ssa = lt::alert_cast<lt::session_stats_alert>(alert);
-            auto const& counters = ssa->counters();
+    m_resave.clear();
+
+    for (const auto& [hashes, handle] : m_torrents)
+    {
+        if (Owns(hashes)) m_resave.emplace_back(handle, lt::torrent_handle::flush_disk_cache | lt::torrent_handle::save_info_dict);
+    }
 
-            std::map<std::string, int64_t> metrics;
+    BOOST_LOG_TRIVIAL(warning) << "Resume data alerts were dropped, saving " << m_resave.size() << " torrent(s) again";
 
-            for (auto const& stats : m_stats)
-            {
-                metrics.insert({ stats.name, counters[stats.value_index] });
-            }
+    if (scheduled)
+    {
+        return;
+    }
 
-            m_sessionStats(metrics);
+    ResaveTick();
+}
 
-            break;
-        }
-        case lt::state_update_alert::alert_type:
+void Session::ResaveTick()
+{
+    const auto count = std::min(ResaveBatchSize, m_resave.size());
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        m_resave.back().first.save_resume_data(m_resave.back().second);
+        m_resave.pop_back();
+    }
+
+    if (m_resave.empty())
+    {
+        return;
+    }
+
+    m_resaveTimer.expires_after(std::chrono::seconds(1));
+    m_resaveTimer.async_wait(
+        [this](const boost::system::error_code& ec)
         {
-            auto sua = lt::alert_cast<lt::state_update_alert>(alert);
+            if (ec) { return; }
+            ResaveTick();
+        });
+}
 
-            m_stateUpdate(sua->status);
+void Session::SyncTorrents()
+{
+    m_instrumentation.alert_resyncs++;
 
-            break;
-        }
-        case lt::storage_moved_alert::alert_type:
+    std::map<lt::info_hash_t, lt::torrent_handle> current;
+
+    for (auto& handle : m_session->get_torrents())
+    {
+        current.insert({ handle.info_hashes(), handle });
+    }
+
+    std::size_t removed = 0;
+
+    for (auto it = m_torrents.begin(); it != m_torrents.end();)
+    {
+        if (current.contains(it->first) || !Owns(it->first))
         {
-            auto const sma = lt::alert_cast<lt::storage_moved_alert>(alert);
+            ++it;
+            continue;
+        }
 
-            BOOST_LOG_TRIVIAL(info) << "Torrent " << sma->torrent_name() << " moved to " << sma->storage_path();
+        const auto hashes = it->first;
+        it = m_torrents.erase(it);
 
-            if (sma->handle.need_save_resume_data())
+        if (m_parked.contains(hashes))
+        {
+            if (auto status = m_statuses.find(hashes); status != m_statuses.end())
             {
-                sma->handle.save_resume_data(lt::torrent_handle::flush_disk_cache
-                                             | lt::torrent_handle::save_info_dict
-                                             | lt::torrent_handle::only_if_modified);
+                status->second.handle = {};
             }
 
-            m_storageMoved(sma->handle);
-
-            break;
+            continue;
         }
-        case lt::torrent_checked_alert::alert_type:
-        {
-            const auto tca = lt::alert_cast<lt::torrent_checked_alert>(alert);
-            BOOST_LOG_TRIVIAL(info) << "Torrent " << tca->torrent_name() << " finished checking";
 
-            if (m_oneshot_torrent_callbacks.contains({ alert->type(), tca->handle.info_hashes()}))
-            {
-                for (auto && cb : m_oneshot_torrent_callbacks.at({ alert->type(), tca->handle.info_hashes() }))
-                {
-                    cb();
-                }
+        m_writer->Remove(hashes);
+        m_awaiting.erase(hashes);
+        m_statuses.erase(hashes);
+        Emit("torrent_removed", m_torrentRemoved, hashes);
+        m_lifecycle.removed.push_back(hashes);
 
-                m_oneshot_torrent_callbacks.erase({ alert->type(), tca->handle.info_hashes() });
-            }
+        removed++;
+    }
 
-            break;
+    // A copy, since the predicate runs on the network thread.
+    std::set<lt::info_hash_t> known;
+
+    for (const auto& [hashes, handle] : m_torrents)
+    {
+        known.insert(hashes);
+    }
+
+    const auto added = m_session->get_torrent_status(
+        [known = std::move(known)](const lt::torrent_status& ts) { return !known.contains(ts.info_hashes); });
+
+    for (const auto& ts : added)
+    {
+        m_torrents.insert({ ts.info_hashes, ts.handle });
+        m_statuses.insert_or_assign(ts.info_hashes, ts);
+
+        // Loaded torrents are already stored.
+        if (m_load && m_load->adding.erase(ts.handle.userdata().get<TorrentClientData>()) > 0)
+        {
+            m_load->pending--;
+            m_load->loaded.push_back(ts);
+            m_loadProgress.loaded++;
+            PostLoadStep(*m_load);
+            continue;
         }
-        case lt::torrent_finished_alert::alert_type:
+
+        // Stored when the resume data comes back.
+        ts.handle.save_resume_data(lt::torrent_handle::flush_disk_cache | lt::torrent_handle::save_info_dict);
+
+        Emit("torrent_added", m_torrentAdded, ts);
+
+        const auto adding = std::find_if(
+            m_adding.begin(),
+            m_adding.end(),
+            [&ts](const auto& item) { return item.second.info_hashes == ts.info_hashes; });
+
+        if (adding != m_adding.end())
         {
-            const auto tfa          = lt::alert_cast<lt::torrent_finished_alert>(alert);
-            const auto& status      = tfa->handle.status();
-            const auto& client_data = tfa->handle.userdata().get<TorrentClientData>();
+            FinishAdding(adding, ts.info_hashes, "");
+        }
+    }
 
-            if (status.total_download > 0)
-            {
-                // Only emit this event if we have downloaded any data this session
-                BOOST_LOG_TRIVIAL(info) << "Torrent " << status.name << " finished";
-                m_torrentFinished(status);
-            }
+    FlushLifecycle();
 
-            if (status.need_save_resume)
+    BOOST_LOG_TRIVIAL(warning) << "Reconciled torrents with the session, "
+                               << added.size() << " added and " << removed << " removed";
+}
+
+void Session::Checkpoint()
+{
+    // Still working through the last checkpoint, or a resave after dropped alerts.
+    if (m_resave.empty())
+    {
+        for (const auto& [hashes, ts] : m_statuses)
+        {
+            if (ts.has_metadata && ts.need_save_resume && Owns(hashes))
             {
-                status.handle.save_resume_data(lt::torrent_handle::flush_disk_cache
-                                               | lt::torrent_handle::save_info_dict
-                                               | lt::torrent_handle::only_if_modified);
+                // Without flushing the disk cache, so a checkpoint does not sync every
+                // file the torrents have written to.
+                m_resave.emplace_back(ts.handle, lt::torrent_handle::save_info_dict | lt::torrent_handle::only_if_modified);
             }
-
-            break;
         }
-        case lt::torrent_paused_alert::alert_type:
+
+        if (!m_resave.empty())
         {
-            auto tpa = lt::alert_cast<lt::torrent_paused_alert>(alert);
-            m_torrentPaused(tpa->handle);
-            break;
+            BOOST_LOG_TRIVIAL(debug) << "Checkpointing resume data for " << m_resave.size() << " torrent(s)";
+            ResaveTick();
         }
-        case lt::torrent_removed_alert::alert_type:
-        {
-            auto tra = lt::alert_cast<lt::torrent_removed_alert>(alert);
+    }
 
-            AddTorrentParams::Remove(m_db, tra->info_hashes);
+    m_checkpointTimer.expires_after(m_checkpointInterval);
+    m_checkpointTimer.async_wait([this](const boost::system::error_code& ec) { if (!ec) Checkpoint(); });
+}
 
-            m_torrents.erase(tra->info_hashes);
-            m_torrentRemoved(tra->info_hashes);
+void Session::SaveDhtState()
+{
+    // Asks the network thread for its state, which is small, and then writes it here.
+    if (WriteSessionParams(m_session_params_file, m_session->session_state(lt::session::save_dht_state)))
+    {
+        m_dhtStateSaved = std::time(nullptr);
+    }
 
-            BOOST_LOG_TRIVIAL(info) << "Torrent " << tra->torrent_name() << " removed";
+    m_dhtStateTimer.expires_after(m_dhtStateInterval);
+    m_dhtStateTimer.async_wait([this](const boost::system::error_code& ec) { if (!ec) SaveDhtState(); });
+}
 
-            break;
-        }
-        case lt::torrent_resumed_alert::alert_type:
-        {
-            auto tra = lt::alert_cast<lt::torrent_resumed_alert>(alert);
-            auto const& status = tra->handle.status();
+void Session::ParkIdle()
+{
+    const auto now = std::chrono::steady_clock::now();
 
-            BOOST_LOG_TRIVIAL(debug) << "Torrent " << status.name << " resumed";
+    // Tried again if the resume data never came back, such as when saving it failed.
+    std::erase_if(m_parking, [&now](const auto& item) { return now - item.second > ParkInterval; });
 
-            m_torrentResumed(status);
+    std::map<lt::info_hash_t, std::chrono::steady_clock::time_point> paused_since;
+    std::size_t parking = 0;
 
-            break;
-        }
-        case lt::tracker_error_alert::alert_type:
+    for (const auto& [hashes, ts] : m_statuses)
+    {
+        if (!(ts.flags & lt::torrent_flags::paused)
+            || !ts.has_metadata
+            || ts.moving_storage
+            || ts.state == lt::torrent_status::checking_files
+            || ts.state == lt::torrent_status::checking_resume_data
+            || !m_torrents.contains(hashes)
+            || !Owns(hashes))
         {
-            const auto tea = lt::alert_cast<lt::tracker_error_alert>(alert);
-            m_torrentTrackerError(tea);
-            break;
+            continue;
         }
-        case lt::tracker_reply_alert::alert_type:
+
+        // Also timed from when it was first seen paused, so one paused by a user a
+        // moment ago is not parked on its old transfer times.
+        const auto since = m_pausedSince.find(hashes);
+        const auto first = since != m_pausedSince.end() ? since->second : now;
+
+        paused_since.insert({ hashes, first });
+
+        if (now - first < m_parkAfter
+            || IdleFor(ts) < m_parkAfter
+            || m_parking.contains(hashes)
+            || parking >= ResaveBatchSize)
         {
-            const auto tra = lt::alert_cast<lt::tracker_reply_alert>(alert);
-            m_torrentTrackerReply(tra->handle);
-            break;
-        }
+            continue;
         }
+
+        m_parking.insert({ hashes, now });
+        ts.handle.save_resume_data(lt::torrent_handle::flush_disk_cache | lt::torrent_handle::save_info_dict);
+        parking++;
+    }
+
+    m_pausedSince.swap(paused_since);
+
+    if (parking > 0)
+    {
+        BOOST_LOG_TRIVIAL(info) << "Parking " << parking << " idle torrent(s)";
     }
+
+    m_parkTimer.expires_after(ParkInterval);
+    m_parkTimer.async_wait([this](const boost::system::error_code& ec) { if (!ec) ParkIdle(); });
 }
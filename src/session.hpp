@@ -1,29 +1,184 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <variant>
 #include <vector>
 
 #include <boost/asio.hpp>
-#include <boost/signals2.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <libtorrent/alert_types.hpp>
+#include <libtorrent/peer_class.hpp>
+#include <libtorrent/peer_info.hpp>
 #include <libtorrent/session.hpp>
 #include <sqlite3.h>
 
+#include "data/models/addtorrentparams.hpp"
+#include "data/pragmas.hpp"
+#include "peerclass.hpp"
+#include "sessionmetrics.hpp"
+#include "torrentregistry.hpp"
+#include "utils/histogram.hpp"
+#include "utils/signal.hpp"
+
 typedef std::function<std::shared_ptr<libtorrent::torrent_plugin>(libtorrent:: torrent_handle const&, libtorrent::client_data_t)> lt_plugin;
 
+namespace porla::Data
+{
+    class WriteBehindQueue;
+}
+
 namespace porla
 {
+    struct TorrentClientData;
+
+    typedef TorrentRegistry<libtorrent::torrent_handle> TorrentHandles;
+
     struct SessionOptions
     {
-        sqlite3*                              db                    = nullptr;
+        // The alert queue size is doubled when alerts are dropped, up to this.
+        int                                   alert_queue_max            = 100000;
+        // Pops and decodes alerts on a thread of their own instead of the io thread.
+        bool                                  alert_thread               = false;
+        sqlite3*                              db                         = nullptr;
+        Data::Pragmas                         db_pragmas;
+        // Null keeps libtorrent's default backend.
+        lt::disk_io_constructor_type          disk_io;
         std::optional<std::vector<lt_plugin>> extensions;
-        lt::settings_pack                     settings              = lt::default_settings();
-        std::filesystem::path                 session_params_file   = std::filesystem::path();
-        int                                   timer_dht_stats       = 5000;
-        int                                   timer_session_stats   = 5000;
-        int                                   timer_torrent_updates = 1000;
+        // Paused torrents without any transfers for this long are parked, taken out of
+        // libtorrent while kept in storage. Zero keeps all of them in libtorrent.
+        std::chrono::seconds                  park_after                 = std::chrono::seconds(0);
+        std::vector<PeerClass>                peer_classes;
+        // Added whatever the extensions are, for plugins porla itself reads from.
+        std::vector<lt_plugin>                plugins;
+        int                                   persistence_batch_size     = 500;
+        bool                                  persistence_compress       = true;
+        int                                   persistence_flush_interval = 1000;
+        lt::settings_pack                     settings                   = lt::default_settings();
+        std::filesystem::path                 session_params_file        = std::filesystem::path();
+        // Torrents are loaded from this snapshot where it is current, and from the database
+        // otherwise. Empty loads them all from the database.
+        std::filesystem::path                 state_snapshot_file        = std::filesystem::path();
+
+        // Set when the session is one of several shards in the process. The shards share
+        // the torrent registry, the statuses and the database writer, each loads the
+        // stored torrents it is given, and each only checkpoints, parks and reconciles
+        // the torrents it owns.
+        struct Shard
+        {
+            TorrentHandles*                                                  torrents;
+            std::map<lt::info_hash_t, lt::torrent_status>*                   statuses;
+            std::shared_ptr<Data::WriteBehindQueue>                          writer;
+            // Called on the thread reading the stored torrents.
+            std::function<bool(const Data::Models::AddTorrentParams::Row&)> loads;
+            std::function<bool(const lt::info_hash_t&)>                      owns;
+        };
+
+        std::optional<Shard>                  shard;
+        // How often the DHT state is written to session_params_file, besides at shutdown,
+        // so a restart after a crash does not bootstrap the DHT from scratch. Zero only
+        // writes it at shutdown.
+        int                                   timer_dht_state            = 600000;
+        int                                   timer_dht_stats            = 5000;
+        int                                   timer_dht_stats_idle       = 60000;
+        // How often torrents with unsaved changes get their resume data saved. Zero only
+        // saves it on events and at shutdown.
+        int                                   timer_resume_data          = 300000;
+        int                                   timer_session_stats        = 5000;
+        int                                   timer_session_stats_idle   = 30000;
+        int                                   timer_torrent_updates      = 1000;
+        int                                   timer_torrent_updates_idle = 5000;
+    };
+
+    // Timings for the alert loop and persistence, exported on /metrics.
+    struct SessionInstrumentation
+    {
+        struct Timing
+        {
+            std::uint64_t count   = 0;
+            double        seconds = 0;
+        };
+
+        Utils::Histogram alert_batch_size{{1, 10, 50, 100, 500, 1000, 5000}};
+        // Batches decoded on the alert thread and not yet handled on the io thread.
+        std::uint64_t    alert_queue_depth = 0;
+        std::int64_t     alert_queue_size  = 0;
+        // Times the torrents or resume data were reconciled after alerts were dropped.
+        std::uint64_t    alert_resyncs     = 0;
+        // Time from libtorrent notifying us of new alerts until they are handled on the io
+        // thread. With the alert thread, it is measured from when they were popped.
+        Utils::Histogram loop_lag{{0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1}};
+        // Per torrent, while loading the stored torrents. Adding is timed from
+        // async_add_torrent until its add_torrent_alert is handled.
+        Utils::Histogram load_add{{0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10}};
+        Utils::Histogram load_decode{{0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05}};
+        // Copied from the write behind queue, which owns the buckets.
+        Utils::Histogram persist_duration{{}};
+        Utils::Histogram persist_size{{}};
+
+        std::map<std::string, Timing> alerts;
+        std::map<std::string, std::uint64_t> alerts_dropped;
+        std::map<std::string, Timing> signals;
+    };
+
+    // The routing table and lookups in flight of each DHT node, one per listen socket, as
+    // of the last dht_stats_alert.
+    struct DhtStats
+    {
+        struct Bucket
+        {
+            int nodes;
+            int replacements;
+            // Seconds since a node in the bucket was last heard from.
+            int last_active;
+        };
+
+        struct Lookup
+        {
+            std::string type;
+            int         outstanding_requests;
+            int         timeouts;
+            int         responses;
+            int         branch_factor;
+            int         nodes_left;
+        };
+
+        struct Node
+        {
+            std::string         endpoint;
+            std::vector<Bucket> buckets;
+            std::vector<Lookup> lookups;
+        };
+
+        std::vector<Node> nodes;
+        // When the DHT state was last written, in seconds since the epoch, or zero.
+        std::int64_t      state_saved = 0;
+    };
+
+    // The lifecycle events of one batch of alerts, each kind in the order they were
+    // emitted one by one.
+    struct TorrentLifecycle
+    {
+        std::vector<libtorrent::torrent_status> finished;
+        std::vector<libtorrent::info_hash_t>    paused;
+        std::vector<libtorrent::info_hash_t>    removed;
+        std::vector<libtorrent::torrent_status> resumed;
+
+        [[nodiscard]] bool Empty() const
+        {
+            return finished.empty() && paused.empty() && removed.empty() && resumed.empty();
+        }
     };
 
     class ISession
@@ -31,34 +186,289 @@ namespace porla
     public:
         virtual ~ISession() = default;
 
-        typedef boost::signals2::signal<void(const libtorrent::info_hash_t&)> InfoHashSignal;
-        typedef boost::signals2::signal<void(const std::map<std::string, int64_t>&)> SessionStatsSignal;
-        typedef boost::signals2::signal<void(const libtorrent::torrent_handle&)> TorrentHandleSignal;
-        typedef boost::signals2::signal<void(const libtorrent::torrent_status&)> TorrentStatusSignal;
-        typedef boost::signals2::signal<void(const std::vector<libtorrent::torrent_status>&)> TorrentStatusListSignal;
-        typedef boost::signals2::signal<void(const lt::tracker_error_alert*)> TrackerErrorSignal;
-
-        virtual boost::signals2::connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) = 0;
-        virtual boost::signals2::connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) = 0;
+        typedef porla::Utils::Signal<void(const libtorrent::info_hash_t&)> InfoHashSignal;
+        typedef porla::Utils::Signal<void(const std::vector<libtorrent::info_hash_t>&)> InfoHashListSignal;
+        typedef porla::Utils::Signal<void(const libtorrent::torrent_handle&, libtorrent::piece_index_t)> PieceSignal;
+        typedef porla::Utils::Signal<void(const SessionMetrics&)> SessionStatsSignal;
+        typedef porla::Utils::Signal<void(const libtorrent::torrent_handle&)> TorrentHandleSignal;
+        typedef porla::Utils::Signal<void(const libtorrent::torrent_status&)> TorrentStatusSignal;
+        typedef porla::Utils::Signal<void(const std::vector<libtorrent::torrent_status>&)> TorrentStatusListSignal;
+        // Copied out of the tracker_error_alert, which is gone once the next alerts are popped.
+        struct TrackerError
+        {
+            libtorrent::torrent_handle handle;
+            libtorrent::error_code     error;
+            std::string                message;
+            std::string                name;
+            std::string                url;
+        };
+
+        typedef porla::Utils::Signal<void(const TrackerError&)> TrackerErrorSignal;
+
+        // An announce to one tracker of a torrent, as it is sent and as it is answered or
+        // fails. Replies have the number of peers, and failures the error.
+        struct TrackerAnnounce
+        {
+            enum Kind
+            {
+                Sent,
+                Replied,
+                Failed
+            };
+
+            Kind                       kind;
+            libtorrent::torrent_handle handle;
+            std::string                url;
+            int                        num_peers = 0;
+            libtorrent::error_code     error;
+            std::string                message;
+        };
+
+        typedef porla::Utils::Signal<void(const TrackerAnnounce&)> TrackerAnnounceSignal;
+
+        typedef porla::Utils::Signal<void(const TorrentLifecycle&)> TorrentLifecycleSignal;
+
+        enum class Stats
+        {
+            Dht,
+            Session,
+            Torrents
+        };
+
+        // Keeps the given stats posted at their active interval for as long as the returned
+        // token is held. With no demand they fall back to the slower idle interval.
+        typedef std::shared_ptr<void> DemandToken;
+        virtual DemandToken Demand(Stats stats) { return nullptr; }
+
+        // Intervals of the stats and resume data timers, in milliseconds, for changing them
+        // while running. Timers which were off at startup stay off.
+        struct Timers
+        {
+            int dht_stats;
+            int dht_stats_idle;
+            int resume_data;
+            int session_stats;
+            int session_stats_idle;
+            int torrent_updates;
+            int torrent_updates_idle;
+        };
+
+        virtual void SetTimers(const Timers& timers) {}
+
+        // A snapshot of the session instrumentation, if the implementation keeps any.
+        virtual std::optional<SessionInstrumentation> Instrumentation() const { return std::nullopt; }
+
+        // DHT nodes are only reported while the stats timer runs, and not at all without a DHT.
+        virtual std::optional<DhtStats> Dht() const { return std::nullopt; }
+
+        // How far loading the stored torrents has come. They are loaded in the background
+        // at startup, and until that is done the session only holds the ones loaded so far.
+        struct LoadProgress
+        {
+            bool done   = true;
+            int  failed = 0;
+            int  loaded = 0;
+            int  total  = 0;
+        };
+
+        virtual LoadProgress Loading() const { return {}; }
+
+        // How far draining has come. A draining session adds no torrents, and saves the
+        // resume data of every torrent which needs it, so shutting down has little left
+        // to save.
+        struct DrainProgress
+        {
+            bool        draining = false;
+            // Torrents whose resume data is still being saved.
+            int         saving   = 0;
+            // Writes not yet committed to the database.
+            std::size_t writes   = 0;
+            // Nothing is left to save or write. Torrents which still transfer may need
+            // saving again by the time the session shuts down, unless it was paused.
+            bool        drained  = false;
+        };
+
+        // Starts draining, pausing the session first if asked. Draining again saves what
+        // changed since. Lasts until shutdown.
+        virtual void Drain(bool pause) {}
+        virtual DrainProgress Draining() const { return {}; }
+
+        // Alert categories logged on top of the ones the session needs, for debugging. They
+        // are only asked of libtorrent while set.
+        virtual libtorrent::alert_category_t DebugAlerts() const { return {}; }
+        virtual void SetDebugAlerts(libtorrent::alert_category_t categories) {}
+
+        // Peer classes by name, which the torrents of their categories belong to. Setting
+        // one which exists replaces it, and moves torrents between classes as its categories
+        // change.
+        virtual std::vector<PeerClass> PeerClasses() const { return {}; }
+        virtual void SetPeerClass(const PeerClass& peer_class) {}
+        virtual bool RemovePeerClass(const std::string& name) { return false; }
+        // Puts one torrent in a peer class, or takes it out, on top of the classes of its
+        // category. Returns false if there is no such torrent or class.
+        virtual bool JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join) { return false; }
+
+        // Parked torrents are not in Torrents(), only their last status in TorrentStatuses().
+        // Parked gives the client data of one, and Unpark adds it to libtorrent again,
+        // resuming it if asked to, or returns nullopt if it is not parked.
+        virtual std::optional<const TorrentClientData*> Parked(const lt::info_hash_t& hash) const { return std::nullopt; }
+        virtual std::optional<libtorrent::torrent_handle> Unpark(const lt::info_hash_t& hash, bool resume) { return std::nullopt; }
+
+        // The client data of the torrent, kept by its handle or, when parked, by the session.
+        const TorrentClientData* ClientData(const libtorrent::torrent_status& ts) const;
+
+        typedef std::shared_ptr<const std::vector<libtorrent::peer_info>> PeerInfoList;
+        typedef std::function<void(PeerInfoList)> PeerInfoCallback;
+
+        // Calls done with the peers of the torrent, or nullptr when there is no such torrent.
+        // The session may answer from peers it fetched a moment ago.
+        virtual void PeerInfo(const libtorrent::info_hash_t& hash, PeerInfoCallback done)
+        {
+            auto const& torrents = Torrents();
+            auto const& torrent = torrents.find(hash);
+
+            if (torrent == torrents.end())
+            {
+                return done(nullptr);
+            }
+
+            auto peers = std::make_shared<std::vector<libtorrent::peer_info>>();
+            torrent->second.get_peer_info(*peers);
+
+            done(std::move(peers));
+        }
+
+        typedef std::shared_ptr<const std::vector<std::int64_t>> FileProgressList;
+        typedef std::function<void(FileProgressList)> FileProgressCallback;
+
+        // Same as PeerInfo, with the bytes downloaded of each file in whole pieces.
+        virtual void FileProgress(const libtorrent::info_hash_t& hash, FileProgressCallback done)
+        {
+            auto const& torrents = Torrents();
+            auto const& torrent = torrents.find(hash);
+
+            if (torrent == torrents.end())
+            {
+                return done(nullptr);
+            }
+
+            auto progress = std::make_shared<std::vector<std::int64_t>>();
+            torrent->second.file_progress(*progress, libtorrent::torrent_handle::piece_granularity);
+
+            done(std::move(progress));
+        }
+
+        // Announces the torrent to its trackers now, or as soon as the min interval they
+        // asked for allows it unless that is ignored. Does nothing if there is no such torrent.
+        virtual void Reannounce(const libtorrent::info_hash_t& hash, bool ignore_min_interval)
+        {
+            auto const& torrents = Torrents();
+            auto const& torrent = torrents.find(hash);
+
+            if (torrent == torrents.end())
+            {
+                return;
+            }
+
+            torrent->second.force_reannounce(
+                0,
+                -1,
+                ignore_min_interval ? libtorrent::torrent_handle::ignore_min_interval : libtorrent::reannounce_flags_t{});
+        }
+
+        // Pieces which passed the hash check. Piece alerts are many, so they are only asked
+        // for while this has subscribers.
+        virtual porla::Utils::Connection OnPieceFinished(const PieceSignal::slot_type& subscriber) { return {}; }
+        virtual porla::Utils::Connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentChecked(const TorrentHandleSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) = 0;
+        // Torrents added from a magnet link, once their metadata arrives.
+        virtual porla::Utils::Connection OnTorrentMetadataReceived(const TorrentHandleSignal::slot_type& subscriber) { return {}; }
+        virtual porla::Utils::Connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) = 0;
+        virtual porla::Utils::Connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) = 0;
+
+        // Torrents loaded from storage at startup, in batches. They are not announced with
+        // OnTorrentAdded, since they were added in an earlier run.
+        virtual porla::Utils::Connection OnTorrentsLoaded(const TorrentStatusListSignal::slot_type& subscriber) { return {}; }
+
+        // Torrents whose category or tags were edited, once per edit however many changed.
+        virtual porla::Utils::Connection OnClientDataChanged(const InfoHashListSignal::slot_type& subscriber) { return {}; }
+
+        // The finished, paused, removed and resumed torrents of a batch of alerts, once
+        // after the batch, for subscribers which would rather handle many torrents at once
+        // than one signal each. The per-torrent signals are emitted as before. Sessions
+        // which do not batch them never emit it, and say so with BatchesLifecycle.
+        virtual porla::Utils::Connection OnTorrentLifecycle(const TorrentLifecycleSignal::slot_type& subscriber) { return {}; }
+        [[nodiscard]] virtual bool BatchesLifecycle() const { return false; }
+
+        // Edits the client data of the torrents, parked ones too. edit returns whether it
+        // changed anything. What changed is persisted in one transaction, without saving
+        // resume data, and announced once with OnClientDataChanged. Returns the torrents
+        // which changed.
+        virtual std::vector<libtorrent::info_hash_t> EditClientData(
+            const std::vector<libtorrent::info_hash_t>& hashes,
+            const std::function<bool(TorrentClientData&)>& edit) { return {}; }
+
+        virtual porla::Utils::Connection OnTrackerAnnounce(const TrackerAnnounceSignal::slot_type& subscriber) { return {}; }
 
         virtual libtorrent::info_hash_t AddTorrent(libtorrent::add_torrent_params const& p) = 0;
+
+        // The outcome of adding one torrent in a batch. The error is empty on success.
+        struct AddTorrentResult
+        {
+            libtorrent::info_hash_t info_hash;
+            std::string             error;
+        };
+
+        typedef std::function<void(std::vector<AddTorrentResult>)> AddTorrentsCallback;
+
+        // Adds torrents without waiting on each one, calling done with a result per params
+        // in the same order once all of them are added or have failed.
+        virtual void AddTorrents(std::vector<libtorrent::add_torrent_params> params, AddTorrentsCallback done)
+        {
+            std::vector<AddTorrentResult> results;
+            results.reserve(params.size());
+
+            for (const auto& p : params)
+            {
+                AddTorrentResult result;
+
+                try
+                {
+                    result.info_hash = AddTorrent(p);
+                    if (result.info_hash == libtorrent::info_hash_t()) result.error = "Failed to add torrent";
+                }
+                catch (const std::exception& ex)
+                {
+                    result.error = ex.what();
+                }
+
+                results.push_back(std::move(result));
+            }
+
+            done(std::move(results));
+        }
+
         virtual void ApplySettings(const libtorrent::settings_pack& settings) = 0;
         virtual void Pause() = 0;
         virtual void Recheck(const lt::info_hash_t& hash) = 0;
         virtual void Remove(const lt::info_hash_t& hash, bool remove_data) = 0;
         virtual void Resume() = 0;
+        // Every setting of the session, as it was last applied.
         virtual libtorrent::settings_pack Settings() = 0;
-        virtual const std::map<lt::info_hash_t, lt::torrent_handle>& Torrents() = 0;
+        virtual const TorrentHandles& Torrents() = 0;
+
+        // Holds the last known status for each torrent in the session. Kept fresh from the
+        // state updates posted by libtorrent, so reading it never blocks on the network thread.
+        virtual const std::map<lt::info_hash_t, lt::torrent_status>& TorrentStatuses() = 0;
     };
 
     class Session : public ISession
@@ -73,105 +483,436 @@ namespace porla
 
         ~Session();
 
-        boost::signals2::connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnPieceFinished(const PieceSignal::slot_type& subscriber) override
+        {
+            auto connection = m_pieceFinished.connect(subscriber);
+            UpdateAlertMask();
+            return connection;
+        }
+
+        porla::Utils::Connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) override
         {
             return m_sessionStats.connect(subscriber);
         }
 
-        boost::signals2::connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) override
         {
             return m_stateUpdate.connect(subscriber);
         }
 
-        boost::signals2::connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) override
         {
             return m_storageMoved.connect(subscriber);
         }
 
-        boost::signals2::connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) override
         {
             return m_storageMovedFailed.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) override
         {
             return m_torrentAdded.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentChecked(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentChecked.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) override
         {
             return m_torrentFinished.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) override
         {
             return m_torrentMediaInfo.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentMetadataReceived(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentMetadataReceived.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) override
         {
             return m_torrentPaused.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) override
         {
             return m_torrentRemoved.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) override
         {
             return m_torrentResumed.connect(subscriber);
         }
 
-        boost::signals2::connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) override
+        // Tracker alerts are only asked for while these have subscribers.
+        porla::Utils::Connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) override
         {
-            return m_torrentTrackerError.connect(subscriber);
+            auto connection = m_torrentTrackerError.connect(subscriber);
+            UpdateAlertMask();
+            return connection;
         }
 
-        boost::signals2::connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) override
+        porla::Utils::Connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) override
         {
-            return m_torrentTrackerReply.connect(subscriber);
+            auto connection = m_torrentTrackerReply.connect(subscriber);
+            UpdateAlertMask();
+            return connection;
         }
 
+        porla::Utils::Connection OnTrackerAnnounce(const TrackerAnnounceSignal::slot_type& subscriber) override
+        {
+            auto connection = m_trackerAnnounce.connect(subscriber);
+            UpdateAlertMask();
+            return connection;
+        }
+
+        porla::Utils::Connection OnTorrentsLoaded(const TorrentStatusListSignal::slot_type& subscriber) override
+        {
+            return m_torrentsLoaded.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnClientDataChanged(const InfoHashListSignal::slot_type& subscriber) override
+        {
+            return m_clientDataChanged.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentLifecycle(const TorrentLifecycleSignal::slot_type& subscriber) override
+        {
+            return m_torrentLifecycle.connect(subscriber);
+        }
+
+        [[nodiscard]] bool BatchesLifecycle() const override { return true; }
+
+        // Starts loading the stored torrents and returns without waiting on them.
         void Load();
 
+        libtorrent::alert_category_t DebugAlerts() const override { return libtorrent::alert_category_t(m_debugAlerts.load()); }
+        DemandToken Demand(Stats stats) override;
+        void SetTimers(const Timers& timers) override;
+        std::optional<SessionInstrumentation> Instrumentation() const override;
+        std::optional<DhtStats> Dht() const override;
+        LoadProgress Loading() const override;
         libtorrent::info_hash_t AddTorrent(libtorrent::add_torrent_params const& p) override;
+        void AddTorrents(std::vector<libtorrent::add_torrent_params> params, AddTorrentsCallback done) override;
         void ApplySettings(const libtorrent::settings_pack& settings) override;
+        void Drain(bool pause) override;
+        DrainProgress Draining() const override;
+        std::vector<libtorrent::info_hash_t> EditClientData(
+            const std::vector<libtorrent::info_hash_t>& hashes,
+            const std::function<bool(TorrentClientData&)>& edit) override;
+        void FileProgress(const lt::info_hash_t& hash, FileProgressCallback done) override;
+        bool JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join) override;
+        std::optional<const TorrentClientData*> Parked(const lt::info_hash_t& hash) const override;
         void Pause() override;
+        std::vector<PeerClass> PeerClasses() const override;
+        void PeerInfo(const lt::info_hash_t& hash, PeerInfoCallback done) override;
         void Recheck(const lt::info_hash_t& hash) override;
         void Remove(const lt::info_hash_t& hash, bool remove_data) override;
+        bool RemovePeerClass(const std::string& name) override;
         void Resume() override;
+        void SetDebugAlerts(libtorrent::alert_category_t categories) override;
+        void SetPeerClass(const PeerClass& peer_class) override;
         libtorrent::settings_pack Settings() override;
-        const std::map<lt::info_hash_t, lt::torrent_handle>& Torrents() override;
+        const TorrentHandles& Torrents() override;
+        const std::map<lt::info_hash_t, lt::torrent_status>& TorrentStatuses() override;
+        std::optional<libtorrent::torrent_handle> Unpark(const lt::info_hash_t& hash, bool resume) override;
 
     private:
         class Timer;
+        struct LoadState;
+
+        // Signals held back until the next state update brings the status they are
+        // emitted with.
+        struct AwaitingStatus
+        {
+            bool finished = false;
+            bool resumed  = false;
+        };
+
+        // What was last posted by libtorrent for a torrent when asked for, such as its peers,
+        // and who is waiting on the next alert with it.
+        template<typename T>
+        struct Fetched
+        {
+            std::chrono::steady_clock::time_point                       fetched;
+            std::shared_ptr<const T>                                    value;
+            std::vector<std::function<void(std::shared_ptr<const T>)>> waiting;
+        };
 
-        void ReadAlerts();
+        template<typename T>
+        using FetchedMap = std::map<lt::info_hash_t, Fetched<T>>;
+
+        // An alert with what is needed from it copied or moved out, so it outlives the next
+        // pop_alerts and can be handled on another thread than the one which read it.
+        struct Alert
+        {
+            struct Added
+            {
+                lt::add_torrent_params params;
+                lt::error_code         error;
+            };
+
+            struct Dropped
+            {
+                std::bitset<lt::num_alert_types> types;
+            };
+
+            struct ResumeData
+            {
+                lt::add_torrent_params params;
+            };
+
+            struct Stats
+            {
+                // In the order of m_stats.
+                std::vector<std::int64_t> values;
+                lt::time_point            when;
+            };
+
+            struct StateUpdate
+            {
+                std::vector<lt::torrent_status> status;
+            };
+
+            struct StorageMoved
+            {
+                std::string path;
+            };
+
+            struct StorageMoveFailed
+            {
+                lt::error_code error;
+                std::string    path;
+            };
+
+            struct FileProgress
+            {
+                std::vector<std::int64_t> progress;
+            };
+
+            struct Peers
+            {
+                std::vector<lt::peer_info> peers;
+            };
+
+            struct Removed
+            {
+                lt::info_hash_t info_hashes;
+            };
+
+            struct Dht
+            {
+                DhtStats::Node node;
+            };
+
+            struct PieceFinished
+            {
+                lt::piece_index_t piece;
+            };
+
+            int                type;
+            lt::torrent_handle handle;
+            std::string        name;
+            std::variant<std::monostate, Added, Dht, Dropped, FileProgress, Peers, PieceFinished, ResumeData, Stats, StateUpdate, StorageMoved, StorageMoveFailed, Removed, TrackerAnnounce, TrackerError> data;
+        };
+
+        struct AlertBatch
+        {
+            std::chrono::steady_clock::time_point popped;
+            std::vector<Alert>                    alerts;
+        };
+
+        struct PendingAdd
+        {
+            std::vector<AddTorrentResult> results;
+            std::size_t                   remaining;
+            AddTorrentsCallback           done;
+        };
+
+        struct Adding
+        {
+            std::shared_ptr<PendingAdd> batch;
+            std::size_t                 index;
+            // Known up front for torrent files and magnet links, and used to find the torrent
+            // when its add_torrent_alert was dropped.
+            lt::info_hash_t             info_hashes;
+        };
+
+        typedef std::map<const TorrentClientData*, Adding> AddingMap;
+
+        template<typename TSignal, typename... TArgs>
+        void Emit(const char* name, TSignal& signal, TArgs&&... args);
+        // Emits the lifecycle events gathered since the last flush, if there were any.
+        void FlushLifecycle();
+
+        typedef void (Session::*AlertHandler)(Alert& alert);
+
+        lt::alert_category_t AlertMask() const;
+        std::vector<Alert> DecodeAlerts(const std::vector<lt::alert*>& alerts) const;
+        void DrainAlerts();
+        template<typename T>
+        void Fetch(
+            FetchedMap<T>& cache,
+            const lt::info_hash_t& hash,
+            std::function<void(std::shared_ptr<const T>)> done,
+            const std::function<void(const lt::torrent_handle&)>& post);
+        template<typename T>
+        void Resolve(FetchedMap<T>& cache, const lt::info_hash_t& hash, T value);
+        void FinishAdding(AddingMap::iterator adding, const lt::info_hash_t& hash, std::string error);
+        void FinishLoading();
+        void GrowAlertQueue();
+        void HandleAlerts(std::vector<Alert>& alerts);
+        void HandleAddTorrent(Alert& alert);
+        void HandleAlertsDropped(Alert& alert);
+        void HandleDhtStats(Alert& alert);
+        bool HandleLoadedTorrent(Alert& alert);
+        void HandleFileProgress(Alert& alert);
+        void HandleMetadataReceived(Alert& alert);
+        void HandlePeerInfo(Alert& alert);
+        void HandlePieceFinished(Alert& alert);
+        void HandleSaveResumeData(Alert& alert);
+        void HandleSaveResumeDataFailed(Alert& alert);
+        void HandleSessionStats(Alert& alert);
+        void HandleStateUpdate(Alert& alert);
+        void HandleStorageMoved(Alert& alert);
+        void HandleStorageMovedFailed(Alert& alert);
+        void HandleTorrentChecked(Alert& alert);
+        void HandleTorrentFinished(Alert& alert);
+        void HandleTorrentPaused(Alert& alert);
+        void HandleTorrentRemoved(Alert& alert);
+        void HandleTorrentResumed(Alert& alert);
+        void HandleTrackerAnnounce(Alert& alert);
+        void HandleTrackerError(Alert& alert);
+        void HandleTrackerReply(Alert& alert);
+        std::shared_ptr<lt::torrent_plugin> JoinPeerClasses(const lt::torrent_handle& th, lt::client_data_t userdata);
+        void LoadStep();
+        void LoadTorrents();
+        void ParkIdle();
+        void PostLoadStep(LoadState& load);
+        void ProcessAlerts(const std::vector<lt::alert*>& alerts);
+        void Checkpoint();
+        void Drained(const lt::info_hash_t& hash);
+        void ReadAlerts(std::chrono::steady_clock::time_point notified);
+        void ResaveResumeData();
+        void ResaveTick();
+        void SaveDhtState();
+        bool Owns(const lt::info_hash_t& hash) const { return !m_owns || m_owns(hash); }
+        void RunAlertThread();
+        void SyncTorrents();
+        void UpdateAlertMask();
 
         boost::asio::io_context& m_io;
-        std::vector<Timer> m_timers;
+        std::map<Stats, Timer> m_timers;
         std::vector<lt::stats_metric> m_stats;
+        std::shared_ptr<const SessionMetrics::Layout> m_statsLayout;
+        // The previous update, which counter deltas are taken from.
+        SessionMetrics m_lastStats;
+        lt::time_point m_lastStatsAt;
 
-        std::filesystem::path m_session_params_file;
+        // Alert timings are kept by type and only named when a snapshot is taken.
+        std::array<SessionInstrumentation::Timing, lt::num_alert_types> m_alertTimings;
+        SessionInstrumentation m_instrumentation;
+
+        // The settings applied to the session, kept here so reading them is not a round
+        // trip to the network thread.
+        lt::settings_pack m_settings;
 
+        std::filesystem::path m_session_params_file;
+        std::filesystem::path m_state_snapshot_file;
+        std::chrono::milliseconds m_dhtStateInterval;
+        boost::asio::steady_timer m_dhtStateTimer;
+        std::int64_t m_dhtStateSaved;
+        // By local endpoint.
+        std::map<std::string, DhtStats::Node> m_dhtNodes;
+
+        PieceSignal m_pieceFinished;
         SessionStatsSignal m_sessionStats;
         TorrentStatusListSignal m_stateUpdate;
         TorrentHandleSignal m_storageMoved;
         TorrentHandleSignal m_storageMovedFailed;
         TorrentStatusSignal m_torrentAdded;
+        TorrentHandleSignal m_torrentChecked;
         TorrentStatusSignal m_torrentFinished;
         TorrentHandleSignal m_torrentMediaInfo;
+        TorrentHandleSignal m_torrentMetadataReceived;
         TorrentHandleSignal m_torrentPaused;
         InfoHashSignal m_torrentRemoved;
         TorrentStatusSignal m_torrentResumed;
         TrackerErrorSignal m_torrentTrackerError;
         TorrentHandleSignal m_torrentTrackerReply;
+        TorrentStatusListSignal m_torrentsLoaded;
+        InfoHashListSignal m_clientDataChanged;
+        TorrentLifecycleSignal m_torrentLifecycle;
+        TrackerAnnounceSignal m_trackerAnnounce;
+        TorrentLifecycle m_lifecycle;
 
         sqlite3* m_db;
+        std::shared_ptr<Data::WriteBehindQueue> m_writer;
+        std::function<bool(const Data::Models::AddTorrentParams::Row&)> m_loads;
+        std::function<bool(const lt::info_hash_t&)> m_owns;
 
         std::unique_ptr<libtorrent::session> m_session;
-        std::map<libtorrent::info_hash_t, libtorrent::torrent_handle> m_torrents;
+
+        bool m_alertThreadEnabled;
+        std::thread m_alertThread;
+        std::atomic<bool> m_alertThreadStopping;
+        std::atomic<bool> m_alertDrainPosted;
+        std::atomic<std::uint64_t> m_alertQueueDepth;
+        boost::lockfree::spsc_queue<AlertBatch*, boost::lockfree::capacity<256>> m_alertQueue;
+
+        // Indexed by alert type. Alerts without a handler are dropped when decoded.
+        std::array<AlertHandler, lt::num_alert_types> m_alertHandlers;
+        lt::alert_category_t m_alertMask;
+        std::atomic<std::uint32_t> m_debugAlerts;
+        bool m_requestUpdates;
+        // Used unless the registry is shared with other shards.
+        TorrentHandles m_ownTorrents;
+        std::map<libtorrent::info_hash_t, libtorrent::torrent_status> m_ownStatuses;
+        TorrentHandles& m_torrents;
+        std::map<libtorrent::info_hash_t, libtorrent::torrent_status>& m_statuses;
         std::map<std::pair<int, libtorrent::info_hash_t>, std::vector<std::function<void()>>> m_oneshot_torrent_callbacks;
+        std::map<libtorrent::info_hash_t, AwaitingStatus> m_awaiting;
+        FetchedMap<std::vector<std::int64_t>> m_fileProgress;
+        FetchedMap<std::vector<libtorrent::peer_info>> m_peerInfo;
+        // Torrents from AddTorrents waiting on their add_torrent_alert, keyed on their client
+        // data since that is the one thing in the params known to be unique.
+        AddingMap m_adding;
+
+        // Set while the stored torrents are being loaded.
+        std::unique_ptr<LoadState> m_load;
+        LoadProgress m_loadProgress;
+
+        int m_alertQueueMax;
+        // Torrents to save resume data for, from checkpoints or after save_resume_data_alerts
+        // were dropped, a few at a time so the alert queue is not flooded.
+        std::vector<std::pair<lt::torrent_handle, lt::resume_data_flags_t>> m_resave;
+        boost::asio::steady_timer m_resaveTimer;
+
+        std::chrono::milliseconds m_checkpointInterval;
+        boost::asio::steady_timer m_checkpointTimer;
+
+        // Set once draining, with the torrents whose resume data it still waits on.
+        bool m_draining;
+        std::set<lt::info_hash_t> m_drainSaving;
+
+        // Client data of the parked torrents, which libtorrent no longer holds. Torrents
+        // being parked wait on their resume data, and paused ones are timed from when
+        // they were first seen paused.
+        std::chrono::seconds m_parkAfter;
+        boost::asio::steady_timer m_parkTimer;
+        std::map<lt::info_hash_t, TorrentClientData*> m_parked;
+        std::map<lt::info_hash_t, std::chrono::steady_clock::time_point> m_parking;
+        std::map<lt::info_hash_t, std::chrono::steady_clock::time_point> m_pausedSince;
+
+        // Written on the io thread and read on the network thread as torrents are added.
+        mutable std::mutex m_peerClassesMutex;
+        std::map<std::string, std::pair<PeerClass, lt::peer_class_t>> m_peerClasses;
+        std::map<std::string, std::vector<lt::peer_class_t>> m_categoryClasses;
     };
 }
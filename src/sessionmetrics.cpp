@@ -0,0 +1,87 @@
+#include "sessionmetrics.hpp"
+
+using porla::SessionMetrics;
+
+SessionMetrics::Layout::Layout(const std::vector<std::pair<std::string, bool>>& metrics)
+{
+    names.reserve(metrics.size());
+    counters.reserve(metrics.size());
+    indices.reserve(metrics.size());
+
+    for (const auto& [name, counter] : metrics)
+    {
+        indices.insert({name, names.size()});
+        names.push_back(name);
+        counters.push_back(counter);
+    }
+}
+
+SessionMetrics::SessionMetrics(std::initializer_list<std::pair<std::string, std::int64_t>> gauges)
+{
+    std::vector<std::pair<std::string, bool>> metrics;
+
+    for (const auto& [name, value] : gauges)
+    {
+        metrics.emplace_back(name, false);
+        m_values.push_back(value);
+    }
+
+    m_layout = std::make_shared<const Layout>(metrics);
+}
+
+SessionMetrics::SessionMetrics(std::shared_ptr<const Layout> layout, std::vector<std::int64_t> values)
+    : m_layout(std::move(layout))
+    , m_values(std::move(values))
+{
+    m_values.resize(m_layout->names.size(), 0);
+}
+
+void SessionMetrics::Since(const SessionMetrics& previous, double seconds)
+{
+    if (previous.m_layout != m_layout || seconds <= 0)
+    {
+        return;
+    }
+
+    m_interval = seconds;
+    m_deltas.assign(m_values.size(), 0);
+
+    for (std::size_t i = 0; i < m_values.size(); i++)
+    {
+        if (!m_layout->counters[i])
+        {
+            continue;
+        }
+
+        const auto delta = m_values[i] - previous.m_values[i];
+        m_deltas[i] = delta < 0 ? m_values[i] : delta;
+    }
+}
+
+double SessionMetrics::Rate(std::size_t index) const
+{
+    return m_interval > 0 ? static_cast<double>(Delta(index)) / m_interval : 0;
+}
+
+std::optional<std::size_t> SessionMetrics::Find(const std::string& name) const
+{
+    if (m_layout == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    const auto index = m_layout->indices.find(name);
+
+    if (index == m_layout->indices.end())
+    {
+        return std::nullopt;
+    }
+
+    return index->second;
+}
+
+std::optional<std::int64_t> SessionMetrics::Get(const std::string& name) const
+{
+    const auto index = Find(name);
+    return index ? std::optional(m_values[*index]) : std::nullopt;
+}
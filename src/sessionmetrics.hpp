@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace porla
+{
+    // The metrics of one session stats update, addressed by their index in a layout shared
+    // by every update of the session. Counters also get how much they grew since the
+    // previous update, computed once for every subscriber.
+    class SessionMetrics
+    {
+    public:
+        struct Layout
+        {
+            // Names, and whether each is a counter rather than a gauge.
+            explicit Layout(const std::vector<std::pair<std::string, bool>>& metrics);
+
+            std::vector<std::string>                     names;
+            std::vector<bool>                            counters;
+            std::unordered_map<std::string, std::size_t> indices;
+        };
+
+        SessionMetrics() = default;
+
+        // Gauges in a layout of their own, for sessions without libtorrent's counters.
+        SessionMetrics(std::initializer_list<std::pair<std::string, std::int64_t>> gauges);
+
+        explicit SessionMetrics(std::shared_ptr<const Layout> layout, std::vector<std::int64_t> values);
+
+        // Sets the deltas of the counters from the previous update, taken seconds before.
+        // They are left at zero if it has another layout. A counter which went down was
+        // reset, and its delta is its value.
+        void Since(const SessionMetrics& previous, double seconds);
+
+        [[nodiscard]] std::size_t Size() const { return m_values.size(); }
+        [[nodiscard]] const std::string& Name(std::size_t index) const { return m_layout->names[index]; }
+        [[nodiscard]] bool IsCounter(std::size_t index) const { return m_layout->counters[index]; }
+        [[nodiscard]] std::int64_t Value(std::size_t index) const { return m_values[index]; }
+        [[nodiscard]] std::int64_t Delta(std::size_t index) const { return m_deltas.empty() ? 0 : m_deltas[index]; }
+        // Per second, over the interval.
+        [[nodiscard]] double Rate(std::size_t index) const;
+        // Seconds since the previous update, or zero for the first.
+        [[nodiscard]] double Interval() const { return m_interval; }
+
+        [[nodiscard]] const std::shared_ptr<const Layout>& GetLayout() const { return m_layout; }
+
+        [[nodiscard]] std::optional<std::size_t> Find(const std::string& name) const;
+        [[nodiscard]] std::optional<std::int64_t> Get(const std::string& name) const;
+
+    private:
+        std::shared_ptr<const Layout> m_layout;
+        std::vector<std::int64_t>     m_values;
+        std::vector<std::int64_t>     m_deltas;
+        double                        m_interval = 0;
+    };
+}
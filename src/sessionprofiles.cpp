@@ -0,0 +1,71 @@
+#include "sessionprofiles.hpp"
+
+#include <stdexcept>
+
+#include <boost/log/trivial.hpp>
+
+#include "session.hpp"
+#include "utils/settingspack.hpp"
+
+namespace lt = libtorrent;
+
+using porla::SessionProfiles;
+using porla::Utils::SettingsPack;
+
+SessionProfiles::SessionProfiles(SessionProfilesOptions options)
+    : m_session(options.session)
+    , m_profiles(std::move(options.profiles))
+{
+}
+
+int SessionProfiles::Activate(const std::optional<std::string>& name)
+{
+    const auto profile = name.has_value() ? m_profiles.find(*name) : m_profiles.end();
+
+    if (name.has_value() && profile == m_profiles.end())
+    {
+        throw std::invalid_argument("Unknown session profile '" + *name + "'");
+    }
+
+    const auto current = m_session.Settings();
+
+    // The session as it would be without the active profile.
+    lt::settings_pack base = current;
+    SettingsPack::Merge(base, m_replaced);
+
+    lt::settings_pack wanted = base;
+    lt::settings_pack replaced;
+
+    if (profile != m_profiles.end())
+    {
+        for (const int key : SettingsPack::Keys(profile->second))
+        {
+            SettingsPack::Copy(replaced, base, key);
+            SettingsPack::Copy(wanted, profile->second, key);
+        }
+    }
+
+    lt::settings_pack delta;
+    int applied = 0;
+
+    for (const int key : SettingsPack::Keys(wanted))
+    {
+        if (SettingsPack::Equal(wanted, current, key)) continue;
+
+        SettingsPack::Copy(delta, wanted, key);
+        applied++;
+    }
+
+    if (applied > 0)
+    {
+        m_session.ApplySettings(delta);
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Switched session profile from '" << m_active.value_or("") << "' to '"
+                            << name.value_or("") << "', applying " << applied << " setting(s)";
+
+    m_active   = name;
+    m_replaced = std::move(replaced);
+
+    return applied;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+
+#include <libtorrent/settings_pack.hpp>
+
+namespace porla
+{
+    class ISession;
+
+    struct SessionProfilesOptions
+    {
+        ISession&                                        session;
+        // Named bundles of settings, each with only the settings it changes.
+        std::map<std::string, libtorrent::settings_pack> profiles;
+    };
+
+    // Switches the session between profiles at runtime. A switch is applied as one
+    // settings pack, with the settings of the new profile and, for the settings only the
+    // previous profile had, the values from before it. Profiles are not stored, so the
+    // session starts without one.
+    class SessionProfiles
+    {
+    public:
+        explicit SessionProfiles(SessionProfilesOptions options);
+
+        // Activates the profile, or goes back to no profile for nullopt. Throws
+        // std::invalid_argument for profiles which do not exist. Returns how many settings
+        // were applied, which are only the ones that differ from the session.
+        int Activate(const std::optional<std::string>& name);
+
+        [[nodiscard]] const std::optional<std::string>& Active() const { return m_active; }
+        [[nodiscard]] const std::map<std::string, libtorrent::settings_pack>& Profiles() const { return m_profiles; }
+
+    private:
+        ISession& m_session;
+        std::map<std::string, libtorrent::settings_pack> m_profiles;
+        std::optional<std::string> m_active;
+        // The values the active profile replaced, put back when it is switched away from.
+        libtorrent::settings_pack m_replaced;
+    };
+}
@@ -0,0 +1,270 @@
+#include "settingstuner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/settings_pack.hpp>
+
+#include "session.hpp"
+
+using porla::SettingsTuner;
+
+const std::map<std::string, porla::SettingsTunerBounds> SettingsTuner::DefaultBounds = {
+    {"aio_threads",           {2, 64}},
+    {"connections_limit",     {200, 20000}},
+    {"send_buffer_watermark", {256 * 1024, 16 * 1024 * 1024}},
+    {"unchoke_slots_limit",   {8, 200}}
+};
+
+static std::string Percent(double value)
+{
+    return std::to_string(std::lround(value * 100)) + "%";
+}
+
+SettingsTuner::SettingsTuner(ISession& session, SettingsTunerOptions options)
+    : m_session(session)
+    , m_options(std::move(options))
+    , m_last(std::chrono::steady_clock::now())
+    , m_cpuWall(m_last)
+    , m_cpuTime(0)
+{
+    for (auto it = m_options.bounds.begin(); it != m_options.bounds.end();)
+    {
+        const int type = lt::setting_by_name(it->first);
+
+        if (type == -1 || (type & lt::settings_pack::type_mask) != lt::settings_pack::int_type_base)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Setting " << it->first << " cannot be tuned";
+            it = m_options.bounds.erase(it);
+            continue;
+        }
+
+        if (it->second.min > it->second.max)
+        {
+            std::swap(it->second.min, it->second.max);
+        }
+
+        ++it;
+    }
+
+    Cpu();
+
+    m_sessionStatsConnection = m_session.OnSessionStats(
+        [this](const auto& stats)
+        {
+            auto const now = std::chrono::steady_clock::now();
+
+            if (now - m_last < m_options.interval)
+            {
+                return;
+            }
+
+            m_last = now;
+
+            Evaluate(stats, Cpu().value_or(0));
+        });
+}
+
+SettingsTuner::~SettingsTuner()
+{
+    m_sessionStatsConnection.disconnect();
+}
+
+std::optional<double> SettingsTuner::Cpu()
+{
+    rusage usage{};
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return std::nullopt;
+    }
+
+    const double time = static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+        + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+
+    auto const now   = std::chrono::steady_clock::now();
+    const double wall  = std::chrono::duration<double>(now - m_cpuWall).count();
+    const double cores = std::max(1u, std::thread::hardware_concurrency());
+
+    std::optional<double> cpu;
+
+    if (wall > 0 && m_cpuTime > 0)
+    {
+        cpu = (time - m_cpuTime) / (wall * cores);
+    }
+
+    m_cpuTime = time;
+    m_cpuWall = now;
+
+    return cpu;
+}
+
+void SettingsTuner::Evaluate(const porla::SessionMetrics& stats, double cpu)
+{
+    auto const gauge = [&stats](const char* name) -> std::optional<int64_t>
+    {
+        return stats.Get(name);
+    };
+
+    // Counters are compared to the previous evaluation, which the first one does not have.
+    auto const counter = [&](const char* name) -> std::optional<int64_t>
+    {
+        auto const value = gauge(name);
+        if (!value) return std::nullopt;
+
+        auto const [it, inserted] = m_counters.insert({name, *value});
+        const int64_t delta = *value - it->second;
+        it->second = *value;
+
+        if (inserted) return std::nullopt;
+        return delta;
+    };
+
+    auto const settings = m_session.Settings();
+    auto const setting  = [&settings](const char* name) { return settings.get_int(lt::setting_by_name(name)); };
+
+    const int64_t no_memory  = counter("peer.no_memory_peers").value_or(0) + counter("peer.buffer_peers").value_or(0);
+    auto const turned_away   = counter("peer.too_many_peers");
+    auto const queued        = gauge("disk.queued_disk_jobs");
+    auto const connected     = gauge("peer.num_peers_connected");
+    auto const up_disk       = gauge("peer.num_peers_up_disk");
+    auto const up_interested = gauge("peer.num_peers_up_interested");
+    auto const up_unchoked   = gauge("peer.num_peers_up_unchoked");
+
+    // Unchoked peers whose send buffer is waiting to be filled from disk.
+    const double waiting = up_disk && up_unchoked && *up_unchoked > 0
+        ? static_cast<double>(*up_disk) / static_cast<double>(*up_unchoked)
+        : 0;
+
+    const bool busy = cpu > m_options.max_cpu;
+
+    // The direction each setting should move in, and why. The first reason given for a
+    // setting wins, so running out of CPU and memory goes first.
+    std::map<std::string, std::pair<int, std::string>> wants;
+
+    auto const want = [&wants](const char* name, int direction, std::string reason)
+    {
+        wants.insert({name, {direction, std::move(reason)}});
+    };
+
+    if (busy)
+    {
+        want("connections_limit", -1, "cpu at " + Percent(cpu));
+        want("unchoke_slots_limit", -1, "cpu at " + Percent(cpu));
+    }
+
+    if (no_memory > 0)
+    {
+        want("connections_limit", -1, std::to_string(no_memory) + " peers disconnected without memory");
+        want("send_buffer_watermark", -1, std::to_string(no_memory) + " peers disconnected without memory");
+    }
+
+    if (queued)
+    {
+        const int threads = setting("aio_threads");
+
+        if (*queued > static_cast<int64_t>(threads) * 4 && !busy)
+        {
+            want("aio_threads", 1, std::to_string(*queued) + " disk jobs queued for " + std::to_string(threads) + " threads");
+        }
+        else if (*queued == 0)
+        {
+            want("aio_threads", -1, "disk queue empty");
+        }
+    }
+
+    if (waiting > 0.25)
+    {
+        want("send_buffer_watermark", 1, Percent(waiting) + " of unchoked peers waiting on disk");
+    }
+
+    if (turned_away && *turned_away > 0 && connected && *connected >= setting("connections_limit") * 9 / 10 && !busy)
+    {
+        want("connections_limit", 1, std::to_string(*turned_away) + " peers turned away at the limit");
+    }
+
+    if (waiting > 0.5)
+    {
+        want("unchoke_slots_limit", -1, Percent(waiting) + " of unchoked peers waiting on disk");
+    }
+    else if (up_interested && waiting < 0.1 && !busy && *up_interested > static_cast<int64_t>(setting("unchoke_slots_limit")) * 2)
+    {
+        want("unchoke_slots_limit", 1, std::to_string(*up_interested) + " interested peers for " + std::to_string(setting("unchoke_slots_limit")) + " slots");
+    }
+
+    lt::settings_pack pack;
+    bool changed = false;
+
+    for (auto const& [name, bounds] : m_options.bounds)
+    {
+        const int type    = lt::setting_by_name(name);
+        const int current = settings.get_int(type);
+
+        auto& state  = m_states[name];
+        auto& choice = m_choices.try_emplace(name, Choice{ .value = current, .min = bounds.min, .max = bounds.max }).first->second;
+
+        choice.value = current;
+
+        if (choice.released)
+        {
+            continue;
+        }
+
+        if (state.applied && *state.applied != current)
+        {
+            BOOST_LOG_TRIVIAL(info) << "Setting " << name << " was changed to " << current << ", no longer tuning it";
+            choice.released = true;
+            continue;
+        }
+
+        auto const it = wants.find(name);
+        const int direction = it == wants.end() ? 0 : it->second.first;
+
+        if (direction == 0 || (state.streak > 0) != (direction > 0))
+        {
+            state.streak = 0;
+        }
+
+        state.streak += direction;
+
+        // Negative limits are unlimited, which is left as the operator set it.
+        if (std::abs(state.streak) < m_options.sustain || current < 0)
+        {
+            continue;
+        }
+
+        state.streak = 0;
+
+        const double stepped = direction > 0
+            ? std::max(current + 1.0, std::round(current * (1 + m_options.step)))
+            : std::min(current - 1.0, std::round(current * (1 - m_options.step)));
+
+        const int next = static_cast<int>(std::clamp(stepped, static_cast<double>(bounds.min), static_cast<double>(bounds.max)));
+
+        if ((direction > 0 && next <= current) || (direction < 0 && next >= current))
+        {
+            continue;
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Tuning " << name << " from " << current << " to " << next << ", " << it->second.second;
+
+        pack.set_int(type, next);
+        changed = true;
+
+        state.applied     = next;
+        choice.value      = next;
+        choice.changes++;
+        choice.changed_at = std::time(nullptr);
+        choice.reason     = it->second.second;
+    }
+
+    if (changed)
+    {
+        m_session.ApplySettings(pack);
+    }
+}
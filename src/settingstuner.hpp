@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "sessionmetrics.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct SettingsTunerBounds
+    {
+        int min;
+        int max;
+    };
+
+    struct SettingsTunerOptions
+    {
+        std::chrono::milliseconds interval = std::chrono::milliseconds(60000);
+        // The settings which may be changed, and the bounds they are kept in. Nothing else
+        // is touched.
+        std::map<std::string, SettingsTunerBounds> bounds;
+        // How far a setting moves with each change, as a fraction of its value.
+        double                    step     = 0.25;
+        // Intervals in a row a change has to be called for before it is made, so settings
+        // do not flap on a short burst.
+        int                       sustain  = 3;
+        // Process CPU, as a fraction of all cores, above which the settings which cost CPU
+        // are only ever lowered.
+        double                    max_cpu  = 0.8;
+    };
+
+    // Adjusts a few libtorrent settings as the session grows, from the session stats it
+    // already posts. A deep disk queue adds aio threads, uploads waiting on disk raise the
+    // send buffer watermark, peers turned away at the connection limit raise it, and many
+    // interested peers per unchoke slot add slots. High CPU and running out of memory for
+    // peers lower them again. Every change is logged, and a setting changed by anything
+    // else is left alone from then on.
+    class SettingsTuner
+    {
+    public:
+        // aio_threads, connections_limit, send_buffer_watermark and unchoke_slots_limit.
+        static const std::map<std::string, SettingsTunerBounds> DefaultBounds;
+
+        struct Choice
+        {
+            int           value;
+            int           min;
+            int           max;
+            std::uint64_t changes    = 0;
+            std::int64_t  changed_at = 0;
+            std::string   reason;
+            // Changed by something else, such as session.settings.update.
+            bool          released   = false;
+        };
+
+        explicit SettingsTuner(ISession& session, SettingsTunerOptions options);
+        SettingsTuner(const SettingsTuner&) = delete;
+
+        ~SettingsTuner();
+
+        // The tuned settings, by name, once they have been evaluated.
+        [[nodiscard]] const std::map<std::string, Choice>& Choices() const { return m_choices; }
+
+        // One evaluation of the stats, with the process CPU since the last one.
+        void Evaluate(const SessionMetrics& stats, double cpu);
+
+    private:
+        struct State
+        {
+            int                streak = 0;
+            std::optional<int> applied;
+        };
+
+        std::optional<double> Cpu();
+
+        ISession& m_session;
+        SettingsTunerOptions m_options;
+
+        std::map<std::string, Choice> m_choices;
+        std::map<std::string, State> m_states;
+        std::map<std::string, int64_t> m_counters;
+        std::chrono::steady_clock::time_point m_last;
+        std::chrono::steady_clock::time_point m_cpuWall;
+        double m_cpuTime;
+
+        porla::Utils::Connection m_sessionStatsConnection;
+    };
+}
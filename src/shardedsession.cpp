@@ -0,0 +1,679 @@
+#include "shardedsession.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+
+#include "data/writebehindqueue.hpp"
+#include "torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using porla::Data::Models::AddTorrentParams;
+using porla::ShardedSession;
+
+// Adds the offset to every port in a listen_interfaces setting, such as
+// "0.0.0.0:6881,[::]:6881s".
+static std::string OffsetPorts(const std::string& interfaces, int offset)
+{
+    std::stringstream in(interfaces);
+    std::stringstream out;
+    std::string item;
+    bool first = true;
+
+    while (std::getline(in, item, ','))
+    {
+        const auto colon = item.rfind(':');
+        const auto end   = item.find_first_not_of("0123456789", colon + 1);
+
+        if (colon != std::string::npos && end != colon + 1)
+        {
+            const auto digits = item.substr(colon + 1, end == std::string::npos ? std::string::npos : end - colon - 1);
+            const auto suffix = end == std::string::npos ? "" : item.substr(end);
+
+            item = item.substr(0, colon + 1) + std::to_string(std::stoi(digits) + offset) + suffix;
+        }
+
+        out << (first ? "" : ",") << item;
+        first = false;
+    }
+
+    return out.str();
+}
+
+static std::optional<std::string> Preset(const lt::add_torrent_params& params)
+{
+    const auto client_data = params.userdata.get<porla::TorrentClientData>();
+
+    if (client_data == nullptr || !client_data->preset.has_value())
+    {
+        return std::nullopt;
+    }
+
+    return client_data->preset->str();
+}
+
+ShardedSession::ShardedSession(boost::asio::io_context& io, ShardedSessionOptions const& options)
+    : m_options(options)
+{
+    m_options.shards = std::max(1, m_options.shards);
+
+    const auto& base = m_options.session;
+    const auto count = static_cast<std::size_t>(m_options.shards);
+
+    BOOST_LOG_TRIVIAL(info) << "Running " << count << " session shards";
+
+    m_writer = std::make_shared<porla::Data::WriteBehindQueue>(porla::Data::WriteBehindQueueOptions{
+        .db             = base.db,
+        .flush_interval = std::chrono::milliseconds(base.persistence_flush_interval),
+        .batch_size     = base.persistence_batch_size,
+        .compress       = base.persistence_compress,
+        .pragmas        = base.db_pragmas
+    });
+
+    m_stats.resize(count);
+    m_statsFresh.resize(count, false);
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        SessionOptions options = base;
+        options.settings = ShardSettings(base.settings, i);
+
+        // The first shard keeps the file of an unsharded session.
+        if (i > 0)
+        {
+            const auto& file = base.session_params_file;
+            options.session_params_file = file.parent_path() / (file.stem().string() + "." + std::to_string(i) + file.extension().string());
+        }
+
+        options.shard = SessionOptions::Shard{
+            .torrents = &m_torrents,
+            .statuses = &m_statuses,
+            .writer   = m_writer,
+            .loads    = [this, i](const AddTorrentParams::Row& row)
+            {
+                std::optional<std::string> preset;
+
+                if (!m_options.presets.empty())
+                {
+                    TorrentClientData client_data;
+
+                    try
+                    {
+                        AddTorrentParams::DecodeClientData(row, client_data);
+                        if (client_data.preset.has_value()) preset = client_data.preset->str();
+                    }
+                    catch (const std::exception&)
+                    {
+                        // Placed by hash, and decoding the row reports it.
+                    }
+                }
+
+                return Assign(row.info_hash, preset) == i;
+            },
+            .owns     = [this, i](const lt::info_hash_t& hash)
+            {
+                const auto owner = m_owners.find(hash);
+                return owner != m_owners.end() && owner->second == i;
+            }
+        };
+
+        BOOST_LOG_TRIVIAL(info) << "Shard " << i << " listening on " << options.settings.get_str(lt::settings_pack::listen_interfaces);
+
+        auto& shard = *m_shards.emplace_back(std::make_unique<Session>(io, options));
+
+        m_connections.push_back(shard.OnSessionStats(
+            [this, i](const SessionMetrics& stats)
+            {
+                m_stats[i] = stats;
+                m_statsFresh[i] = true;
+
+                if (std::find(m_statsFresh.begin(), m_statsFresh.end(), false) != m_statsFresh.end())
+                {
+                    return;
+                }
+
+                const auto& first = m_stats.front();
+                std::vector<std::int64_t> values(first.Size(), 0);
+
+                for (const auto& shard_stats : m_stats)
+                {
+                    for (std::size_t index = 0; index < values.size() && index < shard_stats.Size(); index++)
+                    {
+                        values[index] += shard_stats.Value(index);
+                    }
+                }
+
+                std::fill(m_statsFresh.begin(), m_statsFresh.end(), false);
+
+                const auto now = std::chrono::steady_clock::now();
+
+                SessionMetrics summed(first.GetLayout(), std::move(values));
+
+                if (m_lastStats.Size() > 0)
+                {
+                    summed.Since(m_lastStats, std::chrono::duration<double>(now - m_lastStatsAt).count());
+                }
+
+                m_sessionStats(summed);
+
+                m_lastStats   = std::move(summed);
+                m_lastStatsAt = now;
+            }));
+
+        m_connections.push_back(shard.OnTorrentAdded(
+            [this, i](const lt::torrent_status& ts)
+            {
+                m_owners.insert_or_assign(ts.info_hashes, i);
+                m_torrentAdded(ts);
+            }));
+
+        m_connections.push_back(shard.OnTorrentsLoaded(
+            [this, i](const std::vector<lt::torrent_status>& torrents)
+            {
+                for (const auto& ts : torrents) m_owners.insert_or_assign(ts.info_hashes, i);
+                m_torrentsLoaded(torrents);
+            }));
+
+        m_connections.push_back(shard.OnClientDataChanged(
+            [this](const std::vector<lt::info_hash_t>& hashes) { m_clientDataChanged(hashes); }));
+        m_connections.push_back(shard.OnTorrentLifecycle(
+            [this](const TorrentLifecycle& lifecycle) { m_torrentLifecycle(lifecycle); }));
+
+        m_connections.push_back(shard.OnTorrentRemoved(
+            [this](const lt::info_hash_t& hash)
+            {
+                m_owners.erase(hash);
+                m_torrentRemoved(hash);
+            }));
+
+        m_connections.push_back(shard.OnStateUpdate([this](const auto& torrents) { m_stateUpdate(torrents); }));
+        m_connections.push_back(shard.OnStorageMoved([this](const auto& th) { m_storageMoved(th); }));
+        m_connections.push_back(shard.OnStorageMovedFailed([this](const auto& th) { m_storageMovedFailed(th); }));
+        m_connections.push_back(shard.OnTorrentChecked([this](const auto& th) { m_torrentChecked(th); }));
+        m_connections.push_back(shard.OnTorrentFinished([this](const auto& ts) { m_torrentFinished(ts); }));
+        m_connections.push_back(shard.OnTorrentMediaInfo([this](const auto& th) { m_torrentMediaInfo(th); }));
+        m_connections.push_back(shard.OnTorrentMetadataReceived([this](const auto& th) { m_torrentMetadataReceived(th); }));
+        m_connections.push_back(shard.OnTorrentPaused([this](const auto& th) { m_torrentPaused(th); }));
+        m_connections.push_back(shard.OnTorrentResumed([this](const auto& ts) { m_torrentResumed(ts); }));
+    }
+}
+
+ShardedSession::~ShardedSession()
+{
+    for (auto& connection : m_connections)
+    {
+        connection.disconnect();
+    }
+
+    // Each shard saves its resume data through the shared writer as it shuts down.
+    m_shards.clear();
+}
+
+porla::Utils::Connection ShardedSession::OnPieceFinished(const PieceSignal::slot_type& subscriber)
+{
+    if (!m_forwardPieceFinished)
+    {
+        m_forwardPieceFinished = true;
+
+        for (auto& shard : m_shards)
+        {
+            m_connections.push_back(shard->OnPieceFinished([this](const auto& th, auto piece) { m_pieceFinished(th, piece); }));
+        }
+    }
+
+    return m_pieceFinished.connect(subscriber);
+}
+
+porla::Utils::Connection ShardedSession::OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber)
+{
+    if (!m_forwardTrackerError)
+    {
+        m_forwardTrackerError = true;
+
+        for (auto& shard : m_shards)
+        {
+            m_connections.push_back(shard->OnTorrentTrackerError([this](const auto& error) { m_torrentTrackerError(error); }));
+        }
+    }
+
+    return m_torrentTrackerError.connect(subscriber);
+}
+
+porla::Utils::Connection ShardedSession::OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber)
+{
+    if (!m_forwardTrackerReply)
+    {
+        m_forwardTrackerReply = true;
+
+        for (auto& shard : m_shards)
+        {
+            m_connections.push_back(shard->OnTorrentTrackerReply([this](const auto& th) { m_torrentTrackerReply(th); }));
+        }
+    }
+
+    return m_torrentTrackerReply.connect(subscriber);
+}
+
+porla::Utils::Connection ShardedSession::OnTrackerAnnounce(const TrackerAnnounceSignal::slot_type& subscriber)
+{
+    if (!m_forwardTrackerAnnounce)
+    {
+        m_forwardTrackerAnnounce = true;
+
+        for (auto& shard : m_shards)
+        {
+            m_connections.push_back(shard->OnTrackerAnnounce([this](const auto& announce) { m_trackerAnnounce(announce); }));
+        }
+    }
+
+    return m_trackerAnnounce.connect(subscriber);
+}
+
+void ShardedSession::Load()
+{
+    for (auto& shard : m_shards)
+    {
+        shard->Load();
+    }
+}
+
+std::size_t ShardedSession::Assign(const lt::info_hash_t& hash, const std::optional<std::string>& preset) const
+{
+    if (preset.has_value())
+    {
+        if (const auto it = m_options.presets.find(*preset); it != m_options.presets.end()
+            && it->second >= 0
+            && it->second < m_options.shards)
+        {
+            return static_cast<std::size_t>(it->second);
+        }
+    }
+
+    const auto best = hash.get_best();
+
+    std::uint32_t value;
+    std::memcpy(&value, best.data(), sizeof(value));
+
+    return value % static_cast<std::uint32_t>(m_options.shards);
+}
+
+lt::settings_pack ShardedSession::ShardSettings(const lt::settings_pack& settings, std::size_t shard) const
+{
+    lt::settings_pack pack = settings;
+
+    if (shard < m_options.listen_interfaces.size())
+    {
+        pack.set_str(lt::settings_pack::listen_interfaces, m_options.listen_interfaces[shard]);
+    }
+    else if (shard > 0 && settings.has_val(lt::settings_pack::listen_interfaces))
+    {
+        pack.set_str(
+            lt::settings_pack::listen_interfaces,
+            OffsetPorts(settings.get_str(lt::settings_pack::listen_interfaces), static_cast<int>(shard)));
+    }
+    else if (shard > 0)
+    {
+        const auto defaults = lt::default_settings();
+        pack.set_str(
+            lt::settings_pack::listen_interfaces,
+            OffsetPorts(defaults.get_str(lt::settings_pack::listen_interfaces), static_cast<int>(shard)));
+    }
+
+    return pack;
+}
+
+porla::Session& ShardedSession::Owner(const lt::info_hash_t& hash) const
+{
+    const auto owner = m_owners.find(hash);
+    return *m_shards.at(owner != m_owners.end() ? owner->second : 0);
+}
+
+lt::alert_category_t ShardedSession::DebugAlerts() const
+{
+    return m_shards.front()->DebugAlerts();
+}
+
+porla::ISession::DemandToken ShardedSession::Demand(Stats stats)
+{
+    auto tokens = std::make_shared<std::vector<DemandToken>>();
+
+    for (auto& shard : m_shards)
+    {
+        tokens->push_back(shard->Demand(stats));
+    }
+
+    return tokens;
+}
+
+void ShardedSession::SetTimers(const Timers& timers)
+{
+    for (auto& shard : m_shards)
+    {
+        shard->SetTimers(timers);
+    }
+}
+
+std::optional<porla::DhtStats> ShardedSession::Dht() const
+{
+    DhtStats merged;
+
+    // Each shard has a DHT node of its own per listen socket, and its own state file. The
+    // oldest save is the one reported.
+    for (std::size_t i = 0; i < m_shards.size(); i++)
+    {
+        const auto stats = m_shards[i]->Dht();
+        if (!stats.has_value()) continue;
+
+        merged.nodes.insert(merged.nodes.end(), stats->nodes.begin(), stats->nodes.end());
+        merged.state_saved = i == 0 ? stats->state_saved : std::min(merged.state_saved, stats->state_saved);
+    }
+
+    return merged;
+}
+
+std::optional<porla::SessionInstrumentation> ShardedSession::Instrumentation() const
+{
+    auto merged = m_shards.front()->Instrumentation();
+
+    if (!merged.has_value())
+    {
+        return std::nullopt;
+    }
+
+    // The persistence histograms come from the shared writer, and are the same in all.
+    for (std::size_t i = 1; i < m_shards.size(); i++)
+    {
+        const auto shard = m_shards[i]->Instrumentation();
+        if (!shard.has_value()) continue;
+
+        merged->alert_batch_size.Merge(shard->alert_batch_size);
+        merged->alert_queue_depth += shard->alert_queue_depth;
+        merged->alert_queue_size  += shard->alert_queue_size;
+        merged->alert_resyncs     += shard->alert_resyncs;
+        merged->loop_lag.Merge(shard->loop_lag);
+        merged->load_add.Merge(shard->load_add);
+        merged->load_decode.Merge(shard->load_decode);
+
+        for (const auto& [name, timing] : shard->alerts)
+        {
+            merged->alerts[name].count   += timing.count;
+            merged->alerts[name].seconds += timing.seconds;
+        }
+
+        for (const auto& [name, count] : shard->alerts_dropped)
+        {
+            merged->alerts_dropped[name] += count;
+        }
+
+        for (const auto& [name, timing] : shard->signals)
+        {
+            merged->signals[name].count   += timing.count;
+            merged->signals[name].seconds += timing.seconds;
+        }
+    }
+
+    return merged;
+}
+
+porla::ISession::LoadProgress ShardedSession::Loading() const
+{
+    LoadProgress progress{ .done = true };
+
+    for (const auto& shard : m_shards)
+    {
+        const auto shard_progress = shard->Loading();
+
+        progress.done    = progress.done && shard_progress.done;
+        progress.failed += shard_progress.failed;
+        progress.loaded += shard_progress.loaded;
+        progress.total  += shard_progress.total;
+    }
+
+    return progress;
+}
+
+void ShardedSession::Drain(bool pause)
+{
+    for (auto& shard : m_shards)
+    {
+        shard->Drain(pause);
+    }
+}
+
+porla::ISession::DrainProgress ShardedSession::Draining() const
+{
+    // The writes are the shared writer's, and the same in all.
+    DrainProgress progress{ .draining = true, .writes = m_writer->Pending(), .drained = true };
+
+    for (const auto& shard : m_shards)
+    {
+        const auto shard_progress = shard->Draining();
+
+        progress.draining = progress.draining && shard_progress.draining;
+        progress.drained  = progress.drained && shard_progress.drained;
+        progress.saving  += shard_progress.saving;
+    }
+
+    progress.drained = progress.drained && progress.writes == 0;
+
+    return progress;
+}
+
+lt::info_hash_t ShardedSession::AddTorrent(lt::add_torrent_params const& p)
+{
+    const auto hash = p.ti ? p.ti->info_hashes() : p.info_hashes;
+    return m_shards.at(Assign(hash, Preset(p)))->AddTorrent(p);
+}
+
+void ShardedSession::AddTorrents(std::vector<lt::add_torrent_params> params, AddTorrentsCallback done)
+{
+    struct Pending
+    {
+        std::vector<AddTorrentResult> results;
+        std::size_t                   remaining = 0;
+        AddTorrentsCallback           done;
+    };
+
+    if (params.empty())
+    {
+        return done({});
+    }
+
+    auto pending = std::make_shared<Pending>();
+    pending->results.resize(params.size());
+    pending->done = std::move(done);
+
+    // Split by shard, remembering where each result goes.
+    std::vector<std::vector<lt::add_torrent_params>> batches(m_shards.size());
+    std::vector<std::vector<std::size_t>> positions(m_shards.size());
+
+    for (std::size_t i = 0; i < params.size(); i++)
+    {
+        const auto hash  = params[i].ti ? params[i].ti->info_hashes() : params[i].info_hashes;
+        const auto shard = Assign(hash, Preset(params[i]));
+
+        batches[shard].push_back(std::move(params[i]));
+        positions[shard].push_back(i);
+    }
+
+    for (const auto& batch : batches)
+    {
+        if (!batch.empty()) pending->remaining++;
+    }
+
+    for (std::size_t shard = 0; shard < m_shards.size(); shard++)
+    {
+        if (batches[shard].empty())
+        {
+            continue;
+        }
+
+        m_shards[shard]->AddTorrents(
+            std::move(batches[shard]),
+            [pending, positions = std::move(positions[shard])](std::vector<AddTorrentResult> results)
+            {
+                for (std::size_t i = 0; i < results.size() && i < positions.size(); i++)
+                {
+                    pending->results[positions[i]] = std::move(results[i]);
+                }
+
+                if (--pending->remaining == 0)
+                {
+                    pending->done(std::move(pending->results));
+                }
+            });
+    }
+}
+
+std::vector<lt::info_hash_t> ShardedSession::EditClientData(
+    const std::vector<lt::info_hash_t>& hashes,
+    const std::function<bool(TorrentClientData&)>& edit)
+{
+    // Each shard persists and announces the torrents it owns.
+    std::vector<std::vector<lt::info_hash_t>> owned(m_shards.size());
+
+    for (const auto& hash : hashes)
+    {
+        const auto owner = m_owners.find(hash);
+
+        if (owner != m_owners.end())
+        {
+            owned[owner->second].push_back(hash);
+        }
+    }
+
+    std::vector<lt::info_hash_t> changed;
+
+    for (std::size_t i = 0; i < m_shards.size(); i++)
+    {
+        if (owned[i].empty())
+        {
+            continue;
+        }
+
+        const auto edited = m_shards[i]->EditClientData(owned[i], edit);
+        changed.insert(changed.end(), edited.begin(), edited.end());
+    }
+
+    return changed;
+}
+
+void ShardedSession::ApplySettings(const lt::settings_pack& settings)
+{
+    for (std::size_t i = 0; i < m_shards.size(); i++)
+    {
+        lt::settings_pack pack = settings;
+
+        // A new port for all of them still needs one per shard.
+        if (i > 0 && settings.has_val(lt::settings_pack::listen_interfaces))
+        {
+            pack.set_str(
+                lt::settings_pack::listen_interfaces,
+                OffsetPorts(settings.get_str(lt::settings_pack::listen_interfaces), static_cast<int>(i)));
+        }
+
+        m_shards[i]->ApplySettings(pack);
+    }
+}
+
+void ShardedSession::FileProgress(const lt::info_hash_t& hash, FileProgressCallback done)
+{
+    Owner(hash).FileProgress(hash, std::move(done));
+}
+
+bool ShardedSession::JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join)
+{
+    return Owner(hash).JoinPeerClass(hash, name, join);
+}
+
+std::optional<const porla::TorrentClientData*> ShardedSession::Parked(const lt::info_hash_t& hash) const
+{
+    return Owner(hash).Parked(hash);
+}
+
+void ShardedSession::Pause()
+{
+    for (auto& shard : m_shards)
+    {
+        shard->Pause();
+    }
+}
+
+std::vector<porla::PeerClass> ShardedSession::PeerClasses() const
+{
+    return m_shards.front()->PeerClasses();
+}
+
+void ShardedSession::PeerInfo(const lt::info_hash_t& hash, PeerInfoCallback done)
+{
+    Owner(hash).PeerInfo(hash, std::move(done));
+}
+
+void ShardedSession::Recheck(const lt::info_hash_t& hash)
+{
+    Owner(hash).Recheck(hash);
+}
+
+void ShardedSession::Remove(const lt::info_hash_t& hash, bool remove_data)
+{
+    Owner(hash).Remove(hash, remove_data);
+}
+
+bool ShardedSession::RemovePeerClass(const std::string& name)
+{
+    bool removed = false;
+
+    for (auto& shard : m_shards)
+    {
+        removed = shard->RemovePeerClass(name) || removed;
+    }
+
+    return removed;
+}
+
+void ShardedSession::Resume()
+{
+    for (auto& shard : m_shards)
+    {
+        shard->Resume();
+    }
+}
+
+void ShardedSession::SetDebugAlerts(lt::alert_category_t categories)
+{
+    for (auto& shard : m_shards)
+    {
+        shard->SetDebugAlerts(categories);
+    }
+}
+
+void ShardedSession::SetPeerClass(const PeerClass& peer_class)
+{
+    for (auto& shard : m_shards)
+    {
+        shard->SetPeerClass(peer_class);
+    }
+}
+
+lt::settings_pack ShardedSession::Settings()
+{
+    return m_shards.front()->Settings();
+}
+
+const porla::TorrentHandles& ShardedSession::Torrents()
+{
+    return m_torrents;
+}
+
+const std::map<lt::info_hash_t, lt::torrent_status>& ShardedSession::TorrentStatuses()
+{
+    return m_statuses;
+}
+
+std::optional<lt::torrent_handle> ShardedSession::Unpark(const lt::info_hash_t& hash, bool resume)
+{
+    return Owner(hash).Unpark(hash, resume);
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "session.hpp"
+
+namespace porla
+{
+    struct ShardedSessionOptions
+    {
+        // Options for every shard. The listen interfaces and the session params file are
+        // made per shard from these.
+        SessionOptions             session;
+        int                        shards = 2;
+        // Listen interfaces by shard. Shards without any listen on the ports of the base
+        // settings, offset by their index.
+        std::vector<std::string>   listen_interfaces;
+        // Torrents of these presets go to the shard, and the rest by info hash.
+        std::map<std::string, int> presets;
+    };
+
+    // Several libtorrent sessions in one process, each with its own network thread, listen
+    // port and alert loop, behind one ISession. The shards share the torrent registry, the
+    // statuses and the database writer, so the RPC, SSE and workflows never see which one
+    // a torrent is in. A torrent stays in the shard it was added to.
+    class ShardedSession : public ISession
+    {
+    public:
+        explicit ShardedSession(boost::asio::io_context& io, ShardedSessionOptions const& options);
+
+        ShardedSession(const ShardedSession&) = delete;
+        ShardedSession& operator=(const ShardedSession&) = delete;
+
+        ~ShardedSession() override;
+
+        porla::Utils::Connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) override
+        {
+            return m_sessionStats.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) override
+        {
+            return m_stateUpdate.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_storageMoved.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_storageMovedFailed.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) override
+        {
+            return m_torrentAdded.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentChecked(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentChecked.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) override
+        {
+            return m_torrentFinished.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentMediaInfo.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentMetadataReceived(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentMetadataReceived.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentPaused.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) override
+        {
+            return m_torrentRemoved.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) override
+        {
+            return m_torrentResumed.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentsLoaded(const TorrentStatusListSignal::slot_type& subscriber) override
+        {
+            return m_torrentsLoaded.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnClientDataChanged(const InfoHashListSignal::slot_type& subscriber) override
+        {
+            return m_clientDataChanged.connect(subscriber);
+        }
+
+        // Per shard, so one batch of alerts on each shard is one emit.
+        porla::Utils::Connection OnTorrentLifecycle(const TorrentLifecycleSignal::slot_type& subscriber) override
+        {
+            return m_torrentLifecycle.connect(subscriber);
+        }
+
+        [[nodiscard]] bool BatchesLifecycle() const override { return true; }
+
+        // Piece and tracker alerts are asked of the shards once these have a subscriber.
+        porla::Utils::Connection OnPieceFinished(const PieceSignal::slot_type& subscriber) override;
+        porla::Utils::Connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) override;
+        porla::Utils::Connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) override;
+        porla::Utils::Connection OnTrackerAnnounce(const TrackerAnnounceSignal::slot_type& subscriber) override;
+
+        // Starts loading the stored torrents in every shard.
+        void Load();
+
+        libtorrent::alert_category_t DebugAlerts() const override;
+        DemandToken Demand(Stats stats) override;
+        void SetTimers(const Timers& timers) override;
+        std::optional<SessionInstrumentation> Instrumentation() const override;
+        std::optional<DhtStats> Dht() const override;
+        LoadProgress Loading() const override;
+        libtorrent::info_hash_t AddTorrent(libtorrent::add_torrent_params const& p) override;
+        void AddTorrents(std::vector<libtorrent::add_torrent_params> params, AddTorrentsCallback done) override;
+        void ApplySettings(const libtorrent::settings_pack& settings) override;
+        void Drain(bool pause) override;
+        DrainProgress Draining() const override;
+        std::vector<libtorrent::info_hash_t> EditClientData(
+            const std::vector<libtorrent::info_hash_t>& hashes,
+            const std::function<bool(TorrentClientData&)>& edit) override;
+        void FileProgress(const lt::info_hash_t& hash, FileProgressCallback done) override;
+        bool JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join) override;
+        std::optional<const TorrentClientData*> Parked(const lt::info_hash_t& hash) const override;
+        void Pause() override;
+        std::vector<PeerClass> PeerClasses() const override;
+        void PeerInfo(const lt::info_hash_t& hash, PeerInfoCallback done) override;
+        void Recheck(const lt::info_hash_t& hash) override;
+        void Remove(const lt::info_hash_t& hash, bool remove_data) override;
+        bool RemovePeerClass(const std::string& name) override;
+        void Resume() override;
+        void SetDebugAlerts(libtorrent::alert_category_t categories) override;
+        void SetPeerClass(const PeerClass& peer_class) override;
+        libtorrent::settings_pack Settings() override;
+        const TorrentHandles& Torrents() override;
+        const std::map<lt::info_hash_t, lt::torrent_status>& TorrentStatuses() override;
+        std::optional<libtorrent::torrent_handle> Unpark(const lt::info_hash_t& hash, bool resume) override;
+
+    private:
+        // The shard for a torrent not added yet. Safe to call from any thread.
+        std::size_t Assign(const lt::info_hash_t& hash, const std::optional<std::string>& preset) const;
+        libtorrent::settings_pack ShardSettings(const libtorrent::settings_pack& settings, std::size_t shard) const;
+        // The shard which has the torrent, or the first one for unknown torrents.
+        Session& Owner(const lt::info_hash_t& hash) const;
+
+        ShardedSessionOptions m_options;
+
+        // Declared before the shards, which use them until they are destroyed.
+        TorrentHandles m_torrents;
+        std::map<libtorrent::info_hash_t, libtorrent::torrent_status> m_statuses;
+        std::shared_ptr<Data::WriteBehindQueue> m_writer;
+        std::map<libtorrent::info_hash_t, std::size_t> m_owners;
+
+        std::vector<std::unique_ptr<Session>> m_shards;
+        std::vector<porla::Utils::Connection> m_connections;
+        bool m_forwardPieceFinished   = false;
+        bool m_forwardTrackerAnnounce = false;
+        bool m_forwardTrackerError    = false;
+        bool m_forwardTrackerReply    = false;
+
+        // The last stats of every shard, summed once all of them posted again. Shards share
+        // libtorrent's metrics, so their values are summed by index.
+        std::vector<SessionMetrics> m_stats;
+        std::vector<bool> m_statsFresh;
+        SessionMetrics m_lastStats;
+        std::chrono::steady_clock::time_point m_lastStatsAt;
+
+        PieceSignal m_pieceFinished;
+        SessionStatsSignal m_sessionStats;
+        TorrentStatusListSignal m_stateUpdate;
+        TorrentHandleSignal m_storageMoved;
+        TorrentHandleSignal m_storageMovedFailed;
+        TorrentStatusSignal m_torrentAdded;
+        TorrentHandleSignal m_torrentChecked;
+        TorrentStatusSignal m_torrentFinished;
+        TorrentHandleSignal m_torrentMediaInfo;
+        TorrentHandleSignal m_torrentMetadataReceived;
+        TorrentHandleSignal m_torrentPaused;
+        InfoHashSignal m_torrentRemoved;
+        TorrentStatusSignal m_torrentResumed;
+        TrackerErrorSignal m_torrentTrackerError;
+        TorrentHandleSignal m_torrentTrackerReply;
+        TorrentStatusListSignal m_torrentsLoaded;
+        TrackerAnnounceSignal m_trackerAnnounce;
+        InfoHashListSignal m_clientDataChanged;
+        TorrentLifecycleSignal m_torrentLifecycle;
+    };
+}
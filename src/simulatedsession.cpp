@@ -0,0 +1,346 @@
+#include "simulatedsession.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/torrent_info.hpp>
+
+namespace lt = libtorrent;
+
+using porla::SimulatedSession;
+
+static const int MaxRate = 20 * 1024 * 1024;
+
+SimulatedSession::SimulatedSession(boost::asio::io_context& io, SimulatedSessionOptions const& options)
+    : m_options(options)
+    , m_rng(options.seed)
+    , m_paused(false)
+    , m_sessionStatsTimer(io)
+    , m_torrentUpdatesTimer(io)
+    , m_finish_carry(0)
+    , m_update_carry(0)
+    , m_settings(lt::default_settings())
+{
+}
+
+SimulatedSession::~SimulatedSession()
+{
+    boost::system::error_code ec;
+    m_sessionStatsTimer.cancel(ec);
+    m_torrentUpdatesTimer.cancel(ec);
+}
+
+void SimulatedSession::Load()
+{
+    static const lt::torrent_status::state_t states[] =
+    {
+        lt::torrent_status::downloading,
+        lt::torrent_status::seeding,
+        lt::torrent_status::seeding,
+        lt::torrent_status::seeding
+    };
+
+    BOOST_LOG_TRIVIAL(info) << "Simulating " << m_options.torrents << " torrent(s)";
+
+    std::uniform_int_distribution<int> rate(0, MaxRate);
+    std::uniform_int_distribution<std::int64_t> size(1 << 20, std::int64_t(64) << 30);
+    std::uniform_real_distribution<float> progress(0.f, 1.f);
+
+    const auto now = std::time(nullptr);
+
+    m_hashes.reserve(m_options.torrents);
+
+    for (int i = 0; i < m_options.torrents; i++)
+    {
+        lt::torrent_status ts;
+        ts.info_hashes       = RandomHash();
+        ts.name              = "Simulated.Torrent." + std::to_string(i);
+        ts.save_path         = "/simulated/" + std::to_string(i % 64);
+        ts.added_time        = now - i;
+        ts.state             = states[i % std::size(states)];
+        ts.total             = size(m_rng);
+        ts.total_wanted      = ts.total;
+        ts.progress          = ts.state == lt::torrent_status::downloading ? progress(m_rng) : 1.f;
+        ts.total_done        = static_cast<std::int64_t>(ts.total * ts.progress);
+        ts.download_rate     = ts.state == lt::torrent_status::downloading ? rate(m_rng) : 0;
+        ts.upload_rate       = i % 3 == 0 ? rate(m_rng) : 0;
+        ts.all_time_download = ts.total_done;
+        ts.all_time_upload   = ts.total_done * (i % 5);
+        ts.is_finished       = ts.state == lt::torrent_status::seeding;
+        ts.is_seeding        = ts.is_finished;
+        ts.queue_position    = lt::queue_position_t{ts.state == lt::torrent_status::downloading ? i : -1};
+
+        Insert(std::move(ts));
+    }
+
+    Schedule(m_sessionStatsTimer, m_options.timer_session_stats, &SimulatedSession::PostSessionStats);
+    Schedule(m_torrentUpdatesTimer, m_options.timer_torrent_updates, &SimulatedSession::PostTorrentUpdates);
+}
+
+lt::info_hash_t SimulatedSession::AddTorrent(lt::add_torrent_params const& p)
+{
+    lt::torrent_status ts;
+    ts.info_hashes  = p.ti ? p.ti->info_hashes() : p.info_hashes;
+    ts.name         = p.ti ? p.ti->name() : p.name;
+    ts.save_path    = p.save_path;
+    ts.added_time   = std::time(nullptr);
+    ts.flags        = p.flags;
+    ts.state        = lt::torrent_status::downloading;
+    ts.total        = p.ti ? p.ti->total_size() : 0;
+    ts.total_wanted = ts.total;
+
+    if (!ts.info_hashes.has_v1() && !ts.info_hashes.has_v2())
+    {
+        ts.info_hashes = RandomHash();
+    }
+
+    if (m_statuses.contains(ts.info_hashes))
+    {
+        return ts.info_hashes;
+    }
+
+    const auto& status = Insert(std::move(ts));
+    m_torrentAdded(status);
+
+    return status.info_hashes;
+}
+
+void SimulatedSession::ApplySettings(const lt::settings_pack& settings)
+{
+    m_settings = settings;
+}
+
+void SimulatedSession::Pause()
+{
+    m_paused = true;
+}
+
+void SimulatedSession::Recheck(const lt::info_hash_t& hash)
+{
+    auto status = m_statuses.find(hash);
+
+    if (status == m_statuses.end())
+    {
+        return;
+    }
+
+    status->second.state = lt::torrent_status::checking_files;
+    m_stateUpdate({ status->second });
+}
+
+void SimulatedSession::Remove(const lt::info_hash_t& hash, bool remove_data)
+{
+    if (m_statuses.erase(hash) == 0)
+    {
+        return;
+    }
+
+    m_torrents.erase(hash);
+    std::erase(m_hashes, hash);
+
+    m_torrentRemoved(hash);
+}
+
+void SimulatedSession::Resume()
+{
+    m_paused = false;
+}
+
+lt::settings_pack SimulatedSession::Settings()
+{
+    return m_settings;
+}
+
+const porla::TorrentHandles& SimulatedSession::Torrents()
+{
+    return m_torrents;
+}
+
+const std::map<lt::info_hash_t, lt::torrent_status>& SimulatedSession::TorrentStatuses()
+{
+    return m_statuses;
+}
+
+void SimulatedSession::Schedule(boost::asio::deadline_timer& timer, int interval, void (SimulatedSession::*tick)())
+{
+    if (interval <= 0)
+    {
+        return;
+    }
+
+    timer.expires_from_now(boost::posix_time::milliseconds(interval));
+    timer.async_wait(
+        [this, &timer, interval, tick](boost::system::error_code ec)
+        {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+
+            (this->*tick)();
+            Schedule(timer, interval, tick);
+        });
+}
+
+void SimulatedSession::PostSessionStats()
+{
+    std::int64_t download_rate = 0;
+    std::int64_t upload_rate = 0;
+    std::int64_t downloading = 0;
+    std::int64_t seeding = 0;
+
+    for (const auto& [_, ts] : m_statuses)
+    {
+        download_rate += ts.download_rate;
+        upload_rate   += ts.upload_rate;
+
+        if (ts.state == lt::torrent_status::downloading) downloading++;
+        if (ts.state == lt::torrent_status::seeding)     seeding++;
+    }
+
+    m_sessionStats({
+        {"net.recv_bytes",                download_rate},
+        {"net.sent_bytes",                upload_rate},
+        {"ses.num_downloading_torrents",  downloading},
+        {"ses.num_seeding_torrents",      seeding},
+        {"ses.num_total_torrents",        static_cast<std::int64_t>(m_statuses.size())}
+    });
+}
+
+void SimulatedSession::PostTorrentUpdates()
+{
+    if (m_paused || m_hashes.empty())
+    {
+        return;
+    }
+
+    const double seconds = m_options.timer_torrent_updates / 1000.0;
+
+    m_update_carry += m_options.update_rate * seconds;
+    m_finish_carry += m_options.finish_rate * seconds;
+
+    const auto updates = static_cast<std::size_t>(m_update_carry);
+    m_update_carry -= static_cast<double>(updates);
+
+    std::uniform_int_distribution<int> rate(0, MaxRate);
+    std::uniform_real_distribution<float> step(0.f, 0.05f);
+
+    std::map<lt::info_hash_t, lt::torrent_status*> changed;
+
+    for (std::size_t i = 0; i < std::min(updates, m_hashes.size()); i++)
+    {
+        auto& ts = RandomStatus();
+
+        ts.upload_rate      = rate(m_rng) / 4;
+        ts.all_time_upload += ts.upload_rate;
+
+        if (ts.state == lt::torrent_status::checking_files)
+        {
+            ts.state = ts.progress < 1.f ? lt::torrent_status::downloading : lt::torrent_status::seeding;
+        }
+
+        // Never finish here, so finish events follow the configured rate.
+        if (ts.state == lt::torrent_status::downloading)
+        {
+            ts.download_rate      = rate(m_rng);
+            ts.progress           = std::min(0.999f, ts.progress + step(m_rng));
+            ts.total_done         = static_cast<std::int64_t>(ts.total * ts.progress);
+            ts.all_time_download += ts.download_rate;
+        }
+
+        changed.insert_or_assign(ts.info_hashes, &ts);
+    }
+
+    // Random picks are cheap, so look for a torrent in a given state by sampling.
+    const auto sample = [this](lt::torrent_status::state_t state) -> lt::torrent_status*
+    {
+        for (int attempts = 0; attempts < 64; attempts++)
+        {
+            if (auto& ts = RandomStatus(); ts.state == state) { return &ts; }
+        }
+
+        return nullptr;
+    };
+
+    std::vector<lt::torrent_status*> finished;
+
+    for (; m_finish_carry >= 1; m_finish_carry -= 1)
+    {
+        auto ts = sample(lt::torrent_status::downloading);
+
+        if (ts == nullptr)
+        {
+            m_finish_carry = 0;
+            break;
+        }
+
+        ts->state         = lt::torrent_status::seeding;
+        ts->progress      = 1.f;
+        ts->total_done    = ts->total;
+        ts->download_rate = 0;
+        ts->is_finished   = true;
+        ts->is_seeding    = true;
+
+        finished.push_back(ts);
+        changed.insert_or_assign(ts->info_hashes, ts);
+
+        // Restart a seeding torrent for every one finished, so the mix of states stays stable.
+        if (auto restart = sample(lt::torrent_status::seeding); restart != nullptr && std::find(finished.begin(), finished.end(), restart) == finished.end())
+        {
+            restart->state       = lt::torrent_status::downloading;
+            restart->progress    = 0.f;
+            restart->total_done  = 0;
+            restart->is_finished = false;
+            restart->is_seeding  = false;
+
+            changed.insert_or_assign(restart->info_hashes, restart);
+        }
+    }
+
+    if (changed.empty())
+    {
+        return;
+    }
+
+    std::vector<lt::torrent_status> torrents;
+    torrents.reserve(changed.size());
+
+    for (const auto& [_, ts] : changed)
+    {
+        torrents.push_back(*ts);
+    }
+
+    // The status cache is already updated, as with the real session.
+    m_stateUpdate(torrents);
+
+    for (const auto ts : finished)
+    {
+        m_torrentFinished(*ts);
+    }
+}
+
+lt::torrent_status& SimulatedSession::Insert(lt::torrent_status ts)
+{
+    const auto hash = ts.info_hashes;
+
+    m_hashes.push_back(hash);
+    m_torrents.insert({ hash, lt::torrent_handle{} });
+
+    return m_statuses.insert_or_assign(hash, std::move(ts)).first->second;
+}
+
+lt::info_hash_t SimulatedSession::RandomHash()
+{
+    lt::sha1_hash hash;
+
+    for (auto& b : hash) { b = static_cast<std::uint8_t>(m_rng()); }
+
+    return lt::info_hash_t(hash);
+}
+
+lt::torrent_status& SimulatedSession::RandomStatus()
+{
+    std::uniform_int_distribution<std::size_t> pick(0, m_hashes.size() - 1);
+    return m_statuses.at(m_hashes[pick(m_rng)]);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <random>
+
+#include "session.hpp"
+
+namespace porla
+{
+    struct SimulatedSessionOptions
+    {
+        int          finish_rate           = 1;      // finished torrents per second
+        unsigned int seed                  = 1337;
+        int          timer_session_stats   = 5000;
+        int          timer_torrent_updates = 1000;
+        int          torrents              = 100000;
+        int          update_rate           = 10000;  // changed torrents per second
+    };
+
+    // A session without libtorrent. Generates a fleet of synthetic torrents whose rates and
+    // states evolve on a timer, and emits the same signals as the real session, so the HTTP,
+    // JSON-RPC and SSE stack can be load tested without any swarms.
+    //
+    // The torrents have no handles, so methods that operate on a handle will fail.
+    class SimulatedSession : public ISession
+    {
+    public:
+        explicit SimulatedSession(boost::asio::io_context& io, SimulatedSessionOptions const& options);
+
+        SimulatedSession(const SimulatedSession&) = delete;
+        SimulatedSession& operator=(const SimulatedSession&) = delete;
+
+        ~SimulatedSession() override;
+
+        porla::Utils::Connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) override
+        {
+            return m_sessionStats.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) override
+        {
+            return m_stateUpdate.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_storageMoved.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_storageMovedFailed.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) override
+        {
+            return m_torrentAdded.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentChecked(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentChecked.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) override
+        {
+            return m_torrentFinished.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentMediaInfo.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentPaused.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) override
+        {
+            return m_torrentRemoved.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) override
+        {
+            return m_torrentResumed.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) override
+        {
+            return m_torrentTrackerError.connect(subscriber);
+        }
+
+        porla::Utils::Connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) override
+        {
+            return m_torrentTrackerReply.connect(subscriber);
+        }
+
+        // Generates the initial fleet and starts the timers.
+        void Load();
+
+        libtorrent::info_hash_t AddTorrent(libtorrent::add_torrent_params const& p) override;
+        void ApplySettings(const libtorrent::settings_pack& settings) override;
+        void Pause() override;
+        void Recheck(const lt::info_hash_t& hash) override;
+        void Remove(const lt::info_hash_t& hash, bool remove_data) override;
+        void Resume() override;
+        libtorrent::settings_pack Settings() override;
+        const TorrentHandles& Torrents() override;
+        const std::map<lt::info_hash_t, lt::torrent_status>& TorrentStatuses() override;
+
+    private:
+        void Schedule(boost::asio::deadline_timer& timer, int interval, void (SimulatedSession::*tick)());
+        void PostSessionStats();
+        void PostTorrentUpdates();
+
+        libtorrent::torrent_status& Insert(libtorrent::torrent_status ts);
+        libtorrent::info_hash_t RandomHash();
+        libtorrent::torrent_status& RandomStatus();
+
+        SimulatedSessionOptions m_options;
+        std::mt19937 m_rng;
+        bool m_paused;
+
+        boost::asio::deadline_timer m_sessionStatsTimer;
+        boost::asio::deadline_timer m_torrentUpdatesTimer;
+
+        // Fractional events carried over between ticks, so low rates still fire.
+        double m_finish_carry;
+        double m_update_carry;
+
+        SessionStatsSignal m_sessionStats;
+        TorrentStatusListSignal m_stateUpdate;
+        TorrentHandleSignal m_storageMoved;
+        TorrentHandleSignal m_storageMovedFailed;
+        TorrentStatusSignal m_torrentAdded;
+        TorrentHandleSignal m_torrentChecked;
+        TorrentStatusSignal m_torrentFinished;
+        TorrentHandleSignal m_torrentMediaInfo;
+        TorrentHandleSignal m_torrentPaused;
+        InfoHashSignal m_torrentRemoved;
+        TorrentStatusSignal m_torrentResumed;
+        TrackerErrorSignal m_torrentTrackerError;
+        TorrentHandleSignal m_torrentTrackerReply;
+
+        libtorrent::settings_pack m_settings;
+        TorrentHandles m_torrents;
+        std::map<libtorrent::info_hash_t, libtorrent::torrent_status> m_statuses;
+
+        // Hashes in a flat vector so random picks do not walk the map.
+        std::vector<libtorrent::info_hash_t> m_hashes;
+    };
+}
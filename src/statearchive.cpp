@@ -0,0 +1,134 @@
+#include "statearchive.hpp"
+
+#include <cstdint>
+#include <iterator>
+
+#include <libtorrent/bdecode.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/read_resume_data.hpp>
+#include <libtorrent/write_resume_data.hpp>
+#include <nlohmann/json.hpp>
+
+#include "json/torrentclientdata.hpp"
+#include "torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using porla::StateArchive;
+
+static constexpr std::string_view ClientDataKey = "porla_client_data";
+static constexpr std::string_view MetadataKey   = "porla_metadata";
+
+void StateArchive::Write(const lt::add_torrent_params& params, std::string& out, const Metadata& metadata)
+{
+    lt::entry resume = lt::write_resume_data(params);
+
+    if (const auto client_data = params.userdata.get<TorrentClientData>())
+    {
+        std::string cbor;
+        json::to_cbor(json(*client_data), cbor);
+        resume[ClientDataKey] = std::move(cbor);
+    }
+
+    if (!metadata.empty())
+    {
+        std::string cbor;
+        json::to_cbor(json(metadata), cbor);
+        resume[MetadataKey] = std::move(cbor);
+    }
+
+    // The length is filled in once the record is encoded in place.
+    const std::size_t start = out.size();
+    out.append(4, '\0');
+
+    lt::bencode(std::back_inserter(out), resume);
+
+    const auto size = static_cast<std::uint32_t>(out.size() - start - 4);
+
+    for (int i = 0; i < 4; i++)
+    {
+        out[start + i] = static_cast<char>((size >> (8 * i)) & 0xff);
+    }
+}
+
+std::optional<std::string> StateArchive::Read(
+    std::string_view buf,
+    const std::function<void(lt::add_torrent_params&&, Metadata&&)>& cb)
+{
+    std::size_t pos = 0;
+
+    while (pos < buf.size())
+    {
+        if (buf.size() - pos < 4)
+        {
+            return "Truncated record length at offset " + std::to_string(pos);
+        }
+
+        std::uint32_t size = 0;
+
+        for (int i = 0; i < 4; i++)
+        {
+            size |= static_cast<std::uint32_t>(static_cast<unsigned char>(buf[pos + i])) << (8 * i);
+        }
+
+        pos += 4;
+
+        if (buf.size() - pos < size)
+        {
+            return "Truncated record at offset " + std::to_string(pos - 4);
+        }
+
+        lt::error_code ec;
+        const lt::bdecode_node node = lt::bdecode({ buf.data() + pos, static_cast<std::ptrdiff_t>(size) }, ec);
+
+        if (ec)
+        {
+            return "Failed to decode record at offset " + std::to_string(pos - 4) + ": " + ec.message();
+        }
+
+        lt::add_torrent_params params = lt::read_resume_data(node, ec);
+
+        if (ec)
+        {
+            return "Failed to read resume data at offset " + std::to_string(pos - 4) + ": " + ec.message();
+        }
+
+        auto client_data = new TorrentClientData();
+        params.userdata = lt::client_data_t(client_data);
+
+        if (const auto cbor = node.dict_find_string_value(ClientDataKey); !cbor.empty())
+        {
+            try
+            {
+                json::from_cbor(cbor.begin(), cbor.end()).get_to(*client_data);
+            }
+            catch (const std::exception& ex)
+            {
+                delete client_data;
+                return "Failed to read client data at offset " + std::to_string(pos - 4) + ": " + ex.what();
+            }
+        }
+
+        Metadata metadata;
+
+        if (const auto cbor = node.dict_find_string_value(MetadataKey); !cbor.empty())
+        {
+            try
+            {
+                json::from_cbor(cbor.begin(), cbor.end()).get_to(metadata);
+            }
+            catch (const std::exception& ex)
+            {
+                delete client_data;
+                return "Failed to read metadata at offset " + std::to_string(pos - 4) + ": " + ex.what();
+            }
+        }
+
+        pos += size;
+
+        cb(std::move(params), std::move(metadata));
+    }
+
+    return std::nullopt;
+}
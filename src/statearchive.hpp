@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <libtorrent/add_torrent_params.hpp>
+#include <nlohmann/json.hpp>
+
+namespace porla
+{
+    // Torrents moved between nodes, as a series of records. Each record is a little endian
+    // 32-bit length followed by the torrent's bencoded resume file, which has the info dict
+    // and carries the client data and metadata as CBOR. Records are independent, so an archive can be
+    // split on any record boundary and imported in parts.
+    class StateArchive
+    {
+    public:
+        typedef std::map<std::string, nlohmann::json> Metadata;
+
+        // Appends the record for a torrent, with the client data in its userdata, if any.
+        static void Write(const libtorrent::add_torrent_params& params, std::string& out, const Metadata& metadata = {});
+
+        // Calls cb with the params and metadata of every record, with their client data
+        // allocated in userdata. Returns an error if a record is truncated or fails to decode, after
+        // calling cb for the records before it.
+        static std::optional<std::string> Read(
+            std::string_view buf,
+            const std::function<void(libtorrent::add_torrent_params&&, Metadata&&)>& cb);
+    };
+}
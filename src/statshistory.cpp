@@ -0,0 +1,206 @@
+#include "statshistory.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/session_stats.hpp>
+
+#include "session.hpp"
+
+using porla::StatsHistory;
+
+const std::vector<StatsHistory::Tier> StatsHistory::DefaultTiers = {
+    { 1,    600 },
+    { 60,   1440 },
+    { 3600, 720 }
+};
+
+const std::vector<std::string> StatsHistory::DefaultMetrics = {
+    "dht.dht_nodes",
+    "disk.queued_disk_jobs",
+    "net.recv_bytes",
+    "net.recv_payload_bytes",
+    "net.sent_bytes",
+    "net.sent_payload_bytes",
+    "peer.num_peers_connected",
+    "ses.num_downloading_torrents",
+    "ses.num_seeding_torrents"
+};
+
+StatsHistory::StatsHistory(ISession& session, const std::vector<std::string>& metrics, std::vector<Tier> tiers)
+    : m_last(-1)
+{
+    std::map<std::string, lt::metric_type_t> known;
+
+    for (const auto& metric : lt::session_stats_metrics())
+    {
+        known.insert({ metric.name, metric.type });
+    }
+
+    for (const auto& metric : metrics)
+    {
+        const auto type = known.find(metric);
+
+        if (type == known.end())
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Unknown session stats metric '" << metric << "' not kept in history";
+            continue;
+        }
+
+        m_metrics.push_back(metric);
+        m_counter.push_back(type->second == lt::metric_type_t::counter);
+    }
+
+    for (const auto& tier : tiers)
+    {
+        m_series.push_back(Series{
+            .tier    = tier,
+            .slots   = std::vector<std::int64_t>(tier.capacity, -1),
+            .samples = std::vector<std::uint32_t>(tier.capacity, 0),
+            .values  = std::vector<double>(tier.capacity * m_metrics.size(), 0)
+        });
+    }
+
+    m_sessionStatsConnection = session.OnSessionStats(
+        [this](const auto& stats) { Record(std::time(nullptr), stats); });
+}
+
+StatsHistory::~StatsHistory()
+{
+    m_sessionStatsConnection.disconnect();
+}
+
+porla::MemoryUsage StatsHistory::Memory() const
+{
+    MemoryUsage usage{ .objects = m_series.size() };
+
+    for (const auto& series : m_series)
+    {
+        usage.bytes += series.slots.capacity() * sizeof(std::int64_t)
+            + series.samples.capacity() * sizeof(std::uint32_t)
+            + series.values.capacity() * sizeof(double);
+    }
+
+    return usage;
+}
+
+std::optional<StatsHistory::Range> StatsHistory::Query(
+    const std::vector<std::string>& metrics,
+    std::int64_t from,
+    std::int64_t to,
+    std::optional<int> resolution) const
+{
+    if (m_series.empty())
+    {
+        return std::nullopt;
+    }
+
+    const Series* series = nullptr;
+
+    for (const auto& s : m_series)
+    {
+        if (resolution.has_value())
+        {
+            if (s.tier.resolution == *resolution) { series = &s; break; }
+            continue;
+        }
+
+        const std::int64_t oldest = (m_last / s.tier.resolution - static_cast<std::int64_t>(s.tier.capacity) + 1) * s.tier.resolution;
+
+        series = &s;
+
+        if (oldest <= from)
+        {
+            break;
+        }
+    }
+
+    if (series == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    const std::int64_t res      = series->tier.resolution;
+    const auto         capacity = static_cast<std::int64_t>(series->tier.capacity);
+
+    const std::int64_t last  = std::min(to, m_last) / res;
+    const std::int64_t first = std::max(from / res, m_last / res - capacity + 1);
+
+    Range range{ .start = first * res, .resolution = static_cast<int>(res) };
+
+    for (const auto& metric : metrics)
+    {
+        const auto it = std::find(m_metrics.begin(), m_metrics.end(), metric);
+
+        if (it == m_metrics.end())
+        {
+            continue;
+        }
+
+        const auto index = static_cast<std::size_t>(it - m_metrics.begin());
+
+        auto& values = range.values[metric];
+        values.reserve(static_cast<std::size_t>(std::max<std::int64_t>(0, last - first + 1)));
+
+        for (std::int64_t bucket = first; bucket <= last; bucket++)
+        {
+            const auto slot = static_cast<std::size_t>(bucket % capacity);
+
+            if (series->slots[slot] == bucket)
+            {
+                values.emplace_back(series->values[slot * m_metrics.size() + index]);
+            }
+            else
+            {
+                values.emplace_back(std::nullopt);
+            }
+        }
+    }
+
+    return range;
+}
+
+void StatsHistory::Record(std::int64_t now, const porla::SessionMetrics& stats)
+{
+    // The wall clock can step back, but slots are only ever written forward.
+    if (now < m_last || now < 0)
+    {
+        return;
+    }
+
+    m_last = now;
+
+    for (auto& series : m_series)
+    {
+        const std::int64_t bucket = now / series.tier.resolution;
+        const auto         slot   = static_cast<std::size_t>(bucket % static_cast<std::int64_t>(series.tier.capacity));
+
+        if (series.slots[slot] != bucket)
+        {
+            series.slots[slot]   = bucket;
+            series.samples[slot] = 0;
+
+            std::fill_n(series.values.begin() + static_cast<std::ptrdiff_t>(slot * m_metrics.size()), m_metrics.size(), 0);
+        }
+
+        const auto n = ++series.samples[slot];
+
+        for (std::size_t i = 0; i < m_metrics.size(); i++)
+        {
+            const auto stat = stats.Get(m_metrics[i]);
+
+            if (!stat)
+            {
+                continue;
+            }
+
+            auto& value = series.values[slot * m_metrics.size() + i];
+            const auto sample = static_cast<double>(*stat);
+
+            value = m_counter[i] || n == 1
+                ? sample
+                : value + (sample - value) / n;
+        }
+    }
+}
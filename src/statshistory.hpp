@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "memoryusage.hpp"
+#include "sessionmetrics.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Keeps a fixed-memory history of selected session stats at a few resolutions, so
+    // graphs can be drawn without polling. Counters keep the last value seen in each slot,
+    // gauges the mean of every sample in it.
+    class StatsHistory
+    {
+    public:
+        struct Tier
+        {
+            int         resolution; // seconds
+            std::size_t capacity;   // slots
+        };
+
+        // 1s for 10 minutes, 1m for 24 hours and 1h for 30 days.
+        static const std::vector<Tier> DefaultTiers;
+        static const std::vector<std::string> DefaultMetrics;
+
+        // Values for consecutive slots from start. Slots without samples are empty.
+        struct Range
+        {
+            std::int64_t start;
+            int          resolution;
+            std::map<std::string, std::vector<std::optional<double>>> values;
+        };
+
+        explicit StatsHistory(
+            ISession& session,
+            const std::vector<std::string>& metrics = DefaultMetrics,
+            std::vector<Tier> tiers = DefaultTiers);
+
+        StatsHistory(const StatsHistory&) = delete;
+
+        ~StatsHistory();
+
+        [[nodiscard]] const std::vector<std::string>& Metrics() const { return m_metrics; }
+
+        // All of it is allocated up front, with one object per tier.
+        [[nodiscard]] MemoryUsage Memory() const;
+
+        // Picks the finest tier that still covers from, unless a resolution is given. Unknown
+        // metrics are left out of the result.
+        [[nodiscard]] std::optional<Range> Query(
+            const std::vector<std::string>& metrics,
+            std::int64_t from,
+            std::int64_t to,
+            std::optional<int> resolution = std::nullopt) const;
+
+        void Record(std::int64_t now, const SessionMetrics& stats);
+
+    private:
+        struct Series
+        {
+            Tier                       tier;
+            std::vector<std::int64_t>  slots;   // the bucket each slot holds, or -1
+            std::vector<std::uint32_t> samples;
+            std::vector<double>        values;  // capacity * metric count, slot major
+        };
+
+        std::vector<std::string> m_metrics;
+        std::vector<bool> m_counter;
+        std::vector<Series> m_series;
+        std::int64_t m_last;
+
+        porla::Utils::Connection m_sessionStatsConnection;
+    };
+}
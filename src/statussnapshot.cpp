@@ -0,0 +1,367 @@
+#include "statussnapshot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+
+#include <boost/log/trivial.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using porla::StatusSnapshot;
+
+// Room is made for more than is needed, so the file is not grown for every torrent added.
+static constexpr std::size_t MinRecords = 64;
+static constexpr std::size_t MinStrings = 16 * 1024;
+
+static std::int64_t NowMillis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::optional<StatusSnapshot::Copy> StatusSnapshot::Read(const std::filesystem::path& path)
+{
+    // A writer is never odd for long, so a reader giving up after this many tries
+    // means the file is broken or not a snapshot.
+    static constexpr int MaxAttempts = 1000;
+
+    const int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    void* map = MAP_FAILED;
+    std::size_t size = 0;
+    std::optional<Copy> result;
+
+    for (int attempt = 0; attempt < MaxAttempts && !result.has_value(); attempt++)
+    {
+        struct stat st{};
+
+        if (map == MAP_FAILED)
+        {
+            if (fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) break;
+
+            size = static_cast<std::size_t>(st.st_size);
+            map  = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+            if (map == MAP_FAILED) break;
+        }
+
+        const auto* header = static_cast<const Header*>(map);
+        const auto* base   = static_cast<const char*>(map);
+
+        const std::uint64_t before = header->sequence.load(std::memory_order_acquire);
+
+        if (before % 2 == 1 || std::memcmp(header->magic, Magic, sizeof(Magic)) != 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // The writer grew the file since it was mapped.
+        if (header->file_size > size)
+        {
+            munmap(map, size);
+            map = MAP_FAILED;
+            continue;
+        }
+
+        const std::uint64_t count          = header->count;
+        const std::uint64_t strings_offset = header->strings_offset;
+        const std::uint64_t strings_size   = header->strings_size;
+
+        Copy copy{ .sequence = before };
+
+        if (sizeof(Header) + count * sizeof(Record) <= size && strings_offset + strings_size <= size)
+        {
+            const auto* records = reinterpret_cast<const Record*>(base + sizeof(Header));
+            copy.records.assign(records, records + count);
+            copy.strings.assign(base + strings_offset, strings_size);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (header->sequence.load(std::memory_order_relaxed) == before)
+        {
+            result = std::move(copy);
+        }
+    }
+
+    if (map != MAP_FAILED) munmap(map, size);
+    close(fd);
+
+    return result;
+}
+
+StatusSnapshot::StatusSnapshot(porla::ISession& session, StatusSnapshotOptions options)
+    : m_session(session)
+    , m_options(std::move(options))
+{
+    m_addedConnection       = m_session.OnTorrentAdded([this](auto const&) { m_dirty = true; });
+    m_removedConnection     = m_session.OnTorrentRemoved([this](auto const&) { m_dirty = true; });
+    m_stateUpdateConnection = m_session.OnStateUpdate([this](auto const& torrents) { OnStateUpdate(torrents); });
+
+    Rebuild();
+}
+
+StatusSnapshot::~StatusSnapshot()
+{
+    m_addedConnection.disconnect();
+    m_removedConnection.disconnect();
+    m_stateUpdateConnection.disconnect();
+
+    if (m_map != nullptr) munmap(m_map, m_size);
+
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+
+        // Readers which still have it mapped keep the last snapshot, and new readers
+        // find no file instead of a stale one.
+        unlink(m_options.path.c_str());
+    }
+}
+
+void StatusSnapshot::Begin()
+{
+    Head()->sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void StatusSnapshot::End()
+{
+    Head()->updated_at = NowMillis();
+    Head()->sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool StatusSnapshot::Grow(std::size_t records, std::size_t strings)
+{
+    if (m_map != nullptr && Head()->capacity >= records && m_stringsCapacity >= strings)
+    {
+        return true;
+    }
+
+    const std::size_t capacity = std::max({ MinRecords, records + records / 2, m_map != nullptr ? static_cast<std::size_t>(Head()->capacity) : 0 });
+    const std::size_t strings_capacity = std::max({ MinStrings, strings * 2, m_stringsCapacity });
+    const std::size_t size = sizeof(Header) + capacity * sizeof(Record) + strings_capacity;
+
+    if (m_fd < 0)
+    {
+        m_fd = open(m_options.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+        if (m_fd < 0)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Failed to open status snapshot " << m_options.path << ": " << std::strerror(errno);
+            return false;
+        }
+    }
+
+    if (ftruncate(m_fd, static_cast<off_t>(size)) < 0)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to grow status snapshot to " << size << " bytes: " << std::strerror(errno);
+        return false;
+    }
+
+    void* map = m_map == nullptr
+        ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)
+        : mremap(m_map, m_size, size, MREMAP_MAYMOVE);
+
+    if (map == MAP_FAILED)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to map status snapshot: " << std::strerror(errno);
+        return false;
+    }
+
+    m_map  = map;
+    m_size = size;
+    m_stringsCapacity = strings_capacity;
+
+    auto* header = Head();
+    std::memcpy(header->magic, Magic, sizeof(Magic));
+    header->version        = Version;
+    header->record_size    = sizeof(Record);
+    header->file_size      = size;
+    header->capacity       = capacity;
+    header->strings_offset = sizeof(Header) + capacity * sizeof(Record);
+
+    // The strings moved, so every record points at the wrong place until written again.
+    m_interned.clear();
+    header->strings_size = 0;
+
+    return true;
+}
+
+std::optional<std::pair<std::uint32_t, std::uint32_t>> StatusSnapshot::Intern(std::string_view value)
+{
+    if (value.empty())
+    {
+        return std::pair<std::uint32_t, std::uint32_t>{ 0, 0 };
+    }
+
+    if (const auto interned = m_interned.find(std::string(value)); interned != m_interned.end())
+    {
+        return interned->second;
+    }
+
+    auto* header = Head();
+
+    if (header->strings_size + value.size() > m_stringsCapacity)
+    {
+        return std::nullopt;
+    }
+
+    const std::pair<std::uint32_t, std::uint32_t> location{
+        static_cast<std::uint32_t>(header->strings_size),
+        static_cast<std::uint32_t>(value.size())
+    };
+
+    std::memcpy(static_cast<char*>(m_map) + header->strings_offset + header->strings_size, value.data(), value.size());
+    header->strings_size += value.size();
+
+    m_interned.insert({ std::string(value), location });
+
+    return location;
+}
+
+bool StatusSnapshot::Fill(Record& record, const lt::torrent_status& ts)
+{
+    const auto* client_data = m_session.ClientData(ts);
+
+    const auto name      = Intern(ts.name);
+    const auto save_path = Intern(ts.save_path);
+    const auto category  = Intern(client_data != nullptr && client_data->category.has_value()
+        ? std::string_view(client_data->category->str())
+        : std::string_view());
+
+    if (!name || !save_path || !category)
+    {
+        return false;
+    }
+
+    std::uint8_t flags = 0;
+
+    if (ts.flags & lt::torrent_flags::paused)       flags |= Paused;
+    if (ts.flags & lt::torrent_flags::auto_managed) flags |= AutoManaged;
+    if (ts.is_seeding)                              flags |= Seeding;
+    if (ts.is_finished)                             flags |= Finished;
+    if (ts.errc)                                    flags |= Errored;
+    if (ts.info_hashes.has_v1())                    flags |= HasV1;
+    if (ts.info_hashes.has_v2())                    flags |= HasV2;
+
+    std::memcpy(record.v1, ts.info_hashes.v1.data(), sizeof(record.v1));
+    std::memcpy(record.v2, ts.info_hashes.v2.data(), sizeof(record.v2));
+
+    record.flags             = flags;
+    record.state             = static_cast<std::uint8_t>(ts.state);
+    record.progress          = ts.progress;
+    record.download_rate     = ts.download_payload_rate;
+    record.upload_rate       = ts.upload_payload_rate;
+    record.num_peers         = ts.num_peers;
+    record.num_seeds         = ts.num_seeds;
+    record.queue_position    = static_cast<std::int32_t>(ts.queue_position);
+    record.total_done        = ts.total_done;
+    record.total_wanted      = ts.total_wanted;
+    record.all_time_download = ts.all_time_download;
+    record.all_time_upload   = ts.all_time_upload;
+    record.active_duration   = std::chrono::duration_cast<std::chrono::seconds>(ts.active_duration).count();
+    record.seeding_duration  = std::chrono::duration_cast<std::chrono::seconds>(ts.seeding_duration).count();
+    std::tie(record.name_offset, record.name_size)           = *name;
+    std::tie(record.save_path_offset, record.save_path_size) = *save_path;
+    std::tie(record.category_offset, record.category_size)   = *category;
+
+    return true;
+}
+
+// Only the torrents in the update are written, in place. Adding or removing torrents
+// moves the records, so the whole file is written again.
+void StatusSnapshot::OnStateUpdate(const std::vector<lt::torrent_status>& torrents)
+{
+    if (m_map == nullptr || m_dirty)
+    {
+        return Rebuild();
+    }
+
+    Begin();
+
+    for (const auto& ts : torrents)
+    {
+        const auto slot = m_slots.find(ts.info_hashes);
+
+        if (slot == m_slots.end() || !Fill(Records()[slot->second], ts))
+        {
+            WriteAll();
+            break;
+        }
+    }
+
+    End();
+}
+
+void StatusSnapshot::Rebuild()
+{
+    if (m_map == nullptr && !Grow(m_session.TorrentStatuses().size(), 0))
+    {
+        return;
+    }
+
+    Begin();
+    WriteAll();
+    End();
+}
+
+void StatusSnapshot::WriteAll()
+{
+    const auto& statuses = m_session.TorrentStatuses();
+
+    std::size_t strings = 0;
+    std::unordered_set<std::string_view> seen;
+
+    for (const auto& [hash, ts] : statuses)
+    {
+        const auto* client_data = m_session.ClientData(ts);
+
+        for (const std::string_view value : {
+            std::string_view(ts.name),
+            std::string_view(ts.save_path),
+            client_data != nullptr && client_data->category.has_value() ? std::string_view(client_data->category->str()) : std::string_view() })
+        {
+            if (seen.insert(value).second) strings += value.size();
+        }
+    }
+
+    if (!Grow(statuses.size(), strings))
+    {
+        Head()->count = 0;
+        return;
+    }
+
+    m_interned.clear();
+    m_slots.clear();
+    Head()->strings_size = 0;
+
+    std::size_t index = 0;
+
+    for (const auto& [hash, ts] : statuses)
+    {
+        // The strings were counted, so they fit.
+        Fill(Records()[index], ts);
+        m_slots.insert({ hash, index });
+        index++;
+    }
+
+    Head()->count = index;
+    m_dirty = false;
+}
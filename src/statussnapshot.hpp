@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct StatusSnapshotOptions
+    {
+        // Best put on a tmpfs such as /dev/shm, so the pages are never written to disk.
+        std::filesystem::path path;
+    };
+
+    // Keeps the torrent statuses in a memory mapped file, so readers on the same host can
+    // map it and read them without a request. The file is the header, the records and the
+    // strings the records point into, in that order. Writers bump the sequence to an odd
+    // value before changing anything and to the next even value after, so a reader copies
+    // what it needs between two equal, even reads of the sequence. A reader whose mapping
+    // is smaller than file_size maps the file again. Updated on the io thread.
+    class StatusSnapshot
+    {
+    public:
+        static constexpr char          Magic[8] = {'P', 'O', 'R', 'L', 'A', 'S', 'T', 'S'};
+        static constexpr std::uint32_t Version  = 1;
+
+        enum Flags : std::uint8_t
+        {
+            Paused      = 1 << 0,
+            AutoManaged = 1 << 1,
+            Seeding     = 1 << 2,
+            Finished    = 1 << 3,
+            Errored     = 1 << 4,
+            HasV1       = 1 << 5,
+            HasV2       = 1 << 6
+        };
+
+        struct Header
+        {
+            char                       magic[8];
+            std::uint32_t              version;
+            std::uint32_t              record_size;
+            std::atomic<std::uint64_t> sequence;
+            std::uint64_t              file_size;
+            std::uint64_t              count;
+            std::uint64_t              capacity;
+            // Where the strings start, from the start of the file.
+            std::uint64_t              strings_offset;
+            std::uint64_t              strings_size;
+            // Unix time in milliseconds of the last update.
+            std::int64_t               updated_at;
+            std::uint64_t              reserved[7];
+        };
+
+        // Strings are offsets from strings_offset and sizes, and equal strings such as
+        // save paths are stored once.
+        struct Record
+        {
+            std::uint8_t  v1[20];
+            std::uint8_t  flags;
+            std::uint8_t  state;
+            std::uint8_t  reserved0[2];
+            std::uint8_t  v2[32];
+            float         progress;
+            std::int32_t  download_rate;
+            std::int32_t  upload_rate;
+            std::int32_t  num_peers;
+            std::int32_t  num_seeds;
+            std::int32_t  queue_position;
+            std::int64_t  total_done;
+            std::int64_t  total_wanted;
+            std::int64_t  all_time_download;
+            std::int64_t  all_time_upload;
+            std::int64_t  active_duration;
+            std::int64_t  seeding_duration;
+            std::uint32_t name_offset;
+            std::uint32_t name_size;
+            std::uint32_t save_path_offset;
+            std::uint32_t save_path_size;
+            std::uint32_t category_offset;
+            std::uint32_t category_size;
+            std::uint32_t reserved1[2];
+        };
+
+        static_assert(sizeof(Header) == 128);
+        static_assert(sizeof(Record) == 160);
+
+        // A consistent copy of a snapshot file, as a reader would take it.
+        struct Copy
+        {
+            std::uint64_t       sequence;
+            std::vector<Record> records;
+            std::string         strings;
+
+            [[nodiscard]] std::string_view String(std::uint32_t offset, std::uint32_t size) const
+            {
+                return std::string_view(strings).substr(offset, size);
+            }
+        };
+
+        static std::optional<Copy> Read(const std::filesystem::path& path);
+
+        explicit StatusSnapshot(ISession& session, StatusSnapshotOptions options);
+        StatusSnapshot(const StatusSnapshot&) = delete;
+
+        ~StatusSnapshot();
+
+    private:
+        void Begin();
+        void End();
+        // Maps the file with room for at least this many records and bytes of strings,
+        // moving the strings if the records outgrew their room.
+        bool Grow(std::size_t records, std::size_t strings);
+        // False if the strings do not fit, which a rebuild makes room for.
+        bool Fill(Record& record, const libtorrent::torrent_status& ts);
+        std::optional<std::pair<std::uint32_t, std::uint32_t>> Intern(std::string_view value);
+        void OnStateUpdate(const std::vector<libtorrent::torrent_status>& torrents);
+        void Rebuild();
+        // Writes every record and string again, between Begin and End.
+        void WriteAll();
+
+        Header* Head() const { return static_cast<Header*>(m_map); }
+        Record* Records() const { return reinterpret_cast<Record*>(static_cast<char*>(m_map) + sizeof(Header)); }
+
+        ISession& m_session;
+        StatusSnapshotOptions m_options;
+
+        int m_fd = -1;
+        void* m_map = nullptr;
+        std::size_t m_size = 0;
+        std::size_t m_stringsCapacity = 0;
+
+        std::map<libtorrent::info_hash_t, std::size_t> m_slots;
+        std::unordered_map<std::string, std::pair<std::uint32_t, std::uint32_t>> m_interned;
+        bool m_dirty = true;
+
+        porla::Utils::Connection m_addedConnection;
+        porla::Utils::Connection m_removedConnection;
+        porla::Utils::Connection m_stateUpdateConnection;
+    };
+}
@@ -0,0 +1,54 @@
+#include "symbol.hpp"
+
+#include <mutex>
+#include <set>
+
+using porla::Symbol;
+
+// Strings in a std::set are never moved, so pointers to them stay valid as it grows.
+static std::set<std::string, std::less<>>& Table()
+{
+    static std::set<std::string, std::less<>> table{ std::string() };
+    return table;
+}
+
+static std::mutex& TableMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+Symbol::Symbol()
+    : Symbol(Intern(std::string_view()))
+{
+}
+
+Symbol Symbol::Intern(std::string_view value)
+{
+    std::unique_lock lock(TableMutex());
+
+    auto& table = Table();
+    auto it = table.find(value);
+
+    if (it == table.end())
+    {
+        it = table.emplace(value).first;
+    }
+
+    return Symbol(&*it);
+}
+
+std::optional<Symbol> Symbol::Find(std::string_view value)
+{
+    std::unique_lock lock(TableMutex());
+
+    const auto& table = Table();
+    const auto it = table.find(value);
+
+    if (it == table.end())
+    {
+        return std::nullopt;
+    }
+
+    return Symbol(&*it);
+}
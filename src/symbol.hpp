@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace porla
+{
+    // An interned string. Equal strings share one process wide copy which lives for the
+    // rest of the process, so a symbol is a pointer which compares and hashes in constant
+    // time. Meant for the small sets of values shared by many torrents, like categories
+    // and tags, and not for anything unbounded.
+    class Symbol
+    {
+    public:
+        // The empty string.
+        Symbol();
+
+        explicit Symbol(std::string_view value) : Symbol(Intern(value)) {}
+
+        static Symbol Intern(std::string_view value);
+
+        // The symbol for a string which has already been interned. Lookups use this so
+        // that filtering on unknown values does not grow the table.
+        static std::optional<Symbol> Find(std::string_view value);
+
+        [[nodiscard]] const std::string& str() const { return *m_value; }
+
+        operator const std::string&() const { return *m_value; }
+
+        bool operator==(const Symbol& other) const { return m_value == other.m_value; }
+        bool operator==(std::string_view other) const { return *m_value == other; }
+
+        // Orders by identity, which is stable for the life of the process but unrelated
+        // to the order of the strings.
+        std::strong_ordering operator<=>(const Symbol& other) const
+        {
+            return std::compare_three_way{}(m_value, other.m_value);
+        }
+
+    private:
+        explicit Symbol(const std::string* value) : m_value(value) {}
+
+        const std::string* m_value;
+    };
+
+    // A set of symbols, kept as a sorted vector since torrents only have a few tags.
+    class SymbolSet
+    {
+    public:
+        typedef std::vector<Symbol>::const_iterator const_iterator;
+
+        SymbolSet() = default;
+
+        template<typename TRange>
+        explicit SymbolSet(const TRange& values)
+        {
+            m_symbols.reserve(std::size(values));
+            for (const auto& value : values) m_symbols.push_back(Symbol::Intern(value));
+            std::sort(m_symbols.begin(), m_symbols.end());
+            m_symbols.erase(std::unique(m_symbols.begin(), m_symbols.end()), m_symbols.end());
+        }
+
+        [[nodiscard]] const_iterator begin() const { return m_symbols.begin(); }
+        [[nodiscard]] const_iterator end() const { return m_symbols.end(); }
+
+        [[nodiscard]] bool empty() const { return m_symbols.empty(); }
+        [[nodiscard]] std::size_t size() const { return m_symbols.size(); }
+
+        [[nodiscard]] bool contains(const Symbol& symbol) const
+        {
+            return std::binary_search(m_symbols.begin(), m_symbols.end(), symbol);
+        }
+
+        // Compares the strings rather than interning the value.
+        [[nodiscard]] bool contains(std::string_view value) const
+        {
+            return std::find(m_symbols.begin(), m_symbols.end(), value) != m_symbols.end();
+        }
+
+        bool insert(const Symbol& symbol)
+        {
+            const auto it = std::lower_bound(m_symbols.begin(), m_symbols.end(), symbol);
+            if (it != m_symbols.end() && *it == symbol) return false;
+            m_symbols.insert(it, symbol);
+            return true;
+        }
+
+        bool operator==(const SymbolSet& other) const = default;
+
+    private:
+        std::vector<Symbol> m_symbols;
+    };
+}
+
+template<>
+struct std::hash<porla::Symbol>
+{
+    std::size_t operator()(const porla::Symbol& symbol) const noexcept
+    {
+        return std::hash<const void*>{}(&symbol.str());
+    }
+};
@@ -1,19 +1,26 @@
 #include "systemhandler.hpp"
 
 #include "data/models/users.hpp"
+#include "responsecache.hpp"
 
 using porla::SystemHandler;
 
-SystemHandler::SystemHandler(sqlite3* db)
+SystemHandler::SystemHandler(sqlite3* db, ResponseCache& cache)
     : m_db(db)
+    , m_cache(cache)
 {
 }
 
 void SystemHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
 {
-    auto any_users = porla::Data::Models::Users::Any(m_db);
+    ctx->Write(m_cache.Response(ctx->Request(), Key, [db = m_db]() { return Document(db); }));
+}
+
+nlohmann::json SystemHandler::Document(sqlite3* db)
+{
+    auto any_users = porla::Data::Models::Users::Any(db);
 
-    ctx->WriteJson({
+    return {
         {"status", any_users ? "ok" : "setup"}
-    });
+    };
 }
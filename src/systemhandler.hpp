@@ -2,17 +2,28 @@
 
 #include <sqlite3.h>
 
+#include <nlohmann/json.hpp>
+
 #include "httpcontext.hpp"
 
 namespace porla
 {
+    class ResponseCache;
+
+    // The status the UI asks for on every page load, served from the response cache.
+    // Whatever creates the first user invalidates Key.
     class SystemHandler
     {
     public:
-        explicit SystemHandler(sqlite3* db);
+        static constexpr const char* Key = "system";
+
+        explicit SystemHandler(sqlite3* db, ResponseCache& cache);
         void operator()(const std::shared_ptr<HttpContext>&);
 
+        static nlohmann::json Document(sqlite3* db);
+
     private:
         sqlite3* m_db;
+        ResponseCache& m_cache;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,243 @@
+#include "threadplacement.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+
+#include <boost/log/trivial.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "utils/string.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::ThreadPlacement;
+using porla::ThreadPlacementOptions;
+
+#ifdef __linux__
+static constexpr int MaxCpus = CPU_SETSIZE;
+#else
+static constexpr int MaxCpus = 1024;
+#endif
+
+#ifdef __linux__
+// From linux/mempolicy.h, which is not always installed.
+static constexpr int MpolDefault = 0;
+static constexpr int MpolLocal   = 4;
+
+static std::vector<int> CurrentCpus()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    std::vector<int> cpus;
+
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        return cpus;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &set)) { cpus.push_back(cpu); }
+    }
+
+    return cpus;
+}
+
+// The NUMA nodes the CPUs belong to, from the nodeN links sysfs has for each CPU.
+static std::set<int> NodesOf(const std::vector<int>& cpus)
+{
+    std::set<int> nodes;
+
+    for (const int cpu : cpus)
+    {
+        std::error_code ec;
+
+        for (const auto& entry : fs::directory_iterator("/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec))
+        {
+            const auto name = entry.path().filename().string();
+
+            if (name.size() > 4 && name.starts_with("node") && std::all_of(name.begin() + 4, name.end(), ::isdigit))
+            {
+                nodes.insert(std::stoi(name.substr(4)));
+            }
+        }
+    }
+
+    return nodes;
+}
+#endif
+
+ThreadPlacement::ThreadPlacement(const ThreadPlacementOptions& options)
+    : m_numa_local(options.numa_local)
+{
+    const std::pair<Role, const std::optional<std::string>&> roles[] =
+    {
+        { Role::Http,       options.http },
+        { Role::Io,         options.io },
+        { Role::Libtorrent, options.libtorrent },
+        { Role::Workers,    options.workers }
+    };
+
+    for (const auto& [role, list] : roles)
+    {
+        if (list.has_value() && !list->empty())
+        {
+            m_cpus.insert({ role, Parse(*list) });
+        }
+    }
+
+#ifdef __linux__
+    m_initial = CurrentCpus();
+#else
+    if (!m_cpus.empty())
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Thread placement is only supported on Linux";
+    }
+#endif
+}
+
+void ThreadPlacement::Place(Role role) const
+{
+#ifdef __linux__
+    // Nothing was ever moved, so there is nothing to undo either.
+    if (m_cpus.empty())
+    {
+        return;
+    }
+
+    const auto configured = m_cpus.find(role);
+
+    const auto& cpus = configured != m_cpus.end() ? configured->second : m_initial;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (const int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+
+    if (const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); err != 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to pin " << Name(role) << " thread to CPUs " << Format(cpus) << ": " << strerror(err);
+        return;
+    }
+
+    if (m_numa_local)
+    {
+        const int mode = configured != m_cpus.end() ? MpolLocal : MpolDefault;
+
+        if (syscall(SYS_set_mempolicy, mode, nullptr, 0) != 0)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to set the memory policy of the " << Name(role) << " thread: " << strerror(errno);
+        }
+    }
+#endif
+}
+
+void ThreadPlacement::Report() const
+{
+#ifdef __linux__
+    for (const auto& [role, cpus] : m_cpus)
+    {
+        const auto nodes = NodesOf(cpus);
+        std::string numa;
+
+        for (const int node : nodes)
+        {
+            numa += (numa.empty() ? "" : ",") + std::to_string(node);
+        }
+
+        BOOST_LOG_TRIVIAL(info) << "Placing " << Name(role) << " threads on CPUs " << Format(cpus)
+            << (numa.empty() ? "" : " (NUMA node " + numa + ")")
+            << (m_numa_local ? " with node-local memory" : "");
+    }
+#endif
+}
+
+std::vector<int> ThreadPlacement::Parse(const std::string& list)
+{
+    std::set<int> cpus;
+
+    const auto number = [&list](const std::string& text)
+    {
+        if (text.empty() || !std::all_of(text.begin(), text.end(), ::isdigit) || text.size() > 5)
+        {
+            throw std::invalid_argument("Invalid CPU list '" + list + "'");
+        }
+
+        return std::stoi(text);
+    };
+
+    for (auto item : porla::Utils::String::Split(list, ","))
+    {
+        std::erase(item, ' ');
+
+        const auto dash = item.find('-');
+
+        const int first = number(item.substr(0, dash));
+        const int last  = dash == std::string::npos ? first : number(item.substr(dash + 1));
+
+        if (last < first || last >= MaxCpus)
+        {
+            throw std::invalid_argument("Invalid CPU list '" + list + "'");
+        }
+
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.insert(cpu);
+        }
+    }
+
+    if (cpus.empty())
+    {
+        throw std::invalid_argument("Invalid CPU list '" + list + "'");
+    }
+
+    return { cpus.begin(), cpus.end() };
+}
+
+std::string ThreadPlacement::Format(const std::vector<int>& cpus)
+{
+    std::string result;
+
+    for (std::size_t i = 0; i < cpus.size(); i++)
+    {
+        std::size_t end = i;
+        while (end + 1 < cpus.size() && cpus[end + 1] == cpus[end] + 1) { end++; }
+
+        if (!result.empty()) { result += ","; }
+
+        result += std::to_string(cpus[i]);
+        if (end > i) { result += "-" + std::to_string(cpus[end]); }
+
+        i = end;
+    }
+
+    return result;
+}
+
+const char* ThreadPlacement::Name(Role role)
+{
+    switch (role)
+    {
+    case Role::Http:       return "HTTP";
+    case Role::Io:         return "io";
+    case Role::Libtorrent: return "libtorrent";
+    case Role::Workers:    return "worker";
+    }
+
+    return "unknown";
+}
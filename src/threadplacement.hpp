@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace porla
+{
+    struct ThreadPlacementOptions
+    {
+        // CPU lists like "0-3,8", for each kind of thread. Unset leaves it where the
+        // process started.
+        std::optional<std::string> http;
+        std::optional<std::string> io;
+        std::optional<std::string> libtorrent;
+        std::optional<std::string> workers;
+        // Prefers memory from the NUMA node a thread runs on, for pinned threads.
+        bool                       numa_local = false;
+    };
+
+    // Pins threads to the CPUs configured for their role. Only the calling thread can be
+    // placed, since the memory policy is per thread. libtorrent does not expose its
+    // threads, so the main thread is placed as libtorrent before the session is made and
+    // every thread it starts inherits that, and then as the io thread. Linux only, and a
+    // no-op elsewhere.
+    class ThreadPlacement
+    {
+    public:
+        enum class Role
+        {
+            Http,
+            Io,
+            Libtorrent,
+            Workers
+        };
+
+        // Throws std::invalid_argument for CPU lists that do not parse.
+        explicit ThreadPlacement(const ThreadPlacementOptions& options);
+
+        // Moves the calling thread to the CPUs for the role, or back to the ones the process
+        // started with if the role has none.
+        void Place(Role role) const;
+
+        // Logs the CPUs and NUMA nodes of every role that has them.
+        void Report() const;
+
+        // Parses "0-3,8,10-11" into sorted, unique CPU numbers.
+        static std::vector<int> Parse(const std::string& list);
+        static std::string Format(const std::vector<int>& cpus);
+
+    private:
+        static const char* Name(Role role);
+
+        std::map<Role, std::vector<int>> m_cpus;
+        std::vector<int> m_initial;
+        bool m_numa_local;
+    };
+}
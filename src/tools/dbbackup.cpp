@@ -0,0 +1,43 @@
+#include "dbbackup.hpp"
+
+#include "../config.hpp"
+#include "../data/backup.hpp"
+
+int porla::Tools::DbBackup(int argc, char **argv, std::unique_ptr<porla::Config> cfg)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s db:backup <path>\n", argv[0]);
+        return 1;
+    }
+
+    int last = -1;
+
+    const auto error = porla::Data::Backup::Run(
+        cfg->db_file.value_or("porla.sqlite"),
+        argv[2],
+        [&last](int remaining, int total)
+        {
+            const int percent = total > 0 ? (total - remaining) * 100 / total : 100;
+
+            if (percent != last)
+            {
+                fprintf(stderr, "\r%3d%% (%d/%d pages)", percent, total - remaining, total);
+                last = percent;
+            }
+
+            return true;
+        });
+
+    fprintf(stderr, "\n");
+
+    if (error.has_value())
+    {
+        fprintf(stderr, "Failed to back up database: %s\n", error->c_str());
+        return 1;
+    }
+
+    printf("%s\n", argv[2]);
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <memory>
+
+namespace porla { class Config; }
+
+namespace porla::Tools
+{
+    int DbBackup(int argc, char* argv[], std::unique_ptr<porla::Config> cfg);
+}
@@ -0,0 +1,126 @@
+#include "dbquery.hpp"
+
+#include <functional>
+
+#include <nlohmann/json.hpp>
+
+#include "../config.hpp"
+#include "../data/models/addtorrentparams.hpp"
+#include "../data/statement.hpp"
+#include "../json/ltinfohash.hpp"
+
+using json = nlohmann::json;
+
+using porla::Data::Models::AddTorrentParams;
+using porla::Data::Statement;
+
+// Runs read in one transaction on the read-only connection. In WAL mode the snapshot
+// is taken by the first read and holds until the commit, without blocking the writer.
+static int Read(const porla::Config& cfg, const std::function<json(sqlite3*)>& read)
+{
+    if (cfg.db == nullptr)
+    {
+        fprintf(stderr, "No database to read from: %s\n", cfg.db_file.value_or("porla.sqlite").c_str());
+        return 1;
+    }
+
+    if (sqlite3_exec(cfg.db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        fprintf(stderr, "Failed to begin transaction: %s\n", sqlite3_errmsg(cfg.db));
+        return 1;
+    }
+
+    json result;
+
+    try
+    {
+        result = read(cfg.db);
+    }
+    catch (const std::exception& ex)
+    {
+        sqlite3_exec(cfg.db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        fprintf(stderr, "Failed to read database: %s\n", ex.what());
+        return 1;
+    }
+
+    sqlite3_exec(cfg.db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    printf("%s\n", result.dump().c_str());
+
+    return 0;
+}
+
+static std::int64_t Scalar(sqlite3* db, const char* sql)
+{
+    std::int64_t value = 0;
+
+    Statement::Prepare(db, sql)
+        .Step([&value](const auto& row)
+        {
+            value = row.GetInt64(0);
+            return SQLITE_OK;
+        });
+
+    return value;
+}
+
+int porla::Tools::DbSettings(int argc, char **argv, std::unique_ptr<porla::Config> cfg)
+{
+    return Read(*cfg, [](sqlite3* db)
+    {
+        json settings = json::object();
+
+        Statement::Prepare(db, "SELECT key,value FROM sessionsettings ORDER BY key ASC")
+            .Step([&settings](const auto& row)
+            {
+                const auto key = row.GetStdString(0);
+                settings[key]  = json::parse(row.GetStdString(1), nullptr, false);
+                return SQLITE_OK;
+            });
+
+        return settings;
+    });
+}
+
+int porla::Tools::DbStats(int argc, char **argv, std::unique_ptr<porla::Config> cfg)
+{
+    return Read(*cfg, [](sqlite3* db)
+    {
+        const auto page_size = Scalar(db, "PRAGMA page_size;");
+
+        return json{
+            {"free_bytes",     Scalar(db, "PRAGMA freelist_count;") * page_size},
+            {"parked",         Scalar(db, "SELECT COUNT(*) FROM addtorrentparams WHERE parked = 1;")},
+            {"schema_version", Scalar(db, "PRAGMA user_version;")},
+            {"settings",       Scalar(db, "SELECT COUNT(*) FROM sessionsettings;")},
+            {"size_bytes",     Scalar(db, "PRAGMA page_count;") * page_size},
+            {"torrents",       Scalar(db, "SELECT COUNT(*) FROM addtorrentparams;")},
+            {"users",          Scalar(db, "SELECT COUNT(*) FROM users;")}
+        };
+    });
+}
+
+int porla::Tools::DbTorrents(int argc, char **argv, std::unique_ptr<porla::Config> cfg)
+{
+    return Read(*cfg, [](sqlite3* db)
+    {
+        json torrents = json::array();
+
+        // Only the columns which do not need decoding, leaving the resume data alone.
+        Statement::Prepare(db, "SELECT info_hash,name,save_path,queue_position,parked FROM addtorrentparams ORDER BY queue_position ASC")
+            .Step([&torrents](const auto& row)
+            {
+                torrents.push_back({
+                    {"info_hash",      AddTorrentParams::FromKey(row.GetBlob(0))},
+                    {"name",           row.GetStdString(1)},
+                    {"parked",         row.GetInt32(4) == 1},
+                    {"queue_position", row.GetInt32(3)},
+                    {"save_path",      row.GetStdString(2)}
+                });
+
+                return SQLITE_OK;
+            });
+
+        return torrents;
+    });
+}
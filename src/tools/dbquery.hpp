@@ -0,0 +1,15 @@
+#pragma once
+
+#include <memory>
+
+namespace porla { class Config; }
+
+namespace porla::Tools
+{
+    // Read the database of a running instance from a read-only connection, each in one
+    // read transaction, so the output is from one consistent snapshot while the daemon
+    // keeps writing. Printed as JSON.
+    int DbSettings(int argc, char* argv[], std::unique_ptr<porla::Config> cfg);
+    int DbStats(int argc, char* argv[], std::unique_ptr<porla::Config> cfg);
+    int DbTorrents(int argc, char* argv[], std::unique_ptr<porla::Config> cfg);
+}
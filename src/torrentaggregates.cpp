@@ -0,0 +1,212 @@
+#include "torrentaggregates.hpp"
+
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+#include "utils/ratio.hpp"
+#include "utils/string.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentAggregates;
+
+static const std::string Other = "other";
+
+std::string TorrentAggregates::StateName(const lt::torrent_status& ts)
+{
+    if ((ts.flags & lt::torrent_flags::paused) == lt::torrent_flags::paused)
+    {
+        return "paused";
+    }
+
+    switch (ts.state)
+    {
+    case lt::torrent_status::checking_files:       return "checking_files";
+    case lt::torrent_status::downloading_metadata: return "downloading_metadata";
+    case lt::torrent_status::downloading:          return "downloading";
+    case lt::torrent_status::finished:             return "finished";
+    case lt::torrent_status::seeding:              return "seeding";
+    case lt::torrent_status::checking_resume_data: return "checking_resume_data";
+    }
+
+    return "unknown";
+}
+
+static void Apply(TorrentAggregates::Values& target, const TorrentAggregates::Values& values, int sign)
+{
+    target.count         += sign * values.count;
+    target.download_rate += sign * values.download_rate;
+    target.upload_rate   += sign * values.upload_rate;
+    target.size          += sign * values.size;
+    target.ratio_sum     += sign * values.ratio_sum;
+
+    for (std::size_t i = 0; i < target.ratio.size(); i++)
+    {
+        target.ratio[i] += sign * values.ratio[i];
+    }
+}
+
+TorrentAggregates::TorrentAggregates(porla::ISession& session, std::size_t max_labels)
+    : m_session(session)
+    , m_max_labels(max_labels)
+{
+    for (auto const& [hash, ts] : m_session.TorrentStatuses())
+    {
+        Add(ts);
+    }
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                // Updates can arrive for torrents that are already removed.
+                if (!m_torrents.contains(ts.info_hashes)) { continue; }
+
+                Remove(ts.info_hashes);
+                Add(ts);
+            }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved(
+        [this](const lt::torrent_handle& th)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+            const auto status = statuses.find(th.info_hashes());
+
+            if (status == statuses.end() || !m_torrents.contains(status->first))
+            {
+                return;
+            }
+
+            Remove(status->first);
+            Add(status->second);
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts)
+        {
+            Remove(ts.info_hashes);
+            Add(ts);
+        });
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                Remove(ts.info_hashes);
+                Add(ts);
+            }
+        });
+
+    m_clientDataChangedConnection = m_session.OnClientDataChanged(
+        [this](const std::vector<lt::info_hash_t>& hashes)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+
+            for (const auto& hash : hashes)
+            {
+                const auto status = statuses.find(hash);
+                if (status == statuses.end() || !m_torrents.contains(hash)) { continue; }
+
+                Remove(hash);
+                Add(status->second);
+            }
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+}
+
+TorrentAggregates::~TorrentAggregates()
+{
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_clientDataChangedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+const char* TorrentAggregates::Name(Dimension dimension)
+{
+    switch (dimension)
+    {
+    case Category: return "category";
+    case SavePath: return "save_path";
+    case State:    return "state";
+    case Tracker:  return "tracker";
+    default:       return "unknown";
+    }
+}
+
+void TorrentAggregates::Add(const lt::torrent_status& ts)
+{
+    const auto client_data = m_session.ClientData(ts);
+
+    const double ratio = Utils::Ratio(ts);
+
+    Contribution contribution{
+        .labels = {
+            Label(Category, client_data != nullptr ? client_data->category.value_or(Symbol()).str() : ""),
+            Label(SavePath, ts.save_path),
+            Label(State,    StateName(ts)),
+            Label(Tracker,  porla::Utils::String::UrlHost(ts.current_tracker))
+        },
+        .values = Values{
+            .count         = 1,
+            .download_rate = ts.download_payload_rate,
+            .upload_rate   = ts.upload_payload_rate,
+            .size          = ts.total_wanted,
+            .ratio_sum     = ratio
+        }
+    };
+
+    std::size_t bucket = 0;
+    while (bucket < RatioBounds.size() && ratio > RatioBounds[bucket]) { bucket++; }
+    contribution.values.ratio[bucket] = 1;
+
+    for (int d = 0; d < DimensionCount; d++)
+    {
+        Apply(m_groups[d][contribution.labels[d]], contribution.values, 1);
+    }
+
+    m_torrents.insert_or_assign(ts.info_hashes, std::move(contribution));
+}
+
+void TorrentAggregates::Remove(const lt::info_hash_t& hash)
+{
+    const auto torrent = m_torrents.find(hash);
+
+    if (torrent == m_torrents.end())
+    {
+        return;
+    }
+
+    for (int d = 0; d < DimensionCount; d++)
+    {
+        auto& group = m_groups[d];
+        auto  entry = group.find(torrent->second.labels[d]);
+
+        Apply(entry->second, torrent->second.values, -1);
+
+        // Frees the label for another value once nothing is counted under it.
+        if (entry->second.count == 0)
+        {
+            group.erase(entry);
+        }
+    }
+
+    m_torrents.erase(torrent);
+}
+
+std::string TorrentAggregates::Label(Dimension dimension, const std::string& value)
+{
+    const auto& group = m_groups[dimension];
+
+    if (group.contains(value) || group.size() < m_max_labels)
+    {
+        return value;
+    }
+
+    return Other;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Torrent counts, rates, sizes and ratios summed per category, save path, state and
+    // tracker host. Kept up to date from the state updates by subtracting what a torrent
+    // contributed before and adding what it contributes now, so reading them is free.
+    class TorrentAggregates
+    {
+    public:
+        enum Dimension
+        {
+            Category,
+            SavePath,
+            State,
+            Tracker,
+            DimensionCount
+        };
+
+        static constexpr std::array<double, 6> RatioBounds = { 0.25, 0.5, 1, 2, 5, 10 };
+
+        struct Values
+        {
+            std::int64_t count = 0;
+            std::int64_t download_rate = 0;
+            std::int64_t upload_rate = 0;
+            std::int64_t size = 0;
+            double       ratio_sum = 0;
+            // Torrents per ratio bucket, not cumulative, with the last one above all bounds.
+            std::array<std::int64_t, RatioBounds.size() + 1> ratio{};
+        };
+
+        // Label values beyond max_labels distinct ones per dimension are counted as 'other'.
+        explicit TorrentAggregates(ISession& session, std::size_t max_labels = 100);
+        TorrentAggregates(const TorrentAggregates&) = delete;
+
+        ~TorrentAggregates();
+
+        [[nodiscard]] static const char* Name(Dimension dimension);
+        // The state label of a torrent, which is "paused" for paused torrents.
+        [[nodiscard]] static std::string StateName(const libtorrent::torrent_status& ts);
+        [[nodiscard]] const std::map<std::string, Values>& Group(Dimension dimension) const { return m_groups[dimension]; }
+
+    private:
+        struct Contribution
+        {
+            std::array<std::string, DimensionCount> labels;
+            Values values;
+        };
+
+        void Add(const libtorrent::torrent_status& ts);
+        void Remove(const libtorrent::info_hash_t& hash);
+        std::string Label(Dimension dimension, const std::string& value);
+
+        ISession& m_session;
+        std::size_t m_max_labels;
+
+        std::array<std::map<std::string, Values>, DimensionCount> m_groups;
+        std::map<libtorrent::info_hash_t, Contribution> m_torrents;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_clientDataChangedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
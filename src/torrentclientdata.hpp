@@ -1,18 +1,25 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
 #include <optional>
-#include <string>
-#include <unordered_set>
 
-#include <nlohmann/json.hpp>
+#include "symbol.hpp"
+#include "utils/livecount.hpp"
 
 namespace porla
 {
     struct TorrentClientData
     {
-        std::optional<std::string>                            category;
-        std::optional<std::map<std::string, nlohmann::json>>  metadata;
-        std::optional<std::unordered_set<std::string>>        tags;
+        std::optional<Symbol>    category;
+        // The preset the torrent was added with, if any.
+        std::optional<Symbol>    preset;
+        std::optional<SymbolSet> tags;
+
+        // Bumped by whatever changes the fields above, so the write behind queue only
+        // rewrites client data which changed. Zero is what was loaded from the database.
+        std::uint64_t            revision = 1;
+
+        // Counted for sys.memory, since client data is only reachable through the handles.
+        [[no_unique_address]] Utils::LiveCount<TorrentClientData> live;
     };
 }
@@ -0,0 +1,185 @@
+#include "torrentcolumns.hpp"
+
+#include <algorithm>
+
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+#include "utils/ratio.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentColumns;
+
+TorrentColumns::TorrentColumns(porla::ISession& session)
+    : m_session(session)
+{
+    for (auto const& [hash, ts] : m_session.TorrentStatuses())
+    {
+        Refresh(hash);
+        RefreshTags(hash, m_session.ClientData(ts));
+    }
+
+    m_clientDataChangedConnection = m_session.OnClientDataChanged(
+        [this](const std::vector<lt::info_hash_t>& hashes)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+
+            for (const auto& hash : hashes)
+            {
+                const auto status = statuses.find(hash);
+                if (status == statuses.end()) { continue; }
+
+                RefreshTags(hash, m_session.ClientData(status->second));
+            }
+        });
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (auto const& ts : torrents) { Refresh(ts.info_hashes); }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved([this](auto const& th) { Refresh(th.info_hashes()); });
+    m_torrentAddedConnection = m_session.OnTorrentAdded(
+        [this](auto const& ts)
+        {
+            Refresh(ts.info_hashes);
+            RefreshTags(ts.info_hashes, m_session.ClientData(ts));
+        });
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                Refresh(ts.info_hashes);
+                RefreshTags(ts.info_hashes, m_session.ClientData(ts));
+            }
+        });
+    m_torrentFinishedConnection = m_session.OnTorrentFinished([this](auto const& ts) { Refresh(ts.info_hashes); });
+    m_torrentPausedConnection = m_session.OnTorrentPaused([this](auto const& th) { Refresh(th.info_hashes()); });
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+    m_torrentResumedConnection = m_session.OnTorrentResumed([this](auto const& ts) { Refresh(ts.info_hashes); });
+}
+
+TorrentColumns::~TorrentColumns()
+{
+    m_clientDataChangedConnection.disconnect();
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentFinishedConnection.disconnect();
+    m_torrentPausedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+    m_torrentResumedConnection.disconnect();
+}
+
+void TorrentColumns::Refresh(const lt::info_hash_t& hash)
+{
+    const auto& statuses = m_session.TorrentStatuses();
+    const auto status = statuses.find(hash);
+
+    // State updates can name torrents which were removed after libtorrent posted them.
+    if (status == statuses.end())
+    {
+        return;
+    }
+
+    auto [row_it, inserted] = m_rows.insert({ hash, m_columns.Size() });
+
+    if (inserted)
+    {
+        EachColumn([](auto& column) { column.emplace_back(); });
+        m_columns.tags.resize(m_columns.tags.size() + m_columns.tag_words, 0);
+    }
+
+    const auto& ts = status->second;
+    const auto row = row_it->second;
+    const auto torrent_file = ts.torrent_file.lock();
+
+    m_columns.hashes[row]         = hash;
+    m_columns.added_time[row]     = ts.added_time;
+    m_columns.download_rate[row]  = ts.download_rate;
+    m_columns.flags[row]          = static_cast<std::uint64_t>(ts.flags);
+    m_columns.moving_storage[row] = ts.moving_storage ? 1 : 0;
+    m_columns.progress[row]       = ts.progress;
+    m_columns.queue_position[row] = static_cast<int>(ts.queue_position);
+    m_columns.ratio[row]          = porla::Utils::Ratio(ts);
+    m_columns.size[row]           = torrent_file ? torrent_file->total_size() : -1;
+    m_columns.state[row]          = static_cast<std::uint8_t>(ts.state);
+    m_columns.upload_rate[row]    = ts.upload_rate;
+}
+
+void TorrentColumns::Remove(const lt::info_hash_t& hash)
+{
+    const auto it = m_rows.find(hash);
+    if (it == m_rows.end()) { return; }
+
+    const auto row  = it->second;
+    const auto last = m_columns.Size() - 1;
+
+    m_rows.erase(it);
+
+    const auto words = m_columns.tag_words;
+
+    // Move the last row into the hole to keep the columns dense.
+    if (row != last)
+    {
+        EachColumn([row, last](auto& column) { column[row] = column[last]; });
+        std::copy_n(m_columns.tags.begin() + last * words, words, m_columns.tags.begin() + row * words);
+        m_rows[m_columns.hashes[row]] = row;
+    }
+
+    EachColumn([](auto& column) { column.pop_back(); });
+    m_columns.tags.resize(last * words);
+}
+
+void TorrentColumns::RefreshTags(const lt::info_hash_t& hash, const porla::TorrentClientData* client_data)
+{
+    const auto row_it = m_rows.find(hash);
+    if (row_it == m_rows.end()) { return; }
+
+    if (client_data != nullptr && client_data->tags.has_value())
+    {
+        for (const auto& tag : *client_data->tags)
+        {
+            if (m_columns.tag_bits.contains(tag)) { continue; }
+
+            const auto bit = static_cast<std::uint32_t>(m_columns.tag_bits.size());
+
+            if (bit >= m_columns.tag_words * 64) { WidenTags(); }
+
+            m_columns.tag_bits.insert({ tag, bit });
+        }
+    }
+
+    const auto words = m_columns.tag_words;
+    const auto begin = m_columns.tags.begin() + row_it->second * words;
+
+    std::fill_n(begin, words, 0);
+
+    if (client_data == nullptr || !client_data->tags.has_value())
+    {
+        return;
+    }
+
+    for (const auto& tag : *client_data->tags)
+    {
+        const auto bit = m_columns.tag_bits.at(tag);
+        begin[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    }
+}
+
+void TorrentColumns::WidenTags()
+{
+    const auto words = m_columns.tag_words;
+    std::vector<std::uint64_t> tags(m_columns.Size() * (words + 1), 0);
+
+    for (std::size_t row = 0; row < m_columns.Size(); row++)
+    {
+        std::copy_n(m_columns.tags.begin() + row * words, words, tags.begin() + row * (words + 1));
+    }
+
+    m_columns.tags = std::move(tags);
+    m_columns.tag_words = words + 1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <map>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "query/columns.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+    struct TorrentClientData;
+
+    // Mirrors the numeric fields of the session status cache in contiguous columns, so
+    // queries and sorting over every torrent scan arrays instead of torrent_status objects.
+    // Tags are kept as a bitset per torrent, updated when the client data changes rather
+    // than on state updates, since reading it is a round trip to libtorrent.
+    class TorrentColumns
+    {
+    public:
+        explicit TorrentColumns(ISession& session);
+        TorrentColumns(const TorrentColumns&) = delete;
+
+        ~TorrentColumns();
+
+        [[nodiscard]] const Query::Columns& Snapshot() const { return m_columns; }
+
+    private:
+        // Applies f to every column, including the hashes.
+        template<typename F>
+        void EachColumn(F f)
+        {
+            f(m_columns.hashes);
+            f(m_columns.added_time);
+            f(m_columns.download_rate);
+            f(m_columns.flags);
+            f(m_columns.moving_storage);
+            f(m_columns.progress);
+            f(m_columns.queue_position);
+            f(m_columns.ratio);
+            f(m_columns.size);
+            f(m_columns.state);
+            f(m_columns.upload_rate);
+        }
+
+        // Copies the torrent's cached status into its row.
+        void Refresh(const libtorrent::info_hash_t& hash);
+        // Sets the tag bits of the torrent's row, giving new tags a bit.
+        void RefreshTags(const libtorrent::info_hash_t& hash, const TorrentClientData* client_data);
+        void Remove(const libtorrent::info_hash_t& hash);
+        // Makes room for one more word of tag bits in every row.
+        void WidenTags();
+
+        ISession& m_session;
+        Query::Columns m_columns;
+        std::map<libtorrent::info_hash_t, std::size_t> m_rows;
+
+        porla::Utils::Connection m_clientDataChangedConnection;
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentFinishedConnection;
+        porla::Utils::Connection m_torrentPausedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+        porla::Utils::Connection m_torrentResumedConnection;
+    };
+}
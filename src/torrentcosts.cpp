@@ -0,0 +1,150 @@
+#include "torrentcosts.hpp"
+
+#include <algorithm>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentCosts;
+
+TorrentCosts::TorrentCosts(porla::ISession& session, porla::TorrentCounters& counters, TorrentCostsOptions options)
+    : m_session(session)
+    , m_options(options)
+    , m_slotLength(std::max<std::chrono::steady_clock::duration>(std::chrono::seconds(1), options.window / std::max(1, options.slots)))
+    , m_last(std::chrono::steady_clock::now())
+{
+    m_batchConnection = counters.OnBatch(
+        [this](const TorrentCounters::Batch& batch)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            const auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_last);
+
+            Add(batch, interval, now);
+        });
+
+    // Disconnects can be counted after the torrent is gone, or not at all.
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](const lt::info_hash_t& hash) { m_peers.erase(hash); });
+}
+
+TorrentCosts::~TorrentCosts()
+{
+    m_batchConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+void TorrentCosts::Add(const TorrentCounters::Batch& batch, std::chrono::milliseconds interval, std::chrono::steady_clock::time_point now)
+{
+    m_last = now;
+
+    auto& slot = Current(now);
+
+    for (const auto& [hash, values] : batch)
+    {
+        slot.resources[DiskRead].Add(hash, values.disk_read);
+        slot.resources[Checking].Add(hash, values.checking_ms);
+        slot.resources[Uploaded].Add(hash, values.uploaded);
+        slot.resources[Downloaded].Add(hash, values.downloaded);
+
+        if (values.connects != values.disconnects)
+        {
+            auto& peers = m_peers[hash];
+            peers += static_cast<std::int64_t>(values.connects) - static_cast<std::int64_t>(values.disconnects);
+
+            if (peers <= 0) { m_peers.erase(hash); }
+        }
+    }
+
+    const auto milliseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(0, interval.count()));
+
+    for (const auto& [hash, peers] : m_peers)
+    {
+        slot.resources[Peers].Add(hash, static_cast<std::uint64_t>(peers) * milliseconds);
+    }
+}
+
+std::vector<TorrentCosts::Cost> TorrentCosts::Top(Resource resource, std::size_t limit) const
+{
+    // Large enough that merging the slots drops nothing.
+    Utils::TopK<lt::info_hash_t> merged(m_options.capacity * std::max<std::size_t>(1, m_slots.size()));
+
+    for (const auto& slot : m_slots)
+    {
+        merged.Merge(slot.resources[resource]);
+    }
+
+    std::vector<Cost> result;
+
+    for (const auto& item : merged.Top(limit))
+    {
+        result.push_back({ .info_hash = item.key, .value = item.weight, .error = item.error });
+    }
+
+    return result;
+}
+
+porla::MemoryUsage TorrentCosts::Memory() const
+{
+    // Each held torrent is a node in the lookup and one in the order, of about four
+    // pointers of tree overhead each.
+    constexpr std::size_t NodeOverhead = 4 * sizeof(void*);
+    constexpr std::size_t PerItem = 2 * (sizeof(lt::info_hash_t) + 2 * sizeof(std::uint64_t) + NodeOverhead);
+
+    std::size_t items = 0;
+
+    for (const auto& slot : m_slots)
+    {
+        for (const auto& resource : slot.resources) { items += resource.Size(); }
+    }
+
+    return MemoryUsage{
+        .bytes   = items * PerItem + m_peers.size() * (sizeof(lt::info_hash_t) + sizeof(std::int64_t) + NodeOverhead),
+        .objects = items
+    };
+}
+
+const char* TorrentCosts::Name(Resource resource)
+{
+    switch (resource)
+    {
+    case Peers:         return "peers";
+    case DiskRead:      return "disk_read";
+    case Checking:      return "checking";
+    case Uploaded:      return "uploaded";
+    case Downloaded:    return "downloaded";
+    case ResourceCount: break;
+    }
+
+    return "unknown";
+}
+
+std::optional<TorrentCosts::Resource> TorrentCosts::FromName(const std::string& name)
+{
+    for (int i = 0; i < ResourceCount; i++)
+    {
+        if (name == Name(static_cast<Resource>(i))) { return static_cast<Resource>(i); }
+    }
+
+    return std::nullopt;
+}
+
+TorrentCosts::Slot& TorrentCosts::Current(std::chrono::steady_clock::time_point now)
+{
+    const std::int64_t epoch = now.time_since_epoch() / m_slotLength;
+
+    if (m_slots.empty() || m_slots.back().epoch != epoch)
+    {
+        m_slots.push_back(Slot{
+            .epoch     = epoch,
+            .resources = std::vector(ResourceCount, Utils::TopK<lt::info_hash_t>(m_options.capacity))
+        });
+    }
+
+    // Slots which have left the window.
+    while (m_slots.front().epoch <= epoch - std::max(1, m_options.slots))
+    {
+        m_slots.pop_front();
+    }
+
+    return m_slots.back();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "memoryusage.hpp"
+#include "torrentcounters.hpp"
+#include "utils/signal.hpp"
+#include "utils/topk.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct TorrentCostsOptions
+    {
+        // Costs are ranked over this much of the recent past, kept in slots so that the
+        // oldest part can be dropped as a whole.
+        std::chrono::seconds window   = std::chrono::seconds(300);
+        int                  slots    = 5;
+        // How many torrents each slot keeps per resource. Rankings are exact for torrents
+        // costing more than 1/capacity of the total.
+        std::size_t          capacity = 100;
+    };
+
+    // What torrents cost the node, ranked per resource over a recent window, from the
+    // batches of TorrentCounters. Each slot of the window holds a Space-Saving top-k per
+    // resource, so memory is fixed however many torrents there are, and a ranking merges
+    // the slots. Peers are counted as the connections a torrent has held, in connection
+    // milliseconds, and checking in milliseconds.
+    class TorrentCosts
+    {
+    public:
+        enum Resource
+        {
+            Peers,
+            DiskRead,
+            Checking,
+            Uploaded,
+            Downloaded,
+            ResourceCount
+        };
+
+        struct Cost
+        {
+            libtorrent::info_hash_t info_hash;
+            std::uint64_t           value;
+            // How much of the value could belong to torrents which were ranked out earlier.
+            std::uint64_t           error;
+        };
+
+        explicit TorrentCosts(ISession& session, TorrentCounters& counters, TorrentCostsOptions options);
+        TorrentCosts(const TorrentCosts&) = delete;
+
+        ~TorrentCosts();
+
+        // Adds the batch, which covers the interval before now.
+        void Add(const TorrentCounters::Batch& batch, std::chrono::milliseconds interval, std::chrono::steady_clock::time_point now);
+
+        [[nodiscard]] std::vector<Cost> Top(Resource resource, std::size_t limit) const;
+
+        [[nodiscard]] std::chrono::seconds Window() const { return m_options.window; }
+        [[nodiscard]] std::size_t Capacity() const { return m_options.capacity; }
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+        static const char* Name(Resource resource);
+        static std::optional<Resource> FromName(const std::string& name);
+
+    private:
+        struct Slot
+        {
+            std::int64_t epoch;
+            // By resource.
+            std::vector<Utils::TopK<libtorrent::info_hash_t>> resources;
+        };
+
+        Slot& Current(std::chrono::steady_clock::time_point now);
+
+        ISession& m_session;
+        TorrentCostsOptions m_options;
+        std::chrono::steady_clock::duration m_slotLength;
+        std::chrono::steady_clock::time_point m_last;
+
+        std::deque<Slot> m_slots;
+        // The connections each torrent has open, from its connects and disconnects.
+        std::map<libtorrent::info_hash_t, std::int64_t> m_peers;
+
+        porla::Utils::Connection m_batchConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
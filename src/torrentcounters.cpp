@@ -0,0 +1,217 @@
+#include "torrentcounters.hpp"
+
+#include <optional>
+
+#include <libtorrent/peer_connection_handle.hpp>
+#include <libtorrent/torrent.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+namespace lt = libtorrent;
+
+using porla::TorrentCounters;
+
+// One per connection, counting the payload it moves. Connections are counted by the
+// torrent plugin, and disconnects when libtorrent lets go of the connection.
+class TorrentCounters::PeerPlugin : public lt::peer_plugin
+{
+public:
+    explicit PeerPlugin(std::shared_ptr<Counters> counters)
+        : m_counters(std::move(counters))
+    {
+        m_counters->connects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~PeerPlugin() override
+    {
+        m_counters->disconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool on_piece(const lt::peer_request&, lt::span<char const> data) override
+    {
+        m_counters->downloaded.fetch_add(data.size(), std::memory_order_relaxed);
+        return false;
+    }
+
+    bool on_request(const lt::peer_request& request) override
+    {
+        m_counters->disk_read.fetch_add(request.length, std::memory_order_relaxed);
+        return false;
+    }
+
+    void sent_payload(int bytes) override
+    {
+        m_counters->uploaded.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<Counters> m_counters;
+};
+
+class TorrentCounters::TorrentPlugin : public lt::torrent_plugin
+{
+public:
+    TorrentPlugin(std::shared_ptr<State> state, const lt::info_hash_t& hash)
+        : m_state(std::move(state))
+        , m_counters(std::make_shared<Counters>())
+        , m_hash(hash)
+    {
+        std::unique_lock lock(m_state->mutex);
+        m_state->torrents[m_hash] = m_counters;
+    }
+
+    ~TorrentPlugin() override
+    {
+        std::unique_lock lock(m_state->mutex);
+
+        // Kept for the next batch, so nothing counted is lost with the torrent.
+        if (const auto values = Take(*m_counters); !Empty(values)) { Add(m_state->removed[m_hash], values); }
+
+        // Unless the torrent was added again before this one was let go of.
+        const auto it = m_state->torrents.find(m_hash);
+        if (it != m_state->torrents.end() && it->second == m_counters) { m_state->torrents.erase(it); }
+    }
+
+    std::shared_ptr<lt::peer_plugin> new_connection(const lt::peer_connection_handle&) override
+    {
+        return std::make_shared<PeerPlugin>(m_counters);
+    }
+
+    void on_piece_failed(lt::piece_index_t) override
+    {
+        m_counters->hash_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_state(lt::torrent_status::state_t state) override
+    {
+        const bool checking = state == lt::torrent_status::checking_files
+            || state == lt::torrent_status::checking_resume_data;
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if (checking && !m_checkingSince.has_value())
+        {
+            m_checkingSince = now;
+        }
+        else if (!checking && m_checkingSince.has_value())
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - *m_checkingSince);
+            m_counters->checking_ms.fetch_add(elapsed.count(), std::memory_order_relaxed);
+            m_checkingSince.reset();
+        }
+    }
+
+private:
+    std::shared_ptr<State> m_state;
+    std::shared_ptr<Counters> m_counters;
+    lt::info_hash_t m_hash;
+    // Only touched by the hooks, on the network thread.
+    std::optional<std::chrono::steady_clock::time_point> m_checkingSince;
+};
+
+TorrentCounters::TorrentCounters(boost::asio::io_context& io, TorrentCountersOptions options)
+    : m_timer(io)
+    , m_options(options)
+    , m_state(std::make_shared<State>())
+{
+    Schedule();
+}
+
+TorrentCounters::~TorrentCounters()
+{
+    m_timer.cancel();
+}
+
+std::function<std::shared_ptr<lt::torrent_plugin>(const lt::torrent_handle&, lt::client_data_t)> TorrentCounters::Plugin() const
+{
+    return [state = m_state](const lt::torrent_handle& th, lt::client_data_t) -> std::shared_ptr<lt::torrent_plugin>
+    {
+        // On the network thread, where the handle functions would wait on themselves.
+        return std::make_shared<TorrentPlugin>(state, th.native_handle()->info_hash());
+    };
+}
+
+porla::MemoryUsage TorrentCounters::Memory() const
+{
+    // Every map node holds its key and value plus about four pointers of tree overhead.
+    constexpr std::size_t NodeOverhead = 4 * sizeof(void*);
+
+    std::unique_lock lock(m_state->mutex);
+
+    const auto torrents = m_state->torrents.size();
+
+    return MemoryUsage{
+        .bytes   = torrents * (sizeof(lt::info_hash_t) + sizeof(std::shared_ptr<Counters>) + sizeof(Counters) + NodeOverhead)
+                 + m_last.size() * (sizeof(lt::info_hash_t) + sizeof(Values) + NodeOverhead),
+        .objects = torrents
+    };
+}
+
+TorrentCounters::Values TorrentCounters::Take(Counters& counters)
+{
+    return Values{
+        .downloaded    = counters.downloaded.exchange(0, std::memory_order_relaxed),
+        .uploaded      = counters.uploaded.exchange(0, std::memory_order_relaxed),
+        .connects      = counters.connects.exchange(0, std::memory_order_relaxed),
+        .disconnects   = counters.disconnects.exchange(0, std::memory_order_relaxed),
+        .hash_failures = counters.hash_failures.exchange(0, std::memory_order_relaxed),
+        .disk_read     = counters.disk_read.exchange(0, std::memory_order_relaxed),
+        .checking_ms   = counters.checking_ms.exchange(0, std::memory_order_relaxed)
+    };
+}
+
+void TorrentCounters::Add(Values& values, const Values& other)
+{
+    values.downloaded    += other.downloaded;
+    values.uploaded      += other.uploaded;
+    values.connects      += other.connects;
+    values.disconnects   += other.disconnects;
+    values.hash_failures += other.hash_failures;
+    values.disk_read     += other.disk_read;
+    values.checking_ms   += other.checking_ms;
+}
+
+bool TorrentCounters::Empty(const Values& values)
+{
+    return values.downloaded == 0
+        && values.uploaded == 0
+        && values.connects == 0
+        && values.disconnects == 0
+        && values.hash_failures == 0
+        && values.disk_read == 0
+        && values.checking_ms == 0;
+}
+
+void TorrentCounters::Schedule()
+{
+    m_timer.expires_after(m_options.interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) return;
+
+            Publish();
+            Schedule();
+        });
+}
+
+void TorrentCounters::Publish()
+{
+    Batch batch;
+
+    {
+        std::unique_lock lock(m_state->mutex);
+
+        for (const auto& [hash, counters] : m_state->torrents)
+        {
+            if (const auto values = Take(*counters); !Empty(values)) { batch.insert({ hash, values }); }
+        }
+
+        for (const auto& [hash, values] : m_state->removed) { Add(batch[hash], values); }
+        m_state->removed.clear();
+    }
+
+    for (const auto& [_, values] : batch) { Add(m_totals, values); }
+
+    m_last = std::move(batch);
+    m_batch(m_last);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/asio.hpp>
+#include <libtorrent/client_data.hpp>
+#include <libtorrent/extensions.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_handle.hpp>
+
+#include "memoryusage.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    struct TorrentCountersOptions
+    {
+        std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+    };
+
+    // Counters kept per torrent by a libtorrent plugin, for figures which would otherwise
+    // be polled from the statuses. The plugin hooks run on the network thread and only
+    // add to atomics. Every interval the counters of all torrents are taken in one batch
+    // on the io thread, as the amounts since the batch before, and published.
+    class TorrentCounters
+    {
+    public:
+        struct Values
+        {
+            // Payload, in blocks received and sent.
+            std::uint64_t downloaded    = 0;
+            std::uint64_t uploaded      = 0;
+            std::uint64_t connects      = 0;
+            std::uint64_t disconnects   = 0;
+            std::uint64_t hash_failures = 0;
+            // Block bytes peers asked for, which are read from disk (or the page cache) to
+            // be sent.
+            std::uint64_t disk_read     = 0;
+            // Milliseconds spent checking files or resume data.
+            std::uint64_t checking_ms   = 0;
+        };
+
+        // Only torrents with anything counted since the batch before.
+        typedef std::map<libtorrent::info_hash_t, Values> Batch;
+        typedef porla::Utils::Signal<void(const Batch&)> BatchSignal;
+
+        explicit TorrentCounters(boost::asio::io_context& io, TorrentCountersOptions options);
+        TorrentCounters(const TorrentCounters&) = delete;
+
+        ~TorrentCounters();
+
+        // Added to the session extensions, before the torrents are.
+        [[nodiscard]] std::function<std::shared_ptr<libtorrent::torrent_plugin>(const libtorrent::torrent_handle&, libtorrent::client_data_t)> Plugin() const;
+
+        [[nodiscard]] const Batch& Last() const { return m_last; }
+        // Of every torrent since startup, removed ones too.
+        [[nodiscard]] const Values& Totals() const { return m_totals; }
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+        porla::Utils::Connection OnBatch(const BatchSignal::slot_type& subscriber)
+        {
+            return m_batch.connect(subscriber);
+        }
+
+    private:
+        struct Counters
+        {
+            std::atomic<std::uint64_t> downloaded    = 0;
+            std::atomic<std::uint64_t> uploaded      = 0;
+            std::atomic<std::uint64_t> connects      = 0;
+            std::atomic<std::uint64_t> disconnects   = 0;
+            std::atomic<std::uint64_t> hash_failures = 0;
+            std::atomic<std::uint64_t> disk_read     = 0;
+            std::atomic<std::uint64_t> checking_ms   = 0;
+        };
+
+        // Shared with the plugins, which libtorrent may keep after we are gone. The lock is
+        // only taken when a torrent is added or removed, and once per batch.
+        struct State
+        {
+            std::mutex mutex;
+            std::map<libtorrent::info_hash_t, std::shared_ptr<Counters>> torrents;
+            // Counted by torrents since removed, and not yet taken.
+            Batch removed;
+        };
+
+        class TorrentPlugin;
+        class PeerPlugin;
+
+        static void Add(Values& values, const Values& other);
+        static bool Empty(const Values& values);
+        static Values Take(Counters& counters);
+
+        void Schedule();
+        void Publish();
+
+        boost::asio::steady_timer m_timer;
+        TorrentCountersOptions m_options;
+        std::shared_ptr<State> m_state;
+
+        Batch m_last;
+        Values m_totals;
+        BatchSignal m_batch;
+    };
+}
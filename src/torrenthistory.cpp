@@ -0,0 +1,245 @@
+#include "torrenthistory.hpp"
+
+#include <ctime>
+#include <limits>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+
+#include "data/readerpool.hpp"
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentHistory;
+
+using Buckets = porla::Data::Models::TorrentHistory;
+
+static std::string ToString(const lt::info_hash_t& hash)
+{
+    std::stringstream ss;
+    ss << hash.get_best();
+    return ss.str();
+}
+
+TorrentHistory::TorrentHistory(boost::asio::io_context& io, porla::ISession& session, const TorrentHistoryOptions& options)
+    : m_timer(io)
+    , m_session(session)
+    , m_options(options)
+    , m_pruned(0)
+    , m_flushes(0)
+{
+    for (const auto& [hash, ts] : m_session.TorrentStatuses())
+    {
+        m_last.insert({ hash, Totals{ ts.all_time_download, ts.all_time_upload } });
+    }
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            const std::int64_t now = std::time(nullptr);
+            for (const auto& ts : torrents) { Update(ts, now); }
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts)
+        {
+            m_last.insert_or_assign(ts.info_hashes, Totals{ ts.all_time_download, ts.all_time_upload });
+        });
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                m_last.insert_or_assign(ts.info_hashes, Totals{ ts.all_time_download, ts.all_time_upload });
+            }
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            m_last.erase(hash);
+
+            m_pending.erase(
+                m_pending.lower_bound({ hash, std::numeric_limits<std::int64_t>::min() }),
+                m_pending.upper_bound({ hash, std::numeric_limits<std::int64_t>::max() }));
+
+            try
+            {
+                Buckets::Remove(m_options.db, ToString(hash));
+            }
+            catch (const std::exception& ex)
+            {
+                BOOST_LOG_TRIVIAL(error) << "Failed to remove torrent history: " << ex.what();
+            }
+        });
+
+    Schedule();
+}
+
+TorrentHistory::~TorrentHistory()
+{
+    m_timer.cancel();
+
+    m_stateUpdateConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+
+    Flush();
+}
+
+std::vector<Buckets::Bucket> TorrentHistory::Get(const lt::info_hash_t& hash, Period period, std::int64_t from, std::int64_t to) const
+{
+    return Merge(hash, period, from, to, Stored(hash, period, from, to));
+}
+
+std::vector<Buckets::Bucket> TorrentHistory::Stored(const lt::info_hash_t& hash, Period period, std::int64_t from, std::int64_t to) const
+{
+    if (!HasReaders())
+    {
+        return Buckets::Get(m_options.db, ToString(hash), static_cast<int>(period), from, to);
+    }
+
+    const auto reader = m_options.readers->Acquire();
+    return Buckets::Get(reader.Get(), ToString(hash), static_cast<int>(period), from, to);
+}
+
+std::vector<Buckets::Bucket> TorrentHistory::Merge(
+    const lt::info_hash_t& hash,
+    Period period,
+    std::int64_t from,
+    std::int64_t to,
+    const std::vector<Buckets::Bucket>& stored) const
+{
+    const int seconds = static_cast<int>(period);
+
+    std::map<std::int64_t, Buckets::Bucket> merged;
+
+    for (const auto& bucket : stored)
+    {
+        merged.insert({ bucket.start, bucket });
+    }
+
+    for (auto it = m_pending.lower_bound({ hash, std::numeric_limits<std::int64_t>::min() });
+         it != m_pending.end() && it->first.first == hash;
+         ++it)
+    {
+        const std::int64_t start = it->first.second / seconds * seconds;
+
+        if (start < from || start > to)
+        {
+            continue;
+        }
+
+        auto& bucket = merged.try_emplace(start, Buckets::Bucket{ .start = start, .downloaded = 0, .uploaded = 0 }).first->second;
+        bucket.downloaded += it->second.downloaded;
+        bucket.uploaded   += it->second.uploaded;
+    }
+
+    std::vector<Buckets::Bucket> buckets;
+    buckets.reserve(merged.size());
+
+    for (const auto& [_, bucket] : merged)
+    {
+        buckets.push_back(bucket);
+    }
+
+    return buckets;
+}
+
+bool TorrentHistory::HasReaders() const
+{
+    return m_options.readers != nullptr && m_options.readers->Size() > 0;
+}
+
+void TorrentHistory::Flush()
+{
+    const std::int64_t now = std::time(nullptr);
+    const bool prune = now - m_pruned >= static_cast<int>(Period::Hourly);
+
+    if (m_pending.empty() && !prune)
+    {
+        return;
+    }
+
+    if (sqlite3_exec(m_options.db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to begin transaction: " << sqlite3_errmsg(m_options.db);
+    }
+
+    try
+    {
+        for (const auto& [key, totals] : m_pending)
+        {
+            const auto& [hash, hour] = key;
+            const auto  info_hash = ToString(hash);
+            const auto  daily     = static_cast<int>(Period::Daily);
+
+            Buckets::Add(m_options.db, info_hash, static_cast<int>(Period::Hourly), { hour, totals.downloaded, totals.uploaded });
+            Buckets::Add(m_options.db, info_hash, daily, { hour / daily * daily, totals.downloaded, totals.uploaded });
+        }
+
+        if (prune)
+        {
+            Buckets::Prune(m_options.db, static_cast<int>(Period::Hourly), now - m_options.hourly_retention * static_cast<std::int64_t>(Period::Hourly));
+            Buckets::Prune(m_options.db, static_cast<int>(Period::Daily), now - m_options.daily_retention * static_cast<std::int64_t>(Period::Daily));
+            m_pruned = now;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to write torrent history: " << ex.what();
+    }
+
+    if (sqlite3_exec(m_options.db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to commit transaction: " << sqlite3_errmsg(m_options.db);
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Wrote " << m_pending.size() << " torrent history bucket(s)";
+
+    m_pending.clear();
+    m_flushes++;
+}
+
+void TorrentHistory::Schedule()
+{
+    m_timer.expires_after(m_options.flush_interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+
+            Flush();
+            Schedule();
+        });
+}
+
+void TorrentHistory::Update(const lt::torrent_status& ts, std::int64_t now)
+{
+    const auto last = m_last.find(ts.info_hashes);
+
+    if (last == m_last.end())
+    {
+        m_last.insert({ ts.info_hashes, Totals{ ts.all_time_download, ts.all_time_upload } });
+        return;
+    }
+
+    const std::int64_t downloaded = ts.all_time_download - last->second.downloaded;
+    const std::int64_t uploaded   = ts.all_time_upload - last->second.uploaded;
+
+    last->second = Totals{ ts.all_time_download, ts.all_time_upload };
+
+    // The totals only go backwards if the torrent was re-added, in which case the new
+    // values are just the next baseline.
+    if (downloaded < 0 || uploaded < 0 || (downloaded == 0 && uploaded == 0))
+    {
+        return;
+    }
+
+    auto& pending = m_pending[{ ts.info_hashes, now / static_cast<int>(Period::Hourly) * static_cast<int>(Period::Hourly) }];
+    pending.downloaded += downloaded;
+    pending.uploaded   += uploaded;
+}
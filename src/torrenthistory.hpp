@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+#include <sqlite3.h>
+
+#include "data/models/torrenthistory.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    namespace Data
+    {
+        class ReaderPool;
+    }
+
+    struct TorrentHistoryOptions
+    {
+        sqlite3*             db;
+        // Reads stored buckets through these when set, so they can be read off the io
+        // thread.
+        Data::ReaderPool*    readers = nullptr;
+        std::chrono::seconds flush_interval = std::chrono::seconds(60);
+        int                  hourly_retention = 24 * 7;  // buckets
+        int                  daily_retention  = 365;     // buckets
+    };
+
+    // Rolls up the bytes each torrent transfers into hourly and daily buckets. Deltas are
+    // taken from the all time totals in state updates, kept in memory and written to the
+    // database in one transaction per flush interval.
+    class TorrentHistory
+    {
+    public:
+        enum class Period
+        {
+            Daily  = 86400,
+            Hourly = 3600
+        };
+
+        explicit TorrentHistory(boost::asio::io_context& io, ISession& session, const TorrentHistoryOptions& options);
+        TorrentHistory(const TorrentHistory&) = delete;
+
+        ~TorrentHistory();
+
+        // Buckets between from and to, including what is not flushed yet.
+        [[nodiscard]] std::vector<Data::Models::TorrentHistory::Bucket> Get(
+            const libtorrent::info_hash_t& hash,
+            Period period,
+            std::int64_t from,
+            std::int64_t to) const;
+
+        // The two halves of Get. Stored only reads the database, and may run on any thread
+        // when there are readers. Merge adds what is not flushed yet, on the io thread. If
+        // Flushes changed in between, the stored buckets may miss what was flushed.
+        [[nodiscard]] std::vector<Data::Models::TorrentHistory::Bucket> Stored(
+            const libtorrent::info_hash_t& hash,
+            Period period,
+            std::int64_t from,
+            std::int64_t to) const;
+
+        [[nodiscard]] std::vector<Data::Models::TorrentHistory::Bucket> Merge(
+            const libtorrent::info_hash_t& hash,
+            Period period,
+            std::int64_t from,
+            std::int64_t to,
+            const std::vector<Data::Models::TorrentHistory::Bucket>& stored) const;
+
+        [[nodiscard]] std::uint64_t Flushes() const { return m_flushes; }
+        [[nodiscard]] bool HasReaders() const;
+
+        void Flush();
+
+    private:
+        struct Totals
+        {
+            std::int64_t downloaded;
+            std::int64_t uploaded;
+        };
+
+        void Schedule();
+        void Update(const libtorrent::torrent_status& ts, std::int64_t now);
+
+        boost::asio::steady_timer m_timer;
+        ISession& m_session;
+        TorrentHistoryOptions m_options;
+
+        std::map<libtorrent::info_hash_t, Totals> m_last;
+        // Unflushed deltas by torrent and the hour they happened in. Daily buckets are
+        // derived from these when flushing.
+        std::map<std::pair<libtorrent::info_hash_t, std::int64_t>, Totals> m_pending;
+        std::int64_t m_pruned;
+        std::uint64_t m_flushes;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
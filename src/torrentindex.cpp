@@ -0,0 +1,318 @@
+#include "torrentindex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <type_traits>
+
+#include "session.hpp"
+#include "torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentIndex;
+
+TorrentIndex::TorrentIndex(porla::ISession& session)
+    : m_session(session)
+{
+    for (auto const& [hash, ts] : m_session.TorrentStatuses())
+    {
+        Update(hash, m_session.ClientData(ts), ts.name, ts.save_path);
+    }
+
+    // Names change when a magnet gets its metadata or the torrent is renamed, and state
+    // updates are the only place that shows up.
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                const auto entry = m_entries.find(ts.info_hashes);
+
+                if (entry != m_entries.end() && entry->second.name != ts.name)
+                {
+                    m_names.Erase(entry->first, entry->second.name);
+                    entry->second.name = ts.name;
+                    m_names.Insert(entry->first, entry->second.name);
+                }
+            }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved(
+        [this](const lt::torrent_handle& th)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+            const auto status = statuses.find(th.info_hashes());
+            const auto entry = m_entries.find(th.info_hashes());
+
+            if (status == statuses.end() || entry == m_entries.end())
+            {
+                return;
+            }
+
+            // Only the save path changed, so keep the rest of the entry.
+            Erase(m_save_paths, entry->second.save_path, entry->first);
+            m_save_path_trigrams.Erase(entry->first, entry->second.save_path);
+            entry->second.save_path = status->second.save_path;
+            m_save_paths[entry->second.save_path].insert(entry->first);
+            m_save_path_trigrams.Insert(entry->first, entry->second.save_path);
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts)
+        {
+            Update(ts.info_hashes, m_session.ClientData(ts), ts.name, ts.save_path);
+        });
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                Update(ts.info_hashes, m_session.ClientData(ts), ts.name, ts.save_path);
+            }
+        });
+
+    m_clientDataChangedConnection = m_session.OnClientDataChanged(
+        [this](const std::vector<lt::info_hash_t>& hashes)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+
+            for (const auto& hash : hashes)
+            {
+                const auto status = statuses.find(hash);
+                if (status == statuses.end()) { continue; }
+
+                Update(hash, m_session.ClientData(status->second), status->second.name, status->second.save_path);
+            }
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+}
+
+TorrentIndex::~TorrentIndex()
+{
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_clientDataChangedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+const TorrentIndex::HashSet& TorrentIndex::Category(const std::string& category) const
+{
+    return Find(m_categories, Symbol::Find(category));
+}
+
+const TorrentIndex::HashSet& TorrentIndex::SavePath(const std::string& save_path) const
+{
+    return Find(m_save_paths, save_path);
+}
+
+const TorrentIndex::HashSet& TorrentIndex::Tag(const std::string& tag) const
+{
+    return Find(m_tags, Symbol::Find(tag));
+}
+
+std::optional<TorrentIndex::HashSet> TorrentIndex::NameContains(const std::string& value) const
+{
+    return m_names.Candidates(value);
+}
+
+std::optional<TorrentIndex::HashSet> TorrentIndex::SavePathContains(const std::string& value) const
+{
+    return m_save_path_trigrams.Candidates(value);
+}
+
+static char Lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static std::string Lowered(std::string_view value)
+{
+    std::string result(value);
+    std::transform(result.begin(), result.end(), result.begin(), Lower);
+    return result;
+}
+
+std::vector<std::pair<lt::info_hash_t, double>> TorrentIndex::Search(std::string_view text) const
+{
+    std::vector<std::string> words;
+
+    for (std::size_t pos = 0; pos < text.size();)
+    {
+        const auto end = std::min(text.find(' ', pos), text.size());
+        if (end > pos) words.push_back(Lowered(text.substr(pos, end - pos)));
+        pos = end + 1;
+    }
+
+    std::vector<std::pair<lt::info_hash_t, double>> result;
+
+    if (words.empty())
+    {
+        return result;
+    }
+
+    // Every word has to match, so the candidates are the intersection over the words long
+    // enough to look up. Without any, every torrent is checked.
+    std::optional<HashSet> candidates;
+
+    for (const auto& word : words)
+    {
+        auto names = m_names.Candidates(word);
+        auto paths = m_save_path_trigrams.Candidates(word);
+
+        if (!names.has_value() || !paths.has_value())
+        {
+            continue;
+        }
+
+        names->merge(*paths);
+
+        if (!candidates.has_value())
+        {
+            candidates = std::move(*names);
+        }
+        else
+        {
+            std::erase_if(*candidates, [&](auto const& hash) { return !names->contains(hash); });
+        }
+    }
+
+    const auto score = [&](const Entry& entry) -> std::optional<double>
+    {
+        const auto name      = Lowered(entry.name);
+        const auto save_path = Lowered(entry.save_path);
+
+        double total = 0;
+        std::size_t matched = 0;
+
+        for (const auto& word : words)
+        {
+            if (const auto pos = name.find(word); pos != std::string::npos)
+            {
+                const bool word_start = pos == 0 || !std::isalnum(static_cast<unsigned char>(name[pos - 1]));
+                total   += word_start ? 2 : 1;
+                matched += word.size();
+            }
+            else if (save_path.find(word) != std::string::npos)
+            {
+                total += 0.5;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+
+        // How much of the name the words cover, which is below one and so only orders
+        // torrents matching the same way.
+        return total + (name.empty() ? 0 : static_cast<double>(matched) / static_cast<double>(name.size() + 1));
+    };
+
+    const auto add = [&](const lt::info_hash_t& hash, const Entry& entry)
+    {
+        if (const auto value = score(entry)) result.emplace_back(hash, *value);
+    };
+
+    if (candidates.has_value())
+    {
+        for (const auto& hash : *candidates)
+        {
+            if (const auto entry = m_entries.find(hash); entry != m_entries.end()) add(hash, entry->second);
+        }
+    }
+    else
+    {
+        for (const auto& [hash, entry] : m_entries) add(hash, entry);
+    }
+
+    std::sort(
+        result.begin(),
+        result.end(),
+        [](auto const& lhs, auto const& rhs) { return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first; });
+
+    return result;
+}
+
+porla::MemoryUsage TorrentIndex::Memory() const
+{
+    const auto names = m_names.Memory();
+    const auto paths = m_save_path_trigrams.Memory();
+
+    MemoryUsage usage{ .bytes = names.bytes + paths.bytes, .objects = m_entries.size() };
+
+    for (const auto& [_, entry] : m_entries)
+    {
+        usage.bytes += sizeof(lt::info_hash_t) + sizeof(Entry) + entry.name.capacity() + entry.save_path.capacity();
+    }
+
+    return usage;
+}
+
+void TorrentIndex::Update(const lt::info_hash_t& hash, const TorrentClientData* client_data, const std::string& name, const std::string& save_path)
+{
+    Remove(hash);
+
+    Entry entry{ .name = name, .save_path = save_path };
+
+    if (client_data != nullptr)
+    {
+        entry.category = client_data->category;
+        entry.tags     = client_data->tags.value_or(SymbolSet());
+    }
+
+    if (entry.category.has_value()) m_categories[*entry.category].insert(hash);
+    m_save_paths[entry.save_path].insert(hash);
+    for (auto const& tag : entry.tags) m_tags[tag].insert(hash);
+    m_names.Insert(hash, entry.name);
+    m_save_path_trigrams.Insert(hash, entry.save_path);
+
+    m_entries.insert({ hash, std::move(entry) });
+}
+
+void TorrentIndex::Remove(const lt::info_hash_t& hash)
+{
+    auto entry = m_entries.find(hash);
+    if (entry == m_entries.end()) { return; }
+
+    if (entry->second.category.has_value()) Erase(m_categories, *entry->second.category, hash);
+    Erase(m_save_paths, entry->second.save_path, hash);
+    for (auto const& tag : entry->second.tags) Erase(m_tags, tag, hash);
+    m_names.Erase(hash, entry->second.name);
+    m_save_path_trigrams.Erase(hash, entry->second.save_path);
+
+    m_entries.erase(entry);
+}
+
+template<typename TIndex, typename TKey>
+const TorrentIndex::HashSet& TorrentIndex::Find(const TIndex& index, const TKey& key)
+{
+    static const HashSet empty;
+
+    // Strings which were never interned are not on any torrent.
+    if constexpr (std::is_same_v<TKey, std::optional<Symbol>>)
+    {
+        return key.has_value() ? Find(index, *key) : empty;
+    }
+    else
+    {
+        const auto it = index.find(key);
+        return it == index.end() ? empty : it->second;
+    }
+}
+
+template<typename TIndex, typename TKey>
+void TorrentIndex::Erase(TIndex& index, const TKey& key, const lt::info_hash_t& hash)
+{
+    const auto it = index.find(key);
+    if (it == index.end()) { return; }
+
+    it->second.erase(hash);
+
+    if (it->second.empty())
+    {
+        index.erase(it);
+    }
+}
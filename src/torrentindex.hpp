@@ -0,0 +1,86 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "memoryusage.hpp"
+#include "query/pql.hpp"
+#include "symbol.hpp"
+#include "trigramindex.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+    struct TorrentClientData;
+
+    // Inverted indexes from category, tag and save path to the torrents that have them, so
+    // equality filters do not have to scan every torrent, and trigram indexes of names and
+    // save paths for substring searches.
+    class TorrentIndex : public Query::PQL::Index
+    {
+    public:
+        typedef Query::PQL::HashSet HashSet;
+
+        explicit TorrentIndex(ISession& session);
+        TorrentIndex(const TorrentIndex&) = delete;
+
+        ~TorrentIndex() override;
+
+        [[nodiscard]] const HashSet& Category(const std::string& category) const override;
+        [[nodiscard]] const HashSet& SavePath(const std::string& save_path) const override;
+        [[nodiscard]] const HashSet& Tag(const std::string& tag) const override;
+
+        [[nodiscard]] std::optional<HashSet> NameContains(const std::string& value) const override;
+        [[nodiscard]] std::optional<HashSet> SavePathContains(const std::string& value) const override;
+
+        // Torrents whose name or save path contains every word of the text, ignoring case,
+        // best matches first. Words in the name rank above words in the save path, more so
+        // at the start of a word, and shorter names rank above longer ones.
+        [[nodiscard]] std::vector<std::pair<libtorrent::info_hash_t, double>> Search(std::string_view text) const;
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+        // (Re)indexes a torrent. Call whenever its client data, name or save path changes.
+        void Update(const libtorrent::info_hash_t& hash, const TorrentClientData* client_data, const std::string& name, const std::string& save_path);
+        void Remove(const libtorrent::info_hash_t& hash);
+
+    private:
+        struct Entry
+        {
+            std::optional<Symbol> category;
+            std::string           name;
+            std::string           save_path;
+            SymbolSet             tags;
+        };
+
+        template<typename TIndex, typename TKey>
+        static const HashSet& Find(const TIndex& index, const TKey& key);
+
+        template<typename TIndex, typename TKey>
+        static void Erase(TIndex& index, const TKey& key, const libtorrent::info_hash_t& hash);
+
+        ISession& m_session;
+
+        std::map<libtorrent::info_hash_t, Entry> m_entries;
+        std::unordered_map<Symbol, HashSet> m_categories;
+        std::map<std::string, HashSet> m_save_paths;
+        std::unordered_map<Symbol, HashSet> m_tags;
+        TrigramIndex m_names;
+        TrigramIndex m_save_path_trigrams;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_clientDataChangedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
@@ -0,0 +1,109 @@
+#include "torrentinfocache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string_view>
+
+#include <libtorrent/bdecode.hpp>
+
+namespace lt = libtorrent;
+
+using porla::TorrentInfoCache;
+
+const std::vector<double>& TorrentInfoCache::ParseBounds()
+{
+    static const std::vector<double> bounds = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1 };
+    return bounds;
+}
+
+TorrentInfoCache::Result TorrentInfoCache::Load(const std::string& data, const TorrentInfoCacheOptions& options)
+{
+    if (data.size() > options.max_size)
+    {
+        return Result{
+            .error   = Error::TooLarge,
+            .message = "Torrent file is " + std::to_string(data.size()) + " bytes, over the limit of " + std::to_string(options.max_size)
+        };
+    }
+
+    lt::error_code ec;
+    const lt::bdecode_node node = lt::bdecode(data, ec, nullptr, 100, options.max_decode_tokens);
+
+    if (ec)
+    {
+        return Result{ .error = Error::Decode, .message = ec.message() };
+    }
+
+    lt::load_torrent_limits limits;
+    limits.max_buffer_size   = static_cast<int>(std::min<std::size_t>(options.max_size, std::numeric_limits<int>::max()));
+    limits.max_decode_tokens = options.max_decode_tokens;
+    limits.max_pieces        = options.max_pieces;
+
+    try
+    {
+        return Result{ .ti = std::make_shared<lt::torrent_info>(node, limits) };
+    }
+    catch (const lt::system_error& ex)
+    {
+        return Result{ .error = Error::Info, .message = ex.code().message() };
+    }
+}
+
+TorrentInfoCache::TorrentInfoCache(porla::TorrentInfoCacheOptions options)
+    : m_options(options)
+    , m_cache(options.capacity)
+{
+}
+
+TorrentInfoCache::Result TorrentInfoCache::Parse(const lt::info_hash_t& hash, const std::string& data)
+{
+    // Far cheaper than parsing, and tells files with the same info dict apart.
+    const auto digest = std::hash<std::string_view>{}(data);
+    const bool keyed  = hash != lt::info_hash_t();
+
+    if (keyed)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (const auto entry = m_cache.Get(hash); entry.has_value() && entry->size == data.size() && entry->digest == digest)
+        {
+            m_stats.hits++;
+            lock.unlock();
+
+            return Result{ .ti = std::make_shared<lt::torrent_info>(*entry->ti), .cached = true };
+        }
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    auto result = Load(data, m_options);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (result.error == Error::TooLarge)
+    {
+        m_stats.rejected++;
+        return result;
+    }
+
+    m_stats.misses++;
+    m_stats.parse_seconds.Observe(elapsed);
+
+    if (keyed && result.ti)
+    {
+        m_cache.Put(hash, Entry{
+            .ti     = std::make_shared<const lt::torrent_info>(*result.ti),
+            .size   = data.size(),
+            .digest = digest
+        });
+    }
+
+    return result;
+}
+
+TorrentInfoCache::Stats TorrentInfoCache::GetStats() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_info.hpp>
+
+#include "utils/histogram.hpp"
+#include "utils/lrucache.hpp"
+
+namespace porla
+{
+    struct TorrentInfoCacheOptions
+    {
+        // Parsed torrents kept by info hash, so adding one again right after it was removed
+        // does not parse it again.
+        std::size_t capacity          = 64;
+        // Torrent files larger than this are rejected before they are decoded.
+        std::size_t max_size          = 32 * 1024 * 1024;
+        // Bound the work of decoding a torrent file. Parsing cannot be interrupted once it
+        // has started, so these take the place of a timeout.
+        int         max_decode_tokens = 3000000;
+        int         max_pieces        = 0x200000;
+    };
+
+    // Parses torrent files within limits, and keeps the results by info hash. Torrent files
+    // with large piece layers take long to parse, so this is meant to be called off the io
+    // thread. Safe to use from any thread.
+    class TorrentInfoCache
+    {
+    public:
+        enum class Error
+        {
+            None,
+            TooLarge,
+            Decode,
+            Info
+        };
+
+        struct Result
+        {
+            std::shared_ptr<libtorrent::torrent_info> ti;
+            Error                                     error = Error::None;
+            std::string                               message;
+            bool                                      cached = false;
+        };
+
+        struct Stats
+        {
+            std::uint64_t    hits = 0;
+            std::uint64_t    misses = 0;
+            std::uint64_t    rejected = 0;
+            // Seconds spent decoding and parsing each torrent file which was not cached.
+            Utils::Histogram parse_seconds{ParseBounds()};
+        };
+
+        static const std::vector<double>& ParseBounds();
+
+        // Parses the torrent file without the cache.
+        static Result Load(const std::string& data, const TorrentInfoCacheOptions& options);
+
+        explicit TorrentInfoCache(TorrentInfoCacheOptions options = {});
+        TorrentInfoCache(const TorrentInfoCache&) = delete;
+
+        // The torrent is a copy of the cached one every time, since the session may change
+        // the one it is given. A file which differs from the cached one with the same info
+        // hash, such as one with other trackers, is parsed again.
+        Result Parse(const libtorrent::info_hash_t& hash, const std::string& data);
+
+        [[nodiscard]] Stats GetStats() const;
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<const libtorrent::torrent_info> ti;
+            std::size_t                                     size;
+            std::size_t                                     digest;
+        };
+
+        struct Hash
+        {
+            std::size_t operator()(const libtorrent::info_hash_t& hash) const
+            {
+                const auto best = hash.get_best();
+                return std::hash<std::string_view>{}(std::string_view(best.data(), best.size()));
+            }
+        };
+
+        TorrentInfoCacheOptions m_options;
+
+        mutable std::mutex m_mutex;
+        Utils::LruCache<libtorrent::info_hash_t, Entry, Hash> m_cache;
+        Stats m_stats;
+    };
+}
@@ -0,0 +1,302 @@
+#include "torrentorders.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <locale>
+#include <stdexcept>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentOrders;
+
+static const std::locale& CollationLocale()
+{
+    // Falls back to byte order when the environment names a locale that is not installed.
+    static const std::locale locale = []()
+    {
+        try
+        {
+            return std::locale("");
+        }
+        catch (const std::runtime_error&)
+        {
+            return std::locale::classic();
+        }
+    }();
+
+    return locale;
+}
+
+TorrentOrders::TorrentOrders(porla::ISession& session)
+    : m_session(session)
+{
+    for (auto const& [_, ts] : m_session.TorrentStatuses())
+    {
+        Refresh(ts);
+    }
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                // Updates can arrive for torrents that are already removed.
+                if (m_entries.contains(ts.info_hashes)) { Refresh(ts); }
+            }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved(
+        [this](const lt::torrent_handle& th)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+            if (const auto status = statuses.find(th.info_hashes()); status != statuses.end()) { Refresh(status->second); }
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded([this](const lt::torrent_status& ts) { Refresh(ts); });
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents) { Refresh(ts); }
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+}
+
+TorrentOrders::~TorrentOrders()
+{
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+std::optional<TorrentOrders::Field> TorrentOrders::Find(std::string_view name)
+{
+    if (name == "added_time")     return AddedTime;
+    if (name == "name")           return Name;
+    if (name == "progress")       return Progress;
+    if (name == "queue_position") return QueuePosition;
+    if (name == "size")           return Size;
+
+    return std::nullopt;
+}
+
+std::string TorrentOrders::Collate(std::string_view name)
+{
+    const auto& collate = std::use_facet<std::collate<char>>(CollationLocale());
+    return collate.transform(name.data(), name.data() + name.size());
+}
+
+std::int64_t TorrentOrders::Number(Field field, const lt::torrent_status& ts)
+{
+    switch (field)
+    {
+    case AddedTime:
+        return ts.added_time;
+    case Progress:
+        // Non-negative floats order the same as their bits.
+        return std::bit_cast<std::int32_t>(std::max(0.0f, ts.progress));
+    case QueuePosition:
+        return static_cast<int>(ts.queue_position);
+    case Size:
+    {
+        // Parked torrents no longer have the info dict, only its size.
+        const auto ti = ts.torrent_file.lock();
+        return ti ? ti->total_size() : ts.has_metadata ? ts.total_wanted : -1;
+    }
+    default:
+        return 0;
+    }
+}
+
+const std::string* TorrentOrders::NameKey(const lt::info_hash_t& hash) const
+{
+    const auto entry = m_entries.find(hash);
+    return entry == m_entries.end() ? nullptr : &entry->second.name_key;
+}
+
+void TorrentOrders::Walk(Field field, bool asc, const std::optional<After>& after, std::size_t skip, const Visitor& visit) const
+{
+    bool stop = false;
+
+    const auto number = [&]() -> std::optional<std::pair<std::int64_t, lt::info_hash_t>>
+    {
+        if (!after.has_value()) return std::nullopt;
+        return std::pair{ after->number, after->info_hash };
+    };
+
+    switch (field)
+    {
+    case AddedTime: return Walk(m_added_time, asc, number(), skip, stop, visit);
+    case Progress:  return Walk(m_progress, asc, number(), skip, stop, visit);
+    case Size:      return Walk(m_sizes, asc, number(), skip, stop, visit);
+    case Name:
+    {
+        std::optional<std::pair<std::string, lt::info_hash_t>> key;
+        if (after.has_value()) key = std::pair{ Collate(after->name), after->info_hash };
+        return Walk(m_names, asc, key, skip, stop, visit);
+    }
+    case QueuePosition:
+    {
+        const bool after_unqueued = after.has_value() && after->number < 0;
+
+        if (!after_unqueued)
+        {
+            Walk(m_queue_positions, asc, number(), skip, stop, visit);
+        }
+
+        auto it = after_unqueued ? m_unqueued.upper_bound(after->info_hash) : m_unqueued.begin();
+
+        for (; it != m_unqueued.end() && !stop; ++it)
+        {
+            if (skip > 0) { skip--; continue; }
+            stop = !visit(*it);
+        }
+
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+template<typename TOrder, typename TKey>
+void TorrentOrders::Walk(const TOrder& order, bool asc, const std::optional<std::pair<TKey, lt::info_hash_t>>& after, std::size_t& skip, bool& stop, const Visitor& visit)
+{
+    const auto emit = [&](const lt::info_hash_t& hash)
+    {
+        if (skip > 0) { skip--; return true; }
+        stop = !visit(hash);
+        return !stop;
+    };
+
+    if (asc)
+    {
+        for (auto it = after.has_value() ? order.upper_bound(*after) : order.begin(); it != order.end(); ++it)
+        {
+            if (!emit(it->second)) return;
+        }
+
+        return;
+    }
+
+    // Descending by key, but still ascending by hash within a key, so each run of equal
+    // keys is walked forwards, from the last run to the first.
+    auto hi = order.end();
+
+    if (after.has_value())
+    {
+        for (auto it = order.upper_bound(*after); it != order.end() && it->first == after->first; ++it)
+        {
+            if (!emit(it->second)) return;
+        }
+
+        hi = order.lower_bound({ after->first, lt::info_hash_t() });
+    }
+
+    while (hi != order.begin())
+    {
+        const auto lo = order.lower_bound({ std::prev(hi)->first, lt::info_hash_t() });
+
+        for (auto it = lo; it != hi; ++it)
+        {
+            if (!emit(it->second)) return;
+        }
+
+        hi = lo;
+    }
+}
+
+porla::MemoryUsage TorrentOrders::Memory() const
+{
+    // Every set node holds its key and hash plus about four pointers of tree overhead.
+    constexpr std::size_t NodeOverhead = 4 * sizeof(void*);
+
+    MemoryUsage usage{ .objects = m_entries.size() };
+
+    for (const auto& [_, entry] : m_entries)
+    {
+        usage.bytes += sizeof(lt::info_hash_t) + sizeof(Entry) + NodeOverhead
+            + entry.name.capacity() + entry.name_key.capacity()
+            + 4 * (sizeof(std::pair<std::int64_t, lt::info_hash_t>) + NodeOverhead)
+            + sizeof(std::pair<std::string, lt::info_hash_t>) + entry.name_key.capacity() + NodeOverhead;
+    }
+
+    return usage;
+}
+
+void TorrentOrders::Refresh(const lt::torrent_status& ts)
+{
+    Entry entry{
+        .name           = ts.name,
+        .added_time     = Number(AddedTime, ts),
+        .progress       = Number(Progress, ts),
+        .queue_position = Number(QueuePosition, ts),
+        .size           = Number(Size, ts)
+    };
+
+    const auto existing = m_entries.find(ts.info_hashes);
+
+    if (existing != m_entries.end())
+    {
+        const auto& old = existing->second;
+
+        if (old.name == entry.name
+            && old.added_time == entry.added_time
+            && old.progress == entry.progress
+            && old.queue_position == entry.queue_position
+            && old.size == entry.size)
+        {
+            return;
+        }
+
+        // The collation key is the expensive part, so it is kept while the name is.
+        entry.name_key = old.name == entry.name ? old.name_key : Collate(entry.name);
+
+        Erase(existing->first, old);
+        existing->second = std::move(entry);
+        Insert(existing->first, existing->second);
+
+        return;
+    }
+
+    entry.name_key = Collate(entry.name);
+
+    const auto inserted = m_entries.insert({ ts.info_hashes, std::move(entry) }).first;
+    Insert(inserted->first, inserted->second);
+}
+
+void TorrentOrders::Remove(const lt::info_hash_t& hash)
+{
+    const auto entry = m_entries.find(hash);
+    if (entry == m_entries.end()) { return; }
+
+    Erase(entry->first, entry->second);
+    m_entries.erase(entry);
+}
+
+void TorrentOrders::Insert(const lt::info_hash_t& hash, const Entry& entry)
+{
+    m_added_time.insert({ entry.added_time, hash });
+    m_names.insert({ entry.name_key, hash });
+    m_progress.insert({ entry.progress, hash });
+    m_sizes.insert({ entry.size, hash });
+
+    if (entry.queue_position >= 0) m_queue_positions.insert({ entry.queue_position, hash });
+    else                           m_unqueued.insert(hash);
+}
+
+void TorrentOrders::Erase(const lt::info_hash_t& hash, const Entry& entry)
+{
+    m_added_time.erase({ entry.added_time, hash });
+    m_names.erase({ entry.name_key, hash });
+    m_progress.erase({ entry.progress, hash });
+    m_sizes.erase({ entry.size, hash });
+
+    if (entry.queue_position >= 0) m_queue_positions.erase({ entry.queue_position, hash });
+    else                           m_unqueued.erase(hash);
+}
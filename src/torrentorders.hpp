@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "memoryusage.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Every torrent kept in order of added time, name, progress, queue position and size,
+    // updated as their statuses change, so a sorted page of all torrents is read off the
+    // order instead of sorting them. Ties are broken on info hash, ascending in both
+    // directions, as torrents.list does. Names are ordered by their collation key in the
+    // locale of the environment, computed once per name.
+    class TorrentOrders
+    {
+    public:
+        enum Field
+        {
+            AddedTime,
+            Name,
+            Progress,
+            QueuePosition,
+            Size,
+            FieldCount
+        };
+
+        // The position to continue after, as a cursor gives it.
+        struct After
+        {
+            std::string             name;
+            std::int64_t            number;
+            libtorrent::info_hash_t info_hash;
+        };
+
+        // Returns false to stop.
+        typedef std::function<bool(const libtorrent::info_hash_t&)> Visitor;
+
+        explicit TorrentOrders(ISession& session);
+        TorrentOrders(const TorrentOrders&) = delete;
+
+        ~TorrentOrders();
+
+        [[nodiscard]] static std::optional<Field> Find(std::string_view name);
+        [[nodiscard]] static std::string Collate(std::string_view name);
+
+        // The value a field is ordered by, for building an After from a cursor.
+        [[nodiscard]] static std::int64_t Number(Field field, const libtorrent::torrent_status& ts);
+
+        [[nodiscard]] const std::string* NameKey(const libtorrent::info_hash_t& hash) const;
+        [[nodiscard]] std::size_t Size() const { return m_entries.size(); }
+
+        // Visits the torrents in order, starting after the given position, if any, or
+        // skipping the first few. Torrents without a queue position come last by hash.
+        void Walk(Field field, bool asc, const std::optional<After>& after, std::size_t skip, const Visitor& visit) const;
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+    private:
+        struct Entry
+        {
+            std::string  name;
+            std::string  name_key;
+            std::int64_t added_time;
+            std::int64_t progress;
+            std::int64_t queue_position;
+            std::int64_t size;
+        };
+
+        typedef std::set<std::pair<std::int64_t, libtorrent::info_hash_t>> NumberOrder;
+        typedef std::set<std::pair<std::string, libtorrent::info_hash_t>> NameOrder;
+
+        template<typename TOrder, typename TKey>
+        static void Walk(const TOrder& order, bool asc, const std::optional<std::pair<TKey, libtorrent::info_hash_t>>& after, std::size_t& skip, bool& stop, const Visitor& visit);
+
+        void Refresh(const libtorrent::torrent_status& ts);
+        void Remove(const libtorrent::info_hash_t& hash);
+        void Insert(const libtorrent::info_hash_t& hash, const Entry& entry);
+        void Erase(const libtorrent::info_hash_t& hash, const Entry& entry);
+
+        ISession& m_session;
+
+        std::map<libtorrent::info_hash_t, Entry> m_entries;
+        NumberOrder m_added_time;
+        NameOrder   m_names;
+        NumberOrder m_progress;
+        NumberOrder m_queue_positions;
+        // Torrents with no queue position, as seeding ones, by hash.
+        std::set<libtorrent::info_hash_t> m_unqueued;
+        NumberOrder m_sizes;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
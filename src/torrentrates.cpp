@@ -0,0 +1,153 @@
+#include "torrentrates.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentRates;
+
+// Estimates closer than this to the last rate, in bytes per second, are snapped to it.
+static constexpr double SettledWithin = 0.5;
+
+TorrentRates::TorrentRates(porla::ISession& session, TorrentRatesOptions options)
+    : m_session(session)
+    , m_tau(std::max(1.0, static_cast<double>(options.half_life.count())) / std::log(2.0))
+{
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            Sample(torrents, std::chrono::steady_clock::now());
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            m_estimates.erase(hash);
+            m_settling.erase(hash);
+        });
+}
+
+TorrentRates::~TorrentRates()
+{
+    m_stateUpdateConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+TorrentRates::Rate TorrentRates::Get(const lt::info_hash_t& hash) const
+{
+    const auto estimate = m_estimates.find(hash);
+    return estimate != m_estimates.end() ? estimate->second.rate : Rate{};
+}
+
+std::chrono::seconds TorrentRates::ETA(const lt::torrent_status& ts) const
+{
+    const auto remaining = ts.total_wanted - ts.total_wanted_done;
+    const auto rate = Get(ts.info_hashes).download;
+
+    // Less than a byte a second is a stalled torrent on its way down to zero.
+    if (remaining <= 0 || rate < 1)
+    {
+        return std::chrono::seconds(-1);
+    }
+
+    return std::chrono::seconds(static_cast<std::int64_t>(static_cast<double>(remaining) / rate));
+}
+
+double TorrentRates::Download(const lt::torrent_status& ts) const
+{
+    return Get(ts.info_hashes).download;
+}
+
+double TorrentRates::Upload(const lt::torrent_status& ts) const
+{
+    return Get(ts.info_hashes).upload;
+}
+
+void TorrentRates::Sample(const std::vector<lt::torrent_status>& torrents, std::chrono::steady_clock::time_point now)
+{
+    const auto& statuses = m_session.TorrentStatuses();
+
+    for (const auto& ts : torrents)
+    {
+        // Updates can name torrents which were removed after libtorrent posted them.
+        if (!statuses.contains(ts.info_hashes))
+        {
+            continue;
+        }
+
+        const Rate rate{
+            .download = static_cast<double>(ts.download_payload_rate),
+            .upload   = static_cast<double>(ts.upload_payload_rate)
+        };
+
+        auto [it, inserted] = m_estimates.insert({ ts.info_hashes, Estimate{ .rate = rate, .last = rate, .updated = now } });
+
+        if (!inserted)
+        {
+            Advance(it->second, rate, now);
+            it->second.last = rate;
+        }
+
+        m_settling.insert(ts.info_hashes);
+    }
+
+    // The ones in this update were advanced already, and are only checked for settling.
+    for (auto it = m_settling.begin(); it != m_settling.end();)
+    {
+        const auto estimate = m_estimates.find(*it);
+
+        if (estimate == m_estimates.end())
+        {
+            it = m_settling.erase(it);
+            continue;
+        }
+
+        auto& e = estimate->second;
+
+        if (e.updated != now)
+        {
+            Advance(e, e.last, now);
+        }
+
+        if (std::abs(e.rate.download - e.last.download) < SettledWithin
+            && std::abs(e.rate.upload - e.last.upload) < SettledWithin)
+        {
+            e.rate = e.last;
+            it = m_settling.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+}
+
+porla::MemoryUsage TorrentRates::Memory() const
+{
+    // Every map and set node holds its key and value plus about four pointers of tree overhead.
+    constexpr std::size_t NodeOverhead = 4 * sizeof(void*);
+
+    return MemoryUsage{
+        .bytes   = m_estimates.size() * (sizeof(lt::info_hash_t) + sizeof(Estimate) + NodeOverhead)
+                 + m_settling.size() * (sizeof(lt::info_hash_t) + NodeOverhead),
+        .objects = m_estimates.size()
+    };
+}
+
+void TorrentRates::Advance(Estimate& estimate, const Rate& rate, std::chrono::steady_clock::time_point now) const
+{
+    const double elapsed = std::chrono::duration<double>(now - estimate.updated).count();
+
+    if (elapsed <= 0)
+    {
+        return;
+    }
+
+    const double alpha = 1 - std::exp(-elapsed / m_tau);
+
+    estimate.rate.download += alpha * (rate.download - estimate.rate.download);
+    estimate.rate.upload   += alpha * (rate.upload - estimate.rate.upload);
+    estimate.updated = now;
+}
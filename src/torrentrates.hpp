@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "memoryusage.hpp"
+#include "query/pql.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct TorrentRatesOptions
+    {
+        // How long it takes the estimate to cover half of the way to a new rate.
+        std::chrono::seconds half_life = std::chrono::seconds(10);
+    };
+
+    // Exponentially weighted payload rates for every torrent, updated on state updates
+    // with a weight for the time since the last one, so the estimate does not depend on
+    // how often updates come. Torrents drop out of the updates once their rate stops
+    // changing, so the ones whose estimate has not caught up with their last rate are
+    // moved along on every update too. Reading an estimate is a lookup.
+    class TorrentRates : public Query::PQL::Rates
+    {
+    public:
+        struct Rate
+        {
+            double download = 0;
+            double upload   = 0;
+        };
+
+        explicit TorrentRates(ISession& session, TorrentRatesOptions options = {});
+        TorrentRates(const TorrentRates&) = delete;
+
+        ~TorrentRates() override;
+
+        // Zero for torrents without an estimate yet.
+        [[nodiscard]] Rate Get(const libtorrent::info_hash_t& hash) const;
+        // Like Utils::ETA, from the estimated download rate.
+        [[nodiscard]] std::chrono::seconds ETA(const libtorrent::torrent_status& ts) const;
+
+        [[nodiscard]] double Download(const libtorrent::torrent_status& ts) const override;
+        [[nodiscard]] double Upload(const libtorrent::torrent_status& ts) const override;
+
+        // Folds the statuses in as of now, which state updates do on the io thread.
+        void Sample(const std::vector<libtorrent::torrent_status>& torrents, std::chrono::steady_clock::time_point now);
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+    private:
+        struct Estimate
+        {
+            Rate rate;
+            // The instantaneous rates of the last update.
+            Rate last;
+            std::chrono::steady_clock::time_point updated;
+        };
+
+        // Moves the estimate towards the given rates, as if they held since its last update.
+        void Advance(Estimate& estimate, const Rate& rate, std::chrono::steady_clock::time_point now) const;
+
+        ISession& m_session;
+        // The time constant, from the half life.
+        double m_tau;
+        std::map<libtorrent::info_hash_t, Estimate> m_estimates;
+        // Torrents whose estimate is still away from their last rate.
+        std::set<libtorrent::info_hash_t> m_settling;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+namespace porla
+{
+    // Torrents keyed by info hash, stored densely in a vector and indexed by an open
+    // addressing table with linear probing. Lookups touch one or two slots and the entry
+    // itself, and iteration walks contiguous memory. The interface follows std::map where
+    // the session needs it, except that iteration is in insertion order, and erasing moves
+    // the last torrent into the erased one's place. Iterators stay valid across lookups
+    // and growth of the index, but not across inserts or erases.
+    template<typename TValue>
+    class TorrentRegistry
+    {
+    public:
+        typedef std::pair<libtorrent::info_hash_t, TValue>       value_type;
+        typedef typename std::vector<value_type>::iterator       iterator;
+        typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+        iterator begin() { return m_items.begin(); }
+        iterator end() { return m_items.end(); }
+        const_iterator begin() const { return m_items.begin(); }
+        const_iterator end() const { return m_items.end(); }
+
+        [[nodiscard]] bool empty() const { return m_items.empty(); }
+        [[nodiscard]] std::size_t size() const { return m_items.size(); }
+
+        // Changes whenever a torrent is added, replaced or erased, so copies of the registry
+        // can tell whether they are still current.
+        [[nodiscard]] std::uint64_t version() const { return m_version; }
+
+        void clear()
+        {
+            m_items.clear();
+            m_slots.clear();
+            m_version++;
+        }
+
+        void reserve(std::size_t count)
+        {
+            m_items.reserve(count);
+
+            if (count * 2 > m_slots.size())
+            {
+                Rehash(count * 2);
+            }
+        }
+
+        [[nodiscard]] bool contains(const libtorrent::info_hash_t& key) const
+        {
+            return Find(key) != Npos;
+        }
+
+        iterator find(const libtorrent::info_hash_t& key)
+        {
+            const auto slot = Find(key);
+            return slot == Npos ? end() : begin() + m_slots[slot].index;
+        }
+
+        const_iterator find(const libtorrent::info_hash_t& key) const
+        {
+            const auto slot = Find(key);
+            return slot == Npos ? end() : begin() + m_slots[slot].index;
+        }
+
+        TValue& at(const libtorrent::info_hash_t& key)
+        {
+            const auto slot = Find(key);
+            if (slot == Npos) throw std::out_of_range("torrent not found");
+            return m_items[m_slots[slot].index].second;
+        }
+
+        const TValue& at(const libtorrent::info_hash_t& key) const
+        {
+            const auto slot = Find(key);
+            if (slot == Npos) throw std::out_of_range("torrent not found");
+            return m_items[m_slots[slot].index].second;
+        }
+
+        TValue& operator[](const libtorrent::info_hash_t& key)
+        {
+            return insert({ key, TValue{} }).first->second;
+        }
+
+        std::pair<iterator, bool> insert(value_type item)
+        {
+            if (const auto slot = Find(item.first); slot != Npos)
+            {
+                return { begin() + m_slots[slot].index, false };
+            }
+
+            return { Append(std::move(item)), true };
+        }
+
+        std::pair<iterator, bool> insert_or_assign(const libtorrent::info_hash_t& key, TValue value)
+        {
+            if (const auto slot = Find(key); slot != Npos)
+            {
+                auto item = begin() + m_slots[slot].index;
+                item->second = std::move(value);
+                m_version++;
+                return { item, false };
+            }
+
+            return { Append({ key, std::move(value) }), true };
+        }
+
+        std::size_t erase(const libtorrent::info_hash_t& key)
+        {
+            const auto slot = Find(key);
+
+            if (slot == Npos)
+            {
+                return 0;
+            }
+
+            Remove(slot);
+
+            return 1;
+        }
+
+        // Returns an iterator to the torrent moved into the erased one's place, so loops
+        // erasing while iterating see every torrent.
+        iterator erase(const_iterator pos)
+        {
+            const auto index = static_cast<std::size_t>(pos - m_items.cbegin());
+
+            Remove(Slot(pos->first, static_cast<std::uint32_t>(index)));
+
+            return begin() + static_cast<std::ptrdiff_t>(index);
+        }
+
+    private:
+        struct Entry
+        {
+            std::uint32_t index;
+            // The low bits of the hash, compared before the key and used to find where an
+            // entry would ideally sit.
+            std::uint32_t hash;
+        };
+
+        static constexpr std::uint32_t Empty = UINT32_MAX;
+        static constexpr std::size_t   Npos  = SIZE_MAX;
+
+        // Info hashes are uniformly distributed, so a few of their bytes will do.
+        static std::uint32_t Hash(const libtorrent::info_hash_t& key)
+        {
+            std::uint32_t v1;
+            std::uint32_t v2;
+
+            std::memcpy(&v1, key.v1.data(), sizeof(v1));
+            std::memcpy(&v2, key.v2.data(), sizeof(v2));
+
+            return v1 ^ v2;
+        }
+
+        [[nodiscard]] std::size_t Mask() const { return m_slots.size() - 1; }
+
+        [[nodiscard]] std::size_t Find(const libtorrent::info_hash_t& key) const
+        {
+            if (m_slots.empty())
+            {
+                return Npos;
+            }
+
+            const auto hash = Hash(key);
+
+            for (std::size_t slot = hash & Mask(); m_slots[slot].index != Empty; slot = (slot + 1) & Mask())
+            {
+                if (m_slots[slot].hash == hash && m_items[m_slots[slot].index].first == key)
+                {
+                    return slot;
+                }
+            }
+
+            return Npos;
+        }
+
+        // The slot pointing at a given item, which is known to be there.
+        [[nodiscard]] std::size_t Slot(const libtorrent::info_hash_t& key, std::uint32_t index) const
+        {
+            std::size_t slot = Hash(key) & Mask();
+
+            while (m_slots[slot].index != index)
+            {
+                slot = (slot + 1) & Mask();
+            }
+
+            return slot;
+        }
+
+        iterator Append(value_type item)
+        {
+            // Keeps the index at most half full, so probe sequences stay short.
+            if ((m_items.size() + 1) * 2 > m_slots.size())
+            {
+                Rehash(std::max<std::size_t>(16, m_slots.size() * 2));
+            }
+
+            const auto index = static_cast<std::uint32_t>(m_items.size());
+            const auto hash  = Hash(item.first);
+
+            m_items.push_back(std::move(item));
+
+            std::size_t slot = hash & Mask();
+            while (m_slots[slot].index != Empty) slot = (slot + 1) & Mask();
+
+            m_slots[slot] = Entry{ .index = index, .hash = hash };
+            m_version++;
+
+            return begin() + index;
+        }
+
+        void Rehash(std::size_t capacity)
+        {
+            std::size_t size = 16;
+            while (size < capacity) size *= 2;
+
+            m_slots.assign(size, Entry{ .index = Empty, .hash = 0 });
+
+            for (std::size_t i = 0; i < m_items.size(); i++)
+            {
+                const auto hash = Hash(m_items[i].first);
+
+                std::size_t slot = hash & Mask();
+                while (m_slots[slot].index != Empty) slot = (slot + 1) & Mask();
+
+                m_slots[slot] = Entry{ .index = static_cast<std::uint32_t>(i), .hash = hash };
+            }
+        }
+
+        void Remove(std::size_t slot)
+        {
+            const auto index = m_slots[slot].index;
+            const auto last  = static_cast<std::uint32_t>(m_items.size() - 1);
+
+            // Shifts back the entries after the removed one which would otherwise no
+            // longer be reachable from where they ideally sit.
+            std::size_t hole = slot;
+
+            for (std::size_t next = (hole + 1) & Mask(); m_slots[next].index != Empty; next = (next + 1) & Mask())
+            {
+                const std::size_t ideal = m_slots[next].hash & Mask();
+
+                const bool reachable = hole <= next
+                    ? (hole < ideal && ideal <= next)
+                    : (hole < ideal || ideal <= next);
+
+                if (reachable)
+                {
+                    continue;
+                }
+
+                m_slots[hole] = m_slots[next];
+                hole = next;
+            }
+
+            m_slots[hole].index = Empty;
+
+            if (index != last)
+            {
+                m_slots[Slot(m_items[last].first, last)].index = index;
+                m_items[index] = std::move(m_items[last]);
+            }
+
+            m_items.pop_back();
+            m_version++;
+        }
+
+        std::vector<value_type> m_items;
+        std::vector<Entry>      m_slots;
+        std::uint64_t           m_version = 0;
+    };
+}
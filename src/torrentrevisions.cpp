@@ -0,0 +1,110 @@
+#include "torrentrevisions.hpp"
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentRevisions;
+
+TorrentRevisions::TorrentRevisions(porla::ISession& session, std::size_t max_removed)
+    : m_session(session)
+    , m_max_removed(max_removed)
+    , m_current(0)
+    , m_removed_horizon(0)
+{
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (auto const& ts : torrents) { Changed(ts.info_hashes); }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved([this](auto const& th) { Changed(th.info_hashes()); });
+    m_torrentAddedConnection = m_session.OnTorrentAdded([this](auto const& ts) { Changed(ts.info_hashes); });
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents) { Changed(ts.info_hashes); }
+        });
+    m_clientDataChangedConnection = m_session.OnClientDataChanged(
+        [this](const std::vector<lt::info_hash_t>& hashes)
+        {
+            for (const auto& hash : hashes) { Changed(hash); }
+        });
+    m_torrentFinishedConnection = m_session.OnTorrentFinished([this](auto const& ts) { Changed(ts.info_hashes); });
+    m_torrentPausedConnection = m_session.OnTorrentPaused([this](auto const& th) { Changed(th.info_hashes()); });
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Removed(hash); });
+    m_torrentResumedConnection = m_session.OnTorrentResumed([this](auto const& ts) { Changed(ts.info_hashes); });
+}
+
+TorrentRevisions::~TorrentRevisions()
+{
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_clientDataChangedConnection.disconnect();
+    m_torrentFinishedConnection.disconnect();
+    m_torrentPausedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+    m_torrentResumedConnection.disconnect();
+}
+
+void TorrentRevisions::ChangedSince(std::uint64_t revision, const std::function<void(const lt::info_hash_t&)>& cb) const
+{
+    for (auto it = m_changed_by_revision.upper_bound(revision); it != m_changed_by_revision.end(); ++it)
+    {
+        cb(it->second);
+    }
+}
+
+bool TorrentRevisions::RemovedSince(std::uint64_t revision, const std::function<void(const lt::info_hash_t&)>& cb) const
+{
+    if (revision < m_removed_horizon)
+    {
+        return false;
+    }
+
+    for (auto it = m_removed_by_revision.upper_bound(revision); it != m_removed_by_revision.end(); ++it)
+    {
+        cb(it->second);
+    }
+
+    return true;
+}
+
+void TorrentRevisions::Changed(const lt::info_hash_t& hash)
+{
+    const std::uint64_t revision = ++m_current;
+
+    if (auto it = m_changed.find(hash); it != m_changed.end())
+    {
+        m_changed_by_revision.erase(it->second);
+        it->second = revision;
+    }
+    else
+    {
+        m_changed.insert({ hash, revision });
+    }
+
+    m_changed_by_revision.insert({ revision, hash });
+}
+
+void TorrentRevisions::Removed(const lt::info_hash_t& hash)
+{
+    const std::uint64_t revision = ++m_current;
+
+    if (auto it = m_changed.find(hash); it != m_changed.end())
+    {
+        m_changed_by_revision.erase(it->second);
+        m_changed.erase(it);
+    }
+
+    m_removed_by_revision.insert({ revision, hash });
+
+    // Forget the oldest removals. Clients older than that have to do a full refresh.
+    while (m_removed_by_revision.size() > m_max_removed)
+    {
+        m_removed_horizon = m_removed_by_revision.begin()->first;
+        m_removed_by_revision.erase(m_removed_by_revision.begin());
+    }
+}
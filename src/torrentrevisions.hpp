@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Keeps a monotonic revision for the session and the revision each torrent last changed
+    // in, so clients can ask for what changed since a revision they have already seen.
+    class TorrentRevisions
+    {
+    public:
+        explicit TorrentRevisions(ISession& session, std::size_t max_removed = 10000);
+        TorrentRevisions(const TorrentRevisions&) = delete;
+
+        ~TorrentRevisions();
+
+        [[nodiscard]] std::uint64_t Current() const { return m_current; }
+
+        // Calls cb for every torrent changed after the given revision.
+        void ChangedSince(std::uint64_t revision, const std::function<void(const libtorrent::info_hash_t&)>& cb) const;
+
+        // Calls cb for every torrent removed after the given revision. Returns false if
+        // removals that old are no longer known, in which case the client needs a full refresh.
+        bool RemovedSince(std::uint64_t revision, const std::function<void(const libtorrent::info_hash_t&)>& cb) const;
+
+    private:
+        void Changed(const libtorrent::info_hash_t& hash);
+        void Removed(const libtorrent::info_hash_t& hash);
+
+        ISession& m_session;
+        std::size_t m_max_removed;
+
+        std::uint64_t m_current;
+        std::uint64_t m_removed_horizon;
+
+        std::map<libtorrent::info_hash_t, std::uint64_t> m_changed;
+        std::map<std::uint64_t, libtorrent::info_hash_t> m_changed_by_revision;
+        std::map<std::uint64_t, libtorrent::info_hash_t> m_removed_by_revision;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_clientDataChangedConnection;
+        porla::Utils::Connection m_torrentFinishedConnection;
+        porla::Utils::Connection m_torrentPausedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+        porla::Utils::Connection m_torrentResumedConnection;
+    };
+}
@@ -0,0 +1,211 @@
+#include "torrentsarchivehandler.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/hex.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "session.hpp"
+#include "utils/archivestream.hpp"
+
+namespace fs = std::filesystem;
+namespace http = boost::beast::http;
+namespace lt = libtorrent;
+
+using porla::TorrentsArchiveHandler;
+using porla::Utils::ArchiveStream;
+
+static void WriteError(const std::shared_ptr<porla::HttpContext>& ctx, http::status status, const std::string& body)
+{
+    http::response<http::string_body> res{status, ctx->Request().version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "text/plain");
+    res.keep_alive(ctx->Request().keep_alive());
+    res.body() = body;
+    res.prepare_payload();
+
+    ctx->Write(std::move(res));
+}
+
+// Either hash of a hybrid torrent finds it.
+static const lt::torrent_status* Find(porla::ISession& session, const std::string& hex)
+{
+    lt::info_hash_t key;
+
+    if (hex.size() == 40)
+    {
+        if (!lt::aux::from_hex(hex, key.v1.data())) return nullptr;
+    }
+    else if (hex.size() == 64)
+    {
+        if (!lt::aux::from_hex(hex, key.v2.data())) return nullptr;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    const auto& statuses = session.TorrentStatuses();
+
+    if (const auto status = statuses.find(key); status != statuses.end())
+    {
+        return &status->second;
+    }
+
+    for (const auto& [hash, status] : statuses)
+    {
+        if ((key.has_v1() && hash.v1 == key.v1) || (key.has_v2() && hash.v2 == key.v2))
+        {
+            return &status;
+        }
+    }
+
+    return nullptr;
+}
+
+static std::int64_t ModifiedTime(const fs::path& path)
+{
+    std::error_code ec;
+    const auto modified = fs::last_write_time(path, ec);
+
+    if (ec)
+    {
+        return 0;
+    }
+
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::file_clock::to_sys(modified).time_since_epoch()).count();
+}
+
+TorrentsArchiveHandler::TorrentsArchiveHandler(porla::ISession& session)
+    : m_session(session)
+{
+}
+
+void TorrentsArchiveHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    const auto& query = ctx->RequestUri().query;
+
+    const auto info_hash = query.find("info_hash");
+    const auto format_param = query.find("format");
+    const auto path_param = query.find("path");
+
+    if (info_hash == query.end())
+    {
+        return WriteError(ctx, http::status::bad_request, "'info_hash' is required");
+    }
+
+    auto format = ArchiveStream::Format::Zip;
+
+    if (format_param != query.end() && format_param->second == "tar")
+    {
+        format = ArchiveStream::Format::Tar;
+    }
+    else if (format_param != query.end() && format_param->second != "zip")
+    {
+        return WriteError(ctx, http::status::bad_request, "'format' is either 'zip' or 'tar'");
+    }
+
+    // Without chunked encoding the whole archive would be held in memory.
+    if (ctx->Request().version() < 11)
+    {
+        return WriteError(ctx, http::status::http_version_not_supported, "Archives are only streamed over HTTP/1.1");
+    }
+
+    const auto status = Find(m_session, info_hash->second);
+
+    if (status == nullptr)
+    {
+        return WriteError(ctx, http::status::not_found, "Torrent not found");
+    }
+
+    const auto ti = status->torrent_file.lock();
+
+    if (!ti)
+    {
+        return WriteError(ctx, http::status::not_found, "The torrent has no metadata yet");
+    }
+
+    // Matched against whole directories, so "a" does not pick the files of "ab".
+    std::string prefix;
+
+    if (path_param != query.end() && !path_param->second.empty())
+    {
+        prefix = fs::path(path_param->second).lexically_normal().generic_string();
+        if (!prefix.ends_with('/')) prefix.push_back('/');
+    }
+
+    const auto& files = ti->files();
+
+    std::vector<lt::file_index_t> indices;
+    std::vector<ArchiveStream::Entry> entries;
+
+    for (const auto index : files.file_range())
+    {
+        if (files.pad_file_at(index))
+        {
+            continue;
+        }
+
+        auto name = fs::path(files.file_path(index)).generic_string();
+
+        if (!prefix.empty() && !name.starts_with(prefix))
+        {
+            continue;
+        }
+
+        const auto path = fs::path(files.file_path(index, status->save_path));
+
+        indices.push_back(index);
+        entries.push_back(ArchiveStream::Entry{
+            .name  = std::move(name),
+            .path  = path,
+            .size  = static_cast<std::uint64_t>(files.file_size(index)),
+            .mtime = ModifiedTime(path)
+        });
+    }
+
+    if (entries.empty())
+    {
+        return WriteError(ctx, http::status::not_found, "No files found");
+    }
+
+    m_session.FileProgress(
+        status->info_hashes,
+        [ctx, format, indices = std::move(indices), entries = std::move(entries)](const porla::ISession::FileProgressList& progress) mutable
+        {
+            for (std::size_t i = 0; i < indices.size(); i++)
+            {
+                const auto index = static_cast<std::size_t>(static_cast<int>(indices[i]));
+
+                // The headers are written before the data, so every size has to be final.
+                if (!progress || index >= progress->size() || static_cast<std::uint64_t>(progress->at(index)) < entries[i].size)
+                {
+                    return WriteError(ctx, http::status::conflict, "The files are not downloaded yet");
+                }
+            }
+
+            BOOST_LOG_TRIVIAL(info) << "Streaming " << entries.size() << " files as an archive";
+
+            auto stream = std::make_shared<ArchiveStream>(format, std::move(entries));
+
+            ctx->WriteChunked(
+                format == ArchiveStream::Format::Zip ? "application/zip" : "application/x-tar",
+                [stream](std::string& chunk)
+                {
+                    try
+                    {
+                        return stream->Next(chunk);
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        // The headers are already sent, so the archive ends early instead.
+                        BOOST_LOG_TRIVIAL(error) << "Failed to stream archive: " << ex.what();
+                        return false;
+                    }
+                });
+        });
+}
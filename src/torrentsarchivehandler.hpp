@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Streams the downloaded files of a torrent, picked by the info_hash query parameter,
+    // as a stored zip or a tar archive with format=zip|tar. With path set, only the files
+    // under that directory of the torrent are included. The archive is written as it is
+    // sent, so it is never held in memory or on disk.
+    class TorrentsArchiveHandler
+    {
+    public:
+        explicit TorrentsArchiveHandler(ISession& session);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        ISession& m_session;
+    };
+}
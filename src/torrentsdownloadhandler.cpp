@@ -0,0 +1,376 @@
+#include "torrentsdownloadhandler.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <map>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/hex.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "piecestreams.hpp"
+#include "session.hpp"
+#include "utils/byterange.hpp"
+
+namespace fs = std::filesystem;
+namespace http = boost::beast::http;
+namespace lt = libtorrent;
+
+using porla::TorrentsDownloadHandler;
+using porla::Utils::ByteRange;
+
+static void WriteError(const std::shared_ptr<porla::HttpContext>& ctx, http::status status, const std::string& body)
+{
+    http::response<http::string_body> res{status, ctx->Request().version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "text/plain");
+    res.keep_alive(ctx->Request().keep_alive());
+    res.body() = body;
+    res.prepare_payload();
+
+    ctx->Write(std::move(res));
+}
+
+static std::string ContentType(const fs::path& path)
+{
+    static const std::map<std::string, std::string> Types =
+    {
+        {".avi",  "video/x-msvideo"},
+        {".flac", "audio/flac"},
+        {".gif",  "image/gif"},
+        {".jpeg", "image/jpeg"},
+        {".jpg",  "image/jpeg"},
+        {".m4a",  "audio/mp4"},
+        {".mkv",  "video/x-matroska"},
+        {".mp3",  "audio/mpeg"},
+        {".mp4",  "video/mp4"},
+        {".nfo",  "text/plain"},
+        {".ogg",  "audio/ogg"},
+        {".pdf",  "application/pdf"},
+        {".png",  "image/png"},
+        {".srt",  "text/plain"},
+        {".txt",  "text/plain"},
+        {".webm", "video/webm"},
+        {".zip",  "application/zip"},
+    };
+
+    auto extension = path.extension().string();
+    for (auto& c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    const auto type = Types.find(extension);
+    return type != Types.end() ? type->second : "application/octet-stream";
+}
+
+static std::string HttpDate(std::time_t time)
+{
+    std::tm tm = {};
+    gmtime_r(&time, &tm);
+
+    char buffer[64];
+    const auto size = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+    return {buffer, size};
+}
+
+// For the filename parameter of Content-Disposition, as in RFC 6266.
+static std::string PercentEncode(const std::string& value)
+{
+    static constexpr char Hex[] = "0123456789ABCDEF";
+
+    std::string out;
+
+    for (const auto c : value)
+    {
+        const auto u = static_cast<unsigned char>(c);
+
+        if (std::isalnum(u) || c == '-' || c == '.' || c == '_' || c == '~')
+        {
+            out.push_back(c);
+            continue;
+        }
+
+        out.push_back('%');
+        out.push_back(Hex[u >> 4]);
+        out.push_back(Hex[u & 0x0f]);
+    }
+
+    return out;
+}
+
+// Either hash of a hybrid torrent finds it.
+static const lt::torrent_status* Find(porla::ISession& session, const std::string& hex)
+{
+    lt::info_hash_t key;
+
+    if (hex.size() == 40)
+    {
+        if (!lt::aux::from_hex(hex, key.v1.data())) return nullptr;
+    }
+    else if (hex.size() == 64)
+    {
+        if (!lt::aux::from_hex(hex, key.v2.data())) return nullptr;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    const auto& statuses = session.TorrentStatuses();
+
+    if (const auto status = statuses.find(key); status != statuses.end())
+    {
+        return &status->second;
+    }
+
+    for (const auto& [hash, status] : statuses)
+    {
+        if ((key.has_v1() && hash.v1 == key.v1) || (key.has_v2() && hash.v2 == key.v2))
+        {
+            return &status;
+        }
+    }
+
+    return nullptr;
+}
+
+// The file being served.
+struct Download
+{
+    fs::path     path;
+    std::string  name;
+    std::int64_t size;
+    std::string  tag;
+};
+
+static bool OpenFile(const Download& download, boost::beast::file& file)
+{
+    boost::beast::error_code ec;
+    file.open(download.path.c_str(), boost::beast::file_mode::scan, ec);
+
+    if (ec)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to open " << download.path << " for download: " << ec.message();
+        return false;
+    }
+
+    return true;
+}
+
+static void Respond(
+    const std::shared_ptr<porla::HttpContext>& ctx,
+    const Download& download,
+    boost::beast::file file,
+    ByteRange::Result result,
+    const ByteRange& range,
+    const std::string& etag,
+    const std::string& last_modified,
+    porla::HttpContext::FileAvailability available)
+{
+    const auto& req = ctx->Request();
+
+    http::response<http::empty_body> res{
+        result == ByteRange::Result::Partial ? http::status::partial_content : http::status::ok,
+        req.version()};
+
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::accept_ranges, "bytes");
+    res.set(http::field::content_disposition, "inline; filename*=UTF-8''" + PercentEncode(download.name));
+    res.set(http::field::content_type, ContentType(download.path));
+    res.set(http::field::etag, etag);
+    res.keep_alive(req.keep_alive());
+
+    if (!last_modified.empty())
+    {
+        res.set(http::field::last_modified, last_modified);
+    }
+
+    if (result == ByteRange::Result::Partial)
+    {
+        res.set(
+            http::field::content_range,
+            "bytes " + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1) + "/" + std::to_string(download.size));
+    }
+
+    ctx->WriteFile(std::move(res), std::move(file), range.offset, range.length, std::move(available));
+}
+
+// Files which are still downloading are served with available set, which says how much
+// of them can be read.
+static void Serve(const std::shared_ptr<porla::HttpContext>& ctx, const Download& download, porla::HttpContext::FileAvailability available)
+{
+    const auto& req = ctx->Request();
+    const auto size = static_cast<std::uint64_t>(download.size);
+
+    // The content of a torrent is fixed by its info hash, so the tag stays the same while
+    // the file downloads.
+    const std::string etag = "\"" + download.tag + "\"";
+
+    boost::beast::file file;
+    std::string last_modified;
+
+    if (!available)
+    {
+        std::error_code ec;
+        const auto modified = fs::last_write_time(download.path, ec);
+
+        if (ec || !OpenFile(download, file))
+        {
+            return WriteError(ctx, http::status::not_found, "The file could not be opened");
+        }
+
+        last_modified = HttpDate(std::chrono::system_clock::to_time_t(
+            std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+                std::chrono::file_clock::to_sys(modified))));
+    }
+
+    if (const auto if_none_match = req.find(http::field::if_none_match); if_none_match != req.end()
+        && (if_none_match->value() == etag || if_none_match->value() == "*"))
+    {
+        http::response<http::string_body> res{http::status::not_modified, req.version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::etag, etag);
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return ctx->Write(std::move(res));
+    }
+
+    ByteRange range{ .offset = 0, .length = size };
+    auto result = ByteRange::Result::Full;
+
+    if (const auto header = req.find(http::field::range); header != req.end())
+    {
+        const auto if_range = req.find(http::field::if_range);
+
+        // A range for another version of the file gets the whole of this one.
+        if (if_range == req.end()
+            || if_range->value() == etag
+            || (!last_modified.empty() && if_range->value() == last_modified))
+        {
+            result = ByteRange::Parse({header->value().data(), header->value().size()}, size, range);
+        }
+    }
+
+    if (result == ByteRange::Result::Unsatisfiable)
+    {
+        http::response<http::string_body> res{http::status::range_not_satisfiable, req.version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::content_range, "bytes */" + std::to_string(size));
+        res.keep_alive(req.keep_alive());
+        res.prepare_payload();
+        return ctx->Write(std::move(res));
+    }
+
+    if (!available)
+    {
+        return Respond(ctx, download, std::move(file), result, range, etag, last_modified, nullptr);
+    }
+
+    // The file may not be on disk before its first piece is, so it is opened once the start
+    // of the range can be read.
+    available(
+        range.offset,
+        [ctx, download, result, range, etag, available](std::uint64_t bytes)
+        {
+            boost::beast::file file;
+
+            if (bytes == 0)
+            {
+                return WriteError(ctx, http::status::service_unavailable, "The file is not downloaded yet");
+            }
+
+            if (!OpenFile(download, file))
+            {
+                return WriteError(ctx, http::status::not_found, "The file could not be opened");
+            }
+
+            Respond(ctx, download, std::move(file), result, range, etag, "", available);
+        });
+}
+
+TorrentsDownloadHandler::TorrentsDownloadHandler(porla::ISession& session, porla::PieceStreams* streams)
+    : m_session(session)
+    , m_streams(streams)
+{
+}
+
+void TorrentsDownloadHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    const auto& query = ctx->RequestUri().query;
+
+    const auto info_hash = query.find("info_hash");
+    const auto index_param = query.find("index");
+
+    int index = -1;
+
+    if (index_param != query.end())
+    {
+        const auto& value = index_param->second;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), index);
+
+        if (ec != std::errc() || end != value.data() + value.size()) index = -1;
+    }
+
+    if (info_hash == query.end() || index < 0)
+    {
+        return WriteError(ctx, http::status::bad_request, "Both 'info_hash' and 'index' are required");
+    }
+
+    const auto status = Find(m_session, info_hash->second);
+
+    if (status == nullptr)
+    {
+        return WriteError(ctx, http::status::not_found, "Torrent not found");
+    }
+
+    const auto ti = status->torrent_file.lock();
+
+    if (!ti || index >= ti->num_files())
+    {
+        return WriteError(ctx, http::status::not_found, "File not found");
+    }
+
+    const auto& files = ti->files();
+    const lt::file_index_t file_index{index};
+
+    if (files.pad_file_at(file_index))
+    {
+        return WriteError(ctx, http::status::not_found, "File not found");
+    }
+
+    Download download{
+        .path = files.file_path(file_index, status->save_path),
+        .name = std::string(files.file_name(file_index)),
+        .size = files.file_size(file_index),
+        .tag  = lt::aux::to_hex(status->info_hashes.get_best()) + "-" + std::to_string(index)
+    };
+
+    m_session.FileProgress(
+        status->info_hashes,
+        [&session = m_session, streams = m_streams, ctx, download = std::move(download), hash = status->info_hashes, index](const porla::ISession::FileProgressList& progress)
+        {
+            if (progress && static_cast<std::size_t>(index) < progress->size() && progress->at(index) >= download.size)
+            {
+                return Serve(ctx, download, nullptr);
+            }
+
+            // Pieces which are not downloaded would read as whatever is on disk, so the
+            // file is only read as far as the pieces are there.
+            const auto& statuses = session.TorrentStatuses();
+            const auto status = statuses.find(hash);
+
+            auto available = streams != nullptr && status != statuses.end()
+                ? streams->Open(status->second, lt::file_index_t{index})
+                : nullptr;
+
+            if (!available)
+            {
+                return WriteError(ctx, http::status::conflict, "The file is not downloaded yet");
+            }
+
+            Serve(ctx, download, std::move(available));
+        });
+}
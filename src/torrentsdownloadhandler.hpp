@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    class ISession;
+    class PieceStreams;
+
+    // Serves a downloaded file of a torrent, picked by the info_hash and index query
+    // parameters. Single byte ranges are answered with 206, and If-Range and If-None-Match
+    // are checked against an ETag made from the info hash and file index. Files which are
+    // still downloading are streamed through streams as their pieces arrive, or refused
+    // without it.
+    class TorrentsDownloadHandler
+    {
+    public:
+        explicit TorrentsDownloadHandler(ISession& session, PieceStreams* streams = nullptr);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        ISession& m_session;
+        PieceStreams* m_streams;
+    };
+}
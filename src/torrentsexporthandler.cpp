@@ -0,0 +1,95 @@
+#include "torrentsexporthandler.hpp"
+
+#include <cstdint>
+
+#include <boost/log/trivial.hpp>
+
+#include "data/models/addtorrentparams.hpp"
+#include "data/models/torrentmetadata.hpp"
+#include "data/pragmas.hpp"
+#include "data/statement.hpp"
+#include "statearchive.hpp"
+#include "torrentclientdata.hpp"
+
+namespace http = boost::beast::http;
+namespace lt = libtorrent;
+
+using porla::Data::Models::AddTorrentParams;
+using porla::Data::Models::TorrentMetadata;
+using porla::TorrentsExportHandler;
+
+// Rows decoded per chunk, which keeps a chunk to a few megabytes for most torrents.
+static constexpr int PageSize = 100;
+
+struct Export
+{
+    ~Export()
+    {
+        if (snapshot) sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        // The metadata reads cache their statements.
+        porla::Data::Statement::ClearCache(db);
+        sqlite3_close(db);
+    }
+
+    sqlite3*     db       = nullptr;
+    std::int64_t last     = 0;
+    bool         snapshot = false;
+};
+
+TorrentsExportHandler::TorrentsExportHandler(sqlite3* db)
+{
+    const char* filename = sqlite3_db_filename(db, "main");
+    m_filename = filename != nullptr ? filename : "";
+}
+
+void TorrentsExportHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    const auto& req = ctx->Request();
+    auto state = std::make_shared<Export>();
+
+    if (m_filename.empty() || sqlite3_open_v2(m_filename.c_str(), &state->db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        http::response<http::string_body> res{http::status::internal_server_error, req.version()};
+        res.set(http::field::server, "porla/1.0");
+        res.set(http::field::content_type, "text/plain");
+        res.keep_alive(req.keep_alive());
+        res.body() = "The database cannot be exported";
+        res.prepare_payload();
+        return ctx->Write(std::move(res));
+    }
+
+    sqlite3_busy_timeout(state->db, 5000);
+
+    state->snapshot = Data::InWalMode(state->db)
+        && sqlite3_exec(state->db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    BOOST_LOG_TRIVIAL(info) << "Exporting torrents";
+
+    ctx->WriteChunked(
+        "application/octet-stream",
+        [state](std::string& chunk)
+        {
+            const auto before = state->last;
+
+            try
+            {
+                state->last = AddTorrentParams::ForEachAfter(
+                    state->db,
+                    state->last,
+                    PageSize,
+                    [&chunk, db = state->db](lt::add_torrent_params& params)
+                    {
+                        StateArchive::Write(params, chunk, TorrentMetadata::Get(db, params.info_hashes));
+                        delete params.userdata.get<TorrentClientData>();
+                    });
+            }
+            catch (const std::exception& ex)
+            {
+                // The headers are already sent, so the archive ends early instead.
+                BOOST_LOG_TRIVIAL(error) << "Failed to export torrents: " << ex.what();
+                return false;
+            }
+
+            return state->last != before;
+        });
+}
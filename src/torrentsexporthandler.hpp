@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <sqlite3.h>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    // Streams every torrent in the database as a StateArchive, a page of rows per chunk,
+    // from a read-only connection of its own. In WAL mode the pages all come from one
+    // snapshot, without holding up the writers.
+    class TorrentsExportHandler
+    {
+    public:
+        explicit TorrentsExportHandler(sqlite3* db);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        std::string m_filename;
+    };
+}
@@ -0,0 +1,148 @@
+#include "torrentsimporthandler.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/add_torrent_params.hpp>
+#include <nlohmann/json.hpp>
+
+#include "json/ltinfohash.hpp"
+#include "metadatastore.hpp"
+#include "session.hpp"
+#include "statearchive.hpp"
+#include "torrentclientdata.hpp"
+#include "workerpool.hpp"
+
+namespace http = boost::beast::http;
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using porla::TorrentsImportHandler;
+
+struct Decoded
+{
+    std::vector<lt::add_torrent_params>      params;
+    std::vector<porla::StateArchive::Metadata> metadata;
+    std::optional<std::string>               error;
+};
+
+static Decoded Decode(const std::string& body)
+{
+    Decoded decoded;
+    decoded.error = porla::StateArchive::Read(
+        body,
+        [&decoded](lt::add_torrent_params&& params, porla::StateArchive::Metadata&& metadata)
+        {
+            decoded.params.push_back(std::move(params));
+            decoded.metadata.push_back(std::move(metadata));
+        });
+
+    // Nothing is added from an archive which is not whole.
+    if (decoded.error.has_value())
+    {
+        for (const auto& params : decoded.params) delete params.userdata.get<porla::TorrentClientData>();
+        decoded.params.clear();
+        decoded.metadata.clear();
+    }
+
+    return decoded;
+}
+
+static http::response<http::string_body> ErrorResponse(
+    const http::request<http::string_body>& req,
+    http::status status,
+    const std::string& message)
+{
+    http::response<http::string_body> res{status, req.version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "text/plain");
+    res.keep_alive(req.keep_alive());
+    res.body() = message;
+    res.prepare_payload();
+    return res;
+}
+
+TorrentsImportHandler::TorrentsImportHandler(porla::ISession& session, porla::MetadataStore& metadata, porla::WorkerPool* pool)
+    : m_session(session)
+    , m_metadata(metadata)
+    , m_pool(pool)
+{
+}
+
+void TorrentsImportHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    if (ctx->Request().body().empty())
+    {
+        return ctx->Write(ErrorResponse(ctx->Request(), http::status::bad_request, "Missing archive"));
+    }
+
+    const auto finish = [this, ctx](Decoded decoded)
+    {
+        if (decoded.error.has_value())
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to import torrents: " << *decoded.error;
+            return ctx->Write(ErrorResponse(ctx->Request(), http::status::bad_request, *decoded.error));
+        }
+
+        Add(ctx, std::move(decoded.params), std::move(decoded.metadata));
+    };
+
+    if (m_pool == nullptr)
+    {
+        return finish(Decode(ctx->Request().body()));
+    }
+
+    const bool posted = m_pool->Post(
+        [this, ctx, finish]()
+        {
+            m_pool->Complete([finish, decoded = Decode(ctx->Request().body())]() mutable { finish(std::move(decoded)); });
+        });
+
+    if (!posted)
+    {
+        ctx->Write(ErrorResponse(ctx->Request(), http::status::service_unavailable, "Server busy - too many queued requests"));
+    }
+}
+
+void TorrentsImportHandler::Add(
+    const std::shared_ptr<HttpContext>& ctx,
+    std::vector<lt::add_torrent_params> params,
+    std::vector<StateArchive::Metadata> metadata)
+{
+    BOOST_LOG_TRIVIAL(info) << "Importing " << params.size() << " torrent(s)";
+
+    m_session.AddTorrents(
+        std::move(params),
+        [&store = m_metadata, ctx, metadata = std::move(metadata)](std::vector<ISession::AddTorrentResult> results)
+        {
+            int added = 0;
+            json failed = json::array();
+
+            for (std::size_t i = 0; i < results.size(); i++)
+            {
+                const auto& result = results[i];
+
+                if (result.error.empty())
+                {
+                    if (!metadata[i].empty()) store.Set(result.info_hash, metadata[i]);
+
+                    added++;
+                    continue;
+                }
+
+                failed.push_back({
+                    {"error", result.error},
+                    {"info_hash", result.info_hash}
+                });
+            }
+
+            BOOST_LOG_TRIVIAL(info) << "Imported " << added << " torrent(s), " << failed.size() << " failed";
+
+            ctx->WriteJson({
+                {"added", added},
+                {"failed", failed}
+            });
+        });
+}
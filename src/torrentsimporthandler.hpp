@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <libtorrent/add_torrent_params.hpp>
+
+#include "httpcontext.hpp"
+#include "statearchive.hpp"
+
+namespace porla
+{
+    class ISession;
+    class MetadataStore;
+    class WorkerPool;
+
+    // Adds the torrents in a StateArchive sent as the request body, in one batch, and
+    // stores their metadata. The archive is decoded on the worker pool, if there is one.
+    class TorrentsImportHandler
+    {
+    public:
+        explicit TorrentsImportHandler(ISession& session, MetadataStore& metadata, WorkerPool* pool = nullptr);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        void Add(
+            const std::shared_ptr<HttpContext>& ctx,
+            std::vector<libtorrent::add_torrent_params> params,
+            std::vector<StateArchive::Metadata> metadata);
+
+        ISession& m_session;
+        MetadataStore& m_metadata;
+        WorkerPool* m_pool;
+    };
+}
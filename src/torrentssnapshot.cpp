@@ -0,0 +1,73 @@
+#include "torrentssnapshot.hpp"
+
+#include <boost/asio/post.hpp>
+
+namespace lt = libtorrent;
+
+using porla::TorrentsSnapshot;
+
+TorrentsSnapshot::TorrentsSnapshot(boost::asio::io_context& io, porla::ISession& session)
+    : m_io(io)
+    , m_session(session)
+{
+    Publish();
+
+    // Adds and removals come in bursts, as when loading, so they are published together.
+    m_torrentAddedConnection = m_session.OnTorrentAdded([this](const auto&) { Schedule(); });
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded([this](const auto&) { Schedule(); });
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](const auto&) { Schedule(); });
+
+    // Checking the version is cheap, so this only copies when something changed.
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const auto&)
+        {
+            if (m_session.Torrents().version() != Current()->version) { Publish(); }
+        });
+}
+
+TorrentsSnapshot::~TorrentsSnapshot()
+{
+    m_stateUpdateConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+porla::MemoryUsage TorrentsSnapshot::Memory() const
+{
+    const auto current = Current();
+    const auto size    = current->torrents.size();
+
+    // The entries, and an index which is at most half full of two 32 bit words a slot.
+    return MemoryUsage{
+        .bytes   = size * (sizeof(TorrentHandles::value_type) + 4 * sizeof(std::uint32_t)),
+        .objects = size
+    };
+}
+
+void TorrentsSnapshot::Schedule()
+{
+    if (m_scheduled)
+    {
+        return;
+    }
+
+    m_scheduled = true;
+
+    boost::asio::post(
+        m_io,
+        [this]()
+        {
+            m_scheduled = false;
+            Publish();
+        });
+}
+
+void TorrentsSnapshot::Publish()
+{
+    const auto& torrents = m_session.Torrents();
+
+    m_current.store(
+        std::make_shared<const Snapshot>(Snapshot{ .version = torrents.version(), .torrents = torrents }),
+        std::memory_order_release);
+}
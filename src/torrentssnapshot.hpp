@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "memoryusage.hpp"
+#include "session.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    // Read-copy-update copies of the session's torrent handles, for threads other than
+    // the io thread, which is the only one allowed to touch Torrents(). Whenever the
+    // registry changes, a new copy is published on the io thread. Readers take the current
+    // copy with one atomic load and iterate it without locks. A copy is freed once its
+    // last reader lets go of it. Copies are made at most once per turn of the io loop, and
+    // changes without a signal, such as parking, are seen at the next state update.
+    class TorrentsSnapshot
+    {
+    public:
+        struct Snapshot
+        {
+            std::uint64_t  version;
+            TorrentHandles torrents;
+        };
+
+        explicit TorrentsSnapshot(boost::asio::io_context& io, ISession& session);
+        TorrentsSnapshot(const TorrentsSnapshot&) = delete;
+
+        ~TorrentsSnapshot();
+
+        // Safe to call from any thread.
+        [[nodiscard]] std::shared_ptr<const Snapshot> Current() const { return m_current.load(std::memory_order_acquire); }
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+    private:
+        void Schedule();
+        void Publish();
+
+        boost::asio::io_context& m_io;
+        ISession& m_session;
+        bool m_scheduled = false;
+
+        std::atomic<std::shared_ptr<const Snapshot>> m_current;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
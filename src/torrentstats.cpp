@@ -0,0 +1,314 @@
+#include "torrentstats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "session.hpp"
+#include "torrentaggregates.hpp"
+#include "torrentclientdata.hpp"
+#include "utils/ratio.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentStats;
+
+void TorrentStats::Distribution::Add(std::uint64_t value, int sign)
+{
+    m_buckets[Bucket(value)] += sign;
+    m_count += sign;
+    m_sum   += sign * static_cast<std::int64_t>(value);
+}
+
+std::uint64_t TorrentStats::Distribution::Min() const
+{
+    for (std::size_t bucket = 0; bucket < Buckets; bucket++)
+    {
+        if (m_buckets[bucket] > 0) return Lower(bucket);
+    }
+
+    return 0;
+}
+
+std::uint64_t TorrentStats::Distribution::Max() const
+{
+    for (std::size_t bucket = Buckets; bucket > 0; bucket--)
+    {
+        if (m_buckets[bucket - 1] > 0) return Upper(bucket - 1);
+    }
+
+    return 0;
+}
+
+double TorrentStats::Distribution::Quantile(double q) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    const double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(m_count);
+    std::int64_t cumulative = 0;
+
+    for (std::size_t bucket = 0; bucket < Buckets; bucket++)
+    {
+        if (m_buckets[bucket] == 0) { continue; }
+
+        const auto below = cumulative;
+        cumulative += m_buckets[bucket];
+
+        if (static_cast<double>(cumulative) >= rank)
+        {
+            const auto lower = static_cast<double>(Lower(bucket));
+            const auto upper = static_cast<double>(Upper(bucket));
+
+            return lower + (upper - lower) * (rank - static_cast<double>(below)) / static_cast<double>(m_buckets[bucket]);
+        }
+    }
+
+    return static_cast<double>(Max());
+}
+
+// Values below four have a bucket each. Above, the exponent picks a group of four and
+// the two bits after the leading one pick the bucket in it.
+std::size_t TorrentStats::Distribution::Bucket(std::uint64_t value)
+{
+    if (value < 4)
+    {
+        return static_cast<std::size_t>(value);
+    }
+
+    const auto exponent = static_cast<std::size_t>(std::bit_width(value) - 1);
+    const auto sub      = static_cast<std::size_t>((value >> (exponent - 2)) & 3);
+
+    return 4 + (exponent - 2) * 4 + sub;
+}
+
+std::uint64_t TorrentStats::Distribution::Lower(std::size_t bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+
+    const auto exponent = (bucket - 4) / 4 + 2;
+    const auto sub      = (bucket - 4) % 4;
+
+    return static_cast<std::uint64_t>(4 + sub) << (exponent - 2);
+}
+
+std::uint64_t TorrentStats::Distribution::Upper(std::size_t bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+
+    const auto exponent = (bucket - 4) / 4 + 2;
+
+    return Lower(bucket) + (std::uint64_t{1} << (exponent - 2)) - 1;
+}
+
+TorrentStats::TorrentStats(porla::ISession& session)
+    : m_session(session)
+{
+    for (auto const& [hash, ts] : m_session.TorrentStatuses())
+    {
+        Add(ts);
+    }
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                // Updates can arrive for torrents that are already removed.
+                if (!m_torrents.contains(ts.info_hashes)) { continue; }
+
+                Remove(ts.info_hashes);
+                Add(ts);
+            }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved(
+        [this](const lt::torrent_handle& th)
+        {
+            const auto& statuses = m_session.TorrentStatuses();
+            const auto status = statuses.find(th.info_hashes());
+
+            if (status == statuses.end() || !m_torrents.contains(status->first))
+            {
+                return;
+            }
+
+            Remove(status->first);
+            Add(status->second);
+        });
+
+    m_torrentAddedConnection = m_session.OnTorrentAdded(
+        [this](const lt::torrent_status& ts)
+        {
+            Remove(ts.info_hashes);
+            Add(ts);
+        });
+
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                Remove(ts.info_hashes);
+                Add(ts);
+            }
+        });
+
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+}
+
+TorrentStats::~TorrentStats()
+{
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+}
+
+const char* TorrentStats::Name(Dimension dimension)
+{
+    switch (dimension)
+    {
+    case Category: return "category";
+    case SavePath: return "save_path";
+    case State:    return "state";
+    case Tag:      return "tag";
+    default:       return "unknown";
+    }
+}
+
+const char* TorrentStats::Name(Metric metric)
+{
+    switch (metric)
+    {
+    case DownloadRate: return "download_rate";
+    case UploadRate:   return "upload_rate";
+    case Size:         return "size";
+    case Ratio:        return "ratio";
+    default:           return "unknown";
+    }
+}
+
+TorrentStats::Groups TorrentStats::Scan(Query::PQL::Filter& filter) const
+{
+    Groups groups;
+
+    for (auto const& [_, ts] : m_session.TorrentStatuses())
+    {
+        if (filter.Includes(ts))
+        {
+            Apply(groups, Make(ts), 1);
+        }
+    }
+
+    return groups;
+}
+
+porla::MemoryUsage TorrentStats::Memory() const
+{
+    MemoryUsage usage{ .objects = m_torrents.size() };
+
+    for (const auto& [_, contribution] : m_torrents)
+    {
+        usage.bytes += sizeof(lt::info_hash_t) + sizeof(Contribution)
+            + contribution.save_path.capacity()
+            + contribution.tags.capacity() * sizeof(std::string);
+    }
+
+    std::size_t groups = 1;
+    for (const auto& dimension : m_groups.dimensions) groups += dimension.size();
+
+    usage.bytes += groups * sizeof(Group);
+
+    return usage;
+}
+
+TorrentStats::Contribution TorrentStats::Make(const lt::torrent_status& ts) const
+{
+    const auto client_data = m_session.ClientData(ts);
+
+    Contribution contribution{
+        .category  = client_data != nullptr && client_data->category.has_value() ? client_data->category->str() : "",
+        .save_path = ts.save_path,
+        .state     = TorrentAggregates::StateName(ts),
+        .values    = {
+            static_cast<std::uint64_t>(std::max(0, ts.download_payload_rate)),
+            static_cast<std::uint64_t>(std::max(0, ts.upload_payload_rate)),
+            static_cast<std::uint64_t>(std::max<std::int64_t>(0, ts.total_wanted)),
+            static_cast<std::uint64_t>(std::llround(std::max(0.0, Utils::Ratio(ts)) * RatioScale))
+        }
+    };
+
+    if (client_data != nullptr && client_data->tags.has_value())
+    {
+        for (const auto& tag : *client_data->tags)
+        {
+            contribution.tags.push_back(tag.str());
+        }
+    }
+
+    return contribution;
+}
+
+void TorrentStats::Apply(Groups& groups, const Contribution& contribution, int sign)
+{
+    const auto apply = [&](std::map<std::string, Group>* dimension, const std::string& label)
+    {
+        auto& group = dimension != nullptr ? (*dimension)[label] : groups.total;
+
+        group.count += sign;
+
+        for (int m = 0; m < MetricCount; m++)
+        {
+            group.metrics[m].Add(contribution.values[m], sign);
+        }
+
+        // Frees the group once nothing is counted in it.
+        if (dimension != nullptr && group.count == 0)
+        {
+            dimension->erase(label);
+        }
+    };
+
+    apply(nullptr, "");
+    apply(&groups.dimensions[Category], contribution.category);
+    apply(&groups.dimensions[SavePath], contribution.save_path);
+    apply(&groups.dimensions[State], contribution.state);
+
+    for (const auto& tag : contribution.tags)
+    {
+        apply(&groups.dimensions[Tag], tag);
+    }
+}
+
+void TorrentStats::Add(const lt::torrent_status& ts)
+{
+    auto contribution = Make(ts);
+
+    Apply(m_groups, contribution, 1);
+
+    m_torrents.insert_or_assign(ts.info_hashes, std::move(contribution));
+}
+
+void TorrentStats::Remove(const lt::info_hash_t& hash)
+{
+    const auto torrent = m_torrents.find(hash);
+
+    if (torrent == m_torrents.end())
+    {
+        return;
+    }
+
+    Apply(m_groups, torrent->second, -1);
+
+    m_torrents.erase(torrent);
+}
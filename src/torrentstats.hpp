@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "memoryusage.hpp"
+#include "query/pql.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Counts, sums and distributions of torrent rates, sizes and ratios per category, save
+    // path, state and tag, and over every torrent. Kept from the state updates by taking out
+    // what a torrent counted for before and adding what it counts for now, so reading them
+    // costs as much as there are groups. Unlike TorrentAggregates, nothing is folded into
+    // 'other', and a group needs no scan to read its percentiles.
+    class TorrentStats
+    {
+    public:
+        enum Dimension
+        {
+            Category,
+            SavePath,
+            State,
+            Tag,
+            DimensionCount
+        };
+
+        enum Metric
+        {
+            DownloadRate,
+            UploadRate,
+            Size,
+            Ratio,
+            MetricCount
+        };
+
+        // Values in buckets four to a power of two, so the minimum, maximum and percentiles
+        // are within a quarter of a power of two of the real ones. The sum is exact.
+        class Distribution
+        {
+        public:
+            static constexpr std::size_t Buckets = 256;
+
+            void Add(std::uint64_t value, int sign);
+
+            [[nodiscard]] std::int64_t Count() const { return m_count; }
+            [[nodiscard]] std::int64_t Sum() const { return m_sum; }
+            [[nodiscard]] std::uint64_t Min() const;
+            [[nodiscard]] std::uint64_t Max() const;
+            [[nodiscard]] double Quantile(double q) const;
+
+        private:
+            static std::size_t Bucket(std::uint64_t value);
+            static std::uint64_t Lower(std::size_t bucket);
+            static std::uint64_t Upper(std::size_t bucket);
+
+            std::array<std::uint32_t, Buckets> m_buckets{};
+            std::int64_t m_count = 0;
+            std::int64_t m_sum = 0;
+        };
+
+        struct Group
+        {
+            std::int64_t count = 0;
+            std::array<Distribution, MetricCount> metrics;
+        };
+
+        struct Groups
+        {
+            Group total;
+            std::array<std::map<std::string, Group>, DimensionCount> dimensions;
+        };
+
+        // Ratios are kept in thousandths, since the buckets hold integers.
+        static constexpr double RatioScale = 1000;
+
+        explicit TorrentStats(ISession& session);
+        TorrentStats(const TorrentStats&) = delete;
+
+        ~TorrentStats();
+
+        [[nodiscard]] static const char* Name(Dimension dimension);
+        [[nodiscard]] static const char* Name(Metric metric);
+
+        [[nodiscard]] const Groups& Current() const { return m_groups; }
+
+        // The same figures over the torrents matching a filter, which are only known by
+        // checking every torrent.
+        [[nodiscard]] Groups Scan(Query::PQL::Filter& filter) const;
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+    private:
+        struct Contribution
+        {
+            std::string category;
+            std::string save_path;
+            std::string state;
+            std::vector<std::string> tags;
+            std::array<std::uint64_t, MetricCount> values;
+        };
+
+        [[nodiscard]] Contribution Make(const libtorrent::torrent_status& ts) const;
+        static void Apply(Groups& groups, const Contribution& contribution, int sign);
+
+        void Add(const libtorrent::torrent_status& ts);
+        void Remove(const libtorrent::info_hash_t& hash);
+
+        ISession& m_session;
+
+        Groups m_groups;
+        std::map<libtorrent::info_hash_t, Contribution> m_torrents;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+    };
+}
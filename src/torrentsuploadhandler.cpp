@@ -0,0 +1,116 @@
+#include "torrentsuploadhandler.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include <boost/log/trivial.hpp>
+#include <nlohmann/json.hpp>
+
+#include "methods/torrentsadd.hpp"
+#include "utils/multipart.hpp"
+
+namespace http = boost::beast::http;
+
+using json = nlohmann::json;
+using porla::TorrentsUploadHandler;
+using porla::Utils::Multipart;
+
+static http::response<http::string_body> ErrorResponse(
+    const http::request<http::string_body>& req,
+    http::status status,
+    const std::string& message)
+{
+    http::response<http::string_body> res{status, req.version()};
+    res.set(http::field::server, "porla/1.0");
+    res.set(http::field::content_type, "text/plain");
+    res.keep_alive(req.keep_alive());
+    res.body() = message;
+    res.prepare_payload();
+    return res;
+}
+
+TorrentsUploadHandler::TorrentsUploadHandler(porla::Methods::TorrentsAdd& add)
+    : m_add(add)
+{
+}
+
+void TorrentsUploadHandler::operator()(const std::shared_ptr<HttpContext>& ctx)
+{
+    auto& req = ctx->Request();
+    auto& body = req.body();
+
+    const std::string content_type = req[http::field::content_type];
+    const std::string media_type   = content_type.substr(0, content_type.find(';'));
+
+    // Params default to an empty object, so a preset can provide the save path.
+    std::string params_text = "{}";
+
+    if (const auto boundary = Multipart::Boundary(content_type); !boundary.empty())
+    {
+        std::vector<Multipart::Part> parts;
+
+        try
+        {
+            parts = Multipart::Parse(body, boundary);
+        }
+        catch (const std::invalid_argument& ex)
+        {
+            return ctx->Write(ErrorResponse(req, http::status::bad_request, ex.what()));
+        }
+
+        const Multipart::Part* torrent = nullptr;
+
+        for (const auto& part : parts)
+        {
+            if (part.name == "params") params_text = body.substr(part.offset, part.size);
+            if (part.name == "torrent") torrent = &part;
+        }
+
+        if (torrent == nullptr)
+        {
+            return ctx->Write(ErrorResponse(req, http::status::bad_request, "Missing 'torrent' part"));
+        }
+
+        // Only the file is kept, moved to the front of the body instead of copied out.
+        body.erase(torrent->offset + torrent->size);
+        body.erase(0, torrent->offset);
+    }
+    else if (media_type == "application/x-bittorrent" || media_type == "application/octet-stream")
+    {
+        if (const auto header = req.find("X-Porla-Params"); header != req.end())
+        {
+            params_text = std::string(header->value());
+        }
+    }
+    else
+    {
+        return ctx->Write(ErrorResponse(
+            req,
+            http::status::unsupported_media_type,
+            "Expected application/x-bittorrent or multipart/form-data"));
+    }
+
+    json params = json::parse(params_text, nullptr, false);
+
+    if (!params.is_object())
+    {
+        return ctx->Write(ErrorResponse(req, http::status::bad_request, "Params must be a JSON object"));
+    }
+
+    if (body.empty())
+    {
+        return ctx->Write(ErrorResponse(req, http::status::bad_request, "Missing torrent file"));
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Adding uploaded torrent file of " << body.size() << " bytes";
+
+    try
+    {
+        m_add.Upload(std::move(body), std::move(params), ctx);
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to add uploaded torrent: " << ex.what();
+        ctx->Write(ErrorResponse(req, http::status::bad_request, ex.what()));
+    }
+}
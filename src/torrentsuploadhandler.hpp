@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    namespace Methods
+    {
+        class TorrentsAdd;
+    }
+
+    // Adds a torrent from a .torrent file sent as the request body, so it is neither base64
+    // encoded nor parsed as JSON. The body is either the file itself, as
+    // application/x-bittorrent with the torrents.add params as JSON in an X-Porla-Params
+    // header, or multipart/form-data with a "torrent" part and an optional "params" part.
+    class TorrentsUploadHandler
+    {
+    public:
+        explicit TorrentsUploadHandler(Methods::TorrentsAdd& add);
+
+        void operator()(const std::shared_ptr<HttpContext>& ctx);
+
+    private:
+        Methods::TorrentsAdd& m_add;
+    };
+}
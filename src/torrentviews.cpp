@@ -0,0 +1,114 @@
+#include "torrentviews.hpp"
+
+#include <boost/log/trivial.hpp>
+
+#include "session.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentViews;
+
+TorrentViews::TorrentViews(porla::ISession& session, const std::map<std::string, std::string>& views)
+    : m_session(session)
+{
+    for (const auto& [name, query] : views)
+    {
+        auto& view = m_views[name];
+        view.filter = Query::PQL::Parse(query);
+
+        Rescan(view);
+
+        BOOST_LOG_TRIVIAL(debug) << "View '" << name << "' matches " << view.hashes.size() << " torrent(s)";
+    }
+
+    if (!m_views.empty())
+    {
+        m_torrentUpdatesDemand = m_session.Demand(ISession::Stats::Torrents);
+    }
+
+    m_stateUpdateConnection = m_session.OnStateUpdate(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            // Queries on age change with the clock, so those views are rescanned on every
+            // update instead of only checking the torrents that changed.
+            for (auto& [_, view] : m_views)
+            {
+                if (view.filter->UsesClock()) { Rescan(view); }
+            }
+
+            for (auto const& ts : torrents) { Evaluate(ts); }
+        });
+
+    m_storageMovedConnection = m_session.OnStorageMoved([this](auto const& th) { Evaluate(th.info_hashes()); });
+    m_torrentAddedConnection = m_session.OnTorrentAdded([this](auto const& ts) { Evaluate(ts); });
+    m_torrentsLoadedConnection = m_session.OnTorrentsLoaded(
+        [this](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents) { Evaluate(ts); }
+        });
+    m_torrentFinishedConnection = m_session.OnTorrentFinished([this](auto const& ts) { Evaluate(ts); });
+    m_torrentPausedConnection = m_session.OnTorrentPaused([this](auto const& th) { Evaluate(th.info_hashes()); });
+    m_torrentRemovedConnection = m_session.OnTorrentRemoved([this](auto const& hash) { Remove(hash); });
+    m_torrentResumedConnection = m_session.OnTorrentResumed([this](auto const& ts) { Evaluate(ts); });
+}
+
+TorrentViews::~TorrentViews()
+{
+    m_stateUpdateConnection.disconnect();
+    m_storageMovedConnection.disconnect();
+    m_torrentAddedConnection.disconnect();
+    m_torrentsLoadedConnection.disconnect();
+    m_torrentFinishedConnection.disconnect();
+    m_torrentPausedConnection.disconnect();
+    m_torrentRemovedConnection.disconnect();
+    m_torrentResumedConnection.disconnect();
+}
+
+const TorrentViews::HashSet* TorrentViews::Find(const std::string& name) const
+{
+    const auto view = m_views.find(name);
+    return view != m_views.end() ? &view->second.hashes : nullptr;
+}
+
+void TorrentViews::Evaluate(const lt::torrent_status& ts)
+{
+    // State updates can name torrents that were removed since.
+    if (!m_session.TorrentStatuses().contains(ts.info_hashes))
+    {
+        return;
+    }
+
+    for (auto& [_, view] : m_views)
+    {
+        if (view.filter->Includes(ts)) view.hashes.insert(ts.info_hashes);
+        else                           view.hashes.erase(ts.info_hashes);
+    }
+}
+
+void TorrentViews::Evaluate(const lt::info_hash_t& hash)
+{
+    const auto& statuses = m_session.TorrentStatuses();
+
+    if (auto status = statuses.find(hash); status != statuses.end())
+    {
+        Evaluate(status->second);
+    }
+}
+
+void TorrentViews::Remove(const lt::info_hash_t& hash)
+{
+    for (auto& [_, view] : m_views)
+    {
+        view.hashes.erase(hash);
+    }
+}
+
+void TorrentViews::Rescan(View& view)
+{
+    view.hashes.clear();
+
+    for (auto const& [hash, ts] : m_session.TorrentStatuses())
+    {
+        if (view.filter->Includes(ts)) { view.hashes.insert(hash); }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <libtorrent/info_hash.hpp>
+#include <libtorrent/torrent_status.hpp>
+
+#include "query/pql.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    // Named PQL queries whose matching torrents are kept up to date from the session
+    // signals, so listing a view costs a lookup instead of a query over every torrent.
+    class TorrentViews
+    {
+    public:
+        typedef Query::PQL::HashSet HashSet;
+
+        // Throws a QueryError if any of the queries fail to parse.
+        explicit TorrentViews(ISession& session, const std::map<std::string, std::string>& views);
+        TorrentViews(const TorrentViews&) = delete;
+
+        ~TorrentViews();
+
+        // Returns the torrents in the view, or nullptr if there is no view with that name.
+        [[nodiscard]] const HashSet* Find(const std::string& name) const;
+
+    private:
+        struct View
+        {
+            std::unique_ptr<Query::PQL::Filter> filter;
+            HashSet                             hashes;
+        };
+
+        void Evaluate(const libtorrent::torrent_status& ts);
+        void Evaluate(const libtorrent::info_hash_t& hash);
+        void Remove(const libtorrent::info_hash_t& hash);
+        void Rescan(View& view);
+
+        ISession& m_session;
+        std::map<std::string, View> m_views;
+
+        // Views are only as fresh as the state updates, so they are kept at the active rate.
+        std::shared_ptr<void> m_torrentUpdatesDemand;
+
+        porla::Utils::Connection m_stateUpdateConnection;
+        porla::Utils::Connection m_storageMovedConnection;
+        porla::Utils::Connection m_torrentAddedConnection;
+        porla::Utils::Connection m_torrentsLoadedConnection;
+        porla::Utils::Connection m_torrentFinishedConnection;
+        porla::Utils::Connection m_torrentPausedConnection;
+        porla::Utils::Connection m_torrentRemovedConnection;
+        porla::Utils::Connection m_torrentResumedConnection;
+    };
+}
@@ -0,0 +1,307 @@
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+
+#include <boost/log/trivial.hpp>
+
+using json = nlohmann::json;
+
+using porla::ScopedSpan;
+using porla::TraceScope;
+using porla::TraceSpan;
+using porla::Tracer;
+
+static std::mt19937_64& Random()
+{
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    return rng;
+}
+
+template<std::size_t N>
+static std::array<std::uint8_t, N> RandomId()
+{
+    std::array<std::uint8_t, N> id{};
+
+    // All zero ids are invalid.
+    while (std::all_of(id.begin(), id.end(), [](auto b) { return b == 0; }))
+    {
+        for (auto& b : id) { b = static_cast<std::uint8_t>(Random()()); }
+    }
+
+    return id;
+}
+
+template<std::size_t N>
+static std::string ToHex(const std::array<std::uint8_t, N>& id)
+{
+    static constexpr char Digits[] = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(N * 2);
+
+    for (const auto b : id)
+    {
+        hex.push_back(Digits[b >> 4]);
+        hex.push_back(Digits[b & 0xf]);
+    }
+
+    return hex;
+}
+
+template<std::size_t N>
+static bool FromHex(std::string_view hex, std::array<std::uint8_t, N>& id)
+{
+    const auto nibble = [](char c) -> int
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+
+    if (hex.size() != N * 2) { return false; }
+
+    bool zero = true;
+
+    for (std::size_t i = 0; i < N; i++)
+    {
+        const int hi = nibble(hex[i * 2]);
+        const int lo = nibble(hex[i * 2 + 1]);
+
+        if (hi < 0 || lo < 0) { return false; }
+
+        id[i] = static_cast<std::uint8_t>(hi << 4 | lo);
+        zero = zero && id[i] == 0;
+    }
+
+    return !zero;
+}
+
+static std::string UnixNano(std::chrono::system_clock::time_point tp)
+{
+    return std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count());
+}
+
+TraceSpan::TraceSpan(
+    porla::Tracer& tracer,
+    std::string name,
+    TraceId trace_id,
+    std::optional<SpanId> parent,
+    std::chrono::system_clock::time_point start)
+    : m_tracer(tracer)
+    , m_name(std::move(name))
+    , m_trace_id(trace_id)
+    , m_span_id(RandomId<8>())
+    , m_parent(parent)
+    , m_start(start)
+    , m_ended(false)
+{
+}
+
+std::shared_ptr<TraceSpan> TraceSpan::Child(
+    const std::shared_ptr<TraceSpan>& parent,
+    std::string name,
+    std::chrono::system_clock::time_point start)
+{
+    if (parent == nullptr)
+    {
+        return nullptr;
+    }
+
+    return std::make_shared<TraceSpan>(parent->m_tracer, std::move(name), parent->m_trace_id, parent->m_span_id, start);
+}
+
+void TraceSpan::SetAttribute(std::string key, std::string value)
+{
+    m_attributes.emplace_back(std::move(key), std::move(value));
+}
+
+void TraceSpan::End()
+{
+    if (m_ended.exchange(true))
+    {
+        return;
+    }
+
+    m_end = std::chrono::system_clock::now();
+    m_tracer.Record(*this);
+}
+
+static thread_local std::shared_ptr<TraceSpan> CurrentSpan;
+
+TraceScope::TraceScope(std::shared_ptr<TraceSpan> span)
+    : m_previous(std::move(CurrentSpan))
+{
+    CurrentSpan = std::move(span);
+}
+
+TraceScope::~TraceScope()
+{
+    CurrentSpan = std::move(m_previous);
+}
+
+const std::shared_ptr<TraceSpan>& TraceScope::Current()
+{
+    return CurrentSpan;
+}
+
+ScopedSpan::ScopedSpan(std::string name)
+    : ScopedSpan(CurrentSpan, std::move(name))
+{
+}
+
+ScopedSpan::ScopedSpan(const std::shared_ptr<TraceSpan>& parent, std::string name)
+    : m_span(TraceSpan::Child(parent, std::move(name)))
+{
+}
+
+ScopedSpan::~ScopedSpan()
+{
+    if (m_span) { m_span->End(); }
+}
+
+Tracer::Tracer(boost::asio::io_context& io, TracerOptions options)
+    : m_timer(io)
+    , m_client(io)
+    , m_options(std::move(options))
+    , m_dropped(0)
+{
+    BOOST_LOG_TRIVIAL(info) << "Exporting traces to " << m_options.endpoint << " (sample rate " << m_options.sample_rate << ")";
+    Schedule();
+}
+
+Tracer::~Tracer()
+{
+    m_timer.cancel();
+}
+
+std::shared_ptr<TraceSpan> Tracer::Start(std::string name, std::string_view traceparent)
+{
+    // version-trace_id-parent_id-flags, as in 00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01
+    if (traceparent.size() == 55 && traceparent.substr(0, 3) == "00-" && traceparent[35] == '-' && traceparent[52] == '-')
+    {
+        TraceSpan::TraceId trace_id;
+        TraceSpan::SpanId parent;
+
+        const char flags = traceparent[54];
+        const bool valid_flags = std::isxdigit(static_cast<unsigned char>(traceparent[53]))
+            && std::isxdigit(static_cast<unsigned char>(flags));
+
+        if (valid_flags
+            && FromHex(traceparent.substr(3, 32), trace_id)
+            && FromHex(traceparent.substr(36, 16), parent))
+        {
+            // The lowest bit of the flags is the caller's sampling decision.
+            const int value = flags <= '9' ? flags - '0' : (flags | 0x20) - 'a' + 10;
+
+            if ((value & 1) == 0)
+            {
+                return nullptr;
+            }
+
+            auto span = std::make_shared<TraceSpan>(*this, std::move(name), trace_id, parent);
+            span->m_server = true;
+            return span;
+        }
+    }
+
+    if (std::uniform_real_distribution<double>(0, 1)(Random()) >= m_options.sample_rate)
+    {
+        return nullptr;
+    }
+
+    auto span = std::make_shared<TraceSpan>(*this, std::move(name), RandomId<16>(), std::nullopt);
+    span->m_server = true;
+    return span;
+}
+
+void Tracer::Flush()
+{
+    std::vector<json> spans;
+
+    {
+        std::unique_lock lock(m_mtx);
+        spans.swap(m_pending);
+    }
+
+    if (spans.empty())
+    {
+        return;
+    }
+
+    const json body = {
+        {"resourceSpans", json::array({
+            {
+                {"resource", {
+                    {"attributes", json::array({
+                        {{"key", "service.name"}, {"value", {{"stringValue", m_options.service_name}}}}
+                    })}
+                }},
+                {"scopeSpans", json::array({
+                    {
+                        {"scope", {{"name", "porla"}}},
+                        {"spans", std::move(spans)}
+                    }
+                })}
+            }
+        })}
+    };
+
+    m_client.SendAsync(
+        HttpClient::Request{
+            .url    = m_options.endpoint,
+            .method = "POST",
+            .body   = body.dump()
+        },
+        []() { BOOST_LOG_TRIVIAL(trace) << "Exported traces"; });
+}
+
+void Tracer::Record(const TraceSpan& span)
+{
+    json attributes = json::array();
+
+    for (const auto& [key, value] : span.m_attributes)
+    {
+        attributes.push_back({{"key", key}, {"value", {{"stringValue", value}}}});
+    }
+
+    json encoded = {
+        {"traceId", ToHex(span.m_trace_id)},
+        {"spanId", ToHex(span.m_span_id)},
+        {"name", span.m_name},
+        // Root spans are the server side of a request, everything else is internal.
+        {"kind", span.m_server ? 2 : 1},
+        {"startTimeUnixNano", UnixNano(span.m_start)},
+        {"endTimeUnixNano", UnixNano(span.m_end)},
+        {"attributes", std::move(attributes)}
+    };
+
+    if (span.m_parent.has_value())
+    {
+        encoded["parentSpanId"] = ToHex(*span.m_parent);
+    }
+
+    std::unique_lock lock(m_mtx);
+
+    if (m_pending.size() >= m_options.max_queue)
+    {
+        m_dropped++;
+        return;
+    }
+
+    m_pending.push_back(std::move(encoded));
+}
+
+void Tracer::Schedule()
+{
+    m_timer.expires_after(m_options.flush_interval);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+
+            Flush();
+            Schedule();
+        });
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+
+#include "httpclient.hpp"
+
+namespace porla
+{
+    class Tracer;
+
+    // A timed operation in a trace. Spans only exist for sampled requests, so callers hold a
+    // null pointer otherwise and skip everything. End records the span, once.
+    class TraceSpan
+    {
+    public:
+        typedef std::array<std::uint8_t, 16> TraceId;
+        typedef std::array<std::uint8_t, 8>  SpanId;
+
+        TraceSpan(
+            Tracer& tracer,
+            std::string name,
+            TraceId trace_id,
+            std::optional<SpanId> parent,
+            std::chrono::system_clock::time_point start = std::chrono::system_clock::now());
+
+        TraceSpan(const TraceSpan&) = delete;
+
+        // Null when the parent is null.
+        static std::shared_ptr<TraceSpan> Child(
+            const std::shared_ptr<TraceSpan>& parent,
+            std::string name,
+            std::chrono::system_clock::time_point start = std::chrono::system_clock::now());
+
+        void SetAttribute(std::string key, std::string value);
+        void End();
+
+    private:
+        friend class Tracer;
+
+        Tracer& m_tracer;
+        std::string m_name;
+        TraceId m_trace_id;
+        SpanId m_span_id;
+        std::optional<SpanId> m_parent;
+        std::chrono::system_clock::time_point m_start;
+        std::chrono::system_clock::time_point m_end;
+        std::vector<std::pair<std::string, std::string>> m_attributes;
+        std::atomic<bool> m_ended;
+        bool m_server = false;
+    };
+
+    // Makes a span current on this thread while in scope, so code without a request context,
+    // such as database calls, can add spans to it.
+    class TraceScope
+    {
+    public:
+        explicit TraceScope(std::shared_ptr<TraceSpan> span);
+        TraceScope(const TraceScope&) = delete;
+        ~TraceScope();
+
+        static const std::shared_ptr<TraceSpan>& Current();
+
+    private:
+        std::shared_ptr<TraceSpan> m_previous;
+    };
+
+    // A child span ended when going out of scope. Without a parent it is a no-op.
+    class ScopedSpan
+    {
+    public:
+        explicit ScopedSpan(std::string name);
+        explicit ScopedSpan(const std::shared_ptr<TraceSpan>& parent, std::string name);
+        ScopedSpan(const ScopedSpan&) = delete;
+        ~ScopedSpan();
+
+        [[nodiscard]] const std::shared_ptr<TraceSpan>& Get() const { return m_span; }
+
+    private:
+        std::shared_ptr<TraceSpan> m_span;
+    };
+
+    struct TracerOptions
+    {
+        // The OTLP/HTTP traces endpoint, for example http://localhost:4318/v1/traces.
+        std::string               endpoint;
+        std::chrono::milliseconds flush_interval = std::chrono::milliseconds(5000);
+        std::size_t               max_queue      = 2048;
+        double                    sample_rate    = 0.01;
+        std::string               service_name   = "porla";
+    };
+
+    // Samples requests, collects their spans and exports them in batches to an OTLP
+    // collector, encoded as OTLP/JSON. Spans may end on any thread.
+    class Tracer
+    {
+    public:
+        explicit Tracer(boost::asio::io_context& io, TracerOptions options);
+        Tracer(const Tracer&) = delete;
+        ~Tracer();
+
+        // Starts a root span, continuing the trace from a W3C traceparent header if one is
+        // given. A sampled or unsampled parent decides, otherwise the sample rate does.
+        // Returns null when the request is not sampled.
+        std::shared_ptr<TraceSpan> Start(std::string name, std::string_view traceparent = {});
+
+        void Flush();
+
+        [[nodiscard]] std::uint64_t Dropped() const { return m_dropped; }
+
+    private:
+        friend class TraceSpan;
+
+        void Record(const TraceSpan& span);
+        void Schedule();
+
+        boost::asio::steady_timer m_timer;
+        HttpClient m_client;
+        TracerOptions m_options;
+
+        std::mutex m_mtx;
+        std::vector<nlohmann::json> m_pending;
+        std::atomic<std::uint64_t> m_dropped;
+    };
+}
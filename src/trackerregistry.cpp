@@ -0,0 +1,101 @@
+#include "trackerregistry.hpp"
+
+#include <ctime>
+
+#include "session.hpp"
+#include "utils/string.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TrackerRegistry;
+
+// Announces which are never answered, such as those of torrents stopped in between, are
+// dropped once this many are waiting.
+static constexpr std::size_t MaxPending = 65536;
+static constexpr auto PendingTimeout = std::chrono::minutes(5);
+
+const std::vector<double>& TrackerRegistry::LatencyBounds()
+{
+    static const std::vector<double> bounds = { 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30 };
+    return bounds;
+}
+
+TrackerRegistry::TrackerRegistry(porla::ISession& session, porla::TrackerRegistryOptions options)
+    : m_session(session)
+    , m_options(options)
+{
+    m_announceConnection = m_session.OnTrackerAnnounce(
+        [this](const ISession::TrackerAnnounce& announce)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            const auto key = std::make_pair(announce.handle.info_hashes(), announce.url);
+
+            auto& host = Host(announce.url);
+
+            if (announce.kind == ISession::TrackerAnnounce::Sent)
+            {
+                host.announces++;
+
+                if (m_pending.size() >= MaxPending)
+                {
+                    std::erase_if(m_pending, [&now](const auto& entry) { return now - entry.second > PendingTimeout; });
+                }
+
+                if (m_pending.size() < MaxPending)
+                {
+                    m_pending.insert_or_assign(key, now);
+                }
+
+                return;
+            }
+
+            if (auto pending = m_pending.find(key); pending != m_pending.end())
+            {
+                host.latency.Observe(std::chrono::duration<double>(now - pending->second).count());
+                m_pending.erase(pending);
+            }
+
+            if (announce.kind == ISession::TrackerAnnounce::Replied)
+            {
+                host.replies++;
+                host.last_reply = std::time(nullptr);
+                return;
+            }
+
+            // The message is the failure reason given by the tracker, if it gave one.
+            const auto reason = announce.message.empty() ? announce.error.message() : announce.message;
+            const std::string label = host.errors.size() < m_options.max_errors || host.errors.contains(reason)
+                ? reason
+                : "other";
+
+            host.failures++;
+            host.errors[label]++;
+            host.last_failure = std::time(nullptr);
+            host.last_error   = reason;
+        });
+
+    m_removedConnection = m_session.OnTorrentRemoved(
+        [this](const lt::info_hash_t& hash)
+        {
+            auto pending = m_pending.lower_bound({ hash, std::string() });
+            while (pending != m_pending.end() && pending->first.first == hash) pending = m_pending.erase(pending);
+        });
+}
+
+TrackerRegistry::~TrackerRegistry()
+{
+    m_announceConnection.disconnect();
+    m_removedConnection.disconnect();
+}
+
+TrackerRegistry::Stats& TrackerRegistry::Host(const std::string& url)
+{
+    const auto host = porla::Utils::String::UrlHost(url);
+
+    if (auto stats = m_hosts.find(host); stats != m_hosts.end())
+    {
+        return stats->second;
+    }
+
+    return m_hosts[m_hosts.size() < m_options.max_hosts ? host : "other"];
+}
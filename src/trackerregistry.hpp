@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "utils/histogram.hpp"
+#include "utils/signal.hpp"
+
+namespace porla
+{
+    class ISession;
+
+    struct TrackerRegistryOptions
+    {
+        // Hosts beyond these are counted as 'other'.
+        std::size_t max_hosts  = 100;
+        // Distinct errors kept per host, with the rest counted as 'other'.
+        std::size_t max_errors = 20;
+    };
+
+    // Announces, replies and failures summed per tracker host across all torrents, from the
+    // tracker alerts. Latency is the time from the announce being sent to it being answered
+    // or failing, as seen when the alerts are handled.
+    class TrackerRegistry
+    {
+    public:
+        static const std::vector<double>& LatencyBounds();
+
+        struct Stats
+        {
+            std::uint64_t                        announces = 0;
+            std::uint64_t                        replies = 0;
+            std::uint64_t                        failures = 0;
+            std::map<std::string, std::uint64_t> errors;
+            Utils::Histogram                     latency{LatencyBounds()};
+            // Unix time, or zero when there has not been one.
+            std::int64_t                         last_reply = 0;
+            std::int64_t                         last_failure = 0;
+            std::string                          last_error;
+        };
+
+        explicit TrackerRegistry(ISession& session, TrackerRegistryOptions options = {});
+        TrackerRegistry(const TrackerRegistry&) = delete;
+
+        ~TrackerRegistry();
+
+        [[nodiscard]] const std::map<std::string, Stats>& Hosts() const { return m_hosts; }
+
+    private:
+        Stats& Host(const std::string& url);
+
+        ISession& m_session;
+        TrackerRegistryOptions m_options;
+
+        std::map<std::string, Stats> m_hosts;
+        // Announces sent and not yet answered, by torrent and tracker URL.
+        std::map<std::pair<libtorrent::info_hash_t, std::string>, std::chrono::steady_clock::time_point> m_pending;
+
+        porla::Utils::Connection m_announceConnection;
+        porla::Utils::Connection m_removedConnection;
+    };
+}
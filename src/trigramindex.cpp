@@ -0,0 +1,160 @@
+#include "trigramindex.hpp"
+
+#include <algorithm>
+
+namespace lt = libtorrent;
+
+using porla::TrigramIndex;
+
+static unsigned char Lower(char c)
+{
+    return static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+}
+
+void TrigramIndex::Insert(const lt::info_hash_t& hash, std::string_view value)
+{
+    if (m_ids.contains(hash))
+    {
+        return;
+    }
+
+    std::uint32_t id;
+
+    if (!m_free.empty())
+    {
+        id = m_free.back();
+        m_free.pop_back();
+        m_hashes[id] = hash;
+    }
+    else
+    {
+        id = static_cast<std::uint32_t>(m_hashes.size());
+        m_hashes.push_back(hash);
+    }
+
+    m_ids.insert({ hash, id });
+
+    for (const auto trigram : Trigrams(value))
+    {
+        auto& posting = m_postings[trigram];
+
+        // New ids are the largest unless one was reused, so this is nearly always an append.
+        posting.insert(std::lower_bound(posting.begin(), posting.end(), id), id);
+    }
+}
+
+void TrigramIndex::Erase(const lt::info_hash_t& hash, std::string_view value)
+{
+    const auto it = m_ids.find(hash);
+    if (it == m_ids.end()) { return; }
+
+    const auto id = it->second;
+
+    for (const auto trigram : Trigrams(value))
+    {
+        const auto posting = m_postings.find(trigram);
+        if (posting == m_postings.end()) { continue; }
+
+        const auto pos = std::lower_bound(posting->second.begin(), posting->second.end(), id);
+
+        if (pos != posting->second.end() && *pos == id)
+        {
+            posting->second.erase(pos);
+        }
+
+        if (posting->second.empty())
+        {
+            m_postings.erase(posting);
+        }
+    }
+
+    m_free.push_back(id);
+    m_ids.erase(it);
+}
+
+std::optional<TrigramIndex::HashSet> TrigramIndex::Candidates(std::string_view needle) const
+{
+    const auto trigrams = Trigrams(needle);
+
+    if (trigrams.empty())
+    {
+        return std::nullopt;
+    }
+
+    std::vector<const std::vector<std::uint32_t>*> postings;
+
+    for (const auto trigram : trigrams)
+    {
+        const auto posting = m_postings.find(trigram);
+
+        if (posting == m_postings.end())
+        {
+            return HashSet();
+        }
+
+        postings.push_back(&posting->second);
+    }
+
+    // Start from the rarest trigram, so the running result is never larger than it.
+    std::sort(postings.begin(), postings.end(), [](auto lhs, auto rhs) { return lhs->size() < rhs->size(); });
+
+    std::vector<std::uint32_t> ids = *postings[0];
+    std::vector<std::uint32_t> next;
+
+    for (std::size_t i = 1; i < postings.size() && !ids.empty(); i++)
+    {
+        next.clear();
+        std::set_intersection(ids.begin(), ids.end(), postings[i]->begin(), postings[i]->end(), std::back_inserter(next));
+        ids.swap(next);
+    }
+
+    HashSet result;
+
+    for (const auto id : ids)
+    {
+        result.insert(m_hashes[id]);
+    }
+
+    return result;
+}
+
+porla::MemoryUsage TrigramIndex::Memory() const
+{
+    MemoryUsage usage{ .objects = m_ids.size() };
+
+    for (const auto& [_, posting] : m_postings)
+    {
+        usage.bytes += sizeof(std::uint32_t) * 2 + sizeof(std::vector<std::uint32_t>) + posting.capacity() * sizeof(std::uint32_t);
+    }
+
+    usage.bytes += m_ids.size() * (sizeof(lt::info_hash_t) + sizeof(std::uint32_t) + 32);
+    usage.bytes += m_hashes.capacity() * sizeof(lt::info_hash_t);
+    usage.bytes += m_free.capacity() * sizeof(std::uint32_t);
+
+    return usage;
+}
+
+std::vector<std::uint32_t> TrigramIndex::Trigrams(std::string_view value)
+{
+    std::vector<std::uint32_t> trigrams;
+
+    if (value.size() < 3)
+    {
+        return trigrams;
+    }
+
+    trigrams.reserve(value.size() - 2);
+
+    for (std::size_t i = 0; i + 3 <= value.size(); i++)
+    {
+        trigrams.push_back(
+            static_cast<std::uint32_t>(Lower(value[i])) << 16
+            | static_cast<std::uint32_t>(Lower(value[i + 1])) << 8
+            | static_cast<std::uint32_t>(Lower(value[i + 2])));
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    return trigrams;
+}
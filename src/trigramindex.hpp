@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <libtorrent/info_hash.hpp>
+
+#include "memoryusage.hpp"
+#include "query/pql.hpp"
+
+namespace porla
+{
+    // Maps every three byte sequence of a string, lowercased, to the torrents whose string
+    // has it. A string containing a needle has every trigram of the needle, so intersecting
+    // their torrents gives a small superset of the matches, which are then checked against
+    // the strings themselves. Lowercasing keeps the superset valid for both case sensitive
+    // and insensitive matching. One string per torrent.
+    class TrigramIndex
+    {
+    public:
+        typedef Query::PQL::HashSet HashSet;
+
+        void Insert(const libtorrent::info_hash_t& hash, std::string_view value);
+        // Takes the value the torrent was inserted with.
+        void Erase(const libtorrent::info_hash_t& hash, std::string_view value);
+
+        // Returns nullopt if the needle is shorter than a trigram, since every torrent may
+        // contain it then.
+        [[nodiscard]] std::optional<HashSet> Candidates(std::string_view needle) const;
+
+        [[nodiscard]] MemoryUsage Memory() const;
+
+    private:
+        // Sorted and without duplicates.
+        static std::vector<std::uint32_t> Trigrams(std::string_view value);
+
+        // Torrents are numbered, so posting lists are sorted vectors of small integers which
+        // intersect in a single pass.
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_postings;
+        std::map<libtorrent::info_hash_t, std::uint32_t> m_ids;
+        std::vector<libtorrent::info_hash_t> m_hashes;
+        std::vector<std::uint32_t> m_free;
+    };
+}
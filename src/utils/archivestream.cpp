@@ -0,0 +1,365 @@
+#include "archivestream.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <stdexcept>
+
+#include <zlib.h>
+
+using porla::Utils::ArchiveStream;
+
+// File data read per part.
+static constexpr std::size_t ChunkSize = 256 * 1024;
+
+static constexpr std::uint32_t CentralHeader    = 0x02014b50;
+static constexpr std::uint32_t DataDescriptor   = 0x08074b50;
+static constexpr std::uint32_t EndOfDirectory   = 0x06054b50;
+static constexpr std::uint32_t LocalHeader      = 0x04034b50;
+static constexpr std::uint32_t Zip64End         = 0x06064b50;
+static constexpr std::uint32_t Zip64EndLocator  = 0x07064b50;
+static constexpr std::uint32_t Max32            = 0xffffffff;
+
+// Sizes and CRCs in a data descriptor, and names in UTF-8.
+static constexpr std::uint16_t Flags            = 0x0008 | 0x0800;
+static constexpr std::uint16_t Version          = 20;
+static constexpr std::uint16_t Version64        = 45;
+
+// The largest size a ustar header holds, in 11 octal digits.
+static constexpr std::uint64_t TarMaxSize       = 077777777777;
+
+static void Put(std::string& out, std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) out.push_back(static_cast<char>(value >> (i * 8) & 0xff));
+}
+
+static std::uint32_t DosDateTime(std::int64_t mtime)
+{
+    const auto time = static_cast<std::time_t>(mtime);
+
+    std::tm tm = {};
+    gmtime_r(&time, &tm);
+
+    // DOS dates start in 1980.
+    if (tm.tm_year < 80)
+    {
+        return (1 << 5 | 1) << 16;
+    }
+
+    const std::uint32_t date = (tm.tm_year - 80) << 9 | (tm.tm_mon + 1) << 5 | tm.tm_mday;
+    const std::uint32_t clock = tm.tm_hour << 11 | tm.tm_min << 5 | tm.tm_sec / 2;
+
+    return date << 16 | clock;
+}
+
+// Writes value as octal, zero padded to fill the field but its terminating NUL.
+static void Octal(char* field, std::size_t size, std::uint64_t value)
+{
+    for (std::size_t i = size - 1; i > 0; i--)
+    {
+        field[i - 1] = static_cast<char>('0' + (value & 7));
+        value >>= 3;
+    }
+
+    field[size - 1] = '\0';
+}
+
+static std::string TarHeader(const std::string& name, std::uint64_t size, std::int64_t mtime, char type)
+{
+    std::string header(512, '\0');
+
+    // Long names are split on a '/' into the prefix field. The ones which do not fit are
+    // in a pax header before this one, and cut here.
+    std::size_t split = std::string::npos;
+
+    if (name.size() > 100)
+    {
+        const auto slash = name.rfind('/', 155);
+        if (slash != std::string::npos && name.size() - slash - 1 <= 100) split = slash;
+    }
+
+    if (split != std::string::npos)
+    {
+        name.copy(header.data() + 345, split);
+        name.copy(header.data(), 100, split + 1);
+    }
+    else
+    {
+        name.copy(header.data(), 100);
+    }
+
+    Octal(header.data() + 100, 8, type == '5' ? 0755 : 0644);
+    Octal(header.data() + 108, 8, 0);
+    Octal(header.data() + 116, 8, 0);
+    Octal(header.data() + 124, 12, std::min(size, TarMaxSize));
+    Octal(header.data() + 136, 12, static_cast<std::uint64_t>(std::max<std::int64_t>(0, mtime)));
+
+    header[156] = type;
+    std::string("ustar").copy(header.data() + 257, 5);
+    header[263] = '0';
+    header[264] = '0';
+
+    // The checksum is taken with its own field as spaces.
+    std::fill(header.begin() + 148, header.begin() + 156, ' ');
+
+    std::uint32_t checksum = 0;
+    for (const auto c : header) checksum += static_cast<unsigned char>(c);
+
+    Octal(header.data() + 148, 7, checksum);
+    header[155] = ' ';
+
+    return header;
+}
+
+static void PaxRecord(std::string& out, const std::string& key, const std::string& value)
+{
+    // The length counts its own digits.
+    const auto rest = key.size() + value.size() + 3;
+    auto length = rest + std::to_string(rest).size();
+    if (std::to_string(length).size() != std::to_string(rest).size()) length++;
+
+    out.append(std::to_string(length)).append(" ").append(key).append("=").append(value).append("\n");
+}
+
+static bool FitsUstar(const std::string& name)
+{
+    if (name.size() <= 100) return true;
+
+    const auto slash = name.rfind('/', 155);
+    return slash != std::string::npos && name.size() - slash - 1 <= 100;
+}
+
+ArchiveStream::ArchiveStream(Format format, std::vector<Entry> entries)
+    : m_format(format)
+    , m_entries(std::move(entries))
+{
+    if (m_format == Format::Zip)
+    {
+        m_written.reserve(m_entries.size());
+    }
+}
+
+bool ArchiveStream::Next(std::string& chunk)
+{
+    m_base = m_offset - chunk.size();
+
+    while (chunk.size() < ChunkSize)
+    {
+        if (m_open && m_remaining > 0)
+        {
+            Read(chunk);
+        }
+        else if (m_open)
+        {
+            End(chunk);
+        }
+        else if (m_index < m_entries.size())
+        {
+            Begin(chunk);
+        }
+        else
+        {
+            Finish(chunk);
+            m_offset = Position(chunk);
+            return false;
+        }
+    }
+
+    m_offset = Position(chunk);
+    return true;
+}
+
+void ArchiveStream::Begin(std::string& chunk)
+{
+    const auto& entry = m_entries[m_index];
+
+    m_file.open(entry.path, std::ios::binary);
+
+    if (!m_file)
+    {
+        throw std::runtime_error("Failed to open " + entry.path.string());
+    }
+
+    m_open      = true;
+    m_remaining = entry.size;
+    m_crc32     = crc32(0, nullptr, 0);
+
+    if (m_format == Format::Tar)
+    {
+        if (!FitsUstar(entry.name) || entry.size > TarMaxSize)
+        {
+            std::string records;
+            if (!FitsUstar(entry.name))     PaxRecord(records, "path", entry.name);
+            if (entry.size > TarMaxSize)    PaxRecord(records, "size", std::to_string(entry.size));
+
+            chunk.append(TarHeader("PaxHeader", records.size(), entry.mtime, 'x'));
+            chunk.append(records);
+            chunk.append((512 - records.size() % 512) % 512, '\0');
+        }
+
+        chunk.append(TarHeader(entry.name, entry.size, entry.mtime, '0'));
+        return;
+    }
+
+    const bool zip64 = entry.size >= Max32;
+
+    m_written.push_back(Written{ .offset = Position(chunk) });
+
+    Put(chunk, LocalHeader, 4);
+    Put(chunk, zip64 ? Version64 : Version, 2);
+    Put(chunk, Flags, 2);
+    Put(chunk, 0, 2);
+    Put(chunk, DosDateTime(entry.mtime), 4);
+    Put(chunk, 0, 4);
+    // With a Zip64 extra field the sizes are in it, and like here zero until the
+    // data descriptor.
+    Put(chunk, zip64 ? Max32 : 0, 4);
+    Put(chunk, zip64 ? Max32 : 0, 4);
+    Put(chunk, entry.name.size(), 2);
+    Put(chunk, zip64 ? 20 : 0, 2);
+    chunk.append(entry.name);
+
+    if (zip64)
+    {
+        Put(chunk, 0x0001, 2);
+        Put(chunk, 16, 2);
+        Put(chunk, 0, 8);
+        Put(chunk, 0, 8);
+    }
+}
+
+void ArchiveStream::End(std::string& chunk)
+{
+    const auto& entry = m_entries[m_index];
+
+    m_file.close();
+    m_open = false;
+    m_index++;
+
+    if (m_format == Format::Tar)
+    {
+        chunk.append((512 - entry.size % 512) % 512, '\0');
+        return;
+    }
+
+    m_written.back().crc32 = m_crc32;
+
+    const int size_bytes = entry.size >= Max32 ? 8 : 4;
+
+    Put(chunk, DataDescriptor, 4);
+    Put(chunk, m_crc32, 4);
+    Put(chunk, entry.size, size_bytes);
+    Put(chunk, entry.size, size_bytes);
+}
+
+void ArchiveStream::Finish(std::string& chunk)
+{
+    if (m_format == Format::Tar)
+    {
+        chunk.append(1024, '\0');
+        return;
+    }
+
+    const auto directory = Position(chunk);
+
+    for (std::size_t i = 0; i < m_entries.size(); i++)
+    {
+        const auto& entry   = m_entries[i];
+        const auto& written = m_written[i];
+
+        const bool large_size   = entry.size >= Max32;
+        const bool large_offset = written.offset >= Max32;
+
+        std::string extra;
+
+        if (large_size || large_offset)
+        {
+            const int fields = (large_size ? 2 : 0) + (large_offset ? 1 : 0);
+
+            Put(extra, 0x0001, 2);
+            Put(extra, fields * 8, 2);
+
+            if (large_size)
+            {
+                Put(extra, entry.size, 8);
+                Put(extra, entry.size, 8);
+            }
+
+            if (large_offset) Put(extra, written.offset, 8);
+        }
+
+        const auto version = large_size || large_offset ? Version64 : Version;
+
+        Put(chunk, CentralHeader, 4);
+        // Made on Unix, for the permissions in the external attributes.
+        Put(chunk, 3 << 8 | version, 2);
+        Put(chunk, version, 2);
+        Put(chunk, Flags, 2);
+        Put(chunk, 0, 2);
+        Put(chunk, DosDateTime(entry.mtime), 4);
+        Put(chunk, written.crc32, 4);
+        Put(chunk, large_size ? Max32 : entry.size, 4);
+        Put(chunk, large_size ? Max32 : entry.size, 4);
+        Put(chunk, entry.name.size(), 2);
+        Put(chunk, extra.size(), 2);
+        Put(chunk, 0, 2);
+        Put(chunk, 0, 2);
+        Put(chunk, 0, 2);
+        Put(chunk, static_cast<std::uint32_t>(0100644) << 16, 4);
+        Put(chunk, large_offset ? Max32 : written.offset, 4);
+        chunk.append(entry.name);
+        chunk.append(extra);
+    }
+
+    const auto directory_end  = Position(chunk);
+    const auto directory_size = directory_end - directory;
+    const auto count          = static_cast<std::uint64_t>(m_entries.size());
+
+    if (count >= 0xffff || directory >= Max32 || directory_size >= Max32)
+    {
+        Put(chunk, Zip64End, 4);
+        Put(chunk, 44, 8);
+        Put(chunk, 3 << 8 | Version64, 2);
+        Put(chunk, Version64, 2);
+        Put(chunk, 0, 4);
+        Put(chunk, 0, 4);
+        Put(chunk, count, 8);
+        Put(chunk, count, 8);
+        Put(chunk, directory_size, 8);
+        Put(chunk, directory, 8);
+
+        Put(chunk, Zip64EndLocator, 4);
+        Put(chunk, 0, 4);
+        Put(chunk, directory_end, 8);
+        Put(chunk, 1, 4);
+    }
+
+    Put(chunk, EndOfDirectory, 4);
+    Put(chunk, 0, 2);
+    Put(chunk, 0, 2);
+    Put(chunk, std::min<std::uint64_t>(count, 0xffff), 2);
+    Put(chunk, std::min<std::uint64_t>(count, 0xffff), 2);
+    Put(chunk, std::min<std::uint64_t>(directory_size, Max32), 4);
+    Put(chunk, std::min<std::uint64_t>(directory, Max32), 4);
+    Put(chunk, 0, 2);
+}
+
+void ArchiveStream::Read(std::string& chunk)
+{
+    const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(m_remaining, ChunkSize - chunk.size()));
+    const auto start = chunk.size();
+
+    chunk.resize(start + size);
+    m_file.read(chunk.data() + start, static_cast<std::streamsize>(size));
+
+    if (static_cast<std::size_t>(m_file.gcount()) != size)
+    {
+        throw std::runtime_error(m_entries[m_index].path.string() + " is shorter than its entry");
+    }
+
+    if (m_format == Format::Zip)
+    {
+        m_crc32 = crc32(m_crc32, reinterpret_cast<const Bytef*>(chunk.data() + start), static_cast<uInt>(size));
+    }
+
+    m_remaining -= size;
+}
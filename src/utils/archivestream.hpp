@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace porla::Utils
+{
+    // Writes files into a tar or stored zip archive as it is read, a part at a time. The
+    // headers are made from the names and sizes given up front, the file data is copied
+    // as it is, and at most a part of it is held in memory. Zip entries get their CRC-32
+    // in a data descriptor after the data, and Zip64 records where they need them.
+    class ArchiveStream
+    {
+    public:
+        enum class Format
+        {
+            Tar,
+            Zip
+        };
+
+        struct Entry
+        {
+            // With '/' between directories.
+            std::string           name;
+            std::filesystem::path path;
+            std::uint64_t         size  = 0;
+            // Seconds since the epoch.
+            std::int64_t          mtime = 0;
+        };
+
+        explicit ArchiveStream(Format format, std::vector<Entry> entries);
+
+        // Appends the next part of the archive to chunk, and returns false once the last
+        // one is appended. Throws std::runtime_error if a file cannot be read, or is shorter
+        // than its entry says.
+        bool Next(std::string& chunk);
+
+    private:
+        struct Written
+        {
+            std::uint64_t offset;
+            std::uint32_t crc32;
+        };
+
+        [[nodiscard]] std::uint64_t Position(const std::string& chunk) const { return m_base + chunk.size(); }
+
+        void Begin(std::string& chunk);
+        void End(std::string& chunk);
+        void Finish(std::string& chunk);
+        void Read(std::string& chunk);
+
+        Format             m_format;
+        std::vector<Entry> m_entries;
+        std::size_t        m_index     = 0;
+        std::ifstream      m_file;
+        bool               m_open      = false;
+        std::uint64_t      m_remaining = 0;
+        std::uint32_t      m_crc32     = 0;
+        // Bytes of the archive appended so far, and where in it the current chunk starts.
+        std::uint64_t      m_offset    = 0;
+        std::uint64_t      m_base      = 0;
+        // Where each zip entry starts, for the central directory.
+        std::vector<Written> m_written;
+    };
+}
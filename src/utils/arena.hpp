@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace porla::Utils
+{
+    // Memory for the temporaries of one request, handed out in order and released all at
+    // once with the arena. Whatever is allocated from it must not outlive it, so it is
+    // shared with anything which holds on to them, such as a streamed response.
+    class Arena
+    {
+    public:
+        explicit Arena(std::size_t initial_size = 64 * 1024)
+            : m_resource(initial_size)
+        {
+        }
+
+        Arena(const Arena&) = delete;
+
+        std::pmr::memory_resource* Resource() { return &m_resource; }
+
+    private:
+        std::pmr::monotonic_buffer_resource m_resource;
+    };
+}
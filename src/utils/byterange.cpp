@@ -0,0 +1,80 @@
+#include "byterange.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+
+using porla::Utils::ByteRange;
+
+static std::string_view Trim(std::string_view sv)
+{
+    while (!sv.empty() && (sv.front() == ' ' || sv.front() == '\t')) sv.remove_prefix(1);
+    while (!sv.empty() && (sv.back() == ' ' || sv.back() == '\t'))   sv.remove_suffix(1);
+    return sv;
+}
+
+static std::optional<std::uint64_t> Number(std::string_view sv)
+{
+    std::uint64_t value = 0;
+    const auto [end, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+
+    if (sv.empty() || ec != std::errc() || end != sv.data() + sv.size())
+    {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+ByteRange::Result ByteRange::Parse(std::string_view header, std::uint64_t size, ByteRange& range)
+{
+    header = Trim(header);
+
+    if (!header.starts_with("bytes="))
+    {
+        return Result::Full;
+    }
+
+    const auto spec = Trim(header.substr(6));
+    const auto dash = spec.find('-');
+
+    if (dash == std::string_view::npos || spec.find(',') != std::string_view::npos)
+    {
+        return Result::Full;
+    }
+
+    const auto first = Trim(spec.substr(0, dash));
+    const auto last  = Trim(spec.substr(dash + 1));
+
+    // A suffix range, the last bytes of the body.
+    if (first.empty())
+    {
+        const auto suffix = Number(last);
+
+        if (!suffix.has_value()) return Result::Full;
+        if (*suffix == 0 || size == 0) return Result::Unsatisfiable;
+
+        range.length = std::min(*suffix, size);
+        range.offset = size - range.length;
+
+        return Result::Partial;
+    }
+
+    const auto start = Number(first);
+    const auto end   = last.empty() ? std::optional<std::uint64_t>(UINT64_MAX) : Number(last);
+
+    if (!start.has_value() || !end.has_value() || *end < *start)
+    {
+        return Result::Full;
+    }
+
+    if (*start >= size)
+    {
+        return Result::Unsatisfiable;
+    }
+
+    range.offset = *start;
+    range.length = std::min(*end, size - 1) - *start + 1;
+
+    return Result::Partial;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace porla::Utils
+{
+    // The byte range of a Range request header.
+    struct ByteRange
+    {
+        std::uint64_t offset = 0;
+        std::uint64_t length = 0;
+
+        enum class Result
+        {
+            // No range, or one which is not a single bytes range, so the whole body is sent.
+            Full,
+            Partial,
+            Unsatisfiable
+        };
+
+        // Parses header for a body of size bytes, into range when it is Partial. Multiple
+        // ranges are answered with the whole body, which RFC 9110 allows.
+        static Result Parse(std::string_view header, std::uint64_t size, ByteRange& range);
+    };
+}
@@ -0,0 +1,64 @@
+#include "encoding.hpp"
+
+using porla::Utils::Encoding;
+
+Encoding::Type Encoding::FromMediaType(std::string_view media_type)
+{
+    if (media_type.find("application/msgpack") != std::string_view::npos
+        || media_type.find("application/x-msgpack") != std::string_view::npos
+        || media_type.find("application/vnd.msgpack") != std::string_view::npos)
+    {
+        return Type::MsgPack;
+    }
+
+    if (media_type.find("application/cbor") != std::string_view::npos)
+    {
+        return Type::Cbor;
+    }
+
+    return Type::Json;
+}
+
+std::string Encoding::Dump(const nlohmann::json& j, Type type)
+{
+    std::string out;
+
+    switch (type)
+    {
+    case Type::Cbor:
+        nlohmann::json::to_cbor(j, out);
+        break;
+    case Type::Json:
+        out = j.dump();
+        break;
+    case Type::MsgPack:
+        nlohmann::json::to_msgpack(j, out);
+        break;
+    }
+
+    return out;
+}
+
+const char* Encoding::MediaType(Type type)
+{
+    switch (type)
+    {
+    case Type::Cbor:    return "application/cbor";
+    case Type::Json:    return "application/json";
+    case Type::MsgPack: return "application/msgpack";
+    }
+
+    return "application/json";
+}
+
+nlohmann::json Encoding::Parse(const std::string& data, Type type)
+{
+    switch (type)
+    {
+    case Type::Cbor:    return nlohmann::json::from_cbor(data);
+    case Type::Json:    return nlohmann::json::parse(data);
+    case Type::MsgPack: return nlohmann::json::from_msgpack(data);
+    }
+
+    return nlohmann::json::parse(data);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+namespace porla::Utils
+{
+    // The wire formats a JSON document can be sent in. MessagePack and CBOR carry the same
+    // data model as JSON, so anything that can be dumped can be encoded in either.
+    class Encoding
+    {
+    public:
+        enum class Type
+        {
+            Cbor,
+            Json,
+            MsgPack
+        };
+
+        // Picks the encoding from an Accept or Content-Type header value. Anything that does
+        // not name one of the binary formats is JSON.
+        static Type FromMediaType(std::string_view media_type);
+
+        static std::string Dump(const nlohmann::json& j, Type type);
+        static const char* MediaType(Type type);
+
+        // Throws a nlohmann::json::exception if the data is not valid for the encoding.
+        static nlohmann::json Parse(const std::string& data, Type type);
+    };
+}
@@ -0,0 +1,384 @@
+#include "feed.hpp"
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+
+using porla::Utils::Feed;
+
+namespace
+{
+    struct Tag
+    {
+        // Without the namespace prefix.
+        std::string_view                        name;
+        bool                                    closing      = false;
+        bool                                    self_closing = false;
+        std::map<std::string_view, std::string> attributes;
+
+        [[nodiscard]] std::string Attribute(std::string_view key) const
+        {
+            const auto it = attributes.find(key);
+            return it != attributes.end() ? it->second : std::string();
+        }
+    };
+
+    // What an item has been seen to have, before it is reduced to a Feed::Item.
+    struct Fields
+    {
+        std::string guid;
+        std::string title;
+        std::string link;
+        std::string enclosure;
+        std::string magnet;
+    };
+}
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view Trim(std::string_view sv)
+{
+    while (!sv.empty() && IsSpace(sv.front())) sv.remove_prefix(1);
+    while (!sv.empty() && IsSpace(sv.back()))  sv.remove_suffix(1);
+    return sv;
+}
+
+static std::string_view LocalName(std::string_view name)
+{
+    const auto colon = name.find(':');
+    return colon == std::string_view::npos ? name : name.substr(colon + 1);
+}
+
+static void AppendUtf8(std::string& out, std::uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+    else if (cp < 0x110000)
+    {
+        out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+// Parses what is between the '<' and '>' of a tag.
+static Tag ParseTag(std::string_view body)
+{
+    Tag tag;
+
+    if (!body.empty() && body.front() == '/')
+    {
+        tag.closing = true;
+        body.remove_prefix(1);
+    }
+
+    if (!body.empty() && body.back() == '/')
+    {
+        tag.self_closing = true;
+        body.remove_suffix(1);
+    }
+
+    std::size_t pos = 0;
+    while (pos < body.size() && !IsSpace(body[pos])) pos++;
+
+    tag.name = LocalName(body.substr(0, pos));
+
+    while (pos < body.size())
+    {
+        while (pos < body.size() && IsSpace(body[pos])) pos++;
+
+        const auto key_start = pos;
+        while (pos < body.size() && body[pos] != '=' && !IsSpace(body[pos])) pos++;
+
+        const auto key = body.substr(key_start, pos - key_start);
+
+        while (pos < body.size() && IsSpace(body[pos])) pos++;
+
+        if (pos >= body.size() || body[pos] != '=')
+        {
+            continue;
+        }
+
+        pos++;
+        while (pos < body.size() && IsSpace(body[pos])) pos++;
+
+        if (pos >= body.size() || (body[pos] != '"' && body[pos] != '\''))
+        {
+            break;
+        }
+
+        const char quote = body[pos++];
+        const auto value_end = body.find(quote, pos);
+
+        if (value_end == std::string_view::npos)
+        {
+            break;
+        }
+
+        tag.attributes.insert({ key, Feed::Unescape(body.substr(pos, value_end - pos)) });
+        pos = value_end + 1;
+    }
+
+    return tag;
+}
+
+// The end of the tag which starts at pos, skipping '>' in quoted attribute values.
+static std::size_t TagEnd(std::string_view xml, std::size_t pos)
+{
+    char quote = 0;
+
+    for (; pos < xml.size(); pos++)
+    {
+        const char c = xml[pos];
+
+        if (quote != 0)
+        {
+            if (c == quote) quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            quote = c;
+        }
+        else if (c == '>')
+        {
+            return pos;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+std::string Feed::Unescape(std::string_view text)
+{
+    static const std::map<std::string_view, char> Named =
+    {
+        {"amp",  '&'},
+        {"apos", '\''},
+        {"gt",   '>'},
+        {"lt",   '<'},
+        {"quot", '"'}
+    };
+
+    std::string out;
+    out.reserve(text.size());
+
+    for (std::size_t pos = 0; pos < text.size(); pos++)
+    {
+        const auto end = text[pos] == '&' ? text.find(';', pos) : std::string_view::npos;
+
+        // Stray ampersands are common enough in feeds to be kept as they are.
+        if (end == std::string_view::npos || end - pos > 10)
+        {
+            out.push_back(text[pos]);
+            continue;
+        }
+
+        const auto name = text.substr(pos + 1, end - pos - 1);
+
+        if (name.size() > 1 && name.front() == '#')
+        {
+            const bool hex = name[1] == 'x' || name[1] == 'X';
+
+            try
+            {
+                const auto cp = std::stoul(std::string(name.substr(hex ? 2 : 1)), nullptr, hex ? 16 : 10);
+                AppendUtf8(out, static_cast<std::uint32_t>(cp));
+            }
+            catch (const std::exception&)
+            {
+                out.append(text.substr(pos, end - pos + 1));
+            }
+        }
+        else if (const auto named = Named.find(name); named != Named.end())
+        {
+            out.push_back(named->second);
+        }
+        else
+        {
+            out.append(text.substr(pos, end - pos + 1));
+        }
+
+        pos = end;
+    }
+
+    return out;
+}
+
+std::vector<Feed::Item> Feed::Parse(std::string_view xml)
+{
+    std::vector<Item> items;
+
+    bool   root = false;
+    int    depth = 0;
+    // The depth of the item or entry being read, or 0 outside of one.
+    int    item_depth = 0;
+    Fields fields;
+
+    // The item field the text is read into, and the depth of its element.
+    std::string* capture = nullptr;
+    int          capture_depth = 0;
+    std::string  text;
+
+    std::size_t pos = 0;
+
+    while (pos < xml.size())
+    {
+        const auto lt = xml.find('<', pos);
+
+        if (capture != nullptr)
+        {
+            text.append(Unescape(xml.substr(pos, lt == std::string_view::npos ? std::string_view::npos : lt - pos)));
+        }
+
+        if (lt == std::string_view::npos)
+        {
+            break;
+        }
+
+        const auto rest = xml.substr(lt);
+
+        if (rest.starts_with("<!--"))
+        {
+            const auto end = xml.find("-->", lt + 4);
+            pos = end == std::string_view::npos ? xml.size() : end + 3;
+            continue;
+        }
+
+        if (rest.starts_with("<![CDATA["))
+        {
+            const auto end = xml.find("]]>", lt + 9);
+
+            if (capture != nullptr)
+            {
+                text.append(xml.substr(lt + 9, end == std::string_view::npos ? std::string_view::npos : end - lt - 9));
+            }
+
+            pos = end == std::string_view::npos ? xml.size() : end + 3;
+            continue;
+        }
+
+        // Declarations and processing instructions.
+        if (rest.starts_with("<?") || rest.starts_with("<!"))
+        {
+            const auto end = TagEnd(xml, lt + 2);
+            pos = end == std::string_view::npos ? xml.size() : end + 1;
+            continue;
+        }
+
+        const auto end = TagEnd(xml, lt + 1);
+
+        if (end == std::string_view::npos)
+        {
+            break;
+        }
+
+        pos = end + 1;
+
+        const auto tag = ParseTag(xml.substr(lt + 1, end - lt - 1));
+
+        if (!root)
+        {
+            if (tag.name != "rss" && tag.name != "RDF" && tag.name != "feed")
+            {
+                throw std::invalid_argument("Not an RSS or Atom feed");
+            }
+
+            root = true;
+        }
+
+        if (tag.closing)
+        {
+            if (capture != nullptr && depth == capture_depth)
+            {
+                if (capture->empty()) *capture = Trim(text);
+                capture = nullptr;
+            }
+
+            if (item_depth > 0 && depth == item_depth)
+            {
+                auto link = !fields.magnet.empty()    ? std::move(fields.magnet)
+                          : !fields.enclosure.empty() ? std::move(fields.enclosure)
+                          : std::move(fields.link);
+
+                items.push_back(Item{
+                    .id    = !fields.guid.empty() ? std::move(fields.guid) : link,
+                    .title = std::move(fields.title),
+                    .link  = std::move(link)
+                });
+
+                fields = {};
+                item_depth = 0;
+            }
+
+            depth--;
+            continue;
+        }
+
+        const int tag_depth = depth + 1;
+
+        if (!tag.self_closing)
+        {
+            depth = tag_depth;
+        }
+
+        if (item_depth == 0)
+        {
+            if ((tag.name == "item" || tag.name == "entry") && !tag.self_closing)
+            {
+                item_depth = tag_depth;
+            }
+
+            continue;
+        }
+
+        if (tag.name == "enclosure" && fields.enclosure.empty())
+        {
+            fields.enclosure = tag.Attribute("url");
+        }
+        // Torznab and Newznab indexers list the magnet link as an attribute.
+        else if (tag.name == "attr" && tag.Attribute("name") == "magneturl")
+        {
+            fields.magnet = tag.Attribute("value");
+        }
+        else if (tag.name == "link" && tag.attributes.contains("href"))
+        {
+            const auto rel = tag.Attribute("rel");
+
+            if (rel == "enclosure" && fields.enclosure.empty())   fields.enclosure = tag.Attribute("href");
+            else if ((rel.empty() || rel == "alternate") && fields.link.empty()) fields.link = tag.Attribute("href");
+        }
+        else if (tag_depth == item_depth + 1 && !tag.self_closing && capture == nullptr)
+        {
+            if (tag.name == "title")                          capture = &fields.title;
+            else if (tag.name == "link")                      capture = &fields.link;
+            else if (tag.name == "guid" || tag.name == "id")  capture = &fields.guid;
+
+            capture_depth = tag_depth;
+            text.clear();
+        }
+    }
+
+    if (!root)
+    {
+        throw std::invalid_argument("Not an RSS or Atom feed");
+    }
+
+    return items;
+}
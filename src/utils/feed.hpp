@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace porla::Utils
+{
+    // Reads the items of RSS 2.0 and Atom feeds. Only what is needed to add the torrents
+    // they link to is read, and the markup is scanned without validating it.
+    class Feed
+    {
+    public:
+        struct Item
+        {
+            // The guid or id of the item, or its link when it has neither.
+            std::string id;
+            std::string title;
+            // A magnet link from Torznab attributes, the enclosure, or the item link, in
+            // that order of preference.
+            std::string link;
+        };
+
+        // Items in document order. Throws std::invalid_argument if the document is neither
+        // an RSS nor an Atom feed.
+        static std::vector<Item> Parse(std::string_view xml);
+
+        // Replaces the predefined and numeric character references in text.
+        static std::string Unescape(std::string_view text);
+    };
+}
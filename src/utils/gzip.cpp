@@ -0,0 +1,115 @@
+#include "gzip.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "string.hpp"
+
+using porla::Utils::Gzip;
+using porla::Utils::String;
+
+Gzip::Stream::Stream(int level)
+    : m_zs(std::make_unique<z_stream>())
+{
+    if (deflateInit2(m_zs.get(), level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("Failed to initialize deflate");
+    }
+}
+
+Gzip::Stream::~Stream()
+{
+    deflateEnd(m_zs.get());
+}
+
+void Gzip::Stream::Write(std::string_view data, std::string& out, bool finish)
+{
+    m_zs->next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    m_zs->avail_in = static_cast<uInt>(data.size());
+
+    int res;
+
+    do
+    {
+        const std::size_t offset = out.size();
+        out.resize(offset + deflateBound(m_zs.get(), m_zs->avail_in) + 64);
+
+        m_zs->next_out  = reinterpret_cast<Bytef*>(out.data() + offset);
+        m_zs->avail_out = static_cast<uInt>(out.size() - offset);
+
+        res = deflate(m_zs.get(), finish ? Z_FINISH : Z_NO_FLUSH);
+        out.resize(out.size() - m_zs->avail_out);
+
+        if (res == Z_STREAM_ERROR)
+        {
+            throw std::runtime_error("Failed to deflate data");
+        }
+    }
+    while (finish ? res != Z_STREAM_END : m_zs->avail_in > 0);
+}
+
+std::string Gzip::Compress(std::string_view data, int level)
+{
+    z_stream zs{};
+
+    // 15 window bits, plus 16 for a gzip header and trailer instead of zlib ones.
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("Failed to initialize deflate");
+    }
+
+    std::string out;
+    out.resize(deflateBound(&zs, static_cast<uLong>(data.size())));
+
+    zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in  = static_cast<uInt>(data.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    const int res = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    if (res != Z_STREAM_END)
+    {
+        throw std::runtime_error("Failed to deflate data");
+    }
+
+    return out;
+}
+
+bool Gzip::IsAccepted(std::string_view accept_encoding)
+{
+    const auto trim = [](std::string_view sv)
+    {
+        while (!sv.empty() && sv.front() == ' ') sv.remove_prefix(1);
+        while (!sv.empty() && sv.back() == ' ')  sv.remove_suffix(1);
+        return sv;
+    };
+
+    for (const auto& part : String::Split(std::string(accept_encoding), ","))
+    {
+        const auto params = String::Split(part, ";");
+
+        if (params.empty() || trim(params[0]) != "gzip")
+        {
+            continue;
+        }
+
+        for (std::size_t i = 1; i < params.size(); i++)
+        {
+            const auto param = std::string(trim(params[i]));
+
+            if (param.starts_with("q=") && std::strtod(param.c_str() + 2, nullptr) <= 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+struct z_stream_s;
+
+namespace porla::Utils
+{
+    class Gzip
+    {
+    public:
+        // Compresses a body produced in parts into one gzip stream.
+        class Stream
+        {
+        public:
+            explicit Stream(int level = -1);
+            Stream(const Stream&) = delete;
+            ~Stream();
+
+            // Appends what the input compresses to so far to out, which may be nothing.
+            // The last call finishes the stream. Throws std::runtime_error if zlib fails.
+            void Write(std::string_view data, std::string& out, bool finish);
+
+        private:
+            std::unique_ptr<z_stream_s> m_zs;
+        };
+
+        // Compresses the data into a gzip stream. Level -1 is zlib's default. Throws
+        // std::runtime_error if zlib fails.
+        static std::string Compress(std::string_view data, int level = -1);
+
+        // True if the Accept-Encoding header value lists gzip with a non-zero quality.
+        static bool IsAccepted(std::string_view accept_encoding);
+    };
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace porla::Utils
+{
+    // Counts observations in buckets with fixed upper bounds, the way Prometheus histograms
+    // are exported. Counts are per bucket, not cumulative.
+    class Histogram
+    {
+    public:
+        explicit Histogram(std::vector<double> bounds)
+            : m_bounds(std::move(bounds))
+            , m_counts(m_bounds.size() + 1, 0)
+        {
+        }
+
+        void Observe(double value)
+        {
+            std::size_t bucket = 0;
+            while (bucket < m_bounds.size() && value > m_bounds[bucket]) { bucket++; }
+
+            m_counts[bucket]++;
+            m_count++;
+            m_sum += value;
+        }
+
+        // Adds the observations of a histogram with the same bounds.
+        void Merge(const Histogram& other)
+        {
+            if (other.m_bounds != m_bounds)
+            {
+                return;
+            }
+
+            for (std::size_t bucket = 0; bucket < m_counts.size(); bucket++)
+            {
+                m_counts[bucket] += other.m_counts[bucket];
+            }
+
+            m_count += other.m_count;
+            m_sum += other.m_sum;
+        }
+
+        [[nodiscard]] const std::vector<double>& Bounds() const { return m_bounds; }
+        // One more than the bounds, with the last one counting everything above them.
+        [[nodiscard]] const std::vector<std::uint64_t>& Counts() const { return m_counts; }
+        [[nodiscard]] std::uint64_t Count() const { return m_count; }
+        [[nodiscard]] double Sum() const { return m_sum; }
+
+        // Estimates the value below which the fraction q of observations fall, interpolating
+        // within the bucket like Prometheus' histogram_quantile. Observations above the last
+        // bound are taken to be at it.
+        [[nodiscard]] double Quantile(double q) const
+        {
+            if (m_count == 0 || m_bounds.empty())
+            {
+                return 0;
+            }
+
+            const double rank = q * static_cast<double>(m_count);
+            std::uint64_t cumulative = 0;
+
+            for (std::size_t bucket = 0; bucket < m_bounds.size(); bucket++)
+            {
+                const auto below = cumulative;
+                cumulative += m_counts[bucket];
+
+                if (m_counts[bucket] > 0 && static_cast<double>(cumulative) >= rank)
+                {
+                    const double lower = bucket == 0 ? 0 : m_bounds[bucket - 1];
+
+                    return lower + (m_bounds[bucket] - lower)
+                        * (rank - static_cast<double>(below)) / static_cast<double>(m_counts[bucket]);
+                }
+            }
+
+            return m_bounds.back();
+        }
+
+    private:
+        std::vector<double> m_bounds;
+        std::vector<std::uint64_t> m_counts;
+        std::uint64_t m_count = 0;
+        double m_sum = 0;
+    };
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace porla::Utils
+{
+    // Counts the live objects of T, as a member of T. For objects too many or too spread
+    // out to walk, such as the client data of every torrent.
+    template<typename T>
+    class LiveCount
+    {
+    public:
+        LiveCount() noexcept { s_count.fetch_add(1, std::memory_order_relaxed); }
+        LiveCount(const LiveCount&) noexcept : LiveCount() {}
+        LiveCount& operator=(const LiveCount&) noexcept { return *this; }
+        ~LiveCount() { s_count.fetch_sub(1, std::memory_order_relaxed); }
+
+        static std::uint64_t Count() noexcept { return s_count.load(std::memory_order_relaxed); }
+
+    private:
+        static inline std::atomic<std::uint64_t> s_count{0};
+    };
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace porla::Utils
+{
+    template<typename TKey, typename TValue, typename THash = std::hash<TKey>>
+    class LruCache
+    {
+    public:
+        explicit LruCache(std::size_t capacity)
+            : m_capacity(capacity)
+        {
+        }
+
+        std::optional<TValue> Get(const TKey& key)
+        {
+            const auto item = m_lookup.find(key);
+
+            if (item == m_lookup.end())
+            {
+                return std::nullopt;
+            }
+
+            // Move the item to the front so it is the last one to be evicted.
+            m_items.splice(m_items.begin(), m_items, item->second);
+
+            return item->second->second;
+        }
+
+        void Put(const TKey& key, TValue value)
+        {
+            if (m_capacity == 0)
+            {
+                return;
+            }
+
+            if (const auto item = m_lookup.find(key); item != m_lookup.end())
+            {
+                item->second->second = std::move(value);
+                m_items.splice(m_items.begin(), m_items, item->second);
+                return;
+            }
+
+            while (m_items.size() >= m_capacity)
+            {
+                m_lookup.erase(m_items.back().first);
+                m_items.pop_back();
+            }
+
+            m_items.emplace_front(key, std::move(value));
+            m_lookup.insert({ key, m_items.begin() });
+        }
+
+        void Erase(const TKey& key)
+        {
+            if (const auto item = m_lookup.find(key); item != m_lookup.end())
+            {
+                m_items.erase(item->second);
+                m_lookup.erase(item);
+            }
+        }
+
+        void Clear()
+        {
+            m_lookup.clear();
+            m_items.clear();
+        }
+
+        [[nodiscard]] std::size_t Size() const { return m_items.size(); }
+
+    private:
+        typedef std::list<std::pair<TKey, TValue>> ItemList;
+
+        std::size_t m_capacity;
+        ItemList m_items;
+        std::unordered_map<TKey, typename ItemList::iterator, THash> m_lookup;
+    };
+}
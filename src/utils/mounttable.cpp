@@ -0,0 +1,193 @@
+#include "mounttable.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using porla::Utils::MountTable;
+
+// Spaces, tabs, newlines and backslashes in paths are written as octal escapes.
+static std::string Unescape(std::string_view field)
+{
+    std::string out;
+    out.reserve(field.size());
+
+    for (std::size_t i = 0; i < field.size(); i++)
+    {
+        if (field[i] == '\\' && i + 3 < field.size()
+            && field[i + 1] >= '0' && field[i + 1] <= '7'
+            && field[i + 2] >= '0' && field[i + 2] <= '7'
+            && field[i + 3] >= '0' && field[i + 3] <= '7')
+        {
+            out.push_back(static_cast<char>((field[i + 1] - '0') << 6 | (field[i + 2] - '0') << 3 | (field[i + 3] - '0')));
+            i += 3;
+            continue;
+        }
+
+        out.push_back(field[i]);
+    }
+
+    return out;
+}
+
+static bool ParseNumber(std::string_view text, unsigned int& value)
+{
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+MountTable& MountTable::Instance()
+{
+    static MountTable table;
+    return table;
+}
+
+std::optional<std::uint64_t> MountTable::DeviceId(const std::string& path)
+{
+    std::filesystem::path current(path);
+    struct stat st{};
+
+    while (stat(current.c_str(), &st) < 0)
+    {
+        if (!current.has_relative_path())
+        {
+            return std::nullopt;
+        }
+
+        current = current.parent_path();
+    }
+
+    return static_cast<std::uint64_t>(st.st_dev);
+}
+
+std::map<MountTable::Device, MountTable::Mount> MountTable::Parse(std::string_view mountinfo)
+{
+    std::map<Device, Mount> mounts;
+    std::vector<std::string_view> fields;
+
+    while (!mountinfo.empty())
+    {
+        const auto eol = mountinfo.find('\n');
+        const auto line = mountinfo.substr(0, eol);
+        mountinfo.remove_prefix(eol == std::string_view::npos ? mountinfo.size() : eol + 1);
+
+        fields.clear();
+
+        for (std::size_t pos = 0; pos < line.size();)
+        {
+            const auto end = std::min(line.find(' ', pos), line.size());
+            if (end > pos) fields.push_back(line.substr(pos, end - pos));
+            pos = end + 1;
+        }
+
+        // id, parent id, major:minor, root, mount point, options, any number of optional
+        // fields, a separator, and then the file system type, source and super options.
+        std::size_t separator = 6;
+        while (separator < fields.size() && fields[separator] != "-") separator++;
+
+        if (separator + 2 >= fields.size())
+        {
+            continue;
+        }
+
+        const auto colon = fields[2].find(':');
+        Device device;
+
+        if (colon == std::string_view::npos
+            || !ParseNumber(fields[2].substr(0, colon), device.first)
+            || !ParseNumber(fields[2].substr(colon + 1), device.second))
+        {
+            continue;
+        }
+
+        mounts.try_emplace(device, Mount{
+            .fs_type     = std::string(fields[separator + 1]),
+            .mount_point = Unescape(fields[4]),
+            .source      = Unescape(fields[separator + 2])
+        });
+    }
+
+    return mounts;
+}
+
+MountTable::MountTable()
+    : m_fd(-1)
+    , m_loaded(false)
+{
+#ifdef __linux__
+    m_fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+
+    if (m_fd < 0)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to open /proc/self/mountinfo, mounts will not be found";
+    }
+#endif
+}
+
+MountTable::~MountTable()
+{
+#ifdef __linux__
+    if (m_fd >= 0) close(m_fd);
+#endif
+}
+
+std::optional<MountTable::Mount> MountTable::Find(Device device)
+{
+    std::unique_lock lock(m_mtx);
+
+#ifdef __linux__
+    if (m_fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    pollfd pfd{ .fd = m_fd, .events = POLLPRI, .revents = 0 };
+
+    if (!m_loaded || (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR)) != 0))
+    {
+        Reload();
+    }
+#endif
+
+    if (const auto mount = m_mounts.find(device); mount != m_mounts.end())
+    {
+        return mount->second;
+    }
+
+    return std::nullopt;
+}
+
+void MountTable::Reload()
+{
+#ifdef __linux__
+    // Reading the file from the start is also what clears the change flag.
+    std::string buf;
+    char chunk[4096];
+
+    if (lseek(m_fd, 0, SEEK_SET) < 0)
+    {
+        return;
+    }
+
+    for (ssize_t n; (n = read(m_fd, chunk, sizeof(chunk))) > 0;)
+    {
+        buf.append(chunk, static_cast<std::size_t>(n));
+    }
+
+    m_mounts = Parse(buf);
+    m_loaded = true;
+
+    BOOST_LOG_TRIVIAL(debug) << "Read " << m_mounts.size() << " mount(s) from /proc/self/mountinfo";
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace porla::Utils
+{
+    // The mounts in /proc/self/mountinfo by device number. The table is read once and
+    // again only after the kernel flags the open file with POLLPRI, which it does when
+    // something is mounted or unmounted, so a lookup is usually one poll call and a map
+    // find. Without mountinfo, nothing is found.
+    class MountTable
+    {
+    public:
+        typedef std::pair<unsigned int, unsigned int> Device; // major, minor
+
+        struct Mount
+        {
+            std::string fs_type;
+            std::string mount_point;
+            std::string source;
+        };
+
+        static MountTable& Instance();
+
+        // The st_dev of the file system a path is on. Paths which do not exist yet, such as
+        // save paths created on the first write, resolve to their closest existing parent.
+        static std::optional<std::uint64_t> DeviceId(const std::string& path);
+
+        // Parses mountinfo text. Lines which do not parse are skipped, and the first mount
+        // of a device is kept.
+        static std::map<Device, Mount> Parse(std::string_view mountinfo);
+
+        MountTable(const MountTable&) = delete;
+        ~MountTable();
+
+        std::optional<Mount> Find(Device device);
+
+    private:
+        MountTable();
+
+        void Reload();
+
+        int m_fd;
+        bool m_loaded;
+        std::mutex m_mtx;
+        std::map<Device, Mount> m_mounts;
+    };
+}
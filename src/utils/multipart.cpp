@@ -0,0 +1,148 @@
+#include "multipart.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+#include "string.hpp"
+
+using porla::Utils::Multipart;
+using porla::Utils::String;
+
+static std::string_view Trim(std::string_view sv)
+{
+    while (!sv.empty() && (sv.front() == ' ' || sv.front() == '\t')) sv.remove_prefix(1);
+    while (!sv.empty() && (sv.back() == ' ' || sv.back() == '\t'))   sv.remove_suffix(1);
+    return sv;
+}
+
+static std::string Unquote(std::string_view sv)
+{
+    sv = Trim(sv);
+
+    if (sv.size() >= 2 && sv.front() == '"' && sv.back() == '"')
+    {
+        sv = sv.substr(1, sv.size() - 2);
+    }
+
+    return std::string(sv);
+}
+
+static bool EqualsNoCase(std::string_view lhs, std::string_view rhs)
+{
+    return lhs.size() == rhs.size()
+        && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b)
+            {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            });
+}
+
+// The value of a parameter in a header like "form-data; name=\"params\"".
+static std::string Param(std::string_view header, std::string_view key)
+{
+    for (const auto& param : String::Split(std::string(header), ";"))
+    {
+        const auto trimmed = Trim(param);
+        const auto eq      = trimmed.find('=');
+
+        if (eq != std::string_view::npos && EqualsNoCase(Trim(trimmed.substr(0, eq)), key))
+        {
+            return Unquote(trimmed.substr(eq + 1));
+        }
+    }
+
+    return {};
+}
+
+std::string Multipart::Boundary(std::string_view content_type)
+{
+    const auto type = Trim(content_type.substr(0, content_type.find(';')));
+
+    if (!EqualsNoCase(type, "multipart/form-data"))
+    {
+        return {};
+    }
+
+    return Param(content_type, "boundary");
+}
+
+std::vector<Multipart::Part> Multipart::Parse(std::string_view body, std::string_view boundary)
+{
+    if (boundary.empty())
+    {
+        throw std::invalid_argument("Missing multipart boundary");
+    }
+
+    const std::string delimiter = "--" + std::string(boundary);
+    const std::string separator = "\r\n" + delimiter;
+
+    std::vector<Part> parts;
+    std::size_t pos = body.find(delimiter);
+
+    if (pos == std::string_view::npos)
+    {
+        throw std::invalid_argument("Multipart body has no boundary");
+    }
+
+    pos += delimiter.size();
+
+    // Each delimiter is followed by either a line break and the next part, or by "--" after
+    // the last one.
+    while (!body.substr(pos).starts_with("--"))
+    {
+        if (!body.substr(pos).starts_with("\r\n"))
+        {
+            throw std::invalid_argument("Malformed multipart boundary");
+        }
+
+        pos += 2;
+
+        const auto headers_end = body.find("\r\n\r\n", pos);
+
+        if (headers_end == std::string_view::npos)
+        {
+            throw std::invalid_argument("Multipart part has no end of headers");
+        }
+
+        Part part{};
+
+        for (const auto& line : String::Split(std::string(body.substr(pos, headers_end - pos)), "\r\n"))
+        {
+            const auto colon = line.find(':');
+
+            if (colon == std::string::npos)
+            {
+                continue;
+            }
+
+            const auto name  = Trim(std::string_view(line).substr(0, colon));
+            const auto value = Trim(std::string_view(line).substr(colon + 1));
+
+            if (EqualsNoCase(name, "Content-Disposition"))
+            {
+                part.name     = Param(value, "name");
+                part.filename = Param(value, "filename");
+            }
+            else if (EqualsNoCase(name, "Content-Type"))
+            {
+                part.content_type = std::string(value);
+            }
+        }
+
+        part.offset = headers_end + 4;
+
+        const auto end = body.find(separator, part.offset);
+
+        if (end == std::string_view::npos)
+        {
+            throw std::invalid_argument("Multipart part is not terminated");
+        }
+
+        part.size = end - part.offset;
+        parts.push_back(std::move(part));
+
+        pos = end + separator.size();
+    }
+
+    return parts;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace porla::Utils
+{
+    class Multipart
+    {
+    public:
+        struct Part
+        {
+            std::string name;
+            std::string filename;
+            std::string content_type;
+            // Where the content is in the body, which it is left in.
+            std::size_t offset;
+            std::size_t size;
+        };
+
+        // The boundary of a multipart/form-data Content-Type, or empty if it is not one.
+        static std::string Boundary(std::string_view content_type);
+
+        // Finds the parts of a multipart/form-data body. Throws std::invalid_argument if the
+        // body is malformed.
+        static std::vector<Part> Parse(std::string_view body, std::string_view boundary);
+    };
+}
@@ -0,0 +1,58 @@
+#include "phases.hpp"
+
+#include <cstdint>
+#include <sstream>
+
+using porla::Utils::Phases;
+
+Phases& Phases::Startup()
+{
+    static Phases phases;
+    return phases;
+}
+
+Phases& Phases::Shutdown()
+{
+    static Phases phases;
+    return phases;
+}
+
+void Phases::Begin()
+{
+    std::unique_lock lock(m_mtx);
+    m_start = std::chrono::steady_clock::now();
+}
+
+std::chrono::milliseconds Phases::Elapsed() const
+{
+    std::unique_lock lock(m_mtx);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start);
+}
+
+void Phases::Record(std::string name, std::chrono::steady_clock::duration elapsed)
+{
+    std::unique_lock lock(m_mtx);
+    m_phases.push_back(Phase{
+        .name    = std::move(name),
+        .seconds = std::chrono::duration<double>(elapsed).count()
+    });
+}
+
+std::vector<Phases::Phase> Phases::Get() const
+{
+    std::unique_lock lock(m_mtx);
+    return m_phases;
+}
+
+std::string Phases::Summary() const
+{
+    std::stringstream ss;
+
+    for (const auto& phase : Get())
+    {
+        if (ss.tellp() > 0) ss << ", ";
+        ss << phase.name << ": " << static_cast<std::int64_t>(phase.seconds * 1000) << "ms";
+    }
+
+    return ss.str();
+}
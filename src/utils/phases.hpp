@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace porla::Utils
+{
+    // Wall time of the named phases of startup or shutdown, in the order they finished.
+    // Nested phases are named after the one they are part of, like config.migrations.
+    class Phases
+    {
+    public:
+        struct Phase
+        {
+            std::string name;
+            double      seconds;
+        };
+
+        static Phases& Startup();
+        static Phases& Shutdown();
+
+        // Marks when the first phase starts, which Elapsed is measured from.
+        void Begin();
+        [[nodiscard]] std::chrono::milliseconds Elapsed() const;
+
+        // Runs fn and records how long it took, also when it throws.
+        template<typename TFn>
+        decltype(auto) Measure(std::string name, TFn&& fn)
+        {
+            struct Scope
+            {
+                Phases&                               phases;
+                std::string                           name;
+                std::chrono::steady_clock::time_point start;
+
+                ~Scope() { phases.Record(std::move(name), std::chrono::steady_clock::now() - start); }
+            } scope{ *this, std::move(name), std::chrono::steady_clock::now() };
+
+            return fn();
+        }
+
+        void Record(std::string name, std::chrono::steady_clock::duration elapsed);
+
+        [[nodiscard]] std::vector<Phase> Get() const;
+        // The phases as "name: 12ms", comma separated, for logging.
+        [[nodiscard]] std::string Summary() const;
+
+    private:
+        mutable std::mutex m_mtx;
+        std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+        std::vector<Phase> m_phases;
+    };
+}
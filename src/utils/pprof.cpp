@@ -0,0 +1,208 @@
+#include "pprof.hpp"
+
+using porla::Utils::Pprof;
+
+static void Varint(std::string& out, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<char>(value));
+}
+
+static void Key(std::string& out, int field, int wire_type)
+{
+    Varint(out, static_cast<std::uint64_t>(field) << 3 | wire_type);
+}
+
+// Zero is the default, and left out.
+static void Int(std::string& out, int field, std::uint64_t value)
+{
+    if (value == 0) return;
+
+    Key(out, field, 0);
+    Varint(out, value);
+}
+
+static void Bytes(std::string& out, int field, const std::string& value)
+{
+    Key(out, field, 2);
+    Varint(out, value.size());
+    out.append(value);
+}
+
+template<typename T>
+static void Packed(std::string& out, int field, const std::vector<T>& values)
+{
+    if (values.empty()) return;
+
+    std::string packed;
+    for (const auto value : values) Varint(packed, static_cast<std::uint64_t>(value));
+
+    Bytes(out, field, packed);
+}
+
+static std::string ValueType(std::int64_t type, std::int64_t unit)
+{
+    std::string out;
+    Int(out, 1, type);
+    Int(out, 2, unit);
+    return out;
+}
+
+Pprof::Pprof(
+    std::vector<std::pair<std::string, std::string>> sample_types,
+    std::pair<std::string, std::string> period_type,
+    std::int64_t period)
+    : m_period(period)
+{
+    // The first string is always the empty one.
+    String("");
+
+    for (const auto& [type, unit] : sample_types)
+    {
+        m_sampleTypes.emplace_back(String(type), String(unit));
+    }
+
+    m_periodType = {String(period_type.first), String(period_type.second)};
+}
+
+void Pprof::AddMapping(std::uint64_t start, std::uint64_t limit, std::uint64_t offset, const std::string& file, const std::string& build_id)
+{
+    m_mappings.push_back(Mapping{
+        .start    = start,
+        .limit    = limit,
+        .offset   = offset,
+        .file     = String(file),
+        .build_id = String(build_id)
+    });
+}
+
+void Pprof::AddFunction(std::uint64_t address, const std::string& name)
+{
+    m_functions[address] = String(name);
+}
+
+void Pprof::AddSample(const std::vector<std::uint64_t>& stack, const std::vector<std::int64_t>& values, const std::vector<Label>& labels)
+{
+    Sample sample{ .values = values };
+
+    sample.locations.reserve(stack.size());
+    for (const auto address : stack) sample.locations.push_back(Location(address));
+
+    for (const auto& label : labels)
+    {
+        sample.labels.push_back({String(label.key), label.str.empty() ? 0 : String(label.str), label.num});
+    }
+
+    m_samples.push_back(std::move(sample));
+}
+
+std::string Pprof::Encode(std::int64_t time_nanos, std::int64_t duration_nanos) const
+{
+    std::string out;
+
+    for (const auto& [type, unit] : m_sampleTypes)
+    {
+        Bytes(out, 1, ValueType(type, unit));
+    }
+
+    for (const auto& sample : m_samples)
+    {
+        std::string message;
+        Packed(message, 1, sample.locations);
+        Packed(message, 2, sample.values);
+
+        for (const auto& [key, str, num] : sample.labels)
+        {
+            std::string label;
+            Int(label, 1, key);
+            Int(label, 2, str);
+            Int(label, 3, num);
+            Bytes(message, 3, label);
+        }
+
+        Bytes(out, 2, message);
+    }
+
+    for (std::size_t i = 0; i < m_mappings.size(); i++)
+    {
+        const auto& mapping = m_mappings[i];
+
+        std::string message;
+        Int(message, 1, i + 1);
+        Int(message, 2, mapping.start);
+        Int(message, 3, mapping.limit);
+        Int(message, 4, mapping.offset);
+        Int(message, 5, mapping.file);
+        Int(message, 6, mapping.build_id);
+        Bytes(out, 3, message);
+    }
+
+    // One function for each name, shared by the locations in it.
+    std::map<std::int64_t, std::uint64_t> functions;
+
+    for (const auto& [address, id] : m_locations)
+    {
+        std::string message;
+        Int(message, 1, id);
+        Int(message, 3, address);
+
+        for (std::size_t i = 0; i < m_mappings.size(); i++)
+        {
+            if (address >= m_mappings[i].start && address < m_mappings[i].limit)
+            {
+                Int(message, 2, i + 1);
+                break;
+            }
+        }
+
+        if (const auto name = m_functions.find(address); name != m_functions.end())
+        {
+            const auto function = functions.try_emplace(name->second, functions.size() + 1).first->second;
+
+            std::string line;
+            Int(line, 1, function);
+            Bytes(message, 4, line);
+        }
+
+        Bytes(out, 4, message);
+    }
+
+    for (const auto& [name, id] : functions)
+    {
+        std::string message;
+        Int(message, 1, id);
+        Int(message, 2, name);
+        Int(message, 3, name);
+        Bytes(out, 5, message);
+    }
+
+    for (const auto& value : m_strings)
+    {
+        Bytes(out, 6, value);
+    }
+
+    Int(out, 9, time_nanos);
+    Int(out, 10, duration_nanos);
+    Bytes(out, 11, ValueType(m_periodType.first, m_periodType.second));
+    Int(out, 12, m_period);
+
+    return out;
+}
+
+std::int64_t Pprof::String(const std::string& value)
+{
+    const auto [it, inserted] = m_stringIds.try_emplace(value, static_cast<std::int64_t>(m_strings.size()));
+    if (inserted) m_strings.push_back(value);
+
+    return it->second;
+}
+
+std::uint64_t Pprof::Location(std::uint64_t address)
+{
+    return m_locations.try_emplace(address, m_locations.size() + 1).first->second;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace porla::Utils
+{
+    // Builds a profile in pprof's protobuf format, profile.proto, which `go tool pprof`
+    // reads gzipped or not. Locations are found by address, and named by the function
+    // added for it, or left for pprof to symbolize from the mappings.
+    class Pprof
+    {
+    public:
+        struct Label
+        {
+            std::string  key;
+            std::string  str;
+            std::int64_t num = 0;
+        };
+
+        // Types are (type, unit) pairs, such as ("cpu", "nanoseconds").
+        explicit Pprof(
+            std::vector<std::pair<std::string, std::string>> sample_types,
+            std::pair<std::string, std::string> period_type,
+            std::int64_t period);
+
+        // A mapped object, where addresses from start up to limit are at offset in file.
+        void AddMapping(std::uint64_t start, std::uint64_t limit, std::uint64_t offset, const std::string& file, const std::string& build_id);
+
+        // Names the location at address.
+        void AddFunction(std::uint64_t address, const std::string& name);
+
+        // The stack is leaf first, and there is a value for each sample type.
+        void AddSample(const std::vector<std::uint64_t>& stack, const std::vector<std::int64_t>& values, const std::vector<Label>& labels = {});
+
+        [[nodiscard]] std::string Encode(std::int64_t time_nanos, std::int64_t duration_nanos) const;
+
+    private:
+        struct Mapping
+        {
+            std::uint64_t start;
+            std::uint64_t limit;
+            std::uint64_t offset;
+            std::int64_t  file;
+            std::int64_t  build_id;
+        };
+
+        struct Sample
+        {
+            std::vector<std::uint64_t> locations;
+            std::vector<std::int64_t>  values;
+            // Key, str and num, with the strings in the table.
+            std::vector<std::array<std::int64_t, 3>> labels;
+        };
+
+        std::int64_t String(const std::string& value);
+        std::uint64_t Location(std::uint64_t address);
+
+        std::vector<std::pair<std::int64_t, std::int64_t>> m_sampleTypes;
+        std::pair<std::int64_t, std::int64_t>              m_periodType;
+        std::int64_t                                       m_period;
+
+        std::vector<std::string>                m_strings;
+        std::map<std::string, std::int64_t>     m_stringIds;
+        std::vector<Mapping>                    m_mappings;
+        // Function names by address, and the location of each address.
+        std::map<std::uint64_t, std::int64_t>   m_functions;
+        std::map<std::uint64_t, std::uint64_t>  m_locations;
+        std::vector<Sample>                     m_samples;
+    };
+}
@@ -0,0 +1,56 @@
+#include "settingspack.hpp"
+
+#include <cstring>
+
+namespace lt = libtorrent;
+
+using porla::Utils::SettingsPack;
+
+std::vector<int> SettingsPack::Keys(const lt::settings_pack& pack)
+{
+    std::vector<int> keys;
+
+    const auto collect = [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            if (strcmp(lt::name_for_setting(i), "") != 0 && pack.has_val(i)) keys.push_back(i);
+        }
+    };
+
+    collect(lt::settings_pack::string_type_base, lt::settings_pack::max_string_setting_internal);
+    collect(lt::settings_pack::int_type_base, lt::settings_pack::max_int_setting_internal);
+    collect(lt::settings_pack::bool_type_base, lt::settings_pack::max_bool_setting_internal);
+
+    return keys;
+}
+
+bool SettingsPack::Equal(const lt::settings_pack& lhs, const lt::settings_pack& rhs, int key)
+{
+    switch (key & lt::settings_pack::type_mask)
+    {
+    case lt::settings_pack::bool_type_base:   return lhs.get_bool(key) == rhs.get_bool(key);
+    case lt::settings_pack::int_type_base:    return lhs.get_int(key) == rhs.get_int(key);
+    case lt::settings_pack::string_type_base: return lhs.get_str(key) == rhs.get_str(key);
+    }
+
+    return false;
+}
+
+void SettingsPack::Copy(lt::settings_pack& into, const lt::settings_pack& from, int key)
+{
+    switch (key & lt::settings_pack::type_mask)
+    {
+    case lt::settings_pack::bool_type_base:   into.set_bool(key, from.get_bool(key)); break;
+    case lt::settings_pack::int_type_base:    into.set_int(key, from.get_int(key)); break;
+    case lt::settings_pack::string_type_base: into.set_str(key, from.get_str(key)); break;
+    }
+}
+
+void SettingsPack::Merge(lt::settings_pack& into, const lt::settings_pack& from)
+{
+    for (const int key : Keys(from))
+    {
+        Copy(into, from, key);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include <libtorrent/settings_pack.hpp>
+
+namespace porla::Utils
+{
+    // What settings_pack has no API for: listing the settings a pack has, and copying
+    // them between packs whatever their type.
+    class SettingsPack
+    {
+    public:
+        // The settings set in the pack, in the order of their ids.
+        static std::vector<int> Keys(const libtorrent::settings_pack& pack);
+
+        static bool Equal(const libtorrent::settings_pack& lhs, const libtorrent::settings_pack& rhs, int key);
+        static void Copy(libtorrent::settings_pack& into, const libtorrent::settings_pack& from, int key);
+
+        // Copies every setting set in from, keeping the rest of into.
+        static void Merge(libtorrent::settings_pack& into, const libtorrent::settings_pack& from);
+    };
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace porla::Utils
+{
+    namespace Detail
+    {
+        struct SlotBase
+        {
+            virtual ~SlotBase() = default;
+            virtual void Disconnect() = 0;
+
+            bool connected = true;
+        };
+    }
+
+    // A handle to a connected slot. It does not keep the slot or the signal alive, and
+    // disconnecting after either is gone does nothing.
+    class Connection
+    {
+    public:
+        Connection() = default;
+
+        explicit Connection(std::weak_ptr<Detail::SlotBase> slot)
+            : m_slot(std::move(slot))
+        {
+        }
+
+        void disconnect()
+        {
+            if (const auto slot = m_slot.lock(); slot && slot->connected)
+            {
+                slot->Disconnect();
+            }
+
+            m_slot.reset();
+        }
+
+        [[nodiscard]] bool connected() const
+        {
+            const auto slot = m_slot.lock();
+            return slot && slot->connected;
+        }
+
+    private:
+        std::weak_ptr<Detail::SlotBase> m_slot;
+    };
+
+    // Disconnects when it goes out of scope.
+    class ScopedConnection
+    {
+    public:
+        ScopedConnection() = default;
+
+        ScopedConnection(Connection connection)
+            : m_connection(std::move(connection))
+        {
+        }
+
+        ScopedConnection(const ScopedConnection&) = delete;
+        ScopedConnection& operator=(const ScopedConnection&) = delete;
+
+        ScopedConnection& operator=(Connection connection)
+        {
+            m_connection.disconnect();
+            m_connection = std::move(connection);
+            return *this;
+        }
+
+        ~ScopedConnection()
+        {
+            m_connection.disconnect();
+        }
+
+        void disconnect() { m_connection.disconnect(); }
+        [[nodiscard]] bool connected() const { return m_connection.connected(); }
+
+    private:
+        Connection m_connection;
+    };
+
+    template<typename TSignature>
+    class Signal;
+
+    // A signal for code that connects and emits on one thread, as everything on the io
+    // context does. Emitting takes no lock and touches no reference counts, it only walks
+    // the slots. Slots can connect and disconnect while it is emitting. Slots connected
+    // during an emit are called from the next one, and disconnected ones are not called
+    // again. The names follow boost::signals2 so the two are interchangeable at call sites.
+    template<typename... TArgs>
+    class Signal<void(TArgs...)>
+    {
+    public:
+        typedef std::function<void(TArgs...)> slot_type;
+
+        Signal() = default;
+        Signal(const Signal&) = delete;
+        Signal& operator=(const Signal&) = delete;
+
+        ~Signal()
+        {
+            // Connections still holding a slot find it gone.
+            m_slots.clear();
+        }
+
+        Connection connect(slot_type fn)
+        {
+            auto slot = std::make_shared<Slot>(this, std::move(fn));
+            m_slots.push_back(slot);
+            m_connected++;
+
+            return Connection(slot);
+        }
+
+        void operator()(TArgs... args) const
+        {
+            const Emitting emitting(*this);
+
+            // Only the slots connected before the emit began.
+            const auto size = m_slots.size();
+
+            for (std::size_t i = 0; i < size; i++)
+            {
+                // Indexed, since the vector may grow under a slot connecting another.
+                auto& slot = *m_slots[i];
+                if (slot.connected) { slot.fn(args...); }
+            }
+        }
+
+        [[nodiscard]] bool empty() const { return m_connected == 0; }
+        [[nodiscard]] std::size_t num_slots() const { return m_connected; }
+
+    private:
+        struct Slot : Detail::SlotBase
+        {
+            Slot(Signal* signal, slot_type fn)
+                : signal(signal)
+                , fn(std::move(fn))
+            {
+            }
+
+            void Disconnect() override
+            {
+                connected = false;
+                signal->Disconnected();
+            }
+
+            Signal*   signal;
+            slot_type fn;
+        };
+
+        // Slots are only erased once no emit is walking them.
+        struct Emitting
+        {
+            explicit Emitting(const Signal& signal)
+                : signal(signal)
+            {
+                signal.m_emitting++;
+            }
+
+            ~Emitting()
+            {
+                if (--signal.m_emitting == 0 && signal.m_dirty) { signal.Compact(); }
+            }
+
+            const Signal& signal;
+        };
+
+        void Disconnected()
+        {
+            m_connected--;
+            m_dirty = true;
+
+            if (m_emitting == 0) { Compact(); }
+        }
+
+        void Compact() const
+        {
+            std::erase_if(m_slots, [](const auto& slot) { return !slot->connected; });
+            m_dirty = false;
+        }
+
+        // Emitting is const, as with boost::signals2, though it may compact the slots.
+        mutable std::vector<std::shared_ptr<Slot>> m_slots;
+        std::size_t m_connected = 0;
+        mutable int m_emitting = 0;
+        mutable bool m_dirty = false;
+    };
+}
@@ -23,3 +23,23 @@ std::vector<std::string> String::Split(const std::string &val, const std::string
 
     return result;
 }
+
+std::string String::UrlHost(const std::string& url)
+{
+    auto start = url.find("://");
+    start = start == std::string::npos ? 0 : start + 3;
+
+    std::size_t end;
+
+    if (start < url.size() && url[start] == '[')
+    {
+        end = url.find(']', start);
+        if (end != std::string::npos) { end++; }
+    }
+    else
+    {
+        end = url.find_first_of(":/?", start);
+    }
+
+    return url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
@@ -9,5 +9,8 @@ namespace porla::Utils
     {
     public:
         static std::vector<std::string> Split(const std::string& val, const std::string& delim);
+        // The host of a URL, with IPv6 addresses in their brackets. Parsed by hand, since it
+        // runs for every tracker of every torrent.
+        static std::string UrlHost(const std::string& url);
     };
 }
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace porla::Utils
+{
+    // The heaviest keys of a weighted stream, in the memory of a fixed number of them, by
+    // the Space-Saving algorithm. A key not held takes the place of the lightest one and
+    // starts from its weight, which is kept as the error. So a key's weight is never
+    // under its real one and at most its error over it, and every key heavier than the
+    // total weight over the capacity is held.
+    template<typename TKey, typename TCompare = std::less<TKey>>
+    class TopK
+    {
+    public:
+        struct Item
+        {
+            TKey          key;
+            std::uint64_t weight;
+            std::uint64_t error;
+        };
+
+        explicit TopK(std::size_t capacity)
+            : m_capacity(capacity)
+        {
+        }
+
+        void Add(const TKey& key, std::uint64_t weight)
+        {
+            if (m_capacity == 0 || weight == 0)
+            {
+                return;
+            }
+
+            if (const auto item = m_items.find(key); item != m_items.end())
+            {
+                m_order.erase({ item->second.weight, key });
+                item->second.weight += weight;
+                m_order.insert({ item->second.weight, key });
+                return;
+            }
+
+            Counts counts{ .weight = weight, .error = 0 };
+
+            if (m_items.size() >= m_capacity)
+            {
+                const auto lightest = m_order.begin();
+
+                counts.weight += lightest->first;
+                counts.error   = lightest->first;
+
+                m_items.erase(lightest->second);
+                m_order.erase(lightest);
+            }
+
+            m_items.insert({ key, counts });
+            m_order.insert({ counts.weight, key });
+        }
+
+        // Adds the keys of the other one, as if its stream had been added to this one.
+        void Merge(const TopK& other)
+        {
+            for (const auto& [key, counts] : other.m_items)
+            {
+                Add(key, counts.weight);
+
+                // Whatever the other one could be over by, this one can be too.
+                if (const auto item = m_items.find(key); item != m_items.end())
+                {
+                    item->second.error += counts.error;
+                }
+            }
+        }
+
+        // The heaviest first, at most limit of them.
+        [[nodiscard]] std::vector<Item> Top(std::size_t limit) const
+        {
+            std::vector<Item> result;
+            result.reserve(std::min(limit, m_items.size()));
+
+            for (auto it = m_order.rbegin(); it != m_order.rend() && result.size() < limit; ++it)
+            {
+                result.push_back({ it->second, it->first, m_items.at(it->second).error });
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] std::size_t Size() const { return m_items.size(); }
+
+    private:
+        struct Counts
+        {
+            std::uint64_t weight;
+            std::uint64_t error;
+        };
+
+        struct Order
+        {
+            bool operator()(const std::pair<std::uint64_t, TKey>& lhs, const std::pair<std::uint64_t, TKey>& rhs) const
+            {
+                if (lhs.first != rhs.first) return lhs.first < rhs.first;
+                return TCompare{}(lhs.second, rhs.second);
+            }
+        };
+
+        std::size_t m_capacity;
+        std::map<TKey, Counts, TCompare> m_items;
+        std::set<std::pair<std::uint64_t, TKey>, Order> m_order;
+    };
+}
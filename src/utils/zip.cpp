@@ -0,0 +1,159 @@
+#include "zip.hpp"
+
+#include <stdexcept>
+
+#include <zlib.h>
+
+using porla::Utils::Zip;
+
+static constexpr std::uint32_t CentralHeader  = 0x02014b50;
+static constexpr std::uint32_t EndOfDirectory = 0x06054b50;
+static constexpr std::uint32_t LocalHeader    = 0x04034b50;
+
+static std::uint16_t U16(std::string_view data, std::size_t offset)
+{
+    if (offset + 2 > data.size()) throw std::runtime_error("Truncated zip archive");
+
+    return static_cast<std::uint16_t>(
+        static_cast<std::uint8_t>(data[offset])
+        | static_cast<std::uint8_t>(data[offset + 1]) << 8);
+}
+
+static std::uint32_t U32(std::string_view data, std::size_t offset)
+{
+    return U16(data, offset) | static_cast<std::uint32_t>(U16(data, offset + 2)) << 16;
+}
+
+static void PutU32(std::string& out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>(value >> (i * 8) & 0xff));
+}
+
+std::vector<Zip::Entry> Zip::Entries(std::string_view archive)
+{
+    // The end of directory record is last, followed only by a comment of at most 64 KiB.
+    static constexpr std::size_t EndSize = 22;
+
+    if (archive.size() < EndSize)
+    {
+        throw std::runtime_error("Truncated zip archive");
+    }
+
+    std::size_t end = archive.size() - EndSize;
+    const std::size_t lowest = end > 0xffff ? end - 0xffff : 0;
+
+    while (U32(archive, end) != EndOfDirectory)
+    {
+        if (end == lowest) throw std::runtime_error("Missing zip end of central directory");
+        end--;
+    }
+
+    const std::uint16_t count  = U16(archive, end + 10);
+    std::size_t         offset = U32(archive, end + 16);
+
+    std::vector<Entry> entries;
+    entries.reserve(count);
+
+    for (std::uint16_t i = 0; i < count; i++)
+    {
+        if (U32(archive, offset) != CentralHeader)
+        {
+            throw std::runtime_error("Invalid zip central directory entry");
+        }
+
+        const std::uint16_t flags    = U16(archive, offset + 8);
+        const std::uint32_t stored   = U32(archive, offset + 20);
+        const std::uint16_t name_len = U16(archive, offset + 28);
+        const std::size_t   local    = U32(archive, offset + 42);
+
+        if (flags & 1)
+        {
+            throw std::runtime_error("Encrypted zip archives are not supported");
+        }
+
+        if (offset + 46 + name_len > archive.size() || U32(archive, local) != LocalHeader)
+        {
+            throw std::runtime_error("Invalid zip entry");
+        }
+
+        // The local header's name and extra field can differ in length from the central
+        // directory's, so the data offset comes from it.
+        const std::size_t data = local + 30 + U16(archive, local + 26) + U16(archive, local + 28);
+
+        if (data + stored > archive.size())
+        {
+            throw std::runtime_error("Truncated zip entry");
+        }
+
+        entries.push_back(Entry{
+            .name   = std::string(archive.substr(offset + 46, name_len)),
+            .method = U16(archive, offset + 10),
+            .crc32  = U32(archive, offset + 16),
+            .data   = archive.substr(data, stored),
+            .size   = U32(archive, offset + 24)
+        });
+
+        offset += 46 + name_len + U16(archive, offset + 30) + U16(archive, offset + 32);
+    }
+
+    return entries;
+}
+
+std::string Zip::Gzip(const Entry& entry)
+{
+    if (entry.method != Deflated)
+    {
+        throw std::runtime_error("Only deflated zip entries can be served as gzip");
+    }
+
+    // Deflate, no flags or mtime, and an unknown OS.
+    static constexpr char Header[] = { 0x1f, static_cast<char>(0x8b), 8, 0, 0, 0, 0, 0, 0, static_cast<char>(0xff) };
+
+    std::string out;
+    out.reserve(sizeof(Header) + entry.data.size() + 8);
+    out.append(Header, sizeof(Header));
+    out.append(entry.data);
+
+    PutU32(out, entry.crc32);
+    PutU32(out, entry.size);
+
+    return out;
+}
+
+std::string Zip::Inflate(const Entry& entry)
+{
+    if (entry.method == Stored)
+    {
+        return std::string(entry.data);
+    }
+
+    if (entry.method != Deflated)
+    {
+        throw std::runtime_error("Unsupported zip compression method");
+    }
+
+    z_stream zs{};
+
+    // Negative window bits for raw deflate data, without a zlib header.
+    if (inflateInit2(&zs, -15) != Z_OK)
+    {
+        throw std::runtime_error("Failed to initialize inflate");
+    }
+
+    std::string out(entry.size, '\0');
+
+    zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(entry.data.data()));
+    zs.avail_in  = static_cast<uInt>(entry.data.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    const int res = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+
+    if (res != Z_STREAM_END || zs.total_out != entry.size)
+    {
+        throw std::runtime_error("Failed to inflate zip entry");
+    }
+
+    return out;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace porla::Utils
+{
+    // Reads a zip archive held in memory, pointing into it instead of copying or inflating
+    // the entries. Zip64 and encrypted archives are not supported.
+    class Zip
+    {
+    public:
+        static constexpr std::uint16_t Stored   = 0;
+        static constexpr std::uint16_t Deflated = 8;
+
+        struct Entry
+        {
+            std::string      name;
+            std::uint16_t    method;
+            std::uint32_t    crc32;
+            // The entry as it is stored in the archive.
+            std::string_view data;
+            std::uint32_t    size;
+        };
+
+        // Throws std::runtime_error if the archive is malformed.
+        static std::vector<Entry> Entries(std::string_view archive);
+
+        // The entry as a gzip stream. Deflated entries are wrapped in a gzip header and
+        // trailer, without inflating them.
+        static std::string Gzip(const Entry& entry);
+
+        // The entry's content. Throws std::runtime_error if it does not inflate.
+        static std::string Inflate(const Entry& entry);
+    };
+}
@@ -0,0 +1,351 @@
+#include "watchdirectories.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+#include <boost/log/trivial.hpp>
+#include <libtorrent/add_torrent_params.hpp>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "methods/torrentsadd.hpp"
+#include "session.hpp"
+#include "workerpool.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::WatchDirectories;
+
+// Files are parsed in groups of this size, so a large drop spreads over the workers.
+static constexpr std::size_t ParseBatchSize = 100;
+// The same as the largest request body the HTTP server accepts.
+static constexpr std::uintmax_t MaxFileSize = 10 * 1024 * 1024;
+// Time given to a burst of inotify events before scanning, so they end up in one batch.
+static constexpr std::chrono::milliseconds Debounce(250);
+
+WatchDirectories::WatchDirectories(
+    boost::asio::io_context& io,
+    porla::ISession& session,
+    const porla::Methods::TorrentsAdd& add,
+    porla::WatchDirectoriesOptions options)
+    : m_io(io)
+    , m_session(session)
+    , m_add(add)
+    , m_options(std::move(options))
+    , m_timer(io)
+    , m_scheduled(false)
+{
+    for (const auto& [name, dir] : m_options.directories)
+    {
+        std::error_code ec;
+        fs::create_directories(dir.path, ec);
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to create watch directory " << dir.path << ": " << ec.message();
+        }
+    }
+
+#ifdef __linux__
+    if (const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC); fd >= 0)
+    {
+        bool watching = true;
+
+        for (const auto& [name, dir] : m_options.directories)
+        {
+            if (inotify_add_watch(fd, dir.path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Failed to watch " << dir.path << " with inotify, falling back to polling";
+                watching = false;
+                break;
+            }
+        }
+
+        m_inotify = std::make_unique<boost::asio::posix::stream_descriptor>(io, fd);
+
+        if (watching)
+        {
+            Read();
+        }
+        else
+        {
+            m_inotify.reset();
+        }
+    }
+#endif
+
+    BOOST_LOG_TRIVIAL(info) << "Watching " << m_options.directories.size() << " director(y/ies) for torrent files";
+
+    Schedule(std::chrono::milliseconds(0));
+}
+
+WatchDirectories::~WatchDirectories()
+{
+    m_timer.cancel();
+
+#ifdef __linux__
+    if (m_inotify) m_inotify->close();
+#endif
+}
+
+void WatchDirectories::Add(std::vector<Parsed> parsed)
+{
+    std::vector<lt::add_torrent_params> params;
+    std::vector<File> files;
+
+    for (auto& item : parsed)
+    {
+        if (!item.req.has_value())
+        {
+            Consume(item.file, false);
+            continue;
+        }
+
+        lt::add_torrent_params p;
+
+        if (const auto error = m_add.Build(*item.req, p))
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to add " << item.file.path << ": " << error->message;
+            Consume(item.file, false);
+            continue;
+        }
+
+        params.push_back(std::move(p));
+        files.push_back(std::move(item.file));
+    }
+
+    if (params.empty())
+    {
+        return;
+    }
+
+    m_session.AddTorrents(
+        std::move(params),
+        [this, files = std::move(files)](std::vector<ISession::AddTorrentResult> results)
+        {
+            for (std::size_t i = 0; i < results.size(); i++)
+            {
+                if (!results[i].error.empty())
+                {
+                    BOOST_LOG_TRIVIAL(warning) << "Failed to add " << files[i].path << ": " << results[i].error;
+                }
+
+                Consume(files[i], results[i].error.empty());
+            }
+
+            BOOST_LOG_TRIVIAL(info) << "Added " << results.size() << " torrent file(s) from watch directories";
+        });
+}
+
+void WatchDirectories::Consume(const File& file, bool added)
+{
+    m_inflight.erase(file.path);
+
+    if (!added)
+    {
+        m_failed.insert_or_assign(file.path, file.modified);
+        return;
+    }
+
+    const auto& dir = m_options.directories.at(file.directory);
+    std::error_code ec;
+
+    if (dir.move_to.has_value())
+    {
+        const auto target = *dir.move_to / file.path.filename();
+
+        fs::create_directories(*dir.move_to, ec);
+        fs::rename(file.path, target, ec);
+
+        // Renaming does not work across file systems.
+        if (ec && fs::copy_file(file.path, target, fs::copy_options::overwrite_existing, ec))
+        {
+            fs::remove(file.path, ec);
+        }
+    }
+    else
+    {
+        fs::remove(file.path, ec);
+    }
+
+    if (ec)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to consume " << file.path << ": " << ec.message();
+        // Keeps it from being added again on the next scan.
+        m_failed.insert_or_assign(file.path, file.modified);
+    }
+}
+
+WatchDirectories::Parsed WatchDirectories::Parse(const File& file) const
+{
+    Parsed parsed{ .file = file };
+
+    std::ifstream in(file.path, std::ios::binary);
+
+    if (!in)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Failed to read " << file.path;
+        return parsed;
+    }
+
+    Methods::TorrentsAddReq req;
+    req.preset = m_options.directories.at(file.directory).preset;
+    req.ti     = std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    Methods::TorrentsAdd::ParseTorrentInfo(req);
+
+    parsed.req = std::move(req);
+
+    return parsed;
+}
+
+void WatchDirectories::Read()
+{
+#ifdef __linux__
+    // The events themselves are not needed, only that something changed.
+    m_inotify->async_read_some(
+        boost::asio::buffer(m_events),
+        [this](const boost::system::error_code& ec, std::size_t)
+        {
+            if (ec) { return; }
+
+            Schedule(Debounce);
+            Read();
+        });
+#endif
+}
+
+void WatchDirectories::Scan()
+{
+    // The files are left where they are, rather than moved away as failed.
+    if (m_session.Draining().draining)
+    {
+        return Schedule(m_options.interval);
+    }
+
+    std::set<fs::path> seen;
+    std::vector<File> found;
+
+    for (const auto& [name, dir] : m_options.directories)
+    {
+        std::error_code ec;
+
+        for (const auto& entry : fs::directory_iterator(dir.path, ec))
+        {
+            std::error_code entry_ec;
+
+            if (!entry.is_regular_file(entry_ec) || entry.path().extension() != ".torrent")
+            {
+                continue;
+            }
+
+            const auto modified = entry.last_write_time(entry_ec);
+
+            if (entry_ec)
+            {
+                continue;
+            }
+
+            seen.insert(entry.path());
+
+            if (m_inflight.contains(entry.path()))
+            {
+                continue;
+            }
+
+            if (const auto failed = m_failed.find(entry.path()); failed != m_failed.end() && failed->second == modified)
+            {
+                continue;
+            }
+
+            if (entry.file_size(entry_ec) > MaxFileSize)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Skipping " << entry.path() << ", which is too large to be a torrent file";
+                m_failed.insert_or_assign(entry.path(), modified);
+                continue;
+            }
+
+            found.push_back(File{ .directory = name, .path = entry.path(), .modified = modified });
+        }
+
+        if (ec)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Failed to scan watch directory " << dir.path << ": " << ec.message();
+        }
+    }
+
+    // Forget failures for files which are gone.
+    std::erase_if(m_failed, [&seen](const auto& item) { return !seen.contains(item.first); });
+
+    bool retry = false;
+
+    for (std::size_t offset = 0; offset < found.size(); offset += ParseBatchSize)
+    {
+        std::vector<File> batch(
+            found.begin() + static_cast<std::ptrdiff_t>(offset),
+            found.begin() + static_cast<std::ptrdiff_t>(std::min(found.size(), offset + ParseBatchSize)));
+
+        for (const auto& file : batch) m_inflight.insert(file.path);
+
+        const auto parse = [this, batch]()
+        {
+            std::vector<Parsed> parsed;
+            parsed.reserve(batch.size());
+
+            for (const auto& file : batch) parsed.push_back(Parse(file));
+
+            return parsed;
+        };
+
+        if (m_options.pool == nullptr)
+        {
+            Add(parse());
+            continue;
+        }
+
+        const bool posted = m_options.pool->Post(
+            [this, parse]()
+            {
+                m_options.pool->Complete([this, parsed = parse()]() mutable { Add(std::move(parsed)); });
+            });
+
+        if (!posted)
+        {
+            for (const auto& file : batch) m_inflight.erase(file.path);
+            retry = true;
+        }
+    }
+
+#ifdef __linux__
+    if (m_inotify && !retry) return;
+#endif
+
+    Schedule(m_options.interval);
+}
+
+void WatchDirectories::Schedule(std::chrono::milliseconds delay)
+{
+    const auto at = std::chrono::steady_clock::now() + delay;
+
+    // A scan which is already due sooner picks up the changes too.
+    if (m_scheduled && m_timer.expiry() <= at)
+    {
+        return;
+    }
+
+    m_scheduled = true;
+    m_timer.expires_at(at);
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+
+            m_scheduled = false;
+            Scan();
+        });
+}
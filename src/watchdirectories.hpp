@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+
+#include "config.hpp"
+#include "methods/torrentsaddreq.hpp"
+
+namespace porla
+{
+    class ISession;
+    class WorkerPool;
+
+    namespace Methods
+    {
+        class TorrentsAdd;
+    }
+
+    struct WatchDirectoriesOptions
+    {
+        std::map<std::string, Config::WatchDirectory> directories;
+        // How often the directories are scanned when inotify is not available.
+        std::chrono::milliseconds interval = std::chrono::milliseconds(5000);
+        // Where torrent files are parsed. Null parses them on the io thread.
+        WorkerPool*               pool     = nullptr;
+    };
+
+    // Adds the .torrent files dropped in a set of directories, with the preset of the
+    // directory they are in. New files are noticed with inotify where it is available and
+    // by scanning the directories on an interval otherwise. Files found together are parsed
+    // on the worker pool and added as one batch. Added files are moved or deleted, while
+    // files that fail are left in place and retried once they change.
+    class WatchDirectories
+    {
+    public:
+        explicit WatchDirectories(
+            boost::asio::io_context& io,
+            ISession& session,
+            const Methods::TorrentsAdd& add,
+            WatchDirectoriesOptions options);
+
+        WatchDirectories(const WatchDirectories&) = delete;
+
+        ~WatchDirectories();
+
+    private:
+        struct File
+        {
+            std::string                     directory;
+            std::filesystem::path           path;
+            std::filesystem::file_time_type modified;
+        };
+
+        struct Parsed
+        {
+            File                                  file;
+            std::optional<Methods::TorrentsAddReq> req;
+        };
+
+        void Add(std::vector<Parsed> parsed);
+        void Consume(const File& file, bool added);
+        Parsed Parse(const File& file) const;
+        void Read();
+        void Scan();
+        void Schedule(std::chrono::milliseconds delay);
+
+        boost::asio::io_context& m_io;
+        ISession& m_session;
+        const Methods::TorrentsAdd& m_add;
+        WatchDirectoriesOptions m_options;
+
+        boost::asio::steady_timer m_timer;
+        bool m_scheduled;
+
+#ifdef __linux__
+        std::unique_ptr<boost::asio::posix::stream_descriptor> m_inotify;
+        std::array<char, 4096> m_events;
+#endif
+
+        // Files being parsed or added, so a scan does not pick them up twice.
+        std::set<std::filesystem::path> m_inflight;
+        // Files which failed, with the time they were modified when they did.
+        std::map<std::filesystem::path, std::filesystem::file_time_type> m_failed;
+    };
+}
@@ -0,0 +1,201 @@
+#include "workerpool.hpp"
+
+#include <boost/log/trivial.hpp>
+
+using porla::HttpContext;
+using porla::WorkerPool;
+using porla::WorkerPoolOptions;
+
+class PostedContext : public HttpContext
+{
+public:
+    PostedContext(boost::asio::io_context& io, std::shared_ptr<HttpContext> ctx)
+        : m_io(io)
+        , m_ctx(std::move(ctx))
+    {
+    }
+
+    void Next() override { Post([](auto& ctx) { ctx->Next(); }); }
+
+    // Only the written response needs the io thread, the request is read-only by now.
+    boost::beast::http::request<boost::beast::http::string_body>& Request() override { return m_ctx->Request(); }
+    Uri& RequestUri() override { return m_ctx->RequestUri(); }
+    boost::beast::tcp_stream& Stream() override { return m_ctx->Stream(); }
+    std::shared_ptr<porla::TraceSpan> Trace() override { return m_ctx->Trace(); }
+    bool Local() override { return m_ctx->Local(); }
+
+    void Write(std::string body) override
+    {
+        Post([body = std::move(body)](auto& ctx) mutable { ctx->Write(std::move(body)); });
+    }
+
+    void Write(boost::beast::http::response<boost::beast::http::file_body> res) override
+    {
+        Post([res = std::move(res)](auto& ctx) mutable { ctx->Write(std::move(res)); });
+    }
+
+    void Write(boost::beast::http::response<boost::beast::http::string_body> res) override
+    {
+        Post([res = std::move(res)](auto& ctx) mutable { ctx->Write(std::move(res)); });
+    }
+
+    void WriteJson(const nlohmann::json& j) override
+    {
+        Post([j](auto& ctx) { ctx->WriteJson(j); });
+    }
+
+    void WriteFile(
+        boost::beast::http::response<boost::beast::http::empty_body> res,
+        boost::beast::file file,
+        std::uint64_t offset,
+        std::uint64_t length,
+        FileAvailability available) override
+    {
+        Post(
+            [res = std::move(res), file = std::move(file), offset, length, available = std::move(available)](auto& ctx) mutable
+            {
+                ctx->WriteFile(std::move(res), std::move(file), offset, length, std::move(available));
+            });
+    }
+
+    void WriteChunked(const std::string& content_type, std::function<bool(std::string& chunk)> next) override
+    {
+        Post([content_type, next = std::move(next)](auto& ctx) mutable { ctx->WriteChunked(content_type, std::move(next)); });
+    }
+
+private:
+    template<typename TFn>
+    void Post(TFn&& fn)
+    {
+        boost::asio::post(m_io, [ctx = m_ctx, fn = std::forward<TFn>(fn)]() mutable { fn(ctx); });
+    }
+
+    boost::asio::io_context& m_io;
+    std::shared_ptr<HttpContext> m_ctx;
+};
+
+WorkerPool::WorkerPool(boost::asio::io_context& io, const WorkerPoolOptions& options)
+    : m_io(io)
+    , m_options(options)
+    , m_stopping(false)
+    , m_completed(0)
+    , m_queued(0)
+    , m_rejected(0)
+    , m_wait_us_max(0)
+    , m_wait_us_total(0)
+{
+    for (int i = 0; i < options.threads; i++)
+    {
+        m_threads.emplace_back(
+            [this]
+            {
+                if (m_options.on_start) { m_options.on_start(); }
+                Run();
+            });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::unique_lock lock(m_mtx);
+        m_stopping = true;
+    }
+
+    m_cv.notify_all();
+
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+
+    m_threads.clear();
+}
+
+bool WorkerPool::Post(std::function<void()> work)
+{
+    {
+        std::unique_lock lock(m_mtx);
+
+        if (m_stopping || static_cast<int>(m_queue.size()) >= m_options.queue_size)
+        {
+            m_rejected++;
+            return false;
+        }
+
+        m_queue.push_back(Item{
+            .work      = std::move(work),
+            .queued_at = std::chrono::steady_clock::now()
+        });
+
+        m_queued = m_queue.size();
+    }
+
+    m_cv.notify_one();
+
+    return true;
+}
+
+std::shared_ptr<HttpContext> WorkerPool::Context(std::shared_ptr<HttpContext> ctx)
+{
+    return std::make_shared<PostedContext>(m_io, std::move(ctx));
+}
+
+WorkerPool::Stats WorkerPool::GetStats() const
+{
+    return Stats{
+        .completed     = m_completed,
+        .queued        = m_queued,
+        .rejected      = m_rejected,
+        .wait_us_max   = m_wait_us_max,
+        .wait_us_total = m_wait_us_total
+    };
+}
+
+void WorkerPool::Run()
+{
+    while (true)
+    {
+        Item item;
+
+        {
+            std::unique_lock lock(m_mtx);
+            m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+
+            // Queued work is dropped when stopping, since the io thread it would post its
+            // results to is no longer running.
+            if (m_stopping)
+            {
+                break;
+            }
+
+            item = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_queued = m_queue.size();
+        }
+
+        const uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - item.queued_at).count();
+
+        m_wait_us_total += wait_us;
+
+        uint64_t max = m_wait_us_max;
+        while (wait_us > max && !m_wait_us_max.compare_exchange_weak(max, wait_us)) {}
+
+        try
+        {
+            item.work();
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Unhandled error in worker: " << ex.what();
+        }
+
+        m_completed++;
+    }
+}
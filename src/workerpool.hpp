@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include "httpcontext.hpp"
+
+namespace porla
+{
+    struct WorkerPoolOptions
+    {
+        int threads;
+        int queue_size;
+        // Called on each worker thread before it takes any work, to place it.
+        std::function<void()> on_start;
+    };
+
+    // A bounded queue of CPU-bound work for a few threads, so heavy methods do not hold up
+    // the io thread. The io context is only ever written to from the io thread, so work
+    // posts its results back with Complete, or writes through a context from Context.
+    class WorkerPool
+    {
+    public:
+        struct Stats
+        {
+            uint64_t completed;
+            uint64_t queued;
+            uint64_t rejected;
+            uint64_t wait_us_max;
+            uint64_t wait_us_total;
+        };
+
+        explicit WorkerPool(boost::asio::io_context& io, const WorkerPoolOptions& options);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // Joins the workers, dropping any queued work. Called before the methods that post
+        // to the pool are destroyed.
+        void Stop();
+
+        // Runs the work on a worker thread. Returns false without running it if the queue
+        // is full.
+        bool Post(std::function<void()> work);
+
+        template<typename TFn>
+        void Complete(TFn&& fn)
+        {
+            boost::asio::post(m_io, std::forward<TFn>(fn));
+        }
+
+        // Wraps the context so everything written to it is posted to the io thread first.
+        std::shared_ptr<HttpContext> Context(std::shared_ptr<HttpContext> ctx);
+
+        [[nodiscard]] Stats GetStats() const;
+
+    private:
+        struct Item
+        {
+            std::function<void()>                 work;
+            std::chrono::steady_clock::time_point queued_at;
+        };
+
+        void Run();
+
+        boost::asio::io_context& m_io;
+        WorkerPoolOptions m_options;
+
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::deque<Item> m_queue;
+        bool m_stopping;
+
+        std::atomic<uint64_t> m_completed;
+        std::atomic<uint64_t> m_queued;
+        std::atomic<uint64_t> m_rejected;
+        std::atomic<uint64_t> m_wait_us_max;
+        std::atomic<uint64_t> m_wait_us_total;
+
+        std::vector<std::thread> m_threads;
+    };
+}
@@ -1,12 +1,10 @@
 #include "http.hpp"
 
-#include "../../httpclient.hpp"
-
 using porla::HttpClient;
 using porla::Workflows::Actions::Http;
 
-Http::Http(boost::asio::io_context &io)
-    : m_io(io)
+Http::Http(HttpClient& client)
+    : m_client(client)
 {
 }
 
@@ -21,10 +19,9 @@ void Http::Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> ca
         .body   = params.Render(body).dump()
     };
 
-    auto http_client = std::make_shared<HttpClient>(m_io);
-    http_client->SendAsync(
+    m_client.SendAsync(
         request,
-        [http_client, callback]()
+        [callback]()
         {
             callback->Complete({});
         });
@@ -1,18 +1,17 @@
 #pragma once
 
-#include <boost/asio.hpp>
-
 #include "../action.hpp"
+#include "../../httpclient.hpp"
 
 namespace porla::Workflows::Actions
 {
     class Http : public Action
     {
     public:
-        explicit Http(boost::asio::io_context& io);
+        explicit Http(HttpClient& client);
         void Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> callback) override;
 
     private:
-        boost::asio::io_context& m_io;
+        HttpClient& m_client;
     };
 }
\ No newline at end of file
@@ -2,13 +2,11 @@
 
 #include <boost/log/trivial.hpp>
 
-#include "../../../httpclient.hpp"
-
 using porla::HttpClient;
 using porla::Workflows::Actions::Push::Discord;
 
-Discord::Discord(boost::asio::io_context &io)
-    : m_io(io)
+Discord::Discord(HttpClient& client)
+    : m_client(client)
 {
 }
 
@@ -37,8 +35,7 @@ void Discord::Invoke(const ActionParams &params, std::shared_ptr<ActionCallback>
         }).dump()
     };
 
-    auto http_client = std::make_shared<HttpClient>(m_io);
-    http_client->SendAsync(
+    m_client.SendAsync(
         request,
         [callback]()
         {
@@ -2,14 +2,12 @@
 
 #include <boost/log/trivial.hpp>
 
-#include "../../../httpclient.hpp"
-
 using porla::HttpClient;
 using porla::Workflows::ActionCallback;
 using porla::Workflows::Actions::Push::Ntfy;
 
-Ntfy::Ntfy(boost::asio::io_context& io)
-    : m_io(io)
+Ntfy::Ntfy(HttpClient& client)
+    : m_client(client)
 {
 }
 
@@ -36,8 +34,7 @@ void Ntfy::Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> ca
         .body   = params.Render(message)
     };
 
-    auto http_client = std::make_shared<HttpClient>(m_io);
-    http_client->SendAsync(
+    m_client.SendAsync(
         request,
         [callback]()
         {
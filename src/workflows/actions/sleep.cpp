@@ -2,11 +2,13 @@
 
 #include <boost/log/trivial.hpp>
 
+#include "../timerwheel.hpp"
+
 using porla::Workflows::ActionCallback;
 using porla::Workflows::Actions::Sleep;
 
-Sleep::Sleep(boost::asio::io_context& io)
-    : m_io(io)
+Sleep::Sleep(porla::Workflows::TimerWheel& timers)
+    : m_timers(timers)
 {
 }
 
@@ -16,10 +18,9 @@ void Sleep::Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> c
 
     const auto timeout = params.Input().at("timeout").get<int>();
 
-    auto timer = std::make_shared<boost::asio::deadline_timer>(m_io);
-    timer->expires_from_now(boost::posix_time::milliseconds(timeout));
-    timer->async_wait(
-        [timer, callback](const boost::system::error_code& ec)
+    m_timers.Schedule(
+        std::chrono::milliseconds(timeout),
+        [callback]()
         {
             BOOST_LOG_TRIVIAL(debug) << "(actions/sleep): Completing";
             callback->Complete({});
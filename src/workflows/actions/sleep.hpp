@@ -2,16 +2,21 @@
 
 #include "../action.hpp"
 
+namespace porla::Workflows
+{
+    class TimerWheel;
+}
+
 namespace porla::Workflows::Actions
 {
     class Sleep : public porla::Workflows::Action
     {
     public:
-        explicit Sleep(boost::asio::io_context& io);
+        explicit Sleep(TimerWheel& timers);
 
         void Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> callback) override;
 
     private:
-        boost::asio::io_context& m_io;
+        TimerWheel& m_timers;
     };
 }
@@ -3,10 +3,10 @@
 #include <map>
 #include <memory>
 
-#include <boost/signals2.hpp>
 #include <libtorrent/info_hash.hpp>
 #include <libtorrent/torrent_handle.hpp>
 
+#include "../../../utils/signal.hpp"
 #include "../../action.hpp"
 
 namespace porla
@@ -3,10 +3,10 @@
 #include <map>
 #include <memory>
 
-#include <boost/signals2.hpp>
 #include <libtorrent/info_hash.hpp>
 #include <libtorrent/torrent_handle.hpp>
 
+#include "../../../utils/signal.hpp"
 #include "../../action.hpp"
 
 namespace porla
@@ -29,7 +29,7 @@ namespace porla::Workflows::Actions::Torrents
 
         struct TorrentPauseState;
 
-        boost::signals2::connection m_torrent_paused_connection;
+        porla::Utils::Connection m_torrent_paused_connection;
 
         ISession& m_session;
         std::map<libtorrent::info_hash_t, std::unique_ptr<TorrentPauseState>> m_states;
@@ -1,10 +1,14 @@
 #include "reannounce.hpp"
 
+#include <optional>
+
 #include <boost/log/trivial.hpp>
 #include <libtorrent/alert_types.hpp>
 
+#include "../../../announcescheduler.hpp"
 #include "../../../json/lttorrentstatus.hpp"
 #include "../../../session.hpp"
+#include "../../timerwheel.hpp"
 
 using porla::Workflows::Actions::Torrents::Reannounce;
 
@@ -14,10 +18,15 @@ struct Reannounce::TorrentReannounceState
     int                             current_tries{0};
     int                             max_tries{24};
     int                             timeout{5};
+    int                             priority{0};
+    // The retry waiting on the timer wheel, if any.
+    std::optional<porla::Workflows::TimerWheel::Id> retry;
 };
 
-Reannounce::Reannounce(porla::ISession& session)
+Reannounce::Reannounce(porla::ISession& session, porla::Workflows::TimerWheel& timers, porla::AnnounceScheduler* announces)
     : m_session(session)
+    , m_timers(timers)
+    , m_announces(announces)
 {
     m_torrent_tracker_error_connection = m_session.OnTorrentTrackerError([this](auto && th) { OnTorrentTrackerError(th); });
     m_torrent_tracker_reply_connection = m_session.OnTorrentTrackerReply([this](auto && th) { OnTorrentTrackerReply(th); });
@@ -27,6 +36,11 @@ Reannounce::~Reannounce()
 {
     m_torrent_tracker_error_connection.disconnect();
     m_torrent_tracker_reply_connection.disconnect();
+
+    for (const auto& [_, state] : m_states)
+    {
+        if (state->retry.has_value()) { m_timers.Cancel(*state->retry); }
+    }
 }
 
 void Reannounce::Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> callback)
@@ -49,9 +63,6 @@ void Reannounce::Invoke(const ActionParams& params, std::shared_ptr<ActionCallba
 
     BOOST_LOG_TRIVIAL(info) << "Reannouncing torrent " << th->second.status().name;
 
-    // Force an immediate reannounce and ignore the min interval.
-    th->second.force_reannounce(0, -1, lt::torrent_handle::ignore_min_interval);
-
     auto state = std::make_unique<TorrentReannounceState>();
     state->callback      = callback;
     state->current_tries = 0;
@@ -68,15 +79,24 @@ void Reannounce::Invoke(const ActionParams& params, std::shared_ptr<ActionCallba
         state->timeout = params.Input()["timeout"].get<int>();
     }
 
+    if (params.Input().contains("priority"))
+    {
+        state->priority = params.Input()["priority"].get<int>();
+    }
+
+    const int priority = state->priority;
+
     m_states.insert({ ts.info_hashes, std::move(state) });
+
+    Send(ts.info_hashes, priority);
 }
 
-void Reannounce::OnTorrentTrackerError(const libtorrent::tracker_error_alert* al)
+void Reannounce::OnTorrentTrackerError(const ISession::TrackerError& al)
 {
-    auto ctx = m_states.find(al->handle.info_hashes());
+    auto ctx = m_states.find(al.handle.info_hashes());
     if (ctx == m_states.end()) return;
 
-    if (al->error && al->error.value() == lt::errors::tracker_failure)
+    if (al.error && al.error.value() == lt::errors::tracker_failure)
     {
         const std::vector<std::string> match_failures =
         {
@@ -86,7 +106,7 @@ void Reannounce::OnTorrentTrackerError(const libtorrent::tracker_error_alert* al
             "unregistered"
         };
 
-        const std::string err = al->error_message();
+        const std::string err = al.message;
 
         for (const auto& failure_message : match_failures)
         {
@@ -96,16 +116,31 @@ void Reannounce::OnTorrentTrackerError(const libtorrent::tracker_error_alert* al
 
                 if (ctx->second->current_tries >= ctx->second->max_tries)
                 {
-                    BOOST_LOG_TRIVIAL(warning) << "Max reannounce attempts reached for " << al->torrent_name();
+                    BOOST_LOG_TRIVIAL(warning) << "Max reannounce attempts reached for " << al.name;
+                    if (ctx->second->retry.has_value()) { m_timers.Cancel(*ctx->second->retry); }
                     m_states.erase(ctx);
                     return;
                 }
 
                 BOOST_LOG_TRIVIAL(info)
-                    << "Reannouncing torrent " << al->torrent_name()
+                    << "Reannouncing torrent " << al.name
                     << " - attempt " << ctx->second->current_tries << " of " << ctx->second->max_tries;
 
-                al->handle.force_reannounce(ctx->second->timeout, -1, lt::torrent_handle::ignore_min_interval);
+                // Only one retry waits at a time, later errors within the timeout are covered.
+                if (!ctx->second->retry.has_value())
+                {
+                    ctx->second->retry = m_timers.Schedule(
+                        std::chrono::seconds(ctx->second->timeout),
+                        [this, hash = al.handle.info_hashes()]()
+                        {
+                            const auto state = m_states.find(hash);
+                            if (state == m_states.end()) return;
+
+                            state->second->retry.reset();
+
+                            Send(hash, state->second->priority);
+                        });
+                }
 
                 return;
             }
@@ -113,6 +148,19 @@ void Reannounce::OnTorrentTrackerError(const libtorrent::tracker_error_alert* al
     }
 }
 
+void Reannounce::Send(const lt::info_hash_t& hash, int priority)
+{
+    // Ignores the min interval, since the torrent is usually one the tracker does not
+    // know about yet.
+    if (m_announces != nullptr)
+    {
+        m_announces->Reannounce(hash, priority, true);
+        return;
+    }
+
+    m_session.Reannounce(hash, true);
+}
+
 void Reannounce::OnTorrentTrackerReply(const libtorrent::torrent_handle& th)
 {
     auto ctx = m_states.find(th.info_hashes());
@@ -120,8 +168,12 @@ void Reannounce::OnTorrentTrackerReply(const libtorrent::torrent_handle& th)
 
     BOOST_LOG_TRIVIAL(info) << "Reannouncing done";
 
-    ctx->second->callback->Complete(true);
+    if (ctx->second->retry.has_value()) { m_timers.Cancel(*ctx->second->retry); }
 
+    // Erased first, since completing may start the next step.
+    const auto callback = std::move(ctx->second->callback);
     m_states.erase(ctx);
+
+    callback->Complete(true);
 }
 
@@ -3,37 +3,48 @@
 #include <map>
 #include <memory>
 
-#include <boost/signals2.hpp>
 #include <libtorrent/info_hash.hpp>
 #include <libtorrent/torrent_handle.hpp>
 
+#include "../../../utils/signal.hpp"
 #include "../../action.hpp"
+#include "../../../session.hpp"
 
 namespace porla
 {
-    class ISession;
+    class AnnounceScheduler;
+}
+
+namespace porla::Workflows
+{
+    class TimerWheel;
 }
 
 namespace porla::Workflows::Actions::Torrents
 {
+    // Reannounces go through the announce scheduler when there is one, paced with the
+    // others to the same tracker, and with the priority given in the input.
     class Reannounce : public porla::Workflows::Action
     {
     public:
-        explicit Reannounce(ISession& session);
+        explicit Reannounce(ISession& session, TimerWheel& timers, AnnounceScheduler* announces = nullptr);
         ~Reannounce();
 
         void Invoke(const ActionParams& params, std::shared_ptr<ActionCallback> callback) override;
 
     private:
-        void OnTorrentTrackerError(const libtorrent::tracker_error_alert* al);
+        void OnTorrentTrackerError(const ISession::TrackerError& al);
         void OnTorrentTrackerReply(const libtorrent::torrent_handle& th);
+        void Send(const libtorrent::info_hash_t& hash, int priority);
 
         struct TorrentReannounceState;
 
-        boost::signals2::connection m_torrent_tracker_error_connection;
-        boost::signals2::connection m_torrent_tracker_reply_connection;
+        porla::Utils::Connection m_torrent_tracker_error_connection;
+        porla::Utils::Connection m_torrent_tracker_reply_connection;
 
         ISession& m_session;
+        TimerWheel& m_timers;
+        AnnounceScheduler* m_announces;
         std::map<libtorrent::info_hash_t, std::unique_ptr<TorrentReannounceState>> m_states;
     };
 }
@@ -11,5 +11,10 @@ namespace porla::Workflows
     {
     public:
         virtual nlohmann::json Value() = 0;
+
+        // Providers that list their fields have each one built the first time an
+        // expression reads it, instead of the whole value up front.
+        virtual std::vector<std::string> Fields() { return {}; }
+        virtual nlohmann::json Field(const std::string& name) { return Value()[name]; }
     };
 }
@@ -1,36 +1,270 @@
 #include "executor.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <optional>
+
+#include <boost/asio.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/signals2.hpp>
 #include <libtorrent/torrent_status.hpp>
 
+#include "../json/ltinfohash.hpp"
+#include "../utils/signal.hpp"
+#include "stepbudget.hpp"
 #include "torrentcontextprovider.hpp"
 #include "workflow.hpp"
 #include "../session.hpp"
 
 namespace lt = libtorrent;
+using porla::Data::Models::WorkflowRuns;
 using porla::Workflows::Executor;
+using porla::Workflows::TorrentContextProvider;
+using porla::Workflows::TorrentsContextProvider;
+
+// The torrents of the contexts by info hash, or nullopt for contexts which cannot be
+// saved, such as ones of other events.
+static std::optional<std::string> SaveContexts(const std::map<std::string, std::shared_ptr<porla::Workflows::ContextProvider>>& contexts)
+{
+    nlohmann::json j = nlohmann::json::object();
+
+    for (const auto& [name, provider] : contexts)
+    {
+        if (const auto torrent = std::dynamic_pointer_cast<TorrentContextProvider>(provider))
+        {
+            j[name] = torrent->Status().info_hashes;
+        }
+        else if (const auto torrents = std::dynamic_pointer_cast<TorrentsContextProvider>(provider))
+        {
+            j[name] = nlohmann::json::array();
+            for (const auto& ts : torrents->Torrents()) j[name].push_back(ts->info_hashes);
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+
+    return j.dump();
+}
+
+// Rebuilds the contexts from the current status of their torrents, or nullopt if one of
+// them is not in the session.
+static std::optional<std::map<std::string, std::shared_ptr<porla::Workflows::ContextProvider>>> LoadContexts(
+    const nlohmann::json& j,
+    const std::map<lt::info_hash_t, lt::torrent_status>& statuses)
+{
+    std::map<std::string, std::shared_ptr<porla::Workflows::ContextProvider>> contexts;
+
+    const auto find = [&statuses](const nlohmann::json& hash) -> const lt::torrent_status*
+    {
+        const auto status = statuses.find(hash.get<lt::info_hash_t>());
+        return status != statuses.end() ? &status->second : nullptr;
+    };
+
+    for (const auto& [name, value] : j.items())
+    {
+        if (name == "torrents")
+        {
+            std::vector<std::shared_ptr<const lt::torrent_status>> torrents;
+
+            for (const auto& hash : value)
+            {
+                const auto ts = find(hash);
+                if (ts == nullptr) { return std::nullopt; }
+
+                torrents.push_back(std::make_shared<const lt::torrent_status>(*ts));
+            }
+
+            contexts.insert({ name, std::make_shared<TorrentsContextProvider>(std::move(torrents)) });
+            continue;
+        }
+
+        const auto ts = find(value);
+        if (ts == nullptr) { return std::nullopt; }
+
+        contexts.insert({ name, std::make_shared<TorrentContextProvider>(*ts) });
+    }
+
+    return contexts;
+}
 
 struct Executor::State
 {
-    boost::signals2::connection torrent_added_connection;
-    boost::signals2::connection torrent_finished_connection;
+    struct Pending
+    {
+        std::map<std::string, std::shared_ptr<ContextProvider>> contexts;
+        std::uint64_t seq;
+        std::chrono::steady_clock::time_point enqueued;
+        // The saved run, for executors with a database and contexts which can be saved.
+        std::optional<WorkflowRuns::Run> saved;
+    };
+
+    explicit State(Executor& e)
+        : executor(e)
+    {
+    }
+
+    Executor& executor;
+
+    porla::Utils::Connection torrent_added_connection;
+    porla::Utils::Connection torrent_finished_connection;
+
+    // Queued runs and runs in progress, by workflow.
+    std::vector<std::deque<Pending>> pending;
+    std::vector<int> running;
+
+    // Torrents collected for workflows that batch, and the timers ending their windows.
+    std::vector<std::vector<std::shared_ptr<const lt::torrent_status>>> batches;
+    std::vector<std::unique_ptr<boost::asio::steady_timer>> timers;
+    std::uint64_t seq = 0;
+    bool draining = false;
+
+    // Set once swapped out, keeping the workflows alive for the runs still in progress.
+    std::vector<std::shared_ptr<Workflow>> workflows;
 };
 
 Executor::Executor(const ExecutorOptions& options)
-    : m_session(options.session)
-    , m_state(std::make_unique<State>())
+    : m_io(options.io)
+    , m_session(options.session)
+    , m_state(std::make_shared<State>(*this))
     , m_workflows(options.workflows)
     , m_action_factory(options.action_factory)
+    , m_budget(std::make_shared<StepBudget>(options.max_parallel_steps))
+    , m_max_running(std::max(1, options.max_running))
+    , m_max_queued(options.max_queued)
+    , m_db(options.db)
+    , m_checkpoint_interval(options.checkpoint_interval)
+    , m_checkpoint_timer(options.io)
 {
+    Index();
+
     m_state->torrent_added_connection = m_session.OnTorrentAdded([this](const auto& ts) { OnTorrentAdded(ts); });
-    m_state->torrent_finished_connection = m_session.OnTorrentFinished([this](const auto& ts) { OnTorrentFinished(ts); });
+
+    if (options.batch_events && m_session.BatchesLifecycle())
+    {
+        m_state->torrent_finished_connection = m_session.OnTorrentLifecycle(
+            [this](const porla::TorrentLifecycle& lifecycle)
+            {
+                if (!lifecycle.finished.empty()) OnTorrentsFinished(lifecycle.finished);
+            });
+    }
+    else
+    {
+        m_state->torrent_finished_connection = m_session.OnTorrentFinished([this](const auto& ts) { OnTorrentFinished(ts); });
+    }
+
+    if (m_db == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        WorkflowRuns::ForEach(
+            m_db,
+            [this](WorkflowRuns::Run&& run)
+            {
+                m_next_run_id = std::max(m_next_run_id, run.id + 1);
+                m_restore.push_back(std::move(run));
+            });
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to read saved workflow runs: " << ex.what();
+    }
+
+    m_torrents_loaded_connection = m_session.OnTorrentsLoaded([this](const auto&) { Restore(true); });
+
+    Restore(m_session.Loading().done);
 }
 
 Executor::~Executor()
 {
     m_state->torrent_added_connection.disconnect();
     m_state->torrent_finished_connection.disconnect();
+    m_torrents_loaded_connection.disconnect();
+
+    // Batches still collecting are dropped.
+    for (const auto& timer : m_state->timers)
+    {
+        if (timer) { timer->cancel(); }
+    }
+
+    // Runs still queued or in progress are left in the database, to resume on startup.
+    m_checkpoint_timer.cancel();
+    FlushCheckpoints();
+}
+
+void Executor::SetWorkflows(std::vector<std::shared_ptr<Workflow>> workflows)
+{
+    auto retired = m_state;
+
+    m_state = std::make_shared<State>(*this);
+    m_state->torrent_added_connection    = retired->torrent_added_connection;
+    m_state->torrent_finished_connection = retired->torrent_finished_connection;
+
+    for (const auto& timer : retired->timers)
+    {
+        if (timer) { timer->cancel(); }
+    }
+
+    std::uint64_t dropped = 0;
+
+    for (auto& pending : retired->pending)
+    {
+        for (const auto& run : pending)
+        {
+            if (run.saved) { Checkpoint(run.saved->id, std::nullopt); }
+        }
+
+        dropped += pending.size();
+        pending.clear();
+    }
+
+    m_queue.queued -= dropped;
+
+    retired->workflows = std::move(m_workflows);
+    m_workflows = std::move(workflows);
+
+    Index();
+
+    if (std::any_of(retired->running.begin(), retired->running.end(), [](int running) { return running > 0; }))
+    {
+        m_retired.push_back(std::move(retired));
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Loaded " << m_workflows.size() << " workflow(s), dropped " << dropped << " queued run(s)";
+}
+
+void Executor::Index()
+{
+    m_index.clear();
+    m_stats.clear();
+
+    for (std::size_t i = 0; i < m_workflows.size(); i++)
+    {
+        for (const auto& event_name : m_workflows[i]->On())
+        {
+            m_index[event_name].push_back(i);
+        }
+
+        m_stats.push_back(WorkflowStats{
+            .name = m_workflows[i]->Name().empty() ? "workflow_" + std::to_string(i) : m_workflows[i]->Name()
+        });
+    }
+
+    m_state->pending.resize(m_workflows.size());
+    m_state->running.resize(m_workflows.size(), 0);
+    m_state->batches.resize(m_workflows.size());
+
+    for (const auto& workflow : m_workflows)
+    {
+        m_state->timers.push_back(workflow->Batch().has_value()
+            ? std::make_unique<boost::asio::steady_timer>(m_io)
+            : nullptr);
+    }
 }
 
 void Executor::OnTorrentAdded(const lt::torrent_status& ts)
@@ -47,21 +281,385 @@ void Executor::OnTorrentFinished(const lt::torrent_status& ts)
     });
 }
 
+void Executor::OnTorrentsFinished(const std::vector<lt::torrent_status>& torrents)
+{
+    const auto candidates = m_index.find("torrent_finished");
+
+    if (candidates == m_index.end())
+    {
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Running workflows for torrent_finished, " << torrents.size() << " torrent(s)";
+
+    for (const auto& ts : torrents)
+    {
+        Evaluate(candidates->second, {
+            {"torrent", std::make_shared<porla::Workflows::TorrentContextProvider>(ts)}
+        });
+    }
+
+    Drain();
+}
+
 void Executor::TriggerWorkflows(
     const std::string& event_name,
     const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts)
 {
+    const auto candidates = m_index.find(event_name);
+
+    if (candidates == m_index.end())
+    {
+        return;
+    }
+
     BOOST_LOG_TRIVIAL(info) << "Running workflows for " << event_name;
 
-    for (const auto& workflow : m_workflows)
+    Evaluate(candidates->second, contexts);
+    Drain();
+}
+
+void Executor::Evaluate(
+    const std::vector<std::size_t>& candidates,
+    const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts)
+{
+    for (const auto index : candidates)
+    {
+        const auto& workflow = m_workflows[index];
+        auto& stats = m_stats[index];
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool matches = workflow->Matches(contexts);
+
+        stats.evaluations++;
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!matches)
+        {
+            continue;
+        }
+
+        stats.matches++;
+
+        if (const auto& batch = workflow->Batch())
+        {
+            const auto torrent = contexts.find("torrent");
+            const auto provider = torrent != contexts.end()
+                ? std::dynamic_pointer_cast<TorrentContextProvider>(torrent->second)
+                : nullptr;
+
+            if (provider == nullptr)
+            {
+                BOOST_LOG_TRIVIAL(warning) << "Workflow " << stats.name << " batches, but the event has no torrent";
+                continue;
+            }
+
+            auto& collected = m_state->batches[index];
+            collected.push_back(provider->Shared());
+
+            if (collected.size() >= batch->max_size)
+            {
+                m_state->timers[index]->cancel();
+                FlushBatch(index);
+            }
+            else if (collected.size() == 1)
+            {
+                m_state->timers[index]->expires_after(batch->window);
+                m_state->timers[index]->async_wait(
+                    [state = std::weak_ptr<State>(m_state), index](const boost::system::error_code& ec)
+                    {
+                        const auto s = state.lock();
+                        // Swapped out workflows have had their batches dropped.
+                        if (ec || !s || s != s->executor.m_state) { return; }
+
+                        s->executor.FlushBatch(index);
+                        s->executor.Drain();
+                    });
+            }
+
+            continue;
+        }
+
+        Enqueue(index, contexts);
+    }
+}
+
+void Executor::Enqueue(
+    std::size_t index,
+    const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts,
+    std::optional<WorkflowRuns::Run> restored)
+{
+    auto& stats = m_stats[index];
+
+    // Restored runs were let into the queue before.
+    if (!restored && m_queue.queued >= m_max_queued)
+    {
+        BOOST_LOG_TRIVIAL(warning) << "Workflow queue is full, not running " << stats.name;
+        stats.rejected++;
+        m_queue.rejected++;
+        return;
+    }
+
+    if (!restored && m_db != nullptr)
+    {
+        if (const auto saved = SaveContexts(contexts))
+        {
+            restored = WorkflowRuns::Run{
+                .id        = m_next_run_id++,
+                .workflow  = stats.name,
+                .contexts  = *saved,
+                .stage     = 0,
+                .outputs   = "[]",
+                .queued_at = std::time(nullptr)
+            };
+
+            Checkpoint(restored->id, restored);
+        }
+    }
+
+    m_state->pending[index].push_back(State::Pending{
+        .contexts = contexts,
+        .seq      = m_state->seq++,
+        .enqueued = std::chrono::steady_clock::now(),
+        .saved    = std::move(restored)
+    });
+
+    stats.queued++;
+    m_queue.queued++;
+}
+
+void Executor::FlushBatch(std::size_t index)
+{
+    auto torrents = std::move(m_state->batches[index]);
+    m_state->batches[index].clear();
+
+    if (torrents.empty())
+    {
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << "Running workflow " << m_stats[index].name << " for a batch of " << torrents.size() << " torrent(s)";
+
+    Enqueue(index, {
+        {"torrents", std::make_shared<TorrentsContextProvider>(std::move(torrents))}
+    });
+}
+
+// Starts queued runs while there are free slots, highest priority first and in the order
+// they were queued within a priority. Runs that finish synchronously free their slot
+// during the loop, so it is guarded against re-entry.
+void Executor::Drain()
+{
+    if (m_state->draining)
+    {
+        return;
+    }
+
+    m_state->draining = true;
+
+    while (m_queue.running < static_cast<std::uint64_t>(m_max_running))
     {
-        if (!workflow->ShouldExecute(event_name, contexts))
+        std::optional<std::size_t> next;
+
+        for (std::size_t i = 0; i < m_workflows.size(); i++)
+        {
+            const auto& pending = m_state->pending[i];
+            const int   limit   = m_workflows[i]->Concurrency();
+
+            if (pending.empty() || (limit > 0 && m_state->running[i] >= limit))
+            {
+                continue;
+            }
+
+            if (!next.has_value()
+                || m_workflows[i]->Priority() > m_workflows[*next]->Priority()
+                || (m_workflows[i]->Priority() == m_workflows[*next]->Priority()
+                    && pending.front().seq < m_state->pending[*next].front().seq))
+            {
+                next = i;
+            }
+        }
+
+        if (!next.has_value())
         {
+            break;
+        }
+
+        const auto index = *next;
+        auto run = std::move(m_state->pending[index].front());
+        m_state->pending[index].pop_front();
+
+        auto& stats = m_stats[index];
+        stats.queued--;
+        stats.running++;
+        stats.runs++;
+
+        m_queue.queued--;
+        m_queue.running++;
+        m_queue.wait_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - run.enqueued).count();
+
+        m_state->running[index]++;
+
+        BOOST_LOG_TRIVIAL(info) << "Invoking workflow " << stats.name;
+
+        porla::Workflows::WorkflowRunOptions options{ .budget = m_budget };
+
+        if (run.saved)
+        {
+            options.stage = static_cast<std::size_t>(std::max(0, run.saved->stage));
+            options.outputs = nlohmann::json::parse(run.saved->outputs, nullptr, false);
+            options.checkpoint = [state = std::weak_ptr<State>(m_state), saved = *run.saved](std::size_t stage, const nlohmann::json& outputs) mutable
+            {
+                const auto s = state.lock();
+                if (!s) { return; }
+
+                saved.stage   = static_cast<int>(stage);
+                saved.outputs = outputs.dump();
+
+                s->executor.Checkpoint(saved.id, saved);
+            };
+        }
+
+        m_workflows[index]->Execute(
+            *m_action_factory,
+            run.contexts,
+            [state = std::weak_ptr<State>(m_state), index, id = run.saved ? run.saved->id : 0]()
+            {
+                const auto s = state.lock();
+                if (!s) { return; }
+
+                auto& executor = s->executor;
+
+                if (id > 0) { executor.Checkpoint(id, std::nullopt); }
+
+                s->running[index]--;
+                executor.m_queue.running--;
+
+                // Runs started before the workflows were swapped count against the old ones.
+                if (s == executor.m_state)
+                {
+                    executor.m_stats[index].running--;
+                }
+                else
+                {
+                    std::erase_if(
+                        executor.m_retired,
+                        [](const auto& retired)
+                        {
+                            return std::all_of(retired->running.begin(), retired->running.end(), [](int running) { return running == 0; });
+                        });
+                }
+
+                executor.Drain();
+            },
+            std::move(options));
+    }
+
+    m_state->draining = false;
+}
+
+void Executor::Checkpoint(std::int64_t id, std::optional<WorkflowRuns::Run> run)
+{
+    const bool schedule = m_checkpoints.empty();
+
+    m_checkpoints.insert_or_assign(id, std::move(run));
+
+    if (!schedule)
+    {
+        return;
+    }
+
+    m_checkpoint_timer.expires_after(m_checkpoint_interval);
+    m_checkpoint_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+            FlushCheckpoints();
+        });
+}
+
+void Executor::FlushCheckpoints()
+{
+    if (m_checkpoints.empty())
+    {
+        return;
+    }
+
+    if (sqlite3_exec(m_db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to begin transaction: " << sqlite3_errmsg(m_db);
+    }
+
+    try
+    {
+        for (const auto& [id, run] : m_checkpoints)
+        {
+            if (run) { WorkflowRuns::Upsert(m_db, *run); }
+            else     { WorkflowRuns::Remove(m_db, id); }
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to save workflow runs: " << ex.what();
+    }
+
+    if (sqlite3_exec(m_db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        BOOST_LOG_TRIVIAL(error) << "Failed to commit transaction: " << sqlite3_errmsg(m_db);
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Saved " << m_checkpoints.size() << " workflow run checkpoint(s)";
+
+    m_checkpoints.clear();
+}
+
+void Executor::Restore(bool last)
+{
+    if (m_restore.empty())
+    {
+        return;
+    }
+
+    std::vector<WorkflowRuns::Run> waiting;
+    std::size_t restored = 0;
+    std::size_t dropped  = 0;
+
+    for (auto& run : m_restore)
+    {
+        const auto stats = std::find_if(m_stats.begin(), m_stats.end(), [&run](const auto& s) { return s.name == run.workflow; });
+        const auto json  = nlohmann::json::parse(run.contexts, nullptr, false);
+
+        if (stats == m_stats.end() || !json.is_object())
+        {
+            Checkpoint(run.id, std::nullopt);
+            dropped++;
             continue;
         }
 
-        BOOST_LOG_TRIVIAL(info) << "Invoking workflow";
+        auto contexts = LoadContexts(json, m_session.TorrentStatuses());
+
+        if (!contexts)
+        {
+            if (last)
+            {
+                Checkpoint(run.id, std::nullopt);
+                dropped++;
+            }
+            else
+            {
+                waiting.push_back(std::move(run));
+            }
+
+            continue;
+        }
 
-        workflow->Execute(*m_action_factory, contexts);
+        Enqueue(static_cast<std::size_t>(stats - m_stats.begin()), *contexts, std::move(run));
+        restored++;
     }
+
+    m_restore = std::move(waiting);
+
+    BOOST_LOG_TRIVIAL(info) << "Restored " << restored << " workflow run(s), dropped " << dropped;
+
+    Drain();
 }
@@ -1,10 +1,20 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <libtorrent/fwd.hpp>
+#include <sqlite3.h>
+
+#include "../data/models/workflowruns.hpp"
+#include "../utils/signal.hpp"
 
 namespace porla
 {
@@ -15,35 +25,113 @@ namespace porla::Workflows
 {
     class ActionFactory;
     class ContextProvider;
+    class StepBudget;
     class Workflow;
 
     struct ExecutorOptions
     {
+        boost::asio::io_context& io;
         porla::ISession& session;
         std::vector<std::shared_ptr<Workflow>> workflows;
         std::shared_ptr<ActionFactory> action_factory;
+        int max_running       = 16;    // runs at a time over all workflows
+        std::size_t max_queued = 10000; // runs waiting for a slot before new ones are dropped
+        int max_parallel_steps = 16;    // steps of parallel groups running beside another of their run
+        // Queued runs and runs in progress are kept here, if set, and resumed on startup.
+        sqlite3* db = nullptr;
+        std::chrono::milliseconds checkpoint_interval = std::chrono::seconds(1);
+        // Takes the finished torrents of a batch of alerts together, for sessions which
+        // batch them, instead of one event at a time.
+        bool batch_events = false;
     };
 
     class Executor
     {
     public:
+        struct WorkflowStats
+        {
+            std::string   name;
+            std::uint64_t evaluations = 0;
+            std::uint64_t matches     = 0;
+            double        seconds     = 0; // spent evaluating conditions
+            std::uint64_t queued      = 0;
+            std::uint64_t rejected    = 0;
+            std::uint64_t running     = 0;
+            std::uint64_t runs        = 0;
+        };
+
+        struct QueueStats
+        {
+            std::uint64_t queued       = 0;
+            std::uint64_t rejected     = 0;
+            std::uint64_t running      = 0;
+            double        wait_seconds = 0; // total time runs waited for a slot
+        };
+
         explicit Executor(const ExecutorOptions& options);
         ~Executor();
 
+        [[nodiscard]] const QueueStats& Queue() const { return m_queue; }
+        [[nodiscard]] const std::vector<WorkflowStats>& Stats() const { return m_stats; }
+
+        // Swaps in another set of workflows, such as on a config reload. Runs in progress
+        // finish with the workflow they started with, while queued runs and batches still
+        // collecting are dropped.
+        void SetWorkflows(std::vector<std::shared_ptr<Workflow>> workflows);
+
     private:
         void OnTorrentAdded(const libtorrent::torrent_status& ts);
         void OnTorrentFinished(const libtorrent::torrent_status& ts);
+        void OnTorrentsFinished(const std::vector<libtorrent::torrent_status>& torrents);
         void OnTorrentMediaInfo(const libtorrent::torrent_handle& ts);
 
         void TriggerWorkflows(
             const std::string& event_name,
             const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts);
+        // Like TriggerWorkflows, for candidates already looked up and without draining.
+        void Evaluate(
+            const std::vector<std::size_t>& candidates,
+            const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts);
+
+        void Enqueue(
+            std::size_t index,
+            const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts,
+            std::optional<Data::Models::WorkflowRuns::Run> restored = std::nullopt);
+        void Drain();
+        void FlushBatch(std::size_t index);
+        void Index();
+
+        // Runs are checkpointed in memory and written together, a removed run as nullopt.
+        void Checkpoint(std::int64_t id, std::optional<Data::Models::WorkflowRuns::Run> run);
+        void FlushCheckpoints();
+        // Queues the saved runs whose torrents are known. The others wait for the torrents
+        // to load, unless it is the last try.
+        void Restore(bool last);
 
         struct State;
 
+        boost::asio::io_context& m_io;
         std::shared_ptr<ActionFactory> m_action_factory;
-        std::unique_ptr<State> m_state;
+        std::shared_ptr<StepBudget> m_budget;
+        std::shared_ptr<State> m_state;
+        // States of swapped out workflows, kept until their runs in progress are done.
+        std::vector<std::shared_ptr<State>> m_retired;
         porla::ISession& m_session;
         std::vector<std::shared_ptr<Workflow>> m_workflows;
+        // Indices into m_workflows and m_stats, by the events they run on.
+        std::map<std::string, std::vector<std::size_t>> m_index;
+        std::vector<WorkflowStats> m_stats;
+
+        int m_max_running;
+        std::size_t m_max_queued;
+        QueueStats m_queue;
+
+        sqlite3* m_db;
+        std::chrono::milliseconds m_checkpoint_interval;
+        boost::asio::steady_timer m_checkpoint_timer;
+        std::map<std::int64_t, std::optional<Data::Models::WorkflowRuns::Run>> m_checkpoints;
+        std::int64_t m_next_run_id = 1;
+        std::vector<Data::Models::WorkflowRuns::Run> m_restore;
+        porla::Utils::Connection m_torrents_loaded_connection;
     };
 }
@@ -0,0 +1,124 @@
+#include "heappool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <duktape.h>
+
+using porla::Workflows::HeapPool;
+
+static std::set<std::string> GlobalKeys(duk_context* ctx)
+{
+    std::set<std::string> keys;
+
+    duk_push_global_object(ctx);
+    duk_enum(ctx, -1, DUK_ENUM_OWN_PROPERTIES_ONLY | DUK_ENUM_INCLUDE_NONENUMERABLE);
+
+    while (duk_next(ctx, -1, 0))
+    {
+        keys.insert(duk_safe_to_string(ctx, -1));
+        duk_pop(ctx);
+    }
+
+    duk_pop_2(ctx);
+
+    return keys;
+}
+
+HeapPool::Lease::Lease(HeapPool& pool, duk_context* ctx)
+    : m_pool(&pool)
+    , m_ctx(ctx)
+{
+}
+
+HeapPool::Lease::Lease(Lease&& other) noexcept
+    : m_pool(other.m_pool)
+    , m_ctx(std::exchange(other.m_ctx, nullptr))
+{
+}
+
+HeapPool::Lease::~Lease()
+{
+    if (m_ctx != nullptr)
+    {
+        m_pool->Release(m_ctx);
+    }
+}
+
+HeapPool::HeapPool(std::size_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+HeapPool::~HeapPool()
+{
+    for (const auto& heap : m_idle)
+    {
+        duk_destroy_heap(heap.ctx);
+    }
+}
+
+HeapPool& HeapPool::Default()
+{
+    static HeapPool pool;
+    return pool;
+}
+
+HeapPool::Lease HeapPool::Acquire()
+{
+    std::unique_lock lock(m_mtx);
+
+    if (m_idle.empty())
+    {
+        lock.unlock();
+
+        duk_context* ctx = duk_create_heap_default();
+        auto globals = GlobalKeys(ctx);
+
+        lock.lock();
+        m_leased.push_back(Heap{ ctx, std::move(globals) });
+
+        return { *this, ctx };
+    }
+
+    m_leased.push_back(std::move(m_idle.back()));
+    m_idle.pop_back();
+
+    return { *this, m_leased.back().ctx };
+}
+
+void HeapPool::Release(duk_context* ctx)
+{
+    std::unique_lock lock(m_mtx);
+
+    const auto it = std::find_if(m_leased.begin(), m_leased.end(), [ctx](const Heap& h) { return h.ctx == ctx; });
+    auto heap = std::move(*it);
+    m_leased.erase(it);
+
+    if (m_idle.size() >= m_capacity)
+    {
+        lock.unlock();
+        duk_destroy_heap(ctx);
+        return;
+    }
+
+    lock.unlock();
+
+    // Drop anything left on the value stack and every global the lease added.
+    duk_set_top(ctx, 0);
+    duk_push_global_object(ctx);
+
+    for (const auto& key : GlobalKeys(ctx))
+    {
+        if (!heap.globals.contains(key))
+        {
+            duk_del_prop_string(ctx, -1, key.c_str());
+        }
+    }
+
+    duk_pop(ctx);
+    duk_gc(ctx, 0);
+
+    lock.lock();
+    m_idle.push_back(std::move(heap));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+struct duk_hthread;
+typedef struct duk_hthread duk_context;
+
+namespace porla::Workflows
+{
+    // Keeps duktape heaps around for reuse, since creating one is far more expensive than
+    // evaluating a template expression. Globals added while a heap is leased are removed
+    // when it is returned, so renders do not see each other's state.
+    class HeapPool
+    {
+    public:
+        class Lease
+        {
+        public:
+            Lease(const Lease&) = delete;
+            Lease(Lease&& other) noexcept;
+            ~Lease();
+
+            [[nodiscard]] duk_context* Get() const { return m_ctx; }
+
+        private:
+            friend class HeapPool;
+
+            Lease(HeapPool& pool, duk_context* ctx);
+
+            HeapPool* m_pool;
+            duk_context* m_ctx;
+        };
+
+        explicit HeapPool(std::size_t capacity = 4);
+        HeapPool(const HeapPool&) = delete;
+        ~HeapPool();
+
+        // Shared by renderers that are not given a pool of their own.
+        static HeapPool& Default();
+
+        Lease Acquire();
+
+    private:
+        struct Heap
+        {
+            duk_context* ctx;
+            std::set<std::string> globals; // keys on the global object when created
+        };
+
+        void Release(duk_context* ctx);
+
+        std::size_t m_capacity;
+        std::mutex m_mtx;
+        std::vector<Heap> m_idle;
+        std::vector<Heap> m_leased;
+    };
+}
@@ -1,12 +1,30 @@
 #pragma once
 
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <nlohmann/json.hpp>
 
+#include "template.hpp"
+
 namespace porla::Workflows
 {
     struct Step
     {
         std::string    uses;
         nlohmann::json with;
+
+        // Every string in with, compiled when the workflow is loaded.
+        std::map<std::string, std::shared_ptr<const Template>> templates;
+    };
+
+    // Steps which run at the same time, by their index in the workflow's steps. The next
+    // stage starts once every step of this one is done.
+    struct StepStage
+    {
+        std::vector<std::size_t> steps;
+        int                      max_parallel = 0; // 0 for all at once
     };
 }
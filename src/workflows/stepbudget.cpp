@@ -0,0 +1,44 @@
+#include "stepbudget.hpp"
+
+#include <algorithm>
+
+using porla::Workflows::StepBudget;
+
+StepBudget::StepBudget(int slots)
+    : m_available(std::max(0, slots))
+{
+}
+
+bool StepBudget::TryAcquire()
+{
+    if (m_available == 0)
+    {
+        return false;
+    }
+
+    m_available--;
+    return true;
+}
+
+void StepBudget::Release()
+{
+    if (m_waiters.empty())
+    {
+        m_available++;
+        return;
+    }
+
+    auto granted = std::move(m_waiters.front());
+    m_waiters.pop_front();
+    granted();
+}
+
+void StepBudget::Wait(std::function<void()> granted)
+{
+    if (TryAcquire())
+    {
+        return granted();
+    }
+
+    m_waiters.push_back(std::move(granted));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+namespace porla::Workflows
+{
+    // Slots for the steps of parallel groups which run beside another step of their run,
+    // shared by every run of the executor. The first step running in a group never takes
+    // a slot, so every run makes progress however many others are waiting. Only used on
+    // the io thread.
+    class StepBudget
+    {
+    public:
+        explicit StepBudget(int slots);
+        StepBudget(const StepBudget&) = delete;
+
+        [[nodiscard]] int Available() const { return m_available; }
+        [[nodiscard]] std::size_t Waiting() const { return m_waiters.size(); }
+
+        bool TryAcquire();
+
+        // Hands the slot to the longest waiting run, if any.
+        void Release();
+
+        // Calls granted with a slot taken for it, now or once one is released.
+        void Wait(std::function<void()> granted);
+
+    private:
+        int m_available;
+        std::deque<std::function<void()>> m_waiters;
+    };
+}
@@ -0,0 +1,85 @@
+#include "template.hpp"
+
+#include <regex>
+
+#include <boost/log/trivial.hpp>
+#include <duktape.h>
+
+#include "heappool.hpp"
+
+using porla::Workflows::HeapPool;
+using porla::Workflows::Template;
+
+std::shared_ptr<const Template> Template::Parse(const std::string& text, bool raw_expression)
+{
+    auto tpl = std::make_shared<Template>();
+
+    if (raw_expression)
+    {
+        tpl->m_fragments.push_back(Fragment{ .expression = true, .text = text });
+        return tpl;
+    }
+
+    static const std::regex re(R"(\$\{\{\s(.+?)\s\}\})");
+
+    auto begin = std::sregex_iterator(text.begin(), text.end(), re);
+    std::size_t offset = 0;
+
+    for (auto it = begin; it != std::sregex_iterator(); ++it)
+    {
+        const auto& match = *it;
+
+        if (match.prefix().length() > 0)
+        {
+            tpl->m_fragments.push_back(Fragment{ .expression = false, .text = match.prefix() });
+        }
+
+        tpl->m_fragments.push_back(Fragment{ .expression = true, .text = match[1] });
+
+        offset = match.position() + match.length();
+    }
+
+    if (offset < text.size())
+    {
+        tpl->m_fragments.push_back(Fragment{ .expression = false, .text = text.substr(offset) });
+    }
+
+    return tpl;
+}
+
+std::shared_ptr<const Template> Template::Compile(const std::string& text, bool raw_expression)
+{
+    auto parsed = Parse(text, raw_expression);
+    auto tpl = std::make_shared<Template>(*parsed);
+
+    const auto lease = HeapPool::Default().Acquire();
+    duk_context* ctx = lease.Get();
+
+    for (auto& fragment : tpl->m_fragments)
+    {
+        if (!fragment.expression)
+        {
+            continue;
+        }
+
+        // Compiled as eval code, so the value of the expression is the result of calling it.
+        if (duk_pcompile_string(ctx, DUK_COMPILE_EVAL, fragment.text.c_str()) != 0)
+        {
+            // Left uncompiled, so the error shows up when rendering like it did before.
+            BOOST_LOG_TRIVIAL(warning) << "Failed to compile expression '" << fragment.text << "': " << duk_safe_to_string(ctx, -1);
+            duk_pop(ctx);
+            continue;
+        }
+
+        duk_dump_function(ctx);
+
+        duk_size_t size = 0;
+        const auto* data = static_cast<const char*>(duk_get_buffer(ctx, -1, &size));
+
+        fragment.bytecode.assign(data, size);
+
+        duk_pop(ctx);
+    }
+
+    return tpl;
+}
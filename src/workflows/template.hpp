@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace porla::Workflows
+{
+    // A template split into literal text and ${{ }} expressions. Compiled templates also
+    // hold each expression as duktape bytecode, so rendering them only evaluates.
+    class Template
+    {
+    public:
+        struct Fragment
+        {
+            bool        expression;
+            std::string text;
+            std::string bytecode; // empty if not compiled
+        };
+
+        static std::shared_ptr<const Template> Parse(const std::string& text, bool raw_expression = false);
+        static std::shared_ptr<const Template> Compile(const std::string& text, bool raw_expression = false);
+
+        [[nodiscard]] const std::vector<Fragment>& Fragments() const { return m_fragments; }
+
+    private:
+        std::vector<Fragment> m_fragments;
+    };
+}
@@ -1,6 +1,6 @@
 #include "textrenderer.hpp"
 
-#include <regex>
+#include <cstring>
 #include <sstream>
 
 #include <duktape.h>
@@ -9,47 +9,89 @@
 #include "../utils/string.hpp"
 
 using porla::Utils::String;
+using porla::Workflows::ContextProvider;
 using porla::Workflows::TextRenderer;
 
-TextRenderer::TextRenderer(const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts)
-    : m_contexts(contexts)
+// Getter for a lazy context field. It builds the value once and replaces itself with a
+// plain property holding it.
+static duk_ret_t GetField(duk_context* ctx)
 {
-}
+    duk_push_current_function(ctx);
+    duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("provider"));
+    auto* provider = static_cast<ContextProvider*>(duk_get_pointer(ctx, -1));
+    duk_get_prop_string(ctx, -2, DUK_HIDDEN_SYMBOL("field"));
+    const char* field = duk_get_string(ctx, -1);
 
-nlohmann::json TextRenderer::Render(const std::string& text, bool raw_expression)
-{
-    if (raw_expression)
+    // Exceptions must not unwind through duktape, and its errors skip destructors.
+    char error[256] = {};
+    bool failed = false;
+
+    try
     {
-        return RenderSingleExpression(text);
+        duk_push_string(ctx, provider->Field(field).dump().c_str());
+        duk_json_decode(ctx, -1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::strncpy(error, ex.what(), sizeof(error) - 1);
+        failed = true;
     }
 
-    std::regex re(R"(\$\{\{\s(.+?)\s\}\})");
-    std::smatch string_match;
-    std::string current = text;
-    std::vector<nlohmann::json> fragments;
-
-    while (std::regex_search(current, string_match, re))
+    if (failed)
     {
-        const auto lookup_value = string_match[1];
+        return duk_error(ctx, DUK_ERR_ERROR, "%s", error);
+    }
 
-        if (string_match.prefix().length() > 0)
-        {
-            fragments.emplace_back(string_match.prefix());
-        }
+    duk_push_this(ctx);
+    duk_push_string(ctx, field);
+    duk_dup(ctx, -3);
+    duk_def_prop(
+        ctx,
+        -3,
+        DUK_DEFPROP_HAVE_VALUE | DUK_DEFPROP_SET_WRITABLE | DUK_DEFPROP_SET_ENUMERABLE | DUK_DEFPROP_SET_CONFIGURABLE);
+    duk_pop(ctx);
 
-        fragments.emplace_back(RenderSingleExpression(lookup_value));
+    return 1;
+}
 
-        current = string_match.suffix();
-    }
+static void PushLazy(duk_context* ctx, ContextProvider& provider, const std::vector<std::string>& fields)
+{
+    duk_push_object(ctx);
 
-    if (!current.empty())
+    for (const auto& field : fields)
     {
-        fragments.emplace_back(current);
+        duk_push_string(ctx, field.c_str());
+
+        duk_push_c_function(ctx, GetField, 0);
+        duk_push_pointer(ctx, &provider);
+        duk_put_prop_string(ctx, -2, DUK_HIDDEN_SYMBOL("provider"));
+        duk_push_string(ctx, field.c_str());
+        duk_put_prop_string(ctx, -2, DUK_HIDDEN_SYMBOL("field"));
+
+        duk_def_prop(ctx, -3, DUK_DEFPROP_HAVE_GETTER | DUK_DEFPROP_SET_ENUMERABLE | DUK_DEFPROP_SET_CONFIGURABLE);
     }
+}
+
+TextRenderer::TextRenderer(const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts, HeapPool& pool)
+    : m_contexts(contexts)
+    , m_pool(pool)
+{
+}
+
+nlohmann::json TextRenderer::Render(const std::string& text, bool raw_expression)
+{
+    return Render(*Template::Parse(text, raw_expression));
+}
+
+nlohmann::json TextRenderer::Render(const Template& tpl)
+{
+    const auto& fragments = tpl.Fragments();
 
     if (fragments.size() == 1)
     {
-        return fragments.at(0);
+        return fragments.front().expression
+            ? RenderSingleExpression(fragments.front())
+            : nlohmann::json(fragments.front().text);
     }
     else if (fragments.size() > 1)
     {
@@ -57,13 +99,21 @@ nlohmann::json TextRenderer::Render(const std::string& text, bool raw_expression
 
         for (const auto& fragment : fragments)
         {
-            if (fragment.is_string())
+            if (!fragment.expression)
+            {
+                combined_output << fragment.text;
+                continue;
+            }
+
+            const auto value = RenderSingleExpression(fragment);
+
+            if (value.is_string())
             {
-                combined_output << fragment.get<std::string>();
+                combined_output << value.get<std::string>();
             }
             else
             {
-                combined_output << fragment;
+                combined_output << value;
             }
         }
 
@@ -73,26 +123,75 @@ nlohmann::json TextRenderer::Render(const std::string& text, bool raw_expression
     return {};
 }
 
-nlohmann::json TextRenderer::RenderSingleExpression(const std::string &expression)
+void TextRenderer::Invalidate(const std::string& key)
 {
-    duk_context* ctx = duk_create_heap_default();
-    duk_push_global_object(ctx);
+    if (m_lease != nullptr)
+    {
+        m_stale.insert(key);
+    }
+}
 
-    for (const auto& [key, value] : m_contexts)
+nlohmann::json TextRenderer::RenderSingleExpression(const Template::Fragment& expression)
+{
+    if (m_lease == nullptr)
     {
-        // Push and decode JSON.
-        duk_push_string(ctx, value->Value().dump().c_str());
-        duk_json_decode(ctx, -1);
+        m_lease = std::make_unique<HeapPool::Lease>(m_pool.Acquire());
 
-        // Set property on global object
-        duk_put_prop_string(ctx, -2, key.c_str());
+        for (const auto& [key, _] : m_contexts)
+        {
+            m_stale.insert(key);
+        }
     }
 
-    // Pop global object
-    duk_pop(ctx);
+    duk_context* ctx = m_lease->Get();
+
+    if (!m_stale.empty())
+    {
+        duk_push_global_object(ctx);
+
+        for (const auto& key : m_stale)
+        {
+            const auto context = m_contexts.find(key);
+
+            if (context == m_contexts.end())
+            {
+                continue;
+            }
+
+            if (const auto fields = context->second->Fields(); !fields.empty())
+            {
+                PushLazy(ctx, *context->second, fields);
+            }
+            else
+            {
+                // Push and decode JSON.
+                duk_push_string(ctx, context->second->Value().dump().c_str());
+                duk_json_decode(ctx, -1);
+            }
+
+            // Set property on global object
+            duk_put_prop_string(ctx, -2, key.c_str());
+        }
+
+        // Pop global object
+        duk_pop(ctx);
 
-    // Evaluate expression
-    duk_peval_string(ctx, expression.c_str());
+        m_stale.clear();
+    }
+
+    // Evaluate expression, loading the compiled bytecode if there is any.
+    if (expression.bytecode.empty())
+    {
+        duk_peval_string(ctx, expression.text.c_str());
+    }
+    else
+    {
+        void* buffer = duk_push_fixed_buffer(ctx, expression.bytecode.size());
+        std::memcpy(buffer, expression.bytecode.data(), expression.bytecode.size());
+
+        duk_load_function(ctx);
+        duk_pcall(ctx, 0);
+    }
 
     // TODO: check result etc. Can't encode functions
 
@@ -101,9 +200,11 @@ nlohmann::json TextRenderer::RenderSingleExpression(const std::string &expressio
 
     // Get result
     const char* encoded_output = duk_get_string(ctx, -1);
-    nlohmann::json output = nlohmann::json::parse(encoded_output);
+    nlohmann::json output = encoded_output != nullptr
+        ? nlohmann::json::parse(encoded_output)
+        : nlohmann::json();
 
-    duk_destroy_heap(ctx);
+    duk_pop(ctx);
 
     return output;
 }
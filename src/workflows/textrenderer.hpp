@@ -2,24 +2,40 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 
 #include <nlohmann/json.hpp>
 
+#include "heappool.hpp"
+#include "template.hpp"
+
 namespace porla::Workflows
 {
     class ContextProvider;
 
+    // Renders templates against a set of contexts. The contexts are pushed into a pooled
+    // heap once, on the first expression, and reused for every render after that.
     class TextRenderer
     {
     public:
-        explicit TextRenderer(const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts);
+        explicit TextRenderer(
+            const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts,
+            HeapPool& pool = HeapPool::Default());
 
         [[nodiscard]] nlohmann::json Render(const std::string& text, bool raw_expression = false);
+        [[nodiscard]] nlohmann::json Render(const Template& tpl);
+
+        // Pushes the context again before the next expression, for contexts whose value
+        // changed since it was first rendered.
+        void Invalidate(const std::string& key);
 
     private:
-        nlohmann::json RenderSingleExpression(const std::string& expression);
+        nlohmann::json RenderSingleExpression(const Template::Fragment& expression);
 
         std::map<std::string, std::shared_ptr<ContextProvider>> m_contexts;
+        HeapPool& m_pool;
+        std::unique_ptr<HeapPool::Lease> m_lease;
+        std::set<std::string> m_stale;
     };
 }
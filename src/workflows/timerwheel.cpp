@@ -0,0 +1,186 @@
+#include "timerwheel.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+
+using porla::Workflows::TimerWheel;
+
+TimerWheel::TimerWheel(boost::asio::io_context& io)
+    : m_timer(io)
+    , m_start(std::chrono::steady_clock::now())
+    , m_current(0)
+    , m_armed(false)
+    , m_next(1)
+    , m_cancelled(0)
+    , m_expired(0)
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+    m_timer.cancel();
+}
+
+TimerWheel::Id TimerWheel::Schedule(std::chrono::milliseconds delay, std::function<void()> callback)
+{
+    // Entries always fire on a later tick than the current one, rounding up.
+    const auto ticks = std::max<std::int64_t>(1, (delay.count() + Tick.count() - 1) / Tick.count());
+    const Id id = m_next++;
+
+    // The wheel stops turning when empty, so catch up before placing the first entry.
+    if (m_entries.empty())
+    {
+        m_current = std::max(m_current, Now());
+    }
+
+    m_entries.insert({ id, Entry{ Now() + ticks, std::move(callback) } });
+    Insert(id, m_entries.at(id).expiry);
+    Arm();
+
+    return id;
+}
+
+bool TimerWheel::Cancel(Id id)
+{
+    if (m_entries.erase(id) == 0)
+    {
+        return false;
+    }
+
+    m_cancelled++;
+
+    return true;
+}
+
+TimerWheel::Stats TimerWheel::GetStats() const
+{
+    return Stats{
+        .cancelled = m_cancelled,
+        .expired   = m_expired,
+        .pending   = m_entries.size()
+    };
+}
+
+void TimerWheel::Advance()
+{
+    const auto target = Now();
+    std::vector<Id> due;
+
+    while (m_current < target && !m_entries.empty())
+    {
+        m_current++;
+
+        // Cascade every level whose lower levels just wrapped around, re-inserting its
+        // entries closer to the bottom.
+        for (int level = 1; level < Levels; level++)
+        {
+            if ((m_current & ((std::uint64_t(1) << (Bits * level)) - 1)) != 0)
+            {
+                break;
+            }
+
+            auto ids = std::move(m_wheel[level][(m_current >> (Bits * level)) & (Slots - 1)]);
+            m_wheel[level][(m_current >> (Bits * level)) & (Slots - 1)].clear();
+
+            for (const auto id : ids)
+            {
+                if (const auto entry = m_entries.find(id); entry != m_entries.end())
+                {
+                    Insert(id, entry->second.expiry);
+                }
+            }
+        }
+
+        auto& slot = m_wheel[0][m_current & (Slots - 1)];
+
+        for (const auto id : slot)
+        {
+            if (const auto entry = m_entries.find(id); entry != m_entries.end() && entry->second.expiry <= m_current)
+            {
+                due.push_back(id);
+            }
+        }
+
+        slot.clear();
+    }
+
+    // Nothing pending, so the wheel can skip ahead.
+    if (m_entries.empty())
+    {
+        m_current = target;
+    }
+
+    // Callbacks may schedule again, so they run once the wheel is consistent.
+    for (const auto id : due)
+    {
+        auto entry = m_entries.find(id);
+        if (entry == m_entries.end()) { continue; }
+
+        auto callback = std::move(entry->second.callback);
+        m_entries.erase(entry);
+        m_expired++;
+
+        try
+        {
+            callback();
+        }
+        catch (const std::exception& ex)
+        {
+            BOOST_LOG_TRIVIAL(error) << "Timer callback failed: " << ex.what();
+        }
+    }
+}
+
+void TimerWheel::Arm()
+{
+    if (m_armed || m_entries.empty())
+    {
+        return;
+    }
+
+    m_armed = true;
+
+    m_timer.expires_at(m_start + Tick * static_cast<std::int64_t>(m_current + 1));
+    m_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+            if (ec) { return; }
+
+            m_armed = false;
+
+            Advance();
+            Arm();
+        });
+}
+
+void TimerWheel::Insert(Id id, std::uint64_t expiry)
+{
+    const std::uint64_t delta = expiry > m_current ? expiry - m_current : 0;
+
+    if (delta == 0)
+    {
+        // Due already, when cascading. The current slot is handled right after.
+        m_wheel[0][m_current & (Slots - 1)].push_back(id);
+        return;
+    }
+
+    for (int level = 0; level < Levels; level++)
+    {
+        if (delta < (std::uint64_t(1) << (Bits * (level + 1))))
+        {
+            m_wheel[level][(expiry >> (Bits * level)) & (Slots - 1)].push_back(id);
+            return;
+        }
+    }
+
+    // Further out than the wheel spans. Parked in the last slot the top level reaches and
+    // re-inserted from there when it cascades.
+    const auto top = Bits * (Levels - 1);
+    m_wheel[Levels - 1][((m_current >> top) + Slots - 1) & (Slots - 1)].push_back(id);
+}
+
+std::uint64_t TimerWheel::Now() const
+{
+    return static_cast<std::uint64_t>((std::chrono::steady_clock::now() - m_start) / Tick);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace porla::Workflows
+{
+    // A hierarchical timer wheel shared by the time based workflow actions. Timeouts are
+    // kept in slots with a resolution of one tick, and a single asio timer advances the
+    // wheel while anything is pending. Not thread safe, it is used from the io thread.
+    class TimerWheel
+    {
+    public:
+        typedef std::uint64_t Id;
+
+        struct Stats
+        {
+            std::uint64_t cancelled = 0;
+            std::uint64_t expired   = 0;
+            std::size_t   pending   = 0;
+        };
+
+        static constexpr std::chrono::milliseconds Tick{10};
+
+        explicit TimerWheel(boost::asio::io_context& io);
+        TimerWheel(const TimerWheel&) = delete;
+        ~TimerWheel();
+
+        Id Schedule(std::chrono::milliseconds delay, std::function<void()> callback);
+        bool Cancel(Id id);
+
+        [[nodiscard]] Stats GetStats() const;
+
+    private:
+        static constexpr int Bits   = 6;
+        static constexpr int Levels = 4;
+        static constexpr int Slots  = 1 << Bits;
+
+        struct Entry
+        {
+            std::uint64_t expiry; // in ticks
+            std::function<void()> callback;
+        };
+
+        void Advance();
+        void Arm();
+        void Insert(Id id, std::uint64_t expiry);
+        std::uint64_t Now() const;
+
+        boost::asio::steady_timer m_timer;
+        std::chrono::steady_clock::time_point m_start;
+        std::uint64_t m_current;
+        bool m_armed;
+
+        // Slots hold ids, and cancelled ids are skipped when their slot comes due.
+        std::array<std::array<std::vector<Id>, Slots>, Levels> m_wheel;
+        std::unordered_map<Id, Entry> m_entries;
+        Id m_next;
+
+        std::uint64_t m_cancelled;
+        std::uint64_t m_expired;
+    };
+}
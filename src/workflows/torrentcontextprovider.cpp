@@ -6,9 +6,10 @@
 #include "../torrentclientdata.hpp"
 
 using porla::Workflows::TorrentContextProvider;
+using porla::Workflows::TorrentsContextProvider;
 
 TorrentContextProvider::TorrentContextProvider(const libtorrent::torrent_status &ts)
-    : m_ts(std::make_unique<lt::torrent_status>(ts))
+    : m_ts(std::make_shared<const lt::torrent_status>(ts))
 {
 }
 
@@ -22,3 +23,40 @@ nlohmann::json TorrentContextProvider::Value()
 
     return torrent;
 }
+
+std::vector<std::string> TorrentContextProvider::Fields()
+{
+    return {"info_hash", "name", "progress", "save_path", "total", "total_done", "total_wanted"};
+}
+
+nlohmann::json TorrentContextProvider::Field(const std::string& name)
+{
+    if (name == "info_hash")    return m_ts->info_hashes;
+    if (name == "name")         return m_ts->name;
+    if (name == "progress")     return m_ts->progress;
+    if (name == "save_path")    return m_ts->save_path;
+    if (name == "total")        return m_ts->total;
+    if (name == "total_done")   return m_ts->total_done;
+    if (name == "total_wanted") return m_ts->total_wanted;
+
+    return nullptr;
+}
+
+TorrentsContextProvider::TorrentsContextProvider(std::vector<std::shared_ptr<const libtorrent::torrent_status>> torrents)
+    : m_torrents(std::move(torrents))
+{
+}
+
+TorrentsContextProvider::~TorrentsContextProvider() = default;
+
+nlohmann::json TorrentsContextProvider::Value()
+{
+    nlohmann::json torrents = nlohmann::json::array();
+
+    for (const auto& ts : m_torrents)
+    {
+        torrents.push_back(*ts);
+    }
+
+    return torrents;
+}
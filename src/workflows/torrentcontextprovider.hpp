@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <libtorrent/fwd.hpp>
 
@@ -8,14 +9,36 @@
 
 namespace porla::Workflows
 {
+    // Shares one immutable copy of the status, so every workflow matching an event, and
+    // every batch it joins, reads the same one.
     class TorrentContextProvider : public ContextProvider
     {
     public:
         explicit TorrentContextProvider(const libtorrent::torrent_status& ts);
 
         nlohmann::json Value() override;
+        std::vector<std::string> Fields() override;
+        nlohmann::json Field(const std::string& name) override;
+
+        [[nodiscard]] const libtorrent::torrent_status& Status() const { return *m_ts; }
+        [[nodiscard]] const std::shared_ptr<const libtorrent::torrent_status>& Shared() const { return m_ts; }
+
+    private:
+        std::shared_ptr<const libtorrent::torrent_status> m_ts;
+    };
+
+    // The torrents of a batched run, as an array.
+    class TorrentsContextProvider : public ContextProvider
+    {
+    public:
+        explicit TorrentsContextProvider(std::vector<std::shared_ptr<const libtorrent::torrent_status>> torrents);
+        ~TorrentsContextProvider();
+
+        nlohmann::json Value() override;
+
+        [[nodiscard]] const std::vector<std::shared_ptr<const libtorrent::torrent_status>>& Torrents() const { return m_torrents; }
 
     private:
-        std::unique_ptr<libtorrent::torrent_status> m_ts;
+        std::vector<std::shared_ptr<const libtorrent::torrent_status>> m_torrents;
     };
 }
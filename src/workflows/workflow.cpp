@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <regex>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
@@ -12,7 +13,10 @@
 #include "actionfactory.hpp"
 #include "contextprovider.hpp"
 #include "step.hpp"
+#include "stepbudget.hpp"
 #include "textrenderer.hpp"
+#include "torrentcontextprovider.hpp"
+#include "../utils/livecount.hpp"
 #include "../utils/yaml.hpp"
 
 using porla::Workflows::Action;
@@ -20,9 +24,34 @@ using porla::Workflows::ActionCallback;
 using porla::Workflows::ActionFactory;
 using porla::Workflows::ContextProvider;
 using porla::Workflows::Step;
+using porla::Workflows::StepBudget;
+using porla::Workflows::StepStage;
+using porla::Workflows::Template;
 using porla::Workflows::TextRenderer;
+using porla::Workflows::TorrentContextProvider;
 using porla::Workflows::Workflow;
 using porla::Workflows::WorkflowOptions;
+using porla::Workflows::WorkflowRunOptions;
+
+static void CompileTemplates(const nlohmann::json& j, std::map<std::string, std::shared_ptr<const Template>>& templates)
+{
+    if (j.is_string())
+    {
+        const auto& text = j.get_ref<const std::string&>();
+
+        if (!templates.contains(text))
+        {
+            templates.insert({ text, Template::Compile(text) });
+        }
+    }
+    else if (j.is_structured())
+    {
+        for (const auto& item : j)
+        {
+            CompileTemplates(item, templates);
+        }
+    }
+}
 
 struct StepInstance
 {
@@ -33,9 +62,21 @@ struct StepInstance
 class StepContextProvider : public ContextProvider
 {
 public:
-    void AddOutput(const nlohmann::json& j)
+    explicit StepContextProvider(std::size_t steps, const nlohmann::json& outputs = nullptr)
+        : m_outputs(nlohmann::json::array())
+    {
+        // Null until the step completes, since steps of a stage complete in any order.
+        for (std::size_t i = 0; i < steps; i++) m_outputs.push_back(nullptr);
+
+        if (outputs.is_array() && outputs.size() == steps)
+        {
+            m_outputs = outputs;
+        }
+    }
+
+    void SetOutput(std::size_t index, const nlohmann::json& j)
     {
-        m_outputs.push_back(j);
+        m_outputs[index] = j;
     }
 
     nlohmann::json Value() override
@@ -70,51 +111,203 @@ private:
     std::function<nlohmann::json(std::string, bool)> m_renderer;
 };
 
-class LoopingWorkflowRunner : public ActionCallback, public std::enable_shared_from_this<LoopingWorkflowRunner>
+class WorkflowRunner : public std::enable_shared_from_this<WorkflowRunner>
 {
 public:
-    explicit LoopingWorkflowRunner(
+    explicit WorkflowRunner(
         const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts,
-        const std::vector<StepInstance>& step_instances)
+        const std::vector<StepInstance>& step_instances,
+        const std::vector<StepStage>& stages,
+        WorkflowRunOptions run,
+        std::function<void()> done)
         : m_contexts(contexts)
-        , m_step_context_provider(std::make_shared<StepContextProvider>())
         , m_step_instances(step_instances)
-        , m_current_index(0)
+        , m_stages(stages)
+        , m_budget(std::move(run.budget))
+        , m_checkpoint(std::move(run.checkpoint))
+        , m_done(std::move(done))
     {
+        const bool resumable = run.stage <= m_stages.size()
+            && run.outputs.is_array()
+            && run.outputs.size() == m_step_instances.size();
+
+        if (resumable)
+        {
+            m_stage = run.stage;
+        }
+        else if (run.stage > 0)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Saved outputs do not fit the workflow, running it from the start";
+        }
+
+        m_step_context_provider = std::make_shared<StepContextProvider>(
+            step_instances.size(),
+            resumable ? run.outputs : nullptr);
+
         m_contexts.insert({"steps", m_step_context_provider});
+
+        // One renderer for the whole run, so contexts are pushed once rather than for
+        // every expression.
+        m_renderer = std::make_unique<TextRenderer>(m_contexts);
     }
 
-    void Complete(const nlohmann::json& j) override
+    // The run is over once nothing holds on to the runner, which covers actions that
+    // fail without completing.
+    ~WorkflowRunner()
     {
-        // This is the instance that completed. Set its output.
-        auto& instance = m_step_instances.at(m_current_index);
-
-        m_current_index++;
-        m_step_context_provider->AddOutput(j);
+        if (m_done) { m_done(); }
+    }
 
-        if (m_current_index >= m_step_instances.size())
+    // Starts the steps of the current stage which may run, and moves on to the next stage
+    // once they are all done. Steps completing synchronously call back into this, so it is
+    // guarded against re-entry.
+    void Run()
+    {
+        if (m_running)
         {
             return;
         }
 
+        m_running = true;
+
+        while (!m_failed && m_stage < m_stages.size())
+        {
+            const auto& stage = m_stages[m_stage];
+
+            if (m_next >= stage.steps.size())
+            {
+                if (m_in_flight > 0) { break; }
+
+                m_stage++;
+                m_next = 0;
+
+                if (m_checkpoint && m_stage < m_stages.size())
+                {
+                    m_checkpoint(m_stage, m_step_context_provider->m_outputs);
+                }
+
+                continue;
+            }
+
+            if (stage.max_parallel > 0 && m_in_flight >= stage.max_parallel)
+            {
+                break;
+            }
+
+            bool slot = false;
+
+            if (m_in_flight > 0 && m_budget != nullptr)
+            {
+                if (m_granted)
+                {
+                    m_granted = false;
+                }
+                else if (!m_budget->TryAcquire())
+                {
+                    Wait();
+                    break;
+                }
+
+                slot = true;
+            }
+
+            Start(stage.steps[m_next++], slot);
+        }
+
+        m_running = false;
+
+        // A slot handed over when no more steps could start goes back.
+        if (m_granted)
+        {
+            m_granted = false;
+            m_budget->Release();
+        }
+    }
+
+    void Completed(std::size_t index, const nlohmann::json& output)
+    {
+        m_in_flight--;
+        m_step_context_provider->SetOutput(index, output);
+        m_renderer->Invalidate("steps");
+
         Run();
     }
 
-    void Run()
+    // A step whose action let go of its callback without completing ends the run, once
+    // the other steps in flight are done.
+    void Failed()
+    {
+        m_in_flight--;
+        m_failed = true;
+    }
+
+private:
+    class StepCallback : public ActionCallback
+    {
+    public:
+        StepCallback(std::shared_ptr<WorkflowRunner> runner, std::size_t index, bool slot)
+            : m_runner(std::move(runner))
+            , m_index(index)
+            , m_slot(slot)
+        {
+        }
+
+        ~StepCallback()
+        {
+            if (!m_completed) m_runner->Failed();
+            if (m_slot) m_runner->m_budget->Release();
+        }
+
+        void Complete(const nlohmann::json& output) override
+        {
+            if (m_completed)
+            {
+                return;
+            }
+
+            m_completed = true;
+
+            // The slot is free as soon as the step is done, not when the action lets go.
+            if (m_slot)
+            {
+                m_slot = false;
+                m_runner->m_budget->Release();
+            }
+
+            m_runner->Completed(m_index, output);
+        }
+
+    private:
+        std::shared_ptr<WorkflowRunner> m_runner;
+        std::size_t m_index;
+        bool m_slot;
+        bool m_completed = false;
+    };
+
+    void Start(std::size_t index, bool slot)
     {
-        const auto& instance = m_step_instances.at(m_current_index);
+        const auto& instance = m_step_instances.at(index);
+
+        m_in_flight++;
 
         SimpleActionParams sap{
             instance.step.with,
-            [_this = shared_from_this()](const std::string& text, bool raw_expression)
+            [_this = shared_from_this(), &templates = instance.step.templates](const std::string& text, bool raw_expression)
             {
-                TextRenderer renderer{_this->m_contexts};
-                return renderer.Render(text, raw_expression);
+                if (!raw_expression)
+                {
+                    if (const auto tpl = templates.find(text); tpl != templates.end())
+                    {
+                        return _this->m_renderer->Render(*tpl->second);
+                    }
+                }
+
+                return _this->m_renderer->Render(text, raw_expression);
             }};
 
         try
         {
-            instance.action->Invoke(sap, shared_from_this());
+            instance.action->Invoke(sap, std::make_shared<StepCallback>(shared_from_this(), index, slot));
         }
         catch (const std::exception& ex)
         {
@@ -122,22 +315,107 @@ public:
         }
     }
 
-private:
+    void Wait()
+    {
+        if (m_waiting)
+        {
+            return;
+        }
+
+        m_waiting = true;
+
+        // Not held by the budget, since the run may finish without the slot when the other
+        // steps of the group are done first.
+        m_budget->Wait(
+            [runner = weak_from_this(), budget = m_budget.get()]()
+            {
+                const auto _this = runner.lock();
+
+                if (!_this)
+                {
+                    return budget->Release();
+                }
+
+                _this->m_waiting = false;
+                _this->m_granted = true;
+                _this->Run();
+            });
+    }
+
     std::map<std::string, std::shared_ptr<ContextProvider>> m_contexts;
     std::shared_ptr<StepContextProvider> m_step_context_provider;
+    std::unique_ptr<TextRenderer> m_renderer;
     std::vector<StepInstance> m_step_instances;
-    int m_current_index;
+    std::vector<StepStage> m_stages;
+    std::shared_ptr<StepBudget> m_budget;
+    std::function<void(std::size_t, const nlohmann::json&)> m_checkpoint;
+    std::function<void()> m_done;
+
+    std::size_t m_stage = 0;
+    // The next step of the stage to start, and how many of its steps are running.
+    std::size_t m_next = 0;
+    int m_in_flight = 0;
+    bool m_failed = false;
+    bool m_running = false;
+    // Waiting for a slot in the budget, and holding one handed over while waiting.
+    bool m_waiting = false;
+    bool m_granted = false;
+    [[no_unique_address]] porla::Utils::LiveCount<WorkflowRunner> m_live;
 };
 
 Workflow::Workflow(const WorkflowOptions &opts)
     : m_on(opts.on)
+    , m_batch(opts.batch)
+    , m_concurrency(opts.concurrency)
+    , m_name(opts.name)
+    , m_priority(opts.priority)
     , m_steps(opts.steps)
+    , m_stages(opts.stages)
     , m_condition(opts.condition)
 {
+    if (m_stages.empty())
+    {
+        for (std::size_t i = 0; i < m_steps.size(); i++)
+        {
+            m_stages.push_back(StepStage{ .steps = { i } });
+        }
+    }
+
+    for (const auto& stage : m_stages)
+    {
+        for (const auto index : stage.steps)
+        {
+            if (index >= m_steps.size())
+            {
+                throw std::invalid_argument("Stage has a step which does not exist");
+            }
+        }
+    }
+
+    if (!m_condition.empty())
+    {
+        m_condition_template = Template::Compile(m_condition, true);
+    }
+
+    // Throws a QueryError for invalid queries, so the workflow fails to load.
+    if (!opts.where.empty())
+    {
+        m_where = Query::PQL::Parse(opts.where);
+    }
+
+    for (auto& step : m_steps)
+    {
+        CompileTemplates(step.with, step.templates);
+    }
 }
 
 Workflow::~Workflow() = default;
 
+std::uint64_t Workflow::RunsInProgress()
+{
+    return porla::Utils::LiveCount<WorkflowRunner>::Count();
+}
+
 bool Workflow::ShouldExecute(
     const std::string &event_name,
     const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts)
@@ -147,10 +425,35 @@ bool Workflow::ShouldExecute(
         return false;
     }
 
+    return Matches(contexts);
+}
+
+bool Workflow::Matches(const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts)
+{
+    // Matched against the torrent itself, without going through the JS heap.
+    if (m_where != nullptr)
+    {
+        const auto torrent = contexts.find("torrent");
+        const auto provider = torrent != contexts.end()
+            ? std::dynamic_pointer_cast<TorrentContextProvider>(torrent->second)
+            : nullptr;
+
+        if (provider == nullptr)
+        {
+            BOOST_LOG_TRIVIAL(warning) << "Workflow " << m_name << " has a where query but the event has no torrent";
+            return false;
+        }
+
+        if (!m_where->Includes(provider->Status()))
+        {
+            return false;
+        }
+    }
+
     if (!m_condition.empty())
     {
         porla::Workflows::TextRenderer renderer{contexts};
-        const auto output = renderer.Render(m_condition, true);
+        const auto output = renderer.Render(*m_condition_template);
 
         if (output == false || output == nullptr || output == 0)
         {
@@ -163,7 +466,9 @@ bool Workflow::ShouldExecute(
 
 void Workflow::Execute(
     const ActionFactory &action_factory,
-    const std::map<std::string, std::shared_ptr<ContextProvider>> &contexts)
+    const std::map<std::string, std::shared_ptr<ContextProvider>> &contexts,
+    std::function<void()> done,
+    WorkflowRunOptions run)
 {
     std::vector<StepInstance> step_instances;
 
@@ -174,6 +479,7 @@ void Workflow::Execute(
         if (action == nullptr)
         {
             BOOST_LOG_TRIVIAL(error) << "Invalid action name: " << step.uses;
+            if (done) { done(); }
             return;
         }
 
@@ -183,7 +489,13 @@ void Workflow::Execute(
         });
     }
 
-    std::make_shared<LoopingWorkflowRunner>(contexts, step_instances)->Run();
+    if (step_instances.empty())
+    {
+        if (done) { done(); }
+        return;
+    }
+
+    std::make_shared<WorkflowRunner>(contexts, step_instances, m_stages, std::move(run), std::move(done))->Run();
 }
 
 std::shared_ptr<Workflow> Workflow::LoadFromFile(const std::filesystem::path& workflow_file)
@@ -202,10 +514,12 @@ std::shared_ptr<Workflow> Workflow::LoadFromFile(const std::filesystem::path& wo
 
     workflow_input_file.read(workflow_file_buffer.data(), workflow_file_size);
 
-    return LoadFromYaml(workflow_file_buffer.data());
+    return LoadFromYaml(
+        std::string(workflow_file_buffer.data(), workflow_file_buffer.size()),
+        workflow_file.stem().string());
 }
 
-std::shared_ptr<Workflow> Workflow::LoadFromYaml(const std::string& yaml)
+std::shared_ptr<Workflow> Workflow::LoadFromYaml(const std::string& yaml, const std::string& name)
 {
     const auto node = YAML::Load(yaml);
 
@@ -218,22 +532,74 @@ std::shared_ptr<Workflow> Workflow::LoadFromYaml(const std::string& yaml)
         condition = node["if"].as<std::string>();
     }
 
+    std::optional<porla::Workflows::WorkflowBatch> batch;
+
+    if (const auto batch_node = node["batch"])
+    {
+        batch = porla::Workflows::WorkflowBatch{
+            .window   = std::chrono::milliseconds(static_cast<int>(batch_node["window"].as<double>(10) * 1000)),
+            .max_size = batch_node["max_size"].as<std::size_t>(100)
+        };
+    }
+
+    std::string where;
+
+    if (node["where"])
+    {
+        where = node["where"].as<std::string>();
+    }
+
     std::vector<Step> workflow_steps;
+    std::vector<StepStage> workflow_stages;
+
+    const auto parse_step = [&workflow_steps](const YAML::Node& step)
+    {
+        workflow_steps.emplace_back(Step{
+            .uses = step["uses"].as<std::string>(),
+            .with = step["with"] ? porla::Utils::Yaml::ToJson(step["with"]) : nullptr
+        });
+
+        return workflow_steps.size() - 1;
+    };
 
     if (node["steps"] && node["steps"].IsSequence())
     {
         for (const auto step : node["steps"])
         {
-            workflow_steps.emplace_back(Step{
-                .uses = step["uses"].as<std::string>(),
-                .with = step["with"] ? porla::Utils::Yaml::ToJson(step["with"]) : nullptr
-            });
+            // A parallel group is one stage, its steps numbered in the order they are listed.
+            if (const auto parallel = step["parallel"])
+            {
+                if (!parallel.IsSequence())
+                {
+                    throw std::invalid_argument("'parallel' must be a list of steps");
+                }
+
+                StepStage stage{
+                    .max_parallel = step["max_parallel"] ? step["max_parallel"].as<int>() : 0
+                };
+
+                for (const auto child : parallel)
+                {
+                    stage.steps.push_back(parse_step(child));
+                }
+
+                workflow_stages.push_back(std::move(stage));
+                continue;
+            }
+
+            workflow_stages.push_back(StepStage{ .steps = { parse_step(step) } });
         }
     }
 
     return std::make_shared<Workflow>(WorkflowOptions{
-        .condition = condition,
-        .on        = {on},
-        .steps     = workflow_steps
+        .batch       = batch,
+        .condition   = condition,
+        .concurrency = node["concurrency"] ? node["concurrency"].as<int>() : 0,
+        .name        = node["name"] ? node["name"].as<std::string>() : name,
+        .on          = {on},
+        .priority    = node["priority"] ? node["priority"].as<int>() : 0,
+        .steps       = workflow_steps,
+        .stages      = workflow_stages,
+        .where       = where
     });
 }
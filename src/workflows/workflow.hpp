@@ -1,45 +1,105 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_set>
 
 #include "step.hpp"
+#include "template.hpp"
+#include "../query/pql.hpp"
 
 namespace porla::Workflows
 {
     class ActionFactory;
     class ContextProvider;
+    class StepBudget;
+
+    // Collects the torrents of matching events and runs the workflow once for all of them,
+    // when the window has passed or max_size torrents are collected.
+    struct WorkflowBatch
+    {
+        std::chrono::milliseconds window;
+        std::size_t               max_size;
+    };
+
+    struct WorkflowRunOptions
+    {
+        // Steps beside another running one of their stage wait for a slot here, if given.
+        std::shared_ptr<StepBudget> budget;
+        // Where a resumed run starts, with the outputs of the steps done before it. Outputs
+        // which do not fit the workflow start the run over.
+        std::size_t     stage = 0;
+        nlohmann::json  outputs;
+        // Called as each stage but the last is done, with the stage to resume from.
+        std::function<void(std::size_t stage, const nlohmann::json& outputs)> checkpoint;
+    };
 
     struct WorkflowOptions
     {
+        std::optional<WorkflowBatch>    batch;
         std::string                     condition;
+        int                             concurrency = 0; // runs at a time, 0 for no limit
+        std::string                     name;
         std::unordered_set<std::string> on;
+        int                             priority = 0;    // queued runs of higher priority start first
+        // Outputs are in the steps context by their index here, whichever stage they are in.
         std::vector<Step>               steps;
+        // Empty to run the steps one at a time.
+        std::vector<StepStage>          stages;
+        std::string                     where; // a PQL query the torrent must match
     };
 
     class Workflow
     {
     public:
         static std::shared_ptr<Workflow> LoadFromFile(const std::filesystem::path& workflow_file);
-        static std::shared_ptr<Workflow> LoadFromYaml(const std::string& yaml);
+        // The name defaults to the one given, if the workflow does not have one.
+        static std::shared_ptr<Workflow> LoadFromYaml(const std::string& yaml, const std::string& name = "");
 
         explicit Workflow(const WorkflowOptions& opts);
         ~Workflow();
 
+        // Runs of any workflow which are not done yet.
+        static std::uint64_t RunsInProgress();
+
+        [[nodiscard]] const std::optional<WorkflowBatch>& Batch() const { return m_batch; }
+        [[nodiscard]] int Concurrency() const { return m_concurrency; }
+        [[nodiscard]] const std::string& Name() const { return m_name; }
+        [[nodiscard]] int Priority() const { return m_priority; }
+        [[nodiscard]] const std::unordered_set<std::string>& On() const { return m_on; }
+
         bool ShouldExecute(
             const std::string& event_name,
             const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts);
 
+        // Evaluates the where and if conditions only, for callers that already know the
+        // workflow runs on the event.
+        bool Matches(const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts);
+
+        // Runs the stages in order, and the steps of a stage at the same time. Done is
+        // called once the run is over, whether it ran every step or not.
         void Execute(
             const ActionFactory& action_factory,
-            const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts);
+            const std::map<std::string, std::shared_ptr<ContextProvider>>& contexts,
+            std::function<void()> done = {},
+            WorkflowRunOptions run = {});
 
     private:
         std::unordered_set<std::string> m_on;
+        std::optional<WorkflowBatch> m_batch;
+        int m_concurrency;
+        std::string m_name;
+        int m_priority;
         std::string m_condition;
+        std::shared_ptr<const Template> m_condition_template;
         std::vector<Step> m_steps;
+        std::vector<StepStage> m_stages;
+        std::unique_ptr<Query::PQL::Filter> m_where;
     };
 }
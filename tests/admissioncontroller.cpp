@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/admissioncontroller.hpp"
+
+using porla::AdmissionController;
+using porla::AdmissionControllerOptions;
+using porla::AdmissionPriority;
+
+typedef std::shared_ptr<AdmissionController::Slot> SlotPtr;
+
+TEST(AdmissionControllerTests, Submit_RunsRightAwayWithinTheLimits)
+{
+    boost::asio::io_context io;
+    AdmissionController admission(io, AdmissionControllerOptions{ .max_concurrent = 2 });
+
+    std::vector<SlotPtr> slots;
+
+    admission.Submit("a", AdmissionPriority::Read, [&](SlotPtr slot) { slots.push_back(slot); }, [](auto) { FAIL(); });
+    admission.Submit("b", AdmissionPriority::Read, [&](SlotPtr slot) { slots.push_back(slot); }, [](auto) { FAIL(); });
+
+    EXPECT_EQ(slots.size(), 2);
+    EXPECT_EQ(admission.GetStats().running, 2);
+
+    slots.clear();
+
+    EXPECT_EQ(admission.GetStats().running, 0);
+}
+
+TEST(AdmissionControllerTests, Submit_RunsQueuedRequestsInPriorityOrder)
+{
+    boost::asio::io_context io;
+    AdmissionController admission(io, AdmissionControllerOptions{ .max_concurrent = 1, .max_per_client = 4 });
+
+    SlotPtr running;
+    std::vector<std::string> order;
+
+    admission.Submit("a", AdmissionPriority::Bulk, [&](SlotPtr slot) { running = slot; }, [](auto) { FAIL(); });
+    admission.Submit("a", AdmissionPriority::Bulk, [&](SlotPtr) { order.emplace_back("bulk"); }, [](auto) { FAIL(); });
+    admission.Submit("a", AdmissionPriority::Read, [&](SlotPtr) { order.emplace_back("read"); }, [](auto) { FAIL(); });
+    admission.Submit("a", AdmissionPriority::Control, [&](SlotPtr) { order.emplace_back("control"); }, [](auto) { FAIL(); });
+
+    EXPECT_EQ(admission.GetStats().queued, 3);
+
+    // Each queued request drops its slot when it is done, letting in the next one.
+    running.reset();
+    io.poll();
+
+    EXPECT_EQ(order, (std::vector<std::string>{ "control", "read", "bulk" }));
+}
+
+TEST(AdmissionControllerTests, Submit_NeverQueuesHealthRequests)
+{
+    boost::asio::io_context io;
+    AdmissionController admission(io, AdmissionControllerOptions{ .max_concurrent = 1 });
+
+    SlotPtr running;
+    bool health = false;
+
+    admission.Submit("a", AdmissionPriority::Read, [&](SlotPtr slot) { running = slot; }, [](auto) { FAIL(); });
+    admission.Submit("a", AdmissionPriority::Health, [&](SlotPtr) { health = true; }, [](auto) { FAIL(); });
+
+    EXPECT_TRUE(health);
+    EXPECT_EQ(admission.GetStats().running, 1);
+}
+
+TEST(AdmissionControllerTests, Submit_LimitsEachClientAndBulkReads)
+{
+    boost::asio::io_context io;
+    AdmissionController admission(io, AdmissionControllerOptions{ .max_concurrent = 4, .max_per_client = 1, .max_bulk = 1 });
+
+    std::vector<SlotPtr> slots;
+    const auto keep = [&](SlotPtr slot) { slots.push_back(slot); };
+
+    admission.Submit("a", AdmissionPriority::Read, keep, [](auto) {});
+    admission.Submit("a", AdmissionPriority::Read, keep, [](auto) {});
+    admission.Submit("b", AdmissionPriority::Bulk, keep, [](auto) {});
+    admission.Submit("c", AdmissionPriority::Bulk, keep, [](auto) {});
+    admission.Submit("d", AdmissionPriority::Control, keep, [](auto) {});
+
+    // One for a, one bulk read and the control request.
+    EXPECT_EQ(slots.size(), 3);
+    EXPECT_EQ(admission.GetStats().queued, 2);
+}
+
+TEST(AdmissionControllerTests, Submit_ShedsLessUrgentRequestsWhenTheQueueIsFull)
+{
+    boost::asio::io_context io;
+    AdmissionController admission(io, AdmissionControllerOptions{ .max_concurrent = 1, .max_queued = 1 });
+
+    SlotPtr running;
+    std::vector<std::string> shed;
+
+    admission.Submit("a", AdmissionPriority::Read, [&](SlotPtr slot) { running = slot; }, [](auto) { FAIL(); });
+    admission.Submit("b", AdmissionPriority::Bulk, [](SlotPtr) {}, [&](auto) { shed.emplace_back("bulk"); });
+    admission.Submit("c", AdmissionPriority::Control, [](SlotPtr) {}, [&](auto) { shed.emplace_back("control"); });
+    admission.Submit("d", AdmissionPriority::Read, [](SlotPtr) {}, [&](auto) { shed.emplace_back("read"); });
+
+    io.poll();
+
+    EXPECT_EQ(shed, (std::vector<std::string>{ "bulk", "read" }));
+    EXPECT_EQ(admission.GetStats().shed_full, 2);
+}
+
+TEST(AdmissionControllerTests, Submit_ShedsRequestsPastTheirBudget)
+{
+    boost::asio::io_context io;
+    AdmissionController admission(io, AdmissionControllerOptions{
+        .max_concurrent = 1,
+        .read_budget    = std::chrono::milliseconds(10)
+    });
+
+    SlotPtr running;
+    std::optional<AdmissionController::Rejection> rejection;
+
+    admission.Submit("a", AdmissionPriority::Read, [&](SlotPtr slot) { running = slot; }, [](auto) { FAIL(); });
+    admission.Submit("b", AdmissionPriority::Read, [](SlotPtr) { FAIL(); }, [&](auto r) { rejection = r; });
+
+    io.run_for(std::chrono::milliseconds(200));
+
+    ASSERT_TRUE(rejection.has_value());
+    EXPECT_EQ(*rejection, AdmissionController::Rejection::Timeout);
+    EXPECT_EQ(admission.GetStats().queued, 0);
+}
@@ -0,0 +1,49 @@
+#include "allocations.hpp"
+
+#include <cstdlib>
+#include <new>
+
+using porla::Tests::AllocationScope;
+
+// Per thread, so tests which start threads of their own do not skew the counts.
+static thread_local std::uint64_t t_bytes = 0;
+static thread_local std::uint64_t t_count = 0;
+
+AllocationScope::AllocationScope()
+    : m_bytes(t_bytes)
+    , m_count(t_count)
+{
+}
+
+std::uint64_t AllocationScope::Bytes() const
+{
+    return t_bytes - m_bytes;
+}
+
+std::uint64_t AllocationScope::Count() const
+{
+    return t_count - m_count;
+}
+
+void* operator new(std::size_t size)
+{
+    t_bytes += size;
+    t_count++;
+
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
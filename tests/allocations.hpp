@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+namespace porla::Tests
+{
+    // Counts the calls to the global operator new made on this thread while it is alive,
+    // and the bytes they asked for. The test binary replaces operator new to count them.
+    // Other threads are left out, so work handed off to them is not counted either.
+    class AllocationScope
+    {
+    public:
+        AllocationScope();
+
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+
+        [[nodiscard]] std::uint64_t Bytes() const;
+        [[nodiscard]] std::uint64_t Count() const;
+
+    private:
+        std::uint64_t m_bytes;
+        std::uint64_t m_count;
+    };
+}
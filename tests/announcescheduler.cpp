@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/announcescheduler.hpp"
+
+using porla::AnnounceScheduler;
+using porla::AnnounceSchedulerOptions;
+using porla::ISession;
+
+static lt::info_hash_t Hash(char c)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, c).c_str()));
+}
+
+static void Add(InMemorySession& session, const lt::info_hash_t& hash, const std::string& tracker = "udp://tracker.example.org:1337/announce")
+{
+    lt::torrent_status ts;
+    ts.info_hashes     = hash;
+    ts.current_tracker = tracker;
+
+    session.m_statuses.insert({ hash, ts });
+}
+
+static std::vector<lt::info_hash_t> Sent(const InMemorySession& session)
+{
+    std::vector<lt::info_hash_t> hashes;
+    for (const auto& [hash, _] : session.m_reannounced) hashes.push_back(hash);
+    return hashes;
+}
+
+TEST(AnnounceSchedulerTests, Reannounce_BeyondBurst_WaitsInPriorityOrder)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    AnnounceScheduler announces(io, session, AnnounceSchedulerOptions{ .rate = 1, .burst = 1 });
+
+    Add(session, Hash('a'));
+    Add(session, Hash('b'));
+    Add(session, Hash('c'));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    EXPECT_TRUE(announces.Reannounce(Hash('a')));
+    EXPECT_TRUE(announces.Reannounce(Hash('b'), 0));
+    EXPECT_TRUE(announces.Reannounce(Hash('c'), 5, true));
+
+    EXPECT_EQ(Sent(session), (std::vector<lt::info_hash_t>{ Hash('a') }));
+    EXPECT_EQ(announces.GetStats().queued, 2);
+
+    announces.Pump(start + std::chrono::milliseconds(1500));
+
+    ASSERT_EQ(Sent(session), (std::vector<lt::info_hash_t>{ Hash('a'), Hash('c') }));
+    EXPECT_TRUE(session.m_reannounced[1].second);
+
+    announces.Pump(start + std::chrono::milliseconds(2500));
+
+    EXPECT_EQ(Sent(session), (std::vector<lt::info_hash_t>{ Hash('a'), Hash('c'), Hash('b') }));
+    EXPECT_EQ(announces.GetStats().queued, 0);
+}
+
+TEST(AnnounceSchedulerTests, Reannounce_PerHost_HasItsOwnBudget)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    AnnounceScheduler announces(io, session, AnnounceSchedulerOptions{ .rate = 1, .burst = 1 });
+
+    Add(session, Hash('a'), "udp://a.example.org/announce");
+    Add(session, Hash('b'), "https://b.example.org/announce");
+
+    EXPECT_TRUE(announces.Reannounce(Hash('a')));
+    EXPECT_TRUE(announces.Reannounce(Hash('b')));
+
+    EXPECT_EQ(Sent(session), (std::vector<lt::info_hash_t>{ Hash('a'), Hash('b') }));
+}
+
+TEST(AnnounceSchedulerTests, Reannounce_WhileQueued_IsCoalesced)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    AnnounceScheduler announces(io, session, AnnounceSchedulerOptions{ .rate = 1, .burst = 1 });
+
+    Add(session, Hash('a'));
+    Add(session, Hash('b'));
+    Add(session, Hash('c'));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    announces.Reannounce(Hash('a'));
+    announces.Reannounce(Hash('b'), 0);
+    announces.Reannounce(Hash('c'), 1);
+    // Raises b above c, and is not sent twice.
+    announces.Reannounce(Hash('b'), 2);
+
+    EXPECT_EQ(announces.GetStats().queued, 2);
+    EXPECT_EQ(announces.GetStats().coalesced, 1);
+
+    announces.Pump(start + std::chrono::milliseconds(1500));
+
+    EXPECT_EQ(Sent(session), (std::vector<lt::info_hash_t>{ Hash('a'), Hash('b') }));
+}
+
+TEST(AnnounceSchedulerTests, PeriodicAnnounce_TakesBudgetAndAnswersQueued)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    AnnounceScheduler announces(io, session, AnnounceSchedulerOptions{ .rate = 1, .burst = 1 });
+
+    // Announces from the session carry an invalid handle in tests, whose hash is empty.
+    const lt::info_hash_t periodic;
+
+    Add(session, periodic);
+    Add(session, Hash('a'));
+
+    session.m_trackerAnnounce(ISession::TrackerAnnounce{ .kind = ISession::TrackerAnnounce::Sent, .url = "udp://tracker.example.org:1337/announce" });
+
+    EXPECT_TRUE(announces.Reannounce(Hash('a')));
+    EXPECT_TRUE(Sent(session).empty());
+
+    EXPECT_TRUE(announces.Reannounce(periodic));
+    session.m_trackerAnnounce(ISession::TrackerAnnounce{ .kind = ISession::TrackerAnnounce::Sent, .url = "udp://tracker.example.org:1337/announce" });
+
+    const auto stats = announces.GetStats();
+
+    EXPECT_EQ(stats.periodic, 2);
+    EXPECT_EQ(stats.coalesced, 1);
+    EXPECT_EQ(stats.queued, 1);
+}
+
+TEST(AnnounceSchedulerTests, Reannounce_WithFullQueue_DropsLowestPriority)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    AnnounceScheduler announces(io, session, AnnounceSchedulerOptions{ .rate = 1, .burst = 1, .max_queued = 1 });
+
+    Add(session, Hash('a'));
+    Add(session, Hash('b'));
+    Add(session, Hash('c'));
+    Add(session, Hash('d'));
+
+    announces.Reannounce(Hash('a'));
+
+    EXPECT_TRUE(announces.Reannounce(Hash('b'), 1));
+    EXPECT_FALSE(announces.Reannounce(Hash('c'), 0));
+    EXPECT_TRUE(announces.Reannounce(Hash('d'), 2));
+
+    EXPECT_EQ(announces.GetStats().queued, 1);
+    EXPECT_EQ(announces.GetStats().dropped, 2);
+}
+
+TEST(AnnounceSchedulerTests, Reannounce_WithUnknownTorrent_ReturnsFalse)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    AnnounceScheduler announces(io, session);
+
+    EXPECT_FALSE(announces.Reannounce(Hash('a')));
+    EXPECT_TRUE(session.m_reannounced.empty());
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "inmemorysession.hpp"
+
+#include "../src/changefeed.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::ChangeFeed;
+using porla::ChangeFeedOptions;
+
+static lt::info_hash_t Hash(char id)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+}
+
+TEST(ChangeFeedTests, Replay_ResumesFromAnOffset)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+
+    ChangeFeed feed(io, session, ChangeFeedOptions{ .retain = 2, .snapshot_interval = std::chrono::milliseconds(0) });
+
+    const auto first = feed.Next();
+
+    session.m_torrentRemoved(Hash('a'));
+    session.m_torrentRemoved(Hash('b'));
+
+    std::vector<nlohmann::json> records;
+    EXPECT_TRUE(feed.Replay(first + 1, [&](const std::string& line) { records.push_back(nlohmann::json::parse(line)); }));
+
+    ASSERT_EQ(records.size(), 1);
+    EXPECT_EQ(records[0]["offset"], first + 1);
+    EXPECT_EQ(records[0]["type"], "removed");
+
+    // Only the last two are kept.
+    session.m_torrentRemoved(Hash('c'));
+    EXPECT_FALSE(feed.Replay(first, [](const std::string&) {}));
+}
+
+TEST(ChangeFeedTests, Append_RotatesFilesBySize)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+
+    const auto dir = fs::temp_directory_path() / "porla-changefeed-test";
+    fs::remove_all(dir);
+
+    {
+        ChangeFeed feed(io, session, ChangeFeedOptions{
+            .dir               = dir,
+            .file_size         = 1,
+            .max_files         = 2,
+            .snapshot_interval = std::chrono::milliseconds(0)
+        });
+
+        session.m_torrentRemoved(Hash('a'));
+        session.m_torrentRemoved(Hash('b'));
+        session.m_torrentRemoved(Hash('c'));
+    }
+
+    std::size_t files = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) files++;
+
+    EXPECT_EQ(files, 2);
+
+    fs::remove_all(dir);
+}
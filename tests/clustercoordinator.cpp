@@ -0,0 +1,22 @@
+#include <gtest/gtest.h>
+
+#include "../src/clustercoordinator.hpp"
+
+using porla::ClusterCoordinator;
+
+TEST(ClusterCoordinatorTests, MergeSorted_MergesPagesAndSkipsFailedNodes)
+{
+    const std::vector<ClusterCoordinator::Reply> pages = {
+        { .node = "a", .result = {{"torrents", {{{"info_hash", "a1"}, {"size", 1}}, {{"info_hash", "a2"}, {"size", 5}}}}} },
+        { .node = "b", .result = {{"torrents", {{{"info_hash", "b1"}, {"size", 3}}}}} },
+        { .node = "c", .error = "Timed out" }
+    };
+
+    const auto merged = ClusterCoordinator::MergeSorted(pages, "torrents", "size", true, 1, 5);
+
+    ASSERT_EQ(merged.size(), 2);
+    EXPECT_EQ(merged[0]["info_hash"], "b1");
+    EXPECT_EQ(merged[0]["node"], "b");
+    EXPECT_EQ(merged[1]["info_hash"], "a1");
+    EXPECT_EQ(merged[1]["node"], "a");
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "inmemorysession.hpp"
+
+#include "../src/contentindex.hpp"
+
+namespace lt = libtorrent;
+
+using porla::ContentIndex;
+
+static lt::info_hash_t Hash(char id)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+}
+
+TEST(ContentIndexTests, Find_RanksByBytesInCommon)
+{
+    InMemorySession session;
+    ContentIndex index(session);
+
+    lt::file_storage full;
+    full.add_file("Show/e01.mkv", 1000);
+    full.add_file("Show/e02.mkv", 2000);
+
+    lt::file_storage partial;
+    partial.add_file("Other/e01.mkv", 1000);
+
+    index.Update(Hash('a'), full);
+    index.Update(Hash('b'), partial);
+
+    // Directories are not compared, and sizes must be equal.
+    lt::file_storage query;
+    query.add_file("Renamed/e01.mkv", 1000);
+    query.add_file("Renamed/e02.mkv", 2000);
+    query.add_file("Renamed/e03.mkv", 3000);
+
+    const auto matches = index.Find(query);
+
+    ASSERT_EQ(matches.size(), 2);
+    EXPECT_EQ(matches[0].info_hash, Hash('a'));
+    EXPECT_EQ(matches[0].files, 2);
+    EXPECT_EQ(matches[0].bytes, 3000);
+    EXPECT_EQ(matches[1].info_hash, Hash('b'));
+
+    index.Remove(Hash('a'));
+
+    EXPECT_EQ(index.Find(query).size(), 1);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+#include <sqlite3.h>
+
+#include "../../src/data/backup.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Data::Backup;
+
+class BackupTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_dir = fs::temp_directory_path() / ("porla-backup-" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        fs::create_directories(m_dir);
+
+        ASSERT_EQ(sqlite3_open((m_dir / "source.sqlite").c_str(), &m_db), SQLITE_OK);
+        sqlite3_exec(m_db, "PRAGMA journal_mode=wal; CREATE TABLE items (value TEXT);", nullptr, nullptr, nullptr);
+
+        sqlite3_exec(m_db, "BEGIN;", nullptr, nullptr, nullptr);
+        for (int i = 0; i < 20000; i++)
+        {
+            sqlite3_exec(m_db, "INSERT INTO items (value) VALUES (hex(randomblob(64)));", nullptr, nullptr, nullptr);
+        }
+        sqlite3_exec(m_db, "COMMIT;", nullptr, nullptr, nullptr);
+    }
+
+    void TearDown() override
+    {
+        sqlite3_close(m_db);
+        fs::remove_all(m_dir);
+    }
+
+    static int Count(const fs::path& path)
+    {
+        sqlite3* db;
+        int count = -1;
+
+        sqlite3_open(path.c_str(), &db);
+        sqlite3_exec(
+            db,
+            "SELECT COUNT(*) FROM items;",
+            [](void* user, int, char** values, char**) { *static_cast<int*>(user) = std::stoi(values[0]); return 0; },
+            &count,
+            nullptr);
+        sqlite3_close(db);
+
+        return count;
+    }
+
+    fs::path m_dir;
+    sqlite3* m_db = nullptr;
+};
+
+TEST_F(BackupTest, Run_WithWritesBetweenSteps_CopiesSnapshot)
+{
+    int steps = 0;
+
+    const auto error = Backup::Run(
+        (m_dir / "source.sqlite").string(),
+        (m_dir / "backup.sqlite").string(),
+        [&](int, int)
+        {
+            // Commits from another connection do not end up in, or restart, the backup.
+            sqlite3_exec(m_db, "INSERT INTO items (value) VALUES ('later');", nullptr, nullptr, nullptr);
+            steps++;
+            return true;
+        });
+
+    EXPECT_EQ(error, std::nullopt);
+    EXPECT_GT(steps, 1);
+    EXPECT_EQ(Count(m_dir / "backup.sqlite"), 20000);
+    EXPECT_FALSE(fs::exists(m_dir / "backup.sqlite.tmp"));
+}
+
+TEST_F(BackupTest, Run_WhenCancelled_LeavesNoFile)
+{
+    const auto error = Backup::Run(
+        (m_dir / "source.sqlite").string(),
+        (m_dir / "backup.sqlite").string(),
+        [](int, int) { return false; });
+
+    EXPECT_TRUE(error.has_value());
+    EXPECT_FALSE(fs::exists(m_dir / "backup.sqlite"));
+    EXPECT_FALSE(fs::exists(m_dir / "backup.sqlite.tmp"));
+}
+
+TEST_F(BackupTest, Start_WhenRunning_ReturnsFalse)
+{
+    Backup backup((m_dir / "source.sqlite").string());
+
+    EXPECT_TRUE(backup.Start((m_dir / "backup.sqlite").string()));
+    EXPECT_FALSE(backup.Start((m_dir / "other.sqlite").string()));
+
+    while (backup.Status().state == porla::Data::BackupStatus::State::Running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    EXPECT_EQ(backup.Status().state, porla::Data::BackupStatus::State::Done);
+    EXPECT_EQ(Count(m_dir / "backup.sqlite"), 20000);
+}
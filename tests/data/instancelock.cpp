@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include <sqlite3.h>
+
+#include "../../src/data/instancelock.hpp"
+#include "../../src/data/migrate.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Data::InstanceLock;
+
+class InstanceLockTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_dir = fs::temp_directory_path() / ("porla-instancelock-" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        fs::create_directories(m_dir);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(m_dir);
+    }
+
+    fs::path m_dir;
+};
+
+TEST_F(InstanceLockTest, SecondLock_Throws)
+{
+    InstanceLock lock(m_dir / "porla.sqlite");
+
+    EXPECT_TRUE(fs::exists(InstanceLock::LockFile(m_dir / "porla.sqlite")));
+    EXPECT_THROW(InstanceLock(m_dir / "porla.sqlite"), std::runtime_error);
+}
+
+TEST_F(InstanceLockTest, Released_CanBeTakenAgain)
+{
+    {
+        InstanceLock lock(m_dir / "porla.sqlite");
+    }
+
+    EXPECT_NO_THROW(InstanceLock(m_dir / "porla.sqlite"));
+}
+
+TEST_F(InstanceLockTest, InMemory_TakesNoLock)
+{
+    InstanceLock first(":memory:");
+
+    EXPECT_NO_THROW(InstanceLock(":memory:"));
+}
+
+TEST_F(InstanceLockTest, IsMigrated_OnlyAfterMigrate)
+{
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open((m_dir / "porla.sqlite").c_str(), &db), SQLITE_OK);
+
+    EXPECT_FALSE(porla::Data::IsMigrated(db));
+    ASSERT_TRUE(porla::Data::Migrate(db));
+    EXPECT_TRUE(porla::Data::IsMigrated(db));
+
+    sqlite3_close(db);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <sqlite3.h>
+
+#include "../../src/data/readerpool.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Data::ReaderPool;
+
+class ReaderPoolTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_dir = fs::temp_directory_path() / ("porla-readerpool-" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        fs::create_directories(m_dir);
+
+        ASSERT_EQ(sqlite3_open((m_dir / "db.sqlite").c_str(), &m_db), SQLITE_OK);
+        sqlite3_exec(m_db, "PRAGMA journal_mode=wal; CREATE TABLE items (value INTEGER); INSERT INTO items VALUES (1);", nullptr, nullptr, nullptr);
+    }
+
+    void TearDown() override
+    {
+        sqlite3_close(m_db);
+        fs::remove_all(m_dir);
+    }
+
+    static int Count(sqlite3* db)
+    {
+        int count = -1;
+
+        sqlite3_exec(
+            db,
+            "SELECT COUNT(*) FROM items;",
+            [](void* user, int, char** values, char**) { *static_cast<int*>(user) = std::stoi(values[0]); return 0; },
+            &count,
+            nullptr);
+
+        return count;
+    }
+
+    fs::path m_dir;
+    sqlite3* m_db = nullptr;
+};
+
+TEST_F(ReaderPoolTest, Acquire_InWalMode_ReadsWithoutBlockingWriter)
+{
+    ReaderPool pool(m_db, {}, 1);
+    ASSERT_EQ(pool.Size(), 1);
+
+    {
+        const auto reader = pool.Acquire();
+
+        sqlite3_exec(reader.Get(), "BEGIN;", nullptr, nullptr, nullptr);
+        EXPECT_EQ(Count(reader.Get()), 1);
+
+        // The open read transaction keeps its snapshot while the writer commits.
+        EXPECT_EQ(sqlite3_exec(m_db, "INSERT INTO items VALUES (2);", nullptr, nullptr, nullptr), SQLITE_OK);
+        EXPECT_EQ(Count(reader.Get()), 1);
+
+        sqlite3_exec(reader.Get(), "COMMIT;", nullptr, nullptr, nullptr);
+        EXPECT_EQ(Count(reader.Get()), 2);
+
+        EXPECT_NE(sqlite3_exec(reader.Get(), "INSERT INTO items VALUES (3);", nullptr, nullptr, nullptr), SQLITE_OK);
+    }
+}
+
+TEST_F(ReaderPoolTest, Acquire_WhenAllLeased_WaitsForRelease)
+{
+    ReaderPool pool(m_db, {}, 1);
+    std::atomic<bool> acquired = false;
+
+    auto lease = std::make_unique<ReaderPool::Lease>(pool.Acquire());
+
+    std::thread waiter([&pool, &acquired]()
+    {
+        const auto reader = pool.Acquire();
+        acquired = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(acquired);
+
+    lease.reset();
+    waiter.join();
+
+    EXPECT_TRUE(acquired);
+    EXPECT_EQ(pool.GetStats().acquired, 2);
+    EXPECT_EQ(pool.GetStats().waited, 1);
+}
+
+TEST(ReaderPool, Constructor_InMemoryDatabase_HasNoReaders)
+{
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(":memory:", &db), SQLITE_OK);
+
+    ReaderPool pool(db, {});
+    EXPECT_EQ(pool.Size(), 0);
+
+    sqlite3_close(db);
+}
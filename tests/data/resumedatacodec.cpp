@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "../../src/data/resumedatacodec.hpp"
+
+using porla::Data::ResumeDataCodec;
+using porla::Data::ResumeDataEncoding;
+
+static std::vector<char> ResumeFile()
+{
+    const std::string data =
+        "d11:file-format22:libtorrent resume file12:file-versioni1e"
+        "10:added_timei1600000000e4:name8:Synthetic9:save_path10:/downloads"
+        "6:pieces" + std::string(4096, '\x01') + "e";
+
+    return { data.begin(), data.end() };
+}
+
+TEST(ResumeDataCodecTests, Compress_RoundTripsThroughDecompress)
+{
+    const auto data = ResumeFile();
+    const auto compressed = ResumeDataCodec::Compress(data);
+
+    std::vector<char> out;
+
+    EXPECT_LT(compressed.size(), data.size());
+    EXPECT_TRUE(ResumeDataCodec::Decompress(ResumeDataEncoding::DeflateV1, compressed, out));
+    EXPECT_EQ(out, data);
+}
+
+TEST(ResumeDataCodecTests, Decompress_WithNoEncoding_ReturnsInput)
+{
+    const auto data = ResumeFile();
+
+    std::vector<char> out;
+
+    EXPECT_TRUE(ResumeDataCodec::Decompress(ResumeDataEncoding::None, data, out));
+    EXPECT_EQ(out, data);
+}
+
+TEST(ResumeDataCodecTests, Decompress_WithTruncatedData_Fails)
+{
+    auto compressed = ResumeDataCodec::Compress(ResumeFile());
+    compressed.resize(compressed.size() / 2);
+
+    std::vector<char> out;
+
+    EXPECT_FALSE(ResumeDataCodec::Decompress(ResumeDataEncoding::DeflateV1, compressed, out));
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "../../src/data/migrate.hpp"
+#include "../../src/data/models/addtorrentparams.hpp"
+#include "../../src/data/statement.hpp"
+#include "../../src/data/statesnapshot.hpp"
+#include "../../src/torrentclientdata.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::Data::Models::AddTorrentParams;
+using porla::Data::StateSnapshot;
+
+class StateSnapshotTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_dir = fs::temp_directory_path() / ("porla-statesnapshot-" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        fs::create_directories(m_dir);
+
+        ASSERT_EQ(sqlite3_open((m_dir / "db.sqlite").c_str(), &m_db), SQLITE_OK);
+        ASSERT_TRUE(porla::Data::Migrate(m_db));
+    }
+
+    void TearDown() override
+    {
+        porla::Data::Statement::ClearCache(m_db);
+        sqlite3_close(m_db);
+        fs::remove_all(m_dir);
+    }
+
+    static lt::info_hash_t Hash(char c)
+    {
+        return lt::info_hash_t(lt::sha1_hash(std::string(20, c).c_str()));
+    }
+
+    AddTorrentParams Torrent(char c, int queue_position)
+    {
+        lt::add_torrent_params params;
+        params.info_hashes = Hash(c);
+        params.name        = std::string("torrent-") + c;
+        params.save_path   = "/downloads";
+
+        return AddTorrentParams{
+            .client_data    = &m_clientData,
+            .name           = params.name,
+            .params         = std::move(params),
+            .queue_position = queue_position,
+            .save_path      = "/downloads"
+        };
+    }
+
+    std::vector<AddTorrentParams::Row> Load(std::optional<StateSnapshot::LoadStats>& stats)
+    {
+        std::vector<AddTorrentParams::Row> rows;
+        stats = StateSnapshot::ForEachRow(m_db, m_dir / "state", [&rows](AddTorrentParams::Row&& row) { rows.push_back(std::move(row)); });
+        return rows;
+    }
+
+    fs::path m_dir;
+    sqlite3* m_db = nullptr;
+    porla::TorrentClientData m_clientData;
+};
+
+TEST_F(StateSnapshotTest, ForEachRow_ReadsChangedRowsFromDatabase)
+{
+    AddTorrentParams::Insert(m_db, Hash('a'), Torrent('a', 0));
+    AddTorrentParams::Insert(m_db, Hash('b'), Torrent('b', 1));
+    AddTorrentParams::Insert(m_db, Hash('c'), Torrent('c', 2));
+
+    ASSERT_FALSE(StateSnapshot::Write(m_db, m_dir / "state").has_value());
+
+    auto changed = Torrent('b', 1);
+    changed.save_path = "/elsewhere";
+
+    AddTorrentParams::Update(m_db, Hash('b'), changed);
+    AddTorrentParams::Remove(m_db, Hash('c'));
+    AddTorrentParams::Insert(m_db, Hash('d'), Torrent('d', 3));
+
+    std::optional<StateSnapshot::LoadStats> stats;
+    const auto rows = Load(stats);
+
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->snapshot, 1);
+    EXPECT_EQ(stats->database, 2);
+
+    ASSERT_EQ(rows.size(), 3);
+    EXPECT_EQ(rows[0].info_hash, Hash('a'));
+    EXPECT_EQ(rows[0].name, "torrent-a");
+    EXPECT_EQ(rows[1].info_hash, Hash('b'));
+    EXPECT_EQ(rows[1].save_path, "/elsewhere");
+    EXPECT_EQ(rows[2].info_hash, Hash('d'));
+
+    lt::add_torrent_params params;
+    EXPECT_TRUE(AddTorrentParams::Decode(rows[0], params));
+    EXPECT_EQ(params.info_hashes, Hash('a'));
+}
+
+TEST_F(StateSnapshotTest, ForEachRow_IgnoresDamagedFile)
+{
+    AddTorrentParams::Insert(m_db, Hash('a'), Torrent('a', 0));
+
+    ASSERT_FALSE(StateSnapshot::Write(m_db, m_dir / "state").has_value());
+
+    // Flips a byte of the record, as a torn write would.
+    {
+        std::fstream file(m_dir / "state", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(StateSnapshot::Header) + 4);
+        file.put('x');
+    }
+
+    std::optional<StateSnapshot::LoadStats> stats;
+    const auto rows = Load(stats);
+
+    EXPECT_FALSE(stats.has_value());
+    EXPECT_TRUE(rows.empty());
+}
+
+TEST_F(StateSnapshotTest, ForEachRow_WithoutFile_ReturnsEmpty)
+{
+    std::optional<StateSnapshot::LoadStats> stats;
+    Load(stats);
+
+    EXPECT_FALSE(stats.has_value());
+}
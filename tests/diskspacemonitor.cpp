@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+#include "inmemorysession.hpp"
+
+#include "../src/diskspacemonitor.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::DiskSpaceMonitor;
+
+class DiskSpaceMonitorTests : public ::testing::Test
+{
+protected:
+    void AddTorrent(char id, const std::string& save_path)
+    {
+        lt::torrent_status ts;
+        ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+        ts.save_path = save_path;
+        session.m_statuses.insert({ ts.info_hashes, ts });
+    }
+
+    std::vector<DiskSpaceMonitor::Volume> Run(std::uint64_t low, std::uint64_t critical)
+    {
+        DiskSpaceMonitor monitor(io, session, porla::DiskSpaceMonitorOptions{
+            .interval       = std::chrono::milliseconds(10),
+            .low_bytes      = low,
+            .critical_bytes = critical
+        });
+
+        std::vector<DiskSpaceMonitor::Volume> changes;
+        monitor.OnLevelChanged([&changes](const auto& volume) { changes.push_back(volume); });
+
+        io.run_for(std::chrono::milliseconds(100));
+
+        return changes;
+    }
+
+    boost::asio::io_context io;
+    InMemorySession session;
+};
+
+TEST_F(DiskSpaceMonitorTests, Sample_BelowThreshold_SignalsOnce)
+{
+    AddTorrent('a', fs::temp_directory_path().string());
+
+    const auto changes = Run(std::numeric_limits<std::uint64_t>::max(), std::numeric_limits<std::uint64_t>::max() / 2);
+
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].level, DiskSpaceMonitor::Level::Critical);
+    EXPECT_EQ(changes[0].previous, DiskSpaceMonitor::Level::Ok);
+}
+
+TEST_F(DiskSpaceMonitorTests, Sample_WithSpace_DoesNotSignal)
+{
+    AddTorrent('a', fs::temp_directory_path().string());
+
+    EXPECT_TRUE(Run(1, 0).empty());
+}
+
+TEST_F(DiskSpaceMonitorTests, Sample_MissingSavePath_IsMeasuredOnItsParent)
+{
+    const auto tmp = fs::temp_directory_path();
+
+    AddTorrent('a', tmp.string());
+    AddTorrent('b', (tmp / "porla-missing" / "downloads").string());
+
+    const auto changes = Run(std::numeric_limits<std::uint64_t>::max(), 0);
+
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].level, DiskSpaceMonitor::Level::Low);
+    EXPECT_EQ(changes[0].paths.size(), 2);
+}
@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libtorrent/hex.hpp>
+#include <nlohmann/json.hpp>
+
+#include "allocations.hpp"
+#include "inmemorysession.hpp"
+#include "../src/httpeventstream.hpp"
+
+namespace lt = libtorrent;
+
+using json = nlohmann::json;
+using porla::HttpEventStream;
+
+// Completes every write right away, on an io context of its own, so what the stream does
+// to hand events to its clients is kept apart from the writes themselves.
+class NullSink : public HttpEventStream::Sink
+{
+public:
+    explicit NullSink(boost::asio::io_context& io)
+        : m_io(io)
+    {
+    }
+
+    boost::asio::any_io_executor Executor() override
+    {
+        return m_io.get_executor();
+    }
+
+    void Write(
+        std::vector<std::shared_ptr<const std::string>> events,
+        std::function<void(boost::system::error_code, std::size_t)> done) override
+    {
+        std::size_t bytes = 0;
+        for (const auto& evt : events) bytes += evt->size();
+
+        done({}, bytes);
+    }
+
+    void Close() override {}
+
+private:
+    boost::asio::io_context& m_io;
+};
+
+// Keeps the name and data of every event written to it.
+class RecordingSink : public NullSink
+{
+public:
+    using NullSink::NullSink;
+
+    void Write(
+        std::vector<std::shared_ptr<const std::string>> events,
+        std::function<void(boost::system::error_code, std::size_t)> done) override
+    {
+        for (const auto& evt : events)
+        {
+            const auto name = evt->find("event: ");
+            const auto data = evt->find("data: ");
+
+            if (name == std::string::npos || data == std::string::npos) continue;
+
+            m_events.emplace_back(
+                evt->substr(name + 7, evt->find('\n', name) - name - 7),
+                json::parse(evt->substr(data + 6)));
+        }
+
+        NullSink::Write(std::move(events), std::move(done));
+    }
+
+    std::vector<std::pair<std::string, json>> m_events;
+};
+
+struct PublishCost
+{
+    std::uint64_t bytes;
+    std::uint64_t count;
+};
+
+static PublishCost Publish(int clients, const std::string& payload)
+{
+    boost::asio::io_context io;
+    boost::asio::io_context sinks;
+
+    InMemorySession session;
+    HttpEventStream stream(io, session, porla::HttpEventStreamOptions{ .heartbeat_interval = 0 });
+
+    std::vector<std::shared_ptr<void>> subscriptions;
+
+    for (int i = 0; i < clients; i++)
+    {
+        subscriptions.push_back(stream.Subscribe(std::make_shared<NullSink>(sinks), {}));
+    }
+
+    // Once to get the hello events and the replay buffer out of the way.
+    stream.Publish("disk_space", payload);
+    sinks.run();
+    sinks.restart();
+
+    porla::Tests::AllocationScope allocations;
+    stream.Publish("disk_space", payload);
+
+    const PublishCost cost{ .bytes = allocations.Bytes(), .count = allocations.Count() };
+
+    sinks.run();
+
+    return cost;
+}
+
+TEST(HttpEventStreamTests, Publish_FormatsPayloadOnceForAllClients)
+{
+    // What handing an event to one more client may cost, which is its share of the post
+    // to the client's executor, and never a copy of the event.
+    static constexpr std::uint64_t PerClientAllocations = 4;
+    static constexpr std::uint64_t PerClientBytes       = 1024;
+
+    const std::string payload(256 * 1024, 'x');
+
+    const auto one  = Publish(1, payload);
+    const auto many = Publish(64, payload);
+
+    EXPECT_GE(one.bytes, payload.size());
+    EXPECT_LE(many.bytes, one.bytes + 63 * PerClientBytes);
+    EXPECT_LE(many.count, one.count + 63 * PerClientAllocations);
+}
+
+TEST(HttpEventStreamTests, Peers_SendsAllPeersThenDiffs)
+{
+    const auto peer = [](const std::string& ip, int down_speed)
+    {
+        lt::peer_info pi;
+        pi.ip = lt::tcp::endpoint(lt::make_address(ip), 6881);
+        pi.down_speed = down_speed;
+        return pi;
+    };
+
+    boost::asio::io_context io;
+    boost::asio::io_context sinks;
+
+    const lt::info_hash_t hash(lt::sha1_hash(std::string(20, 'a').c_str()));
+
+    InMemorySession session;
+    session.m_peers[hash] = { peer("10.0.0.1", 100), peer("10.0.0.2", 200) };
+
+    HttpEventStream stream(io, session, porla::HttpEventStreamOptions{
+        .heartbeat_interval = 0,
+        .peers_interval     = 1
+    });
+
+    auto sink = std::make_shared<RecordingSink>(sinks);
+    auto subscription = stream.Subscribe(sink, {
+        { "events", "none" },
+        { "peers",  lt::aux::to_hex(hash.v1) }
+    });
+
+    sinks.run();
+
+    ASSERT_EQ(sink->m_events.size(), 2);
+    EXPECT_EQ(sink->m_events[1].first, "peers");
+    EXPECT_EQ(sink->m_events[1].second["peers"].size(), 2);
+
+    session.m_peers[hash] = { peer("10.0.0.1", 150), peer("10.0.0.3", 0) };
+
+    io.run_one();
+    sinks.restart();
+    sinks.run();
+
+    ASSERT_EQ(sink->m_events.size(), 3);
+    EXPECT_EQ(sink->m_events[2].first, "peers_diff");
+
+    const auto& diff = sink->m_events[2].second;
+
+    ASSERT_EQ(diff["joined"].size(), 1);
+    EXPECT_EQ(diff["joined"][0]["ip"][0], "10.0.0.3");
+    ASSERT_EQ(diff["left"].size(), 1);
+    EXPECT_EQ(diff["left"][0][0], "10.0.0.2");
+    ASSERT_EQ(diff["changed"].size(), 1);
+    EXPECT_EQ(diff["changed"][0].size(), 2);
+    EXPECT_EQ(diff["changed"][0]["down_speed"], 150);
+
+    // Sampling stops with the last subscriber.
+    subscription.reset();
+
+    io.run_one();
+
+    EXPECT_EQ(io.run_one(), 0);
+}
+
+TEST(HttpEventStreamTests, Lifecycle_SentOnlyToClientsAskingForIt)
+{
+    boost::asio::io_context io;
+    boost::asio::io_context sinks;
+
+    const lt::info_hash_t a(lt::sha1_hash(std::string(20, 'a').c_str()));
+    const lt::info_hash_t b(lt::sha1_hash(std::string(20, 'b').c_str()));
+
+    InMemorySession session;
+    HttpEventStream stream(io, session, porla::HttpEventStreamOptions{ .heartbeat_interval = 0 });
+
+    auto everything = std::make_shared<RecordingSink>(sinks);
+    auto batched    = std::make_shared<RecordingSink>(sinks);
+    auto filtered   = std::make_shared<RecordingSink>(sinks);
+
+    auto s1 = stream.Subscribe(everything, {});
+    auto s2 = stream.Subscribe(batched, { { "events", "torrents_lifecycle" } });
+    auto s3 = stream.Subscribe(filtered, {
+        { "events",      "torrents_lifecycle" },
+        { "info_hashes", lt::aux::to_hex(b.v1) }
+    });
+
+    sinks.run();
+    sinks.restart();
+
+    everything->m_events.clear();
+    batched->m_events.clear();
+    filtered->m_events.clear();
+
+    lt::torrent_status finished;
+    finished.info_hashes = a;
+
+    session.m_torrentLifecycle(porla::TorrentLifecycle{
+        .finished = { finished },
+        .removed  = { a, b }
+    });
+
+    sinks.run();
+
+    EXPECT_TRUE(everything->m_events.empty());
+
+    ASSERT_EQ(batched->m_events.size(), 1);
+    EXPECT_EQ(batched->m_events[0].first, "torrents_lifecycle");
+    EXPECT_EQ(batched->m_events[0].second["finished"].size(), 1);
+    EXPECT_EQ(batched->m_events[0].second["removed"].size(), 2);
+    EXPECT_TRUE(batched->m_events[0].second["paused"].empty());
+
+    ASSERT_EQ(filtered->m_events.size(), 1);
+    EXPECT_TRUE(filtered->m_events[0].second["finished"].empty());
+    ASSERT_EQ(filtered->m_events[0].second["removed"].size(), 1);
+}
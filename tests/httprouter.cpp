@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "../src/httprouter.hpp"
+
+using porla::HttpRouter;
+
+class RouterContext : public porla::HttpContext
+{
+public:
+    RouterContext(boost::beast::http::verb verb, std::string path)
+        : m_stream(m_io)
+    {
+        m_req.method(verb);
+        m_uri.path = std::move(path);
+    }
+
+    void Next() override { next = true; }
+
+    boost::beast::http::request<boost::beast::http::string_body>& Request() override { return m_req; }
+    Uri& RequestUri() override { return m_uri; }
+    boost::beast::tcp_stream& Stream() override { return m_stream; }
+
+    void Write(std::string) override {}
+    void Write(boost::beast::http::response<boost::beast::http::file_body>) override {}
+    void Write(boost::beast::http::response<boost::beast::http::string_body>) override {}
+    void WriteJson(const nlohmann::json&) override {}
+    void WriteChunked(const std::string&, std::function<bool(std::string&)>) override {}
+
+    bool next = false;
+
+private:
+    boost::asio::io_context m_io;
+    boost::beast::http::request<boost::beast::http::string_body> m_req;
+    Uri m_uri;
+    boost::beast::tcp_stream m_stream;
+};
+
+static std::string Route(const HttpRouter& router, boost::beast::http::verb verb, const std::string& path)
+{
+    auto ctx = std::make_shared<RouterContext>(verb, path);
+
+    // The routes write their name into the request body.
+    router(ctx);
+
+    return ctx->next ? "next" : ctx->Request().body();
+}
+
+static porla::HttpMiddleware Named(const std::string& name)
+{
+    return [name](const std::shared_ptr<porla::HttpContext>& ctx) { ctx->Request().body() = name; };
+}
+
+TEST(HttpRouterTests, Route_MatchesExactPathsAndMethods)
+{
+    HttpRouter router;
+    router.Get("/api/v1/system", Named("system"));
+    router.Post("/api/v1/jsonrpc", Named("rpc"));
+
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/api/v1/system"), "system");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::post, "/api/v1/jsonrpc"), "rpc");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/api/v1/jsonrpc"), "next");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/api/v1/other"), "next");
+}
+
+TEST(HttpRouterTests, Route_PicksTheLongestPrefix)
+{
+    HttpRouter router;
+    router.Prefix("/", Named("root"));
+    router.Prefix("/ui/", Named("ui"));
+    router.Get("/ui/exact", Named("exact"));
+
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/ui/exact"), "exact");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/ui/assets/index.js"), "ui");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/ui"), "ui");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, "/other"), "root");
+    EXPECT_EQ(Route(router, boost::beast::http::verb::get, ""), "root");
+}
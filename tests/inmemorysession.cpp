@@ -7,30 +7,75 @@ libtorrent::info_hash_t InMemorySession::AddTorrent(const libtorrent::add_torren
 
 void InMemorySession::ApplySettings(const libtorrent::settings_pack &settings)
 {
+    for (int i = lt::settings_pack::int_type_base; i < lt::settings_pack::max_int_setting_internal; i++)
+    {
+        if (settings.has_val(i)) m_settings.set_int(i, settings.get_int(i));
+    }
+}
+
+bool InMemorySession::JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join)
+{
+    if (!m_peerClasses.contains(name))
+    {
+        return false;
+    }
+
+    if (join) m_joined.insert({ hash, name });
+    else      m_joined.erase({ hash, name });
+
+    return true;
 }
 
 void InMemorySession::Pause()
 {
 }
 
+void InMemorySession::PeerInfo(const lt::info_hash_t& hash, PeerInfoCallback done)
+{
+    const auto peers = m_peers.find(hash);
+    done(peers == m_peers.end() ? nullptr : std::make_shared<std::vector<lt::peer_info>>(peers->second));
+}
+
+void InMemorySession::Reannounce(const lt::info_hash_t& hash, bool ignore_min_interval)
+{
+    m_reannounced.emplace_back(hash, ignore_min_interval);
+}
+
 void InMemorySession::Recheck(const lt::info_hash_t &hash)
 {
 }
 
 void InMemorySession::Remove(const lt::info_hash_t &hash, bool remove_data)
 {
+    m_removed.emplace_back(hash, remove_data);
+}
+
+bool InMemorySession::RemovePeerClass(const std::string& name)
+{
+    return m_peerClasses.erase(name) > 0;
 }
 
 void InMemorySession::Resume()
 {
 }
 
+void InMemorySession::SetPeerClass(const porla::PeerClass& peer_class)
+{
+    m_peerClasses.insert_or_assign(peer_class.name, peer_class);
+}
+
 libtorrent::settings_pack InMemorySession::Settings()
 {
-    return {};
+    return m_settings;
 }
 
-const std::map<lt::info_hash_t, lt::torrent_handle> &InMemorySession::Torrents()
+const porla::TorrentHandles& InMemorySession::Torrents()
 {
     return m_torrents;
 }
+
+
+const std::map<lt::info_hash_t, lt::torrent_status> &InMemorySession::TorrentStatuses()
+{
+    return m_statuses;
+}
@@ -1,91 +1,138 @@
 #pragma once
 
+#include <set>
+
+#include "../src/peerclass.hpp"
 #include "../src/session.hpp"
 
 class InMemorySession : public porla::ISession
 {
 public:
-    boost::signals2::connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnClientDataChanged(const InfoHashListSignal::slot_type& subscriber) override
+    {
+        return m_clientDataChanged.connect(subscriber);
+    }
+
+    porla::Utils::Connection OnSessionStats(const SessionStatsSignal::slot_type& subscriber) override
     {
         return m_sessionStats.connect(subscriber);
     }
 
-    boost::signals2::connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnStateUpdate(const TorrentStatusListSignal::slot_type& subscriber) override
     {
         return m_stateUpdate.connect(subscriber);
     }
 
-    boost::signals2::connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnStorageMoved(const TorrentHandleSignal::slot_type& subscriber) override
     {
         return m_storageMoved.connect(subscriber);
     }
 
-    boost::signals2::connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnStorageMovedFailed(const TorrentHandleSignal::slot_type& subscriber) override
     {
         return m_storageMovedFailed.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentAdded(const TorrentStatusSignal::slot_type& subscriber) override
     {
         return m_torrentAdded.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentChecked(const TorrentHandleSignal::slot_type& subscriber) override
+    {
+        return m_torrentChecked.connect(subscriber);
+    }
+
+    porla::Utils::Connection OnTorrentFinished(const TorrentStatusSignal::slot_type& subscriber) override
     {
         return m_torrentFinished.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentLifecycle(const TorrentLifecycleSignal::slot_type& subscriber) override
+    {
+        return m_torrentLifecycle.connect(subscriber);
+    }
+
+    [[nodiscard]] bool BatchesLifecycle() const override { return true; }
+
+    porla::Utils::Connection OnTorrentMediaInfo(const TorrentHandleSignal::slot_type& subscriber) override
     {
         return m_torrentMediaInfo.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentPaused(const TorrentHandleSignal::slot_type& subscriber) override
     {
         return m_torrentPaused.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentRemoved(const InfoHashSignal::slot_type& subscriber) override
     {
         return m_torrentRemoved.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentResumed(const TorrentStatusSignal::slot_type& subscriber) override
     {
         return m_torrentResumed.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentTrackerError(const TrackerErrorSignal::slot_type& subscriber) override
     {
         return m_torrentTrackerError.connect(subscriber);
     }
 
-    boost::signals2::connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) override
+    porla::Utils::Connection OnTorrentTrackerReply(const TorrentHandleSignal::slot_type& subscriber) override
     {
         return m_torrentTrackerReply.connect(subscriber);
     }
 
+    porla::Utils::Connection OnTrackerAnnounce(const TrackerAnnounceSignal::slot_type& subscriber) override
+    {
+        return m_trackerAnnounce.connect(subscriber);
+    }
+
     libtorrent::info_hash_t AddTorrent(libtorrent::add_torrent_params const& p) override;
     void ApplySettings(const libtorrent::settings_pack& settings) override;
+    bool JoinPeerClass(const lt::info_hash_t& hash, const std::string& name, bool join) override;
     void Pause() override;
+    void PeerInfo(const lt::info_hash_t& hash, PeerInfoCallback done) override;
+    void Reannounce(const lt::info_hash_t& hash, bool ignore_min_interval) override;
     void Recheck(const lt::info_hash_t& hash) override;
     void Remove(const lt::info_hash_t& hash, bool remove_data) override;
+    bool RemovePeerClass(const std::string& name) override;
     void Resume() override;
+    void SetPeerClass(const porla::PeerClass& peer_class) override;
     libtorrent::settings_pack Settings() override;
-    const std::map<lt::info_hash_t, lt::torrent_handle>& Torrents() override;
+    const porla::TorrentHandles& Torrents() override;
+    const std::map<lt::info_hash_t, lt::torrent_status>& TorrentStatuses() override;
 
+    InfoHashListSignal m_clientDataChanged;
     SessionStatsSignal m_sessionStats;
     TorrentStatusListSignal m_stateUpdate;
     TorrentHandleSignal m_storageMoved;
     TorrentHandleSignal m_storageMovedFailed;
     TorrentStatusSignal m_torrentAdded;
+    TorrentHandleSignal m_torrentChecked;
     TorrentStatusSignal m_torrentFinished;
+    TorrentLifecycleSignal m_torrentLifecycle;
     TorrentHandleSignal m_torrentMediaInfo;
     TorrentHandleSignal m_torrentPaused;
     InfoHashSignal m_torrentRemoved;
     TorrentStatusSignal m_torrentResumed;
     TrackerErrorSignal m_torrentTrackerError;
     TorrentHandleSignal m_torrentTrackerReply;
-
-    std::map<lt::info_hash_t, lt::torrent_handle> m_torrents;
+    TrackerAnnounceSignal m_trackerAnnounce;
+
+    porla::TorrentHandles m_torrents;
+    std::map<lt::info_hash_t, lt::torrent_status> m_statuses;
+    // Handed out by PeerInfo. Torrents without an entry are not found.
+    std::map<lt::info_hash_t, std::vector<lt::peer_info>> m_peers;
+    // Set with SetPeerClass, and the classes torrents were put in with JoinPeerClass.
+    std::map<std::string, porla::PeerClass> m_peerClasses;
+    std::set<std::pair<lt::info_hash_t, std::string>> m_joined;
+    // Every call to Reannounce, with whether the min interval was ignored.
+    std::vector<std::pair<lt::info_hash_t, bool>> m_reannounced;
+    // Every call to Remove, with whether the data was removed too.
+    std::vector<std::pair<lt::info_hash_t, bool>> m_removed;
+    // Returned by Settings, with the integer settings from ApplySettings merged in.
+    lt::settings_pack m_settings;
 };
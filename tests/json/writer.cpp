@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../../src/json/utils.hpp"
+#include "../../src/json/writer.hpp"
+
+namespace porla::WriterTests
+{
+    struct Inner
+    {
+        std::optional<int> value;
+    };
+
+    struct Outer
+    {
+        std::optional<std::string>  absent;
+        bool                        flag;
+        std::vector<Inner>          inners;
+        nlohmann::json              metadata;
+        std::string                 name;
+        std::optional<double>       ratio;
+        float                       progress;
+        std::pair<std::string, int> pair;
+    };
+
+    NLOHMANN_JSONIFY_ALL_THINGS(Inner, value);
+    NLOHMANN_JSONIFY_ALL_THINGS(Outer, absent, flag, inners, metadata, name, pair, progress, ratio);
+}
+
+using porla::WriterTests::Inner;
+using porla::WriterTests::Outer;
+
+static std::string Written(const auto& value)
+{
+    std::string out;
+    porla::Json::Write(out, value);
+    return out;
+}
+
+TEST(JsonWriterTests, Write_MatchesDump)
+{
+    const Outer outer{
+        .flag     = true,
+        .inners   = { Inner{ .value = 1 }, Inner{} },
+        .metadata = { {"b", 1}, {"a", nullptr} },
+        .name     = "quote \" slash \\ newline \n bell \x07 utf8 \xc3\xa5",
+        .ratio    = 2.0,
+        .progress = 0.1f,
+        .pair     = { "x", -3 }
+    };
+
+    EXPECT_EQ(Written(outer), nlohmann::json(outer).dump());
+}
+
+TEST(JsonWriterTests, Write_NumbersAsNlohmann)
+{
+    for (const double value : { 0.0, -0.0, 1.0, 1e15, 1e16, 1e-5, 0.30000000000000004, 123456.789 })
+    {
+        EXPECT_EQ(Written(value), nlohmann::json(value).dump()) << value;
+    }
+
+    EXPECT_EQ(Written(NAN), "null");
+    EXPECT_EQ(Written(std::int64_t{-9223372036854775807 - 1}), "-9223372036854775808");
+    EXPECT_EQ(Written(std::uint64_t{18446744073709551615u}), "18446744073709551615");
+}
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/memoryaccounting.hpp"
+#include "../src/torrentclientdata.hpp"
+
+using porla::MemoryAccounting;
+using porla::MemoryUsage;
+
+TEST(MemoryAccountingTests, Sample_CountsClientDataDiskBlocksAndSources)
+{
+    InMemorySession session;
+    MemoryAccounting memory(session);
+
+    const auto before = memory.Sample().subsystems.at("session.client_data").objects;
+
+    auto data = std::make_unique<porla::TorrentClientData>();
+    auto copy = std::make_unique<porla::TorrentClientData>(*data);
+
+    session.m_sessionStats({{ "disk.disk_blocks_in_use", 4 }});
+    memory.Add("queue", []() { return MemoryUsage{ .bytes = 100, .objects = 2 }; });
+
+    const auto snapshot = memory.Sample();
+
+    EXPECT_EQ(snapshot.subsystems.at("session.client_data").objects, before + 2);
+    EXPECT_EQ(snapshot.subsystems.at("libtorrent.disk").bytes, 4 * 16 * 1024);
+    EXPECT_EQ(snapshot.subsystems.at("queue").bytes, 100);
+
+    copy.reset();
+    memory.Add("queue", nullptr);
+
+    EXPECT_EQ(memory.Sample().subsystems.at("session.client_data").objects, before + 1);
+    EXPECT_FALSE(memory.Sample().subsystems.contains("queue"));
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <sodium.h>
+
+#include "../src/passwordhasher.hpp"
+
+using porla::PasswordHasher;
+using porla::PasswordHasherOptions;
+
+static PasswordHasherOptions Options()
+{
+    return PasswordHasherOptions{
+        .memory_budget = crypto_pwhash_MEMLIMIT_MIN,
+        .memlimit      = crypto_pwhash_MEMLIMIT_MIN,
+        .opslimit      = crypto_pwhash_OPSLIMIT_MIN,
+        .queue_size    = 4
+    };
+}
+
+static void RunOne(boost::asio::io_context& io)
+{
+    auto work = boost::asio::make_work_guard(io);
+    io.run_one();
+}
+
+TEST(PasswordHasherTests, Verify_AcceptsTheHashedPassword)
+{
+    ASSERT_GE(sodium_init(), 0);
+
+    boost::asio::io_context io;
+    PasswordHasher hasher(io, Options());
+
+    std::string hashed;
+    hasher.Hash("hunter2", [&](auto result, const auto& h) { ASSERT_EQ(result, PasswordHasher::Result::Ok); hashed = h; });
+    RunOne(io);
+
+    std::vector<PasswordHasher::Result> results;
+    hasher.Verify(hashed, "hunter2", [&](auto result) { results.push_back(result); });
+    hasher.Verify(hashed, "hunter3", [&](auto result) { results.push_back(result); });
+    hasher.Verify(std::nullopt, "hunter2", [&](auto result) { results.push_back(result); });
+    RunOne(io);
+    RunOne(io);
+    RunOne(io);
+
+    EXPECT_EQ(hasher.Threads(), 1);
+    EXPECT_EQ(results, (std::vector{
+        PasswordHasher::Result::Ok,
+        PasswordHasher::Result::Failed,
+        PasswordHasher::Result::Failed }));
+}
+
+TEST(PasswordHasherTests, Verify_TimesOutWhenQueuedTooLong)
+{
+    auto options = Options();
+    options.timeout = std::chrono::milliseconds(-1);
+
+    boost::asio::io_context io;
+    PasswordHasher hasher(io, options);
+
+    std::optional<PasswordHasher::Result> result;
+    hasher.Verify(std::nullopt, "hunter2", [&](auto r) { result = r; });
+    RunOne(io);
+
+    EXPECT_EQ(result, PasswordHasher::Result::Timeout);
+}
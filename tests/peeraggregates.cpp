@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/peeraggregates.hpp"
+
+namespace lt = libtorrent;
+
+using porla::PeerAggregates;
+
+class PeerAggregatesTests : public ::testing::Test
+{
+protected:
+    lt::info_hash_t AddTorrent(char id, std::vector<lt::peer_info> peers)
+    {
+        lt::torrent_status ts;
+        ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+        ts.num_peers = static_cast<int>(peers.size());
+        session.m_statuses.insert_or_assign(ts.info_hashes, ts);
+        session.m_peers.insert_or_assign(ts.info_hashes, std::move(peers));
+        return ts.info_hashes;
+    }
+
+    static lt::peer_info Peer(const std::string& ip, const std::string& client, int upload_rate)
+    {
+        lt::peer_info pi;
+        pi.ip = lt::tcp::endpoint(lt::make_address(ip), 6881);
+        pi.client = client;
+        pi.payload_up_speed = upload_rate;
+        return pi;
+    }
+
+    void Sweep()
+    {
+        io.restart();
+        io.run_for(std::chrono::milliseconds(20));
+    }
+
+    boost::asio::io_context io;
+    InMemorySession session;
+};
+
+TEST(PeerAggregatesLabelTests, Client_StripsVersion)
+{
+    EXPECT_EQ(PeerAggregates::Client("qBittorrent 4.6.2"), "qBittorrent");
+    EXPECT_EQ(PeerAggregates::Client("libtorrent/2.0.9"), "libtorrent");
+    EXPECT_EQ(PeerAggregates::Client("BitComet"), "BitComet");
+    EXPECT_EQ(PeerAggregates::Client(""), "unknown");
+}
+
+TEST(PeerAggregatesLabelTests, Network_MasksAddress)
+{
+    EXPECT_EQ(PeerAggregates::Network(lt::make_address("203.0.113.7")), "203.0.0.0/16");
+    EXPECT_EQ(PeerAggregates::Network(lt::make_address("2001:db8:1::1")), "2001:db8::/32");
+}
+
+TEST_F(PeerAggregatesTests, Sweep_SumsPeersAcrossTorrents)
+{
+    AddTorrent('a', { Peer("203.0.113.7", "qBittorrent 4.6.2", 100), Peer("198.51.100.1", "Transmission 4.0", 10) });
+    AddTorrent('b', { Peer("203.0.113.7", "qBittorrent 4.6.2", 50) });
+
+    PeerAggregates aggregates(io, session, porla::PeerAggregatesOptions{ .interval = std::chrono::milliseconds(1) });
+    Sweep();
+
+    const auto& snapshot = aggregates.Get();
+
+    EXPECT_EQ(snapshot.torrents_sampled, 2);
+    EXPECT_EQ(snapshot.total.peers, 3);
+    EXPECT_EQ(snapshot.clients.at("qBittorrent").upload_rate, 150);
+    EXPECT_EQ(snapshot.networks.at("203.0.0.0/16").peers, 2);
+
+    ASSERT_EQ(snapshot.top.size(), 2);
+    EXPECT_EQ(snapshot.top[0].ip, "203.0.113.7");
+    EXPECT_EQ(snapshot.top[0].torrents, 2);
+}
+
+TEST_F(PeerAggregatesTests, Sweep_CountsChurnBetweenSamples)
+{
+    const auto hash = AddTorrent('a', { Peer("203.0.113.7", "", 0), Peer("198.51.100.1", "", 0) });
+
+    PeerAggregates aggregates(io, session, porla::PeerAggregatesOptions{ .interval = std::chrono::milliseconds(1) });
+    Sweep();
+
+    session.m_peers[hash] = { Peer("203.0.113.7", "", 0), Peer("192.0.2.1", "", 0) };
+    Sweep();
+
+    EXPECT_EQ(aggregates.Get().connected, 1);
+    EXPECT_EQ(aggregates.Get().disconnected, 1);
+}
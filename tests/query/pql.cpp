@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
+
+#include <map>
+
 #include <libtorrent/torrent_status.hpp>
 
+#include "../allocations.hpp"
 #include "../../src/query/pql.hpp"
 
 using porla::Query::PQL;
@@ -21,6 +25,7 @@ INSTANTIATE_TEST_SUITE_P(
         "category = \"some-category\"",
         "download_rate > 1mbps",
         "name contains \"foo\"",
+        "name matches \"-GRP$\"",
         "is:downloading",
         "not is:downloading",
         "is:downloading and not is:paused",
@@ -30,10 +35,15 @@ INSTANTIATE_TEST_SUITE_P(
         "is:seeding and age > 1w",
         "progress <= 0.8",
         "save_path = \"/dl\"",
+        "seeding_time > 2w",
         "size > 1gb",
         "size < 1gb or age > 3h",
         "size > 1gb and tags contains \"foo\"",
-        "upload_rate < 1mbps"
+        "upload_rate < 1mbps",
+        "(size < 1gb or age > 3h) and is:seeding",
+        "any(files, path matches \"\\.mkv$\" and size > 10gb)",
+        "count(files) > 100",
+        "max_per_subnet(peers) > 50"
     ));
 
 TEST(porla_Query_PQL, Filter_Name_Contains)
@@ -58,6 +68,17 @@ TEST(porla_Query_PQL, Filter_Age)
     EXPECT_EQ(PQL::Parse("age <= 1h")->Includes(status), false);
 }
 
+TEST(porla_Query_PQL, Filter_SeedingTime)
+{
+    libtorrent::torrent_status status;
+    status.seeding_duration = std::chrono::seconds(3 * 24 * 60 * 60);
+
+    EXPECT_EQ(PQL::Parse("seeding_time >= 3d")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("seeding_time < 1w")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("seeding_time > 3d")->Includes(status), false);
+    EXPECT_EQ(PQL::Parse("seeding_time > 1d")->UsesClock(), true);
+}
+
 TEST(porla_Query_PQL, Filter_DownloadRate)
 {
     libtorrent::torrent_status status;
@@ -79,4 +100,403 @@ TEST(porla_Query_PQL, Filter_Flags)
     EXPECT_EQ(PQL::Parse("is:seeding")->Includes(status), true);
     EXPECT_EQ(PQL::Parse("not is:seeding")->Includes(status), false);
     EXPECT_EQ(PQL::Parse("is:seeding and not is:paused")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("is:metadata_pending")->Includes(status), false);
+
+    status.state = lt::torrent_status::downloading_metadata;
+
+    EXPECT_EQ(PQL::Parse("is:metadata_pending")->Includes(status), true);
+}
+
+TEST(porla_Query_PQL, ParseCached_ReturnsSameFilterForSameQuery)
+{
+    const auto first  = PQL::ParseCached("is:seeding and age > 1w");
+    const auto second = PQL::ParseCached("is:seeding and age > 1w");
+
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_NE(first.get(), PQL::ParseCached("is:paused").get());
+}
+
+TEST(porla_Query_PQL, Filter_AndOr)
+{
+    libtorrent::torrent_status status;
+    status.name = "ubuntu";
+    status.state = lt::torrent_status::seeding;
+
+    EXPECT_EQ(PQL::Parse("is:paused or name contains \"ubu\"")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("is:paused and name contains \"ubu\"")->Includes(status), false);
+    EXPECT_EQ(PQL::Parse("is:paused or is:downloading or is:seeding")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("is:seeding and not is:paused and name = \"ubuntu\"")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("is:seeding and is:paused or name = \"ubuntu\"")->Includes(status), true);
+}
+
+TEST(porla_Query_PQL, Parse_RejectsInvalidValueTypes)
+{
+    EXPECT_THROW(PQL::Parse("age > \"foo\""), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("name > 1"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("tags = \"foo\""), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("size contains 1"), porla::Query::QueryError);
+}
+
+class SavePathIndex : public PQL::Index
+{
+public:
+    const PQL::HashSet& Category(const std::string&) const override { return empty; }
+    const PQL::HashSet& SavePath(const std::string& save_path) const override { return save_path == "/dl" ? dl : empty; }
+    const PQL::HashSet& Tag(const std::string&) const override { return empty; }
+
+    PQL::HashSet dl = {
+        lt::info_hash_t(lt::sha1_hash(std::string(20, 'a'))),
+        lt::info_hash_t(lt::sha1_hash(std::string(20, 'b')))
+    };
+
+    PQL::HashSet empty;
+};
+
+TEST(porla_Query_PQL, Candidates_UsesIndex)
+{
+    SavePathIndex index;
+
+    EXPECT_EQ(PQL::Parse("save_path = \"/dl\"")->Candidates(index), index.dl);
+    EXPECT_EQ(PQL::Parse("save_path = \"/dl\" and is:seeding")->Candidates(index), index.dl);
+    EXPECT_EQ(PQL::Parse("save_path = \"/dl\" or save_path = \"/tmp\"")->Candidates(index), index.dl);
+    EXPECT_EQ(PQL::Parse("save_path = \"/dl\" or is:seeding")->Candidates(index), std::nullopt);
+    EXPECT_EQ(PQL::Parse("save_path contains \"/dl\"")->Candidates(index), std::nullopt);
+}
+
+TEST(porla_Query_PQL, IncludesCandidate_SkipsIndexedPredicates)
+{
+    libtorrent::torrent_status status;
+    status.save_path = "/other";
+    status.state = lt::torrent_status::seeding;
+
+    const auto filter = PQL::Parse("save_path = \"/dl\" and is:seeding");
+
+    EXPECT_EQ(filter->Includes(status), false);
+    EXPECT_EQ(filter->IncludesCandidate(status), true);
+
+    status.state = lt::torrent_status::downloading;
+    EXPECT_EQ(filter->IncludesCandidate(status), false);
+}
+
+TEST(porla_Query_PQL, Select_EvaluatesColumns)
+{
+    porla::Query::Columns columns;
+
+    for (int i = 0; i < 100; i++)
+    {
+        columns.hashes.emplace_back();
+        columns.added_time.push_back(0);
+        columns.download_rate.push_back(i * 1024);
+        columns.flags.push_back(0);
+        columns.moving_storage.push_back(0);
+        columns.progress.push_back(static_cast<float>(i) / 100);
+        columns.queue_position.push_back(i);
+        columns.ratio.push_back(0);
+        columns.size.push_back(i % 2 == 0 ? -1 : i);
+        columns.state.push_back(i < 50 ? lt::torrent_status::downloading : lt::torrent_status::seeding);
+        columns.upload_rate.push_back(0);
+    }
+
+    const auto count = [](const porla::Query::Bitmap& selection)
+    {
+        int n = 0;
+        for (auto word : selection) { n += __builtin_popcountll(word); }
+        return n;
+    };
+
+    porla::Query::Bitmap selection;
+
+    ASSERT_TRUE(PQL::Parse("is:seeding and download_rate >= 90kbps")->Select(columns, selection));
+    EXPECT_EQ(count(selection), 10);
+
+    ASSERT_TRUE(PQL::Parse("not is:seeding")->Select(columns, selection));
+    EXPECT_EQ(count(selection), 50);
+
+    // Torrents without metadata never match on size.
+    ASSERT_TRUE(PQL::Parse("size < 10 or progress > 0.95")->Select(columns, selection));
+    EXPECT_EQ(count(selection), 9);
+
+    EXPECT_FALSE(PQL::Parse("is:seeding and name contains \"foo\"")->Select(columns, selection));
+}
+
+TEST(porla_Query_PQL, Select_TestsTagBits)
+{
+    porla::Query::Columns columns;
+    columns.tag_words = 1;
+    columns.tag_bits  = {
+        { porla::Symbol::Intern("pql-tag-a"), 0 },
+        { porla::Symbol::Intern("pql-tag-b"), 1 },
+        { porla::Symbol::Intern("pql-tag-c"), 2 }
+    };
+
+    // Row i has the tags of the bits set in i.
+    for (std::uint64_t i = 0; i < 8; i++)
+    {
+        columns.hashes.emplace_back();
+        columns.tags.push_back(i);
+    }
+
+    const auto rows = [&columns](const std::string& query)
+    {
+        porla::Query::Bitmap selection;
+        EXPECT_TRUE(PQL::Parse(query)->Select(columns, selection));
+        return selection.empty() ? 0 : selection[0];
+    };
+
+    EXPECT_EQ(rows("tags contains \"pql-tag-a\""), 0b10101010);
+    EXPECT_EQ(rows("tags contains \"pql-tag-a\" and tags contains \"pql-tag-b\""), 0b10001000);
+    EXPECT_EQ(rows("tags contains \"pql-tag-a\" or tags contains \"pql-tag-b\""), 0b11101110);
+    EXPECT_EQ(rows("tags in [\"pql-tag-b\", \"pql-tag-c\"]"), 0b11111100);
+    EXPECT_EQ(rows("tags matches \"^pql-tag-[bc]$\""), 0b11111100);
+    EXPECT_EQ(rows("tags contains \"pql-tag-a\" and tags contains \"pql-tag-unknown\""), 0);
+
+    // Past 64 tags, rows take more than one word.
+    columns.tag_words = 2;
+    columns.tags.assign(columns.Size() * 2, 0);
+    columns.tag_bits.insert({ porla::Symbol::Intern("pql-tag-d"), 70 });
+    columns.tags[3 * 2]     = 0b1;
+    columns.tags[3 * 2 + 1] = std::uint64_t{1} << 6;
+    columns.tags[5 * 2 + 1] = std::uint64_t{1} << 6;
+
+    EXPECT_EQ(rows("tags contains \"pql-tag-d\""), 0b00101000);
+    EXPECT_EQ(rows("tags contains \"pql-tag-a\" and tags contains \"pql-tag-d\""), 0b00001000);
+}
+
+TEST(porla_Query_PQL, Filter_EqualityChainsAndInfoHash)
+{
+    libtorrent::torrent_status status;
+    status.name = "debian";
+    status.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, 'a')));
+
+    EXPECT_EQ(PQL::Parse("name = \"ubuntu\" or name = \"debian\" or name = \"arch\"")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("name = \"ubuntu\" or name = \"arch\" or is:paused")->Includes(status), false);
+    EXPECT_EQ(PQL::Parse("info_hash = \"6161616161616161616161616161616161616161\"")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("info_hash = \"6161616161616161616161616161616161616162\" or info_hash = \"6161616161616161616161616161616161616161\"")->Includes(status), true);
+
+    EXPECT_THROW(PQL::Parse("info_hash = \"abc\""), porla::Query::QueryError);
+}
+
+class PqlDifferentialTestFixture : public ::testing::TestWithParam<std::string> {};
+
+// The hand-written parser has to agree with the ANTLR reference - same errors at the same
+// positions, and filters that include the same torrents.
+TEST_P(PqlDifferentialTestFixture, Parse_MatchesAntlr)
+{
+    const auto outcome = [](const std::function<std::unique_ptr<PQL::Filter>()>& parse)
+    {
+        std::vector<std::string> result;
+
+        try
+        {
+            const auto filter = parse();
+
+            for (int i = 0; i < 8; i++)
+            {
+                libtorrent::torrent_status status;
+                status.added_time    = time(nullptr) - i * 60 * 60 * 24 - 60 * 30;
+                status.download_rate = i * 512 * 1024;
+                status.name          = i % 2 == 0 ? "ubuntu" : "debian";
+                status.progress      = static_cast<float>(i) / 8;
+                status.save_path     = i % 3 == 0 ? "/dl" : "/tmp";
+                status.state         = i % 2 == 0 ? lt::torrent_status::seeding : lt::torrent_status::downloading;
+                status.upload_rate   = i * 1024;
+
+                if (i % 4 == 0) status.flags |= lt::torrent_flags::paused;
+
+                result.push_back(filter->Includes(status) ? "1" : "0");
+            }
+        }
+        catch (const porla::Query::QueryError& qe)
+        {
+            result.push_back("error at " + std::to_string(qe.pos()));
+        }
+
+        return result;
+    };
+
+    const std::string query = GetParam();
+
+    EXPECT_EQ(
+        outcome([&]() { return PQL::Parse(query); }),
+        outcome([&]() { return PQL::ParseAntlr(query); }));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PqlDifferentialTests,
+    PqlDifferentialTestFixture,
+    ::testing::Values(
+        "",
+        "age > 1d",
+        "age <= 3d",
+        "download_rate > 1mbps",
+        "download_rate >= 512 kbps and upload_rate < 4kbps",
+        "is:downloading",
+        "not is:paused",
+        "is:seeding and not is:paused",
+        "is:paused or is:seeding and name contains \"ubu\"",
+        "is:paused and is:seeding or name = \"debian\"",
+        "name = \"ubuntu\" or name = \"debian\" or name = \"arch\"",
+        "progress > 0.5",
+        "progress <= 1",
+        "save_path = \"/dl\" or save_path contains \"tmp\"",
+        "size > 1gb",
+        "name",
+        "name =",
+        "name = $",
+        "name = \"unterminated",
+        "name > 1",
+        "is:",
+        "is:foo",
+        "not name = \"x\"",
+        "foo = 1",
+        "s = 1",
+        "is:seeding and",
+        "is:seeding or or",
+        "is:seeding and\n  size > kb",
+        "tags = \"foo\""
+    ));
+
+TEST(porla_Query_PQL, Parse_InOperator)
+{
+    libtorrent::torrent_status status;
+    status.name = "debian";
+
+    EXPECT_EQ(PQL::Parse("name in [\"ubuntu\", \"debian\"]")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("name in [\"ubuntu\"]")->Includes(status), false);
+
+    EXPECT_THROW(PQL::Parse("name in []"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("size in [1, 2]"), porla::Query::QueryError);
+}
+
+TEST(porla_Query_PQL, Filter_Matches)
+{
+    libtorrent::torrent_status status;
+    status.name = "Some.Release.1080p-GRP";
+    status.save_path = "/downloads/tv";
+
+    EXPECT_EQ(PQL::Parse("name matches \"-(GRP|OTHER)$\"")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("name matches \"^GRP\"")->Includes(status), false);
+    EXPECT_EQ(PQL::Parse("save_path matches \"/(tv|movies)$\"")->Includes(status), true);
+    EXPECT_EQ(PQL::Parse("name matches \"(?i)1080P\" and save_path contains \"tv\"")->Includes(status), true);
+
+    // Parked torrents have no tags to match.
+    EXPECT_EQ(PQL::Parse("tags matches \".\"")->Includes(status), false);
+
+    EXPECT_THROW(PQL::Parse("name matches \"(\""), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("size matches \"1\""), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("name in [\"a\"] or name matches 1"), porla::Query::QueryError);
+}
+
+TEST(porla_Query_PQL, Parse_RejectsTrailingInput)
+{
+    // The ANTLR grammar stops at the end of the expression and ignores the rest.
+    EXPECT_THROW(PQL::Parse("is:seeding is:paused"), porla::Query::QueryError);
+}
+
+TEST(porla_Query_PQL, Includes_DoesNotAllocatePerTorrent)
+{
+    std::vector<libtorrent::torrent_status> torrents(1000);
+
+    for (std::size_t i = 0; i < torrents.size(); i++)
+    {
+        torrents[i].name = "Some.Release." + std::to_string(i) + ".1080p-GRP";
+        torrents[i].save_path = "/downloads/tv";
+        torrents[i].added_time = time(nullptr) - static_cast<std::int64_t>(i) * 60;
+        torrents[i].info_hashes.v1[0] = static_cast<std::uint8_t>(i);
+    }
+
+    const auto filter = PQL::Parse(
+        "(name contains \"release\" and age < 1d and not is:paused)"
+        " or name matches \"(?i)-grp$\""
+        " or save_path in [\"/downloads/movies\", \"/downloads/tv\"]"
+        " or info_hash = \"0000000000000000000000000000000000000000\"");
+
+    // Warms up the scratch space of the pattern.
+    filter->Includes(torrents[0]);
+
+    porla::Tests::AllocationScope allocations;
+    std::size_t included = 0;
+
+    for (const auto& ts : torrents)
+    {
+        included += filter->Includes(ts) ? 1 : 0;
+    }
+
+    EXPECT_EQ(allocations.Count(), 0);
+    EXPECT_EQ(included, torrents.size());
+}
+
+class SampledPeers : public PQL::Peers
+{
+public:
+    [[nodiscard]] const std::vector<PQL::Peer>* Sampled(const libtorrent::info_hash_t& hash) const override
+    {
+        const auto peers = m_peers.find(hash);
+        return peers != m_peers.end() ? &peers->second : nullptr;
+    }
+
+    std::map<libtorrent::info_hash_t, std::vector<PQL::Peer>> m_peers;
+};
+
+TEST(porla_Query_PQL, Filter_PeerAggregates)
+{
+    const auto peer = [](const std::string& ip, const std::string& client, int upload_rate)
+    {
+        return PQL::Peer{
+            .endpoint      = libtorrent::tcp::endpoint(libtorrent::make_address(ip), 6881),
+            .client        = client,
+            .download_rate = 0,
+            .upload_rate   = upload_rate
+        };
+    };
+
+    libtorrent::torrent_status status;
+    status.info_hashes.v1[0] = 1;
+
+    SampledPeers peers;
+    peers.m_peers[status.info_hashes] = {
+        peer("10.0.0.1", "qBittorrent 4.6", 0),
+        peer("10.0.0.2", "qBittorrent 4.5", 0),
+        peer("10.0.0.3", "Transmission 4.0", 200),
+        peer("10.0.1.1", "Deluge 2.1", 0)
+    };
+
+    const auto includes = [&](const std::string& query)
+    {
+        return PQL::Parse(query)->Includes(status, nullptr, &peers);
+    };
+
+    EXPECT_TRUE(includes("max_per_subnet(peers) = 3"));
+    EXPECT_FALSE(includes("max_per_subnet(peers) > 3"));
+    EXPECT_TRUE(includes("max_per_subnet(peers, client contains \"qBittorrent\") = 2"));
+    EXPECT_TRUE(includes("count(peers, client matches \"^qBittorrent\") = 2"));
+    EXPECT_TRUE(includes("count(peers) = 4 and not is:paused"));
+    EXPECT_TRUE(includes("any(peers, upload_rate > 100 and ip contains \"10.0.0.\")"));
+    EXPECT_FALSE(includes("any(peers, upload_rate > 100 and ip contains \"10.0.1.\")"));
+    EXPECT_TRUE(includes("is:paused or (any(peers, client = \"Deluge 2.1\") and count(peers) > 1)"));
+
+    // Torrents without sampled peers, and filters without the samples, match nothing.
+    EXPECT_FALSE(PQL::Parse("count(peers) >= 0")->Includes(status));
+
+    libtorrent::torrent_status other;
+    EXPECT_FALSE(PQL::Parse("count(peers) >= 0")->Includes(other, nullptr, &peers));
+}
+
+TEST(porla_Query_PQL, Parse_Aggregates)
+{
+    libtorrent::torrent_status status;
+
+    // Torrents without metadata have no files.
+    EXPECT_FALSE(PQL::Parse("any(files)")->Includes(status));
+    EXPECT_FALSE(PQL::Parse("count(files, size > 1gb) >= 0")->Includes(status));
+
+    EXPECT_THROW(PQL::Parse("max_per_subnet(files) > 1"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("count(files, client = \"x\") > 1"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("count(files, size contains 1) > 1"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("count(files) matches \"x\""), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("count(peers) > \"x\""), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("count(peers)"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("sum(files) > 1"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("any(trackers)"), porla::Query::QueryError);
+    EXPECT_THROW(PQL::Parse("(is:paused"), porla::Query::QueryError);
 }
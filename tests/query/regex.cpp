@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "../allocations.hpp"
+#include "../../src/query/regex.hpp"
+
+using porla::Query::Regex;
+
+TEST(porla_Query_Regex, Search_MatchesAnywhere)
+{
+    EXPECT_TRUE(Regex("ubuntu").Search("i am ubuntu 123"));
+    EXPECT_FALSE(Regex("debian").Search("i am ubuntu 123"));
+    EXPECT_TRUE(Regex("").Search(""));
+}
+
+TEST(porla_Query_Regex, Search_Anchors)
+{
+    EXPECT_TRUE(Regex("-(GRP|OTHER)$").Search("Some.Release.1080p-GRP"));
+    EXPECT_FALSE(Regex("-(GRP|OTHER)$").Search("Some.Release-GRP.1080p"));
+    EXPECT_TRUE(Regex("^Some").Search("Some.Release"));
+    EXPECT_FALSE(Regex("^Release").Search("Some.Release"));
+}
+
+TEST(porla_Query_Regex, Search_ClassesAndRepeats)
+{
+    EXPECT_TRUE(Regex("S\\d{2}E\\d{2}").Search("Show.S01E02.720p"));
+    EXPECT_FALSE(Regex("S\\d{2}E\\d{2}").Search("Show.S1E2.720p"));
+    EXPECT_TRUE(Regex("^[a-z]+\\.[^.]+$").Search("name.ext"));
+    EXPECT_TRUE(Regex("ab*c").Search("ac"));
+    EXPECT_TRUE(Regex("ab+c").Search("abbbc"));
+    EXPECT_FALSE(Regex("ab+c").Search("ac"));
+    EXPECT_TRUE(Regex("^a{2,3}$").Search("aaa"));
+    EXPECT_FALSE(Regex("^a{2,3}$").Search("aaaa"));
+    EXPECT_TRUE(Regex("^colou?r$").Search("color"));
+}
+
+TEST(porla_Query_Regex, Search_CaseInsensitive)
+{
+    EXPECT_TRUE(Regex("(?i)x264").Search("Movie.X264"));
+    EXPECT_FALSE(Regex("x264").Search("Movie.X264"));
+}
+
+TEST(porla_Query_Regex, Search_IsLinearForHostilePatterns)
+{
+    // Exponential for a backtracking engine.
+    EXPECT_FALSE(Regex("^(a+)+$").Search(std::string(10000, 'a') + "b"));
+    EXPECT_FALSE(Regex("^(a|a)*$").Search(std::string(10000, 'a') + "b"));
+}
+
+TEST(porla_Query_Regex, Constructor_RejectsInvalidPatterns)
+{
+    EXPECT_THROW(Regex("("), std::invalid_argument);
+    EXPECT_THROW(Regex(")"), std::invalid_argument);
+    EXPECT_THROW(Regex("[a"), std::invalid_argument);
+    EXPECT_THROW(Regex("*a"), std::invalid_argument);
+    EXPECT_THROW(Regex("a{3,2}"), std::invalid_argument);
+    EXPECT_THROW(Regex("\\1"), std::invalid_argument);
+    EXPECT_THROW(Regex("(a{1000}){1000}"), std::invalid_argument);
+}
+
+TEST(porla_Query_Regex, Search_DoesNotAllocateOnceWarm)
+{
+    const Regex regex("(?i)-(grp|other)$");
+    const std::string input = "Some.Release.1080p-GRP";
+
+    ASSERT_TRUE(regex.Search(input));
+
+    porla::Tests::AllocationScope allocations;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        regex.Search(input);
+    }
+
+    EXPECT_EQ(allocations.Count(), 0);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <ctime>
+
+#include "inmemorysession.hpp"
+
+#include "../src/releaseboost.hpp"
+
+using porla::ReleaseBoost;
+using porla::ReleaseBoostOptions;
+
+static lt::info_hash_t Hash(char c)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, c).c_str()));
+}
+
+static lt::torrent_status Status(char c, std::int64_t added, std::int64_t completed = 0)
+{
+    lt::torrent_status ts;
+    ts.info_hashes    = Hash(c);
+    ts.added_time     = added;
+    ts.completed_time = completed;
+    return ts;
+}
+
+static const ReleaseBoostOptions Linear{ .window = std::chrono::seconds(1000), .curve = ReleaseBoostOptions::Curve::Linear };
+
+TEST(ReleaseBoostTests, Decay_FollowsTheCurve)
+{
+    const ReleaseBoostOptions exponential{ .window = std::chrono::seconds(1000) };
+
+    EXPECT_DOUBLE_EQ(ReleaseBoost::Decay(0, 0, exponential), 1);
+    EXPECT_DOUBLE_EQ(ReleaseBoost::Decay(0, 250, exponential), 0.5);
+    EXPECT_DOUBLE_EQ(ReleaseBoost::Decay(0, 1000, exponential), 0);
+    EXPECT_DOUBLE_EQ(ReleaseBoost::Decay(0, 500, Linear), 0.5);
+    EXPECT_DOUBLE_EQ(ReleaseBoost::Decay(0, 2000, Linear), 0);
+}
+
+TEST(ReleaseBoostTests, Tiers_AreCreatedWithFallingPriority)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+
+    {
+        ReleaseBoost boost(io, session, Linear);
+
+        ASSERT_EQ(session.m_peerClasses.size(), 4);
+
+        const auto& first = session.m_peerClasses.at(ReleaseBoost::ClassName(0));
+        const auto& last  = session.m_peerClasses.at(ReleaseBoost::ClassName(3));
+
+        EXPECT_EQ(first.upload_priority, 255);
+        EXPECT_TRUE(first.ignore_unchoke_slots);
+        EXPECT_EQ(last.upload_priority, 65);
+        EXPECT_FALSE(last.ignore_unchoke_slots);
+    }
+
+    EXPECT_TRUE(session.m_peerClasses.empty());
+}
+
+TEST(ReleaseBoostTests, AddedTorrent_MovesDownThroughTiers)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    ReleaseBoost boost(io, session, Linear);
+
+    const std::int64_t now = std::time(nullptr);
+
+    session.m_torrentAdded(Status('a', now));
+
+    EXPECT_TRUE(session.m_joined.contains({ Hash('a'), ReleaseBoost::ClassName(0) }));
+    EXPECT_EQ(boost.Priority(Hash('a')), 100);
+
+    boost.Tick(now + 500);
+
+    EXPECT_FALSE(session.m_joined.contains({ Hash('a'), ReleaseBoost::ClassName(0) }));
+    EXPECT_TRUE(session.m_joined.contains({ Hash('a'), ReleaseBoost::ClassName(2) }));
+    EXPECT_EQ(boost.Priority(Hash('a')), 50);
+
+    boost.Tick(now + 1000);
+
+    EXPECT_TRUE(session.m_joined.empty());
+    EXPECT_EQ(boost.Size(), 0);
+}
+
+TEST(ReleaseBoostTests, LoadedTorrent_PastItsWindow_IsNotBoosted)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    ReleaseBoost boost(io, session, Linear);
+
+    const std::int64_t now = std::time(nullptr);
+
+    session.m_torrentAdded(Status('a', now - 7200));
+    session.m_torrentFinished(Status('a', now - 7200, now - 3600));
+
+    EXPECT_TRUE(session.m_joined.empty());
+    EXPECT_EQ(boost.Size(), 0);
+}
+
+TEST(ReleaseBoostTests, FinishedTorrent_StartsOver)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    ReleaseBoost boost(io, session, Linear);
+
+    const std::int64_t now = std::time(nullptr);
+
+    session.m_torrentAdded(Status('a', now - 600));
+    EXPECT_TRUE(session.m_joined.contains({ Hash('a'), ReleaseBoost::ClassName(2) }));
+
+    session.m_torrentFinished(Status('a', now - 600, now));
+    EXPECT_TRUE(session.m_joined.contains({ Hash('a'), ReleaseBoost::ClassName(0) }));
+    EXPECT_EQ(session.m_joined.size(), 1);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "../src/responsecache.hpp"
+
+namespace http = boost::beast::http;
+
+using porla::ResponseCache;
+using porla::Utils::Encoding;
+
+TEST(ResponseCacheTests, Get_BuildsOnceUntilInvalidated)
+{
+    ResponseCache cache;
+    int builds = 0;
+
+    const auto build = [&builds]() { return nlohmann::json{{"builds", ++builds}}; };
+
+    EXPECT_EQ((*cache.Get("system", build))["builds"], 1);
+    EXPECT_EQ((*cache.Get("system", build))["builds"], 1);
+
+    cache.Invalidate("system");
+
+    EXPECT_EQ((*cache.Get("system", build))["builds"], 2);
+    EXPECT_EQ(builds, 2);
+}
+
+TEST(ResponseCacheTests, Get_WithThrowingBuild_BuildsAgain)
+{
+    ResponseCache cache;
+
+    EXPECT_THROW(cache.Get("system", []() -> nlohmann::json { throw std::runtime_error("db"); }), std::runtime_error);
+    EXPECT_EQ((*cache.Get("system", []() { return nlohmann::json{{"status", "ok"}}; }))["status"], "ok");
+}
+
+TEST(ResponseCacheTests, Encoded_HasEtagPerEncoding)
+{
+    ResponseCache cache;
+
+    const auto build = []() { return nlohmann::json{{"status", "ok"}}; };
+    const auto json  = cache.Encoded("system", Encoding::Type::Json, build);
+    const auto cbor  = cache.Encoded("system", Encoding::Type::Cbor, build);
+
+    EXPECT_EQ(json->data, R"({"status":"ok"})");
+    EXPECT_NE(json->etag, cbor->etag);
+    EXPECT_EQ(cache.Encoded("system", Encoding::Type::Json, build), json);
+}
+
+TEST(ResponseCacheTests, Response_WithMatchingEtag_IsNotModified)
+{
+    ResponseCache cache;
+
+    const auto build = []() { return nlohmann::json{{"status", "setup"}}; };
+
+    http::request<http::string_body> req{http::verb::get, "/api/v1/system", 11};
+
+    const auto first = cache.Response(req, "system", build);
+    EXPECT_EQ(first.result(), http::status::ok);
+    EXPECT_EQ(first.body(), R"({"status":"setup"})");
+
+    req.set(http::field::if_none_match, "W/\"other\", " + std::string(first[http::field::etag]));
+
+    const auto second = cache.Response(req, "system", build);
+    EXPECT_EQ(second.result(), http::status::not_modified);
+    EXPECT_TRUE(second.body().empty());
+
+    cache.Invalidate("system");
+
+    const auto changed = cache.Response(req, "system", []() { return nlohmann::json{{"status", "ok"}}; });
+    EXPECT_EQ(changed.result(), http::status::ok);
+}
+
+TEST(ResponseCacheTests, IsNoneMatch_AcceptsListsWeakTagsAndWildcard)
+{
+    EXPECT_TRUE(ResponseCache::IsNoneMatch("\"a\", \"b\"", "\"b\""));
+    EXPECT_TRUE(ResponseCache::IsNoneMatch("W/\"a\"", "\"a\""));
+    EXPECT_TRUE(ResponseCache::IsNoneMatch("*", "\"a\""));
+    EXPECT_FALSE(ResponseCache::IsNoneMatch("\"a\"", "\"b\""));
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/savepathquotas.hpp"
+
+namespace lt = libtorrent;
+
+using porla::SavePathQuota;
+using porla::SavePathQuotas;
+using porla::SavePathQuotasOptions;
+
+static lt::info_hash_t Hash(char c)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, c).c_str()));
+}
+
+static lt::torrent_status Status(char c, const std::string& save_path, std::int64_t wanted, std::int64_t added, bool finished = false)
+{
+    lt::torrent_status ts;
+    ts.info_hashes       = Hash(c);
+    ts.save_path         = save_path;
+    ts.total_wanted      = wanted;
+    ts.total_wanted_done = finished ? wanted : 0;
+    ts.is_finished       = finished;
+    ts.added_time        = added;
+    return ts;
+}
+
+class SavePathQuotasTests : public ::testing::Test
+{
+protected:
+    void Add(const lt::torrent_status& ts)
+    {
+        session.m_statuses.insert_or_assign(ts.info_hashes, ts);
+        session.m_torrentAdded(ts);
+    }
+
+    void Update(const lt::torrent_status& ts)
+    {
+        session.m_statuses.insert_or_assign(ts.info_hashes, ts);
+        session.m_stateUpdate(std::vector<lt::torrent_status>{ ts });
+    }
+
+    static SavePathQuotasOptions Options()
+    {
+        return SavePathQuotasOptions{
+            .quotas = {
+                SavePathQuota{ .name = "data", .save_path = "/data/", .max_size = 100 },
+                SavePathQuota{ .name = "tv", .save_path = "/data/tv", .max_size = 40, .action = "pause" }
+            }
+        };
+    }
+
+    InMemorySession session;
+};
+
+TEST_F(SavePathQuotasTests, Torrents_CountAgainstEveryQuotaTheyAreUnder)
+{
+    SavePathQuotas quotas(session, Options());
+
+    Add(Status('a', "/data/tv/show", 30, 1));
+    Add(Status('b', "/data/movies", 20, 2, true));
+    Add(Status('c', "/database", 50, 3));
+
+    const auto usage = quotas.Quotas();
+
+    EXPECT_EQ(usage[0].reserved, 50);
+    EXPECT_EQ(usage[0].completed, 20);
+    EXPECT_EQ(usage[0].torrents, 2);
+    EXPECT_EQ(usage[1].reserved, 30);
+    EXPECT_EQ(usage[1].torrents, 1);
+
+    session.m_torrentRemoved(Hash('a'));
+
+    EXPECT_EQ(quotas.Quotas()[0].reserved, 20);
+    EXPECT_EQ(quotas.Quotas()[1].torrents, 0);
+}
+
+TEST_F(SavePathQuotasTests, Admit_OverRejectQuota_IsRejected)
+{
+    SavePathQuotas quotas(session, Options());
+
+    Add(Status('a', "/data/movies", 60, 1));
+
+    const auto rejection = quotas.Admit(Hash('b'), std::nullopt, "/data/movies", 50);
+
+    ASSERT_TRUE(rejection.has_value());
+    EXPECT_EQ(rejection->quota, "data");
+    EXPECT_EQ(rejection->reserved, 60);
+
+    // Unknown sizes, and torrents outside every quota, are let in.
+    EXPECT_FALSE(quotas.Admit(Hash('b'), std::nullopt, "/data/movies", 0).has_value());
+    EXPECT_FALSE(quotas.Admit(Hash('c'), std::nullopt, "/other", 500).has_value());
+}
+
+TEST_F(SavePathQuotasTests, Admit_CountsPendingUntilAdded)
+{
+    SavePathQuotas quotas(session, Options());
+
+    EXPECT_FALSE(quotas.Admit(Hash('a'), std::nullopt, "/data", 60).has_value());
+    EXPECT_EQ(quotas.Quotas()[0].pending, 60);
+    EXPECT_TRUE(quotas.Admit(Hash('b'), std::nullopt, "/data", 60).has_value());
+
+    Add(Status('a', "/data", 60, 1));
+
+    EXPECT_EQ(quotas.Quotas()[0].pending, 0);
+    EXPECT_EQ(quotas.Quotas()[0].reserved, 60);
+}
+
+TEST_F(SavePathQuotasTests, Downloads_WhichDoNotFit_AreOverUntilThereIsRoom)
+{
+    SavePathQuotas quotas(session, Options());
+
+    Add(Status('a', "/data/tv", 20, 1));
+    Add(Status('b', "/data/tv", 0, 2));
+    Add(Status('c', "/data/tv", 10, 3, true));
+
+    EXPECT_FALSE(quotas.IsOver(Hash('b')));
+
+    // The metadata of the magnet link arrives, and it is too large for what is left.
+    Update(Status('b', "/data/tv", 15, 2));
+
+    EXPECT_FALSE(quotas.IsOver(Hash('a')));
+    EXPECT_TRUE(quotas.IsOver(Hash('b')));
+    EXPECT_FALSE(quotas.IsOver(Hash('c')));
+    EXPECT_EQ(quotas.Quotas()[1].over, 1);
+
+    session.m_torrentRemoved(Hash('a'));
+
+    EXPECT_FALSE(quotas.IsOver(Hash('b')));
+    EXPECT_EQ(quotas.Quotas()[1].over, 0);
+}
+
+TEST_F(SavePathQuotasTests, Moved_OutOfQuota_IsNoLongerOver)
+{
+    SavePathQuotas quotas(session, Options());
+
+    Add(Status('a', "/data/tv", 30, 1));
+    Add(Status('b', "/data/tv", 30, 2));
+
+    EXPECT_TRUE(quotas.IsOver(Hash('b')));
+
+    Update(Status('b', "/archive", 30, 2));
+
+    EXPECT_FALSE(quotas.IsOver(Hash('b')));
+    EXPECT_EQ(quotas.Quotas()[1].reserved, 30);
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/movequeue.hpp"
+#include "../src/seedinggoals.hpp"
+
+namespace lt = libtorrent;
+
+using porla::SeedingGoals;
+
+class SeedingGoalsTests : public ::testing::Test
+{
+protected:
+    lt::torrent_status AddTorrent(char id, float progress)
+    {
+        lt::torrent_status ts;
+        ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+        ts.progress = progress;
+        session.m_statuses.insert({ ts.info_hashes, ts });
+        session.m_torrents.insert({ ts.info_hashes, lt::torrent_handle() });
+        return ts;
+    }
+
+    std::unique_ptr<SeedingGoals> Goals(const std::string& query, const std::string& action)
+    {
+        return std::make_unique<SeedingGoals>(io, session, moves, porla::SeedingGoalsOptions{
+            .goals = {porla::SeedingGoal{ .name = "test", .query = query, .action = action }}
+        });
+    }
+
+    boost::asio::io_context io;
+    InMemorySession session;
+    porla::MoveQueue moves{session};
+};
+
+TEST_F(SeedingGoalsTests, StateUpdate_Matching_AppliesOnce)
+{
+    const auto done = AddTorrent('a', 1.0f);
+    const auto goals = Goals("progress >= 1.0", "remove_data");
+
+    session.m_stateUpdate({ done });
+    session.m_stateUpdate({ done });
+
+    ASSERT_EQ(session.m_removed.size(), 1);
+    EXPECT_EQ(session.m_removed[0].first, done.info_hashes);
+    EXPECT_TRUE(session.m_removed[0].second);
+}
+
+TEST_F(SeedingGoalsTests, StateUpdate_NotMatching_DoesNothing)
+{
+    const auto downloading = AddTorrent('a', 0.5f);
+    const auto goals = Goals("progress >= 1.0", "remove");
+
+    session.m_stateUpdate({ downloading });
+
+    EXPECT_TRUE(session.m_removed.empty());
+}
+
+TEST_F(SeedingGoalsTests, StateUpdate_MatchingAgain_AppliesAgain)
+{
+    auto ts = AddTorrent('a', 1.0f);
+    const auto goals = Goals("progress >= 1.0", "remove");
+
+    session.m_stateUpdate({ ts });
+
+    ts.progress = 0.5f;
+    session.m_stateUpdate({ ts });
+
+    ts.progress = 1.0f;
+    session.m_stateUpdate({ ts });
+
+    EXPECT_EQ(session.m_removed.size(), 2);
+}
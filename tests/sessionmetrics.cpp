@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "../src/sessionmetrics.hpp"
+
+using porla::SessionMetrics;
+
+TEST(SessionMetricsTests, Since_ComputesCounterDeltasAndRates)
+{
+    const auto layout = std::make_shared<const SessionMetrics::Layout>(
+        std::vector<std::pair<std::string, bool>>{{"net.recv_bytes", true}, {"peer.num_peers_connected", false}});
+
+    const SessionMetrics first(layout, {100, 5});
+    SessionMetrics second(layout, {300, 7});
+
+    second.Since(first, 2);
+
+    EXPECT_EQ(second.Delta(0), 200);
+    EXPECT_DOUBLE_EQ(second.Rate(0), 100);
+    EXPECT_DOUBLE_EQ(second.Interval(), 2);
+
+    // Gauges have no deltas.
+    EXPECT_EQ(second.Delta(1), 0);
+    EXPECT_EQ(second.Get("peer.num_peers_connected"), 7);
+    EXPECT_FALSE(second.Get("missing").has_value());
+
+    // A counter going down was reset.
+    SessionMetrics third(layout, {50, 7});
+    third.Since(second, 1);
+
+    EXPECT_EQ(third.Delta(0), 50);
+}
+
+TEST(SessionMetricsTests, Since_IgnoresOtherLayouts)
+{
+    const SessionMetrics first{{"net.recv_bytes", 100}};
+    SessionMetrics second{{"net.recv_bytes", 300}};
+
+    second.Since(first, 1);
+
+    EXPECT_EQ(second.Delta(0), 0);
+    EXPECT_DOUBLE_EQ(second.Interval(), 0);
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "inmemorysession.hpp"
+
+#include "../src/sessionprofiles.hpp"
+
+using porla::SessionProfiles;
+using porla::SessionProfilesOptions;
+
+static lt::settings_pack Profile(std::initializer_list<std::pair<int, int>> settings)
+{
+    lt::settings_pack pack;
+    for (const auto& [key, value] : settings) pack.set_int(key, value);
+    return pack;
+}
+
+TEST(SessionProfilesTests, Activate_RestoresSettingsOnlyThePreviousProfileHad)
+{
+    InMemorySession session;
+    session.m_settings.set_int(lt::settings_pack::download_rate_limit, 0);
+    session.m_settings.set_int(lt::settings_pack::upload_rate_limit, 0);
+
+    SessionProfiles profiles(SessionProfilesOptions{
+        .session  = session,
+        .profiles = {
+            { "night", Profile({{ lt::settings_pack::download_rate_limit, 5000 }, { lt::settings_pack::upload_rate_limit, 1000 }}) },
+            { "work",  Profile({{ lt::settings_pack::upload_rate_limit, 100 }}) }
+        }
+    });
+
+    EXPECT_EQ(profiles.Activate("night"), 2);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::download_rate_limit), 5000);
+
+    EXPECT_EQ(profiles.Activate("work"), 2);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::download_rate_limit), 0);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::upload_rate_limit), 100);
+    EXPECT_EQ(profiles.Active(), "work");
+
+    EXPECT_EQ(profiles.Activate(std::nullopt), 1);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::upload_rate_limit), 0);
+    EXPECT_FALSE(profiles.Active().has_value());
+}
+
+TEST(SessionProfilesTests, Activate_ThrowsForUnknownProfiles)
+{
+    InMemorySession session;
+    SessionProfiles profiles(SessionProfilesOptions{ .session = session });
+
+    EXPECT_THROW(profiles.Activate("missing"), std::invalid_argument);
+    EXPECT_FALSE(profiles.Active().has_value());
+}
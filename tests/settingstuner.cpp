@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/settingstuner.hpp"
+
+using porla::SettingsTuner;
+using porla::SettingsTunerOptions;
+
+TEST(SettingsTunerTests, Evaluate_RaisesWithinBoundsOnceSustained)
+{
+    InMemorySession session;
+    session.m_settings.set_int(lt::settings_pack::aio_threads, 10);
+
+    SettingsTuner tuner(session, SettingsTunerOptions{
+        .bounds  = {{ "aio_threads", { 2, 16 } }},
+        .step    = 0.5,
+        .sustain = 2
+    });
+
+    tuner.Evaluate({{ "disk.queued_disk_jobs", 100 }}, 0);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::aio_threads), 10);
+
+    tuner.Evaluate({{ "disk.queued_disk_jobs", 100 }}, 0);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::aio_threads), 15);
+
+    tuner.Evaluate({{ "disk.queued_disk_jobs", 100 }}, 0);
+    tuner.Evaluate({{ "disk.queued_disk_jobs", 100 }}, 0);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::aio_threads), 16);
+
+    const auto& choice = tuner.Choices().at("aio_threads");
+
+    EXPECT_EQ(choice.value, 16);
+    EXPECT_EQ(choice.changes, 2);
+    EXPECT_EQ(choice.reason, "100 disk jobs queued for 15 threads");
+}
+
+TEST(SettingsTunerTests, Evaluate_LeavesSettingsChangedElsewhereAlone)
+{
+    InMemorySession session;
+    session.m_settings.set_int(lt::settings_pack::connections_limit, 1000);
+
+    SettingsTuner tuner(session, SettingsTunerOptions{
+        .bounds  = {{ "connections_limit", { 200, 5000 } }},
+        .sustain = 1,
+        .max_cpu = 0.5
+    });
+
+    tuner.Evaluate({}, 0.9);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::connections_limit), 750);
+
+    lt::settings_pack pack;
+    pack.set_int(lt::settings_pack::connections_limit, 3000);
+    session.ApplySettings(pack);
+
+    tuner.Evaluate({}, 0.9);
+    EXPECT_EQ(session.Settings().get_int(lt::settings_pack::connections_limit), 3000);
+    EXPECT_TRUE(tuner.Choices().at("connections_limit").released);
+}
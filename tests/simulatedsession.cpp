@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "../src/simulatedsession.hpp"
+
+namespace lt = libtorrent;
+
+using porla::SimulatedSession;
+using porla::SimulatedSessionOptions;
+
+TEST(SimulatedSessionTests, Load_GeneratesTorrents)
+{
+    boost::asio::io_context io;
+    SimulatedSession session(io, SimulatedSessionOptions{ .torrents = 100 });
+
+    session.Load();
+
+    EXPECT_EQ(session.TorrentStatuses().size(), 100);
+    EXPECT_EQ(session.Torrents().size(), 100);
+}
+
+TEST(SimulatedSessionTests, StateUpdates_UpdateStatusCacheFirst)
+{
+    boost::asio::io_context io;
+    SimulatedSession session(io, SimulatedSessionOptions{
+        .finish_rate           = 10,
+        .timer_torrent_updates = 1,
+        .torrents              = 100,
+        .update_rate           = 1000
+    });
+
+    int updated = 0;
+
+    const auto connection = session.OnStateUpdate(
+        [&](const std::vector<lt::torrent_status>& torrents)
+        {
+            for (const auto& ts : torrents)
+            {
+                const auto& cached = session.TorrentStatuses().at(ts.info_hashes);
+
+                EXPECT_EQ(cached.state, ts.state);
+                EXPECT_EQ(cached.progress, ts.progress);
+            }
+
+            updated += static_cast<int>(torrents.size());
+            io.stop();
+        });
+
+    session.Load();
+    io.run_for(std::chrono::seconds(1));
+
+    EXPECT_GT(updated, 0);
+}
+
+TEST(SimulatedSessionTests, AddAndRemove_EmitSignals)
+{
+    boost::asio::io_context io;
+    SimulatedSession session(io, SimulatedSessionOptions{ .torrents = 0 });
+
+    std::vector<lt::info_hash_t> added;
+    std::vector<lt::info_hash_t> removed;
+
+    const auto added_connection = session.OnTorrentAdded([&](auto const& ts) { added.push_back(ts.info_hashes); });
+    const auto removed_connection = session.OnTorrentRemoved([&](auto const& hash) { removed.push_back(hash); });
+
+    lt::add_torrent_params params;
+    params.name = "test";
+    params.save_path = "/tmp";
+
+    const auto hash = session.AddTorrent(params);
+    session.Remove(hash, false);
+
+    EXPECT_EQ(added, std::vector<lt::info_hash_t>({ hash }));
+    EXPECT_EQ(removed, std::vector<lt::info_hash_t>({ hash }));
+    EXPECT_TRUE(session.TorrentStatuses().empty());
+}
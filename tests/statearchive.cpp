@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../src/statearchive.hpp"
+#include "../src/torrentclientdata.hpp"
+
+namespace lt = libtorrent;
+
+using porla::StateArchive;
+using porla::TorrentClientData;
+
+static lt::add_torrent_params MakeParams(char id, const std::string& category)
+{
+    lt::add_torrent_params params;
+    params.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    params.name        = std::string("torrent-") + id;
+    params.save_path   = "/downloads";
+
+    auto client_data = new TorrentClientData();
+    client_data->category = porla::Symbol::Intern(category);
+    params.userdata = lt::client_data_t(client_data);
+
+    return params;
+}
+
+TEST(StateArchiveTests, Read_ReturnsWrittenRecords)
+{
+    auto a = MakeParams('a', "movies");
+    auto b = MakeParams('b', "music");
+
+    std::string archive;
+    StateArchive::Write(a, archive);
+    StateArchive::Write(b, archive);
+
+    delete a.userdata.get<TorrentClientData>();
+    delete b.userdata.get<TorrentClientData>();
+
+    std::vector<lt::add_torrent_params> read;
+    const auto error = StateArchive::Read(archive, [&read](lt::add_torrent_params&& p, auto&&) { read.push_back(std::move(p)); });
+
+    ASSERT_EQ(error, std::nullopt);
+    ASSERT_EQ(read.size(), 2);
+
+    EXPECT_EQ(read[0].info_hashes, a.info_hashes);
+    EXPECT_EQ(read[0].name, "torrent-a");
+    EXPECT_EQ(read[0].save_path, "/downloads");
+    EXPECT_EQ(read[0].userdata.get<TorrentClientData>()->category, porla::Symbol::Intern("movies"));
+    EXPECT_EQ(read[1].userdata.get<TorrentClientData>()->category, porla::Symbol::Intern("music"));
+
+    for (const auto& p : read) delete p.userdata.get<TorrentClientData>();
+}
+
+TEST(StateArchiveTests, Read_ForTruncatedRecord_ReturnsError)
+{
+    auto a = MakeParams('a', "movies");
+    auto b = MakeParams('b', "music");
+
+    std::string archive;
+    StateArchive::Write(a, archive);
+    StateArchive::Write(b, archive);
+    archive.resize(archive.size() - 1);
+
+    delete a.userdata.get<TorrentClientData>();
+    delete b.userdata.get<TorrentClientData>();
+
+    int records = 0;
+    const auto error = StateArchive::Read(
+        archive,
+        [&records](lt::add_torrent_params&& p, auto&&)
+        {
+            delete p.userdata.get<TorrentClientData>();
+            records++;
+        });
+
+    EXPECT_TRUE(error.has_value());
+    EXPECT_EQ(records, 1);
+}
+
+TEST(StateArchiveTests, Read_ReturnsWrittenMetadata)
+{
+    auto a = MakeParams('a', "movies");
+    auto b = MakeParams('b', "music");
+
+    std::string archive;
+    StateArchive::Write(a, archive, {{"source", "rss"}, {"score", 3}});
+    StateArchive::Write(b, archive);
+
+    delete a.userdata.get<TorrentClientData>();
+    delete b.userdata.get<TorrentClientData>();
+
+    std::vector<StateArchive::Metadata> read;
+    const auto error = StateArchive::Read(
+        archive,
+        [&read](lt::add_torrent_params&& p, StateArchive::Metadata&& metadata)
+        {
+            delete p.userdata.get<TorrentClientData>();
+            read.push_back(std::move(metadata));
+        });
+
+    ASSERT_EQ(error, std::nullopt);
+    ASSERT_EQ(read.size(), 2);
+
+    EXPECT_EQ(read[0].at("source"), "rss");
+    EXPECT_EQ(read[0].at("score"), 3);
+    EXPECT_TRUE(read[1].empty());
+}
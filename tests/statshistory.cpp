@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/statshistory.hpp"
+
+using porla::StatsHistory;
+
+static const std::vector<std::string> Metrics = { "net.recv_bytes", "peer.num_peers_connected" };
+
+TEST(StatsHistoryTests, Query_ReturnsSlotsFromTheFinestTierCoveringTheRange)
+{
+    InMemorySession session;
+    StatsHistory history(session, Metrics, {{ 1, 10 }, { 10, 10 }});
+
+    history.Record(100, {{ "net.recv_bytes", 10 }, { "peer.num_peers_connected", 2 }});
+    history.Record(102, {{ "net.recv_bytes", 30 }, { "peer.num_peers_connected", 4 }});
+
+    const auto fine = history.Query(Metrics, 100, 102);
+
+    ASSERT_TRUE(fine.has_value());
+    EXPECT_EQ(fine->resolution, 1);
+    EXPECT_EQ(fine->start, 100);
+    ASSERT_EQ(fine->values.at("net.recv_bytes").size(), 3);
+    EXPECT_EQ(fine->values.at("net.recv_bytes")[0], 10);
+    EXPECT_FALSE(fine->values.at("net.recv_bytes")[1].has_value());
+    EXPECT_EQ(fine->values.at("net.recv_bytes")[2], 30);
+
+    // Older than the 1s tier keeps, so the 10s tier is used. Counters keep the last value
+    // and gauges the mean.
+    const auto coarse = history.Query(Metrics, 50, 102);
+
+    ASSERT_TRUE(coarse.has_value());
+    EXPECT_EQ(coarse->resolution, 10);
+    EXPECT_EQ(coarse->values.at("net.recv_bytes").back(), 30);
+    EXPECT_EQ(coarse->values.at("peer.num_peers_connected").back(), 3);
+}
+
+TEST(StatsHistoryTests, Record_OverwritesSlotsOlderThanTheTier)
+{
+    InMemorySession session;
+    StatsHistory history(session, Metrics, {{ 1, 4 }});
+
+    history.Record(100, {{ "net.recv_bytes", 1 }});
+    history.Record(104, {{ "net.recv_bytes", 2 }});
+
+    const auto range = history.Query({ "net.recv_bytes" }, 0, 104);
+
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->start, 101);
+    ASSERT_EQ(range->values.at("net.recv_bytes").size(), 4);
+    EXPECT_FALSE(range->values.at("net.recv_bytes")[0].has_value());
+    EXPECT_EQ(range->values.at("net.recv_bytes")[3], 2);
+}
+
+TEST(StatsHistoryTests, Query_FailsForUnknownResolution)
+{
+    InMemorySession session;
+    StatsHistory history(session, Metrics, {{ 1, 4 }});
+
+    EXPECT_FALSE(history.Query(Metrics, 0, 10, 60).has_value());
+}
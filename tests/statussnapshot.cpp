@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+#include "inmemorysession.hpp"
+
+#include "../src/statussnapshot.hpp"
+
+namespace fs = std::filesystem;
+namespace lt = libtorrent;
+
+using porla::StatusSnapshot;
+using porla::StatusSnapshotOptions;
+
+static lt::torrent_status Status(char id, const std::string& name, float progress)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    ts.name        = name;
+    ts.save_path   = "/downloads";
+    ts.progress    = progress;
+    return ts;
+}
+
+TEST(StatusSnapshotTests, Read_SeesRecordsUpdatedInPlace)
+{
+    InMemorySession session;
+
+    const auto path = fs::temp_directory_path() / "porla-statussnapshot-test";
+
+    auto a = Status('a', "first", 0.25f);
+    auto b = Status('b', "second", 0.5f);
+
+    session.m_statuses.insert({ a.info_hashes, a });
+    session.m_statuses.insert({ b.info_hashes, b });
+
+    {
+        StatusSnapshot snapshot(session, StatusSnapshotOptions{ .path = path });
+
+        const auto before = StatusSnapshot::Read(path);
+
+        ASSERT_TRUE(before.has_value());
+        ASSERT_EQ(before->records.size(), 2);
+        EXPECT_EQ(before->sequence % 2, 0);
+        EXPECT_EQ(before->String(before->records[0].name_offset, before->records[0].name_size), "first");
+
+        // Equal strings are stored once.
+        EXPECT_EQ(before->records[0].save_path_offset, before->records[1].save_path_offset);
+
+        b.progress = 1.0f;
+        session.m_statuses[b.info_hashes] = b;
+        session.m_stateUpdate({ b });
+
+        const auto after = StatusSnapshot::Read(path);
+
+        ASSERT_TRUE(after.has_value());
+        EXPECT_GT(after->sequence, before->sequence);
+        EXPECT_FLOAT_EQ(after->records[1].progress, 1.0f);
+        EXPECT_EQ(after->String(after->records[1].name_offset, after->records[1].name_size), "second");
+    }
+
+    EXPECT_FALSE(fs::exists(path));
+}
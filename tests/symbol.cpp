@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../src/json/symbol.hpp"
+#include "../src/symbol.hpp"
+
+using porla::Symbol;
+using porla::SymbolSet;
+
+TEST(Symbol, Intern_ForEqualStrings_ReturnsSameSymbol)
+{
+    const std::string value = "movies";
+
+    EXPECT_EQ(Symbol::Intern("movies"), Symbol::Intern(value));
+    EXPECT_EQ(&Symbol::Intern("movies").str(), &Symbol::Intern(value).str());
+    EXPECT_NE(Symbol::Intern("movies"), Symbol::Intern("music"));
+}
+
+TEST(Symbol, Find_ForUnknownString_DoesNotIntern)
+{
+    EXPECT_EQ(Symbol::Find("a-value-nobody-interned"), std::nullopt);
+    EXPECT_EQ(Symbol::Find("a-value-nobody-interned"), std::nullopt);
+
+    Symbol::Intern("now-interned");
+    EXPECT_EQ(Symbol::Find("now-interned"), Symbol::Intern("now-interned"));
+}
+
+TEST(Symbol, DefaultConstructed_IsEmptyString)
+{
+    EXPECT_EQ(Symbol(), Symbol::Intern(""));
+    EXPECT_EQ(Symbol().str(), "");
+}
+
+TEST(SymbolSet, Construct_RemovesDuplicates)
+{
+    const SymbolSet tags(std::vector<std::string>{ "foo", "bar", "foo" });
+
+    EXPECT_EQ(tags.size(), 2);
+    EXPECT_TRUE(tags.contains(Symbol::Intern("foo")));
+    EXPECT_TRUE(tags.contains("bar"));
+    EXPECT_FALSE(tags.contains("baz"));
+}
+
+TEST(SymbolSet, Insert_ForExistingSymbol_ReturnsFalse)
+{
+    SymbolSet tags;
+
+    EXPECT_TRUE(tags.insert(Symbol::Intern("foo")));
+    EXPECT_FALSE(tags.insert(Symbol::Intern("foo")));
+    EXPECT_EQ(tags.size(), 1);
+}
+
+TEST(SymbolSet, Json_RoundTrips)
+{
+    const SymbolSet tags(std::vector<std::string>{ "foo", "bar" });
+
+    const nlohmann::json j = tags;
+    EXPECT_TRUE(j.is_array());
+    EXPECT_EQ(j.size(), 2);
+
+    EXPECT_EQ(j.get<SymbolSet>(), tags);
+    EXPECT_EQ(nlohmann::json(Symbol::Intern("foo")).get<Symbol>(), Symbol::Intern("foo"));
+}
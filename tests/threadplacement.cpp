@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "../src/threadplacement.hpp"
+
+using porla::ThreadPlacement;
+using porla::ThreadPlacementOptions;
+
+TEST(ThreadPlacementTests, Parse_ReadsCpuLists)
+{
+    EXPECT_EQ(ThreadPlacement::Parse("0"), (std::vector<int>{ 0 }));
+    EXPECT_EQ(ThreadPlacement::Parse("0-3,8"), (std::vector<int>{ 0, 1, 2, 3, 8 }));
+    EXPECT_EQ(ThreadPlacement::Parse("8, 2-3, 3"), (std::vector<int>{ 2, 3, 8 }));
+}
+
+TEST(ThreadPlacementTests, Parse_RejectsInvalidLists)
+{
+    EXPECT_THROW(ThreadPlacement::Parse(""), std::invalid_argument);
+    EXPECT_THROW(ThreadPlacement::Parse("a"), std::invalid_argument);
+    EXPECT_THROW(ThreadPlacement::Parse("3-1"), std::invalid_argument);
+    EXPECT_THROW(ThreadPlacement::Parse("1,"), std::invalid_argument);
+    EXPECT_THROW(ThreadPlacement::Parse("0-99999"), std::invalid_argument);
+    EXPECT_THROW(ThreadPlacement(ThreadPlacementOptions{ .io = "x" }), std::invalid_argument);
+}
+
+TEST(ThreadPlacementTests, Format_CollapsesRanges)
+{
+    EXPECT_EQ(ThreadPlacement::Format({ 0, 1, 2, 3, 8 }), "0-3,8");
+    EXPECT_EQ(ThreadPlacement::Format({ 1, 3, 5, 6 }), "1,3,5-6");
+    EXPECT_EQ(ThreadPlacement::Format({}), "");
+}
+
+TEST(ThreadPlacementTests, Place_WithoutRolesLeavesThreadsAlone)
+{
+    ThreadPlacement placement(ThreadPlacementOptions{});
+    placement.Place(ThreadPlacement::Role::Io);
+    placement.Report();
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentaggregates.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentAggregates;
+
+static lt::torrent_status MakeStatus(char id, const std::string& save_path, const std::string& tracker)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    ts.state = lt::torrent_status::downloading;
+    ts.save_path = save_path;
+    ts.current_tracker = tracker;
+    return ts;
+}
+
+TEST(TorrentAggregatesTests, StateUpdates_ReplaceWhatATorrentContributed)
+{
+    InMemorySession session;
+    TorrentAggregates aggregates(session);
+
+    auto a = MakeStatus('a', "/data", "udp://tracker.example.org:1337/announce");
+    auto b = MakeStatus('b', "/data", "https://[::1]/announce");
+
+    a.download_payload_rate = 100;
+    b.download_payload_rate = 50;
+
+    session.m_torrentAdded(a);
+    session.m_torrentAdded(b);
+
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::SavePath).at("/data").count, 2);
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::SavePath).at("/data").download_rate, 150);
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::Tracker).at("tracker.example.org").count, 1);
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::Tracker).at("[::1]").count, 1);
+
+    a.download_payload_rate = 10;
+    a.state = lt::torrent_status::seeding;
+    session.m_stateUpdate({ a });
+
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::SavePath).at("/data").download_rate, 60);
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::State).at("seeding").count, 1);
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::State).at("downloading").count, 1);
+
+    session.m_torrentRemoved(b.info_hashes);
+
+    EXPECT_FALSE(aggregates.Group(TorrentAggregates::State).contains("downloading"));
+    EXPECT_EQ(aggregates.Group(TorrentAggregates::SavePath).at("/data").count, 1);
+}
+
+TEST(TorrentAggregatesTests, Labels_AreCappedPerDimension)
+{
+    InMemorySession session;
+    TorrentAggregates aggregates(session, 1);
+
+    session.m_torrentAdded(MakeStatus('a', "/one", ""));
+    session.m_torrentAdded(MakeStatus('b', "/two", ""));
+    session.m_torrentAdded(MakeStatus('c', "/three", ""));
+
+    const auto& save_paths = aggregates.Group(TorrentAggregates::SavePath);
+
+    EXPECT_EQ(save_paths.size(), 2);
+    EXPECT_EQ(save_paths.at("/one").count, 1);
+    EXPECT_EQ(save_paths.at("other").count, 2);
+}
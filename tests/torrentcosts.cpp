@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentcosts.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentCosts;
+using porla::TorrentCostsOptions;
+using porla::TorrentCounters;
+
+static lt::info_hash_t Hash(char id)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+}
+
+TEST(TorrentCostsTests, Top_RanksTorrentsPerResource)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    TorrentCounters counters(io, {});
+    TorrentCosts costs(session, counters, {});
+
+    const auto now = std::chrono::steady_clock::now();
+
+    costs.Add({
+        { Hash('a'), TorrentCounters::Values{ .connects = 3, .disk_read = 100 } },
+        { Hash('b'), TorrentCounters::Values{ .connects = 1, .disk_read = 900 } }
+    }, std::chrono::milliseconds(1000), now);
+
+    // Peers stay counted for as long as they are connected, without new batches.
+    costs.Add({}, std::chrono::milliseconds(1000), now);
+
+    const auto disk = costs.Top(TorrentCosts::DiskRead, 10);
+
+    ASSERT_EQ(disk.size(), 2);
+    EXPECT_EQ(disk[0].info_hash, Hash('b'));
+    EXPECT_EQ(disk[0].value, 900);
+
+    const auto peers = costs.Top(TorrentCosts::Peers, 1);
+
+    ASSERT_EQ(peers.size(), 1);
+    EXPECT_EQ(peers[0].info_hash, Hash('a'));
+    EXPECT_EQ(peers[0].value, 6000);
+}
+
+TEST(TorrentCostsTests, Top_DropsCostsOlderThanTheWindow)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    TorrentCounters counters(io, {});
+    TorrentCosts costs(session, counters, TorrentCostsOptions{ .window = std::chrono::seconds(60), .slots = 3 });
+
+    const auto now = std::chrono::steady_clock::now();
+
+    costs.Add({{ Hash('a'), TorrentCounters::Values{ .uploaded = 100 } }}, std::chrono::milliseconds(1000), now);
+    costs.Add({{ Hash('b'), TorrentCounters::Values{ .uploaded = 10 } }}, std::chrono::milliseconds(1000), now + std::chrono::seconds(50));
+
+    EXPECT_EQ(costs.Top(TorrentCosts::Uploaded, 10).size(), 2);
+
+    costs.Add({}, std::chrono::milliseconds(1000), now + std::chrono::seconds(90));
+
+    const auto uploaded = costs.Top(TorrentCosts::Uploaded, 10);
+
+    ASSERT_EQ(uploaded.size(), 1);
+    EXPECT_EQ(uploaded[0].info_hash, Hash('b'));
+}
+
+TEST(TorrentCostsTests, Add_ForgetsPeersOfRemovedTorrents)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    TorrentCounters counters(io, {});
+    TorrentCosts costs(session, counters, {});
+
+    const auto now = std::chrono::steady_clock::now();
+
+    costs.Add({{ Hash('a'), TorrentCounters::Values{ .connects = 2 } }}, std::chrono::milliseconds(1000), now);
+    session.m_torrentRemoved(Hash('a'));
+    costs.Add({}, std::chrono::milliseconds(1000), now);
+
+    const auto peers = costs.Top(TorrentCosts::Peers, 10);
+
+    ASSERT_EQ(peers.size(), 1);
+    EXPECT_EQ(peers[0].value, 2000);
+}
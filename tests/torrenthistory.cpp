@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <ctime>
+
+#include "inmemorysession.hpp"
+
+#include "../src/data/migrate.hpp"
+#include "../src/data/statement.hpp"
+#include "../src/torrenthistory.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentHistory;
+
+class TorrentHistoryTests : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(sqlite3_open(":memory:", &db), SQLITE_OK);
+        ASSERT_TRUE(porla::Data::Migrate(db));
+    }
+
+    void TearDown() override
+    {
+        porla::Data::Statement::ClearCache(db);
+        sqlite3_close(db);
+    }
+
+    static lt::torrent_status MakeStatus(std::int64_t downloaded, std::int64_t uploaded)
+    {
+        lt::torrent_status ts;
+        ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, 'a').c_str()));
+        ts.all_time_download = downloaded;
+        ts.all_time_upload = uploaded;
+        return ts;
+    }
+
+    boost::asio::io_context io;
+    InMemorySession session;
+    sqlite3* db = nullptr;
+};
+
+TEST_F(TorrentHistoryTests, StateUpdates_AddDeltasToTheCurrentBucket)
+{
+    TorrentHistory history(io, session, porla::TorrentHistoryOptions{ .db = db });
+
+    const auto ts = MakeStatus(100, 10);
+    const std::int64_t now = std::time(nullptr);
+
+    session.m_torrentAdded(ts);
+    session.m_stateUpdate({ MakeStatus(150, 30) });
+
+    auto pending = history.Get(ts.info_hashes, TorrentHistory::Period::Hourly, now - 3600, now);
+
+    ASSERT_EQ(pending.size(), 1);
+    EXPECT_EQ(pending[0].downloaded, 50);
+    EXPECT_EQ(pending[0].uploaded, 20);
+
+    // Flushed buckets are summed with whatever came after.
+    history.Flush();
+    session.m_stateUpdate({ MakeStatus(160, 30) });
+
+    const auto daily = history.Get(ts.info_hashes, TorrentHistory::Period::Daily, now - 86400, now);
+
+    ASSERT_EQ(daily.size(), 1);
+    EXPECT_EQ(daily[0].downloaded, 60);
+    EXPECT_EQ(daily[0].uploaded, 20);
+}
+
+TEST_F(TorrentHistoryTests, Removed_DeletesTheHistory)
+{
+    TorrentHistory history(io, session, porla::TorrentHistoryOptions{ .db = db });
+
+    const auto ts = MakeStatus(0, 0);
+    const std::int64_t now = std::time(nullptr);
+
+    session.m_torrentAdded(ts);
+    session.m_stateUpdate({ MakeStatus(10, 0) });
+    history.Flush();
+
+    session.m_torrentRemoved(ts.info_hashes);
+
+    EXPECT_TRUE(history.Get(ts.info_hashes, TorrentHistory::Period::Hourly, now - 3600, now).empty());
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <string>
+
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/create_torrent.hpp>
+
+#include "../src/torrentinfocache.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentInfoCache;
+using porla::TorrentInfoCacheOptions;
+
+static std::string TorrentFile(const std::string& tracker)
+{
+    lt::file_storage storage;
+    storage.add_file("Synthetic.Torrent/file.bin", 4 << 20);
+
+    lt::create_torrent ct(storage, 1 << 20, lt::create_torrent::v1_only);
+    ct.add_tracker(tracker, 0);
+
+    for (lt::piece_index_t i(0); i < lt::piece_index_t(ct.num_pieces()); i++)
+    {
+        ct.set_hash(i, lt::sha1_hash(std::string(20, 'a').c_str()));
+    }
+
+    std::string data;
+    lt::bencode(std::back_inserter(data), ct.generate());
+    return data;
+}
+
+TEST(TorrentInfoCacheTests, Parse_AddedAgain_IsTakenFromCache)
+{
+    TorrentInfoCache cache;
+
+    const auto data  = TorrentFile("https://tracker.example.org/announce");
+    const auto first = cache.Parse(lt::info_hash_t(), data);
+
+    ASSERT_NE(first.ti, nullptr);
+
+    const auto hash   = first.ti->info_hashes();
+    const auto parsed = cache.Parse(hash, data);
+    const auto cached = cache.Parse(hash, data);
+
+    EXPECT_FALSE(parsed.cached);
+    ASSERT_TRUE(cached.cached);
+    // A copy every time, since the session may change the one it is given.
+    EXPECT_NE(cached.ti, parsed.ti);
+    EXPECT_EQ(cached.ti->info_hashes(), hash);
+
+    const auto stats = cache.GetStats();
+
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.parse_seconds.Count(), 2);
+}
+
+TEST(TorrentInfoCacheTests, Parse_OtherFileWithSameInfoHash_IsParsedAgain)
+{
+    TorrentInfoCache cache;
+
+    const auto a = TorrentFile("https://a.example.org/announce");
+    const auto b = TorrentFile("https://b.example.org/announce");
+
+    const auto hash = cache.Parse(lt::info_hash_t(), a).ti->info_hashes();
+
+    cache.Parse(hash, a);
+
+    const auto other = cache.Parse(hash, b);
+
+    ASSERT_NE(other.ti, nullptr);
+    EXPECT_FALSE(other.cached);
+    EXPECT_EQ(other.ti->trackers().front().url, "https://b.example.org/announce");
+}
+
+TEST(TorrentInfoCacheTests, Parse_OverMaxSize_IsRejected)
+{
+    TorrentInfoCache cache(TorrentInfoCacheOptions{ .max_size = 16 });
+
+    const auto result = cache.Parse(lt::info_hash_t(), TorrentFile("https://tracker.example.org/announce"));
+
+    EXPECT_EQ(result.ti, nullptr);
+    EXPECT_EQ(result.error, TorrentInfoCache::Error::TooLarge);
+    EXPECT_EQ(cache.GetStats().rejected, 1);
+    EXPECT_EQ(cache.GetStats().parse_seconds.Count(), 0);
+}
+
+TEST(TorrentInfoCacheTests, Load_ReportsWhatFailed)
+{
+    EXPECT_EQ(TorrentInfoCache::Load("not bencoded", {}).error, TorrentInfoCache::Error::Decode);
+    EXPECT_EQ(TorrentInfoCache::Load("d3:fooi1ee", {}).error, TorrentInfoCache::Error::Info);
+}
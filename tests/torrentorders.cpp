@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentorders.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentOrders;
+
+static lt::torrent_status MakeStatus(char id, int queue_position, std::int64_t size)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    ts.name = std::string(1, id);
+    ts.queue_position = lt::queue_position_t{queue_position};
+    ts.has_metadata = true;
+    ts.total_wanted = size;
+    return ts;
+}
+
+static std::string Names(const TorrentOrders& orders, TorrentOrders::Field field, bool asc, const std::optional<TorrentOrders::After>& after = std::nullopt, std::size_t skip = 0)
+{
+    std::string names;
+
+    orders.Walk(field, asc, after, skip, [&](const lt::info_hash_t& hash)
+    {
+        names += static_cast<char>(hash.v1[0]);
+        return true;
+    });
+
+    return names;
+}
+
+TEST(TorrentOrdersTests, Walk_BreaksTiesOnHashInBothDirections)
+{
+    InMemorySession session;
+    TorrentOrders orders(session);
+
+    session.m_torrentAdded(MakeStatus('c', 0, 10));
+    session.m_torrentAdded(MakeStatus('a', 1, 20));
+    session.m_torrentAdded(MakeStatus('b', 2, 10));
+
+    EXPECT_EQ(Names(orders, TorrentOrders::Size, true), "bca");
+    EXPECT_EQ(Names(orders, TorrentOrders::Size, false), "abc");
+    EXPECT_EQ(Names(orders, TorrentOrders::Size, false, std::nullopt, 1), "bc");
+
+    const auto b = MakeStatus('b', 2, 10);
+    EXPECT_EQ(Names(orders, TorrentOrders::Size, false, TorrentOrders::After{ "", 10, b.info_hashes }), "c");
+}
+
+TEST(TorrentOrdersTests, Walk_PutsUnqueuedTorrentsLast)
+{
+    InMemorySession session;
+    TorrentOrders orders(session);
+
+    session.m_torrentAdded(MakeStatus('d', -1, 0));
+    session.m_torrentAdded(MakeStatus('b', 1, 0));
+    session.m_torrentAdded(MakeStatus('c', -1, 0));
+    session.m_torrentAdded(MakeStatus('a', 0, 0));
+
+    EXPECT_EQ(Names(orders, TorrentOrders::QueuePosition, true), "abcd");
+
+    const auto c = MakeStatus('c', -1, 0);
+    EXPECT_EQ(Names(orders, TorrentOrders::QueuePosition, true, TorrentOrders::After{ "", -1, c.info_hashes }), "d");
+
+    // Seeding moves a torrent out of the queue.
+    session.m_stateUpdate({ MakeStatus('a', -1, 0) });
+    EXPECT_EQ(Names(orders, TorrentOrders::QueuePosition, true), "bacd");
+
+    session.m_torrentRemoved(c.info_hashes);
+    EXPECT_EQ(Names(orders, TorrentOrders::QueuePosition, true), "bad");
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/query/pql.hpp"
+#include "../src/torrentrates.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentRates;
+
+static lt::torrent_status MakeStatus(int download_rate, std::int64_t remaining)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, 'a').c_str()));
+    ts.download_payload_rate = download_rate;
+    ts.total_wanted = remaining;
+    ts.total_wanted_done = 0;
+    return ts;
+}
+
+TEST(TorrentRatesTests, Sample_WeighsByTimeAndSettlesOnLastRate)
+{
+    InMemorySession session;
+    TorrentRates rates(session, porla::TorrentRatesOptions{ .half_life = std::chrono::seconds(10) });
+
+    const auto start = std::chrono::steady_clock::now();
+
+    auto ts = MakeStatus(1000, 100000);
+    session.m_statuses[ts.info_hashes] = ts;
+
+    rates.Sample({ ts }, start);
+    EXPECT_DOUBLE_EQ(rates.Get(ts.info_hashes).download, 1000);
+
+    // Half of the way after one half life, whichever way the time is split up.
+    ts.download_payload_rate = 3000;
+    rates.Sample({ ts }, start + std::chrono::seconds(10));
+    EXPECT_NEAR(rates.Get(ts.info_hashes).download, 2000, 1);
+    EXPECT_NEAR(rates.ETA(ts).count(), 50, 1);
+
+    // Without the torrent in the updates, the estimate still moves towards its last rate.
+    rates.Sample({}, start + std::chrono::seconds(20));
+    EXPECT_NEAR(rates.Get(ts.info_hashes).download, 2500, 1);
+
+    rates.Sample({}, start + std::chrono::seconds(1000));
+    EXPECT_DOUBLE_EQ(rates.Get(ts.info_hashes).download, 3000);
+}
+
+TEST(TorrentRatesTests, Query_FiltersOnSmoothedRates)
+{
+    InMemorySession session;
+    TorrentRates rates(session);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    auto ts = MakeStatus(10000, 100000);
+    session.m_statuses[ts.info_hashes] = ts;
+    rates.Sample({ ts }, start);
+
+    // A drop to nothing for one update leaves the estimate, and the ETA, about where it was.
+    ts.download_payload_rate = 0;
+    rates.Sample({ ts }, start + std::chrono::seconds(1));
+
+    const auto filter = porla::Query::PQL::Parse("download_rate_avg > 5000 and eta_avg < 60");
+
+    EXPECT_TRUE(filter->Includes(ts, rates));
+    EXPECT_FALSE(filter->Includes(ts));
+}
+
+TEST(TorrentRatesTests, Remove_DropsEstimate)
+{
+    InMemorySession session;
+    TorrentRates rates(session);
+
+    auto ts = MakeStatus(1000, 0);
+    session.m_statuses[ts.info_hashes] = ts;
+    rates.Sample({ ts }, std::chrono::steady_clock::now());
+
+    session.m_torrentRemoved(ts.info_hashes);
+
+    EXPECT_DOUBLE_EQ(rates.Get(ts.info_hashes).download, 0);
+    EXPECT_EQ(rates.Memory().objects, 0);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "../src/torrentregistry.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentRegistry;
+
+static lt::info_hash_t Hash(int i)
+{
+    lt::sha1_hash hash;
+    // Equal leading bytes, so every hash lands in the same probe sequence.
+    hash[19] = static_cast<std::uint8_t>(i);
+    return lt::info_hash_t(hash);
+}
+
+TEST(TorrentRegistry, Find_ForMissingKey_ReturnsEnd)
+{
+    TorrentRegistry<int> registry;
+    registry.insert({ Hash(1), 1 });
+
+    EXPECT_EQ(registry.find(Hash(2)), registry.end());
+    EXPECT_FALSE(registry.contains(Hash(2)));
+}
+
+TEST(TorrentRegistry, Erase_WithCollidingKeys_KeepsOthersReachable)
+{
+    TorrentRegistry<int> registry;
+
+    for (int i = 0; i < 100; i++) registry.insert({ Hash(i), i });
+    for (int i = 0; i < 100; i += 2) EXPECT_EQ(registry.erase(Hash(i)), 1);
+
+    EXPECT_EQ(registry.size(), 50);
+
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(registry.contains(Hash(i)), i % 2 == 1);
+
+        if (i % 2 == 1)
+        {
+            EXPECT_EQ(registry.at(Hash(i)), i);
+        }
+    }
+}
+
+TEST(TorrentRegistry, EraseIterator_WhileIterating_VisitsEveryTorrent)
+{
+    TorrentRegistry<int> registry;
+
+    for (int i = 0; i < 10; i++) registry.insert({ Hash(i), i });
+
+    int visited = 0;
+
+    for (auto it = registry.begin(); it != registry.end();)
+    {
+        visited++;
+        it = it->second < 5 ? registry.erase(it) : std::next(it);
+    }
+
+    EXPECT_EQ(visited, 10);
+    EXPECT_EQ(registry.size(), 5);
+}
+
+TEST(TorrentRegistry, InsertOrAssign_ForExistingKey_ReplacesValue)
+{
+    TorrentRegistry<int> registry;
+    registry.insert({ Hash(1), 1 });
+
+    EXPECT_FALSE(registry.insert_or_assign(Hash(1), 2).second);
+    EXPECT_FALSE(registry.insert({ Hash(1), 3 }).second);
+    EXPECT_EQ(registry.at(Hash(1)), 2);
+    EXPECT_EQ(registry.size(), 1);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentrevisions.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentRevisions;
+
+static lt::torrent_status MakeStatus(char id)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    return ts;
+}
+
+static std::vector<lt::info_hash_t> Changed(const TorrentRevisions& revisions, std::uint64_t since)
+{
+    std::vector<lt::info_hash_t> result;
+    revisions.ChangedSince(since, [&](auto const& hash) { result.push_back(hash); });
+    return result;
+}
+
+TEST(TorrentRevisionsTests, ChangedSince_ReturnsOnlyNewerChanges)
+{
+    InMemorySession session;
+    TorrentRevisions revisions(session);
+
+    const auto a = MakeStatus('a');
+    const auto b = MakeStatus('b');
+
+    session.m_torrentAdded(a);
+    const auto rev = revisions.Current();
+    session.m_stateUpdate({ b });
+
+    EXPECT_EQ(Changed(revisions, 0), std::vector<lt::info_hash_t>({ a.info_hashes, b.info_hashes }));
+    EXPECT_EQ(Changed(revisions, rev), std::vector<lt::info_hash_t>({ b.info_hashes }));
+    EXPECT_TRUE(Changed(revisions, revisions.Current()).empty());
+}
+
+TEST(TorrentRevisionsTests, ChangedSince_IncludesClientDataChanges)
+{
+    InMemorySession session;
+    TorrentRevisions revisions(session);
+
+    const auto a = MakeStatus('a');
+    const auto b = MakeStatus('b');
+
+    session.m_torrentAdded(a);
+    session.m_torrentAdded(b);
+    const auto rev = revisions.Current();
+    session.m_clientDataChanged({ b.info_hashes });
+
+    EXPECT_EQ(Changed(revisions, rev), std::vector<lt::info_hash_t>({ b.info_hashes }));
+}
+
+TEST(TorrentRevisionsTests, RemovedSince_ReturnsRemovedTorrents)
+{
+    InMemorySession session;
+    TorrentRevisions revisions(session);
+
+    const auto a = MakeStatus('a');
+
+    session.m_torrentAdded(a);
+    const auto rev = revisions.Current();
+    session.m_torrentRemoved(a.info_hashes);
+
+    std::vector<lt::info_hash_t> removed;
+
+    EXPECT_TRUE(revisions.RemovedSince(rev, [&](auto const& hash) { removed.push_back(hash); }));
+    EXPECT_EQ(removed, std::vector<lt::info_hash_t>({ a.info_hashes }));
+    EXPECT_TRUE(Changed(revisions, 0).empty());
+}
+
+TEST(TorrentRevisionsTests, RemovedSince_FailsWhenRevisionIsTooOld)
+{
+    InMemorySession session;
+    TorrentRevisions revisions(session, 1);
+
+    session.m_torrentRemoved(MakeStatus('a').info_hashes);
+    session.m_torrentRemoved(MakeStatus('b').info_hashes);
+
+    EXPECT_FALSE(revisions.RemovedSince(0, [](auto const&) {}));
+    EXPECT_TRUE(revisions.RemovedSince(revisions.Current() - 1, [](auto const&) {}));
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentssnapshot.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentsSnapshot;
+
+static lt::info_hash_t MakeHash(char id)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+}
+
+TEST(TorrentsSnapshotTests, Add_PublishesOneCopyPerBurst)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    TorrentsSnapshot snapshot(io, session);
+
+    const auto before = snapshot.Current();
+    EXPECT_TRUE(before->torrents.empty());
+
+    lt::torrent_status ts;
+
+    for (const char id : { 'a', 'b' })
+    {
+        ts.info_hashes = MakeHash(id);
+        session.m_torrents.insert({ ts.info_hashes, lt::torrent_handle() });
+        session.m_torrentAdded(ts);
+    }
+
+    // Nothing is published until the io loop turns.
+    EXPECT_EQ(snapshot.Current(), before);
+
+    io.run();
+
+    const auto after = snapshot.Current();
+    EXPECT_EQ(after->torrents.size(), 2);
+    EXPECT_EQ(after->version, session.m_torrents.version());
+
+    // Readers still holding the old copy see it unchanged.
+    EXPECT_TRUE(before->torrents.empty());
+}
+
+TEST(TorrentsSnapshotTests, StateUpdate_PublishesChangesWithoutSignal)
+{
+    boost::asio::io_context io;
+    InMemorySession session;
+    TorrentsSnapshot snapshot(io, session);
+
+    session.m_torrents.insert({ MakeHash('a'), lt::torrent_handle() });
+
+    const auto unchanged = snapshot.Current();
+    session.m_stateUpdate({});
+
+    EXPECT_NE(snapshot.Current(), unchanged);
+    EXPECT_TRUE(snapshot.Current()->torrents.contains(MakeHash('a')));
+
+    // Without changes, the same copy is kept.
+    const auto current = snapshot.Current();
+    session.m_stateUpdate({});
+
+    EXPECT_EQ(snapshot.Current(), current);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentstats.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentStats;
+
+static lt::torrent_status MakeStatus(char id, const std::string& save_path, int download_rate)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    ts.state = lt::torrent_status::downloading;
+    ts.save_path = save_path;
+    ts.download_payload_rate = download_rate;
+    return ts;
+}
+
+TEST(TorrentStatsTests, Distribution_KeepsExactSumsAndCloseQuantiles)
+{
+    TorrentStats::Distribution distribution;
+
+    for (std::uint64_t value = 1; value <= 100; value++)
+    {
+        distribution.Add(value, 1);
+    }
+
+    distribution.Add(100, -1);
+
+    EXPECT_EQ(distribution.Count(), 99);
+    EXPECT_EQ(distribution.Sum(), 4950);
+    EXPECT_EQ(distribution.Min(), 1);
+    EXPECT_NEAR(distribution.Max(), 99, 99 / 4);
+    EXPECT_NEAR(distribution.Quantile(0.5), 50, 50 / 4);
+}
+
+TEST(TorrentStatsTests, StateUpdates_MoveTorrentsBetweenGroups)
+{
+    InMemorySession session;
+    TorrentStats stats(session);
+
+    auto a = MakeStatus('a', "/data", 100);
+    auto b = MakeStatus('b', "/data", 50);
+
+    session.m_torrentAdded(a);
+    session.m_torrentAdded(b);
+
+    const auto& groups = stats.Current();
+
+    EXPECT_EQ(groups.total.count, 2);
+    EXPECT_EQ(groups.total.metrics[TorrentStats::DownloadRate].Sum(), 150);
+    EXPECT_EQ(groups.dimensions[TorrentStats::SavePath].at("/data").count, 2);
+
+    a.state = lt::torrent_status::seeding;
+    a.download_payload_rate = 0;
+    session.m_stateUpdate({ a });
+
+    EXPECT_EQ(groups.total.metrics[TorrentStats::DownloadRate].Sum(), 50);
+    EXPECT_EQ(groups.dimensions[TorrentStats::State].at("seeding").count, 1);
+    EXPECT_EQ(groups.dimensions[TorrentStats::State].at("downloading").count, 1);
+
+    session.m_torrentRemoved(b.info_hashes);
+
+    EXPECT_EQ(groups.total.count, 1);
+    EXPECT_FALSE(groups.dimensions[TorrentStats::State].contains("downloading"));
+}
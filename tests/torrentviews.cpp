@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/torrentviews.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TorrentViews;
+
+static lt::torrent_status MakeStatus(char id, lt::torrent_status::state_t state)
+{
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+    ts.state = state;
+    return ts;
+}
+
+TEST(TorrentViewsTests, StateUpdates_KeepViewsCurrent)
+{
+    InMemorySession session;
+
+    auto a = MakeStatus('a', lt::torrent_status::seeding);
+    auto b = MakeStatus('b', lt::torrent_status::downloading);
+
+    session.m_statuses = {{ a.info_hashes, a }, { b.info_hashes, b }};
+
+    TorrentViews views(session, {{ "seeding", "is:seeding" }});
+
+    EXPECT_EQ(*views.Find("seeding"), TorrentViews::HashSet({ a.info_hashes }));
+
+    b.state = lt::torrent_status::seeding;
+    session.m_statuses[b.info_hashes] = b;
+    session.m_stateUpdate({ b });
+
+    EXPECT_EQ(*views.Find("seeding"), TorrentViews::HashSet({ a.info_hashes, b.info_hashes }));
+
+    session.m_statuses.erase(a.info_hashes);
+    session.m_torrentRemoved(a.info_hashes);
+
+    EXPECT_EQ(*views.Find("seeding"), TorrentViews::HashSet({ b.info_hashes }));
+    EXPECT_EQ(views.Find("missing"), nullptr);
+}
+
+TEST(TorrentViewsTests, Constructor_ThrowsOnInvalidQuery)
+{
+    InMemorySession session;
+    EXPECT_THROW(TorrentViews(session, {{ "broken", "name =" }}), porla::Query::QueryError);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "inmemorysession.hpp"
+
+#include "../src/trackerregistry.hpp"
+
+using porla::ISession;
+using porla::TrackerRegistry;
+
+static ISession::TrackerAnnounce Announce(ISession::TrackerAnnounce::Kind kind, const std::string& url, const std::string& message = "")
+{
+    return ISession::TrackerAnnounce{ .kind = kind, .url = url, .message = message };
+}
+
+TEST(TrackerRegistryTests, Announces_AreCountedPerHost)
+{
+    InMemorySession session;
+    TrackerRegistry registry(session);
+
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Sent, "udp://tracker.example.org:1337/announce"));
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Replied, "udp://tracker.example.org:1337/announce"));
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Sent, "https://tracker.example.org/announce"));
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Failed, "https://tracker.example.org/announce", "unregistered torrent"));
+
+    ASSERT_EQ(registry.Hosts().size(), 1);
+
+    const auto& stats = registry.Hosts().at("tracker.example.org");
+
+    EXPECT_EQ(stats.announces, 2);
+    EXPECT_EQ(stats.replies, 1);
+    EXPECT_EQ(stats.failures, 1);
+    EXPECT_EQ(stats.errors.at("unregistered torrent"), 1);
+    EXPECT_EQ(stats.last_error, "unregistered torrent");
+    EXPECT_EQ(stats.latency.Count(), 2);
+}
+
+TEST(TrackerRegistryTests, Hosts_BeyondMax_AreCountedAsOther)
+{
+    InMemorySession session;
+    TrackerRegistry registry(session, porla::TrackerRegistryOptions{ .max_hosts = 1 });
+
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Sent, "udp://a.example.org/announce"));
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Sent, "udp://b.example.org/announce"));
+    session.m_trackerAnnounce(Announce(ISession::TrackerAnnounce::Sent, "udp://c.example.org/announce"));
+
+    ASSERT_EQ(registry.Hosts().size(), 2);
+    EXPECT_EQ(registry.Hosts().at("a.example.org").announces, 1);
+    EXPECT_EQ(registry.Hosts().at("other").announces, 2);
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../src/trigramindex.hpp"
+
+namespace lt = libtorrent;
+
+using porla::TrigramIndex;
+
+static lt::info_hash_t Hash(char id)
+{
+    return lt::info_hash_t(lt::sha1_hash(std::string(20, id).c_str()));
+}
+
+TEST(TrigramIndexTests, Candidates_IntersectsTheTrigramsOfTheNeedle)
+{
+    TrigramIndex index;
+
+    index.Insert(Hash('a'), "Debian.Netinst.iso");
+    index.Insert(Hash('b'), "ubuntu-desktop.iso");
+    index.Insert(Hash('c'), "netbsd");
+
+    EXPECT_EQ(index.Candidates("NETINST"), TrigramIndex::HashSet({ Hash('a') }));
+    EXPECT_EQ(index.Candidates(".iso"), TrigramIndex::HashSet({ Hash('a'), Hash('b') }));
+    EXPECT_EQ(index.Candidates("fedora"), TrigramIndex::HashSet());
+
+    // Too short to look up.
+    EXPECT_EQ(index.Candidates("is"), std::nullopt);
+}
+
+TEST(TrigramIndexTests, Erase_ReusesTheTorrentsNumber)
+{
+    TrigramIndex index;
+
+    index.Insert(Hash('a'), "first name");
+    index.Insert(Hash('b'), "second name");
+    index.Erase(Hash('a'), "first name");
+    index.Insert(Hash('c'), "third name");
+
+    EXPECT_EQ(index.Candidates("first"), TrigramIndex::HashSet());
+    EXPECT_EQ(index.Candidates("name"), TrigramIndex::HashSet({ Hash('b'), Hash('c') }));
+}
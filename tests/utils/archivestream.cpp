@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <zlib.h>
+
+#include "../../src/utils/archivestream.hpp"
+#include "../../src/utils/zip.hpp"
+
+namespace fs = std::filesystem;
+
+using porla::Utils::ArchiveStream;
+using porla::Utils::Zip;
+
+class ArchiveStreamTests : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        dir = fs::temp_directory_path() / "porla-archivestream-test";
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+
+        // Larger than a part, so entries are split across them.
+        large = std::string(300 * 1024, '\0');
+        for (std::size_t i = 0; i < large.size(); i++) large[i] = static_cast<char>(i * 31 % 251);
+
+        Write("a.txt", "hello");
+        Write("b.bin", large);
+        Write("empty", "");
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(dir);
+    }
+
+    void Write(const std::string& name, const std::string& data)
+    {
+        std::ofstream(dir / name, std::ios::binary) << data;
+    }
+
+    std::vector<ArchiveStream::Entry> Entries(const std::string& long_name = "dir/b.bin")
+    {
+        return {
+            { .name = "dir/a.txt", .path = dir / "a.txt", .size = 5,            .mtime = 1700000000 },
+            { .name = long_name,   .path = dir / "b.bin", .size = large.size(), .mtime = 1700000000 },
+            { .name = "dir/empty", .path = dir / "empty", .size = 0,            .mtime = 1700000000 }
+        };
+    }
+
+    static std::string Read(ArchiveStream& stream)
+    {
+        std::string archive;
+        std::string chunk;
+
+        while (stream.Next(chunk))
+        {
+            archive += chunk;
+            chunk.clear();
+        }
+
+        return archive + chunk;
+    }
+
+    fs::path dir;
+    std::string large;
+};
+
+TEST_F(ArchiveStreamTests, Zip_IsReadableWithCrcs)
+{
+    ArchiveStream stream(ArchiveStream::Format::Zip, Entries());
+
+    const auto archive = Read(stream);
+    const auto entries = Zip::Entries(archive);
+
+    ASSERT_EQ(entries.size(), 3);
+
+    EXPECT_EQ(entries[0].name, "dir/a.txt");
+    EXPECT_EQ(entries[0].method, Zip::Stored);
+    EXPECT_EQ(Zip::Inflate(entries[0]), "hello");
+    EXPECT_EQ(entries[0].crc32, crc32(0, reinterpret_cast<const Bytef*>("hello"), 5));
+
+    EXPECT_EQ(entries[1].name, "dir/b.bin");
+    EXPECT_EQ(Zip::Inflate(entries[1]), large);
+    EXPECT_EQ(entries[1].crc32, crc32(0, reinterpret_cast<const Bytef*>(large.data()), large.size()));
+
+    EXPECT_EQ(entries[2].name, "dir/empty");
+    EXPECT_EQ(entries[2].size, 0);
+}
+
+TEST_F(ArchiveStreamTests, Tar_WritesUstarAndPaxHeaders)
+{
+    const std::string long_name = std::string(120, 'x') + "/" + std::string(120, 'y');
+
+    ArchiveStream stream(ArchiveStream::Format::Tar, Entries(long_name));
+
+    const auto archive = Read(stream);
+
+    EXPECT_EQ(archive.size() % 512, 0);
+    EXPECT_EQ(archive.substr(0, 9), "dir/a.txt");
+    EXPECT_EQ(archive.substr(257, 5), "ustar");
+    EXPECT_EQ(archive.substr(124, 11), "00000000005");
+    EXPECT_EQ(archive.substr(512, 5), "hello");
+
+    // The long name goes in a pax header before the entry.
+    EXPECT_EQ(archive[1024 + 156], 'x');
+    EXPECT_NE(archive.find("path=" + long_name + "\n"), std::string::npos);
+
+    // Ends with two zero blocks.
+    EXPECT_EQ(archive.substr(archive.size() - 1024), std::string(1024, '\0'));
+}
+
+TEST_F(ArchiveStreamTests, Next_ThrowsForShortFiles)
+{
+    auto entries = Entries();
+    entries[0].size = 50;
+
+    ArchiveStream stream(ArchiveStream::Format::Zip, entries);
+
+    EXPECT_THROW(Read(stream), std::runtime_error);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../src/utils/base64.hpp"
+
+using porla::Utils::Base64;
+
+TEST(Base64, DecodeInPlace_ForEveryPadding_ReturnsOriginal)
+{
+    const std::vector<std::pair<std::string, std::string>> vectors = {
+        {"", ""},
+        {"Zg==", "f"},
+        {"Zm8=", "fo"},
+        {"Zm9v", "foo"},
+        {"Zm9vYg==", "foob"},
+        {"Zm9vYmE=", "fooba"},
+        {"Zm9vYmFy", "foobar"}
+    };
+
+    for (const auto& [encoded, original] : vectors)
+    {
+        std::string data = encoded;
+        EXPECT_TRUE(Base64::DecodeInPlace(data));
+        EXPECT_EQ(data, original);
+    }
+}
+
+TEST(Base64, DecodeInPlace_ForInvalidInput_ReturnsFalse)
+{
+    std::string length = "Zm9";
+    std::string chars  = "Zm9*";
+    std::string pad    = "Z=9v";
+
+    EXPECT_FALSE(Base64::DecodeInPlace(length));
+    EXPECT_FALSE(Base64::DecodeInPlace(chars));
+    EXPECT_FALSE(Base64::DecodeInPlace(pad));
+}
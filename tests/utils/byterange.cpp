@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include "../../src/utils/byterange.hpp"
+
+using porla::Utils::ByteRange;
+
+TEST(ByteRange, Parse_ReadsSingleRanges)
+{
+    ByteRange range;
+
+    EXPECT_EQ(ByteRange::Parse("bytes=0-99", 1000, range), ByteRange::Result::Partial);
+    EXPECT_EQ(range.offset, 0);
+    EXPECT_EQ(range.length, 100);
+
+    EXPECT_EQ(ByteRange::Parse("bytes=900-", 1000, range), ByteRange::Result::Partial);
+    EXPECT_EQ(range.offset, 900);
+    EXPECT_EQ(range.length, 100);
+
+    EXPECT_EQ(ByteRange::Parse("bytes=-300", 1000, range), ByteRange::Result::Partial);
+    EXPECT_EQ(range.offset, 700);
+    EXPECT_EQ(range.length, 300);
+
+    // Ends past the body are cut to its size.
+    EXPECT_EQ(ByteRange::Parse("bytes=500-5000", 1000, range), ByteRange::Result::Partial);
+    EXPECT_EQ(range.offset, 500);
+    EXPECT_EQ(range.length, 500);
+}
+
+TEST(ByteRange, Parse_IgnoresOtherRanges)
+{
+    ByteRange range;
+
+    EXPECT_EQ(ByteRange::Parse("", 1000, range), ByteRange::Result::Full);
+    EXPECT_EQ(ByteRange::Parse("items=0-1", 1000, range), ByteRange::Result::Full);
+    EXPECT_EQ(ByteRange::Parse("bytes=0-1,5-9", 1000, range), ByteRange::Result::Full);
+    EXPECT_EQ(ByteRange::Parse("bytes=9-5", 1000, range), ByteRange::Result::Full);
+    EXPECT_EQ(ByteRange::Parse("bytes=a-b", 1000, range), ByteRange::Result::Full);
+}
+
+TEST(ByteRange, Parse_RejectsRangesPastTheEnd)
+{
+    ByteRange range;
+
+    EXPECT_EQ(ByteRange::Parse("bytes=1000-", 1000, range), ByteRange::Result::Unsatisfiable);
+    EXPECT_EQ(ByteRange::Parse("bytes=-0", 1000, range), ByteRange::Result::Unsatisfiable);
+    EXPECT_EQ(ByteRange::Parse("bytes=-10", 0, range), ByteRange::Result::Unsatisfiable);
+}
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+
+#include "../../src/utils/encoding.hpp"
+
+using porla::Utils::Encoding;
+
+TEST(Encoding, FromMediaType_ForAcceptHeaders_ReturnsCorrectType)
+{
+    EXPECT_EQ(Encoding::FromMediaType(""), Encoding::Type::Json);
+    EXPECT_EQ(Encoding::FromMediaType("*/*"), Encoding::Type::Json);
+    EXPECT_EQ(Encoding::FromMediaType("application/json"), Encoding::Type::Json);
+    EXPECT_EQ(Encoding::FromMediaType("application/cbor"), Encoding::Type::Cbor);
+    EXPECT_EQ(Encoding::FromMediaType("application/msgpack, application/json;q=0.5"), Encoding::Type::MsgPack);
+    EXPECT_EQ(Encoding::FromMediaType("application/x-msgpack"), Encoding::Type::MsgPack);
+}
+
+TEST(Encoding, Dump_ForEveryType_RoundTrips)
+{
+    const nlohmann::json j = {
+        {"id", 1},
+        {"result", {{"torrents", {{{"name", "foo"}, {"progress", 0.5}}}}}}
+    };
+
+    for (const auto type : { Encoding::Type::Cbor, Encoding::Type::Json, Encoding::Type::MsgPack })
+    {
+        EXPECT_EQ(Encoding::Parse(Encoding::Dump(j, type), type), j);
+    }
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "../../src/utils/feed.hpp"
+
+using porla::Utils::Feed;
+
+TEST(FeedTests, Parse_ReadsRssItems)
+{
+    const auto items = Feed::Parse(R"(<?xml version="1.0" encoding="UTF-8"?>
+<rss version="2.0" xmlns:torznab="http://torznab.com/schemas/2015/feed">
+  <channel>
+    <title>Indexer</title>
+    <link>https://example.com</link>
+    <item>
+      <title><![CDATA[Ubuntu 24.04 <x64>]]></title>
+      <guid isPermaLink="false">abc-1</guid>
+      <link>https://example.com/details/1</link>
+      <enclosure url="https://example.com/get/1.torrent?a=1&amp;b=2" type="application/x-bittorrent" />
+    </item>
+    <!-- <item><title>Commented</title></item> -->
+    <item>
+      <title>Debian &amp; friends</title>
+      <link>https://example.com/get/2.torrent</link>
+      <torznab:attr name="magneturl" value="magnet:?xt=urn:btih:aaaa&amp;dn=debian" />
+    </item>
+  </channel>
+</rss>)");
+
+    ASSERT_EQ(items.size(), 2);
+    EXPECT_EQ(items[0].id, "abc-1");
+    EXPECT_EQ(items[0].title, "Ubuntu 24.04 <x64>");
+    EXPECT_EQ(items[0].link, "https://example.com/get/1.torrent?a=1&b=2");
+    EXPECT_EQ(items[1].id, "magnet:?xt=urn:btih:aaaa&dn=debian");
+    EXPECT_EQ(items[1].title, "Debian & friends");
+    EXPECT_EQ(items[1].link, "magnet:?xt=urn:btih:aaaa&dn=debian");
+}
+
+TEST(FeedTests, Parse_ReadsAtomEntries)
+{
+    const auto items = Feed::Parse(R"(<feed xmlns="http://www.w3.org/2005/Atom">
+  <title>Releases</title>
+  <link href="https://example.com/" />
+  <entry>
+    <id>urn:uuid:1</id>
+    <title type="html">Fedora &#8211; 40</title>
+    <link rel="alternate" href="https://example.com/1" />
+    <link rel="enclosure" href="https://example.com/1.torrent" />
+  </entry>
+  <entry>
+    <title>Arch</title>
+    <link href="https://example.com/2.torrent" />
+  </entry>
+</feed>)");
+
+    ASSERT_EQ(items.size(), 2);
+    EXPECT_EQ(items[0].id, "urn:uuid:1");
+    EXPECT_EQ(items[0].title, "Fedora \xe2\x80\x93 40");
+    EXPECT_EQ(items[0].link, "https://example.com/1.torrent");
+    EXPECT_EQ(items[1].id, "https://example.com/2.torrent");
+    EXPECT_EQ(items[1].link, "https://example.com/2.torrent");
+}
+
+TEST(FeedTests, Parse_ThrowsForOtherDocuments)
+{
+    EXPECT_THROW(Feed::Parse("<html><body></body></html>"), std::invalid_argument);
+    EXPECT_THROW(Feed::Parse("not xml"), std::invalid_argument);
+}
+
+TEST(FeedTests, Unescape_KeepsUnknownReferences)
+{
+    EXPECT_EQ(Feed::Unescape("a &amp; b &#x41;&#66; &nbsp; & c"), "a & b AB &nbsp; & c");
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include "../../src/utils/gzip.hpp"
+
+using porla::Utils::Gzip;
+
+static std::string Inflate(const std::string& data)
+{
+    z_stream zs{};
+    inflateInit2(&zs, 15 + 16);
+
+    std::string out(64 * 1024, '\0');
+
+    zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in  = static_cast<uInt>(data.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    inflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+
+    return out;
+}
+
+TEST(GzipTests, Compress_RoundTripsThroughInflate)
+{
+    const std::string data(10000, 'a');
+    const auto compressed = Gzip::Compress(data);
+
+    ASSERT_GE(compressed.size(), 2);
+    EXPECT_EQ(static_cast<unsigned char>(compressed[0]), 0x1f);
+    EXPECT_EQ(static_cast<unsigned char>(compressed[1]), 0x8b);
+    EXPECT_LT(compressed.size(), data.size());
+    EXPECT_EQ(Inflate(compressed), data);
+}
+
+TEST(GzipTests, IsAccepted_HonorsQualityValues)
+{
+    EXPECT_TRUE(Gzip::IsAccepted("gzip"));
+    EXPECT_TRUE(Gzip::IsAccepted("deflate, gzip;q=0.5"));
+    EXPECT_FALSE(Gzip::IsAccepted("gzip;q=0"));
+    EXPECT_FALSE(Gzip::IsAccepted("br, deflate"));
+}
+
+TEST(GzipTests, Stream_CompressesPartsIntoOneStream)
+{
+    Gzip::Stream stream;
+    std::string compressed;
+
+    stream.Write(std::string(5000, 'a'), compressed, false);
+    stream.Write(std::string(5000, 'b'), compressed, false);
+    stream.Write("", compressed, true);
+
+    EXPECT_EQ(Inflate(compressed), std::string(5000, 'a') + std::string(5000, 'b'));
+}
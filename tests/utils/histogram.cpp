@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include "../../src/utils/histogram.hpp"
+
+using porla::Utils::Histogram;
+
+TEST(HistogramTests, Observe_CountsInTheFirstBucketThatFits)
+{
+    Histogram histogram({ 1, 10 });
+
+    histogram.Observe(0.5);
+    histogram.Observe(1);
+    histogram.Observe(5);
+    histogram.Observe(100);
+
+    EXPECT_EQ(histogram.Counts(), std::vector<std::uint64_t>({ 2, 1, 1 }));
+    EXPECT_EQ(histogram.Count(), 4);
+    EXPECT_DOUBLE_EQ(histogram.Sum(), 106.5);
+}
+
+TEST(HistogramTests, Quantile_InterpolatesWithinTheBucket)
+{
+    Histogram histogram({ 1, 10 });
+
+    EXPECT_DOUBLE_EQ(histogram.Quantile(0.5), 0);
+
+    histogram.Observe(0.5);
+    histogram.Observe(0.5);
+    histogram.Observe(5);
+    histogram.Observe(5);
+
+    EXPECT_DOUBLE_EQ(histogram.Quantile(0.5), 1);
+    EXPECT_DOUBLE_EQ(histogram.Quantile(0.75), 5.5);
+
+    histogram.Observe(100);
+
+    EXPECT_DOUBLE_EQ(histogram.Quantile(0.99), 10);
+}
+
+TEST(HistogramTests, Merge_AddsHistogramsWithTheSameBounds)
+{
+    Histogram histogram({ 1, 10 });
+    Histogram other({ 1, 10 });
+    Histogram different({ 5 });
+
+    histogram.Observe(0.5);
+    other.Observe(5);
+    other.Observe(100);
+    different.Observe(1);
+
+    histogram.Merge(other);
+    histogram.Merge(different);
+
+    EXPECT_EQ(histogram.Counts(), std::vector<std::uint64_t>({ 1, 1, 1 }));
+    EXPECT_EQ(histogram.Count(), 3);
+    EXPECT_DOUBLE_EQ(histogram.Sum(), 105.5);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include "../../src/utils/lrucache.hpp"
+
+using porla::Utils::LruCache;
+
+TEST(LruCache, Get_ForMissingKey_ReturnsNullopt)
+{
+    LruCache<std::string, int> cache(2);
+    EXPECT_EQ(cache.Get("foo"), std::nullopt);
+}
+
+TEST(LruCache, Put_OverCapacity_EvictsLeastRecentlyUsed)
+{
+    LruCache<std::string, int> cache(2);
+    cache.Put("foo", 1);
+    cache.Put("bar", 2);
+
+    // Touch foo so bar becomes the least recently used item.
+    EXPECT_EQ(cache.Get("foo"), 1);
+
+    cache.Put("baz", 3);
+
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_EQ(cache.Get("foo"), 1);
+    EXPECT_EQ(cache.Get("bar"), std::nullopt);
+    EXPECT_EQ(cache.Get("baz"), 3);
+}
+
+TEST(LruCache, Put_ForExistingKey_ReplacesValue)
+{
+    LruCache<std::string, int> cache(2);
+    cache.Put("foo", 1);
+    cache.Put("foo", 2);
+
+    EXPECT_EQ(cache.Size(), 1);
+    EXPECT_EQ(cache.Get("foo"), 2);
+}
+
+TEST(LruCache, Erase_RemovesOnlyThatKey)
+{
+    LruCache<std::string, int> cache(2);
+    cache.Put("foo", 1);
+    cache.Put("bar", 2);
+    cache.Erase("foo");
+    cache.Erase("baz");
+
+    EXPECT_EQ(cache.Size(), 1);
+    EXPECT_EQ(cache.Get("foo"), std::nullopt);
+    EXPECT_EQ(cache.Get("bar"), 2);
+}
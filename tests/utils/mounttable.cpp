@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include "../../src/utils/mounttable.hpp"
+
+using porla::Utils::MountTable;
+
+TEST(MountTable, Parse_ReadsDeviceMountPointAndSource)
+{
+    const auto mounts = MountTable::Parse(
+        "22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+        "36 22 0:32 / /mnt/my\\040disk rw,nosuid master:2 shared:3 - xfs /dev/mapper/data rw,usrquota\n"
+        "37 22 259:65536 / /srv rw - btrfs /dev/nvme0n1p1 rw\n");
+
+    ASSERT_EQ(mounts.size(), 3);
+
+    EXPECT_EQ(mounts.at({ 8, 1 }).mount_point, "/");
+    EXPECT_EQ(mounts.at({ 8, 1 }).source, "/dev/sda1");
+    EXPECT_EQ(mounts.at({ 0, 32 }).fs_type, "xfs");
+    EXPECT_EQ(mounts.at({ 0, 32 }).mount_point, "/mnt/my disk");
+    EXPECT_EQ(mounts.at({ 259, 65536 }).source, "/dev/nvme0n1p1");
+}
+
+TEST(MountTable, Parse_SkipsMalformedLinesAndKeepsFirstMount)
+{
+    const auto mounts = MountTable::Parse(
+        "garbage\n"
+        "22 1 8:1 / / rw - ext4 /dev/sda1 rw\n"
+        "23 1 8:1 /home /home rw - ext4 /dev/sda1 rw\n"
+        "24 1 x:y / /bad rw - ext4 /dev/sdb rw\n"
+        "25 1 8:2 / /nosep rw ext4 /dev/sdc rw");
+
+    ASSERT_EQ(mounts.size(), 1);
+    EXPECT_EQ(mounts.at({ 8, 1 }).mount_point, "/");
+}
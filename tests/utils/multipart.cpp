@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "../../src/utils/multipart.hpp"
+
+using porla::Utils::Multipart;
+
+TEST(MultipartTests, Boundary_ReadsQuotedAndUnquotedValues)
+{
+    EXPECT_EQ(Multipart::Boundary("multipart/form-data; boundary=abc"), "abc");
+    EXPECT_EQ(Multipart::Boundary("Multipart/Form-Data; charset=utf-8; boundary=\"a b\""), "a b");
+    EXPECT_EQ(Multipart::Boundary("application/x-bittorrent"), "");
+}
+
+TEST(MultipartTests, Parse_FindsPartsWithinTheBody)
+{
+    const std::string body =
+        "--xyz\r\n"
+        "Content-Disposition: form-data; name=\"params\"\r\n"
+        "Content-Type: application/json\r\n"
+        "\r\n"
+        "{\"save_path\":\"/tmp\"}\r\n"
+        "--xyz\r\n"
+        "Content-Disposition: form-data; name=\"torrent\"; filename=\"a.torrent\"\r\n"
+        "\r\n"
+        "d4:info\r\nd\r\n--xyz--\r\n";
+
+    const auto parts = Multipart::Parse(body, "xyz");
+
+    ASSERT_EQ(parts.size(), 2);
+    EXPECT_EQ(parts[0].name, "params");
+    EXPECT_EQ(parts[0].content_type, "application/json");
+    EXPECT_EQ(body.substr(parts[0].offset, parts[0].size), "{\"save_path\":\"/tmp\"}");
+    EXPECT_EQ(parts[1].name, "torrent");
+    EXPECT_EQ(parts[1].filename, "a.torrent");
+    EXPECT_EQ(body.substr(parts[1].offset, parts[1].size), "d4:info\r\nd");
+}
+
+TEST(MultipartTests, Parse_ThrowsForUnterminatedParts)
+{
+    EXPECT_THROW(
+        Multipart::Parse("--xyz\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\nabc", "xyz"),
+        std::invalid_argument);
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+
+#include "../../src/utils/pprof.hpp"
+
+using porla::Utils::Pprof;
+
+// The top level fields of a message, by number, with the length delimited ones as their
+// content.
+static std::multimap<int, std::string> Fields(const std::string& message)
+{
+    std::multimap<int, std::string> fields;
+    std::size_t offset = 0;
+
+    auto varint = [&]()
+    {
+        std::uint64_t value = 0;
+        for (int shift = 0; offset < message.size(); shift += 7)
+        {
+            const auto byte = static_cast<unsigned char>(message[offset++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        return value;
+    };
+
+    while (offset < message.size())
+    {
+        const auto key = varint();
+
+        if ((key & 7) == 2)
+        {
+            const auto size = varint();
+            fields.emplace(static_cast<int>(key >> 3), message.substr(offset, size));
+            offset += size;
+        }
+        else
+        {
+            fields.emplace(static_cast<int>(key >> 3), std::to_string(varint()));
+        }
+    }
+
+    return fields;
+}
+
+TEST(Pprof, Encode_WritesSamplesLocationsAndStrings)
+{
+    Pprof profile({{"samples", "count"}, {"cpu", "nanoseconds"}}, {"cpu", "nanoseconds"}, 10000000);
+
+    profile.AddMapping(0x1000, 0x2000, 0, "/usr/bin/porla", "abcd");
+    profile.AddFunction(0x1010, "main");
+    profile.AddSample({0x1020, 0x1010}, {1, 10000000}, {{.key = "thread", .str = "porla"}});
+    profile.AddSample({0x1010}, {2, 20000000});
+
+    const auto fields = Fields(profile.Encode(1, 2));
+
+    EXPECT_EQ(fields.count(1), 2);
+    EXPECT_EQ(fields.count(2), 2);
+    EXPECT_EQ(fields.count(3), 1);
+    // The two addresses, and one function for the one which is named.
+    EXPECT_EQ(fields.count(4), 2);
+    EXPECT_EQ(fields.count(5), 1);
+    EXPECT_EQ(fields.find(12)->second, "10000000");
+
+    std::vector<std::string> strings;
+    const auto [begin, end] = fields.equal_range(6);
+    for (auto it = begin; it != end; ++it) strings.push_back(it->second);
+
+    ASSERT_FALSE(strings.empty());
+    EXPECT_EQ(strings[0], "");
+    EXPECT_NE(std::find(strings.begin(), strings.end(), "main"), strings.end());
+    EXPECT_NE(std::find(strings.begin(), strings.end(), "porla"), strings.end());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../../src/utils/signal.hpp"
+
+using porla::Utils::Connection;
+using porla::Utils::ScopedConnection;
+using porla::Utils::Signal;
+
+TEST(Signal, Disconnect_StopsCallingSlot)
+{
+    Signal<void(int)> signal;
+    int sum = 0;
+
+    auto connection = signal.connect([&sum](int value) { sum += value; });
+
+    signal(1);
+    connection.disconnect();
+    signal(2);
+
+    EXPECT_EQ(sum, 1);
+    EXPECT_TRUE(signal.empty());
+    EXPECT_FALSE(connection.connected());
+}
+
+TEST(Signal, DisconnectWhileEmitting_SkipsSlotsNotYetCalled)
+{
+    Signal<void()> signal;
+    std::vector<int> calls;
+    Connection second;
+
+    signal.connect([&]() { calls.push_back(1); second.disconnect(); });
+    second = signal.connect([&]() { calls.push_back(2); });
+
+    signal();
+    signal();
+
+    EXPECT_EQ(calls, std::vector<int>({ 1, 1 }));
+    EXPECT_EQ(signal.num_slots(), 1);
+}
+
+TEST(Signal, ConnectWhileEmitting_CallsSlotFromNextEmit)
+{
+    Signal<void()> signal;
+    int calls = 0;
+    bool connected = false;
+
+    signal.connect([&]()
+    {
+        if (!connected)
+        {
+            connected = true;
+            signal.connect([&calls]() { calls++; });
+        }
+    });
+
+    signal();
+    EXPECT_EQ(calls, 0);
+
+    signal();
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(Signal, Connection_OutlivingSignal_DisconnectsSafely)
+{
+    Connection connection;
+
+    {
+        Signal<void()> signal;
+        connection = signal.connect([]() {});
+        EXPECT_TRUE(connection.connected());
+    }
+
+    EXPECT_FALSE(connection.connected());
+    connection.disconnect();
+}
+
+TEST(Signal, ScopedConnection_DisconnectsOnDestruction)
+{
+    Signal<void()> signal;
+
+    {
+        ScopedConnection scoped = signal.connect([]() {});
+        EXPECT_EQ(signal.num_slots(), 1);
+    }
+
+    EXPECT_TRUE(signal.empty());
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../../src/utils/topk.hpp"
+
+using porla::Utils::TopK;
+
+TEST(TopK, Top_ReturnsHeaviestFirst)
+{
+    TopK<std::string> top(4);
+    top.Add("a", 10);
+    top.Add("b", 30);
+    top.Add("c", 20);
+    top.Add("a", 25);
+
+    const auto items = top.Top(2);
+
+    ASSERT_EQ(items.size(), 2);
+    EXPECT_EQ(items[0].key, "a");
+    EXPECT_EQ(items[0].weight, 35);
+    EXPECT_EQ(items[0].error, 0);
+    EXPECT_EQ(items[1].key, "b");
+}
+
+TEST(TopK, Add_OverCapacity_ReplacesLightestAndKeepsItsWeightAsError)
+{
+    TopK<std::string> top(2);
+    top.Add("a", 100);
+    top.Add("b", 5);
+    top.Add("c", 7);
+
+    const auto items = top.Top(2);
+
+    ASSERT_EQ(top.Size(), 2);
+    EXPECT_EQ(items[0].key, "a");
+    EXPECT_EQ(items[1].key, "c");
+    EXPECT_EQ(items[1].weight, 12);
+    EXPECT_EQ(items[1].error, 5);
+}
+
+TEST(TopK, Add_HoldsHeavyKeysOfLongStreams)
+{
+    TopK<int> top(8);
+
+    for (int i = 0; i < 10000; i++)
+    {
+        top.Add(i % 100, 1);
+        if (i % 10 == 0) top.Add(-1, 10);
+    }
+
+    const auto items = top.Top(1);
+
+    ASSERT_EQ(items.size(), 1);
+    EXPECT_EQ(items[0].key, -1);
+    EXPECT_GE(items[0].weight, 10000);
+    EXPECT_LE(items[0].weight - items[0].error, 10000);
+}
+
+TEST(TopK, Merge_SumsWeightsAndErrors)
+{
+    TopK<std::string> first(2);
+    first.Add("a", 10);
+    first.Add("b", 1);
+    first.Add("c", 2);
+
+    TopK<std::string> second(2);
+    second.Add("a", 5);
+    second.Add("c", 4);
+
+    TopK<std::string> merged(4);
+    merged.Merge(first);
+    merged.Merge(second);
+
+    const auto items = merged.Top(2);
+
+    ASSERT_EQ(items.size(), 2);
+    EXPECT_EQ(items[0].key, "a");
+    EXPECT_EQ(items[0].weight, 15);
+    EXPECT_EQ(items[1].key, "c");
+    EXPECT_EQ(items[1].weight, 7);
+    EXPECT_EQ(items[1].error, 1);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include "../../src/utils/zip.hpp"
+
+using porla::Utils::Zip;
+
+static void Put(std::string& out, std::uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) out.push_back(static_cast<char>(value >> (i * 8) & 0xff));
+}
+
+static std::string Deflate(const std::string& data)
+{
+    z_stream zs{};
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+    std::string out(deflateBound(&zs, data.size()), '\0');
+
+    zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in  = static_cast<uInt>(data.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    return out;
+}
+
+// An archive with one entry per file, deflated unless store is set, the way zip tools
+// lay them out.
+static std::string Archive(const std::vector<std::tuple<std::string, std::string, bool>>& files)
+{
+    std::string archive;
+    std::string directory;
+
+    for (const auto& [name, content, store] : files)
+    {
+        const auto data = store ? content : Deflate(content);
+        const auto crc  = static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(content.data()), static_cast<uInt>(content.size())));
+        const auto local = static_cast<std::uint32_t>(archive.size());
+
+        Put(archive, 0x04034b50, 4);
+        Put(archive, 20, 2);
+        Put(archive, 0, 2);
+        Put(archive, store ? 0 : 8, 2);
+        Put(archive, 0, 4);
+        Put(archive, crc, 4);
+        Put(archive, data.size(), 4);
+        Put(archive, content.size(), 4);
+        Put(archive, name.size(), 2);
+        Put(archive, 0, 2);
+        archive += name + data;
+
+        Put(directory, 0x02014b50, 4);
+        Put(directory, 20, 2);
+        Put(directory, 20, 2);
+        Put(directory, 0, 2);
+        Put(directory, store ? 0 : 8, 2);
+        Put(directory, 0, 4);
+        Put(directory, crc, 4);
+        Put(directory, data.size(), 4);
+        Put(directory, content.size(), 4);
+        Put(directory, name.size(), 2);
+        Put(directory, 0, 2);
+        Put(directory, 0, 2);
+        Put(directory, 0, 2);
+        Put(directory, 0, 2);
+        Put(directory, 0, 4);
+        Put(directory, local, 4);
+        directory += name;
+    }
+
+    const auto offset = archive.size();
+    archive += directory;
+
+    Put(archive, 0x06054b50, 4);
+    Put(archive, 0, 4);
+    Put(archive, files.size(), 2);
+    Put(archive, files.size(), 2);
+    Put(archive, directory.size(), 4);
+    Put(archive, offset, 4);
+    Put(archive, 0, 2);
+
+    return archive;
+}
+
+TEST(ZipTests, Entries_PointsIntoTheArchive)
+{
+    const std::string html(1000, 'a');
+    const auto archive = Archive({ { "index.html", html, false }, { "logo.png", "png", true } });
+
+    const auto entries = Zip::Entries(archive);
+
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(entries[0].name, "index.html");
+    EXPECT_EQ(entries[0].method, Zip::Deflated);
+    EXPECT_EQ(entries[0].size, html.size());
+    EXPECT_EQ(entries[1].name, "logo.png");
+    EXPECT_EQ(entries[1].data, "png");
+    EXPECT_GE(entries[1].data.data(), archive.data());
+    EXPECT_LT(entries[1].data.data(), archive.data() + archive.size());
+}
+
+TEST(ZipTests, Gzip_WrapsTheDeflatedDataWithoutInflating)
+{
+    const std::string content = "hello, hello, hello, hello";
+    const auto entries = Zip::Entries(Archive({ { "a.js", content, false } }));
+    const auto gzip = Zip::Gzip(entries[0]);
+
+    z_stream zs{};
+    inflateInit2(&zs, 15 + 16);
+
+    std::string out(content.size(), '\0');
+
+    zs.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(gzip.data()));
+    zs.avail_in  = static_cast<uInt>(gzip.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    // Z_STREAM_END is only returned once the trailer's CRC and size check out.
+    EXPECT_EQ(inflate(&zs, Z_FINISH), Z_STREAM_END);
+    inflateEnd(&zs);
+
+    EXPECT_EQ(out, content);
+}
+
+TEST(ZipTests, Inflate_ReturnsTheContent)
+{
+    const std::string content(5000, 'x');
+    const auto entries = Zip::Entries(Archive({ { "a.css", content, false }, { "b.css", "b", true } }));
+
+    EXPECT_EQ(Zip::Inflate(entries[0]), content);
+    EXPECT_EQ(Zip::Inflate(entries[1]), "b");
+}
+
+TEST(ZipTests, Entries_ThrowsOnGarbage)
+{
+    EXPECT_THROW(Zip::Entries("not a zip archive at all"), std::runtime_error);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+#include <boost/asio/executor_work_guard.hpp>
+
+#include "../src/workerpool.hpp"
+
+using porla::WorkerPool;
+using porla::WorkerPoolOptions;
+
+TEST(WorkerPoolTests, Post_RunsOffTheIoThreadAndCompletesOnIt)
+{
+    boost::asio::io_context io;
+    WorkerPool pool(io, WorkerPoolOptions{ .threads = 1, .queue_size = 4 });
+
+    std::thread::id worker;
+    std::thread::id completed;
+
+    ASSERT_TRUE(pool.Post(
+        [&]()
+        {
+            worker = std::this_thread::get_id();
+            pool.Complete([&]() { completed = std::this_thread::get_id(); });
+        }));
+
+    // Blocks until the completion is posted, then runs it here.
+    auto work = boost::asio::make_work_guard(io);
+    io.run_one();
+
+    EXPECT_NE(worker, std::this_thread::get_id());
+    EXPECT_EQ(completed, std::this_thread::get_id());
+    EXPECT_EQ(pool.GetStats().completed, 1);
+}
+
+TEST(WorkerPoolTests, Post_RejectsWhenTheQueueIsFull)
+{
+    std::promise<void> started;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    boost::asio::io_context io;
+    WorkerPool pool(io, WorkerPoolOptions{ .threads = 1, .queue_size = 1 });
+
+    ASSERT_TRUE(pool.Post([&started, released]() { started.set_value(); released.wait(); }));
+    started.get_future().wait();
+
+    EXPECT_TRUE(pool.Post([]() {}));
+    EXPECT_FALSE(pool.Post([]() {}));
+    EXPECT_EQ(pool.GetStats().queued, 1);
+    EXPECT_EQ(pool.GetStats().rejected, 1);
+
+    release.set_value();
+}
+
+TEST(WorkerPoolTests, OnStart_RunsOnEveryWorkerFirst)
+{
+    std::atomic<int> started = 0;
+
+    boost::asio::io_context io;
+
+    {
+        WorkerPool pool(io, WorkerPoolOptions{ .threads = 2, .queue_size = 1, .on_start = [&started]() { started++; } });
+        pool.Stop();
+    }
+
+    EXPECT_EQ(started, 2);
+}
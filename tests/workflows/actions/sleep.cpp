@@ -2,6 +2,7 @@
 
 #include "../../../src/workflows/action.hpp"
 #include "../../../src/workflows/actions/sleep.hpp"
+#include "../../../src/workflows/timerwheel.hpp"
 
 using porla::Workflows::ActionCallback;
 using porla::Workflows::ActionParams;
@@ -49,10 +50,12 @@ class SleepTests : public ::testing::Test
 protected:
     void SetUp() override
     {
-        sleep = std::make_unique<Sleep>(io);
+        timers = std::make_unique<porla::Workflows::TimerWheel>(io);
+        sleep = std::make_unique<Sleep>(*timers);
     }
 
     boost::asio::io_context io;
+    std::unique_ptr<porla::Workflows::TimerWheel> timers;
     std::unique_ptr<Sleep> sleep;
 };
 
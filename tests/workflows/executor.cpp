@@ -4,6 +4,8 @@
 
 #include "../inmemorysession.hpp"
 
+#include "../../src/data/migrate.hpp"
+
 #include "../../src/workflows/action.hpp"
 #include "../../src/workflows/actionfactory.hpp"
 #include "../../src/workflows/executor.hpp"
@@ -32,9 +34,10 @@ protected:
         session = std::make_unique<InMemorySession>();
     }
 
-    auto LoadWorkflow(const std::string& yaml, const std::shared_ptr<MockAction>& mock_action)
+    auto LoadWorkflow(const std::string& yaml, const std::shared_ptr<MockAction>& mock_action, sqlite3* db = nullptr)
     {
         return std::make_unique<Executor>(porla::Workflows::ExecutorOptions{
+            .io = io,
             .session = *session,
             .workflows = {
                 Workflow::LoadFromYaml(yaml)
@@ -43,7 +46,8 @@ protected:
                 std::map<std::string, std::function<std::shared_ptr<porla::Workflows::Action>()>>{
                     {"log", []() { return std::make_shared<Log>(); }},
                     {"mock", [&]() { return mock_action; }}
-                })
+                }),
+            .db = db
         });
     }
 
@@ -119,3 +123,177 @@ steps:
     session->m_torrentAdded(ts);
     io.run();
 }
+
+TEST_F(ExecutorTests, OnTriggerWithConcurrencyLimitQueuesRuns)
+{
+    const auto mock_action = std::make_shared<MockAction>();
+    const auto executor = LoadWorkflow(R"(
+on: torrent_added
+concurrency: 1
+steps:
+  - uses: mock
+)", mock_action);
+
+    std::shared_ptr<ActionCallback> pending;
+
+    EXPECT_CALL(*mock_action, Invoke)
+        .Times(2)
+        .WillRepeatedly(
+            [&pending](const ActionParams&, const std::shared_ptr<ActionCallback>& callback)
+            {
+                pending = callback;
+            });
+
+    lt::torrent_status ts;
+    ts.name = "test-torrent";
+
+    session->m_torrentAdded(ts);
+    session->m_torrentAdded(ts);
+
+    EXPECT_EQ(executor->Stats().at(0).running, 1);
+    EXPECT_EQ(executor->Stats().at(0).queued, 1);
+
+    // Releasing the first run starts the queued one.
+    pending->Complete({});
+    pending.reset();
+
+    EXPECT_EQ(executor->Stats().at(0).queued, 0);
+    EXPECT_EQ(executor->Stats().at(0).runs, 2);
+}
+
+TEST_F(ExecutorTests, OnTriggerWithBatchRunsOnceForAllTorrents)
+{
+    const auto mock_action = std::make_shared<MockAction>();
+    const auto executor = LoadWorkflow(R"(
+on: torrent_added
+batch:
+  window: 60
+  max_size: 2
+steps:
+  - uses: mock
+)", mock_action);
+
+    EXPECT_CALL(*mock_action, Invoke)
+        .Times(1)
+        .WillOnce(
+            [](const ActionParams& params, const std::shared_ptr<ActionCallback>& callback)
+            {
+                EXPECT_EQ(params.Render("torrents.length", true), 2);
+                callback->Complete({});
+            });
+
+    lt::torrent_status ts;
+    ts.name = "test-torrent";
+
+    session->m_torrentAdded(ts);
+    session->m_torrentAdded(ts);
+    io.run();
+}
+
+TEST_F(ExecutorTests, SetWorkflowsDropsQueuedRunsAndFinishesRunning)
+{
+    const auto mock_action = std::make_shared<MockAction>();
+    const auto executor = LoadWorkflow(R"(
+on: torrent_added
+concurrency: 1
+steps:
+  - uses: mock
+)", mock_action);
+
+    std::shared_ptr<ActionCallback> pending;
+
+    EXPECT_CALL(*mock_action, Invoke)
+        .Times(2)
+        .WillRepeatedly(
+            [&pending](const ActionParams&, const std::shared_ptr<ActionCallback>& callback)
+            {
+                pending = callback;
+            });
+
+    lt::torrent_status ts;
+    ts.name = "test-torrent";
+
+    session->m_torrentAdded(ts);
+    session->m_torrentAdded(ts);
+
+    executor->SetWorkflows({
+        Workflow::LoadFromYaml(R"(
+on: torrent_added
+steps:
+  - uses: mock
+)", "reloaded")
+    });
+
+    EXPECT_EQ(executor->Queue().queued, 0);
+    EXPECT_EQ(executor->Queue().running, 1);
+    EXPECT_EQ(executor->Stats().at(0).name, "reloaded");
+
+    // The old run still holds its slot until it is done.
+    pending->Complete({});
+    pending.reset();
+
+    EXPECT_EQ(executor->Queue().running, 0);
+
+    session->m_torrentAdded(ts);
+
+    EXPECT_EQ(executor->Stats().at(0).runs, 1);
+}
+
+TEST_F(ExecutorTests, RunsInProgressResumeFromLastStage)
+{
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(":memory:", &db), SQLITE_OK);
+    ASSERT_TRUE(porla::Data::Migrate(db));
+
+    const auto yaml = R"(
+name: resumed
+on: torrent_added
+steps:
+  - uses: mock
+  - uses: mock
+)";
+
+    lt::torrent_status ts;
+    ts.info_hashes = lt::info_hash_t(lt::sha1_hash("aaaaaaaaaaaaaaaaaaaa"));
+    ts.name = "test-torrent";
+
+    session->m_statuses.insert({ ts.info_hashes, ts });
+
+    std::shared_ptr<ActionCallback> pending;
+
+    {
+        const auto mock_action = std::make_shared<MockAction>();
+        const auto executor = LoadWorkflow(yaml, mock_action, db);
+
+        EXPECT_CALL(*mock_action, Invoke)
+            .WillOnce([](const ActionParams&, const std::shared_ptr<ActionCallback>& callback) { callback->Complete({{"first", true}}); })
+            .WillOnce([&pending](const ActionParams&, const std::shared_ptr<ActionCallback>& callback) { pending = callback; });
+
+        session->m_torrentAdded(ts);
+    }
+
+    // The run outlived the executor, as when porla stops.
+    pending.reset();
+
+    const auto mock_action = std::make_shared<MockAction>();
+
+    EXPECT_CALL(*mock_action, Invoke)
+        .WillOnce(
+            [](const ActionParams& params, const std::shared_ptr<ActionCallback>& callback)
+            {
+                EXPECT_EQ(params.Render("steps[0].first", true), true);
+                callback->Complete({});
+            });
+
+    {
+        const auto executor = LoadWorkflow(yaml, mock_action, db);
+        EXPECT_EQ(executor->Stats().at(0).runs, 1);
+    }
+
+    // Done runs are removed.
+    int rows = -1;
+    sqlite3_exec(db, "SELECT COUNT(*) FROM workflowruns;", [](void* user, int, char** values, char**) { *static_cast<int*>(user) = std::stoi(values[0]); return 0; }, &rows, nullptr);
+    EXPECT_EQ(rows, 0);
+
+    sqlite3_close(db);
+}
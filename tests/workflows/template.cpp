@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+
+#include "../../src/workflows/template.hpp"
+#include "../../src/workflows/textrenderer.hpp"
+
+using porla::Workflows::Template;
+using porla::Workflows::TextRenderer;
+
+TEST(TemplateTests, Parse_SplitsLiteralsAndExpressions)
+{
+    const auto tpl = Template::Parse("a ${{ x }} b ${{ y }}");
+
+    ASSERT_EQ(tpl->Fragments().size(), 4);
+    EXPECT_FALSE(tpl->Fragments()[0].expression);
+    EXPECT_EQ(tpl->Fragments()[0].text, "a ");
+    EXPECT_TRUE(tpl->Fragments()[1].expression);
+    EXPECT_EQ(tpl->Fragments()[1].text, "x");
+    EXPECT_EQ(tpl->Fragments()[3].text, "y");
+}
+
+TEST(TemplateTests, Compile_RendersLikeTheSourceText)
+{
+    const auto tpl = Template::Compile("Sum: ${{ 1 + 2 }}");
+
+    ASSERT_EQ(tpl->Fragments().size(), 2);
+    EXPECT_FALSE(tpl->Fragments()[1].bytecode.empty());
+
+    TextRenderer renderer({});
+    EXPECT_EQ(renderer.Render(*tpl), "Sum: 3");
+}
@@ -68,3 +68,39 @@ TEST_F(TextRendererTests, Render_WithSingleFragmentAsObject_ReturnsRawValue)
     const auto rendered_value = renderer->Render("${{ mock }}");
     EXPECT_EQ(rendered_value, R"({"foo": "bar", "num": 1337 })"_json);
 }
+
+TEST_F(TextRendererTests, Render_WithPooledHeap_DoesNotLeakGlobals)
+{
+    porla::Workflows::HeapPool pool(1);
+
+    {
+        TextRenderer first({}, pool);
+        EXPECT_EQ(first.Render("leaked = 1", true), 1);
+    }
+
+    TextRenderer second({}, pool);
+    EXPECT_EQ(second.Render("typeof leaked", true), "undefined");
+}
+
+class LazyContextProvider : public ContextProvider
+{
+public:
+    nlohmann::json Value() override { values++; return {{"a", 1}, {"b", 2}}; }
+    std::vector<std::string> Fields() override { return {"a", "b"}; }
+    nlohmann::json Field(const std::string& name) override { fields.push_back(name); return name == "a" ? 1 : 2; }
+
+    int values = 0;
+    std::vector<std::string> fields;
+};
+
+TEST_F(TextRendererTests, Render_WithLazyContext_BuildsFieldsOnceOnAccess)
+{
+    const auto lazy = std::make_shared<LazyContextProvider>();
+    TextRenderer lazy_renderer({{"lazy", lazy}});
+
+    EXPECT_EQ(lazy_renderer.Render("${{ lazy.a }}"), 1);
+    EXPECT_EQ(lazy_renderer.Render("${{ lazy.a + 1 }}"), 2);
+
+    EXPECT_EQ(lazy->values, 0);
+    EXPECT_EQ(lazy->fields, std::vector<std::string>{"a"});
+}
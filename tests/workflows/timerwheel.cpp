@@ -0,0 +1,29 @@
+#include <boost/asio.hpp>
+#include <gtest/gtest.h>
+
+#include "../../src/workflows/timerwheel.hpp"
+
+using porla::Workflows::TimerWheel;
+
+TEST(TimerWheelTests, Schedule_FiresInOrderOfExpiry)
+{
+    boost::asio::io_context io;
+    TimerWheel timers(io);
+
+    std::vector<int> fired;
+
+    // 700ms is past the first level, so it is cascaded down before firing.
+    timers.Schedule(std::chrono::milliseconds(700), [&fired]() { fired.push_back(3); });
+    timers.Schedule(std::chrono::milliseconds(20),  [&fired]() { fired.push_back(1); });
+    timers.Schedule(std::chrono::milliseconds(100), [&fired]() { fired.push_back(2); });
+
+    const auto cancelled = timers.Schedule(std::chrono::milliseconds(50), [&fired]() { fired.push_back(0); });
+    EXPECT_TRUE(timers.Cancel(cancelled));
+
+    io.run();
+
+    EXPECT_EQ(fired, std::vector<int>({ 1, 2, 3 }));
+    EXPECT_EQ(timers.GetStats().expired, 3);
+    EXPECT_EQ(timers.GetStats().cancelled, 1);
+    EXPECT_EQ(timers.GetStats().pending, 0);
+}
@@ -5,6 +5,7 @@
 #include "../../src/workflows/action.hpp"
 #include "../../src/workflows/actionfactory.hpp"
 #include "../../src/workflows/step.hpp"
+#include "../../src/workflows/stepbudget.hpp"
 #include "../../src/workflows/torrentcontextprovider.hpp"
 #include "../../src/workflows/workflow.hpp"
 
@@ -14,6 +15,7 @@ using porla::Workflows::ActionCallback;
 using porla::Workflows::ActionFactory;
 using porla::Workflows::ActionParams;
 using porla::Workflows::Step;
+using porla::Workflows::StepBudget;
 using porla::Workflows::TorrentContextProvider;
 using porla::Workflows::Workflow;
 using porla::Workflows::WorkflowOptions;
@@ -76,3 +78,100 @@ TEST_F(WorkflowTests, HasWorkingOutputs)
         {"torrent", std::make_shared<TorrentContextProvider>(ts)}
     });
 }
+
+TEST_F(WorkflowTests, ShouldExecute_WithWhereQuery_MatchesTheTorrent)
+{
+    const auto w = Workflow::LoadFromYaml(R"(
+on: torrent_finished
+where: name contains "ubuntu"
+)");
+
+    libtorrent::torrent_status ubuntu;
+    ubuntu.name = "ubuntu-22.04.iso";
+
+    libtorrent::torrent_status debian;
+    debian.name = "debian-12.iso";
+
+    EXPECT_TRUE(w->ShouldExecute("torrent_finished", {{"torrent", std::make_shared<TorrentContextProvider>(ubuntu)}}));
+    EXPECT_FALSE(w->ShouldExecute("torrent_finished", {{"torrent", std::make_shared<TorrentContextProvider>(debian)}}));
+}
+
+TEST_F(WorkflowTests, Execute_WithParallelGroup_RunsStepsTogetherAndJoins)
+{
+    const auto w = Workflow::LoadFromYaml(R"(
+on: torrent_finished
+steps:
+  - parallel:
+      - uses: mock
+      - uses: mock
+  - uses: mock
+)");
+
+    std::vector<std::shared_ptr<ActionCallback>> callbacks;
+    callbacks.reserve(3);
+
+    EXPECT_CALL(*mock_action, Invoke)
+        .Times(3)
+        .WillRepeatedly(
+            [&callbacks](const ActionParams& params, const std::shared_ptr<ActionCallback>& callback)
+            {
+                if (callbacks.size() == 2)
+                {
+                    EXPECT_EQ(params.Render("steps[0]", true), "first");
+                    EXPECT_EQ(params.Render("steps[1]", true), "second");
+                }
+
+                callbacks.push_back(callback);
+            });
+
+    bool done = false;
+    w->Execute(*action_factory, {}, [&done]() { done = true; });
+
+    ASSERT_EQ(callbacks.size(), 2);
+
+    // Completed out of order, and the last step waits for both.
+    callbacks[1]->Complete("second");
+    EXPECT_EQ(callbacks.size(), 2);
+
+    callbacks[0]->Complete("first");
+    ASSERT_EQ(callbacks.size(), 3);
+
+    callbacks[2]->Complete({});
+    callbacks.clear();
+
+    EXPECT_TRUE(done);
+}
+
+TEST_F(WorkflowTests, Execute_WithoutBudgetSlots_RunsParallelStepsOneAtATime)
+{
+    const auto w = Workflow::LoadFromYaml(R"(
+on: torrent_finished
+steps:
+  - parallel:
+      - uses: mock
+      - uses: mock
+)");
+
+    std::vector<std::shared_ptr<ActionCallback>> callbacks;
+    callbacks.reserve(2);
+
+    EXPECT_CALL(*mock_action, Invoke)
+        .Times(2)
+        .WillRepeatedly(
+            [&callbacks](const ActionParams&, const std::shared_ptr<ActionCallback>& callback)
+            {
+                callbacks.push_back(callback);
+            });
+
+    const auto budget = std::make_shared<StepBudget>(0);
+
+    w->Execute(*action_factory, {}, {}, { .budget = budget });
+
+    // The first step of a group needs no slot, and the next one waits for it to finish.
+    ASSERT_EQ(callbacks.size(), 1);
+    EXPECT_EQ(budget->Waiting(), 1);
+
+    callbacks[0]->Complete({});
+
+    EXPECT_EQ(callbacks.size(), 2);
+}